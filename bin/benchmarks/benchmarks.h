@@ -0,0 +1,95 @@
+#ifndef AWS_HTTP_BENCHMARKS_H
+#define AWS_HTTP_BENCHMARKS_H
+
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/common/array_list.h>
+#include <aws/common/atomics.h>
+#include <aws/common/error.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Print a message and abort. Benchmarks have no way to recover, and a wrong result must not be reported */
+#define BENCHMARK_CHECK(cond)                                                                                          \
+    do {                                                                                                               \
+        if (!(cond)) {                                                                                                 \
+            fprintf(                                                                                                   \
+                stderr,                                                                                                \
+                "%s:%d: check failed: %s, last error %s\n",                                                            \
+                __FILE__,                                                                                              \
+                __LINE__,                                                                                              \
+                #cond,                                                                                                 \
+                aws_error_name(aws_last_error()));                                                                     \
+            abort();                                                                                                   \
+        }                                                                                                              \
+    } while (0)
+
+#define BENCHMARK_MAX_METRICS 12
+
+struct benchmark_metric {
+    const char *name;
+    double value;
+};
+
+/* One line of the report */
+struct benchmark_result {
+    char name[96];
+    size_t metric_count;
+    struct benchmark_metric metrics[BENCHMARK_MAX_METRICS];
+};
+
+struct benchmark_ctx {
+    /* Counts every allocation made through it, see benchmark_get_allocation_count() */
+    struct aws_allocator allocator;
+    struct aws_allocator *parent_allocator;
+    struct aws_atomic_var allocation_count;
+
+    /* Only benchmarks whose name contains this run. NULL runs all */
+    const char *filter;
+
+    size_t message_count;
+    size_t payload_size;
+    size_t rounds;
+
+    /* Loopback sweep: comma-separated lists of event-loop counts, response body sizes and concurrent requests */
+    const char *loop_counts;
+    const char *loopback_payload_sizes;
+    const char *concurrencies;
+    uint64_t duration_ms;
+    /* Each loopback configuration listens on this plus its index */
+    uint32_t port;
+
+    /* struct benchmark_result */
+    struct aws_array_list results;
+};
+
+/* Number of allocations made through ctx->allocator so far. Includes reallocs */
+uint64_t benchmark_get_allocation_count(struct benchmark_ctx *ctx);
+
+bool benchmark_is_selected(const struct benchmark_ctx *ctx, const char *name);
+
+/* Returns a result to add metrics to. It's valid until the next call */
+struct benchmark_result *benchmark_add_result(struct benchmark_ctx *ctx, const char *name);
+
+void benchmark_result_add_metric(struct benchmark_result *result, const char *name, double value);
+
+/* In-memory encoders and decoders, see codec.c */
+void benchmark_run_codecs(struct benchmark_ctx *ctx);
+
+/* HPACK over a single connection's worth of header-blocks, part of the codec suite, see hpack_corpus.c */
+void benchmark_run_hpack_corpora(struct benchmark_ctx *ctx);
+
+/* Single hot functions, next to the code they replaced, see micro.c */
+void benchmark_run_micro(struct benchmark_ctx *ctx);
+
+/* An HTTP/2 client connection on a testing channel, see connection.c */
+void benchmark_run_connection(struct benchmark_ctx *ctx);
+
+/* HTTP/1.1 client and server talking over TCP on 127.0.0.1, see loopback.c */
+void benchmark_run_loopback(struct benchmark_ctx *ctx);
+
+#endif /* AWS_HTTP_BENCHMARKS_H */
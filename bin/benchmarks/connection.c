@@ -0,0 +1,451 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+#include "benchmarks.h"
+
+#include <aws/http/private/connection_impl.h>
+#include <aws/http/private/h2_connection.h>
+#include <aws/http/private/h2_frames.h>
+#include <aws/http/request_response.h>
+
+#include <aws/common/clock.h>
+#include <aws/io/stream.h>
+#include <aws/testing/io_testing_channel.h>
+
+/**
+ * Benchmarks of a whole HTTP/2 client connection, on a testing_channel instead of a socket.
+ *
+ * Everything runs on this thread: the time measured is the connection's own work (scheduling streams, encoding
+ * frames, filling aws_io_messages), with none of the noise of a real network.
+ * The fake server opens the flow-control windows all the way, so only the connection limits how fast DATA goes out.
+ * What the connection writes is drained after each run, outside the time measured.
+ */
+
+struct connection_bench {
+    struct aws_allocator *allocator;
+    struct testing_channel testing_channel;
+    struct aws_http_connection *connection;
+
+    /* Encodes what the fake server sends */
+    struct aws_h2_frame_encoder peer_encoder;
+    struct aws_byte_buf peer_output;
+
+    /* Where written messages are drained to */
+    struct aws_byte_buf written;
+};
+
+static void s_peer_send_frame(struct connection_bench *bench, struct aws_h2_frame *frame) {
+    BENCHMARK_CHECK(frame != NULL);
+    bool frame_complete = false;
+    while (!frame_complete) {
+        aws_byte_buf_reset(&bench->peer_output, false);
+        BENCHMARK_CHECK(
+            aws_h2_encode_frame(&bench->peer_encoder, frame, &bench->peer_output, &frame_complete) == AWS_OP_SUCCESS);
+        BENCHMARK_CHECK(
+            testing_channel_push_read_data(&bench->testing_channel, aws_byte_cursor_from_buf(&bench->peer_output)) ==
+            AWS_OP_SUCCESS);
+    }
+    aws_h2_frame_destroy(frame);
+}
+
+/* Gives back the connection flow-control window used by DATA the connection sent */
+static void s_peer_send_connection_window_update(struct connection_bench *bench, size_t data_bytes) {
+    while (data_bytes > 0) {
+        uint32_t increment = (uint32_t)aws_min_size(data_bytes, AWS_H2_WINDOW_UPDATE_MAX);
+        s_peer_send_frame(bench, aws_h2_frame_new_window_update(bench->allocator, 0 /*stream_id*/, increment));
+        data_bytes -= increment;
+    }
+}
+
+/* Responds to a stream, which completes it */
+static void s_peer_send_response(struct connection_bench *bench, struct aws_http_stream *stream) {
+    struct aws_http_headers *headers = aws_http_headers_new(bench->allocator);
+    BENCHMARK_CHECK(headers != NULL);
+    BENCHMARK_CHECK(
+        aws_http_headers_add(headers, aws_byte_cursor_from_c_str(":status"), aws_byte_cursor_from_c_str("200")) ==
+        AWS_OP_SUCCESS);
+    s_peer_send_frame(
+        bench,
+        aws_h2_frame_new_headers(
+            bench->allocator, aws_http_stream_get_id(stream), headers, true /*end_stream*/, 0 /*pad_length*/, NULL));
+    aws_http_headers_release(headers);
+}
+
+/* Returns the number of aws_io_messages the connection wrote, and adds up their bytes */
+static size_t s_drain_written(struct connection_bench *bench, size_t *out_bytes) {
+    size_t message_count = 0;
+    struct aws_linked_list *written_msgs = testing_channel_get_written_message_queue(&bench->testing_channel);
+    for (struct aws_linked_list_node *node = aws_linked_list_begin(written_msgs);
+         node != aws_linked_list_end(written_msgs);
+         node = aws_linked_list_next(node)) {
+        ++message_count;
+    }
+
+    aws_byte_buf_reset(&bench->written, false);
+    BENCHMARK_CHECK(testing_channel_drain_written_messages(&bench->testing_channel, &bench->written) == AWS_OP_SUCCESS);
+    if (out_bytes) {
+        *out_bytes = bench->written.len;
+    }
+    return message_count;
+}
+
+/* peer_max_frame_size is the MAX_FRAME_SIZE the fake server allows the connection to send */
+static void s_connection_bench_init(
+    struct connection_bench *bench,
+    struct benchmark_ctx *ctx,
+    uint32_t peer_max_frame_size) {
+
+    AWS_ZERO_STRUCT(*bench);
+    bench->allocator = ctx->parent_allocator;
+
+    struct aws_testing_channel_options channel_options = {.clock_fn = aws_high_res_clock_get_ticks};
+    BENCHMARK_CHECK(
+        testing_channel_init(&bench->testing_channel, bench->allocator, &channel_options) == AWS_OP_SUCCESS);
+
+    struct aws_http2_setting settings_array[] = {
+        {.id = AWS_HTTP2_SETTINGS_ENABLE_PUSH, .value = 0},
+    };
+    struct aws_http2_connection_options http2_options = {
+        .initial_settings_array = settings_array,
+        .num_initial_settings = AWS_ARRAY_SIZE(settings_array),
+        .max_closed_streams = AWS_HTTP2_DEFAULT_MAX_CLOSED_STREAMS,
+    };
+
+    /* Only the connection gets the counting allocator */
+    bench->connection =
+        aws_http_connection_new_http2_client(&ctx->allocator, false /*manual_window_management*/, &http2_options);
+    BENCHMARK_CHECK(bench->connection != NULL);
+
+    /* What the http-bootstrap would do for a real connection */
+    struct aws_channel_slot *slot = aws_channel_slot_new(bench->testing_channel.channel);
+    BENCHMARK_CHECK(slot != NULL);
+    BENCHMARK_CHECK(aws_channel_slot_insert_end(bench->testing_channel.channel, slot) == AWS_OP_SUCCESS);
+    BENCHMARK_CHECK(aws_channel_slot_set_handler(slot, &bench->connection->channel_handler) == AWS_OP_SUCCESS);
+    bench->connection->vtable->on_channel_handler_installed(&bench->connection->channel_handler, slot);
+
+    BENCHMARK_CHECK(aws_h2_frame_encoder_init(&bench->peer_encoder, bench->allocator, bench) == AWS_OP_SUCCESS);
+    BENCHMARK_CHECK(
+        aws_byte_buf_init(&bench->peer_output, bench->allocator, g_aws_channel_max_fragment_size) == AWS_OP_SUCCESS);
+    BENCHMARK_CHECK(aws_byte_buf_init(&bench->written, bench->allocator, 1024) == AWS_OP_SUCCESS);
+
+    /* Server's connection preface, then ACK the connection's SETTINGS */
+    struct aws_http2_setting peer_settings[] = {
+        {.id = AWS_HTTP2_SETTINGS_INITIAL_WINDOW_SIZE, .value = AWS_H2_WINDOW_UPDATE_MAX},
+        {.id = AWS_HTTP2_SETTINGS_MAX_FRAME_SIZE, .value = peer_max_frame_size},
+    };
+    s_peer_send_frame(
+        bench,
+        aws_h2_frame_new_settings(bench->allocator, peer_settings, AWS_ARRAY_SIZE(peer_settings), false /*ack*/));
+    s_peer_send_frame(bench, aws_h2_frame_new_settings(bench->allocator, NULL, 0, true /*ack*/));
+    s_peer_send_connection_window_update(bench, AWS_H2_WINDOW_UPDATE_MAX - AWS_H2_INIT_WINDOW_SIZE);
+
+    testing_channel_drain_queued_tasks(&bench->testing_channel);
+    s_drain_written(bench, NULL);
+}
+
+static void s_connection_bench_clean_up(struct connection_bench *bench) {
+    aws_http_connection_close(bench->connection);
+    testing_channel_drain_queued_tasks(&bench->testing_channel);
+    s_drain_written(bench, NULL);
+
+    aws_http_connection_release(bench->connection);
+    BENCHMARK_CHECK(testing_channel_clean_up(&bench->testing_channel) == AWS_OP_SUCCESS);
+    aws_h2_frame_encoder_clean_up(&bench->peer_encoder);
+    aws_byte_buf_clean_up(&bench->peer_output);
+    aws_byte_buf_clean_up(&bench->written);
+}
+
+static struct aws_http_message *s_new_post_request(struct aws_allocator *allocator) {
+    struct aws_http_header request_headers_src[] = {
+        {.name = aws_byte_cursor_from_c_str(":method"), .value = aws_byte_cursor_from_c_str("POST")},
+        {.name = aws_byte_cursor_from_c_str(":scheme"), .value = aws_byte_cursor_from_c_str("https")},
+        {.name = aws_byte_cursor_from_c_str(":path"), .value = aws_byte_cursor_from_c_str("/")},
+    };
+    struct aws_http_message *request = aws_http2_message_new_request(allocator);
+    BENCHMARK_CHECK(request != NULL);
+    BENCHMARK_CHECK(
+        aws_http_message_add_header_array(request, request_headers_src, AWS_ARRAY_SIZE(request_headers_src)) ==
+        AWS_OP_SUCCESS);
+    return request;
+}
+
+/*****************************************************************************************************************
+ * Sending DATA while many streams wait
+ *****************************************************************************************************************/
+
+/* Streams waiting behind the urgent one. Each has a 1 byte body */
+#define SEND_DATA_WAITING_STREAMS 2000
+/* aws_io_messages the urgent stream's body spans */
+#define SEND_DATA_URGENT_BODY_MESSAGES 64
+
+/**
+ * Sends a big urgent body while thousands of other streams wait their turn.
+ * Waiting streams stay in their priority buckets, so each aws_io_message should cost the same
+ * no matter how many streams are waiting.
+ */
+static void s_run_send_data_among_waiting_streams(struct benchmark_ctx *ctx) {
+    const char *name = "connection.h2.send_data.urgent_among_waiting=2000";
+    if (!benchmark_is_selected(ctx, name)) {
+        return;
+    }
+
+    struct connection_bench bench;
+    s_connection_bench_init(&bench, ctx, aws_h2_settings_initial[AWS_HTTP2_SETTINGS_MAX_FRAME_SIZE]);
+
+    enum { NUM_STREAMS = SEND_DATA_WAITING_STREAMS + 1 };
+    const size_t big_body_size = g_aws_channel_max_fragment_size * SEND_DATA_URGENT_BODY_MESSAGES;
+    const size_t data_bytes_per_run = big_body_size + SEND_DATA_WAITING_STREAMS;
+    struct aws_byte_buf big_body_buf;
+    BENCHMARK_CHECK(aws_byte_buf_init(&big_body_buf, bench.allocator, big_body_size) == AWS_OP_SUCCESS);
+    BENCHMARK_CHECK(aws_byte_buf_write_u8_n(&big_body_buf, (uint8_t)'a', big_body_size));
+    struct aws_http2_stream_priority most_urgent = {.urgency = 0, .incremental = false};
+
+    struct aws_http_message **requests = aws_mem_calloc(bench.allocator, NUM_STREAMS, sizeof(void *));
+    struct aws_input_stream **request_bodies = aws_mem_calloc(bench.allocator, NUM_STREAMS, sizeof(void *));
+    struct aws_http_stream **streams = aws_mem_calloc(bench.allocator, NUM_STREAMS, sizeof(void *));
+    BENCHMARK_CHECK(requests && request_bodies && streams);
+
+    uint64_t elapsed_ns = 0;
+    uint64_t message_count = 0;
+    uint64_t bytes = 0;
+    uint64_t allocations = 0;
+
+    /* The first run warms up and isn't counted */
+    for (size_t round = 0; round <= ctx->rounds; ++round) {
+        for (size_t i = 0; i < NUM_STREAMS; ++i) {
+            requests[i] = s_new_post_request(bench.allocator);
+            struct aws_byte_cursor body_cursor =
+                i == 0 ? aws_byte_cursor_from_buf(&big_body_buf) : aws_byte_cursor_from_c_str("z");
+            request_bodies[i] = aws_input_stream_new_from_cursor(bench.allocator, &body_cursor);
+            BENCHMARK_CHECK(request_bodies[i] != NULL);
+            aws_http_message_set_body_stream(requests[i], request_bodies[i]);
+        }
+
+        for (size_t i = 0; i < NUM_STREAMS; ++i) {
+            struct aws_http_make_request_options request_options = {
+                .self_size = sizeof(request_options),
+                .request = requests[i],
+                .http2_priority = i == 0 ? &most_urgent : NULL,
+            };
+            streams[i] = aws_http_connection_make_request(bench.connection, &request_options);
+            BENCHMARK_CHECK(streams[i] != NULL);
+            BENCHMARK_CHECK(aws_http_stream_activate(streams[i]) == AWS_OP_SUCCESS);
+        }
+
+        /* Activated streams are sent once the channel thread runs, so only that is timed */
+        uint64_t allocations_start = benchmark_get_allocation_count(ctx);
+        uint64_t start_ns = 0;
+        aws_high_res_clock_get_ticks(&start_ns);
+
+        testing_channel_drain_queued_tasks(&bench.testing_channel);
+
+        uint64_t end_ns = 0;
+        aws_high_res_clock_get_ticks(&end_ns);
+
+        size_t run_bytes = 0;
+        size_t run_messages = s_drain_written(&bench, &run_bytes);
+        /* Every body went out, along with the frames around it */
+        BENCHMARK_CHECK(run_bytes > data_bytes_per_run);
+        if (round > 0) {
+            elapsed_ns += end_ns - start_ns;
+            message_count += run_messages;
+            bytes += run_bytes;
+            allocations += benchmark_get_allocation_count(ctx) - allocations_start;
+        }
+
+        for (size_t i = 0; i < NUM_STREAMS; ++i) {
+            s_peer_send_response(&bench, streams[i]);
+        }
+        s_peer_send_connection_window_update(&bench, data_bytes_per_run);
+        testing_channel_drain_queued_tasks(&bench.testing_channel);
+        s_drain_written(&bench, NULL);
+
+        for (size_t i = 0; i < NUM_STREAMS; ++i) {
+            aws_http_stream_release(streams[i]);
+            aws_http_message_release(requests[i]);
+            aws_input_stream_release(request_bodies[i]);
+        }
+    }
+
+    const double runs = (double)ctx->rounds;
+    const double messages = message_count ? (double)message_count : 1.0;
+    struct benchmark_result *result = benchmark_add_result(ctx, name);
+    benchmark_result_add_metric(result, "us_per_message", (double)elapsed_ns / 1000.0 / messages);
+    benchmark_result_add_metric(result, "messages_per_run", (double)message_count / runs);
+    benchmark_result_add_metric(result, "mb_per_s", (double)bytes / (double)aws_max_u64(elapsed_ns, 1) * 1e9 / 1e6);
+    benchmark_result_add_metric(result, "allocations_per_message", (double)allocations / messages);
+
+    aws_mem_release(bench.allocator, streams);
+    aws_mem_release(bench.allocator, request_bodies);
+    aws_mem_release(bench.allocator, requests);
+    aws_byte_buf_clean_up(&big_body_buf);
+    s_connection_bench_clean_up(&bench);
+}
+
+/*****************************************************************************************************************
+ * Manual DATA writes
+ *****************************************************************************************************************/
+
+/* Bytes one stream sends per run, split into writes of the size being measured */
+#define WRITE_DATA_BYTES_PER_RUN (4 * 1024 * 1024)
+
+struct write_data_completions {
+    size_t count;
+    int first_error_code;
+};
+
+static void s_on_write_data_complete(struct aws_http_stream *stream, int error_code, void *user_data) {
+    (void)stream;
+    struct write_data_completions *completions = user_data;
+    if (error_code && !completions->first_error_code) {
+        completions->first_error_code = error_code;
+    }
+    completions->count++;
+}
+
+/**
+ * Sends one stream's body through aws_http2_stream_write_data(), in writes of write_size bytes.
+ * The copy variant passes each write as an aws_input_stream, which is read into the connection's aws_io_messages.
+ * The zero_copy variant passes each write as a data_buffer, which big enough payloads are sent from directly.
+ * Small zero-copy payloads should cost no more than copying them, since they're copied too.
+ */
+static void s_run_write_data(
+    struct benchmark_ctx *ctx,
+    size_t write_size,
+    uint32_t peer_max_frame_size,
+    bool zero_copy) {
+
+    char name[128];
+    snprintf(
+        name,
+        sizeof(name),
+        "connection.h2.write_data.size=%zu.frame=%lu.%s",
+        write_size,
+        (unsigned long)peer_max_frame_size,
+        zero_copy ? "zero_copy" : "copy");
+    if (!benchmark_is_selected(ctx, name)) {
+        return;
+    }
+
+    struct connection_bench bench;
+    s_connection_bench_init(&bench, ctx, peer_max_frame_size);
+
+    const size_t write_count = WRITE_DATA_BYTES_PER_RUN / write_size;
+    struct aws_byte_buf payload_buf;
+    BENCHMARK_CHECK(aws_byte_buf_init(&payload_buf, bench.allocator, write_size) == AWS_OP_SUCCESS);
+    BENCHMARK_CHECK(aws_byte_buf_write_u8_n(&payload_buf, (uint8_t)'a', write_size));
+    struct aws_input_stream **data_streams = aws_mem_calloc(bench.allocator, write_count, sizeof(void *));
+    BENCHMARK_CHECK(data_streams != NULL);
+
+    uint64_t elapsed_ns = 0;
+    uint64_t message_count = 0;
+    uint64_t bytes = 0;
+    uint64_t allocations = 0;
+
+    /* The first run warms up and isn't counted */
+    for (size_t round = 0; round <= ctx->rounds; ++round) {
+        if (!zero_copy) {
+            for (size_t i = 0; i < write_count; ++i) {
+                struct aws_byte_cursor payload = aws_byte_cursor_from_buf(&payload_buf);
+                data_streams[i] = aws_input_stream_new_from_cursor(bench.allocator, &payload);
+                BENCHMARK_CHECK(data_streams[i] != NULL);
+            }
+        }
+
+        struct aws_http_message *request = s_new_post_request(bench.allocator);
+        struct aws_http_make_request_options request_options = {
+            .self_size = sizeof(request_options),
+            .request = request,
+            .http2_use_manual_data_writes = true,
+        };
+        struct aws_http_stream *stream = aws_http_connection_make_request(bench.connection, &request_options);
+        BENCHMARK_CHECK(stream != NULL);
+        BENCHMARK_CHECK(aws_http_stream_activate(stream) == AWS_OP_SUCCESS);
+
+        /* HEADERS go out before the time measured */
+        testing_channel_drain_queued_tasks(&bench.testing_channel);
+        s_drain_written(&bench, NULL);
+
+        struct write_data_completions completions = {0};
+        uint64_t allocations_start = benchmark_get_allocation_count(ctx);
+        uint64_t start_ns = 0;
+        aws_high_res_clock_get_ticks(&start_ns);
+
+        for (size_t i = 0; i < write_count; ++i) {
+            struct aws_http2_stream_write_data_options write_options = {
+                .data = zero_copy ? NULL : data_streams[i],
+                .end_stream = i == write_count - 1,
+                .on_complete = s_on_write_data_complete,
+                .user_data = &completions,
+            };
+            if (zero_copy) {
+                write_options.data_buffer = aws_byte_cursor_from_buf(&payload_buf);
+            }
+            BENCHMARK_CHECK(aws_http2_stream_write_data(stream, &write_options) == AWS_OP_SUCCESS);
+        }
+        testing_channel_drain_queued_tasks(&bench.testing_channel);
+
+        uint64_t end_ns = 0;
+        aws_high_res_clock_get_ticks(&end_ns);
+
+        size_t run_bytes = 0;
+        size_t run_messages = s_drain_written(&bench, &run_bytes);
+        /* Every write went out, along with the frames around it, and the channel is done with all of them */
+        BENCHMARK_CHECK(run_bytes > write_count * write_size);
+        BENCHMARK_CHECK(completions.count == write_count && completions.first_error_code == 0);
+        if (round > 0) {
+            elapsed_ns += end_ns - start_ns;
+            message_count += run_messages;
+            bytes += run_bytes;
+            allocations += benchmark_get_allocation_count(ctx) - allocations_start;
+        }
+
+        s_peer_send_response(&bench, stream);
+        s_peer_send_connection_window_update(&bench, write_count * write_size);
+        testing_channel_drain_queued_tasks(&bench.testing_channel);
+        s_drain_written(&bench, NULL);
+
+        aws_http_stream_release(stream);
+        aws_http_message_release(request);
+        if (!zero_copy) {
+            for (size_t i = 0; i < write_count; ++i) {
+                aws_input_stream_release(data_streams[i]);
+            }
+        }
+    }
+
+    const double writes = (double)ctx->rounds * (double)write_count;
+    struct benchmark_result *result = benchmark_add_result(ctx, name);
+    benchmark_result_add_metric(result, "ns_per_write", (double)elapsed_ns / writes);
+    benchmark_result_add_metric(result, "messages_per_write", (double)message_count / writes);
+    benchmark_result_add_metric(result, "mb_per_s", (double)bytes / (double)aws_max_u64(elapsed_ns, 1) * 1e9 / 1e6);
+    benchmark_result_add_metric(result, "allocations_per_write", (double)allocations / writes);
+
+    aws_mem_release(bench.allocator, data_streams);
+    aws_byte_buf_clean_up(&payload_buf);
+    s_connection_bench_clean_up(&bench);
+}
+
+static void s_run_write_data_sweep(struct benchmark_ctx *ctx) {
+    /* Below, around and far above AWS_H2_ZERO_COPY_PAYLOAD_MIN_SIZE */
+    const size_t write_sizes[] = {1024, 4096, 16 * 1024, 256 * 1024, 1024 * 1024};
+    /* The default MAX_FRAME_SIZE, and one that lets a whole write go in a single frame */
+    const uint32_t peer_max_frame_sizes[] = {16 * 1024, 1024 * 1024};
+
+    for (size_t f = 0; f < AWS_ARRAY_SIZE(peer_max_frame_sizes); ++f) {
+        for (size_t w = 0; w < AWS_ARRAY_SIZE(write_sizes); ++w) {
+            s_run_write_data(ctx, write_sizes[w], peer_max_frame_sizes[f], false /*zero_copy*/);
+            s_run_write_data(ctx, write_sizes[w], peer_max_frame_sizes[f], true /*zero_copy*/);
+        }
+    }
+}
+
+/*****************************************************************************************************************
+ * Running
+ *****************************************************************************************************************/
+
+void benchmark_run_connection(struct benchmark_ctx *ctx) {
+    s_run_send_data_among_waiting_streams(ctx);
+    s_run_write_data_sweep(ctx);
+}
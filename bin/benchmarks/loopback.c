@@ -0,0 +1,493 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+#include "benchmarks.h"
+
+#include <aws/http/connection.h>
+#include <aws/http/connection_manager.h>
+#include <aws/http/private/manager_histogram.h>
+#include <aws/http/request_response.h>
+#include <aws/http/server.h>
+
+#include <aws/common/clock.h>
+#include <aws/common/condition_variable.h>
+#include <aws/common/mutex.h>
+#include <aws/common/thread.h>
+#include <aws/io/channel_bootstrap.h>
+#include <aws/io/event_loop.h>
+#include <aws/io/host_resolver.h>
+#include <aws/io/socket.h>
+#include <aws/io/stream.h>
+
+#include <string.h>
+
+/**
+ * End-to-end benchmark: an aws_http_server and a connection manager client, sharing one event-loop group,
+ * send requests to each other over TCP on 127.0.0.1.
+ *
+ * Each configuration keeps `concurrency` GET requests in flight for its duration, each on its own HTTP/1.1
+ * connection, and the server answers each with a body of `size` bytes. Requests started in the first fifth of the
+ * duration warm up connections and caches, and aren't counted. Latency is from acquiring a connection to the
+ * response completing.
+ *
+ * Only HTTP/1.1 is covered: aws_http_server can't serve HTTP/2 yet (HTTP/2 connections don't accept
+ * request-handler streams).
+ */
+
+#define LOOPBACK_HOST "127.0.0.1"
+#define LOOPBACK_TIMEOUT_SEC 10
+
+struct loopback_config {
+    size_t loop_count;
+    size_t payload_size;
+    size_t concurrency;
+    uint32_t port;
+};
+
+struct loopback_run;
+
+/* One of the `concurrency` requests in flight. Starts another when it completes, until the run ends */
+struct loopback_slot {
+    struct loopback_run *run;
+    struct aws_http_connection *connection;
+    uint64_t start_ns;
+    size_t body_bytes;
+};
+
+struct loopback_run {
+    struct aws_allocator *allocator;
+    struct loopback_config config;
+
+    struct aws_event_loop_group *event_loop_group;
+    struct aws_host_resolver *host_resolver;
+    struct aws_server_bootstrap *server_bootstrap;
+    struct aws_client_bootstrap *client_bootstrap;
+    struct aws_socket_options socket_options;
+    struct aws_socket_endpoint endpoint;
+    struct aws_http_server *server;
+    struct aws_http_connection_manager *manager;
+
+    /* Served by the server, shared by all responses */
+    struct aws_byte_buf payload;
+    struct aws_http_message *request;
+
+    struct loopback_slot *slots;
+
+    uint64_t measure_start_ns;
+    uint64_t end_ns;
+
+    /* Updated from the event-loop threads */
+    struct aws_atomic_var active_slots;
+    struct aws_atomic_var requests_measured;
+    struct aws_atomic_var bytes_measured;
+    struct aws_atomic_var errors;
+    struct aws_http_atomic_histogram latency_histogram;
+
+    struct aws_mutex lock;
+    struct aws_condition_variable signal;
+    bool is_done;
+    bool is_server_destroyed;
+    bool is_manager_shut_down;
+};
+
+/* Parses a comma-separated list of numbers, like "1,2,4" */
+static void s_parse_list(const char *list, struct aws_array_list *out_values, struct aws_allocator *allocator) {
+    BENCHMARK_CHECK(aws_array_list_init_dynamic(out_values, allocator, 4, sizeof(size_t)) == AWS_OP_SUCCESS);
+
+    const char *next = list;
+    while (*next) {
+        char *end = NULL;
+        unsigned long long value = strtoull(next, &end, 10);
+        if (end == next || value == 0 || value > SIZE_MAX || (*end != ',' && *end != '\0')) {
+            fprintf(stderr, "invalid list \"%s\", expected numbers separated by commas.\n", list);
+            exit(1);
+        }
+        size_t size_value = (size_t)value;
+        BENCHMARK_CHECK(aws_array_list_push_back(out_values, &size_value) == AWS_OP_SUCCESS);
+        next = *end == ',' ? end + 1 : end;
+    }
+}
+
+static uint64_t s_now_ns(void) {
+    uint64_t now_ns = 0;
+    aws_high_res_clock_get_ticks(&now_ns);
+    return now_ns;
+}
+
+static void s_signal(struct loopback_run *run, bool *flag) {
+    aws_mutex_lock(&run->lock);
+    *flag = true;
+    aws_mutex_unlock(&run->lock);
+    aws_condition_variable_notify_all(&run->signal);
+}
+
+static bool s_is_flag_set(void *user_data) {
+    return *(bool *)user_data;
+}
+
+static void s_wait(struct loopback_run *run, bool *flag) {
+    aws_mutex_lock(&run->lock);
+    aws_condition_variable_wait_pred(&run->signal, &run->lock, s_is_flag_set, flag);
+    aws_mutex_unlock(&run->lock);
+}
+
+/*****************************************************************************************************************
+ * Server
+ *****************************************************************************************************************/
+
+static int s_server_on_request_done(struct aws_http_stream *stream, void *user_data) {
+    struct loopback_run *run = user_data;
+
+    char content_length[32];
+    snprintf(content_length, sizeof(content_length), "%zu", run->payload.len);
+    struct aws_http_header content_length_header = {
+        .name = aws_byte_cursor_from_c_str("Content-Length"),
+        .value = aws_byte_cursor_from_c_str(content_length),
+    };
+
+    struct aws_byte_cursor body = aws_byte_cursor_from_buf(&run->payload);
+    struct aws_input_stream *body_stream = aws_input_stream_new_from_cursor(run->allocator, &body);
+    struct aws_http_message *response = aws_http_message_new_response(run->allocator);
+    BENCHMARK_CHECK(body_stream != NULL && response != NULL);
+    BENCHMARK_CHECK(aws_http_message_set_response_status(response, 200) == AWS_OP_SUCCESS);
+    BENCHMARK_CHECK(aws_http_message_add_header(response, content_length_header) == AWS_OP_SUCCESS);
+    aws_http_message_set_body_stream(response, body_stream);
+
+    /* The head is encoded right away, and the stream holds on to the body */
+    int result = aws_http_stream_send_response(stream, response);
+
+    aws_http_message_release(response);
+    aws_input_stream_release(body_stream);
+    return result;
+}
+
+static void s_server_on_stream_complete(struct aws_http_stream *stream, int error_code, void *user_data) {
+    (void)error_code;
+    (void)user_data;
+    aws_http_stream_release(stream);
+}
+
+static struct aws_http_stream *s_server_on_incoming_request(struct aws_http_connection *connection, void *user_data) {
+    struct loopback_run *run = user_data;
+
+    struct aws_http_request_handler_options options = AWS_HTTP_REQUEST_HANDLER_OPTIONS_INIT;
+    options.server_connection = connection;
+    options.user_data = run;
+    options.on_request_done = s_server_on_request_done;
+    options.on_complete = s_server_on_stream_complete;
+    return aws_http_stream_new_server_request_handler(&options);
+}
+
+static void s_server_on_connection_shutdown(struct aws_http_connection *connection, int error_code, void *user_data) {
+    (void)error_code;
+    (void)user_data;
+    aws_http_connection_release(connection);
+}
+
+static void s_server_on_incoming_connection(
+    struct aws_http_server *server,
+    struct aws_http_connection *connection,
+    int error_code,
+    void *user_data) {
+
+    (void)server;
+    struct loopback_run *run = user_data;
+    if (error_code) {
+        aws_atomic_fetch_add(&run->errors, 1);
+        return;
+    }
+
+    struct aws_http_server_connection_options options = AWS_HTTP_SERVER_CONNECTION_OPTIONS_INIT;
+    options.connection_user_data = run;
+    options.on_incoming_request = s_server_on_incoming_request;
+    options.on_shutdown = s_server_on_connection_shutdown;
+    if (aws_http_connection_configure_server(connection, &options)) {
+        aws_atomic_fetch_add(&run->errors, 1);
+        aws_http_connection_release(connection);
+    }
+}
+
+static void s_server_on_destroy_complete(void *user_data) {
+    struct loopback_run *run = user_data;
+    s_signal(run, &run->is_server_destroyed);
+}
+
+/*****************************************************************************************************************
+ * Client
+ *****************************************************************************************************************/
+
+static void s_slot_start(struct loopback_slot *slot);
+
+static void s_slot_finish(struct loopback_slot *slot) {
+    struct loopback_run *run = slot->run;
+    if (aws_atomic_fetch_sub(&run->active_slots, 1) == 1) {
+        s_signal(run, &run->is_done);
+    }
+}
+
+static int s_client_on_response_body(
+    struct aws_http_stream *stream,
+    const struct aws_byte_cursor *data,
+    void *user_data) {
+
+    (void)stream;
+    struct loopback_slot *slot = user_data;
+    slot->body_bytes += data->len;
+    return AWS_OP_SUCCESS;
+}
+
+static void s_client_on_stream_complete(struct aws_http_stream *stream, int error_code, void *user_data) {
+    struct loopback_slot *slot = user_data;
+    struct loopback_run *run = slot->run;
+
+    int status = 0;
+    aws_http_stream_get_incoming_response_status(stream, &status);
+    if (error_code || status != 200 || slot->body_bytes != run->payload.len) {
+        aws_atomic_fetch_add(&run->errors, 1);
+    } else if (slot->start_ns >= run->measure_start_ns) {
+        aws_http_atomic_histogram_record(&run->latency_histogram, slot->start_ns, s_now_ns());
+        aws_atomic_fetch_add(&run->requests_measured, 1);
+        aws_atomic_fetch_add(&run->bytes_measured, slot->body_bytes);
+    }
+
+    aws_http_stream_release(stream);
+    aws_http_connection_manager_release_connection(run->manager, slot->connection);
+    slot->connection = NULL;
+
+    if (error_code) {
+        s_slot_finish(slot);
+    } else {
+        s_slot_start(slot);
+    }
+}
+
+static void s_client_on_connection_acquired(struct aws_http_connection *connection, int error_code, void *user_data) {
+    struct loopback_slot *slot = user_data;
+    struct loopback_run *run = slot->run;
+
+    if (error_code) {
+        aws_atomic_fetch_add(&run->errors, 1);
+        s_slot_finish(slot);
+        return;
+    }
+
+    slot->connection = connection;
+    slot->body_bytes = 0;
+
+    struct aws_http_make_request_options options = {
+        .self_size = sizeof(options),
+        .request = run->request,
+        .user_data = slot,
+        .on_response_body = s_client_on_response_body,
+        .on_complete = s_client_on_stream_complete,
+    };
+    struct aws_http_stream *stream = aws_http_connection_make_request(connection, &options);
+    if (!stream || aws_http_stream_activate(stream)) {
+        aws_atomic_fetch_add(&run->errors, 1);
+        aws_http_stream_release(stream);
+        aws_http_connection_manager_release_connection(run->manager, connection);
+        slot->connection = NULL;
+        s_slot_finish(slot);
+    }
+}
+
+static void s_slot_start(struct loopback_slot *slot) {
+    struct loopback_run *run = slot->run;
+    slot->start_ns = s_now_ns();
+    if (slot->start_ns >= run->end_ns) {
+        s_slot_finish(slot);
+        return;
+    }
+    aws_http_connection_manager_acquire_connection(run->manager, s_client_on_connection_acquired, slot);
+}
+
+static void s_manager_on_shutdown_complete(void *user_data) {
+    struct loopback_run *run = user_data;
+    s_signal(run, &run->is_manager_shut_down);
+}
+
+/*****************************************************************************************************************
+ * Running
+ *****************************************************************************************************************/
+
+static void s_run_init(struct loopback_run *run, struct benchmark_ctx *ctx, const struct loopback_config *config) {
+    AWS_ZERO_STRUCT(*run);
+    run->allocator = &ctx->allocator;
+    run->config = *config;
+    aws_atomic_init_int(&run->active_slots, 0);
+    aws_atomic_init_int(&run->requests_measured, 0);
+    aws_atomic_init_int(&run->bytes_measured, 0);
+    aws_atomic_init_int(&run->errors, 0);
+    aws_http_atomic_histogram_init(&run->latency_histogram);
+    BENCHMARK_CHECK(aws_mutex_init(&run->lock) == AWS_OP_SUCCESS);
+    BENCHMARK_CHECK(aws_condition_variable_init(&run->signal) == AWS_OP_SUCCESS);
+
+    BENCHMARK_CHECK(aws_byte_buf_init(&run->payload, ctx->parent_allocator, config->payload_size) == AWS_OP_SUCCESS);
+    for (size_t i = 0; i < config->payload_size; ++i) {
+        run->payload.buffer[i] = (uint8_t)('a' + i % 26);
+    }
+    run->payload.len = config->payload_size;
+
+    run->event_loop_group = aws_event_loop_group_new_default(run->allocator, (uint16_t)config->loop_count, NULL);
+    BENCHMARK_CHECK(run->event_loop_group != NULL);
+    struct aws_host_resolver_default_options resolver_options = {
+        .el_group = run->event_loop_group,
+        .max_entries = 8,
+    };
+    run->host_resolver = aws_host_resolver_new_default(run->allocator, &resolver_options);
+    BENCHMARK_CHECK(run->host_resolver != NULL);
+    run->server_bootstrap = aws_server_bootstrap_new(run->allocator, run->event_loop_group);
+    BENCHMARK_CHECK(run->server_bootstrap != NULL);
+    struct aws_client_bootstrap_options bootstrap_options = {
+        .event_loop_group = run->event_loop_group,
+        .host_resolver = run->host_resolver,
+    };
+    run->client_bootstrap = aws_client_bootstrap_new(run->allocator, &bootstrap_options);
+    BENCHMARK_CHECK(run->client_bootstrap != NULL);
+
+    run->socket_options.type = AWS_SOCKET_STREAM;
+    run->socket_options.domain = AWS_SOCKET_IPV4;
+    run->socket_options.connect_timeout_ms =
+        (uint32_t)aws_timestamp_convert(LOOPBACK_TIMEOUT_SEC, AWS_TIMESTAMP_SECS, AWS_TIMESTAMP_MILLIS, NULL);
+    snprintf(run->endpoint.address, sizeof(run->endpoint.address), "%s", LOOPBACK_HOST);
+    run->endpoint.port = config->port;
+
+    struct aws_http_server_options server_options = AWS_HTTP_SERVER_OPTIONS_INIT;
+    server_options.allocator = run->allocator;
+    server_options.bootstrap = run->server_bootstrap;
+    server_options.endpoint = &run->endpoint;
+    server_options.socket_options = &run->socket_options;
+    server_options.server_user_data = run;
+    server_options.on_incoming_connection = s_server_on_incoming_connection;
+    server_options.on_destroy_complete = s_server_on_destroy_complete;
+    run->server = aws_http_server_new(&server_options);
+    BENCHMARK_CHECK(run->server != NULL);
+
+    struct aws_http_connection_manager_options manager_options = {
+        .bootstrap = run->client_bootstrap,
+        .initial_window_size = SIZE_MAX,
+        .socket_options = &run->socket_options,
+        .host = aws_byte_cursor_from_c_str(LOOPBACK_HOST),
+        .port = config->port,
+        .max_connections = config->concurrency,
+        .shutdown_complete_user_data = run,
+        .shutdown_complete_callback = s_manager_on_shutdown_complete,
+    };
+    run->manager = aws_http_connection_manager_new(run->allocator, &manager_options);
+    BENCHMARK_CHECK(run->manager != NULL);
+
+    run->request = aws_http_message_new_request(run->allocator);
+    BENCHMARK_CHECK(run->request != NULL);
+    BENCHMARK_CHECK(aws_http_message_set_request_method(run->request, aws_http_method_get) == AWS_OP_SUCCESS);
+    BENCHMARK_CHECK(
+        aws_http_message_set_request_path(run->request, aws_byte_cursor_from_c_str("/benchmark")) == AWS_OP_SUCCESS);
+    struct aws_http_header host_header = {
+        .name = aws_byte_cursor_from_c_str("Host"),
+        .value = aws_byte_cursor_from_c_str(LOOPBACK_HOST),
+    };
+    BENCHMARK_CHECK(aws_http_message_add_header(run->request, host_header) == AWS_OP_SUCCESS);
+
+    run->slots = aws_mem_calloc(ctx->parent_allocator, config->concurrency, sizeof(struct loopback_slot));
+    for (size_t i = 0; i < config->concurrency; ++i) {
+        run->slots[i].run = run;
+    }
+}
+
+static void s_run_clean_up(struct loopback_run *run, struct benchmark_ctx *ctx) {
+    aws_http_connection_manager_release(run->manager);
+    s_wait(run, &run->is_manager_shut_down);
+    aws_http_server_release(run->server);
+    s_wait(run, &run->is_server_destroyed);
+
+    aws_http_message_release(run->request);
+    aws_client_bootstrap_release(run->client_bootstrap);
+    aws_server_bootstrap_release(run->server_bootstrap);
+    aws_host_resolver_release(run->host_resolver);
+    aws_event_loop_group_release(run->event_loop_group);
+    /* Let the event-loop threads go before the next configuration starts its own */
+    aws_thread_join_all_managed();
+
+    aws_mem_release(ctx->parent_allocator, run->slots);
+    aws_byte_buf_clean_up(&run->payload);
+    aws_condition_variable_clean_up(&run->signal);
+    aws_mutex_clean_up(&run->lock);
+}
+
+static void s_run_loopback_config(struct benchmark_ctx *ctx, const struct loopback_config *config) {
+    char name[96];
+    snprintf(
+        name,
+        sizeof(name),
+        "loopback.h1.loops=%zu.size=%zu.concurrency=%zu",
+        config->loop_count,
+        config->payload_size,
+        config->concurrency);
+    if (!benchmark_is_selected(ctx, name)) {
+        return;
+    }
+
+    struct loopback_run run;
+    s_run_init(&run, ctx, config);
+
+    /* Connect ahead of time, so the warm-up isn't spent waiting on connection setup */
+    aws_http_connection_manager_prewarm(run.manager, config->concurrency);
+
+    const uint64_t duration_ns =
+        aws_timestamp_convert(ctx->duration_ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+    const uint64_t start_ns = s_now_ns();
+    run.measure_start_ns = start_ns + duration_ns / 5;
+    run.end_ns = start_ns + duration_ns;
+
+    aws_atomic_store_int(&run.active_slots, config->concurrency);
+    for (size_t i = 0; i < config->concurrency; ++i) {
+        s_slot_start(&run.slots[i]);
+    }
+    s_wait(&run, &run.is_done);
+
+    /* Requests measured are those started in the measured window, and they may finish after it */
+    const uint64_t finished_ns = s_now_ns();
+    const double measured_sec = (double)(finished_ns - run.measure_start_ns) / 1e9;
+    const double requests = (double)aws_atomic_load_int(&run.requests_measured);
+    const double bytes = (double)aws_atomic_load_int(&run.bytes_measured);
+
+    struct aws_http_manager_histogram latency;
+    aws_http_atomic_histogram_snapshot(&run.latency_histogram, &latency);
+
+    struct benchmark_result *result = benchmark_add_result(ctx, name);
+    benchmark_result_add_metric(result, "requests_per_s", requests / measured_sec);
+    benchmark_result_add_metric(result, "gbit_per_s", bytes * 8 / measured_sec / 1e9);
+    benchmark_result_add_metric(result, "p50_us", (double)aws_http_manager_histogram_get_percentile(&latency, 50.0));
+    benchmark_result_add_metric(result, "p99_us", (double)aws_http_manager_histogram_get_percentile(&latency, 99.0));
+    benchmark_result_add_metric(result, "p999_us", (double)aws_http_manager_histogram_get_percentile(&latency, 99.9));
+    benchmark_result_add_metric(result, "errors", (double)aws_atomic_load_int(&run.errors));
+
+    s_run_clean_up(&run, ctx);
+}
+
+void benchmark_run_loopback(struct benchmark_ctx *ctx) {
+    struct aws_array_list loop_counts;
+    struct aws_array_list payload_sizes;
+    struct aws_array_list concurrencies;
+    s_parse_list(ctx->loop_counts, &loop_counts, ctx->parent_allocator);
+    s_parse_list(ctx->loopback_payload_sizes, &payload_sizes, ctx->parent_allocator);
+    s_parse_list(ctx->concurrencies, &concurrencies, ctx->parent_allocator);
+
+    /* Each configuration listens on a port of its own, so one just closed can't get in the way */
+    uint32_t port = ctx->port;
+    for (size_t l = 0; l < aws_array_list_length(&loop_counts); ++l) {
+        for (size_t s = 0; s < aws_array_list_length(&payload_sizes); ++s) {
+            for (size_t c = 0; c < aws_array_list_length(&concurrencies); ++c) {
+                struct loopback_config config = {.port = port++};
+                aws_array_list_get_at(&loop_counts, &config.loop_count, l);
+                aws_array_list_get_at(&payload_sizes, &config.payload_size, s);
+                aws_array_list_get_at(&concurrencies, &config.concurrency, c);
+                s_run_loopback_config(ctx, &config);
+            }
+        }
+    }
+
+    aws_array_list_clean_up(&loop_counts);
+    aws_array_list_clean_up(&payload_sizes);
+    aws_array_list_clean_up(&concurrencies);
+}
@@ -0,0 +1,306 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+#include "benchmarks.h"
+
+#include <aws/http/http.h>
+
+#include <aws/common/command_line_parser.h>
+
+#include <string.h>
+
+#ifdef _MSC_VER
+#    pragma warning(disable : 4996) /* Disable warnings about fopen() being insecure */
+#endif
+
+struct benchmarks_app {
+    struct benchmark_ctx ctx;
+    bool run_codecs;
+    bool run_micro;
+    bool run_connection;
+    bool run_loopback;
+    const char *json_path;
+};
+
+static void s_usage(int exit_code) {
+
+    fprintf(stderr, "usage: aws-c-http-benchmarks [options] [codec] [micro] [connection] [loopback]\n");
+    fprintf(stderr, " codec: encode and decode HTTP/1.1, HTTP/2, HPACK and WebSocket messages in memory.\n");
+    fprintf(stderr, " micro: single hot functions, next to the simpler code they replaced.\n");
+    fprintf(stderr, " connection: an HTTP/2 client connection sending DATA on a testing channel.\n");
+    fprintf(stderr, "            codec, micro and connection run if nothing is specified.\n");
+    fprintf(stderr, " loopback: HTTP/1.1 requests between a server and a connection manager over 127.0.0.1,\n");
+    fprintf(stderr, "           for each combination of --loops, --sizes and --concurrency.\n");
+    fprintf(stderr, "\n Options:\n\n");
+    fprintf(stderr, "  -c, --concurrency LIST: requests in flight at once, for loopback (default 1,16,64).\n");
+    fprintf(stderr, "  -d, --duration MS: milliseconds each loopback configuration runs for (default 2000).\n");
+    fprintf(stderr, "  -f, --filter NAME: only run benchmarks whose name contains NAME.\n");
+    fprintf(stderr, "  -j, --json FILE: also write the results to FILE as JSON. \"-\" writes only JSON to stdout.\n");
+    fprintf(stderr, "  -l, --loops LIST: event-loop threads, for loopback (default 1,2,4).\n");
+    fprintf(stderr, "  -m, --messages INT: messages in each corpus (default 1000).\n");
+    fprintf(stderr, "  -p, --payload-size INT: bytes of body in each message (default 1024).\n");
+    fprintf(stderr, "  -P, --port INT: first port loopback listens on (default 58000).\n");
+    fprintf(stderr, "  -r, --rounds INT: times each corpus or benchmark is replayed while timing (default 10).\n");
+    fprintf(stderr, "  -s, --sizes LIST: response body sizes, for loopback (default 1024,65536).\n");
+    fprintf(stderr, "  -h, --help\n");
+    fprintf(stderr, "            Display this message and quit.\n");
+    exit(exit_code);
+}
+
+static struct aws_cli_option s_long_options[] = {
+    {"concurrency", AWS_CLI_OPTIONS_REQUIRED_ARGUMENT, NULL, 'c'},
+    {"duration", AWS_CLI_OPTIONS_REQUIRED_ARGUMENT, NULL, 'd'},
+    {"filter", AWS_CLI_OPTIONS_REQUIRED_ARGUMENT, NULL, 'f'},
+    {"json", AWS_CLI_OPTIONS_REQUIRED_ARGUMENT, NULL, 'j'},
+    {"loops", AWS_CLI_OPTIONS_REQUIRED_ARGUMENT, NULL, 'l'},
+    {"messages", AWS_CLI_OPTIONS_REQUIRED_ARGUMENT, NULL, 'm'},
+    {"payload-size", AWS_CLI_OPTIONS_REQUIRED_ARGUMENT, NULL, 'p'},
+    {"port", AWS_CLI_OPTIONS_REQUIRED_ARGUMENT, NULL, 'P'},
+    {"rounds", AWS_CLI_OPTIONS_REQUIRED_ARGUMENT, NULL, 'r'},
+    {"sizes", AWS_CLI_OPTIONS_REQUIRED_ARGUMENT, NULL, 's'},
+    {"help", AWS_CLI_OPTIONS_NO_ARGUMENT, NULL, 'h'},
+    /* Per getopt(3) the last element of the array has to be filled with all zeros */
+    {NULL, AWS_CLI_OPTIONS_NO_ARGUMENT, NULL, 0},
+};
+
+static size_t s_parse_size(const char *arg, size_t min_value) {
+    char *end = NULL;
+    unsigned long long value = strtoull(arg, &end, 10);
+    if (end == arg || *end != '\0' || value < min_value || value > SIZE_MAX) {
+        fprintf(stderr, "invalid number \"%s\".\n", arg);
+        s_usage(1);
+    }
+    return (size_t)value;
+}
+
+static void s_parse_options(int argc, char **argv, struct benchmarks_app *app) {
+    while (true) {
+        int option_index = 0;
+        int c = aws_cli_getopt_long(argc, argv, "c:d:f:j:l:m:p:P:r:s:h", s_long_options, &option_index);
+        if (c == -1) {
+            break;
+        }
+
+        switch (c) {
+            case 0:
+                /* getopt_long() returns 0 if an option.flag is non-null */
+                break;
+            case 'c':
+                app->ctx.concurrencies = aws_cli_optarg;
+                break;
+            case 'd':
+                app->ctx.duration_ms = s_parse_size(aws_cli_optarg, 1);
+                break;
+            case 'f':
+                app->ctx.filter = aws_cli_optarg;
+                break;
+            case 'j':
+                app->json_path = aws_cli_optarg;
+                break;
+            case 'l':
+                app->ctx.loop_counts = aws_cli_optarg;
+                break;
+            case 'm':
+                app->ctx.message_count = s_parse_size(aws_cli_optarg, 1);
+                break;
+            case 'p':
+                app->ctx.payload_size = s_parse_size(aws_cli_optarg, 0);
+                break;
+            case 'P':
+                app->ctx.port = (uint32_t)s_parse_size(aws_cli_optarg, 1);
+                break;
+            case 'r':
+                app->ctx.rounds = s_parse_size(aws_cli_optarg, 1);
+                break;
+            case 's':
+                app->ctx.loopback_payload_sizes = aws_cli_optarg;
+                break;
+            case 'h':
+                s_usage(0);
+                break;
+            default:
+                fprintf(stderr, "Unknown option\n");
+                s_usage(1);
+        }
+    }
+
+    if (aws_cli_optind == argc) {
+        app->run_codecs = true;
+        app->run_micro = true;
+        app->run_connection = true;
+    }
+    for (int i = aws_cli_optind; i < argc; ++i) {
+        if (strcmp(argv[i], "codec") == 0) {
+            app->run_codecs = true;
+        } else if (strcmp(argv[i], "micro") == 0) {
+            app->run_micro = true;
+        } else if (strcmp(argv[i], "connection") == 0) {
+            app->run_connection = true;
+        } else if (strcmp(argv[i], "loopback") == 0) {
+            app->run_loopback = true;
+        } else {
+            fprintf(stderr, "Unknown benchmark suite \"%s\"\n", argv[i]);
+            s_usage(1);
+        }
+    }
+}
+
+/* Allocator that counts calls before passing them on to its parent */
+
+static void *s_counting_mem_acquire(struct aws_allocator *allocator, size_t size) {
+    struct benchmark_ctx *ctx = allocator->impl;
+    aws_atomic_fetch_add_explicit(&ctx->allocation_count, 1, aws_memory_order_relaxed);
+    return aws_mem_acquire(ctx->parent_allocator, size);
+}
+
+static void *s_counting_mem_calloc(struct aws_allocator *allocator, size_t num, size_t size) {
+    struct benchmark_ctx *ctx = allocator->impl;
+    aws_atomic_fetch_add_explicit(&ctx->allocation_count, 1, aws_memory_order_relaxed);
+    return aws_mem_calloc(ctx->parent_allocator, num, size);
+}
+
+static void *s_counting_mem_realloc(struct aws_allocator *allocator, void *ptr, size_t oldsize, size_t newsize) {
+    struct benchmark_ctx *ctx = allocator->impl;
+    aws_atomic_fetch_add_explicit(&ctx->allocation_count, 1, aws_memory_order_relaxed);
+    if (aws_mem_realloc(ctx->parent_allocator, &ptr, oldsize, newsize)) {
+        return NULL;
+    }
+    return ptr;
+}
+
+static void s_counting_mem_release(struct aws_allocator *allocator, void *ptr) {
+    struct benchmark_ctx *ctx = allocator->impl;
+    aws_mem_release(ctx->parent_allocator, ptr);
+}
+
+uint64_t benchmark_get_allocation_count(struct benchmark_ctx *ctx) {
+    return aws_atomic_load_int_explicit(&ctx->allocation_count, aws_memory_order_relaxed);
+}
+
+bool benchmark_is_selected(const struct benchmark_ctx *ctx, const char *name) {
+    return ctx->filter == NULL || strstr(name, ctx->filter) != NULL;
+}
+
+struct benchmark_result *benchmark_add_result(struct benchmark_ctx *ctx, const char *name) {
+    struct benchmark_result result;
+    AWS_ZERO_STRUCT(result);
+    snprintf(result.name, sizeof(result.name), "%s", name);
+    BENCHMARK_CHECK(aws_array_list_push_back(&ctx->results, &result) == AWS_OP_SUCCESS);
+
+    struct benchmark_result *added = NULL;
+    aws_array_list_get_at_ptr(&ctx->results, (void **)&added, aws_array_list_length(&ctx->results) - 1);
+    return added;
+}
+
+void benchmark_result_add_metric(struct benchmark_result *result, const char *name, double value) {
+    BENCHMARK_CHECK(result->metric_count < BENCHMARK_MAX_METRICS);
+    result->metrics[result->metric_count].name = name;
+    result->metrics[result->metric_count].value = value;
+    result->metric_count++;
+}
+
+static void s_print_results(const struct benchmark_ctx *ctx) {
+    const size_t count = aws_array_list_length(&ctx->results);
+    for (size_t i = 0; i < count; ++i) {
+        struct benchmark_result *result = NULL;
+        aws_array_list_get_at_ptr(&ctx->results, (void **)&result, i);
+
+        printf("%-40s", result->name);
+        for (size_t m = 0; m < result->metric_count; ++m) {
+            printf(" %s=%.2f", result->metrics[m].name, result->metrics[m].value);
+        }
+        printf("\n");
+    }
+}
+
+/* Metric values are plain numbers, and result names are chosen by the benchmarks, so nothing needs escaping */
+static void s_write_json(const struct benchmark_ctx *ctx, FILE *output) {
+    fprintf(output, "{\n");
+    fprintf(output, "  \"library\": \"aws-c-http\",\n");
+    fprintf(output, "  \"messages\": %zu,\n", ctx->message_count);
+    fprintf(output, "  \"payload_size\": %zu,\n", ctx->payload_size);
+    fprintf(output, "  \"rounds\": %zu,\n", ctx->rounds);
+    fprintf(output, "  \"results\": [");
+
+    const size_t count = aws_array_list_length(&ctx->results);
+    for (size_t i = 0; i < count; ++i) {
+        struct benchmark_result *result = NULL;
+        aws_array_list_get_at_ptr(&ctx->results, (void **)&result, i);
+
+        fprintf(output, "%s\n    {\"name\": \"%s\"", i ? "," : "", result->name);
+        for (size_t m = 0; m < result->metric_count; ++m) {
+            fprintf(output, ", \"%s\": %.3f", result->metrics[m].name, result->metrics[m].value);
+        }
+        fprintf(output, "}");
+    }
+    fprintf(output, "\n  ]\n}\n");
+}
+
+int main(int argc, char **argv) {
+    struct aws_allocator *parent_allocator = aws_default_allocator();
+
+    struct benchmarks_app app;
+    AWS_ZERO_STRUCT(app);
+    app.ctx.parent_allocator = parent_allocator;
+    app.ctx.allocator.mem_acquire = s_counting_mem_acquire;
+    app.ctx.allocator.mem_release = s_counting_mem_release;
+    app.ctx.allocator.mem_realloc = s_counting_mem_realloc;
+    app.ctx.allocator.mem_calloc = s_counting_mem_calloc;
+    app.ctx.allocator.impl = &app.ctx;
+    aws_atomic_init_int(&app.ctx.allocation_count, 0);
+    app.ctx.message_count = 1000;
+    app.ctx.payload_size = 1024;
+    app.ctx.rounds = 10;
+    app.ctx.loop_counts = "1,2,4";
+    app.ctx.loopback_payload_sizes = "1024,65536";
+    app.ctx.concurrencies = "1,16,64";
+    app.ctx.duration_ms = 2000;
+    app.ctx.port = 58000;
+
+    aws_http_library_init(parent_allocator);
+
+    s_parse_options(argc, argv, &app);
+
+    BENCHMARK_CHECK(
+        aws_array_list_init_dynamic(&app.ctx.results, parent_allocator, 16, sizeof(struct benchmark_result)) ==
+        AWS_OP_SUCCESS);
+
+    if (app.run_codecs) {
+        benchmark_run_codecs(&app.ctx);
+        benchmark_run_hpack_corpora(&app.ctx);
+    }
+    if (app.run_micro) {
+        benchmark_run_micro(&app.ctx);
+    }
+    if (app.run_connection) {
+        benchmark_run_connection(&app.ctx);
+    }
+    if (app.run_loopback) {
+        benchmark_run_loopback(&app.ctx);
+    }
+
+    const bool is_json_to_stdout = app.json_path && strcmp(app.json_path, "-") == 0;
+    if (!is_json_to_stdout) {
+        s_print_results(&app.ctx);
+    }
+
+    int exit_code = 0;
+    if (app.json_path) {
+        FILE *json_output = is_json_to_stdout ? stdout : fopen(app.json_path, "w");
+        if (json_output) {
+            s_write_json(&app.ctx, json_output);
+            if (json_output != stdout) {
+                fclose(json_output);
+            }
+        } else {
+            fprintf(stderr, "unable to open \"%s\" for writing.\n", app.json_path);
+            exit_code = 1;
+        }
+    }
+
+    aws_array_list_clean_up(&app.ctx.results);
+    aws_http_library_clean_up();
+
+    return exit_code;
+}
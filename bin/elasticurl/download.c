@@ -0,0 +1,453 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+#include "elasticurl.h"
+
+#include <aws/http/connection.h>
+#include <aws/http/connection_manager.h>
+#include <aws/http/http2_stream_manager.h>
+#include <aws/http/status_code.h>
+
+#include <aws/common/clock.h>
+
+#include <aws/io/channel_bootstrap.h>
+
+#include <inttypes.h>
+
+#ifdef _WIN32
+#    include <stdio.h>
+#else
+#    include <errno.h>
+#    include <unistd.h>
+#endif
+
+#ifdef _MSC_VER
+#    pragma warning(disable : 4204) /* Declared initializers */
+#endif
+
+/**
+ * Parallel ranged download: a HEAD request finds the size of the object, which is then fetched as Range GETs of
+ * --part-size bytes, --parallel at a time. Each part is written at its offset in the output file as it arrives, so
+ * parts finish in any order.
+ *
+ * HTTP/1.1 parts go through an aws_http_connection_manager, a connection each. HTTP/2 ones (--http2) go through an
+ * aws_http2_stream_manager that also spreads them over --parallel connections, as one TCP connection is what limits
+ * the throughput of a big download.
+ */
+
+struct elasticurl_download {
+    struct elasticurl_ctx *app_ctx;
+    struct aws_allocator *allocator;
+    enum aws_http_version version;
+
+    /* One of these, depending on version */
+    struct aws_http_connection_manager *connection_manager;
+    struct aws_http2_stream_manager *stream_manager;
+
+    /* From the HEAD response */
+    uint64_t object_size;
+    size_t part_count;
+
+    struct aws_mutex lock;
+    struct aws_condition_variable signal;
+
+    /* Protected by lock */
+    struct {
+        size_t next_part;
+        size_t parts_in_flight;
+        /* The first error of any part. No more parts start once it's set */
+        int error_code;
+        bool is_head_done;
+        bool is_manager_shut_down;
+    } synced_data;
+
+    struct aws_atomic_var bytes_written;
+};
+
+/* The HEAD request, or one Range GET */
+struct elasticurl_download_part {
+    struct elasticurl_download *download;
+    struct aws_http_message *request;
+    struct aws_http_connection *connection;
+    bool is_head;
+    uint64_t offset;
+    uint64_t length;
+    uint64_t bytes_received;
+    /* From the HEAD response */
+    bool has_content_length;
+    uint64_t content_length;
+};
+
+static uint64_t s_now_ns(void) {
+    uint64_t now_ns = 0;
+    aws_high_res_clock_get_ticks(&now_ns);
+    return now_ns;
+}
+
+static bool s_is_done(void *user_data) {
+    struct elasticurl_download *download = user_data;
+    if (!download->synced_data.is_head_done || download->synced_data.parts_in_flight) {
+        return false;
+    }
+    return download->synced_data.error_code || download->synced_data.next_part == download->part_count;
+}
+
+static bool s_is_manager_shut_down(void *user_data) {
+    struct elasticurl_download *download = user_data;
+    return download->synced_data.is_manager_shut_down;
+}
+
+static void s_on_manager_shutdown_complete(void *user_data) {
+    struct elasticurl_download *download = user_data;
+    aws_mutex_lock(&download->lock);
+    download->synced_data.is_manager_shut_down = true;
+    /* Notified with the lock held, as the waiter cleans download up as soon as it sees this */
+    aws_condition_variable_notify_all(&download->signal);
+    aws_mutex_unlock(&download->lock);
+}
+
+/* Writes all of data at offset in the output file. Parts write from different threads at once */
+static int s_write_at(struct elasticurl_download *download, uint64_t offset, struct aws_byte_cursor data) {
+#ifdef _WIN32
+    /* No pwrite(), so writes take turns at seeking the file */
+    aws_mutex_lock(&download->lock);
+    bool is_written = _fseeki64(download->app_ctx->output, (__int64)offset, SEEK_SET) == 0 &&
+                      fwrite(data.ptr, 1, data.len, download->app_ctx->output) == data.len;
+    aws_mutex_unlock(&download->lock);
+    if (!is_written) {
+        return aws_raise_error(AWS_ERROR_SYS_CALL_FAILURE);
+    }
+#else
+    const int fd = fileno(download->app_ctx->output);
+    while (data.len) {
+        ssize_t written = pwrite(fd, data.ptr, data.len, (off_t)offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return aws_raise_error(AWS_ERROR_SYS_CALL_FAILURE);
+        }
+        aws_byte_cursor_advance(&data, (size_t)written);
+        offset += (uint64_t)written;
+    }
+#endif
+    return AWS_OP_SUCCESS;
+}
+
+static void s_start_part(struct elasticurl_download *download, size_t part_index);
+
+/* Every part ends here, and starts the next one in its place */
+static void s_part_finish(struct elasticurl_download_part *part, int error_code) {
+    struct elasticurl_download *download = part->download;
+
+    if (!error_code) {
+        if (part->is_head) {
+            if (!part->has_content_length) {
+                fprintf(stderr, "The HEAD response has no content-length, so the download can't be split.\n");
+                error_code = AWS_ERROR_HTTP_HEADER_NOT_FOUND;
+            }
+        } else if (part->bytes_received != part->length) {
+            fprintf(stderr, "Part at offset %" PRIu64 " was cut short.\n", part->offset);
+            error_code = AWS_ERROR_HTTP_PROTOCOL_ERROR;
+        }
+    }
+
+    const bool is_head = part->is_head;
+    if (is_head && !error_code) {
+        download->object_size = part->content_length;
+        const uint64_t part_count = (part->content_length + download->app_ctx->download.part_size - 1) /
+                                    download->app_ctx->download.part_size;
+        if (part_count > SIZE_MAX) {
+            error_code = AWS_ERROR_OVERFLOW_DETECTED;
+        }
+        download->part_count = (size_t)part_count;
+    }
+    aws_http_message_release(part->request);
+    aws_mem_release(download->allocator, part);
+
+    size_t start_count = 0;
+
+    aws_mutex_lock(&download->lock);
+    if (is_head) {
+        download->synced_data.is_head_done = true;
+    } else {
+        download->synced_data.parts_in_flight--;
+    }
+    if (error_code && !download->synced_data.error_code) {
+        download->synced_data.error_code = error_code;
+    }
+    /* After the HEAD, --parallel parts start. After that, each part finishing starts one more */
+    const size_t start_limit = is_head ? download->app_ctx->download.parallel : 1;
+    while (!download->synced_data.error_code && start_count < start_limit &&
+           download->synced_data.next_part < download->part_count) {
+        download->synced_data.next_part++;
+        download->synced_data.parts_in_flight++;
+        start_count++;
+    }
+    const size_t first_part = download->synced_data.next_part - start_count;
+    if (s_is_done(download)) {
+        aws_condition_variable_notify_all(&download->signal);
+    }
+    aws_mutex_unlock(&download->lock);
+
+    for (size_t i = 0; i < start_count; ++i) {
+        s_start_part(download, first_part + i);
+    }
+}
+
+static int s_on_response_headers(
+    struct aws_http_stream *stream,
+    enum aws_http_header_block header_block,
+    const struct aws_http_header *header_array,
+    size_t num_headers,
+    void *user_data) {
+
+    (void)stream;
+    struct elasticurl_download_part *part = user_data;
+    if (!part->is_head || header_block != AWS_HTTP_HEADER_BLOCK_MAIN) {
+        return AWS_OP_SUCCESS;
+    }
+
+    for (size_t i = 0; i < num_headers; ++i) {
+        if (aws_byte_cursor_eq_c_str_ignore_case(&header_array[i].name, "content-length") &&
+            aws_byte_cursor_utf8_parse_u64(header_array[i].value, &part->content_length) == AWS_OP_SUCCESS) {
+            part->has_content_length = true;
+        }
+    }
+    return AWS_OP_SUCCESS;
+}
+
+static int s_on_response_header_block_done(
+    struct aws_http_stream *stream,
+    enum aws_http_header_block header_block,
+    void *user_data) {
+
+    struct elasticurl_download_part *part = user_data;
+    if (header_block != AWS_HTTP_HEADER_BLOCK_MAIN) {
+        return AWS_OP_SUCCESS;
+    }
+
+    /* A server that ignores Range answers 200 with the whole object, which mustn't be written over every part */
+    int status = 0;
+    aws_http_stream_get_incoming_response_status(stream, &status);
+    const int expected_status = part->is_head ? AWS_HTTP_STATUS_CODE_200_OK : AWS_HTTP_STATUS_CODE_206_PARTIAL_CONTENT;
+    if (status != expected_status) {
+        fprintf(
+            stderr,
+            "%s got status %d, expected %d.\n",
+            part->is_head ? "The HEAD request" : "A Range request",
+            status,
+            expected_status);
+        return aws_raise_error(AWS_ERROR_HTTP_INVALID_STATUS_CODE);
+    }
+    return AWS_OP_SUCCESS;
+}
+
+static int s_on_response_body(struct aws_http_stream *stream, const struct aws_byte_cursor *data, void *user_data) {
+    (void)stream;
+    struct elasticurl_download_part *part = user_data;
+
+    if (data->len > part->length - part->bytes_received) {
+        fprintf(stderr, "Part at offset %" PRIu64 " got more than it asked for.\n", part->offset);
+        return aws_raise_error(AWS_ERROR_HTTP_PROTOCOL_ERROR);
+    }
+    if (s_write_at(part->download, part->offset + part->bytes_received, *data)) {
+        fprintf(stderr, "Failed to write to the output file.\n");
+        return AWS_OP_ERR;
+    }
+    part->bytes_received += data->len;
+    aws_atomic_fetch_add(&part->download->bytes_written, data->len);
+    return AWS_OP_SUCCESS;
+}
+
+static void s_on_stream_complete(struct aws_http_stream *stream, int error_code, void *user_data) {
+    struct elasticurl_download_part *part = user_data;
+    struct elasticurl_download *download = part->download;
+
+    aws_http_stream_release(stream);
+    if (part->connection) {
+        aws_http_connection_manager_release_connection(download->connection_manager, part->connection);
+    }
+    s_part_finish(part, error_code);
+}
+
+static void s_on_connection_acquired(struct aws_http_connection *connection, int error_code, void *user_data) {
+    struct elasticurl_download_part *part = user_data;
+
+    if (error_code) {
+        s_part_finish(part, error_code);
+        return;
+    }
+
+    part->connection = connection;
+    struct aws_http_make_request_options options = {
+        .self_size = sizeof(options),
+        .request = part->request,
+        .user_data = part,
+        .on_response_headers = s_on_response_headers,
+        .on_response_header_block_done = s_on_response_header_block_done,
+        .on_response_body = s_on_response_body,
+        .on_complete = s_on_stream_complete,
+    };
+    struct aws_http_stream *stream = aws_http_connection_make_request(connection, &options);
+    if (stream == NULL || aws_http_stream_activate(stream)) {
+        error_code = aws_last_error();
+        aws_http_stream_release(stream);
+        aws_http_connection_manager_release_connection(part->download->connection_manager, connection);
+        s_part_finish(part, error_code);
+    }
+}
+
+/* On success the stream manager has activated the stream, and s_on_stream_complete is called when it's done */
+static void s_on_stream_acquired(struct aws_http_stream *stream, int error_code, void *user_data) {
+    (void)stream;
+    struct elasticurl_download_part *part = user_data;
+    if (error_code) {
+        s_part_finish(part, error_code);
+    }
+}
+
+static void s_make_request(struct elasticurl_download *download, struct elasticurl_download_part *part) {
+    if (download->version == AWS_HTTP_VERSION_2) {
+        struct aws_http_make_request_options options = {
+            .self_size = sizeof(options),
+            .request = part->request,
+            .user_data = part,
+            .on_response_headers = s_on_response_headers,
+            .on_response_header_block_done = s_on_response_header_block_done,
+            .on_response_body = s_on_response_body,
+            .on_complete = s_on_stream_complete,
+        };
+        struct aws_http2_stream_manager_acquire_stream_options acquire_options = {
+            .callback = s_on_stream_acquired,
+            .user_data = part,
+            .options = &options,
+        };
+        aws_http2_stream_manager_acquire_stream(download->stream_manager, &acquire_options);
+    } else {
+        aws_http_connection_manager_acquire_connection(download->connection_manager, s_on_connection_acquired, part);
+    }
+}
+
+static void s_start_head(struct elasticurl_download *download) {
+    struct elasticurl_download_part *part =
+        aws_mem_calloc(download->allocator, 1, sizeof(struct elasticurl_download_part));
+    part->download = download;
+    part->is_head = true;
+    part->request = elasticurl_build_http_request(download->app_ctx, download->version, NULL);
+    aws_http_message_set_request_method(part->request, aws_http_method_head);
+    s_make_request(download, part);
+}
+
+static void s_start_part(struct elasticurl_download *download, size_t part_index) {
+    const uint64_t part_size = download->app_ctx->download.part_size;
+
+    struct elasticurl_download_part *part =
+        aws_mem_calloc(download->allocator, 1, sizeof(struct elasticurl_download_part));
+    part->download = download;
+    part->offset = (uint64_t)part_index * part_size;
+    part->length = aws_min_u64(part_size, download->object_size - part->offset);
+    part->request = elasticurl_build_http_request(download->app_ctx, download->version, NULL);
+
+    char range[64];
+    snprintf(range, sizeof(range), "bytes=%" PRIu64 "-%" PRIu64, part->offset, part->offset + part->length - 1);
+    struct aws_http_header range_header = {
+        .name = aws_byte_cursor_from_c_str("range"),
+        .value = aws_byte_cursor_from_c_str(range),
+    };
+    aws_http_message_add_header(part->request, range_header);
+
+    s_make_request(download, part);
+}
+
+static int s_new_manager(struct elasticurl_download *download, const struct elasticurl_connection_config *config) {
+    const size_t parallel = download->app_ctx->download.parallel;
+
+    if (download->version == AWS_HTTP_VERSION_2) {
+        struct aws_http2_stream_manager_options manager_options = {
+            .bootstrap = config->bootstrap,
+            .socket_options = config->socket_options,
+            .tls_connection_options = config->tls_options,
+            .http2_prior_knowledge = config->tls_options == NULL,
+            .host = config->host,
+            .port = config->port,
+            .shutdown_complete_user_data = download,
+            .shutdown_complete_callback = s_on_manager_shutdown_complete,
+            /* A connection per part, while there are connections to spare */
+            .ideal_concurrent_streams_per_connection = 1,
+            .max_connections = parallel,
+        };
+        download->stream_manager = aws_http2_stream_manager_new(download->allocator, &manager_options);
+        return download->stream_manager ? AWS_OP_SUCCESS : AWS_OP_ERR;
+    }
+
+    struct aws_http_connection_manager_options manager_options = {
+        .bootstrap = config->bootstrap,
+        .initial_window_size = SIZE_MAX,
+        .socket_options = config->socket_options,
+        .tls_connection_options = config->tls_options,
+        .host = config->host,
+        .port = config->port,
+        .max_connections = parallel,
+        .shutdown_complete_user_data = download,
+        .shutdown_complete_callback = s_on_manager_shutdown_complete,
+    };
+    download->connection_manager = aws_http_connection_manager_new(download->allocator, &manager_options);
+    return download->connection_manager ? AWS_OP_SUCCESS : AWS_OP_ERR;
+}
+
+int elasticurl_run_parallel_download(
+    struct elasticurl_ctx *app_ctx,
+    const struct elasticurl_connection_config *config) {
+
+    struct elasticurl_download download;
+    AWS_ZERO_STRUCT(download);
+    download.app_ctx = app_ctx;
+    download.allocator = app_ctx->allocator;
+    download.version =
+        app_ctx->required_http_version == AWS_HTTP_VERSION_2 ? AWS_HTTP_VERSION_2 : AWS_HTTP_VERSION_1_1;
+    aws_mutex_init(&download.lock);
+    aws_condition_variable_init(&download.signal);
+    aws_atomic_init_int(&download.bytes_written, 0);
+
+    if (s_new_manager(&download, config)) {
+        fprintf(stderr, "Failed to create the manager with error %s\n", aws_error_debug_str(aws_last_error()));
+        exit(1);
+    }
+
+    const uint64_t start_ns = s_now_ns();
+    s_start_head(&download);
+
+    aws_mutex_lock(&download.lock);
+    aws_condition_variable_wait_pred(&download.signal, &download.lock, s_is_done, &download);
+    const int error_code = download.synced_data.error_code;
+    aws_mutex_unlock(&download.lock);
+    const double elapsed_sec = (double)(s_now_ns() - start_ns) / AWS_TIMESTAMP_NANOS;
+
+    const uint64_t bytes_written = aws_atomic_load_int(&download.bytes_written);
+    if (error_code) {
+        fprintf(stderr, "Download failed with error %s\n", aws_error_debug_str(error_code));
+    } else {
+        fprintf(
+            stdout,
+            "Downloaded %" PRIu64 " bytes in %zu parts in %.3f s: %.2f MB/s\n",
+            bytes_written,
+            download.part_count,
+            elapsed_sec,
+            (double)bytes_written / elapsed_sec / (1024 * 1024));
+    }
+
+    if (download.connection_manager) {
+        aws_http_connection_manager_release(download.connection_manager);
+    }
+    aws_http2_stream_manager_release(download.stream_manager);
+    aws_mutex_lock(&download.lock);
+    aws_condition_variable_wait_pred(&download.signal, &download.lock, s_is_manager_shut_down, &download);
+    aws_mutex_unlock(&download.lock);
+
+    aws_condition_variable_clean_up(&download.signal);
+    aws_mutex_clean_up(&download.lock);
+
+    return error_code ? 1 : 0;
+}
@@ -0,0 +1,108 @@
+#ifndef AWS_ELASTICURL_H
+#define AWS_ELASTICURL_H
+
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/request_response.h>
+
+#include <aws/common/condition_variable.h>
+#include <aws/common/hash_table.h>
+#include <aws/common/logging.h>
+#include <aws/common/mutex.h>
+
+#include <aws/io/shared_library.h>
+#include <aws/io/uri.h>
+
+#include <stdio.h>
+
+struct aws_client_bootstrap;
+struct aws_socket_options;
+struct aws_tls_connection_options;
+
+/* Load generation, see load.c. It's on if any of these are set */
+struct elasticurl_load_options {
+    /* Requests kept in flight, when not going at a fixed rate */
+    size_t concurrency;
+    /* Stop after this many requests, or after duration_sec. 0 for no limit */
+    size_t request_count;
+    size_t duration_sec;
+    /* Open loop: start this many requests per second, however long they take. 0 for closed loop */
+    double rate;
+    /* At most this many connections. 0 for concurrency over HTTP/1.1, or one for HTTP/2 */
+    size_t connection_count;
+};
+
+/* Parallel ranged download, see download.c. It's on if parallel is set */
+struct elasticurl_download_options {
+    /* Parts downloaded at once, each on a connection of its own */
+    size_t parallel;
+    uint64_t part_size;
+};
+
+struct elasticurl_ctx {
+    struct aws_allocator *allocator;
+    const char *verb;
+    struct aws_uri uri;
+    struct aws_mutex mutex;
+    struct aws_condition_variable c_var;
+    bool response_code_written;
+    const char *cacert;
+    const char *capath;
+    const char *cert;
+    const char *key;
+    int connect_timeout;
+    const char *header_lines[10];
+    size_t header_line_count;
+    FILE *input_file;
+    struct aws_input_stream *input_body;
+    struct aws_http_message *request;
+    struct aws_http_connection *connection;
+    const char *signing_library_path;
+    struct aws_shared_library signing_library;
+    const char *signing_function_name;
+    struct aws_hash_table signing_context;
+    aws_http_message_transform_fn *signing_function;
+    const char *alpn;
+    bool include_headers;
+    bool insecure;
+    FILE *output;
+    const char *trace_file;
+    enum aws_log_level log_level;
+    enum aws_http_version required_http_version;
+    bool exchange_completed;
+    bool is_load_mode;
+    struct elasticurl_load_options load;
+    struct elasticurl_download_options download;
+};
+
+/* Where to connect to, and how, worked out from the command line */
+struct elasticurl_connection_config {
+    struct aws_client_bootstrap *bootstrap;
+    const struct aws_socket_options *socket_options;
+    /* NULL for plain text */
+    const struct aws_tls_connection_options *tls_options;
+    struct aws_byte_cursor host;
+    uint16_t port;
+};
+
+/**
+ * Builds the request described by the command line, for the given HTTP version.
+ * body may be NULL, or a stream for the request to send. The request holds a reference to it.
+ */
+struct aws_http_message *elasticurl_build_http_request(
+    struct elasticurl_ctx *app_ctx,
+    enum aws_http_version protocol_version,
+    struct aws_input_stream *body);
+
+/* Runs the load described by app_ctx->load and prints the results. Returns the exit code */
+int elasticurl_run_load(struct elasticurl_ctx *app_ctx, const struct elasticurl_connection_config *config);
+
+/* Downloads to app_ctx->output in parts, as described by app_ctx->download, and prints the throughput */
+int elasticurl_run_parallel_download(
+    struct elasticurl_ctx *app_ctx,
+    const struct elasticurl_connection_config *config);
+
+#endif /* AWS_ELASTICURL_H */
@@ -0,0 +1,491 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+#include "elasticurl.h"
+
+#include <aws/http/connection.h>
+#include <aws/http/connection_manager.h>
+#include <aws/http/http2_stream_manager.h>
+#include <aws/http/private/manager_histogram.h>
+
+#include <aws/common/clock.h>
+#include <aws/common/task_scheduler.h>
+
+#include <aws/io/channel_bootstrap.h>
+#include <aws/io/event_loop.h>
+#include <aws/io/stream.h>
+
+#include <inttypes.h>
+
+#ifdef _MSC_VER
+#    pragma warning(disable : 4204) /* Declared initializers */
+#endif
+
+/**
+ * Load generation: the request from the command line, made over and over through the same managers services use.
+ * HTTP/1.1 requests go through an aws_http_connection_manager, and HTTP/2 ones (--http2) through an
+ * aws_http2_stream_manager.
+ *
+ * Closed loop (the default) keeps --concurrency requests in flight, starting one as soon as another completes.
+ * Open loop (--rate) starts requests on a schedule, however long they take. Its latencies are measured from when a
+ * request was due to start rather than from when it did, so a server that falls behind shows up in them.
+ */
+
+struct elasticurl_load {
+    struct elasticurl_ctx *app_ctx;
+    struct aws_allocator *allocator;
+    enum aws_http_version version;
+
+    /* One of these, depending on version */
+    struct aws_http_connection_manager *connection_manager;
+    struct aws_http2_stream_manager *stream_manager;
+
+    /* Request body from --data or --data-file, read once and sent by every request */
+    struct aws_byte_buf body;
+
+    /* Open loop only. Starts the requests that are due, then waits for the next one */
+    struct aws_event_loop *rate_loop;
+    struct aws_task rate_task;
+
+    uint64_t start_ns;
+    /* 0 if there's no --duration */
+    uint64_t end_ns;
+
+    struct aws_mutex lock;
+    struct aws_condition_variable signal;
+
+    /* Protected by lock */
+    struct {
+        size_t started;
+        size_t in_flight;
+        /* No more requests will start */
+        bool is_starting_done;
+        bool is_manager_shut_down;
+    } synced_data;
+
+    /* Updated by requests completing, on any thread */
+    struct aws_atomic_var succeeded;
+    struct aws_atomic_var failed;
+    /* Responses by status class: 1xx to 5xx, anything else in 0 */
+    struct aws_atomic_var status_classes[6];
+    struct aws_atomic_var bytes_received;
+    struct aws_http_atomic_histogram latency_histogram;
+};
+
+/* One request, from being started to its stream completing */
+struct elasticurl_load_request {
+    struct elasticurl_load *load;
+    struct aws_http_message *request;
+    struct aws_http_connection *connection;
+    /* When the request was due to start. Latency is measured from here */
+    uint64_t start_ns;
+    uint64_t bytes_received;
+};
+
+static uint64_t s_now_ns(void) {
+    uint64_t now_ns = 0;
+    aws_high_res_clock_get_ticks(&now_ns);
+    return now_ns;
+}
+
+static bool s_is_done(void *user_data) {
+    struct elasticurl_load *load = user_data;
+    return load->synced_data.is_starting_done && load->synced_data.in_flight == 0;
+}
+
+static bool s_is_manager_shut_down(void *user_data) {
+    struct elasticurl_load *load = user_data;
+    return load->synced_data.is_manager_shut_down;
+}
+
+static void s_on_manager_shutdown_complete(void *user_data) {
+    struct elasticurl_load *load = user_data;
+    aws_mutex_lock(&load->lock);
+    load->synced_data.is_manager_shut_down = true;
+    /* Notified with the lock held, as the waiter cleans load up as soon as it sees this */
+    aws_condition_variable_notify_all(&load->signal);
+    aws_mutex_unlock(&load->lock);
+}
+
+
+/* Whether a request due at due_ns would go past --requests or --duration. Must be called with the lock held */
+static bool s_is_limit_reached_synced(const struct elasticurl_load *load, uint64_t due_ns) {
+    const struct elasticurl_load_options *options = &load->app_ctx->load;
+    return (options->request_count && load->synced_data.started == options->request_count) ||
+           (load->end_ns && due_ns >= load->end_ns);
+}
+
+/* Counts a request due at due_ns as started, if the limits allow another. Must be called with the lock held */
+static bool s_try_start_synced(struct elasticurl_load *load, uint64_t due_ns) {
+    if (load->synced_data.is_starting_done) {
+        return false;
+    }
+    if (s_is_limit_reached_synced(load, due_ns)) {
+        load->synced_data.is_starting_done = true;
+        return false;
+    }
+    load->synced_data.started++;
+    load->synced_data.in_flight++;
+    return true;
+}
+
+static void s_start_request(struct elasticurl_load *load, uint64_t start_ns);
+
+/* Every request ends here, failed or not. In closed loop, the next one starts in its place */
+static void s_request_finish(struct elasticurl_load_request *load_request, int error_code, int status) {
+    struct elasticurl_load *load = load_request->load;
+    const uint64_t now_ns = s_now_ns();
+
+    if (error_code) {
+        aws_atomic_fetch_add(&load->failed, 1);
+    } else {
+        aws_atomic_fetch_add(&load->succeeded, 1);
+        aws_atomic_fetch_add(&load->status_classes[status >= 100 && status < 600 ? status / 100 : 0], 1);
+        aws_atomic_fetch_add(&load->bytes_received, (size_t)load_request->bytes_received);
+        aws_http_atomic_histogram_record(&load->latency_histogram, load_request->start_ns, now_ns);
+    }
+
+    aws_http_message_release(load_request->request);
+    aws_mem_release(load->allocator, load_request);
+
+    aws_mutex_lock(&load->lock);
+    load->synced_data.in_flight--;
+    const bool is_next_started = load->app_ctx->load.rate == 0 && s_try_start_synced(load, now_ns);
+    if (s_is_done(load)) {
+        aws_condition_variable_notify_all(&load->signal);
+    }
+    aws_mutex_unlock(&load->lock);
+
+    if (is_next_started) {
+        s_start_request(load, now_ns);
+    }
+}
+
+static int s_on_response_body(struct aws_http_stream *stream, const struct aws_byte_cursor *data, void *user_data) {
+    (void)stream;
+    struct elasticurl_load_request *load_request = user_data;
+    load_request->bytes_received += data->len;
+    return AWS_OP_SUCCESS;
+}
+
+static void s_on_stream_complete(struct aws_http_stream *stream, int error_code, void *user_data) {
+    struct elasticurl_load_request *load_request = user_data;
+    struct elasticurl_load *load = load_request->load;
+
+    int status = 0;
+    aws_http_stream_get_incoming_response_status(stream, &status);
+    aws_http_stream_release(stream);
+    if (load_request->connection) {
+        aws_http_connection_manager_release_connection(load->connection_manager, load_request->connection);
+    }
+
+    s_request_finish(load_request, error_code, status);
+}
+
+static void s_on_connection_acquired(struct aws_http_connection *connection, int error_code, void *user_data) {
+    struct elasticurl_load_request *load_request = user_data;
+
+    if (error_code) {
+        s_request_finish(load_request, error_code, 0);
+        return;
+    }
+
+    load_request->connection = connection;
+    struct aws_http_make_request_options options = {
+        .self_size = sizeof(options),
+        .request = load_request->request,
+        .user_data = load_request,
+        .on_response_body = s_on_response_body,
+        .on_complete = s_on_stream_complete,
+    };
+    struct aws_http_stream *stream = aws_http_connection_make_request(connection, &options);
+    if (stream == NULL || aws_http_stream_activate(stream)) {
+        error_code = aws_last_error();
+        aws_http_stream_release(stream);
+        aws_http_connection_manager_release_connection(load_request->load->connection_manager, connection);
+        s_request_finish(load_request, error_code, 0);
+    }
+}
+
+/* On success the stream manager has activated the stream, and s_on_stream_complete is called when it's done */
+static void s_on_stream_acquired(struct aws_http_stream *stream, int error_code, void *user_data) {
+    (void)stream;
+    struct elasticurl_load_request *load_request = user_data;
+    if (error_code) {
+        s_request_finish(load_request, error_code, 0);
+    }
+}
+
+static void s_start_request(struct elasticurl_load *load, uint64_t start_ns) {
+    struct elasticurl_load_request *load_request =
+        aws_mem_calloc(load->allocator, 1, sizeof(struct elasticurl_load_request));
+    load_request->load = load;
+    load_request->start_ns = start_ns;
+
+    /* Each request needs a body stream of its own, as the stream keeps track of how much has been sent */
+    struct aws_input_stream *body = NULL;
+    if (load->body.len) {
+        struct aws_byte_cursor body_cursor = aws_byte_cursor_from_buf(&load->body);
+        body = aws_input_stream_new_from_cursor(load->allocator, &body_cursor);
+    }
+    load_request->request = elasticurl_build_http_request(load->app_ctx, load->version, body);
+    aws_input_stream_release(body);
+
+    if (load->version == AWS_HTTP_VERSION_2) {
+        struct aws_http_make_request_options options = {
+            .self_size = sizeof(options),
+            .request = load_request->request,
+            .user_data = load_request,
+            .on_response_body = s_on_response_body,
+            .on_complete = s_on_stream_complete,
+        };
+        struct aws_http2_stream_manager_acquire_stream_options acquire_options = {
+            .callback = s_on_stream_acquired,
+            .user_data = load_request,
+            .options = &options,
+        };
+        aws_http2_stream_manager_acquire_stream(load->stream_manager, &acquire_options);
+    } else {
+        aws_http_connection_manager_acquire_connection(
+            load->connection_manager, s_on_connection_acquired, load_request);
+    }
+}
+
+/* Open loop: starts every request due by now, each with the time it was due, then sleeps until the next one */
+static void s_rate_task(struct aws_task *task, void *arg, enum aws_task_status status) {
+    struct elasticurl_load *load = arg;
+    const double interval_ns = (double)AWS_TIMESTAMP_NANOS / load->app_ctx->load.rate;
+    const uint64_t now_ns = s_now_ns();
+
+    while (true) {
+        aws_mutex_lock(&load->lock);
+        const uint64_t due_ns = load->start_ns + (uint64_t)((double)load->synced_data.started * interval_ns);
+        bool is_started = false;
+        if (status != AWS_TASK_STATUS_RUN_READY) {
+            load->synced_data.is_starting_done = true;
+        } else if (due_ns <= now_ns) {
+            is_started = s_try_start_synced(load, due_ns);
+        } else if (s_is_limit_reached_synced(load, due_ns)) {
+            /* Don't wait for a request that won't start */
+            load->synced_data.is_starting_done = true;
+        }
+        const bool is_starting_done = load->synced_data.is_starting_done;
+        if (s_is_done(load)) {
+            aws_condition_variable_notify_all(&load->signal);
+        }
+        aws_mutex_unlock(&load->lock);
+
+        if (is_started) {
+            s_start_request(load, due_ns);
+        } else if (is_starting_done) {
+            return;
+        } else {
+            uint64_t loop_now_ns = 0;
+            aws_event_loop_current_clock_time(load->rate_loop, &loop_now_ns);
+            aws_event_loop_schedule_task_future(load->rate_loop, task, loop_now_ns + (due_ns - now_ns));
+            return;
+        }
+    }
+}
+
+static int s_read_body(struct elasticurl_load *load) {
+    struct aws_input_stream *input_body = load->app_ctx->input_body;
+    int64_t length = 0;
+    if (aws_input_stream_get_length(input_body, &length) ||
+        aws_byte_buf_init(&load->body, load->allocator, (size_t)length)) {
+        return AWS_OP_ERR;
+    }
+
+    struct aws_stream_status status;
+    AWS_ZERO_STRUCT(status);
+    while (!status.is_end_of_stream && load->body.len < load->body.capacity) {
+        if (aws_input_stream_read(input_body, &load->body) || aws_input_stream_get_status(input_body, &status)) {
+            return AWS_OP_ERR;
+        }
+    }
+    return AWS_OP_SUCCESS;
+}
+
+static int s_new_manager(struct elasticurl_load *load, const struct elasticurl_connection_config *config) {
+    const struct elasticurl_load_options *options = &load->app_ctx->load;
+
+    if (load->version == AWS_HTTP_VERSION_2) {
+        struct aws_http2_stream_manager_options manager_options = {
+            .bootstrap = config->bootstrap,
+            .socket_options = config->socket_options,
+            .tls_connection_options = config->tls_options,
+            .http2_prior_knowledge = config->tls_options == NULL,
+            .host = config->host,
+            .port = config->port,
+            .shutdown_complete_user_data = load,
+            .shutdown_complete_callback = s_on_manager_shutdown_complete,
+            .max_connections = options->connection_count ? options->connection_count : 1,
+        };
+        load->stream_manager = aws_http2_stream_manager_new(load->allocator, &manager_options);
+        return load->stream_manager ? AWS_OP_SUCCESS : AWS_OP_ERR;
+    }
+
+    struct aws_http_connection_manager_options manager_options = {
+        .bootstrap = config->bootstrap,
+        .initial_window_size = SIZE_MAX,
+        .socket_options = config->socket_options,
+        .tls_connection_options = config->tls_options,
+        .host = config->host,
+        .port = config->port,
+        .max_connections = options->connection_count ? options->connection_count : options->concurrency,
+        .shutdown_complete_user_data = load,
+        .shutdown_complete_callback = s_on_manager_shutdown_complete,
+    };
+    load->connection_manager = aws_http_connection_manager_new(load->allocator, &manager_options);
+    return load->connection_manager ? AWS_OP_SUCCESS : AWS_OP_ERR;
+}
+
+static void s_print_latency_histogram(const struct aws_http_manager_histogram *latency) {
+    /* Coarser than the histogram's own buckets: row 0 is under 1us, and row i from 2^(i-1) up to 2^i us */
+    uint64_t rows[65];
+    AWS_ZERO_ARRAY(rows);
+    size_t first_row = AWS_ARRAY_SIZE(rows);
+    size_t last_row = 0;
+    uint64_t max_row_count = 0;
+    for (size_t i = 0; i < AWS_HTTP_MANAGER_HISTOGRAM_BUCKET_COUNT; ++i) {
+        if (latency->buckets[i] == 0) {
+            continue;
+        }
+        size_t row = 0;
+        for (uint64_t lower_bound = aws_http_manager_histogram_get_bucket_lower_bound(i); lower_bound;
+             lower_bound >>= 1) {
+            ++row;
+        }
+        rows[row] += latency->buckets[i];
+        first_row = aws_min_size(first_row, row);
+        last_row = aws_max_size(last_row, row);
+        max_row_count = aws_max_u64(max_row_count, rows[row]);
+    }
+
+    for (size_t row = first_row; row <= last_row; ++row) {
+        const uint64_t lower_us = row ? (uint64_t)1 << (row - 1) : 0;
+        const uint64_t upper_us = (uint64_t)1 << row;
+        const int bar_width = (int)(rows[row] * 40 / max_row_count);
+        fprintf(
+            stdout,
+            "  %10" PRIu64 " - %-10" PRIu64 " %10" PRIu64 " %.*s\n",
+            lower_us,
+            upper_us,
+            rows[row],
+            bar_width,
+            "########################################");
+    }
+}
+
+static void s_print_results(struct elasticurl_load *load, uint64_t elapsed_ns) {
+    const double elapsed_sec = (double)elapsed_ns / AWS_TIMESTAMP_NANOS;
+    const uint64_t succeeded = aws_atomic_load_int(&load->succeeded);
+    const uint64_t bytes_received = aws_atomic_load_int(&load->bytes_received);
+
+    struct aws_http_manager_histogram latency;
+    aws_http_atomic_histogram_snapshot(&load->latency_histogram, &latency);
+
+    fprintf(
+        stdout,
+        "Requests:   %" PRIu64 " succeeded, %" PRIu64 " failed\n",
+        succeeded,
+        (uint64_t)aws_atomic_load_int(&load->failed));
+    fprintf(stdout, "Responses: ");
+    for (size_t i = 1; i < AWS_ARRAY_SIZE(load->status_classes); ++i) {
+        fprintf(stdout, " %zuxx: %" PRIu64, i, (uint64_t)aws_atomic_load_int(&load->status_classes[i]));
+    }
+    fprintf(stdout, "\n");
+    fprintf(stdout, "Duration:   %.3f s\n", elapsed_sec);
+    fprintf(
+        stdout,
+        "Throughput: %.2f requests/s, %.2f MB/s received\n",
+        (double)succeeded / elapsed_sec,
+        (double)bytes_received / elapsed_sec / (1024 * 1024));
+
+    if (latency.count == 0) {
+        return;
+    }
+    fprintf(
+        stdout,
+        "Latency:    mean %" PRIu64 " us, p50 %" PRIu64 " us, p90 %" PRIu64 " us, p99 %" PRIu64 " us, p99.9 %" PRIu64
+        " us\n",
+        latency.sum_us / latency.count,
+        aws_http_manager_histogram_get_percentile(&latency, 50.0),
+        aws_http_manager_histogram_get_percentile(&latency, 90.0),
+        aws_http_manager_histogram_get_percentile(&latency, 99.0),
+        aws_http_manager_histogram_get_percentile(&latency, 99.9));
+    fprintf(stdout, "Latency histogram (us):\n");
+    s_print_latency_histogram(&latency);
+}
+
+int elasticurl_run_load(struct elasticurl_ctx *app_ctx, const struct elasticurl_connection_config *config) {
+    const struct elasticurl_load_options *options = &app_ctx->load;
+
+    struct elasticurl_load load;
+    AWS_ZERO_STRUCT(load);
+    load.app_ctx = app_ctx;
+    load.allocator = app_ctx->allocator;
+    load.version = app_ctx->required_http_version == AWS_HTTP_VERSION_2 ? AWS_HTTP_VERSION_2 : AWS_HTTP_VERSION_1_1;
+    aws_mutex_init(&load.lock);
+    aws_condition_variable_init(&load.signal);
+    aws_atomic_init_int(&load.succeeded, 0);
+    aws_atomic_init_int(&load.failed, 0);
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(load.status_classes); ++i) {
+        aws_atomic_init_int(&load.status_classes[i], 0);
+    }
+    aws_atomic_init_int(&load.bytes_received, 0);
+    aws_http_atomic_histogram_init(&load.latency_histogram);
+
+    if (s_read_body(&load)) {
+        fprintf(stderr, "Failed to read the request body with error %s\n", aws_error_debug_str(aws_last_error()));
+        exit(1);
+    }
+    if (s_new_manager(&load, config)) {
+        fprintf(stderr, "Failed to create the manager with error %s\n", aws_error_debug_str(aws_last_error()));
+        exit(1);
+    }
+
+    load.start_ns = s_now_ns();
+    if (options->duration_sec) {
+        load.end_ns =
+            load.start_ns + aws_timestamp_convert(options->duration_sec, AWS_TIMESTAMP_SECS, AWS_TIMESTAMP_NANOS, NULL);
+    }
+
+    if (options->rate > 0) {
+        load.rate_loop = aws_event_loop_group_get_next_loop(config->bootstrap->event_loop_group);
+        aws_task_init(&load.rate_task, s_rate_task, &load, "elasticurl_load_rate");
+        aws_event_loop_schedule_task_now(load.rate_loop, &load.rate_task);
+    } else {
+        aws_mutex_lock(&load.lock);
+        size_t start_count = 0;
+        while (start_count < options->concurrency && s_try_start_synced(&load, load.start_ns)) {
+            ++start_count;
+        }
+        aws_mutex_unlock(&load.lock);
+        for (size_t i = 0; i < start_count; ++i) {
+            s_start_request(&load, load.start_ns);
+        }
+    }
+
+    aws_mutex_lock(&load.lock);
+    aws_condition_variable_wait_pred(&load.signal, &load.lock, s_is_done, &load);
+    aws_mutex_unlock(&load.lock);
+    const uint64_t elapsed_ns = s_now_ns() - load.start_ns;
+
+    s_print_results(&load, elapsed_ns);
+
+    if (load.connection_manager) {
+        aws_http_connection_manager_release(load.connection_manager);
+    }
+    aws_http2_stream_manager_release(load.stream_manager);
+    aws_mutex_lock(&load.lock);
+    aws_condition_variable_wait_pred(&load.signal, &load.lock, s_is_manager_shut_down, &load);
+    aws_mutex_unlock(&load.lock);
+
+    aws_byte_buf_clean_up(&load.body);
+    aws_condition_variable_clean_up(&load.signal);
+    aws_mutex_clean_up(&load.lock);
+
+    return aws_atomic_load_int(&load.failed) ? 1 : 0;
+}
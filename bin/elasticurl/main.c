@@ -2,6 +2,8 @@
  * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
  * SPDX-License-Identifier: Apache-2.0.
  */
+#include "elasticurl.h"
+
 #include <aws/http/connection.h>
 #include <aws/http/request_response.h>
 
@@ -33,39 +35,6 @@
 
 #define ELASTICURL_VERSION "0.2.0"
 
-struct elasticurl_ctx {
-    struct aws_allocator *allocator;
-    const char *verb;
-    struct aws_uri uri;
-    struct aws_mutex mutex;
-    struct aws_condition_variable c_var;
-    bool response_code_written;
-    const char *cacert;
-    const char *capath;
-    const char *cert;
-    const char *key;
-    int connect_timeout;
-    const char *header_lines[10];
-    size_t header_line_count;
-    FILE *input_file;
-    struct aws_input_stream *input_body;
-    struct aws_http_message *request;
-    struct aws_http_connection *connection;
-    const char *signing_library_path;
-    struct aws_shared_library signing_library;
-    const char *signing_function_name;
-    struct aws_hash_table signing_context;
-    aws_http_message_transform_fn *signing_function;
-    const char *alpn;
-    bool include_headers;
-    bool insecure;
-    FILE *output;
-    const char *trace_file;
-    enum aws_log_level log_level;
-    enum aws_http_version required_http_version;
-    bool exchange_completed;
-};
-
 static void s_usage(int exit_code) {
 
     fprintf(stderr, "usage: elasticurl [options] url\n");
@@ -96,6 +65,15 @@ static void s_usage(int exit_code) {
     fprintf(stderr, "      --version: print the version of elasticurl.\n");
     fprintf(stderr, "      --http2: HTTP/2 connection required\n");
     fprintf(stderr, "      --http1_1: HTTP/1.1 connection required\n");
+    fprintf(stderr, "\n Load generation, which repeats the request and prints latency and throughput instead:\n\n");
+    fprintf(stderr, "      --concurrency INT: requests to keep in flight (default 1).\n");
+    fprintf(stderr, "      --requests INT: stop after this many requests.\n");
+    fprintf(stderr, "      --duration INT: stop after this many seconds (default 10 if --requests isn't set).\n");
+    fprintf(stderr, "      --rate NUM: start this many requests per second, however long they take.\n");
+    fprintf(stderr, "      --connections INT: most connections to open (default --concurrency, or 1 with --http2).\n");
+    fprintf(stderr, "\n Parallel download, which splits a GET into Range requests and needs --output:\n\n");
+    fprintf(stderr, "      --parallel INT: parts to download at once, each on a connection of its own.\n");
+    fprintf(stderr, "      --part-size SIZE: bytes in each part, with an optional K, M or G suffix (default 8M).\n");
     fprintf(stderr, "  -h, --help\n");
     fprintf(stderr, "            Display this message and quit.\n");
     exit(exit_code);
@@ -125,6 +103,13 @@ static struct aws_cli_option s_long_options[] = {
     {"version", AWS_CLI_OPTIONS_NO_ARGUMENT, NULL, 'V'},
     {"http2", AWS_CLI_OPTIONS_NO_ARGUMENT, NULL, 'w'},
     {"http1_1", AWS_CLI_OPTIONS_NO_ARGUMENT, NULL, 'W'},
+    {"concurrency", AWS_CLI_OPTIONS_REQUIRED_ARGUMENT, NULL, 'C'},
+    {"requests", AWS_CLI_OPTIONS_REQUIRED_ARGUMENT, NULL, 'n'},
+    {"duration", AWS_CLI_OPTIONS_REQUIRED_ARGUMENT, NULL, 'D'},
+    {"rate", AWS_CLI_OPTIONS_REQUIRED_ARGUMENT, NULL, 'R'},
+    {"connections", AWS_CLI_OPTIONS_REQUIRED_ARGUMENT, NULL, 'N'},
+    {"parallel", AWS_CLI_OPTIONS_REQUIRED_ARGUMENT, NULL, 'A'},
+    {"part-size", AWS_CLI_OPTIONS_REQUIRED_ARGUMENT, NULL, 'S'},
     {"help", AWS_CLI_OPTIONS_NO_ARGUMENT, NULL, 'h'},
     /* Per getopt(3) the last element of the array has to be filled with all zeros */
     {NULL, AWS_CLI_OPTIONS_NO_ARGUMENT, NULL, 0},
@@ -157,12 +142,44 @@ static int s_parse_signing_context(
     return AWS_OP_SUCCESS;
 }
 
+static size_t s_parse_load_count(const char *arg) {
+    char *end = NULL;
+    unsigned long long value = strtoull(arg, &end, 10);
+    if (end == arg || *end != '\0' || value == 0 || value > SIZE_MAX) {
+        fprintf(stderr, "invalid number \"%s\".\n", arg);
+        s_usage(1);
+    }
+    return (size_t)value;
+}
+
+/* A number of bytes, like 512, 64K or 8M */
+static uint64_t s_parse_byte_size(const char *arg) {
+    char *end = NULL;
+    unsigned long long value = strtoull(arg, &end, 10);
+    uint64_t multiplier = 1;
+    if (end != arg && (*end == 'K' || *end == 'k')) {
+        multiplier = 1024;
+        ++end;
+    } else if (end != arg && (*end == 'M' || *end == 'm')) {
+        multiplier = 1024 * 1024;
+        ++end;
+    } else if (end != arg && (*end == 'G' || *end == 'g')) {
+        multiplier = 1024 * 1024 * 1024;
+        ++end;
+    }
+    if (end == arg || *end != '\0' || value == 0 || value > UINT64_MAX / multiplier) {
+        fprintf(stderr, "invalid size \"%s\".\n", arg);
+        s_usage(1);
+    }
+    return (uint64_t)value * multiplier;
+}
+
 static void s_parse_options(int argc, char **argv, struct elasticurl_ctx *ctx) {
     bool uri_found = false;
     while (true) {
         int option_index = 0;
-        int c =
-            aws_cli_getopt_long(argc, argv, "a:b:c:e:f:H:d:g:j:l:m:M:GPHiko:t:v:VwWh", s_long_options, &option_index);
+        int c = aws_cli_getopt_long(
+            argc, argv, "a:b:c:e:f:H:d:g:j:l:m:M:GPHiko:t:v:VwWC:n:D:R:N:A:S:h", s_long_options, &option_index);
         if (c == -1) {
             break;
         }
@@ -276,6 +293,38 @@ static void s_parse_options(int argc, char **argv, struct elasticurl_ctx *ctx) {
                 ctx->alpn = "http/1.1";
                 ctx->required_http_version = AWS_HTTP_VERSION_1_1;
                 break;
+            case 'C':
+                ctx->load.concurrency = s_parse_load_count(aws_cli_optarg);
+                ctx->is_load_mode = true;
+                break;
+            case 'n':
+                ctx->load.request_count = s_parse_load_count(aws_cli_optarg);
+                ctx->is_load_mode = true;
+                break;
+            case 'D':
+                ctx->load.duration_sec = s_parse_load_count(aws_cli_optarg);
+                ctx->is_load_mode = true;
+                break;
+            case 'R': {
+                char *end = NULL;
+                ctx->load.rate = strtod(aws_cli_optarg, &end);
+                if (end == aws_cli_optarg || *end != '\0' || !(ctx->load.rate > 0)) {
+                    fprintf(stderr, "invalid rate \"%s\".\n", aws_cli_optarg);
+                    s_usage(1);
+                }
+                ctx->is_load_mode = true;
+                break;
+            }
+            case 'N':
+                ctx->load.connection_count = s_parse_load_count(aws_cli_optarg);
+                ctx->is_load_mode = true;
+                break;
+            case 'A':
+                ctx->download.parallel = s_parse_load_count(aws_cli_optarg);
+                break;
+            case 'S':
+                ctx->download.part_size = s_parse_byte_size(aws_cli_optarg);
+                break;
             case 'h':
                 s_usage(0);
                 break;
@@ -317,6 +366,47 @@ static void s_parse_options(int argc, char **argv, struct elasticurl_ctx *ctx) {
         }
     }
 
+    if (ctx->is_load_mode) {
+        if (ctx->signing_function != NULL) {
+            fprintf(stderr, "Signing isn't supported with load generation.\n");
+            s_usage(1);
+        }
+        if (ctx->load.concurrency == 0) {
+            ctx->load.concurrency = 1;
+        }
+        if (ctx->load.request_count == 0 && ctx->load.duration_sec == 0) {
+            ctx->load.duration_sec = 10;
+        }
+        if (ctx->required_http_version != AWS_HTTP_VERSION_2) {
+            /* HTTP/1.1 requests go through the connection manager, which needs connections to speak it */
+            ctx->alpn = "http/1.1";
+        }
+    }
+
+    if (ctx->download.parallel) {
+        if (ctx->is_load_mode) {
+            fprintf(stderr, "--parallel can't be used with load generation.\n");
+            s_usage(1);
+        }
+        if (ctx->output == stdout) {
+            fprintf(stderr, "--parallel writes parts as they arrive, so it needs a file to write to with --output.\n");
+            s_usage(1);
+        }
+        if (strcmp(ctx->verb, "GET") != 0 || ctx->input_body != NULL || ctx->signing_function != NULL) {
+            fprintf(stderr, "--parallel only supports unsigned GET requests.\n");
+            s_usage(1);
+        }
+        if (ctx->download.part_size == 0) {
+            ctx->download.part_size = 8 * 1024 * 1024;
+        }
+        if (ctx->required_http_version != AWS_HTTP_VERSION_2) {
+            ctx->alpn = "http/1.1";
+        }
+    } else if (ctx->download.part_size) {
+        fprintf(stderr, "--part-size needs --parallel.\n");
+        s_usage(1);
+    }
+
     if (ctx->input_body == NULL) {
         struct aws_byte_cursor empty_cursor;
         AWS_ZERO_STRUCT(empty_cursor);
@@ -391,9 +481,10 @@ static void s_on_stream_complete_fn(struct aws_http_stream *stream, int error_co
     aws_http_stream_release(stream);
 }
 
-static struct aws_http_message *s_build_http_request(
+struct aws_http_message *elasticurl_build_http_request(
     struct elasticurl_ctx *app_ctx,
-    enum aws_http_version protocol_version) {
+    enum aws_http_version protocol_version,
+    struct aws_input_stream *body) {
 
     struct aws_http_message *request = protocol_version == AWS_HTTP_VERSION_2
                                            ? aws_http2_message_new_request(app_ctx->allocator)
@@ -432,9 +523,9 @@ static struct aws_http_message *s_build_http_request(
     };
     aws_http_message_add_header(request, user_agent_header);
 
-    if (app_ctx->input_body) {
+    if (body) {
         int64_t data_len = 0;
-        if (aws_input_stream_get_length(app_ctx->input_body, &data_len)) {
+        if (aws_input_stream_get_length(body, &data_len)) {
             fprintf(stderr, "failed to get length of input stream.\n");
             exit(1);
         }
@@ -448,7 +539,7 @@ static struct aws_http_message *s_build_http_request(
                 .value = aws_byte_cursor_from_c_str(content_length),
             };
             aws_http_message_add_header(request, content_length_header);
-            aws_http_message_set_body_stream(request, app_ctx->input_body);
+            aws_http_message_set_body_stream(request, body);
         }
     }
 
@@ -493,7 +584,8 @@ static void s_on_client_connection_setup(struct aws_http_connection *connection,
     }
 
     app_ctx->connection = connection;
-    app_ctx->request = s_build_http_request(app_ctx, aws_http_connection_get_version(connection));
+    app_ctx->request =
+        elasticurl_build_http_request(app_ctx, aws_http_connection_get_version(connection), app_ctx->input_body);
 
     /* If async signing function is set, invoke it. It must invoke the signing complete callback when it's done. */
     if (app_ctx->signing_function) {
@@ -696,7 +788,9 @@ int main(int argc, char **argv) {
         }
     }
 
-    struct aws_event_loop_group *el_group = aws_event_loop_group_new_default(allocator, 1, NULL);
+    /* Load generation and parallel downloads spread their connections over a thread per core */
+    struct aws_event_loop_group *el_group =
+        aws_event_loop_group_new_default(allocator, app_ctx.is_load_mode || app_ctx.download.parallel ? 0 : 1, NULL);
 
     struct aws_host_resolver_default_options resolver_options = {
         .el_group = el_group,
@@ -736,10 +830,25 @@ int main(int argc, char **argv) {
         /* Use prior knowledge to connect */
         http_client_options.prior_knowledge_http2 = true;
     }
-    aws_http_client_connect(&http_client_options);
-    aws_mutex_lock(&app_ctx.mutex);
-    aws_condition_variable_wait_pred(&app_ctx.c_var, &app_ctx.mutex, s_completion_predicate, &app_ctx);
-    aws_mutex_unlock(&app_ctx.mutex);
+
+    int exit_code = 0;
+    struct elasticurl_connection_config connection_config = {
+        .bootstrap = bootstrap,
+        .socket_options = &socket_options,
+        .tls_options = tls_options,
+        .host = app_ctx.uri.host_name,
+        .port = port,
+    };
+    if (app_ctx.is_load_mode) {
+        exit_code = elasticurl_run_load(&app_ctx, &connection_config);
+    } else if (app_ctx.download.parallel) {
+        exit_code = elasticurl_run_parallel_download(&app_ctx, &connection_config);
+    } else {
+        aws_http_client_connect(&http_client_options);
+        aws_mutex_lock(&app_ctx.mutex);
+        aws_condition_variable_wait_pred(&app_ctx.c_var, &app_ctx.mutex, s_completion_predicate, &app_ctx);
+        aws_mutex_unlock(&app_ctx.mutex);
+    }
 
     aws_client_bootstrap_release(bootstrap);
     aws_host_resolver_release(resolver);
@@ -777,5 +886,5 @@ int main(int argc, char **argv) {
 
     aws_hash_table_clean_up(&app_ctx.signing_context);
 
-    return 0;
+    return exit_code;
 }
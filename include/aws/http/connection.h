@@ -15,6 +15,8 @@ struct aws_socket_options;
 struct aws_socket_endpoint;
 struct aws_tls_connection_options;
 struct aws_http2_setting;
+struct aws_http_headers;
+struct aws_http_connection_memory_tracker;
 struct proxy_env_var_settings;
 
 /**
@@ -134,6 +136,25 @@ struct aws_http_connection_monitoring_options {
      */
     uint32_t allowable_throughput_failure_interval_seconds;
 
+    /**
+     * Optional. If a request waits longer than this, after being sent, for the first byte of its response,
+     * the connection is shut down with AWS_ERROR_HTTP_CHANNEL_LATENCY_FAILURE. 0 disables the check.
+     */
+    uint64_t maximum_first_byte_latency_ms;
+
+    /**
+     * Optional, HTTP/2 only. If a PING takes longer than this to be acknowledged, the connection is shut down with
+     * AWS_ERROR_HTTP_CHANNEL_LATENCY_FAILURE. 0 disables the check.
+     * The connection doesn't send PINGs on its own, see aws_http2_connection_ping().
+     */
+    uint64_t maximum_ping_rtt_ms;
+
+    /**
+     * Optional, HTTP/2 only. If DATA is blocked by the peer's connection or stream flow-control window for longer
+     * than this, the connection is shut down with AWS_ERROR_HTTP_CHANNEL_WINDOW_STALL_FAILURE. 0 disables the check.
+     */
+    uint64_t maximum_window_stall_ms;
+
     /**
      * invoked on each statistics publish by the underlying IO channel. Install this callback to receive the statistics
      * for observation. This field is optional.
@@ -163,6 +184,90 @@ struct aws_http1_connection_options {
      * A capacity that is too big may waste memory without helping throughput.
      */
     size_t read_buffer_capacity;
+
+    /**
+     * Optional.
+     * If greater than the read buffer's capacity, the connection auto-sizes its read buffer
+     * (and therefore its read window).
+     * Capacity doubles, up to this limit, each time the socket fills the whole window
+     * while the HTTP-stream is keeping up with the data (throughput is limited by the window).
+     * Capacity halves, back down towards `read_buffer_capacity` (or the default capacity),
+     * each time the connection goes idle with nothing left to read.
+     * This lets bulk downloads use a big window, without every idle keep-alive connection holding one.
+     *
+     * Ignored if `manual_window_management` is false.
+     * If zero is specified (the default) then the capacity is fixed.
+     */
+    size_t max_read_buffer_capacity;
+
+    /**
+     * Optional.
+     * If true, each header-block received on a stream is delivered via a single
+     * on_response_headers (or on_request_headers) callback with every header in the block.
+     * Otherwise (the default), the callback is invoked once per header.
+     * The headers point directly into the received data, which the connection holds onto
+     * until the header-block is delivered, so headers are not copied.
+     * Only headers split across multiple reads from the socket get copied.
+     */
+    bool deliver_whole_header_blocks;
+
+    /**
+     * Optional.
+     * Client-only. If non-zero, requests with an "Expect: 100-continue" header hold their body
+     * after sending the head, until the server responds with "100 Continue",
+     * or this many milliseconds pass without a response.
+     * If a final response (ex: 403, 307, 413) arrives instead, the body is never sent.
+     * A chunked body is ended with the last-chunk, and the connection stays open.
+     * A body with a Content-Length can't be cut short, so the connection closes after the response.
+     *
+     * If zero is specified (the default) then the body is sent right after the head,
+     * and the "Expect" header is treated like any other.
+     */
+    uint64_t expect_continue_timeout_ms;
+
+    /**
+     * Optional.
+     * Max number of aws_io_messages the connection may have sent down the channel
+     * that haven't finished writing to the network yet.
+     * With more than one, the connection encodes its next message while the socket is still sending
+     * the previous one, so a single connection on a fast link isn't left waiting on each write.
+     * Each message in flight holds up to one full message (see g_aws_channel_max_fragment_size) of memory.
+     *
+     * If zero is specified (the default) then 1 is used,
+     * and each message finishes writing before the next is sent.
+     */
+    size_t max_write_messages_in_flight;
+
+    /**
+     * Optional.
+     * Client-only. Requests are pipelined (RFC-7230 6.3.2): each one is written as soon as the one before it
+     * has been sent, without waiting for its response, and responses are matched to requests in order.
+     * If non-zero, at most this many requests are written ahead of their responses,
+     * and the next one waits until the oldest response completes.
+     * A request whose method isn't idempotent (anything but GET, HEAD, OPTIONS, TRACE, PUT and DELETE)
+     * isn't pipelined then: it waits for every response before it, and the requests after it wait for its response.
+     * If the connection closes mid-pipeline, requests that were written complete with the connection's error,
+     * as the server may have acted on them. Requests that weren't written at all complete with
+     * AWS_ERROR_HTTP_REQUEST_NOT_SENT, and are safe to retry on another connection.
+     *
+     * If zero is specified (the default) then requests are pipelined without a limit, whatever their method,
+     * and every request left complete with the connection's error if it closes.
+     */
+    size_t max_pipelined_requests;
+
+    /**
+     * Optional.
+     * If true, once a message's head is decoded and its body framing is known, each read from the socket
+     * that lies entirely within the body (or within the current chunk of a chunked body) is handed straight
+     * to the stream's on_incoming_body callback, without queueing it in the read buffer first.
+     * While that goes on, the connection's read window is only incremented once half of it has been used,
+     * rather than after every read, which saves work on very large downloads.
+     * Reads that straddle the end of the body, or arrive while the stream's window can't take all of them,
+     * are decoded as usual. Streams using on_incoming_body_lease are always decoded as usual.
+     *
+     * If false (the default), every read is queued and decoded, and the window is incremented after each.
+     */
+    bool bulk_body_passthrough;
 };
 
 /**
@@ -201,7 +306,7 @@ struct aws_http2_connection_options {
      * the frame will be ignored or cause a connection error,
      * depending on the frame type and how the stream was closed.
      * Remembering more streams reduces the chances that a late frame causes
-     * a connection error, but costs some memory.
+     * a connection error, but costs some memory (8 bytes per stream, allocated up front).
      */
     size_t max_closed_streams;
 
@@ -238,6 +343,112 @@ struct aws_http2_connection_options {
      * But, the client will always automatically update the window for padding even for manual window update.
      */
     bool conn_manual_window_management;
+
+    /**
+     * Optional.
+     * Max number of microseconds the connection may wait before writing newly queued frames.
+     * Set it to zero (the default) to start writing as soon as there's something to send.
+     *
+     * If non-zero, frames queued while the connection is idle (HEADERS, WINDOW_UPDATE, SETTINGS ACK, etc)
+     * are held until the delay passes, so that frames from a burst of activity coalesce into
+     * fewer, fuller aws_io_messages. This trades a little latency for fewer TLS records and syscalls.
+     * The delay only applies when nothing is currently being written. While a write is in flight,
+     * frames are already batched until it completes.
+     */
+    uint32_t write_coalescing_delay_us;
+
+    /**
+     * Optional.
+     * Max number of aws_io_messages the connection may have sent down the channel
+     * that haven't finished writing to the network yet.
+     * Works like aws_http1_connection_options.max_write_messages_in_flight.
+     * The aws_io_message carrying a zero-copy DATA payload (see aws_http2_stream_write_data_options.data_buffer)
+     * doesn't count against this, it's sent along with the message holding its frame prefix.
+     *
+     * If zero is specified (the default) then 1 is used.
+     */
+    size_t max_write_messages_in_flight;
+
+    /**
+     * Optional.
+     * Set non-zero to automatically grow the flow-control windows of streams, up to this many bytes.
+     * Ignored if the connection is using manual window management for streams.
+     *
+     * Without this, stream windows stay at their initial size (SETTINGS_INITIAL_WINDOW_SIZE),
+     * which caps each stream's download rate at roughly window/round-trip-time.
+     * With this, the connection estimates the bandwidth-delay product by sending a PING
+     * and counting the DATA bytes received before its ACK arrives.
+     * Whenever the peer comes close to filling a stream's window within one round-trip,
+     * the window is doubled (via WINDOW_UPDATE), until this ceiling is reached.
+     * The ceiling applies to each stream, not the connection as a whole: with N streams receiving at once,
+     * the peer may have up to N times this many bytes in flight. Budget memory accordingly,
+     * or limit it with SETTINGS_MAX_CONCURRENT_STREAMS.
+     */
+    uint32_t stream_window_auto_tuning_max_size;
+
+    /**
+     * Optional.
+     * If true, each header-block received on a stream is delivered via a single
+     * on_response_headers callback with every header in the block.
+     * Otherwise (the default), on_response_headers may be invoked once per header.
+     * The headers are collected into memory that the connection reuses from block to block,
+     * so this costs no extra allocations once the connection has warmed up.
+     */
+    bool deliver_whole_header_blocks;
+
+    /**
+     * Optional.
+     * Header-fields expected in most requests sent on this connection
+     * (ex: user-agent, accept, content-type). A reference is acquired, so the caller may release theirs.
+     * When an outgoing request contains a header matching one of these (same name and value),
+     * the HPACK encoder reuses work it cached for that header, instead of searching its tables
+     * and re-encoding the strings. Headers that don't match are encoded normally,
+     * and the encoded bytes sent to the peer are the same either way.
+     */
+    struct aws_http_headers *header_template;
+
+    /**
+     * Optional.
+     * Set true to let the HPACK encoder skip indexing header-fields whose values rarely repeat
+     * (ex: request-id, signature), so they don't evict entries that would have been reused.
+     * Such fields are sent as literals without indexing instead.
+     * If false (the default), every header-field that permits indexing is inserted into the dynamic table.
+     */
+    bool hpack_indexing_policy;
+
+    /**
+     * Optional.
+     * Set non-zero to let the connection adjust the SETTINGS_HEADER_TABLE_SIZE it sends to the peer,
+     * up to this many bytes, based on how the peer's HPACK encoder is using the table.
+     * Ignored if initial_settings_array contains SETTINGS_HEADER_TABLE_SIZE = 0.
+     *
+     * Every so many header-blocks received, the connection checks whether entries were evicted
+     * from the table and soon needed again (the table is too small, so it's doubled),
+     * or whether the table stayed mostly empty (it's halved, freeing memory), and sends a new SETTINGS frame.
+     * Most connections need far less than the default 4096 bytes, while busy ones can gain from more.
+     */
+    uint32_t header_table_adaptive_max_size;
+
+    /**
+     * Optional.
+     * The SETTINGS_HEADER_TABLE_SIZE never goes below this while adapting.
+     * Ignored unless header_table_adaptive_max_size is set.
+     */
+    uint32_t header_table_adaptive_min_size;
+
+    /**
+     * Optional.
+     * Set non-zero to send and receive DATA frames up to this many bytes when a stream is transferring in bulk.
+     * It's clamped to the bounds of SETTINGS_MAX_FRAME_SIZE, 16384 to 16777215.
+     *
+     * Unless initial_settings_array already contains SETTINGS_MAX_FRAME_SIZE,
+     * it is advertised to the peer with this value so the peer may send larger frames too.
+     * Outgoing DATA frames use the peer's SETTINGS_MAX_FRAME_SIZE, up to this value, while a single stream
+     * has data to send. Once several streams have data to send, frames stay at the default 16384 bytes
+     * so the streams keep taking turns at a fine grain.
+     * Fewer, larger frames cut per-frame overhead for both sides of a big transfer.
+     */
+    uint32_t bulk_data_max_frame_size;
 };
 
 /**
@@ -369,6 +580,18 @@ struct aws_http_client_connection_options {
      */
     bool prior_knowledge_http2;
 
+    /**
+     * Optional.
+     * When true, try to upgrade a cleartext connection to HTTP/2 (RFC7540 3.2).
+     * Before on_setup is invoked, an `OPTIONS *` request carrying `Upgrade: h2c` and the
+     * HTTP2-Settings from `http2_options` is sent. If the server answers "101 Switching Protocols",
+     * on_setup receives an HTTP/2 connection multiplexed over the same socket.
+     * Otherwise, on_setup receives the HTTP/1.1 connection once the response is complete.
+     * Cannot be combined with TLS, `prior_knowledge_http2`, or `proxy_options`.
+     * Connections made through a proxy found in the environment stay HTTP/1.1.
+     */
+    bool http2_upgrade;
+
     /**
      * Optional.
      * Pointer to the hash map containing the ALPN string to protocol to use.
@@ -407,6 +630,34 @@ struct aws_http_client_connection_options {
      * Host resolution override that allows the user to override DNS behavior for this particular connection.
      */
     const struct aws_host_resolution_config *host_resolution_config;
+
+    /**
+     * Internal. Set by the connection manager, leave NULL.
+     * The connection adds its memory usage to these totals for as long as it lives,
+     * see aws_http_connection_manager_fetch_memory_usage().
+     */
+    struct aws_http_connection_memory_tracker *memory_tracker;
+};
+
+/**
+ * Bytes of memory a connection is holding onto, by what they're for.
+ * These are the buffers that grow with traffic, not the fixed size of the connection and stream objects.
+ * See aws_http_connection_get_memory_usage().
+ */
+struct aws_http_connection_memory_usage {
+    /* Decoder buffers for data that spans aws_io_messages (HTTP/1 lines, HTTP/2 frame fields and HPACK strings) */
+    size_t decoder_scratch;
+    /* HTTP/2 only. HPACK dynamic tables, for both encoding and decoding */
+    size_t hpack_tables;
+    /* Outgoing data waiting to be written: HTTP/2 frames, HTTP/1 message heads and chunks */
+    size_t outgoing_queue;
+    /* Received headers and other incoming data kept around until it can be delivered */
+    size_t buffered_headers;
+    /* HTTP/1 only. Bytes received, but not processed yet because a stream's window is closed.
+     * HTTP/2 delivers data as it arrives, and relies on flow control to bound it */
+    size_t unconsumed_reads;
+    /* HTTP/2 only. Memory from freed frames, kept to build the next ones without allocating */
+    size_t frame_cache;
 };
 
 /* Predefined settings identifiers (RFC-7540 6.5.2) */
@@ -418,7 +669,9 @@ enum aws_http2_settings_id {
     AWS_HTTP2_SETTINGS_INITIAL_WINDOW_SIZE = 0x4,
     AWS_HTTP2_SETTINGS_MAX_FRAME_SIZE = 0x5,
     AWS_HTTP2_SETTINGS_MAX_HEADER_LIST_SIZE = 0x6,
-    AWS_HTTP2_SETTINGS_END_RANGE, /* End of known values */
+    AWS_HTTP2_SETTINGS_END_RANGE, /* End of known values from RFC-7540 */
+    /* RFC-8441 3. Outside the range above, which keeps its size. 0x7 is unassigned */
+    AWS_HTTP2_SETTINGS_ENABLE_CONNECT_PROTOCOL = 0x8,
 };
 
 /* A HTTP/2 setting and its value, used in SETTINGS frame */
@@ -427,6 +680,22 @@ struct aws_http2_setting {
     uint32_t value;
 };
 
+/**
+ * HTTP/2: Smoothed estimate of a connection's round-trip time. See aws_http2_connection_get_rtt_estimate().
+ */
+struct aws_http2_rtt_estimate {
+    /* Smoothed round-trip time (SRTT), the way TCP smooths it (RFC-6298) */
+    uint64_t smoothed_rtt_ns;
+    /* Smoothed mean deviation of the samples from smoothed_rtt_ns (RTTVAR) */
+    uint64_t rtt_variation_ns;
+    /* Smallest sample seen */
+    uint64_t min_rtt_ns;
+    /* Most recent sample */
+    uint64_t latest_rtt_ns;
+    /* Number of samples taken */
+    uint64_t sample_count;
+};
+
 /**
  * HTTP/2: Default value for max closed streams we will keep in memory.
  */
@@ -438,7 +707,10 @@ struct aws_http2_setting {
 #define AWS_HTTP2_PING_DATA_SIZE (8)
 
 /**
- * HTTP/2: The number of known settings.
+ * HTTP/2: The number of settings in the arrays filled by aws_http2_connection_get_local_settings()
+ * and aws_http2_connection_get_remote_settings(). These are the settings from RFC-7540, in order of id,
+ * so a setting's index is its id minus one.
+ * Settings defined later have getters of their own, see aws_http2_connection_get_remote_enable_connect_protocol().
  */
 #define AWS_HTTP2_SETTINGS_COUNT (6)
 
@@ -521,6 +793,16 @@ struct aws_channel *aws_http_connection_get_channel(struct aws_http_connection *
 AWS_HTTP_API
 const struct aws_socket_endpoint *aws_http_connection_get_remote_endpoint(const struct aws_http_connection *connection);
 
+/**
+ * Get the bytes of memory the connection is currently holding onto.
+ * This may be called from any thread. The values are updated by the connection's thread as it reads and writes,
+ * so they may be slightly behind.
+ */
+AWS_HTTP_API
+void aws_http_connection_get_memory_usage(
+    const struct aws_http_connection *connection,
+    struct aws_http_connection_memory_usage *out_usage);
+
 /**
  * Initialize an map copied from the *src map, which maps `struct aws_string *` to `enum aws_http_version`.
  */
@@ -581,6 +863,21 @@ int aws_http2_connection_ping(
     aws_http2_on_ping_complete_fn *on_completed,
     void *user_data);
 
+/**
+ * Get the connection's round-trip time estimate (HTTP/2 only).
+ * The connection takes a sample whenever a PING it sent, or a SETTINGS frame it sent, is acknowledged by the peer.
+ * That includes the connection's initial SETTINGS, so an estimate is usually available soon after setup.
+ * Safe to call from any thread.
+ * If no sample has been taken yet, AWS_ERROR_HTTP_DATA_NOT_AVAILABLE will be raised.
+ *
+ * @param http2_connection HTTP/2 connection.
+ * @param out_estimate Gets set to the current estimate.
+ */
+AWS_HTTP_API
+int aws_http2_connection_get_rtt_estimate(
+    const struct aws_http_connection *http2_connection,
+    struct aws_http2_rtt_estimate *out_estimate);
+
 /**
  * Get the local settings we are using to affect the decoding.
  *
@@ -603,6 +900,25 @@ void aws_http2_connection_get_remote_settings(
     const struct aws_http_connection *http2_connection,
     struct aws_http2_setting out_settings[AWS_HTTP2_SETTINGS_COUNT]);
 
+/**
+ * Get whether we have enabled the extended CONNECT method (SETTINGS_ENABLE_CONNECT_PROTOCOL, RFC-8441 3).
+ *
+ * @param http2_connection HTTP/2 connection.
+ * @return true if the local SETTINGS_ENABLE_CONNECT_PROTOCOL is 1.
+ */
+AWS_HTTP_API
+bool aws_http2_connection_get_local_enable_connect_protocol(const struct aws_http_connection *http2_connection);
+
+/**
+ * Get whether the remote peer has enabled the extended CONNECT method (SETTINGS_ENABLE_CONNECT_PROTOCOL, RFC-8441 3).
+ * A request with the :protocol pseudo-header can only be sent once this is true.
+ *
+ * @param http2_connection HTTP/2 connection.
+ * @return true if the SETTINGS_ENABLE_CONNECT_PROTOCOL received from the peer is 1.
+ */
+AWS_HTTP_API
+bool aws_http2_connection_get_remote_enable_connect_protocol(const struct aws_http_connection *http2_connection);
+
 /**
  * Send a custom GOAWAY frame (HTTP/2 only).
  *
@@ -13,12 +13,14 @@
 AWS_PUSH_SANE_WARNING_LEVEL
 
 struct aws_client_bootstrap;
+struct aws_host_resolution_config;
 struct aws_http_connection;
 struct aws_http_connection_manager;
 struct aws_socket_options;
 struct aws_tls_connection_options;
 struct proxy_env_var_settings;
 struct aws_http2_setting;
+struct aws_http_headers;
 
 typedef void(aws_http_connection_manager_on_connection_setup_fn)(
     struct aws_http_connection *connection,
@@ -27,6 +29,24 @@ typedef void(aws_http_connection_manager_on_connection_setup_fn)(
 
 typedef void(aws_http_connection_manager_shutdown_complete_fn)(void *user_data);
 
+/**
+ * Which idle connection the manager vends to an acquisition.
+ */
+enum aws_http_connection_manager_idle_selection {
+    /**
+     * Default.
+     * Most recently used first. Traffic concentrates on as few connections as it needs, which keep their large
+     * congestion windows and warm TLS state, while the rest stay idle long enough to be culled
+     * (see max_connection_idle_in_milliseconds), which also frees their memory.
+     */
+    AWS_HCMIS_MRU = 0,
+    /**
+     * Least recently used first. Traffic is spread evenly over every open connection, so connections are only
+     * culled once traffic drops off entirely.
+     */
+    AWS_HCMIS_LRU,
+};
+
 /**
  * Metrics for logging and debugging purpose.
  */
@@ -42,8 +62,54 @@ struct aws_http_manager_metrics {
     size_t available_concurrency;
     /* The number of requests that are awaiting concurrency to be made available from the HTTP manager. */
     size_t pending_concurrency_acquires;
-    /* The number of connections (http/1.1) or streams (for h2 via. stream manager) currently vended to user. */
+    /* The number of connections (http/1.1) or streams (for h2 via. stream manager) currently vended to user. A
+     * multiplexed HTTP/2 connection counts once per lease (see max_http2_leases_per_connection). */
     size_t leased_concurrency;
+    /*
+     * Connection manager only, always 0 for stream manager.
+     * The number of acquisitions served by a connection that was opened before anything needed it, by
+     * min_idle_connections or aws_http_connection_manager_prewarm(), so they didn't wait on connection setup.
+     */
+    size_t prewarmed_acquires;
+};
+
+/* The number of buckets in struct aws_http_manager_histogram */
+#define AWS_HTTP_MANAGER_HISTOGRAM_BUCKET_COUNT 272
+
+/**
+ * A distribution of durations, in microseconds.
+ *
+ * Buckets are log-linear: durations under 8us get a bucket each, and every power of 2 above that is split into 8
+ * buckets, so a bucket is at most 12.5% wide. Bucket i holds durations from
+ * aws_http_manager_histogram_get_bucket_lower_bound(i) up to the next bucket's lower bound. The last bucket also
+ * holds every longer duration (from about 18 hours).
+ */
+struct aws_http_manager_histogram {
+    uint64_t buckets[AWS_HTTP_MANAGER_HISTOGRAM_BUCKET_COUNT];
+    /* The number of durations recorded, the sum of all buckets */
+    uint64_t count;
+    /* The sum of all durations recorded */
+    uint64_t sum_us;
+};
+
+/**
+ * Latency distributions recorded by an HTTP manager since it was created.
+ */
+struct aws_http_manager_latency_metrics {
+    /*
+     * From an acquisition being made to it being handed its connection (or stream, for stream manager). Acquisitions
+     * that fail aren't recorded. Acquisitions served by an idle connection right away are, as ~0.
+     */
+    struct aws_http_manager_histogram acquisition_wait;
+    /*
+     * From asking for a new connection to it being set up: host resolution, TCP connect, TLS negotiation and
+     * proxy CONNECT, all together, as these all happen below the HTTP layer.
+     */
+    struct aws_http_manager_histogram connection_setup;
+    /* HTTP/2 only. From a new connection being set up to the peer acknowledging our initial SETTINGS. */
+    struct aws_http_manager_histogram http2_settings;
+    /* From a connection being set up to it shutting down */
+    struct aws_http_manager_histogram connection_lifetime;
 };
 
 /*
@@ -65,8 +131,12 @@ struct aws_http_connection_manager_options {
      * For secure connections, set "h2" in the ALPN string for HTTP/2, otherwise HTTP/1.1 is used.
      *
      * Leave NULL to create cleartext (HTTP) connections.
-     * For cleartext connections, use `http2_prior_knowledge` (RFC-7540 3.4)
+     * For cleartext connections, use `http2_prior_knowledge` (RFC-7540 3.4) or `http2_upgrade` (RFC-7540 3.2)
      * to control whether that are treated as HTTP/1.1 or HTTP/2.
+     *
+     * Every connection is negotiated with the aws_tls_ctx of these options. TLS session resumption, where the TLS
+     * implementation supports it, is kept in that context, so managers that should resume each other's sessions
+     * (for the same host and ALPN) need to share one aws_tls_ctx.
      */
     const struct aws_tls_connection_options *tls_connection_options;
 
@@ -74,10 +144,17 @@ struct aws_http_connection_manager_options {
      * Specify whether you have prior knowledge that cleartext (HTTP) connections are HTTP/2 (RFC-7540 3.4).
      * If false, then cleartext connections are treated as HTTP/1.1.
      * It is illegal to set this true when secure connections are being used.
-     * Note that upgrading from HTTP/1.1 to HTTP/2 is not supported (RFC-7540 3.2).
      */
     bool http2_prior_knowledge;
 
+    /**
+     * Try to upgrade each cleartext (HTTP) connection from HTTP/1.1 to HTTP/2 (RFC-7540 3.2).
+     * Connections whose server declines the upgrade stay HTTP/1.1.
+     * See `aws_http_client_connection_options.http2_upgrade`.
+     * It is illegal to set this true when secure connections are being used, or with `http2_prior_knowledge`.
+     */
+    bool http2_upgrade;
+
     const struct aws_http_connection_monitoring_options *monitoring_options;
     struct aws_byte_cursor host;
     uint16_t port;
@@ -90,6 +167,7 @@ struct aws_http_connection_manager_options {
     size_t num_initial_settings;
     size_t max_closed_streams;
     bool http2_conn_manual_window_management;
+    struct aws_http_headers *http2_header_template;
 
     /* Proxy configuration for http connection */
     const struct aws_http_proxy_options *proxy_options;
@@ -101,6 +179,16 @@ struct aws_http_connection_manager_options {
      */
     const struct proxy_env_var_settings *proxy_ev_settings;
 
+    /**
+     * Optional.
+     * Host resolution override used by every connection the manager creates, see
+     * `struct aws_http_client_connection_options`. The resolver hands each new connection the least recently used
+     * address of the host, so connections spread across all the addresses it has resolved, and addresses that fail
+     * to connect are deprioritized. Use max_ttl to control how long addresses are kept, and so how many of them each
+     * resolution accumulates.
+     */
+    const struct aws_host_resolution_config *host_resolution_config;
+
     /*
      * Maximum number of connections this manager is allowed to contain
      */
@@ -122,8 +210,106 @@ struct aws_http_connection_manager_options {
     /**
      * If set to a non-zero value, then connections that stay in the pool longer than the specified
      * timeout will be closed automatically.
+     * With a tunneling proxy that sends "Keep-Alive: timeout=N" on its CONNECT response, a connection is closed
+     * about a second before the N seconds are up if that's sooner, so the manager doesn't vend a tunnel the
+     * proxy already dropped.
      */
     uint64_t max_connection_idle_in_milliseconds;
+
+    /**
+     * If set to true, idle connections are pooled per event loop of the bootstrap's event loop group,
+     * each pool with its own lock, so acquiring an idle connection and releasing a connection that's
+     * still usable don't take the manager's lock.
+     * An acquire takes from the pool of the caller's event loop first, then from the other pools,
+     * and only waits in the manager's queue (and creates new connections) once every pool is empty.
+     * max_connections is enforced across all pools.
+     */
+    bool enable_event_loop_shards;
+
+    /**
+     * If set to a non-zero value, the manager opens connections ahead of demand so that at least this many are
+     * idle (or being set up) once the pending acquisitions are served. It starts as soon as the manager is created,
+     * and idle culling never takes the pool below this size.
+     * Must not be greater than max_connections.
+     */
+    size_t min_idle_connections;
+
+    /**
+     * Which idle connection an acquisition gets, see aws_http_connection_manager_idle_selection.
+     * Defaults to AWS_HCMIS_MRU.
+     */
+    enum aws_http_connection_manager_idle_selection idle_selection;
+
+    /**
+     * If set to a non-zero value, an acquisition that waits longer than this for a connection fails with
+     * AWS_ERROR_HTTP_CONNECTION_MANAGER_ACQUISITION_TIMEOUT.
+     * Acquisitions served right away from the idle pool never wait.
+     */
+    uint64_t connection_acquisition_timeout_ms;
+
+    /**
+     * If set to a non-zero value, an acquisition that would have to wait while this many acquisitions are already
+     * waiting fails right away with AWS_ERROR_HTTP_CONNECTION_MANAGER_MAX_PENDING_ACQUISITIONS_EXCEEDED.
+     */
+    size_t max_pending_connection_acquisitions;
+
+    /**
+     * If set to a non-zero value, an HTTP/2 connection (negotiated with ALPN, or with http2_prior_knowledge) is
+     * leased to up to this many acquisitions at once, capped by the peer's SETTINGS_MAX_CONCURRENT_STREAMS, instead
+     * of one. Each acquisition gets the same connection and releases it as usual. The connection counts once against
+     * max_connections, and only goes back to the idle pool once every lease is released.
+     * With http2_prior_knowledge, a burst of acquisitions opens one connection per this many acquisitions.
+     * Each lease is meant for one stream at a time. For more control over streams, see aws_http2_stream_manager.
+     * HTTP/1.1 connections are unaffected.
+     * Cannot be used with enable_event_loop_shards.
+     */
+    size_t max_http2_leases_per_connection;
+
+    /**
+     * If set to a non-zero value, the most bytes of response data the manager's connections may have in their read
+     * windows, or read and not yet consumed, all together.
+     * Connections only grow their windows while the budget has room. Once it runs out, each connection is still
+     * allowed an equal share, so one slow consumer can't starve the rest.
+     * A connection's initial window is always granted, even if that goes over the budget.
+     * For HTTP/1.1 this only applies with enable_read_back_pressure. For HTTP/2 it applies to the connection's
+     * flow-control window, unless http2_conn_manual_window_management is set, and data for streams with
+     * enable_read_back_pressure counts until the user updates the stream's window.
+     */
+    size_t read_window_budget;
+};
+
+/**
+ * Options for aws_http_connection_manager_acquire_connection_with_options()
+ */
+struct aws_http_connection_manager_acquire_connection_options {
+    /**
+     * Required.
+     * Invoked once the connection is acquired, or the acquisition fails.
+     */
+    aws_http_connection_manager_on_connection_setup_fn *callback;
+
+    /**
+     * Optional.
+     * User data for the callback.
+     */
+    void *user_data;
+
+    /**
+     * Optional.
+     * The event loop the connection's channel should live on, usually the caller's, so that requests made on the
+     * connection don't hop threads. Must be one of the event loops of the manager's bootstrap.
+     * An idle connection on this event loop is vended first, and new connections for this acquisition are created
+     * on it.
+     */
+    struct aws_event_loop *event_loop;
+
+    /**
+     * If set to true, only a connection on event_loop is vended. The acquisition waits for one, even while idle
+     * connections on other event loops exist, and the manager may close those to make room under max_connections.
+     * If false, any connection is vended when none on event_loop is idle.
+     * Ignored if event_loop is NULL.
+     */
+    bool require_event_loop;
 };
 
 AWS_EXTERN_C_BEGIN
@@ -172,6 +358,23 @@ void aws_http_connection_manager_acquire_connection(
     aws_http_connection_manager_on_connection_setup_fn *callback,
     void *user_data);
 
+/*
+ * Same as aws_http_connection_manager_acquire_connection(), with options to ask for a connection on a particular
+ * event loop. See aws_http_connection_manager_acquire_connection_options.
+ */
+AWS_HTTP_API
+void aws_http_connection_manager_acquire_connection_with_options(
+    struct aws_http_connection_manager *manager,
+    const struct aws_http_connection_manager_acquire_connection_options *options);
+
+/*
+ * Opens up to num_connections new connections ahead of demand, so that later acquisitions don't wait on DNS, TCP
+ * and TLS setup.  New connections never take the manager past max_connections.  They go idle once set up,
+ * and are culled like any other idle connection.
+ */
+AWS_HTTP_API
+void aws_http_connection_manager_prewarm(struct aws_http_connection_manager *manager, size_t num_connections);
+
 /*
  * Returns a connection back to the manager.  All acquired connections must
  * eventually be released back to the manager in order to avoid a resource leak.
@@ -191,6 +394,40 @@ void aws_http_connection_manager_fetch_metrics(
     const struct aws_http_connection_manager *manager,
     struct aws_http_manager_metrics *out_metrics);
 
+/**
+ * Fetch the latency distributions the connection manager has recorded.
+ * Recording is lock-free, so this may miss durations being recorded at the same time.
+ */
+AWS_HTTP_API
+void aws_http_connection_manager_fetch_latency_metrics(
+    const struct aws_http_connection_manager *manager,
+    struct aws_http_manager_latency_metrics *out_metrics);
+
+/**
+ * Fetch the memory held by the connection manager's connections, summed over every connection it has open
+ * (idle, vended, or shutting down). See aws_http_connection_get_memory_usage().
+ */
+AWS_HTTP_API
+void aws_http_connection_manager_fetch_memory_usage(
+    const struct aws_http_connection_manager *manager,
+    struct aws_http_connection_memory_usage *out_usage);
+
+/**
+ * Returns the smallest duration, in microseconds, that bucket_index of struct aws_http_manager_histogram holds.
+ */
+AWS_HTTP_API
+uint64_t aws_http_manager_histogram_get_bucket_lower_bound(size_t bucket_index);
+
+/**
+ * Returns an upper bound, in microseconds, on the given percentile (0 to 100) of the durations in the histogram.
+ * It's the largest duration of the bucket the percentile falls in, so it's at most 12.5% over the actual value.
+ * Returns 0 for an empty histogram.
+ */
+AWS_HTTP_API
+uint64_t aws_http_manager_histogram_get_percentile(
+    const struct aws_http_manager_histogram *histogram,
+    double percentile);
+
 AWS_EXTERN_C_END
 AWS_POP_SANE_WARNING_LEVEL
 
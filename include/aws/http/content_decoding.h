@@ -0,0 +1,96 @@
+#ifndef AWS_HTTP_CONTENT_DECODING_H
+#define AWS_HTTP_CONTENT_DECODING_H
+
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/http.h>
+
+AWS_PUSH_SANE_WARNING_LEVEL
+
+struct aws_http_content_decoder;
+
+struct aws_http_content_decoder_vtable {
+    /**
+     * Decode from `encoded`, advancing it past what was consumed, and append to `decoded` without growing it.
+     * Decode as much as fits, output that doesn't fit yet is produced by the next call.
+     * Each call must consume input or produce output, unless `encoded` is empty.
+     * Return AWS_OP_ERR if the data can't be decoded.
+     */
+    int (*decode)(
+        struct aws_http_content_decoder *decoder,
+        struct aws_byte_cursor *encoded,
+        struct aws_byte_buf *decoded);
+
+    /**
+     * The body has ended. Return AWS_OP_ERR if the encoded data ended early.
+     */
+    int (*finish)(struct aws_http_content_decoder *decoder);
+
+    void (*destroy)(struct aws_http_content_decoder *decoder);
+};
+
+/**
+ * Decodes one content-coding (gzip, br, zstd, ...) of a response body.
+ * The library doesn't ship any codecs, the user provides them via aws_http_content_decoding_options.
+ */
+struct aws_http_content_decoder {
+    const struct aws_http_content_decoder_vtable *vtable;
+    struct aws_allocator *allocator;
+    void *impl;
+};
+
+/**
+ * Create a decoder for `content_coding`, a token from the response's Content-Encoding header.
+ * Tokens are compared case-insensitively (RFC-9110 8.4.1), "identity" is never passed.
+ * Return NULL if the coding isn't supported, raising AWS_ERROR_HTTP_UNSUPPORTED_CONTENT_ENCODING.
+ */
+typedef struct aws_http_content_decoder *(aws_http_content_decoder_new_fn)(
+    struct aws_allocator *allocator,
+    struct aws_byte_cursor content_coding,
+    void *user_data);
+
+/**
+ * Options for decoding response bodies as they arrive, see `content_decoding` in aws_http_make_request_options.
+ * If the response has a Content-Encoding header, the body is decoded before it's passed to `on_response_body`.
+ *
+ * When the connection uses manual window management, the stream's window is updated in terms of the decoded body.
+ * Update it by how much of the decoded body has been consumed, and the library credits the encoded bytes those
+ * came from.
+ *
+ * Only a single content-coding is supported, responses with several codings applied fail with
+ * AWS_ERROR_HTTP_UNSUPPORTED_CONTENT_ENCODING.
+ */
+struct aws_http_content_decoding_options {
+    /**
+     * Required.
+     * Creates a decoder for the response's content-coding.
+     */
+    aws_http_content_decoder_new_fn *new_decoder;
+
+    /**
+     * Optional.
+     * Passed to `new_decoder`.
+     */
+    void *user_data;
+
+    /**
+     * Optional.
+     * Value for the Accept-Encoding header, e.g. "gzip, br".
+     * Added to the request when it's made, unless the request already has an Accept-Encoding header.
+     */
+    struct aws_byte_cursor accept_encoding;
+
+    /**
+     * Optional.
+     * Size of the buffer decoded data is delivered from. The stream allocates it once, and reuses it.
+     * If 0, a default is used.
+     */
+    size_t decoded_buffer_size;
+};
+
+AWS_POP_SANE_WARNING_LEVEL
+
+#endif /* AWS_HTTP_CONTENT_DECODING_H */
@@ -0,0 +1,91 @@
+#ifndef AWS_HTTP_CONTENT_ENCODING_H
+#define AWS_HTTP_CONTENT_ENCODING_H
+
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/http.h>
+
+AWS_PUSH_SANE_WARNING_LEVEL
+
+struct aws_http_content_encoder;
+
+struct aws_http_content_encoder_vtable {
+    /**
+     * Encode from `unencoded`, advancing it past what was consumed, and append to `encoded` without growing it.
+     * Encode as much as fits, output that doesn't fit yet is produced by the next call.
+     * `is_end` is true once `unencoded` holds the last of the body. From then on, calls continue (with an empty
+     * `unencoded` once it's all consumed) until the encoder has written all its output and sets *out_is_complete.
+     * Each call must consume input or produce output, unless it completes.
+     * Return AWS_OP_ERR if the data can't be encoded.
+     */
+    int (*encode)(
+        struct aws_http_content_encoder *encoder,
+        struct aws_byte_cursor *unencoded,
+        bool is_end,
+        struct aws_byte_buf *encoded,
+        bool *out_is_complete);
+
+    void (*destroy)(struct aws_http_content_encoder *encoder);
+};
+
+/**
+ * Encodes a request body with one content-coding (gzip, zstd, ...) as it's sent.
+ * The library doesn't ship any codecs, the user provides them via aws_http_content_encoding_options.
+ */
+struct aws_http_content_encoder {
+    const struct aws_http_content_encoder_vtable *vtable;
+    struct aws_allocator *allocator;
+    void *impl;
+};
+
+/**
+ * Create an encoder for `content_coding`, see aws_http_content_encoding_options.
+ * Return NULL and raise an error on failure.
+ */
+typedef struct aws_http_content_encoder *(aws_http_content_encoder_new_fn)(
+    struct aws_allocator *allocator,
+    struct aws_byte_cursor content_coding,
+    void *user_data);
+
+/**
+ * Options for encoding a request body as it's sent, see `content_encoding` in aws_http_make_request_options.
+ *
+ * The request's body stream is read through the encoder, and the request is sent with a Content-Encoding header.
+ * The encoded length isn't known up front, so any Content-Length header isn't sent.
+ * HTTP/1.1 requests are sent with "Transfer-Encoding: chunked" instead, HTTP/2 requests just end with the body.
+ * This has no effect on requests without a body stream.
+ */
+struct aws_http_content_encoding_options {
+    /**
+     * Required.
+     * The content-coding, e.g. "gzip". Sent as the Content-Encoding header.
+     * The request must not have a Content-Encoding header already.
+     */
+    struct aws_byte_cursor content_coding;
+
+    /**
+     * Required.
+     * Creates an encoder for `content_coding`.
+     */
+    aws_http_content_encoder_new_fn *new_encoder;
+
+    /**
+     * Optional.
+     * Passed to `new_encoder`.
+     */
+    void *user_data;
+
+    /**
+     * Optional.
+     * Size of the buffer the body stream is read into before encoding. The stream allocates it once, and reuses it.
+     * If 0, a default is used.
+     */
+    size_t unencoded_buffer_size;
+};
+
+AWS_POP_SANE_WARNING_LEVEL
+
+#endif /* AWS_HTTP_CONTENT_ENCODING_H */
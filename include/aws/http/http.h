@@ -59,6 +59,19 @@ enum aws_http_errors {
     AWS_ERROR_HTTP_WEBSOCKET_PROTOCOL_ERROR,
     AWS_ERROR_HTTP_MANUAL_WRITE_NOT_ENABLED,
     AWS_ERROR_HTTP_MANUAL_WRITE_HAS_COMPLETED,
+    AWS_ERROR_HTTP_CONNECTION_MANAGER_ACQUISITION_TIMEOUT,
+    AWS_ERROR_HTTP_CONNECTION_MANAGER_MAX_PENDING_ACQUISITIONS_EXCEEDED,
+    AWS_ERROR_HTTP_WEBSOCKET_MESSAGE_TOO_BIG,
+    AWS_ERROR_HTTP_CHANNEL_LATENCY_FAILURE,
+    AWS_ERROR_HTTP_CHANNEL_WINDOW_STALL_FAILURE,
+    AWS_ERROR_HTTP_UNSUPPORTED_CONTENT_ENCODING,
+    AWS_ERROR_HTTP_CONTENT_DECODING_FAILED,
+    AWS_ERROR_HTTP_CONTENT_ENCODING_FAILED,
+    AWS_ERROR_HTTP_REQUEST_NOT_SENT,
+    AWS_ERROR_HTTP_SERVER_CONNECTION_LIMIT_REACHED,
+    AWS_ERROR_HTTP_SERVER_CONNECTION_TIMEOUT,
+    AWS_ERROR_HTTP_EXTENDED_CONNECT_NOT_SUPPORTED,
+    AWS_ERROR_HTTP_WEBSOCKET_MANAGER_SHUTTING_DOWN,
 
     AWS_ERROR_HTTP_END_RANGE = AWS_ERROR_ENUM_END_RANGE(AWS_C_HTTP_PACKAGE_ID)
 };
@@ -94,6 +107,7 @@ enum aws_http_log_subject {
     AWS_LS_HTTP_WEBSOCKET,
     AWS_LS_HTTP_WEBSOCKET_SETUP,
     AWS_LS_HTTP_PROXY_NEGOTIATION,
+    AWS_LS_HTTP_WEBSOCKET_MANAGER,
 };
 
 enum aws_http_version {
@@ -151,6 +165,7 @@ AWS_HTTP_API extern const struct aws_byte_cursor aws_http_header_scheme;
 AWS_HTTP_API extern const struct aws_byte_cursor aws_http_header_authority;
 AWS_HTTP_API extern const struct aws_byte_cursor aws_http_header_path;
 AWS_HTTP_API extern const struct aws_byte_cursor aws_http_header_status;
+AWS_HTTP_API extern const struct aws_byte_cursor aws_http_header_protocol;
 
 AWS_HTTP_API extern const struct aws_byte_cursor aws_http_scheme_http;
 AWS_HTTP_API extern const struct aws_byte_cursor aws_http_scheme_https;
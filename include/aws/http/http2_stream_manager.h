@@ -11,6 +11,7 @@
 AWS_PUSH_SANE_WARNING_LEVEL
 
 struct aws_http2_stream_manager;
+struct aws_http2_stream_manager_coalescing_group;
 struct aws_client_bootstrap;
 struct aws_http_connection;
 struct aws_http_connection_manager;
@@ -18,6 +19,7 @@ struct aws_socket_options;
 struct aws_tls_connection_options;
 struct proxy_env_var_settings;
 struct aws_http2_setting;
+struct aws_http_headers;
 struct aws_http_make_request_options;
 struct aws_http_stream;
 struct aws_http_manager_metrics;
@@ -38,6 +40,23 @@ typedef void(
  */
 typedef void(aws_http2_stream_manager_shutdown_complete_fn)(void *user_data);
 
+/**
+ * How the stream manager picks a connection for a new stream, among those with room for it.
+ * Either way, it compares two connections picked at random (power of two choices).
+ */
+enum aws_http2_stream_manager_connection_selection {
+    /**
+     * Picks the one with fewer streams. The default.
+     */
+    AWS_H2SM_CONNECTION_SELECTION_FEWEST_STREAMS,
+    /**
+     * Also weighs the bytes each connection still has to move: request bodies not yet finished, and response bodies
+     * not yet received according to their content-length. When connection_ping_period_ms is set, the load is scaled
+     * by the round trip time of each connection's last PING, so streams favor faster connections.
+     */
+    AWS_H2SM_CONNECTION_SELECTION_LEAST_LOADED,
+};
+
 /**
  * HTTP/2 stream manager configuration struct.
  *
@@ -57,6 +76,8 @@ struct aws_http2_stream_manager_options {
      *
      * To create cleartext (HTTP) connections, leave this NULL
      * and set `http2_prior_knowledge` (RFC-7540 3.4).
+     *
+     * As with aws_http_connection_manager, TLS session resumption is kept in the aws_tls_ctx of these options.
      */
     const struct aws_tls_connection_options *tls_connection_options;
 
@@ -86,6 +107,13 @@ struct aws_http2_stream_manager_options {
     size_t max_closed_streams;
     bool conn_manual_window_management;
 
+    /**
+     * Optional.
+     * Header-fields expected in most requests, passed to every connection the manager creates.
+     * See `header_template` in `struct aws_http2_connection_options`.
+     */
+    struct aws_http_headers *header_template;
+
     /**
      * HTTP/2 Stream window control.
      * If set to true, the read back pressure mechanism will be enabled for streams created.
@@ -127,6 +155,12 @@ struct aws_http2_stream_manager_options {
      */
     size_t connection_ping_timeout_ms;
 
+    /**
+     * Optional.
+     * How to pick a connection for a new stream. Defaults to AWS_H2SM_CONNECTION_SELECTION_FEWEST_STREAMS.
+     */
+    enum aws_http2_stream_manager_connection_selection connection_selection;
+
     /* TODO: More flexible policy about the connections, but will always has these three values below. */
     /**
      * Optional.
@@ -142,11 +176,63 @@ struct aws_http2_stream_manager_options {
      * other end and the value here.
      */
     size_t max_concurrent_streams_per_connection;
+    /**
+     * Optional.
+     * When set, each connection's stream limit adapts to how the server copes instead of staying at
+     * max_concurrent_streams_per_connection, which becomes the most it can grow to. The peer's
+     * SETTINGS_MAX_CONCURRENT_STREAMS is followed too, including when it changes after the connection is set up.
+     * Like TCP congestion control (AIMD), a connection starts with a few streams and raises its limit while streams
+     * complete normally. It halves the limit when a stream is refused (RST_STREAM with REFUSED_STREAM or
+     * ENHANCE_YOUR_CALM), or when a response takes much longer to start than the fastest one seen on the connection.
+     */
+    bool enable_adaptive_concurrency;
+    /**
+     * Optional.
+     * The most duplicate streams hedging may make, as a percentage of all the stream acquisitions. 0 turns hedging off.
+     * When an acquisition that sets `allow_hedging` has no response after a while, the same request is sent on
+     * another connection that has room for it. The first of the two streams to get a response is the one the user's
+     * callbacks see, and the other one is reset with CANCEL. No connection is made for a hedge.
+     */
+    size_t hedging_budget_percent;
+    /**
+     * Optional.
+     * How long to wait for a response before hedging, in milliseconds. 0 waits for `hedge_latency_percentile` of the
+     * response latencies the manager has seen instead, and doesn't hedge until it has seen enough of them.
+     */
+    size_t hedge_delay_ms;
+    /**
+     * Optional.
+     * See `hedge_delay_ms`. 0 will be considered as using the default value of 95.
+     */
+    double hedge_latency_percentile;
     /**
      * Required.
      * The max number of connections will be open at same time. If all the connections are full, manager will wait until
      * available to vender more streams */
     size_t max_connections;
+    /**
+     * Optional.
+     * The most bytes of response data all the connections may have in their flow-control windows, or received and
+     * not yet consumed. 0 for no limit. See `read_window_budget` in `aws_http_connection_manager_options`.
+     */
+    size_t read_window_budget;
+    /**
+     * Optional.
+     * Stream managers of the same group reuse each other's connections (RFC-7540 9.1.1). While this manager has no
+     * connection of its own, its streams are acquired from another manager of the group that has one, if that manager
+     * connects to the same port, to one of the addresses `host` resolves to, and its server certificate covers `host`.
+     * The request keeps its own :authority. Only for secure connections without a proxy.
+     * The addresses are resolved once, with the bootstrap's host resolver, as the manager is created.
+     */
+    struct aws_http2_stream_manager_coalescing_group *coalescing_group;
+    /**
+     * Optional.
+     * With `coalescing_group`, the names the server certificate of this manager's connections is valid for, besides
+     * `host`. A name may start with a "*." label, which matches any one label. They are taken as they are, as the
+     * TLS handshake only verifies `host`, so leave out any the certificate doesn't list.
+     */
+    const struct aws_byte_cursor *certificate_names;
+    size_t num_certificate_names;
 };
 
 struct aws_http2_stream_manager_acquire_stream_options {
@@ -162,6 +248,29 @@ struct aws_http2_stream_manager_acquire_stream_options {
     void *user_data;
     /* Required. see `aws_http_make_request_options` */
     const struct aws_http_make_request_options *options;
+    /**
+     * Optional.
+     * Allow the request to be hedged, see `hedging_budget_percent` in `aws_http2_stream_manager_options`.
+     * Only set it for idempotent requests, like a GET, as the server may get the request twice.
+     * Ignored for requests with a body stream or `http2_use_manual_data_writes`.
+     * If the duplicate stream wins, the callbacks of `options` get it instead of the stream acquired, from the
+     * duplicate's connection thread. The duplicate is only valid during those callbacks.
+     */
+    bool allow_hedging;
+    /**
+     * Optional.
+     * When non-zero, the request is sent again on another stream if this one fails before the server processed it:
+     * the stream is refused (RST_STREAM with REFUSED_STREAM), a GOAWAY says the server didn't get to it, or the
+     * connection closes before any response. The server may have processed the request in the last case, so only set
+     * it for requests that are safe to send twice.
+     * The first `replay_buffer_size` bytes of the body stream are kept as they're sent, so the body is sent again
+     * without the body stream seeking. The request is only sent again if no more than that had been sent.
+     * Requests without a body stream can use any non-zero value.
+     * The callbacks of `options` get the new stream instead of the stream acquired, from its connection thread, and
+     * it's only valid during those callbacks. If it can't be made, on_complete gets the stream acquired.
+     * Ignored for hedged requests, and with `http2_use_manual_data_writes`.
+     */
+    size_t replay_buffer_size;
 };
 
 AWS_EXTERN_C_BEGIN
@@ -191,6 +300,38 @@ struct aws_http2_stream_manager *aws_http2_stream_manager_new(
     struct aws_allocator *allocator,
     const struct aws_http2_stream_manager_options *options);
 
+/**
+ * Create a group for stream managers to share their connections through, see `coalescing_group` in
+ * `aws_http2_stream_manager_options`. Every stream manager in the group holds a refcount on it.
+ * Initial refcount after new is 1.
+ *
+ * @param allocator
+ * @return The new group, or NULL on failure.
+ */
+AWS_HTTP_API
+struct aws_http2_stream_manager_coalescing_group *aws_http2_stream_manager_coalescing_group_new(
+    struct aws_allocator *allocator);
+
+/**
+ * Acquire a refcount from the group. NULL is acceptable.
+ *
+ * @param group
+ * @return The same pointer acquiring.
+ */
+AWS_HTTP_API
+struct aws_http2_stream_manager_coalescing_group *aws_http2_stream_manager_coalescing_group_acquire(
+    struct aws_http2_stream_manager_coalescing_group *group);
+
+/**
+ * Release a refcount from the group, which is destroyed after the refcount drops to zero. NULL is acceptable.
+ *
+ * @param group
+ * @return NULL
+ */
+AWS_HTTP_API
+struct aws_http2_stream_manager_coalescing_group *aws_http2_stream_manager_coalescing_group_release(
+    struct aws_http2_stream_manager_coalescing_group *group);
+
 /**
  * Acquire a stream from stream manager asynchronously.
  *
@@ -202,6 +343,21 @@ void aws_http2_stream_manager_acquire_stream(
     struct aws_http2_stream_manager *http2_stream_manager,
     const struct aws_http2_stream_manager_acquire_stream_options *acquire_stream_option);
 
+/**
+ * Acquire streams from stream manager asynchronously, one for each element of the array.
+ * The same as calling `aws_http2_stream_manager_acquire_stream` for each of them, but the lock is taken once, and
+ * the streams to be made from the same connection are made by one task on its thread.
+ *
+ * @param http2_stream_manager
+ * @param acquire_stream_options Array of num_acquisitions, see `aws_http2_stream_manager_acquire_stream_options`
+ * @param num_acquisitions
+ */
+AWS_HTTP_API
+void aws_http2_stream_manager_acquire_streams(
+    struct aws_http2_stream_manager *http2_stream_manager,
+    const struct aws_http2_stream_manager_acquire_stream_options *acquire_stream_options,
+    size_t num_acquisitions);
+
 /**
  * Fetch the current metrics from stream manager.
  *
@@ -213,6 +369,30 @@ void aws_http2_stream_manager_fetch_metrics(
     const struct aws_http2_stream_manager *http2_stream_manager,
     struct aws_http_manager_metrics *out_metrics);
 
+/**
+ * Fetch the latency distributions the stream manager has recorded.
+ * acquisition_wait is per stream acquisition, the rest are for the connections of the underlying connection manager.
+ *
+ * @param http2_stream_manager
+ * @param out_metrics The metrics to be fetched
+ */
+AWS_HTTP_API
+void aws_http2_stream_manager_fetch_latency_metrics(
+    const struct aws_http2_stream_manager *http2_stream_manager,
+    struct aws_http_manager_latency_metrics *out_metrics);
+
+/**
+ * Fetch the memory held by the stream manager's connections, summed over all of them.
+ * See aws_http_connection_manager_fetch_memory_usage().
+ *
+ * @param http2_stream_manager
+ * @param out_usage The memory usage to be fetched
+ */
+AWS_HTTP_API
+void aws_http2_stream_manager_fetch_memory_usage(
+    const struct aws_http2_stream_manager *http2_stream_manager,
+    struct aws_http_connection_memory_usage *out_usage);
+
 AWS_EXTERN_C_END
 AWS_POP_SANE_WARNING_LEVEL
 
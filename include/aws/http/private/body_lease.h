@@ -0,0 +1,63 @@
+#ifndef AWS_HTTP_BODY_LEASE_H
+#define AWS_HTTP_BODY_LEASE_H
+
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/request_response.h>
+
+#include <aws/common/linked_list.h>
+
+struct aws_http_connection;
+struct aws_io_message;
+
+/**
+ * An aws_io_message that struct aws_http_body_lease point into.
+ * The connection creates one the first time it leases data from a message, and holds it until it's done with the
+ * message. Each lease holds it too, along with a hold on the connection. The message is released once every hold is.
+ * Only touched on the connection's thread, leases released on other threads hop over to it first.
+ */
+struct aws_http_leased_message {
+    struct aws_allocator *allocator;
+    struct aws_http_connection *connection;
+    struct aws_io_message *message;
+    size_t hold_count;
+
+    /* Set by the connection as it releases its hold, if leases are left. The connection counts this much against
+     * its read window until they're released, then vtable->on_body_leases_released gets it back */
+    size_t counted_bytes;
+
+    /* For the connection's use, while it holds the message */
+    struct aws_linked_list_node node;
+};
+
+AWS_EXTERN_C_BEGIN
+
+/* The connection holds the new aws_http_leased_message, until it calls aws_http_leased_message_release() */
+AWS_HTTP_API
+struct aws_http_leased_message *aws_http_leased_message_new(
+    struct aws_http_connection *connection,
+    struct aws_io_message *message);
+
+/**
+ * The connection is done with the message, release its hold.
+ * Returns true if leases still hold the message. If so, set `counted_bytes` now.
+ */
+AWS_HTTP_API
+bool aws_http_leased_message_release(struct aws_http_leased_message *leased_message);
+
+/**
+ * Invoke the stream's on_incoming_body_lease with a lease on `data`, which must be within the leased message.
+ * Returns the callback's result.
+ */
+AWS_HTTP_API
+int aws_http_leased_message_deliver_body(
+    struct aws_http_leased_message *leased_message,
+    struct aws_http_stream *stream,
+    struct aws_byte_cursor data);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_HTTP_BODY_LEASE_H */
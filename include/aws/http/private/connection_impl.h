@@ -9,9 +9,13 @@
 #include <aws/http/connection.h>
 
 #include <aws/http/private/http_impl.h>
+#include <aws/http/private/timer_wheel.h>
 #include <aws/http/server.h>
 
 #include <aws/common/atomics.h>
+#include <aws/common/linked_list.h>
+#include <aws/common/mutex.h>
+#include <aws/common/ref_count.h>
 #include <aws/io/channel.h>
 #include <aws/io/channel_bootstrap.h>
 
@@ -44,6 +48,14 @@ struct aws_http_connection_vtable {
     bool (*is_open)(const struct aws_http_connection *connection);
     bool (*new_requests_allowed)(const struct aws_http_connection *connection);
 
+    /* Invoked on the connection's thread when some of the tracker's read_window_budget is released,
+     * if the connection was held below its fair share. See aws_http_connection_update_read_window_budget() */
+    void (*on_read_window_budget_available)(struct aws_http_connection *connection);
+
+    /* Invoked on the connection's thread when the last lease on an aws_http_leased_message is released,
+     * after the connection released its own hold. Gets back the message's counted_bytes */
+    void (*on_body_leases_released)(struct aws_http_connection *connection, size_t counted_bytes);
+
     /* HTTP/2 specific functions */
     void (*update_window)(struct aws_http_connection *connection, uint32_t increment_size);
     int (*change_settings)(
@@ -76,10 +88,50 @@ struct aws_http_connection_vtable {
     void (*get_remote_settings)(
         const struct aws_http_connection *http2_connection,
         struct aws_http2_setting out_settings[AWS_HTTP2_SETTINGS_COUNT]);
+    bool (*get_local_enable_connect_protocol)(const struct aws_http_connection *http2_connection);
+    bool (*get_remote_enable_connect_protocol)(const struct aws_http_connection *http2_connection);
+    int (*get_rtt_estimate)(
+        const struct aws_http_connection *http2_connection,
+        struct aws_http2_rtt_estimate *out_estimate);
 };
 
 typedef int(aws_http_proxy_request_transform_fn)(struct aws_http_message *request, void *user_data);
 
+/* struct aws_http_connection_memory_usage, in atomics so any thread can read it */
+struct aws_http_connection_atomic_memory_usage {
+    struct aws_atomic_var decoder_scratch;
+    struct aws_atomic_var hpack_tables;
+    struct aws_atomic_var outgoing_queue;
+    struct aws_atomic_var buffered_headers;
+    struct aws_atomic_var unconsumed_reads;
+    struct aws_atomic_var frame_cache;
+};
+
+/**
+ * Sums the memory usage of a group of connections (ex: those of a connection manager).
+ * Each connection holds a reference, and adds the changes in its usage as they happen.
+ */
+struct aws_http_connection_memory_tracker {
+    struct aws_allocator *allocator;
+    struct aws_ref_count ref_count;
+    struct aws_http_connection_atomic_memory_usage totals;
+
+    /* See aws_http_connection_manager_options.read_window_budget. 0 if there's no budget */
+    size_t read_window_budget;
+
+    /* Any thread may touch this data, but the lock must be held */
+    struct {
+        struct aws_mutex lock;
+        /* Sum of each connection's read_window_budget.reserved */
+        size_t reserved;
+        /* Connections that have reserved from the budget. Each one's fair share is an equal split */
+        size_t connection_count;
+        /* List using aws_http_connection.read_window_budget.waiting_node.
+         * Connections held below their fair share, to notify once some of the budget is released */
+        struct aws_linked_list waiting_list;
+    } synced_data;
+};
+
 /**
  * Base class for connections.
  * There are specific implementations for each HTTP version.
@@ -118,6 +170,40 @@ struct aws_http_connection {
     struct aws_http_connection_server_data *server_data;
 
     bool stream_manual_window_management;
+
+    /* Only the connection's thread writes these, see aws_http_connection_set_memory_usage() */
+    struct aws_http_connection_atomic_memory_usage memory_usage;
+
+    /* Optional. See aws_http_client_connection_options.memory_tracker */
+    struct aws_http_connection_memory_tracker *memory_tracker;
+
+    /* This connection's part of the tracker's read_window_budget */
+    struct {
+        /* Only the connection's thread touches these */
+        size_t reserved;
+        bool is_counted;
+        struct aws_channel_task retry_task;
+
+        /* The tracker's lock must be held to touch these */
+        struct aws_linked_list_node waiting_node;
+        bool is_waiting;
+        bool is_retry_task_scheduled;
+    } read_window_budget;
+
+    /* Client connections through a tunneling proxy only. The timeout from the Keep-Alive header of the proxy's
+     * CONNECT response, 0 if it sent none. Set before the connection is surfaced, never changes after */
+    uint64_t proxy_keep_alive_timeout_ms;
+
+    /* Server connections only, see aws_http_connection_start_server_timeouts().
+     * Only the connection's thread touches these */
+    struct {
+        /* NULL unless some timeout is on */
+        struct aws_http_timer_wheel *wheel;
+        struct aws_http_timer_wheel_entry entry;
+        uint64_t idle_timeout_ns;
+        uint64_t header_read_timeout_ns;
+        bool is_reading_head;
+    } server_timeouts;
 };
 
 /* Gets a client connection up and running.
@@ -137,7 +223,14 @@ struct aws_http_client_bootstrap {
     struct aws_http1_connection_options http1_options;
     struct aws_http2_connection_options http2_options; /* allocated with bootstrap */
     struct aws_hash_table *alpn_string_map;            /* allocated with bootstrap */
+    struct aws_http_connection_memory_tracker *memory_tracker;
     struct aws_http_connection *connection;
+
+    /* "Upgrade: h2c" request, sent before the user is told about the connection. NULL unless upgrading. */
+    struct aws_http_message *http2_upgrade_request;
+    struct aws_http_stream *http2_upgrade_stream;
+    /* Once the upgrade succeeds, `connection` is the HTTP/2 connection and this is the pass-through HTTP/1.1 one */
+    struct aws_http_connection *upgraded_http1_connection;
 };
 
 AWS_EXTERN_C_BEGIN
@@ -189,6 +282,8 @@ uint32_t aws_http_connection_get_next_stream_id(struct aws_http_connection *conn
  * @param alpn_string_map the customized ALPN string map from `struct aws_string *` to `enum aws_http_version`.
  * @param http1_options http1 options
  * @param http2_options http2 options
+ * @param connection_user_data user_data for the connection's callbacks
+ * @param memory_tracker optional, see aws_http_connection_set_memory_tracker()
  * @return a new http connection or NULL on failure
  */
 AWS_HTTP_API
@@ -203,7 +298,106 @@ struct aws_http_connection *aws_http_connection_new_channel_handler(
     const struct aws_hash_table *alpn_string_map,
     const struct aws_http1_connection_options *http1_options,
     const struct aws_http2_connection_options *http2_options,
-    void *connection_user_data);
+    void *connection_user_data,
+    struct aws_http_connection_memory_tracker *memory_tracker);
+
+AWS_HTTP_API
+void aws_http_connection_atomic_memory_usage_init(struct aws_http_connection_atomic_memory_usage *usage);
+
+AWS_HTTP_API
+struct aws_http_connection_memory_tracker *aws_http_connection_memory_tracker_new(
+    struct aws_allocator *allocator,
+    size_t read_window_budget);
+
+/* NULL-safe, returns the tracker */
+AWS_HTTP_API
+struct aws_http_connection_memory_tracker *aws_http_connection_memory_tracker_acquire(
+    struct aws_http_connection_memory_tracker *tracker);
+
+/* NULL-safe */
+AWS_HTTP_API
+void aws_http_connection_memory_tracker_release(struct aws_http_connection_memory_tracker *tracker);
+
+AWS_HTTP_API
+void aws_http_connection_memory_tracker_get_usage(
+    const struct aws_http_connection_memory_tracker *tracker,
+    struct aws_http_connection_memory_usage *out_usage);
+
+/**
+ * Have the connection add its memory usage to the tracker's totals from now on, including what it's using already.
+ * Must be called on the connection's thread, at most once.
+ */
+AWS_HTTP_API
+void aws_http_connection_set_memory_tracker(
+    struct aws_http_connection *connection,
+    struct aws_http_connection_memory_tracker *tracker);
+
+/**
+ * Called by the connection's thread to replace its memory usage values.
+ * The differences are applied to the tracker's totals, if there is one.
+ */
+AWS_HTTP_API
+void aws_http_connection_set_memory_usage(
+    struct aws_http_connection *connection,
+    const struct aws_http_connection_memory_usage *usage);
+
+/* True if the connection's tracker has a read_window_budget */
+AWS_HTTP_API
+bool aws_http_connection_has_read_window_budget(const struct aws_http_connection *connection);
+
+/**
+ * Called on the connection's thread before it grows its read window by `increment_size`.
+ * `in_use` is what counts against the budget right now: the current window, plus what's been read but not consumed.
+ * The connection's reservation is set to `in_use` (which may be more than the budget), then up to `increment_size`
+ * more is reserved. The amount reserved is returned, and the window should only grow by that much.
+ *
+ * A connection below its fair share may take whatever is available. Beyond its fair share, it may only take what
+ * leaves another fair share available. If it got less than it asked for while below its fair share,
+ * vtable->on_read_window_budget_available is invoked once some of the budget is released.
+ *
+ * Returns `increment_size` if there's no budget.
+ */
+AWS_HTTP_API
+size_t aws_http_connection_update_read_window_budget(
+    struct aws_http_connection *connection,
+    size_t in_use,
+    size_t increment_size);
+
+/* Called as the connection is destroyed. Zeroes its memory usage, returns its part of any read_window_budget,
+ * and releases the tracker */
+AWS_HTTP_API
+void aws_http_connection_memory_usage_clean_up(struct aws_http_connection *connection);
+
+/**
+ * Turn on a server connection's idle and header-read timeouts, see aws_http_server_options.
+ * Either may be 0 to leave it off. The idle timer starts now.
+ * Deadlines are kept in the event-loop's aws_http_timer_wheel, and the connection shuts down its channel
+ * with AWS_ERROR_HTTP_SERVER_CONNECTION_TIMEOUT if one passes.
+ *
+ * The connection implementation reports progress with the functions below, which are O(1),
+ * and do nothing unless timeouts are on. All must be called on the connection's thread.
+ */
+AWS_HTTP_API
+int aws_http_connection_start_server_timeouts(
+    struct aws_http_connection *connection,
+    uint64_t idle_timeout_ns,
+    uint64_t header_read_timeout_ns);
+
+/* No request is in progress, the idle timer starts over */
+AWS_HTTP_API
+void aws_http_connection_server_timeouts_on_idle(struct aws_http_connection *connection);
+
+/* Bytes of a request head arrived. The header-read timer starts, unless this head already started it */
+AWS_HTTP_API
+void aws_http_connection_server_timeouts_on_head_begin(struct aws_http_connection *connection);
+
+/* The request head is complete. No timeout applies while the request is handled */
+AWS_HTTP_API
+void aws_http_connection_server_timeouts_on_head_done(struct aws_http_connection *connection);
+
+/* Called as the connection shuts down */
+AWS_HTTP_API
+void aws_http_connection_stop_server_timeouts(struct aws_http_connection *connection);
 
 AWS_EXTERN_C_END
 
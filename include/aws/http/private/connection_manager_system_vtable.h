@@ -21,6 +21,12 @@ typedef struct aws_channel *(aws_http_connection_manager_connection_get_channel_
     struct aws_http_connection *connection);
 typedef enum aws_http_version(aws_http_connection_manager_connection_get_version_fn)(
     const struct aws_http_connection *connection);
+typedef struct aws_event_loop *(aws_http_connection_manager_connection_get_event_loop_fn)(
+    struct aws_http_connection *connection);
+typedef uint32_t(aws_http_connection_manager_connection_get_max_concurrent_streams_fn)(
+    const struct aws_http_connection *connection);
+typedef uint64_t(aws_http_connection_manager_connection_get_proxy_keep_alive_timeout_fn)(
+    const struct aws_http_connection *connection);
 
 struct aws_http_connection_manager_system_vtable {
     /*
@@ -34,6 +40,12 @@ struct aws_http_connection_manager_system_vtable {
     aws_http_connection_manager_is_callers_thread_fn *is_callers_thread;
     aws_http_connection_manager_connection_get_channel_fn *connection_get_channel;
     aws_http_connection_manager_connection_get_version_fn *connection_get_version;
+    /* Only used when enable_event_loop_shards is set, or an acquisition asks for an event loop */
+    aws_http_connection_manager_connection_get_event_loop_fn *connection_get_event_loop;
+    /* Only used with max_http2_leases_per_connection. The peer's current SETTINGS_MAX_CONCURRENT_STREAMS */
+    aws_http_connection_manager_connection_get_max_concurrent_streams_fn *connection_get_max_concurrent_streams;
+    /* Optional. Milliseconds a tunneling proxy keeps an idle tunnel open, 0 if unknown */
+    aws_http_connection_manager_connection_get_proxy_keep_alive_timeout_fn *connection_get_proxy_keep_alive_timeout;
 };
 
 AWS_HTTP_API
@@ -29,6 +29,8 @@ AWS_EXTERN_C_BEGIN
 /**
  * Creates a new http connection monitor that regularly checks the connection's throughput and shuts the connection
  * down if the a minimum threshold is not met for a configurable number of seconds.
+ * It also shuts the connection down as soon as a configured maximum first byte latency, PING round-trip time, or
+ * flow-control window stall is exceeded.
  */
 AWS_HTTP_API
 struct aws_crt_statistics_handler *aws_crt_statistics_handler_new_http_connection_monitor(
@@ -0,0 +1,45 @@
+#ifndef AWS_HTTP_CONTENT_DECODING_IMPL_H
+#define AWS_HTTP_CONTENT_DECODING_IMPL_H
+
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/content_decoding.h>
+
+struct aws_http_message;
+struct aws_http_stream;
+
+AWS_EXTERN_C_BEGIN
+
+/* Add the Accept-Encoding header to a request about to be made, unless it has one already */
+AWS_HTTP_API
+int aws_http_content_decoding_prepare_request(
+    struct aws_http_message *request,
+    const struct aws_http_content_decoding_options *options);
+
+/**
+ * Set up decoding of a new client stream's response body. This takes the stream's incoming callbacks,
+ * and passes the user's callbacks decoded data instead.
+ * Must be called before the stream is activated.
+ */
+AWS_HTTP_API
+int aws_http_stream_content_decoding_init(
+    struct aws_http_stream *stream,
+    const struct aws_http_content_decoding_options *options);
+
+/* Called as the stream is destroyed */
+AWS_HTTP_API
+void aws_http_stream_content_decoding_clean_up(struct aws_http_stream *stream);
+
+/**
+ * The user consumed `decoded_increment` bytes of decoded body.
+ * Returns how much the stream's window should grow by, in encoded bytes. May be called from any thread.
+ */
+AWS_HTTP_API
+size_t aws_http_stream_content_decoding_translate_window(struct aws_http_stream *stream, size_t decoded_increment);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_HTTP_CONTENT_DECODING_IMPL_H */
@@ -0,0 +1,34 @@
+#ifndef AWS_HTTP_CONTENT_ENCODING_IMPL_H
+#define AWS_HTTP_CONTENT_ENCODING_IMPL_H
+
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/content_encoding.h>
+
+struct aws_http_message;
+struct aws_input_stream;
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Create the request to actually send in place of `request`: the same, but with its body stream read through an
+ * encoder, a Content-Encoding header, and no Content-Length header. HTTP/1.1 requests get
+ * "Transfer-Encoding: chunked", and the HTTP/1.1 encoder sends the body stream as chunks.
+ * `request` must have a body stream.
+ */
+AWS_HTTP_API
+struct aws_http_message *aws_http_content_encoding_new_request(
+    struct aws_allocator *allocator,
+    struct aws_http_message *request,
+    const struct aws_http_content_encoding_options *options);
+
+/* Returns true if body_stream was created by aws_http_content_encoding_new_request(). Its length isn't known */
+AWS_HTTP_API
+bool aws_http_content_encoding_is_body_stream(const struct aws_input_stream *body_stream);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_HTTP_CONTENT_ENCODING_IMPL_H */
@@ -6,6 +6,7 @@
  * SPDX-License-Identifier: Apache-2.0.
  */
 
+#include <aws/common/array_list.h>
 #include <aws/common/mutex.h>
 #include <aws/http/private/connection_impl.h>
 #include <aws/http/private/h1_encoder.h>
@@ -20,13 +21,26 @@ struct aws_h1_connection {
 
     size_t initial_stream_window_size;
 
+    /* See aws_http1_connection_options.expect_continue_timeout_ms. Zero if feature is off */
+    uint64_t expect_continue_timeout_ns;
+
+    /* See aws_http1_connection_options.max_write_messages_in_flight. Never zero */
+    size_t max_write_messages_in_flight;
+
+    /* See aws_http1_connection_options.max_pipelined_requests. Zero if there's no limit */
+    size_t max_pipelined_requests;
+
+    /* See aws_http1_connection_options.bulk_body_passthrough */
+    bool bulk_body_passthrough;
+
     /* Task responsible for sending data.
      * As long as there is data available to send, the task will be "active" and repeatedly:
      * 1) Encode outgoing stream data to an aws_io_message and send it up the channel.
-     * 2) Wait until the aws_io_message's write_complete callback fires.
+     * 2) If `max_write_messages_in_flight` are now in flight, wait until one's write_complete callback fires.
      * 3) Reschedule the task to run again.
      *
      * `thread_data.is_outgoing_stream_task_active` tells whether the task is "active".
+     * `thread_data.is_outgoing_stream_task_waiting_for_write` tells whether it's at step 2.
      *
      * If there is no data available to write (waiting for user to add more streams or chunks),
      * then the task stops being active. The task is made active again when the user
@@ -45,6 +59,14 @@ struct aws_h1_connection {
      */
     struct aws_channel_task cross_thread_work_task;
 
+    /* Task that stops holding a request body, if "100 Continue" takes too long to arrive.
+     * See `thread_data.expect_continue_deadline_ns`. */
+    struct aws_channel_task expect_continue_timeout_task;
+
+    /* Streams get their chunks from here, see aws_http1_stream_write_chunk().
+     * Any thread may touch this, it has its own lock. */
+    struct aws_h1_chunk_pool chunk_pool;
+
     /* Only the event-loop thread may touch this data */
     struct {
         /* List of streams being worked on. */
@@ -72,13 +94,48 @@ struct aws_h1_connection {
          * The `aws_io_message.copy_mark` is used to track progress on partially processed messages.
          * `pending_bytes` is the sum of all unprocessed bytes across all queued messages.
          * `capacity` is the limit for how many unprocessed bytes we'd like in the queue.
+         *
+         * If `max_capacity` is greater than `min_capacity`, then `capacity` auto-sizes between them,
+         * see `aws_http1_connection_options.max_read_buffer_capacity`.
+         * Since window that's already been issued can't be taken back, `pending_bytes` can briefly
+         * exceed `capacity` after it shrinks.
+         * Body leases (see aws_http_on_incoming_body_lease_fn) may hold messages that are done processing,
+         * `leased_bytes` is their size, which counts against `capacity` too.
+         * `is_window_exhausted` is set when a read uses up the entire connection window.
+         * `went_idle` is set when the connection runs out of HTTP-streams to read.
          */
         struct {
             struct aws_linked_list messages;
             size_t pending_bytes;
             size_t capacity;
+            size_t min_capacity;
+            size_t max_capacity;
+            bool is_window_exhausted;
+            bool went_idle;
+            /* For the first of `messages`, once any of its body data is leased */
+            struct aws_http_leased_message *leased_message;
+            size_t leased_bytes;
         } read_buffer;
 
+        /**
+         * Used when `aws_http1_connection_options.deliver_whole_header_blocks` is set.
+         * Headers of the header-block in progress are collected here, then delivered all at once.
+         * Most headers point directly into aws_io_messages. Once fully decoded, those messages are moved from
+         * `read_buffer.messages` to `retained_messages`, and only released after delivery.
+         * Lines that spanned aws_io_messages were assembled in the decoder's scratch space, so they're copied
+         * to `string_arena` (name, value, name, value...). Since the arena may move as it grows,
+         * those headers have a NULL name.ptr and value.ptr until collection is done.
+         * Memory is kept between header-blocks, so a connection quickly stops allocating for this.
+         */
+        struct {
+            bool enabled;
+            struct aws_array_list header_array; /* aws_http_header */
+            struct aws_byte_buf string_arena;
+            struct aws_linked_list retained_messages;
+            /* Retained messages that body leases point into too, using aws_http_leased_message.node */
+            struct aws_linked_list retained_leased_messages;
+        } header_collection;
+
         /**
          * The connection's current window size.
          * We use this variable, instead of the existing `aws_channel_slot.window_size`,
@@ -96,6 +153,15 @@ struct aws_h1_connection {
         uint64_t outgoing_stream_timestamp_ns;
         uint64_t incoming_stream_timestamp_ns;
 
+        /* If non-zero, the outgoing stream's body is held waiting for "100 Continue" until this time.
+         * If the timeout task is already scheduled (for an earlier deadline) it reschedules itself
+         * when it runs, rather than being scheduled twice. */
+        uint64_t expect_continue_deadline_ns;
+        bool is_expect_continue_timeout_task_scheduled;
+
+        /* aws_io_messages sent by the outgoing stream task, whose write_complete callback hasn't fired yet */
+        size_t write_messages_in_flight;
+
         /* True when read and/or writing has stopped, whether due to errors or normal channel shutdown. */
         bool is_reading_stopped : 1;
         bool is_writing_stopped : 1;
@@ -110,6 +176,7 @@ struct aws_h1_connection {
 
         /* see `outgoing_stream_task` */
         bool is_outgoing_stream_task_active : 1;
+        bool is_outgoing_stream_task_waiting_for_write : 1;
 
         bool is_processing_read_messages : 1;
     } thread_data;
@@ -142,6 +209,7 @@ struct aws_h1_window_stats {
     size_t connection_window;
     size_t recent_window_increments; /* Resets to 0 each time window stats are queried*/
     size_t buffer_capacity;
+    size_t buffer_max_capacity; /* Same as buffer_capacity, unless the read buffer auto-sizes */
     size_t buffer_pending_bytes;
     uint64_t stream_window;
     bool has_incoming_stream;
@@ -21,6 +21,11 @@ struct aws_h1_decoded_header {
 
     /* Raw buffer storing the entire header. */
     struct aws_byte_cursor data;
+
+    /* False if `data` points into the cursor passed to `aws_h1_decode()`.
+     * True if the header's line spanned multiple `aws_h1_decode()` calls, in which case `data` points into
+     * memory the decoder reuses for the next line. */
+    bool is_data_in_scratch_space;
 };
 
 struct aws_h1_decoder_vtable {
@@ -84,6 +89,11 @@ AWS_HTTP_API int aws_h1_decoder_get_encoding_flags(const struct aws_h1_decoder *
 AWS_HTTP_API uint64_t aws_h1_decoder_get_content_length(const struct aws_h1_decoder *decoder);
 AWS_HTTP_API bool aws_h1_decoder_get_body_headers_ignored(const struct aws_h1_decoder *decoder);
 AWS_HTTP_API enum aws_http_header_block aws_h1_decoder_get_header_block(const struct aws_h1_decoder *decoder);
+/* Bytes of body data that come next, up to the end of the body or of the current chunk.
+ * Zero if the decoder isn't in the middle of body data */
+AWS_HTTP_API uint64_t aws_h1_decoder_get_body_bytes_until_boundary(const struct aws_h1_decoder *decoder);
+/* Bytes allocated for assembling lines that span multiple calls to aws_h1_decode() */
+AWS_HTTP_API size_t aws_h1_decoder_get_scratch_capacity(const struct aws_h1_decoder *decoder);
 
 AWS_EXTERN_C_END
 
@@ -5,11 +5,32 @@
  * SPDX-License-Identifier: Apache-2.0.
  */
 
+#include <aws/common/mutex.h>
 #include <aws/http/private/http_impl.h>
 #include <aws/http/private/request_response_impl.h>
 
+/* Pooled chunks have room for a chunk-line this long, enough for a 64-bit chunk-size and a short extension */
+#define AWS_H1_POOLED_CHUNK_LINE_SIZE 64
+
+/**
+ * Recycles aws_h1_chunks, along with their chunk-line storage,
+ * so that streaming lots of chunks doesn't cost an allocation per chunk.
+ * Chunks are created on the user's thread and destroyed on the event-loop thread, so the pool has a lock.
+ */
+struct aws_h1_chunk_pool {
+    struct aws_allocator *allocator;
+    struct aws_mutex lock;
+    /* Idle `struct aws_h1_chunk` */
+    struct aws_linked_list free_list;
+    size_t free_count;
+    /* Chunks destroyed when free_count is at this limit are freed instead */
+    size_t max_free_count;
+};
+
 struct aws_h1_chunk {
     struct aws_allocator *allocator;
+    /* If non-NULL, the chunk returns to this pool when destroyed */
+    struct aws_h1_chunk_pool *pool;
     struct aws_input_stream *data;
     uint64_t data_size;
     aws_http1_stream_write_chunk_complete_fn *on_complete;
@@ -19,6 +40,24 @@ struct aws_h1_chunk {
     struct aws_byte_buf chunk_line;
 };
 
+struct aws_http1_request_template {
+    struct aws_allocator *allocator;
+    struct aws_string *method;
+    /* Pre-encoded header-lines: "{name}: {value}\r\n" for each header in the template */
+    struct aws_byte_buf header_lines;
+    bool has_connection_close_header;
+    bool has_expect_continue_header;
+};
+
+struct aws_http1_static_response {
+    struct aws_allocator *allocator;
+    /* Pre-encoded response: status-line, header-lines, head-end, then the whole body */
+    struct aws_byte_buf encoded;
+    /* Length of the head within `encoded`, which is all that's sent in reply to a HEAD request */
+    size_t head_len;
+    bool has_connection_close_header;
+};
+
 struct aws_h1_trailer {
     struct aws_allocator *allocator;
     struct aws_byte_buf trailer_data;
@@ -31,7 +70,7 @@ struct aws_h1_trailer {
 struct aws_h1_encoder_message {
     /* Upon creation, the "head" (everything preceding body) is buffered here. */
     struct aws_byte_buf outgoing_head_buf;
-    /* Single stream used for unchunked body */
+    /* Single stream used for unchunked body, or for a chunked body when has_chunked_body_stream is set */
     struct aws_input_stream *body;
 
     /* Pointer to list of `struct aws_h1_chunk`, used for chunked encoding.
@@ -48,17 +87,28 @@ struct aws_h1_encoder_message {
     uint64_t content_length;
     bool has_connection_close_header;
     bool has_chunked_encoding_header;
+    /* Chunked body is read from `body`, instead of coming from the chunk API.
+     * Only allowed for body streams whose length isn't known, see aws_http_content_encoding_new_request() */
+    bool has_chunked_body_stream;
+    /* "Expect: 100-continue" */
+    bool has_expect_continue_header;
+    /* If true, the encoder pauses after the head, until aws_h1_encoder_continue_body() or
+     * aws_h1_encoder_abandon_body() is called. Only matters if there's a body */
+    bool hold_body_until_continue;
 };
 
 enum aws_h1_encoder_state {
     AWS_H1_ENCODER_STATE_INIT,
     AWS_H1_ENCODER_STATE_HEAD,
+    AWS_H1_ENCODER_STATE_AWAIT_CONTINUE,
     AWS_H1_ENCODER_STATE_UNCHUNKED_BODY,
+    AWS_H1_ENCODER_STATE_STREAM_CHUNK,
     AWS_H1_ENCODER_STATE_CHUNK_NEXT,
     AWS_H1_ENCODER_STATE_CHUNK_LINE,
     AWS_H1_ENCODER_STATE_CHUNK_BODY,
     AWS_H1_ENCODER_STATE_CHUNK_END,
     AWS_H1_ENCODER_STATE_CHUNK_TRAILER,
+    AWS_H1_ENCODER_STATE_LAST_CHUNK,
     AWS_H1_ENCODER_STATE_DONE,
 };
 
@@ -85,9 +135,6 @@ struct aws_h1_trailer *aws_h1_trailer_new(
 
 void aws_h1_trailer_destroy(struct aws_h1_trailer *trailer);
 
-/* Just destroy the chunk (don't fire callback) */
-void aws_h1_chunk_destroy(struct aws_h1_chunk *chunk);
-
 /* Destroy chunk and fire its completion callback */
 void aws_h1_chunk_complete_and_destroy(struct aws_h1_chunk *chunk, struct aws_http_stream *http_stream, int error_code);
 
@@ -95,6 +142,23 @@ int aws_chunk_line_from_options(struct aws_http1_chunk_options *options, struct
 
 AWS_EXTERN_C_BEGIN
 
+/* Pool must outlive every chunk made from it */
+AWS_HTTP_API
+int aws_h1_chunk_pool_init(struct aws_h1_chunk_pool *pool, struct aws_allocator *allocator, size_t max_free_count);
+
+AWS_HTTP_API
+void aws_h1_chunk_pool_clean_up(struct aws_h1_chunk_pool *pool);
+
+/* Like aws_h1_chunk_new(), but reuses a chunk from the pool if possible */
+AWS_HTTP_API
+struct aws_h1_chunk *aws_h1_chunk_new_from_pool(
+    struct aws_h1_chunk_pool *pool,
+    const struct aws_http1_chunk_options *options);
+
+/* Just destroy the chunk (don't fire callback), returning it to its pool if it came from one */
+AWS_HTTP_API
+void aws_h1_chunk_destroy(struct aws_h1_chunk *chunk);
+
 /* Validate request and cache any info the encoder will need later in the "encoder message". */
 AWS_HTTP_API
 int aws_h1_encoder_message_init_from_request(
@@ -103,6 +167,16 @@ int aws_h1_encoder_message_init_from_request(
     const struct aws_http_message *request,
     struct aws_linked_list *pending_chunk_list);
 
+/* Same as above, but the method and leading headers come from a request template.
+ * request_template may be NULL */
+AWS_HTTP_API
+int aws_h1_encoder_message_init_from_request_template(
+    struct aws_h1_encoder_message *message,
+    struct aws_allocator *allocator,
+    const struct aws_http_message *request,
+    const struct aws_http1_request_template *request_template,
+    struct aws_linked_list *pending_chunk_list);
+
 int aws_h1_encoder_message_init_from_response(
     struct aws_h1_encoder_message *message,
     struct aws_allocator *allocator,
@@ -110,6 +184,15 @@ int aws_h1_encoder_message_init_from_response(
     bool body_headers_ignored,
     struct aws_linked_list *pending_chunk_list);
 
+/* The message sends the static response's pre-encoded bytes in place, with no copy and no body stream,
+ * so the static response must outlive the message. */
+AWS_HTTP_API
+void aws_h1_encoder_message_init_from_static_response(
+    struct aws_h1_encoder_message *message,
+    const struct aws_http1_static_response *static_response,
+    bool body_ignored,
+    struct aws_linked_list *pending_chunk_list);
+
 AWS_HTTP_API
 void aws_h1_encoder_message_clean_up(struct aws_h1_encoder_message *message);
 
@@ -128,6 +211,17 @@ int aws_h1_encoder_start_message(
 AWS_HTTP_API
 int aws_h1_encoder_process(struct aws_h1_encoder *encoder, struct aws_byte_buf *out_buf);
 
+/* aws_h1_encoder_process() only copies body segments from aws_http_body_segments_stream_new() that fit whole.
+ * If it wrote nothing because the next segment is too large, call this to take that segment,
+ * so it can be sent in its own aws_io_message without copying.
+ * out_taken is set false if there's no such segment.
+ * If a segment is taken, the caller becomes responsible for invoking its on_release callback. */
+AWS_HTTP_API
+int aws_h1_encoder_take_body_segment(
+    struct aws_h1_encoder *encoder,
+    struct aws_http_body_segment *out_segment,
+    bool *out_taken);
+
 AWS_HTTP_API
 bool aws_h1_encoder_is_message_in_progress(const struct aws_h1_encoder *encoder);
 
@@ -135,6 +229,22 @@ bool aws_h1_encoder_is_message_in_progress(const struct aws_h1_encoder *encoder)
 AWS_HTTP_API
 bool aws_h1_encoder_is_waiting_for_chunks(const struct aws_h1_encoder *encoder);
 
+/* Return true if the head has been encoded, and the body is held until aws_h1_encoder_continue_body()
+ * or aws_h1_encoder_abandon_body() is called. See aws_h1_encoder_message.hold_body_until_continue */
+AWS_HTTP_API
+bool aws_h1_encoder_is_waiting_for_continue(const struct aws_h1_encoder *encoder);
+
+/* Stop holding the current message's body. It will be encoded by the next aws_h1_encoder_process() */
+AWS_HTTP_API
+void aws_h1_encoder_continue_body(struct aws_h1_encoder *encoder);
+
+/* Finish the current message without sending its held body.
+ * A chunked body is ended with the last-chunk, so the connection may continue to be used.
+ * An unchunked body leaves the message short of its Content-Length, so the connection must close.
+ * MUST only be called while aws_h1_encoder_is_waiting_for_continue() is true */
+AWS_HTTP_API
+void aws_h1_encoder_abandon_body(struct aws_h1_encoder *encoder);
+
 AWS_EXTERN_C_END
 
 #endif /* AWS_HTTP_H1_ENCODER_H */
@@ -52,6 +52,9 @@ struct aws_h1_stream {
      * See RFC-7230 Section 6: Connection Management. */
     bool is_final_stream;
 
+    /* Client-only. Whether the request's method is idempotent (RFC-7231 4.2.2), see max_pipelined_requests */
+    bool is_idempotent_request;
+
     /* Buffer for incoming data that needs to stick around. */
     struct aws_byte_buf incoming_storage_buf;
 
@@ -0,0 +1,86 @@
+#ifndef AWS_HTTP_H2_CLOSED_STREAMS_H
+#define AWS_HTTP_H2_CLOSED_STREAMS_H
+
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/http.h>
+
+/* Slot in the ring of recently closed streams */
+struct aws_h2_closed_stream {
+    uint32_t stream_id;  /* 0 if slot is empty */
+    uint8_t closed_when; /* enum aws_h2_stream_closed_when */
+};
+
+/* Entry in the index over the ring */
+struct aws_h2_closed_streams_index_slot {
+    uint32_t stream_id; /* 0 if slot is empty */
+    uint32_t ring_slot;
+};
+
+/**
+ * Remembers how the most recently closed streams on an HTTP/2 connection closed,
+ * so frames that arrive for them late can be handled correctly.
+ *
+ * Streams are kept in a fixed-size ring, in the order they closed.
+ * A newly closed stream overwrites the one that closed longest ago, whatever their ids,
+ * so a long-lived stream that closes late doesn't push out streams that closed just before it.
+ *
+ * An open-addressed index maps stream-id to ring slot, so a lookup doesn't scan the ring.
+ * Like aws_h2_stream_table, it's indexed directly by (stream-id / 2) with linear probing.
+ * It has at least twice as many slots as the ring, so it's never more than half full.
+ * An entry is removed when its ring slot is overwritten, by shifting the rest of its probe chain back,
+ * so the index never fills with tombstones.
+ *
+ * Costs no allocation after init. Not thread-safe.
+ */
+struct aws_h2_closed_streams {
+    struct aws_allocator *alloc;
+
+    struct aws_h2_closed_stream *ring;
+    size_t ring_capacity;
+    /* Slot the next closed stream goes in */
+    size_t next_ring_slot;
+
+    struct aws_h2_closed_streams_index_slot *index;
+    size_t index_capacity; /* always a power of 2 */
+    size_t index_count;
+};
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Remember up to `capacity` closed streams. `capacity` must be non-zero.
+ */
+AWS_HTTP_API
+int aws_h2_closed_streams_init(
+    struct aws_h2_closed_streams *closed_streams,
+    struct aws_allocator *alloc,
+    size_t capacity);
+
+AWS_HTTP_API
+void aws_h2_closed_streams_clean_up(struct aws_h2_closed_streams *closed_streams);
+
+/**
+ * Record that a stream closed, evicting whichever stream closed longest ago if the ring is full.
+ * If the stream-id is already recorded, the old record is dropped. Cannot fail.
+ */
+AWS_HTTP_API
+void aws_h2_closed_streams_add(
+    struct aws_h2_closed_streams *closed_streams,
+    uint32_t stream_id,
+    uint8_t closed_when);
+
+/**
+ * Returns the record for this stream, or NULL if there's no memory of it closing.
+ */
+AWS_HTTP_API
+const struct aws_h2_closed_stream *aws_h2_closed_streams_find(
+    const struct aws_h2_closed_streams *closed_streams,
+    uint32_t stream_id);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_HTTP_H2_CLOSED_STREAMS_H */
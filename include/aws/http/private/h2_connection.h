@@ -7,16 +7,24 @@
  */
 
 #include <aws/common/atomics.h>
-#include <aws/common/fifo_cache.h>
 #include <aws/common/hash_table.h>
 #include <aws/common/mutex.h>
 
 #include <aws/http/private/connection_impl.h>
+#include <aws/http/private/h2_closed_streams.h>
 #include <aws/http/private/h2_frames.h>
+#include <aws/http/private/h2_stream_table.h>
+#include <aws/http/private/mpsc_queue.h>
+#include <aws/http/request_response.h>
 #include <aws/http/statistics.h>
 
 struct aws_h2_decoder;
 struct aws_h2_stream;
+struct aws_http_leased_message;
+
+/* Streams with DATA to send are scheduled in buckets. Lower urgency values go first, and within an urgency,
+ * non-incremental streams go before incremental ones (RFC-9218 10). */
+#define AWS_H2_PRIORITY_BUCKET_COUNT ((AWS_HTTP2_PRIORITY_URGENCY_MAX + 1) * 2)
 
 struct aws_h2_connection {
     struct aws_http_connection base;
@@ -26,9 +34,32 @@ struct aws_h2_connection {
 
     struct aws_channel_task cross_thread_work_task;
     struct aws_channel_task outgoing_frames_task;
+    /* Wakes the outgoing frames task after it parked, because no body stream had data available */
+    struct aws_channel_task outgoing_frames_retry_task;
 
     bool conn_manual_window_management;
 
+    /* Recycles memory for frames. Use frame_pool.allocator when creating one on the connection's thread */
+    struct aws_h2_frame_pool frame_pool;
+
+    /* If non-zero, how long to hold newly queued frames before starting the outgoing frames task */
+    uint64_t write_coalescing_delay_ns;
+
+    /* See aws_http2_connection_options.max_write_messages_in_flight. Never zero */
+    size_t max_write_messages_in_flight;
+
+    /* If non-zero, stream windows grow automatically up to this size. See aws_http2_connection_options */
+    uint32_t stream_window_auto_tuning_max_size;
+
+    /* If max_size is non-zero, SETTINGS_HEADER_TABLE_SIZE adapts between these. See aws_http2_connection_options */
+    struct {
+        uint32_t min_size;
+        uint32_t max_size;
+    } header_table_adaptive;
+
+    /* If non-zero, a stream sending DATA alone may use frames up to this size. See aws_http2_connection_options */
+    uint32_t bulk_data_max_frame_size;
+
     /* Only the event-loop thread may touch this data */
     struct {
         struct aws_h2_decoder *decoder;
@@ -40,10 +71,25 @@ struct aws_h2_connection {
 
         bool is_outgoing_frames_task_active;
 
+        /* aws_io_messages sent by the outgoing frames task, whose write completion hasn't fired yet.
+         * A frame prefix and its zero-copy payload message count as one. While `max_write_messages_in_flight`
+         * are in flight, the task stays active but waits for a completion to reschedule it. */
+        size_t write_messages_in_flight;
+        bool is_outgoing_frames_task_waiting_for_write;
+
+        /* Number of times in a row the outgoing frames task had DATA to send, but no body stream had data available.
+         * Reset once a message is sent. Used to decide when to stop polling every tick and back off instead. */
+        uint32_t outgoing_frames_empty_count;
+        bool is_outgoing_frames_retry_task_scheduled;
+
         /* Settings received from peer, which restricts the message to send */
-        uint32_t settings_peer[AWS_HTTP2_SETTINGS_END_RANGE];
+        uint32_t settings_peer[AWS_H2_SETTINGS_END_RANGE];
         /* Local settings to send/sent to peer, which affects the decoding */
-        uint32_t settings_self[AWS_HTTP2_SETTINGS_END_RANGE];
+        uint32_t settings_self[AWS_H2_SETTINGS_END_RANGE];
+
+        /* True once the peer's first SETTINGS frame has arrived.
+         * Until then, an extended CONNECT can't know if the peer supports it, and waits (RFC-8441 3) */
+        bool is_peer_settings_received;
 
         /* List using aws_h2_pending_settings.node
          * Contains settings waiting to be ACKed by peer and applied */
@@ -53,18 +99,48 @@ struct aws_h2_connection {
          * Pings waiting to be ACKed by peer */
         struct aws_linked_list pending_ping_queue;
 
+        /* Stream window auto-tuning (see stream_window_auto_tuning_max_size).
+         * While a PING is in flight, count the DATA bytes each stream receives. When its ACK arrives,
+         * the most any one stream received approximates the bandwidth-delay product of a stream.
+         * Streams reset their count lazily, the first time they receive DATA in a new sample. */
+        struct {
+            bool is_ping_in_flight;
+            uint32_t sample_id;
+            uint64_t max_stream_bytes_received;
+            /* How much bigger than SETTINGS_INITIAL_WINDOW_SIZE stream windows should be.
+             * Each stream catches up lazily, the next time it receives DATA. */
+            uint32_t stream_window_growth;
+        } window_auto_tuning;
+
+        /* Adaptive SETTINGS_HEADER_TABLE_SIZE (see header_table_adaptive).
+         * Counts down header-blocks received until the next time the decoder's table usage is evaluated */
+        struct {
+            uint32_t header_blocks_until_evaluation;
+            bool is_settings_in_flight;
+        } header_table_adaptive;
+
         /* Most recent stream-id that was initiated by peer */
         uint32_t latest_peer_initiated_stream_id;
 
+        /* List using aws_h2_stream.node, sorted by stream-id.
+         * Streams are activated without a lock, so one can arrive before another that got a lower stream-id.
+         * They wait here until every lower stream-id has arrived, since streams must open in order (RFC-9113 5.1.1) */
+        struct aws_linked_list pending_stream_list;
+
+        /* Stream-id of the next self-initiated stream to open */
+        uint32_t next_pending_stream_id;
+
         /* Maps stream-id to aws_h2_stream*.
          * Contains all streams in the open, reserved, and half-closed states (terms from RFC-7540 5.1).
-         * Once a stream enters closed state, it is removed from this map. */
-        struct aws_hash_table active_streams_map;
+         * Once a stream enters closed state, it is removed from this table. */
+        struct aws_h2_stream_table active_streams;
 
-        /* List using aws_h2_stream.node.
-         * Contains all streams with DATA frames to send.
-         * Any stream in this list is also in the active_streams_map. */
-        struct aws_linked_list outgoing_streams_list;
+        /* Lists using aws_h2_stream.node, indexed by aws_h2_stream.priority_bucket (most urgent first).
+         * Together they contain all streams with DATA frames to send.
+         * Any stream in these lists is also in active_streams.
+         * Streams stay sorted by priority between messages, so writing DATA only touches the streams it writes,
+         * no matter how many are waiting their turn. Use aws_h2_connection_add_outgoing_stream() to add one. */
+        struct aws_linked_list outgoing_streams_buckets[AWS_H2_PRIORITY_BUCKET_COUNT];
 
         /* List using aws_h2_stream.node.
          * Contains all streams with DATA frames to send, and cannot send now due to flow control.
@@ -74,20 +150,20 @@ struct aws_h2_connection {
         /* List using aws_h2_stream.node.
          * Contains all streams that are open, but are only sending data when notified, rather than polling
          * for it (e.g. event streams)
-         * Streams are moved to the outgoing_streams_list until they send pending data, then are moved back
+         * Streams are moved to the outgoing_streams_buckets until they send pending data, then are moved back
          * to this list to sleep until more data comes in
          */
         struct aws_linked_list waiting_streams_list;
 
         /* List using aws_h2_frame.node.
          * Queues all frames (except DATA frames) for connection to send.
-         * When queue is empty, then we send DATA frames from the outgoing_streams_list */
+         * When queue is empty, then we send DATA frames from the outgoing_streams_buckets */
         struct aws_linked_list outgoing_frames_queue;
+        /* Sum of memory_size for the frames in outgoing_frames_queue, reported as memory usage */
+        size_t outgoing_frames_queue_bytes;
 
-        /* FIFO cache for closed stream, key: stream-id, value: aws_h2_stream_closed_when.
-         * Contains data about streams that were recently closed.
-         * The oldest entry will be removed if the cache is full */
-        struct aws_cache *closed_streams;
+        /* The max_closed_streams most recently closed streams, and how they closed */
+        struct aws_h2_closed_streams closed_streams;
 
         /* Flow-control of connection from peer. Indicating the buffer capacity of our peer.
          * Reduce the space after sending a flow-controlled frame. Increment after receiving WINDOW_UPDATE for
@@ -99,6 +175,17 @@ struct aws_h2_connection {
          * connection */
         size_t window_size_self;
 
+        /* DATA received for streams with manual window management, that the user hasn't updated the stream windows
+         * for yet. Counts against any read window budget, along with window_size_self */
+        size_t read_window_budget_held;
+
+        /* The aws_io_message being decoded, and its aws_http_leased_message once any body data is leased from it */
+        struct aws_io_message *read_message;
+        struct aws_http_leased_message *leased_message;
+
+        /* Size of messages that only body leases still hold. Counts against any read window budget too */
+        size_t leased_bytes;
+
         /* Highest self-initiated stream-id that peer might have processed.
          * Defaults to max stream-id, may be lowered when GOAWAY frame received. */
         uint32_t goaway_received_last_stream_id;
@@ -109,6 +196,16 @@ struct aws_h2_connection {
         /* Frame we are encoding now. NULL if we are not encoding anything. */
         struct aws_h2_frame *current_outgoing_frame;
 
+        /* Caller-owned DATA payload (see aws_http2_stream_write_data_options.data_buffer) that is sent in its own
+         * aws_io_message, right after the message containing its frame prefix.
+         * Set when the payload is encoded, and handed off to the payload's aws_io_message when that's created,
+         * which holds onto the stream and write until the channel is done with the memory. */
+        struct {
+            struct aws_byte_cursor payload;
+            struct aws_h2_stream *stream;
+            struct aws_h2_stream_data_write *write;
+        } zero_copy;
+
         /* Pointer to initial pending settings. If ACKed by peer, it will be NULL. */
         struct aws_h2_pending_settings *init_pending_settings;
 
@@ -125,6 +222,14 @@ struct aws_h2_connection {
         uint64_t outgoing_timestamp_ns;
         /* Timestamp when connection has data to receive, which is when there is an active stream */
         uint64_t incoming_timestamp_ns;
+        /* Timestamp when DATA stopped being sent because the peer's connection window ran out, and the timestamp
+         * the stall has been counted in stats up to. Only valid while is_connection_window_stalled */
+        uint64_t connection_window_stall_began_ns;
+        uint64_t connection_window_stall_timestamp_ns;
+        bool is_connection_window_stalled;
+
+        /* Updated each time a PING or SETTINGS we sent is ACKed. sample_count is 0 until the first ACK */
+        struct aws_http2_rtt_estimate rtt_estimate;
 
     } thread_data;
 
@@ -132,8 +237,13 @@ struct aws_h2_connection {
     struct {
         struct aws_mutex lock;
 
-        /* New `aws_h2_stream *` that haven't moved to `thread_data` yet */
-        struct aws_linked_list pending_stream_list;
+        /* New `aws_h2_stream *` that haven't moved to `thread_data` yet.
+         * Lock-free, so threads making requests on a shared connection don't contend for the lock.
+         * Closed as the connection shuts down, so streams can't be left in it */
+        struct aws_http_mpsc_queue pending_stream_queue;
+
+        /* Atomic uint32_t, stream-id for the next self-initiated stream */
+        struct aws_atomic_var next_stream_id;
 
         /* New `aws_h2_frames *`, connection control frames created by user that haven't moved to `thread_data` yet */
         struct aws_linked_list pending_frame_list;
@@ -147,16 +257,19 @@ struct aws_h2_connection {
         /* New `aws_h2_pending_goaway *` created by user that haven't sent yet */
         struct aws_linked_list pending_goaway_list;
 
-        bool is_cross_thread_work_task_scheduled;
+        /* Atomic bool. Set by whoever schedules cross_thread_work_task, cleared as the task begins */
+        struct aws_atomic_var is_cross_thread_work_task_scheduled;
 
-        /* The window_update value for `thread_data.window_size_self` that haven't applied yet */
-        size_t window_update_size;
+        /* Atomic size_t, the window_update value for `thread_data.window_size_self` that haven't applied yet.
+         * The task sends it in a single WINDOW_UPDATE frame */
+        struct aws_atomic_var window_update_size;
 
         /* For checking status from outside the event-loop thread. */
         bool is_open;
 
-        /* If non-zero, reason to immediately reject new streams. (ex: closing) */
-        int new_stream_error_code;
+        /* Atomic int. If non-zero, reason to immediately reject new streams. (ex: closing)
+         * Read without the lock, changed with the lock held */
+        struct aws_atomic_var new_stream_error_code;
 
         /* Last-stream-id sent in most recent GOAWAY frame. Defaults to AWS_H2_STREAM_ID_MAX + 1 indicates no GOAWAY has
          * been sent so far.*/
@@ -173,15 +286,20 @@ struct aws_h2_connection {
         uint32_t goaway_received_http2_error_code;
 
         /* For checking settings received from peer from outside the event-loop thread. */
-        uint32_t settings_peer[AWS_HTTP2_SETTINGS_END_RANGE];
+        uint32_t settings_peer[AWS_H2_SETTINGS_END_RANGE];
         /* For checking local settings to send/sent to peer from outside the event-loop thread. */
-        uint32_t settings_self[AWS_HTTP2_SETTINGS_END_RANGE];
+        uint32_t settings_self[AWS_H2_SETTINGS_END_RANGE];
+
+        /* For checking thread_data.rtt_estimate from outside the event-loop thread. */
+        struct aws_http2_rtt_estimate rtt_estimate;
     } synced_data;
 };
 
 struct aws_h2_pending_settings {
     struct aws_http2_setting *settings_array;
     size_t num_settings;
+    /* For calculating round-trip time */
+    uint64_t started_time;
     struct aws_linked_list_node node;
     /* user callback */
     void *user_data;
@@ -226,6 +344,12 @@ enum aws_h2_data_encode_status {
 /* When window size is too small to fit the possible padding into it, we stop sending data and wait for WINDOW_UPDATE */
 #define AWS_H2_MIN_WINDOW_SIZE (256)
 
+/* When no body stream has data available, the outgoing frames task polls again on the next tick this many times,
+ * since data often becomes available soon. After that it parks, and retries with exponential backoff. */
+#define AWS_H2_OUTGOING_FRAMES_EMPTY_POLL_LIMIT (16)
+#define AWS_H2_OUTGOING_FRAMES_RETRY_MIN_NS (50 * 1000)        /* 50 microseconds */
+#define AWS_H2_OUTGOING_FRAMES_RETRY_MAX_NS (50 * 1000 * 1000) /* 50 milliseconds */
+
 /* Private functions called from tests... */
 
 AWS_EXTERN_C_BEGIN
@@ -254,6 +378,11 @@ AWS_EXTERN_C_END
  */
 void aws_h2_connection_enqueue_outgoing_frame(struct aws_h2_connection *connection, struct aws_h2_frame *frame);
 
+/**
+ * Count a RST_STREAM frame that was enqueued, in the connection's statistics.
+ */
+void aws_h2_connection_count_rst_stream_sent(struct aws_h2_connection *connection, uint32_t h2_error_code);
+
 /**
  * Invoked immediately after a stream enters the CLOSED state.
  * The connection will remove the stream from its "active" datastructures,
@@ -277,6 +406,29 @@ int aws_h2_connection_send_rst_and_close_reserved_stream(
     uint32_t stream_id,
     uint32_t h2_error_code);
 
+/**
+ * Prepare a client connection that was installed after the server accepted an `Upgrade: h2c` request.
+ * The upgrade request implicitly became stream 1 (RFC-7540 3.2). Nobody is waiting on its response,
+ * so the stream is cancelled and new streams start at id 3.
+ * Must be called before any stream is made on the connection.
+ */
+int aws_h2_connection_on_http1_upgrade(struct aws_h2_connection *connection);
+
+/**
+ * The user updated a stream's window. Any DATA held against the read window budget for the stream, up to that much,
+ * is released.
+ */
+void aws_h2_connection_release_stream_read_window_budget(
+    struct aws_h2_connection *connection,
+    struct aws_h2_stream *stream,
+    size_t size);
+
+/**
+ * Put a stream at the back of its priority bucket in the outgoing_streams_buckets.
+ * The stream must not be in any other list.
+ */
+void aws_h2_connection_add_outgoing_stream(struct aws_h2_connection *connection, struct aws_h2_stream *stream);
+
 /**
  * Error happens while writing into channel, shutdown the connection. Only called within the eventloop thread
  */
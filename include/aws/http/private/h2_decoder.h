@@ -37,6 +37,19 @@ struct aws_h2_decoder_vtable {
     struct aws_h2err (
         *on_headers_end)(uint32_t stream_id, bool malformed, enum aws_http_header_block block_type, void *userdata);
 
+    /* Only used if aws_h2_decoder_params.collect_header_blocks is set, in which case it replaces _i() calls
+     * for HEADERS header-blocks. Called once, just before _end(), with every header-field in the block.
+     * name_enum_array[i] is the aws_http_header_name of header_array[i].
+     * Both arrays are only valid for the duration of the callback.
+     * Not called if the header-block is malformed */
+    struct aws_h2err (*on_headers_block)(
+        uint32_t stream_id,
+        const struct aws_http_header *header_array,
+        const enum aws_http_header_name *name_enum_array,
+        size_t num_headers,
+        enum aws_http_header_block block_type,
+        void *userdata);
+
     /* For PUSH_PROMISE header-block: _begin() is called, then 0+ _i() calls, then _end().
      * No other decoder callbacks will occur in this time.
      * If something is malformed, no further _i() calls occur, and it is reported in _end() */
@@ -100,6 +113,14 @@ struct aws_h2_decoder_params {
     /* If true, do not expect the connection preface and immediately accept any frame type.
      * Only set this when testing the decoder itself */
     bool skip_connection_preface;
+
+    /* If true, header-fields of a HEADERS header-block are collected into a contiguous array
+     * and delivered once via on_headers_block(), instead of one at a time via on_headers_i().
+     * The array and the strings it points to are kept in memory reused from block to block. */
+    bool collect_header_blocks;
+
+    /* Optional. If set, frames and bytes received are counted here */
+    struct aws_crt_statistics_http2_channel *stats;
 };
 
 struct aws_h2_decoder;
@@ -116,6 +137,19 @@ AWS_HTTP_API void aws_h2_decoder_set_setting_header_table_size(struct aws_h2_dec
 AWS_HTTP_API void aws_h2_decoder_set_setting_enable_push(struct aws_h2_decoder *decoder, uint32_t data);
 AWS_HTTP_API void aws_h2_decoder_set_setting_max_frame_size(struct aws_h2_decoder *decoder, uint32_t data);
 
+/* Suggest a SETTINGS_HEADER_TABLE_SIZE, based on HPACK dynamic table usage since the last call.
+ * See aws_hpack_suggest_dynamic_table_size() */
+AWS_HTTP_API size_t aws_h2_decoder_suggest_header_table_size(
+    struct aws_h2_decoder *decoder,
+    size_t min_size,
+    size_t max_size);
+
+/* Add the memory the decoder is holding onto to `usage`: scratch buffers, its HPACK dynamic table,
+ * and the header-block being collected */
+AWS_HTTP_API void aws_h2_decoder_add_memory_usage(
+    const struct aws_h2_decoder *decoder,
+    struct aws_http_connection_memory_usage *usage);
+
 AWS_EXTERN_C_END
 
 #endif /* AWS_HTTP_H2_DECODER_H */
@@ -9,6 +9,7 @@
 #include <aws/http/connection.h>
 #include <aws/http/private/hpack.h>
 #include <aws/http/request_response.h>
+#include <aws/http/statistics.h>
 
 #include <aws/common/byte_buf.h>
 
@@ -57,13 +58,21 @@ struct aws_h2err {
 #define AWS_H2_STREAM_ID_MAX (0x7FFFFFFF)     /* cannot use high bit */
 #define AWS_H2_FRAME_PREFIX_SIZE (9)
 #define AWS_H2_INIT_WINDOW_SIZE (65535) /* Defined initial window size */
+#define AWS_H2_ZERO_COPY_PAYLOAD_MIN_SIZE (8 * 1024) /* Smaller DATA payloads are always copied */
+/* End of all known settings ids, including those after AWS_HTTP2_SETTINGS_END_RANGE. Size of arrays indexed by id */
+#define AWS_H2_SETTINGS_END_RANGE (AWS_HTTP2_SETTINGS_ENABLE_CONNECT_PROTOCOL + 1)
 
 /* Legal min(inclusive) and max(inclusive) for each setting */
-extern const uint32_t aws_h2_settings_bounds[AWS_HTTP2_SETTINGS_END_RANGE][2];
+extern const uint32_t aws_h2_settings_bounds[AWS_H2_SETTINGS_END_RANGE][2];
 
 /* Initial values for settings RFC-7540 6.5.2 */
 AWS_HTTP_API
-extern const uint32_t aws_h2_settings_initial[AWS_HTTP2_SETTINGS_END_RANGE];
+extern const uint32_t aws_h2_settings_initial[AWS_H2_SETTINGS_END_RANGE];
+
+/* Known settings ids aren't contiguous: ENABLE_CONNECT_PROTOCOL (0x8) is past AWS_HTTP2_SETTINGS_END_RANGE,
+ * and 0x7 is unassigned. Unknown ids are ignored (RFC-7540 6.5.2) */
+AWS_HTTP_API
+bool aws_h2_settings_id_is_known(uint32_t id);
 
 /* This magic string must be the very first thing a client sends to the server.
  * See RFC-7540 3.5 - HTTP/2 Connection Preface.
@@ -101,6 +110,9 @@ struct aws_h2_frame {
     /* If true, frame will be sent before those with normal priority.
      * Useful for frames like PING ACK where low latency is important. */
     bool high_priority;
+
+    /* Bytes allocated for this frame, as it was constructed. See aws_http_connection_memory_usage.outgoing_queue */
+    size_t memory_size;
 };
 
 /* Used to encode a frame */
@@ -116,7 +128,13 @@ struct aws_h2_frame_encoder {
         uint32_t max_frame_size;
     } settings;
 
+    /* If non-zero, DATA payloads are also limited to this size, even if the peer's MAX_FRAME_SIZE is larger */
+    uint32_t max_data_payload;
+
     bool has_errored;
+
+    /* Optional. If set, frames and bytes successfully encoded are counted here */
+    struct aws_crt_statistics_http2_channel *stats;
 };
 
 typedef void aws_h2_frame_destroy_fn(struct aws_h2_frame *frame_base);
@@ -131,8 +149,42 @@ struct aws_h2_frame_vtable {
     aws_h2_frame_encode_fn *encode;
 };
 
+/* Allocations are rounded up to the smallest size class that fits, anything larger bypasses the pool */
+#define AWS_H2_FRAME_POOL_SIZE_CLASS_COUNT 3
+#define AWS_H2_FRAME_POOL_MIN_BLOCK_SIZE 128
+/* Max number of free blocks kept per size class, beyond that blocks return to the parent allocator.
+ * Enough for the frames a connection typically has queued at once, about 15KB when every list is full */
+#define AWS_H2_FRAME_POOL_MAX_FREE_BLOCKS 16
+
+/**
+ * Per-connection cache for the small allocations that churn with every frame (aws_h2_frame).
+ * Pass `&pool->allocator` wherever you'd otherwise pass the connection's allocator.
+ * Freed blocks go onto a free-list for their size class, so steady-state traffic
+ * doesn't touch the parent allocator at all.
+ * Not thread-safe: only allocate and free from the connection's thread. Frames created on other threads
+ * must use the parent allocator instead.
+ * Everything allocated from the pool must be freed before the pool is cleaned up.
+ */
+struct aws_h2_frame_pool {
+    struct aws_allocator allocator;
+    struct aws_allocator *parent;
+    /* Bytes held in the free-lists, counted in the connection's memory usage */
+    size_t cached_bytes;
+    struct {
+        /* Singly-linked list, threaded through the free blocks themselves */
+        void *free_list;
+        size_t free_count;
+    } size_classes[AWS_H2_FRAME_POOL_SIZE_CLASS_COUNT];
+};
+
 AWS_EXTERN_C_BEGIN
 
+AWS_HTTP_API
+int aws_h2_frame_pool_init(struct aws_h2_frame_pool *pool, struct aws_allocator *parent);
+
+AWS_HTTP_API
+void aws_h2_frame_pool_clean_up(struct aws_h2_frame_pool *pool);
+
 AWS_HTTP_API
 const char *aws_h2_frame_type_to_str(enum aws_h2_frame_type type);
 
@@ -223,6 +275,29 @@ int aws_h2_encode_data_frame(
     bool *body_complete,
     bool *body_stalled);
 
+/**
+ * Attempt to encode a DATA frame whose body is caller-owned memory.
+ * Up to MAX_FRAME_SIZE is consumed from the front of body (limited by flow-control windows).
+ * If the payload fits in the output buffer, it is copied in like any other DATA frame.
+ * If it doesn't fit and is smaller than AWS_H2_ZERO_COPY_PAYLOAD_MIN_SIZE, only what fits is copied.
+ * Otherwise only the frame prefix is written, and out_payload is set to the payload,
+ * which the caller must send immediately after the output buffer without writing anything in between.
+ * body_complete will be set true once body is fully consumed.
+ *
+ * Each call to this function encodes a complete DATA frame, or nothing at all.
+ */
+AWS_HTTP_API
+int aws_h2_encode_data_frame_from_cursor(
+    struct aws_h2_frame_encoder *encoder,
+    uint32_t stream_id,
+    struct aws_byte_cursor *body,
+    bool body_ends_stream,
+    int32_t *stream_window_size_peer,
+    size_t *connection_window_size_peer,
+    struct aws_byte_buf *output,
+    struct aws_byte_cursor *out_payload,
+    bool *body_complete);
+
 AWS_HTTP_API
 void aws_h2_frame_destroy(struct aws_h2_frame *frame);
 
@@ -239,6 +314,19 @@ struct aws_h2_frame *aws_h2_frame_new_headers(
     uint8_t pad_length,
     const struct aws_h2_frame_priority_settings *optional_priority);
 
+/**
+ * Like aws_h2_frame_new_headers(), but the header-block is encoded straight from an HTTP/1 request,
+ * see aws_hpack_encode_header_block_from_http1(). The request is acquired until the frame is destroyed.
+ */
+AWS_HTTP_API
+struct aws_h2_frame *aws_h2_frame_new_headers_from_http1(
+    struct aws_allocator *allocator,
+    uint32_t stream_id,
+    const struct aws_http_message *http1_request,
+    bool end_stream,
+    uint8_t pad_length,
+    const struct aws_h2_frame_priority_settings *optional_priority);
+
 AWS_HTTP_API
 struct aws_h2_frame *aws_h2_frame_new_priority(
     struct aws_allocator *allocator,
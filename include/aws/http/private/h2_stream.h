@@ -14,6 +14,8 @@
 
 #include <inttypes.h>
 
+struct aws_http_leased_message;
+
 #define AWS_H2_STREAM_LOGF(level, stream, text, ...)                                                                   \
     AWS_LOGF_##level(                                                                                                  \
         AWS_LS_HTTP_STREAM,                                                                                            \
@@ -64,7 +66,17 @@ enum aws_h2_stream_body_state {
 /* represents a write operation, which will be turned into a data frame */
 struct aws_h2_stream_data_write {
     struct aws_linked_list_node node;
+    /* Either data_stream or data_buffer is used, never both */
     struct aws_input_stream *data_stream;
+    /* Caller-owned memory, the part that hasn't been encoded yet */
+    struct aws_byte_cursor data_buffer;
+    bool use_data_buffer;
+    /* Number of aws_io_messages in the channel that refer to data_buffer memory (see aws_h2_connection's zero_copy).
+     * Could be several when the connection has multiple messages in flight.
+     * If the write is destroyed while this is non-zero it's deferred until the channel is done. */
+    size_t data_buffer_messages_in_flight;
+    bool destroy_pending;
+    int destroy_error_code;
     aws_http2_stream_write_data_complete_fn *on_complete;
     void *user_data;
     bool end_stream;
@@ -73,7 +85,11 @@ struct aws_h2_stream_data_write {
 struct aws_h2_stream {
     struct aws_http_stream base;
 
+    /* What the connection reads for each stream as it schedules DATA, kept together so it's one cache line */
     struct aws_linked_list_node node;
+    /* Index into the connection's outgoing_streams_buckets, derived from `priority` */
+    uint8_t priority_bucket;
+
     struct aws_channel_task cross_thread_work_task;
 
     /* Only the event-loop thread may touch this data */
@@ -84,6 +100,14 @@ struct aws_h2_stream {
          * We allow this value exceed the max window size (int64 can hold much more than 0x7FFFFFFF),
          * We leave it up to the remote peer to detect whether the max window size has been exceeded. */
         int64_t window_size_self;
+        /* How much of the connection's window_auto_tuning.stream_window_growth this stream has already received */
+        uint32_t window_size_self_growth;
+        /* DATA bytes received during the connection's window_auto_tuning sample with this id */
+        uint32_t window_auto_tuning_sample_id;
+        uint64_t window_auto_tuning_bytes_received;
+        /* This stream's part of the connection's read_window_budget_held */
+        size_t read_window_budget_held;
+        /* HTTP/2 message, or HTTP/1.1 request whose headers are encoded as HTTP/2 without converting the message */
         struct aws_http_message *outgoing_message;
         /* All queued writes. If the message provides a body stream, it will be first in this list
          * This list can drain, which results in the stream being put to sleep (moved to waiting_streams_list in
@@ -97,9 +121,11 @@ struct aws_h2_stream {
         /* The total length of payload of data frame received */
         uint64_t incoming_data_length;
         /* Indicates that the stream is currently in the waiting_streams_list and is
-         * asleep. When stream needs to be awaken, moving the stream back to the outgoing_streams_list and set this bool
-         * to false */
+         * asleep. When stream needs to be awaken, moving the stream back to the outgoing_streams_buckets and set this
+         * bool to false */
         bool waiting_for_writes;
+        /* When the stream was last put in the connection's stalled_window_streams_list, 0 while it isn't there */
+        uint64_t window_stall_timestamp_ns;
     } thread_data;
 
     /* Any thread may touch this data, but the lock must be held (unless it's an atomic) */
@@ -125,6 +151,13 @@ struct aws_h2_stream {
     } synced_data;
     bool manual_write;
 
+    /* The request has a :protocol pseudo-header, so it's an extended CONNECT (RFC-8441 4) */
+    bool is_extended_connect;
+
+    /* Scheduling priority for outgoing DATA. Set when the stream is created and never changes.
+     * Only consulted via priority_bucket while scheduling, except to check `incremental` once a stream is picked */
+    struct aws_http2_stream_priority priority;
+
     /* Store the sent reset HTTP/2 error code, set to -1, if none has sent so far */
     int64_t sent_reset_error_code;
 
@@ -166,6 +199,13 @@ struct aws_h2err aws_h2_stream_on_decoder_headers_i(
     enum aws_http_header_name name_enum,
     enum aws_http_header_block block_type);
 
+struct aws_h2err aws_h2_stream_on_decoder_headers_block(
+    struct aws_h2_stream *stream,
+    const struct aws_http_header *header_array,
+    const enum aws_http_header_name *name_enum_array,
+    size_t num_headers,
+    enum aws_http_header_block block_type);
+
 struct aws_h2err aws_h2_stream_on_decoder_headers_end(
     struct aws_h2_stream *stream,
     bool malformed,
@@ -177,7 +217,11 @@ struct aws_h2err aws_h2_stream_on_decoder_data_begin(
     uint32_t payload_len,
     uint32_t total_padding_bytes,
     bool end_stream);
-struct aws_h2err aws_h2_stream_on_decoder_data_i(struct aws_h2_stream *stream, struct aws_byte_cursor data);
+/* leased_message is what data points into, for streams that lease body data. NULL otherwise */
+struct aws_h2err aws_h2_stream_on_decoder_data_i(
+    struct aws_h2_stream *stream,
+    struct aws_byte_cursor data,
+    struct aws_http_leased_message *leased_message);
 struct aws_h2err aws_h2_stream_on_decoder_window_update(
     struct aws_h2_stream *stream,
     uint32_t window_size_increment,
@@ -187,4 +231,11 @@ struct aws_h2err aws_h2_stream_on_decoder_rst_stream(struct aws_h2_stream *strea
 
 int aws_h2_stream_activate(struct aws_http_stream *stream);
 
+/* The channel is done with a write's data_buffer memory that was sent without copying.
+ * Finishes any destruction of the write that was deferred, and releases the stream reference taken for it. */
+void aws_h2_stream_on_data_buffer_written(
+    struct aws_h2_stream *stream,
+    struct aws_h2_stream_data_write *write,
+    int error_code);
+
 #endif /* AWS_HTTP_H2_STREAM_H */
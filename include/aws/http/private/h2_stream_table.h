@@ -0,0 +1,93 @@
+#ifndef AWS_HTTP_H2_STREAM_TABLE_H
+#define AWS_HTTP_H2_STREAM_TABLE_H
+
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/http.h>
+
+struct aws_h2_stream;
+
+struct aws_h2_stream_table_slot {
+    /* 0 if the slot has never been used. Non-zero with a NULL stream means the stream was removed (tombstone) */
+    uint32_t stream_id;
+    struct aws_h2_stream *stream;
+};
+
+/**
+ * Maps stream-id to aws_h2_stream*, for the streams that are active on an HTTP/2 connection.
+ *
+ * In place of hashing, the table is indexed directly by (stream-id / 2), modulo its power-of-two capacity.
+ * Stream-ids from one endpoint step by 2 and the active ones live in a narrow range that slides upward,
+ * so each active stream usually sits in its own slot and a lookup is a single array access.
+ * Collisions (ids that are a multiple of the capacity apart, or a client and server id sharing a slot)
+ * are resolved by linear probing.
+ *
+ * Removed slots become tombstones, so removing the current stream while iterating is safe.
+ * Not thread-safe.
+ */
+struct aws_h2_stream_table {
+    struct aws_allocator *alloc;
+    struct aws_h2_stream_table_slot *slots;
+    size_t capacity; /* always a power of 2 */
+    size_t count;
+    size_t tombstone_count;
+};
+
+/**
+ * Iterates over every stream in the table, in no particular order.
+ * Streams may be removed while iterating, but not added.
+ */
+struct aws_h2_stream_table_iter {
+    const struct aws_h2_stream_table *table;
+    size_t slot_index;
+    struct aws_h2_stream *stream;
+};
+
+AWS_EXTERN_C_BEGIN
+
+AWS_HTTP_API
+int aws_h2_stream_table_init(
+    struct aws_h2_stream_table *table,
+    struct aws_allocator *alloc,
+    size_t initial_capacity);
+
+AWS_HTTP_API
+void aws_h2_stream_table_clean_up(struct aws_h2_stream_table *table);
+
+/**
+ * Returns the stream with this id, or NULL if it's not in the table.
+ */
+AWS_HTTP_API
+struct aws_h2_stream *aws_h2_stream_table_find(const struct aws_h2_stream_table *table, uint32_t stream_id);
+
+/**
+ * Add a stream to the table. The stream-id must not already be in the table.
+ * Only fails if memory can't be allocated to grow the table.
+ */
+AWS_HTTP_API
+int aws_h2_stream_table_insert(struct aws_h2_stream_table *table, uint32_t stream_id, struct aws_h2_stream *stream);
+
+/**
+ * Remove the stream with this id. Does nothing if it's not in the table.
+ */
+AWS_HTTP_API
+void aws_h2_stream_table_remove(struct aws_h2_stream_table *table, uint32_t stream_id);
+
+AWS_HTTP_API
+size_t aws_h2_stream_table_get_count(const struct aws_h2_stream_table *table);
+
+AWS_HTTP_API
+struct aws_h2_stream_table_iter aws_h2_stream_table_iter_begin(const struct aws_h2_stream_table *table);
+
+AWS_HTTP_API
+bool aws_h2_stream_table_iter_done(const struct aws_h2_stream_table_iter *iter);
+
+AWS_HTTP_API
+void aws_h2_stream_table_iter_next(struct aws_h2_stream_table_iter *iter);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_HTTP_H2_STREAM_TABLE_H */
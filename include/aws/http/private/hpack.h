@@ -49,6 +49,9 @@ enum aws_hpack_huffman_mode {
  * Maintains the dynamic table.
  * Insertion is backwards, indexing is forwards
  */
+/* Number of evicted header-fields a context remembers, to detect when they're inserted again */
+#define AWS_HPACK_EVICTED_HISTORY_SIZE 16
+
 struct aws_hpack_context {
     struct aws_allocator *allocator;
 
@@ -56,11 +59,19 @@ struct aws_hpack_context {
     const void *log_id;
 
     struct {
-        /* Array of headers, pointers to memory we alloced, which needs to be cleaned up whenever we move an entry out
-         */
+        /* Array of headers. Their name and value strings point into `strings` */
         struct aws_http_header *buffer;
         size_t buffer_capacity; /* Number of http_headers that can fit in buffer */
 
+        /* One allocation holding the name and value strings of every entry, oldest to newest, back to back.
+         * Live strings occupy [strings_start, strings_end). Evicting an entry just advances strings_start,
+         * and when there isn't room after strings_end, live strings slide back to the front.
+         * Grows (rarely) until it's twice max_size, after which inserts never need to allocate. */
+        uint8_t *strings;
+        size_t strings_capacity;
+        size_t strings_start;
+        size_t strings_end;
+
         size_t num_elements;
         size_t index_0;
 
@@ -68,19 +79,80 @@ struct aws_hpack_context {
         size_t size;
         size_t max_size;
 
+        /* Number of headers ever inserted. An entry's index changes as others are inserted,
+         * but its insertion number (value of insert_count right after it went in) does not */
+        uint64_t insert_count;
+
         /* aws_http_header * -> size_t */
         struct aws_hash_table reverse_lookup;
         /* aws_byte_cursor * -> size_t */
         struct aws_hash_table reverse_lookup_name_only;
+
+        /* How the table has been used since the last call to aws_hpack_suggest_dynamic_table_size() */
+        struct {
+            /* Largest size the table reached */
+            size_t peak_size;
+            uint64_t num_inserts;
+            uint64_t num_evictions;
+            /* Inserts of a header-field that was recently evicted, which a bigger table would have kept */
+            uint64_t num_evicted_reinserts;
+
+            /* Hashes of the most recently evicted header-fields (kept across calls), newest overwrite oldest */
+            uint32_t evicted_hashes[AWS_HPACK_EVICTED_HISTORY_SIZE];
+            size_t num_evicted_hashes;
+            size_t next_evicted_hash;
+        } usage;
     } dynamic_table;
 };
 
+struct aws_hpack_header_template;
+
+/* Number of header-names whose values the encoder's indexing policy keeps track of */
+#define AWS_HPACK_INDEXING_POLICY_NAME_SLOTS 64
+/* Number of recently seen values remembered per header-name */
+#define AWS_HPACK_INDEXING_POLICY_RECENT_VALUES 4
+
+/**
+ * What the encoder's indexing policy has recently seen for one header-name.
+ * Names and values are only remembered by hash, collisions just make the estimate a little off.
+ */
+struct aws_hpack_indexing_policy_slot {
+    uint32_t name_hash;
+    uint32_t recent_value_hashes[AWS_HPACK_INDEXING_POLICY_RECENT_VALUES];
+    uint8_t num_recent_values;
+    uint8_t next_recent_value;
+    /* Occurrences of this name within the window, and how many of those repeated a recent value.
+     * Both are halved when the window fills, so old history fades out */
+    uint16_t occurrences;
+    uint16_t repeats;
+};
+
+/**
+ * Counters for measuring how well the encoder is compressing.
+ * Compression ratio is encoded_bytes / raw_bytes.
+ */
+struct aws_hpack_encoder_stats {
+    /* Sum of header-field name and value lengths passed to the encoder */
+    uint64_t raw_bytes;
+    /* Sum of header-block lengths produced by the encoder */
+    uint64_t encoded_bytes;
+    uint64_t num_header_fields;
+    /* Header-fields sent as a single dynamic or static table index */
+    uint64_t num_indexed;
+    /* Header-fields inserted into the dynamic table */
+    uint64_t num_inserted;
+    /* Header-fields that allowed indexing, but the policy chose to send without indexing */
+    uint64_t num_skipped_by_policy;
+};
+
 /**
  * Encodes outgoing headers.
  */
 struct aws_hpack_encoder {
     const void *log_id;
 
+    /* Generic encoder for the HPACK Huffman code. Strings are encoded by a faster HPACK-specific path,
+     * this remains as a reference implementation for tests */
     struct aws_huffman_encoder huffman_encoder;
     enum aws_hpack_huffman_mode huffman_mode;
 
@@ -91,6 +163,28 @@ struct aws_hpack_encoder {
         size_t smallest_value;
         bool pending;
     } dynamic_table_size_update;
+
+    /* Optional, see aws_hpack_encoder_set_header_template() */
+    struct aws_hpack_header_template *header_template;
+
+    /* See aws_hpack_encoder_set_indexing_policy() */
+    struct {
+        bool enabled;
+        struct aws_hpack_indexing_policy_slot slots[AWS_HPACK_INDEXING_POLICY_NAME_SLOTS];
+    } indexing_policy;
+
+    struct aws_hpack_encoder_stats stats;
+
+    /* Reused by aws_hpack_encode_header_block_from_http1() to lowercase each header-name */
+    struct aws_byte_buf lowercase_name_buf;
+};
+
+/**
+ * Progress through a Huffman-encoded string literal, see aws_hpack_huffman_decode().
+ */
+struct aws_hpack_huffman_decoder {
+    /* Position in the HPACK Huffman code tree, where 0 is the root */
+    uint8_t state;
 };
 
 /**
@@ -99,7 +193,7 @@ struct aws_hpack_encoder {
 struct aws_hpack_decoder {
     const void *log_id;
 
-    struct aws_huffman_decoder huffman_decoder;
+    struct aws_hpack_huffman_decoder huffman_decoder;
 
     struct aws_hpack_context context;
 
@@ -170,6 +264,7 @@ AWS_EXTERN_C_BEGIN
 /* Library-level init and shutdown */
 void aws_hpack_static_table_init(struct aws_allocator *allocator);
 void aws_hpack_static_table_clean_up(void);
+void aws_hpack_huffman_decode_table_init(void);
 
 AWS_HTTP_API
 void aws_hpack_context_init(
@@ -191,6 +286,10 @@ size_t aws_hpack_get_dynamic_table_num_elements(const struct aws_hpack_context *
 
 size_t aws_hpack_get_dynamic_table_max_size(const struct aws_hpack_context *context);
 
+/* Returns the bytes allocated for the dynamic table's entries and their strings */
+AWS_HTTP_API
+size_t aws_hpack_get_dynamic_table_memory_usage(const struct aws_hpack_context *context);
+
 AWS_HTTP_API
 const struct aws_http_header *aws_hpack_get_header(const struct aws_hpack_context *context, size_t index);
 
@@ -205,12 +304,33 @@ size_t aws_hpack_find_index(
 AWS_HTTP_API
 int aws_hpack_insert_header(struct aws_hpack_context *context, const struct aws_http_header *header);
 
+/* Like aws_hpack_find_index(), but only searches the static table, so the result never changes.
+ * A return value of 0 indicates that the header wasn't found */
+AWS_HTTP_API
+size_t aws_hpack_find_static_index(const struct aws_http_header *header, bool *found_value);
+
+/* Returns the current index of the header that was inserted when insert_count became `insertion`.
+ * A return value of 0 indicates that header has been evicted from the dynamic table */
+AWS_HTTP_API
+size_t aws_hpack_get_index_of_insertion(const struct aws_hpack_context *context, uint64_t insertion);
+
 /**
  * Set the max size of the dynamic table (in octets). The size of each header is name.len + value.len + 32 [4.1].
  */
 AWS_HTTP_API
 int aws_hpack_resize_dynamic_table(struct aws_hpack_context *context, size_t new_max_size);
 
+/**
+ * Suggest a max size for the dynamic table, between min_size and max_size,
+ * based on how the table was used since the last call. Resets the usage counters.
+ *
+ * Suggests doubling the current size when recently evicted header-fields keep being inserted again
+ * (a bigger table would have had them as hits), and halving it when nothing was evicted
+ * and the table never got more than a quarter full. Otherwise suggests the current size.
+ */
+AWS_HTTP_API
+size_t aws_hpack_suggest_dynamic_table_size(struct aws_hpack_context *context, size_t min_size, size_t max_size);
+
 AWS_HTTP_API
 void aws_hpack_encoder_init(struct aws_hpack_encoder *encoder, struct aws_allocator *allocator, const void *log_id);
 
@@ -226,6 +346,39 @@ void aws_hpack_encoder_update_max_table_size(struct aws_hpack_encoder *encoder,
 AWS_HTTP_API
 void aws_hpack_encoder_set_huffman_mode(struct aws_hpack_encoder *encoder, enum aws_hpack_huffman_mode mode);
 
+/**
+ * Register header-fields that this encoder expects to send in many header-blocks
+ * (ex: user-agent or content-type on every request). The headers are copied.
+ * Replaces any previous template, pass NULL to remove it.
+ *
+ * When a header-block contains a field matching a template entry (same name and value),
+ * the encoder skips the usual table lookups and re-encoding of its strings.
+ * It remembers the field's static-table index, its pre-encoded (possibly Huffman) strings,
+ * and the position where it was inserted into the dynamic table, which is re-checked
+ * on each use so evictions and table resizes are handled correctly.
+ */
+AWS_HTTP_API
+int aws_hpack_encoder_set_header_template(struct aws_hpack_encoder *encoder, const struct aws_http_headers *headers);
+
+/**
+ * Enable or disable the indexing policy (disabled by default).
+ *
+ * A header-field marked AWS_HTTP_HEADER_COMPRESSION_USE_CACHE only permits indexing, it doesn't require it.
+ * Inserting a field whose value is different nearly every time (ex: request-id, signature)
+ * costs the encoding of its insertion and evicts entries that would have been reused.
+ * With the policy enabled, the encoder estimates how often each header-name repeats a recent value,
+ * and once a name has been seen enough times, stops indexing its values if they rarely repeat.
+ * When disabled, every USE_CACHE field that isn't already in a table is inserted.
+ */
+AWS_HTTP_API
+void aws_hpack_encoder_set_indexing_policy(struct aws_hpack_encoder *encoder, bool enabled);
+
+/**
+ * Get the encoder's compression counters.
+ */
+AWS_HTTP_API
+void aws_hpack_encoder_get_stats(const struct aws_hpack_encoder *encoder, struct aws_hpack_encoder_stats *out_stats);
+
 /**
  * Encode header-block into the output.
  * This function will mutate hpack, so an error means hpack can no longer be used.
@@ -237,6 +390,38 @@ int aws_hpack_encode_header_block(
     const struct aws_http_headers *headers,
     struct aws_byte_buf *output);
 
+/**
+ * Encode an HTTP/1 request as an HTTP/2 header-block, without converting it to an HTTP/2 message first.
+ * The pseudo-headers (":method", ":scheme", ":authority" from Host, ":path") are synthesized while encoding,
+ * connection-specific headers are skipped, and names are lowercased as they're encoded.
+ * The output is the same as encoding the headers of aws_http2_message_new_from_http1().
+ * Raises AWS_ERROR_HTTP_INVALID_METHOD or AWS_ERROR_HTTP_INVALID_PATH, without touching hpack,
+ * if the request lacks them. Any other error means hpack can no longer be used.
+ */
+AWS_HTTP_API
+int aws_hpack_encode_header_block_from_http1(
+    struct aws_hpack_encoder *encoder,
+    const struct aws_http_message *http1_request,
+    struct aws_byte_buf *output);
+
+/**
+ * Returns an upper bound on the size of the header-block aws_hpack_encode_header_block() would encode right now.
+ * An output buffer with this much space available is never resized.
+ */
+AWS_HTTP_API
+size_t aws_hpack_encode_header_block_max_size(
+    const struct aws_hpack_encoder *encoder,
+    const struct aws_http_headers *headers);
+
+/**
+ * Returns an upper bound on the size of the header-block aws_hpack_encode_header_block_from_http1() would
+ * encode right now.
+ */
+AWS_HTTP_API
+size_t aws_hpack_encode_header_block_from_http1_max_size(
+    const struct aws_hpack_encoder *encoder,
+    const struct aws_http_message *http1_request);
+
 AWS_HTTP_API
 void aws_hpack_decoder_init(struct aws_hpack_decoder *decoder, struct aws_allocator *allocator, const void *log_id);
 
@@ -292,6 +477,31 @@ int aws_hpack_decode_string(
     struct aws_byte_buf *output,
     bool *complete);
 
+/**
+ * Prepare to decode a new Huffman-encoded string literal.
+ */
+AWS_HTTP_API
+void aws_hpack_huffman_decoder_reset(struct aws_hpack_huffman_decoder *decoder);
+
+/**
+ * Decode Huffman-encoded data (RFC-7541 5.2) into the output, which will grow if necessary.
+ * A string literal may be passed in several chunks, all of to_decode is always consumed.
+ * Decoding is done 4 bits at a time, through a state-transition table built from the HPACK Huffman code.
+ * An error is raised if the data contains the EOS symbol.
+ */
+AWS_HTTP_API
+int aws_hpack_huffman_decode(
+    struct aws_hpack_huffman_decoder *decoder,
+    struct aws_byte_cursor *to_decode,
+    struct aws_byte_buf *output);
+
+/**
+ * Call after the last chunk of a string literal has been decoded.
+ * Raises an error if the leftover padding bits aren't a prefix of EOS, or are longer than 7 bits (RFC-7541 5.2).
+ */
+AWS_HTTP_API
+int aws_hpack_huffman_decode_finish(const struct aws_hpack_huffman_decoder *decoder);
+
 AWS_EXTERN_C_END
 
 #endif /* AWS_HTTP_HPACK_H */
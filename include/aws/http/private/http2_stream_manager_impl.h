@@ -6,9 +6,15 @@
  * SPDX-License-Identifier: Apache-2.0.
  */
 
+#include <aws/common/array_list.h>
+#include <aws/common/atomics.h>
+#include <aws/common/linked_list.h>
 #include <aws/common/mutex.h>
 #include <aws/common/ref_count.h>
+#include <aws/http/content_decoding.h>
+#include <aws/http/content_encoding.h>
 #include <aws/http/http2_stream_manager.h>
+#include <aws/http/private/manager_histogram.h>
 #include <aws/http/private/random_access_set.h>
 
 enum aws_h2_sm_state_type {
@@ -32,6 +38,28 @@ struct aws_h2_sm_connection {
                                                      or failed to be created from the connection. */
     uint32_t max_concurrent_streams; /* lower bound between user configured and the other side */
 
+    /* With AWS_H2SM_CONNECTION_SELECTION_LEAST_LOADED only. Updated from the connection's thread, and read with the
+     * lock held to pick a connection. */
+    struct aws_atomic_var outstanding_bytes; /* Sum of the outstanding bytes of the streams made on the connection */
+    struct aws_atomic_var last_ping_rtt_ns;  /* 0 until a PING completes */
+
+    /* With enable_adaptive_concurrency only, protected by the stream manager's lock. max_concurrent_streams is the
+     * current limit then. */
+    struct {
+        uint32_t max_limit;       /* What the limit may grow to */
+        bool is_slow_start;       /* The limit grows with every stream until the first sign of congestion */
+        uint32_t success_count;   /* Streams completed since the limit last grew, after slow start */
+        uint32_t skip_count;      /* Streams left that were made before the limit last dropped */
+        uint64_t min_response_latency_ns;
+    } adaptive;
+
+    /* Protected by the stream manager's lock. Once the connection is about to stop taking streams, after a GOAWAY or
+     * as its stream ids run out, another one is acquired ahead of time. */
+    bool is_replacement_requested;
+    bool is_draining; /* No more streams are assigned to it, it's released once the ones it has finish */
+    /* In ideal_available_set or nonideal_available_set, protected by the stream manager's lock */
+    struct aws_random_access_set_node available_set_node;
+
     /* task to send ping periodically from connection thread. */
     struct aws_ref_count ref_count;
     struct aws_channel_task ping_task;
@@ -40,23 +68,113 @@ struct aws_h2_sm_connection {
         bool ping_received;
         bool stopped_new_requests;
         uint64_t next_ping_task_time;
+        bool is_low_on_stream_ids;
+        bool is_out_of_stream_ids;
     } thread_data;
 
     enum aws_h2_sm_connection_state_type state;
 };
 
+struct aws_h2_sm_hedge;
+
+/* One of the two streams of a hedged acquisition */
+struct aws_h2_sm_hedge_stream {
+    struct aws_h2_sm_hedge *hedge;
+    /* Set with a hold once the stream has a connection, so it can be cancelled from the other stream's thread */
+    struct aws_channel *channel;
+    /* Only touched from the channel's thread */
+    struct aws_http_stream *stream;
+    bool is_complete;
+    struct aws_channel_task cancel_task;
+};
+
+/**
+ * Shared by an acquisition that allows hedging and the duplicate acquisition made for it. Refcounted by the two
+ * acquisitions and the tasks scheduled for it. The user's on_destroy is invoked when the last ref goes.
+ */
+struct aws_h2_sm_hedge {
+    struct aws_allocator *allocator;
+    struct aws_ref_count ref_count;
+    struct aws_http2_stream_manager *stream_manager;
+    /* The user's options, to make the duplicate with */
+    struct aws_http_make_request_options options;
+    struct aws_http2_stream_priority http2_priority;
+    struct aws_http_content_decoding_options content_decoding;
+    /* Where the first stream was made. Only valid from its thread, until it completes */
+    struct aws_h2_sm_connection *primary_sm_connection;
+    struct aws_channel_task hedge_task;
+    /* The struct aws_h2_sm_hedge_stream whose callbacks the user sees, NULL until one of them is picked */
+    struct aws_atomic_var winner;
+    /* Streams made and not completed yet */
+    struct aws_atomic_var open_streams;
+    struct aws_h2_sm_hedge_stream primary;
+    struct aws_h2_sm_hedge_stream duplicate;
+};
+
+/**
+ * Shared by an acquisition that allows replay and the acquisitions made to send its request again, see
+ * `replay_buffer_size` in aws_http2_stream_manager_acquire_stream_options. Refcounted by the acquisitions.
+ * The user's on_destroy is invoked when the last ref goes. Only one of the acquisitions has a stream at a time, so it's
+ * only touched from the thread of that stream.
+ */
+struct aws_h2_sm_replay {
+    struct aws_allocator *allocator;
+    struct aws_ref_count ref_count;
+    aws_http_on_stream_destroy_fn *on_destroy;
+    void *user_data;
+    /* The request sent every time. Its body, if any, is read through a replay buffer */
+    struct aws_http_message *request;
+    /* The stream the user acquired. Held while the request is sent again, to report with if that can't be made */
+    struct aws_http_stream *acquired_stream;
+    size_t replays_count;
+    bool was_stream_made;
+};
+
 /* Live from the user request to acquire a stream to the stream completed. */
 struct aws_h2_sm_pending_stream_acquisition {
     struct aws_allocator *allocator;
     struct aws_linked_list_node node;
     struct aws_http_make_request_options options;
+    /* Copy of options.http2_priority, since the user's pointer may not outlive the acquisition */
+    struct aws_http2_stream_priority http2_priority;
+    /* Copy of options.content_decoding, without accept_encoding. That's added to the request as it's acquired */
+    struct aws_http_content_decoding_options content_decoding;
+    /* Copy of options.content_encoding, and storage for its content_coding. The request is encoded as it's made */
+    struct aws_http_content_encoding_options content_encoding;
+    struct aws_byte_buf content_coding_buf;
     struct aws_h2_sm_connection *sm_connection; /* The connection to make request to. Keep
                                                NULL, until find available one and move it to the pending_make_requests
                                                list. */
     struct aws_http_message *request;
     struct aws_channel_task make_request_task;
+    /* Acquisitions for the same connection, which make_request_task makes requests for too */
+    struct aws_linked_list make_request_batch;
     aws_http2_stream_manager_on_stream_acquired_fn *callback;
     void *user_data;
+    uint64_t acquire_timestamp;
+    /* This stream's share of sm_connection->outstanding_bytes. Only touched from the connection's thread */
+    size_t outstanding_request_bytes;
+    size_t outstanding_response_bytes;
+    /* For enable_adaptive_concurrency. From the stream activated to its response headers, on the connection's thread */
+    uint64_t activate_timestamp;
+    uint64_t response_timestamp;
+    /* NULL without hedging */
+    struct aws_h2_sm_hedge_stream *hedge_stream;
+    /* NULL without replay */
+    struct aws_h2_sm_replay *replay;
+    /* Made to send the request of another acquisition again. The user never owns its stream */
+    bool is_replay;
+    /* The user has seen the response start, so the request is no longer sent again */
+    bool is_response_started;
+};
+
+/* Stream managers that reuse each other's connections, see `coalescing_group` in aws_http2_stream_manager_options */
+struct aws_http2_stream_manager_coalescing_group {
+    struct aws_allocator *allocator;
+    struct aws_ref_count ref_count;
+    struct aws_mutex lock;
+    /* Protected by the lock. Intrusive list of struct aws_http2_stream_manager through coalescing.node */
+    struct aws_linked_list members;
 };
 
 /* connections_acquiring_count, open_stream_count, pending_make_requests_count AND pending_stream_acquisition_count */
@@ -114,11 +232,45 @@ struct aws_http2_stream_manager {
      */
     size_t max_concurrent_streams_per_connection;
 
+    enum aws_http2_stream_manager_connection_selection connection_selection;
+    bool enable_adaptive_concurrency;
+
+    /* 0 if hedging is off */
+    size_t hedging_budget_percent;
+    /* 0 to use hedge_latency_percentile of response_latency_histogram */
+    uint64_t hedge_delay_ns;
+    double hedge_latency_percentile;
+
     /**
      * Task to invoke pending acquisition callbacks asynchronously if stream manager is shutting.
      */
     struct aws_event_loop *finish_pending_stream_acquisitions_task_event_loop;
 
+    /**
+     * From a stream acquisition to its stream being activated, see aws_http_manager_latency_metrics.
+     * Recorded without the lock.
+     */
+    struct aws_http_atomic_histogram acquisition_wait_histogram;
+    /**
+     * From a stream being activated to its response headers, with hedging only. Recorded without the lock.
+     */
+    struct aws_http_atomic_histogram response_latency_histogram;
+
+    /* With a coalescing_group only */
+    struct {
+        struct aws_http2_stream_manager_coalescing_group *group;
+        struct aws_string *host;
+        uint16_t port;
+        /* struct aws_string * of the names the server certificate covers besides host */
+        struct aws_array_list certificate_names;
+        /* The rest is protected by the group's lock */
+        struct aws_linked_list_node node;
+        bool is_member;
+        bool is_resolved;
+        /* struct aws_string * of the addresses host resolved to */
+        struct aws_array_list addresses;
+    } coalescing;
+
     /* Any thread may touch this data, but the lock must be held (unless it's an atomic) */
     struct {
         struct aws_mutex lock;
@@ -130,16 +282,16 @@ struct aws_http2_stream_manager {
 
         /**
          * A set of all connections that meet all requirement to use. Note: there will be connections not in this set,
-         * but hold by the stream manager, which can be tracked by the streams created on it. Set of `struct
-         * aws_h2_sm_connection *`
+         * but hold by the stream manager, which can be tracked by the streams created on it. Intrusive set of `struct
+         * aws_h2_sm_connection` through available_set_node
          */
-        struct aws_random_access_set ideal_available_set;
+        struct aws_random_access_intrusive_set ideal_available_set;
         /**
          * A set of all available connections that exceed the soft limits set by users. Note: there will be connections
-         * not in this set, but hold by the stream manager, which can be tracked by the streams created. Set of `struct
-         * aws_h2_sm_connection *`
+         * not in this set, but hold by the stream manager, which can be tracked by the streams created. Intrusive
+         * set of `struct aws_h2_sm_connection` through available_set_node
          */
-        struct aws_random_access_set nonideal_available_set;
+        struct aws_random_access_intrusive_set nonideal_available_set;
         /* We don't mantain set for connections that is full or "dead" (Cannot make any new streams). We have streams
          * opening from the connection tracking them */
 
@@ -168,6 +320,10 @@ struct aws_http2_stream_manager {
         size_t internal_refcount_stats[AWS_SMCT_COUNT];
 
         bool finish_pending_stream_acquisitions_task_scheduled;
+
+        /* For the hedging budget: all the stream acquisitions, and the duplicates made for them */
+        size_t acquisitions_count;
+        size_t hedges_count;
     } synced_data;
 };
 
@@ -95,6 +95,12 @@ AWS_HTTP_API enum aws_http_header_name aws_http_str_to_header_name(struct aws_by
  */
 AWS_HTTP_API enum aws_http_header_name aws_http_lowercase_str_to_header_name(struct aws_byte_cursor cursor);
 
+/**
+ * Returns true for connection-specific header-fields, which an intermediary transforming an HTTP/1.x message
+ * to HTTP/2 MUST remove (RFC-9113 8.2.2). Host is included, since its value is sent as ":authority" instead.
+ */
+AWS_HTTP_API bool aws_http_header_name_is_connection_specific(enum aws_http_header_name name);
+
 AWS_EXTERN_C_END
 
 #endif /* AWS_HTTP_IMPL_H */
@@ -0,0 +1,42 @@
+#ifndef AWS_HTTP_MANAGER_HISTOGRAM_H
+#define AWS_HTTP_MANAGER_HISTOGRAM_H
+
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/connection_manager.h>
+
+#include <aws/common/atomics.h>
+
+/**
+ * The lock-free side of struct aws_http_manager_histogram, for recording durations from any thread.
+ *
+ * Each record is two relaxed atomic adds. A snapshot taken while records are happening may be missing some of them,
+ * or have a record's count without its duration in sum_us, but it never sees a torn value.
+ */
+struct aws_http_atomic_histogram {
+    struct aws_atomic_var buckets[AWS_HTTP_MANAGER_HISTOGRAM_BUCKET_COUNT];
+    struct aws_atomic_var sum_us;
+};
+
+AWS_EXTERN_C_BEGIN
+
+AWS_HTTP_API
+void aws_http_atomic_histogram_init(struct aws_http_atomic_histogram *histogram);
+
+/**
+ * Records the duration from start_ns to end_ns. A clock that went backwards records 0.
+ */
+AWS_HTTP_API
+void aws_http_atomic_histogram_record(struct aws_http_atomic_histogram *histogram, uint64_t start_ns, uint64_t end_ns);
+
+AWS_HTTP_API
+void aws_http_atomic_histogram_snapshot(
+    const struct aws_http_atomic_histogram *histogram,
+    struct aws_http_manager_histogram *out_histogram);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_HTTP_MANAGER_HISTOGRAM_H */
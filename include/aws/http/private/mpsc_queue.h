@@ -0,0 +1,57 @@
+#ifndef AWS_HTTP_MPSC_QUEUE_H
+#define AWS_HTTP_MPSC_QUEUE_H
+
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/http.h>
+
+#include <aws/common/atomics.h>
+#include <aws/common/linked_list.h>
+
+/**
+ * Lock-free intrusive queue with many producers and a single consumer.
+ * Any thread may push, only the consumer (ex: a connection's thread) may drain.
+ * Nodes are aws_linked_list_node, only their `next` pointer is used while queued,
+ * so whatever list the node goes into after draining may reuse it.
+ */
+struct aws_http_mpsc_queue {
+    /* Most recently pushed node, or NULL if empty, or a sentinel once closed */
+    struct aws_atomic_var head;
+};
+
+AWS_EXTERN_C_BEGIN
+
+AWS_HTTP_API
+void aws_http_mpsc_queue_init(struct aws_http_mpsc_queue *queue);
+
+/**
+ * Push a node, from any thread.
+ * Returns false if the queue has been closed, in which case the node isn't queued.
+ */
+AWS_HTTP_API
+bool aws_http_mpsc_queue_push(struct aws_http_mpsc_queue *queue, struct aws_linked_list_node *node);
+
+/**
+ * Move everything queued to the back of `out_list`, in the order it was pushed.
+ * Only the consumer may call this.
+ */
+AWS_HTTP_API
+void aws_http_mpsc_queue_drain(struct aws_http_mpsc_queue *queue, struct aws_linked_list *out_list);
+
+/**
+ * Drain the queue, and reject any further pushes.
+ * Only the consumer may call this.
+ */
+AWS_HTTP_API
+void aws_http_mpsc_queue_close(struct aws_http_mpsc_queue *queue, struct aws_linked_list *out_list);
+
+/* Returns true if nothing is queued. Only meaningful from the consumer */
+AWS_HTTP_API
+bool aws_http_mpsc_queue_is_empty(const struct aws_http_mpsc_queue *queue);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_HTTP_MPSC_QUEUE_H */
@@ -76,6 +76,8 @@ struct aws_http_proxy_user_data {
     enum aws_proxy_bootstrap_state state;
     int error_code;
     enum aws_http_status_code connect_status_code;
+    /* Keep-Alive timeout from the CONNECT response, passed on to the final connection */
+    uint64_t connect_keep_alive_timeout_ms;
 
     /*
      * The initial http connection object between the client and the proxy.
@@ -128,6 +130,9 @@ struct aws_http_proxy_user_data {
     struct aws_event_loop *requested_event_loop;
 
     const struct aws_host_resolution_config *host_resolution_config;
+
+    /* Tunneling only, the final connection reports its memory usage here */
+    struct aws_http_connection_memory_tracker *memory_tracker;
 };
 
 struct aws_http_proxy_system_vtable {
@@ -191,7 +196,7 @@ struct aws_http_proxy_strategy *aws_http_proxy_strategy_new_forwarding_identity(
 /**
  * Constructor for a tunneling proxy strategy that contains a set of sub-strategies which are tried
  * sequentially in order.  Each strategy has the choice to either proceed on a fresh connection or
- * reuse the current one.
+ * reuse the current one.  Negotiations after a successful one start from the sub-strategy it started with.
  *
  * @param allocator memory allocator to use
  * @param config sequence configuration options
@@ -82,5 +82,83 @@ int aws_random_access_set_exist(const struct aws_random_access_set *set, const v
 AWS_HTTP_API
 int aws_random_access_set_random_get_ptr_index(const struct aws_random_access_set *set, void **out, size_t index);
 
+/**
+ * Intrusive variant: each element embeds a node, which keeps its own index in the set's array. Insert, remove and get
+ * random element are constant time with no hashing and, once the array has grown, no allocation.
+ * An element can be in one set at a time through a node. Use AWS_CONTAINER_OF to get from a node to its element.
+ */
+struct aws_random_access_intrusive_set {
+    struct aws_array_list list; /* struct aws_random_access_set_node * */
+};
+
+/* Zero it before use, as a node that's in no set */
+struct aws_random_access_set_node {
+    const struct aws_random_access_intrusive_set *set;
+    size_t index;
+};
+
+/**
+ * Initialize the intrusive set.
+ *
+ * @param set                       Pointer of structure to initialize with
+ * @param allocator                 Allocator
+ * @param initial_item_allocation   The initial number of item to allocate.
+ * @return AWS_OP_ERR if any fails to initialize, AWS_OP_SUCCESS on success.
+ */
+AWS_HTTP_API
+int aws_random_access_intrusive_set_init(
+    struct aws_random_access_intrusive_set *set,
+    struct aws_allocator *allocator,
+    size_t initial_item_allocation);
+
+/**
+ * The nodes still in the set are left as they are.
+ */
+AWS_HTTP_API
+void aws_random_access_intrusive_set_clean_up(struct aws_random_access_intrusive_set *set);
+
+/**
+ * Insert the node to the end of the array. Nothing happens if it's in the set already, and it fails with
+ * AWS_ERROR_INVALID_ARGUMENT if it's in another set.
+ */
+AWS_HTTP_API
+int aws_random_access_intrusive_set_add(
+    struct aws_random_access_intrusive_set *set,
+    struct aws_random_access_set_node *node,
+    bool *added);
+
+/**
+ * Remove the node from the set, moving the end of the array to its place. Nothing happens if it's not in the set.
+ */
+AWS_HTTP_API
+void aws_random_access_intrusive_set_remove(
+    struct aws_random_access_intrusive_set *set,
+    struct aws_random_access_set_node *node);
+
+/**
+ * Get a random node from the set. Fails when the set is empty.
+ */
+AWS_HTTP_API
+int aws_random_access_intrusive_set_random_get(
+    const struct aws_random_access_intrusive_set *set,
+    struct aws_random_access_set_node **out);
+
+/**
+ * Get the node currently stored at that index, which changes as nodes are removed.
+ */
+AWS_HTTP_API
+int aws_random_access_intrusive_set_get_at_index(
+    const struct aws_random_access_intrusive_set *set,
+    struct aws_random_access_set_node **out,
+    size_t index);
+
+AWS_HTTP_API
+size_t aws_random_access_intrusive_set_get_size(const struct aws_random_access_intrusive_set *set);
+
+AWS_HTTP_API
+bool aws_random_access_intrusive_set_contains(
+    const struct aws_random_access_intrusive_set *set,
+    const struct aws_random_access_set_node *node);
+
 AWS_EXTERN_C_END
 #endif /* AWS_HTTP_RANDOM_ACCESS_SET_H */
@@ -0,0 +1,30 @@
+#ifndef AWS_HTTP_REPLAY_BODY_H
+#define AWS_HTTP_REPLAY_BODY_H
+
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/http.h>
+
+struct aws_http_message;
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Create the request to actually send in place of `request`, so it can be sent again if its stream fails: the same,
+ * but with its body stream read through a replay buffer, which keeps the first `replay_buffer_size` bytes read.
+ * The new body stream can seek back to the start (AWS_SSB_BEGIN, offset 0) as long as no more than that was read,
+ * which is the only seek it supports. It never seeks the original body stream, so that needn't be seekable.
+ * `request` must have a body stream.
+ */
+AWS_HTTP_API
+struct aws_http_message *aws_http_replay_body_new_request(
+    struct aws_allocator *allocator,
+    struct aws_http_message *request,
+    size_t replay_buffer_size);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_HTTP_REPLAY_BODY_H */
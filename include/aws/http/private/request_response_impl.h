@@ -19,6 +19,9 @@ struct aws_http_stream_vtable {
 
     int (*http1_write_chunk)(struct aws_http_stream *http1_stream, const struct aws_http1_chunk_options *options);
     int (*http1_add_trailer)(struct aws_http_stream *http1_stream, const struct aws_http_headers *trailing_headers);
+    int (*http1_send_static_response)(
+        struct aws_http_stream *http1_stream,
+        const struct aws_http1_static_response *static_response);
 
     int (*http2_reset_stream)(struct aws_http_stream *http2_stream, uint32_t http2_error);
     int (*http2_get_received_error_code)(struct aws_http_stream *http2_stream, uint32_t *http2_error);
@@ -26,6 +29,7 @@ struct aws_http_stream_vtable {
     int (*http2_write_data)(
         struct aws_http_stream *http2_stream,
         const struct aws_http2_stream_write_data_options *options);
+    int (*http2_notify_body_ready)(struct aws_http_stream *http2_stream);
 };
 
 /**
@@ -43,10 +47,15 @@ struct aws_http_stream {
     aws_http_on_incoming_headers_fn *on_incoming_headers;
     aws_http_on_incoming_header_block_done_fn *on_incoming_header_block_done;
     aws_http_on_incoming_body_fn *on_incoming_body;
+    /* If set, used instead of on_incoming_body. See aws_http_leased_message_deliver_body() */
+    aws_http_on_incoming_body_lease_fn *on_incoming_body_lease;
     aws_http_on_stream_metrics_fn *on_metrics;
     aws_http_on_stream_complete_fn *on_complete;
     aws_http_on_stream_destroy_fn *on_destroy;
 
+    /* Set if the response body is decoded, see aws_http_stream_content_decoding_init() */
+    struct aws_http_content_decoding *content_decoding;
+
     struct aws_atomic_var refcount;
     enum aws_http_method request_method;
     struct aws_http_stream_metrics metrics;
@@ -68,4 +77,29 @@ struct aws_http_stream {
     struct aws_http_stream_server_data *server_data;
 };
 
+/**
+ * Body stream created by aws_http_body_segments_stream_new().
+ * Connections that can send caller-owned memory without copying use these functions
+ * to take segments directly, instead of reading them via aws_input_stream_read().
+ */
+struct aws_http_body_segments_stream;
+
+/* Returns NULL if body_stream wasn't created by aws_http_body_segments_stream_new() */
+struct aws_http_body_segments_stream *aws_http_body_segments_stream_from_input_stream(
+    struct aws_input_stream *body_stream);
+
+/* Returns length of the unread portion of the next non-empty segment, or 0 if all segments have been consumed */
+size_t aws_http_body_segments_stream_get_next_len(struct aws_http_body_segments_stream *segments_stream);
+
+/* Take the unread portion of the next non-empty segment.
+ * The caller becomes responsible for invoking the segment's on_release callback.
+ * Returns false if all segments have been consumed. */
+bool aws_http_body_segments_stream_take_next(
+    struct aws_http_body_segments_stream *segments_stream,
+    struct aws_http_body_segment *out_segment);
+
+/* If the stream's request has been sent, raise *max_latency_ms to how long the stream waited for the
+ * first byte of its response, or has been waiting so far if none has arrived yet. */
+void aws_http_stream_update_max_first_byte_latency(const struct aws_http_stream *stream, uint64_t *max_latency_ms);
+
 #endif /* AWS_HTTP_REQUEST_RESPONSE_IMPL_H */
@@ -0,0 +1,28 @@
+#ifndef AWS_HTTP_SIMD_H
+#define AWS_HTTP_SIMD_H
+
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/http.h>
+
+/* Pick a 128bit vector instruction set for scanning text 16 bytes at a time.
+ * SSE2 and NEON are baseline on x86-64 and AArch64, so no runtime detection is needed.
+ * If neither AWS_HTTP_SIMD_SSE2 nor AWS_HTTP_SIMD_NEON is defined, callers fall back to scalar code. */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define AWS_HTTP_SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#    include <arm_neon.h>
+#    define AWS_HTTP_SIMD_NEON
+
+/* NEON has no movemask. Narrowing each 16bit lane of a 0x00/0xFF comparison result with a shift of 4
+ * leaves a 64bit mask with 4 bits per byte, so byte i of the vector maps to bits [4*i, 4*i+3]. */
+static inline uint64_t aws_http_neon_nibble_mask(uint8x16_t comparison) {
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(comparison), 4)), 0);
+}
+#endif
+
+#endif /* AWS_HTTP_SIMD_H */
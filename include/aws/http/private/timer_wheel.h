@@ -0,0 +1,80 @@
+#ifndef AWS_HTTP_TIMER_WHEEL_H
+#define AWS_HTTP_TIMER_WHEEL_H
+
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/common/linked_list.h>
+#include <aws/http/http.h>
+
+struct aws_event_loop;
+struct aws_http_timer_wheel;
+struct aws_http_timer_wheel_entry;
+
+/* Granularity of the wheel. Entries never expire early, but may expire up to one tick late */
+#define AWS_HTTP_TIMER_WHEEL_TICK_MS 100
+#define AWS_HTTP_TIMER_WHEEL_NUM_SLOTS 1024
+
+/**
+ * Invoked on the event-loop thread when an entry's deadline passes.
+ * The entry is already disarmed, it may be scheduled again from the callback.
+ */
+typedef void(aws_http_timer_wheel_on_expired_fn)(struct aws_http_timer_wheel_entry *entry, void *user_data);
+
+/**
+ * A deadline filed in an aws_http_timer_wheel. Embed in the object being timed.
+ * Treat members as private.
+ */
+struct aws_http_timer_wheel_entry {
+    struct aws_linked_list_node node;
+    aws_http_timer_wheel_on_expired_fn *on_expired;
+    void *user_data;
+    /* Zero when the entry isn't armed */
+    uint64_t deadline_ns;
+    /* Tick of the slot the entry is filed in. Pushing a deadline later just updates deadline_ns,
+     * and the entry is moved when its old slot comes around, so touching an entry costs no list work */
+    uint64_t filed_tick;
+};
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Get the event-loop's timer wheel, creating it on first use.
+ * There's one wheel per event-loop, shared by every connection on it, and it lives as long as the event-loop.
+ * The wheel's task only runs while some entry is armed.
+ * Must be called on the event-loop's thread. Returns NULL and raises an error if the wheel can't be created.
+ */
+AWS_HTTP_API
+struct aws_http_timer_wheel *aws_http_timer_wheel_get(struct aws_event_loop *event_loop);
+
+AWS_HTTP_API
+void aws_http_timer_wheel_entry_init(
+    struct aws_http_timer_wheel_entry *entry,
+    aws_http_timer_wheel_on_expired_fn *on_expired,
+    void *user_data);
+
+/**
+ * Arm the entry to expire at deadline_ns (event-loop clock), replacing any earlier deadline.
+ * O(1). Must be called on the event-loop's thread.
+ */
+AWS_HTTP_API
+void aws_http_timer_wheel_schedule(
+    struct aws_http_timer_wheel *wheel,
+    struct aws_http_timer_wheel_entry *entry,
+    uint64_t deadline_ns);
+
+/**
+ * Disarm the entry. Safe to call if it isn't armed.
+ * O(1). Must be called on the event-loop's thread.
+ */
+AWS_HTTP_API
+void aws_http_timer_wheel_cancel(struct aws_http_timer_wheel *wheel, struct aws_http_timer_wheel_entry *entry);
+
+AWS_HTTP_API
+bool aws_http_timer_wheel_entry_is_armed(const struct aws_http_timer_wheel_entry *entry);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_HTTP_TIMER_WHEEL_H */
@@ -0,0 +1,31 @@
+#ifndef AWS_HTTP_TRACING_IMPL_H
+#define AWS_HTTP_TRACING_IMPL_H
+
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/tracing.h>
+
+/**
+ * Fire a tracepoint, see enum aws_http_trace_event.
+ * Compiles to nothing, arguments included, unless the library is built with AWS_HTTP_ENABLE_TRACING.
+ */
+#ifdef AWS_HTTP_ENABLE_TRACING
+#    define AWS_HTTP_TRACE(event, id, arg1, arg2)                                                                      \
+        aws_http_trace((event), (const void *)(id), (uint64_t)(arg1), (uint64_t)(arg2))
+#else
+#    define AWS_HTTP_TRACE(event, id, arg1, arg2)
+#endif
+
+AWS_EXTERN_C_BEGIN
+
+#ifdef AWS_HTTP_ENABLE_TRACING
+AWS_HTTP_API
+void aws_http_trace(enum aws_http_trace_event event, const void *id, uint64_t arg1, uint64_t arg2);
+#endif
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_HTTP_TRACING_IMPL_H */
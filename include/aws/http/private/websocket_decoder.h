@@ -14,6 +14,19 @@ typedef int(aws_websocket_decoder_frame_fn)(const struct aws_websocket_frame *fr
 /* Called repeatedly as the payload is decoded. If a mask was used, the data has been unmasked. */
 typedef int(aws_websocket_decoder_payload_fn)(struct aws_byte_cursor data, void *user_data);
 
+/**
+ * Incremental UTF-8 validation, for payloads that arrive in pieces.
+ * Zero-initialized, it's ready to validate the start of a message.
+ */
+struct aws_websocket_utf8_validator {
+    /* Bits of the codepoint being decoded, while remaining_bytes is non-zero */
+    uint32_t codepoint;
+    /* Smallest codepoint its encoding's length can legally hold, to catch overlong encodings */
+    uint32_t min_codepoint;
+    /* Continuation bytes still expected for the current codepoint */
+    uint8_t remaining_bytes;
+};
+
 /**
  * Each state consumes data and/or moves decoder to a subsequent state.
  */
@@ -42,7 +55,7 @@ struct aws_websocket_decoder {
     /* True while processing a TEXT "message" (from the start of a TEXT frame,
      * until the end of the TEXT or CONTINUATION frame with the FIN bit set). */
     bool processing_text_message;
-    struct aws_utf8_decoder *text_message_validator;
+    struct aws_websocket_utf8_validator text_message_validator;
 
     void *user_data;
     aws_websocket_decoder_frame_fn *on_frame;
@@ -74,6 +87,28 @@ AWS_HTTP_API int aws_websocket_decoder_process(
     struct aws_byte_cursor *data,
     bool *frame_complete);
 
+/**
+ * Validate the next `len` bytes of a UTF-8 message.
+ * If `masking_key` is non-NULL, the bytes are first unmasked in place, like aws_websocket_mask_payload(),
+ * in the same pass over the data.
+ * Runs of ASCII are checked 16 or 8 bytes at a time.
+ * Raises AWS_ERROR_INVALID_UTF8 as soon as the data can't be valid UTF-8. The payload may be partially unmasked then.
+ */
+AWS_HTTP_API
+int aws_websocket_utf8_validator_update(
+    struct aws_websocket_utf8_validator *validator,
+    uint8_t *payload,
+    size_t len,
+    const uint8_t *masking_key,
+    uint64_t mask_offset);
+
+/**
+ * Check that the message didn't end partway through a codepoint, and reset the validator for the next message.
+ * Raises AWS_ERROR_INVALID_UTF8 if it did.
+ */
+AWS_HTTP_API
+int aws_websocket_utf8_validator_finalize(struct aws_websocket_utf8_validator *validator);
+
 AWS_EXTERN_C_END
 
 #endif /* AWS_HTTP_WEBSOCKET_DECODER_H */
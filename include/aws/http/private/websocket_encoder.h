@@ -52,6 +52,15 @@ bool aws_websocket_encoder_is_frame_in_progress(const struct aws_websocket_encod
 AWS_HTTP_API
 int aws_websocket_encoder_process(struct aws_websocket_encoder *encoder, struct aws_byte_buf *out_buf);
 
+/**
+ * Account for `len` bytes of an unmasked frame's payload that the caller sends on its own,
+ * rather than through aws_websocket_encoder_process().
+ * Only valid once the frame's header has been written, and the encoder is waiting on payload.
+ * The frame is done once the whole payload is accounted for.
+ */
+AWS_HTTP_API
+int aws_websocket_encoder_take_payload(struct aws_websocket_encoder *encoder, uint64_t len);
+
 AWS_EXTERN_C_END
 
 #endif /* AWS_HTTP_WEBSOCKET_ENCODER_H */
@@ -11,6 +11,8 @@
 struct aws_http_client_connection_options;
 struct aws_http_connection;
 struct aws_http_make_request_options;
+struct aws_http_stream;
+struct aws_websocket_h2_transport;
 
 /* RFC-6455 Section 5.2 Base Framing Protocol
  * Payload length:  7 bits, 7+16 bits, or 7+64 bits
@@ -65,6 +67,15 @@ struct aws_websocket_handler_options {
 
     bool is_server;
     bool manual_window_update;
+    /* The permessage-deflate extension was negotiated, so messages may be compressed */
+    bool permessage_deflate;
+    /* See aws_websocket_client_connection_options.max_write_messages_in_flight */
+    size_t max_write_messages_in_flight;
+    /* See aws_websocket_client_connection_options.write_coalescing_delay_us */
+    uint32_t write_coalescing_delay_us;
+    /* See aws_websocket_client_connection_options.on_incoming_message */
+    aws_websocket_on_incoming_message_fn *on_incoming_message;
+    size_t max_incoming_message_size;
 };
 
 struct aws_websocket_client_bootstrap_system_vtable {
@@ -97,12 +108,53 @@ const char *aws_websocket_opcode_str(uint8_t opcode);
 AWS_HTTP_API
 uint64_t aws_websocket_frame_encoded_size(const struct aws_websocket_frame *frame);
 
+/**
+ * XOR the payload bytes against the masking-key, in place (RFC-6455 Section 5.3).
+ * mask_offset is how many bytes of the frame's payload came before these, so a payload can be masked in pieces.
+ * Works 16 or 8 bytes at a time, so it's much faster than masking byte by byte.
+ */
+AWS_HTTP_API
+void aws_websocket_mask_payload(uint8_t *payload, size_t len, const uint8_t masking_key[4], uint64_t mask_offset);
+
+/**
+ * Returns false once the websocket is closing, has stopped writing, or has converted to a midchannel handler.
+ * The websocket manager checks this before vending a released websocket again.
+ */
+AWS_HTTP_API
+bool aws_websocket_is_open(struct aws_websocket *websocket);
+
 /**
  * Create a websocket channel-handler and insert it into the channel.
  */
 AWS_HTTP_API
 struct aws_websocket *aws_websocket_handler_new(const struct aws_websocket_handler_options *options);
 
+/**
+ * Create a channel-handler that carries the channel's data as the DATA of an HTTP/2 stream, for websockets over
+ * HTTP/2 (RFC-8441), and insert it into the channel. It must be the channel's first handler.
+ * The stream must use http2_use_manual_data_writes, be on the channel's event-loop, and outlive the channel.
+ */
+AWS_HTTP_API
+struct aws_websocket_h2_transport *aws_websocket_h2_transport_new(
+    struct aws_allocator *allocator,
+    struct aws_channel *channel,
+    struct aws_http_stream *stream);
+
+/**
+ * Pass DATA received on the stream up the channel.
+ * Data that the channel's read window can't take yet is kept until it can.
+ */
+AWS_HTTP_API
+int aws_websocket_h2_transport_on_stream_body(
+    struct aws_websocket_h2_transport *transport,
+    struct aws_byte_cursor data);
+
+/**
+ * The stream has completed, shut down the channel.
+ */
+AWS_HTTP_API
+void aws_websocket_h2_transport_on_stream_complete(struct aws_websocket_h2_transport *transport, int error_code);
+
 /**
  * Override the functions that websocket bootstrap uses to interact with external systems.
  * Used for unit testing.
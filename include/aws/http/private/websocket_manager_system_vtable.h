@@ -0,0 +1,36 @@
+#ifndef AWS_HTTP_WEBSOCKET_MANAGER_SYSTEM_VTABLE_H
+#define AWS_HTTP_WEBSOCKET_MANAGER_SYSTEM_VTABLE_H
+
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/websocket_manager.h>
+
+#include <aws/io/io.h>
+
+struct aws_websocket_manager_system_vtable {
+    int (*aws_websocket_client_connect)(const struct aws_websocket_client_connection_options *options);
+    int (*aws_websocket_send_frame)(
+        struct aws_websocket *websocket,
+        const struct aws_websocket_send_frame_options *options);
+    void (*aws_websocket_close)(struct aws_websocket *websocket, bool free_scarce_resources_immediately);
+    void (*aws_websocket_release)(struct aws_websocket *websocket);
+    bool (*aws_websocket_is_open)(struct aws_websocket *websocket);
+    aws_io_clock_fn *get_monotonic_time;
+};
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Override the functions that websocket managers use to interact with external systems.
+ * Applies to managers created afterwards. Pass NULL to go back to the defaults.
+ * Used for unit testing.
+ */
+AWS_HTTP_API
+void aws_websocket_manager_set_system_vtable(const struct aws_websocket_manager_system_vtable *system_vtable);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_HTTP_WEBSOCKET_MANAGER_SYSTEM_VTABLE_H */
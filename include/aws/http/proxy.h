@@ -445,6 +445,9 @@ struct aws_http_proxy_strategy *aws_http_proxy_strategy_new_basic_auth(
  * fails it may make followup CONNECT attempts using kerberos or ntlm tokens, based on configuration and proxy
  * response properties.
  *
+ * Once an attempt succeeds, later connections using the same strategy (all of a connection manager's, for example)
+ * start with the attempt that worked, rather than paying for the vanilla CONNECT's 407 again.
+ *
  * @param allocator memory allocator to use
  * @param config configuration options for the strategy
  * @return a new proxy strategy if successfully constructed, otherwise NULL
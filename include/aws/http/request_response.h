@@ -13,6 +13,8 @@
 AWS_PUSH_SANE_WARNING_LEVEL
 
 struct aws_http_connection;
+struct aws_http_content_decoding_options;
+struct aws_http_content_encoding_options;
 struct aws_input_stream;
 
 /**
@@ -23,6 +25,18 @@ struct aws_input_stream;
  */
 struct aws_http_stream;
 
+/**
+ * A pre-validated, pre-serialized request head shared by many HTTP/1.1 requests.
+ * See aws_http1_request_template_new().
+ */
+struct aws_http1_request_template;
+
+/**
+ * A pre-validated, pre-serialized HTTP/1.1 response (head and body) shared by many request handler streams.
+ * See aws_http1_static_response_new().
+ */
+struct aws_http1_static_response;
+
 /**
  * Controls whether a header's strings may be compressed by encoding the index of
  * strings in a cache, rather than encoding the literal string.
@@ -107,6 +121,12 @@ enum aws_http_header_block {
  */
 struct aws_http_message;
 
+/**
+ * Keeps blank HTTP/1.1 request messages around for reuse, so issuing requests in a steady state doesn't allocate.
+ * A pool is not thread-safe, use one per thread or per event-loop.
+ */
+struct aws_http_message_pool;
+
 /**
  * Function to invoke when a message transformation completes.
  * This function MUST be invoked or the application will soft-lock.
@@ -176,6 +196,32 @@ typedef int(aws_http_on_incoming_header_block_done_fn)(
 typedef int(
     aws_http_on_incoming_body_fn)(struct aws_http_stream *stream, const struct aws_byte_cursor *data, void *user_data);
 
+/**
+ * A lease on body data, pointing straight into the buffer the connection read it into.
+ * See `aws_http_on_incoming_body_lease_fn`.
+ */
+struct aws_http_body_lease;
+
+/**
+ * Called repeatedly as body data is received, like `aws_http_on_incoming_body_fn`, but without the need to copy.
+ * The lease is valid during the callback. To keep the data for longer, call aws_http_body_lease_acquire()
+ * during the callback, and aws_http_body_lease_release() once done with it, from any thread.
+ * This is always invoked on the HTTP connection's event-loop thread.
+ *
+ * Until all the leases on a buffer are released, the buffer can't be reused, and the connection stays alive.
+ * On HTTP/1.1 connections using manual_window_management, leased data counts against the connection's read window,
+ * so a slow consumer holding leases stops more data from being read.
+ * On HTTP/2 connections, leased data counts against any read window budget (see `read_window_budget` in
+ * `aws_http_connection_manager_options`).
+ *
+ * Return AWS_OP_SUCCESS to continue processing the stream.
+ * Return AWS_OP_ERR to indicate failure and cancel the stream.
+ */
+typedef int(aws_http_on_incoming_body_lease_fn)(
+    struct aws_http_stream *stream,
+    struct aws_http_body_lease *lease,
+    void *user_data);
+
 /**
  * Invoked when request has been completely read.
  * This is always invoked on the HTTP connection's event-loop thread.
@@ -225,6 +271,47 @@ struct aws_http_stream_metrics {
 
     /* The stream-id on the connection when this stream was activated. */
     uint32_t stream_id;
+
+    /* The time stamp when aws_http_stream_activate() succeeded. -1 means data not available.
+     * Timestamp are from `aws_high_res_clock_get_ticks` */
+    int64_t activate_timestamp_ns;
+    /* The time stamp when the main (non-informational) response headers finished being received.
+     * -1 means data not available. Timestamp are from `aws_high_res_clock_get_ticks` */
+    int64_t receive_headers_end_timestamp_ns;
+    /* For a stream from an aws_http2_stream_manager, the time from aws_http2_stream_manager_acquire_stream()
+     * to the stream being activated on a connection. -1 means data not available. */
+    int64_t connection_acquisition_wait_ns;
+};
+
+/**
+ * Default urgency for an HTTP/2 stream (RFC-9218 4.1).
+ */
+#define AWS_HTTP2_PRIORITY_URGENCY_DEFAULT 3
+
+/**
+ * Least urgent value for an HTTP/2 stream (RFC-9218 4.1).
+ * Urgency 0 is the most urgent.
+ */
+#define AWS_HTTP2_PRIORITY_URGENCY_MAX 7
+
+/**
+ * Priority of an HTTP/2 stream, using the parameters of Extensible Priorities (RFC-9218).
+ * The connection uses this to decide which stream's DATA is sent first.
+ * Priority signals from the peer (PRIORITY frames) are still ignored, so the peer cannot make the
+ * connection do reprioritization work (CVE-2019-9513).
+ */
+struct aws_http2_stream_priority {
+    /**
+     * 0 (most urgent) to AWS_HTTP2_PRIORITY_URGENCY_MAX (least urgent).
+     * DATA from a more urgent stream is always sent before DATA from a less urgent stream.
+     */
+    uint8_t urgency;
+
+    /**
+     * If true, the stream takes turns sending DATA with other incremental streams of the same urgency.
+     * If false, the stream sends all its DATA before other streams of the same urgency get a turn.
+     */
+    bool incremental;
 };
 
 /**
@@ -300,6 +387,48 @@ struct aws_http_make_request_options {
      * when data has been supplied via `aws_http2_stream_write_data`
      */
     bool http2_use_manual_data_writes;
+
+    /**
+     * HTTP/2 scheduling priority for the request's DATA frames.
+     * Optional.
+     * If NULL, the request's "priority" header (RFC-9218) is used if present.
+     * If there is no such header either, the stream has urgency AWS_HTTP2_PRIORITY_URGENCY_DEFAULT and is
+     * incremental, meaning it takes turns with all other streams.
+     * This setting has no effect on HTTP/1.x connections.
+     */
+    const struct aws_http2_stream_priority *http2_priority;
+
+    /**
+     * Optional.
+     * HTTP/1.1 only. The method and headers every request like this one shares,
+     * see aws_http1_request_template_new().
+     * The template's headers are sent first, followed by the request's own headers.
+     * The request's method may be left unset, in which case the template's method is used.
+     * The template is copied into the stream, so it may be destroyed once the stream is created.
+     */
+    const struct aws_http1_request_template *http1_request_template;
+
+    /**
+     * Invoked repeatedly as body data is received, instead of `on_response_body`.
+     * Optional.
+     * See `aws_http_on_incoming_body_lease_fn`.
+     */
+    aws_http_on_incoming_body_lease_fn *on_response_body_lease;
+
+    /**
+     * Optional.
+     * Decode the response body according to its Content-Encoding, see aws_http_content_decoding_options.
+     * The options are copied when the stream is created.
+     * Can't be used with `on_response_body_lease`, since decoded data isn't in the connection's read buffers.
+     */
+    const struct aws_http_content_decoding_options *content_decoding;
+
+    /**
+     * Optional.
+     * Encode the request body as it's sent, see aws_http_content_encoding_options.
+     * The request is sent with a Content-Encoding header, `request` itself isn't modified.
+     */
+    const struct aws_http_content_encoding_options *content_encoding;
 };
 
 struct aws_http_request_handler_options {
@@ -385,6 +514,38 @@ typedef void aws_http_stream_write_complete_fn(struct aws_http_stream *stream, i
  */
 typedef aws_http_stream_write_complete_fn aws_http1_stream_write_chunk_complete_fn;
 
+/**
+ * Invoked when the memory of an outgoing body segment is no longer in use.
+ * See aws_http_body_segments_stream_new().
+ * This may be invoked on any thread, but never more than once per segment.
+ *
+ * @param user_data     User data for this segment.
+ */
+typedef void aws_http_body_segment_release_fn(void *user_data);
+
+/**
+ * A piece of an outgoing body that lives in caller-owned memory.
+ * See aws_http_body_segments_stream_new().
+ */
+struct aws_http_body_segment {
+    /**
+     * The data to send.
+     * The memory must remain valid until on_release is invoked.
+     */
+    struct aws_byte_cursor data;
+
+    /**
+     * Optional.
+     * Invoked when the data is no longer in use.
+     */
+    aws_http_body_segment_release_fn *on_release;
+
+    /**
+     * User provided data passed to the on_release callback on its invocation.
+     */
+    void *user_data;
+};
+
 /**
  * HTTP/1.1 chunk extension for chunked encoding.
  * Note that the underlying strings are not owned by the byte cursors.
@@ -466,6 +627,16 @@ struct aws_http2_stream_write_data_options {
      */
     struct aws_input_stream *data;
 
+    /**
+     * Caller-owned data to be sent, as an alternative to `data`.
+     * Optional.
+     * Large payloads are handed to the channel directly, instead of being copied into an intermediate buffer.
+     * The memory must remain valid and unmodified until `on_complete` is invoked,
+     * which happens once the channel is done with it, whether or not it was successfully sent.
+     * It is an error to set both `data` and `data_buffer`.
+     */
+    struct aws_byte_cursor data_buffer;
+
     /**
      * Set true when it's the last chunk to be sent.
      * After a write with end_stream, no more data write will be accepted.
@@ -510,6 +681,28 @@ bool aws_http_header_name_eq(struct aws_byte_cursor name_a, struct aws_byte_curs
 AWS_HTTP_API
 struct aws_http_headers *aws_http_headers_new(struct aws_allocator *allocator);
 
+/**
+ * Create a new headers object, with storage reserved up front for about `header_count` headers.
+ * This is only a hint: the object grows as needed if more headers are added.
+ * The caller has a hold on the object and must call aws_http_headers_release() when they are done with it.
+ */
+AWS_HTTP_API
+struct aws_http_headers *aws_http_headers_new_with_capacity(struct aws_allocator *allocator, size_t header_count);
+
+/**
+ * Create a new headers object layered over a shared `base`.
+ * The new object starts out containing all of the base's headers, without copying them.
+ * Headers added to it come after the base's, and are only visible through the new object.
+ * Erasing or replacing any of the base's headers (or adding a pseudo-header that must go in front of them)
+ * copies the base's headers into the new object first, so the base itself is never modified.
+ *
+ * This lets many requests share a common set of headers, each with a few headers of its own.
+ * The new object acquires a hold on `base`. The base must not be modified while layered objects use it.
+ * The caller has a hold on the object and must call aws_http_headers_release() when they are done with it.
+ */
+AWS_HTTP_API
+struct aws_http_headers *aws_http_headers_new_layered(struct aws_allocator *allocator, struct aws_http_headers *base);
+
 /**
  * Acquire a hold on the object, preventing it from being deleted until
  * aws_http_headers_release() is called by all those with a hold on it.
@@ -788,6 +981,46 @@ struct aws_http_message *aws_http_message_release(struct aws_http_message *messa
 AWS_HTTP_API
 void aws_http_message_destroy(struct aws_http_message *message);
 
+/**
+ * Return the message to a blank state, so it can be reused for another message of the same kind and version.
+ * Clears the method, path, status, headers, and body stream, but keeps allocated capacity for reuse.
+ * If the headers are also held elsewhere (see aws_http_message_new_request_with_headers()),
+ * the message lets go of them and gets new ones, rather than clearing them out from under the other holder.
+ *
+ * Do not reset a message while a stream is using it.
+ */
+AWS_HTTP_API
+int aws_http_message_reset(struct aws_http_message *message);
+
+/**
+ * Create a pool that keeps up to `max_messages` request messages for reuse.
+ */
+AWS_HTTP_API
+struct aws_http_message_pool *aws_http_message_pool_new(struct aws_allocator *allocator, size_t max_messages);
+
+/**
+ * Destroy the pool, and release every message it's keeping.
+ * Messages acquired from the pool remain valid, release them as usual.
+ */
+AWS_HTTP_API
+void aws_http_message_pool_destroy(struct aws_http_message_pool *pool);
+
+/**
+ * Get a blank HTTP/1.1 request message, reusing one from the pool if possible.
+ * The caller has a hold on the message and should return it with aws_http_message_pool_release()
+ * (aws_http_message_release() works too, but the message won't be reused).
+ */
+AWS_HTTP_API
+struct aws_http_message *aws_http_message_pool_acquire_request(struct aws_http_message_pool *pool);
+
+/**
+ * Release a hold on the message, keeping it for reuse if possible.
+ * The message is reset and kept if the caller held the only hold on it, it's an HTTP/1.1 request,
+ * and the pool isn't full. Otherwise this is equivalent to aws_http_message_release().
+ */
+AWS_HTTP_API
+void aws_http_message_pool_release(struct aws_http_message_pool *pool, struct aws_http_message *message);
+
 AWS_HTTP_API
 bool aws_http_message_is_request(const struct aws_http_message *message);
 
@@ -857,6 +1090,52 @@ struct aws_input_stream *aws_http_message_get_body_stream(const struct aws_http_
 AWS_HTTP_API
 void aws_http_message_set_body_stream(struct aws_http_message *message, struct aws_input_stream *body_stream);
 
+/**
+ * Create a body stream that sends caller-owned memory, without taking a copy.
+ * The segments are sent in order, and each segment's on_release callback fires
+ * once its data is no longer in use.
+ *
+ * HTTP/1.1 connections pass large segments straight down the channel, so on_release
+ * fires when the data has been written to the network.
+ * Anywhere else, the stream behaves like any other body stream: its data is copied
+ * as it's read, and on_release fires once the segment has been read.
+ * Any segments remaining when the stream is destroyed are released then.
+ *
+ * The segment array itself is copied, and need not outlive this call.
+ * The stream can't seek, since segments are released as they're consumed.
+ * Returns NULL and raises an error if the stream could not be created,
+ * in which case no on_release callbacks are invoked.
+ */
+AWS_HTTP_API
+struct aws_input_stream *aws_http_body_segments_stream_new(
+    struct aws_allocator *allocator,
+    const struct aws_http_body_segment *segments,
+    size_t segment_count);
+
+/**
+ * Create a body stream that sends `length` bytes of a file, starting at `offset`,
+ * without reading them into user-space buffers.
+ * The range is memory-mapped, and delivered as segments (see aws_http_body_segments_stream_new()),
+ * so HTTP/1.1 connections write the file's pages straight down the channel.
+ * The mapping is released once every byte is sent, or the stream is destroyed.
+ *
+ * The file is only open while this call runs.
+ * Only use this for files that won't change while the stream is alive.
+ * If the file is truncated, reading the missing pages kills the process
+ * (SIGBUS on POSIX, an unhandled in-page exception on Windows) and there's no error to handle.
+ * Bytes overwritten in place may be sent as either the old or new data.
+ * For a file that other processes may modify, use aws_input_stream_new_from_file(), which reads copies.
+ * Use aws_file_get_length() to find the length of the whole file.
+ * Returns NULL and raises an error if the file can't be opened and mapped,
+ * or if the range extends past the end of the file.
+ */
+AWS_HTTP_API
+struct aws_input_stream *aws_http_body_stream_new_from_file(
+    struct aws_allocator *allocator,
+    const char *file_path,
+    uint64_t offset,
+    uint64_t length);
+
 /**
  * aws_future<aws_http_message*>
  */
@@ -913,6 +1192,22 @@ AWS_HTTP_API int aws_http2_stream_write_data(
     struct aws_http_stream *http2_stream,
     const struct aws_http2_stream_write_data_options *options);
 
+/**
+ * Notify an HTTP/2 stream that its request body stream has more data available.
+ *
+ * When every body stream on a connection has no data available (aws_input_stream_read() produces 0 bytes),
+ * the connection stops polling them every event-loop tick and retries with an increasing delay instead.
+ * Call this to make the connection try reading the body again immediately.
+ * Calling it is never required for correctness, only for latency.
+ * May be called from any thread.
+ *
+ * @return AWS_OP_SUCCESS if the notification was queued
+ *         AWS_OP_ERR indicating the attempt raised an error code.
+ *              AWS_ERROR_HTTP_STREAM_NOT_ACTIVATED will be raised if the stream is not activated yet.
+ *              AWS_ERROR_HTTP_STREAM_HAS_COMPLETED will be raised if the stream has completed.
+ */
+AWS_HTTP_API int aws_http2_stream_notify_body_ready(struct aws_http_stream *http2_stream);
+
 /**
  * Add a list of headers to be added as trailing headers sent after the last chunk is sent.
  * a "Trailer" header field which indicates the fields present in the trailer.
@@ -933,6 +1228,46 @@ AWS_HTTP_API int aws_http1_stream_add_chunked_trailer(
     struct aws_http_stream *http1_stream,
     const struct aws_http_headers *trailing_headers);
 
+/**
+ * Create a template for the head of HTTP/1.1 requests that share a method and most of their headers
+ * (ex: Host, User-Agent, Accept). The method and headers of `request` are validated and serialized once,
+ * so requests made with the template only pay to validate and serialize their path and remaining headers.
+ * The path and body of `request` are ignored.
+ *
+ * Content-Length and Transfer-Encoding depend on each request's body, so they may not be in a template.
+ *
+ * The template is immutable, and may be used by any number of requests on any thread.
+ * Returns NULL and raises an error if the template is invalid.
+ */
+AWS_HTTP_API
+struct aws_http1_request_template *aws_http1_request_template_new(
+    struct aws_allocator *allocator,
+    const struct aws_http_message *request);
+
+AWS_HTTP_API
+void aws_http1_request_template_destroy(struct aws_http1_request_template *request_template);
+
+/**
+ * Create a static HTTP/1.1 response, for responses a server sends over and over unchanged
+ * (ex: health checks, redirects, small cached bodies). The status, headers, and body of `response`
+ * are validated and serialized once, so sending it with aws_http1_stream_send_static_response()
+ * copies no headers and reads no body stream.
+ *
+ * The body is read into memory now, so it must have a Content-Length and may not be chunked.
+ * `response` may be modified or released once this call returns.
+ *
+ * The static response is immutable, and may be sent by any number of streams on any thread.
+ * It must outlive every stream it's sent on.
+ * Returns NULL and raises an error if the response is invalid.
+ */
+AWS_HTTP_API
+struct aws_http1_static_response *aws_http1_static_response_new(
+    struct aws_allocator *allocator,
+    const struct aws_http_message *response);
+
+AWS_HTTP_API
+void aws_http1_static_response_destroy(struct aws_http1_static_response *static_response);
+
 /**
  *
  * This datastructure has more functions for inspecting and modifying headers than
@@ -1011,7 +1346,9 @@ int aws_http_message_erase_header(struct aws_http_message *message, size_t index
  *  - No `user-agent` will be added.
  *  - No security check will be enforced. eg: `referer` header privacy should be enforced by the user-agent who adds the
  *      header
- *  - When HTTP/1 message sent on HTTP/2 connection, `aws_http2_message_new_from_http1` will be applied under the hood.
+ *  - When HTTP/1 message sent on HTTP/2 connection, it's sent as `aws_http2_message_new_from_http1` would convert it.
+ *      The message isn't copied: its headers are encoded as HTTP/2 when the stream is activated,
+ *      so it must not be modified until the stream completes, the same as any other message.
  *  - When HTTP/2 message sent on HTTP/1 connection, no change will be made.
  */
 AWS_HTTP_API
@@ -1075,6 +1412,17 @@ int aws_http_stream_get_incoming_request_uri(const struct aws_http_stream *strea
 AWS_HTTP_API
 int aws_http_stream_send_response(struct aws_http_stream *stream, struct aws_http_message *response);
 
+/**
+ * Send a static response (only callable from HTTP/1.1 "request handler" streams).
+ * Like aws_http_stream_send_response(), but the pre-encoded bytes are sent as-is.
+ * If the request was HEAD, only the head is sent.
+ * The static response must stay alive at least until the stream's on_complete is called.
+ */
+AWS_HTTP_API
+int aws_http1_stream_send_static_response(
+    struct aws_http_stream *http1_stream,
+    const struct aws_http1_static_response *static_response);
+
 /**
  * Increment the stream's flow-control window to keep data flowing.
  *
@@ -1091,6 +1439,27 @@ int aws_http_stream_send_response(struct aws_http_stream *stream, struct aws_htt
 AWS_HTTP_API
 void aws_http_stream_update_window(struct aws_http_stream *stream, size_t increment_size);
 
+/**
+ * Get the body data a lease is on. It stays valid until the lease is released.
+ */
+AWS_HTTP_API
+struct aws_byte_cursor aws_http_body_lease_get_data(const struct aws_http_body_lease *lease);
+
+/**
+ * Keep a lease beyond the `aws_http_on_incoming_body_lease_fn` it was passed to.
+ * Only call this during the callback, or on a lease already acquired.
+ * Returns the same lease.
+ */
+AWS_HTTP_API
+struct aws_http_body_lease *aws_http_body_lease_acquire(struct aws_http_body_lease *lease);
+
+/**
+ * Release a lease acquired with aws_http_body_lease_acquire(). May be called from any thread.
+ * NULL is acceptable.
+ */
+AWS_HTTP_API
+void aws_http_body_lease_release(struct aws_http_body_lease *lease);
+
 /**
  * Gets the HTTP/2 id associated with a stream.  Even h1 streams have an id (using the same allocation procedure
  * as http/2) for easier tracking purposes. For client streams, this will only be non-zero after a successful call
@@ -1099,6 +1468,13 @@ void aws_http_stream_update_window(struct aws_http_stream *stream, size_t increm
 AWS_HTTP_API
 uint32_t aws_http_stream_get_id(const struct aws_http_stream *stream);
 
+/**
+ * Gets the stream's tracing metrics, see `aws_http_stream_metrics`.
+ * The values are only settled once the stream completes, so call this from the on_complete callback or later.
+ */
+AWS_HTTP_API
+void aws_http_stream_get_metrics(const struct aws_http_stream *stream, struct aws_http_stream_metrics *out_metrics);
+
 /**
  * Reset the HTTP/2 stream (HTTP/2 only).
  * Note that if the stream closes before this async call is fully processed, the RST_STREAM frame will not be sent.
@@ -106,6 +106,53 @@ struct aws_http_server_options {
      * reaches 0, no further data will be received.
      **/
     bool manual_window_management;
+
+    /**
+     * Optional.
+     * If non-zero, the most connections the server keeps open at once. Once there are this many, further
+     * incoming connections are refused: they are closed before any HTTP handler is created for them, and
+     * on_incoming_connection is invoked with AWS_ERROR_HTTP_SERVER_CONNECTION_LIMIT_REACHED.
+     */
+    size_t max_connections;
+
+    /**
+     * Optional, requires max_connections.
+     * Once max_connections has been reached, keep refusing connections until the count drains down to this,
+     * so the server doesn't flap between accepting and refusing at the limit.
+     * Must be less than max_connections. If 0, accepting resumes as soon as the count is below max_connections.
+     */
+    size_t resume_connections_threshold;
+
+    /**
+     * Optional.
+     * If non-zero, a connection with no request in progress for this long is closed.
+     * The timer starts when the connection is accepted, and starts over after each response completes.
+     * Connections are closed with AWS_ERROR_HTTP_SERVER_CONNECTION_TIMEOUT.
+     */
+    uint64_t idle_timeout_ms;
+
+    /**
+     * Optional.
+     * If non-zero, a client gets this long to send a complete request head (request-line and headers),
+     * counted from its first byte, or the connection is closed with AWS_ERROR_HTTP_SERVER_CONNECTION_TIMEOUT.
+     * This protects against clients that trickle a request in to hold connections open.
+     * Only applies to HTTP/1.x connections.
+     */
+    uint64_t header_read_timeout_ms;
+};
+
+/**
+ * Counts of the connections a server has handled.
+ */
+struct aws_http_server_metrics {
+    /* Connections that are open right now */
+    size_t current_connections;
+    /* Connections let in since the server was created */
+    uint64_t accepted_connections;
+    /* Connections refused because of max_connections since the server was created */
+    uint64_t rejected_connections;
+    /* True while connections are being refused, until the count drains to resume_connections_threshold */
+    bool is_refusing_connections;
 };
 
 /**
@@ -180,6 +227,12 @@ struct aws_http_server *aws_http_server_new(const struct aws_http_server_options
 AWS_HTTP_API
 void aws_http_server_release(struct aws_http_server *server);
 
+/**
+ * Fetch the server's connection counts.
+ */
+AWS_HTTP_API
+void aws_http_server_fetch_metrics(const struct aws_http_server *server, struct aws_http_server_metrics *out_metrics);
+
 /**
  * Configure a server connection.
  * This must be called from the server's on_incoming_connection callback.
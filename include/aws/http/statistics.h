@@ -29,8 +29,15 @@ struct aws_crt_statistics_http1_channel {
 
     uint32_t current_outgoing_stream_id;
     uint32_t current_incoming_stream_id;
+
+    /* Longest a request waited, after being sent, for the first byte of its response.
+     * Includes a request still waiting at the time of report. */
+    uint64_t max_first_byte_latency_ms;
 };
 
+/* Number of frame types defined by HTTP/2, DATA (0x0) through CONTINUATION (0x9) (RFC-7540 6) */
+#define AWS_CRT_STATISTICS_HTTP2_FRAME_TYPE_COUNT 10
+
 struct aws_crt_statistics_http2_channel {
     aws_crt_statistics_category_t category;
 
@@ -39,6 +46,49 @@ struct aws_crt_statistics_http2_channel {
 
     /* True if during the time of report, there has ever been no active streams on the connection */
     bool was_inactive;
+
+    /* Frames, indexed by frame type. Frames of unknown types are not counted */
+    uint64_t frames_sent[AWS_CRT_STATISTICS_HTTP2_FRAME_TYPE_COUNT];
+    uint64_t frames_received[AWS_CRT_STATISTICS_HTTP2_FRAME_TYPE_COUNT];
+
+    /* Payload of DATA frames, padding included (the amount counted against flow-control) */
+    uint64_t data_bytes_sent;
+    uint64_t data_bytes_received;
+
+    /* Header-blocks, as HPACK encoded on the wire, and as the sum of name and value lengths of their fields */
+    uint64_t header_bytes_sent_compressed;
+    uint64_t header_bytes_sent_uncompressed;
+    uint64_t header_bytes_received_compressed;
+    uint64_t header_bytes_received_uncompressed;
+
+    /* Time DATA was waiting to be sent because the peer's connection flow-control window was exhausted */
+    uint64_t connection_window_stalled_ms;
+    /* Time streams spent waiting on their peer's stream flow-control window, summed over streams.
+     * A stall is added once it ends. */
+    uint64_t stream_window_stalled_ms;
+
+    /* RST_STREAM frames, indexed by error code (see enum aws_http2_error_code). Unknown codes are not counted */
+    uint64_t rst_streams_sent[AWS_HTTP2_ERR_COUNT];
+    uint64_t rst_streams_received[AWS_HTTP2_ERR_COUNT];
+
+    /* Number of active streams at the time of report, not reset */
+    uint32_t active_stream_count;
+
+    /* Longest a request waited, after being sent, for the first byte of its response.
+     * Includes requests still waiting at the time of report. */
+    uint64_t max_first_byte_latency_ms;
+
+    /* Longest round-trip time of a PING, including PINGs still waiting for their ACK at the time of report */
+    uint64_t max_ping_rtt_ms;
+
+    /* How long DATA has been continuously blocked by the peer's connection or stream flow-control window,
+     * at the time of report. 0 if nothing is blocked. Not reset */
+    uint64_t current_window_stall_ms;
+
+    /* The connection's round-trip time estimate at the time of report, see aws_http2_rtt_estimate.
+     * 0 if no sample has been taken yet. Not reset */
+    uint64_t smoothed_rtt_ms;
+    uint64_t rtt_variation_ms;
 };
 
 AWS_EXTERN_C_BEGIN
@@ -0,0 +1,78 @@
+#ifndef AWS_HTTP_TRACING_H
+#define AWS_HTTP_TRACING_H
+
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/http.h>
+
+AWS_PUSH_SANE_WARNING_LEVEL
+
+/**
+ * Tracepoints fired on protocol hot paths, for profiling production traffic.
+ *
+ * They're compiled in only when the library is built with the AWS_HTTP_ENABLE_TRACING CMake option, and cost
+ * nothing otherwise. When compiled in, each tracepoint is also a USDT probe named aws_c_http:trace (if the platform
+ * has <sys/sdt.h>), with the same 4 arguments as aws_http_trace_fn, so eBPF or DTrace tools can attach to it.
+ *
+ * Every event carries an `id` pointer and two integer arguments, documented per event.
+ */
+enum aws_http_trace_event {
+    /* id: stream, arg1: stream-id */
+    AWS_HTTP_TRACE_STREAM_ACTIVATE,
+    /* id: stream, arg1: stream-id, arg2: error-code */
+    AWS_HTTP_TRACE_STREAM_COMPLETE,
+    /* id: stream, arg1: length of the encoded request-line or status-line and headers */
+    AWS_HTTP_TRACE_H1_HEAD_ENCODED,
+    /* id: stream */
+    AWS_HTTP_TRACE_H1_HEAD_DECODED,
+    /* id: connection, arg1: frame type, arg2: stream-id */
+    AWS_HTTP_TRACE_H2_FRAME_ENCODED,
+    /* id: connection, arg1: frame type, arg2: stream-id */
+    AWS_HTTP_TRACE_H2_FRAME_DECODED,
+    /* id: connection manager, arg1: connection pointer (0 on failure), arg2: error-code */
+    AWS_HTTP_TRACE_CONNECTION_ACQUIRED,
+    /* id: connection manager, arg1: connection pointer */
+    AWS_HTTP_TRACE_CONNECTION_RELEASED,
+    /* id: HTTP/2 connection, arg1: stream-id, or 0 for the connection's window */
+    AWS_HTTP_TRACE_WINDOW_STALL_BEGIN,
+    /* id: HTTP/2 connection, arg1: stream-id, or 0 for the connection's window */
+    AWS_HTTP_TRACE_WINDOW_STALL_END,
+
+    AWS_HTTP_TRACE_EVENT_COUNT,
+};
+
+/**
+ * Invoked synchronously from the thread the event happened on, which is usually an event-loop thread.
+ * Must be quick, and must not call back into the library.
+ */
+typedef void(aws_http_trace_fn)(
+    enum aws_http_trace_event event,
+    const void *id,
+    uint64_t arg1,
+    uint64_t arg2,
+    void *user_data);
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Set the function invoked at every tracepoint, or NULL to stop.
+ * Not thread-safe: set it before making connections, or while none are running.
+ *
+ * Fails with AWS_ERROR_UNSUPPORTED_OPERATION if the library was built without AWS_HTTP_ENABLE_TRACING.
+ */
+AWS_HTTP_API
+int aws_http_set_trace_callback(aws_http_trace_fn *trace_fn, void *user_data);
+
+/**
+ * Returns the name of a trace event, for display.
+ */
+AWS_HTTP_API
+const char *aws_http_trace_event_to_str(enum aws_http_trace_event event);
+
+AWS_EXTERN_C_END
+AWS_POP_SANE_WARNING_LEVEL
+
+#endif /* AWS_HTTP_TRACING_H */
@@ -9,6 +9,8 @@
 
 AWS_PUSH_SANE_WARNING_LEVEL
 
+struct aws_http2_stream_manager;
+struct aws_http_body_segment;
 struct aws_http_header;
 struct aws_http_message;
 
@@ -21,6 +23,12 @@ struct aws_http_message;
  */
 struct aws_websocket;
 
+/**
+ * A ref-counted, immutable payload in caller-owned memory, which may be sent by many websockets at once.
+ * See aws_websocket_shared_payload_new().
+ */
+struct aws_websocket_shared_payload;
+
 /**
  * Opcode describing the type of a websocket frame.
  * RFC-6455 Section 5.2
@@ -38,6 +46,44 @@ enum aws_websocket_opcode {
 #define AWS_WEBSOCKET_MAX_HANDSHAKE_KEY_LENGTH 25
 #define AWS_WEBSOCKET_CLOSE_TIMEOUT 1000000000 // nanos -> 1 sec
 
+#define AWS_WEBSOCKET_PERMESSAGE_DEFLATE_MIN_WINDOW_BITS 8
+#define AWS_WEBSOCKET_PERMESSAGE_DEFLATE_MAX_WINDOW_BITS 15
+
+/**
+ * Parameters of the permessage-deflate extension.
+ * See RFC-7692 Section 7.1.
+ *
+ * The websocket negotiates the extension and marks compressed messages (the RSV1 bit),
+ * but the DEFLATE compression itself is done by the user, as payload streams in and out.
+ * A compressed message's payload is the DEFLATE data with its final 0x00 0x00 0xff 0xff removed.
+ * See RFC-7692 Section 7.2.
+ */
+struct aws_websocket_permessage_deflate_options {
+    /**
+     * The server won't keep its compression context from one message to the next.
+     * When offered, asks the server for this. The server may choose it on its own.
+     */
+    bool server_no_context_takeover;
+
+    /**
+     * The client won't keep its compression context from one message to the next.
+     * When offered, promises this. The server may require it on its own.
+     */
+    bool client_no_context_takeover;
+
+    /**
+     * Base 2 logarithm of the LZ77 window the server compresses with, from 8 to 15.
+     * When offered, 0 means no limit is asked for.
+     */
+    uint8_t server_max_window_bits;
+
+    /**
+     * Base 2 logarithm of the LZ77 window the client compresses with, from 8 to 15.
+     * When offered, 0 means the client uses the largest window, and the server may not pick a smaller one.
+     */
+    uint8_t client_max_window_bits;
+};
+
 /**
  * Data passed to the websocket on_connection_setup callback.
  *
@@ -59,6 +105,12 @@ struct aws_websocket_on_connection_setup_data {
     const struct aws_http_header *handshake_response_header_array;
     size_t num_handshake_response_headers;
     const struct aws_byte_cursor *handshake_response_body;
+
+    /**
+     * The permessage-deflate parameters the server accepted, with the window bits both sides actually use.
+     * NULL if the extension is not in use.
+     */
+    const struct aws_websocket_permessage_deflate_options *permessage_deflate;
 };
 
 /**
@@ -84,6 +136,12 @@ struct aws_websocket_incoming_frame {
     uint64_t payload_length;
     uint8_t opcode;
     bool fin;
+
+    /**
+     * With permessage-deflate, true for every data frame of a compressed message.
+     * The payload is passed along as received, still compressed.
+     */
+    bool compressed;
 };
 
 /**
@@ -140,6 +198,40 @@ typedef bool(aws_websocket_on_incoming_frame_complete_fn)(
     int error_code,
     void *user_data);
 
+/**
+ * A complete incoming TEXT or BINARY message, see `aws_websocket_client_connection_options.on_incoming_message`.
+ * The payload lives in a buffer from the websocket's pool.
+ * Call aws_websocket_incoming_message_release() when done with it, to return the buffer to the pool.
+ */
+struct aws_websocket_incoming_message {
+    /* TEXT or BINARY */
+    uint8_t opcode;
+
+    /**
+     * With permessage-deflate, true if the message is compressed.
+     * The payload is passed along as received, still compressed.
+     */
+    bool compressed;
+
+    /* The payload of all the message's frames, put together */
+    struct aws_byte_cursor payload;
+};
+
+/**
+ * Called when all the frames of a TEXT or BINARY message have arrived.
+ * Invoked once per message on the websocket's event-loop thread.
+ * The user now owns the message, and must call aws_websocket_incoming_message_release() on it.
+ * This may be done later, from any thread, even after the websocket is released.
+ * If the connection shuts down in the middle of a message, the partial message is discarded.
+ *
+ * Return true to proceed normally. If false is returned, the websocket will read no further data
+ * and the connection will close.
+ */
+typedef bool(aws_websocket_on_incoming_message_fn)(
+    struct aws_websocket *websocket,
+    struct aws_websocket_incoming_message *message,
+    void *user_data);
+
 /**
  * Options for creating a websocket client connection.
  */
@@ -151,13 +243,13 @@ struct aws_websocket_client_connection_options {
     struct aws_allocator *allocator;
 
     /**
-     * Required.
+     * Required, unless `http2_stream_manager` is set.
      * The connection keeps the bootstrap alive via ref-counting.
      */
     struct aws_client_bootstrap *bootstrap;
 
     /**
-     * Required.
+     * Required, unless `http2_stream_manager` is set.
      * aws_websocket_client_connect() makes a copy.
      */
     const struct aws_socket_options *socket_options;
@@ -176,7 +268,7 @@ struct aws_websocket_client_connection_options {
     const struct aws_http_proxy_options *proxy_options;
 
     /**
-     * Required.
+     * Required, unless `http2_stream_manager` is set.
      * aws_websocket_client_connect() makes a copy.
      */
     struct aws_byte_cursor host;
@@ -288,6 +380,72 @@ struct aws_websocket_client_connection_options {
      * Host resolution override that allows the user to override DNS behavior for this particular connection.
      */
     const struct aws_host_resolution_config *host_resolution_config;
+
+    /**
+     * Optional.
+     * If set, offer the permessage-deflate extension (RFC-7692) with these parameters.
+     * aws_websocket_client_connect() adds the "Sec-WebSocket-Extensions" header to `handshake_request`,
+     * which must not have one already.
+     * The server may decline, see `aws_websocket_on_connection_setup_data.permessage_deflate`.
+     */
+    const struct aws_websocket_permessage_deflate_options *permessage_deflate;
+
+    /**
+     * Optional.
+     * Max number of aws_io_messages full of outgoing frames that the websocket may have sent down the channel,
+     * that haven't finished writing to the network yet.
+     * More than one lets the websocket encode frames while the socket is still busy sending earlier ones.
+     * If zero is specified (the default) then 1 is used.
+     */
+    size_t max_write_messages_in_flight;
+
+    /**
+     * Optional.
+     * Max number of microseconds the websocket may hold newly queued frames before writing them.
+     * Zero (the default) writes as soon as there's something to send.
+     *
+     * When non-zero, frames sent while nothing is being written wait out the delay, so a burst of small frames
+     * shares one aws_io_message instead of going out one at a time.
+     * Frames sent while a write is in flight simply wait for it to complete.
+     * The CLOSE frame sent during shutdown is never held.
+     */
+    uint32_t write_coalescing_delay_us;
+
+    /**
+     * Optional.
+     * If set, TEXT and BINARY messages are put together by the websocket and delivered whole,
+     * instead of frame by frame. See `aws_websocket_on_incoming_message_fn`.
+     * The "incoming frame" callbacks are then only invoked for control frames (PING, PONG, CLOSE).
+     *
+     * The read window still shrinks as payload from data frames arrives, see `manual_window_management`.
+     */
+    aws_websocket_on_incoming_message_fn *on_incoming_message;
+
+    /**
+     * Optional.
+     * Max size of a message assembled for `on_incoming_message`.
+     * If a peer sends a bigger one, the connection is closed with AWS_ERROR_HTTP_WEBSOCKET_MESSAGE_TOO_BIG.
+     * If zero is specified (the default) then 16MiB is used.
+     * Ignored unless `on_incoming_message` is set.
+     */
+    size_t max_incoming_message_size;
+
+    /**
+     * Optional.
+     * If set, the websocket runs as a stream on one of this manager's HTTP/2 connections (RFC-8441),
+     * instead of opening a connection of its own. Many websockets to the same server can then share a connection.
+     * The server must enable SETTINGS_ENABLE_CONNECT_PROTOCOL, or setup fails with
+     * AWS_ERROR_HTTP_EXTENDED_CONNECT_NOT_SUPPORTED.
+     *
+     * `bootstrap`, `socket_options`, `tls_options`, `proxy_options`, `host`, `port`, `requested_event_loop`,
+     * and `host_resolution_config` are ignored, the manager's connections were configured with their own.
+     * `handshake_request` is still a GET request as described above. It's sent as an HTTP/2 extended CONNECT,
+     * with the "Upgrade", "Connection", and "Sec-WebSocket-Key" headers left out, and the server responds 200.
+     *
+     * The websocket holds a reference to the manager until it's completely shut down.
+     * Closing the websocket ends its stream, the connection is left open for others.
+     */
+    struct aws_http2_stream_manager *http2_stream_manager;
 };
 
 /**
@@ -320,7 +478,7 @@ typedef void(
  */
 struct aws_websocket_send_frame_options {
     /**
-     * Size of payload to be sent via `stream_outgoing_payload` callback.
+     * Size of payload to be sent via `stream_outgoing_payload` callback, or of `shared_payload`'s data.
      */
     uint64_t payload_length;
 
@@ -336,6 +494,15 @@ struct aws_websocket_send_frame_options {
      */
     aws_websocket_stream_outgoing_payload_fn *stream_outgoing_payload;
 
+    /**
+     * Payload to send, instead of using `stream_outgoing_payload`.
+     * `payload_length` must match the length of its data.
+     * The websocket holds a reference until the frame completes.
+     * Servers send large payloads straight from its memory, without copying them.
+     * Clients still copy the payload, since it must be masked.
+     */
+    struct aws_websocket_shared_payload *shared_payload;
+
     /**
      * Callback for completion of send operation.
      * See `aws_websocket_outgoing_frame_complete_fn`.
@@ -353,6 +520,12 @@ struct aws_websocket_send_frame_options {
      * Indicates that this is the final fragment in a message. The first fragment MAY also be the final fragment.
      */
     bool fin;
+
+    /**
+     * Set on the first frame of a message whose payload the user compressed.
+     * Only allowed once permessage-deflate is in use, and only on TEXT and BINARY frames.
+     */
+    bool compressed;
 };
 
 AWS_EXTERN_C_BEGIN
@@ -409,6 +582,43 @@ void aws_websocket_close(struct aws_websocket *websocket, bool free_scarce_resou
 AWS_HTTP_API
 int aws_websocket_send_frame(struct aws_websocket *websocket, const struct aws_websocket_send_frame_options *options);
 
+/**
+ * Create a payload that can be sent by any number of websockets, see `aws_websocket_send_frame_options.shared_payload`.
+ * The segment's data is not copied. Its on_release callback fires when the last reference is released,
+ * which may happen on any thread.
+ * The payload starts with a ref-count of 1, which the caller must release.
+ */
+AWS_HTTP_API
+struct aws_websocket_shared_payload *aws_websocket_shared_payload_new(
+    struct aws_allocator *allocator,
+    const struct aws_http_body_segment *segment);
+
+/**
+ * Increment the payload's ref-count.
+ * This function may be called from any thread.
+ * @return Always returns the same pointer that is passed in.
+ */
+AWS_HTTP_API
+struct aws_websocket_shared_payload *aws_websocket_shared_payload_acquire(
+    struct aws_websocket_shared_payload *payload);
+
+/**
+ * Decrement the payload's ref-count.
+ * This function may be called from any thread.
+ * It is safe to pass NULL, nothing will happen.
+ */
+AWS_HTTP_API
+void aws_websocket_shared_payload_release(struct aws_websocket_shared_payload *payload);
+
+/**
+ * Return a message delivered by `on_incoming_message`, so its buffer can be reused.
+ * The payload is not valid after this call.
+ * This function may be called from any thread.
+ * It is safe to pass NULL, nothing will happen.
+ */
+AWS_HTTP_API
+void aws_websocket_incoming_message_release(struct aws_websocket_incoming_message *message);
+
 /**
  * Manually increment the read window to keep frames flowing.
  *
@@ -0,0 +1,193 @@
+#ifndef AWS_HTTP_WEBSOCKET_MANAGER_H
+#define AWS_HTTP_WEBSOCKET_MANAGER_H
+
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/websocket.h>
+
+AWS_PUSH_SANE_WARNING_LEVEL
+
+struct aws_client_bootstrap;
+struct aws_http_header;
+struct aws_socket_options;
+struct aws_tls_connection_options;
+struct aws_websocket_manager;
+
+/**
+ * Invoked once a websocket is acquired from the manager, or the acquisition fails.
+ * An error_code of zero indicates success, and the websocket must later be given back with
+ * aws_websocket_manager_release_websocket(). Do not call aws_websocket_release() on it, the manager owns it.
+ * If the acquisition failed, the websocket is NULL.
+ */
+typedef void(aws_websocket_manager_on_websocket_acquired_fn)(
+    struct aws_websocket *websocket,
+    int error_code,
+    void *user_data);
+
+typedef void(aws_websocket_manager_shutdown_complete_fn)(void *user_data);
+
+/*
+ * Websocket manager configuration struct.
+ *
+ * Contains everything needed to connect a websocket, as well as how many websockets to keep open and
+ * how to keep them healthy while no one is using them.
+ */
+struct aws_websocket_manager_options {
+    /*
+     * Websocket connection configuration, check `struct aws_websocket_client_connection_options` for details of each
+     * config.
+     */
+    struct aws_client_bootstrap *bootstrap;
+    const struct aws_socket_options *socket_options;
+    const struct aws_tls_connection_options *tls_options;
+    struct aws_byte_cursor host;
+    uint16_t port;
+    size_t initial_window_size;
+    bool manual_window_management;
+
+    /**
+     * Required.
+     * Path of the handshake request. Each websocket is connected with a handshake request made by
+     * aws_http_message_new_websocket_handshake_request(), so each gets its own Sec-WebSocket-Key.
+     */
+    struct aws_byte_cursor path;
+
+    /**
+     * Optional.
+     * Headers added to each handshake request, such as "Sec-WebSocket-Protocol" or authorization.
+     * The manager makes a copy.
+     */
+    const struct aws_http_header *handshake_header_array;
+    size_t num_handshake_headers;
+
+    /*
+     * Maximum number of websockets this manager is allowed to have open, idle or acquired.
+     */
+    size_t max_websockets;
+
+    /**
+     * If set to a non-zero value, the manager connects websockets ahead of demand so that at least this many are
+     * idle (or being set up) once the pending acquisitions are served. It starts as soon as the manager is created,
+     * and idle culling never takes the pool below this size.
+     * Must not be greater than max_websockets.
+     */
+    size_t min_idle_websockets;
+
+    /**
+     * If set to a non-zero value, then websockets that stay idle longer than this are closed,
+     * as long as that doesn't take the pool below min_idle_websockets.
+     */
+    uint64_t max_websocket_idle_ms;
+
+    /**
+     * If set to a non-zero value, an idle websocket that hasn't heard from its server for this long is sent a PING.
+     * If the PONG doesn't come back within ping_timeout_ms, the websocket is closed and replaced.
+     * Acquired websockets are never pinged by the manager.
+     */
+    uint64_t ping_interval_ms;
+
+    /**
+     * Time to wait for the PONG, see ping_interval_ms.
+     * If zero is specified (the default) then ping_interval_ms is used.
+     */
+    uint64_t ping_timeout_ms;
+
+    /*
+     * Callback and associated user data to invoke when the websocket manager has
+     * completely shutdown and has finished deleting itself.
+     * Technically optional, but correctness may be impossible without it.
+     */
+    void *shutdown_complete_user_data;
+    aws_websocket_manager_shutdown_complete_fn *shutdown_complete_callback;
+};
+
+/**
+ * Options for aws_websocket_manager_acquire_websocket().
+ * The callbacks are the ones the acquirer would have given aws_websocket_client_connect(). They're invoked for the
+ * websocket from the moment it's acquired until it's released back to the manager, on the websocket's
+ * event-loop thread. See `struct aws_websocket_client_connection_options`.
+ */
+struct aws_websocket_manager_acquire_options {
+    /**
+     * Required.
+     * Invoked once the websocket is acquired, or the acquisition fails.
+     */
+    aws_websocket_manager_on_websocket_acquired_fn *on_acquired;
+
+    /**
+     * Optional.
+     * Invoked if the websocket shuts down while acquired. It must still be released back to the manager.
+     */
+    aws_websocket_on_connection_shutdown_fn *on_connection_shutdown;
+
+    aws_websocket_on_incoming_frame_begin_fn *on_incoming_frame_begin;
+    aws_websocket_on_incoming_frame_payload_fn *on_incoming_frame_payload;
+    aws_websocket_on_incoming_frame_complete_fn *on_incoming_frame_complete;
+
+    /**
+     * Optional.
+     * User data for the callbacks.
+     */
+    void *user_data;
+};
+
+AWS_EXTERN_C_BEGIN
+
+/*
+ * Websocket managers are ref counted.  Adds one external ref to the manager.
+ */
+AWS_HTTP_API
+void aws_websocket_manager_acquire(struct aws_websocket_manager *manager);
+
+/*
+ * Websocket managers are ref counted.  Removes one external ref from the manager.
+ *
+ * When the ref count goes to zero, the websocket manager begins its shut down
+ * process.  All pending websocket acquisitions are failed (with callbacks
+ * invoked), idle websockets are closed, and acquired websockets are closed as they are
+ * released.  The websocket manager destroys itself once all of its websockets have shut down.
+ */
+AWS_HTTP_API
+void aws_websocket_manager_release(struct aws_websocket_manager *manager);
+
+/*
+ * Creates a new websocket manager with the supplied configuration options.
+ *
+ * The returned websocket manager begins with a ref count of 1.
+ */
+AWS_HTTP_API
+struct aws_websocket_manager *aws_websocket_manager_new(
+    struct aws_allocator *allocator,
+    const struct aws_websocket_manager_options *options);
+
+/*
+ * Requests a websocket from the manager.  An idle websocket, already connected and upgraded, is vended right
+ * away, with on_acquired invoked before this returns.  Otherwise the acquisition waits for a new websocket to be
+ * connected, or for another to be released.  The options struct is copied.
+ *
+ * Once a websocket has been successfully acquired from the manager it
+ * must be released back (via aws_websocket_manager_release_websocket)
+ * at some point.  Failure to do so will cause a resource leak.
+ */
+AWS_HTTP_API
+int aws_websocket_manager_acquire_websocket(
+    struct aws_websocket_manager *manager,
+    const struct aws_websocket_manager_acquire_options *options);
+
+/*
+ * Returns a websocket back to the manager.  The acquirer's callbacks stop being invoked for it.
+ * If it's still open, it goes back to the idle pool (or to a pending acquisition) to be used again.
+ * To keep a websocket from being used again, close it with aws_websocket_close() before releasing it.
+ *
+ * Note: it can lead to another acquired callback to be invoked within the thread.
+ */
+AWS_HTTP_API
+int aws_websocket_manager_release_websocket(struct aws_websocket_manager *manager, struct aws_websocket *websocket);
+
+AWS_EXTERN_C_END
+AWS_POP_SANE_WARNING_LEVEL
+
+#endif /* AWS_HTTP_WEBSOCKET_MANAGER_H */
@@ -0,0 +1,137 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/private/body_lease.h>
+
+#include <aws/common/atomics.h>
+#include <aws/common/task_scheduler.h>
+#include <aws/http/private/connection_impl.h>
+#include <aws/http/private/request_response_impl.h>
+#include <aws/io/channel.h>
+#include <aws/io/event_loop.h>
+#include <aws/io/logging.h>
+
+struct aws_http_body_lease {
+    struct aws_allocator *allocator;
+    struct aws_atomic_var ref_count;
+    struct aws_byte_cursor data;
+    struct aws_http_leased_message *leased_message;
+
+    /* The last release may come from any thread, this finishes up on the connection's */
+    struct aws_task release_task;
+};
+
+struct aws_http_leased_message *aws_http_leased_message_new(
+    struct aws_http_connection *connection,
+    struct aws_io_message *message) {
+
+    AWS_PRECONDITION(aws_channel_thread_is_callers_thread(connection->channel_slot->channel));
+
+    struct aws_http_leased_message *leased_message =
+        aws_mem_calloc(connection->alloc, 1, sizeof(struct aws_http_leased_message));
+    leased_message->allocator = connection->alloc;
+    leased_message->connection = connection;
+    leased_message->message = message;
+    leased_message->hold_count = 1;
+    return leased_message;
+}
+
+/* Returns true if something still holds the message */
+static bool s_leased_message_release_hold(struct aws_http_leased_message *leased_message) {
+    AWS_ASSERT(leased_message->hold_count > 0);
+    if (--leased_message->hold_count > 0) {
+        return true;
+    }
+
+    aws_mem_release(leased_message->message->allocator, leased_message->message);
+    aws_mem_release(leased_message->allocator, leased_message);
+    return false;
+}
+
+bool aws_http_leased_message_release(struct aws_http_leased_message *leased_message) {
+    AWS_PRECONDITION(aws_channel_thread_is_callers_thread(leased_message->connection->channel_slot->channel));
+    return s_leased_message_release_hold(leased_message);
+}
+
+static void s_body_lease_destroy(struct aws_http_body_lease *lease) {
+    struct aws_http_leased_message *leased_message = lease->leased_message;
+    struct aws_http_connection *connection = leased_message->connection;
+    size_t counted_bytes = leased_message->counted_bytes;
+    aws_mem_release(lease->allocator, lease);
+
+    if (!s_leased_message_release_hold(leased_message) && counted_bytes > 0) {
+        connection->vtable->on_body_leases_released(connection, counted_bytes);
+    }
+
+    /* Release the lease's hold on the connection last, this may be what lets it be destroyed */
+    aws_http_connection_release(connection);
+}
+
+static void s_body_lease_release_task(struct aws_task *task, void *arg, enum aws_task_status status) {
+    (void)task;
+    /* Even if canceled, this runs on the event-loop's thread (or once that has stopped), so clean up either way */
+    (void)status;
+    s_body_lease_destroy(arg);
+}
+
+int aws_http_leased_message_deliver_body(
+    struct aws_http_leased_message *leased_message,
+    struct aws_http_stream *stream,
+    struct aws_byte_cursor data) {
+
+    AWS_PRECONDITION(stream->on_incoming_body_lease);
+    AWS_PRECONDITION(
+        data.ptr >= leased_message->message->message_data.buffer &&
+        data.ptr + data.len <=
+            leased_message->message->message_data.buffer + leased_message->message->message_data.len);
+
+    struct aws_http_body_lease *lease =
+        aws_mem_calloc(leased_message->allocator, 1, sizeof(struct aws_http_body_lease));
+    lease->allocator = leased_message->allocator;
+    aws_atomic_init_int(&lease->ref_count, 1);
+    lease->data = data;
+    lease->leased_message = leased_message;
+    aws_task_init(&lease->release_task, s_body_lease_release_task, lease, "http_body_lease_release");
+
+    leased_message->hold_count++;
+    aws_http_connection_acquire(leased_message->connection);
+
+    int err = stream->on_incoming_body_lease(stream, lease, stream->user_data);
+
+    /* The user acquired the lease if they want to keep it */
+    aws_http_body_lease_release(lease);
+    return err;
+}
+
+struct aws_byte_cursor aws_http_body_lease_get_data(const struct aws_http_body_lease *lease) {
+    AWS_PRECONDITION(lease);
+    return lease->data;
+}
+
+struct aws_http_body_lease *aws_http_body_lease_acquire(struct aws_http_body_lease *lease) {
+    AWS_PRECONDITION(lease);
+    aws_atomic_fetch_add(&lease->ref_count, 1);
+    return lease;
+}
+
+void aws_http_body_lease_release(struct aws_http_body_lease *lease) {
+    if (!lease) {
+        return;
+    }
+
+    size_t prev_ref_count = aws_atomic_fetch_sub(&lease->ref_count, 1);
+    AWS_FATAL_ASSERT(prev_ref_count != 0);
+    if (prev_ref_count > 1) {
+        return;
+    }
+
+    /* The lease holds the connection, so its channel is still around */
+    struct aws_channel *channel = lease->leased_message->connection->channel_slot->channel;
+    if (aws_channel_thread_is_callers_thread(channel)) {
+        s_body_lease_destroy(lease);
+    } else {
+        aws_event_loop_schedule_task_now(aws_channel_get_event_loop(channel), &lease->release_task);
+    }
+}
@@ -11,6 +11,8 @@
 
 #include <aws/http/private/proxy_impl.h>
 
+#include <aws/common/clock.h>
+#include <aws/common/encoding.h>
 #include <aws/common/hash_table.h>
 #include <aws/common/mutex.h>
 #include <aws/common/string.h>
@@ -38,6 +40,12 @@ void aws_http_client_bootstrap_destroy(struct aws_http_client_bootstrap *bootstr
     if (bootstrap->alpn_string_map) {
         aws_hash_table_clean_up(bootstrap->alpn_string_map);
     }
+    aws_http_headers_release(bootstrap->http2_options.header_template);
+    aws_http_connection_memory_tracker_release(bootstrap->memory_tracker);
+    aws_http_message_release(bootstrap->http2_upgrade_request);
+    if (bootstrap->upgraded_http1_connection) {
+        aws_http_connection_release(bootstrap->upgraded_http1_connection);
+    }
     aws_mem_release(bootstrap->alloc, bootstrap);
 }
 
@@ -58,12 +66,20 @@ struct aws_http_server {
     aws_http_server_on_incoming_connection_fn *on_incoming_connection;
     aws_http_server_on_destroy_fn *on_destroy_complete;
     struct aws_socket *socket;
+    size_t max_connections;
+    size_t resume_connections_threshold;
+    uint64_t idle_timeout_ns;
+    uint64_t header_read_timeout_ns;
 
     /* Any thread may touch this data, but the lock must be held */
     struct {
         struct aws_mutex lock;
         bool is_shutting_down;
+        /* Every admitted channel. The value is NULL until its connection has been created */
         struct aws_hash_table channel_to_connection_map;
+        bool is_refusing_connections;
+        uint64_t accepted_connections;
+        uint64_t rejected_connections;
     } synced_data;
 };
 
@@ -91,7 +107,8 @@ struct aws_http_connection *aws_http_connection_new_channel_handler(
     const struct aws_hash_table *alpn_string_map,
     const struct aws_http1_connection_options *http1_options,
     const struct aws_http2_connection_options *http2_options,
-    void *connection_user_data) {
+    void *connection_user_data,
+    struct aws_http_connection_memory_tracker *memory_tracker) {
 
     struct aws_channel_slot *connection_slot = NULL;
     struct aws_http_connection *connection = NULL;
@@ -221,6 +238,11 @@ struct aws_http_connection *aws_http_connection_new_channel_handler(
     }
     connection->user_data = connection_user_data;
 
+    /* Before installation, so the connection knows about any read window budget before it opens its windows */
+    if (memory_tracker) {
+        aws_http_connection_set_memory_tracker(connection, memory_tracker);
+    }
+
     /* Connect handler and slot */
     if (aws_channel_slot_set_handler(connection_slot, &connection->channel_handler)) {
         AWS_LOGF_ERROR(
@@ -355,6 +377,30 @@ void aws_http2_connection_get_remote_settings(
     http2_connection->vtable->get_remote_settings(http2_connection, out_settings);
 }
 
+bool aws_http2_connection_get_local_enable_connect_protocol(const struct aws_http_connection *http2_connection) {
+    AWS_ASSERT(http2_connection);
+    AWS_PRECONDITION(http2_connection->vtable);
+    AWS_FATAL_ASSERT(http2_connection->http_version == AWS_HTTP_VERSION_2);
+    return http2_connection->vtable->get_local_enable_connect_protocol(http2_connection);
+}
+
+bool aws_http2_connection_get_remote_enable_connect_protocol(const struct aws_http_connection *http2_connection) {
+    AWS_ASSERT(http2_connection);
+    AWS_PRECONDITION(http2_connection->vtable);
+    AWS_FATAL_ASSERT(http2_connection->http_version == AWS_HTTP_VERSION_2);
+    return http2_connection->vtable->get_remote_enable_connect_protocol(http2_connection);
+}
+
+int aws_http2_connection_get_rtt_estimate(
+    const struct aws_http_connection *http2_connection,
+    struct aws_http2_rtt_estimate *out_estimate) {
+    AWS_ASSERT(http2_connection);
+    AWS_PRECONDITION(out_estimate);
+    AWS_PRECONDITION(http2_connection->vtable);
+    AWS_FATAL_ASSERT(http2_connection->http_version == AWS_HTTP_VERSION_2);
+    return http2_connection->vtable->get_rtt_estimate(http2_connection, out_estimate);
+}
+
 void aws_http2_connection_update_window(struct aws_http_connection *http2_connection, uint32_t increment_size) {
     AWS_ASSERT(http2_connection);
     AWS_PRECONDITION(http2_connection->vtable);
@@ -377,6 +423,376 @@ const struct aws_socket_endpoint *aws_http_connection_get_remote_endpoint(
     return &socket->remote_endpoint;
 }
 
+void aws_http_connection_atomic_memory_usage_init(struct aws_http_connection_atomic_memory_usage *usage) {
+    aws_atomic_init_int(&usage->decoder_scratch, 0);
+    aws_atomic_init_int(&usage->hpack_tables, 0);
+    aws_atomic_init_int(&usage->outgoing_queue, 0);
+    aws_atomic_init_int(&usage->buffered_headers, 0);
+    aws_atomic_init_int(&usage->unconsumed_reads, 0);
+    aws_atomic_init_int(&usage->frame_cache, 0);
+}
+
+static void s_atomic_memory_usage_load(
+    const struct aws_http_connection_atomic_memory_usage *usage,
+    struct aws_http_connection_memory_usage *out_usage) {
+
+    out_usage->decoder_scratch = aws_atomic_load_int(&usage->decoder_scratch);
+    out_usage->hpack_tables = aws_atomic_load_int(&usage->hpack_tables);
+    out_usage->outgoing_queue = aws_atomic_load_int(&usage->outgoing_queue);
+    out_usage->buffered_headers = aws_atomic_load_int(&usage->buffered_headers);
+    out_usage->unconsumed_reads = aws_atomic_load_int(&usage->unconsumed_reads);
+    out_usage->frame_cache = aws_atomic_load_int(&usage->frame_cache);
+}
+
+void aws_http_connection_get_memory_usage(
+    const struct aws_http_connection *connection,
+    struct aws_http_connection_memory_usage *out_usage) {
+    AWS_PRECONDITION(connection);
+    AWS_PRECONDITION(out_usage);
+
+    s_atomic_memory_usage_load(&connection->memory_usage, out_usage);
+}
+
+static void s_memory_tracker_destroy(void *user_data) {
+    struct aws_http_connection_memory_tracker *tracker = user_data;
+    AWS_ASSERT(tracker->synced_data.reserved == 0);
+    AWS_ASSERT(aws_linked_list_empty(&tracker->synced_data.waiting_list));
+    aws_mutex_clean_up(&tracker->synced_data.lock);
+    aws_mem_release(tracker->allocator, tracker);
+}
+
+struct aws_http_connection_memory_tracker *aws_http_connection_memory_tracker_new(
+    struct aws_allocator *allocator,
+    size_t read_window_budget) {
+
+    struct aws_http_connection_memory_tracker *tracker =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_http_connection_memory_tracker));
+    tracker->allocator = allocator;
+    aws_ref_count_init(&tracker->ref_count, tracker, s_memory_tracker_destroy);
+    aws_http_connection_atomic_memory_usage_init(&tracker->totals);
+    tracker->read_window_budget = read_window_budget;
+    aws_mutex_init(&tracker->synced_data.lock);
+    aws_linked_list_init(&tracker->synced_data.waiting_list);
+    return tracker;
+}
+
+struct aws_http_connection_memory_tracker *aws_http_connection_memory_tracker_acquire(
+    struct aws_http_connection_memory_tracker *tracker) {
+    if (tracker) {
+        aws_ref_count_acquire(&tracker->ref_count);
+    }
+    return tracker;
+}
+
+void aws_http_connection_memory_tracker_release(struct aws_http_connection_memory_tracker *tracker) {
+    if (tracker) {
+        aws_ref_count_release(&tracker->ref_count);
+    }
+}
+
+void aws_http_connection_memory_tracker_get_usage(
+    const struct aws_http_connection_memory_tracker *tracker,
+    struct aws_http_connection_memory_usage *out_usage) {
+    AWS_PRECONDITION(tracker);
+    AWS_PRECONDITION(out_usage);
+
+    s_atomic_memory_usage_load(&tracker->totals, out_usage);
+}
+
+/* Only the connection's thread sets `value`, but the `total` is shared with other connections */
+static void s_set_memory_usage_value(struct aws_atomic_var *value, struct aws_atomic_var *total, size_t new_value) {
+    size_t old_value = aws_atomic_exchange_int(value, new_value);
+    if (total == NULL || new_value == old_value) {
+        return;
+    }
+
+    if (new_value > old_value) {
+        aws_atomic_fetch_add(total, new_value - old_value);
+    } else {
+        aws_atomic_fetch_sub(total, old_value - new_value);
+    }
+}
+
+void aws_http_connection_set_memory_usage(
+    struct aws_http_connection *connection,
+    const struct aws_http_connection_memory_usage *usage) {
+
+    struct aws_http_connection_atomic_memory_usage *values = &connection->memory_usage;
+    struct aws_http_connection_atomic_memory_usage *totals =
+        connection->memory_tracker ? &connection->memory_tracker->totals : NULL;
+
+    s_set_memory_usage_value(
+        &values->decoder_scratch, totals ? &totals->decoder_scratch : NULL, usage->decoder_scratch);
+    s_set_memory_usage_value(&values->hpack_tables, totals ? &totals->hpack_tables : NULL, usage->hpack_tables);
+    s_set_memory_usage_value(&values->outgoing_queue, totals ? &totals->outgoing_queue : NULL, usage->outgoing_queue);
+    s_set_memory_usage_value(
+        &values->buffered_headers, totals ? &totals->buffered_headers : NULL, usage->buffered_headers);
+    s_set_memory_usage_value(
+        &values->unconsumed_reads, totals ? &totals->unconsumed_reads : NULL, usage->unconsumed_reads);
+    s_set_memory_usage_value(&values->frame_cache, totals ? &totals->frame_cache : NULL, usage->frame_cache);
+}
+
+static void s_memory_tracker_lock_synced_data(struct aws_http_connection_memory_tracker *tracker) {
+    int err = aws_mutex_lock(&tracker->synced_data.lock);
+    AWS_ASSERT(!err);
+    (void)err;
+}
+
+static void s_memory_tracker_unlock_synced_data(struct aws_http_connection_memory_tracker *tracker) {
+    int err = aws_mutex_unlock(&tracker->synced_data.lock);
+    AWS_ASSERT(!err);
+    (void)err;
+}
+
+static void s_read_window_budget_retry_task(struct aws_channel_task *task, void *arg, enum aws_task_status status) {
+    (void)task;
+    if (status != AWS_TASK_STATUS_RUN_READY) {
+        /* The channel is shutting down. This may run on the thread that scheduled it, with the tracker's lock held,
+         * so don't touch anything */
+        return;
+    }
+
+    struct aws_http_connection *connection = arg;
+    { /* BEGIN CRITICAL SECTION */
+        s_memory_tracker_lock_synced_data(connection->memory_tracker);
+        connection->read_window_budget.is_retry_task_scheduled = false;
+        s_memory_tracker_unlock_synced_data(connection->memory_tracker);
+    } /* END CRITICAL SECTION */
+
+    connection->vtable->on_read_window_budget_available(connection);
+}
+
+/* Budget was released, have every waiting connection try again. The tracker's lock must be held */
+static void s_read_window_budget_notify_waiting_synced(struct aws_http_connection_memory_tracker *tracker) {
+    while (!aws_linked_list_empty(&tracker->synced_data.waiting_list)) {
+        struct aws_linked_list_node *node = aws_linked_list_pop_front(&tracker->synced_data.waiting_list);
+        struct aws_http_connection *waiting =
+            AWS_CONTAINER_OF(node, struct aws_http_connection, read_window_budget.waiting_node);
+        waiting->read_window_budget.is_waiting = false;
+
+        if (!waiting->read_window_budget.is_retry_task_scheduled) {
+            waiting->read_window_budget.is_retry_task_scheduled = true;
+            aws_channel_schedule_task_now(waiting->channel_slot->channel, &waiting->read_window_budget.retry_task);
+        }
+    }
+}
+
+bool aws_http_connection_has_read_window_budget(const struct aws_http_connection *connection) {
+    return connection->memory_tracker && connection->memory_tracker->read_window_budget > 0;
+}
+
+size_t aws_http_connection_update_read_window_budget(
+    struct aws_http_connection *connection,
+    size_t in_use,
+    size_t increment_size) {
+    AWS_PRECONDITION(aws_channel_thread_is_callers_thread(connection->channel_slot->channel));
+
+    if (!aws_http_connection_has_read_window_budget(connection)) {
+        return increment_size;
+    }
+
+    struct aws_http_connection_memory_tracker *tracker = connection->memory_tracker;
+    const size_t budget = tracker->read_window_budget;
+    const size_t prev_reserved = connection->read_window_budget.reserved;
+    size_t granted = 0;
+
+    { /* BEGIN CRITICAL SECTION */
+        s_memory_tracker_lock_synced_data(tracker);
+
+        if (!connection->read_window_budget.is_counted) {
+            connection->read_window_budget.is_counted = true;
+            tracker->synced_data.connection_count++;
+        }
+
+        if (connection->read_window_budget.is_waiting) {
+            /* Trying again now, no need for a notification */
+            aws_linked_list_remove(&connection->read_window_budget.waiting_node);
+            connection->read_window_budget.is_waiting = false;
+        }
+
+        tracker->synced_data.reserved = tracker->synced_data.reserved - prev_reserved + in_use;
+
+        const size_t fair_share = budget / tracker->synced_data.connection_count;
+        const size_t available = aws_sub_size_saturating(budget, tracker->synced_data.reserved);
+
+        /* Whatever's available, up to the fair share. Beyond that, only what leaves a fair share for the others */
+        const size_t below_fair_share = aws_sub_size_saturating(fair_share, in_use);
+        granted = aws_min_size(increment_size, aws_min_size(available, below_fair_share));
+        const size_t above_fair_share = aws_sub_size_saturating(available - granted, fair_share);
+        granted += aws_min_size(increment_size - granted, above_fair_share);
+
+        connection->read_window_budget.reserved = in_use + granted;
+        tracker->synced_data.reserved += granted;
+
+        if (in_use < prev_reserved) {
+            s_read_window_budget_notify_waiting_synced(tracker);
+        }
+
+        if (granted < increment_size && connection->read_window_budget.reserved < fair_share) {
+            aws_linked_list_push_back(
+                &tracker->synced_data.waiting_list, &connection->read_window_budget.waiting_node);
+            connection->read_window_budget.is_waiting = true;
+        }
+
+        s_memory_tracker_unlock_synced_data(tracker);
+    } /* END CRITICAL SECTION */
+
+    if (granted < increment_size) {
+        AWS_LOGF_TRACE(
+            AWS_LS_HTTP_CONNECTION,
+            "id=%p: Read window budget granted %zu of the %zu bytes wanted, %zu were already in use.",
+            (void *)connection,
+            granted,
+            increment_size,
+            in_use);
+    }
+
+    return granted;
+}
+
+void aws_http_connection_set_memory_tracker(
+    struct aws_http_connection *connection,
+    struct aws_http_connection_memory_tracker *tracker) {
+    AWS_PRECONDITION(connection->memory_tracker == NULL);
+
+    aws_channel_task_init(
+        &connection->read_window_budget.retry_task,
+        s_read_window_budget_retry_task,
+        connection,
+        "http_connection_read_window_budget_retry");
+
+    /* Zero the values, then set them again, so what the connection already uses counts towards the totals */
+    struct aws_http_connection_memory_usage usage;
+    aws_http_connection_get_memory_usage(connection, &usage);
+    struct aws_http_connection_memory_usage zero_usage;
+    AWS_ZERO_STRUCT(zero_usage);
+    aws_http_connection_set_memory_usage(connection, &zero_usage);
+
+    connection->memory_tracker = aws_http_connection_memory_tracker_acquire(tracker);
+    aws_http_connection_set_memory_usage(connection, &usage);
+}
+
+void aws_http_connection_memory_usage_clean_up(struct aws_http_connection *connection) {
+    struct aws_http_connection_memory_usage zero_usage;
+    AWS_ZERO_STRUCT(zero_usage);
+    aws_http_connection_set_memory_usage(connection, &zero_usage);
+
+    struct aws_http_connection_memory_tracker *tracker = connection->memory_tracker;
+    if (tracker && connection->read_window_budget.is_counted) {
+        { /* BEGIN CRITICAL SECTION */
+            s_memory_tracker_lock_synced_data(tracker);
+            if (connection->read_window_budget.is_waiting) {
+                aws_linked_list_remove(&connection->read_window_budget.waiting_node);
+                connection->read_window_budget.is_waiting = false;
+            }
+            tracker->synced_data.connection_count--;
+            tracker->synced_data.reserved -= connection->read_window_budget.reserved;
+            if (connection->read_window_budget.reserved > 0) {
+                s_read_window_budget_notify_waiting_synced(tracker);
+            }
+            s_memory_tracker_unlock_synced_data(tracker);
+        } /* END CRITICAL SECTION */
+
+        connection->read_window_budget.reserved = 0;
+        connection->read_window_budget.is_counted = false;
+    }
+
+    aws_http_connection_memory_tracker_release(connection->memory_tracker);
+    connection->memory_tracker = NULL;
+}
+
+static void s_on_server_timeout_expired(struct aws_http_timer_wheel_entry *entry, void *user_data) {
+    (void)entry;
+    struct aws_http_connection *connection = user_data;
+    AWS_LOGF_DEBUG(
+        AWS_LS_HTTP_CONNECTION,
+        "id=%p: Closing connection, %s timeout expired.",
+        (void *)connection,
+        connection->server_timeouts.is_reading_head ? "header-read" : "idle");
+
+    aws_channel_shutdown(connection->channel_slot->channel, AWS_ERROR_HTTP_SERVER_CONNECTION_TIMEOUT);
+}
+
+/* Arm the entry timeout_ns from now, or disarm it if that timeout is off */
+static void s_server_timeouts_arm(struct aws_http_connection *connection, uint64_t timeout_ns) {
+    if (timeout_ns == 0) {
+        aws_http_timer_wheel_cancel(connection->server_timeouts.wheel, &connection->server_timeouts.entry);
+        return;
+    }
+
+    uint64_t now_ns = 0;
+    aws_channel_current_clock_time(connection->channel_slot->channel, &now_ns);
+    aws_http_timer_wheel_schedule(
+        connection->server_timeouts.wheel,
+        &connection->server_timeouts.entry,
+        aws_add_u64_saturating(now_ns, timeout_ns));
+}
+
+int aws_http_connection_start_server_timeouts(
+    struct aws_http_connection *connection,
+    uint64_t idle_timeout_ns,
+    uint64_t header_read_timeout_ns) {
+
+    AWS_PRECONDITION(connection);
+    AWS_PRECONDITION(connection->server_data);
+    AWS_PRECONDITION(aws_channel_thread_is_callers_thread(connection->channel_slot->channel));
+
+    if (idle_timeout_ns == 0 && header_read_timeout_ns == 0) {
+        return AWS_OP_SUCCESS;
+    }
+
+    struct aws_http_timer_wheel *wheel =
+        aws_http_timer_wheel_get(aws_channel_get_event_loop(connection->channel_slot->channel));
+    if (!wheel) {
+        return AWS_OP_ERR;
+    }
+
+    connection->server_timeouts.wheel = wheel;
+    connection->server_timeouts.idle_timeout_ns = idle_timeout_ns;
+    connection->server_timeouts.header_read_timeout_ns = header_read_timeout_ns;
+    aws_http_timer_wheel_entry_init(&connection->server_timeouts.entry, s_on_server_timeout_expired, connection);
+
+    aws_http_connection_server_timeouts_on_idle(connection);
+    return AWS_OP_SUCCESS;
+}
+
+void aws_http_connection_server_timeouts_on_idle(struct aws_http_connection *connection) {
+    if (!connection->server_timeouts.wheel) {
+        return;
+    }
+
+    connection->server_timeouts.is_reading_head = false;
+    s_server_timeouts_arm(connection, connection->server_timeouts.idle_timeout_ns);
+}
+
+void aws_http_connection_server_timeouts_on_head_begin(struct aws_http_connection *connection) {
+    /* The clock doesn't restart as more of the head trickles in, that's the point */
+    if (!connection->server_timeouts.wheel || connection->server_timeouts.is_reading_head) {
+        return;
+    }
+
+    connection->server_timeouts.is_reading_head = true;
+    s_server_timeouts_arm(connection, connection->server_timeouts.header_read_timeout_ns);
+}
+
+void aws_http_connection_server_timeouts_on_head_done(struct aws_http_connection *connection) {
+    if (!connection->server_timeouts.wheel) {
+        return;
+    }
+
+    connection->server_timeouts.is_reading_head = false;
+    aws_http_timer_wheel_cancel(connection->server_timeouts.wheel, &connection->server_timeouts.entry);
+}
+
+void aws_http_connection_stop_server_timeouts(struct aws_http_connection *connection) {
+    if (!connection->server_timeouts.wheel) {
+        return;
+    }
+
+    aws_http_timer_wheel_cancel(connection->server_timeouts.wheel, &connection->server_timeouts.entry);
+    connection->server_timeouts.wheel = NULL;
+}
+
 int aws_http_alpn_map_init(struct aws_allocator *allocator, struct aws_hash_table *map) {
     AWS_ASSERT(allocator);
     AWS_ASSERT(map);
@@ -431,6 +847,26 @@ void aws_http_connection_release(struct aws_http_connection *connection) {
     }
 }
 
+/* Whether an incoming channel should be refused because of max_connections.
+ * Refusing starts at max_connections, and lasts until the count drains to resume_connections_threshold. */
+static bool s_server_is_refusing_connections_synced(struct aws_http_server *server) {
+    if (server->max_connections == 0) {
+        return false;
+    }
+
+    if (!server->synced_data.is_refusing_connections &&
+        aws_hash_table_get_entry_count(&server->synced_data.channel_to_connection_map) >= server->max_connections) {
+        AWS_LOGF_INFO(
+            AWS_LS_HTTP_SERVER,
+            "%p: Reached max_connections=%zu, refusing connections until there are %zu.",
+            (void *)server,
+            server->max_connections,
+            server->resume_connections_threshold);
+        server->synced_data.is_refusing_connections = true;
+    }
+    return server->synced_data.is_refusing_connections;
+}
+
 /* At this point, the server bootstrapper has accepted an incoming connection from a client and set up a channel.
  * Now we need to create an aws_http_connection and insert it into the channel as a channel-handler.
  * Note: Be careful not to access server->socket until lock is acquired to avoid race conditions */
@@ -455,6 +891,45 @@ static void s_server_bootstrap_on_accept_channel_setup(
 
         goto error;
     }
+
+    /* Admit the channel before spending anything on it. It goes in the map right away,
+     * so channels still being set up on other event-loops count against max_connections */
+    int put_err = 0;
+    /* BEGIN CRITICAL SECTION */
+    s_server_lock_synced_data(server);
+    if (s_server_is_refusing_connections_synced(server)) {
+        error_code = AWS_ERROR_HTTP_SERVER_CONNECTION_LIMIT_REACHED;
+        ++server->synced_data.rejected_connections;
+    } else {
+        put_err = aws_hash_table_put(&server->synced_data.channel_to_connection_map, channel, NULL, NULL);
+        if (!put_err) {
+            ++server->synced_data.accepted_connections;
+        }
+    }
+    s_server_unlock_synced_data(server);
+    /* END CRITICAL SECTION */
+    if (error_code) {
+        AWS_LOGF_DEBUG(
+            AWS_LS_HTTP_SERVER,
+            "%p: Refusing incoming connection, the server has reached max_connections=%zu.",
+            (void *)server,
+            server->max_connections);
+        goto error;
+    }
+
+    if (put_err) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_SERVER,
+            "%p: %s:%d: Failed to store connection object, error %d (%s).",
+            (void *)server,
+            server->socket->local_endpoint.address,
+            server->socket->local_endpoint.port,
+            aws_last_error(),
+            aws_error_name(aws_last_error()));
+
+        goto error;
+    }
+
     /* Create connection */
     /* TODO: expose http1/2 options to server API */
     struct aws_http1_connection_options http1_options;
@@ -472,7 +947,8 @@ static void s_server_bootstrap_on_accept_channel_setup(
         NULL, /* alpn_string_map */
         &http1_options,
         &http2_options,
-        NULL /* connection_user_data */);
+        NULL /* connection_user_data */,
+        NULL /* memory_tracker */);
     if (!connection) {
         AWS_LOGF_ERROR(
             AWS_LS_HTTP_SERVER,
@@ -484,14 +960,17 @@ static void s_server_bootstrap_on_accept_channel_setup(
         goto error;
     }
 
-    int put_err = 0;
     /* BEGIN CRITICAL SECTION */
     s_server_lock_synced_data(server);
     if (server->synced_data.is_shutting_down) {
         error_code = AWS_ERROR_HTTP_CONNECTION_CLOSED;
     }
     if (!error_code) {
-        put_err = aws_hash_table_put(&server->synced_data.channel_to_connection_map, channel, connection, NULL);
+        /* The channel can't have left the map, it only leaves once the channel has shut down */
+        struct aws_hash_element *map_elem = NULL;
+        aws_hash_table_find(&server->synced_data.channel_to_connection_map, channel, &map_elem);
+        AWS_FATAL_ASSERT(map_elem);
+        map_elem->value = connection;
     }
     s_server_unlock_synced_data(server);
     /* END CRITICAL SECTION */
@@ -503,19 +982,6 @@ static void s_server_bootstrap_on_accept_channel_setup(
         goto error;
     }
 
-    if (put_err) {
-        AWS_LOGF_ERROR(
-            AWS_LS_HTTP_SERVER,
-            "%p: %s:%d: Failed to store connection object, error %d (%s).",
-            (void *)server,
-            server->socket->local_endpoint.address,
-            server->socket->local_endpoint.port,
-            aws_last_error(),
-            aws_error_name(aws_last_error()));
-
-        goto error;
-    }
-
     /* Tell user of successful connection. */
     AWS_LOGF_INFO(
         AWS_LS_HTTP_CONNECTION,
@@ -540,6 +1006,17 @@ static void s_server_bootstrap_on_accept_channel_setup(
         aws_raise_error(AWS_ERROR_HTTP_REACTION_REQUIRED);
         goto error;
     }
+
+    if (aws_http_connection_start_server_timeouts(
+            connection, server->idle_timeout_ns, server->header_read_timeout_ns)) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_CONNECTION,
+            "id=%p: Failed to start connection timeouts, error %d (%s).",
+            (void *)connection,
+            aws_last_error(),
+            aws_error_name(aws_last_error()));
+        goto error;
+    }
     return;
 
 error:
@@ -599,10 +1076,17 @@ static void s_server_bootstrap_on_accept_channel_shutdown(
     s_server_lock_synced_data(server);
     int remove_err =
         aws_hash_table_remove(&server->synced_data.channel_to_connection_map, channel, &map_elem, &was_present);
+    if (server->synced_data.is_refusing_connections &&
+        aws_hash_table_get_entry_count(&server->synced_data.channel_to_connection_map) <=
+            server->resume_connections_threshold) {
+        AWS_LOGF_INFO(AWS_LS_HTTP_SERVER, "%p: Connections have drained, accepting connections again.", (void *)server);
+        server->synced_data.is_refusing_connections = false;
+    }
     s_server_unlock_synced_data(server);
     /* END CRITICAL SECTION */
 
-    if (!remove_err && was_present) {
+    /* The connection is NULL if the channel shut down before it was created */
+    if (!remove_err && was_present && map_elem.value) {
         struct aws_http_connection *connection = map_elem.value;
         AWS_LOGF_INFO(AWS_LS_HTTP_CONNECTION, "id=%p: Server connection shut down.", (void *)connection);
         /* Tell user about shutdown */
@@ -635,6 +1119,15 @@ struct aws_http_server *aws_http_server_new(const struct aws_http_server_options
         return NULL;
     }
 
+    if ((options->max_connections == 0 && options->resume_connections_threshold != 0) ||
+        (options->max_connections != 0 && options->resume_connections_threshold >= options->max_connections)) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_SERVER,
+            "static: Invalid options, resume_connections_threshold must be less than max_connections.");
+        aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
     server = aws_mem_calloc(options->allocator, 1, sizeof(struct aws_http_server));
     if (!server) {
         /* nothing to clean up */
@@ -649,6 +1142,15 @@ struct aws_http_server *aws_http_server_new(const struct aws_http_server_options
     server->on_incoming_connection = options->on_incoming_connection;
     server->on_destroy_complete = options->on_destroy_complete;
     server->manual_window_management = options->manual_window_management;
+    server->max_connections = options->max_connections;
+    server->resume_connections_threshold = options->resume_connections_threshold;
+    server->idle_timeout_ns =
+        aws_timestamp_convert(options->idle_timeout_ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+    server->header_read_timeout_ns =
+        aws_timestamp_convert(options->header_read_timeout_ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+    if (server->max_connections != 0 && server->resume_connections_threshold == 0) {
+        server->resume_connections_threshold = server->max_connections - 1;
+    }
 
     int err = aws_mutex_init(&server->synced_data.lock);
     if (err) {
@@ -762,6 +1264,266 @@ void aws_http_server_release(struct aws_http_server *server) {
      * clean up will be called from eventloop */
 }
 
+void aws_http_server_fetch_metrics(const struct aws_http_server *server, struct aws_http_server_metrics *out_metrics) {
+    AWS_PRECONDITION(server);
+    AWS_PRECONDITION(out_metrics);
+
+    struct aws_http_server *mutable_server = (struct aws_http_server *)server;
+    /* BEGIN CRITICAL SECTION */
+    s_server_lock_synced_data(mutable_server);
+    out_metrics->current_connections =
+        aws_hash_table_get_entry_count(&mutable_server->synced_data.channel_to_connection_map);
+    out_metrics->accepted_connections = mutable_server->synced_data.accepted_connections;
+    out_metrics->rejected_connections = mutable_server->synced_data.rejected_connections;
+    out_metrics->is_refusing_connections = mutable_server->synced_data.is_refusing_connections;
+    s_server_unlock_synced_data(mutable_server);
+    /* END CRITICAL SECTION */
+}
+
+/* Build the "OPTIONS *" request that asks a cleartext server to switch to HTTP/2 (RFC-7540 3.2).
+ * A request of its own is used, rather than the user's first one, so the user always gets their
+ * connection with no streams on it, whichever protocol the server picks. */
+static struct aws_http_message *s_new_http2_upgrade_request(
+    struct aws_allocator *allocator,
+    struct aws_byte_cursor host_name,
+    uint32_t port,
+    const struct aws_http2_connection_options *http2_options) {
+
+    struct aws_http_message *request = NULL;
+    struct aws_byte_buf host_value;
+    struct aws_byte_buf settings_payload;
+    struct aws_byte_buf settings_value;
+    AWS_ZERO_STRUCT(host_value);
+    AWS_ZERO_STRUCT(settings_payload);
+    AWS_ZERO_STRUCT(settings_value);
+
+    /* Leave out the port when it's the default for "http" */
+    if (aws_byte_buf_init_copy_from_cursor(&host_value, allocator, host_name)) {
+        goto error;
+    }
+    if (port != 80) {
+        char port_str[16];
+        snprintf(port_str, sizeof(port_str), ":%d", (int)port);
+        struct aws_byte_cursor port_cursor = aws_byte_cursor_from_c_str(port_str);
+        if (aws_byte_buf_append_dynamic(&host_value, &port_cursor)) {
+            goto error;
+        }
+    }
+
+    /* HTTP2-Settings carries the payload of a SETTINGS frame, base64url encoded without padding (RFC-7540 3.2.1).
+     * The value can't be empty (token68), so with no settings of our own, send a couple at their defaults */
+    struct aws_http2_setting default_settings[] = {
+        {
+            .id = AWS_HTTP2_SETTINGS_ENABLE_PUSH,
+            .value = aws_h2_settings_initial[AWS_HTTP2_SETTINGS_ENABLE_PUSH],
+        },
+        {
+            .id = AWS_HTTP2_SETTINGS_INITIAL_WINDOW_SIZE,
+            .value = aws_h2_settings_initial[AWS_HTTP2_SETTINGS_INITIAL_WINDOW_SIZE],
+        },
+    };
+    const struct aws_http2_setting *settings = http2_options->initial_settings_array;
+    size_t num_settings = http2_options->num_initial_settings;
+    if (num_settings == 0) {
+        settings = default_settings;
+        num_settings = AWS_ARRAY_SIZE(default_settings);
+    }
+    if (aws_byte_buf_init(&settings_payload, allocator, num_settings * 6)) {
+        goto error;
+    }
+    for (size_t i = 0; i < num_settings; ++i) {
+        aws_byte_buf_write_be16(&settings_payload, (uint16_t)settings[i].id);
+        aws_byte_buf_write_be32(&settings_payload, settings[i].value);
+    }
+    size_t encoded_len = 0;
+    struct aws_byte_cursor payload_cursor = aws_byte_cursor_from_buf(&settings_payload);
+    if (aws_base64_compute_encoded_len(settings_payload.len, &encoded_len) ||
+        aws_byte_buf_init(&settings_value, allocator, encoded_len) ||
+        aws_base64_encode(&payload_cursor, &settings_value)) {
+        goto error;
+    }
+    while (settings_value.len > 0 && (settings_value.buffer[settings_value.len - 1] == '=' ||
+                                      settings_value.buffer[settings_value.len - 1] == '\0')) {
+        --settings_value.len;
+    }
+    for (size_t i = 0; i < settings_value.len; ++i) {
+        if (settings_value.buffer[i] == '+') {
+            settings_value.buffer[i] = '-';
+        } else if (settings_value.buffer[i] == '/') {
+            settings_value.buffer[i] = '_';
+        }
+    }
+
+    request = aws_http_message_new_request(allocator);
+    if (!request) {
+        goto error;
+    }
+
+    struct aws_http_header headers[] = {
+        {.name = aws_byte_cursor_from_c_str("Host"), .value = aws_byte_cursor_from_buf(&host_value)},
+        {
+            .name = aws_byte_cursor_from_c_str("Connection"),
+            .value = aws_byte_cursor_from_c_str("Upgrade, HTTP2-Settings"),
+        },
+        {.name = aws_byte_cursor_from_c_str("Upgrade"), .value = aws_byte_cursor_from_c_str("h2c")},
+        {.name = aws_byte_cursor_from_c_str("HTTP2-Settings"), .value = aws_byte_cursor_from_buf(&settings_value)},
+    };
+
+    if (aws_http_message_set_request_method(request, aws_http_method_options) ||
+        aws_http_message_set_request_path(request, aws_byte_cursor_from_c_str("*")) ||
+        aws_http_message_add_header_array(request, headers, AWS_ARRAY_SIZE(headers))) {
+        goto error;
+    }
+
+    aws_byte_buf_clean_up(&host_value);
+    aws_byte_buf_clean_up(&settings_payload);
+    aws_byte_buf_clean_up(&settings_value);
+    return request;
+
+error:
+    aws_http_message_release(request);
+    aws_byte_buf_clean_up(&host_value);
+    aws_byte_buf_clean_up(&settings_payload);
+    aws_byte_buf_clean_up(&settings_value);
+    return NULL;
+}
+
+/* The server switched protocols. Put an HTTP/2 connection on the end of the channel, and give it to the user */
+static int s_on_http2_upgrade_response_header_block_done(
+    struct aws_http_stream *stream,
+    enum aws_http_header_block header_block,
+    void *user_data) {
+
+    struct aws_http_client_bootstrap *http_bootstrap = user_data;
+
+    int status = 0;
+    if (header_block != AWS_HTTP_HEADER_BLOCK_INFORMATIONAL ||
+        aws_http_stream_get_incoming_response_status(stream, &status) ||
+        status != AWS_HTTP_STATUS_CODE_101_SWITCHING_PROTOCOLS) {
+        return AWS_OP_SUCCESS;
+    }
+
+    struct aws_http_connection *http2_connection = aws_http_connection_new_channel_handler(
+        http_bootstrap->alloc,
+        aws_http_connection_get_channel(http_bootstrap->connection),
+        false,
+        false,
+        http_bootstrap->stream_manual_window_management,
+        true /*prior_knowledge_http2*/,
+        http_bootstrap->initial_window_size,
+        NULL /*alpn_string_map*/,
+        &http_bootstrap->http1_options,
+        &http_bootstrap->http2_options,
+        http_bootstrap->user_data,
+        http_bootstrap->memory_tracker);
+    if (!http2_connection) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_CONNECTION,
+            "id=%p: Failed to create the HTTP/2 connection after upgrade, error %d (%s).",
+            (void *)http_bootstrap->connection,
+            aws_last_error(),
+            aws_error_name(aws_last_error()));
+        return AWS_OP_ERR;
+    }
+
+    if (aws_h2_connection_on_http1_upgrade(AWS_CONTAINER_OF(http2_connection, struct aws_h2_connection, base))) {
+        aws_http_connection_release(http2_connection);
+        return AWS_OP_ERR;
+    }
+
+    http2_connection->proxy_request_transform = http_bootstrap->proxy_request_transform;
+    http_bootstrap->upgraded_http1_connection = http_bootstrap->connection;
+    http_bootstrap->connection = http2_connection;
+
+    AWS_LOGF_INFO(
+        AWS_LS_HTTP_CONNECTION,
+        "id=%p: HTTP/2 client connection established, upgraded from HTTP/1.1 connection id=%p.",
+        (void *)http2_connection,
+        (void *)http_bootstrap->upgraded_http1_connection);
+
+    http_bootstrap->on_setup(http2_connection, AWS_ERROR_SUCCESS, http_bootstrap->user_data);
+    http_bootstrap->on_setup = NULL;
+    return AWS_OP_SUCCESS;
+}
+
+static int s_on_http2_upgrade_response_body(
+    struct aws_http_stream *stream,
+    const struct aws_byte_cursor *data,
+    void *user_data) {
+
+    struct aws_http_client_bootstrap *http_bootstrap = user_data;
+
+    /* Nobody reads this body, don't let it stall the connection */
+    if (http_bootstrap->stream_manual_window_management) {
+        aws_http_stream_update_window(stream, data->len);
+    }
+    return AWS_OP_SUCCESS;
+}
+
+/* Once upgraded, the request "completes" when the channel shuts down. Otherwise, the server declined and the
+ * HTTP/1.1 connection goes to the user, unless the request failed, in which case setup fails. */
+static void s_on_http2_upgrade_complete(struct aws_http_stream *stream, int error_code, void *user_data) {
+    struct aws_http_client_bootstrap *http_bootstrap = user_data;
+
+    AWS_ASSERT(stream == http_bootstrap->http2_upgrade_stream);
+    aws_http_stream_release(stream);
+    http_bootstrap->http2_upgrade_stream = NULL;
+
+    if (!http_bootstrap->on_setup) {
+        return;
+    }
+
+    if (error_code) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_CONNECTION,
+            "id=%p: HTTP/2 upgrade request failed, error %d (%s).",
+            (void *)http_bootstrap->connection,
+            error_code,
+            aws_error_name(error_code));
+
+        /* on_setup is told about the failure once the channel has shut down */
+        aws_channel_shutdown(aws_http_connection_get_channel(http_bootstrap->connection), error_code);
+        return;
+    }
+
+    AWS_LOGF_INFO(
+        AWS_LS_HTTP_CONNECTION,
+        "id=%p: Server declined the HTTP/2 upgrade, HTTP/1.1 client connection established.",
+        (void *)http_bootstrap->connection);
+
+    http_bootstrap->on_setup(http_bootstrap->connection, AWS_ERROR_SUCCESS, http_bootstrap->user_data);
+    http_bootstrap->on_setup = NULL;
+}
+
+static int s_send_http2_upgrade_request(struct aws_http_client_bootstrap *http_bootstrap) {
+    struct aws_http_make_request_options request_options = {
+        .self_size = sizeof(request_options),
+        .request = http_bootstrap->http2_upgrade_request,
+        .user_data = http_bootstrap,
+        .on_response_header_block_done = s_on_http2_upgrade_response_header_block_done,
+        .on_response_body = s_on_http2_upgrade_response_body,
+        .on_complete = s_on_http2_upgrade_complete,
+    };
+
+    http_bootstrap->http2_upgrade_stream =
+        aws_http_connection_make_request(http_bootstrap->connection, &request_options);
+    if (!http_bootstrap->http2_upgrade_stream) {
+        return AWS_OP_ERR;
+    }
+
+    if (aws_http_stream_activate(http_bootstrap->http2_upgrade_stream)) {
+        aws_http_stream_release(http_bootstrap->http2_upgrade_stream);
+        http_bootstrap->http2_upgrade_stream = NULL;
+        return AWS_OP_ERR;
+    }
+
+    AWS_LOGF_TRACE(
+        AWS_LS_HTTP_CONNECTION,
+        "id=%p: Sent HTTP/2 upgrade request, waiting for the response.",
+        (void *)http_bootstrap->connection);
+    return AWS_OP_SUCCESS;
+}
+
 /* At this point, the channel bootstrapper has established a connection to the server and set up a channel.
  * Now we need to create the aws_http_connection and insert it into the channel as a channel-handler. */
 static void s_client_bootstrap_on_channel_setup(
@@ -806,7 +1568,8 @@ static void s_client_bootstrap_on_channel_setup(
         http_bootstrap->alpn_string_map,
         &http_bootstrap->http1_options,
         &http_bootstrap->http2_options,
-        http_bootstrap->user_data);
+        http_bootstrap->user_data,
+        http_bootstrap->memory_tracker);
     if (!http_bootstrap->connection) {
         AWS_LOGF_ERROR(
             AWS_LS_HTTP_CONNECTION,
@@ -835,6 +1598,14 @@ static void s_client_bootstrap_on_channel_setup(
 
     http_bootstrap->connection->proxy_request_transform = http_bootstrap->proxy_request_transform;
 
+    if (http_bootstrap->http2_upgrade_request) {
+        /* The user hears about the connection once the server has answered the upgrade request */
+        if (s_send_http2_upgrade_request(http_bootstrap)) {
+            goto error;
+        }
+        return;
+    }
+
     AWS_LOGF_INFO(
         AWS_LS_HTTP_CONNECTION,
         "id=%p: " PRInSTR " client connection established.",
@@ -883,6 +1654,12 @@ static void s_client_bootstrap_on_channel_shutdown(
 
         http_bootstrap->on_setup(NULL, error_code, http_bootstrap->user_data);
 
+        /* The user never got the connection, so nobody else will release it */
+        if (http_bootstrap->connection) {
+            aws_http_connection_release(http_bootstrap->connection);
+            http_bootstrap->connection = NULL;
+        }
+
     } else if (http_bootstrap->on_shutdown) {
         AWS_LOGF_INFO(
             AWS_LS_HTTP_CONNECTION,
@@ -942,6 +1719,13 @@ int s_validate_http_client_connection_options(const struct aws_http_client_conne
         return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
     }
 
+    if (options->http2_upgrade && (options->tls_options || options->prior_knowledge_http2)) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_CONNECTION,
+            "static: HTTP/2 upgrade only works with cleartext TCP, and can't be used with prior knowledge.");
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+    }
+
     return AWS_OP_SUCCESS;
 }
 
@@ -1071,8 +1855,12 @@ int aws_http_client_connect_internal(
     http_bootstrap->on_setup = options.on_setup;
     http_bootstrap->on_shutdown = options.on_shutdown;
     http_bootstrap->proxy_request_transform = proxy_request_transform;
+    http_bootstrap->memory_tracker = aws_http_connection_memory_tracker_acquire(options.memory_tracker);
     http_bootstrap->http1_options = *options.http1_options;
     http_bootstrap->http2_options = *options.http2_options;
+    if (http_bootstrap->http2_options.header_template) {
+        aws_http_headers_acquire(http_bootstrap->http2_options.header_template);
+    }
 
     /* keep a copy of the settings array if it's not NULL */
     if (options.http2_options->num_initial_settings > 0) {
@@ -1094,6 +1882,14 @@ int aws_http_client_connect_internal(
         http_bootstrap->monitoring_options = *options.monitoring_options;
     }
 
+    if (options.http2_upgrade) {
+        http_bootstrap->http2_upgrade_request =
+            s_new_http2_upgrade_request(options.allocator, options.host_name, options.port, options.http2_options);
+        if (!http_bootstrap->http2_upgrade_request) {
+            goto error;
+        }
+    }
+
     AWS_LOGF_TRACE(
         AWS_LS_HTTP_CONNECTION,
         "static: attempting to initialize a new client channel to %s:%d",
@@ -1148,6 +1944,11 @@ int aws_http_client_connect(const struct aws_http_client_connection_options *opt
         return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
     }
 
+    if (options->http2_upgrade && options->proxy_options) {
+        AWS_LOGF_ERROR(AWS_LS_HTTP_CONNECTION, "static: HTTP/2 upgrade can't be used through a proxy.");
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+    }
+
     if (options->proxy_options != NULL) {
         return aws_http_client_connect_via_proxy(options);
     } else {
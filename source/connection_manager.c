@@ -6,18 +6,24 @@
 #include <aws/http/connection_manager.h>
 
 #include <aws/http/connection.h>
+#include <aws/http/private/connection_impl.h>
 #include <aws/http/private/connection_manager_system_vtable.h>
 #include <aws/http/private/connection_monitor.h>
 #include <aws/http/private/http_impl.h>
+#include <aws/http/private/manager_histogram.h>
 #include <aws/http/private/proxy_impl.h>
+#include <aws/http/private/tracing_impl.h>
+#include <aws/http/request_response.h>
 
 #include <aws/io/channel_bootstrap.h>
 #include <aws/io/event_loop.h>
+#include <aws/io/host_resolver.h>
 #include <aws/io/logging.h>
 #include <aws/io/socket.h>
 #include <aws/io/tls_channel_handler.h>
 #include <aws/io/uri.h>
 
+#include <aws/common/atomics.h>
 #include <aws/common/clock.h>
 #include <aws/common/hash_table.h>
 #include <aws/common/linked_list.h>
@@ -37,8 +43,56 @@ struct aws_idle_connection {
     struct aws_linked_list_node node;
     uint64_t cull_timestamp;
     struct aws_http_connection *connection;
+    /* Went idle as soon as it was set up, because no acquisition was waiting for it. Never vended yet */
+    bool is_prewarmed;
 };
 
+/*
+ * With max_http2_leases_per_connection, an HTTP/2 connection leased to one or more acquisitions at once, see
+ * "HTTP/2 multiplexing" below.
+ */
+struct aws_cm_shared_connection {
+    struct aws_allocator *allocator;
+    /* In manager->shared_connections_with_room while is_in_room_list */
+    struct aws_linked_list_node node;
+    struct aws_http_connection *connection;
+    size_t lease_count;
+    size_t max_leases;
+    bool is_in_room_list;
+};
+
+/*
+ * With enable_event_loop_shards, the idle connections of one event loop, see "Shards" below.
+ */
+struct aws_http_connection_manager_shard {
+    struct aws_event_loop *event_loop;
+
+    /* Protects everything below. Lock order is manager->lock, then a shard's lock */
+    struct aws_mutex lock;
+
+    /* List of aws_idle_connection, with the same ordering rules as manager->idle_connections */
+    struct aws_linked_list idle_connections;
+    size_t idle_connection_count;
+
+    /* Cleared when the manager starts shutting down. After that, everything goes through the manager's lock */
+    bool is_open;
+};
+
+static struct aws_event_loop *s_connection_get_event_loop(struct aws_http_connection *connection) {
+    return aws_channel_get_event_loop(aws_http_connection_get_channel(connection));
+}
+
+static uint32_t s_connection_get_max_concurrent_streams(const struct aws_http_connection *connection) {
+    struct aws_http2_setting settings[AWS_HTTP2_SETTINGS_COUNT];
+    /* The setting id equals to the index plus one. */
+    aws_http2_connection_get_remote_settings(connection, settings);
+    return settings[AWS_HTTP2_SETTINGS_MAX_CONCURRENT_STREAMS - 1].value;
+}
+
+static uint64_t s_connection_get_proxy_keep_alive_timeout(const struct aws_http_connection *connection) {
+    return connection->proxy_keep_alive_timeout_ms;
+}
+
 /*
  * System vtable to use under normal circumstances
  */
@@ -51,6 +105,9 @@ static struct aws_http_connection_manager_system_vtable s_default_system_vtable
     .is_callers_thread = aws_channel_thread_is_callers_thread,
     .connection_get_channel = aws_http_connection_get_channel,
     .connection_get_version = aws_http_connection_get_version,
+    .connection_get_event_loop = s_connection_get_event_loop,
+    .connection_get_max_concurrent_streams = s_connection_get_max_concurrent_streams,
+    .connection_get_proxy_keep_alive_timeout = s_connection_get_proxy_keep_alive_timeout,
 };
 
 const struct aws_http_connection_manager_system_vtable *g_aws_http_connection_manager_default_system_vtable_ptr =
@@ -141,6 +198,67 @@ enum aws_http_connection_manager_count_type {
  * During the transition from READY to SHUTTING_DOWN, we flush the pending acquisition queue (with failure callbacks)
  *   and since we disallow new acquires, pending_acquisition_count should always be zero after the transition.
  *
+ * Shards
+ * With enable_event_loop_shards, there's one shard per event loop in the bootstrap's group, each holding the idle
+ * connections whose channels live on that loop, under the shard's own lock. The manager's lock is still what
+ * protects all the counters and the pending acquisition queue, the shards only take the common paths off it:
+ *
+ *   Acquire - take an idle connection from the caller's shard. If it's empty, steal from the other shards.
+ *      Only if every shard is empty does the acquisition go through the usual transaction.
+ *   Release - a connection that's still usable goes straight onto its shard's idle stack, unless acquisitions
+ *      are pending. Then it goes through the usual transaction, so the front acquisition gets it.
+ *
+ * To keep the counts right without the manager's lock, a connection sitting idle in a shard still counts as
+ * vended (AWS_HCMCT_VENDED_CONNECTION), as if the shard were a user holding it. The fast paths move connections
+ * between users and shards, which never changes a count. max_connections is enforced exactly as before, since
+ * every open connection is still vended, pending or waiting for settings. The vended count goes down when a
+ * shard's idle connection is closed, culled or flushed by shutdown, all under the manager's lock.
+ *
+ * manager->idle_connections is only used within a transaction: a connection made idle there is either vended to
+ * a pending acquisition, or moved onto its shard (and counted as vended) before the transaction's lock is released.
+ *
+ * A release reads pending_acquisition_count_hint while holding its shard's lock, and an acquire stores the hint
+ * before looking through the shards under their locks. So either the release sees the pending acquisition and
+ * takes the slow path, or the acquire finds the released connection. A released connection can't sit idle while
+ * an acquisition waits for it.
+ *
+ * Event loops
+ * An acquisition may ask for a connection on a particular event loop (aws_http_connection_manager_acquire_connection_
+ * with_options()). Idle connections on that loop are vended to it first, and new connections made for it are
+ * created on that loop. If it requires the loop, it's only ever given a connection there, so it can stay pending
+ * while idle connections on other loops exist. When that leaves no room under max_connections for the connection it
+ * needs, the oldest idle connections are closed to make some.
+ *
+ * Prewarming
+ * Every transaction also opens connections ahead of demand: as many as aws_http_connection_manager_prewarm() asked
+ * for, or enough to keep min_idle_connections idle or being set up once the pending acquisitions are served,
+ * whichever is more. Culling stops at min_idle_connections too. After a failed connect, filling min_idle_connections
+ * waits for the next transaction or cull task, so an unreachable host isn't retried in a tight loop.
+ *
+ * Tunneling proxies
+ * Each connection through a tunneling proxy is its own CONNECT tunnel, set up along with the connection and closed
+ * with it, so pooling connections is what pools tunnels, and prewarming opens tunnels ahead of demand. What the
+ * manager adds is keep-alive awareness: a proxy that answers CONNECT with "Keep-Alive: timeout=N" may drop the
+ * tunnel after N idle seconds, so with max_connection_idle_in_milliseconds set, such a connection is culled a
+ * little before that instead, rather than being vended dead. Idle lists stay sorted by cull time, connections
+ * that cull sooner are filed ahead of later ones.
+ *
+ * Acquisition timeouts
+ * With connection_acquisition_timeout_ms, every acquisition that has to wait gets the same timeout. Acquisitions are
+ * only ever added to the back of pending_acquisitions, so the queue is sorted by deadline and a single task, scheduled
+ * for the deadline at the front, fails the expired acquisitions without looking at the rest of the queue.
+ * max_pending_connection_acquisitions bounds the queue: an acquisition that would wait behind that many fails
+ * right away.
+ *
+ * HTTP/2 multiplexing
+ * With max_http2_leases_per_connection, vending an idle HTTP/2 connection makes it shared
+ * (aws_cm_shared_connection): until it's out of leases, the following acquisitions are given the same connection
+ * before any idle connection, so streams pile onto few connections rather than each getting its own. A shared
+ * connection counts as one vended connection however many leases it has. Releasing a lease only gives the connection
+ * back (to the idle pool, or to be closed) once it was the last one. A connection that stops taking new requests,
+ * after a GOAWAY for example, stops taking new leases too.
+ * With http2_prior_knowledge, each connection being opened is counted as serving that many pending acquisitions, so
+ * a burst of acquisitions opens only as many connections as it needs.
  */
 struct aws_http_connection_manager {
     struct aws_allocator *allocator;
@@ -183,12 +301,14 @@ struct aws_http_connection_manager {
     /*
      * The set of all available, ready-to-be-used connections, as aws_idle_connection structs.
      *
-     * This must be a LIFO stack.  When connections are released by the user, they must be added on to the back.
-     * When we vend connections to the user, they must be removed from the back first.
+     * When connections are released by the user, they must be added on to the back.
      * In this way, the list will always be sorted from oldest (in terms of time spent idle) to newest.  This means
      * we can always use the cull timestamp of the front connection as the next scheduled time for culling.
      * It also means that when we cull connections, we can quit the loop as soon as we find a connection
      * whose timestamp is greater than the current timestamp.
+     *
+     * Connections are vended from the back (AWS_HCMIS_MRU, so it's a LIFO stack) or the front (AWS_HCMIS_LRU),
+     * see idle_selection.  Removing from either end, or from the middle, keeps the list sorted.
      */
     struct aws_linked_list idle_connections;
 
@@ -237,13 +357,17 @@ struct aws_http_connection_manager {
     struct proxy_env_var_settings proxy_ev_settings;
     struct aws_tls_connection_options *proxy_ev_tls_options;
     uint16_t port;
+    struct aws_host_resolution_config host_resolution_config;
+    bool has_host_resolution_config;
     /*
      * HTTP/2 specific.
      */
     bool http2_prior_knowledge;
+    bool http2_upgrade;
     struct aws_array_list *initial_settings;
     size_t max_closed_streams;
     bool http2_conn_manual_window_management;
+    struct aws_http_headers *http2_header_template;
 
     /*
      * The maximum number of connections this manager should ever have at once.
@@ -292,6 +416,84 @@ struct aws_http_connection_manager {
      */
     struct aws_task *cull_task;
     struct aws_event_loop *cull_event_loop;
+
+    /*
+     * Task to fail acquisitions that waited longer than connection_acquisition_timeout_ms, see "Acquisition timeouts"
+     * above. Also runs on the cull_event_loop. Only scheduled while acquisitions are pending.
+     */
+    uint64_t connection_acquisition_timeout_ms;
+    struct aws_task *acquisition_timeout_task;
+    bool is_acquisition_timeout_task_scheduled;
+
+    /*
+     * If non-zero, acquisitions fail instead of waiting once this many are pending
+     */
+    size_t max_pending_connection_acquisitions;
+
+    /*
+     * With enable_event_loop_shards, one shard per event loop of the bootstrap's group. NULL otherwise.
+     */
+    struct aws_http_connection_manager_shard *shards;
+    size_t shard_count;
+
+    /*
+     * Copy of pending_acquisition_count, written with the lock held, read by shards without it
+     */
+    struct aws_atomic_var pending_acquisition_count_hint;
+
+    /*
+     * Round-robin starting shard for acquires made off the manager's event loops
+     */
+    struct aws_atomic_var next_shard_index;
+
+    /*
+     * The number of idle connections to keep open ahead of demand, see "Prewarming" above
+     */
+    size_t min_idle_connections;
+
+    /*
+     * Which end of an idle connection list to vend from, see idle_connections
+     */
+    enum aws_http_connection_manager_idle_selection idle_selection;
+
+    /*
+     * The number of acquisitions served by a prewarmed connection. Atomic since the shards' fast path counts too
+     */
+    struct aws_atomic_var prewarmed_acquire_count;
+
+    /*
+     * See aws_http_manager_latency_metrics. Recorded without the lock
+     */
+    struct aws_http_atomic_histogram acquisition_wait_histogram;
+    struct aws_http_atomic_histogram connection_setup_histogram;
+    struct aws_http_atomic_histogram http2_settings_histogram;
+    struct aws_http_atomic_histogram connection_lifetime_histogram;
+
+    /*
+     * Every connection adds its memory usage here, see aws_http_connection_manager_fetch_memory_usage()
+     */
+    struct aws_http_connection_memory_tracker *memory_tracker;
+
+    /*
+     * See "HTTP/2 multiplexing" above. 0 if disabled
+     */
+    size_t max_http2_leases_per_connection;
+
+    /*
+     * Maps aws_http_connection * to its aws_cm_shared_connection, for every shared HTTP/2 connection.
+     * Only initialized with max_http2_leases_per_connection
+     */
+    struct aws_hash_table shared_connections;
+
+    /*
+     * The shared connections that can take another lease, oldest first
+     */
+    struct aws_linked_list shared_connections_with_room;
+
+    /*
+     * The number of leases across all shared connections
+     */
+    size_t shared_lease_count;
 };
 
 struct aws_http_connection_manager_snapshot {
@@ -309,6 +511,8 @@ struct aws_http_connection_manager_snapshot {
     size_t external_ref_count;
 };
 
+static size_t s_get_shards_idle_connection_count(struct aws_http_connection_manager *manager);
+
 /*
  * Correct usage requires AWS_ZERO_STRUCT to have been called beforehand.
  */
@@ -316,13 +520,16 @@ static void s_aws_http_connection_manager_get_snapshot(
     struct aws_http_connection_manager *manager,
     struct aws_http_connection_manager_snapshot *snapshot) {
 
+    /* Connections idle in shards count as vended internally, but they're reported as idle */
+    size_t shards_idle_count = s_get_shards_idle_connection_count(manager);
+
     snapshot->state = manager->state;
-    snapshot->idle_connection_count = manager->idle_connection_count;
+    snapshot->idle_connection_count = manager->idle_connection_count + shards_idle_count;
     snapshot->pending_acquisition_count = manager->pending_acquisition_count;
     snapshot->pending_settings_count = manager->pending_settings_count;
 
     snapshot->pending_connects_count = manager->internal_ref[AWS_HCMCT_PENDING_CONNECTIONS];
-    snapshot->vended_connection_count = manager->internal_ref[AWS_HCMCT_VENDED_CONNECTION];
+    snapshot->vended_connection_count = manager->internal_ref[AWS_HCMCT_VENDED_CONNECTION] - shards_idle_count;
     snapshot->open_connection_count = manager->internal_ref[AWS_HCMCT_OPEN_CONNECTION];
 
     snapshot->external_ref_count = manager->external_ref_count;
@@ -378,11 +585,28 @@ struct aws_http_connection_acquisition {
     struct aws_http_connection_manager *manager; /* Only used by logging */
     aws_http_connection_manager_on_connection_setup_fn *callback;
     void *user_data;
+    /* See aws_http_connection_manager_acquire_connection_options */
+    struct aws_event_loop *event_loop;
+    bool require_event_loop;
+    uint64_t acquire_timestamp;
+    /* Only set with connection_acquisition_timeout_ms */
+    uint64_t timeout_timestamp;
     struct aws_http_connection *connection;
     int error_code;
     struct aws_channel_task acquisition_task;
 };
 
+/*
+ * The user_data of each connection the manager creates. Lives from the connect until the connection's shutdown, or
+ * until its setup fails.
+ */
+struct aws_cm_connection_context {
+    struct aws_allocator *allocator;
+    struct aws_http_connection_manager *manager;
+    uint64_t connect_timestamp;
+    uint64_t setup_timestamp;
+};
+
 static void s_connection_acquisition_task(
     struct aws_channel_task *channel_task,
     void *arg,
@@ -398,6 +622,8 @@ static void s_connection_acquisition_task(
             AWS_LS_HTTP_CONNECTION_MANAGER,
             "id=%p: Failed to complete connection acquisition because the connection was closed",
             (void *)pending_acquisition->manager);
+        AWS_HTTP_TRACE(
+            AWS_HTTP_TRACE_CONNECTION_ACQUIRED, pending_acquisition->manager, 0, AWS_ERROR_HTTP_CONNECTION_CLOSED);
         pending_acquisition->callback(NULL, AWS_ERROR_HTTP_CONNECTION_CLOSED, pending_acquisition->user_data);
         /* release it back to prevent a leak of the connection count. */
         aws_http_connection_manager_release_connection(pending_acquisition->manager, pending_acquisition->connection);
@@ -407,6 +633,11 @@ static void s_connection_acquisition_task(
             "id=%p: Successfully completed connection acquisition with connection id=%p",
             (void *)pending_acquisition->manager,
             (void *)pending_acquisition->connection);
+        AWS_HTTP_TRACE(
+            AWS_HTTP_TRACE_CONNECTION_ACQUIRED,
+            pending_acquisition->manager,
+            (uintptr_t)pending_acquisition->connection,
+            pending_acquisition->error_code);
         pending_acquisition->callback(
             pending_acquisition->connection, pending_acquisition->error_code, pending_acquisition->user_data);
     }
@@ -432,6 +663,10 @@ static void s_aws_http_connection_manager_complete_acquisitions(
             AWS_CONTAINER_OF(node, struct aws_http_connection_acquisition, node);
 
         if (pending_acquisition->error_code == AWS_OP_SUCCESS) {
+            uint64_t now = 0;
+            pending_acquisition->manager->system_vtable->get_monotonic_time(&now);
+            aws_http_atomic_histogram_record(
+                &pending_acquisition->manager->acquisition_wait_histogram, pending_acquisition->acquire_timestamp, now);
 
             struct aws_channel *channel =
                 pending_acquisition->manager->system_vtable->connection_get_channel(pending_acquisition->connection);
@@ -463,14 +698,25 @@ static void s_aws_http_connection_manager_complete_acquisitions(
                 aws_error_str(pending_acquisition->error_code));
         }
 
+        AWS_HTTP_TRACE(
+            AWS_HTTP_TRACE_CONNECTION_ACQUIRED,
+            pending_acquisition->manager,
+            (uintptr_t)pending_acquisition->connection,
+            pending_acquisition->error_code);
         pending_acquisition->callback(
             pending_acquisition->connection, pending_acquisition->error_code, pending_acquisition->user_data);
         aws_mem_release(allocator, pending_acquisition);
     }
 }
 
+/* Only invoke with lock held. Shards read the hint without the lock, see "Shards" above */
+static void s_set_pending_acquisition_count(struct aws_http_connection_manager *manager, size_t count) {
+    manager->pending_acquisition_count = count;
+    aws_atomic_store_int(&manager->pending_acquisition_count_hint, count);
+}
+
 /*
- * Moves the first pending connection acquisition into a (task set) list.  Call this while holding the lock to
+ * Moves a pending connection acquisition into a (task set) list.  Call this while holding the lock to
  * build the set of callbacks to be completed once the lock is released.
  *
  * Hard Requirement: Manager's lock must held somewhere in the call stack
@@ -479,17 +725,17 @@ static void s_aws_http_connection_manager_complete_acquisitions(
  * If this was a failed acquisition then connection is null and error_code is hopefully a useful diagnostic (extreme
  * edge cases exist where it may not be though)
  */
-static void s_aws_http_connection_manager_move_front_acquisition(
+static void s_aws_http_connection_manager_move_acquisition(
     struct aws_http_connection_manager *manager,
+    struct aws_linked_list_node *node,
     struct aws_http_connection *connection,
     int error_code,
     struct aws_linked_list *output_list) {
 
-    AWS_FATAL_ASSERT(!aws_linked_list_empty(&manager->pending_acquisitions));
-    struct aws_linked_list_node *node = aws_linked_list_pop_front(&manager->pending_acquisitions);
+    aws_linked_list_remove(node);
 
     AWS_FATAL_ASSERT(manager->pending_acquisition_count > 0);
-    --manager->pending_acquisition_count;
+    s_set_pending_acquisition_count(manager, manager->pending_acquisition_count - 1);
 
     if (error_code == AWS_ERROR_SUCCESS && connection == NULL) {
         AWS_LOGF_FATAL(
@@ -507,6 +753,18 @@ static void s_aws_http_connection_manager_move_front_acquisition(
     aws_linked_list_push_back(output_list, node);
 }
 
+/* Moves the first pending connection acquisition, see s_aws_http_connection_manager_move_acquisition() */
+static void s_aws_http_connection_manager_move_front_acquisition(
+    struct aws_http_connection_manager *manager,
+    struct aws_http_connection *connection,
+    int error_code,
+    struct aws_linked_list *output_list) {
+
+    AWS_FATAL_ASSERT(!aws_linked_list_empty(&manager->pending_acquisitions));
+    s_aws_http_connection_manager_move_acquisition(
+        manager, aws_linked_list_front(&manager->pending_acquisitions), connection, error_code, output_list);
+}
+
 /*
  * Encompasses all of the external operations that need to be done for various
  * events:
@@ -527,6 +785,12 @@ struct aws_connection_management_transaction {
     struct aws_linked_list connections_to_release; /* <struct aws_idle_connection> */
     struct aws_http_connection_manager_snapshot snapshot;
     size_t new_connections;
+    /* How many connections aws_http_connection_manager_prewarm() asked for */
+    size_t prewarm_connections;
+    /* Set after a failed connect, so an unreachable host isn't retried in a tight loop to fill min_idle_connections */
+    bool skip_min_idle;
+    /* <struct aws_event_loop *>, the event loop for each new connection. Empty unless acquisitions asked for one */
+    struct aws_array_list new_connection_event_loops;
 };
 
 static void s_aws_connection_management_transaction_init(
@@ -545,6 +809,7 @@ static void s_aws_connection_management_transaction_clean_up(struct aws_connecti
     AWS_FATAL_ASSERT(aws_linked_list_empty(&work->connections_to_release));
     AWS_FATAL_ASSERT(aws_linked_list_empty(&work->completions));
     AWS_ASSERT(work->manager);
+    aws_array_list_clean_up(&work->new_connection_event_loops);
     aws_ref_count_release(&work->manager->internal_ref_count);
 }
 
@@ -573,6 +838,479 @@ static void s_connection_manager_internal_ref_decrease(
     }
 }
 
+/* Connections on event loops outside the bootstrap's group share the first shard */
+static struct aws_http_connection_manager_shard *s_get_shard_for_event_loop(
+    struct aws_http_connection_manager *manager,
+    struct aws_event_loop *event_loop) {
+
+    for (size_t i = 0; i < manager->shard_count; ++i) {
+        if (manager->shards[i].event_loop == event_loop) {
+            return &manager->shards[i];
+        }
+    }
+    return &manager->shards[0];
+}
+
+static struct aws_http_connection_manager_shard *s_get_shard_for_connection(
+    struct aws_http_connection_manager *manager,
+    struct aws_http_connection *connection) {
+
+    return s_get_shard_for_event_loop(manager, manager->system_vtable->connection_get_event_loop(connection));
+}
+
+/* The caller's own shard if it's running on one of the manager's event loops, otherwise take turns */
+static size_t s_get_callers_shard_index(struct aws_http_connection_manager *manager) {
+    for (size_t i = 0; i < manager->shard_count; ++i) {
+        if (aws_event_loop_thread_is_callers_thread(manager->shards[i].event_loop)) {
+            return i;
+        }
+    }
+    return aws_atomic_fetch_add(&manager->next_shard_index, 1) % manager->shard_count;
+}
+
+/* Pops the idle connection to vend next from a non-empty idle list, according to idle_selection */
+static struct aws_idle_connection *s_pop_idle_connection(
+    const struct aws_http_connection_manager *manager,
+    struct aws_linked_list *idle_connections) {
+
+    struct aws_linked_list_node *node = manager->idle_selection == AWS_HCMIS_LRU
+                                            ? aws_linked_list_pop_front(idle_connections)
+                                            : aws_linked_list_pop_back(idle_connections);
+    return AWS_CONTAINER_OF(node, struct aws_idle_connection, node);
+}
+
+/* Pops the shard's next idle connection, or returns NULL if it's empty or closed. Doesn't need the manager's lock */
+static struct aws_idle_connection *s_take_idle_connection_from_shard(
+    const struct aws_http_connection_manager *manager,
+    struct aws_http_connection_manager_shard *shard) {
+    struct aws_idle_connection *idle_connection = NULL;
+
+    aws_mutex_lock(&shard->lock);
+    if (shard->is_open && !aws_linked_list_empty(&shard->idle_connections)) {
+        idle_connection = s_pop_idle_connection(manager, &shard->idle_connections);
+        --shard->idle_connection_count;
+    }
+    aws_mutex_unlock(&shard->lock);
+
+    return idle_connection;
+}
+
+/*
+ * Pops an idle connection from the first open shard that has one, trying the shards in order from first_index.
+ * Returns NULL if they're all empty. Doesn't need the manager's lock.
+ */
+static struct aws_idle_connection *s_take_idle_connection_from_shards(
+    struct aws_http_connection_manager *manager,
+    size_t first_index) {
+
+    for (size_t i = 0; i < manager->shard_count; ++i) {
+        struct aws_idle_connection *idle_connection =
+            s_take_idle_connection_from_shard(manager, &manager->shards[(first_index + i) % manager->shard_count]);
+        if (idle_connection) {
+            return idle_connection;
+        }
+    }
+    return NULL;
+}
+
+/* Only invoke with lock held */
+static size_t s_get_shards_idle_connection_count(struct aws_http_connection_manager *manager) {
+    size_t count = 0;
+    for (size_t i = 0; i < manager->shard_count; ++i) {
+        aws_mutex_lock(&manager->shards[i].lock);
+        count += manager->shards[i].idle_connection_count;
+        aws_mutex_unlock(&manager->shards[i].lock);
+    }
+    return count;
+}
+
+/*
+ * Files an idle connection by cull time. Usually that's the back of the list, since connections share the same idle
+ * timeout, only a proxy's shorter keep-alive moves one further up.
+ */
+static void s_push_idle_connection(
+    struct aws_linked_list *idle_connections,
+    struct aws_idle_connection *idle_connection) {
+
+    const struct aws_linked_list_node *rend = aws_linked_list_rend(idle_connections);
+    struct aws_linked_list_node *node = aws_linked_list_rbegin(idle_connections);
+    while (node != rend) {
+        struct aws_idle_connection *other = AWS_CONTAINER_OF(node, struct aws_idle_connection, node);
+        if (other->cull_timestamp <= idle_connection->cull_timestamp) {
+            aws_linked_list_insert_after(node, &idle_connection->node);
+            return;
+        }
+        node = aws_linked_list_prev(node);
+    }
+    aws_linked_list_push_front(idle_connections, &idle_connection->node);
+}
+
+/* Only invoke with lock held. Moves the connections made idle during this transaction onto their shards */
+static void s_move_idle_connections_to_shards(struct aws_http_connection_manager *manager) {
+    while (!aws_linked_list_empty(&manager->idle_connections)) {
+        /* Oldest first, so each shard's stack stays sorted by idle time */
+        struct aws_linked_list_node *node = aws_linked_list_pop_front(&manager->idle_connections);
+        struct aws_idle_connection *idle_connection = AWS_CONTAINER_OF(node, struct aws_idle_connection, node);
+        --manager->idle_connection_count;
+
+        struct aws_http_connection_manager_shard *shard =
+            s_get_shard_for_connection(manager, idle_connection->connection);
+        aws_mutex_lock(&shard->lock);
+        s_push_idle_connection(&shard->idle_connections, idle_connection);
+        ++shard->idle_connection_count;
+        aws_mutex_unlock(&shard->lock);
+
+        /* A shard's idle connections count as vended */
+        s_connection_manager_internal_ref_increase(manager, AWS_HCMCT_VENDED_CONNECTION, 1);
+    }
+}
+
+/* Only invoke with lock held. Closes every shard, moving their idle connections into the transaction to release */
+static void s_close_shards(struct aws_connection_management_transaction *work) {
+    struct aws_http_connection_manager *manager = work->manager;
+
+    size_t closed_idle_count = 0;
+    for (size_t i = 0; i < manager->shard_count; ++i) {
+        struct aws_http_connection_manager_shard *shard = &manager->shards[i];
+        aws_mutex_lock(&shard->lock);
+        shard->is_open = false;
+        closed_idle_count += shard->idle_connection_count;
+        shard->idle_connection_count = 0;
+        aws_linked_list_move_all_back(&work->connections_to_release, &shard->idle_connections);
+        aws_mutex_unlock(&shard->lock);
+    }
+
+    s_connection_manager_internal_ref_decrease(manager, AWS_HCMCT_VENDED_CONNECTION, closed_idle_count);
+}
+
+/* Only invoke with lock held. If the connection is idle, removes it and returns true */
+static bool s_remove_idle_connection(
+    struct aws_http_connection_manager *manager,
+    struct aws_http_connection *connection) {
+
+    const struct aws_linked_list_node *end = aws_linked_list_end(&manager->idle_connections);
+    for (struct aws_linked_list_node *node = aws_linked_list_begin(&manager->idle_connections); node != end;
+         node = aws_linked_list_next(node)) {
+        struct aws_idle_connection *current_idle_connection = AWS_CONTAINER_OF(node, struct aws_idle_connection, node);
+        if (current_idle_connection->connection == connection) {
+            aws_linked_list_remove(node);
+            aws_mem_release(current_idle_connection->allocator, current_idle_connection);
+            --manager->idle_connection_count;
+            return true;
+        }
+    }
+
+    if (manager->shards == NULL) {
+        return false;
+    }
+
+    bool found = false;
+    struct aws_http_connection_manager_shard *shard = s_get_shard_for_connection(manager, connection);
+    aws_mutex_lock(&shard->lock);
+    end = aws_linked_list_end(&shard->idle_connections);
+    for (struct aws_linked_list_node *node = aws_linked_list_begin(&shard->idle_connections); node != end;
+         node = aws_linked_list_next(node)) {
+        struct aws_idle_connection *current_idle_connection = AWS_CONTAINER_OF(node, struct aws_idle_connection, node);
+        if (current_idle_connection->connection == connection) {
+            aws_linked_list_remove(node);
+            aws_mem_release(current_idle_connection->allocator, current_idle_connection);
+            --shard->idle_connection_count;
+            found = true;
+            break;
+        }
+    }
+    aws_mutex_unlock(&shard->lock);
+
+    if (found) {
+        s_connection_manager_internal_ref_decrease(manager, AWS_HCMCT_VENDED_CONNECTION, 1);
+    }
+    return found;
+}
+
+/*
+ * Only invoke with lock held. Pops the connection in manager->idle_connections on the event loop that idle_selection
+ * would vend first, if any
+ */
+static struct aws_idle_connection *s_take_idle_connection_on_event_loop(
+    struct aws_http_connection_manager *manager,
+    struct aws_event_loop *event_loop) {
+
+    bool is_lru = manager->idle_selection == AWS_HCMIS_LRU;
+    const struct aws_linked_list_node *stop =
+        is_lru ? aws_linked_list_end(&manager->idle_connections) : aws_linked_list_rend(&manager->idle_connections);
+    struct aws_linked_list_node *node = is_lru ? aws_linked_list_begin(&manager->idle_connections)
+                                               : aws_linked_list_rbegin(&manager->idle_connections);
+    for (; node != stop; node = is_lru ? aws_linked_list_next(node) : aws_linked_list_prev(node)) {
+        struct aws_idle_connection *idle_connection = AWS_CONTAINER_OF(node, struct aws_idle_connection, node);
+        if (manager->system_vtable->connection_get_event_loop(idle_connection->connection) == event_loop) {
+            aws_linked_list_remove(node);
+            --manager->idle_connection_count;
+            return idle_connection;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Only invoke with lock held. Pops an idle connection the acquisition accepts, preferring its event loop if it asked
+ * for one, or returns NULL. Sets out_from_shard if the connection was idle in a shard, and so is already vended.
+ */
+static struct aws_idle_connection *s_take_idle_connection_for_acquisition(
+    struct aws_http_connection_manager *manager,
+    const struct aws_http_connection_acquisition *acquisition,
+    bool *out_from_shard) {
+
+    *out_from_shard = false;
+    struct aws_idle_connection *idle_connection = NULL;
+
+    if (acquisition->event_loop) {
+        idle_connection = s_take_idle_connection_on_event_loop(manager, acquisition->event_loop);
+        if (idle_connection == NULL && manager->shards) {
+            idle_connection = s_take_idle_connection_from_shard(
+                manager, s_get_shard_for_event_loop(manager, acquisition->event_loop));
+            *out_from_shard = idle_connection != NULL;
+        }
+        if (idle_connection || acquisition->require_event_loop) {
+            return idle_connection;
+        }
+    }
+
+    if (!aws_linked_list_empty(&manager->idle_connections)) {
+        --manager->idle_connection_count;
+        return s_pop_idle_connection(manager, &manager->idle_connections);
+    }
+
+    if (manager->shards) {
+        idle_connection = s_take_idle_connection_from_shards(manager, 0);
+        *out_from_shard = idle_connection != NULL;
+    }
+    return idle_connection;
+}
+
+/* Only invoke with lock held. Returns the shared connection record of connection, or NULL if it isn't shared */
+static struct aws_cm_shared_connection *s_find_shared_connection(
+    struct aws_http_connection_manager *manager,
+    struct aws_http_connection *connection) {
+
+    if (manager->max_http2_leases_per_connection == 0) {
+        return NULL;
+    }
+
+    struct aws_hash_element *element = NULL;
+    aws_hash_table_find(&manager->shared_connections, connection, &element);
+    return element ? element->value : NULL;
+}
+
+static void s_remove_from_room_list(struct aws_cm_shared_connection *shared_connection) {
+    if (shared_connection->is_in_room_list) {
+        aws_linked_list_remove(&shared_connection->node);
+        shared_connection->is_in_room_list = false;
+    }
+}
+
+/*
+ * Only invoke with lock held. Adds a lease to a shared connection the acquisition accepts, preferring its event loop
+ * if it asked for one, and returns the connection. Returns NULL if there's none.
+ */
+static struct aws_http_connection *s_lease_shared_connection(
+    struct aws_http_connection_manager *manager,
+    const struct aws_http_connection_acquisition *acquisition) {
+
+    struct aws_cm_shared_connection *chosen = NULL;
+    struct aws_linked_list_node *node = aws_linked_list_begin(&manager->shared_connections_with_room);
+    while (node != aws_linked_list_end(&manager->shared_connections_with_room)) {
+        struct aws_linked_list_node *next_node = aws_linked_list_next(node);
+        struct aws_cm_shared_connection *shared_connection =
+            AWS_CONTAINER_OF(node, struct aws_cm_shared_connection, node);
+
+        if (!manager->system_vtable->is_connection_available(shared_connection->connection)) {
+            /* It's given back or closed once its leases are released */
+            s_remove_from_room_list(shared_connection);
+        } else if (
+            acquisition->event_loop == NULL ||
+            manager->system_vtable->connection_get_event_loop(shared_connection->connection) ==
+                acquisition->event_loop) {
+            chosen = shared_connection;
+            break;
+        } else if (chosen == NULL && !acquisition->require_event_loop) {
+            /* Keep looking for one on the acquisition's event loop */
+            chosen = shared_connection;
+        }
+
+        node = next_node;
+    }
+
+    if (chosen == NULL) {
+        return NULL;
+    }
+
+    ++chosen->lease_count;
+    ++manager->shared_lease_count;
+    if (chosen->lease_count >= chosen->max_leases) {
+        s_remove_from_room_list(chosen);
+    }
+    return chosen->connection;
+}
+
+/*
+ * Only invoke with lock held. If multiplexing is on and connection, which was just vended from the idle pool, is
+ * HTTP/2, makes it shared with its first lease.
+ */
+static void s_share_connection_if_http2(
+    struct aws_http_connection_manager *manager,
+    struct aws_http_connection *connection) {
+
+    if (manager->max_http2_leases_per_connection == 0 ||
+        manager->system_vtable->connection_get_version(connection) != AWS_HTTP_VERSION_2) {
+        return;
+    }
+
+    size_t max_leases = manager->max_http2_leases_per_connection;
+    if (manager->system_vtable->connection_get_max_concurrent_streams) {
+        uint32_t max_concurrent_streams = manager->system_vtable->connection_get_max_concurrent_streams(connection);
+        if (max_concurrent_streams < max_leases) {
+            max_leases = max_concurrent_streams;
+        }
+    }
+    if (max_leases <= 1) {
+        return;
+    }
+
+    struct aws_cm_shared_connection *shared_connection =
+        aws_mem_calloc(manager->allocator, 1, sizeof(struct aws_cm_shared_connection));
+    shared_connection->allocator = manager->allocator;
+    shared_connection->connection = connection;
+    shared_connection->lease_count = 1;
+    shared_connection->max_leases = max_leases;
+
+    if (aws_hash_table_put(&manager->shared_connections, connection, shared_connection, NULL)) {
+        /* It's just vended to one acquisition, like without multiplexing */
+        aws_mem_release(shared_connection->allocator, shared_connection);
+        return;
+    }
+
+    ++manager->shared_lease_count;
+    aws_linked_list_push_back(&manager->shared_connections_with_room, &shared_connection->node);
+    shared_connection->is_in_room_list = true;
+}
+
+/*
+ * Only invoke with lock held. Removes a lease from a shared connection. Returns true if other leases remain, so the
+ * connection stays vended. false if that was the last one, and the connection is no longer shared.
+ */
+static bool s_release_lease(
+    struct aws_http_connection_manager *manager,
+    struct aws_cm_shared_connection *shared_connection,
+    bool is_connection_unavailable) {
+
+    AWS_FATAL_ASSERT(shared_connection->lease_count > 0);
+    --shared_connection->lease_count;
+    --manager->shared_lease_count;
+
+    if (shared_connection->lease_count > 0) {
+        if (!shared_connection->is_in_room_list && !is_connection_unavailable) {
+            aws_linked_list_push_back(&manager->shared_connections_with_room, &shared_connection->node);
+            shared_connection->is_in_room_list = true;
+        }
+        return true;
+    }
+
+    s_remove_from_room_list(shared_connection);
+    aws_hash_table_remove(&manager->shared_connections, shared_connection->connection, NULL, NULL);
+    aws_mem_release(shared_connection->allocator, shared_connection);
+    return false;
+}
+
+/*
+ * Only invoke with lock held. Moves up to count of the oldest idle connections into the transaction to release, to
+ * make room under max_connections for acquisitions that require other event loops. Returns how many were moved.
+ */
+static size_t s_release_idle_connections_for_room(struct aws_connection_management_transaction *work, size_t count) {
+    struct aws_http_connection_manager *manager = work->manager;
+
+    size_t released_count = 0;
+    while (released_count < count && !aws_linked_list_empty(&manager->idle_connections)) {
+        struct aws_linked_list_node *node = aws_linked_list_pop_front(&manager->idle_connections);
+        aws_linked_list_push_back(&work->connections_to_release, node);
+        --manager->idle_connection_count;
+        ++released_count;
+    }
+
+    size_t released_from_shards_count = 0;
+    for (size_t i = 0; i < manager->shard_count && released_count < count; ++i) {
+        struct aws_http_connection_manager_shard *shard = &manager->shards[i];
+        aws_mutex_lock(&shard->lock);
+        while (released_count < count && !aws_linked_list_empty(&shard->idle_connections)) {
+            struct aws_linked_list_node *node = aws_linked_list_pop_front(&shard->idle_connections);
+            aws_linked_list_push_back(&work->connections_to_release, node);
+            --shard->idle_connection_count;
+            ++released_count;
+            ++released_from_shards_count;
+        }
+        aws_mutex_unlock(&shard->lock);
+    }
+
+    /* A shard's idle connections count as vended */
+    s_connection_manager_internal_ref_decrease(manager, AWS_HCMCT_VENDED_CONNECTION, released_from_shards_count);
+
+    return released_count;
+}
+
+/*
+ * Only invoke with lock held. The number of acquisitions each connection being opened will serve. With multiplexing
+ * and HTTP/2 prior knowledge, every new connection is HTTP/2 and gets shared, so it counts for as many acquisitions as
+ * it can take leases. If the peer's SETTINGS_MAX_CONCURRENT_STREAMS turns out lower, the acquisitions it can't take
+ * get more connections once it's set up. Connections negotiating with ALPN might turn out to be HTTP/1.1, so they only
+ * count for one.
+ */
+static size_t s_get_acquisitions_per_new_connection(const struct aws_http_connection_manager *manager) {
+    if (manager->max_http2_leases_per_connection > 0 && manager->http2_prior_knowledge) {
+        return manager->max_http2_leases_per_connection;
+    }
+    return 1;
+}
+
+/* Only invoke with lock held. The number of pending acquisitions the connections being opened will serve */
+static size_t s_get_pending_connection_acquisition_capacity(const struct aws_http_connection_manager *manager) {
+    return (manager->internal_ref[AWS_HCMCT_PENDING_CONNECTIONS] + manager->pending_settings_count) *
+           s_get_acquisitions_per_new_connection(manager);
+}
+
+/*
+ * Only invoke with lock held. The acquisitions at the back of the queue are the ones this transaction's new
+ * connections are for, those ahead of them are waiting on connects already pending. Each new connection is created
+ * on the event loop its acquisition asked for.
+ */
+static void s_set_new_connection_event_loops(struct aws_connection_management_transaction *work) {
+    struct aws_http_connection_manager *manager = work->manager;
+
+    const struct aws_linked_list_node *rend = aws_linked_list_rend(&manager->pending_acquisitions);
+    struct aws_linked_list_node *node = aws_linked_list_rbegin(&manager->pending_acquisitions);
+    for (size_t i = 0; i < work->new_connections && node != rend; ++i, node = aws_linked_list_prev(node)) {
+        struct aws_http_connection_acquisition *acquisition =
+            AWS_CONTAINER_OF(node, struct aws_http_connection_acquisition, node);
+        if (acquisition->event_loop == NULL) {
+            continue;
+        }
+
+        if (!aws_array_list_is_valid(&work->new_connection_event_loops)) {
+            if (aws_array_list_init_dynamic(
+                    &work->new_connection_event_loops,
+                    work->allocator,
+                    work->new_connections,
+                    sizeof(struct aws_event_loop *))) {
+                /* The connections just go wherever the bootstrap puts them */
+                return;
+            }
+            struct aws_event_loop *no_event_loop = NULL;
+            for (size_t j = 0; j < work->new_connections; ++j) {
+                aws_array_list_push_back(&work->new_connection_event_loops, &no_event_loop);
+            }
+        }
+        aws_array_list_set_at(&work->new_connection_event_loops, &acquisition->event_loop, i);
+    }
+}
+
 /* Only invoked with the lock held */
 static void s_aws_http_connection_manager_build_transaction(struct aws_connection_management_transaction *work) {
     struct aws_http_connection_manager *manager = work->manager;
@@ -580,54 +1318,144 @@ static void s_aws_http_connection_manager_build_transaction(struct aws_connectio
     if (manager->state == AWS_HCMST_READY) {
         /*
          * Step 1 - If there's free connections, complete acquisition requests
+         *
+         * Acquisitions are served in order, except that one requiring an event loop none of the idle connections
+         * are on keeps waiting without holding up the ones behind it.
          */
-        while (!aws_linked_list_empty(&manager->idle_connections) > 0 && manager->pending_acquisition_count > 0) {
-            AWS_FATAL_ASSERT(manager->idle_connection_count >= 1);
+        bool has_idle_connections = manager->idle_connection_count > 0 ||
+                                    (manager->shards && s_get_shards_idle_connection_count(manager) > 0) ||
+                                    !aws_linked_list_empty(&manager->shared_connections_with_room);
+        struct aws_linked_list_node *node = aws_linked_list_begin(&manager->pending_acquisitions);
+        while (has_idle_connections && node != aws_linked_list_end(&manager->pending_acquisitions)) {
+            struct aws_linked_list_node *next_node = aws_linked_list_next(node);
+            struct aws_http_connection_acquisition *acquisition =
+                AWS_CONTAINER_OF(node, struct aws_http_connection_acquisition, node);
+
+            struct aws_http_connection *shared_connection = s_lease_shared_connection(manager, acquisition);
+            if (shared_connection) {
+                AWS_LOGF_DEBUG(
+                    AWS_LS_HTTP_CONNECTION_MANAGER,
+                    "id=%p: Leasing shared HTTP/2 connection (%p)",
+                    (void *)manager,
+                    (void *)shared_connection);
+                s_aws_http_connection_manager_move_acquisition(
+                    manager, node, shared_connection, AWS_ERROR_SUCCESS, &work->completions);
+                node = next_node;
+                continue;
+            }
+
+            bool is_from_shard = false;
+            struct aws_idle_connection *idle_connection =
+                s_take_idle_connection_for_acquisition(manager, acquisition, &is_from_shard);
+            if (idle_connection) {
+                struct aws_http_connection *connection = idle_connection->connection;
+
+                AWS_LOGF_DEBUG(
+                    AWS_LS_HTTP_CONNECTION_MANAGER,
+                    "id=%p: Grabbing pooled connection (%p)",
+                    (void *)manager,
+                    (void *)connection);
+                s_aws_http_connection_manager_move_acquisition(
+                    manager, node, connection, AWS_ERROR_SUCCESS, &work->completions);
+                if (idle_connection->is_prewarmed) {
+                    aws_atomic_fetch_add(&manager->prewarmed_acquire_count, 1);
+                }
+                if (!is_from_shard) {
+                    /* A shard's idle connections already count as vended */
+                    s_connection_manager_internal_ref_increase(manager, AWS_HCMCT_VENDED_CONNECTION, 1);
+                }
+                s_share_connection_if_http2(manager, connection);
+                aws_mem_release(idle_connection->allocator, idle_connection);
+            } else if (acquisition->event_loop == NULL || !acquisition->require_event_loop) {
+                /* It would have taken any connection, so there are none left */
+                has_idle_connections = false;
+            }
+
+            node = next_node;
+        }
+
+        /* The number of connections needed for the acquisitions no pending connection will serve */
+        size_t unserved_count = 0;
+        size_t pending_capacity = s_get_pending_connection_acquisition_capacity(manager);
+        if (manager->pending_acquisition_count > pending_capacity) {
+            size_t acquisitions_per_connection = s_get_acquisitions_per_new_connection(manager);
+            unserved_count = (manager->pending_acquisition_count - pending_capacity + acquisitions_per_connection - 1) /
+                             acquisitions_per_connection;
+        }
+
+        if (has_idle_connections && unserved_count > 0) {
             /*
-             * It is absolutely critical that this is pop_back and not front.  By making the idle connections
-             * a LIFO stack, the list will always be sorted from oldest (in terms of idle time) to newest.  This means
-             * we can always use the cull timestamp of the first connection as the next scheduled time for culling.
-             * It also means that when we cull connections, we can quit the loop as soon as we find a connection
-             * whose timestamp is greater than the current timestamp.
+             * Everything still pending requires an event loop none of the idle connections are on. Close enough of
+             * them that the connections it needs fit under max_connections.
              */
-            struct aws_linked_list_node *node = aws_linked_list_pop_back(&manager->idle_connections);
-            struct aws_idle_connection *idle_connection = AWS_CONTAINER_OF(node, struct aws_idle_connection, node);
-            struct aws_http_connection *connection = idle_connection->connection;
+            size_t used_count = manager->internal_ref[AWS_HCMCT_VENDED_CONNECTION] +
+                                manager->internal_ref[AWS_HCMCT_PENDING_CONNECTIONS] +
+                                manager->pending_settings_count + manager->idle_connection_count;
+            size_t room = manager->max_connections > used_count ? manager->max_connections - used_count : 0;
+            if (unserved_count > room) {
+                size_t released_count = s_release_idle_connections_for_room(work, unserved_count - room);
+                AWS_LOGF_DEBUG(
+                    AWS_LS_HTTP_CONNECTION_MANAGER,
+                    "id=%p: Closing %zu idle connections to make room for connections on other event loops",
+                    (void *)manager,
+                    released_count);
+            }
+        }
 
-            AWS_LOGF_DEBUG(
-                AWS_LS_HTTP_CONNECTION_MANAGER,
-                "id=%p: Grabbing pooled connection (%p)",
-                (void *)manager,
-                (void *)connection);
-            s_aws_http_connection_manager_move_front_acquisition(
-                manager, connection, AWS_ERROR_SUCCESS, &work->completions);
-            s_connection_manager_internal_ref_increase(manager, AWS_HCMCT_VENDED_CONNECTION, 1);
-            --manager->idle_connection_count;
-            aws_mem_release(idle_connection->allocator, idle_connection);
+        if (manager->shards) {
+            /* Anything still idle isn't wanted by a pending acquisition, hand it to its shard */
+            s_move_idle_connections_to_shards(manager);
         }
 
         /*
          * Step 2 - if there's excess pending acquisitions and we have room to make more, make more
          */
-        if (manager->pending_acquisition_count >
-            manager->internal_ref[AWS_HCMCT_PENDING_CONNECTIONS] + manager->pending_settings_count) {
+        if (unserved_count > 0) {
+            /* Idle connections only outlive step 1 for acquisitions that require other event loops */
             AWS_FATAL_ASSERT(
-                manager->max_connections >= manager->internal_ref[AWS_HCMCT_VENDED_CONNECTION] +
-                                                manager->internal_ref[AWS_HCMCT_PENDING_CONNECTIONS] +
-                                                manager->pending_settings_count);
+                manager->max_connections >=
+                manager->internal_ref[AWS_HCMCT_VENDED_CONNECTION] +
+                    manager->internal_ref[AWS_HCMCT_PENDING_CONNECTIONS] + manager->pending_settings_count +
+                    manager->idle_connection_count);
 
-            work->new_connections = manager->pending_acquisition_count -
-                                    manager->internal_ref[AWS_HCMCT_PENDING_CONNECTIONS] -
-                                    manager->pending_settings_count;
+            work->new_connections = unserved_count;
             size_t max_new_connections =
                 manager->max_connections -
                 (manager->internal_ref[AWS_HCMCT_VENDED_CONNECTION] +
-                 manager->internal_ref[AWS_HCMCT_PENDING_CONNECTIONS] + manager->pending_settings_count);
+                 manager->internal_ref[AWS_HCMCT_PENDING_CONNECTIONS] + manager->pending_settings_count +
+                 manager->idle_connection_count);
 
             if (work->new_connections > max_new_connections) {
                 work->new_connections = max_new_connections;
             }
             s_connection_manager_internal_ref_increase(manager, AWS_HCMCT_PENDING_CONNECTIONS, work->new_connections);
+            s_set_new_connection_event_loops(work);
+        }
+
+        /*
+         * Step 3 - Open connections ahead of demand, see "Prewarming" above
+         */
+        size_t prewarm_count = work->prewarm_connections;
+        if (manager->min_idle_connections > 0 && !work->skip_min_idle) {
+            size_t supply_count = manager->idle_connection_count + s_get_shards_idle_connection_count(manager) +
+                                  manager->internal_ref[AWS_HCMCT_PENDING_CONNECTIONS] +
+                                  manager->pending_settings_count;
+            size_t demand_count = manager->pending_acquisition_count + manager->min_idle_connections;
+            if (demand_count > supply_count && demand_count - supply_count > prewarm_count) {
+                prewarm_count = demand_count - supply_count;
+            }
+        }
+
+        if (prewarm_count > 0) {
+            size_t used_count = manager->internal_ref[AWS_HCMCT_VENDED_CONNECTION] +
+                                manager->internal_ref[AWS_HCMCT_PENDING_CONNECTIONS] +
+                                manager->pending_settings_count + manager->idle_connection_count;
+            size_t room = manager->max_connections > used_count ? manager->max_connections - used_count : 0;
+            if (prewarm_count > room) {
+                prewarm_count = room;
+            }
+            work->new_connections += prewarm_count;
+            s_connection_manager_internal_ref_increase(manager, AWS_HCMCT_PENDING_CONNECTIONS, prewarm_count);
         }
     } else {
         /*
@@ -636,6 +1464,7 @@ static void s_aws_http_connection_manager_build_transaction(struct aws_connectio
         AWS_FATAL_ASSERT(aws_linked_list_empty(&work->connections_to_release));
         aws_linked_list_swap_contents(&manager->idle_connections, &work->connections_to_release);
         manager->idle_connection_count = 0;
+        s_close_shards(work);
 
         /*
          * Move all manager pending acquisitions to the work completion list
@@ -654,7 +1483,7 @@ static void s_aws_http_connection_manager_build_transaction(struct aws_connectio
             "id=%p: manager release, failing %zu pending acquisitions",
             (void *)manager,
             manager->pending_acquisition_count);
-        manager->pending_acquisition_count = 0;
+        s_set_pending_acquisition_count(manager, 0);
     }
 
     s_aws_http_connection_manager_get_snapshot(manager, &work->snapshot);
@@ -685,12 +1514,29 @@ static void s_aws_http_connection_manager_finish_destroy(struct aws_http_connect
     AWS_FATAL_ASSERT(manager->internal_ref[AWS_HCMCT_OPEN_CONNECTION] == 0);
     AWS_FATAL_ASSERT(aws_linked_list_empty(&manager->pending_acquisitions));
     AWS_FATAL_ASSERT(aws_linked_list_empty(&manager->idle_connections));
+    AWS_FATAL_ASSERT(aws_linked_list_empty(&manager->shared_connections_with_room));
+
+    if (aws_hash_table_is_valid(&manager->shared_connections)) {
+        /* Shared connections count as vended, so there are none left */
+        AWS_FATAL_ASSERT(aws_hash_table_get_entry_count(&manager->shared_connections) == 0);
+        aws_hash_table_clean_up(&manager->shared_connections);
+    }
+
+    for (size_t i = 0; i < manager->shard_count; ++i) {
+        AWS_FATAL_ASSERT(aws_linked_list_empty(&manager->shards[i].idle_connections));
+        aws_mutex_clean_up(&manager->shards[i].lock);
+    }
+    if (manager->shards) {
+        aws_mem_release(manager->allocator, manager->shards);
+    }
 
     aws_string_destroy(manager->host);
     if (manager->initial_settings) {
         aws_array_list_clean_up(manager->initial_settings);
         aws_mem_release(manager->allocator, manager->initial_settings);
     }
+    aws_http_headers_release(manager->http2_header_template);
+    aws_http_connection_memory_tracker_release(manager->memory_tracker);
     if (manager->tls_connection_options) {
         aws_tls_connection_options_clean_up(manager->tls_connection_options);
         aws_mem_release(manager->allocator, manager->tls_connection_options);
@@ -711,6 +1557,9 @@ static void s_aws_http_connection_manager_finish_destroy(struct aws_http_connect
     if (manager->cull_task) {
         aws_mem_release(manager->allocator, manager->cull_task);
     }
+    if (manager->acquisition_timeout_task) {
+        aws_mem_release(manager->allocator, manager->acquisition_timeout_task);
+    }
 
     aws_mutex_clean_up(&manager->lock);
 
@@ -723,20 +1572,33 @@ static void s_aws_http_connection_manager_finish_destroy(struct aws_http_connect
     aws_mem_release(manager->allocator, manager);
 }
 
-/* This is scheduled to run on the cull task's event loop. Should only be scheduled to run if we have one  */
+/*
+ * This is scheduled to run on the cull task's event loop. Should only be scheduled to run if we have a cull task or
+ * an acquisition timeout task
+ */
 static void s_final_destruction_task(struct aws_task *task, void *arg, enum aws_task_status status) {
     (void)status;
     struct aws_http_connection_manager *manager = arg;
     struct aws_allocator *allocator = manager->allocator;
 
-    AWS_FATAL_ASSERT(manager->cull_task != NULL);
+    AWS_FATAL_ASSERT(manager->cull_task != NULL || manager->acquisition_timeout_task != NULL);
     AWS_FATAL_ASSERT(manager->cull_event_loop != NULL);
 
-    aws_event_loop_cancel_task(manager->cull_event_loop, manager->cull_task);
+    size_t task_count = 0;
+    if (manager->cull_task) {
+        aws_event_loop_cancel_task(manager->cull_event_loop, manager->cull_task);
+        ++task_count;
+    }
+    if (manager->acquisition_timeout_task) {
+        aws_event_loop_cancel_task(manager->cull_event_loop, manager->acquisition_timeout_task);
+        ++task_count;
+    }
     aws_mem_release(allocator, task);
 
-    /* release the refcount on manager as the culling task will not run again */
-    aws_ref_count_release(&manager->internal_ref_count);
+    /* release the refcount each task held on manager, as they will not run again */
+    for (size_t i = 0; i < task_count; ++i) {
+        aws_ref_count_release(&manager->internal_ref_count);
+    }
 }
 
 static void s_cull_task(struct aws_task *task, void *arg, enum aws_task_status status);
@@ -764,8 +1626,8 @@ static void s_schedule_connection_culling(struct aws_http_connection_manager *ma
     struct aws_linked_list_node *oldest_node = aws_linked_list_begin(&manager->idle_connections);
     if (oldest_node != end) {
         /*
-         * Since the connections are in LIFO order in the list, the front of the list has the closest
-         * cull time.
+         * Connections are filed by cull time (see s_push_idle_connection()), the front of the list has the
+         * closest one.
          */
         struct aws_idle_connection *oldest_idle_connection =
             AWS_CONTAINER_OF(oldest_node, struct aws_idle_connection, node);
@@ -781,13 +1643,71 @@ static void s_schedule_connection_culling(struct aws_http_connection_manager *ma
             now + aws_timestamp_convert(
                       manager->max_connection_idle_in_milliseconds, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
     }
+    /* Each shard's list is sorted the same way */
+    for (size_t i = 0; i < manager->shard_count; ++i) {
+        struct aws_http_connection_manager_shard *shard = &manager->shards[i];
+        aws_mutex_lock(&shard->lock);
+        if (!aws_linked_list_empty(&shard->idle_connections)) {
+            struct aws_idle_connection *oldest_idle_connection =
+                AWS_CONTAINER_OF(aws_linked_list_front(&shard->idle_connections), struct aws_idle_connection, node);
+            if (oldest_idle_connection->cull_timestamp < cull_task_time) {
+                cull_task_time = oldest_idle_connection->cull_timestamp;
+            }
+        }
+        aws_mutex_unlock(&shard->lock);
+    }
     aws_mutex_unlock(&manager->lock);
 
+    if (manager->min_idle_connections > 0) {
+        /* Connections kept for min_idle_connections stay at the front past their cull time, don't spin on them */
+        uint64_t now = 0;
+        manager->system_vtable->get_monotonic_time(&now);
+        uint64_t cull_interval = aws_timestamp_convert(
+            manager->max_connection_idle_in_milliseconds, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+        if (cull_task_time <= now) {
+            cull_task_time = now + cull_interval;
+        }
+    }
+
     aws_event_loop_schedule_task_future(manager->cull_event_loop, manager->cull_task, cull_task_time);
 
     return;
 }
 
+static void s_acquisition_timeout_task(struct aws_task *task, void *arg, enum aws_task_status status);
+static void s_init_acquisition_timeout_task(struct aws_http_connection_manager *manager) {
+    if (manager->connection_acquisition_timeout_ms == 0) {
+        return;
+    }
+
+    manager->acquisition_timeout_task = aws_mem_calloc(manager->allocator, 1, sizeof(struct aws_task));
+    aws_task_init(manager->acquisition_timeout_task, s_acquisition_timeout_task, manager, "acquisition_timeout");
+    /* For the task to properly run and cancel, we need to keep manager alive */
+    aws_ref_count_acquire(&manager->internal_ref_count);
+
+    if (manager->cull_event_loop == NULL) {
+        manager->cull_event_loop = aws_event_loop_group_get_next_loop(manager->bootstrap->event_loop_group);
+    }
+    AWS_FATAL_ASSERT(manager->cull_event_loop != NULL);
+}
+
+/*
+ * Only invoke with lock held. Schedules the acquisition timeout task for the front acquisition's deadline, unless
+ * it's already scheduled or nothing is pending.
+ */
+static void s_schedule_acquisition_timeout_task(struct aws_http_connection_manager *manager) {
+    if (manager->acquisition_timeout_task == NULL || manager->is_acquisition_timeout_task_scheduled ||
+        aws_linked_list_empty(&manager->pending_acquisitions)) {
+        return;
+    }
+
+    struct aws_http_connection_acquisition *oldest_acquisition = AWS_CONTAINER_OF(
+        aws_linked_list_front(&manager->pending_acquisitions), struct aws_http_connection_acquisition, node);
+    manager->is_acquisition_timeout_task_scheduled = true;
+    aws_event_loop_schedule_task_future(
+        manager->cull_event_loop, manager->acquisition_timeout_task, oldest_acquisition->timeout_timestamp);
+}
+
 struct aws_http_connection_manager *aws_http_connection_manager_new(
     struct aws_allocator *allocator,
     const struct aws_http_connection_manager_options *options) {
@@ -800,14 +1720,30 @@ struct aws_http_connection_manager *aws_http_connection_manager_new(
         return NULL;
     }
 
-    if (!options->socket_options) {
-        AWS_LOGF_ERROR(AWS_LS_HTTP_CONNECTION_MANAGER, "Invalid options - socket_options is null");
+    if (!options->socket_options) {
+        AWS_LOGF_ERROR(AWS_LS_HTTP_CONNECTION_MANAGER, "Invalid options - socket_options is null");
+        aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    if (options->max_connections == 0) {
+        AWS_LOGF_ERROR(AWS_LS_HTTP_CONNECTION_MANAGER, "Invalid options - max_connections cannot be 0");
+        aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    if (options->min_idle_connections > options->max_connections) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_CONNECTION_MANAGER,
+            "Invalid options - min_idle_connections cannot be greater than max_connections");
         aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
         return NULL;
     }
 
-    if (options->max_connections == 0) {
-        AWS_LOGF_ERROR(AWS_LS_HTTP_CONNECTION_MANAGER, "Invalid options - max_connections cannot be 0");
+    if (options->max_http2_leases_per_connection > 0 && options->enable_event_loop_shards) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_CONNECTION_MANAGER,
+            "Invalid options - max_http2_leases_per_connection cannot be used with enable_event_loop_shards");
         aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
         return NULL;
     }
@@ -819,6 +1755,14 @@ struct aws_http_connection_manager *aws_http_connection_manager_new(
         return NULL;
     }
 
+    if (options->http2_upgrade && (options->tls_connection_options || options->http2_prior_knowledge)) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_CONNECTION_MANAGER,
+            "Invalid options - HTTP/2 upgrade cannot be set when TLS or HTTP/2 prior knowledge is used");
+        aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
     struct aws_http_connection_manager *manager =
         aws_mem_calloc(allocator, 1, sizeof(struct aws_http_connection_manager));
     if (manager == NULL) {
@@ -838,6 +1782,41 @@ struct aws_http_connection_manager *aws_http_connection_manager_new(
 
     aws_linked_list_init(&manager->idle_connections);
     aws_linked_list_init(&manager->pending_acquisitions);
+    aws_linked_list_init(&manager->shared_connections_with_room);
+    aws_atomic_init_int(&manager->pending_acquisition_count_hint, 0);
+    aws_atomic_init_int(&manager->next_shard_index, 0);
+    aws_atomic_init_int(&manager->prewarmed_acquire_count, 0);
+    aws_http_atomic_histogram_init(&manager->acquisition_wait_histogram);
+    aws_http_atomic_histogram_init(&manager->connection_setup_histogram);
+    aws_http_atomic_histogram_init(&manager->http2_settings_histogram);
+    aws_http_atomic_histogram_init(&manager->connection_lifetime_histogram);
+    manager->memory_tracker = aws_http_connection_memory_tracker_new(allocator, options->read_window_budget);
+
+    if (options->enable_event_loop_shards) {
+        size_t loop_count = aws_event_loop_group_get_loop_count(options->bootstrap->event_loop_group);
+        manager->shards = aws_mem_calloc(allocator, loop_count, sizeof(struct aws_http_connection_manager_shard));
+        if (manager->shards == NULL) {
+            goto on_error;
+        }
+        for (size_t i = 0; i < loop_count; ++i) {
+            struct aws_http_connection_manager_shard *shard = &manager->shards[i];
+            if (aws_mutex_init(&shard->lock)) {
+                goto on_error;
+            }
+            /* Count each shard once its lock exists, so finish_destroy only cleans up those */
+            ++manager->shard_count;
+            shard->event_loop = aws_event_loop_group_get_loop_at(options->bootstrap->event_loop_group, i);
+            aws_linked_list_init(&shard->idle_connections);
+            shard->is_open = true;
+        }
+    }
+
+    if (options->max_http2_leases_per_connection > 0) {
+        if (aws_hash_table_init(&manager->shared_connections, allocator, 8, aws_hash_ptr, aws_ptr_eq, NULL, NULL)) {
+            goto on_error;
+        }
+        manager->max_http2_leases_per_connection = options->max_http2_leases_per_connection;
+    }
 
     manager->host = aws_string_new_from_cursor(allocator, &options->host);
     if (manager->host == NULL) {
@@ -873,6 +1852,14 @@ struct aws_http_connection_manager *aws_http_connection_manager_new(
     manager->shutdown_complete_user_data = options->shutdown_complete_user_data;
     manager->enable_read_back_pressure = options->enable_read_back_pressure;
     manager->max_connection_idle_in_milliseconds = options->max_connection_idle_in_milliseconds;
+    manager->min_idle_connections = options->min_idle_connections;
+    manager->idle_selection = options->idle_selection;
+    manager->connection_acquisition_timeout_ms = options->connection_acquisition_timeout_ms;
+    manager->max_pending_connection_acquisitions = options->max_pending_connection_acquisitions;
+    if (options->host_resolution_config) {
+        manager->host_resolution_config = *options->host_resolution_config;
+        manager->has_host_resolution_config = true;
+    }
     if (options->proxy_ev_settings) {
         manager->proxy_ev_settings = *options->proxy_ev_settings;
     }
@@ -884,6 +1871,7 @@ struct aws_http_connection_manager *aws_http_connection_manager_new(
         manager->proxy_ev_settings.tls_options = manager->proxy_ev_tls_options;
     }
     manager->http2_prior_knowledge = options->http2_prior_knowledge;
+    manager->http2_upgrade = options->http2_upgrade;
     if (options->num_initial_settings > 0) {
         manager->initial_settings = aws_mem_calloc(allocator, 1, sizeof(struct aws_array_list));
         aws_array_list_init_dynamic(
@@ -895,12 +1883,21 @@ struct aws_http_connection_manager *aws_http_connection_manager_new(
     }
     manager->max_closed_streams = options->max_closed_streams;
     manager->http2_conn_manual_window_management = options->http2_conn_manual_window_management;
+    manager->http2_header_template = options->http2_header_template;
+    if (manager->http2_header_template) {
+        aws_http_headers_acquire(manager->http2_header_template);
+    }
 
     /* NOTHING can fail after here */
     s_schedule_connection_culling(manager);
+    s_init_acquisition_timeout_task(manager);
 
     AWS_LOGF_INFO(AWS_LS_HTTP_CONNECTION_MANAGER, "id=%p: Successfully created", (void *)manager);
 
+    if (manager->min_idle_connections > 0) {
+        aws_http_connection_manager_prewarm(manager, 0);
+    }
+
     return manager;
 
 on_error:
@@ -935,8 +1932,8 @@ void aws_http_connection_manager_release(struct aws_http_connection_manager *man
                 (void *)manager);
             manager->state = AWS_HCMST_SHUTTING_DOWN;
             s_aws_http_connection_manager_build_transaction(&work);
-            if (manager->cull_task != NULL) {
-                /* When manager shutting down, schedule the task to cancel the cull task if exist. */
+            if (manager->cull_task != NULL || manager->acquisition_timeout_task != NULL) {
+                /* When manager shutting down, schedule the task to cancel the cull and timeout tasks if exist. */
                 AWS_FATAL_ASSERT(manager->cull_event_loop);
                 struct aws_task *final_destruction_task =
                     aws_mem_calloc(manager->allocator, 1, sizeof(struct aws_task));
@@ -979,14 +1976,22 @@ static void s_aws_http_connection_manager_h2_on_initial_settings_completed(
     int error_code,
     void *user_data);
 
-static int s_aws_http_connection_manager_new_connection(struct aws_http_connection_manager *manager) {
+static int s_aws_http_connection_manager_new_connection(
+    struct aws_http_connection_manager *manager,
+    struct aws_event_loop *event_loop) {
+    struct aws_cm_connection_context *connection_context =
+        aws_mem_calloc(manager->allocator, 1, sizeof(struct aws_cm_connection_context));
+    connection_context->allocator = manager->allocator;
+    connection_context->manager = manager;
+    manager->system_vtable->get_monotonic_time(&connection_context->connect_timestamp);
+
     struct aws_http_client_connection_options options;
     AWS_ZERO_STRUCT(options);
     options.self_size = sizeof(struct aws_http_client_connection_options);
     options.bootstrap = manager->bootstrap;
     options.tls_options = manager->tls_connection_options;
     options.allocator = manager->allocator;
-    options.user_data = manager;
+    options.user_data = connection_context;
     options.host_name = aws_byte_cursor_from_string(manager->host);
     options.port = manager->port;
     options.initial_window_size = manager->initial_window_size;
@@ -996,6 +2001,12 @@ static int s_aws_http_connection_manager_new_connection(struct aws_http_connecti
     options.manual_window_management = manager->enable_read_back_pressure;
     options.proxy_ev_settings = &manager->proxy_ev_settings;
     options.prior_knowledge_http2 = manager->http2_prior_knowledge;
+    options.http2_upgrade = manager->http2_upgrade;
+    options.requested_event_loop = event_loop;
+    options.memory_tracker = manager->memory_tracker;
+    if (manager->has_host_resolution_config) {
+        options.host_resolution_config = &manager->host_resolution_config;
+    }
 
     struct aws_http2_connection_options h2_options;
     AWS_ZERO_STRUCT(h2_options);
@@ -1005,6 +2016,7 @@ static int s_aws_http_connection_manager_new_connection(struct aws_http_connecti
     }
     h2_options.max_closed_streams = manager->max_closed_streams;
     h2_options.conn_manual_window_management = manager->http2_conn_manual_window_management;
+    h2_options.header_template = manager->http2_header_template;
     /* The initial_settings_completed invoked after the other side acknowledges it, and will always be invoked if the
      * connection set up */
     h2_options.on_initial_settings_completed = s_aws_http_connection_manager_h2_on_initial_settings_completed;
@@ -1031,6 +2043,8 @@ static int s_aws_http_connection_manager_new_connection(struct aws_http_connecti
             (void *)manager,
             aws_last_error(),
             aws_error_str(aws_last_error()));
+        /* None of the callbacks will be invoked */
+        aws_mem_release(connection_context->allocator, connection_context);
         return AWS_OP_ERR;
     }
 
@@ -1093,7 +2107,12 @@ static void s_aws_http_connection_manager_execute_transaction(struct aws_connect
     }
 
     for (size_t i = 0; i < work->new_connections; ++i) {
-        if (s_aws_http_connection_manager_new_connection(manager)) {
+        struct aws_event_loop *event_loop = NULL;
+        if (i < aws_array_list_length(&work->new_connection_event_loops)) {
+            aws_array_list_get_at(&work->new_connection_event_loops, &event_loop, i);
+        }
+
+        if (s_aws_http_connection_manager_new_connection(manager, event_loop)) {
             ++new_connection_failures;
             representative_error = aws_last_error();
             if (push_errors) {
@@ -1152,41 +2171,169 @@ static void s_aws_http_connection_manager_execute_transaction(struct aws_connect
     s_aws_connection_management_transaction_clean_up(work);
 }
 
-void aws_http_connection_manager_acquire_connection(
+/* Completes an acquisition that never made it into the queue. The manager's lock must not be held */
+static void s_complete_acquisition_now(struct aws_http_connection_acquisition *acquisition) {
+    struct aws_linked_list completions;
+    aws_linked_list_init(&completions);
+    aws_linked_list_push_back(&completions, &acquisition->node);
+    s_aws_http_connection_manager_complete_acquisitions(&completions, acquisition->allocator);
+}
+
+static bool s_is_bootstrap_event_loop(struct aws_http_connection_manager *manager, struct aws_event_loop *event_loop) {
+    struct aws_event_loop_group *event_loop_group = manager->bootstrap->event_loop_group;
+    size_t loop_count = aws_event_loop_group_get_loop_count(event_loop_group);
+    for (size_t i = 0; i < loop_count; ++i) {
+        if (aws_event_loop_group_get_loop_at(event_loop_group, i) == event_loop) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void aws_http_connection_manager_acquire_connection_with_options(
     struct aws_http_connection_manager *manager,
-    aws_http_connection_manager_on_connection_setup_fn *callback,
-    void *user_data) {
+    const struct aws_http_connection_manager_acquire_connection_options *options) {
+
+    AWS_PRECONDITION(options);
+    AWS_PRECONDITION(options->callback);
 
-    AWS_LOGF_DEBUG(AWS_LS_HTTP_CONNECTION_MANAGER, "id=%p: Acquire connection", (void *)manager);
+    AWS_LOGF_DEBUG(
+        AWS_LS_HTTP_CONNECTION_MANAGER,
+        "id=%p: Acquire connection, event_loop=%p, require_event_loop=%d",
+        (void *)manager,
+        (void *)options->event_loop,
+        (int)options->require_event_loop);
 
     struct aws_http_connection_acquisition *request =
         aws_mem_calloc(manager->allocator, 1, sizeof(struct aws_http_connection_acquisition));
 
     request->allocator = manager->allocator;
-    request->callback = callback;
-    request->user_data = user_data;
+    request->callback = options->callback;
+    request->user_data = options->user_data;
     request->manager = manager;
+    request->event_loop = options->event_loop;
+    request->require_event_loop = options->event_loop != NULL && options->require_event_loop;
+    manager->system_vtable->get_monotonic_time(&request->acquire_timestamp);
+
+    if (request->event_loop && !s_is_bootstrap_event_loop(manager, request->event_loop)) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_CONNECTION_MANAGER,
+            "id=%p: Invalid options - event_loop is not in the bootstrap's event loop group",
+            (void *)manager);
+        request->error_code = AWS_ERROR_INVALID_ARGUMENT;
+        s_complete_acquisition_now(request);
+        return;
+    }
+
+    if (manager->shards) {
+        struct aws_idle_connection *idle_connection = NULL;
+        if (request->event_loop) {
+            struct aws_http_connection_manager_shard *shard = s_get_shard_for_event_loop(manager, request->event_loop);
+            idle_connection = s_take_idle_connection_from_shard(manager, shard);
+        }
+        if (idle_connection == NULL && !request->require_event_loop) {
+            idle_connection = s_take_idle_connection_from_shards(manager, s_get_callers_shard_index(manager));
+        }
+        if (idle_connection) {
+            /* The connection stays counted as vended, so nothing else changes and the manager's lock isn't needed */
+            request->connection = idle_connection->connection;
+            request->error_code = AWS_ERROR_SUCCESS;
+            bool is_prewarmed = idle_connection->is_prewarmed;
+            aws_mem_release(idle_connection->allocator, idle_connection);
+
+            if (is_prewarmed) {
+                aws_atomic_fetch_add(&manager->prewarmed_acquire_count, 1);
+            }
+
+            s_complete_acquisition_now(request);
+
+            if (manager->min_idle_connections > 0) {
+                /* The pool just shrank, top it back up */
+                aws_http_connection_manager_prewarm(manager, 0);
+            }
+            return;
+        }
+    }
 
     struct aws_connection_management_transaction work;
     s_aws_connection_management_transaction_init(&work, manager);
 
+    if (manager->connection_acquisition_timeout_ms > 0) {
+        request->timeout_timestamp =
+            request->acquire_timestamp +
+            aws_timestamp_convert(
+                manager->connection_acquisition_timeout_ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+    }
+
     aws_mutex_lock(&manager->lock);
 
     /* It's a use after free crime, we don't want to handle */
     AWS_FATAL_ASSERT(manager->state == AWS_HCMST_READY);
 
+    if (manager->max_pending_connection_acquisitions > 0 &&
+        manager->pending_acquisition_count >= manager->max_pending_connection_acquisitions) {
+        aws_mutex_unlock(&manager->lock);
+
+        AWS_LOGF_DEBUG(
+            AWS_LS_HTTP_CONNECTION_MANAGER,
+            "id=%p: Failing connection acquisition, %zu acquisitions are already pending",
+            (void *)manager,
+            manager->max_pending_connection_acquisitions);
+        request->error_code = AWS_ERROR_HTTP_CONNECTION_MANAGER_MAX_PENDING_ACQUISITIONS_EXCEEDED;
+        s_complete_acquisition_now(request);
+        s_aws_connection_management_transaction_clean_up(&work);
+        return;
+    }
+
     aws_linked_list_push_back(&manager->pending_acquisitions, &request->node);
-    ++manager->pending_acquisition_count;
+    s_set_pending_acquisition_count(manager, manager->pending_acquisition_count + 1);
 
     s_aws_http_connection_manager_build_transaction(&work);
+    s_schedule_acquisition_timeout_task(manager);
 
     aws_mutex_unlock(&manager->lock);
 
     s_aws_http_connection_manager_execute_transaction(&work);
 }
 
-/* Only invoke with lock held */
-static int s_idle_connection(struct aws_http_connection_manager *manager, struct aws_http_connection *connection) {
+void aws_http_connection_manager_acquire_connection(
+    struct aws_http_connection_manager *manager,
+    aws_http_connection_manager_on_connection_setup_fn *callback,
+    void *user_data) {
+
+    struct aws_http_connection_manager_acquire_connection_options options = {
+        .callback = callback,
+        .user_data = user_data,
+    };
+    aws_http_connection_manager_acquire_connection_with_options(manager, &options);
+}
+
+void aws_http_connection_manager_prewarm(struct aws_http_connection_manager *manager, size_t num_connections) {
+    AWS_LOGF_DEBUG(AWS_LS_HTTP_CONNECTION_MANAGER, "id=%p: Prewarm %zu connections", (void *)manager, num_connections);
+
+    struct aws_connection_management_transaction work;
+    s_aws_connection_management_transaction_init(&work, manager);
+    work.prewarm_connections = num_connections;
+
+    aws_mutex_lock(&manager->lock);
+
+    /* It's a use after free crime, we don't want to handle */
+    AWS_FATAL_ASSERT(manager->state == AWS_HCMST_READY);
+
+    s_aws_http_connection_manager_build_transaction(&work);
+
+    aws_mutex_unlock(&manager->lock);
+
+    s_aws_http_connection_manager_execute_transaction(&work);
+}
+
+/* How long before a tunneling proxy's keep-alive timeout an idle tunnel is culled, see "Tunneling proxies" above */
+static const uint64_t s_proxy_keep_alive_margin_ms = 1000;
+
+static struct aws_idle_connection *s_idle_connection_new(
+    struct aws_http_connection_manager *manager,
+    struct aws_http_connection *connection) {
+
     struct aws_idle_connection *idle_connection =
         aws_mem_calloc(manager->allocator, 1, sizeof(struct aws_idle_connection));
 
@@ -1198,32 +2345,77 @@ static int s_idle_connection(struct aws_http_connection_manager *manager, struct
         goto on_error;
     }
 
+    uint64_t idle_ms = manager->max_connection_idle_in_milliseconds;
+    if (manager->system_vtable->connection_get_proxy_keep_alive_timeout) {
+        uint64_t keep_alive_ms = manager->system_vtable->connection_get_proxy_keep_alive_timeout(connection);
+        if (keep_alive_ms > 0) {
+            /* Leave the proxy some slack, its clock started when it last forwarded something */
+            keep_alive_ms -= aws_min_u64(s_proxy_keep_alive_margin_ms, keep_alive_ms / 2);
+            idle_ms = aws_min_u64(idle_ms, keep_alive_ms);
+        }
+    }
+
     idle_connection->cull_timestamp =
-        idle_start_timestamp +
-        aws_timestamp_convert(
-            manager->max_connection_idle_in_milliseconds, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+        idle_start_timestamp + aws_timestamp_convert(idle_ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+
+    return idle_connection;
+
+on_error:
 
-    aws_linked_list_push_back(&manager->idle_connections, &idle_connection->node);
+    aws_mem_release(idle_connection->allocator, idle_connection);
+
+    return NULL;
+}
+
+/* Only invoke with lock held */
+static int s_idle_connection(struct aws_http_connection_manager *manager, struct aws_http_connection *connection) {
+    struct aws_idle_connection *idle_connection = s_idle_connection_new(manager, connection);
+    if (idle_connection == NULL) {
+        return AWS_OP_ERR;
+    }
+
+    s_push_idle_connection(&manager->idle_connections, idle_connection);
     ++manager->idle_connection_count;
 
     return AWS_OP_SUCCESS;
+}
 
-on_error:
+/*
+ * Puts a released connection straight onto its shard's idle stack, without the manager's lock.
+ * Returns false if the release needs the usual transaction instead (acquisitions are pending, or shutting down).
+ */
+static bool s_try_release_to_shard(
+    struct aws_http_connection_manager *manager,
+    struct aws_http_connection *connection) {
+    struct aws_idle_connection *idle_connection = s_idle_connection_new(manager, connection);
+    if (idle_connection == NULL) {
+        return false;
+    }
 
-    aws_mem_release(idle_connection->allocator, idle_connection);
+    struct aws_http_connection_manager_shard *shard = s_get_shard_for_connection(manager, connection);
+
+    aws_mutex_lock(&shard->lock);
+    /* Read the hint while holding the shard's lock, see "Shards" above */
+    bool is_idle = shard->is_open && aws_atomic_load_int(&manager->pending_acquisition_count_hint) == 0;
+    if (is_idle) {
+        s_push_idle_connection(&shard->idle_connections, idle_connection);
+        ++shard->idle_connection_count;
+    }
+    aws_mutex_unlock(&shard->lock);
 
-    return AWS_OP_ERR;
+    if (!is_idle) {
+        aws_mem_release(idle_connection->allocator, idle_connection);
+    }
+    return is_idle;
 }
 
 int aws_http_connection_manager_release_connection(
     struct aws_http_connection_manager *manager,
     struct aws_http_connection *connection) {
 
-    struct aws_connection_management_transaction work;
-    s_aws_connection_management_transaction_init(&work, manager);
-
     int result = AWS_OP_ERR;
     bool should_release_connection = !manager->system_vtable->is_connection_available(connection);
+    AWS_HTTP_TRACE(AWS_HTTP_TRACE_CONNECTION_RELEASED, manager, (uintptr_t)connection, 0);
 
     AWS_LOGF_DEBUG(
         AWS_LS_HTTP_CONNECTION_MANAGER,
@@ -1231,6 +2423,14 @@ int aws_http_connection_manager_release_connection(
         (void *)manager,
         (void *)connection);
 
+    if (manager->shards && !should_release_connection && s_try_release_to_shard(manager, connection)) {
+        /* The connection stays counted as vended, so nothing else changes */
+        return AWS_OP_SUCCESS;
+    }
+
+    struct aws_connection_management_transaction work;
+    s_aws_connection_management_transaction_init(&work, manager);
+
     aws_mutex_lock(&manager->lock);
 
     /* We're probably hosed in this case, but let's not underflow */
@@ -1245,6 +2445,13 @@ int aws_http_connection_manager_release_connection(
 
     result = AWS_OP_SUCCESS;
 
+    struct aws_cm_shared_connection *shared_connection = s_find_shared_connection(manager, connection);
+    if (shared_connection && s_release_lease(manager, shared_connection, should_release_connection)) {
+        /* Other acquisitions still hold it, so it stays vended. A pending acquisition may take the freed lease */
+        s_aws_http_connection_manager_build_transaction(&work);
+        goto release;
+    }
+
     s_connection_manager_internal_ref_decrease(manager, AWS_HCMCT_VENDED_CONNECTION, 1);
 
     if (!should_release_connection) {
@@ -1273,7 +2480,8 @@ static void s_aws_http_connection_manager_h2_on_goaway_received(
     uint32_t http2_error_code,
     struct aws_byte_cursor debug_data,
     void *user_data) {
-    struct aws_http_connection_manager *manager = user_data;
+    struct aws_cm_connection_context *connection_context = user_data;
+    struct aws_http_connection_manager *manager = connection_context->manager;
     /* We don't offer user the details, but we can still log it out for debugging */
     AWS_LOGF_DEBUG(
         AWS_LS_HTTP_CONNECTION_MANAGER,
@@ -1292,17 +2500,13 @@ static void s_aws_http_connection_manager_h2_on_goaway_received(
     aws_mutex_lock(&manager->lock);
     /* Goaway received, remove the connection from idle and release it, if it's there. But, not decrease the
      * open_connection_count as the shutdown callback will be invoked, we still need the manager to be alive */
-    const struct aws_linked_list_node *end = aws_linked_list_end(&manager->idle_connections);
-    for (struct aws_linked_list_node *node = aws_linked_list_begin(&manager->idle_connections); node != end;
-         node = aws_linked_list_next(node)) {
-        struct aws_idle_connection *current_idle_connection = AWS_CONTAINER_OF(node, struct aws_idle_connection, node);
-        if (current_idle_connection->connection == http2_connection) {
-            aws_linked_list_remove(node);
-            work.connection_to_release = http2_connection;
-            aws_mem_release(current_idle_connection->allocator, current_idle_connection);
-            --manager->idle_connection_count;
-            break;
-        }
+    if (s_remove_idle_connection(manager, http2_connection)) {
+        work.connection_to_release = http2_connection;
+    }
+    struct aws_cm_shared_connection *shared_connection = s_find_shared_connection(manager, http2_connection);
+    if (shared_connection) {
+        /* No new leases, it's released once the current ones are */
+        s_remove_from_room_list(shared_connection);
     }
     s_aws_http_connection_manager_build_transaction(&work);
 
@@ -1331,11 +2535,15 @@ static void s_cm_on_connection_ready_or_failed(
                 (void *)manager,
                 (void *)connection);
             work->connection_to_release = connection;
+        } else if (manager->pending_acquisition_count == 0) {
+            /* Nothing is waiting for it, so it was opened ahead of demand */
+            struct aws_idle_connection *idle_connection =
+                AWS_CONTAINER_OF(aws_linked_list_back(&manager->idle_connections), struct aws_idle_connection, node);
+            idle_connection->is_prewarmed = true;
         }
     } else {
         /* fail acquisition as one connection cannot be used any more */
-        while (manager->pending_acquisition_count >
-               manager->internal_ref[AWS_HCMCT_PENDING_CONNECTIONS] + manager->pending_settings_count) {
+        while (manager->pending_acquisition_count > s_get_pending_connection_acquisition_capacity(manager)) {
             AWS_LOGF_DEBUG(
                 AWS_LS_HTTP_CONNECTION_MANAGER,
                 "id=%p: Failing excess connection acquisition with error code %d",
@@ -1354,10 +2562,17 @@ static void s_aws_http_connection_manager_h2_on_initial_settings_completed(
     struct aws_http_connection *http2_connection,
     int error_code,
     void *user_data) {
-    struct aws_http_connection_manager *manager = user_data;
+    struct aws_cm_connection_context *connection_context = user_data;
+    struct aws_http_connection_manager *manager = connection_context->manager;
     /* The other side acknowledge about the settings which also means we received the settings from other side at this
      * point, because the settings should be the fist frame to be sent */
 
+    if (!error_code) {
+        uint64_t now = 0;
+        manager->system_vtable->get_monotonic_time(&now);
+        aws_http_atomic_histogram_record(&manager->http2_settings_histogram, connection_context->setup_timestamp, now);
+    }
+
     struct aws_connection_management_transaction work;
     s_aws_connection_management_transaction_init(&work, manager);
 
@@ -1384,7 +2599,19 @@ static void s_aws_http_connection_manager_on_connection_setup(
     struct aws_http_connection *connection,
     int error_code,
     void *user_data) {
-    struct aws_http_connection_manager *manager = user_data;
+    struct aws_cm_connection_context *connection_context = user_data;
+    struct aws_http_connection_manager *manager = connection_context->manager;
+
+    if (connection != NULL) {
+        manager->system_vtable->get_monotonic_time(&connection_context->setup_timestamp);
+        aws_http_atomic_histogram_record(
+            &manager->connection_setup_histogram,
+            connection_context->connect_timestamp,
+            connection_context->setup_timestamp);
+    } else {
+        /* Shutdown will not be invoked */
+        aws_mem_release(connection_context->allocator, connection_context);
+    }
 
     struct aws_connection_management_transaction work;
     s_aws_connection_management_transaction_init(&work, manager);
@@ -1411,6 +2638,9 @@ static void s_aws_http_connection_manager_on_connection_setup(
     if (!error_code) {
         /* Shutdown will not be invoked if setup completed with error */
         s_connection_manager_internal_ref_increase(manager, AWS_HCMCT_OPEN_CONNECTION, 1);
+    } else {
+        /* The next transaction, or the cull task, tries again */
+        work.skip_min_idle = true;
     }
 
     if (connection != NULL && manager->system_vtable->connection_get_version(connection) == AWS_HTTP_VERSION_2) {
@@ -1445,7 +2675,13 @@ static void s_aws_http_connection_manager_on_connection_shutdown(
     void *user_data) {
     (void)error_code;
 
-    struct aws_http_connection_manager *manager = user_data;
+    struct aws_cm_connection_context *connection_context = user_data;
+    struct aws_http_connection_manager *manager = connection_context->manager;
+
+    uint64_t now = 0;
+    manager->system_vtable->get_monotonic_time(&now);
+    aws_http_atomic_histogram_record(&manager->connection_lifetime_histogram, connection_context->setup_timestamp, now);
+    aws_mem_release(connection_context->allocator, connection_context);
 
     AWS_LOGF_DEBUG(
         AWS_LS_HTTP_CONNECTION_MANAGER,
@@ -1464,17 +2700,8 @@ static void s_aws_http_connection_manager_on_connection_shutdown(
     /*
      * Find and, if found, remove it from idle connections
      */
-    const struct aws_linked_list_node *end = aws_linked_list_end(&manager->idle_connections);
-    for (struct aws_linked_list_node *node = aws_linked_list_begin(&manager->idle_connections); node != end;
-         node = aws_linked_list_next(node)) {
-        struct aws_idle_connection *current_idle_connection = AWS_CONTAINER_OF(node, struct aws_idle_connection, node);
-        if (current_idle_connection->connection == connection) {
-            aws_linked_list_remove(node);
-            work.connection_to_release = connection;
-            aws_mem_release(current_idle_connection->allocator, current_idle_connection);
-            --manager->idle_connection_count;
-            break;
-        }
+    if (s_remove_idle_connection(manager, connection)) {
+        work.connection_to_release = connection;
     }
 
     s_aws_http_connection_manager_build_transaction(&work);
@@ -1484,18 +2711,65 @@ static void s_aws_http_connection_manager_on_connection_shutdown(
     s_aws_http_connection_manager_execute_transaction(&work);
 }
 
-static void s_cull_idle_connections(struct aws_http_connection_manager *manager) {
+/*
+ * Only invoke with lock held.  Moves the connections whose idle time is up from the front of idle_connections
+ * to the back of connections_to_release.  Returns how many were moved.
+ */
+static size_t s_cull_idle_connection_list(
+    struct aws_http_connection_manager *manager,
+    struct aws_linked_list *idle_connections,
+    uint64_t now,
+    size_t max_count,
+    struct aws_linked_list *connections_to_release) {
+
+    size_t culled_count = 0;
+    const struct aws_linked_list_node *end = aws_linked_list_end(idle_connections);
+    struct aws_linked_list_node *current_node = aws_linked_list_begin(idle_connections);
+    while (current_node != end && culled_count < max_count) {
+        struct aws_linked_list_node *node = current_node;
+        struct aws_idle_connection *current_idle_connection = AWS_CONTAINER_OF(node, struct aws_idle_connection, node);
+        if (current_idle_connection->cull_timestamp > now) {
+            break;
+        }
+
+        current_node = aws_linked_list_next(current_node);
+        aws_linked_list_remove(node);
+        aws_linked_list_push_back(connections_to_release, node);
+        ++culled_count;
+
+        AWS_LOGF_DEBUG(
+            AWS_LS_HTTP_CONNECTION_MANAGER,
+            "id=%p: culling idle connection (%p)",
+            (void *)manager,
+            (void *)current_idle_connection->connection);
+    }
+
+    return culled_count;
+}
+
+/*
+ * Each idle list is ordered by expiry (see s_push_idle_connection()), so a cull only touches the connections that
+ * expired (plus the first one that hasn't).
+ * What's left to bound is a burst of them expiring together, which would hold the manager's lock for all of
+ * them at once. So a cull moves at most this many, and the next one is scheduled right away if it stopped there.
+ */
+static const size_t s_max_culls_per_task = 256;
+
+/* Returns true if it stopped at s_max_culls_per_task, so there may be more to cull right away */
+static bool s_cull_idle_connections(struct aws_http_connection_manager *manager) {
     AWS_LOGF_INFO(AWS_LS_HTTP_CONNECTION_MANAGER, "id=%p: culling idle connections", (void *)manager);
 
     if (manager == NULL || manager->max_connection_idle_in_milliseconds == 0) {
-        return;
+        return false;
     }
 
     uint64_t now = 0;
     if (manager->system_vtable->get_monotonic_time(&now)) {
-        return;
+        return false;
     }
 
+    bool is_batch_full = false;
+
     struct aws_connection_management_transaction work;
     s_aws_connection_management_transaction_init(&work, manager);
 
@@ -1503,26 +2777,44 @@ static void s_cull_idle_connections(struct aws_http_connection_manager *manager)
 
     /* Only if we're not shutting down */
     if (manager->state == AWS_HCMST_READY) {
-        const struct aws_linked_list_node *end = aws_linked_list_end(&manager->idle_connections);
-        struct aws_linked_list_node *current_node = aws_linked_list_begin(&manager->idle_connections);
-        while (current_node != end) {
-            struct aws_linked_list_node *node = current_node;
-            struct aws_idle_connection *current_idle_connection =
-                AWS_CONTAINER_OF(node, struct aws_idle_connection, node);
-            if (current_idle_connection->cull_timestamp > now) {
-                break;
+        /* Never cull below min_idle_connections */
+        size_t cullable_count = SIZE_MAX;
+        if (manager->min_idle_connections > 0) {
+            size_t idle_count = manager->idle_connection_count + s_get_shards_idle_connection_count(manager);
+            cullable_count = 0;
+            if (idle_count > manager->min_idle_connections) {
+                cullable_count = idle_count - manager->min_idle_connections;
             }
+        }
+        if (cullable_count > s_max_culls_per_task) {
+            cullable_count = s_max_culls_per_task;
+            is_batch_full = true;
+        }
 
-            current_node = aws_linked_list_next(current_node);
-            aws_linked_list_remove(node);
-            aws_linked_list_push_back(&work.connections_to_release, node);
-            --manager->idle_connection_count;
+        size_t culled_count = s_cull_idle_connection_list(
+            manager, &manager->idle_connections, now, cullable_count, &work.connections_to_release);
+        manager->idle_connection_count -= culled_count;
+        cullable_count -= culled_count;
+
+        size_t shards_culled_count = 0;
+        for (size_t i = 0; i < manager->shard_count; ++i) {
+            struct aws_http_connection_manager_shard *shard = &manager->shards[i];
+            aws_mutex_lock(&shard->lock);
+            culled_count = s_cull_idle_connection_list(
+                manager, &shard->idle_connections, now, cullable_count, &work.connections_to_release);
+            shard->idle_connection_count -= culled_count;
+            aws_mutex_unlock(&shard->lock);
+            cullable_count -= culled_count;
+            shards_culled_count += culled_count;
+        }
+        /* Only full if the whole batch was used */
+        is_batch_full = is_batch_full && cullable_count == 0;
+        /* A shard's idle connections count as vended */
+        s_connection_manager_internal_ref_decrease(manager, AWS_HCMCT_VENDED_CONNECTION, shards_culled_count);
 
-            AWS_LOGF_DEBUG(
-                AWS_LS_HTTP_CONNECTION_MANAGER,
-                "id=%p: culling idle connection (%p)",
-                (void *)manager,
-                (void *)current_idle_connection->connection);
+        if (manager->min_idle_connections > 0) {
+            /* Also retries connections that failed to open for min_idle_connections */
+            s_aws_http_connection_manager_build_transaction(&work);
         }
     }
 
@@ -1531,6 +2823,8 @@ static void s_cull_idle_connections(struct aws_http_connection_manager *manager)
     aws_mutex_unlock(&manager->lock);
 
     s_aws_http_connection_manager_execute_transaction(&work);
+
+    return is_batch_full;
 }
 
 static void s_cull_task(struct aws_task *task, void *arg, enum aws_task_status status) {
@@ -1541,11 +2835,85 @@ static void s_cull_task(struct aws_task *task, void *arg, enum aws_task_status s
 
     struct aws_http_connection_manager *manager = arg;
 
-    s_cull_idle_connections(manager);
+    if (s_cull_idle_connections(manager)) {
+        /* Let everything waiting on the manager's lock in before culling the rest */
+        aws_event_loop_schedule_task_now(manager->cull_event_loop, manager->cull_task);
+        return;
+    }
 
     s_schedule_connection_culling(manager);
 }
 
+static void s_acquisition_timeout_task(struct aws_task *task, void *arg, enum aws_task_status status) {
+    (void)task;
+    if (status != AWS_TASK_STATUS_RUN_READY) {
+        return;
+    }
+
+    struct aws_http_connection_manager *manager = arg;
+
+    struct aws_connection_management_transaction work;
+    s_aws_connection_management_transaction_init(&work, manager);
+
+    uint64_t now = 0;
+    manager->system_vtable->get_monotonic_time(&now);
+
+    aws_mutex_lock(&manager->lock);
+
+    manager->is_acquisition_timeout_task_scheduled = false;
+
+    /* The queue is sorted by deadline, see "Acquisition timeouts" above */
+    size_t timed_out_count = 0;
+    while (!aws_linked_list_empty(&manager->pending_acquisitions)) {
+        struct aws_http_connection_acquisition *oldest_acquisition = AWS_CONTAINER_OF(
+            aws_linked_list_front(&manager->pending_acquisitions), struct aws_http_connection_acquisition, node);
+        if (oldest_acquisition->timeout_timestamp > now) {
+            break;
+        }
+
+        s_aws_http_connection_manager_move_front_acquisition(
+            manager, NULL, AWS_ERROR_HTTP_CONNECTION_MANAGER_ACQUISITION_TIMEOUT, &work.completions);
+        ++timed_out_count;
+    }
+
+    if (timed_out_count > 0) {
+        AWS_LOGF_DEBUG(
+            AWS_LS_HTTP_CONNECTION_MANAGER,
+            "id=%p: Failing %zu connection acquisitions that timed out",
+            (void *)manager,
+            timed_out_count);
+    }
+
+    s_schedule_acquisition_timeout_task(manager);
+
+    s_aws_http_connection_manager_get_snapshot(manager, &work.snapshot);
+
+    aws_mutex_unlock(&manager->lock);
+
+    s_aws_http_connection_manager_execute_transaction(&work);
+}
+
+void aws_http_connection_manager_fetch_latency_metrics(
+    const struct aws_http_connection_manager *manager,
+    struct aws_http_manager_latency_metrics *out_metrics) {
+    AWS_PRECONDITION(manager);
+    AWS_PRECONDITION(out_metrics);
+
+    aws_http_atomic_histogram_snapshot(&manager->acquisition_wait_histogram, &out_metrics->acquisition_wait);
+    aws_http_atomic_histogram_snapshot(&manager->connection_setup_histogram, &out_metrics->connection_setup);
+    aws_http_atomic_histogram_snapshot(&manager->http2_settings_histogram, &out_metrics->http2_settings);
+    aws_http_atomic_histogram_snapshot(&manager->connection_lifetime_histogram, &out_metrics->connection_lifetime);
+}
+
+void aws_http_connection_manager_fetch_memory_usage(
+    const struct aws_http_connection_manager *manager,
+    struct aws_http_connection_memory_usage *out_usage) {
+    AWS_PRECONDITION(manager);
+    AWS_PRECONDITION(out_usage);
+
+    aws_http_connection_memory_tracker_get_usage(manager->memory_tracker, out_usage);
+}
+
 void aws_http_connection_manager_fetch_metrics(
     const struct aws_http_connection_manager *manager,
     struct aws_http_manager_metrics *out_metrics) {
@@ -1553,8 +2921,18 @@ void aws_http_connection_manager_fetch_metrics(
     AWS_PRECONDITION(out_metrics);
 
     AWS_FATAL_ASSERT(aws_mutex_lock((struct aws_mutex *)(void *)&manager->lock) == AWS_OP_SUCCESS);
-    out_metrics->available_concurrency = manager->idle_connection_count;
+    /* Connections idle in shards count as vended internally, but they're reported as available */
+    size_t shards_idle_count = s_get_shards_idle_connection_count((struct aws_http_connection_manager *)manager);
+    out_metrics->available_concurrency = manager->idle_connection_count + shards_idle_count;
     out_metrics->pending_concurrency_acquires = manager->pending_acquisition_count;
-    out_metrics->leased_concurrency = manager->internal_ref[AWS_HCMCT_VENDED_CONNECTION];
+    out_metrics->leased_concurrency = manager->internal_ref[AWS_HCMCT_VENDED_CONNECTION] - shards_idle_count;
+    if (manager->max_http2_leases_per_connection > 0) {
+        /* A shared connection is vended once, but leased to each of its acquisitions */
+        out_metrics->leased_concurrency = out_metrics->leased_concurrency -
+                                          aws_hash_table_get_entry_count(&manager->shared_connections) +
+                                          manager->shared_lease_count;
+    }
+    out_metrics->prewarmed_acquires =
+        aws_atomic_load_int(&manager->prewarmed_acquire_count);
     AWS_FATAL_ASSERT(aws_mutex_unlock((struct aws_mutex *)(void *)&manager->lock) == AWS_OP_SUCCESS);
 }
@@ -34,6 +34,9 @@ static void s_process_statistics(
     uint64_t bytes_written = 0;
     uint32_t h1_current_outgoing_stream_id = 0;
     uint32_t h1_current_incoming_stream_id = 0;
+    uint64_t max_first_byte_latency_ms = 0;
+    uint64_t max_ping_rtt_ms = 0;
+    uint64_t current_window_stall_ms = 0;
 
     /*
      * Pull out the data needed to perform the throughput calculation
@@ -64,6 +67,7 @@ static void s_process_statistics(
                 pending_write_interval_ms = http1_stats->pending_outgoing_stream_ms;
                 h1_current_outgoing_stream_id = http1_stats->current_outgoing_stream_id;
                 h1_current_incoming_stream_id = http1_stats->current_incoming_stream_id;
+                max_first_byte_latency_ms = http1_stats->max_first_byte_latency_ms;
 
                 break;
             }
@@ -74,6 +78,9 @@ static void s_process_statistics(
                 pending_read_interval_ms = h2_stats->pending_incoming_stream_ms;
                 pending_write_interval_ms = h2_stats->pending_outgoing_stream_ms;
                 h2_was_inactive |= h2_stats->was_inactive;
+                max_first_byte_latency_ms = h2_stats->max_first_byte_latency_ms;
+                max_ping_rtt_ms = h2_stats->max_ping_rtt_ms;
+                current_window_stall_ms = h2_stats->current_window_stall_ms;
                 h2 = true;
                 break;
             }
@@ -90,6 +97,41 @@ static void s_process_statistics(
 
     struct aws_channel *channel = context;
 
+    if (impl->options.maximum_first_byte_latency_ms > 0 &&
+        max_first_byte_latency_ms > impl->options.maximum_first_byte_latency_ms) {
+        AWS_LOGF_INFO(
+            AWS_LS_IO_CHANNEL,
+            "id=%p: Channel first byte latency threshold exceeded (%" PRIu64 " ms > %" PRIu64 " ms).  Shutting down.",
+            (void *)channel,
+            max_first_byte_latency_ms,
+            impl->options.maximum_first_byte_latency_ms);
+        aws_channel_shutdown(channel, AWS_ERROR_HTTP_CHANNEL_LATENCY_FAILURE);
+        return;
+    }
+
+    if (impl->options.maximum_ping_rtt_ms > 0 && max_ping_rtt_ms > impl->options.maximum_ping_rtt_ms) {
+        AWS_LOGF_INFO(
+            AWS_LS_IO_CHANNEL,
+            "id=%p: Channel PING round-trip time threshold exceeded (%" PRIu64 " ms > %" PRIu64 " ms).  Shutting down.",
+            (void *)channel,
+            max_ping_rtt_ms,
+            impl->options.maximum_ping_rtt_ms);
+        aws_channel_shutdown(channel, AWS_ERROR_HTTP_CHANNEL_LATENCY_FAILURE);
+        return;
+    }
+
+    if (impl->options.maximum_window_stall_ms > 0 && current_window_stall_ms > impl->options.maximum_window_stall_ms) {
+        AWS_LOGF_INFO(
+            AWS_LS_IO_CHANNEL,
+            "id=%p: Channel flow-control window stall threshold exceeded (%" PRIu64 " ms > %" PRIu64
+            " ms).  Shutting down.",
+            (void *)channel,
+            current_window_stall_ms,
+            impl->options.maximum_window_stall_ms);
+        aws_channel_shutdown(channel, AWS_ERROR_HTTP_CHANNEL_WINDOW_STALL_FAILURE);
+        return;
+    }
+
     uint64_t bytes_per_second = 0;
     uint64_t max_pending_io_interval_ms = 0;
 
@@ -230,6 +272,14 @@ bool aws_http_connection_monitoring_options_is_valid(const struct aws_http_conne
         return false;
     }
 
-    return options->allowable_throughput_failure_interval_seconds > 0 &&
-           options->minimum_throughput_bytes_per_second > 0;
+    bool checks_throughput = options->allowable_throughput_failure_interval_seconds > 0 &&
+                             options->minimum_throughput_bytes_per_second > 0;
+    if (!checks_throughput && (options->allowable_throughput_failure_interval_seconds > 0 ||
+                               options->minimum_throughput_bytes_per_second > 0)) {
+        /* Throughput settings only make sense together */
+        return false;
+    }
+
+    return checks_throughput || options->maximum_first_byte_latency_ms > 0 || options->maximum_ping_rtt_ms > 0 ||
+           options->maximum_window_stall_ms > 0;
 }
@@ -0,0 +1,309 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/private/content_decoding_impl.h>
+
+#include <aws/common/mutex.h>
+#include <aws/http/private/connection_impl.h>
+#include <aws/http/private/request_response_impl.h>
+#include <aws/http/private/strutil.h>
+#include <aws/http/request_response.h>
+#include <aws/io/logging.h>
+
+enum {
+    DEFAULT_DECODED_BUFFER_SIZE = 16 * 1024,
+};
+
+struct aws_http_content_decoding {
+    struct aws_allocator *allocator;
+    struct aws_http_content_decoding_options options;
+
+    /* The user's callbacks, the stream's are pointed at the ones in this file */
+    aws_http_on_incoming_headers_fn *on_incoming_headers;
+    aws_http_on_incoming_body_fn *on_incoming_body;
+    aws_http_on_stream_complete_fn *on_complete;
+
+    /* Only touched on the connection's thread */
+    struct {
+        /* NULL until a Content-Encoding with a coding other than "identity" is received */
+        struct aws_http_content_decoder *decoder;
+        /* Allocated with the first data to decode, and reused for all of it */
+        struct aws_byte_buf decoded_buf;
+    } thread_data;
+
+    struct {
+        struct aws_mutex lock;
+        bool is_decoding;
+        /* Totals for the body so far. Window updates from the user are translated using these */
+        uint64_t encoded_received;
+        uint64_t decoded_received;
+        uint64_t decoded_consumed;
+        uint64_t encoded_credited;
+    } synced_data;
+};
+
+int aws_http_content_decoding_prepare_request(
+    struct aws_http_message *request,
+    const struct aws_http_content_decoding_options *options) {
+
+    if (options->accept_encoding.len == 0) {
+        return AWS_OP_SUCCESS;
+    }
+
+    struct aws_http_headers *headers = aws_http_message_get_headers(request);
+    struct aws_byte_cursor name = aws_byte_cursor_from_c_str("Accept-Encoding");
+    if (aws_http_headers_has(headers, name)) {
+        return AWS_OP_SUCCESS;
+    }
+
+    /* HTTP/2 header names must be lowercase */
+    if (aws_http_message_get_protocol_version(request) == AWS_HTTP_VERSION_2) {
+        name = aws_byte_cursor_from_c_str("accept-encoding");
+    }
+    return aws_http_headers_add(headers, name, options->accept_encoding);
+}
+
+static bool s_is_identity(struct aws_byte_cursor coding) {
+    return aws_byte_cursor_eq_c_str_ignore_case(&coding, "identity");
+}
+
+/* Look for codings in a Content-Encoding header value, creating the decoder for the first one */
+static int s_on_content_encoding(
+    struct aws_http_stream *stream,
+    struct aws_http_content_decoding *decoding,
+    struct aws_byte_cursor value) {
+
+    struct aws_byte_cursor coding;
+    AWS_ZERO_STRUCT(coding);
+    while (aws_byte_cursor_next_split(&value, ',', &coding)) {
+        struct aws_byte_cursor trimmed = aws_strutil_trim_http_whitespace(coding);
+        if (trimmed.len == 0 || s_is_identity(trimmed)) {
+            continue;
+        }
+
+        if (decoding->thread_data.decoder) {
+            AWS_LOGF_ERROR(
+                AWS_LS_HTTP_STREAM,
+                "id=%p: Response has more than one content-coding, only one is supported.",
+                (void *)stream);
+            return aws_raise_error(AWS_ERROR_HTTP_UNSUPPORTED_CONTENT_ENCODING);
+        }
+
+        decoding->thread_data.decoder =
+            decoding->options.new_decoder(decoding->allocator, trimmed, decoding->options.user_data);
+        if (!decoding->thread_data.decoder) {
+            AWS_LOGF_ERROR(
+                AWS_LS_HTTP_STREAM,
+                "id=%p: Cannot decode response with content-coding '" PRInSTR "', error %d (%s).",
+                (void *)stream,
+                AWS_BYTE_CURSOR_PRI(trimmed),
+                aws_last_error(),
+                aws_error_name(aws_last_error()));
+            return AWS_OP_ERR;
+        }
+
+        AWS_LOGF_TRACE(
+            AWS_LS_HTTP_STREAM,
+            "id=%p: Decoding response body with content-coding '" PRInSTR "'.",
+            (void *)stream,
+            AWS_BYTE_CURSOR_PRI(trimmed));
+
+        aws_mutex_lock(&decoding->synced_data.lock);
+        decoding->synced_data.is_decoding = true;
+        aws_mutex_unlock(&decoding->synced_data.lock);
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+static int s_on_incoming_headers(
+    struct aws_http_stream *stream,
+    enum aws_http_header_block header_block,
+    const struct aws_http_header *header_array,
+    size_t num_headers,
+    void *user_data) {
+
+    struct aws_http_content_decoding *decoding = stream->content_decoding;
+    if (header_block == AWS_HTTP_HEADER_BLOCK_MAIN) {
+        for (size_t i = 0; i < num_headers; ++i) {
+            if (aws_http_str_to_header_name(header_array[i].name) == AWS_HTTP_HEADER_CONTENT_ENCODING) {
+                if (s_on_content_encoding(stream, decoding, header_array[i].value)) {
+                    return AWS_OP_ERR;
+                }
+            }
+        }
+    }
+
+    if (decoding->on_incoming_headers) {
+        return decoding->on_incoming_headers(stream, header_block, header_array, num_headers, user_data);
+    }
+    return AWS_OP_SUCCESS;
+}
+
+/* Record what was decoded for window updates. Encoded bytes that decoded to nothing are credited right away,
+ * since the user won't see anything to update the window for */
+static void s_record_decoded(
+    struct aws_http_stream *stream,
+    struct aws_http_content_decoding *decoding,
+    size_t encoded_len,
+    size_t decoded_len) {
+
+    aws_mutex_lock(&decoding->synced_data.lock);
+    decoding->synced_data.encoded_received += encoded_len;
+    decoding->synced_data.decoded_received += decoded_len;
+    if (decoded_len == 0) {
+        decoding->synced_data.encoded_credited += encoded_len;
+    }
+    aws_mutex_unlock(&decoding->synced_data.lock);
+
+    if (decoded_len == 0 && encoded_len > 0 && stream->owning_connection->stream_manual_window_management) {
+        stream->vtable->update_window(stream, encoded_len);
+    }
+}
+
+static int s_on_incoming_body(struct aws_http_stream *stream, const struct aws_byte_cursor *data, void *user_data) {
+    struct aws_http_content_decoding *decoding = stream->content_decoding;
+    struct aws_http_content_decoder *decoder = decoding->thread_data.decoder;
+    if (!decoder) {
+        if (decoding->on_incoming_body) {
+            return decoding->on_incoming_body(stream, data, user_data);
+        }
+        return AWS_OP_SUCCESS;
+    }
+
+    struct aws_byte_buf *decoded_buf = &decoding->thread_data.decoded_buf;
+    if (decoded_buf->capacity == 0) {
+        size_t size = decoding->options.decoded_buffer_size ? decoding->options.decoded_buffer_size
+                                                            : DEFAULT_DECODED_BUFFER_SIZE;
+        if (aws_byte_buf_init(decoded_buf, decoding->allocator, size)) {
+            return AWS_OP_ERR;
+        }
+    }
+
+    struct aws_byte_cursor encoded = *data;
+    bool is_decoded_buf_full = false;
+    do {
+        decoded_buf->len = 0;
+        const size_t prev_encoded_len = encoded.len;
+        if (decoder->vtable->decode(decoder, &encoded, decoded_buf)) {
+            AWS_LOGF_ERROR(
+                AWS_LS_HTTP_STREAM,
+                "id=%p: Failed to decode response body, error %d (%s).",
+                (void *)stream,
+                aws_last_error(),
+                aws_error_name(aws_last_error()));
+            return AWS_OP_ERR;
+        }
+
+        if (encoded.len > 0 && encoded.len == prev_encoded_len && decoded_buf->len == 0) {
+            AWS_LOGF_ERROR(AWS_LS_HTTP_STREAM, "id=%p: Content decoder made no progress.", (void *)stream);
+            return aws_raise_error(AWS_ERROR_HTTP_CONTENT_DECODING_FAILED);
+        }
+
+        /* Record before invoking the user, who may update the window during the callback */
+        s_record_decoded(stream, decoding, prev_encoded_len - encoded.len, decoded_buf->len);
+
+        if (decoded_buf->len > 0 && decoding->on_incoming_body) {
+            struct aws_byte_cursor decoded = aws_byte_cursor_from_buf(decoded_buf);
+            if (decoding->on_incoming_body(stream, &decoded, user_data)) {
+                return AWS_OP_ERR;
+            }
+        }
+
+        /* A full buffer may mean the decoder has more to give, even if all the input was consumed */
+        is_decoded_buf_full = decoded_buf->len == decoded_buf->capacity;
+    } while (encoded.len > 0 || is_decoded_buf_full);
+
+    return AWS_OP_SUCCESS;
+}
+
+static void s_on_complete(struct aws_http_stream *stream, int error_code, void *user_data) {
+    struct aws_http_content_decoding *decoding = stream->content_decoding;
+    struct aws_http_content_decoder *decoder = decoding->thread_data.decoder;
+    if (error_code == AWS_ERROR_SUCCESS && decoder && decoder->vtable->finish(decoder)) {
+        error_code = aws_last_error();
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_STREAM,
+            "id=%p: Response body ended before it could be fully decoded, error %d (%s).",
+            (void *)stream,
+            error_code,
+            aws_error_name(error_code));
+    }
+
+    if (decoding->on_complete) {
+        decoding->on_complete(stream, error_code, user_data);
+    }
+}
+
+int aws_http_stream_content_decoding_init(
+    struct aws_http_stream *stream,
+    const struct aws_http_content_decoding_options *options) {
+
+    AWS_PRECONDITION(stream->content_decoding == NULL);
+    AWS_PRECONDITION(options->new_decoder);
+
+    struct aws_http_content_decoding *decoding =
+        aws_mem_calloc(stream->alloc, 1, sizeof(struct aws_http_content_decoding));
+    decoding->allocator = stream->alloc;
+    decoding->options = *options;
+    aws_mutex_init(&decoding->synced_data.lock);
+
+    decoding->on_incoming_headers = stream->on_incoming_headers;
+    decoding->on_incoming_body = stream->on_incoming_body;
+    decoding->on_complete = stream->on_complete;
+
+    stream->on_incoming_headers = s_on_incoming_headers;
+    stream->on_incoming_body = s_on_incoming_body;
+    stream->on_complete = s_on_complete;
+    stream->content_decoding = decoding;
+    return AWS_OP_SUCCESS;
+}
+
+void aws_http_stream_content_decoding_clean_up(struct aws_http_stream *stream) {
+    struct aws_http_content_decoding *decoding = stream->content_decoding;
+    if (!decoding) {
+        return;
+    }
+
+    if (decoding->thread_data.decoder) {
+        decoding->thread_data.decoder->vtable->destroy(decoding->thread_data.decoder);
+    }
+    aws_byte_buf_clean_up(&decoding->thread_data.decoded_buf);
+    aws_mutex_clean_up(&decoding->synced_data.lock);
+    aws_mem_release(decoding->allocator, decoding);
+    stream->content_decoding = NULL;
+}
+
+size_t aws_http_stream_content_decoding_translate_window(struct aws_http_stream *stream, size_t decoded_increment) {
+    struct aws_http_content_decoding *decoding = stream->content_decoding;
+    size_t encoded_increment = decoded_increment;
+
+    aws_mutex_lock(&decoding->synced_data.lock);
+    if (decoding->synced_data.is_decoding) {
+        decoding->synced_data.decoded_consumed = aws_min_u64(
+            aws_add_u64_saturating(decoding->synced_data.decoded_consumed, decoded_increment),
+            decoding->synced_data.decoded_received);
+
+        /* The encoded bytes the consumed data came from. Codings don't say which encoded bytes produced what,
+         * so this goes by the ratio so far, and is exact once everything received has been consumed */
+        uint64_t encoded_consumed = decoding->synced_data.encoded_received;
+        if (decoding->synced_data.decoded_consumed < decoding->synced_data.decoded_received) {
+            double ratio = (double)decoding->synced_data.decoded_consumed /
+                           (double)decoding->synced_data.decoded_received;
+            encoded_consumed = aws_min_u64(
+                (uint64_t)((double)decoding->synced_data.encoded_received * ratio),
+                decoding->synced_data.encoded_received);
+        }
+
+        encoded_increment = 0;
+        if (encoded_consumed > decoding->synced_data.encoded_credited) {
+            encoded_increment = (size_t)(encoded_consumed - decoding->synced_data.encoded_credited);
+            decoding->synced_data.encoded_credited = encoded_consumed;
+        }
+    }
+    aws_mutex_unlock(&decoding->synced_data.lock);
+
+    return encoded_increment;
+}
@@ -0,0 +1,234 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/private/content_encoding_impl.h>
+
+#include <aws/http/request_response.h>
+#include <aws/io/logging.h>
+#include <aws/io/stream.h>
+
+enum {
+    DEFAULT_UNENCODED_BUFFER_SIZE = 16 * 1024,
+};
+
+/* Input stream that reads the source body stream through an encoder */
+struct aws_http_content_encoding_stream {
+    struct aws_input_stream base;
+    struct aws_allocator *allocator;
+    struct aws_input_stream *source;
+    struct aws_http_content_encoder *encoder;
+    /* Data read from the source, and the part of it that hasn't been passed to the encoder yet */
+    struct aws_byte_buf unencoded_buf;
+    struct aws_byte_cursor unencoded;
+    bool is_source_end;
+    bool is_complete;
+};
+
+static int s_encoding_stream_seek(struct aws_input_stream *stream, int64_t offset, enum aws_stream_seek_basis basis) {
+    (void)stream;
+    (void)offset;
+    (void)basis;
+    return aws_raise_error(AWS_ERROR_UNSUPPORTED_OPERATION);
+}
+
+static int s_encoding_stream_read(struct aws_input_stream *stream, struct aws_byte_buf *dest) {
+    struct aws_http_content_encoding_stream *encoding_stream =
+        AWS_CONTAINER_OF(stream, struct aws_http_content_encoding_stream, base);
+
+    while (!encoding_stream->is_complete && dest->len < dest->capacity) {
+        if (encoding_stream->unencoded.len == 0 && !encoding_stream->is_source_end) {
+            aws_byte_buf_reset(&encoding_stream->unencoded_buf, false /*zero_contents*/);
+            if (aws_input_stream_read(encoding_stream->source, &encoding_stream->unencoded_buf)) {
+                return AWS_OP_ERR;
+            }
+            encoding_stream->unencoded = aws_byte_cursor_from_buf(&encoding_stream->unencoded_buf);
+
+            struct aws_stream_status status;
+            if (aws_input_stream_get_status(encoding_stream->source, &status)) {
+                return AWS_OP_ERR;
+            }
+            encoding_stream->is_source_end = status.is_end_of_stream;
+
+            /* Source has nothing for us right now, try again later */
+            if (encoding_stream->unencoded.len == 0 && !encoding_stream->is_source_end) {
+                break;
+            }
+        }
+
+        const size_t prev_unencoded_len = encoding_stream->unencoded.len;
+        const size_t prev_dest_len = dest->len;
+        struct aws_http_content_encoder *encoder = encoding_stream->encoder;
+        if (encoder->vtable->encode(
+                encoder,
+                &encoding_stream->unencoded,
+                encoding_stream->is_source_end,
+                dest,
+                &encoding_stream->is_complete)) {
+            AWS_LOGF_ERROR(
+                AWS_LS_HTTP_STREAM,
+                "id=%p: Failed to encode request body, error %d (%s).",
+                (void *)stream,
+                aws_last_error(),
+                aws_error_name(aws_last_error()));
+            return AWS_OP_ERR;
+        }
+
+        if (!encoding_stream->is_complete && encoding_stream->unencoded.len == prev_unencoded_len &&
+            dest->len == prev_dest_len) {
+            AWS_LOGF_ERROR(AWS_LS_HTTP_STREAM, "id=%p: Content encoder made no progress.", (void *)stream);
+            return aws_raise_error(AWS_ERROR_HTTP_CONTENT_ENCODING_FAILED);
+        }
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+static int s_encoding_stream_get_status(struct aws_input_stream *stream, struct aws_stream_status *status) {
+    struct aws_http_content_encoding_stream *encoding_stream =
+        AWS_CONTAINER_OF(stream, struct aws_http_content_encoding_stream, base);
+
+    status->is_end_of_stream = encoding_stream->is_complete;
+    status->is_valid = true;
+    return AWS_OP_SUCCESS;
+}
+
+static int s_encoding_stream_get_length(struct aws_input_stream *stream, int64_t *out_length) {
+    (void)stream;
+    (void)out_length;
+    return aws_raise_error(AWS_ERROR_UNSUPPORTED_OPERATION);
+}
+
+static void s_encoding_stream_destroy(void *user_data) {
+    struct aws_http_content_encoding_stream *encoding_stream = user_data;
+
+    aws_input_stream_release(encoding_stream->source);
+    if (encoding_stream->encoder) {
+        encoding_stream->encoder->vtable->destroy(encoding_stream->encoder);
+    }
+    aws_byte_buf_clean_up(&encoding_stream->unencoded_buf);
+    aws_mem_release(encoding_stream->allocator, encoding_stream);
+}
+
+static struct aws_input_stream_vtable s_encoding_stream_vtable = {
+    .seek = s_encoding_stream_seek,
+    .read = s_encoding_stream_read,
+    .get_status = s_encoding_stream_get_status,
+    .get_length = s_encoding_stream_get_length,
+};
+
+static struct aws_input_stream *s_encoding_stream_new(
+    struct aws_allocator *allocator,
+    struct aws_input_stream *source,
+    const struct aws_http_content_encoding_options *options) {
+
+    struct aws_http_content_encoding_stream *encoding_stream =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_http_content_encoding_stream));
+    encoding_stream->allocator = allocator;
+
+    size_t buffer_size =
+        options->unencoded_buffer_size ? options->unencoded_buffer_size : DEFAULT_UNENCODED_BUFFER_SIZE;
+    if (aws_byte_buf_init(&encoding_stream->unencoded_buf, allocator, buffer_size)) {
+        goto error;
+    }
+
+    encoding_stream->encoder = options->new_encoder(allocator, options->content_coding, options->user_data);
+    if (!encoding_stream->encoder) {
+        goto error;
+    }
+
+    encoding_stream->source = aws_input_stream_acquire(source);
+    encoding_stream->base.vtable = &s_encoding_stream_vtable;
+    aws_ref_count_init(&encoding_stream->base.ref_count, encoding_stream, s_encoding_stream_destroy);
+    return &encoding_stream->base;
+
+error:
+    s_encoding_stream_destroy(encoding_stream);
+    return NULL;
+}
+
+bool aws_http_content_encoding_is_body_stream(const struct aws_input_stream *body_stream) {
+    return body_stream != NULL && body_stream->vtable == &s_encoding_stream_vtable;
+}
+
+struct aws_http_message *aws_http_content_encoding_new_request(
+    struct aws_allocator *allocator,
+    struct aws_http_message *request,
+    const struct aws_http_content_encoding_options *options) {
+
+    AWS_PRECONDITION(aws_http_message_get_body_stream(request));
+
+    struct aws_http_headers *headers = aws_http_message_get_headers(request);
+    if (aws_http_headers_has(headers, aws_byte_cursor_from_c_str("Content-Encoding"))) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_GENERAL,
+            "id=%p: Cannot encode request body, the request already has a Content-Encoding header.",
+            (void *)request);
+        aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    struct aws_input_stream *body_stream = NULL;
+    const bool is_http2 = aws_http_message_get_protocol_version(request) == AWS_HTTP_VERSION_2;
+    struct aws_http_message *encoded_request =
+        is_http2 ? aws_http2_message_new_request(allocator) : aws_http_message_new_request(allocator);
+    if (!encoded_request) {
+        return NULL;
+    }
+
+    /* HTTP/2 requests carry the method and path as pseudo-headers, which are copied below */
+    if (!is_http2) {
+        struct aws_byte_cursor method;
+        struct aws_byte_cursor path;
+        if (aws_http_message_get_request_method(request, &method) ||
+            aws_http_message_set_request_method(encoded_request, method) ||
+            aws_http_message_get_request_path(request, &path) ||
+            aws_http_message_set_request_path(encoded_request, path)) {
+            goto error;
+        }
+    }
+
+    const size_t header_count = aws_http_headers_count(headers);
+    for (size_t i = 0; i < header_count; ++i) {
+        struct aws_http_header header;
+        aws_http_headers_get_index(headers, i, &header);
+
+        /* The encoded length isn't known */
+        if (aws_byte_cursor_eq_c_str_ignore_case(&header.name, "content-length")) {
+            continue;
+        }
+        if (aws_http_message_add_header(encoded_request, header)) {
+            goto error;
+        }
+    }
+
+    struct aws_byte_cursor content_encoding_name =
+        aws_byte_cursor_from_c_str(is_http2 ? "content-encoding" : "Content-Encoding");
+    if (aws_http_headers_add(
+            aws_http_message_get_headers(encoded_request), content_encoding_name, options->content_coding)) {
+        goto error;
+    }
+
+    if (!is_http2 && !aws_http_headers_has(headers, aws_byte_cursor_from_c_str("Transfer-Encoding"))) {
+        if (aws_http_headers_add(
+                aws_http_message_get_headers(encoded_request),
+                aws_byte_cursor_from_c_str("Transfer-Encoding"),
+                aws_byte_cursor_from_c_str("chunked"))) {
+            goto error;
+        }
+    }
+
+    body_stream = s_encoding_stream_new(allocator, aws_http_message_get_body_stream(request), options);
+    if (!body_stream) {
+        goto error;
+    }
+    aws_http_message_set_body_stream(encoded_request, body_stream);
+    aws_input_stream_release(body_stream);
+
+    return encoded_request;
+
+error:
+    aws_http_message_release(encoded_request);
+    return NULL;
+}
@@ -0,0 +1,229 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/common/atomics.h>
+#include <aws/common/file.h>
+#include <aws/common/math.h>
+#include <aws/http/request_response.h>
+
+#ifdef _WIN32
+#    include <windows.h>
+#else
+#    include <errno.h>
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+/* Mapped range is split into segments of this size, so the channel can report progress (and pace writes)
+ * as it goes, instead of holding one enormous aws_io_message */
+#define FILE_BODY_SEGMENT_SIZE (1024 * 1024)
+
+/* Shared by all segments of a file body. Unmapped when the last segment is released */
+struct aws_http_file_mapping {
+    struct aws_allocator *allocator;
+    void *addr;
+    size_t len;
+    struct aws_atomic_var segments_outstanding;
+};
+
+static void s_unmap(void *addr, size_t len) {
+#ifdef _WIN32
+    (void)len;
+    UnmapViewOfFile(addr);
+#else
+    munmap(addr, len);
+#endif
+}
+
+/* Segments may be released from different threads (event-loop write completion vs stream destruction) */
+static void s_on_file_segment_release(void *user_data) {
+    struct aws_http_file_mapping *mapping = user_data;
+    if (aws_atomic_fetch_sub(&mapping->segments_outstanding, 1) == 1) {
+        s_unmap(mapping->addr, mapping->len);
+        aws_mem_release(mapping->allocator, mapping);
+    }
+}
+
+/* Map the range [offset, offset+length) of the file. Returns pointer to the data at `offset`.
+ * Mappings must start on a page (or allocation granularity) boundary, so *out_map_addr and *out_map_len
+ * describe the slightly larger range that actually got mapped */
+static uint8_t *s_map_file_range(
+    const char *file_path,
+    uint64_t offset,
+    uint64_t length,
+    void **out_map_addr,
+    size_t *out_map_len) {
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(
+        file_path,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+        NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        aws_raise_error(AWS_ERROR_FILE_INVALID_PATH);
+        return NULL;
+    }
+
+    uint8_t *data = NULL;
+    HANDLE file_mapping = NULL;
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+        aws_raise_error(AWS_ERROR_SYS_CALL_FAILURE);
+        goto done;
+    }
+    uint64_t end;
+    if (aws_add_u64_checked(offset, length, &end) || end > (uint64_t)file_size.QuadPart) {
+        aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+        goto done;
+    }
+
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    uint64_t map_offset = offset - (offset % system_info.dwAllocationGranularity);
+    uint64_t map_len = length + (offset - map_offset);
+    if (map_len > SIZE_MAX) {
+        aws_raise_error(AWS_ERROR_OVERFLOW_DETECTED);
+        goto done;
+    }
+
+    file_mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (file_mapping == NULL) {
+        aws_raise_error(AWS_ERROR_SYS_CALL_FAILURE);
+        goto done;
+    }
+
+    void *map_addr =
+        MapViewOfFile(file_mapping, FILE_MAP_READ, (DWORD)(map_offset >> 32), (DWORD)map_offset, (SIZE_T)map_len);
+    if (map_addr == NULL) {
+        aws_raise_error(AWS_ERROR_SYS_CALL_FAILURE);
+        goto done;
+    }
+
+    *out_map_addr = map_addr;
+    *out_map_len = (size_t)map_len;
+    data = (uint8_t *)map_addr + (offset - map_offset);
+
+done:
+    /* The view keeps the file's data alive, handles aren't needed anymore */
+    if (file_mapping) {
+        CloseHandle(file_mapping);
+    }
+    CloseHandle(file);
+    return data;
+
+#else
+    int fd = open(file_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        aws_translate_and_raise_io_error(errno);
+        return NULL;
+    }
+
+    uint8_t *data = NULL;
+    struct stat file_stat;
+    if (fstat(fd, &file_stat)) {
+        aws_translate_and_raise_io_error(errno);
+        goto done;
+    }
+    uint64_t end;
+    if (aws_add_u64_checked(offset, length, &end) || end > (uint64_t)file_stat.st_size) {
+        aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+        goto done;
+    }
+
+    uint64_t page_size = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t map_offset = offset - (offset % page_size);
+    uint64_t map_len = length + (offset - map_offset);
+    if (map_len > SIZE_MAX) {
+        aws_raise_error(AWS_ERROR_OVERFLOW_DETECTED);
+        goto done;
+    }
+
+    void *map_addr = mmap(NULL, (size_t)map_len, PROT_READ, MAP_PRIVATE, fd, (off_t)map_offset);
+    if (map_addr == MAP_FAILED) {
+        aws_translate_and_raise_io_error(errno);
+        goto done;
+    }
+
+    /* Just a hint, it's fine if this fails */
+    madvise(map_addr, (size_t)map_len, MADV_SEQUENTIAL);
+
+    *out_map_addr = map_addr;
+    *out_map_len = (size_t)map_len;
+    data = (uint8_t *)map_addr + (offset - map_offset);
+
+done:
+    /* The mapping keeps the file's data alive, the descriptor isn't needed anymore */
+    close(fd);
+    return data;
+#endif
+}
+
+struct aws_input_stream *aws_http_body_stream_new_from_file(
+    struct aws_allocator *allocator,
+    const char *file_path,
+    uint64_t offset,
+    uint64_t length) {
+
+    AWS_PRECONDITION(allocator);
+    AWS_PRECONDITION(file_path);
+
+    if (length == 0) {
+        /* Nothing to map */
+        return aws_http_body_segments_stream_new(allocator, NULL, 0);
+    }
+
+    void *map_addr = NULL;
+    size_t map_len = 0;
+    uint8_t *data = s_map_file_range(file_path, offset, length, &map_addr, &map_len);
+    if (!data) {
+        return NULL;
+    }
+
+    /* map_len fits in size_t, so length does too */
+    size_t segment_count = (size_t)(length / FILE_BODY_SEGMENT_SIZE) + (length % FILE_BODY_SEGMENT_SIZE != 0);
+
+    struct aws_http_file_mapping *mapping = aws_mem_calloc(allocator, 1, sizeof(struct aws_http_file_mapping));
+    mapping->allocator = allocator;
+    mapping->addr = map_addr;
+    mapping->len = map_len;
+    aws_atomic_init_int(&mapping->segments_outstanding, segment_count);
+
+    struct aws_input_stream *stream = NULL;
+    struct aws_http_body_segment *segments =
+        aws_mem_calloc(allocator, segment_count, sizeof(struct aws_http_body_segment));
+    if (!segments) {
+        goto error;
+    }
+
+    size_t remaining = (size_t)length;
+    for (size_t i = 0; i < segment_count; ++i) {
+        size_t segment_len = aws_min_size(remaining, FILE_BODY_SEGMENT_SIZE);
+        segments[i].data = aws_byte_cursor_from_array(data, segment_len);
+        segments[i].on_release = s_on_file_segment_release;
+        segments[i].user_data = mapping;
+        data += segment_len;
+        remaining -= segment_len;
+    }
+
+    /* Segment array is copied by the new stream */
+    stream = aws_http_body_segments_stream_new(allocator, segments, segment_count);
+    aws_mem_release(allocator, segments);
+    if (!stream) {
+        goto error;
+    }
+
+    return stream;
+
+error:
+    s_unmap(map_addr, map_len);
+    aws_mem_release(allocator, mapping);
+    return NULL;
+}
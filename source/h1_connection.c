@@ -6,10 +6,12 @@
 #include <aws/common/math.h>
 #include <aws/common/mutex.h>
 #include <aws/common/string.h>
+#include <aws/http/private/body_lease.h>
 #include <aws/http/private/h1_connection.h>
 #include <aws/http/private/h1_decoder.h>
 #include <aws/http/private/h1_stream.h>
 #include <aws/http/private/request_response_impl.h>
+#include <aws/http/private/tracing_impl.h>
 #include <aws/http/status_code.h>
 #include <aws/io/logging.h>
 
@@ -21,6 +23,9 @@
 
 enum {
     DECODER_INITIAL_SCRATCH_SIZE = 256,
+    HEADER_COLLECTION_INITIAL_COUNT = 32,
+    HEADER_COLLECTION_ARENA_INITIAL_SIZE = 256,
+    CHUNK_POOL_MAX_FREE_COUNT = 32,
 };
 
 static int s_handler_process_read_message(
@@ -59,6 +64,8 @@ static void s_connection_close(struct aws_http_connection *connection_base);
 static void s_connection_stop_new_request(struct aws_http_connection *connection_base);
 static bool s_connection_is_open(const struct aws_http_connection *connection_base);
 static bool s_connection_new_requests_allowed(const struct aws_http_connection *connection_base);
+static void s_connection_on_read_window_budget_available(struct aws_http_connection *connection_base);
+static void s_connection_on_body_leases_released(struct aws_http_connection *connection_base, size_t counted_bytes);
 static int s_decoder_on_request(
     enum aws_http_method method_enum,
     const struct aws_byte_cursor *method_str,
@@ -73,6 +80,17 @@ static void s_gather_statistics(struct aws_channel_handler *handler, struct aws_
 static void s_write_outgoing_stream(struct aws_h1_connection *connection, bool first_try);
 static int s_try_process_next_stream_read_message(struct aws_h1_connection *connection, bool *out_stop_processing);
 
+/* RFC-7231 4.2.2. Methods are case-sensitive */
+static bool s_is_idempotent_method(struct aws_byte_cursor method) {
+    static const char *s_idempotent_methods[] = {"GET", "HEAD", "OPTIONS", "TRACE", "PUT", "DELETE"};
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(s_idempotent_methods); ++i) {
+        if (aws_byte_cursor_eq_c_str(&method, s_idempotent_methods[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
 static struct aws_http_connection_vtable s_h1_connection_vtable = {
     .channel_handler_vtable =
         {
@@ -94,6 +112,8 @@ static struct aws_http_connection_vtable s_h1_connection_vtable = {
     .stop_new_requests = s_connection_stop_new_request,
     .is_open = s_connection_is_open,
     .new_requests_allowed = s_connection_new_requests_allowed,
+    .on_read_window_budget_available = s_connection_on_read_window_budget_available,
+    .on_body_leases_released = s_connection_on_body_leases_released,
     .change_settings = NULL,
     .send_ping = NULL,
     .send_goaway = NULL,
@@ -101,6 +121,9 @@ static struct aws_http_connection_vtable s_h1_connection_vtable = {
     .get_received_goaway = NULL,
     .get_local_settings = NULL,
     .get_remote_settings = NULL,
+    .get_local_enable_connect_protocol = NULL,
+    .get_remote_enable_connect_protocol = NULL,
+    .get_rtt_estimate = NULL,
 };
 
 static const struct aws_h1_decoder_vtable s_h1_decoder_vtable = {
@@ -234,6 +257,44 @@ static bool s_connection_new_requests_allowed(const struct aws_http_connection *
     return new_stream_error_code == 0;
 }
 
+static void s_connection_on_read_window_budget_available(struct aws_http_connection *connection_base) {
+    struct aws_h1_connection *connection = AWS_CONTAINER_OF(connection_base, struct aws_h1_connection, base);
+    if (connection->thread_data.is_reading_stopped) {
+        return;
+    }
+    /* Processing ends by updating the connection window, which asks the budget again */
+    aws_h1_connection_try_process_read_messages(connection);
+}
+
+static void s_connection_on_body_leases_released(struct aws_http_connection *connection_base, size_t counted_bytes) {
+    struct aws_h1_connection *connection = AWS_CONTAINER_OF(connection_base, struct aws_h1_connection, base);
+    AWS_ASSERT(connection->thread_data.read_buffer.leased_bytes >= counted_bytes);
+    connection->thread_data.read_buffer.leased_bytes -= counted_bytes;
+    if (connection->thread_data.is_reading_stopped) {
+        return;
+    }
+    /* Processing ends by updating the connection window, which has room for those bytes again */
+    aws_h1_connection_try_process_read_messages(connection);
+}
+
+/* Release an aws_io_message the connection is done reading, unless body leases still hold it */
+static void s_release_read_message(
+    struct aws_h1_connection *connection,
+    struct aws_io_message *msg,
+    struct aws_http_leased_message *leased_message) {
+
+    if (!leased_message) {
+        aws_mem_release(msg->allocator, msg);
+        return;
+    }
+
+    AWS_ASSERT(leased_message->message == msg);
+    if (aws_http_leased_message_release(leased_message)) {
+        leased_message->counted_bytes = msg->message_data.len;
+        connection->thread_data.read_buffer.leased_bytes += msg->message_data.len;
+    }
+}
+
 static int s_stream_send_response(struct aws_http_stream *stream, struct aws_http_message *response) {
     AWS_PRECONDITION(stream);
     AWS_PRECONDITION(response);
@@ -255,6 +316,60 @@ static size_t s_calculate_midchannel_desired_connection_window(struct aws_h1_con
     return aws_channel_slot_downstream_read_window(connection->base.channel_slot);
 }
 
+/* Auto-size the read-buffer, if `read_buffer.max_capacity` allows it.
+ * Grow if the last read used up the whole connection window but the HTTP-stream kept up with the data,
+ * since that means the window (not the stream) limited throughput.
+ * Shrink if the connection went idle, and nothing is left to read. */
+static void s_auto_size_read_buffer(struct aws_h1_connection *connection) {
+    const size_t capacity = connection->thread_data.read_buffer.capacity;
+    const size_t pending_bytes = connection->thread_data.read_buffer.pending_bytes;
+
+    if (connection->thread_data.read_buffer.went_idle) {
+        if (connection->thread_data.incoming_stream) {
+            /* Next stream already began, not idle after all */
+            connection->thread_data.read_buffer.went_idle = false;
+        } else if (pending_bytes == 0) {
+            connection->thread_data.read_buffer.went_idle = false;
+            connection->thread_data.read_buffer.is_window_exhausted = false;
+
+            if (capacity > connection->thread_data.read_buffer.min_capacity) {
+                connection->thread_data.read_buffer.capacity =
+                    aws_max_size(connection->thread_data.read_buffer.min_capacity, capacity / 2);
+
+                AWS_LOGF_TRACE(
+                    AWS_LS_HTTP_CONNECTION,
+                    "id=%p: Connection is idle, shrinking read buffer capacity to %zu.",
+                    (void *)&connection->base,
+                    connection->thread_data.read_buffer.capacity);
+            }
+            return;
+        }
+    }
+
+    if (!connection->thread_data.read_buffer.is_window_exhausted) {
+        return;
+    }
+    connection->thread_data.read_buffer.is_window_exhausted = false;
+
+    if (capacity >= connection->thread_data.read_buffer.max_capacity) {
+        return;
+    }
+
+    if (pending_bytes > capacity / 2) {
+        /* Data is piling up, a bigger buffer would just hold more of it */
+        return;
+    }
+
+    connection->thread_data.read_buffer.capacity =
+        aws_min_size(connection->thread_data.read_buffer.max_capacity, aws_mul_size_saturating(capacity, 2));
+
+    AWS_LOGF_TRACE(
+        AWS_LS_HTTP_CONNECTION,
+        "id=%p: Read window limited throughput, growing read buffer capacity to %zu.",
+        (void *)&connection->base,
+        connection->thread_data.read_buffer.capacity);
+}
+
 /* Calculate the desired window size for a connection that is processing data for aws_http_streams. */
 static size_t s_calculate_stream_mode_desired_connection_window(struct aws_h1_connection *connection) {
     AWS_ASSERT(aws_channel_thread_is_callers_thread(connection->base.channel_slot->channel));
@@ -264,12 +379,17 @@ static size_t s_calculate_stream_mode_desired_connection_window(struct aws_h1_co
         return SIZE_MAX;
     }
 
-    /* Connection window should match the available space in the read-buffer */
+    s_auto_size_read_buffer(connection);
+
+    /* Connection window should match the available space in the read-buffer. Leased bytes may be over capacity */
     AWS_ASSERT(
-        connection->thread_data.read_buffer.pending_bytes <= connection->thread_data.read_buffer.capacity &&
+        (connection->thread_data.read_buffer.pending_bytes <= connection->thread_data.read_buffer.capacity ||
+         connection->thread_data.read_buffer.max_capacity > connection->thread_data.read_buffer.min_capacity ||
+         connection->thread_data.read_buffer.leased_bytes > 0) &&
         "This isn't fatal, but our math is off");
     const size_t desired_connection_window = aws_sub_size_saturating(
-        connection->thread_data.read_buffer.capacity, connection->thread_data.read_buffer.pending_bytes);
+        connection->thread_data.read_buffer.capacity,
+        connection->thread_data.read_buffer.pending_bytes + connection->thread_data.read_buffer.leased_bytes);
 
     AWS_LOGF_TRACE(
         AWS_LS_HTTP_CONNECTION,
@@ -297,7 +417,16 @@ static int s_update_connection_window(struct aws_h1_connection *connection) {
                                     ? s_calculate_midchannel_desired_connection_window(connection)
                                     : s_calculate_stream_mode_desired_connection_window(connection);
 
-    const size_t increment_size = aws_sub_size_saturating(desired_size, connection->thread_data.connection_window);
+    size_t increment_size = aws_sub_size_saturating(desired_size, connection->thread_data.connection_window);
+    if (!connection->thread_data.has_switched_protocols && connection->base.stream_manual_window_management) {
+        /* What's in the window, and what's been read but not consumed, counts against any read window budget */
+        increment_size = aws_http_connection_update_read_window_budget(
+            &connection->base,
+            connection->thread_data.connection_window + connection->thread_data.read_buffer.pending_bytes +
+                connection->thread_data.read_buffer.leased_bytes,
+            increment_size);
+    }
+
     if (increment_size > 0) {
         /* Update local `connection_window`. See comments at variable's declaration site
          * on why we use this instead of the official `aws_channel_slot.window_size` */
@@ -359,6 +488,7 @@ int aws_h1_stream_activate(struct aws_http_stream *stream) {
 
         /* ID successfully assigned */
         h1_stream->synced_data.api_state = AWS_H1_STREAM_API_STATE_ACTIVE;
+        aws_high_res_clock_get_ticks((uint64_t *)&stream->metrics.activate_timestamp_ns);
 
         aws_linked_list_push_back(&connection->synced_data.new_client_stream_list, &h1_stream->node);
         if (!connection->synced_data.is_cross_thread_work_task_scheduled) {
@@ -372,6 +502,7 @@ int aws_h1_stream_activate(struct aws_http_stream *stream) {
     /* connection keeps activated stream alive until stream completes */
     aws_atomic_fetch_add(&stream->refcount, 1);
     stream->metrics.stream_id = stream->id;
+    AWS_HTTP_TRACE(AWS_HTTP_TRACE_STREAM_ACTIVATE, stream, stream->id, 0);
 
     if (should_schedule_task) {
         AWS_LOGF_TRACE(
@@ -425,8 +556,12 @@ struct aws_http_stream *s_make_request(
 
     /* Success! */
     struct aws_byte_cursor method;
-    aws_http_message_get_request_method(options->request, &method);
+    if (aws_http_message_get_request_method(options->request, &method)) {
+        /* encoder already ensured that the template provides the method */
+        method = aws_byte_cursor_from_string(options->http1_request_template->method);
+    }
     stream->base.request_method = aws_http_str_to_method(method);
+    stream->is_idempotent_request = s_is_idempotent_method(method);
     struct aws_byte_cursor path;
     aws_http_message_get_request_path(options->request, &path);
     AWS_LOGF_DEBUG(
@@ -547,6 +682,8 @@ static void s_stream_complete(struct aws_h1_stream *stream, int error_code) {
         }
     }
 
+    AWS_HTTP_TRACE(AWS_HTTP_TRACE_STREAM_COMPLETE, &stream->base, stream->base.id, error_code);
+
     if (error_code != AWS_ERROR_SUCCESS) {
         if (stream->base.client_data && stream->is_incoming_message_done) {
             /* As a request that finished receiving the response, we ignore error and
@@ -577,6 +714,10 @@ static void s_stream_complete(struct aws_h1_stream *stream, int error_code) {
     /* Remove stream from list. */
     aws_linked_list_remove(&stream->node);
 
+    if (stream->base.server_data && aws_linked_list_empty(&connection->thread_data.stream_list)) {
+        aws_http_connection_server_timeouts_on_idle(&connection->base);
+    }
+
     /* Nice logging */
     if (error_code) {
         AWS_LOGF_DEBUG(
@@ -689,6 +830,9 @@ static void s_set_incoming_stream_ptr(
             connection->thread_data.incoming_stream_timestamp_ns,
             now_ns,
             &connection->thread_data.stats.pending_incoming_stream_ms);
+
+        /* Read buffer may shrink, once the remaining data is processed. See s_auto_size_read_buffer() */
+        connection->thread_data.read_buffer.went_idle = true;
     }
 
     connection->thread_data.incoming_stream = next_incoming_stream;
@@ -775,6 +919,10 @@ static struct aws_h1_stream *s_update_outgoing_stream_ptr(struct aws_h1_connecti
     /* If current stream is NULL, look for more work. */
     if (!current && !connection->thread_data.is_writing_stopped) {
 
+        /* Client streams that were sent and are waiting on their response */
+        size_t pipelined_count = 0;
+        bool is_pipelining_non_idempotent = false;
+
         /* Look for next stream we can work on. */
         for (struct aws_linked_list_node *node = aws_linked_list_begin(&connection->thread_data.stream_list);
              node != aws_linked_list_end(&connection->thread_data.stream_list);
@@ -784,9 +932,18 @@ static struct aws_h1_stream *s_update_outgoing_stream_ptr(struct aws_h1_connecti
 
             /* If we already sent this stream's data, keep looking... */
             if (stream->is_outgoing_message_done) {
+                ++pipelined_count;
+                is_pipelining_non_idempotent |= !stream->is_idempotent_request;
                 continue;
             }
 
+            /* STOP if the pipeline is full. s_decoder_on_done() starts writing again once a response completes */
+            if (connection->max_pipelined_requests && pipelined_count > 0 &&
+                (pipelined_count >= connection->max_pipelined_requests || is_pipelining_non_idempotent ||
+                 !stream->is_idempotent_request)) {
+                break;
+            }
+
             /* STOP if we're a server, and this stream's response isn't ready to send.
              * It's not like we can skip this and start on the next stream because responses must be sent in order.
              * Don't need a check like this for clients because their streams always start with data to send. */
@@ -842,8 +999,10 @@ static void s_on_channel_write_complete(
 
     (void)message;
     struct aws_h1_connection *connection = user_data;
-    AWS_ASSERT(connection->thread_data.is_outgoing_stream_task_active);
     AWS_ASSERT(aws_channel_thread_is_callers_thread(connection->base.channel_slot->channel));
+    AWS_ASSERT(connection->thread_data.write_messages_in_flight > 0);
+
+    connection->thread_data.write_messages_in_flight--;
 
     if (err_code) {
         AWS_LOGF_TRACE(
@@ -857,23 +1016,140 @@ static void s_on_channel_write_complete(
         return;
     }
 
+    /* The task isn't waiting on us if it's already scheduled, or has stopped for lack of data */
+    if (!connection->thread_data.is_outgoing_stream_task_waiting_for_write) {
+        AWS_LOGF_TRACE(
+            AWS_LS_HTTP_CONNECTION, "id=%p: Message finished writing to network.", (void *)&connection->base);
+        return;
+    }
+
     AWS_LOGF_TRACE(
         AWS_LS_HTTP_CONNECTION,
         "id=%p: Message finished writing to network. Rescheduling outgoing stream task.",
         (void *)&connection->base);
 
-    /* To avoid wasting memory, we only want ONE of our written aws_io_messages in the channel at a time.
-     * Therefore, we wait until it's written to the network before trying to send another
-     * by running the outgoing-stream-task again.
+    /* To avoid wasting memory, we only want `max_write_messages_in_flight` of our aws_io_messages in the channel
+     * at a time. Therefore, once that many are in flight, we wait until one is written to the network
+     * before trying to send another by running the outgoing-stream-task again.
      *
      * We also want to share the network with other channels.
      * Therefore, when the write completes, we SCHEDULE the outgoing-stream-task
      * to run again instead of calling the function directly.
      * This way, if the message completes synchronously,
      * we're not hogging the network by writing message after message in a tight loop */
+    connection->thread_data.is_outgoing_stream_task_waiting_for_write = false;
     aws_channel_schedule_task_now(channel, &connection->outgoing_stream_task);
 }
 
+/* Send an aws_io_message from the outgoing stream task down the channel.
+ * Then keep the task going if there's room for another message in flight, or have it wait for one to complete. */
+static int s_send_outgoing_message(struct aws_h1_connection *connection, struct aws_io_message *msg) {
+    /* Count it first, in case it completes synchronously */
+    connection->thread_data.write_messages_in_flight++;
+    if (aws_channel_slot_send_message(connection->base.channel_slot, msg, AWS_CHANNEL_DIR_WRITE)) {
+        connection->thread_data.write_messages_in_flight--;
+        return AWS_OP_ERR;
+    }
+
+    if (connection->thread_data.write_messages_in_flight < connection->max_write_messages_in_flight) {
+        aws_channel_schedule_task_now(connection->base.channel_slot->channel, &connection->outgoing_stream_task);
+    } else {
+        connection->thread_data.is_outgoing_stream_task_waiting_for_write = true;
+    }
+    return AWS_OP_SUCCESS;
+}
+
+/* An aws_io_message whose data is a caller-owned body segment, rather than memory from the channel's message pool.
+ * Whoever finishes with it frees it via aws_mem_release(message->allocator, message), like any other message. */
+struct aws_h1_body_segment_message {
+    struct aws_io_message base;
+    struct aws_http_body_segment segment;
+};
+
+static void s_on_body_segment_write_complete(
+    struct aws_channel *channel,
+    struct aws_io_message *message,
+    int err_code,
+    void *user_data) {
+
+    struct aws_h1_body_segment_message *segment_msg =
+        AWS_CONTAINER_OF(message, struct aws_h1_body_segment_message, base);
+
+    /* Whether or not the write succeeded, the channel is done with the segment's memory */
+    if (segment_msg->segment.on_release) {
+        segment_msg->segment.on_release(segment_msg->segment.user_data);
+    }
+
+    s_on_channel_write_complete(channel, message, err_code, user_data);
+}
+
+/* Send a body segment down the channel without copying it */
+static void s_send_body_segment(struct aws_h1_connection *connection, const struct aws_http_body_segment *segment) {
+    struct aws_h1_body_segment_message *segment_msg =
+        aws_mem_calloc(connection->base.alloc, 1, sizeof(struct aws_h1_body_segment_message));
+    segment_msg->segment = *segment;
+    segment_msg->base.allocator = connection->base.alloc;
+    segment_msg->base.message_type = AWS_IO_MESSAGE_APPLICATION_DATA;
+    segment_msg->base.message_data = aws_byte_buf_from_array(segment->data.ptr, segment->data.len);
+    segment_msg->base.owning_channel = connection->base.channel_slot->channel;
+    segment_msg->base.on_completion = s_on_body_segment_write_complete;
+    segment_msg->base.user_data = connection;
+
+    AWS_LOGF_TRACE(
+        AWS_LS_HTTP_CONNECTION,
+        "id=%p: Outgoing stream task is sending body segment of size %zu without copying.",
+        (void *)&connection->base,
+        segment->data.len);
+
+    if (s_send_outgoing_message(connection, &segment_msg->base)) {
+        int error_code = aws_last_error();
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_CONNECTION,
+            "id=%p: Failed to send message in write direction, error %d (%s). Closing connection.",
+            (void *)&connection->base,
+            error_code,
+            aws_error_name(error_code));
+
+        if (segment->on_release) {
+            segment->on_release(segment->user_data);
+        }
+        aws_mem_release(connection->base.alloc, segment_msg);
+        s_shutdown_due_to_error(connection, error_code);
+    }
+}
+
+/* Recount the memory this connection is holding onto, see aws_http_connection_get_memory_usage().
+ * Chunks still in a stream's synced_data aren't counted until the connection's thread moves them over. */
+static void s_update_memory_usage(struct aws_h1_connection *connection) {
+    struct aws_http_connection_memory_usage usage;
+    AWS_ZERO_STRUCT(usage);
+
+    usage.decoder_scratch = aws_h1_decoder_get_scratch_capacity(connection->thread_data.incoming_stream_decoder);
+    usage.buffered_headers = connection->thread_data.header_collection.string_arena.capacity +
+                             connection->thread_data.header_collection.header_array.current_size;
+    usage.unconsumed_reads =
+        connection->thread_data.read_buffer.pending_bytes + connection->thread_data.read_buffer.leased_bytes;
+
+    for (struct aws_linked_list_node *node = aws_linked_list_begin(&connection->thread_data.stream_list);
+         node != aws_linked_list_end(&connection->thread_data.stream_list);
+         node = aws_linked_list_next(node)) {
+
+        struct aws_h1_stream *stream = AWS_CONTAINER_OF(node, struct aws_h1_stream, node);
+        usage.buffered_headers += stream->incoming_storage_buf.capacity;
+        usage.outgoing_queue += stream->encoder_message.outgoing_head_buf.capacity;
+
+        for (struct aws_linked_list_node *chunk_node = aws_linked_list_begin(&stream->thread_data.pending_chunk_list);
+             chunk_node != aws_linked_list_end(&stream->thread_data.pending_chunk_list);
+             chunk_node = aws_linked_list_next(chunk_node)) {
+
+            struct aws_h1_chunk *chunk = AWS_CONTAINER_OF(chunk_node, struct aws_h1_chunk, node);
+            usage.outgoing_queue += sizeof(struct aws_h1_chunk) + chunk->chunk_line.capacity;
+        }
+    }
+
+    aws_http_connection_set_memory_usage(&connection->base, &usage);
+}
+
 static void s_outgoing_stream_task(struct aws_channel_task *task, void *arg, enum aws_task_status status) {
     (void)task;
     if (status != AWS_TASK_STATUS_RUN_READY) {
@@ -885,6 +1161,7 @@ static void s_outgoing_stream_task(struct aws_channel_task *task, void *arg, enu
     AWS_ASSERT(aws_channel_thread_is_callers_thread(connection->base.channel_slot->channel));
 
     s_write_outgoing_stream(connection, false /*first_try*/);
+    s_update_memory_usage(connection);
 }
 
 void aws_h1_connection_try_write_outgoing_stream(struct aws_h1_connection *connection) {
@@ -897,6 +1174,102 @@ void aws_h1_connection_try_write_outgoing_stream(struct aws_h1_connection *conne
 
     connection->thread_data.is_outgoing_stream_task_active = true;
     s_write_outgoing_stream(connection, true /*first_try*/);
+    s_update_memory_usage(connection);
+}
+
+/* Start the clock on the outgoing stream's held body, if it's not already running */
+static void s_start_expect_continue_timer(struct aws_h1_connection *connection) {
+    if (connection->thread_data.expect_continue_deadline_ns != 0) {
+        return;
+    }
+
+    uint64_t now_ns = 0;
+    aws_channel_current_clock_time(connection->base.channel_slot->channel, &now_ns);
+    connection->thread_data.expect_continue_deadline_ns =
+        aws_add_u64_saturating(now_ns, connection->expect_continue_timeout_ns);
+
+    AWS_LOGF_TRACE(
+        AWS_LS_HTTP_CONNECTION,
+        "id=%p: Holding request body until server responds to 'Expect: 100-continue'.",
+        (void *)&connection->base);
+
+    if (!connection->thread_data.is_expect_continue_timeout_task_scheduled) {
+        connection->thread_data.is_expect_continue_timeout_task_scheduled = true;
+        aws_channel_schedule_task_future(
+            connection->base.channel_slot->channel,
+            &connection->expect_continue_timeout_task,
+            connection->thread_data.expect_continue_deadline_ns);
+    }
+}
+
+/* Let the outgoing stream's held body be sent */
+static void s_stop_holding_body(struct aws_h1_connection *connection) {
+    connection->thread_data.expect_continue_deadline_ns = 0;
+    aws_h1_encoder_continue_body(&connection->thread_data.encoder);
+    aws_h1_connection_try_write_outgoing_stream(connection);
+}
+
+static void s_expect_continue_timeout_task(struct aws_channel_task *task, void *arg, enum aws_task_status status) {
+    (void)task;
+    struct aws_h1_connection *connection = arg;
+    connection->thread_data.is_expect_continue_timeout_task_scheduled = false;
+
+    if (status != AWS_TASK_STATUS_RUN_READY) {
+        return;
+    }
+
+    /* Body is no longer held */
+    if (connection->thread_data.expect_continue_deadline_ns == 0) {
+        return;
+    }
+
+    /* Timer was started again since this task was scheduled, wait for the new deadline */
+    uint64_t now_ns = 0;
+    aws_channel_current_clock_time(connection->base.channel_slot->channel, &now_ns);
+    if (now_ns < connection->thread_data.expect_continue_deadline_ns) {
+        connection->thread_data.is_expect_continue_timeout_task_scheduled = true;
+        aws_channel_schedule_task_future(
+            connection->base.channel_slot->channel,
+            &connection->expect_continue_timeout_task,
+            connection->thread_data.expect_continue_deadline_ns);
+        return;
+    }
+
+    AWS_LOGF_DEBUG(
+        AWS_LS_HTTP_CONNECTION,
+        "id=%p: No response to 'Expect: 100-continue' within %" PRIu64 "ns, sending request body anyway.",
+        (void *)&connection->base,
+        connection->expect_continue_timeout_ns);
+
+    s_stop_holding_body(connection);
+}
+
+/* A final response arrived while the request body is held. Finish the request without it. */
+static void s_abandon_held_body(struct aws_h1_connection *connection, struct aws_h1_stream *stream) {
+    AWS_LOGF_DEBUG(
+        AWS_LS_HTTP_STREAM,
+        "id=%p: Received final response to 'Expect: 100-continue', request body will not be sent.",
+        (void *)&stream->base);
+
+    connection->thread_data.expect_continue_deadline_ns = 0;
+
+    if (!stream->encoder_message.has_chunked_encoding_header) {
+        /* Server is expecting Content-Length bytes of body, the only way to stop sending them is to close */
+        AWS_LOGF_TRACE(
+            AWS_LS_HTTP_STREAM,
+            "id=%p: Request is short of its Content-Length. This will be the final stream on this connection.",
+            (void *)&stream->base);
+
+        stream->is_final_stream = true;
+        { /* BEGIN CRITICAL SECTION */
+            aws_h1_connection_lock_synced_data(connection);
+            connection->synced_data.new_stream_error_code = AWS_ERROR_HTTP_CONNECTION_CLOSED;
+            aws_h1_connection_unlock_synced_data(connection);
+        } /* END CRITICAL SECTION */
+    }
+
+    aws_h1_encoder_abandon_body(&connection->thread_data.encoder);
+    aws_h1_connection_try_write_outgoing_stream(connection);
 }
 
 /* Do the actual work of the outgoing-stream-task */
@@ -913,16 +1286,23 @@ static void s_write_outgoing_stream(struct aws_h1_connection *connection, bool f
      * The outgoing stream task will be kicked off again when user adds more data (new stream, new chunk, etc) */
     struct aws_h1_stream *outgoing_stream = s_update_outgoing_stream_ptr(connection);
     bool waiting_for_chunks = aws_h1_encoder_is_waiting_for_chunks(&connection->thread_data.encoder);
-    if (!outgoing_stream || waiting_for_chunks) {
+    bool waiting_for_continue = aws_h1_encoder_is_waiting_for_continue(&connection->thread_data.encoder);
+    if (!outgoing_stream || waiting_for_chunks || waiting_for_continue) {
         if (!first_try) {
             AWS_LOGF_TRACE(
                 AWS_LS_HTTP_CONNECTION,
-                "id=%p: Outgoing stream task stopped. outgoing_stream=%p waiting_for_chunks:%d",
+                "id=%p: Outgoing stream task stopped. outgoing_stream=%p waiting_for_chunks:%d waiting_for_continue:%d",
                 (void *)&connection->base,
                 outgoing_stream ? (void *)&outgoing_stream->base : NULL,
-                waiting_for_chunks);
+                waiting_for_chunks,
+                waiting_for_continue);
         }
         connection->thread_data.is_outgoing_stream_task_active = false;
+
+        /* The head has finished writing, start waiting for the server's response */
+        if (waiting_for_continue) {
+            s_start_expect_continue_timer(connection);
+        }
         return;
     }
 
@@ -961,7 +1341,7 @@ static void s_write_outgoing_stream(struct aws_h1_connection *connection, bool f
             (void *)&connection->base,
             msg->message_data.len);
 
-        if (aws_channel_slot_send_message(connection->base.channel_slot, msg, AWS_CHANNEL_DIR_WRITE)) {
+        if (s_send_outgoing_message(connection, msg)) {
             AWS_LOGF_ERROR(
                 AWS_LS_HTTP_CONNECTION,
                 "id=%p: Failed to send message in write direction, error %d (%s). Closing connection.",
@@ -973,6 +1353,20 @@ static void s_write_outgoing_stream(struct aws_h1_connection *connection, bool f
         }
 
     } else {
+        aws_mem_release(msg->allocator, msg);
+        msg = NULL;
+
+        /* The body's next segment may be too large to copy, in which case we send it as-is */
+        struct aws_http_body_segment segment;
+        bool took_segment;
+        if (aws_h1_encoder_take_body_segment(&connection->thread_data.encoder, &segment, &took_segment)) {
+            goto error;
+        }
+        if (took_segment) {
+            s_send_body_segment(connection, &segment);
+            return;
+        }
+
         /* If message is empty, warn that no work is being done
          * and reschedule the task to try again next tick.
          * It's likely that body isn't ready, so body streaming function has no data to write yet.
@@ -983,8 +1377,6 @@ static void s_write_outgoing_stream(struct aws_h1_connection *connection, bool f
             (void *)&connection->base,
             outgoing_stream ? (void *)&outgoing_stream->base : NULL);
 
-        aws_mem_release(msg->allocator, msg);
-
         aws_channel_schedule_task_now(connection->base.channel_slot->channel, &connection->outgoing_stream_task);
     }
 
@@ -1072,6 +1464,93 @@ static int s_decoder_on_response(int status_code, void *user_data) {
     return AWS_OP_SUCCESS;
 }
 
+/* Release aws_io_messages that were only kept alive for the collected headers pointing into them */
+static void s_release_retained_messages(struct aws_h1_connection *connection) {
+    while (!aws_linked_list_empty(&connection->thread_data.header_collection.retained_messages)) {
+        struct aws_linked_list_node *node =
+            aws_linked_list_pop_front(&connection->thread_data.header_collection.retained_messages);
+        struct aws_io_message *msg = AWS_CONTAINER_OF(node, struct aws_io_message, queueing_handle);
+        aws_mem_release(msg->allocator, msg);
+    }
+    while (!aws_linked_list_empty(&connection->thread_data.header_collection.retained_leased_messages)) {
+        struct aws_linked_list_node *node =
+            aws_linked_list_pop_front(&connection->thread_data.header_collection.retained_leased_messages);
+        struct aws_http_leased_message *leased_message = AWS_CONTAINER_OF(node, struct aws_http_leased_message, node);
+        s_release_read_message(connection, leased_message->message, leased_message);
+    }
+}
+
+static void s_reset_header_collection(struct aws_h1_connection *connection) {
+    aws_array_list_clear(&connection->thread_data.header_collection.header_array);
+    aws_byte_buf_reset(&connection->thread_data.header_collection.string_arena, false);
+    s_release_retained_messages(connection);
+}
+
+static int s_collect_header(struct aws_h1_connection *connection, const struct aws_h1_decoded_header *header) {
+    struct aws_http_header collected = {
+        .name = header->name_data,
+        .value = header->value_data,
+    };
+
+    if (header->is_data_in_scratch_space) {
+        /* The decoder reuses its scratch space for the next line, so copy this one out */
+        struct aws_byte_buf *arena = &connection->thread_data.header_collection.string_arena;
+        if (aws_byte_buf_append_dynamic(arena, &header->name_data) ||
+            aws_byte_buf_append_dynamic(arena, &header->value_data)) {
+            return AWS_OP_ERR;
+        }
+        collected.name.ptr = NULL;
+        collected.value.ptr = NULL;
+    }
+
+    return aws_array_list_push_back(&connection->thread_data.header_collection.header_array, &collected);
+}
+
+/* Deliver every header collected for this header-block in one call */
+static int s_deliver_collected_headers(struct aws_h1_connection *connection, struct aws_h1_stream *incoming_stream) {
+    if (!connection->thread_data.header_collection.enabled) {
+        return AWS_OP_SUCCESS;
+    }
+
+    struct aws_array_list *header_array = &connection->thread_data.header_collection.header_array;
+    const size_t num_headers = aws_array_list_length(header_array);
+    if (num_headers == 0) {
+        return AWS_OP_SUCCESS;
+    }
+
+    /* Now that the arena is done growing, point the copied headers at it */
+    struct aws_byte_cursor arena = aws_byte_cursor_from_buf(&connection->thread_data.header_collection.string_arena);
+    struct aws_http_header *headers = header_array->data;
+    for (size_t i = 0; i < num_headers; ++i) {
+        if (headers[i].name.ptr == NULL) {
+            headers[i].name.ptr = aws_byte_cursor_advance(&arena, headers[i].name.len).ptr;
+            headers[i].value.ptr = aws_byte_cursor_advance(&arena, headers[i].value.len).ptr;
+        }
+    }
+    AWS_ASSERT(arena.len == 0);
+
+    enum aws_http_header_block header_block =
+        aws_h1_decoder_get_header_block(connection->thread_data.incoming_stream_decoder);
+
+    int err = incoming_stream->base.on_incoming_headers(
+        &incoming_stream->base, header_block, headers, num_headers, incoming_stream->base.user_data);
+
+    s_reset_header_collection(connection);
+
+    if (err) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_STREAM,
+            "id=%p: Incoming header callback raised error %d (%s).",
+            (void *)&incoming_stream->base,
+            aws_last_error(),
+            aws_error_name(aws_last_error()));
+
+        return AWS_OP_ERR;
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
 static int s_decoder_on_header(const struct aws_h1_decoded_header *header, void *user_data) {
     struct aws_h1_connection *connection = user_data;
     struct aws_h1_stream *incoming_stream = connection->thread_data.incoming_stream;
@@ -1147,6 +1626,10 @@ static int s_decoder_on_header(const struct aws_h1_decoded_header *header, void
         }
     }
 
+    if (incoming_stream->base.on_incoming_headers && connection->thread_data.header_collection.enabled) {
+        return s_collect_header(connection, header);
+    }
+
     if (incoming_stream->base.on_incoming_headers) {
         struct aws_http_header deliver = {
             .name = header->name_data,
@@ -1172,21 +1655,38 @@ static int s_decoder_on_header(const struct aws_h1_decoded_header *header, void
 }
 
 static int s_mark_head_done(struct aws_h1_stream *incoming_stream) {
+    struct aws_h1_connection *connection =
+        AWS_CONTAINER_OF(incoming_stream->base.owning_connection, struct aws_h1_connection, base);
+
+    /* Any header-block (including trailers, which arrive after the head is done) ends here */
+    if (s_deliver_collected_headers(connection, incoming_stream)) {
+        return AWS_OP_ERR;
+    }
+
     /* Bail out if we've already done this */
     if (incoming_stream->is_incoming_head_done) {
         return AWS_OP_SUCCESS;
     }
 
-    struct aws_h1_connection *connection =
-        AWS_CONTAINER_OF(incoming_stream->base.owning_connection, struct aws_h1_connection, base);
-
     enum aws_http_header_block header_block =
         aws_h1_decoder_get_header_block(connection->thread_data.incoming_stream_decoder);
 
+    /* Is the body of this request held, waiting on the response to "Expect: 100-continue"? */
+    bool is_body_held = incoming_stream == connection->thread_data.outgoing_stream &&
+                        incoming_stream->encoder_message.hold_body_until_continue;
+
     if (header_block == AWS_HTTP_HEADER_BLOCK_MAIN) {
         AWS_LOGF_TRACE(AWS_LS_HTTP_STREAM, "id=%p: Main header block done.", (void *)&incoming_stream->base);
         incoming_stream->is_incoming_head_done = true;
 
+        if (incoming_stream->base.server_data) {
+            aws_http_connection_server_timeouts_on_head_done(&connection->base);
+        }
+
+        if (is_body_held && aws_h1_encoder_is_waiting_for_continue(&connection->thread_data.encoder)) {
+            s_abandon_held_body(connection, incoming_stream);
+        }
+
     } else if (header_block == AWS_HTTP_HEADER_BLOCK_INFORMATIONAL) {
         AWS_LOGF_TRACE(AWS_LS_HTTP_STREAM, "id=%p: Informational header block done.", (void *)&incoming_stream->base);
 
@@ -1196,9 +1696,20 @@ static int s_mark_head_done(struct aws_h1_stream *incoming_stream) {
             if (s_aws_http1_switch_protocols(connection)) {
                 return AWS_OP_ERR;
             }
+        } else if (
+            incoming_stream->base.client_data->response_status == AWS_HTTP_STATUS_CODE_100_CONTINUE && is_body_held) {
+            AWS_LOGF_TRACE(
+                AWS_LS_HTTP_STREAM,
+                "id=%p: Received '100 Continue', sending request body.",
+                (void *)&incoming_stream->base);
+            s_stop_holding_body(connection);
         }
     }
 
+    if (header_block == AWS_HTTP_HEADER_BLOCK_MAIN) {
+        aws_high_res_clock_get_ticks((uint64_t *)&incoming_stream->base.metrics.receive_headers_end_timestamp_ns);
+    }
+
     /* Invoke user cb */
     if (incoming_stream->base.on_incoming_header_block_done) {
         int err = incoming_stream->base.on_incoming_header_block_done(
@@ -1258,18 +1769,27 @@ static int s_decoder_on_body(const struct aws_byte_cursor *data, bool finished,
         }
     }
 
-    if (incoming_stream->base.on_incoming_body) {
+    if (incoming_stream->base.on_incoming_body_lease) {
+        /* Body data always points into the message being decoded, which is the first one queued */
+        if (!connection->thread_data.read_buffer.leased_message) {
+            struct aws_linked_list_node *node = aws_linked_list_front(&connection->thread_data.read_buffer.messages);
+            connection->thread_data.read_buffer.leased_message = aws_http_leased_message_new(
+                &connection->base, AWS_CONTAINER_OF(node, struct aws_io_message, queueing_handle));
+        }
+        err = aws_http_leased_message_deliver_body(
+            connection->thread_data.read_buffer.leased_message, &incoming_stream->base, *data);
+    } else if (incoming_stream->base.on_incoming_body) {
         err = incoming_stream->base.on_incoming_body(&incoming_stream->base, data, incoming_stream->base.user_data);
-        if (err) {
-            AWS_LOGF_ERROR(
-                AWS_LS_HTTP_STREAM,
-                "id=%p: Incoming body callback raised error %d (%s).",
-                (void *)&incoming_stream->base,
-                aws_last_error(),
-                aws_error_name(aws_last_error()));
+    }
+    if (err) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_STREAM,
+            "id=%p: Incoming body callback raised error %d (%s).",
+            (void *)&incoming_stream->base,
+            aws_last_error(),
+            aws_error_name(aws_last_error()));
 
-            return AWS_OP_ERR;
-        }
+        return AWS_OP_ERR;
     }
 
     return AWS_OP_SUCCESS;
@@ -1342,6 +1862,14 @@ static int s_decoder_on_done(void *user_data) {
         s_stream_complete(incoming_stream, AWS_ERROR_SUCCESS);
 
         s_client_update_incoming_stream_ptr(connection);
+
+        /* The next request may have been waiting for room in the pipeline.
+         * Write it from a task, rather than from the middle of decoding */
+        if (connection->max_pipelined_requests && !connection->thread_data.is_outgoing_stream_task_active &&
+            !aws_linked_list_empty(&connection->thread_data.stream_list)) {
+            connection->thread_data.is_outgoing_stream_task_active = true;
+            aws_channel_schedule_task_now(connection->base.channel_slot->channel, &connection->outgoing_stream_task);
+        }
     }
 
     /* Report success even if user's on_complete() callback shuts down on the connection.
@@ -1377,6 +1905,7 @@ static struct aws_h1_connection *s_connection_new(
 
     /* 1 refcount for user */
     aws_atomic_init_int(&connection->base.refcount, 1);
+    aws_http_connection_atomic_memory_usage_init(&connection->base.memory_usage);
 
     if (manual_window_management) {
         connection->initial_stream_window_size = initial_window_size;
@@ -1392,14 +1921,30 @@ static struct aws_h1_connection *s_connection_new(
                 aws_max_size(clamp_min, aws_min_size(clamp_max, initial_window_size));
         }
 
+        connection->thread_data.read_buffer.min_capacity = connection->thread_data.read_buffer.capacity;
+        connection->thread_data.read_buffer.max_capacity =
+            aws_max_size(connection->thread_data.read_buffer.capacity, http1_options->max_read_buffer_capacity);
+
         connection->thread_data.connection_window = connection->thread_data.read_buffer.capacity;
     } else {
         /* No backpressure, keep connection window at SIZE_MAX */
         connection->initial_stream_window_size = SIZE_MAX;
         connection->thread_data.read_buffer.capacity = SIZE_MAX;
+        connection->thread_data.read_buffer.min_capacity = SIZE_MAX;
+        connection->thread_data.read_buffer.max_capacity = SIZE_MAX;
         connection->thread_data.connection_window = SIZE_MAX;
     }
 
+    connection->max_write_messages_in_flight =
+        http1_options->max_write_messages_in_flight > 0 ? http1_options->max_write_messages_in_flight : 1;
+    connection->bulk_body_passthrough = http1_options->bulk_body_passthrough;
+
+    if (!server) {
+        connection->max_pipelined_requests = http1_options->max_pipelined_requests;
+        connection->expect_continue_timeout_ns = aws_timestamp_convert(
+            http1_options->expect_continue_timeout_ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+    }
+
     aws_h1_encoder_init(&connection->thread_data.encoder, alloc);
 
     aws_channel_task_init(
@@ -1409,8 +1954,15 @@ static struct aws_h1_connection *s_connection_new(
         s_cross_thread_work_task,
         connection,
         "http1_connection_cross_thread_work");
+    aws_channel_task_init(
+        &connection->expect_continue_timeout_task,
+        s_expect_continue_timeout_task,
+        connection,
+        "http1_connection_expect_continue_timeout");
     aws_linked_list_init(&connection->thread_data.stream_list);
     aws_linked_list_init(&connection->thread_data.read_buffer.messages);
+    aws_linked_list_init(&connection->thread_data.header_collection.retained_messages);
+    aws_linked_list_init(&connection->thread_data.header_collection.retained_leased_messages);
     aws_crt_statistics_http1_channel_init(&connection->thread_data.stats);
 
     int err = aws_mutex_init(&connection->synced_data.lock);
@@ -1427,6 +1979,10 @@ static struct aws_h1_connection *s_connection_new(
     aws_linked_list_init(&connection->synced_data.new_client_stream_list);
     connection->synced_data.is_open = true;
 
+    if (aws_h1_chunk_pool_init(&connection->chunk_pool, alloc, CHUNK_POOL_MAX_FREE_COUNT)) {
+        goto error_chunk_pool;
+    }
+
     struct aws_h1_decoder_params options = {
         .alloc = alloc,
         .is_decoding_requests = server,
@@ -1445,9 +2001,32 @@ static struct aws_h1_connection *s_connection_new(
         goto error_decoder;
     }
 
+    if (http1_options->deliver_whole_header_blocks) {
+        connection->thread_data.header_collection.enabled = true;
+        if (aws_array_list_init_dynamic(
+                &connection->thread_data.header_collection.header_array,
+                alloc,
+                HEADER_COLLECTION_INITIAL_COUNT,
+                sizeof(struct aws_http_header))) {
+            goto error_header_array;
+        }
+        if (aws_byte_buf_init(
+                &connection->thread_data.header_collection.string_arena,
+                alloc,
+                HEADER_COLLECTION_ARENA_INITIAL_SIZE)) {
+            goto error_header_arena;
+        }
+    }
+
     return connection;
 
+error_header_arena:
+    aws_array_list_clean_up(&connection->thread_data.header_collection.header_array);
+error_header_array:
+    aws_h1_decoder_destroy(connection->thread_data.incoming_stream_decoder);
 error_decoder:
+    aws_h1_chunk_pool_clean_up(&connection->chunk_pool);
+error_chunk_pool:
     aws_mutex_clean_up(&connection->synced_data.lock);
 error_mutex:
     aws_mem_release(alloc, connection);
@@ -1497,15 +2076,30 @@ static void s_handler_destroy(struct aws_channel_handler *handler) {
     AWS_ASSERT(aws_linked_list_empty(&connection->thread_data.stream_list));
     AWS_ASSERT(aws_linked_list_empty(&connection->synced_data.new_client_stream_list));
 
-    /* Clean up any buffered read messages. */
+    /* Clean up any buffered read messages.
+     * Body leases hold the connection, so the only hold left on a leased message is the connection's */
+    if (connection->thread_data.read_buffer.leased_message) {
+        struct aws_io_message *msg = connection->thread_data.read_buffer.leased_message->message;
+        aws_linked_list_remove(&msg->queueing_handle);
+        s_release_read_message(connection, msg, connection->thread_data.read_buffer.leased_message);
+        connection->thread_data.read_buffer.leased_message = NULL;
+    }
     while (!aws_linked_list_empty(&connection->thread_data.read_buffer.messages)) {
         struct aws_linked_list_node *node = aws_linked_list_pop_front(&connection->thread_data.read_buffer.messages);
         struct aws_io_message *msg = AWS_CONTAINER_OF(node, struct aws_io_message, queueing_handle);
         aws_mem_release(msg->allocator, msg);
     }
 
+    if (connection->thread_data.header_collection.enabled) {
+        s_release_retained_messages(connection);
+        aws_array_list_clean_up(&connection->thread_data.header_collection.header_array);
+        aws_byte_buf_clean_up(&connection->thread_data.header_collection.string_arena);
+    }
+
     aws_h1_decoder_destroy(connection->thread_data.incoming_stream_decoder);
     aws_h1_encoder_clean_up(&connection->thread_data.encoder);
+    aws_h1_chunk_pool_clean_up(&connection->chunk_pool);
+    aws_http_connection_memory_usage_clean_up(&connection->base);
     aws_mutex_clean_up(&connection->synced_data.lock);
     aws_mem_release(connection->base.alloc, connection);
 }
@@ -1580,10 +2174,12 @@ static int s_try_process_next_midchannel_read_message(struct aws_h1_connection *
             sending_bytes,
             queued_msg->message_data.len - queued_msg->copy_mark);
 
-        /* If the last of queued_msg has been copied, it can be deleted now. */
+        /* If the last of queued_msg has been copied, it can be deleted now.
+         * Body leases from before the switch may still hold it. */
         if (queued_msg->copy_mark == queued_msg->message_data.len) {
             aws_linked_list_remove(queued_msg_node);
-            aws_mem_release(queued_msg->allocator, queued_msg);
+            s_release_read_message(connection, queued_msg, connection->thread_data.read_buffer.leased_message);
+            connection->thread_data.read_buffer.leased_message = NULL;
         }
     } else {
         /* Sending all of queued_msg along. */
@@ -1689,6 +2285,63 @@ static struct aws_h1_stream *s_server_invoke_on_incoming_request(struct aws_h1_c
     return new_stream ? AWS_CONTAINER_OF(new_stream, struct aws_h1_stream, base) : NULL;
 }
 
+/* See aws_http1_connection_options.bulk_body_passthrough.
+ * If the whole message is body data the incoming stream can take right now, decode it on the spot,
+ * skipping the read buffer, and only update the connection window once half of it is used.
+ * Returns true if the message was consumed (or the connection shut down trying), false if it should be queued. */
+static bool s_try_pass_body_through(struct aws_h1_connection *connection, struct aws_io_message *message) {
+    if (!connection->bulk_body_passthrough || connection->thread_data.has_switched_protocols ||
+        connection->thread_data.is_reading_stopped || connection->thread_data.is_processing_read_messages ||
+        !aws_linked_list_empty(&connection->thread_data.read_buffer.messages)) {
+        return false;
+    }
+
+    /* Leases point into the first queued message, so those streams need the message queued */
+    struct aws_h1_stream *incoming_stream = connection->thread_data.incoming_stream;
+    if (!incoming_stream || incoming_stream->base.on_incoming_body_lease) {
+        return false;
+    }
+
+    const size_t message_size = message->message_data.len;
+    struct aws_h1_decoder *decoder = connection->thread_data.incoming_stream_decoder;
+    if (aws_h1_decoder_get_body_bytes_until_boundary(decoder) < message_size ||
+        incoming_stream->thread_data.stream_window < message_size) {
+        return false;
+    }
+
+    connection->thread_data.is_processing_read_messages = true;
+
+    /* The decoder is mid-body, so this is a single on_body call, and it's done at the boundary at the latest */
+    struct aws_byte_cursor body = aws_byte_cursor_from_buf(&message->message_data);
+    int err = aws_h1_decode(decoder, &body);
+    aws_mem_release(message->allocator, message);
+    if (err) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_CONNECTION,
+            "id=%p: Message processing failed, error %d (%s). Closing connection.",
+            (void *)&connection->base,
+            aws_last_error(),
+            aws_error_name(aws_last_error()));
+        goto shutdown;
+    }
+
+    /* Once past the boundary, go back to updating the window after every read */
+    const bool is_mid_body = aws_h1_decoder_get_body_bytes_until_boundary(decoder) > 0;
+    if (!is_mid_body || connection->thread_data.connection_window < connection->thread_data.read_buffer.capacity / 2) {
+        if (s_update_connection_window(connection)) {
+            goto shutdown;
+        }
+        s_update_memory_usage(connection);
+    }
+
+    connection->thread_data.is_processing_read_messages = false;
+    return true;
+
+shutdown:
+    s_shutdown_due_to_error(connection, aws_last_error());
+    return true;
+}
+
 static int s_handler_process_read_message(
     struct aws_channel_handler *handler,
     struct aws_channel_slot *slot,
@@ -1712,6 +2365,14 @@ static int s_handler_process_read_message(
         return aws_raise_error(AWS_ERROR_INVALID_STATE);
     }
     connection->thread_data.connection_window -= message_size;
+    if (connection->thread_data.connection_window == 0) {
+        /* The socket may have had more data, but the window stopped it from reading */
+        connection->thread_data.read_buffer.is_window_exhausted = true;
+    }
+
+    if (s_try_pass_body_through(connection, message)) {
+        return AWS_OP_SUCCESS;
+    }
 
     /* Push message into queue of buffered messages */
     aws_linked_list_push_back(&connection->thread_data.read_buffer.messages, &message->queueing_handle);
@@ -1768,6 +2429,8 @@ void aws_h1_connection_try_process_read_messages(struct aws_h1_connection *conne
         goto shutdown;
     }
 
+    s_update_memory_usage(connection);
+
     connection->thread_data.is_processing_read_messages = false;
     return;
 
@@ -1813,6 +2476,9 @@ static int s_try_process_next_stream_read_message(struct aws_h1_connection *conn
 
                 return AWS_OP_ERR;
             }
+
+            /* The new request's head is arriving */
+            aws_http_connection_server_timeouts_on_head_begin(&connection->base);
         }
     }
 
@@ -1856,6 +2522,8 @@ static int s_try_process_next_stream_read_message(struct aws_h1_connection *conn
     if (incoming_stream->base.metrics.receive_start_timestamp_ns == -1) {
         /* That's the first time for the stream receives any message */
         aws_high_res_clock_get_ticks((uint64_t *)&incoming_stream->base.metrics.receive_start_timestamp_ns);
+        aws_http_stream_update_max_first_byte_latency(
+            &incoming_stream->base, &connection->thread_data.stats.max_first_byte_latency_ms);
     }
 
     /* As decoder runs, it invokes the internal s_decoder_X callbacks, which in turn invoke user callbacks.
@@ -1888,7 +2556,21 @@ static int s_try_process_next_stream_read_message(struct aws_h1_connection *conn
      * Otherwise, it remains in the queue for further processing later. */
     if (queued_msg->copy_mark == queued_msg->message_data.len) {
         aws_linked_list_remove(&queued_msg->queueing_handle);
-        aws_mem_release(queued_msg->allocator, queued_msg);
+        struct aws_http_leased_message *leased_message = connection->thread_data.read_buffer.leased_message;
+        connection->thread_data.read_buffer.leased_message = NULL;
+        if (connection->thread_data.header_collection.enabled &&
+            aws_array_list_length(&connection->thread_data.header_collection.header_array) > 0) {
+            /* Collected headers may point into this message, keep it until they're delivered */
+            if (leased_message) {
+                aws_linked_list_push_back(
+                    &connection->thread_data.header_collection.retained_leased_messages, &leased_message->node);
+            } else {
+                aws_linked_list_push_back(
+                    &connection->thread_data.header_collection.retained_messages, &queued_msg->queueing_handle);
+            }
+        } else {
+            s_release_read_message(connection, queued_msg, leased_message);
+        }
     }
 
     return AWS_OP_SUCCESS;
@@ -1968,6 +2650,17 @@ error:
     return AWS_OP_SUCCESS;
 }
 
+/* With max_pipelined_requests, the requests never written get an error that says they are safe to retry */
+static int s_get_pending_stream_error_code(
+    const struct aws_h1_connection *connection,
+    const struct aws_h1_stream *stream,
+    int error_code) {
+    if (connection->max_pipelined_requests && stream->base.metrics.send_start_timestamp_ns == -1) {
+        return AWS_ERROR_HTTP_REQUEST_NOT_SENT;
+    }
+    return error_code;
+}
+
 static int s_handler_shutdown(
     struct aws_channel_handler *handler,
     struct aws_channel_slot *slot,
@@ -1987,6 +2680,8 @@ static int s_handler_shutdown(
         aws_error_name(error_code));
 
     if (dir == AWS_CHANNEL_DIR_READ) {
+        aws_http_connection_stop_server_timeouts(&connection->base);
+
         /* This call ensures that no further streams will be created or worked on. */
         s_stop(connection, true /*stop_reading*/, false /*stop_writing*/, false /*schedule_shutdown*/, error_code);
     } else /* dir == AWS_CHANNEL_DIR_WRITE */ {
@@ -1998,14 +2693,16 @@ static int s_handler_shutdown(
 
         while (!aws_linked_list_empty(&connection->thread_data.stream_list)) {
             struct aws_linked_list_node *node = aws_linked_list_front(&connection->thread_data.stream_list);
-            s_stream_complete(AWS_CONTAINER_OF(node, struct aws_h1_stream, node), stream_error_code);
+            struct aws_h1_stream *stream = AWS_CONTAINER_OF(node, struct aws_h1_stream, node);
+            s_stream_complete(stream, s_get_pending_stream_error_code(connection, stream, stream_error_code));
         }
 
         /* It's OK to access synced_data.new_client_stream_list without holding the lock because
          * no more streams can be added after s_stop() has been invoked. */
         while (!aws_linked_list_empty(&connection->synced_data.new_client_stream_list)) {
             struct aws_linked_list_node *node = aws_linked_list_front(&connection->synced_data.new_client_stream_list);
-            s_stream_complete(AWS_CONTAINER_OF(node, struct aws_h1_stream, node), stream_error_code);
+            struct aws_h1_stream *stream = AWS_CONTAINER_OF(node, struct aws_h1_stream, node);
+            s_stream_complete(stream, s_get_pending_stream_error_code(connection, stream, stream_error_code));
         }
     }
 
@@ -2057,6 +2754,9 @@ static void s_pull_up_stats_timestamps(struct aws_h1_connection *connection) {
 
         connection->thread_data.stats.current_incoming_stream_id =
             aws_http_stream_get_id(&connection->thread_data.incoming_stream->base);
+
+        aws_http_stream_update_max_first_byte_latency(
+            &connection->thread_data.incoming_stream->base, &connection->thread_data.stats.max_first_byte_latency_ms);
     }
 }
 
@@ -2085,6 +2785,7 @@ struct aws_h1_window_stats aws_h1_connection_window_stats(struct aws_http_connec
     struct aws_h1_window_stats stats = {
         .connection_window = connection->thread_data.connection_window,
         .buffer_capacity = connection->thread_data.read_buffer.capacity,
+        .buffer_max_capacity = connection->thread_data.read_buffer.max_capacity,
         .buffer_pending_bytes = connection->thread_data.read_buffer.pending_bytes,
         .recent_window_increments = connection->thread_data.recent_window_increments,
         .has_incoming_stream = connection->thread_data.incoming_stream != NULL,
@@ -3,9 +3,12 @@
  * SPDX-License-Identifier: Apache-2.0.
  */
 
+#include <aws/common/math.h>
 #include <aws/common/string.h>
 #include <aws/http/private/h1_decoder.h>
+#include <aws/http/private/simd.h>
 #include <aws/http/private/strutil.h>
+#include <aws/http/private/tracing_impl.h>
 #include <aws/http/status_code.h>
 #include <aws/io/logging.h>
 
@@ -19,17 +22,33 @@ AWS_STATIC_STRING_FROM_LITERAL(s_transfer_coding_x_gzip, "x-gzip");
 /* Decoder runs a state machine.
  * Each state consumes data until it sets the next state.
  * A common state is the "line state", which handles consuming one line ending in CRLF
- * and feeding the line to a linestate_fn, which should process data and set the next state.
+ * and feeding the line to a linestate, which should process data and set the next state.
+ *
+ * States and linestates are enums, and aws_h1_decode() switches on them to run the matching function.
+ * Whether requests or responses are decoded only decides the linestate each message starts with.
  */
-typedef int(state_fn)(struct aws_h1_decoder *decoder, struct aws_byte_cursor *input);
-typedef int(linestate_fn)(struct aws_h1_decoder *decoder, struct aws_byte_cursor input);
+enum h1_decoder_state {
+    H1_DECODER_STATE_GETLINE,
+    H1_DECODER_STATE_UNCHUNKED_BODY,
+    H1_DECODER_STATE_CHUNK,
+};
+
+/* What to do with the line once H1_DECODER_STATE_GETLINE has it */
+enum h1_decoder_linestate {
+    H1_DECODER_LINESTATE_NONE,
+    H1_DECODER_LINESTATE_REQUEST,
+    H1_DECODER_LINESTATE_RESPONSE,
+    H1_DECODER_LINESTATE_HEADER,
+    H1_DECODER_LINESTATE_CHUNK_SIZE,
+    H1_DECODER_LINESTATE_CHUNK_TERMINATOR,
+};
 
 struct aws_h1_decoder {
     /* Implementation data. */
     struct aws_allocator *alloc;
     struct aws_byte_buf scratch_space;
-    state_fn *run_state;
-    linestate_fn *process_line;
+    enum h1_decoder_state state;
+    enum h1_decoder_linestate linestate;
     int transfer_encoding;
     uint64_t content_processed;
     uint64_t content_length;
@@ -37,6 +56,8 @@ struct aws_h1_decoder {
     uint64_t chunk_size;
     bool doing_trailers;
     bool is_done;
+    /* True while a line assembled in scratch_space is processed, rather than one still in the input */
+    bool is_line_in_scratch_space;
     bool body_headers_ignored;
     bool body_headers_forbidden;
     enum aws_http_header_block header_block;
@@ -44,52 +65,91 @@ struct aws_h1_decoder {
 
     /* User callbacks and settings. */
     struct aws_h1_decoder_vtable vtable;
-    bool is_decoding_requests;
+    /* H1_DECODER_LINESTATE_REQUEST or H1_DECODER_LINESTATE_RESPONSE, see aws_h1_decoder_params.is_decoding_requests */
+    enum h1_decoder_linestate start_linestate;
     void *user_data;
 };
 
-static int s_linestate_request(struct aws_h1_decoder *decoder, struct aws_byte_cursor input);
-static int s_linestate_response(struct aws_h1_decoder *decoder, struct aws_byte_cursor input);
-static int s_linestate_header(struct aws_h1_decoder *decoder, struct aws_byte_cursor input);
-static int s_linestate_chunk_size(struct aws_h1_decoder *decoder, struct aws_byte_cursor input);
+static int s_process_line(struct aws_h1_decoder *decoder, struct aws_byte_cursor line);
+
+/* Returns the index of the first "\n" that immediately follows a "\r", or len if there is none.
+ * prev_is_cr says whether the character before ptr[0] was "\r".
+ * Where the target has 128bit vectors, 16 bytes are checked at a time by building bitmasks
+ * of the "\r" and "\n" positions, then shifting the "\r" mask forward by one character. */
+static size_t s_find_crlf(const uint8_t *ptr, size_t len, bool prev_is_cr) {
+    size_t i = 0;
+
+#if defined(AWS_HTTP_SIMD_SSE2)
+    const __m128i cr_vec = _mm_set1_epi8('\r');
+    const __m128i lf_vec = _mm_set1_epi8('\n');
+    for (; len - i >= 16; i += 16) {
+        const __m128i chunk = _mm_loadu_si128((const __m128i *)(ptr + i));
+        const uint32_t lf_mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, lf_vec));
+        const uint32_t cr_mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, cr_vec));
+
+        /* One bit per character */
+        const uint32_t crlf_mask = lf_mask & ((cr_mask << 1) | (uint32_t)prev_is_cr);
+        if (crlf_mask) {
+            return i + aws_ctz_u32(crlf_mask);
+        }
+        prev_is_cr = (cr_mask >> 15) & 1;
+    }
+#elif defined(AWS_HTTP_SIMD_NEON)
+    const uint8x16_t cr_vec = vdupq_n_u8('\r');
+    const uint8x16_t lf_vec = vdupq_n_u8('\n');
+    for (; len - i >= 16; i += 16) {
+        const uint8x16_t chunk = vld1q_u8(ptr + i);
 
-static bool s_scan_for_crlf(struct aws_h1_decoder *decoder, struct aws_byte_cursor input, size_t *bytes_processed) {
-    AWS_ASSERT(input.len > 0);
+        const uint64_t lf_mask = aws_http_neon_nibble_mask(vceqq_u8(chunk, lf_vec));
+        const uint64_t cr_mask = aws_http_neon_nibble_mask(vceqq_u8(chunk, cr_vec));
+
+        /* Four bits per character */
+        const uint64_t crlf_mask = lf_mask & ((cr_mask << 4) | (prev_is_cr ? 0xF : 0));
+        if (crlf_mask) {
+            return i + (aws_ctz_u64(crlf_mask) >> 2);
+        }
+        prev_is_cr = (cr_mask >> 60) != 0;
+    }
+#endif
 
-    /* In a loop, scan for "\n", then look one char back for "\r" */
-    uint8_t *ptr = input.ptr;
-    uint8_t *end = input.ptr + input.len;
-    while (ptr != end) {
-        uint8_t *newline = (uint8_t *)memchr(ptr, '\n', end - ptr);
+    /* Whatever the vector loop didn't cover: scan for "\n" with memchr, then look one char back for "\r" */
+    while (i < len) {
+        const uint8_t *newline = (const uint8_t *)memchr(ptr + i, '\n', len - i);
         if (!newline) {
             break;
         }
 
-        uint8_t prev_char;
-        if (newline == input.ptr) {
-            /* If "\n" is first character check scratch_space for previous character */
-            if (decoder->scratch_space.len > 0) {
-                prev_char = decoder->scratch_space.buffer[decoder->scratch_space.len - 1];
-            } else {
-                prev_char = 0;
-            }
-        } else {
-            prev_char = *(newline - 1);
+        size_t newline_index = (size_t)(newline - ptr);
+        bool after_cr = (newline_index == i) ? prev_is_cr : (ptr[newline_index - 1] == '\r');
+        if (after_cr) {
+            return newline_index;
         }
 
-        if (prev_char == '\r') {
-            *bytes_processed = 1 + (newline - input.ptr);
-            return true;
-        }
+        i = newline_index + 1;
+        prev_is_cr = false;
+    }
+
+    return len;
+}
 
-        ptr = newline + 1;
+static bool s_scan_for_crlf(struct aws_h1_decoder *decoder, struct aws_byte_cursor input, size_t *bytes_processed) {
+    AWS_ASSERT(input.len > 0);
+
+    /* If "\n" is first character, the "\r" may be at the end of scratch_space */
+    bool prev_is_cr = decoder->scratch_space.len > 0 &&
+                      decoder->scratch_space.buffer[decoder->scratch_space.len - 1] == '\r';
+
+    size_t newline_index = s_find_crlf(input.ptr, input.len, prev_is_cr);
+    if (newline_index < input.len) {
+        *bytes_processed = 1 + newline_index;
+        return true;
     }
 
     *bytes_processed = input.len;
     return false;
 }
 
-/* This state consumes an entire line, then calls a linestate_fn to process the line. */
+/* This state consumes an entire line, then runs the current linestate on it. */
 static int s_state_getline(struct aws_h1_decoder *decoder, struct aws_byte_cursor *input) {
     /* If preceding runs of this state failed to find CRLF, their data is stored in the scratch_space
      * and new data needs to be combined with the old data for processing. */
@@ -123,7 +183,8 @@ static int s_state_getline(struct aws_h1_decoder *decoder, struct aws_byte_curso
         AWS_ASSERT(line.len >= 2);
         line.len -= 2;
 
-        return decoder->process_line(decoder, line);
+        decoder->is_line_in_scratch_space = use_scratch;
+        return s_process_line(decoder, line);
     }
 
     /* Didn't find crlf, we'll continue scanning when more data comes in */
@@ -179,16 +240,16 @@ static int s_cursor_split_exactly_n_times(
     return s_cursor_split_impl(input, split_on, cursor_array, num_cursors, true);
 }
 
-static void s_set_state(struct aws_h1_decoder *decoder, state_fn *state) {
+static void s_set_state(struct aws_h1_decoder *decoder, enum h1_decoder_state state) {
     decoder->scratch_space.len = 0;
-    decoder->run_state = state;
-    decoder->process_line = NULL;
+    decoder->state = state;
+    decoder->linestate = H1_DECODER_LINESTATE_NONE;
 }
 
-/* Set next state to capture a full line, then call the specified linestate_fn on it */
-static void s_set_line_state(struct aws_h1_decoder *decoder, linestate_fn *line_processor) {
-    s_set_state(decoder, s_state_getline);
-    decoder->process_line = line_processor;
+/* Set next state to capture a full line, then run the specified linestate on it */
+static void s_set_line_state(struct aws_h1_decoder *decoder, enum h1_decoder_linestate linestate) {
+    s_set_state(decoder, H1_DECODER_STATE_GETLINE);
+    decoder->linestate = linestate;
 }
 
 static int s_mark_done(struct aws_h1_decoder *decoder) {
@@ -199,11 +260,7 @@ static int s_mark_done(struct aws_h1_decoder *decoder) {
 
 /* Reset state, in preparation for processing a new message */
 static void s_reset_state(struct aws_h1_decoder *decoder) {
-    if (decoder->is_decoding_requests) {
-        s_set_line_state(decoder, s_linestate_request);
-    } else {
-        s_set_line_state(decoder, s_linestate_response);
-    }
+    s_set_line_state(decoder, decoder->start_linestate);
 
     decoder->transfer_encoding = 0;
     decoder->content_processed = 0;
@@ -258,7 +315,7 @@ static int s_linestate_chunk_terminator(struct aws_h1_decoder *decoder, struct a
         return aws_raise_error(AWS_ERROR_HTTP_PROTOCOL_ERROR);
     }
 
-    s_set_line_state(decoder, s_linestate_chunk_size);
+    s_set_line_state(decoder, H1_DECODER_LINESTATE_CHUNK_SIZE);
 
     return AWS_OP_SUCCESS;
 }
@@ -283,7 +340,7 @@ static int s_state_chunk(struct aws_h1_decoder *decoder, struct aws_byte_cursor
     }
 
     if (AWS_LIKELY(finished)) {
-        s_set_line_state(decoder, s_linestate_chunk_terminator);
+        s_set_line_state(decoder, H1_DECODER_LINESTATE_CHUNK_TERMINATOR);
     }
 
     return AWS_OP_SUCCESS;
@@ -329,14 +386,14 @@ static int s_linestate_chunk_size(struct aws_h1_decoder *decoder, struct aws_byt
 
         /* Expected empty newline and end of message. */
         decoder->doing_trailers = true;
-        s_set_line_state(decoder, s_linestate_header);
+        s_set_line_state(decoder, H1_DECODER_LINESTATE_HEADER);
         return AWS_OP_SUCCESS;
     }
 
     /* Skip all chunk extensions, as they are optional. */
     /* RFC-7230 section 4.1.1 Chunk Extensions */
 
-    s_set_state(decoder, s_state_chunk);
+    s_set_state(decoder, H1_DECODER_STATE_CHUNK);
 
     return AWS_OP_SUCCESS;
 }
@@ -349,15 +406,16 @@ static int s_linestate_header(struct aws_h1_decoder *decoder, struct aws_byte_cu
     /* RFC-7230 section 3 Message Format */
     if (input.len == 0) {
         if (AWS_LIKELY(!decoder->doing_trailers)) {
+            AWS_HTTP_TRACE(AWS_HTTP_TRACE_H1_HEAD_DECODED, decoder->logging_id, 0, 0);
             if (decoder->body_headers_ignored) {
                 err = s_mark_done(decoder);
                 if (err) {
                     return AWS_OP_ERR;
                 }
             } else if (decoder->transfer_encoding & AWS_HTTP_TRANSFER_ENCODING_CHUNKED) {
-                s_set_line_state(decoder, s_linestate_chunk_size);
+                s_set_line_state(decoder, H1_DECODER_LINESTATE_CHUNK_SIZE);
             } else if (decoder->content_length > 0) {
-                s_set_state(decoder, s_state_unchunked_body);
+                s_set_state(decoder, H1_DECODER_STATE_UNCHUNKED_BODY);
             } else {
                 err = s_mark_done(decoder);
                 if (err) {
@@ -408,6 +466,7 @@ static int s_linestate_header(struct aws_h1_decoder *decoder, struct aws_byte_cu
     header.name_data = name;
     header.value_data = value;
     header.data = input;
+    header.is_data_in_scratch_space = decoder->is_line_in_scratch_space;
 
     switch (header.name) {
         case AWS_HTTP_HEADER_CONTENT_LENGTH:
@@ -536,7 +595,7 @@ static int s_linestate_header(struct aws_h1_decoder *decoder, struct aws_byte_cu
         return AWS_OP_ERR;
     }
 
-    s_set_line_state(decoder, s_linestate_header);
+    s_set_line_state(decoder, H1_DECODER_LINESTATE_HEADER);
 
     return AWS_OP_SUCCESS;
 }
@@ -608,7 +667,7 @@ static int s_linestate_request(struct aws_h1_decoder *decoder, struct aws_byte_c
         return AWS_OP_ERR;
     }
 
-    s_set_line_state(decoder, s_linestate_header);
+    s_set_line_state(decoder, H1_DECODER_LINESTATE_HEADER);
 
     return AWS_OP_SUCCESS;
 }
@@ -681,10 +740,30 @@ static int s_linestate_response(struct aws_h1_decoder *decoder, struct aws_byte_
         return AWS_OP_ERR;
     }
 
-    s_set_line_state(decoder, s_linestate_header);
+    s_set_line_state(decoder, H1_DECODER_LINESTATE_HEADER);
     return AWS_OP_SUCCESS;
 }
 
+static int s_process_line(struct aws_h1_decoder *decoder, struct aws_byte_cursor line) {
+    switch (decoder->linestate) {
+        case H1_DECODER_LINESTATE_HEADER:
+            return s_linestate_header(decoder, line);
+        case H1_DECODER_LINESTATE_REQUEST:
+            return s_linestate_request(decoder, line);
+        case H1_DECODER_LINESTATE_RESPONSE:
+            return s_linestate_response(decoder, line);
+        case H1_DECODER_LINESTATE_CHUNK_SIZE:
+            return s_linestate_chunk_size(decoder, line);
+        case H1_DECODER_LINESTATE_CHUNK_TERMINATOR:
+            return s_linestate_chunk_terminator(decoder, line);
+        case H1_DECODER_LINESTATE_NONE:
+            break;
+    }
+
+    AWS_ASSERT(0 && "line without a linestate");
+    return aws_raise_error(AWS_ERROR_INVALID_STATE);
+}
+
 struct aws_h1_decoder *aws_h1_decoder_new(struct aws_h1_decoder_params *params) {
     AWS_ASSERT(params);
 
@@ -697,7 +776,8 @@ struct aws_h1_decoder *aws_h1_decoder_new(struct aws_h1_decoder_params *params)
     decoder->alloc = params->alloc;
     decoder->user_data = params->user_data;
     decoder->vtable = params->vtable;
-    decoder->is_decoding_requests = params->is_decoding_requests;
+    decoder->start_linestate =
+        params->is_decoding_requests ? H1_DECODER_LINESTATE_REQUEST : H1_DECODER_LINESTATE_RESPONSE;
 
     aws_byte_buf_init(&decoder->scratch_space, params->alloc, params->scratch_space_initial_size);
 
@@ -721,7 +801,22 @@ int aws_h1_decode(struct aws_h1_decoder *decoder, struct aws_byte_cursor *data)
     struct aws_byte_cursor backup = *data;
 
     while (data->len && !decoder->is_done) {
-        int err = decoder->run_state(decoder, data);
+        int err;
+        switch (decoder->state) {
+            case H1_DECODER_STATE_GETLINE:
+                err = s_state_getline(decoder, data);
+                break;
+            case H1_DECODER_STATE_UNCHUNKED_BODY:
+                err = s_state_unchunked_body(decoder, data);
+                break;
+            case H1_DECODER_STATE_CHUNK:
+                err = s_state_chunk(decoder, data);
+                break;
+            default:
+                AWS_ASSERT(0 && "invalid state");
+                err = aws_raise_error(AWS_ERROR_INVALID_STATE);
+                break;
+        }
         if (err) {
             /* Reset the data param to how we found it */
             *data = backup;
@@ -752,6 +847,21 @@ enum aws_http_header_block aws_h1_decoder_get_header_block(const struct aws_h1_d
     return decoder->header_block;
 }
 
+uint64_t aws_h1_decoder_get_body_bytes_until_boundary(const struct aws_h1_decoder *decoder) {
+    switch (decoder->state) {
+        case H1_DECODER_STATE_UNCHUNKED_BODY:
+            return decoder->content_length - decoder->content_processed;
+        case H1_DECODER_STATE_CHUNK:
+            return decoder->chunk_size - decoder->chunk_processed;
+        default:
+            return 0;
+    }
+}
+
+size_t aws_h1_decoder_get_scratch_capacity(const struct aws_h1_decoder *decoder) {
+    return decoder->scratch_space.capacity;
+}
+
 void aws_h1_decoder_set_logging_id(struct aws_h1_decoder *decoder, const void *id) {
     decoder->logging_id = id;
 }
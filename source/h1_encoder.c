@@ -2,8 +2,11 @@
  * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
  * SPDX-License-Identifier: Apache-2.0.
  */
+#include <aws/common/string.h>
+#include <aws/http/private/content_encoding_impl.h>
 #include <aws/http/private/h1_encoder.h>
 #include <aws/http/private/strutil.h>
+#include <aws/http/private/tracing_impl.h>
 #include <aws/http/status_code.h>
 #include <aws/io/logging.h>
 #include <aws/io/stream.h>
@@ -17,6 +20,40 @@
 #define MAX_ASCII_HEX_CHUNK_STR_SIZE (sizeof(uint64_t) * 2 + 1)
 #define CRLF_SIZE 2
 
+/* Chunks read from a body stream have a fixed-width chunk-size, so the line can be written after the data is read */
+#define STREAM_CHUNK_SIZE_DIGITS 8
+#define STREAM_CHUNK_LINE_SIZE (STREAM_CHUNK_SIZE_DIGITS + CRLF_SIZE)
+#define STREAM_CHUNK_MAX_DATA_SIZE UINT32_MAX
+
+/**
+ * Validate a header's name and value, and get its value without surrounding whitespace.
+ */
+static int s_validate_outgoing_header(const struct aws_http_header *header, struct aws_byte_cursor *out_field_value) {
+    /* Validate header field-name (RFC-7230 3.2): field-name = token */
+    if (!aws_strutil_is_http_token(header->name)) {
+        AWS_LOGF_ERROR(AWS_LS_HTTP_STREAM, "id=static: Header name is invalid");
+        return aws_raise_error(AWS_ERROR_HTTP_INVALID_HEADER_NAME);
+    }
+
+    /* Validate header field-value.
+     * The value itself isn't supposed to have whitespace on either side,
+     * but we'll trim it off before validation so we don't start needlessly
+     * failing requests that used to work before we added validation.
+     * This should be OK because field-value can be sent with any amount
+     * of whitespace around it, which the other side will just ignore (RFC-7230 3.2):
+     * header-field = field-name ":" OWS field-value OWS */
+    *out_field_value = aws_strutil_trim_http_whitespace(header->value);
+    if (!aws_strutil_is_http_field_value(*out_field_value)) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_STREAM,
+            "id=static: Header '" PRInSTR "' has invalid value",
+            AWS_BYTE_CURSOR_PRI(header->name));
+        return aws_raise_error(AWS_ERROR_HTTP_INVALID_HEADER_VALUE);
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
 /**
  * Scan headers to detect errors and determine anything we'll need to know later (ex: total length).
  */
@@ -37,26 +74,9 @@ static int s_scan_outgoing_headers(
         struct aws_http_header header;
         aws_http_message_get_header(message, &header, i);
 
-        /* Validate header field-name (RFC-7230 3.2): field-name = token */
-        if (!aws_strutil_is_http_token(header.name)) {
-            AWS_LOGF_ERROR(AWS_LS_HTTP_STREAM, "id=static: Header name is invalid");
-            return aws_raise_error(AWS_ERROR_HTTP_INVALID_HEADER_NAME);
-        }
-
-        /* Validate header field-value.
-         * The value itself isn't supposed to have whitespace on either side,
-         * but we'll trim it off before validation so we don't start needlessly
-         * failing requests that used to work before we added validation.
-         * This should be OK because field-value can be sent with any amount
-         * of whitespace around it, which the other side will just ignore (RFC-7230 3.2):
-         * header-field = field-name ":" OWS field-value OWS */
-        struct aws_byte_cursor field_value = aws_strutil_trim_http_whitespace(header.value);
-        if (!aws_strutil_is_http_field_value(field_value)) {
-            AWS_LOGF_ERROR(
-                AWS_LS_HTTP_STREAM,
-                "id=static: Header '" PRInSTR "' has invalid value",
-                AWS_BYTE_CURSOR_PRI(header.name));
-            return aws_raise_error(AWS_ERROR_HTTP_INVALID_HEADER_VALUE);
+        struct aws_byte_cursor field_value;
+        if (s_validate_outgoing_header(&header, &field_value)) {
+            return AWS_OP_ERR;
         }
 
         enum aws_http_header_name name_enum = aws_http_str_to_header_name(header.name);
@@ -66,6 +86,11 @@ static int s_scan_outgoing_headers(
                     encoder_message->has_connection_close_header = true;
                 }
             } break;
+            case AWS_HTTP_HEADER_EXPECT: {
+                if (aws_byte_cursor_eq_c_str_ignore_case(&field_value, "100-continue")) {
+                    encoder_message->has_expect_continue_header = true;
+                }
+            } break;
             case AWS_HTTP_HEADER_CONTENT_LENGTH: {
                 has_content_length_header = true;
                 if (aws_byte_cursor_utf8_parse_u64(field_value, &encoder_message->content_length)) {
@@ -127,7 +152,11 @@ static int s_scan_outgoing_headers(
         return aws_raise_error(AWS_ERROR_HTTP_INVALID_HEADER_VALUE);
     }
 
-    if (encoder_message->has_chunked_encoding_header && has_body_stream) {
+    /* A body stream whose encoded length isn't known is sent as chunks */
+    if (encoder_message->has_chunked_encoding_header && has_body_stream &&
+        aws_http_content_encoding_is_body_stream(aws_http_message_get_body_stream(message))) {
+        encoder_message->has_chunked_body_stream = true;
+    } else if (encoder_message->has_chunked_encoding_header && has_body_stream) {
         AWS_LOGF_ERROR(
             AWS_LS_HTTP_STREAM,
             "id=static: Both Transfer-Encoding chunked header and body stream is set. "
@@ -146,6 +175,7 @@ static int s_scan_outgoing_headers(
         /* Don't send body, no matter what the headers are */
         encoder_message->content_length = 0;
         encoder_message->has_chunked_encoding_header = false;
+        encoder_message->has_chunked_body_stream = false;
     }
 
     if (encoder_message->content_length > 0 && !has_body_stream) {
@@ -162,26 +192,9 @@ static int s_scan_outgoing_trailer(const struct aws_http_headers *headers, size_
     for (size_t i = 0; i < num_headers; i++) {
         struct aws_http_header header;
         aws_http_headers_get_index(headers, i, &header);
-        /* Validate header field-name (RFC-7230 3.2): field-name = token */
-        if (!aws_strutil_is_http_token(header.name)) {
-            AWS_LOGF_ERROR(AWS_LS_HTTP_STREAM, "id=static: Header name is invalid");
-            return aws_raise_error(AWS_ERROR_HTTP_INVALID_HEADER_NAME);
-        }
-
-        /* Validate header field-value.
-         * The value itself isn't supposed to have whitespace on either side,
-         * but we'll trim it off before validation so we don't start needlessly
-         * failing requests that used to work before we added validation.
-         * This should be OK because field-value can be sent with any amount
-         * of whitespace around it, which the other side will just ignore (RFC-7230 3.2):
-         * header-field = field-name ":" OWS field-value OWS */
-        struct aws_byte_cursor field_value = aws_strutil_trim_http_whitespace(header.value);
-        if (!aws_strutil_is_http_field_value(field_value)) {
-            AWS_LOGF_ERROR(
-                AWS_LS_HTTP_STREAM,
-                "id=static: Header '" PRInSTR "' has invalid value",
-                AWS_BYTE_CURSOR_PRI(header.name));
-            return aws_raise_error(AWS_ERROR_HTTP_INVALID_HEADER_VALUE);
+        struct aws_byte_cursor field_value;
+        if (s_validate_outgoing_header(&header, &field_value)) {
+            return AWS_OP_ERR;
         }
 
         enum aws_http_header_name name_enum = aws_http_str_to_header_name(header.name);
@@ -246,12 +259,111 @@ static void s_write_headers(struct aws_byte_buf *dst, const struct aws_http_head
     (void)wrote_all;
 }
 
+struct aws_http1_request_template *aws_http1_request_template_new(
+    struct aws_allocator *allocator,
+    const struct aws_http_message *request) {
+
+    AWS_PRECONDITION(allocator);
+    AWS_PRECONDITION(request);
+
+    struct aws_byte_cursor method;
+    if (aws_http_message_get_request_method(request, &method)) {
+        AWS_LOGF_ERROR(AWS_LS_HTTP_STREAM, "id=static: Request template method not set");
+        aws_raise_error(AWS_ERROR_HTTP_INVALID_METHOD);
+        return NULL;
+    }
+    /* RFC-7230 3.1.1: method = token */
+    if (!aws_strutil_is_http_token(method)) {
+        AWS_LOGF_ERROR(AWS_LS_HTTP_STREAM, "id=static: Request template method is invalid");
+        aws_raise_error(AWS_ERROR_HTTP_INVALID_METHOD);
+        return NULL;
+    }
+
+    struct aws_http1_request_template *request_template =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_http1_request_template));
+    request_template->allocator = allocator;
+
+    size_t header_lines_len = 0;
+    const size_t num_headers = aws_http_message_get_header_count(request);
+    for (size_t i = 0; i < num_headers; ++i) {
+        struct aws_http_header header;
+        aws_http_message_get_header(request, &header, i);
+
+        struct aws_byte_cursor field_value;
+        if (s_validate_outgoing_header(&header, &field_value)) {
+            goto error;
+        }
+
+        enum aws_http_header_name name_enum = aws_http_str_to_header_name(header.name);
+        if (name_enum == AWS_HTTP_HEADER_CONTENT_LENGTH || name_enum == AWS_HTTP_HEADER_TRANSFER_ENCODING) {
+            AWS_LOGF_ERROR(
+                AWS_LS_HTTP_STREAM,
+                "id=static: Header '" PRInSTR "' depends on the body, it cannot be in a request template",
+                AWS_BYTE_CURSOR_PRI(header.name));
+            aws_raise_error(AWS_ERROR_HTTP_INVALID_HEADER_FIELD);
+            goto error;
+        }
+        if (name_enum == AWS_HTTP_HEADER_CONNECTION && aws_byte_cursor_eq_c_str(&field_value, "close")) {
+            request_template->has_connection_close_header = true;
+        }
+        if (name_enum == AWS_HTTP_HEADER_EXPECT && aws_byte_cursor_eq_c_str_ignore_case(&field_value, "100-continue")) {
+            request_template->has_expect_continue_header = true;
+        }
+
+        /* header-line: "{name}: {value}\r\n" */
+        int err = 0;
+        err |= aws_add_size_checked(header.name.len, header_lines_len, &header_lines_len);
+        err |= aws_add_size_checked(header.value.len, header_lines_len, &header_lines_len);
+        err |= aws_add_size_checked(4, header_lines_len, &header_lines_len); /* ": " + "\r\n" */
+        if (err) {
+            goto error;
+        }
+    }
+
+    request_template->method = aws_string_new_from_cursor(allocator, &method);
+    if (!request_template->method) {
+        goto error;
+    }
+
+    if (aws_byte_buf_init(&request_template->header_lines, allocator, header_lines_len)) {
+        goto error;
+    }
+    s_write_headers(&request_template->header_lines, aws_http_message_get_const_headers(request));
+
+    return request_template;
+
+error:
+    aws_http1_request_template_destroy(request_template);
+    return NULL;
+}
+
+void aws_http1_request_template_destroy(struct aws_http1_request_template *request_template) {
+    if (!request_template) {
+        return;
+    }
+
+    aws_string_destroy(request_template->method);
+    aws_byte_buf_clean_up(&request_template->header_lines);
+    aws_mem_release(request_template->allocator, request_template);
+}
+
 int aws_h1_encoder_message_init_from_request(
     struct aws_h1_encoder_message *message,
     struct aws_allocator *allocator,
     const struct aws_http_message *request,
     struct aws_linked_list *pending_chunk_list) {
 
+    return aws_h1_encoder_message_init_from_request_template(
+        message, allocator, request, NULL /*request_template*/, pending_chunk_list);
+}
+
+int aws_h1_encoder_message_init_from_request_template(
+    struct aws_h1_encoder_message *message,
+    struct aws_allocator *allocator,
+    const struct aws_http_message *request,
+    const struct aws_http1_request_template *request_template,
+    struct aws_linked_list *pending_chunk_list) {
+
     AWS_PRECONDITION(aws_linked_list_is_valid(pending_chunk_list));
 
     AWS_ZERO_STRUCT(*message);
@@ -262,12 +374,21 @@ int aws_h1_encoder_message_init_from_request(
     struct aws_byte_cursor method;
     int err = aws_http_message_get_request_method(request, &method);
     if (err) {
-        AWS_LOGF_ERROR(AWS_LS_HTTP_STREAM, "id=static: Request method not set");
+        if (request_template == NULL) {
+            AWS_LOGF_ERROR(AWS_LS_HTTP_STREAM, "id=static: Request method not set");
+            aws_raise_error(AWS_ERROR_HTTP_INVALID_METHOD);
+            goto error;
+        }
+        /* Template's method was validated when the template was created */
+        method = aws_byte_cursor_from_string(request_template->method);
+
+    } else if (request_template != NULL && !aws_string_eq_byte_cursor(request_template->method, &method)) {
+        AWS_LOGF_ERROR(AWS_LS_HTTP_STREAM, "id=static: Request method does not match request template's method");
         aws_raise_error(AWS_ERROR_HTTP_INVALID_METHOD);
         goto error;
-    }
-    /* RFC-7230 3.1.1: method = token */
-    if (!aws_strutil_is_http_token(method)) {
+
+    } else if (!aws_strutil_is_http_token(method)) {
+        /* RFC-7230 3.1.1: method = token */
         AWS_LOGF_ERROR(AWS_LS_HTTP_STREAM, "id=static: Request method is invalid");
         aws_raise_error(AWS_ERROR_HTTP_INVALID_METHOD);
         goto error;
@@ -299,6 +420,14 @@ int aws_h1_encoder_message_init_from_request(
         goto error;
     }
 
+    /* Template headers were already validated, and can't include body headers, so only the length matters */
+    size_t template_lines_len = 0;
+    if (request_template != NULL) {
+        template_lines_len = request_template->header_lines.len;
+        message->has_connection_close_header |= request_template->has_connection_close_header;
+        message->has_expect_continue_header |= request_template->has_expect_continue_header;
+    }
+
     /* request-line: "{method} {uri} {version}\r\n" */
     size_t request_line_len = 4; /* 2 spaces + "\r\n" */
     err |= aws_add_size_checked(method.len, request_line_len, &request_line_len);
@@ -309,6 +438,7 @@ int aws_h1_encoder_message_init_from_request(
     size_t head_end_len = 2;
 
     size_t head_total_len = request_line_len;
+    err |= aws_add_size_checked(template_lines_len, head_total_len, &head_total_len);
     err |= aws_add_size_checked(header_lines_len, head_total_len, &head_total_len);
     err |= aws_add_size_checked(head_end_len, head_total_len, &head_total_len);
     if (err) {
@@ -329,6 +459,10 @@ int aws_h1_encoder_message_init_from_request(
     wrote_all &= aws_byte_buf_write_from_whole_cursor(&message->outgoing_head_buf, version);
     wrote_all &= s_write_crlf(&message->outgoing_head_buf);
 
+    if (request_template != NULL) {
+        wrote_all &= aws_byte_buf_write_from_whole_buffer(&message->outgoing_head_buf, request_template->header_lines);
+    }
+
     s_write_headers(&message->outgoing_head_buf, aws_http_message_get_const_headers(request));
 
     wrote_all &= s_write_crlf(&message->outgoing_head_buf);
@@ -431,6 +565,107 @@ error:
     return AWS_OP_ERR;
 }
 
+struct aws_http1_static_response *aws_http1_static_response_new(
+    struct aws_allocator *allocator,
+    const struct aws_http_message *response) {
+
+    AWS_PRECONDITION(allocator);
+    AWS_PRECONDITION(response);
+
+    struct aws_http1_static_response *static_response =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_http1_static_response));
+    static_response->allocator = allocator;
+
+    /* Validate and serialize the head the same way a regular response would be */
+    struct aws_linked_list unused_chunk_list;
+    aws_linked_list_init(&unused_chunk_list);
+    struct aws_h1_encoder_message encoder_message;
+    if (aws_h1_encoder_message_init_from_response(
+            &encoder_message, allocator, response, false /*body_headers_ignored*/, &unused_chunk_list)) {
+        goto error;
+    }
+
+    if (encoder_message.has_chunked_encoding_header) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_STREAM, "id=static: Static response body must have a Content-Length, not be sent in chunks");
+        aws_raise_error(AWS_ERROR_HTTP_INVALID_HEADER_FIELD);
+        goto error;
+    }
+
+    /* Static responses are small, the whole body must fit in memory */
+    size_t body_len = (size_t)aws_min_u64(encoder_message.content_length, SIZE_MAX);
+    size_t encoded_len;
+    if (body_len != encoder_message.content_length) {
+        aws_raise_error(AWS_ERROR_OVERFLOW_DETECTED);
+        goto error;
+    }
+    if (aws_add_size_checked(encoder_message.outgoing_head_buf.len, body_len, &encoded_len)) {
+        goto error;
+    }
+
+    /* Take the head buffer from the encoder message, and read the body in after it */
+    static_response->encoded = encoder_message.outgoing_head_buf;
+    AWS_ZERO_STRUCT(encoder_message.outgoing_head_buf);
+    static_response->head_len = static_response->encoded.len;
+    static_response->has_connection_close_header = encoder_message.has_connection_close_header;
+    if (aws_byte_buf_reserve(&static_response->encoded, encoded_len)) {
+        goto error;
+    }
+
+    while (static_response->encoded.len < encoded_len) {
+        if (aws_input_stream_read(encoder_message.body, &static_response->encoded)) {
+            goto error;
+        }
+        struct aws_stream_status status;
+        if (aws_input_stream_get_status(encoder_message.body, &status)) {
+            goto error;
+        }
+        if (status.is_end_of_stream) {
+            break;
+        }
+    }
+    if (static_response->encoded.len != encoded_len) {
+        AWS_LOGF_ERROR(AWS_LS_HTTP_STREAM, "id=static: Static response body length does not match Content-Length");
+        aws_raise_error(AWS_ERROR_HTTP_OUTGOING_STREAM_LENGTH_INCORRECT);
+        goto error;
+    }
+
+    aws_h1_encoder_message_clean_up(&encoder_message);
+    return static_response;
+
+error:
+    aws_h1_encoder_message_clean_up(&encoder_message);
+    aws_http1_static_response_destroy(static_response);
+    return NULL;
+}
+
+void aws_http1_static_response_destroy(struct aws_http1_static_response *static_response) {
+    if (!static_response) {
+        return;
+    }
+
+    aws_byte_buf_clean_up(&static_response->encoded);
+    aws_mem_release(static_response->allocator, static_response);
+}
+
+void aws_h1_encoder_message_init_from_static_response(
+    struct aws_h1_encoder_message *message,
+    const struct aws_http1_static_response *static_response,
+    bool body_ignored,
+    struct aws_linked_list *pending_chunk_list) {
+
+    AWS_PRECONDITION(aws_linked_list_is_valid(pending_chunk_list));
+
+    AWS_ZERO_STRUCT(*message);
+    message->pending_chunk_list = pending_chunk_list;
+    message->has_connection_close_header = static_response->has_connection_close_header;
+
+    /* The body was encoded along with the head, so the encoder sends it all as the "head".
+     * A buffer without an allocator is never freed by aws_byte_buf_clean_up() */
+    size_t len = body_ignored ? static_response->head_len : static_response->encoded.len;
+    message->outgoing_head_buf = aws_byte_buf_from_array(static_response->encoded.buffer, len);
+}
+
 void aws_h1_encoder_message_clean_up(struct aws_h1_encoder_message *message) {
     aws_input_stream_release(message->body);
     aws_byte_buf_clean_up(&message->outgoing_head_buf);
@@ -537,6 +772,15 @@ void aws_h1_trailer_destroy(struct aws_h1_trailer *trailer) {
     aws_mem_release(trailer->allocator, trailer);
 }
 
+/* Fill in a chunk whose memory and chunk-line storage are already allocated */
+static void s_chunk_init(struct aws_h1_chunk *chunk, const struct aws_http1_chunk_options *options) {
+    chunk->data = aws_input_stream_acquire(options->chunk_data);
+    chunk->data_size = options->chunk_data_size;
+    chunk->on_complete = options->on_complete;
+    chunk->user_data = options->user_data;
+    s_populate_chunk_line_buffer(&chunk->chunk_line, options);
+}
+
 struct aws_h1_chunk *aws_h1_chunk_new(struct aws_allocator *allocator, const struct aws_http1_chunk_options *options) {
     /* Allocate chunk along with storage for the chunk-line */
     struct aws_h1_chunk *chunk;
@@ -547,19 +791,104 @@ struct aws_h1_chunk *aws_h1_chunk_new(struct aws_allocator *allocator, const str
         return NULL;
     }
 
+    AWS_ZERO_STRUCT(*chunk);
     chunk->allocator = allocator;
-    chunk->data = aws_input_stream_acquire(options->chunk_data);
-    chunk->data_size = options->chunk_data_size;
-    chunk->on_complete = options->on_complete;
-    chunk->user_data = options->user_data;
     chunk->chunk_line = aws_byte_buf_from_empty_array(chunk_line_storage, chunk_line_size);
-    s_populate_chunk_line_buffer(&chunk->chunk_line, options);
+    s_chunk_init(chunk, options);
+    return chunk;
+}
+
+int aws_h1_chunk_pool_init(struct aws_h1_chunk_pool *pool, struct aws_allocator *allocator, size_t max_free_count) {
+    AWS_ZERO_STRUCT(*pool);
+    if (aws_mutex_init(&pool->lock)) {
+        return AWS_OP_ERR;
+    }
+    pool->allocator = allocator;
+    pool->max_free_count = max_free_count;
+    aws_linked_list_init(&pool->free_list);
+    return AWS_OP_SUCCESS;
+}
+
+void aws_h1_chunk_pool_clean_up(struct aws_h1_chunk_pool *pool) {
+    while (!aws_linked_list_empty(&pool->free_list)) {
+        struct aws_linked_list_node *node = aws_linked_list_pop_front(&pool->free_list);
+        struct aws_h1_chunk *chunk = AWS_CONTAINER_OF(node, struct aws_h1_chunk, node);
+        aws_mem_release(pool->allocator, chunk);
+    }
+    aws_mutex_clean_up(&pool->lock);
+    AWS_ZERO_STRUCT(*pool);
+}
+
+struct aws_h1_chunk *aws_h1_chunk_new_from_pool(
+    struct aws_h1_chunk_pool *pool,
+    const struct aws_http1_chunk_options *options) {
+
+    /* Chunks with a long chunk-line (lots of extensions) are rare, don't bother pooling them */
+    if (s_calculate_chunk_line_size(options) > AWS_H1_POOLED_CHUNK_LINE_SIZE) {
+        return aws_h1_chunk_new(pool->allocator, options);
+    }
+
+    struct aws_h1_chunk *chunk = NULL;
+
+    /* BEGIN CRITICAL SECTION */
+    aws_mutex_lock(&pool->lock);
+    if (!aws_linked_list_empty(&pool->free_list)) {
+        struct aws_linked_list_node *node = aws_linked_list_pop_back(&pool->free_list);
+        chunk = AWS_CONTAINER_OF(node, struct aws_h1_chunk, node);
+        pool->free_count--;
+    }
+    aws_mutex_unlock(&pool->lock);
+    /* END CRITICAL SECTION */
+
+    if (chunk) {
+        /* Reuse the chunk-line storage that was allocated along with the chunk */
+        chunk->chunk_line.len = 0;
+    } else {
+        void *chunk_line_storage;
+        if (!aws_mem_acquire_many(
+                pool->allocator,
+                2,
+                &chunk,
+                sizeof(struct aws_h1_chunk),
+                &chunk_line_storage,
+                AWS_H1_POOLED_CHUNK_LINE_SIZE)) {
+            return NULL;
+        }
+
+        AWS_ZERO_STRUCT(*chunk);
+        chunk->allocator = pool->allocator;
+        chunk->pool = pool;
+        chunk->chunk_line = aws_byte_buf_from_empty_array(chunk_line_storage, AWS_H1_POOLED_CHUNK_LINE_SIZE);
+    }
+
+    s_chunk_init(chunk, options);
     return chunk;
 }
 
 void aws_h1_chunk_destroy(struct aws_h1_chunk *chunk) {
     AWS_PRECONDITION(chunk);
     aws_input_stream_release(chunk->data);
+    chunk->data = NULL;
+
+    struct aws_h1_chunk_pool *pool = chunk->pool;
+    if (pool) {
+        bool returned_to_pool = false;
+
+        /* BEGIN CRITICAL SECTION */
+        aws_mutex_lock(&pool->lock);
+        if (pool->free_count < pool->max_free_count) {
+            aws_linked_list_push_back(&pool->free_list, &chunk->node);
+            pool->free_count++;
+            returned_to_pool = true;
+        }
+        aws_mutex_unlock(&pool->lock);
+        /* END CRITICAL SECTION */
+
+        if (returned_to_pool) {
+            return;
+        }
+    }
+
     aws_mem_release(chunk->allocator, chunk);
 }
 
@@ -727,13 +1056,34 @@ static int s_state_fn_head(struct aws_h1_encoder *encoder, struct aws_byte_buf *
         return AWS_OP_SUCCESS;
     }
 
+    AWS_HTTP_TRACE(AWS_HTTP_TRACE_H1_HEAD_ENCODED, encoder->current_stream, encoder->message->outgoing_head_buf.len, 0);
+
     /* Don't NEED to free this buffer now, but we don't need it anymore, so why not */
     aws_byte_buf_clean_up(&encoder->message->outgoing_head_buf);
 
+    return s_switch_state(encoder, AWS_H1_ENCODER_STATE_AWAIT_CONTINUE);
+}
+
+static bool s_message_has_body(const struct aws_h1_encoder_message *message) {
+    return (message->body && message->content_length) || message->has_chunked_encoding_header;
+}
+
+/* If the body is held, wait here for aws_h1_encoder_continue_body() or aws_h1_encoder_abandon_body() */
+static int s_state_fn_await_continue(struct aws_h1_encoder *encoder, struct aws_byte_buf *dst) {
+    (void)dst;
+
+    if (encoder->message->hold_body_until_continue && s_message_has_body(encoder->message)) {
+        /* Remain in this state */
+        return AWS_OP_SUCCESS;
+    }
+
     /* Pick next state */
     if (encoder->message->body && encoder->message->content_length) {
         return s_switch_state(encoder, AWS_H1_ENCODER_STATE_UNCHUNKED_BODY);
 
+    } else if (encoder->message->has_chunked_body_stream) {
+        return s_switch_state(encoder, AWS_H1_ENCODER_STATE_STREAM_CHUNK);
+
     } else if (encoder->message->has_chunked_encoding_header) {
         return s_switch_state(encoder, AWS_H1_ENCODER_STATE_CHUNK_NEXT);
 
@@ -742,10 +1092,50 @@ static int s_state_fn_head(struct aws_h1_encoder *encoder, struct aws_byte_buf *
     }
 }
 
+/* Like s_encode_stream(), but for a body from aws_http_body_segments_stream_new().
+ * Only copies segments that fit whole in dst.
+ * Larger segments are left for aws_h1_encoder_take_body_segment() to send without copying. */
+static int s_encode_body_segments(
+    struct aws_h1_encoder *encoder,
+    struct aws_byte_buf *dst,
+    struct aws_http_body_segments_stream *segments_stream,
+    bool *out_done) {
+
+    *out_done = false;
+
+    while (!*out_done) {
+        size_t next_len = aws_http_body_segments_stream_get_next_len(segments_stream);
+        if (next_len > dst->capacity - dst->len) {
+            /* Return success because we want to try again later */
+            return AWS_OP_SUCCESS;
+        }
+
+        if (next_len == 0) {
+            /* No segments left. Read anyway, so that a body shorter than Content-Length is noticed */
+            return s_encode_stream(encoder, dst, encoder->message->body, encoder->message->content_length, out_done);
+        }
+
+        struct aws_byte_buf segment_dst = aws_byte_buf_from_empty_array(dst->buffer + dst->len, next_len);
+        if (s_encode_stream(
+                encoder, &segment_dst, encoder->message->body, encoder->message->content_length, out_done)) {
+            return AWS_OP_ERR;
+        }
+        dst->len += segment_dst.len;
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
 /* Write out body (not using chunked encoding). */
 static int s_state_fn_unchunked_body(struct aws_h1_encoder *encoder, struct aws_byte_buf *dst) {
     bool done;
-    if (s_encode_stream(encoder, dst, encoder->message->body, encoder->message->content_length, &done)) {
+    struct aws_http_body_segments_stream *segments_stream =
+        aws_http_body_segments_stream_from_input_stream(encoder->message->body);
+    if (segments_stream) {
+        if (s_encode_body_segments(encoder, dst, segments_stream, &done)) {
+            return AWS_OP_ERR;
+        }
+    } else if (s_encode_stream(encoder, dst, encoder->message->body, encoder->message->content_length, &done)) {
         return AWS_OP_ERR;
     }
 
@@ -758,6 +1148,61 @@ static int s_state_fn_unchunked_body(struct aws_h1_encoder *encoder, struct aws_
     return s_switch_state(encoder, AWS_H1_ENCODER_STATE_DONE);
 }
 
+/* Read chunks from the body stream, writing each as "chunk-size CRLF chunk-data CRLF".
+ * Goes to the last-chunk when the stream ends. */
+static int s_state_fn_stream_chunk(struct aws_h1_encoder *encoder, struct aws_byte_buf *dst) {
+    while (dst->capacity - dst->len > STREAM_CHUNK_LINE_SIZE + CRLF_SIZE) {
+        /* Read the chunk-data first, into the space after the chunk line */
+        size_t space = dst->capacity - dst->len - STREAM_CHUNK_LINE_SIZE - CRLF_SIZE;
+        struct aws_byte_buf chunk_data = aws_byte_buf_from_empty_array(
+            dst->buffer + dst->len + STREAM_CHUNK_LINE_SIZE, aws_min_size(space, STREAM_CHUNK_MAX_DATA_SIZE));
+
+        ENCODER_LOG(TRACE, encoder, "Reading chunk from body stream.");
+        if (aws_input_stream_read(encoder->message->body, &chunk_data)) {
+            ENCODER_LOGF(
+                ERROR,
+                encoder,
+                "Failed to read body stream, error %d (%s)",
+                aws_last_error(),
+                aws_error_name(aws_last_error()));
+            return AWS_OP_ERR;
+        }
+
+        if (chunk_data.len == 0) {
+            struct aws_stream_status status;
+            if (aws_input_stream_get_status(encoder->message->body, &status)) {
+                ENCODER_LOGF(
+                    ERROR,
+                    encoder,
+                    "Failed to query body stream status, error %d (%s)",
+                    aws_last_error(),
+                    aws_error_name(aws_last_error()));
+                return AWS_OP_ERR;
+            }
+            if (status.is_end_of_stream) {
+                ENCODER_LOGF(TRACE, encoder, "Body stream complete, sent %" PRIu64 " bytes", encoder->progress_bytes);
+                return s_switch_state(encoder, AWS_H1_ENCODER_STATE_LAST_CHUNK);
+            }
+
+            /* Remain in this state until the stream has more data */
+            return AWS_OP_SUCCESS;
+        }
+
+        char chunk_line[STREAM_CHUNK_LINE_SIZE + 1];
+        snprintf(chunk_line, sizeof(chunk_line), "%08" PRIX32 "\r\n", (uint32_t)chunk_data.len);
+        memcpy(dst->buffer + dst->len, chunk_line, STREAM_CHUNK_LINE_SIZE);
+        dst->len += STREAM_CHUNK_LINE_SIZE + chunk_data.len;
+        s_write_crlf(dst);
+
+        encoder->chunk_count++;
+        encoder->progress_bytes += chunk_data.len;
+        ENCODER_LOGF(TRACE, encoder, "Sent chunk %zu with size %zu", encoder->chunk_count, chunk_data.len);
+    }
+
+    /* Remain in this state until there's more space to write into */
+    return AWS_OP_SUCCESS;
+}
+
 /* Select next chunk to work on.
  * Encoder is essentially "paused" here if no chunks are available. */
 static int s_state_fn_chunk_next(struct aws_h1_encoder *encoder, struct aws_byte_buf *dst) {
@@ -857,6 +1302,19 @@ static int s_state_fn_chunk_trailer(struct aws_h1_encoder *encoder, struct aws_b
     return s_switch_state(encoder, AWS_H1_ENCODER_STATE_DONE);
 }
 
+/* Write the last-chunk, with no trailer.
+ * Used when the body was abandoned before any chunks were sent, or a chunked body stream has ended */
+static int s_state_fn_last_chunk(struct aws_h1_encoder *encoder, struct aws_byte_buf *dst) {
+    struct aws_byte_buf last_chunk = aws_byte_buf_from_c_str("0\r\n\r\n");
+    bool done = s_encode_buf(encoder, dst, &last_chunk);
+    if (!done) {
+        /* Remain in this state until we're done writing out last-chunk */
+        return AWS_OP_SUCCESS;
+    }
+
+    return s_switch_state(encoder, AWS_H1_ENCODER_STATE_DONE);
+}
+
 /* Message is done, loop back to start of state machine */
 static int s_state_fn_done(struct aws_h1_encoder *encoder, struct aws_byte_buf *dst) {
     (void)dst;
@@ -874,12 +1332,15 @@ struct encoder_state_def {
 static struct encoder_state_def s_encoder_states[] = {
     [AWS_H1_ENCODER_STATE_INIT] = {.fn = s_state_fn_init, .name = "INIT"},
     [AWS_H1_ENCODER_STATE_HEAD] = {.fn = s_state_fn_head, .name = "HEAD"},
+    [AWS_H1_ENCODER_STATE_AWAIT_CONTINUE] = {.fn = s_state_fn_await_continue, .name = "AWAIT_CONTINUE"},
     [AWS_H1_ENCODER_STATE_UNCHUNKED_BODY] = {.fn = s_state_fn_unchunked_body, .name = "BODY"},
+    [AWS_H1_ENCODER_STATE_STREAM_CHUNK] = {.fn = s_state_fn_stream_chunk, .name = "STREAM_CHUNK"},
     [AWS_H1_ENCODER_STATE_CHUNK_NEXT] = {.fn = s_state_fn_chunk_next, .name = "CHUNK_NEXT"},
     [AWS_H1_ENCODER_STATE_CHUNK_LINE] = {.fn = s_state_fn_chunk_line, .name = "CHUNK_LINE"},
     [AWS_H1_ENCODER_STATE_CHUNK_BODY] = {.fn = s_state_fn_chunk_body, .name = "CHUNK_BODY"},
     [AWS_H1_ENCODER_STATE_CHUNK_END] = {.fn = s_state_fn_chunk_end, .name = "CHUNK_END"},
     [AWS_H1_ENCODER_STATE_CHUNK_TRAILER] = {.fn = s_state_fn_chunk_trailer, .name = "CHUNK_TRAILER"},
+    [AWS_H1_ENCODER_STATE_LAST_CHUNK] = {.fn = s_state_fn_last_chunk, .name = "LAST_CHUNK"},
     [AWS_H1_ENCODER_STATE_DONE] = {.fn = s_state_fn_done, .name = "DONE"},
 };
 
@@ -905,6 +1366,63 @@ int aws_h1_encoder_process(struct aws_h1_encoder *encoder, struct aws_byte_buf *
     return AWS_OP_SUCCESS;
 }
 
+int aws_h1_encoder_take_body_segment(
+    struct aws_h1_encoder *encoder,
+    struct aws_http_body_segment *out_segment,
+    bool *out_taken) {
+
+    AWS_PRECONDITION(encoder);
+    AWS_PRECONDITION(out_segment);
+    AWS_PRECONDITION(out_taken);
+
+    *out_taken = false;
+
+    if (!encoder->message || encoder->state != AWS_H1_ENCODER_STATE_UNCHUNKED_BODY) {
+        return AWS_OP_SUCCESS;
+    }
+
+    struct aws_http_body_segments_stream *segments_stream =
+        aws_http_body_segments_stream_from_input_stream(encoder->message->body);
+    if (!segments_stream) {
+        return AWS_OP_SUCCESS;
+    }
+
+    /* If there's nothing left, let aws_h1_encoder_process() deal with the end of the stream */
+    size_t next_len = aws_http_body_segments_stream_get_next_len(segments_stream);
+    if (next_len == 0) {
+        return AWS_OP_SUCCESS;
+    }
+
+    /* Check length before taking the segment, so it's still released with the stream if there's an error */
+    uint64_t progress_bytes;
+    if (aws_add_u64_checked(encoder->progress_bytes, next_len, &progress_bytes) ||
+        progress_bytes > encoder->message->content_length) {
+        ENCODER_LOGF(
+            ERROR, encoder, "Body stream has exceeded expected length: %" PRIu64, encoder->message->content_length);
+        return aws_raise_error(AWS_ERROR_HTTP_OUTGOING_STREAM_LENGTH_INCORRECT);
+    }
+
+    aws_http_body_segments_stream_take_next(segments_stream, out_segment);
+    *out_taken = true;
+    encoder->progress_bytes = progress_bytes;
+
+    ENCODER_LOGF(
+        TRACE,
+        encoder,
+        "Sending %zu bytes of body without copying, progress: %" PRIu64 "/%" PRIu64,
+        out_segment->data.len,
+        encoder->progress_bytes,
+        encoder->message->content_length);
+
+    if (encoder->progress_bytes == encoder->message->content_length) {
+        /* Message is done. There's no more data to encode, so finish up now rather than in the next process() call */
+        s_switch_state(encoder, AWS_H1_ENCODER_STATE_DONE);
+        s_state_fn_done(encoder, NULL);
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
 bool aws_h1_encoder_is_message_in_progress(const struct aws_h1_encoder *encoder) {
     return encoder->message;
 }
@@ -913,3 +1431,30 @@ bool aws_h1_encoder_is_waiting_for_chunks(const struct aws_h1_encoder *encoder)
     return encoder->state == AWS_H1_ENCODER_STATE_CHUNK_NEXT &&
            aws_linked_list_empty(encoder->message->pending_chunk_list);
 }
+
+bool aws_h1_encoder_is_waiting_for_continue(const struct aws_h1_encoder *encoder) {
+    return encoder->state == AWS_H1_ENCODER_STATE_AWAIT_CONTINUE && encoder->message->hold_body_until_continue &&
+           s_message_has_body(encoder->message);
+}
+
+void aws_h1_encoder_continue_body(struct aws_h1_encoder *encoder) {
+    if (encoder->message) {
+        encoder->message->hold_body_until_continue = false;
+    }
+}
+
+void aws_h1_encoder_abandon_body(struct aws_h1_encoder *encoder) {
+    AWS_PRECONDITION(aws_h1_encoder_is_waiting_for_continue(encoder));
+
+    encoder->message->hold_body_until_continue = false;
+
+    if (encoder->message->has_chunked_encoding_header) {
+        ENCODER_LOG(DEBUG, encoder, "Abandoning chunked body, ending it with the last-chunk.");
+        s_switch_state(encoder, AWS_H1_ENCODER_STATE_LAST_CHUNK);
+    } else {
+        ENCODER_LOG(DEBUG, encoder, "Abandoning body, message will be short of its Content-Length.");
+        /* There's no more data to encode, so finish up now rather than in the next process() call */
+        s_switch_state(encoder, AWS_H1_ENCODER_STATE_DONE);
+        s_state_fn_done(encoder, NULL);
+    }
+}
@@ -151,7 +151,7 @@ static int s_stream_write_chunk(struct aws_http_stream *stream_base, const struc
         return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
     }
 
-    struct aws_h1_chunk *chunk = aws_h1_chunk_new(stream_base->alloc, options);
+    struct aws_h1_chunk *chunk = aws_h1_chunk_new_from_pool(&s_get_h1_connection(stream)->chunk_pool, options);
     if (AWS_UNLIKELY(NULL == chunk)) {
         AWS_LOGF_ERROR(
             AWS_LS_HTTP_STREAM,
@@ -325,12 +325,17 @@ static int s_stream_add_trailer(struct aws_http_stream *stream_base, const struc
     return AWS_OP_SUCCESS;
 }
 
+static int s_stream_send_static_response(
+    struct aws_http_stream *stream_base,
+    const struct aws_http1_static_response *static_response);
+
 static const struct aws_http_stream_vtable s_stream_vtable = {
     .destroy = s_stream_destroy,
     .update_window = s_stream_update_window,
     .activate = aws_h1_stream_activate,
     .http1_write_chunk = s_stream_write_chunk,
     .http1_add_trailer = s_stream_add_trailer,
+    .http1_send_static_response = s_stream_send_static_response,
     .http2_reset_stream = NULL,
     .http2_get_received_error_code = NULL,
     .http2_get_sent_error_code = NULL,
@@ -367,6 +372,9 @@ static struct aws_h1_stream *s_stream_new_common(
     stream->base.metrics.receive_start_timestamp_ns = -1;
     stream->base.metrics.receive_end_timestamp_ns = -1;
     stream->base.metrics.receiving_duration_ns = -1;
+    stream->base.metrics.activate_timestamp_ns = -1;
+    stream->base.metrics.receive_headers_end_timestamp_ns = -1;
+    stream->base.metrics.connection_acquisition_wait_ns = -1;
 
     aws_channel_task_init(
         &stream->cross_thread_work_task, s_stream_cross_thread_work_task, stream, "http1_stream_cross_thread_work");
@@ -408,12 +416,14 @@ struct aws_h1_stream *aws_h1_stream_new_request(
     stream->base.client_data = &stream->base.client_or_server_data.client;
     stream->base.client_data->response_status = AWS_HTTP_STATUS_CODE_UNKNOWN;
     stream->base.on_metrics = options->on_metrics;
+    stream->base.on_incoming_body_lease = options->on_response_body_lease;
 
     /* Validate request and cache info that the encoder will eventually need */
-    if (aws_h1_encoder_message_init_from_request(
+    if (aws_h1_encoder_message_init_from_request_template(
             &stream->encoder_message,
             client_connection->alloc,
             options->request,
+            options->http1_request_template,
             &stream->thread_data.pending_chunk_list)) {
         goto error;
     }
@@ -424,7 +434,14 @@ struct aws_h1_stream *aws_h1_stream_new_request(
         stream->is_final_stream = true;
     }
 
-    stream->synced_data.using_chunked_encoding = stream->encoder_message.has_chunked_encoding_header;
+    /* Hold the body until the server responds to "Expect: 100-continue", if connection is configured to */
+    if (stream->encoder_message.has_expect_continue_header && s_get_h1_connection(stream)->expect_continue_timeout_ns) {
+        stream->encoder_message.hold_body_until_continue = true;
+    }
+
+    /* A chunked body read from the body stream doesn't use the chunk API */
+    stream->synced_data.using_chunked_encoding =
+        stream->encoder_message.has_chunked_encoding_header && !stream->encoder_message.has_chunked_body_stream;
 
     return stream;
 
@@ -463,24 +480,10 @@ struct aws_h1_stream *aws_h1_stream_new_request_handler(const struct aws_http_re
     return stream;
 }
 
-int aws_h1_stream_send_response(struct aws_h1_stream *stream, struct aws_http_message *response) {
+/* Move the encoder_message into the stream, and get the encoder going. Cleans up encoder_message on failure */
+static int s_stream_send_encoder_message(struct aws_h1_stream *stream, struct aws_h1_encoder_message *encoder_message) {
     struct aws_h1_connection *connection = s_get_h1_connection(stream);
     int error_code = 0;
-
-    /* Validate the response and cache info that encoder will eventually need.
-     * The encoder_message object will be moved into the stream later while holding the lock */
-    struct aws_h1_encoder_message encoder_message;
-    bool body_headers_ignored = stream->base.request_method == AWS_HTTP_METHOD_HEAD;
-    if (aws_h1_encoder_message_init_from_response(
-            &encoder_message,
-            stream->base.alloc,
-            response,
-            body_headers_ignored,
-            &stream->thread_data.pending_chunk_list)) {
-        error_code = aws_last_error();
-        goto error;
-    }
-
     bool should_schedule_task = false;
     { /* BEGIN CRITICAL SECTION */
         s_stream_lock_synced_data(stream);
@@ -491,8 +494,8 @@ int aws_h1_stream_send_response(struct aws_h1_stream *stream, struct aws_http_me
             error_code = AWS_ERROR_INVALID_STATE;
         } else {
             stream->synced_data.has_outgoing_response = true;
-            stream->encoder_message = encoder_message;
-            if (encoder_message.has_connection_close_header) {
+            stream->encoder_message = *encoder_message;
+            if (encoder_message->has_connection_close_header) {
                 /* This will be the last stream connection will process, new streams will be rejected */
                 stream->is_final_stream = true;
 
@@ -537,6 +540,53 @@ error:
         error_code,
         aws_error_name(error_code));
 
-    aws_h1_encoder_message_clean_up(&encoder_message);
+    aws_h1_encoder_message_clean_up(encoder_message);
     return aws_raise_error(error_code);
 }
+
+int aws_h1_stream_send_response(struct aws_h1_stream *stream, struct aws_http_message *response) {
+    /* Validate the response and cache info that encoder will eventually need.
+     * The encoder_message object will be moved into the stream later while holding the lock */
+    struct aws_h1_encoder_message encoder_message;
+    bool body_headers_ignored = stream->base.request_method == AWS_HTTP_METHOD_HEAD;
+    if (aws_h1_encoder_message_init_from_response(
+            &encoder_message,
+            stream->base.alloc,
+            response,
+            body_headers_ignored,
+            &stream->thread_data.pending_chunk_list)) {
+        int error_code = aws_last_error();
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_STREAM,
+            "id=%p: Sending response on the stream failed, error %d (%s)",
+            (void *)&stream->base,
+            error_code,
+            aws_error_name(error_code));
+        aws_h1_encoder_message_clean_up(&encoder_message);
+        return AWS_OP_ERR;
+    }
+
+    return s_stream_send_encoder_message(stream, &encoder_message);
+}
+
+static int s_stream_send_static_response(
+    struct aws_http_stream *stream_base,
+    const struct aws_http1_static_response *static_response) {
+    AWS_PRECONDITION(stream_base);
+    AWS_PRECONDITION(static_response);
+    struct aws_h1_stream *stream = AWS_CONTAINER_OF(stream_base, struct aws_h1_stream, base);
+
+    if (!stream_base->server_data) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_STREAM, "id=%p: Static response can only be sent by a request handler stream", (void *)stream);
+        return aws_raise_error(AWS_ERROR_INVALID_STATE);
+    }
+
+    /* Already validated and encoded, so this can't fail */
+    struct aws_h1_encoder_message encoder_message;
+    bool body_ignored = stream_base->request_method == AWS_HTTP_METHOD_HEAD;
+    aws_h1_encoder_message_init_from_static_response(
+        &encoder_message, static_response, body_ignored, &stream->thread_data.pending_chunk_list);
+
+    return s_stream_send_encoder_message(stream, &encoder_message);
+}
@@ -0,0 +1,155 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/private/h2_closed_streams.h>
+
+static size_t s_home_index(size_t capacity, uint32_t stream_id) {
+    /* ids from one endpoint are all odd or all even, so divide by 2 to use every slot */
+    return (size_t)(stream_id >> 1) & (capacity - 1);
+}
+
+int aws_h2_closed_streams_init(
+    struct aws_h2_closed_streams *closed_streams,
+    struct aws_allocator *alloc,
+    size_t capacity) {
+
+    AWS_PRECONDITION(closed_streams);
+    AWS_PRECONDITION(alloc);
+    AWS_PRECONDITION(capacity > 0);
+
+    AWS_ZERO_STRUCT(*closed_streams);
+    closed_streams->alloc = alloc;
+
+    /* Ring slots are stored in the index as uint32_t */
+    if (capacity > UINT32_MAX / 2) {
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+    }
+
+    size_t index_capacity = 1;
+    while (index_capacity < capacity * 2) {
+        index_capacity <<= 1;
+    }
+
+    closed_streams->ring = aws_mem_calloc(alloc, capacity, sizeof(struct aws_h2_closed_stream));
+    if (!closed_streams->ring) {
+        goto error;
+    }
+    closed_streams->ring_capacity = capacity;
+
+    closed_streams->index = aws_mem_calloc(alloc, index_capacity, sizeof(struct aws_h2_closed_streams_index_slot));
+    if (!closed_streams->index) {
+        goto error;
+    }
+    closed_streams->index_capacity = index_capacity;
+
+    return AWS_OP_SUCCESS;
+
+error:
+    aws_h2_closed_streams_clean_up(closed_streams);
+    return AWS_OP_ERR;
+}
+
+void aws_h2_closed_streams_clean_up(struct aws_h2_closed_streams *closed_streams) {
+    if (closed_streams->ring) {
+        aws_mem_release(closed_streams->alloc, closed_streams->ring);
+    }
+    if (closed_streams->index) {
+        aws_mem_release(closed_streams->alloc, closed_streams->index);
+    }
+    AWS_ZERO_STRUCT(*closed_streams);
+}
+
+/* Returns the index slot for this stream-id, or NULL if it's not in the index */
+static struct aws_h2_closed_streams_index_slot *s_index_find(
+    const struct aws_h2_closed_streams *closed_streams,
+    uint32_t stream_id) {
+
+    AWS_PRECONDITION(stream_id != 0);
+
+    size_t mask = closed_streams->index_capacity - 1;
+    size_t i = s_home_index(closed_streams->index_capacity, stream_id);
+    /* Index is never more than half full, so an empty slot always ends the probe */
+    while (closed_streams->index[i].stream_id != 0) {
+        if (closed_streams->index[i].stream_id == stream_id) {
+            return &closed_streams->index[i];
+        }
+        i = (i + 1) & mask;
+    }
+    return NULL;
+}
+
+/* Empty an index slot, shifting later entries in the probe chain back so none become unreachable */
+static void s_index_remove(
+    struct aws_h2_closed_streams *closed_streams,
+    struct aws_h2_closed_streams_index_slot *slot) {
+
+    struct aws_h2_closed_streams_index_slot *index = closed_streams->index;
+    size_t mask = closed_streams->index_capacity - 1;
+    size_t hole = (size_t)(slot - index);
+    size_t i = hole;
+
+    while (true) {
+        i = (i + 1) & mask;
+        if (index[i].stream_id == 0) {
+            break;
+        }
+
+        /* An entry can fill the hole only if the hole lies between its home slot and where it sits now */
+        size_t home = s_home_index(closed_streams->index_capacity, index[i].stream_id);
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            index[hole] = index[i];
+            hole = i;
+        }
+    }
+
+    index[hole].stream_id = 0;
+    index[hole].ring_slot = 0;
+    closed_streams->index_count--;
+}
+
+void aws_h2_closed_streams_add(
+    struct aws_h2_closed_streams *closed_streams,
+    uint32_t stream_id,
+    uint8_t closed_when) {
+
+    AWS_PRECONDITION(stream_id != 0);
+
+    struct aws_h2_closed_streams_index_slot *existing = s_index_find(closed_streams, stream_id);
+    if (existing) {
+        /* Drop the old record, so the ring never holds an id twice */
+        closed_streams->ring[existing->ring_slot].stream_id = 0;
+        s_index_remove(closed_streams, existing);
+    }
+
+    /* Evict whichever stream closed longest ago */
+    size_t ring_slot = closed_streams->next_ring_slot;
+    struct aws_h2_closed_stream *record = &closed_streams->ring[ring_slot];
+    if (record->stream_id != 0) {
+        struct aws_h2_closed_streams_index_slot *evicted = s_index_find(closed_streams, record->stream_id);
+        AWS_ASSERT(evicted && evicted->ring_slot == ring_slot);
+        s_index_remove(closed_streams, evicted);
+    }
+
+    record->stream_id = stream_id;
+    record->closed_when = closed_when;
+    closed_streams->next_ring_slot = (ring_slot + 1) % closed_streams->ring_capacity;
+
+    size_t mask = closed_streams->index_capacity - 1;
+    size_t i = s_home_index(closed_streams->index_capacity, stream_id);
+    while (closed_streams->index[i].stream_id != 0) {
+        i = (i + 1) & mask;
+    }
+    closed_streams->index[i].stream_id = stream_id;
+    closed_streams->index[i].ring_slot = (uint32_t)ring_slot;
+    closed_streams->index_count++;
+}
+
+const struct aws_h2_closed_stream *aws_h2_closed_streams_find(
+    const struct aws_h2_closed_streams *closed_streams,
+    uint32_t stream_id) {
+
+    const struct aws_h2_closed_streams_index_slot *slot = s_index_find(closed_streams, stream_id);
+    return slot ? &closed_streams->ring[slot->ring_slot] : NULL;
+}
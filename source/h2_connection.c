@@ -4,11 +4,13 @@
  */
 
 #include <aws/http/private/h2_connection.h>
+#include <aws/http/private/body_lease.h>
 #include <aws/http/private/h2_stream.h>
 
 #include <aws/http/private/h2_decoder.h>
 #include <aws/http/private/h2_stream.h>
 #include <aws/http/private/strutil.h>
+#include <aws/http/private/tracing_impl.h>
 
 #include <aws/common/clock.h>
 #include <aws/common/logging.h>
@@ -24,6 +26,9 @@
     AWS_LOGF_##level(AWS_LS_HTTP_CONNECTION, "id=%p: " text, (void *)(connection), __VA_ARGS__)
 #define CONNECTION_LOG(level, connection, text) CONNECTION_LOGF(level, connection, "%s", text)
 
+/* With adaptive SETTINGS_HEADER_TABLE_SIZE, number of header-blocks received between evaluations */
+static const uint32_t s_header_table_adaptive_evaluation_interval = 64;
+
 static int s_handler_process_read_message(
     struct aws_channel_handler *handler,
     struct aws_channel_slot *slot,
@@ -58,6 +63,8 @@ static void s_connection_stop_new_request(struct aws_http_connection *connection
 static bool s_connection_is_open(const struct aws_http_connection *connection_base);
 static bool s_connection_new_requests_allowed(const struct aws_http_connection *connection_base);
 static void s_connection_update_window(struct aws_http_connection *connection_base, uint32_t increment_size);
+static void s_connection_on_read_window_budget_available(struct aws_http_connection *connection_base);
+static void s_connection_on_body_leases_released(struct aws_http_connection *connection_base, size_t counted_bytes);
 static int s_connection_change_settings(
     struct aws_http_connection *connection_base,
     const struct aws_http2_setting *settings_array,
@@ -88,9 +95,15 @@ static void s_connection_get_local_settings(
 static void s_connection_get_remote_settings(
     const struct aws_http_connection *connection_base,
     struct aws_http2_setting out_settings[AWS_HTTP2_SETTINGS_COUNT]);
+static bool s_connection_get_local_enable_connect_protocol(const struct aws_http_connection *connection_base);
+static bool s_connection_get_remote_enable_connect_protocol(const struct aws_http_connection *connection_base);
+static int s_connection_get_rtt_estimate(
+    const struct aws_http_connection *connection_base,
+    struct aws_http2_rtt_estimate *out_estimate);
 
 static void s_cross_thread_work_task(struct aws_channel_task *task, void *arg, enum aws_task_status status);
 static void s_outgoing_frames_task(struct aws_channel_task *task, void *arg, enum aws_task_status status);
+static void s_outgoing_frames_retry_task(struct aws_channel_task *task, void *arg, enum aws_task_status status);
 static int s_encode_outgoing_frames_queue(struct aws_h2_connection *connection, struct aws_byte_buf *output);
 static int s_encode_data_from_outgoing_streams(struct aws_h2_connection *connection, struct aws_byte_buf *output);
 static int s_record_closed_stream(
@@ -119,6 +132,13 @@ static struct aws_h2err s_decoder_on_headers_i(
     enum aws_http_header_name name_enum,
     enum aws_http_header_block block_type,
     void *userdata);
+static struct aws_h2err s_decoder_on_headers_block(
+    uint32_t stream_id,
+    const struct aws_http_header *header_array,
+    const enum aws_http_header_name *name_enum_array,
+    size_t num_headers,
+    enum aws_http_header_block block_type,
+    void *userdata);
 static struct aws_h2err s_decoder_on_headers_end(
     uint32_t stream_id,
     bool malformed,
@@ -172,6 +192,8 @@ static struct aws_http_connection_vtable s_h2_connection_vtable = {
     .stop_new_requests = s_connection_stop_new_request,
     .is_open = s_connection_is_open,
     .new_requests_allowed = s_connection_new_requests_allowed,
+    .on_read_window_budget_available = s_connection_on_read_window_budget_available,
+    .on_body_leases_released = s_connection_on_body_leases_released,
     .update_window = s_connection_update_window,
     .change_settings = s_connection_change_settings,
     .send_ping = s_connection_send_ping,
@@ -180,11 +202,15 @@ static struct aws_http_connection_vtable s_h2_connection_vtable = {
     .get_received_goaway = s_connection_get_received_goaway,
     .get_local_settings = s_connection_get_local_settings,
     .get_remote_settings = s_connection_get_remote_settings,
+    .get_local_enable_connect_protocol = s_connection_get_local_enable_connect_protocol,
+    .get_remote_enable_connect_protocol = s_connection_get_remote_enable_connect_protocol,
+    .get_rtt_estimate = s_connection_get_rtt_estimate,
 };
 
 static const struct aws_h2_decoder_vtable s_h2_decoder_vtable = {
     .on_headers_begin = s_decoder_on_headers_begin,
     .on_headers_i = s_decoder_on_headers_i,
+    .on_headers_block = s_decoder_on_headers_block,
     .on_headers_end = s_decoder_on_headers_end,
     .on_push_promise_begin = s_decoder_on_push_promise,
     .on_data_begin = s_decoder_on_data_begin,
@@ -211,20 +237,28 @@ static void s_unlock_synced_data(struct aws_h2_connection *connection) {
     (void)err;
 }
 
-static void s_acquire_stream_and_connection_lock(struct aws_h2_stream *stream, struct aws_h2_connection *connection) {
+static void s_lock_stream_synced_data(struct aws_h2_stream *stream) {
     int err = aws_mutex_lock(&stream->synced_data.lock);
-    err |= aws_mutex_lock(&connection->synced_data.lock);
-    AWS_ASSERT(!err && "lock connection and stream failed");
+    AWS_ASSERT(!err && "lock stream failed");
     (void)err;
 }
 
-static void s_release_stream_and_connection_lock(struct aws_h2_stream *stream, struct aws_h2_connection *connection) {
-    int err = aws_mutex_unlock(&connection->synced_data.lock);
-    err |= aws_mutex_unlock(&stream->synced_data.lock);
-    AWS_ASSERT(!err && "unlock connection and stream failed");
+static void s_unlock_stream_synced_data(struct aws_h2_stream *stream) {
+    int err = aws_mutex_unlock(&stream->synced_data.lock);
+    AWS_ASSERT(!err && "unlock stream failed");
     (void)err;
 }
 
+/* Schedule cross_thread_work_task, unless it's already scheduled. May be called from any thread */
+static void s_schedule_cross_thread_work(struct aws_h2_connection *connection) {
+    if (aws_atomic_exchange_int(&connection->synced_data.is_cross_thread_work_task_scheduled, true)) {
+        return;
+    }
+
+    CONNECTION_LOG(TRACE, connection, "Scheduling cross-thread work task");
+    aws_channel_schedule_task_now(connection->base.channel_slot->channel, &connection->cross_thread_work_task);
+}
+
 static void s_add_time_measurement_to_stats(uint64_t start_ns, uint64_t end_ns, uint64_t *output_ms) {
     if (end_ns > start_ns) {
         *output_ms += aws_timestamp_convert(end_ns - start_ns, AWS_TIMESTAMP_NANOS, AWS_TIMESTAMP_MILLIS, NULL);
@@ -233,6 +267,43 @@ static void s_add_time_measurement_to_stats(uint64_t start_ns, uint64_t end_ns,
     }
 }
 
+static void s_connection_window_stall_begin(struct aws_h2_connection *connection) {
+    if (!connection->thread_data.is_connection_window_stalled) {
+        aws_channel_current_clock_time(
+            connection->base.channel_slot->channel, &connection->thread_data.connection_window_stall_began_ns);
+        connection->thread_data.connection_window_stall_timestamp_ns =
+            connection->thread_data.connection_window_stall_began_ns;
+        connection->thread_data.is_connection_window_stalled = true;
+        AWS_HTTP_TRACE(AWS_HTTP_TRACE_WINDOW_STALL_BEGIN, connection, 0, 0);
+    }
+}
+
+static void s_connection_window_stall_end(struct aws_h2_connection *connection) {
+    if (connection->thread_data.is_connection_window_stalled) {
+        uint64_t now_ns = 0;
+        aws_channel_current_clock_time(connection->base.channel_slot->channel, &now_ns);
+        s_add_time_measurement_to_stats(
+            connection->thread_data.connection_window_stall_timestamp_ns,
+            now_ns,
+            &connection->thread_data.stats.connection_window_stalled_ms);
+        connection->thread_data.is_connection_window_stalled = false;
+        AWS_HTTP_TRACE(AWS_HTTP_TRACE_WINDOW_STALL_END, connection, 0, 0);
+    }
+}
+
+static void s_stream_window_stall_end(struct aws_h2_connection *connection, struct aws_h2_stream *stream) {
+    if (stream->thread_data.window_stall_timestamp_ns != 0) {
+        uint64_t now_ns = 0;
+        aws_channel_current_clock_time(connection->base.channel_slot->channel, &now_ns);
+        s_add_time_measurement_to_stats(
+            stream->thread_data.window_stall_timestamp_ns,
+            now_ns,
+            &connection->thread_data.stats.stream_window_stalled_ms);
+        stream->thread_data.window_stall_timestamp_ns = 0;
+        AWS_HTTP_TRACE(AWS_HTTP_TRACE_WINDOW_STALL_END, connection, stream->base.id, 0);
+    }
+}
+
 /**
  * Internal function for bringing connection to a stop.
  * Invoked multiple times, including when:
@@ -264,7 +335,7 @@ static void s_stop(
      * we don't consider the connection "open" anymore so user can't create more streams */
     { /* BEGIN CRITICAL SECTION */
         s_lock_synced_data(connection);
-        connection->synced_data.new_stream_error_code = AWS_ERROR_HTTP_CONNECTION_CLOSED;
+        aws_atomic_store_int(&connection->synced_data.new_stream_error_code, AWS_ERROR_HTTP_CONNECTION_CLOSED);
         connection->synced_data.is_open = false;
         s_unlock_synced_data(connection);
     } /* END CRITICAL SECTION */
@@ -307,6 +378,10 @@ static struct aws_h2_connection *s_connection_new(
     if (!connection) {
         return NULL;
     }
+    if (aws_h2_frame_pool_init(&connection->frame_pool, alloc)) {
+        aws_mem_release(alloc, connection);
+        return NULL;
+    }
     connection->base.vtable = &s_h2_connection_vtable;
     connection->base.alloc = alloc;
     connection->base.channel_handler.vtable = &s_h2_connection_vtable.channel_handler_vtable;
@@ -314,12 +389,46 @@ static struct aws_h2_connection *s_connection_new(
     connection->base.channel_handler.impl = connection;
     connection->base.http_version = AWS_HTTP_VERSION_2;
     /* Init the next stream id (server must use even ids, client odd [RFC 7540 5.1.1])*/
-    connection->base.next_stream_id = (server ? 2 : 1);
+    aws_atomic_init_int(&connection->synced_data.next_stream_id, server ? 2 : 1);
+    connection->thread_data.next_pending_stream_id = (server ? 2 : 1);
     /* Stream window management */
     connection->base.stream_manual_window_management = manual_window_management;
 
     /* Connection window management */
     connection->conn_manual_window_management = http2_options->conn_manual_window_management;
+    connection->write_coalescing_delay_ns = aws_timestamp_convert(
+        http2_options->write_coalescing_delay_us, AWS_TIMESTAMP_MICROS, AWS_TIMESTAMP_NANOS, NULL);
+    connection->max_write_messages_in_flight =
+        http2_options->max_write_messages_in_flight > 0 ? http2_options->max_write_messages_in_flight : 1;
+
+    /* Stream window auto-tuning only makes sense if we're the ones updating stream windows */
+    if (http2_options->stream_window_auto_tuning_max_size && !manual_window_management) {
+        connection->stream_window_auto_tuning_max_size =
+            aws_min_u32(http2_options->stream_window_auto_tuning_max_size, AWS_H2_WINDOW_UPDATE_MAX);
+    }
+
+    if (http2_options->header_table_adaptive_max_size) {
+        connection->header_table_adaptive.max_size = http2_options->header_table_adaptive_max_size;
+        connection->header_table_adaptive.min_size = aws_min_u32(
+            http2_options->header_table_adaptive_min_size, http2_options->header_table_adaptive_max_size);
+        connection->thread_data.header_table_adaptive.header_blocks_until_evaluation =
+            s_header_table_adaptive_evaluation_interval;
+
+        /* Don't bring back a table the user turned off */
+        for (size_t i = 0; i < http2_options->num_initial_settings; ++i) {
+            if (http2_options->initial_settings_array[i].id == AWS_HTTP2_SETTINGS_HEADER_TABLE_SIZE &&
+                http2_options->initial_settings_array[i].value == 0) {
+                connection->header_table_adaptive.max_size = 0;
+            }
+        }
+    }
+    if (http2_options->bulk_data_max_frame_size) {
+        connection->bulk_data_max_frame_size = aws_min_u32(
+            aws_max_u32(
+                http2_options->bulk_data_max_frame_size,
+                aws_h2_settings_bounds[AWS_HTTP2_SETTINGS_MAX_FRAME_SIZE][0]),
+            aws_h2_settings_bounds[AWS_HTTP2_SETTINGS_MAX_FRAME_SIZE][1]);
+    }
     connection->on_goaway_received = http2_options->on_goaway_received;
     connection->on_remote_settings_change = http2_options->on_remote_settings_change;
 
@@ -328,20 +437,31 @@ static struct aws_h2_connection *s_connection_new(
 
     aws_channel_task_init(
         &connection->outgoing_frames_task, s_outgoing_frames_task, connection, "HTTP/2 outgoing frames");
+    aws_channel_task_init(
+        &connection->outgoing_frames_retry_task,
+        s_outgoing_frames_retry_task,
+        connection,
+        "HTTP/2 outgoing frames retry");
 
     /* 1 refcount for user */
     aws_atomic_init_int(&connection->base.refcount, 1);
+    aws_http_connection_atomic_memory_usage_init(&connection->base.memory_usage);
     uint32_t max_stream_id = AWS_H2_STREAM_ID_MAX;
     connection->synced_data.goaway_sent_last_stream_id = max_stream_id + 1;
     connection->synced_data.goaway_received_last_stream_id = max_stream_id + 1;
 
-    aws_linked_list_init(&connection->synced_data.pending_stream_list);
+    aws_http_mpsc_queue_init(&connection->synced_data.pending_stream_queue);
+    aws_atomic_init_int(&connection->synced_data.is_cross_thread_work_task_scheduled, false);
+    aws_atomic_init_int(&connection->synced_data.window_update_size, 0);
     aws_linked_list_init(&connection->synced_data.pending_frame_list);
     aws_linked_list_init(&connection->synced_data.pending_settings_list);
     aws_linked_list_init(&connection->synced_data.pending_ping_list);
     aws_linked_list_init(&connection->synced_data.pending_goaway_list);
 
-    aws_linked_list_init(&connection->thread_data.outgoing_streams_list);
+    aws_linked_list_init(&connection->thread_data.pending_stream_list);
+    for (size_t i = 0; i < AWS_H2_PRIORITY_BUCKET_COUNT; ++i) {
+        aws_linked_list_init(&connection->thread_data.outgoing_streams_buckets[i]);
+    }
     aws_linked_list_init(&connection->thread_data.pending_settings_queue);
     aws_linked_list_init(&connection->thread_data.pending_ping_queue);
     aws_linked_list_init(&connection->thread_data.stalled_window_streams_list);
@@ -354,11 +474,10 @@ static struct aws_h2_connection *s_connection_new(
         goto error;
     }
 
-    if (aws_hash_table_init(
-            &connection->thread_data.active_streams_map, alloc, 8, aws_hash_ptr, aws_ptr_eq, NULL, NULL)) {
+    if (aws_h2_stream_table_init(&connection->thread_data.active_streams, alloc, 8)) {
 
         CONNECTION_LOGF(
-            ERROR, connection, "Hashtable init error %d (%s).", aws_last_error(), aws_error_name(aws_last_error()));
+            ERROR, connection, "Stream table init error %d (%s).", aws_last_error(), aws_error_name(aws_last_error()));
         goto error;
     }
     size_t max_closed_streams = AWS_HTTP2_DEFAULT_MAX_CLOSED_STREAMS;
@@ -366,11 +485,13 @@ static struct aws_h2_connection *s_connection_new(
         max_closed_streams = http2_options->max_closed_streams;
     }
 
-    connection->thread_data.closed_streams =
-        aws_cache_new_fifo(alloc, aws_hash_ptr, aws_ptr_eq, NULL, NULL, max_closed_streams);
-    if (!connection->thread_data.closed_streams) {
+    if (aws_h2_closed_streams_init(&connection->thread_data.closed_streams, alloc, max_closed_streams)) {
         CONNECTION_LOGF(
-            ERROR, connection, "FIFO cache init error %d (%s).", aws_last_error(), aws_error_name(aws_last_error()));
+            ERROR,
+            connection,
+            "Closed streams init error %d (%s).",
+            aws_last_error(),
+            aws_error_name(aws_last_error()));
         goto error;
     }
 
@@ -391,7 +512,7 @@ static struct aws_h2_connection *s_connection_new(
     connection->thread_data.stats.was_inactive = true; /* Start with non active streams */
 
     connection->synced_data.is_open = true;
-    connection->synced_data.new_stream_error_code = AWS_ERROR_SUCCESS;
+    aws_atomic_init_int(&connection->synced_data.new_stream_error_code, AWS_ERROR_SUCCESS);
 
     /* Create a new decoder */
     struct aws_h2_decoder_params params = {
@@ -400,6 +521,8 @@ static struct aws_h2_connection *s_connection_new(
         .userdata = connection,
         .logging_id = connection,
         .is_server = server,
+        .collect_header_blocks = http2_options->deliver_whole_header_blocks,
+        .stats = &connection->thread_data.stats,
     };
     connection->thread_data.decoder = aws_h2_decoder_new(&params);
     if (!connection->thread_data.decoder) {
@@ -413,13 +536,57 @@ static struct aws_h2_connection *s_connection_new(
             ERROR, connection, "Encoder init error %d (%s)", aws_last_error(), aws_error_name(aws_last_error()));
         goto error;
     }
+    connection->thread_data.encoder.stats = &connection->thread_data.stats;
+    if (http2_options->header_template) {
+        if (aws_hpack_encoder_set_header_template(
+                &connection->thread_data.encoder.hpack, http2_options->header_template)) {
+            CONNECTION_LOGF(
+                ERROR,
+                connection,
+                "Header template error %d (%s)",
+                aws_last_error(),
+                aws_error_name(aws_last_error()));
+            goto error;
+        }
+    }
+    aws_hpack_encoder_set_indexing_policy(&connection->thread_data.encoder.hpack, http2_options->hpack_indexing_policy);
+    /* Let the peer send large DATA frames too, unless the user picked the MAX_FRAME_SIZE themselves */
+    const struct aws_http2_setting *initial_settings_array = http2_options->initial_settings_array;
+    size_t num_initial_settings = http2_options->num_initial_settings;
+    struct aws_http2_setting *settings_with_max_frame_size = NULL;
+    if (connection->bulk_data_max_frame_size) {
+        bool has_max_frame_size = false;
+        for (size_t i = 0; i < num_initial_settings; ++i) {
+            if (initial_settings_array[i].id == AWS_HTTP2_SETTINGS_MAX_FRAME_SIZE) {
+                has_max_frame_size = true;
+            }
+        }
+        if (!has_max_frame_size) {
+            settings_with_max_frame_size =
+                aws_mem_calloc(alloc, num_initial_settings + 1, sizeof(struct aws_http2_setting));
+            if (num_initial_settings > 0) {
+                memcpy(
+                    settings_with_max_frame_size,
+                    initial_settings_array,
+                    num_initial_settings * sizeof(struct aws_http2_setting));
+            }
+            settings_with_max_frame_size[num_initial_settings].id = AWS_HTTP2_SETTINGS_MAX_FRAME_SIZE;
+            settings_with_max_frame_size[num_initial_settings].value = connection->bulk_data_max_frame_size;
+            initial_settings_array = settings_with_max_frame_size;
+            ++num_initial_settings;
+        }
+    }
+
     /* User data from connection base is not ready until the handler installed */
     connection->thread_data.init_pending_settings = s_new_pending_settings(
         connection->base.alloc,
-        http2_options->initial_settings_array,
-        http2_options->num_initial_settings,
+        initial_settings_array,
+        num_initial_settings,
         http2_options->on_initial_settings_completed,
         NULL /* user_data is set later... */);
+    if (settings_with_max_frame_size) {
+        aws_mem_release(alloc, settings_with_max_frame_size);
+    }
     if (!connection->thread_data.init_pending_settings) {
         goto error;
     }
@@ -467,14 +634,15 @@ static void s_handler_destroy(struct aws_channel_handler *handler) {
     CONNECTION_LOG(TRACE, connection, "Destroying connection");
 
     /* No streams should be left in internal datastructures */
-    AWS_ASSERT(
-        !aws_hash_table_is_valid(&connection->thread_data.active_streams_map) ||
-        aws_hash_table_get_entry_count(&connection->thread_data.active_streams_map) == 0);
+    AWS_ASSERT(aws_h2_stream_table_get_count(&connection->thread_data.active_streams) == 0);
 
     AWS_ASSERT(aws_linked_list_empty(&connection->thread_data.waiting_streams_list));
     AWS_ASSERT(aws_linked_list_empty(&connection->thread_data.stalled_window_streams_list));
-    AWS_ASSERT(aws_linked_list_empty(&connection->thread_data.outgoing_streams_list));
-    AWS_ASSERT(aws_linked_list_empty(&connection->synced_data.pending_stream_list));
+    for (size_t i = 0; i < AWS_H2_PRIORITY_BUCKET_COUNT; ++i) {
+        AWS_ASSERT(aws_linked_list_empty(&connection->thread_data.outgoing_streams_buckets[i]));
+    }
+    AWS_ASSERT(aws_linked_list_empty(&connection->thread_data.pending_stream_list));
+    AWS_ASSERT(aws_http_mpsc_queue_is_empty(&connection->synced_data.pending_stream_queue));
     AWS_ASSERT(aws_linked_list_empty(&connection->synced_data.pending_frame_list));
     AWS_ASSERT(aws_linked_list_empty(&connection->synced_data.pending_settings_list));
     AWS_ASSERT(aws_linked_list_empty(&connection->synced_data.pending_ping_list));
@@ -487,6 +655,7 @@ static void s_handler_destroy(struct aws_channel_handler *handler) {
     while (!aws_linked_list_empty(outgoing_frames_queue)) {
         struct aws_linked_list_node *node = aws_linked_list_pop_front(outgoing_frames_queue);
         struct aws_h2_frame *frame = AWS_CONTAINER_OF(node, struct aws_h2_frame, node);
+        connection->thread_data.outgoing_frames_queue_bytes -= frame->memory_size;
         aws_h2_frame_destroy(frame);
     }
     if (connection->thread_data.init_pending_settings) {
@@ -495,9 +664,12 @@ static void s_handler_destroy(struct aws_channel_handler *handler) {
     }
     aws_h2_decoder_destroy(connection->thread_data.decoder);
     aws_h2_frame_encoder_clean_up(&connection->thread_data.encoder);
-    aws_hash_table_clean_up(&connection->thread_data.active_streams_map);
-    aws_cache_destroy(connection->thread_data.closed_streams);
+    aws_h2_stream_table_clean_up(&connection->thread_data.active_streams);
+    aws_http_connection_memory_usage_clean_up(&connection->base);
+    aws_h2_closed_streams_clean_up(&connection->thread_data.closed_streams);
     aws_mutex_clean_up(&connection->synced_data.lock);
+    /* Must come after anything that may have been allocated from the pool */
+    aws_h2_frame_pool_clean_up(&connection->frame_pool);
     aws_mem_release(connection->base.alloc, connection);
 }
 
@@ -528,6 +700,8 @@ static struct aws_h2_pending_settings *s_new_pending_settings(
         memcpy(pending_settings->settings_array, settings_array, num_settings * sizeof(struct aws_http2_setting));
     }
     pending_settings->num_settings = num_settings;
+    /* If the clock fails, this SETTINGS just won't be used for the round-trip time estimate */
+    aws_high_res_clock_get_ticks(&pending_settings->started_time);
     pending_settings->on_completed = on_completed;
     pending_settings->user_data = user_data;
 
@@ -604,6 +778,15 @@ void aws_h2_connection_enqueue_outgoing_frame(struct aws_h2_connection *connecti
     } else {
         aws_linked_list_push_back(&connection->thread_data.outgoing_frames_queue, &frame->node);
     }
+    connection->thread_data.outgoing_frames_queue_bytes += frame->memory_size;
+}
+
+void aws_h2_connection_count_rst_stream_sent(struct aws_h2_connection *connection, uint32_t h2_error_code) {
+    AWS_PRECONDITION(aws_channel_thread_is_callers_thread(connection->base.channel_slot->channel));
+
+    if (h2_error_code < AWS_HTTP2_ERR_COUNT) {
+        connection->thread_data.stats.rst_streams_sent[h2_error_code]++;
+    }
 }
 
 static void s_on_channel_write_complete(
@@ -614,6 +797,9 @@ static void s_on_channel_write_complete(
 
     (void)message;
     struct aws_h2_connection *connection = user_data;
+    AWS_ASSERT(connection->thread_data.write_messages_in_flight > 0);
+
+    connection->thread_data.write_messages_in_flight--;
 
     if (err_code) {
         CONNECTION_LOGF(ERROR, connection, "Message did not write to network, error %s", aws_error_name(err_code));
@@ -621,20 +807,93 @@ static void s_on_channel_write_complete(
         return;
     }
 
+    if (!connection->thread_data.is_outgoing_frames_task_waiting_for_write) {
+        CONNECTION_LOG(TRACE, connection, "Message finished writing to network");
+
+        /* If the task stopped while this was in flight, shutdown may have been waiting on it to write the GOAWAY */
+        if (connection->thread_data.channel_shutdown_waiting_for_goaway_to_be_written &&
+            !connection->thread_data.is_outgoing_frames_task_active &&
+            connection->thread_data.write_messages_in_flight == 0) {
+            s_finish_shutdown(connection);
+        }
+        return;
+    }
+
     CONNECTION_LOG(TRACE, connection, "Message finished writing to network. Rescheduling outgoing frame task");
 
-    /* To avoid wasting memory, we only want ONE of our written aws_io_messages in the channel at a time.
-     * Therefore, we wait until it's written to the network before trying to send another
-     * by running the outgoing-frame-task again.
+    /* To avoid wasting memory, we only want `max_write_messages_in_flight` of our aws_io_messages in the channel
+     * at a time. Therefore, once that many are in flight, we wait until one is written to the network
+     * before trying to send another by running the outgoing-frame-task again.
      *
      * We also want to share the network with other channels.
      * Therefore, when the write completes, we SCHEDULE the outgoing-frame-task
      * to run again instead of calling the function directly.
      * This way, if the message completes synchronously,
      * we're not hogging the network by writing message after message in a tight loop */
+    connection->thread_data.is_outgoing_frames_task_waiting_for_write = false;
     aws_channel_schedule_task_now(channel, &connection->outgoing_frames_task);
 }
 
+/* An aws_io_message whose data is the caller's memory from a zero-copy DATA payload,
+ * rather than memory from the channel's message pool. */
+struct aws_h2_zero_copy_payload_message {
+    struct aws_io_message base;
+    struct aws_h2_stream *stream;
+    struct aws_h2_stream_data_write *write;
+};
+
+/* The channel is done with the caller's memory from a zero-copy DATA payload */
+static void s_zero_copy_payload_complete(struct aws_h2_zero_copy_payload_message *payload_msg, int error_code) {
+    aws_h2_stream_on_data_buffer_written(payload_msg->stream, payload_msg->write, error_code);
+}
+
+static void s_on_zero_copy_payload_write_complete(
+    struct aws_channel *channel,
+    struct aws_io_message *message,
+    int err_code,
+    void *user_data) {
+
+    s_zero_copy_payload_complete(AWS_CONTAINER_OF(message, struct aws_h2_zero_copy_payload_message, base), err_code);
+
+    /* The payload message is the last one sent, so it's the one that resumes the outgoing frames task */
+    s_on_channel_write_complete(channel, message, err_code, user_data);
+}
+
+/* Create an aws_io_message that refers to the caller's memory, rather than owning a buffer.
+ * It takes over the connection's zero_copy payload. */
+static struct aws_h2_zero_copy_payload_message *s_new_zero_copy_payload_message(struct aws_h2_connection *connection) {
+    struct aws_allocator *alloc = connection->base.alloc;
+    struct aws_h2_zero_copy_payload_message *payload_msg =
+        aws_mem_calloc(alloc, 1, sizeof(struct aws_h2_zero_copy_payload_message));
+    payload_msg->base.allocator = alloc;
+    payload_msg->base.message_type = AWS_IO_MESSAGE_APPLICATION_DATA;
+    payload_msg->base.owning_channel = connection->base.channel_slot->channel;
+    payload_msg->base.message_data = aws_byte_buf_from_array(
+        connection->thread_data.zero_copy.payload.ptr, connection->thread_data.zero_copy.payload.len);
+    payload_msg->base.on_completion = s_on_zero_copy_payload_write_complete;
+    payload_msg->base.user_data = connection;
+    payload_msg->stream = connection->thread_data.zero_copy.stream;
+    payload_msg->write = connection->thread_data.zero_copy.write;
+
+    AWS_ZERO_STRUCT(connection->thread_data.zero_copy);
+    return payload_msg;
+}
+
+/* Recount the memory this connection is holding onto, see aws_http_connection_get_memory_usage().
+ * Frames still in synced_data aren't counted until the connection's thread moves them over. */
+static void s_update_memory_usage(struct aws_h2_connection *connection) {
+    struct aws_http_connection_memory_usage usage;
+    AWS_ZERO_STRUCT(usage);
+
+    aws_h2_decoder_add_memory_usage(connection->thread_data.decoder, &usage);
+    usage.unconsumed_reads += connection->thread_data.leased_bytes;
+    usage.hpack_tables += aws_hpack_get_dynamic_table_memory_usage(&connection->thread_data.encoder.hpack.context);
+    usage.frame_cache = connection->frame_pool.cached_bytes;
+    usage.outgoing_queue += connection->thread_data.outgoing_frames_queue_bytes;
+
+    aws_http_connection_set_memory_usage(&connection->base, &usage);
+}
+
 static void s_outgoing_frames_task(struct aws_channel_task *task, void *arg, enum aws_task_status status) {
     (void)task;
 
@@ -644,6 +903,106 @@ static void s_outgoing_frames_task(struct aws_channel_task *task, void *arg, enu
 
     struct aws_h2_connection *connection = arg;
     s_write_outgoing_frames(connection, false /*first_try*/);
+    s_update_memory_usage(connection);
+}
+
+static void s_outgoing_frames_retry_task(struct aws_channel_task *task, void *arg, enum aws_task_status status) {
+    (void)task;
+
+    struct aws_h2_connection *connection = arg;
+    connection->thread_data.is_outgoing_frames_retry_task_scheduled = false;
+
+    if (status != AWS_TASK_STATUS_RUN_READY) {
+        return;
+    }
+
+    /* Does nothing if something else already woke the outgoing frames task */
+    aws_h2_try_write_outgoing_frames(connection);
+}
+
+/* Stop running the outgoing frames task until something happens that might produce data,
+ * or until the retry task fires, whichever comes first. */
+static void s_park_outgoing_frames_task(struct aws_h2_connection *connection) {
+    connection->thread_data.is_outgoing_frames_task_active = false;
+
+    if (connection->thread_data.is_outgoing_frames_retry_task_scheduled) {
+        return;
+    }
+
+    /* Double the delay each time, up to the max */
+    uint32_t backoff_exponent = connection->thread_data.outgoing_frames_empty_count -
+                                AWS_H2_OUTGOING_FRAMES_EMPTY_POLL_LIMIT - 1;
+    uint64_t delay_ns = AWS_H2_OUTGOING_FRAMES_RETRY_MAX_NS;
+    if (backoff_exponent < 20) {
+        delay_ns = aws_min_u64(
+            (uint64_t)AWS_H2_OUTGOING_FRAMES_RETRY_MIN_NS << backoff_exponent, AWS_H2_OUTGOING_FRAMES_RETRY_MAX_NS);
+    }
+
+    uint64_t now_ns = 0;
+    aws_channel_current_clock_time(connection->base.channel_slot->channel, &now_ns);
+
+    CONNECTION_LOGF(
+        TRACE,
+        connection,
+        "Outgoing frames task found no body data available, parking for up to %" PRIu64 "ns.",
+        delay_ns);
+
+    connection->thread_data.is_outgoing_frames_retry_task_scheduled = true;
+    aws_channel_schedule_task_future(
+        connection->base.channel_slot->channel, &connection->outgoing_frames_retry_task, now_ns + delay_ns);
+}
+
+static bool s_has_outgoing_streams(const struct aws_h2_connection *connection) {
+    for (size_t i = 0; i < AWS_H2_PRIORITY_BUCKET_COUNT; ++i) {
+        if (!aws_linked_list_empty(&connection->thread_data.outgoing_streams_buckets[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void aws_h2_connection_add_outgoing_stream(struct aws_h2_connection *connection, struct aws_h2_stream *stream) {
+    AWS_ASSERT(stream->priority_bucket < AWS_H2_PRIORITY_BUCKET_COUNT);
+    struct aws_linked_list *bucket = &connection->thread_data.outgoing_streams_buckets[stream->priority_bucket];
+    aws_linked_list_push_back(bucket, &stream->node);
+}
+
+/* Returns the only stream with DATA to send, or NULL if there are none or several */
+static struct aws_h2_stream *s_get_lone_outgoing_stream(struct aws_h2_connection *connection) {
+    struct aws_h2_stream *lone_stream = NULL;
+    for (size_t i = 0; i < AWS_H2_PRIORITY_BUCKET_COUNT; ++i) {
+        struct aws_linked_list *bucket = &connection->thread_data.outgoing_streams_buckets[i];
+        if (aws_linked_list_empty(bucket)) {
+            continue;
+        }
+        if (lone_stream || aws_linked_list_begin(bucket) != aws_linked_list_rbegin(bucket)) {
+            return NULL;
+        }
+        lone_stream = AWS_CONTAINER_OF(aws_linked_list_front(bucket), struct aws_h2_stream, node);
+    }
+    return lone_stream;
+}
+
+/* If a lone stream is transferring in bulk with frames larger than a normal aws_io_message,
+ * returns the message size that fits a whole frame. Otherwise returns 0 */
+static size_t s_get_bulk_data_message_size(struct aws_h2_connection *connection) {
+    if (!connection->bulk_data_max_frame_size) {
+        return 0;
+    }
+    struct aws_h2_stream *stream = s_get_lone_outgoing_stream(connection);
+    if (!stream || stream->thread_data.window_size_peer <= AWS_H2_MIN_WINDOW_SIZE) {
+        return 0;
+    }
+
+    size_t max_payload =
+        aws_min_u32(connection->bulk_data_max_frame_size, connection->thread_data.encoder.settings.max_frame_size);
+    max_payload = aws_min_size(max_payload, (size_t)stream->thread_data.window_size_peer);
+    max_payload = aws_min_size(max_payload, connection->thread_data.window_size_peer);
+    size_t message_size = max_payload + AWS_H2_FRAME_PREFIX_SIZE;
+    if (message_size <= g_aws_channel_max_fragment_size) {
+        return 0;
+    }
+    return message_size;
 }
 
 static void s_write_outgoing_frames(struct aws_h2_connection *connection, bool first_try) {
@@ -652,7 +1011,6 @@ static void s_write_outgoing_frames(struct aws_h2_connection *connection, bool f
 
     struct aws_channel_slot *channel_slot = connection->base.channel_slot;
     struct aws_linked_list *outgoing_frames_queue = &connection->thread_data.outgoing_frames_queue;
-    struct aws_linked_list *outgoing_streams_list = &connection->thread_data.outgoing_streams_list;
 
     if (connection->thread_data.is_writing_stopped) {
         return;
@@ -661,7 +1019,7 @@ static void s_write_outgoing_frames(struct aws_h2_connection *connection, bool f
     /* Determine whether there's work to do, and end task immediately if there's not.
      * Note that we stop writing DATA frames if the channel is trying to shut down */
     bool has_control_frames = !aws_linked_list_empty(outgoing_frames_queue);
-    bool has_data_frames = !aws_linked_list_empty(outgoing_streams_list);
+    bool has_data_frames = s_has_outgoing_streams(connection);
     bool may_write_data_frames = (connection->thread_data.window_size_peer > AWS_H2_MIN_WINDOW_SIZE) &&
                                  !connection->thread_data.channel_shutdown_waiting_for_goaway_to_be_written;
     bool will_write = has_control_frames || (has_data_frames && may_write_data_frames);
@@ -679,7 +1037,9 @@ static void s_write_outgoing_frames(struct aws_h2_connection *connection, bool f
 
         connection->thread_data.is_outgoing_frames_task_active = false;
 
-        if (connection->thread_data.channel_shutdown_waiting_for_goaway_to_be_written) {
+        /* If messages are still in flight, the last one to complete finishes shutdown */
+        if (connection->thread_data.channel_shutdown_waiting_for_goaway_to_be_written &&
+            connection->thread_data.write_messages_in_flight == 0) {
             s_finish_shutdown(connection);
         }
 
@@ -690,8 +1050,19 @@ static void s_write_outgoing_frames(struct aws_h2_connection *connection, bool f
         CONNECTION_LOG(TRACE, connection, "Starting outgoing frames task");
     }
 
-    /* Acquire aws_io_message, that we will attempt to fill up */
-    struct aws_io_message *msg = aws_channel_slot_acquire_max_message_for_write(channel_slot);
+    /* Acquire aws_io_message, that we will attempt to fill up.
+     * A stream transferring in bulk gets one big enough for a whole large DATA frame. */
+    size_t bulk_data_message_size = 0;
+    if (aws_linked_list_empty(outgoing_frames_queue) && may_write_data_frames) {
+        bulk_data_message_size = s_get_bulk_data_message_size(connection);
+    }
+    struct aws_io_message *msg = NULL;
+    if (bulk_data_message_size) {
+        msg = aws_channel_acquire_message_from_pool(
+            channel_slot->channel, AWS_IO_MESSAGE_APPLICATION_DATA, bulk_data_message_size);
+    } else {
+        msg = aws_channel_slot_acquire_max_message_for_write(channel_slot);
+    }
     if (AWS_UNLIKELY(!msg)) {
         CONNECTION_LOG(ERROR, connection, "Failed to acquire message from pool, closing connection.");
         goto error;
@@ -713,7 +1084,7 @@ static void s_write_outgoing_frames(struct aws_h2_connection *connection, bool f
     }
 
     /* If outgoing_frames_queue emptied, and connection is running normally,
-     * then write as many DATA frames from outgoing_streams_list as possible. */
+     * then write as many DATA frames from outgoing_streams_buckets as possible. */
     if (aws_linked_list_empty(outgoing_frames_queue) && may_write_data_frames) {
         if (s_encode_data_from_outgoing_streams(connection, &msg->message_data)) {
             goto error;
@@ -722,27 +1093,84 @@ static void s_write_outgoing_frames(struct aws_h2_connection *connection, bool f
 
     if (msg->message_data.len) {
         /* Write message to channel.
-         * outgoing_frames_task will resume when message completes. */
+         * outgoing_frames_task will resume right away if more messages may be in flight,
+         * or when a message completes otherwise. */
         CONNECTION_LOGF(TRACE, connection, "Outgoing frames task sending message of size %zu", msg->message_data.len);
+        connection->thread_data.outgoing_frames_empty_count = 0;
+
+        /* If a zero-copy DATA payload follows this message,
+         * it's the payload's message that signals the pair is complete. */
+        struct aws_h2_zero_copy_payload_message *payload_msg = NULL;
+        if (connection->thread_data.zero_copy.payload.len > 0) {
+            payload_msg = s_new_zero_copy_payload_message(connection);
+            msg->on_completion = NULL;
+            msg->user_data = NULL;
+        }
 
+        /* Count it first, in case it completes synchronously */
+        connection->thread_data.write_messages_in_flight++;
         if (aws_channel_slot_send_message(channel_slot, msg, AWS_CHANNEL_DIR_WRITE)) {
+            connection->thread_data.write_messages_in_flight--;
             CONNECTION_LOGF(
                 ERROR,
                 connection,
                 "Failed to send channel message: %s. Closing connection.",
                 aws_error_name(aws_last_error()));
 
+            if (payload_msg) {
+                int error_code = aws_last_error();
+                s_zero_copy_payload_complete(payload_msg, error_code);
+                aws_mem_release(payload_msg->base.allocator, payload_msg);
+                aws_raise_error(error_code);
+            }
             goto error;
         }
-    } else {
-        /* Message is empty, warn that no work is being done and reschedule the task to try again next tick.
-         * It's likely that body isn't ready, so body streaming function has no data to write yet.
-         * If this scenario turns out to be common we should implement a "pause" feature. */
-        CONNECTION_LOG(WARN, connection, "Outgoing frames task sent no data, will try again next tick.");
 
+        if (payload_msg) {
+            CONNECTION_LOGF(
+                TRACE,
+                connection,
+                "Outgoing frames task sending zero-copy DATA payload of size %zu",
+                payload_msg->base.message_data.len);
+
+            /* First message belongs to the channel now */
+            msg = NULL;
+            if (aws_channel_slot_send_message(channel_slot, &payload_msg->base, AWS_CHANNEL_DIR_WRITE)) {
+                int error_code = aws_last_error();
+                connection->thread_data.write_messages_in_flight--;
+                CONNECTION_LOGF(
+                    ERROR,
+                    connection,
+                    "Failed to send channel message: %s. Closing connection.",
+                    aws_error_name(error_code));
+
+                s_zero_copy_payload_complete(payload_msg, error_code);
+                aws_mem_release(payload_msg->base.allocator, payload_msg);
+                aws_raise_error(error_code);
+                goto error;
+            }
+        }
+
+        if (connection->thread_data.write_messages_in_flight < connection->max_write_messages_in_flight) {
+            aws_channel_schedule_task_now(channel_slot->channel, &connection->outgoing_frames_task);
+        } else {
+            connection->thread_data.is_outgoing_frames_task_waiting_for_write = true;
+        }
+    } else {
+        /* Message is empty. It's likely that body isn't ready, so body streaming function has no data to write yet.
+         * Try again next tick a few times, since data often shows up soon.
+         * After that, park the task so we're not spinning the event-loop. Anything that might let us write again
+         * (new streams, manual writes, aws_http2_stream_notify_body_ready(), incoming frames) wakes it up,
+         * and a retry task with exponential backoff wakes it up otherwise. */
         aws_mem_release(msg->allocator, msg);
 
-        aws_channel_schedule_task_now(channel_slot->channel, &connection->outgoing_frames_task);
+        connection->thread_data.outgoing_frames_empty_count++;
+        if (connection->thread_data.outgoing_frames_empty_count <= AWS_H2_OUTGOING_FRAMES_EMPTY_POLL_LIMIT) {
+            CONNECTION_LOG(TRACE, connection, "Outgoing frames task sent no data, will try again next tick.");
+            aws_channel_schedule_task_now(channel_slot->channel, &connection->outgoing_frames_task);
+        } else {
+            s_park_outgoing_frames_task(connection);
+        }
     }
     return;
 
@@ -768,7 +1196,11 @@ static int s_encode_outgoing_frames_queue(struct aws_h2_connection *connection,
         struct aws_h2_frame *frame = AWS_CONTAINER_OF(frame_node, struct aws_h2_frame, node);
         connection->thread_data.current_outgoing_frame = frame;
         bool frame_complete;
-        if (aws_h2_encode_frame(&connection->thread_data.encoder, frame, output, &frame_complete)) {
+        /* A frame may allocate as it encodes (ex: HEADERS buffering its header block) */
+        const size_t prev_memory_size = frame->memory_size;
+        int encode_err = aws_h2_encode_frame(&connection->thread_data.encoder, frame, output, &frame_complete);
+        connection->thread_data.outgoing_frames_queue_bytes += frame->memory_size - prev_memory_size;
+        if (encode_err) {
             CONNECTION_LOGF(
                 ERROR,
                 connection,
@@ -799,6 +1231,7 @@ static int s_encode_outgoing_frames_queue(struct aws_h2_connection *connection,
 
         /* Done encoding frame, pop from queue and cleanup*/
         aws_linked_list_remove(frame_node);
+        connection->thread_data.outgoing_frames_queue_bytes -= frame->memory_size;
         aws_h2_frame_destroy(frame);
         connection->thread_data.current_outgoing_frame = NULL;
     }
@@ -806,12 +1239,11 @@ static int s_encode_outgoing_frames_queue(struct aws_h2_connection *connection,
     return AWS_OP_SUCCESS;
 }
 
-/* Write as many DATA frames from outgoing_streams_list as possible. */
+/* Write as many DATA frames from outgoing_streams_buckets as possible. */
 static int s_encode_data_from_outgoing_streams(struct aws_h2_connection *connection, struct aws_byte_buf *output) {
 
     AWS_PRECONDITION(aws_channel_thread_is_callers_thread(connection->base.channel_slot->channel));
-    struct aws_linked_list *outgoing_streams_list = &connection->thread_data.outgoing_streams_list;
-    if (aws_linked_list_empty(outgoing_streams_list)) {
+    if (!s_has_outgoing_streams(connection)) {
         return AWS_OP_SUCCESS;
     }
     struct aws_linked_list *stalled_window_streams_list = &connection->thread_data.stalled_window_streams_list;
@@ -824,10 +1256,23 @@ static int s_encode_data_from_outgoing_streams(struct aws_h2_connection *connect
 
     int aws_error_code = 0;
 
-    /* We simply round-robin through streams, instead of using stream priority.
-     * Respecting priority is not required (RFC-7540 5.3), so we're ignoring it for now. This also keeps use safe
-     * from priority DOS attacks: https://cve.mitre.org/cgi-bin/cvename.cgi?name=CVE-2019-9513 */
-    while (!aws_linked_list_empty(outgoing_streams_list)) {
+    /* Streams wait in buckets by priority, most urgent first, and only the front of a bucket is looked at.
+     * Only the priority set locally when the stream was created is used. Priority signals from the peer are ignored,
+     * which keeps us safe from priority DOS attacks: https://cve.mitre.org/cgi-bin/cvename.cgi?name=CVE-2019-9513
+     * Streams in the same bucket keep their relative order from the last time around. */
+    struct aws_linked_list *buckets = connection->thread_data.outgoing_streams_buckets;
+
+    size_t bucket_i = 0;
+    while (true) {
+        /* Find the most important bucket that still has streams */
+        while (bucket_i < AWS_H2_PRIORITY_BUCKET_COUNT && aws_linked_list_empty(&buckets[bucket_i])) {
+            ++bucket_i;
+        }
+        if (bucket_i == AWS_H2_PRIORITY_BUCKET_COUNT) {
+            goto done;
+        }
+        struct aws_linked_list *bucket = &buckets[bucket_i];
+
         if (connection->thread_data.window_size_peer <= AWS_H2_MIN_WINDOW_SIZE) {
             CONNECTION_LOGF(
                 DEBUG,
@@ -835,6 +1280,7 @@ static int s_encode_data_from_outgoing_streams(struct aws_h2_connection *connect
                 "Peer connection's flow-control window is too small now %zu. Connection will stop sending DATA until "
                 "WINDOW_UPDATE is received.",
                 connection->thread_data.window_size_peer);
+            s_connection_window_stall_begin(connection);
             goto done;
         }
 
@@ -846,9 +1292,17 @@ static int s_encode_data_from_outgoing_streams(struct aws_h2_connection *connect
             goto done;
         }
 
-        struct aws_linked_list_node *node = aws_linked_list_pop_front(outgoing_streams_list);
+        struct aws_linked_list_node *node = aws_linked_list_pop_front(bucket);
         struct aws_h2_stream *stream = AWS_CONTAINER_OF(node, struct aws_h2_stream, node);
 
+        /* A stream sending alone may use large frames. Streams taking turns keep them small, so no stream waits
+         * long behind another's frame */
+        if (connection->bulk_data_max_frame_size) {
+            connection->thread_data.encoder.max_data_payload =
+                s_has_outgoing_streams(connection) ? aws_h2_settings_initial[AWS_HTTP2_SETTINGS_MAX_FRAME_SIZE]
+                                                   : connection->bulk_data_max_frame_size;
+        }
+
         /* Ask stream to encode a data frame.
          * Stream may complete itself as a result of encoding its data,
          * in which case it will vanish from the connection's datastructures as a side-effect of this call.
@@ -871,7 +1325,12 @@ static int s_encode_data_from_outgoing_streams(struct aws_h2_connection *connect
             case AWS_H2_DATA_ENCODE_COMPLETE:
                 break;
             case AWS_H2_DATA_ENCODE_ONGOING:
-                aws_linked_list_push_back(outgoing_streams_list, node);
+                /* Incremental streams take turns. A non-incremental stream keeps going until it's done or stalls. */
+                if (stream->priority.incremental) {
+                    aws_linked_list_push_back(bucket, node);
+                } else {
+                    aws_linked_list_push_front(bucket, node);
+                }
                 break;
             case AWS_H2_DATA_ENCODE_ONGOING_BODY_STREAM_STALLED:
                 aws_linked_list_push_back(&stalled_streams_list, node);
@@ -882,6 +1341,9 @@ static int s_encode_data_from_outgoing_streams(struct aws_h2_connection *connect
                 break;
             case AWS_H2_DATA_ENCODE_ONGOING_WINDOW_STALLED:
                 aws_linked_list_push_back(stalled_window_streams_list, node);
+                aws_channel_current_clock_time(
+                    connection->base.channel_slot->channel, &stream->thread_data.window_stall_timestamp_ns);
+                AWS_HTTP_TRACE(AWS_HTTP_TRACE_WINDOW_STALL_BEGIN, connection, stream->base.id, 0);
                 AWS_H2_STREAM_LOG(
                     DEBUG,
                     stream,
@@ -891,20 +1353,27 @@ static int s_encode_data_from_outgoing_streams(struct aws_h2_connection *connect
             default:
                 CONNECTION_LOG(ERROR, connection, "Data encode status is invalid.");
                 aws_error_code = AWS_ERROR_INVALID_STATE;
+                goto done;
+        }
+
+        /* A zero-copy payload must immediately follow its frame prefix, so nothing more goes in this message */
+        if (connection->thread_data.zero_copy.payload.len > 0) {
+            goto done;
         }
     }
 
 done:
-    /* Return any stalled streams to outgoing_streams_list */
+    /* Stalled streams go to the back of their buckets, to try again next time */
     while (!aws_linked_list_empty(&stalled_streams_list)) {
-        aws_linked_list_push_back(outgoing_streams_list, aws_linked_list_pop_front(&stalled_streams_list));
+        struct aws_linked_list_node *node = aws_linked_list_pop_front(&stalled_streams_list);
+        aws_h2_connection_add_outgoing_stream(connection, AWS_CONTAINER_OF(node, struct aws_h2_stream, node));
     }
 
     if (aws_error_code) {
         return aws_raise_error(aws_error_code);
     }
 
-    if (aws_linked_list_empty(outgoing_streams_list)) {
+    if (!s_has_outgoing_streams(connection)) {
         /* transition from something to write -> nothing to write */
         uint64_t now_ns = 0;
         aws_channel_current_clock_time(connection->base.channel_slot->channel, &now_ns);
@@ -926,7 +1395,29 @@ void aws_h2_try_write_outgoing_frames(struct aws_h2_connection *connection) {
     }
 
     connection->thread_data.is_outgoing_frames_task_active = true;
+
+    /* Don't hold frames once shutdown has begun, the GOAWAY should go out ASAP */
+    if (connection->write_coalescing_delay_ns > 0 && !connection->thread_data.is_reading_stopped) {
+        /* Give other frames queued in the near future a chance to share the same aws_io_message */
+        uint64_t now_ns = 0;
+        aws_channel_current_clock_time(connection->base.channel_slot->channel, &now_ns);
+
+        CONNECTION_LOGF(
+            TRACE,
+            connection,
+            "Delaying outgoing frames task by %" PRIu64 "ns to coalesce writes.",
+            connection->write_coalescing_delay_ns);
+
+        aws_channel_schedule_task_future(
+            connection->base.channel_slot->channel,
+            &connection->outgoing_frames_task,
+            now_ns + connection->write_coalescing_delay_ns);
+        s_update_memory_usage(connection);
+        return;
+    }
+
     s_write_outgoing_frames(connection, true /*first_try*/);
+    s_update_memory_usage(connection);
 }
 
 /**
@@ -943,12 +1434,10 @@ struct aws_h2err s_get_active_stream_for_incoming_frame(
     *out_stream = NULL;
 
     /* Check active streams */
-    struct aws_hash_element *found = NULL;
-    const void *stream_id_key = (void *)(size_t)stream_id;
-    aws_hash_table_find(&connection->thread_data.active_streams_map, stream_id_key, &found);
+    struct aws_h2_stream *found = aws_h2_stream_table_find(&connection->thread_data.active_streams, stream_id);
     if (found) {
         /* Found it! return */
-        *out_stream = found->value;
+        *out_stream = found;
         return AWS_H2ERR_SUCCESS;
     }
 
@@ -956,7 +1445,7 @@ struct aws_h2err s_get_active_stream_for_incoming_frame(
     bool self_initiated_stream = client_initiated && (connection->base.client_data != NULL);
     bool peer_initiated_stream = !self_initiated_stream;
 
-    if ((self_initiated_stream && stream_id >= connection->base.next_stream_id) ||
+    if ((self_initiated_stream && stream_id >= aws_atomic_load_int(&connection->synced_data.next_stream_id)) ||
         (peer_initiated_stream && stream_id > connection->thread_data.latest_peer_initiated_stream_id)) {
         /* Illegal to receive frames for a stream in the idle state (stream doesn't exist yet)
          * (except server receiving HEADERS to start a stream, but that's handled elsewhere) */
@@ -982,17 +1471,15 @@ struct aws_h2err s_get_active_stream_for_incoming_frame(
         return AWS_H2ERR_SUCCESS;
     }
 
-    void *cached_value = NULL;
     /* Stream is closed, check whether it's legal for a few more frames to trickle in */
-    if (aws_cache_find(connection->thread_data.closed_streams, stream_id_key, &cached_value)) {
-        return aws_h2err_from_last_error();
-    }
-    if (cached_value) {
+    const struct aws_h2_closed_stream *closed_stream =
+        aws_h2_closed_streams_find(&connection->thread_data.closed_streams, stream_id);
+    if (closed_stream) {
         if (frame_type == AWS_H2_FRAME_T_PRIORITY) {
             /* If we support PRIORITY, do something here. Right now just ignore it */
             return AWS_H2ERR_SUCCESS;
         }
-        enum aws_h2_stream_closed_when closed_when = (enum aws_h2_stream_closed_when)(size_t)cached_value;
+        enum aws_h2_stream_closed_when closed_when = (enum aws_h2_stream_closed_when)closed_stream->closed_when;
         switch (closed_when) {
             case AWS_H2_STREAM_CLOSED_WHEN_BOTH_SIDES_END_STREAM:
                 /* WINDOW_UPDATE or RST_STREAM frames can be received ... for a short period after
@@ -1027,14 +1514,15 @@ struct aws_h2err s_get_active_stream_for_incoming_frame(
                     "Illegal to receive %s frame on stream id=%" PRIu32 " after RST_STREAM has been received",
                     aws_h2_frame_type_to_str(frame_type),
                     stream_id);
-                struct aws_h2_frame *rst_stream =
-                    aws_h2_frame_new_rst_stream(connection->base.alloc, stream_id, AWS_HTTP2_ERR_STREAM_CLOSED);
+                struct aws_h2_frame *rst_stream = aws_h2_frame_new_rst_stream(
+                    &connection->frame_pool.allocator, stream_id, AWS_HTTP2_ERR_STREAM_CLOSED);
                 if (!rst_stream) {
                     CONNECTION_LOGF(
                         ERROR, connection, "Error creating RST_STREAM frame, %s", aws_error_name(aws_last_error()));
                     return aws_h2err_from_last_error();
                 }
                 aws_h2_connection_enqueue_outgoing_frame(connection, rst_stream);
+                aws_h2_connection_count_rst_stream_sent(connection, AWS_HTTP2_ERR_STREAM_CLOSED);
                 return AWS_H2ERR_SUCCESS;
             case AWS_H2_STREAM_CLOSED_WHEN_RST_STREAM_SENT:
                 /* An endpoint MUST ignore frames that it receives on closed streams after it has sent a RST_STREAM
@@ -1124,6 +1612,97 @@ struct aws_h2err s_decoder_on_headers_i(
     return AWS_H2ERR_SUCCESS;
 }
 
+struct aws_h2err s_decoder_on_headers_block(
+    uint32_t stream_id,
+    const struct aws_http_header *header_array,
+    const enum aws_http_header_name *name_enum_array,
+    size_t num_headers,
+    enum aws_http_header_block block_type,
+    void *userdata) {
+
+    struct aws_h2_connection *connection = userdata;
+    struct aws_h2_stream *stream;
+    struct aws_h2err err =
+        s_get_active_stream_for_incoming_frame(connection, stream_id, AWS_H2_FRAME_T_HEADERS, &stream);
+    if (aws_h2err_failed(err)) {
+        return err;
+    }
+
+    if (stream) {
+        err = aws_h2_stream_on_decoder_headers_block(stream, header_array, name_enum_array, num_headers, block_type);
+        if (aws_h2err_failed(err)) {
+            return err;
+        }
+    }
+
+    return AWS_H2ERR_SUCCESS;
+}
+
+static void s_on_header_table_adaptive_settings_complete(
+    struct aws_http_connection *connection_base,
+    int error_code,
+    void *user_data) {
+
+    (void)error_code;
+    (void)user_data;
+    struct aws_h2_connection *connection = AWS_CONTAINER_OF(connection_base, struct aws_h2_connection, base);
+    connection->thread_data.header_table_adaptive.is_settings_in_flight = false;
+}
+
+/* Every so many header-blocks, send a new SETTINGS_HEADER_TABLE_SIZE if the decoder's table usage suggests one */
+static int s_header_table_adaptive_on_header_block(struct aws_h2_connection *connection) {
+    if (!connection->header_table_adaptive.max_size) {
+        return AWS_OP_SUCCESS;
+    }
+    if (--connection->thread_data.header_table_adaptive.header_blocks_until_evaluation > 0) {
+        return AWS_OP_SUCCESS;
+    }
+    connection->thread_data.header_table_adaptive.header_blocks_until_evaluation =
+        s_header_table_adaptive_evaluation_interval;
+
+    if (connection->thread_data.header_table_adaptive.is_settings_in_flight) {
+        /* Let the usage keep accumulating until the last change takes effect */
+        return AWS_OP_SUCCESS;
+    }
+
+    uint32_t current_size = connection->thread_data.settings_self[AWS_HTTP2_SETTINGS_HEADER_TABLE_SIZE];
+    size_t suggested_size = aws_h2_decoder_suggest_header_table_size(
+        connection->thread_data.decoder,
+        connection->header_table_adaptive.min_size,
+        connection->header_table_adaptive.max_size);
+    if (suggested_size == current_size) {
+        return AWS_OP_SUCCESS;
+    }
+
+    struct aws_http2_setting setting = {
+        .id = AWS_HTTP2_SETTINGS_HEADER_TABLE_SIZE,
+        .value = (uint32_t)suggested_size,
+    };
+    struct aws_h2_pending_settings *pending_settings = s_new_pending_settings(
+        connection->base.alloc, &setting, 1, s_on_header_table_adaptive_settings_complete, NULL /*user_data*/);
+    if (!pending_settings) {
+        return AWS_OP_ERR;
+    }
+    struct aws_h2_frame *settings_frame =
+        aws_h2_frame_new_settings(&connection->frame_pool.allocator, &setting, 1, false /*ACK*/);
+    if (!settings_frame) {
+        aws_mem_release(connection->base.alloc, pending_settings);
+        return AWS_OP_ERR;
+    }
+
+    CONNECTION_LOGF(
+        DEBUG,
+        connection,
+        "Changing SETTINGS_HEADER_TABLE_SIZE from %" PRIu32 " to %" PRIu32 " based on HPACK dynamic table usage",
+        current_size,
+        setting.value);
+    aws_linked_list_push_back(&connection->thread_data.pending_settings_queue, &pending_settings->node);
+    aws_h2_connection_enqueue_outgoing_frame(connection, settings_frame);
+
+    connection->thread_data.header_table_adaptive.is_settings_in_flight = true;
+    return AWS_OP_SUCCESS;
+}
+
 struct aws_h2err s_decoder_on_headers_end(
     uint32_t stream_id,
     bool malformed,
@@ -1131,6 +1710,11 @@ struct aws_h2err s_decoder_on_headers_end(
     void *userdata) {
 
     struct aws_h2_connection *connection = userdata;
+
+    if (s_header_table_adaptive_on_header_block(connection)) {
+        return aws_h2err_from_last_error();
+    }
+
     struct aws_h2_stream *stream;
     struct aws_h2err err =
         s_get_active_stream_for_incoming_frame(connection, stream_id, AWS_H2_FRAME_T_HEADERS, &stream);
@@ -1188,7 +1772,7 @@ struct aws_h2err s_decoder_on_push_promise(uint32_t stream_id, uint32_t promised
 
 static int s_connection_send_update_window(struct aws_h2_connection *connection, uint32_t window_size) {
     struct aws_h2_frame *connection_window_update_frame =
-        aws_h2_frame_new_window_update(connection->base.alloc, 0, window_size);
+        aws_h2_frame_new_window_update(&connection->frame_pool.allocator, 0, window_size);
     if (!connection_window_update_frame) {
         CONNECTION_LOGF(
             ERROR,
@@ -1202,6 +1786,169 @@ static int s_connection_send_update_window(struct aws_h2_connection *connection,
     return AWS_OP_SUCCESS;
 }
 
+/* With a read window budget, the automatic connection window isn't kept at max, it grows by what the budget grants */
+static bool s_connection_window_uses_read_budget(const struct aws_h2_connection *connection) {
+    return !connection->conn_manual_window_management && aws_http_connection_has_read_window_budget(&connection->base);
+}
+
+/* Grow the connection window by what the read window budget grants.
+ * Only while there are streams to receive for, since the peer can't be made to give the window back */
+static int s_connection_update_budgeted_window(struct aws_h2_connection *connection) {
+    size_t increment_size = 0;
+    if (!connection->thread_data.is_reading_stopped &&
+        aws_h2_stream_table_get_count(&connection->thread_data.active_streams) > 0) {
+        increment_size = aws_sub_size_saturating(AWS_H2_WINDOW_UPDATE_MAX, connection->thread_data.window_size_self);
+    }
+
+    size_t granted = aws_http_connection_update_read_window_budget(
+        &connection->base,
+        connection->thread_data.window_size_self + connection->thread_data.read_window_budget_held +
+            connection->thread_data.leased_bytes,
+        increment_size);
+    if (granted == 0) {
+        return AWS_OP_SUCCESS;
+    }
+
+    CONNECTION_LOGF(TRACE, connection, "Read window budget allows updating connection window by %zu.", granted);
+    return s_connection_send_update_window(connection, (uint32_t)granted);
+}
+
+void aws_h2_connection_release_stream_read_window_budget(
+    struct aws_h2_connection *connection,
+    struct aws_h2_stream *stream,
+    size_t size) {
+
+    size_t released = aws_min_size(size, stream->thread_data.read_window_budget_held);
+    if (released == 0) {
+        return;
+    }
+    stream->thread_data.read_window_budget_held -= released;
+    connection->thread_data.read_window_budget_held -= released;
+
+    if (s_connection_update_budgeted_window(connection)) {
+        aws_h2_connection_shutdown_due_to_write_err(connection, aws_last_error());
+    }
+}
+
+static void s_connection_on_read_window_budget_available(struct aws_http_connection *connection_base) {
+    struct aws_h2_connection *connection = AWS_CONTAINER_OF(connection_base, struct aws_h2_connection, base);
+    if (s_connection_update_budgeted_window(connection)) {
+        aws_h2_connection_shutdown_due_to_write_err(connection, aws_last_error());
+        return;
+    }
+    aws_h2_try_write_outgoing_frames(connection);
+}
+
+static void s_connection_on_body_leases_released(struct aws_http_connection *connection_base, size_t counted_bytes) {
+    struct aws_h2_connection *connection = AWS_CONTAINER_OF(connection_base, struct aws_h2_connection, base);
+    AWS_ASSERT(connection->thread_data.leased_bytes >= counted_bytes);
+    connection->thread_data.leased_bytes -= counted_bytes;
+    s_update_memory_usage(connection);
+    s_connection_on_read_window_budget_available(connection_base);
+}
+
+static void s_on_window_auto_tuning_ping_complete(
+    struct aws_http_connection *connection_base,
+    uint64_t round_trip_time_ns,
+    int error_code,
+    void *user_data) {
+
+    (void)user_data;
+    struct aws_h2_connection *connection = AWS_CONTAINER_OF(connection_base, struct aws_h2_connection, base);
+    connection->thread_data.window_auto_tuning.is_ping_in_flight = false;
+    if (error_code) {
+        return;
+    }
+
+    uint64_t bdp = connection->thread_data.window_auto_tuning.max_stream_bytes_received;
+    uint32_t initial_window = connection->thread_data.settings_self[AWS_HTTP2_SETTINGS_INITIAL_WINDOW_SIZE];
+    uint64_t window = (uint64_t)initial_window + connection->thread_data.window_auto_tuning.stream_window_growth;
+    uint64_t max_window = connection->stream_window_auto_tuning_max_size;
+
+    /* If the peer nearly filled a stream's window within one round-trip, the window is what's limiting throughput.
+     * Compared per stream, since many streams each well within their windows can add up to more than one window */
+    if (bdp * 3 < window * 2 || window >= max_window) {
+        return;
+    }
+
+    uint64_t new_window = aws_min_u64(aws_max_u64(bdp * 2, window * 2), max_window);
+    connection->thread_data.window_auto_tuning.stream_window_growth = (uint32_t)(new_window - initial_window);
+
+    CONNECTION_LOGF(
+        DEBUG,
+        connection,
+        "Received %" PRIu64 " bytes in %" PRIu64 "ns round-trip, growing stream windows from %" PRIu64 " to %" PRIu64,
+        bdp,
+        round_trip_time_ns,
+        window,
+        new_window);
+}
+
+/* Count the stream's bytes towards its bandwidth-delay product estimate */
+static void s_window_auto_tuning_count_stream_bytes(
+    struct aws_h2_connection *connection,
+    struct aws_h2_stream *stream,
+    uint32_t payload_len) {
+
+    if (stream->thread_data.window_auto_tuning_sample_id != connection->thread_data.window_auto_tuning.sample_id) {
+        stream->thread_data.window_auto_tuning_sample_id = connection->thread_data.window_auto_tuning.sample_id;
+        stream->thread_data.window_auto_tuning_bytes_received = 0;
+    }
+    stream->thread_data.window_auto_tuning_bytes_received += payload_len;
+    connection->thread_data.window_auto_tuning.max_stream_bytes_received = aws_max_u64(
+        connection->thread_data.window_auto_tuning.max_stream_bytes_received,
+        stream->thread_data.window_auto_tuning_bytes_received);
+}
+
+/* Count bytes towards the bandwidth-delay product estimate, sending a PING to start a new sample if necessary */
+static int s_window_auto_tuning_on_data(
+    struct aws_h2_connection *connection,
+    struct aws_h2_stream *stream,
+    uint32_t payload_len) {
+
+    if (connection->thread_data.window_auto_tuning.is_ping_in_flight) {
+        s_window_auto_tuning_count_stream_bytes(connection, stream, payload_len);
+        return AWS_OP_SUCCESS;
+    }
+
+    uint64_t window = (uint64_t)connection->thread_data.settings_self[AWS_HTTP2_SETTINGS_INITIAL_WINDOW_SIZE] +
+                      connection->thread_data.window_auto_tuning.stream_window_growth;
+    if (window >= connection->stream_window_auto_tuning_max_size) {
+        /* Already as big as we'll go, stop measuring */
+        return AWS_OP_SUCCESS;
+    }
+
+    uint64_t time_stamp;
+    if (aws_high_res_clock_get_ticks(&time_stamp)) {
+        return AWS_OP_ERR;
+    }
+    struct aws_h2_pending_ping *pending_ping = s_new_pending_ping(
+        connection->base.alloc, NULL /*optional_opaque_data*/, time_stamp, NULL, s_on_window_auto_tuning_ping_complete);
+    if (!pending_ping) {
+        return AWS_OP_ERR;
+    }
+    struct aws_h2_frame *ping_frame =
+        aws_h2_frame_new_ping(&connection->frame_pool.allocator, false /*ACK*/, pending_ping->opaque_data);
+    if (!ping_frame) {
+        aws_mem_release(connection->base.alloc, pending_ping);
+        return AWS_OP_ERR;
+    }
+
+    CONNECTION_LOG(TRACE, connection, "Sending PING to measure bandwidth-delay product for window auto-tuning");
+    aws_linked_list_push_back(&connection->thread_data.pending_ping_queue, &pending_ping->node);
+    aws_h2_connection_enqueue_outgoing_frame(connection, ping_frame);
+
+    /* Start a new sample. Streams start out with sample id 0, which is skipped here, so a new stream is never
+     * mistaken for one that already counted bytes in this sample */
+    connection->thread_data.window_auto_tuning.is_ping_in_flight = true;
+    if (++connection->thread_data.window_auto_tuning.sample_id == 0) {
+        connection->thread_data.window_auto_tuning.sample_id = 1;
+    }
+    connection->thread_data.window_auto_tuning.max_stream_bytes_received = 0;
+    s_window_auto_tuning_count_stream_bytes(connection, stream, payload_len);
+    return AWS_OP_SUCCESS;
+}
+
 struct aws_h2err s_decoder_on_data_begin(
     uint32_t stream_id,
     uint32_t payload_len,
@@ -1229,15 +1976,33 @@ struct aws_h2err s_decoder_on_data_begin(
         return err;
     }
 
+    if (stream && connection->base.stream_manual_window_management &&
+        s_connection_window_uses_read_budget(connection)) {
+        /* Held until the user updates the stream's window. Padding isn't delivered to the user, so isn't held */
+        stream->thread_data.read_window_budget_held += payload_len - total_padding_bytes;
+        connection->thread_data.read_window_budget_held += payload_len - total_padding_bytes;
+    }
+
     if (stream) {
         err = aws_h2_stream_on_decoder_data_begin(stream, payload_len, total_padding_bytes, end_stream);
         if (aws_h2err_failed(err)) {
             return err;
         }
     }
+    if (stream && connection->stream_window_auto_tuning_max_size && payload_len > 0) {
+        if (s_window_auto_tuning_on_data(connection, stream, payload_len)) {
+            return aws_h2err_from_last_error();
+        }
+    }
+
     /* Handle automatic updates of the connection flow window */
     uint32_t auto_window_update;
-    if (connection->conn_manual_window_management) {
+    if (s_connection_window_uses_read_budget(connection)) {
+        if (s_connection_update_budgeted_window(connection)) {
+            return aws_h2err_from_last_error();
+        }
+        return AWS_H2ERR_SUCCESS;
+    } else if (connection->conn_manual_window_management) {
         /* Automatically update the flow-window to account for padding, even though "manual window management"
          * is enabled. We do this because the current API doesn't have any way to inform the user about padding,
          * so we can't expect them to manage it themselves. */
@@ -1273,7 +2038,15 @@ struct aws_h2err s_decoder_on_data_i(uint32_t stream_id, struct aws_byte_cursor
     }
 
     if (stream) {
-        err = aws_h2_stream_on_decoder_data_i(stream, data);
+        struct aws_http_leased_message *leased_message = NULL;
+        if (stream->base.on_incoming_body_lease) {
+            if (!connection->thread_data.leased_message) {
+                connection->thread_data.leased_message =
+                    aws_http_leased_message_new(&connection->base, connection->thread_data.read_message);
+            }
+            leased_message = connection->thread_data.leased_message;
+        }
+        err = aws_h2_stream_on_decoder_data_i(stream, data, leased_message);
         if (aws_h2err_failed(err)) {
             return err;
         }
@@ -1289,10 +2062,8 @@ struct aws_h2err s_decoder_on_end_stream(uint32_t stream_id, void *userdata) {
      * isn't an actual frame type. It's a flag on DATA or HEADERS frames, and we
      * already checked the legality of those frames in their respective callbacks. */
 
-    struct aws_hash_element *found = NULL;
-    aws_hash_table_find(&connection->thread_data.active_streams_map, (void *)(size_t)stream_id, &found);
-    if (found) {
-        struct aws_h2_stream *stream = found->value;
+    struct aws_h2_stream *stream = aws_h2_stream_table_find(&connection->thread_data.active_streams, stream_id);
+    if (stream) {
         struct aws_h2err err = aws_h2_stream_on_decoder_end_stream(stream);
         if (aws_h2err_failed(err)) {
             return err;
@@ -1323,6 +2094,31 @@ static struct aws_h2err s_decoder_on_rst_stream(uint32_t stream_id, uint32_t h2_
     return AWS_H2ERR_SUCCESS;
 }
 
+/* Fold a round-trip time sample into the connection's estimate, the way TCP does (RFC-6298 2) */
+static void s_add_rtt_sample(struct aws_h2_connection *connection, uint64_t rtt_ns) {
+    struct aws_http2_rtt_estimate *estimate = &connection->thread_data.rtt_estimate;
+    if (estimate->sample_count == 0) {
+        estimate->smoothed_rtt_ns = rtt_ns;
+        estimate->rtt_variation_ns = rtt_ns / 2;
+        estimate->min_rtt_ns = rtt_ns;
+    } else {
+        /* RTTVAR = 3/4 * RTTVAR + 1/4 * |SRTT - R|, then SRTT = 7/8 * SRTT + 1/8 * R */
+        uint64_t deviation = estimate->smoothed_rtt_ns > rtt_ns ? estimate->smoothed_rtt_ns - rtt_ns
+                                                                : rtt_ns - estimate->smoothed_rtt_ns;
+        estimate->rtt_variation_ns = estimate->rtt_variation_ns - estimate->rtt_variation_ns / 4 + deviation / 4;
+        estimate->smoothed_rtt_ns = estimate->smoothed_rtt_ns - estimate->smoothed_rtt_ns / 8 + rtt_ns / 8;
+        estimate->min_rtt_ns = aws_min_u64(estimate->min_rtt_ns, rtt_ns);
+    }
+    estimate->latest_rtt_ns = rtt_ns;
+    estimate->sample_count++;
+
+    { /* BEGIN CRITICAL SECTION */
+        s_lock_synced_data(connection);
+        connection->synced_data.rtt_estimate = *estimate;
+        s_unlock_synced_data(connection);
+    } /* END CRITICAL SECTION */
+}
+
 static struct aws_h2err s_decoder_on_ping_ack(uint8_t opaque_data[AWS_HTTP2_PING_DATA_SIZE], void *userdata) {
     struct aws_h2_connection *connection = userdata;
     if (aws_linked_list_empty(&connection->thread_data.pending_ping_queue)) {
@@ -1359,6 +2155,10 @@ static struct aws_h2err s_decoder_on_ping_ack(uint8_t opaque_data[AWS_HTTP2_PING
         goto error;
     }
     CONNECTION_LOGF(TRACE, connection, "Round trip time is %lf ms, approximately", (double)rtt / 1000000);
+    s_add_rtt_sample(connection, rtt);
+    connection->thread_data.stats.max_ping_rtt_ms = aws_max_u64(
+        connection->thread_data.stats.max_ping_rtt_ms,
+        aws_timestamp_convert(rtt, AWS_TIMESTAMP_NANOS, AWS_TIMESTAMP_MILLIS, NULL));
     /* fire the callback */
     if (pending_ping->on_completed) {
         pending_ping->on_completed(&connection->base, rtt, AWS_ERROR_SUCCESS, pending_ping->user_data);
@@ -1377,7 +2177,7 @@ static struct aws_h2err s_decoder_on_ping(uint8_t opaque_data[AWS_HTTP2_PING_DAT
     struct aws_h2_connection *connection = userdata;
 
     /* send a PING frame with the ACK flag set in response, with an identical payload. */
-    struct aws_h2_frame *ping_ack_frame = aws_h2_frame_new_ping(connection->base.alloc, true, opaque_data);
+    struct aws_h2_frame *ping_ack_frame = aws_h2_frame_new_ping(&connection->frame_pool.allocator, true, opaque_data);
     if (!ping_ack_frame) {
         CONNECTION_LOGF(
             ERROR, connection, "Ping ACK frame failed to be sent, error %s", aws_error_name(aws_last_error()));
@@ -1397,7 +2197,8 @@ static struct aws_h2err s_decoder_on_settings(
     /* Once all values have been processed, the recipient MUST immediately emit a SETTINGS frame with the ACK flag
      * set.(RFC-7540 6.5.3) */
     CONNECTION_LOG(TRACE, connection, "Setting frame processing ends");
-    struct aws_h2_frame *settings_ack_frame = aws_h2_frame_new_settings(connection->base.alloc, NULL, 0, true);
+    struct aws_h2_frame *settings_ack_frame =
+        aws_h2_frame_new_settings(&connection->frame_pool.allocator, NULL, 0, true);
     if (!settings_ack_frame) {
         CONNECTION_LOGF(
             ERROR, connection, "Settings ACK frame failed to be sent, error %s", aws_error_name(aws_last_error()));
@@ -1432,10 +2233,11 @@ static struct aws_h2err s_decoder_on_settings(
                  * flow-control windows that it maintains by the difference between the new value and the old value. */
                 int32_t size_changed =
                     settings_array[i].value - connection->thread_data.settings_peer[settings_array[i].id];
-                struct aws_hash_iter stream_iter = aws_hash_iter_begin(&connection->thread_data.active_streams_map);
-                while (!aws_hash_iter_done(&stream_iter)) {
-                    struct aws_h2_stream *stream = stream_iter.element.value;
-                    aws_hash_iter_next(&stream_iter);
+                struct aws_h2_stream_table_iter stream_iter =
+                    aws_h2_stream_table_iter_begin(&connection->thread_data.active_streams);
+                while (!aws_h2_stream_table_iter_done(&stream_iter)) {
+                    struct aws_h2_stream *stream = stream_iter.stream;
+                    aws_h2_stream_table_iter_next(&stream_iter);
                     err = aws_h2_stream_window_size_change(stream, size_changed, false /*self*/);
                     if (aws_h2err_failed(err)) {
                         CONNECTION_LOG(
@@ -1471,6 +2273,14 @@ static struct aws_h2err s_decoder_on_settings(
         s_unlock_synced_data(connection);
     } /* END CRITICAL SECTION */
     aws_mem_release(connection->base.alloc, callback_array);
+
+    if (!connection->thread_data.is_peer_settings_received) {
+        connection->thread_data.is_peer_settings_received = true;
+        if (!aws_linked_list_empty(&connection->thread_data.pending_stream_list)) {
+            /* An extended CONNECT may be waiting on these settings */
+            s_schedule_cross_thread_work(connection);
+        }
+    }
     return AWS_H2ERR_SUCCESS;
 error:
     aws_mem_release(connection->base.alloc, callback_array);
@@ -1488,6 +2298,12 @@ static struct aws_h2err s_decoder_on_settings_ack(void *userdata) {
     struct aws_linked_list_node *node = aws_linked_list_pop_front(&connection->thread_data.pending_settings_queue);
     pending_settings = AWS_CONTAINER_OF(node, struct aws_h2_pending_settings, node);
 
+    uint64_t now_ns = 0;
+    if (pending_settings->started_time && !aws_high_res_clock_get_ticks(&now_ns) &&
+        now_ns >= pending_settings->started_time) {
+        s_add_rtt_sample(connection, now_ns - pending_settings->started_time);
+    }
+
     struct aws_http2_setting *settings_array = pending_settings->settings_array;
     /* Apply the settings */
     struct aws_h2_decoder *decoder = connection->thread_data.decoder;
@@ -1508,10 +2324,11 @@ static struct aws_h2err s_decoder_on_settings_ack(void *userdata) {
                  * flow-control windows that it maintains by the difference between the new value and the old value. */
                 int32_t size_changed =
                     settings_array[i].value - connection->thread_data.settings_self[settings_array[i].id];
-                struct aws_hash_iter stream_iter = aws_hash_iter_begin(&connection->thread_data.active_streams_map);
-                while (!aws_hash_iter_done(&stream_iter)) {
-                    struct aws_h2_stream *stream = stream_iter.element.value;
-                    aws_hash_iter_next(&stream_iter);
+                struct aws_h2_stream_table_iter stream_iter =
+                    aws_h2_stream_table_iter_begin(&connection->thread_data.active_streams);
+                while (!aws_h2_stream_table_iter_done(&stream_iter)) {
+                    struct aws_h2_stream *stream = stream_iter.stream;
+                    aws_h2_stream_table_iter_next(&stream_iter);
                     err = aws_h2_stream_window_size_change(stream, size_changed, true /*self*/);
                     if (aws_h2err_failed(err)) {
                         CONNECTION_LOG(
@@ -1583,6 +2400,7 @@ static struct aws_h2err s_decoder_on_window_update(uint32_t stream_id, uint32_t
                 "Peer connection's flow-control window is resumed from too small to %" PRIu32
                 ". Connection will resume sending DATA.",
                 window_size_increment);
+            s_connection_window_stall_end(connection);
         }
         connection->thread_data.window_size_peer += window_size_increment;
         return AWS_H2ERR_SUCCESS;
@@ -1609,7 +2427,8 @@ static struct aws_h2err s_decoder_on_window_update(uint32_t stream_id, uint32_t
                     " Stream will resume sending data.",
                     stream->thread_data.window_size_peer);
                 aws_linked_list_remove(&stream->node);
-                aws_linked_list_push_back(&connection->thread_data.outgoing_streams_list, &stream->node);
+                aws_h2_connection_add_outgoing_stream(connection, stream);
+                s_stream_window_stall_end(connection, stream);
             }
         }
     }
@@ -1636,7 +2455,7 @@ struct aws_h2err s_decoder_on_goaway(
     { /* BEGIN CRITICAL SECTION */
         s_lock_synced_data(connection);
 
-        connection->synced_data.new_stream_error_code = AWS_ERROR_HTTP_GOAWAY_RECEIVED;
+        aws_atomic_store_int(&connection->synced_data.new_stream_error_code, AWS_ERROR_HTTP_GOAWAY_RECEIVED);
         connection->synced_data.goaway_received_last_stream_id = last_stream;
         connection->synced_data.goaway_received_http2_error_code = error_code;
 
@@ -1653,10 +2472,11 @@ struct aws_h2err s_decoder_on_goaway(
     /* Complete activated streams whose id is higher than last_stream, since they will not process by peer. We should
      * treat them as they had never been created at all.
      * This would be more efficient if we could iterate streams in reverse-id order */
-    struct aws_hash_iter stream_iter = aws_hash_iter_begin(&connection->thread_data.active_streams_map);
-    while (!aws_hash_iter_done(&stream_iter)) {
-        struct aws_h2_stream *stream = stream_iter.element.value;
-        aws_hash_iter_next(&stream_iter);
+    struct aws_h2_stream_table_iter stream_iter =
+        aws_h2_stream_table_iter_begin(&connection->thread_data.active_streams);
+    while (!aws_h2_stream_table_iter_done(&stream_iter)) {
+        struct aws_h2_stream *stream = stream_iter.stream;
+        aws_h2_stream_table_iter_next(&stream_iter);
         if (stream->base.id > last_stream) {
             AWS_H2_STREAM_LOG(
                 DEBUG,
@@ -1734,9 +2554,11 @@ static void s_handler_installed(struct aws_channel_handler *handler, struct aws_
     connection->thread_data.init_pending_settings = NULL;
     /* Set user_data here, the user_data is valid now */
     init_pending_settings->user_data = connection->base.user_data;
+    /* The round-trip starts now, not when the connection was created */
+    aws_high_res_clock_get_ticks(&init_pending_settings->started_time);
 
     struct aws_h2_frame *init_settings_frame = aws_h2_frame_new_settings(
-        connection->base.alloc,
+        &connection->frame_pool.allocator,
         init_pending_settings->settings_array,
         init_pending_settings->num_settings,
         false /*ACK*/);
@@ -1750,17 +2572,17 @@ static void s_handler_installed(struct aws_channel_handler *handler, struct aws_
         goto error;
     }
     /* enqueue the initial settings frame here */
-    aws_linked_list_push_back(&connection->thread_data.outgoing_frames_queue, &init_settings_frame->node);
+    aws_h2_connection_enqueue_outgoing_frame(connection, init_settings_frame);
 
-    /* If not manual connection window management, update the connection window to max. */
-    if (!connection->conn_manual_window_management) {
+    /* If not manual connection window management, update the connection window to max.
+     * Unless there's a read window budget, then it grows as streams need it. */
+    if (!connection->conn_manual_window_management && !s_connection_window_uses_read_budget(connection)) {
         uint32_t initial_window_update_size = AWS_H2_WINDOW_UPDATE_MAX - AWS_H2_INIT_WINDOW_SIZE;
-        struct aws_h2_frame *connection_window_update_frame =
-            aws_h2_frame_new_window_update(connection->base.alloc, 0 /* stream_id */, initial_window_update_size);
+        struct aws_h2_frame *connection_window_update_frame = aws_h2_frame_new_window_update(
+            &connection->frame_pool.allocator, 0 /* stream_id */, initial_window_update_size);
         AWS_ASSERT(connection_window_update_frame);
         /* enqueue the windows update frame here */
-        aws_linked_list_push_back(
-            &connection->thread_data.outgoing_frames_queue, &connection_window_update_frame->node);
+        aws_h2_connection_enqueue_outgoing_frame(connection, connection_window_update_frame);
         connection->thread_data.window_size_self += initial_window_update_size;
     }
     aws_h2_try_write_outgoing_frames(connection);
@@ -1785,13 +2607,17 @@ static void s_stream_complete(struct aws_h2_connection *connection, struct aws_h
         AWS_H2_STREAM_LOG(DEBUG, stream, "Server stream complete");
     }
 
-    /* Remove stream from active_streams_map and outgoing_stream_list (if it was in them at all) */
-    aws_hash_table_remove(&connection->thread_data.active_streams_map, (void *)(size_t)stream->base.id, NULL, NULL);
+    /* Remove stream from active_streams and outgoing_streams_buckets (if it was in them at all) */
+    aws_h2_stream_table_remove(&connection->thread_data.active_streams, stream->base.id);
     if (stream->node.next) {
         aws_linked_list_remove(&stream->node);
     }
+    s_stream_window_stall_end(connection, stream);
+
+    /* Whatever the user didn't consume is gone with the stream */
+    aws_h2_connection_release_stream_read_window_budget(connection, stream, SIZE_MAX);
 
-    if (aws_hash_table_get_entry_count(&connection->thread_data.active_streams_map) == 0 &&
+    if (aws_h2_stream_table_get_count(&connection->thread_data.active_streams) == 0 &&
         connection->thread_data.incoming_timestamp_ns != 0) {
         uint64_t now_ns = 0;
         aws_channel_current_clock_time(connection->base.channel_slot->channel, &now_ns);
@@ -1841,10 +2667,7 @@ static int s_record_closed_stream(
 
     AWS_PRECONDITION(aws_channel_thread_is_callers_thread(connection->base.channel_slot->channel));
 
-    if (aws_cache_put(connection->thread_data.closed_streams, (void *)(size_t)stream_id, (void *)(size_t)closed_when)) {
-        CONNECTION_LOG(ERROR, connection, "Failed inserting ID into cache of recently closed streams");
-        return AWS_OP_ERR;
-    }
+    aws_h2_closed_streams_add(&connection->thread_data.closed_streams, stream_id, (uint8_t)closed_when);
 
     return AWS_OP_SUCCESS;
 }
@@ -1855,12 +2678,14 @@ int aws_h2_connection_send_rst_and_close_reserved_stream(
     uint32_t h2_error_code) {
     AWS_PRECONDITION(aws_channel_thread_is_callers_thread(connection->base.channel_slot->channel));
 
-    struct aws_h2_frame *rst_stream = aws_h2_frame_new_rst_stream(connection->base.alloc, stream_id, h2_error_code);
+    struct aws_h2_frame *rst_stream =
+        aws_h2_frame_new_rst_stream(&connection->frame_pool.allocator, stream_id, h2_error_code);
     if (!rst_stream) {
         CONNECTION_LOGF(ERROR, connection, "Error creating RST_STREAM frame, %s", aws_error_name(aws_last_error()));
         return AWS_OP_ERR;
     }
     aws_h2_connection_enqueue_outgoing_frame(connection, rst_stream);
+    aws_h2_connection_count_rst_stream_sent(connection, h2_error_code);
 
     /* If we ever fully support PUSH_PROMISE, this is where we'd remove the
      * promised_stream_id from some reserved_streams datastructure */
@@ -1868,6 +2693,25 @@ int aws_h2_connection_send_rst_and_close_reserved_stream(
     return s_record_closed_stream(connection, stream_id, AWS_H2_STREAM_CLOSED_WHEN_RST_STREAM_SENT);
 }
 
+int aws_h2_connection_on_http1_upgrade(struct aws_h2_connection *connection) {
+    AWS_PRECONDITION(connection->base.client_data);
+    AWS_PRECONDITION(aws_channel_thread_is_callers_thread(connection->base.channel_slot->channel));
+    AWS_PRECONDITION(aws_atomic_load_int(&connection->synced_data.next_stream_id) == 1);
+
+    aws_atomic_store_int(&connection->synced_data.next_stream_id, 3);
+    /* Stream 1 never goes through the pending list, or the streams after it would wait for it forever */
+    connection->thread_data.next_pending_stream_id = 3;
+
+    /* Frames the server still sends for stream 1 are ignored, since we've sent RST_STREAM */
+    CONNECTION_LOG(TRACE, connection, "Upgraded from HTTP/1.1, cancelling stream id=1 of the upgrade request");
+    if (aws_h2_connection_send_rst_and_close_reserved_stream(connection, 1 /*stream_id*/, AWS_HTTP2_ERR_CANCEL)) {
+        return AWS_OP_ERR;
+    }
+
+    aws_h2_try_write_outgoing_frames(connection);
+    return AWS_OP_SUCCESS;
+}
+
 /* Move stream into "active" datastructures and notify stream that it can send frames now */
 static void s_move_stream_to_thread(
     struct aws_h2_connection *connection,
@@ -1886,16 +2730,23 @@ static void s_move_stream_to_thread(
         goto error;
     }
 
+    if (stream->is_extended_connect &&
+        connection->thread_data.settings_peer[AWS_HTTP2_SETTINGS_ENABLE_CONNECT_PROTOCOL] != 1) {
+        /* RFC-8441 3: A sender MUST NOT send a :protocol pseudo-header unless peer sent this setting as 1 */
+        AWS_H2_STREAM_LOG(ERROR, stream, "Failed activating stream, peer does not support extended CONNECT");
+        aws_raise_error(AWS_ERROR_HTTP_EXTENDED_CONNECT_NOT_SUPPORTED);
+        goto error;
+    }
+
     uint32_t max_concurrent_streams = connection->thread_data.settings_peer[AWS_HTTP2_SETTINGS_MAX_CONCURRENT_STREAMS];
-    if (aws_hash_table_get_entry_count(&connection->thread_data.active_streams_map) >= max_concurrent_streams) {
+    if (aws_h2_stream_table_get_count(&connection->thread_data.active_streams) >= max_concurrent_streams) {
         AWS_H2_STREAM_LOG(ERROR, stream, "Failed activating stream, max concurrent streams are reached");
         aws_raise_error(AWS_ERROR_HTTP_MAX_CONCURRENT_STREAMS_EXCEEDED);
         goto error;
     }
 
-    if (aws_hash_table_put(
-            &connection->thread_data.active_streams_map, (void *)(size_t)stream->base.id, stream, NULL)) {
-        AWS_H2_STREAM_LOG(ERROR, stream, "Failed inserting stream into map");
+    if (aws_h2_stream_table_insert(&connection->thread_data.active_streams, stream->base.id, stream)) {
+        AWS_H2_STREAM_LOG(ERROR, stream, "Failed inserting stream into table");
         goto error;
     }
 
@@ -1904,7 +2755,14 @@ static void s_move_stream_to_thread(
         goto error;
     }
 
-    if (aws_hash_table_get_entry_count(&connection->thread_data.active_streams_map) == 1) {
+    if (s_connection_window_uses_read_budget(connection)) {
+        /* The window may have been left short while there were no streams */
+        if (s_connection_update_budgeted_window(connection)) {
+            goto error;
+        }
+    }
+
+    if (aws_h2_stream_table_get_count(&connection->thread_data.active_streams) == 1) {
         /* transition from nothing to read -> something to read */
         uint64_t now_ns = 0;
         aws_channel_current_clock_time(connection->base.channel_slot->channel, &now_ns);
@@ -1916,7 +2774,7 @@ static void s_move_stream_to_thread(
             aws_linked_list_push_back(&connection->thread_data.waiting_streams_list, &stream->node);
             break;
         case AWS_H2_STREAM_BODY_STATE_ONGOING:
-            aws_linked_list_push_back(&connection->thread_data.outgoing_streams_list, &stream->node);
+            aws_h2_connection_add_outgoing_stream(connection, stream);
             break;
         default:
             break;
@@ -1927,6 +2785,21 @@ error:
     s_stream_complete(connection, stream, aws_last_error());
 }
 
+/* Insert a newly arrived stream into thread_data.pending_stream_list, keeping it sorted by stream-id.
+ * Streams usually arrive in order, so search from the back */
+static void s_add_pending_stream(struct aws_h2_connection *connection, struct aws_h2_stream *stream) {
+    struct aws_linked_list *list = &connection->thread_data.pending_stream_list;
+    struct aws_linked_list_node *iter = aws_linked_list_rbegin(list);
+    while (iter != aws_linked_list_rend(list)) {
+        struct aws_h2_stream *other = AWS_CONTAINER_OF(iter, struct aws_h2_stream, node);
+        if (other->base.id < stream->base.id) {
+            break;
+        }
+        iter = aws_linked_list_prev(iter);
+    }
+    aws_linked_list_insert_after(iter, &stream->node);
+}
+
 /* Perform on-thread work that is triggered by calls to the connection/stream API */
 static void s_cross_thread_work_task(struct aws_channel_task *task, void *arg, enum aws_task_status status) {
     (void)task;
@@ -1951,24 +2824,24 @@ static void s_cross_thread_work_task(struct aws_channel_task *task, void *arg, e
     struct aws_linked_list pending_goaway;
     aws_linked_list_init(&pending_goaway);
 
-    size_t window_update_size;
-    int new_stream_error_code;
+    /* Clear this before taking any work, so work queued from here on schedules the task again */
+    aws_atomic_store_int(&connection->synced_data.is_cross_thread_work_task_scheduled, false);
+
     { /* BEGIN CRITICAL SECTION */
         s_lock_synced_data(connection);
-        connection->synced_data.is_cross_thread_work_task_scheduled = false;
 
         aws_linked_list_swap_contents(&connection->synced_data.pending_frame_list, &pending_frames);
-        aws_linked_list_swap_contents(&connection->synced_data.pending_stream_list, &pending_streams);
         aws_linked_list_swap_contents(&connection->synced_data.pending_settings_list, &pending_settings);
         aws_linked_list_swap_contents(&connection->synced_data.pending_ping_list, &pending_ping);
         aws_linked_list_swap_contents(&connection->synced_data.pending_goaway_list, &pending_goaway);
-        window_update_size = connection->synced_data.window_update_size;
-        connection->synced_data.window_update_size = 0;
-        new_stream_error_code = connection->synced_data.new_stream_error_code;
 
         s_unlock_synced_data(connection);
     } /* END CRITICAL SECTION */
 
+    aws_http_mpsc_queue_drain(&connection->synced_data.pending_stream_queue, &pending_streams);
+    size_t window_update_size = aws_atomic_exchange_int(&connection->synced_data.window_update_size, 0);
+    int new_stream_error_code = (int)aws_atomic_load_int(&connection->synced_data.new_stream_error_code);
+
     /* Enqueue new pending control frames */
     while (!aws_linked_list_empty(&pending_frames)) {
         struct aws_linked_list_node *node = aws_linked_list_pop_front(&pending_frames);
@@ -1976,15 +2849,53 @@ static void s_cross_thread_work_task(struct aws_channel_task *task, void *arg, e
         aws_h2_connection_enqueue_outgoing_frame(connection, frame);
     }
 
-    /* We already enqueued the window_update frame, just apply the change and let our peer check this value, no matter
-     * overflow happens or not. Peer will detect it for us. */
-    connection->thread_data.window_size_self =
-        aws_add_size_saturating(connection->thread_data.window_size_self, window_update_size);
+    /* All the user's updates since the last run go out in one WINDOW_UPDATE frame */
+    if (window_update_size > 0) {
+        struct aws_h2_frame *window_update_frame =
+            aws_h2_frame_new_window_update(&connection->frame_pool.allocator, 0, (uint32_t)window_update_size);
+        if (window_update_frame) {
+            aws_h2_connection_enqueue_outgoing_frame(connection, window_update_frame);
+
+            /* Apply the change and let our peer check this value, no matter overflow happens or not.
+             * Peer will detect it for us. */
+            connection->thread_data.window_size_self =
+                aws_add_size_saturating(connection->thread_data.window_size_self, window_update_size);
+        } else {
+            CONNECTION_LOGF(
+                ERROR,
+                connection,
+                "Failed to create WINDOW_UPDATE frame on connection, error %s",
+                aws_error_name(aws_last_error()));
+            s_stop(
+                connection,
+                false /*stop_reading*/,
+                false /*stop_writing*/,
+                true /*schedule_shutdown*/,
+                aws_last_error());
+        }
+    }
 
-    /* Process new pending_streams */
+    /* Process new pending_streams, in stream-id order */
     while (!aws_linked_list_empty(&pending_streams)) {
         struct aws_linked_list_node *node = aws_linked_list_pop_front(&pending_streams);
+        s_add_pending_stream(connection, AWS_CONTAINER_OF(node, struct aws_h2_stream, node));
+    }
+    while (!aws_linked_list_empty(&connection->thread_data.pending_stream_list)) {
+        struct aws_linked_list_node *node = aws_linked_list_front(&connection->thread_data.pending_stream_list);
         struct aws_h2_stream *stream = AWS_CONTAINER_OF(node, struct aws_h2_stream, node);
+        if (stream->base.id != connection->thread_data.next_pending_stream_id) {
+            /* A stream with a lower id was activated, but hasn't arrived yet. Its arrival runs this task again */
+            break;
+        }
+        if (stream->is_extended_connect && !connection->thread_data.is_peer_settings_received &&
+            !new_stream_error_code) {
+            /* Wait to learn whether peer supports extended CONNECT. Streams after it wait too, to open in order.
+             * The peer's SETTINGS runs this task again */
+            break;
+        }
+
+        aws_linked_list_pop_front(&connection->thread_data.pending_stream_list);
+        connection->thread_data.next_pending_stream_id += 2;
         s_move_stream_to_thread(connection, stream, new_stream_error_code);
     }
 
@@ -2013,56 +2924,76 @@ static void s_cross_thread_work_task(struct aws_channel_task *task, void *arg, e
     aws_h2_try_write_outgoing_frames(connection);
 }
 
+/* Take the next self-initiated stream-id. Returns 0 and raises an error if they're all gone. May be called from any
+ * thread */
+static uint32_t s_take_next_stream_id(struct aws_h2_connection *connection) {
+    size_t next_id = aws_atomic_load_int(&connection->synced_data.next_stream_id);
+    do {
+        if (AWS_UNLIKELY(next_id > AWS_H2_STREAM_ID_MAX)) {
+            CONNECTION_LOG(INFO, connection, "All available stream ids are gone");
+            aws_raise_error(AWS_ERROR_HTTP_STREAM_IDS_EXHAUSTED);
+            return 0;
+        }
+    } while (!aws_atomic_compare_exchange_int(&connection->synced_data.next_stream_id, &next_id, next_id + 2));
+
+    return (uint32_t)next_id;
+}
+
 int aws_h2_stream_activate(struct aws_http_stream *stream) {
     struct aws_h2_stream *h2_stream = AWS_CONTAINER_OF(stream, struct aws_h2_stream, base);
 
     struct aws_http_connection *base_connection = stream->owning_connection;
     struct aws_h2_connection *connection = AWS_CONTAINER_OF(base_connection, struct aws_h2_connection, base);
 
+    /* Only the stream's lock is taken, activating streams on one connection from many threads doesn't contend */
     int err;
-    bool was_cross_thread_work_scheduled = false;
     { /* BEGIN CRITICAL SECTION */
-        s_acquire_stream_and_connection_lock(h2_stream, connection);
+        s_lock_stream_synced_data(h2_stream);
 
         if (stream->id) {
             /* stream has already been activated. */
-            s_release_stream_and_connection_lock(h2_stream, connection);
+            s_unlock_stream_synced_data(h2_stream);
             return AWS_OP_SUCCESS;
         }
 
-        err = connection->synced_data.new_stream_error_code;
+        err = (int)aws_atomic_load_int(&connection->synced_data.new_stream_error_code);
         if (err) {
-            s_release_stream_and_connection_lock(h2_stream, connection);
+            s_unlock_stream_synced_data(h2_stream);
             goto error;
         }
 
-        stream->id = aws_http_connection_get_next_stream_id(base_connection);
-
-        if (stream->id) {
-            /* success */
-            was_cross_thread_work_scheduled = connection->synced_data.is_cross_thread_work_task_scheduled;
-            connection->synced_data.is_cross_thread_work_task_scheduled = true;
+        stream->id = s_take_next_stream_id(connection);
+        if (!stream->id) {
+            s_unlock_stream_synced_data(h2_stream);
+            /* s_take_next_stream_id() raises its own error. */
+            return AWS_OP_ERR;
+        }
 
-            aws_linked_list_push_back(&connection->synced_data.pending_stream_list, &h2_stream->node);
-            h2_stream->synced_data.api_state = AWS_H2_STREAM_API_STATE_ACTIVE;
+        h2_stream->synced_data.api_state = AWS_H2_STREAM_API_STATE_ACTIVE;
+        aws_high_res_clock_get_ticks((uint64_t *)&stream->metrics.activate_timestamp_ns);
+        stream->metrics.stream_id = stream->id;
+
+        /* connection keeps activated stream alive until stream completes.
+         * Take that ref before the stream is queued, since the connection may complete it right away */
+        aws_atomic_fetch_add(&stream->refcount, 1);
+
+        if (!aws_http_mpsc_queue_push(&connection->synced_data.pending_stream_queue, &h2_stream->node)) {
+            /* Connection shut down since the error code was checked. Undo, as if it had been rejected then */
+            aws_atomic_fetch_sub(&stream->refcount, 1);
+            h2_stream->synced_data.api_state = AWS_H2_STREAM_API_STATE_INIT;
+            stream->id = 0;
+            stream->metrics.stream_id = 0;
+            s_unlock_stream_synced_data(h2_stream);
+            err = AWS_ERROR_HTTP_CONNECTION_CLOSED;
+            goto error;
         }
 
-        s_release_stream_and_connection_lock(h2_stream, connection);
+        s_unlock_stream_synced_data(h2_stream);
     } /* END CRITICAL SECTION */
 
-    if (!stream->id) {
-        /* aws_http_connection_get_next_stream_id() raises its own error. */
-        return AWS_OP_ERR;
-    }
-
-    /* connection keeps activated stream alive until stream completes */
-    aws_atomic_fetch_add(&stream->refcount, 1);
-    stream->metrics.stream_id = stream->id;
+    AWS_HTTP_TRACE(AWS_HTTP_TRACE_STREAM_ACTIVATE, stream, stream->id, 0);
 
-    if (!was_cross_thread_work_scheduled) {
-        CONNECTION_LOG(TRACE, connection, "Scheduling cross-thread work task");
-        aws_channel_schedule_task_now(connection->base.channel_slot->channel, &connection->cross_thread_work_task);
-    }
+    s_schedule_cross_thread_work(connection);
 
     return AWS_OP_SUCCESS;
 
@@ -2097,12 +3028,7 @@ static struct aws_http_stream *s_connection_make_request(
         return NULL;
     }
 
-    int new_stream_error_code;
-    { /* BEGIN CRITICAL SECTION */
-        s_lock_synced_data(connection);
-        new_stream_error_code = connection->synced_data.new_stream_error_code;
-        s_unlock_synced_data(connection);
-    } /* END CRITICAL SECTION */
+    int new_stream_error_code = (int)aws_atomic_load_int(&connection->synced_data.new_stream_error_code);
     if (new_stream_error_code) {
         aws_raise_error(new_stream_error_code);
         CONNECTION_LOGF(
@@ -2135,9 +3061,9 @@ static void s_connection_stop_new_request(struct aws_http_connection *connection
 
     { /* BEGIN CRITICAL SECTION */
         s_lock_synced_data(connection);
-        if (!connection->synced_data.new_stream_error_code) {
-            connection->synced_data.new_stream_error_code = AWS_ERROR_HTTP_CONNECTION_CLOSED;
-        }
+        size_t no_error = AWS_ERROR_SUCCESS;
+        aws_atomic_compare_exchange_int(
+            &connection->synced_data.new_stream_error_code, &no_error, AWS_ERROR_HTTP_CONNECTION_CLOSED);
         s_unlock_synced_data(connection);
     } /* END CRITICAL SECTION */
 }
@@ -2157,13 +3083,7 @@ static bool s_connection_is_open(const struct aws_http_connection *connection_ba
 
 static bool s_connection_new_requests_allowed(const struct aws_http_connection *connection_base) {
     struct aws_h2_connection *connection = AWS_CONTAINER_OF(connection_base, struct aws_h2_connection, base);
-    int new_stream_error_code;
-    { /* BEGIN CRITICAL SECTION */
-        s_lock_synced_data(connection);
-        new_stream_error_code = connection->synced_data.new_stream_error_code;
-        s_unlock_synced_data(connection);
-    } /* END CRITICAL SECTION */
-    return new_stream_error_code == 0;
+    return aws_atomic_load_int(&connection->synced_data.new_stream_error_code) == 0;
 }
 
 static void s_connection_update_window(struct aws_http_connection *connection_base, uint32_t increment_size) {
@@ -2180,58 +3100,22 @@ static void s_connection_update_window(struct aws_http_connection *connection_ba
             "Connection manual window management is off, update window operations are not supported.");
         return;
     }
-    struct aws_h2_frame *connection_window_update_frame =
-        aws_h2_frame_new_window_update(connection->base.alloc, 0, increment_size);
-    if (!connection_window_update_frame) {
-        CONNECTION_LOGF(
-            ERROR,
-            connection,
-            "Failed to create WINDOW_UPDATE frame on connection, error %s",
-            aws_error_name(aws_last_error()));
-        /* OOM should result in a crash. And the increment size is too huge is the only other failure case, which will
-         * result in overflow. */
-        goto overflow;
-    }
-
-    int err = 0;
-    bool cross_thread_work_should_schedule = false;
-    bool connection_open = false;
+    /* Add to the pending update without a lock. The cross-thread work task sends all of it in one frame */
     size_t sum_size = 0;
-    { /* BEGIN CRITICAL SECTION */
-        s_lock_synced_data(connection);
-
-        err |= aws_add_size_checked(connection->synced_data.window_update_size, increment_size, &sum_size);
-        err |= sum_size > AWS_H2_WINDOW_UPDATE_MAX;
-        connection_open = connection->synced_data.is_open;
-
-        if (!err && connection_open) {
-            cross_thread_work_should_schedule = !connection->synced_data.is_cross_thread_work_task_scheduled;
-            connection->synced_data.is_cross_thread_work_task_scheduled = true;
-            aws_linked_list_push_back(
-                &connection->synced_data.pending_frame_list, &connection_window_update_frame->node);
-            connection->synced_data.window_update_size = sum_size;
+    size_t pending_size = aws_atomic_load_int(&connection->synced_data.window_update_size);
+    do {
+        if (aws_add_size_checked(pending_size, increment_size, &sum_size) || sum_size > AWS_H2_WINDOW_UPDATE_MAX) {
+            CONNECTION_LOG(
+                ERROR,
+                connection,
+                "The connection's flow-control windows has been incremented beyond 2**31 -1, the max for HTTP/2. The ");
+            goto overflow;
         }
-        s_unlock_synced_data(connection);
-    } /* END CRITICAL SECTION */
-    if (err) {
-        CONNECTION_LOG(
-            ERROR,
-            connection,
-            "The connection's flow-control windows has been incremented beyond 2**31 -1, the max for HTTP/2. The ");
-        aws_h2_frame_destroy(connection_window_update_frame);
-        goto overflow;
-    }
+    } while (!aws_atomic_compare_exchange_int(&connection->synced_data.window_update_size, &pending_size, sum_size));
 
-    if (cross_thread_work_should_schedule) {
-        CONNECTION_LOG(TRACE, connection, "Scheduling cross-thread work task");
-        aws_channel_schedule_task_now(connection->base.channel_slot->channel, &connection->cross_thread_work_task);
-    }
+    /* If the connection has closed, the update is dropped along with the rest of its outgoing frames */
+    s_schedule_cross_thread_work(connection);
 
-    if (!connection_open) {
-        /* connection already closed, just do nothing */
-        aws_h2_frame_destroy(connection_window_update_frame);
-        return;
-    }
     CONNECTION_LOGF(
         TRACE,
         connection,
@@ -2276,7 +3160,6 @@ static int s_connection_change_settings(
         return AWS_OP_ERR;
     }
 
-    bool was_cross_thread_work_scheduled = false;
     bool connection_open;
     { /* BEGIN CRITICAL SECTION */
         s_lock_synced_data(connection);
@@ -2286,18 +3169,13 @@ static int s_connection_change_settings(
             s_unlock_synced_data(connection);
             goto closed;
         }
-        was_cross_thread_work_scheduled = connection->synced_data.is_cross_thread_work_task_scheduled;
-        connection->synced_data.is_cross_thread_work_task_scheduled = true;
         aws_linked_list_push_back(&connection->synced_data.pending_frame_list, &settings_frame->node);
         aws_linked_list_push_back(&connection->synced_data.pending_settings_list, &pending_settings->node);
 
         s_unlock_synced_data(connection);
     } /* END CRITICAL SECTION */
 
-    if (!was_cross_thread_work_scheduled) {
-        CONNECTION_LOG(TRACE, connection, "Scheduling cross-thread work task");
-        aws_channel_schedule_task_now(connection->base.channel_slot->channel, &connection->cross_thread_work_task);
-    }
+    s_schedule_cross_thread_work(connection);
 
     return AWS_OP_SUCCESS;
 closed:
@@ -2340,7 +3218,6 @@ static int s_connection_send_ping(
         return AWS_OP_ERR;
     }
 
-    bool was_cross_thread_work_scheduled = false;
     bool connection_open;
     { /* BEGIN CRITICAL SECTION */
         s_lock_synced_data(connection);
@@ -2350,18 +3227,13 @@ static int s_connection_send_ping(
             s_unlock_synced_data(connection);
             goto closed;
         }
-        was_cross_thread_work_scheduled = connection->synced_data.is_cross_thread_work_task_scheduled;
-        connection->synced_data.is_cross_thread_work_task_scheduled = true;
         aws_linked_list_push_back(&connection->synced_data.pending_frame_list, &ping_frame->node);
         aws_linked_list_push_back(&connection->synced_data.pending_ping_list, &pending_ping->node);
 
         s_unlock_synced_data(connection);
     } /* END CRITICAL SECTION */
 
-    if (!was_cross_thread_work_scheduled) {
-        CONNECTION_LOG(TRACE, connection, "Scheduling cross-thread work task");
-        aws_channel_schedule_task_now(connection->base.channel_slot->channel, &connection->cross_thread_work_task);
-    }
+    s_schedule_cross_thread_work(connection);
 
     return AWS_OP_SUCCESS;
 
@@ -2382,7 +3254,6 @@ static void s_connection_send_goaway(
     struct aws_h2_pending_goaway *pending_goaway =
         s_new_pending_goaway(connection->base.alloc, http2_error, allow_more_streams, optional_debug_data);
 
-    bool was_cross_thread_work_scheduled = false;
     bool connection_open;
     { /* BEGIN CRITICAL SECTION */
         s_lock_synced_data(connection);
@@ -2394,8 +3265,6 @@ static void s_connection_send_goaway(
             aws_mem_release(connection->base.alloc, pending_goaway);
             return;
         }
-        was_cross_thread_work_scheduled = connection->synced_data.is_cross_thread_work_task_scheduled;
-        connection->synced_data.is_cross_thread_work_task_scheduled = true;
         aws_linked_list_push_back(&connection->synced_data.pending_goaway_list, &pending_goaway->node);
         s_unlock_synced_data(connection);
     } /* END CRITICAL SECTION */
@@ -2409,10 +3278,7 @@ static void s_connection_send_goaway(
             http2_error);
     }
 
-    if (!was_cross_thread_work_scheduled) {
-        CONNECTION_LOG(TRACE, connection, "Scheduling cross-thread work task");
-        aws_channel_schedule_task_now(connection->base.channel_slot->channel, &connection->cross_thread_work_task);
-    }
+    s_schedule_cross_thread_work(connection);
 }
 
 static void s_get_settings_general(
@@ -2421,7 +3287,7 @@ static void s_get_settings_general(
     bool local) {
 
     struct aws_h2_connection *connection = AWS_CONTAINER_OF(connection_base, struct aws_h2_connection, base);
-    uint32_t synced_settings[AWS_HTTP2_SETTINGS_END_RANGE];
+    uint32_t synced_settings[AWS_H2_SETTINGS_END_RANGE];
     { /* BEGIN CRITICAL SECTION */
         s_lock_synced_data(connection);
         if (local) {
@@ -2453,6 +3319,47 @@ static void s_connection_get_remote_settings(
     s_get_settings_general(connection_base, out_settings, false /*local*/);
 }
 
+static bool s_get_enable_connect_protocol_general(const struct aws_http_connection *connection_base, bool local) {
+    struct aws_h2_connection *connection = AWS_CONTAINER_OF(connection_base, struct aws_h2_connection, base);
+    uint32_t value = 0;
+    { /* BEGIN CRITICAL SECTION */
+        s_lock_synced_data(connection);
+        if (local) {
+            value = connection->synced_data.settings_self[AWS_HTTP2_SETTINGS_ENABLE_CONNECT_PROTOCOL];
+        } else {
+            value = connection->synced_data.settings_peer[AWS_HTTP2_SETTINGS_ENABLE_CONNECT_PROTOCOL];
+        }
+        s_unlock_synced_data(connection);
+    } /* END CRITICAL SECTION */
+    return value == 1;
+}
+
+static bool s_connection_get_local_enable_connect_protocol(const struct aws_http_connection *connection_base) {
+    return s_get_enable_connect_protocol_general(connection_base, true /*local*/);
+}
+
+static bool s_connection_get_remote_enable_connect_protocol(const struct aws_http_connection *connection_base) {
+    return s_get_enable_connect_protocol_general(connection_base, false /*local*/);
+}
+
+static int s_connection_get_rtt_estimate(
+    const struct aws_http_connection *connection_base,
+    struct aws_http2_rtt_estimate *out_estimate) {
+
+    struct aws_h2_connection *connection = AWS_CONTAINER_OF(connection_base, struct aws_h2_connection, base);
+    { /* BEGIN CRITICAL SECTION */
+        s_lock_synced_data(connection);
+        *out_estimate = connection->synced_data.rtt_estimate;
+        s_unlock_synced_data(connection);
+    } /* END CRITICAL SECTION */
+
+    if (out_estimate->sample_count == 0) {
+        CONNECTION_LOG(ERROR, connection, "No round-trip time sample has been taken yet.");
+        return aws_raise_error(AWS_ERROR_HTTP_DATA_NOT_AVAILABLE);
+    }
+    return AWS_OP_SUCCESS;
+}
+
 /* Send a GOAWAY with the lowest possible last-stream-id or graceful shutdown warning */
 static void s_send_goaway(
     struct aws_h2_connection *connection,
@@ -2481,7 +3388,7 @@ static void s_send_goaway(
     }
 
     struct aws_h2_frame *goaway =
-        aws_h2_frame_new_goaway(connection->base.alloc, last_stream_id, h2_error_code, debug_data);
+        aws_h2_frame_new_goaway(&connection->frame_pool.allocator, last_stream_id, h2_error_code, debug_data);
     if (!goaway) {
         CONNECTION_LOGF(ERROR, connection, "Error creating GOAWAY frame, %s", aws_error_name(aws_last_error()));
         goto error;
@@ -2575,6 +3482,7 @@ static int s_handler_process_read_message(
     /* Any error that bubbles up from the decoder or its callbacks is treated as
      * a Connection Error (a GOAWAY frames is sent, and the connection is closed) */
     struct aws_byte_cursor message_cursor = aws_byte_cursor_from_buf(&message->message_data);
+    connection->thread_data.read_message = message;
     struct aws_h2err err = aws_h2_decode(connection->thread_data.decoder, &message_cursor);
     if (aws_h2err_failed(err)) {
         CONNECTION_LOGF(
@@ -2587,6 +3495,11 @@ static int s_handler_process_read_message(
         goto shutdown;
     }
 
+    /* Frames from the peer keep an idle server connection alive, as long as no stream is in progress */
+    if (connection->base.server_data && aws_h2_stream_table_get_count(&connection->thread_data.active_streams) == 0) {
+        aws_http_connection_server_timeouts_on_idle(&connection->base);
+    }
+
     /* HTTP/2 protocol uses WINDOW_UPDATE frames to coordinate data rates with peer,
      * so we can just keep the aws_channel's read-window wide open */
     if (aws_channel_slot_increment_read_window(slot, message->message_data.len)) {
@@ -2608,10 +3521,23 @@ shutdown:
     s_stop(connection, true /*stop_reading*/, false /*stop_writing*/, true /*schedule_shutdown*/, err.aws_code);
 
 clean_up:
-    aws_mem_release(message->allocator, message);
+    connection->thread_data.read_message = NULL;
+    if (connection->thread_data.leased_message) {
+        /* Body leases may outlive the message's processing */
+        struct aws_http_leased_message *leased_message = connection->thread_data.leased_message;
+        connection->thread_data.leased_message = NULL;
+        if (aws_http_leased_message_release(leased_message) && s_connection_window_uses_read_budget(connection)) {
+            /* The peer's flow-control windows don't cover it anymore, so the budget has to */
+            leased_message->counted_bytes = message->message_data.len;
+            connection->thread_data.leased_bytes += message->message_data.len;
+        }
+    } else {
+        aws_mem_release(message->allocator, message);
+    }
 
     /* Flush any outgoing frames that might have been queued as a result of decoder callbacks. */
     aws_h2_try_write_outgoing_frames(connection);
+    s_update_memory_usage(connection);
 
     return AWS_OP_SUCCESS;
 }
@@ -2655,6 +3581,8 @@ static int s_handler_shutdown(
         aws_error_name(error_code));
 
     if (dir == AWS_CHANNEL_DIR_READ) {
+        aws_http_connection_stop_server_timeouts(&connection->base);
+
         /* This call ensures that no further streams will be created. */
         s_stop(connection, true /*stop_reading*/, false /*stop_writing*/, false /*schedule_shutdown*/, error_code);
         /* Send user requested GOAWAY, if they haven't been sent before. It's OK to access
@@ -2692,7 +3620,8 @@ static int s_handler_shutdown(
         /* We'd prefer to wait until we know GOAWAY has been written, but don't wait if... */
         if (free_scarce_resources_immediately /* we must finish ASAP */ ||
             connection->thread_data.is_writing_stopped /* write will never complete */ ||
-            !connection->thread_data.is_outgoing_frames_task_active /* write is already complete */) {
+            (!connection->thread_data.is_outgoing_frames_task_active &&
+             connection->thread_data.write_messages_in_flight == 0) /* write is already complete */) {
 
             s_finish_shutdown(connection);
         } else {
@@ -2720,23 +3649,29 @@ static void s_finish_shutdown(struct aws_h2_connection *connection) {
 
     /* Remove remaining streams from internal datastructures and mark them as complete. */
 
-    struct aws_hash_iter stream_iter = aws_hash_iter_begin(&connection->thread_data.active_streams_map);
-    while (!aws_hash_iter_done(&stream_iter)) {
-        struct aws_h2_stream *stream = stream_iter.element.value;
-        aws_hash_iter_delete(&stream_iter, true);
-        aws_hash_iter_next(&stream_iter);
+    struct aws_h2_stream_table_iter stream_iter =
+        aws_h2_stream_table_iter_begin(&connection->thread_data.active_streams);
+    while (!aws_h2_stream_table_iter_done(&stream_iter)) {
+        struct aws_h2_stream *stream = stream_iter.stream;
+        aws_h2_stream_table_iter_next(&stream_iter);
 
+        /* s_stream_complete() removes the stream from the table, which is safe while iterating */
         s_stream_complete(connection, stream, AWS_ERROR_HTTP_CONNECTION_CLOSED);
     }
 
-    /* It's OK to access synced_data without holding the lock because
-     * no more streams or user-requested control frames can be added after s_stop() has been invoked. */
-    while (!aws_linked_list_empty(&connection->synced_data.pending_stream_list)) {
-        struct aws_linked_list_node *node = aws_linked_list_pop_front(&connection->synced_data.pending_stream_list);
+    /* Streams are activated without the lock, one may have checked for errors just before s_stop().
+     * Closing the queue makes any later activation fail instead of leaving its stream here */
+    aws_http_mpsc_queue_close(
+        &connection->synced_data.pending_stream_queue, &connection->thread_data.pending_stream_list);
+    while (!aws_linked_list_empty(&connection->thread_data.pending_stream_list)) {
+        struct aws_linked_list_node *node = aws_linked_list_pop_front(&connection->thread_data.pending_stream_list);
         struct aws_h2_stream *stream = AWS_CONTAINER_OF(node, struct aws_h2_stream, node);
         s_stream_complete(connection, stream, AWS_ERROR_HTTP_CONNECTION_CLOSED);
     }
 
+    /* It's OK to access synced_data without holding the lock because
+     * no more user-requested control frames can be added after s_stop() has been invoked. */
+
     while (!aws_linked_list_empty(&connection->synced_data.pending_frame_list)) {
         struct aws_linked_list_node *node = aws_linked_list_pop_front(&connection->synced_data.pending_frame_list);
         struct aws_h2_frame *frame = AWS_CONTAINER_OF(node, struct aws_h2_frame, node);
@@ -2807,7 +3742,7 @@ static size_t s_handler_message_overhead(struct aws_channel_handler *handler) {
 static void s_reset_statistics(struct aws_channel_handler *handler) {
     struct aws_h2_connection *connection = handler->impl;
     aws_crt_statistics_http2_channel_reset(&connection->thread_data.stats);
-    if (aws_hash_table_get_entry_count(&connection->thread_data.active_streams_map) == 0) {
+    if (aws_h2_stream_table_get_count(&connection->thread_data.active_streams) == 0) {
         /* Check the current state */
         connection->thread_data.stats.was_inactive = true;
     }
@@ -2827,7 +3762,7 @@ static void s_gather_statistics(struct aws_channel_handler *handler, struct aws_
         return;
     }
 
-    if (!aws_linked_list_empty(&connection->thread_data.outgoing_streams_list)) {
+    if (s_has_outgoing_streams(connection)) {
         s_add_time_measurement_to_stats(
             connection->thread_data.outgoing_timestamp_ns,
             now_ns,
@@ -2835,7 +3770,7 @@ static void s_gather_statistics(struct aws_channel_handler *handler, struct aws_
 
         connection->thread_data.outgoing_timestamp_ns = now_ns;
     }
-    if (aws_hash_table_get_entry_count(&connection->thread_data.active_streams_map) != 0) {
+    if (aws_h2_stream_table_get_count(&connection->thread_data.active_streams) != 0) {
         s_add_time_measurement_to_stats(
             connection->thread_data.incoming_timestamp_ns,
             now_ns,
@@ -2845,6 +3780,56 @@ static void s_gather_statistics(struct aws_channel_handler *handler, struct aws_
     } else {
         connection->thread_data.stats.was_inactive = true;
     }
+    if (connection->thread_data.is_connection_window_stalled) {
+        s_add_time_measurement_to_stats(
+            connection->thread_data.connection_window_stall_timestamp_ns,
+            now_ns,
+            &connection->thread_data.stats.connection_window_stalled_ms);
+
+        connection->thread_data.connection_window_stall_timestamp_ns = now_ns;
+    }
+    connection->thread_data.stats.active_stream_count =
+        (uint32_t)aws_h2_stream_table_get_count(&connection->thread_data.active_streams);
+
+    /* Include waits that are still going on, so the monitor doesn't have to wait for them to end */
+    struct aws_h2_stream_table_iter stream_iter =
+        aws_h2_stream_table_iter_begin(&connection->thread_data.active_streams);
+    while (!aws_h2_stream_table_iter_done(&stream_iter)) {
+        aws_http_stream_update_max_first_byte_latency(
+            &stream_iter.stream->base, &connection->thread_data.stats.max_first_byte_latency_ms);
+        aws_h2_stream_table_iter_next(&stream_iter);
+    }
+
+    if (!aws_linked_list_empty(&connection->thread_data.pending_ping_queue)) {
+        /* PINGs are ACKed in order, the oldest has been waiting the longest */
+        struct aws_h2_pending_ping *oldest_ping = AWS_CONTAINER_OF(
+            aws_linked_list_front(&connection->thread_data.pending_ping_queue), struct aws_h2_pending_ping, node);
+        if (now_ns > oldest_ping->started_time) {
+            connection->thread_data.stats.max_ping_rtt_ms = aws_max_u64(
+                connection->thread_data.stats.max_ping_rtt_ms,
+                aws_timestamp_convert(
+                    now_ns - oldest_ping->started_time, AWS_TIMESTAMP_NANOS, AWS_TIMESTAMP_MILLIS, NULL));
+        }
+    }
+
+    uint64_t oldest_stall_timestamp_ns = now_ns;
+    if (connection->thread_data.is_connection_window_stalled) {
+        oldest_stall_timestamp_ns = connection->thread_data.connection_window_stall_began_ns;
+    }
+    const struct aws_linked_list *stalled_window_streams_list = &connection->thread_data.stalled_window_streams_list;
+    for (struct aws_linked_list_node *node = aws_linked_list_begin(stalled_window_streams_list);
+         node != aws_linked_list_end(stalled_window_streams_list);
+         node = aws_linked_list_next(node)) {
+        struct aws_h2_stream *stream = AWS_CONTAINER_OF(node, struct aws_h2_stream, node);
+        oldest_stall_timestamp_ns =
+            aws_min_u64(oldest_stall_timestamp_ns, stream->thread_data.window_stall_timestamp_ns);
+    }
+    connection->thread_data.stats.current_window_stall_ms =
+        aws_timestamp_convert(now_ns - oldest_stall_timestamp_ns, AWS_TIMESTAMP_NANOS, AWS_TIMESTAMP_MILLIS, NULL);
+    connection->thread_data.stats.smoothed_rtt_ms = aws_timestamp_convert(
+        connection->thread_data.rtt_estimate.smoothed_rtt_ns, AWS_TIMESTAMP_NANOS, AWS_TIMESTAMP_MILLIS, NULL);
+    connection->thread_data.stats.rtt_variation_ms = aws_timestamp_convert(
+        connection->thread_data.rtt_estimate.rtt_variation_ns, AWS_TIMESTAMP_NANOS, AWS_TIMESTAMP_MILLIS, NULL);
 
     void *stats_base = &connection->thread_data.stats;
     aws_array_list_push_back(stats, &stats_base);
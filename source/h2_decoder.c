@@ -6,6 +6,7 @@
 
 #include <aws/http/private/hpack.h>
 #include <aws/http/private/strutil.h>
+#include <aws/http/private/tracing_impl.h>
 
 #include <aws/common/string.h>
 #include <aws/http/status_code.h>
@@ -30,6 +31,13 @@ static const uint32_t s_31_bit_mask = UINT32_MAX >> 1;
 /* initial size for cookie buffer, buffer will grow if needed */
 static const size_t s_decoder_cookie_buffer_initial_size = 512;
 
+/* Enough for the pseudo-header values of typical requests and responses. Grows for unusually long ones (ex: :path) */
+static const size_t s_decoder_pseudoheader_buffer_initial_size = 256;
+
+/* initial sizes for collect_header_blocks, these will grow if needed */
+static const size_t s_decoder_header_collection_initial_count = 32;
+static const size_t s_decoder_header_collection_arena_initial_size = 1024;
+
 #define DECODER_LOGF(level, decoder, text, ...)                                                                        \
     AWS_LOGF_##level(AWS_LS_HTTP_DECODER, "id=%p " text, (decoder)->logging_id, __VA_ARGS__)
 #define DECODER_LOG(level, decoder, text) DECODER_LOGF(level, decoder, "%s", text)
@@ -196,6 +204,7 @@ struct aws_h2_decoder {
     struct aws_hpack_decoder hpack;
     bool is_server;
     struct aws_byte_buf scratch;
+    struct aws_crt_statistics_http2_channel *stats;
     const struct h2_decoder_state *state;
     bool state_changed;
 
@@ -240,9 +249,16 @@ struct aws_h2_decoder {
         /* Whether these are informational (1xx), normal, or trailing headers */
         enum aws_http_header_block block_type;
 
-        /* Buffer up pseudo-headers and deliver them once they're all validated */
-        struct aws_string *pseudoheader_values[PSEUDOHEADER_COUNT];
+        /* Buffer up pseudo-headers and deliver them once they're all validated.
+         * Values are copied back to back into pseudoheader_storage, which is kept between header-blocks.
+         * Offsets are used since the storage may move as it grows */
+        struct aws_pseudoheader_value {
+            bool is_set;
+            size_t offset;
+            size_t len;
+        } pseudoheader_values[PSEUDOHEADER_COUNT];
         enum aws_http_header_compression pseudoheader_compression[PSEUDOHEADER_COUNT];
+        struct aws_byte_buf pseudoheader_storage;
 
         /* All pseudo-header fields MUST appear in the header block before regular header fields. */
         bool pseudoheaders_done;
@@ -269,6 +285,18 @@ struct aws_h2_decoder {
         enum aws_http_header_compression cookie_header_compression_type;
     } header_block_in_progress;
 
+    /* Used when collect_header_blocks is set.
+     * Header-fields of the HEADERS header-block in progress are copied here, then delivered all at once.
+     * Names and values are appended to string_arena in order (name, value, name, value...).
+     * Since the arena may move as it grows, the cursors in header_array only get their ptr once collection is done.
+     * Memory is kept between header-blocks, so a connection quickly stops allocating for this. */
+    struct aws_header_collection {
+        bool enabled;
+        struct aws_array_list header_array;    /* aws_http_header */
+        struct aws_array_list name_enum_array; /* enum aws_http_header_name */
+        struct aws_byte_buf string_arena;
+    } header_collection;
+
     /* Settings for decoder, which is based on the settings sent to the peer and ACKed by peer */
     struct {
         /* enable/disable server push */
@@ -309,6 +337,7 @@ struct aws_h2_decoder *aws_h2_decoder_new(struct aws_h2_decoder_params *params)
     decoder->userdata = params->userdata;
     decoder->logging_id = params->logging_id;
     decoder->is_server = params->is_server;
+    decoder->stats = params->stats;
     decoder->connection_preface_complete = params->skip_connection_preface;
 
     decoder->scratch = aws_byte_buf_from_empty_array(scratch_buf, s_scratch_space_size);
@@ -335,6 +364,37 @@ struct aws_h2_decoder *aws_h2_decoder_new(struct aws_h2_decoder_params *params)
         goto error;
     }
 
+    if (aws_byte_buf_init(
+            &decoder->header_block_in_progress.pseudoheader_storage,
+            decoder->alloc,
+            s_decoder_pseudoheader_buffer_initial_size)) {
+        goto error;
+    }
+
+    if (params->collect_header_blocks) {
+        decoder->header_collection.enabled = true;
+        if (aws_array_list_init_dynamic(
+                &decoder->header_collection.header_array,
+                decoder->alloc,
+                s_decoder_header_collection_initial_count,
+                sizeof(struct aws_http_header))) {
+            goto error;
+        }
+        if (aws_array_list_init_dynamic(
+                &decoder->header_collection.name_enum_array,
+                decoder->alloc,
+                s_decoder_header_collection_initial_count,
+                sizeof(enum aws_http_header_name))) {
+            goto error;
+        }
+        if (aws_byte_buf_init(
+                &decoder->header_collection.string_arena,
+                decoder->alloc,
+                s_decoder_header_collection_arena_initial_size)) {
+            goto error;
+        }
+    }
+
     return decoder;
 
 error:
@@ -342,19 +402,29 @@ error:
         aws_hpack_decoder_clean_up(&decoder->hpack);
         aws_array_list_clean_up(&decoder->settings_buffer_list);
         aws_byte_buf_clean_up(&decoder->header_block_in_progress.cookies);
+        aws_byte_buf_clean_up(&decoder->header_block_in_progress.pseudoheader_storage);
+        aws_array_list_clean_up(&decoder->header_collection.header_array);
+        aws_array_list_clean_up(&decoder->header_collection.name_enum_array);
+        aws_byte_buf_clean_up(&decoder->header_collection.string_arena);
     }
     aws_mem_release(params->alloc, allocation);
     return NULL;
 }
 
 static void s_reset_header_block_in_progress(struct aws_h2_decoder *decoder) {
-    for (size_t i = 0; i < PSEUDOHEADER_COUNT; ++i) {
-        aws_string_destroy(decoder->header_block_in_progress.pseudoheader_values[i]);
-    }
     struct aws_byte_buf cookie_backup = decoder->header_block_in_progress.cookies;
+    struct aws_byte_buf pseudoheader_storage_backup = decoder->header_block_in_progress.pseudoheader_storage;
     AWS_ZERO_STRUCT(decoder->header_block_in_progress);
     decoder->header_block_in_progress.cookies = cookie_backup;
     aws_byte_buf_reset(&decoder->header_block_in_progress.cookies, false);
+    decoder->header_block_in_progress.pseudoheader_storage = pseudoheader_storage_backup;
+    aws_byte_buf_reset(&decoder->header_block_in_progress.pseudoheader_storage, false);
+
+    if (decoder->header_collection.enabled) {
+        aws_array_list_clear(&decoder->header_collection.header_array);
+        aws_array_list_clear(&decoder->header_collection.name_enum_array);
+        aws_byte_buf_reset(&decoder->header_collection.string_arena, false);
+    }
 }
 
 void aws_h2_decoder_destroy(struct aws_h2_decoder *decoder) {
@@ -365,10 +435,87 @@ void aws_h2_decoder_destroy(struct aws_h2_decoder *decoder) {
     aws_hpack_decoder_clean_up(&decoder->hpack);
     s_reset_header_block_in_progress(decoder);
     aws_byte_buf_clean_up(&decoder->header_block_in_progress.cookies);
+    aws_byte_buf_clean_up(&decoder->header_block_in_progress.pseudoheader_storage);
+    aws_array_list_clean_up(&decoder->header_collection.header_array);
+    aws_array_list_clean_up(&decoder->header_collection.name_enum_array);
+    aws_byte_buf_clean_up(&decoder->header_collection.string_arena);
     aws_byte_buf_clean_up(&decoder->goaway_in_progress.debug_data);
     aws_mem_release(decoder->alloc, decoder);
 }
 
+/* Returns true if `data` starts with a whole DATA frame that the fast path can deliver.
+ * Anything unusual (padding, errors, header-block in progress, etc) is left to the state machine */
+static bool s_is_complete_data_frame(const struct aws_h2_decoder *decoder, const struct aws_byte_cursor *data) {
+    if (data->len < s_state_prefix_requires_9_bytes || data->ptr[3] != AWS_H2_FRAME_T_DATA ||
+        (data->ptr[4] & AWS_H2_FRAME_F_PADDED)) {
+        return false;
+    }
+
+    if (!decoder->connection_preface_complete || decoder->header_block_in_progress.stream_id) {
+        return false;
+    }
+
+    const uint32_t payload_len = ((uint32_t)data->ptr[0] << 16) | ((uint32_t)data->ptr[1] << 8) | data->ptr[2];
+    if (payload_len > decoder->settings.max_frame_size ||
+        data->len - s_state_prefix_requires_9_bytes < (size_t)payload_len) {
+        return false;
+    }
+
+    const uint32_t stream_id = (((uint32_t)data->ptr[5] << 24) | ((uint32_t)data->ptr[6] << 16) |
+                                ((uint32_t)data->ptr[7] << 8) | data->ptr[8]) &
+                               s_31_bit_mask;
+    return stream_id != 0;
+}
+
+/* Deliver a whole DATA frame, checked by s_is_complete_data_frame(), without going through the state machine.
+ * Invokes the same callbacks the states would, in the same order. */
+static struct aws_h2err s_decode_complete_data_frame(struct aws_h2_decoder *decoder, struct aws_byte_cursor *data) {
+    struct aws_frame_in_progress *frame = &decoder->frame_in_progress;
+    uint8_t raw_type = 0;
+    uint8_t raw_flags = 0;
+
+    bool all_read = true;
+    all_read &= aws_byte_cursor_read_be24(data, &frame->payload_len);
+    all_read &= aws_byte_cursor_read_u8(data, &raw_type);
+    all_read &= aws_byte_cursor_read_u8(data, &raw_flags);
+    all_read &= aws_byte_cursor_read_be32(data, &frame->stream_id);
+    AWS_ASSERT(all_read);
+    (void)all_read;
+
+    frame->type = AWS_H2_FRAME_T_DATA;
+    frame->stream_id &= s_31_bit_mask;
+    frame->flags.end_stream = raw_flags & AWS_H2_FRAME_F_END_STREAM;
+
+    if (decoder->stats) {
+        decoder->stats->frames_received[AWS_H2_FRAME_T_DATA]++;
+        decoder->stats->data_bytes_received += frame->payload_len;
+    }
+    AWS_HTTP_TRACE(AWS_HTTP_TRACE_H2_FRAME_DECODED, decoder->logging_id, frame->type, frame->stream_id);
+
+    DECODER_LOGF(
+        TRACE,
+        decoder,
+        "Decoding whole DATA frame (stream-id=%" PRIu32 " payload-len=%" PRIu32 ")",
+        frame->stream_id,
+        frame->payload_len);
+
+    DECODER_CALL_VTABLE_STREAM_ARGS(
+        decoder, on_data_begin, frame->payload_len, 0 /*padding_len*/, frame->flags.end_stream);
+
+    const struct aws_byte_cursor body_data = aws_byte_cursor_advance(data, frame->payload_len);
+    if (body_data.len) {
+        DECODER_CALL_VTABLE_STREAM_ARGS(decoder, on_data_i, body_data);
+    }
+
+    DECODER_CALL_VTABLE_STREAM(decoder, on_data_end);
+    if (frame->flags.end_stream) {
+        DECODER_CALL_VTABLE_STREAM(decoder, on_end_stream);
+    }
+
+    AWS_ZERO_STRUCT(decoder->frame_in_progress);
+    return AWS_H2ERR_SUCCESS;
+}
+
 struct aws_h2err aws_h2_decode(struct aws_h2_decoder *decoder, struct aws_byte_cursor *data) {
     AWS_PRECONDITION(decoder);
     AWS_PRECONDITION(data);
@@ -383,6 +530,16 @@ struct aws_h2err aws_h2_decode(struct aws_h2_decoder *decoder, struct aws_byte_c
     do {
         decoder->state_changed = false;
 
+        /* Fast path for bulk downloads: whole DATA frames are delivered straight from the input */
+        if (decoder->state == &s_state_prefix && !decoder->scratch.len) {
+            while (s_is_complete_data_frame(decoder, data)) {
+                err = s_decode_complete_data_frame(decoder, data);
+                if (aws_h2err_failed(err)) {
+                    goto handle_error;
+                }
+            }
+        }
+
         const uint32_t bytes_required = decoder->state->bytes_required;
         AWS_ASSERT(bytes_required <= decoder->scratch.capacity);
         const char *current_state_name = decoder->state->name;
@@ -657,6 +814,14 @@ static struct aws_h2err s_state_fn_prefix(struct aws_h2_decoder *decoder, struct
         return aws_h2err_from_h2_code(AWS_HTTP2_ERR_FRAME_SIZE_ERROR);
     }
 
+    if (decoder->stats && frame->type != AWS_H2_FRAME_T_UNKNOWN) {
+        decoder->stats->frames_received[frame->type]++;
+        if (frame->type == AWS_H2_FRAME_T_DATA) {
+            decoder->stats->data_bytes_received += frame->payload_len;
+        }
+    }
+    AWS_HTTP_TRACE(AWS_HTTP_TRACE_H2_FRAME_DECODED, decoder->logging_id, frame->type, frame->stream_id);
+
     DECODER_LOGF(
         TRACE,
         decoder,
@@ -819,6 +984,10 @@ static struct aws_h2err s_state_fn_frame_rst_stream(struct aws_h2_decoder *decod
 
     decoder->frame_in_progress.payload_len -= s_state_frame_rst_stream_requires_4_bytes;
 
+    if (decoder->stats && error_code < AWS_HTTP2_ERR_COUNT) {
+        decoder->stats->rst_streams_received[error_code]++;
+    }
+
     DECODER_CALL_VTABLE_STREAM_ARGS(decoder, on_rst_stream, error_code);
 
     return s_decoder_reset_state(decoder);
@@ -904,7 +1073,7 @@ static struct aws_h2err s_state_fn_frame_settings_i(struct aws_h2_decoder *decod
 
     /* An endpoint that receives a SETTINGS frame with any unknown or unsupported identifier MUST ignore that setting.
      * RFC-7540 6.5.2 */
-    if (id >= AWS_HTTP2_SETTINGS_BEGIN_RANGE && id < AWS_HTTP2_SETTINGS_END_RANGE) {
+    if (aws_h2_settings_id_is_known(id)) {
         /* check the value meets the settings bounds */
         if (value < aws_h2_settings_bounds[id][0] || value > aws_h2_settings_bounds[id][1]) {
             DECODER_LOGF(
@@ -1123,8 +1292,83 @@ static struct aws_h2err s_state_fn_frame_unknown(struct aws_h2_decoder *decoder,
     return AWS_H2ERR_SUCCESS;
 }
 
+/* Deliver a validated header-field via callback, or collect it if collect_header_blocks is set */
+static struct aws_h2err s_deliver_header_field(
+    struct aws_h2_decoder *decoder,
+    const struct aws_http_header *header_field,
+    enum aws_http_header_name name_enum) {
+
+    struct aws_header_block_in_progress *current_block = &decoder->header_block_in_progress;
+    if (current_block->is_push_promise) {
+        DECODER_CALL_VTABLE_STREAM_ARGS(decoder, on_push_promise_i, header_field, name_enum);
+        return AWS_H2ERR_SUCCESS;
+    }
+
+    struct aws_header_collection *collection = &decoder->header_collection;
+    if (!collection->enabled) {
+        DECODER_CALL_VTABLE_STREAM_ARGS(decoder, on_headers_i, header_field, name_enum, current_block->block_type);
+        return AWS_H2ERR_SUCCESS;
+    }
+
+    /* Copy strings into the arena. Cursor pointers are filled in once the whole block is collected */
+    if (aws_byte_buf_append_dynamic(&collection->string_arena, &header_field->name) ||
+        aws_byte_buf_append_dynamic(&collection->string_arena, &header_field->value)) {
+        return aws_h2err_from_last_error();
+    }
+
+    struct aws_http_header collected = {
+        .name = {.len = header_field->name.len},
+        .value = {.len = header_field->value.len},
+        .compression = header_field->compression,
+    };
+    if (aws_array_list_push_back(&collection->header_array, &collected) ||
+        aws_array_list_push_back(&collection->name_enum_array, &name_enum)) {
+        return aws_h2err_from_last_error();
+    }
+
+    return AWS_H2ERR_SUCCESS;
+}
+
+/* Deliver every header-field collected for the HEADERS header-block in a single callback */
+static struct aws_h2err s_deliver_collected_header_block(struct aws_h2_decoder *decoder) {
+    struct aws_header_collection *collection = &decoder->header_collection;
+
+    struct aws_http_header *header_array = collection->header_array.data;
+    size_t num_headers = aws_array_list_length(&collection->header_array);
+
+    /* The arena is done growing, point cursors at their strings */
+    uint8_t *string_ptr = collection->string_arena.buffer;
+    for (size_t i = 0; i < num_headers; ++i) {
+        header_array[i].name.ptr = string_ptr;
+        string_ptr += header_array[i].name.len;
+        header_array[i].value.ptr = string_ptr;
+        string_ptr += header_array[i].value.len;
+    }
+    AWS_ASSERT(string_ptr == collection->string_arena.buffer + collection->string_arena.len);
+
+    DECODER_LOGF(TRACE, decoder, "Delivering header-block with %zu header-fields", num_headers);
+    DECODER_CALL_VTABLE_STREAM_ARGS(
+        decoder,
+        on_headers_block,
+        header_array,
+        collection->name_enum_array.data,
+        num_headers,
+        decoder->header_block_in_progress.block_type);
+
+    return AWS_H2ERR_SUCCESS;
+}
+
 /* Perform analysis that can't be done until all pseudo-headers are received.
  * Then deliver buffered pseudoheaders via callback */
+static struct aws_byte_cursor s_get_pseudoheader_value(
+    const struct aws_header_block_in_progress *current_block,
+    enum pseudoheader_name pseudoheader) {
+
+    const struct aws_pseudoheader_value *value = &current_block->pseudoheader_values[pseudoheader];
+    AWS_ASSERT(value->is_set);
+    return aws_byte_cursor_from_array(current_block->pseudoheader_storage.buffer + value->offset, value->len);
+}
+
 static struct aws_h2err s_flush_pseudoheaders(struct aws_h2_decoder *decoder) {
     struct aws_header_block_in_progress *current_block = &decoder->header_block_in_progress;
 
@@ -1140,13 +1384,13 @@ static struct aws_h2err s_flush_pseudoheaders(struct aws_h2_decoder *decoder) {
     /* s_process_header_field() already checked that we're not mixing request & response pseudoheaders */
     bool has_request_pseudoheaders = false;
     for (int i = PSEUDOHEADER_METHOD; i <= PSEUDOHEADER_PATH; ++i) {
-        if (current_block->pseudoheader_values[i] != NULL) {
+        if (current_block->pseudoheader_values[i].is_set) {
             has_request_pseudoheaders = true;
             break;
         }
     }
 
-    bool has_response_pseudoheaders = current_block->pseudoheader_values[PSEUDOHEADER_STATUS] != NULL;
+    bool has_response_pseudoheaders = current_block->pseudoheader_values[PSEUDOHEADER_STATUS].is_set;
 
     if (current_block->is_push_promise && !has_request_pseudoheaders) {
         DECODER_LOG(ERROR, decoder, "PUSH_PROMISE is missing :method");
@@ -1161,8 +1405,7 @@ static struct aws_h2err s_flush_pseudoheaders(struct aws_h2_decoder *decoder) {
         /* Response header block. */
 
         /* Determine whether this is an Informational (1xx) response */
-        struct aws_byte_cursor status_value =
-            aws_byte_cursor_from_string(current_block->pseudoheader_values[PSEUDOHEADER_STATUS]);
+        struct aws_byte_cursor status_value = s_get_pseudoheader_value(current_block, PSEUDOHEADER_STATUS);
         uint64_t status_code;
         if (status_value.len != 3 || aws_byte_cursor_utf8_parse_u64(status_value, &status_code)) {
             DECODER_LOG(ERROR, decoder, ":status header has invalid value");
@@ -1204,22 +1447,19 @@ static struct aws_h2err s_flush_pseudoheaders(struct aws_h2_decoder *decoder) {
 
     /* Finally, deliver header-fields via callback */
     for (size_t i = 0; i < PSEUDOHEADER_COUNT; ++i) {
-        const struct aws_string *value_string = current_block->pseudoheader_values[i];
-        if (value_string) {
+        if (current_block->pseudoheader_values[i].is_set) {
 
             struct aws_http_header header_field = {
                 .name = *s_pseudoheader_name_to_cursor[i],
-                .value = aws_byte_cursor_from_string(value_string),
+                .value = s_get_pseudoheader_value(current_block, (enum pseudoheader_name)i),
                 .compression = current_block->pseudoheader_compression[i],
             };
 
             enum aws_http_header_name name_enum = s_pseudoheader_to_header_name[i];
 
-            if (current_block->is_push_promise) {
-                DECODER_CALL_VTABLE_STREAM_ARGS(decoder, on_push_promise_i, &header_field, name_enum);
-            } else {
-                DECODER_CALL_VTABLE_STREAM_ARGS(
-                    decoder, on_headers_i, &header_field, name_enum, current_block->block_type);
+            struct aws_h2err err = s_deliver_header_field(decoder, &header_field, name_enum);
+            if (aws_h2err_failed(err)) {
+                return err;
             }
         }
     }
@@ -1287,7 +1527,7 @@ static struct aws_h2err s_process_header_field(
         }
 
         /* Protect against duplicates. */
-        if (current_block->pseudoheader_values[pseudoheader_enum] != NULL) {
+        if (current_block->pseudoheader_values[pseudoheader_enum].is_set) {
             /* ok to log name of recognized pseudo-header at ERROR level */
             DECODER_LOGF(
                 ERROR, decoder, "'" PRInSTR "' pseudo-header occurred multiple times", AWS_BYTE_CURSOR_PRI(name));
@@ -1295,12 +1535,14 @@ static struct aws_h2err s_process_header_field(
         }
 
         /* Buffer up pseudo-headers, we'll deliver them later once they're all validated. */
-        current_block->pseudoheader_compression[pseudoheader_enum] = header_field->compression;
-        current_block->pseudoheader_values[pseudoheader_enum] =
-            aws_string_new_from_cursor(decoder->alloc, &header_field->value);
-        if (!current_block->pseudoheader_values[pseudoheader_enum]) {
+        struct aws_pseudoheader_value *value = &current_block->pseudoheader_values[pseudoheader_enum];
+        value->offset = current_block->pseudoheader_storage.len;
+        if (aws_byte_buf_append_dynamic(&current_block->pseudoheader_storage, &header_field->value)) {
             return aws_h2err_from_last_error();
         }
+        value->len = header_field->value.len;
+        value->is_set = true;
+        current_block->pseudoheader_compression[pseudoheader_enum] = header_field->compression;
 
     } else { /* Else regular header-field. */
 
@@ -1372,10 +1614,9 @@ static struct aws_h2err s_process_header_field(
                 break;
         }
         /* Deliver header-field via callback */
-        if (current_block->is_push_promise) {
-            DECODER_CALL_VTABLE_STREAM_ARGS(decoder, on_push_promise_i, header_field, name_enum);
-        } else {
-            DECODER_CALL_VTABLE_STREAM_ARGS(decoder, on_headers_i, header_field, name_enum, current_block->block_type);
+        struct aws_h2err err = s_deliver_header_field(decoder, header_field, name_enum);
+        if (aws_h2err_failed(err)) {
+            return err;
         }
     }
 
@@ -1404,13 +1645,7 @@ static struct aws_h2err s_flush_cookie_header(struct aws_h2_decoder *decoder) {
     concatenated_cookie.name = header_name;
     concatenated_cookie.value = aws_byte_cursor_from_buf(&current_block->cookies);
     concatenated_cookie.compression = current_block->cookie_header_compression_type;
-    if (current_block->is_push_promise) {
-        DECODER_CALL_VTABLE_STREAM_ARGS(decoder, on_push_promise_i, &concatenated_cookie, AWS_HTTP_HEADER_COOKIE);
-    } else {
-        DECODER_CALL_VTABLE_STREAM_ARGS(
-            decoder, on_headers_i, &concatenated_cookie, AWS_HTTP_HEADER_COOKIE, current_block->block_type);
-    }
-    return AWS_H2ERR_SUCCESS;
+    return s_deliver_header_field(decoder, &concatenated_cookie, AWS_HTTP_HEADER_COOKIE);
 }
 
 /* This state checks whether we've consumed the current frame's entire header-block fragment.
@@ -1441,6 +1676,12 @@ static struct aws_h2err s_state_fn_header_block_loop(struct aws_h2_decoder *deco
             if (decoder->header_block_in_progress.is_push_promise) {
                 DECODER_CALL_VTABLE_STREAM_ARGS(decoder, on_push_promise_end, malformed);
             } else {
+                if (decoder->header_collection.enabled && !malformed) {
+                    err = s_deliver_collected_header_block(decoder);
+                    if (aws_h2err_failed(err)) {
+                        return err;
+                    }
+                }
                 DECODER_CALL_VTABLE_STREAM_ARGS(
                     decoder, on_headers_end, malformed, decoder->header_block_in_progress.block_type);
             }
@@ -1501,6 +1742,9 @@ static struct aws_h2err s_state_fn_header_block_entry(struct aws_h2_decoder *dec
     const size_t bytes_consumed = prev_fragment_len - fragment.len;
     aws_byte_cursor_advance(input, bytes_consumed);
     decoder->frame_in_progress.payload_len -= (uint32_t)bytes_consumed;
+    if (decoder->stats) {
+        decoder->stats->header_bytes_received_compressed += bytes_consumed;
+    }
 
     if (result.type == AWS_HPACK_DECODE_T_ONGOING) {
         /* HPACK decoder hasn't finished entry */
@@ -1542,6 +1786,10 @@ static struct aws_h2err s_state_fn_header_block_entry(struct aws_h2_decoder *dec
             AWS_BYTE_CURSOR_PRI(header_field->name),
             AWS_BYTE_CURSOR_PRI(header_field->value));
 
+        if (decoder->stats) {
+            decoder->stats->header_bytes_received_uncompressed += header_field->name.len + header_field->value.len;
+        }
+
         struct aws_h2err err = s_process_header_field(decoder, header_field);
         if (aws_h2err_failed(err)) {
             return err;
@@ -1583,6 +1831,25 @@ void aws_h2_decoder_set_setting_header_table_size(struct aws_h2_decoder *decoder
     aws_hpack_decoder_update_max_table_size(&decoder->hpack, data);
 }
 
+size_t aws_h2_decoder_suggest_header_table_size(struct aws_h2_decoder *decoder, size_t min_size, size_t max_size) {
+    return aws_hpack_suggest_dynamic_table_size(&decoder->hpack.context, min_size, max_size);
+}
+
+void aws_h2_decoder_add_memory_usage(
+    const struct aws_h2_decoder *decoder,
+    struct aws_http_connection_memory_usage *usage) {
+
+    usage->decoder_scratch += decoder->scratch.capacity + decoder->hpack.progress_entry.scratch.capacity +
+                              decoder->goaway_in_progress.debug_data.capacity +
+                              decoder->settings_buffer_list.current_size;
+    usage->hpack_tables += aws_hpack_get_dynamic_table_memory_usage(&decoder->hpack.context);
+    usage->buffered_headers += decoder->header_block_in_progress.cookies.capacity +
+                               decoder->header_block_in_progress.pseudoheader_storage.capacity +
+                               decoder->header_collection.header_array.current_size +
+                               decoder->header_collection.name_enum_array.current_size +
+                               decoder->header_collection.string_arena.capacity;
+}
+
 void aws_h2_decoder_set_setting_enable_push(struct aws_h2_decoder *decoder, uint32_t data) {
     decoder->settings.enable_push = data;
 }
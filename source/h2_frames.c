@@ -4,6 +4,7 @@
  */
 
 #include <aws/http/private/h2_frames.h>
+#include <aws/http/private/tracing_impl.h>
 
 #include <aws/compression/huffman.h>
 
@@ -26,16 +27,17 @@ const struct aws_byte_cursor aws_h2_connection_preface_client_string =
     AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n");
 
 /* Initial values and bounds are from RFC-7540 6.5.2 */
-const uint32_t aws_h2_settings_initial[AWS_HTTP2_SETTINGS_END_RANGE] = {
+const uint32_t aws_h2_settings_initial[AWS_H2_SETTINGS_END_RANGE] = {
     [AWS_HTTP2_SETTINGS_HEADER_TABLE_SIZE] = 4096,
     [AWS_HTTP2_SETTINGS_ENABLE_PUSH] = 1,
     [AWS_HTTP2_SETTINGS_MAX_CONCURRENT_STREAMS] = UINT32_MAX, /* "Initially there is no limit to this value" */
     [AWS_HTTP2_SETTINGS_INITIAL_WINDOW_SIZE] = AWS_H2_INIT_WINDOW_SIZE,
     [AWS_HTTP2_SETTINGS_MAX_FRAME_SIZE] = 16384,
     [AWS_HTTP2_SETTINGS_MAX_HEADER_LIST_SIZE] = UINT32_MAX, /* "The initial value of this setting is unlimited" */
+    [AWS_HTTP2_SETTINGS_ENABLE_CONNECT_PROTOCOL] = 0,       /* RFC-8441 3 */
 };
 
-const uint32_t aws_h2_settings_bounds[AWS_HTTP2_SETTINGS_END_RANGE][2] = {
+const uint32_t aws_h2_settings_bounds[AWS_H2_SETTINGS_END_RANGE][2] = {
     [AWS_HTTP2_SETTINGS_HEADER_TABLE_SIZE][0] = 0,
     [AWS_HTTP2_SETTINGS_HEADER_TABLE_SIZE][1] = UINT32_MAX,
 
@@ -53,8 +55,105 @@ const uint32_t aws_h2_settings_bounds[AWS_HTTP2_SETTINGS_END_RANGE][2] = {
 
     [AWS_HTTP2_SETTINGS_MAX_HEADER_LIST_SIZE][0] = 0,
     [AWS_HTTP2_SETTINGS_MAX_HEADER_LIST_SIZE][1] = UINT32_MAX,
+
+    [AWS_HTTP2_SETTINGS_ENABLE_CONNECT_PROTOCOL][0] = 0,
+    [AWS_HTTP2_SETTINGS_ENABLE_CONNECT_PROTOCOL][1] = 1,
 };
 
+bool aws_h2_settings_id_is_known(uint32_t id) {
+    return (id >= AWS_HTTP2_SETTINGS_BEGIN_RANGE && id < AWS_HTTP2_SETTINGS_END_RANGE) ||
+           id == AWS_HTTP2_SETTINGS_ENABLE_CONNECT_PROTOCOL;
+}
+
+/***********************************************************************************************************************
+ * Frame Pool
+ **********************************************************************************************************************/
+
+/* Each block starts with a header recording its size class, padded to keep the user's memory max-aligned */
+#define FRAME_POOL_HEADER_SIZE 16
+
+static size_t s_frame_pool_block_size(size_t size_class) {
+    return (size_t)AWS_H2_FRAME_POOL_MIN_BLOCK_SIZE << size_class;
+}
+
+static void *s_frame_pool_mem_acquire(struct aws_allocator *allocator, size_t size) {
+    struct aws_h2_frame_pool *pool = allocator->impl;
+
+    size_t size_class = 0;
+    while (size_class < AWS_H2_FRAME_POOL_SIZE_CLASS_COUNT && size > s_frame_pool_block_size(size_class)) {
+        ++size_class;
+    }
+
+    void *block = NULL;
+    if (size_class < AWS_H2_FRAME_POOL_SIZE_CLASS_COUNT) {
+        block = pool->size_classes[size_class].free_list;
+        if (block) {
+            pool->size_classes[size_class].free_list = *(void **)block;
+            pool->size_classes[size_class].free_count--;
+            pool->cached_bytes -= FRAME_POOL_HEADER_SIZE + s_frame_pool_block_size(size_class);
+        } else {
+            block = aws_mem_acquire(pool->parent, FRAME_POOL_HEADER_SIZE + s_frame_pool_block_size(size_class));
+        }
+    } else {
+        block = aws_mem_acquire(pool->parent, FRAME_POOL_HEADER_SIZE + size);
+    }
+
+    if (!block) {
+        return NULL;
+    }
+
+    *(size_t *)block = size_class;
+    return (uint8_t *)block + FRAME_POOL_HEADER_SIZE;
+}
+
+static void s_frame_pool_mem_release(struct aws_allocator *allocator, void *ptr) {
+    struct aws_h2_frame_pool *pool = allocator->impl;
+
+    void *block = (uint8_t *)ptr - FRAME_POOL_HEADER_SIZE;
+    size_t size_class = *(size_t *)block;
+
+    if (size_class < AWS_H2_FRAME_POOL_SIZE_CLASS_COUNT &&
+        pool->size_classes[size_class].free_count < AWS_H2_FRAME_POOL_MAX_FREE_BLOCKS) {
+
+        *(void **)block = pool->size_classes[size_class].free_list;
+        pool->size_classes[size_class].free_list = block;
+        pool->size_classes[size_class].free_count++;
+        pool->cached_bytes += FRAME_POOL_HEADER_SIZE + s_frame_pool_block_size(size_class);
+        return;
+    }
+
+    aws_mem_release(pool->parent, block);
+}
+
+int aws_h2_frame_pool_init(struct aws_h2_frame_pool *pool, struct aws_allocator *parent) {
+    AWS_PRECONDITION(pool);
+    AWS_PRECONDITION(parent);
+
+    AWS_ZERO_STRUCT(*pool);
+    pool->parent = parent;
+    pool->allocator.mem_acquire = s_frame_pool_mem_acquire;
+    pool->allocator.mem_release = s_frame_pool_mem_release;
+    pool->allocator.impl = pool;
+    return AWS_OP_SUCCESS;
+}
+
+void aws_h2_frame_pool_clean_up(struct aws_h2_frame_pool *pool) {
+    if (!pool->parent) {
+        return;
+    }
+
+    for (size_t i = 0; i < AWS_H2_FRAME_POOL_SIZE_CLASS_COUNT; ++i) {
+        void *block = pool->size_classes[i].free_list;
+        while (block) {
+            void *next = *(void **)block;
+            aws_mem_release(pool->parent, block);
+            block = next;
+        }
+    }
+
+    AWS_ZERO_STRUCT(*pool);
+}
+
 /* Stream ids & dependencies should only write the bottom 31 bits */
 static const uint32_t s_u32_top_bit_mask = UINT32_MAX << 31;
 
@@ -196,6 +295,14 @@ static int s_get_max_contiguous_payload_length(
     return AWS_OP_SUCCESS;
 }
 
+/* Max DATA payload allowed by the peer's MAX_FRAME_SIZE, and by any smaller limit the connection has set */
+static size_t s_get_max_data_payload_given_settings(const struct aws_h2_frame_encoder *encoder) {
+    if (encoder->max_data_payload) {
+        return aws_min_u32(encoder->settings.max_frame_size, encoder->max_data_payload);
+    }
+    return encoder->settings.max_frame_size;
+}
+
 /***********************************************************************************************************************
  * Priority
  **********************************************************************************************************************/
@@ -245,6 +352,16 @@ static void s_init_frame_base(
     frame_base->stream_id = stream_id;
 }
 
+AWS_STATIC_ASSERT(AWS_H2_FRAME_T_UNKNOWN == AWS_CRT_STATISTICS_HTTP2_FRAME_TYPE_COUNT);
+
+static void s_on_frame_encoded(struct aws_h2_frame_encoder *encoder, enum aws_h2_frame_type type, uint32_t stream_id) {
+    AWS_HTTP_TRACE(AWS_HTTP_TRACE_H2_FRAME_ENCODED, encoder->logging_id, type, stream_id);
+    (void)stream_id;
+    if (encoder->stats) {
+        encoder->stats->frames_sent[type]++;
+    }
+}
+
 static void s_frame_prefix_encode(
     enum aws_h2_frame_type type,
     uint32_t stream_id,
@@ -366,6 +483,7 @@ int aws_h2_encode_data_frame(
     }
     /* The flow-control window will limit the size for max_payload of a flow-controlled frame */
     max_payload = aws_min_size(max_payload, min_window_size);
+    max_payload = aws_min_size(max_payload, s_get_max_data_payload_given_settings(encoder));
     /* Max amount of body we can fit in the payload*/
     size_t max_body;
     if (aws_sub_size_checked(max_payload, payload_overhead, &max_body) || max_body == 0) {
@@ -441,6 +559,11 @@ int aws_h2_encode_data_frame(
     *connection_window_size_peer -= payload_len;
     *stream_window_size_peer -= (int32_t)payload_len;
 
+    s_on_frame_encoded(encoder, AWS_H2_FRAME_T_DATA, stream_id);
+    if (encoder->stats) {
+        encoder->stats->data_bytes_sent += payload_len;
+    }
+
     AWS_ASSERT(writes_ok);
     (void)writes_ok;
     return AWS_OP_SUCCESS;
@@ -457,6 +580,96 @@ error:
     return AWS_OP_ERR;
 }
 
+int aws_h2_encode_data_frame_from_cursor(
+    struct aws_h2_frame_encoder *encoder,
+    uint32_t stream_id,
+    struct aws_byte_cursor *body,
+    bool body_ends_stream,
+    int32_t *stream_window_size_peer,
+    size_t *connection_window_size_peer,
+    struct aws_byte_buf *output,
+    struct aws_byte_cursor *out_payload,
+    bool *body_complete) {
+
+    AWS_PRECONDITION(encoder);
+    AWS_PRECONDITION(body);
+    AWS_PRECONDITION(output);
+    AWS_PRECONDITION(out_payload);
+    AWS_PRECONDITION(body_complete);
+    AWS_PRECONDITION(*stream_window_size_peer > 0);
+
+    if (aws_h2_validate_stream_id(stream_id)) {
+        return AWS_OP_ERR;
+    }
+
+    AWS_ZERO_STRUCT(*out_payload);
+    *body_complete = false;
+
+    if (output->capacity - output->len < AWS_H2_FRAME_PREFIX_SIZE) {
+        ENCODER_LOGF(TRACE, encoder, "Insufficient space to encode DATA for stream %" PRIu32 " right now", stream_id);
+        return AWS_OP_SUCCESS;
+    }
+
+    /* Payload size is limited by MAX_FRAME_SIZE and flow-control, but not by space in the output buffer */
+    size_t min_window_size = aws_min_size(*stream_window_size_peer, *connection_window_size_peer);
+    size_t max_payload = aws_min_size(s_get_max_data_payload_given_settings(encoder), min_window_size);
+    size_t payload_len = aws_min_size(body->len, max_payload);
+
+    /* Sending a payload separately ends the current write pass, which only pays off for big payloads.
+     * Smaller ones are limited to the space available, like any other DATA frame */
+    size_t space_for_payload = output->capacity - output->len - AWS_H2_FRAME_PREFIX_SIZE;
+    if (payload_len > space_for_payload && payload_len < AWS_H2_ZERO_COPY_PAYLOAD_MIN_SIZE) {
+        if (space_for_payload == 0) {
+            ENCODER_LOGF(
+                TRACE, encoder, "Insufficient space to encode DATA for stream %" PRIu32 " right now", stream_id);
+            return AWS_OP_SUCCESS;
+        }
+        payload_len = space_for_payload;
+    }
+
+    struct aws_byte_cursor payload = aws_byte_cursor_advance(body, payload_len);
+
+    uint8_t flags = 0;
+    if (body->len == 0) {
+        *body_complete = true;
+        if (body_ends_stream) {
+            flags |= AWS_H2_FRAME_F_END_STREAM;
+        }
+    }
+
+    /* Copy the payload if it fits, there's nothing to gain from sending it separately */
+    bool payload_fits = payload.len <= space_for_payload;
+
+    ENCODER_LOGF(
+        TRACE,
+        encoder,
+        "Encoding frame type=DATA stream_id=%" PRIu32 " data_len=%zu%s%s",
+        stream_id,
+        payload.len,
+        payload_fits ? "" : " zero-copy",
+        (flags & AWS_H2_FRAME_F_END_STREAM) ? " END_STREAM" : "");
+
+    s_frame_prefix_encode(AWS_H2_FRAME_T_DATA, stream_id, payload.len, flags, output);
+    if (payload_fits) {
+        bool writes_ok = aws_byte_buf_write_from_whole_cursor(output, payload);
+        AWS_ASSERT(writes_ok);
+        (void)writes_ok;
+    } else {
+        *out_payload = payload;
+    }
+
+    AWS_ASSERT(payload.len <= min_window_size);
+    *connection_window_size_peer -= payload.len;
+    *stream_window_size_peer -= (int32_t)payload.len;
+
+    s_on_frame_encoded(encoder, AWS_H2_FRAME_T_DATA, stream_id);
+    if (encoder->stats) {
+        encoder->stats->data_bytes_sent += payload.len;
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
 /***********************************************************************************************************************
  * HEADERS / PUSH_PROMISE
  **********************************************************************************************************************/
@@ -466,8 +679,9 @@ DEFINE_FRAME_VTABLE(headers);
 struct aws_h2_frame_headers {
     struct aws_h2_frame base;
 
-    /* Common data */
+    /* Common data. Exactly one of these is set, an HTTP/1 request is encoded as HTTP/2 without converting it */
     const struct aws_http_headers *headers;
+    const struct aws_http_message *http1_request;
     uint8_t pad_length; /* Set to 0 to disable AWS_H2_FRAME_F_PADDED */
 
     /* HEADERS-only data */
@@ -486,6 +700,7 @@ struct aws_h2_frame_headers {
         AWS_H2_HEADERS_STATE_COMPLETE,
     } state;
 
+    /* Only used if the header-block can't be encoded straight into the output (see s_encode_header_block_directly) */
     struct aws_byte_buf whole_encoded_header_block;
     struct aws_byte_cursor header_block_cursor; /* tracks progress sending encoded header-block in fragments */
 };
@@ -495,6 +710,7 @@ static struct aws_h2_frame *s_frame_new_headers_or_push_promise(
     enum aws_h2_frame_type frame_type,
     uint32_t stream_id,
     const struct aws_http_headers *headers,
+    const struct aws_http_message *http1_request,
     uint8_t pad_length,
     bool end_stream,
     const struct aws_h2_frame_priority_settings *optional_priority,
@@ -504,7 +720,7 @@ static struct aws_h2_frame *s_frame_new_headers_or_push_promise(
      * requested, let the server side reject the request? */
     AWS_PRECONDITION(allocator);
     AWS_PRECONDITION(frame_type == AWS_H2_FRAME_T_HEADERS || frame_type == AWS_H2_FRAME_T_PUSH_PROMISE);
-    AWS_PRECONDITION(headers);
+    AWS_PRECONDITION((headers != NULL) != (http1_request != NULL));
 
     /* Validate args */
 
@@ -529,10 +745,6 @@ static struct aws_h2_frame *s_frame_new_headers_or_push_promise(
         return NULL;
     }
 
-    if (aws_byte_buf_init(&frame->whole_encoded_header_block, allocator, s_encoded_header_block_reserve)) {
-        goto error;
-    }
-
     if (frame_type == AWS_H2_FRAME_T_HEADERS) {
         frame->end_stream = end_stream;
         if (optional_priority) {
@@ -544,16 +756,18 @@ static struct aws_h2_frame *s_frame_new_headers_or_push_promise(
     }
 
     s_init_frame_base(&frame->base, allocator, frame_type, &s_frame_headers_vtable, stream_id);
+    frame->base.memory_size = sizeof(struct aws_h2_frame_headers);
 
-    aws_http_headers_acquire((struct aws_http_headers *)headers);
-    frame->headers = headers;
+    if (headers) {
+        aws_http_headers_acquire((struct aws_http_headers *)headers);
+        frame->headers = headers;
+    } else {
+        aws_http_message_acquire((struct aws_http_message *)http1_request);
+        frame->http1_request = http1_request;
+    }
     frame->pad_length = pad_length;
 
     return &frame->base;
-
-error:
-    s_frame_headers_destroy(&frame->base);
-    return NULL;
 }
 
 struct aws_h2_frame *aws_h2_frame_new_headers(
@@ -569,6 +783,28 @@ struct aws_h2_frame *aws_h2_frame_new_headers(
         AWS_H2_FRAME_T_HEADERS,
         stream_id,
         headers,
+        NULL /* http1_request */,
+        pad_length,
+        end_stream,
+        optional_priority,
+        0 /* HEADERS doesn't have promised_stream_id */);
+}
+
+struct aws_h2_frame *aws_h2_frame_new_headers_from_http1(
+    struct aws_allocator *allocator,
+    uint32_t stream_id,
+    const struct aws_http_message *http1_request,
+    bool end_stream,
+    uint8_t pad_length,
+    const struct aws_h2_frame_priority_settings *optional_priority) {
+
+    AWS_PRECONDITION(http1_request);
+    return s_frame_new_headers_or_push_promise(
+        allocator,
+        AWS_H2_FRAME_T_HEADERS,
+        stream_id,
+        NULL /* headers */,
+        http1_request,
         pad_length,
         end_stream,
         optional_priority,
@@ -587,6 +823,7 @@ struct aws_h2_frame *aws_h2_frame_new_push_promise(
         AWS_H2_FRAME_T_PUSH_PROMISE,
         stream_id,
         headers,
+        NULL /* http1_request */,
         pad_length,
         false /* PUSH_PROMISE doesn't have end_stream flag */,
         NULL /* PUSH_PROMISE doesn't have priority_settings */,
@@ -596,6 +833,7 @@ struct aws_h2_frame *aws_h2_frame_new_push_promise(
 static void s_frame_headers_destroy(struct aws_h2_frame *frame_base) {
     struct aws_h2_frame_headers *frame = AWS_CONTAINER_OF(frame_base, struct aws_h2_frame_headers, base);
     aws_http_headers_release((struct aws_http_headers *)frame->headers);
+    aws_http_message_release((struct aws_http_message *)frame->http1_request);
     aws_byte_buf_clean_up(&frame->whole_encoded_header_block);
     aws_mem_release(frame->base.alloc, frame);
 }
@@ -710,10 +948,14 @@ static void s_encode_single_header_block_frame(
         writes_ok &= aws_byte_buf_write_be32(output, *promised_stream_id);
     }
 
-    /* Write header-block fragment */
+    /* Write header-block fragment, unless it was encoded right where it belongs */
     if (fragment_len > 0) {
         struct aws_byte_cursor fragment = aws_byte_cursor_advance(&frame->header_block_cursor, fragment_len);
-        writes_ok &= aws_byte_buf_write_from_whole_cursor(output, fragment);
+        if (fragment.ptr == output->buffer + output->len) {
+            output->len += fragment.len;
+        } else {
+            writes_ok &= aws_byte_buf_write_from_whole_cursor(output, fragment);
+        }
     }
 
     /* Write padding */
@@ -723,6 +965,7 @@ static void s_encode_single_header_block_frame(
 
     AWS_ASSERT(writes_ok);
     (void)writes_ok;
+    s_on_frame_encoded(encoder, frame_type, frame->base.stream_id);
 
     /* Success! Wrote entire frame. It's safe to change state now */
     frame->state =
@@ -740,6 +983,94 @@ handle_waiting_for_more_space:
     *waiting_for_more_space = true;
 }
 
+static int s_hpack_encode_header_block(
+    struct aws_h2_frame_headers *frame,
+    struct aws_h2_frame_encoder *encoder,
+    struct aws_byte_buf *output) {
+
+    const uint64_t prev_raw_bytes = encoder->hpack.stats.raw_bytes;
+    const size_t prev_len = output->len;
+    int encode_result;
+    if (frame->http1_request) {
+        encode_result = aws_hpack_encode_header_block_from_http1(&encoder->hpack, frame->http1_request, output);
+    } else {
+        encode_result = aws_hpack_encode_header_block(&encoder->hpack, frame->headers, output);
+    }
+    if (encode_result) {
+        ENCODER_LOGF(
+            ERROR,
+            encoder,
+            "Error doing HPACK encoding on %s of stream %" PRIu32 ": %s",
+            aws_h2_frame_type_to_str(frame->base.type),
+            frame->base.stream_id,
+            aws_error_name(aws_last_error()));
+        return AWS_OP_ERR;
+    }
+
+    if (encoder->stats) {
+        encoder->stats->header_bytes_sent_compressed += output->len - prev_len;
+        encoder->stats->header_bytes_sent_uncompressed += encoder->hpack.stats.raw_bytes - prev_raw_bytes;
+    }
+    return AWS_OP_SUCCESS;
+}
+
+/* If the whole header-block is sure to fit in one frame in the output, HPACK-encode it straight into the output,
+ * where the frame's payload will go. s_encode_single_header_block_frame() then writes the rest of the frame around it.
+ * HPACK encoding updates the dynamic table, so it can't be retried, which is why this is only done
+ * when the encoded size can't possibly exceed the space available. */
+static int s_encode_header_block_directly(
+    struct aws_h2_frame_headers *frame,
+    struct aws_h2_frame_encoder *encoder,
+    struct aws_byte_buf *output,
+    bool *out_encoded) {
+
+    *out_encoded = false;
+
+    size_t max_payload;
+    if (s_get_max_contiguous_payload_length(encoder, output, &max_payload)) {
+        /* Not even room for a frame prefix, fall back to encoding into another buffer */
+        aws_reset_error();
+        return AWS_OP_SUCCESS;
+    }
+
+    /* Payload that comes before the header-block, and the padding that comes after it */
+    size_t before_block = 0;
+    if (frame->pad_length > 0) {
+        before_block += 1;
+    }
+    if (frame->has_priority) {
+        before_block += s_frame_priority_settings_size;
+    }
+    if (frame->base.type == AWS_H2_FRAME_T_PUSH_PROMISE) {
+        before_block += 4;
+    }
+    const size_t payload_overhead = before_block + frame->pad_length;
+
+    size_t max_block_size;
+    if (frame->http1_request) {
+        max_block_size = aws_hpack_encode_header_block_from_http1_max_size(&encoder->hpack, frame->http1_request);
+    } else {
+        max_block_size = aws_hpack_encode_header_block_max_size(&encoder->hpack, frame->headers);
+    }
+    if (aws_add_size_saturating(max_block_size, payload_overhead) > max_payload) {
+        return AWS_OP_SUCCESS;
+    }
+
+    /* The buffer has no allocator, and is big enough that the HPACK encoder never needs to grow it */
+    struct aws_byte_buf block = {
+        .buffer = output->buffer + output->len + AWS_H2_FRAME_PREFIX_SIZE + before_block,
+        .capacity = max_block_size,
+    };
+    if (s_hpack_encode_header_block(frame, encoder, &block)) {
+        return AWS_OP_ERR;
+    }
+    AWS_ASSERT(block.buffer == output->buffer + output->len + AWS_H2_FRAME_PREFIX_SIZE + before_block);
+
+    frame->header_block_cursor = aws_byte_cursor_from_buf(&block);
+    *out_encoded = true;
+    return AWS_OP_SUCCESS;
+}
+
 static int s_frame_headers_encode(
     struct aws_h2_frame *frame_base,
     struct aws_h2_frame_encoder *encoder,
@@ -748,21 +1079,26 @@ static int s_frame_headers_encode(
 
     struct aws_h2_frame_headers *frame = AWS_CONTAINER_OF(frame_base, struct aws_h2_frame_headers, base);
 
-    /* Pre-encode the entire header-block into another buffer
-     * the first time we're called. */
+    /* Encode the entire header-block the first time we're called.
+     * Straight into the output if it fits in one frame there, otherwise into another buffer to be sent in fragments */
     if (frame->state == AWS_H2_HEADERS_STATE_INIT) {
-        if (aws_hpack_encode_header_block(&encoder->hpack, frame->headers, &frame->whole_encoded_header_block)) {
-            ENCODER_LOGF(
-                ERROR,
-                encoder,
-                "Error doing HPACK encoding on %s of stream %" PRIu32 ": %s",
-                aws_h2_frame_type_to_str(frame->base.type),
-                frame->base.stream_id,
-                aws_error_name(aws_last_error()));
+        bool encoded_directly;
+        if (s_encode_header_block_directly(frame, encoder, output, &encoded_directly)) {
             goto error;
         }
 
-        frame->header_block_cursor = aws_byte_cursor_from_buf(&frame->whole_encoded_header_block);
+        if (!encoded_directly) {
+            if (aws_byte_buf_init(
+                    &frame->whole_encoded_header_block, frame->base.alloc, s_encoded_header_block_reserve)) {
+                goto error;
+            }
+            if (s_hpack_encode_header_block(frame, encoder, &frame->whole_encoded_header_block)) {
+                goto error;
+            }
+            frame->header_block_cursor = aws_byte_cursor_from_buf(&frame->whole_encoded_header_block);
+            frame->base.memory_size += frame->whole_encoded_header_block.capacity;
+        }
+
         frame->state = AWS_H2_HEADERS_STATE_FIRST_FRAME;
     }
 
@@ -829,6 +1165,7 @@ static struct aws_h2_frame_prebuilt *s_h2_frame_new_prebuilt(
 
     AWS_ZERO_STRUCT(*frame);
     s_init_frame_base(&frame->base, allocator, type, &s_frame_prebuilt_vtable, stream_id);
+    frame->base.memory_size = sizeof(struct aws_h2_frame_prebuilt) + encoded_frame_len;
 
     /* encoded_buf has the exact amount of space necessary for the full encoded frame.
      * The constructor of our subclass must finish filling up encoded_buf with the payload. */
@@ -1218,6 +1555,11 @@ int aws_h2_encode_frame(
         return AWS_OP_ERR;
     }
 
+    /* Header-block frames count each HEADERS, PUSH_PROMISE, and CONTINUATION frame as it's written */
+    if (*frame_complete && frame->type != AWS_H2_FRAME_T_HEADERS && frame->type != AWS_H2_FRAME_T_PUSH_PROMISE) {
+        s_on_frame_encoded(encoder, frame->type, frame->stream_id);
+    }
+
     encoder->current_frame = *frame_complete ? NULL : frame;
     return AWS_OP_SUCCESS;
 }
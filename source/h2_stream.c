@@ -6,8 +6,10 @@
 #include <aws/http/private/h2_stream.h>
 
 #include <aws/common/clock.h>
+#include <aws/http/private/body_lease.h>
 #include <aws/http/private/h2_connection.h>
 #include <aws/http/private/strutil.h>
+#include <aws/http/private/tracing_impl.h>
 #include <aws/http/status_code.h>
 #include <aws/io/channel.h>
 #include <aws/io/logging.h>
@@ -24,6 +26,7 @@ static int s_stream_get_sent_error_code(struct aws_http_stream *stream_base, uin
 static int s_stream_write_data(
     struct aws_http_stream *stream_base,
     const struct aws_http2_stream_write_data_options *options);
+static int s_stream_notify_body_ready(struct aws_http_stream *stream_base);
 
 static void s_stream_cross_thread_work_task(struct aws_channel_task *task, void *arg, enum aws_task_status status);
 static struct aws_h2err s_send_rst_and_close_stream(struct aws_h2_stream *stream, struct aws_h2err stream_error);
@@ -38,6 +41,7 @@ struct aws_http_stream_vtable s_h2_stream_vtable = {
     .http2_get_received_error_code = s_stream_get_received_error_code,
     .http2_get_sent_error_code = s_stream_get_sent_error_code,
     .http2_write_data = s_stream_write_data,
+    .http2_notify_body_ready = s_stream_notify_body_ready,
 };
 
 const char *aws_h2_stream_state_to_str(enum aws_h2_stream_state state) {
@@ -67,6 +71,10 @@ static struct aws_h2_connection *s_get_h2_connection(const struct aws_h2_stream
     return AWS_CONTAINER_OF(stream->base.owning_connection, struct aws_h2_connection, base);
 }
 
+static struct aws_allocator *s_get_frame_allocator(const struct aws_h2_stream *stream) {
+    return &s_get_h2_connection(stream)->frame_pool.allocator;
+}
+
 static void s_lock_synced_data(struct aws_h2_stream *stream) {
     int err = aws_mutex_lock(&stream->synced_data.lock);
     AWS_ASSERT(!err && "lock failed");
@@ -210,7 +218,7 @@ static int s_stream_send_update_window_frame(struct aws_h2_stream *stream, size_
 
     struct aws_h2_connection *connection = s_get_h2_connection(stream);
     struct aws_h2_frame *stream_window_update_frame =
-        aws_h2_frame_new_window_update(stream->base.alloc, stream->base.id, (uint32_t)increment_size);
+        aws_h2_frame_new_window_update(s_get_frame_allocator(stream), stream->base.id, (uint32_t)increment_size);
 
     if (!stream_window_update_frame) {
         AWS_H2_STREAM_LOGF(
@@ -225,6 +233,49 @@ static int s_stream_send_update_window_frame(struct aws_h2_stream *stream, size_
     return AWS_OP_SUCCESS;
 }
 
+/* Parse the value of an RFC-9218 "priority" header, ex: "u=1, i".
+ * Members that are missing keep their RFC-9218 default (u=3, non-incremental).
+ * Anything we don't understand is ignored, as RFC-9218 4 requires. */
+static void s_parse_priority_header(struct aws_byte_cursor value, struct aws_http2_stream_priority *priority) {
+    priority->urgency = AWS_HTTP2_PRIORITY_URGENCY_DEFAULT;
+    priority->incremental = false;
+
+    struct aws_byte_cursor member;
+    AWS_ZERO_STRUCT(member);
+    while (aws_byte_cursor_next_split(&value, ',', &member)) {
+        /* Drop any parameters, ex: "u=1;foo=bar" */
+        struct aws_byte_cursor item = aws_strutil_trim_http_whitespace(member);
+        struct aws_byte_cursor key_value;
+        AWS_ZERO_STRUCT(key_value);
+        aws_byte_cursor_next_split(&item, ';', &key_value);
+        if (key_value.len == 0) {
+            continue;
+        }
+
+        struct aws_byte_cursor key = key_value;
+        struct aws_byte_cursor val;
+        AWS_ZERO_STRUCT(val);
+        const uint8_t *equals = memchr(key_value.ptr, '=', key_value.len);
+        if (equals) {
+            key.len = (size_t)(equals - key_value.ptr);
+            val = aws_byte_cursor_from_array(equals + 1, key_value.len - key.len - 1);
+        }
+
+        if (aws_byte_cursor_eq_c_str(&key, "u")) {
+            if (val.len == 1 && val.ptr[0] >= '0' && val.ptr[0] <= '0' + AWS_HTTP2_PRIORITY_URGENCY_MAX) {
+                priority->urgency = (uint8_t)(val.ptr[0] - '0');
+            }
+        } else if (aws_byte_cursor_eq_c_str(&key, "i")) {
+            /* Bare key means boolean true in a structured field */
+            if (!equals || aws_byte_cursor_eq_c_str(&val, "?1")) {
+                priority->incremental = true;
+            } else if (aws_byte_cursor_eq_c_str(&val, "?0")) {
+                priority->incremental = false;
+            }
+        }
+    }
+}
+
 struct aws_h2_stream *aws_h2_stream_new_request(
     struct aws_http_connection *client_connection,
     const struct aws_http_make_request_options *options) {
@@ -241,6 +292,7 @@ struct aws_h2_stream *aws_h2_stream_new_request(
     stream->base.on_incoming_headers = options->on_response_headers;
     stream->base.on_incoming_header_block_done = options->on_response_header_block_done;
     stream->base.on_incoming_body = options->on_response_body;
+    stream->base.on_incoming_body_lease = options->on_response_body_lease;
     stream->base.on_metrics = options->on_metrics;
     stream->base.on_complete = options->on_complete;
     stream->base.on_destroy = options->on_destroy;
@@ -252,6 +304,9 @@ struct aws_h2_stream *aws_h2_stream_new_request(
     stream->base.metrics.receive_start_timestamp_ns = -1;
     stream->base.metrics.receive_end_timestamp_ns = -1;
     stream->base.metrics.receiving_duration_ns = -1;
+    stream->base.metrics.activate_timestamp_ns = -1;
+    stream->base.metrics.receive_headers_end_timestamp_ns = -1;
+    stream->base.metrics.connection_acquisition_wait_ns = -1;
     aws_linked_list_init(&stream->thread_data.outgoing_writes);
     aws_linked_list_init(&stream->synced_data.pending_write_list);
 
@@ -260,15 +315,25 @@ struct aws_h2_stream *aws_h2_stream_new_request(
 
     enum aws_http_version message_version = aws_http_message_get_protocol_version(options->request);
     switch (message_version) {
-        case AWS_HTTP_VERSION_1_1:
-            /* TODO: don't automatic transform HTTP/1 message. Let user explicitly pass in HTTP/2 request */
-            stream->thread_data.outgoing_message =
-                aws_http2_message_new_from_http1(stream->base.alloc, options->request);
-            if (!stream->thread_data.outgoing_message) {
-                AWS_H2_STREAM_LOG(ERROR, stream, "Stream failed to create the HTTP/2 message from HTTP/1.1 message");
+        case AWS_HTTP_VERSION_1_1: {
+            /* The HTTP/1.1 message isn't converted, its HEADERS frame synthesizes the pseudo-headers while encoding.
+             * Check now for what the conversion would have required, so bad requests still fail here */
+            struct aws_byte_cursor h1_method;
+            if (aws_http_message_get_request_method(options->request, &h1_method)) {
+                AWS_H2_STREAM_LOG(ERROR, stream, "Stream failed to use HTTP/1.1 message, no method found");
+                aws_raise_error(AWS_ERROR_HTTP_INVALID_METHOD);
                 goto error;
             }
+            struct aws_byte_cursor h1_path;
+            if (aws_http_message_get_request_path(options->request, &h1_path)) {
+                AWS_H2_STREAM_LOG(ERROR, stream, "Stream failed to use HTTP/1.1 message, no path found");
+                aws_raise_error(AWS_ERROR_HTTP_INVALID_PATH);
+                goto error;
+            }
+            stream->thread_data.outgoing_message = options->request;
+            aws_http_message_acquire(stream->thread_data.outgoing_message);
             break;
+        }
         case AWS_HTTP_VERSION_2:
             stream->thread_data.outgoing_message = options->request;
             aws_http_message_acquire(stream->thread_data.outgoing_message);
@@ -284,6 +349,32 @@ struct aws_h2_stream *aws_h2_stream_new_request(
         goto error;
     }
     stream->base.request_method = aws_http_str_to_method(method);
+    stream->is_extended_connect =
+        message_version == AWS_HTTP_VERSION_2 &&
+        aws_http_headers_has(aws_http_message_get_const_headers(options->request), aws_http_header_protocol);
+
+    /* Determine scheduling priority.
+     * With no priority specified, streams are incremental so they all take turns, as they always have. */
+    stream->priority.urgency = AWS_HTTP2_PRIORITY_URGENCY_DEFAULT;
+    stream->priority.incremental = true;
+    if (options->http2_priority) {
+        if (options->http2_priority->urgency > AWS_HTTP2_PRIORITY_URGENCY_MAX) {
+            AWS_H2_STREAM_LOGF(
+                ERROR, stream, "Invalid priority urgency %" PRIu8 ".", options->http2_priority->urgency);
+            aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+            goto error;
+        }
+        stream->priority = *options->http2_priority;
+    } else {
+        const struct aws_http_headers *headers =
+            aws_http_message_get_const_headers(stream->thread_data.outgoing_message);
+        struct aws_byte_cursor priority_name = aws_byte_cursor_from_c_str("priority");
+        struct aws_byte_cursor priority_value;
+        if (aws_http_headers_get(headers, priority_name, &priority_value) == AWS_OP_SUCCESS) {
+            s_parse_priority_header(priority_value, &stream->priority);
+        }
+    }
+    stream->priority_bucket = (uint8_t)(stream->priority.urgency * 2 + (stream->priority.incremental ? 1 : 0));
 
     /* Init H2 specific stuff */
     stream->thread_data.state = AWS_H2_STREAM_STATE_IDLE;
@@ -370,6 +461,9 @@ static void s_stream_cross_thread_work_task(struct aws_channel_task *task, void
     /* The largest legal value will be 2 * max window size, which is way less than INT64_MAX, so if the window_size_self
      * overflows, remote peer will find it out. So just apply the change and ignore the possible overflow.*/
     stream->thread_data.window_size_self += window_update_size;
+    if (window_update_size > 0) {
+        aws_h2_connection_release_stream_read_window_budget(connection, stream, window_update_size);
+    }
 
     if (reset_called) {
         struct aws_h2err returned_h2err = s_send_rst_and_close_stream(stream, reset_error);
@@ -381,7 +475,7 @@ static void s_stream_cross_thread_work_task(struct aws_channel_task *task, void
     if (stream->thread_data.waiting_for_writes && !aws_linked_list_empty(&pending_writes)) {
         /* Got more to write, move the stream back to outgoing list */
         aws_linked_list_remove(&stream->node);
-        aws_linked_list_push_back(&connection->thread_data.outgoing_streams_list, &stream->node);
+        aws_h2_connection_add_outgoing_stream(connection, stream);
         stream->thread_data.waiting_for_writes = false;
     }
     /* move any pending writes to the outgoing write queue */
@@ -402,6 +496,13 @@ static void s_stream_data_write_destroy(
 
     AWS_PRECONDITION(stream);
     AWS_PRECONDITION(write);
+    if (write->data_buffer_messages_in_flight > 0) {
+        /* The channel still holds the caller's memory.
+         * Finish once it's done, see aws_h2_stream_on_data_buffer_written() */
+        write->destroy_pending = true;
+        write->destroy_error_code = error_code;
+        return;
+    }
     if (write->on_complete) {
         write->on_complete(&stream->base, error_code, write->user_data);
     }
@@ -443,6 +544,8 @@ static void s_stream_destroy(struct aws_http_stream *stream_base) {
 }
 
 void aws_h2_stream_complete(struct aws_h2_stream *stream, int error_code) {
+    AWS_HTTP_TRACE(AWS_HTTP_TRACE_STREAM_COMPLETE, &stream->base, stream->base.id, error_code);
+
     { /* BEGIN CRITICAL SECTION */
         /* clean up any pending writes */
         s_lock_synced_data(stream);
@@ -627,9 +730,10 @@ static struct aws_h2err s_send_rst_and_close_stream(struct aws_h2_stream *stream
 
     /* Send RST_STREAM */
     struct aws_h2_frame *rst_stream_frame =
-        aws_h2_frame_new_rst_stream(stream->base.alloc, stream->base.id, stream_error.h2_code);
+        aws_h2_frame_new_rst_stream(s_get_frame_allocator(stream), stream->base.id, stream_error.h2_code);
     AWS_FATAL_ASSERT(rst_stream_frame != NULL);
     aws_h2_connection_enqueue_outgoing_frame(connection, rst_stream_frame); /* connection takes ownership of frame */
+    aws_h2_connection_count_rst_stream_sent(connection, stream_error.h2_code);
     stream->sent_reset_error_code = stream_error.h2_code;
 
     /* Tell connection that stream is now closed */
@@ -681,14 +785,20 @@ static struct aws_h2_stream_data_write *s_h2_stream_get_current_write(struct aws
     return write;
 }
 
-static struct aws_input_stream *s_h2_stream_get_data_stream(struct aws_h2_stream *stream) {
-    struct aws_h2_stream_data_write *write = s_h2_stream_get_current_write(stream);
-    return write->data_stream;
-}
+void aws_h2_stream_on_data_buffer_written(
+    struct aws_h2_stream *stream,
+    struct aws_h2_stream_data_write *write,
+    int error_code) {
+
+    AWS_PRECONDITION(write->data_buffer_messages_in_flight > 0);
+    write->data_buffer_messages_in_flight--;
+    if (write->destroy_pending && write->data_buffer_messages_in_flight == 0) {
+        /* Report the channel's error, unless the write already had one of its own */
+        s_stream_data_write_destroy(stream, write, write->destroy_error_code ? write->destroy_error_code : error_code);
+    }
 
-static bool s_h2_stream_does_current_write_end_stream(struct aws_h2_stream *stream) {
-    struct aws_h2_stream_data_write *write = s_h2_stream_get_current_write(stream);
-    return write->end_stream;
+    /* Release the reference that kept the stream alive while the channel had the memory */
+    aws_http_stream_release(&stream->base);
 }
 
 int aws_h2_stream_on_activated(struct aws_h2_stream *stream, enum aws_h2_stream_body_state *body_state) {
@@ -698,20 +808,29 @@ int aws_h2_stream_on_activated(struct aws_h2_stream *stream, enum aws_h2_stream_
 
     /* Create HEADERS frame */
     struct aws_http_message *msg = stream->thread_data.outgoing_message;
-    /* Should be ensured when the stream is created */
-    AWS_ASSERT(aws_http_message_get_protocol_version(msg) == AWS_HTTP_VERSION_2);
     /* If manual write, always has data to be sent. */
     bool with_data = aws_http_message_get_body_stream(msg) != NULL || stream->manual_write;
 
-    struct aws_http_headers *h2_headers = aws_http_message_get_headers(msg);
-
-    struct aws_h2_frame *headers_frame = aws_h2_frame_new_headers(
-        stream->base.alloc,
-        stream->base.id,
-        h2_headers,
-        !with_data /* end_stream */,
-        0 /* padding - not currently configurable via public API */,
-        NULL /* priority - not currently configurable via public API */);
+    struct aws_h2_frame *headers_frame = NULL;
+    if (aws_http_message_get_protocol_version(msg) == AWS_HTTP_VERSION_1_1) {
+        headers_frame = aws_h2_frame_new_headers_from_http1(
+            s_get_frame_allocator(stream),
+            stream->base.id,
+            msg,
+            !with_data /* end_stream */,
+            0 /* padding - not currently configurable via public API */,
+            NULL /* priority - not currently configurable via public API */);
+    } else {
+        /* Should be ensured when the stream is created */
+        AWS_ASSERT(aws_http_message_get_protocol_version(msg) == AWS_HTTP_VERSION_2);
+        headers_frame = aws_h2_frame_new_headers(
+            s_get_frame_allocator(stream),
+            stream->base.id,
+            aws_http_message_get_headers(msg),
+            !with_data /* end_stream */,
+            0 /* padding - not currently configurable via public API */,
+            NULL /* priority - not currently configurable via public API */);
+    }
 
     if (!headers_frame) {
         AWS_H2_STREAM_LOGF(ERROR, stream, "Failed to create HEADERS frame: %s", aws_error_name(aws_last_error()));
@@ -726,7 +845,7 @@ int aws_h2_stream_on_activated(struct aws_h2_stream *stream, enum aws_h2_stream_
         connection->thread_data.settings_self[AWS_HTTP2_SETTINGS_INITIAL_WINDOW_SIZE];
 
     if (with_data) {
-        /* If stream has DATA to send, put it in the outgoing_streams_list, and we'll send data later */
+        /* If stream has DATA to send, put it in the outgoing_streams_buckets, and we'll send data later */
         stream->thread_data.state = AWS_H2_STREAM_STATE_OPEN;
         AWS_H2_STREAM_LOG(TRACE, stream, "Sending HEADERS. State -> OPEN");
     } else {
@@ -777,23 +896,51 @@ int aws_h2_stream_encode_data_frame(
     }
 
     *data_encode_status = AWS_H2_DATA_ENCODE_COMPLETE;
-    struct aws_input_stream *input_stream = s_h2_stream_get_data_stream(stream);
-    AWS_ASSERT(input_stream);
+    struct aws_h2_stream_data_write *current_write = s_h2_stream_get_current_write(stream);
 
     bool input_stream_complete = false;
     bool input_stream_stalled = false;
-    bool ends_stream = s_h2_stream_does_current_write_end_stream(stream);
-    if (aws_h2_encode_data_frame(
+    bool ends_stream = current_write->end_stream;
+    int encode_err;
+    if (current_write->use_data_buffer) {
+        struct aws_byte_cursor zero_copy_payload;
+        encode_err = aws_h2_encode_data_frame_from_cursor(
+            encoder,
+            stream->base.id,
+            &current_write->data_buffer,
+            ends_stream,
+            &stream->thread_data.window_size_peer,
+            &connection->thread_data.window_size_peer,
+            output,
+            &zero_copy_payload,
+            &input_stream_complete);
+
+        if (!encode_err && zero_copy_payload.len > 0) {
+            /* Connection will send the payload in its own aws_io_message, right after this one */
+            AWS_ASSERT(connection->thread_data.zero_copy.stream == NULL);
+            connection->thread_data.zero_copy.payload = zero_copy_payload;
+            connection->thread_data.zero_copy.stream = stream;
+            connection->thread_data.zero_copy.write = current_write;
+            current_write->data_buffer_messages_in_flight++;
+            /* Keep stream alive until the channel is done with the memory */
+            aws_atomic_fetch_add(&stream->base.refcount, 1);
+        }
+    } else {
+        AWS_ASSERT(current_write->data_stream);
+        encode_err = aws_h2_encode_data_frame(
             encoder,
             stream->base.id,
-            input_stream,
+            current_write->data_stream,
             ends_stream,
             0 /*pad_length*/,
             &stream->thread_data.window_size_peer,
             &connection->thread_data.window_size_peer,
             output,
             &input_stream_complete,
-            &input_stream_stalled)) {
+            &input_stream_stalled);
+    }
+
+    if (encode_err) {
 
         /* Failed to write DATA, treat it as a Stream Error */
         AWS_H2_STREAM_LOGF(ERROR, stream, "Error encoding stream DATA, %s", aws_error_name(aws_last_error()));
@@ -863,24 +1010,24 @@ struct aws_h2err aws_h2_stream_on_decoder_headers_begin(struct aws_h2_stream *st
     if (aws_h2err_failed(stream_err)) {
         return s_send_rst_and_close_stream(stream, stream_err);
     }
+    bool is_first_header_block = stream->base.metrics.receive_start_timestamp_ns == -1;
     aws_high_res_clock_get_ticks((uint64_t *)&stream->base.metrics.receive_start_timestamp_ns);
+    if (is_first_header_block) {
+        aws_http_stream_update_max_first_byte_latency(
+            &stream->base, &s_get_h2_connection(stream)->thread_data.stats.max_first_byte_latency_ms);
+    }
 
     return AWS_H2ERR_SUCCESS;
 }
 
-struct aws_h2err aws_h2_stream_on_decoder_headers_i(
+/* Validate an incoming header-field and note anything the stream needs from it.
+ * Returns a failed aws_h2err (PROTOCOL_ERROR) if the message is malformed */
+static struct aws_h2err s_process_incoming_header(
     struct aws_h2_stream *stream,
     const struct aws_http_header *header,
     enum aws_http_header_name name_enum,
     enum aws_http_header_block block_type) {
 
-    AWS_PRECONDITION_ON_CHANNEL_THREAD(stream);
-
-    /* Not calling s_check_state_allows_frame_type() here because we already checked
-     * at start of HEADERS frame in aws_h2_stream_on_decoder_headers_begin() */
-
-    bool is_server = stream->base.server_data;
-
     /* RFC-7540 8.1 - Message consists of:
      * - 0+ Informational 1xx headers (response-only, decoder validates that this only occurs in responses)
      * - 1 main headers with normal request or response.
@@ -910,38 +1057,48 @@ struct aws_h2err aws_h2_stream_on_decoder_headers_i(
             AWS_ASSERT(0);
     }
 
-    if (is_server) {
-        return aws_h2err_from_aws_code(AWS_ERROR_UNIMPLEMENTED);
+    /* Client */
+    switch (name_enum) {
+        case AWS_HTTP_HEADER_STATUS: {
+            uint64_t status_code = 0;
+            int err = aws_byte_cursor_utf8_parse_u64(header->value, &status_code);
+            AWS_ASSERT(!err && "Invalid :status value. Decoder should have already validated this");
+            (void)err;
 
-    } else {
-        /* Client */
-        switch (name_enum) {
-            case AWS_HTTP_HEADER_STATUS: {
-                uint64_t status_code = 0;
-                int err = aws_byte_cursor_utf8_parse_u64(header->value, &status_code);
-                AWS_ASSERT(!err && "Invalid :status value. Decoder should have already validated this");
-                (void)err;
-
-                stream->base.client_data->response_status = (int)status_code;
-            } break;
-            case AWS_HTTP_HEADER_CONTENT_LENGTH: {
-                if (stream->thread_data.content_length_received) {
-                    AWS_H2_STREAM_LOG(ERROR, stream, "Duplicate content-length value");
-                    goto malformed;
-                }
-                if (aws_byte_cursor_utf8_parse_u64(header->value, &stream->thread_data.incoming_content_length)) {
-                    AWS_H2_STREAM_LOG(ERROR, stream, "Invalid content-length value");
-                    goto malformed;
-                }
-                stream->thread_data.content_length_received = true;
-            } break;
-            default:
-                break;
-        }
+            stream->base.client_data->response_status = (int)status_code;
+        } break;
+        case AWS_HTTP_HEADER_CONTENT_LENGTH: {
+            if (stream->thread_data.content_length_received) {
+                AWS_H2_STREAM_LOG(ERROR, stream, "Duplicate content-length value");
+                goto malformed;
+            }
+            if (aws_byte_cursor_utf8_parse_u64(header->value, &stream->thread_data.incoming_content_length)) {
+                AWS_H2_STREAM_LOG(ERROR, stream, "Invalid content-length value");
+                goto malformed;
+            }
+            stream->thread_data.content_length_received = true;
+        } break;
+        default:
+            break;
     }
 
+    return AWS_H2ERR_SUCCESS;
+
+malformed:
+    /* RFC-9113 8.1.1 Malformed requests or responses that are detected MUST be treated as a stream error
+     * (Section 5.4.2) of type PROTOCOL_ERROR.*/
+    return aws_h2err_from_h2_code(AWS_HTTP2_ERR_PROTOCOL_ERROR);
+}
+
+static struct aws_h2err s_deliver_incoming_headers(
+    struct aws_h2_stream *stream,
+    const struct aws_http_header *header_array,
+    size_t num_headers,
+    enum aws_http_header_block block_type) {
+
     if (stream->base.on_incoming_headers) {
-        if (stream->base.on_incoming_headers(&stream->base, block_type, header, 1, stream->base.user_data)) {
+        if (stream->base.on_incoming_headers(
+                &stream->base, block_type, header_array, num_headers, stream->base.user_data)) {
             AWS_H2_STREAM_LOGF(
                 ERROR, stream, "Incoming header callback raised error, %s", aws_error_name(aws_last_error()));
             return s_send_rst_and_close_stream(stream, aws_h2err_from_last_error());
@@ -949,11 +1106,60 @@ struct aws_h2err aws_h2_stream_on_decoder_headers_i(
     }
 
     return AWS_H2ERR_SUCCESS;
+}
 
-malformed:
-    /* RFC-9113 8.1.1 Malformed requests or responses that are detected MUST be treated as a stream error
-     * (Section 5.4.2) of type PROTOCOL_ERROR.*/
-    return s_send_rst_and_close_stream(stream, aws_h2err_from_h2_code(AWS_HTTP2_ERR_PROTOCOL_ERROR));
+struct aws_h2err aws_h2_stream_on_decoder_headers_i(
+    struct aws_h2_stream *stream,
+    const struct aws_http_header *header,
+    enum aws_http_header_name name_enum,
+    enum aws_http_header_block block_type) {
+
+    AWS_PRECONDITION_ON_CHANNEL_THREAD(stream);
+
+    /* Not calling s_check_state_allows_frame_type() here because we already checked
+     * at start of HEADERS frame in aws_h2_stream_on_decoder_headers_begin() */
+
+    if (stream->base.server_data) {
+        return aws_h2err_from_aws_code(AWS_ERROR_UNIMPLEMENTED);
+    }
+
+    struct aws_h2err err = s_process_incoming_header(stream, header, name_enum, block_type);
+    if (aws_h2err_failed(err)) {
+        return s_send_rst_and_close_stream(stream, err);
+    }
+
+    return s_deliver_incoming_headers(stream, header, 1, block_type);
+}
+
+struct aws_h2err aws_h2_stream_on_decoder_headers_block(
+    struct aws_h2_stream *stream,
+    const struct aws_http_header *header_array,
+    const enum aws_http_header_name *name_enum_array,
+    size_t num_headers,
+    enum aws_http_header_block block_type) {
+
+    AWS_PRECONDITION_ON_CHANNEL_THREAD(stream);
+
+    /* Not calling s_check_state_allows_frame_type() here because we already checked
+     * at start of HEADERS frame in aws_h2_stream_on_decoder_headers_begin() */
+
+    if (num_headers == 0) {
+        return AWS_H2ERR_SUCCESS;
+    }
+
+    if (stream->base.server_data) {
+        return aws_h2err_from_aws_code(AWS_ERROR_UNIMPLEMENTED);
+    }
+
+    for (size_t i = 0; i < num_headers; ++i) {
+        struct aws_h2err err = s_process_incoming_header(stream, &header_array[i], name_enum_array[i], block_type);
+        if (aws_h2err_failed(err)) {
+            return s_send_rst_and_close_stream(stream, err);
+        }
+    }
+
+    /* Whole block is valid, hand it to the user in one call */
+    return s_deliver_incoming_headers(stream, header_array, num_headers, block_type);
 }
 
 struct aws_h2err aws_h2_stream_on_decoder_headers_end(
@@ -978,6 +1184,7 @@ struct aws_h2err aws_h2_stream_on_decoder_headers_end(
         case AWS_HTTP_HEADER_BLOCK_MAIN:
             AWS_H2_STREAM_LOG(TRACE, stream, "Main header-block done.");
             stream->thread_data.received_main_headers = true;
+            aws_high_res_clock_get_ticks((uint64_t *)&stream->base.metrics.receive_headers_end_timestamp_ns);
             break;
         case AWS_HTTP_HEADER_BLOCK_TRAILING:
             AWS_H2_STREAM_LOG(TRACE, stream, "Trailing 1xx header-block done.");
@@ -1021,7 +1228,7 @@ struct aws_h2err aws_h2_stream_on_decoder_push_promise(struct aws_h2_stream *str
 
 static int s_stream_send_update_window(struct aws_h2_stream *stream, uint32_t window_size) {
     struct aws_h2_frame *stream_window_update_frame =
-        aws_h2_frame_new_window_update(stream->base.alloc, stream->base.id, window_size);
+        aws_h2_frame_new_window_update(s_get_frame_allocator(stream), stream->base.id, window_size);
     if (!stream_window_update_frame) {
         AWS_H2_STREAM_LOGF(
             ERROR,
@@ -1098,8 +1305,15 @@ struct aws_h2err aws_h2_stream_on_decoder_data_begin(
              * so we can't expect them to manage it themselves. */
             auto_window_update = total_padding_bytes;
         } else {
-            /* Automatically update the full amount we just received */
-            auto_window_update = payload_len;
+            /* Automatically update the full amount we just received,
+             * plus any growth from window auto-tuning that this stream hasn't received yet */
+            struct aws_h2_connection *connection = s_get_h2_connection(stream);
+            int64_t growth = (int64_t)connection->thread_data.window_auto_tuning.stream_window_growth -
+                             stream->thread_data.window_size_self_growth;
+            int64_t growth_room = AWS_H2_WINDOW_UPDATE_MAX - (stream->thread_data.window_size_self + payload_len);
+            growth = aws_max_i64(aws_min_i64(growth, growth_room), 0);
+            stream->thread_data.window_size_self_growth += (uint32_t)growth;
+            auto_window_update = payload_len + (uint32_t)growth;
         }
 
         if (auto_window_update != 0) {
@@ -1118,18 +1332,24 @@ struct aws_h2err aws_h2_stream_on_decoder_data_begin(
     return AWS_H2ERR_SUCCESS;
 }
 
-struct aws_h2err aws_h2_stream_on_decoder_data_i(struct aws_h2_stream *stream, struct aws_byte_cursor data) {
+struct aws_h2err aws_h2_stream_on_decoder_data_i(
+    struct aws_h2_stream *stream,
+    struct aws_byte_cursor data,
+    struct aws_http_leased_message *leased_message) {
     AWS_PRECONDITION_ON_CHANNEL_THREAD(stream);
 
     /* Not calling s_check_state_allows_frame_type() here because we already checked at start of DATA frame in
      * aws_h2_stream_on_decoder_data_begin() */
 
-    if (stream->base.on_incoming_body) {
-        if (stream->base.on_incoming_body(&stream->base, &data, stream->base.user_data)) {
-            AWS_H2_STREAM_LOGF(
-                ERROR, stream, "Incoming body callback raised error, %s", aws_error_name(aws_last_error()));
-            return s_send_rst_and_close_stream(stream, aws_h2err_from_last_error());
-        }
+    int err = AWS_OP_SUCCESS;
+    if (leased_message) {
+        err = aws_http_leased_message_deliver_body(leased_message, &stream->base, data);
+    } else if (stream->base.on_incoming_body) {
+        err = stream->base.on_incoming_body(&stream->base, &data, stream->base.user_data);
+    }
+    if (err) {
+        AWS_H2_STREAM_LOGF(ERROR, stream, "Incoming body callback raised error, %s", aws_error_name(aws_last_error()));
+        return s_send_rst_and_close_stream(stream, aws_h2err_from_last_error());
     }
 
     return AWS_H2ERR_SUCCESS;
@@ -1284,6 +1504,10 @@ static int s_stream_write_data(
     struct aws_http_stream *stream_base,
     const struct aws_http2_stream_write_data_options *options) {
     struct aws_h2_stream *stream = AWS_CONTAINER_OF(stream_base, struct aws_h2_stream, base);
+    if (options->data && options->data_buffer.len > 0) {
+        AWS_H2_STREAM_LOG(ERROR, stream, "Cannot set both 'data' and 'data_buffer' in one write");
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+    }
     if (!stream->manual_write) {
         AWS_H2_STREAM_LOG(
             ERROR,
@@ -1299,6 +1523,9 @@ static int s_stream_write_data(
         aws_mem_calloc(stream->base.alloc, 1, sizeof(struct aws_h2_stream_data_write));
     if (options->data) {
         pending_write->data_stream = aws_input_stream_acquire(options->data);
+    } else if (options->data_buffer.len > 0) {
+        pending_write->data_buffer = options->data_buffer;
+        pending_write->use_data_buffer = true;
     } else {
         struct aws_byte_cursor empty_cursor;
         AWS_ZERO_STRUCT(empty_cursor);
@@ -1349,3 +1576,35 @@ static int s_stream_write_data(
 
     return AWS_OP_SUCCESS;
 }
+
+static int s_stream_notify_body_ready(struct aws_http_stream *stream_base) {
+    struct aws_h2_stream *stream = AWS_CONTAINER_OF(stream_base, struct aws_h2_stream, base);
+    struct aws_h2_connection *connection = s_get_h2_connection(stream);
+
+    /* The cross-thread work task always ends by trying to write outgoing frames,
+     * which wakes the connection if it's waiting for body data */
+    bool schedule_cross_thread_work = false;
+    { /* BEGIN CRITICAL SECTION */
+        s_lock_synced_data(stream);
+        if (stream->synced_data.api_state != AWS_H2_STREAM_API_STATE_ACTIVE) {
+            s_unlock_synced_data(stream);
+            int error_code = stream->synced_data.api_state == AWS_H2_STREAM_API_STATE_INIT
+                                 ? AWS_ERROR_HTTP_STREAM_NOT_ACTIVATED
+                                 : AWS_ERROR_HTTP_STREAM_HAS_COMPLETED;
+            AWS_H2_STREAM_LOG(ERROR, stream, "Cannot notify body ready on an inactive or closed stream");
+            return aws_raise_error(error_code);
+        }
+        schedule_cross_thread_work = !stream->synced_data.is_cross_thread_work_task_scheduled;
+        stream->synced_data.is_cross_thread_work_task_scheduled = true;
+        s_unlock_synced_data(stream);
+    } /* END CRITICAL SECTION */
+
+    if (schedule_cross_thread_work) {
+        AWS_H2_STREAM_LOG(TRACE, stream, "Scheduling stream cross-thread work task");
+        /* increment the refcount of stream to keep it alive until the task runs */
+        aws_atomic_fetch_add(&stream->base.refcount, 1);
+        aws_channel_schedule_task_now(connection->base.channel_slot->channel, &stream->cross_thread_work_task);
+    }
+
+    return AWS_OP_SUCCESS;
+}
@@ -0,0 +1,177 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/private/h2_stream_table.h>
+
+#include <string.h>
+
+#define MIN_CAPACITY 8
+
+static size_t s_home_index(size_t capacity, uint32_t stream_id) {
+    /* ids from one endpoint are all odd or all even, so divide by 2 to use every slot */
+    return (size_t)(stream_id >> 1) & (capacity - 1);
+}
+
+static int s_alloc_slots(struct aws_h2_stream_table *table, size_t capacity) {
+    struct aws_h2_stream_table_slot *slots =
+        aws_mem_calloc(table->alloc, capacity, sizeof(struct aws_h2_stream_table_slot));
+    if (!slots) {
+        return AWS_OP_ERR;
+    }
+    table->slots = slots;
+    table->capacity = capacity;
+    table->tombstone_count = 0;
+    return AWS_OP_SUCCESS;
+}
+
+/* Place a stream in the first slot that isn't holding a live stream. Caller ensures there is room. */
+static void s_place(struct aws_h2_stream_table *table, uint32_t stream_id, struct aws_h2_stream *stream) {
+    size_t mask = table->capacity - 1;
+    size_t i = s_home_index(table->capacity, stream_id);
+    while (table->slots[i].stream != NULL) {
+        i = (i + 1) & mask;
+    }
+    struct aws_h2_stream_table_slot *slot = &table->slots[i];
+    if (slot->stream_id != 0) {
+        /* reusing a tombstone */
+        table->tombstone_count--;
+    }
+    slot->stream_id = stream_id;
+    slot->stream = stream;
+}
+
+static int s_rehash(struct aws_h2_stream_table *table, size_t new_capacity) {
+    struct aws_h2_stream_table_slot *old_slots = table->slots;
+    size_t old_capacity = table->capacity;
+
+    if (s_alloc_slots(table, new_capacity)) {
+        return AWS_OP_ERR;
+    }
+
+    for (size_t i = 0; i < old_capacity; ++i) {
+        if (old_slots[i].stream != NULL) {
+            s_place(table, old_slots[i].stream_id, old_slots[i].stream);
+        }
+    }
+
+    aws_mem_release(table->alloc, old_slots);
+    return AWS_OP_SUCCESS;
+}
+
+int aws_h2_stream_table_init(
+    struct aws_h2_stream_table *table,
+    struct aws_allocator *alloc,
+    size_t initial_capacity) {
+
+    AWS_PRECONDITION(table);
+    AWS_PRECONDITION(alloc);
+
+    AWS_ZERO_STRUCT(*table);
+    table->alloc = alloc;
+
+    size_t capacity = MIN_CAPACITY;
+    while (capacity < initial_capacity) {
+        capacity <<= 1;
+    }
+
+    return s_alloc_slots(table, capacity);
+}
+
+void aws_h2_stream_table_clean_up(struct aws_h2_stream_table *table) {
+    if (table->slots) {
+        aws_mem_release(table->alloc, table->slots);
+    }
+    AWS_ZERO_STRUCT(*table);
+}
+
+static struct aws_h2_stream_table_slot *s_find_slot(const struct aws_h2_stream_table *table, uint32_t stream_id) {
+    AWS_PRECONDITION(stream_id != 0);
+
+    size_t mask = table->capacity - 1;
+    size_t i = s_home_index(table->capacity, stream_id);
+    /* Table is never full of used slots, so an empty slot always ends the probe */
+    while (table->slots[i].stream_id != 0) {
+        if (table->slots[i].stream_id == stream_id && table->slots[i].stream != NULL) {
+            return &table->slots[i];
+        }
+        i = (i + 1) & mask;
+    }
+    return NULL;
+}
+
+struct aws_h2_stream *aws_h2_stream_table_find(const struct aws_h2_stream_table *table, uint32_t stream_id) {
+    struct aws_h2_stream_table_slot *slot = s_find_slot(table, stream_id);
+    return slot ? slot->stream : NULL;
+}
+
+int aws_h2_stream_table_insert(struct aws_h2_stream_table *table, uint32_t stream_id, struct aws_h2_stream *stream) {
+    AWS_PRECONDITION(stream_id != 0);
+    AWS_PRECONDITION(stream);
+    AWS_PRECONDITION(s_find_slot(table, stream_id) == NULL);
+
+    /* Keep used slots (live + tombstones) under 3/4 of capacity, so probes stay short and always terminate */
+    if ((table->count + table->tombstone_count + 1) * 4 > table->capacity * 3) {
+        size_t new_capacity = table->capacity;
+        if ((table->count + 1) * 2 > table->capacity) {
+            new_capacity <<= 1;
+        }
+        /* If live streams fill less than half the table, rehashing at the same capacity sweeps out tombstones */
+        if (s_rehash(table, new_capacity)) {
+            return AWS_OP_ERR;
+        }
+    }
+
+    s_place(table, stream_id, stream);
+    table->count++;
+    return AWS_OP_SUCCESS;
+}
+
+void aws_h2_stream_table_remove(struct aws_h2_stream_table *table, uint32_t stream_id) {
+    struct aws_h2_stream_table_slot *slot = s_find_slot(table, stream_id);
+    if (!slot) {
+        return;
+    }
+
+    /* Leave a tombstone so later entries in this probe chain remain reachable */
+    slot->stream = NULL;
+    table->tombstone_count++;
+    table->count--;
+
+    if (table->count == 0) {
+        /* Cheap moment to sweep out every tombstone */
+        memset(table->slots, 0, table->capacity * sizeof(struct aws_h2_stream_table_slot));
+        table->tombstone_count = 0;
+    }
+}
+
+size_t aws_h2_stream_table_get_count(const struct aws_h2_stream_table *table) {
+    return table->count;
+}
+
+static void s_iter_seek(struct aws_h2_stream_table_iter *iter) {
+    const struct aws_h2_stream_table *table = iter->table;
+    while (iter->slot_index < table->capacity && table->slots[iter->slot_index].stream == NULL) {
+        iter->slot_index++;
+    }
+    iter->stream = iter->slot_index < table->capacity ? table->slots[iter->slot_index].stream : NULL;
+}
+
+struct aws_h2_stream_table_iter aws_h2_stream_table_iter_begin(const struct aws_h2_stream_table *table) {
+    struct aws_h2_stream_table_iter iter = {
+        .table = table,
+        .slot_index = 0,
+    };
+    s_iter_seek(&iter);
+    return iter;
+}
+
+bool aws_h2_stream_table_iter_done(const struct aws_h2_stream_table_iter *iter) {
+    return iter->slot_index >= iter->table->capacity;
+}
+
+void aws_h2_stream_table_iter_next(struct aws_h2_stream_table_iter *iter) {
+    iter->slot_index++;
+    s_iter_seek(iter);
+}
@@ -17,6 +17,14 @@ const size_t s_hpack_dynamic_table_max_size = 16 * 1024 * 1024;
 /* Used for growing the dynamic table buffer when it fills up */
 const float s_hpack_dynamic_table_buffer_growth_rate = 1.5F;
 
+/* Smallest allocation for the dynamic table's strings */
+const size_t s_hpack_dynamic_table_strings_initial_size = 512;
+
+/* aws_hpack_suggest_dynamic_table_size() suggests growing once this many recently evicted entries were inserted again,
+ * and they made up at least 1 in this many inserts */
+const uint64_t s_hpack_usage_min_reinserts_to_grow = 4;
+const uint64_t s_hpack_usage_reinsert_ratio_to_grow = 8;
+
 struct aws_http_header s_static_header_table[] = {
 #define HEADER(_index, _name)                                                                                          \
     [_index] = {                                                                                                       \
@@ -46,10 +54,54 @@ struct aws_byte_cursor s_static_header_table_name_only[] = {
 #undef HEADER_WITH_VALUE
 };
 
-/* aws_http_header * -> size_t */
-static struct aws_hash_table s_static_header_reverse_lookup;
-/* aws_byte_cursor * -> size_t */
-static struct aws_hash_table s_static_header_reverse_lookup_name_only;
+/*
+ * Perfect hash of every distinct name in the static table, so reverse lookups need no runtime hash tables.
+ * The constants were found by search, such that none of the 52 distinct names collide:
+ *     slot = (len + 18 * name[0] + 105 * name[len - 1]) % 128
+ * Each slot holds the lowest static index with that name, or 0 if no name hashes there.
+ * The static table is fixed by RFC-7541, hpack_static_table_find_all checks this table against it.
+ */
+/* clang-format off */
+static const uint8_t s_static_header_name_slots[128] = {
+     0,  0,  0,  0,  0,  0,  0,  0,  6,  0, 18, 20,  0, 55,  0,  0,
+     0, 49, 39,  0,  0,  0,  0, 41, 60,  0,  0,  0,  0,  0,  0,  2,
+    16,  0,  0,  0, 29,  0, 22, 25,  0, 44,  0,  0, 28,  0,  0,  0,
+     0,  0,  0, 52, 35,  0,  0,  0,  0,  0,  0,  0,  0,  0, 46,  1,
+     0,  4, 21,  0,  0, 26,  8,  0,  0,  0,  0,  0, 36, 51, 17, 24,
+    56, 53,  0,  0,  0,  0,  0, 42, 58,  0,  0, 61,  0, 34, 54, 48,
+    40, 47, 43,  0,  0, 37,  0,  0, 38, 32,  0,  0, 19,  0,  0, 31,
+    30, 59,  0, 27, 15,  0, 50,  0, 57, 33,  0,  0,  0, 23,  0, 45,
+};
+/* clang-format on */
+
+/* Returns the lowest static index with this name, or 0 if not found */
+static size_t s_static_find_name(struct aws_byte_cursor name) {
+    if (name.len == 0) {
+        return 0;
+    }
+
+    const size_t slot = (name.len + 18 * (size_t)name.ptr[0] + 105 * (size_t)name.ptr[name.len - 1]) & 127;
+    const size_t index = s_static_header_name_slots[slot];
+    if (index != 0 && aws_byte_cursor_eq(&s_static_header_table_name_only[index], &name)) {
+        return index;
+    }
+    return 0;
+}
+
+/* Entries that share a name are adjacent in the static table.
+ * Starting from the name's lowest index, returns the index whose value matches, or 0 if none does */
+static size_t s_static_find_value(size_t name_index, struct aws_byte_cursor value) {
+    const struct aws_byte_cursor *name = &s_static_header_table_name_only[name_index];
+    for (size_t i = name_index; i < s_static_header_table_size; ++i) {
+        if (!aws_byte_cursor_eq(&s_static_header_table_name_only[i], name)) {
+            break;
+        }
+        if (aws_byte_cursor_eq(&s_static_header_table[i].value, &value)) {
+            return i;
+        }
+    }
+    return 0;
+}
 
 static uint64_t s_header_hash(const void *key) {
     const struct aws_http_header *header = key;
@@ -70,43 +122,11 @@ static bool s_header_eq(const void *a, const void *b) {
 }
 
 void aws_hpack_static_table_init(struct aws_allocator *allocator) {
-
-    int result = aws_hash_table_init(
-        &s_static_header_reverse_lookup,
-        allocator,
-        s_static_header_table_size - 1,
-        s_header_hash,
-        s_header_eq,
-        NULL,
-        NULL);
-    AWS_FATAL_ASSERT(AWS_OP_SUCCESS == result);
-
-    result = aws_hash_table_init(
-        &s_static_header_reverse_lookup_name_only,
-        allocator,
-        s_static_header_table_size - 1,
-        aws_hash_byte_cursor_ptr,
-        (aws_hash_callback_eq_fn *)aws_byte_cursor_eq,
-        NULL,
-        NULL);
-    AWS_FATAL_ASSERT(AWS_OP_SUCCESS == result);
-
-    /* Process in reverse so that name_only prefers lower indices */
-    for (size_t i = s_static_header_table_size - 1; i > 0; --i) {
-        /* the tables are created as 1-based indexing */
-        result = aws_hash_table_put(&s_static_header_reverse_lookup, &s_static_header_table[i], (void *)i, NULL);
-        AWS_FATAL_ASSERT(AWS_OP_SUCCESS == result);
-
-        result = aws_hash_table_put(
-            &s_static_header_reverse_lookup_name_only, &s_static_header_table_name_only[i], (void *)(i), NULL);
-        AWS_FATAL_ASSERT(AWS_OP_SUCCESS == result);
-    }
+    (void)allocator;
+    aws_hpack_huffman_decode_table_init();
 }
 
-void aws_hpack_static_table_clean_up(void) {
-    aws_hash_table_clean_up(&s_static_header_reverse_lookup);
-    aws_hash_table_clean_up(&s_static_header_reverse_lookup_name_only);
-}
+void aws_hpack_static_table_clean_up(void) {}
 
 #define HPACK_LOGF(level, hpack, text, ...)                                                                            \
     AWS_LOGF_##level((hpack)->log_subject, "id=%p [HPACK]: " text, (hpack)->log_id, __VA_ARGS__)
@@ -150,19 +170,12 @@ void aws_hpack_context_init(
 
 static struct aws_http_header *s_dynamic_table_get(const struct aws_hpack_context *context, size_t index);
 
-static void s_clean_up_dynamic_table_buffer(struct aws_hpack_context *context) {
-    while (context->dynamic_table.num_elements > 0) {
-        struct aws_http_header *back = s_dynamic_table_get(context, context->dynamic_table.num_elements - 1);
-        context->dynamic_table.num_elements -= 1;
-        /* clean-up the memory we allocate for it */
-        aws_mem_release(context->allocator, back->name.ptr);
-    }
-    aws_mem_release(context->allocator, context->dynamic_table.buffer);
-}
-
 void aws_hpack_context_clean_up(struct aws_hpack_context *context) {
     if (context->dynamic_table.buffer) {
-        s_clean_up_dynamic_table_buffer(context);
+        aws_mem_release(context->allocator, context->dynamic_table.buffer);
+    }
+    if (context->dynamic_table.strings) {
+        aws_mem_release(context->allocator, context->dynamic_table.strings);
     }
     aws_hash_table_clean_up(&context->dynamic_table.reverse_lookup);
     aws_hash_table_clean_up(&context->dynamic_table.reverse_lookup_name_only);
@@ -181,6 +194,11 @@ size_t aws_hpack_get_dynamic_table_max_size(const struct aws_hpack_context *cont
     return context->dynamic_table.max_size;
 }
 
+size_t aws_hpack_get_dynamic_table_memory_usage(const struct aws_hpack_context *context) {
+    return context->dynamic_table.buffer_capacity * sizeof(struct aws_http_header) +
+           context->dynamic_table.strings_capacity;
+}
+
 /*
  * Gets the header from the dynamic table.
  * NOTE: This function only bounds checks on the buffer size, not the number of elements.
@@ -217,15 +235,19 @@ size_t aws_hpack_find_index(
 
     *found_value = false;
 
+    const size_t static_name_index = s_static_find_name(header->name);
+
     struct aws_hash_element *elem = NULL;
     if (search_value) {
         /* Check name-and-value first in static table */
-        aws_hash_table_find(&s_static_header_reverse_lookup, header, &elem);
-        if (elem) {
-            /* TODO: Maybe always set found_value to true? Who cares that the value is empty if they matched? */
-            /* If an element was found, check if it has a value */
-            *found_value = ((const struct aws_http_header *)elem->key)->value.len;
-            return (size_t)elem->value;
+        if (static_name_index) {
+            const size_t static_index = s_static_find_value(static_name_index, header->value);
+            if (static_index) {
+                /* TODO: Maybe always set found_value to true? Who cares that the value is empty if they matched? */
+                /* If an element was found, check if it has a value */
+                *found_value = s_static_header_table[static_index].value.len;
+                return static_index;
+            }
         }
         /* Check name-and-value in dynamic table */
         aws_hash_table_find(&context->dynamic_table.reverse_lookup, header, &elem);
@@ -237,9 +259,8 @@ size_t aws_hpack_find_index(
     }
     /* Check the name-only table. Note, even if we search for value, when we fail in searching for name-and-value, we
      * should also check the name only table */
-    aws_hash_table_find(&s_static_header_reverse_lookup_name_only, &header->name, &elem);
-    if (elem) {
-        return (size_t)elem->value;
+    if (static_name_index) {
+        return static_name_index;
     }
     aws_hash_table_find(&context->dynamic_table.reverse_lookup_name_only, &header->name, &elem);
     if (elem) {
@@ -261,15 +282,92 @@ trans_index_from_dynamic_table:
     return index;
 }
 
+size_t aws_hpack_find_static_index(const struct aws_http_header *header, bool *found_value) {
+    *found_value = false;
+
+    const size_t name_index = s_static_find_name(header->name);
+    if (name_index == 0) {
+        return 0;
+    }
+
+    const size_t index = s_static_find_value(name_index, header->value);
+    if (index) {
+        *found_value = s_static_header_table[index].value.len;
+        return index;
+    }
+    return name_index;
+}
+
+size_t aws_hpack_get_index_of_insertion(const struct aws_hpack_context *context, uint64_t insertion) {
+    if (insertion == 0 || insertion > context->dynamic_table.insert_count) {
+        return 0;
+    }
+
+    /* Entries are evicted oldest-first, so the newest num_elements insertions are the ones still in the table */
+    const uint64_t age = context->dynamic_table.insert_count - insertion;
+    if (age >= context->dynamic_table.num_elements) {
+        return 0;
+    }
+
+    /* Newest entry is at dynamic index 0, which comes right after the static table */
+    return s_static_header_table_size + (size_t)age;
+}
+
 /* Remove elements from the dynamic table until it fits in max_size bytes */
-static int s_dynamic_table_shrink(struct aws_hpack_context *context, size_t max_size) {
+/* Remember an entry that's being evicted to make room for an insert */
+static void s_usage_record_eviction(struct aws_hpack_context *context, const struct aws_http_header *header) {
+    context->dynamic_table.usage.num_evictions++;
+    context->dynamic_table.usage.evicted_hashes[context->dynamic_table.usage.next_evicted_hash] =
+        (uint32_t)s_header_hash(header);
+    context->dynamic_table.usage.next_evicted_hash =
+        (context->dynamic_table.usage.next_evicted_hash + 1) % AWS_HPACK_EVICTED_HISTORY_SIZE;
+    if (context->dynamic_table.usage.num_evicted_hashes < AWS_HPACK_EVICTED_HISTORY_SIZE) {
+        context->dynamic_table.usage.num_evicted_hashes++;
+    }
+}
+
+static void s_usage_record_insert(struct aws_hpack_context *context, const struct aws_http_header *header) {
+    context->dynamic_table.usage.num_inserts++;
+    context->dynamic_table.usage.peak_size =
+        aws_max_size(context->dynamic_table.usage.peak_size, context->dynamic_table.size);
+
+    if (context->dynamic_table.usage.num_evicted_hashes == 0) {
+        return;
+    }
+    const uint32_t hash = (uint32_t)s_header_hash(header);
+    for (size_t i = 0; i < context->dynamic_table.usage.num_evicted_hashes; ++i) {
+        if (context->dynamic_table.usage.evicted_hashes[i] == hash) {
+            context->dynamic_table.usage.num_evicted_reinserts++;
+            return;
+        }
+    }
+}
+
+/* Evict oldest entries until the table fits in max_size.
+ * Evictions that make room for an insert are recorded in the usage stats, ones caused by resizing are not. */
+static int s_dynamic_table_shrink(struct aws_hpack_context *context, size_t max_size, bool record_usage) {
     while (context->dynamic_table.size > max_size && context->dynamic_table.num_elements > 0) {
         struct aws_http_header *back = s_dynamic_table_get(context, context->dynamic_table.num_elements - 1);
 
+        if (record_usage) {
+            s_usage_record_eviction(context, back);
+        }
+
         /* "Remove" the header from the table */
         context->dynamic_table.size -= aws_hpack_get_header_size(back);
         context->dynamic_table.num_elements -= 1;
 
+        /* Oldest entry's strings are always at the start of the live strings */
+        AWS_ASSERT(
+            (back->name.len ? back->name.ptr : back->value.ptr) == NULL ||
+            (back->name.len ? back->name.ptr : back->value.ptr) ==
+                context->dynamic_table.strings + context->dynamic_table.strings_start);
+        context->dynamic_table.strings_start += back->name.len + back->value.len;
+        if (context->dynamic_table.num_elements == 0) {
+            context->dynamic_table.strings_start = 0;
+            context->dynamic_table.strings_end = 0;
+        }
+
         /* Remove old header from hash tables */
         if (aws_hash_table_remove(&context->dynamic_table.reverse_lookup, back, NULL, NULL)) {
             HPACK_LOG(ERROR, context, "Failed to remove header from the reverse lookup table");
@@ -287,8 +385,6 @@ static int s_dynamic_table_shrink(struct aws_hpack_context *context, size_t max_
             }
         }
 
-        /* clean up the memory we allocated to hold the name and value string*/
-        aws_mem_release(context->allocator, back->name.ptr);
     }
 
     return AWS_OP_SUCCESS;
@@ -297,6 +393,90 @@ error:
     return AWS_OP_ERR;
 }
 
+/* Point every entry's strings at new_base, instead of old_base */
+static void s_dynamic_table_rebase_strings(
+    struct aws_hpack_context *context,
+    const uint8_t *old_base,
+    uint8_t *new_base) {
+
+    for (size_t i = 0; i < context->dynamic_table.num_elements; ++i) {
+        struct aws_http_header *entry = s_dynamic_table_get(context, i);
+        if (entry->name.ptr) {
+            entry->name.ptr = new_base + (entry->name.ptr - old_base);
+        }
+        if (entry->value.ptr) {
+            entry->value.ptr = new_base + (entry->value.ptr - old_base);
+        }
+    }
+}
+
+/*
+ * Move the live strings into a new allocation of new_capacity bytes, which must be enough to hold them.
+ * A new_capacity of 0 frees the allocation.
+ */
+static int s_dynamic_table_resize_strings(struct aws_hpack_context *context, size_t new_capacity) {
+    const size_t live_len = context->dynamic_table.strings_end - context->dynamic_table.strings_start;
+    AWS_ASSERT(new_capacity >= live_len);
+
+    uint8_t *new_strings = NULL;
+    if (new_capacity > 0) {
+        new_strings = aws_mem_acquire(context->allocator, new_capacity);
+        if (!new_strings) {
+            return AWS_OP_ERR;
+        }
+    }
+
+    if (live_len > 0) {
+        const uint8_t *old_base = context->dynamic_table.strings + context->dynamic_table.strings_start;
+        memcpy(new_strings, old_base, live_len);
+        s_dynamic_table_rebase_strings(context, old_base, new_strings);
+    }
+
+    if (context->dynamic_table.strings) {
+        aws_mem_release(context->allocator, context->dynamic_table.strings);
+    }
+    context->dynamic_table.strings = new_strings;
+    context->dynamic_table.strings_capacity = new_capacity;
+    context->dynamic_table.strings_start = 0;
+    context->dynamic_table.strings_end = live_len;
+    return AWS_OP_SUCCESS;
+}
+
+/*
+ * Ensure there's room for `len` more bytes after strings_end.
+ * Live strings are slid to the front only when they fill at most half the capacity,
+ * so each slide frees at least as many bytes as it copies, and copying is cheap when amortized.
+ * Live strings never exceed max_size, so once capacity reaches 2 * max_size,
+ * sliding always makes room and nothing more is allocated.
+ */
+static int s_dynamic_table_reserve_strings(struct aws_hpack_context *context, size_t len) {
+    if (context->dynamic_table.strings_capacity - context->dynamic_table.strings_end >= len) {
+        return AWS_OP_SUCCESS;
+    }
+
+    const size_t live_len = context->dynamic_table.strings_end - context->dynamic_table.strings_start;
+    const size_t max_capacity = aws_mul_size_saturating(context->dynamic_table.max_size, 2);
+
+    /* Slide live strings to the front, over the space left by evicted entries */
+    if (context->dynamic_table.strings_capacity - live_len >= len &&
+        live_len <= context->dynamic_table.strings_capacity / 2) {
+
+        uint8_t *old_base = context->dynamic_table.strings + context->dynamic_table.strings_start;
+        memmove(context->dynamic_table.strings, old_base, live_len);
+        s_dynamic_table_rebase_strings(context, old_base, context->dynamic_table.strings);
+        context->dynamic_table.strings_start = 0;
+        context->dynamic_table.strings_end = live_len;
+        return AWS_OP_SUCCESS;
+    }
+
+    /* Grow, which slides live strings to the front at the same time */
+    size_t new_capacity = aws_add_size_saturating(live_len, len);
+    new_capacity = aws_max_size(new_capacity, aws_mul_size_saturating(context->dynamic_table.strings_capacity, 2));
+    new_capacity = aws_max_size(new_capacity, s_hpack_dynamic_table_strings_initial_size);
+    new_capacity = aws_min_size(new_capacity, aws_max_size(max_capacity, live_len + len));
+    return s_dynamic_table_resize_strings(context, new_capacity);
+}
+
 /*
  * Resizes the dynamic table storage buffer to new_max_elements.
  * Useful when inserting over capacity, or when downsizing.
@@ -412,16 +592,24 @@ int aws_hpack_insert_header(struct aws_hpack_context *context, const struct aws_
 
     /* Rotate out headers until there's room for the new header (this function will return immediately if nothing needs
      * to be evicted) */
-    if (s_dynamic_table_shrink(context, context->dynamic_table.max_size - header_size)) {
+    if (s_dynamic_table_shrink(context, context->dynamic_table.max_size - header_size, true /*record_usage*/)) {
+        goto error;
+    }
+
+    /* Make room for the strings before adding the entry, so if this fails the table is unchanged */
+    if (s_dynamic_table_reserve_strings(context, header->name.len + header->value.len)) {
         goto error;
     }
 
     /* If we're out of space in the buffer, grow it */
     if (context->dynamic_table.num_elements == context->dynamic_table.buffer_capacity) {
-        /* If the buffer is currently of 0 size, reset it back to its initial size */
+        /* If the buffer is currently of 0 size, reset it back to its initial size.
+         * Always grow by at least 1, a capacity of 1 would otherwise never grow. */
         const size_t new_size =
             context->dynamic_table.buffer_capacity
-                ? (size_t)(context->dynamic_table.buffer_capacity * s_hpack_dynamic_table_buffer_growth_rate)
+                ? aws_max_size(
+                      (size_t)(context->dynamic_table.buffer_capacity * s_hpack_dynamic_table_buffer_growth_rate),
+                      context->dynamic_table.buffer_capacity + 1)
                 : s_hpack_dynamic_table_initial_elements;
 
         if (s_dynamic_table_resize_buffer(context, new_size)) {
@@ -438,33 +626,29 @@ int aws_hpack_insert_header(struct aws_hpack_context *context, const struct aws_
 
     /* Increment num_elements */
     context->dynamic_table.num_elements++;
+    context->dynamic_table.insert_count++;
     /* Increment the size */
     context->dynamic_table.size += header_size;
 
     /* Put the header at the "front" of the table */
     struct aws_http_header *table_header = s_dynamic_table_get(context, 0);
 
-    /* TODO:: We can optimize this with ring buffer. */
-    /* allocate memory for the name and value, which will be deallocated whenever the entry is evicted from the table or
-     * the table is cleaned up. We keep the pointer in the name pointer of each entry */
-    const size_t buf_memory_size = header->name.len + header->value.len;
-
-    if (buf_memory_size) {
-        uint8_t *buf_memory = aws_mem_acquire(context->allocator, buf_memory_size);
-        if (!buf_memory) {
-            return AWS_OP_ERR;
-        }
-        struct aws_byte_buf buf = aws_byte_buf_from_empty_array(buf_memory, buf_memory_size);
-        /* Copy header, then backup strings into our own allocation */
-        *table_header = *header;
-        aws_byte_buf_append_and_update(&buf, &table_header->name);
-        aws_byte_buf_append_and_update(&buf, &table_header->value);
-    } else {
-        /* if buf_memory_size is 0, no memory needed, we will insert the empty header into dynamic table */
-        *table_header = *header;
-        table_header->name.ptr = NULL;
-        table_header->value.ptr = NULL;
+    /* Copy header, then copy strings into the table's own storage (space was reserved above).
+     * Empty strings get a NULL ptr, so they needn't be adjusted when storage moves. */
+    *table_header = *header;
+    table_header->name.ptr = NULL;
+    table_header->value.ptr = NULL;
+    if (header->name.len) {
+        table_header->name.ptr = context->dynamic_table.strings + context->dynamic_table.strings_end;
+        memcpy(table_header->name.ptr, header->name.ptr, header->name.len);
+        context->dynamic_table.strings_end += header->name.len;
+    }
+    if (header->value.len) {
+        table_header->value.ptr = context->dynamic_table.strings + context->dynamic_table.strings_end;
+        memcpy(table_header->value.ptr, header->value.ptr, header->value.len);
+        context->dynamic_table.strings_end += header->value.len;
     }
+
     /* Write the new header to the look up tables */
     if (aws_hash_table_put(
             &context->dynamic_table.reverse_lookup, table_header, (void *)context->dynamic_table.index_0, NULL)) {
@@ -479,6 +663,7 @@ int aws_hpack_insert_header(struct aws_hpack_context *context, const struct aws_
         goto error;
     }
 
+    s_usage_record_insert(context, table_header);
     return AWS_OP_SUCCESS;
 
 error:
@@ -506,7 +691,7 @@ int aws_hpack_resize_dynamic_table(struct aws_hpack_context *context, size_t new
     }
 
     /* If downsizing, remove elements until we're within the new size constraints */
-    if (s_dynamic_table_shrink(context, new_max_size)) {
+    if (s_dynamic_table_shrink(context, new_max_size, false /*record_usage*/)) {
         goto error;
     }
 
@@ -515,6 +700,16 @@ int aws_hpack_resize_dynamic_table(struct aws_hpack_context *context, size_t new
         goto error;
     }
 
+    /* Strings storage will grow again as needed, up to twice the new max size */
+    const size_t live_strings_len = context->dynamic_table.strings_end - context->dynamic_table.strings_start;
+    const size_t strings_capacity = aws_min_size(
+        context->dynamic_table.strings_capacity,
+        aws_max_size(live_strings_len, aws_mul_size_saturating(new_max_size, 2)));
+    if (strings_capacity != context->dynamic_table.strings_capacity &&
+        s_dynamic_table_resize_strings(context, strings_capacity)) {
+        goto error;
+    }
+
     /* Update the max size */
     context->dynamic_table.max_size = new_max_size;
 
@@ -523,3 +718,30 @@ int aws_hpack_resize_dynamic_table(struct aws_hpack_context *context, size_t new
 error:
     return AWS_OP_ERR;
 }
+
+size_t aws_hpack_suggest_dynamic_table_size(struct aws_hpack_context *context, size_t min_size, size_t max_size) {
+    AWS_PRECONDITION(min_size <= max_size);
+
+    const size_t current_size = context->dynamic_table.max_size;
+    size_t suggested_size = current_size;
+
+    const uint64_t reinserts = context->dynamic_table.usage.num_evicted_reinserts;
+    if (reinserts >= s_hpack_usage_min_reinserts_to_grow &&
+        reinserts * s_hpack_usage_reinsert_ratio_to_grow >= context->dynamic_table.usage.num_inserts) {
+        /* Entries are being evicted and then needed again soon after */
+        suggested_size = aws_mul_size_saturating(current_size, 2);
+    } else if (
+        context->dynamic_table.usage.num_evictions == 0 &&
+        aws_mul_size_saturating(context->dynamic_table.usage.peak_size, 4) <= current_size) {
+        /* Most of the table went unused, give back memory but leave room for what was used */
+        suggested_size =
+            aws_max_size(current_size / 2, aws_mul_size_saturating(context->dynamic_table.usage.peak_size, 2));
+    }
+
+    context->dynamic_table.usage.peak_size = context->dynamic_table.size;
+    context->dynamic_table.usage.num_inserts = 0;
+    context->dynamic_table.usage.num_evictions = 0;
+    context->dynamic_table.usage.num_evicted_reinserts = 0;
+
+    return aws_min_size(aws_max_size(suggested_size, min_size), max_size);
+}
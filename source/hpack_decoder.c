@@ -8,18 +8,191 @@
     AWS_LOGF_##level(AWS_LS_HTTP_DECODER, "id=%p [HPACK]: " text, (decoder)->log_id, __VA_ARGS__)
 #define HPACK_LOG(level, decoder, text) HPACK_LOGF(level, decoder, "%s", text)
 
-struct aws_huffman_symbol_coder *hpack_get_coder(void);
-
 /* Used while decoding the header name & value, grows if necessary */
 const size_t s_hpack_decoder_scratch_initial_size = 512;
 
+/*
+ * Huffman decoding is driven by a table of transitions, 4 bits at a time.
+ * The HPACK Huffman code (257 symbols, including EOS) forms a binary tree with 256 internal nodes,
+ * each internal node is a state. From any state, a nibble of input leads to another state,
+ * possibly emitting one symbol along the way (shortest code is 5 bits, so a nibble never completes two).
+ * The table is built from hpack_huffman_static_table.def when the library is initialized.
+ */
+enum {
+    AWS_HPACK_HUFFMAN_NUM_STATES = 256,
+    AWS_HPACK_HUFFMAN_EOS = 256,
+};
+
+enum aws_hpack_huffman_transition_flags {
+    AWS_HPACK_HUFFMAN_EMIT = 0x1,
+    AWS_HPACK_HUFFMAN_FAIL = 0x2,
+};
+
+struct aws_hpack_huffman_transition {
+    uint8_t next_state;
+    uint8_t flags;
+    uint8_t symbol;
+};
+
+static struct aws_hpack_huffman_transition s_huffman_transitions[AWS_HPACK_HUFFMAN_NUM_STATES][16];
+
+/* Whether string may end in this state. True for the root, and for states reached from the root by 1-7 "1" bits,
+ * since padding must be the most significant bits of EOS (which is all 1s) and shorter than 8 bits. */
+static bool s_huffman_accepting[AWS_HPACK_HUFFMAN_NUM_STATES];
+
+void aws_hpack_huffman_decode_table_init(void) {
+    struct huffman_code {
+        uint32_t pattern;
+        uint8_t num_bits;
+    };
+    static const struct huffman_code s_codes[AWS_HPACK_HUFFMAN_EOS + 1] = {
+#define HUFFMAN_CODE(psymbol, pbit_string, pbit_code, pnum_bits) [psymbol] = {(pbit_code), (pnum_bits)},
+#include <aws/http/private/hpack_huffman_static_table.def>
+#undef HUFFMAN_CODE
+        [AWS_HPACK_HUFFMAN_EOS] = {0x3fffffff, 30},
+    };
+
+    /* Build the code tree. A child >= 0 is an internal node, a child < 0 is leaf for symbol (-child - 1) */
+    static int16_t s_tree[AWS_HPACK_HUFFMAN_NUM_STATES][2];
+    AWS_ZERO_ARRAY(s_tree);
+    size_t num_nodes = 1;
+
+    AWS_ZERO_ARRAY(s_huffman_accepting);
+    s_huffman_accepting[0] = true;
+
+    for (int symbol = 0; symbol <= AWS_HPACK_HUFFMAN_EOS; ++symbol) {
+        const struct huffman_code code = s_codes[symbol];
+        size_t node = 0;
+        for (uint8_t depth = 1; depth <= code.num_bits; ++depth) {
+            const uint8_t bit = (code.pattern >> (code.num_bits - depth)) & 0x1;
+            if (depth == code.num_bits) {
+                AWS_FATAL_ASSERT(s_tree[node][bit] == 0);
+                s_tree[node][bit] = (int16_t)(-symbol - 1);
+            } else {
+                if (s_tree[node][bit] == 0) {
+                    AWS_FATAL_ASSERT(num_nodes < AWS_HPACK_HUFFMAN_NUM_STATES);
+                    s_tree[node][bit] = (int16_t)num_nodes++;
+                }
+                AWS_FATAL_ASSERT(s_tree[node][bit] > 0);
+                node = (size_t)s_tree[node][bit];
+
+                if (symbol == AWS_HPACK_HUFFMAN_EOS && depth <= 7) {
+                    s_huffman_accepting[node] = true;
+                }
+            }
+        }
+    }
+    AWS_FATAL_ASSERT(num_nodes == AWS_HPACK_HUFFMAN_NUM_STATES);
+
+    /* Walk 4 bits from every state to fill in the transitions */
+    for (size_t state = 0; state < AWS_HPACK_HUFFMAN_NUM_STATES; ++state) {
+        for (uint8_t nibble = 0; nibble < 16; ++nibble) {
+            struct aws_hpack_huffman_transition transition = {.next_state = 0, .flags = 0, .symbol = 0};
+            size_t node = state;
+            for (int shift = 3; shift >= 0; --shift) {
+                const int16_t child = s_tree[node][(nibble >> shift) & 0x1];
+                if (child < 0) {
+                    const int symbol = -child - 1;
+                    if (symbol == AWS_HPACK_HUFFMAN_EOS) {
+                        transition.flags = AWS_HPACK_HUFFMAN_FAIL;
+                        break;
+                    }
+                    transition.flags |= AWS_HPACK_HUFFMAN_EMIT;
+                    transition.symbol = (uint8_t)symbol;
+                    node = 0;
+                } else {
+                    node = (size_t)child;
+                }
+            }
+            transition.next_state = (uint8_t)node;
+            s_huffman_transitions[state][nibble] = transition;
+        }
+    }
+}
+
+void aws_hpack_huffman_decoder_reset(struct aws_hpack_huffman_decoder *decoder) {
+    decoder->state = 0;
+}
+
+int aws_hpack_huffman_decode(
+    struct aws_hpack_huffman_decoder *decoder,
+    struct aws_byte_cursor *to_decode,
+    struct aws_byte_buf *output) {
+
+    AWS_PRECONDITION(decoder);
+    AWS_PRECONDITION(aws_byte_cursor_is_valid(to_decode));
+    AWS_PRECONDITION(aws_byte_buf_is_valid(output));
+
+    if (to_decode->len == 0) {
+        return AWS_OP_SUCCESS;
+    }
+
+    /* Every symbol is at least 5 bits, and fewer than 30 bits can be left over from the previous chunk.
+     * Ensure there's room for the most symbols this could possibly produce, so the loop needn't check. */
+    size_t max_symbols;
+    if (aws_mul_size_checked(to_decode->len, 8, &max_symbols) ||
+        aws_add_size_checked(max_symbols, 29, &max_symbols)) {
+        return AWS_OP_ERR;
+    }
+    max_symbols /= 5;
+    if (output->capacity - output->len < max_symbols) {
+        /* Prefer to double capacity, but if that's not enough grow to exactly what's required */
+        size_t required_capacity;
+        if (aws_add_size_checked(output->len, max_symbols, &required_capacity)) {
+            return AWS_OP_ERR;
+        }
+        size_t double_capacity = aws_add_size_saturating(output->capacity, output->capacity);
+        if (aws_byte_buf_reserve(output, aws_max_size(required_capacity, double_capacity))) {
+            return AWS_OP_ERR;
+        }
+    }
+
+    uint8_t *dst = output->buffer + output->len;
+    uint8_t state = decoder->state;
+
+    for (size_t i = 0; i < to_decode->len; ++i) {
+        const uint8_t byte = to_decode->ptr[i];
+
+        const struct aws_hpack_huffman_transition *transition = &s_huffman_transitions[state][byte >> 4];
+        if (AWS_UNLIKELY(transition->flags & AWS_HPACK_HUFFMAN_FAIL)) {
+            goto eos_error;
+        }
+        if (transition->flags & AWS_HPACK_HUFFMAN_EMIT) {
+            *dst++ = transition->symbol;
+        }
+        state = transition->next_state;
+
+        transition = &s_huffman_transitions[state][byte & 0xf];
+        if (AWS_UNLIKELY(transition->flags & AWS_HPACK_HUFFMAN_FAIL)) {
+            goto eos_error;
+        }
+        if (transition->flags & AWS_HPACK_HUFFMAN_EMIT) {
+            *dst++ = transition->symbol;
+        }
+        state = transition->next_state;
+    }
+
+    output->len = (size_t)(dst - output->buffer);
+    decoder->state = state;
+    aws_byte_cursor_advance(to_decode, to_decode->len);
+    return AWS_OP_SUCCESS;
+
+eos_error:
+    /* HPACK says to treat EOS as an error */
+    return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+}
+
+int aws_hpack_huffman_decode_finish(const struct aws_hpack_huffman_decoder *decoder) {
+    if (!s_huffman_accepting[decoder->state]) {
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+    }
+    return AWS_OP_SUCCESS;
+}
+
 void aws_hpack_decoder_init(struct aws_hpack_decoder *decoder, struct aws_allocator *allocator, const void *log_id) {
     AWS_ZERO_STRUCT(*decoder);
     decoder->log_id = log_id;
 
-    aws_huffman_decoder_init(&decoder->huffman_decoder, hpack_get_coder());
-    aws_huffman_decoder_allow_growth(&decoder->huffman_decoder, true);
-
     aws_hpack_context_init(&decoder->context, allocator, AWS_LS_HTTP_DECODER, log_id);
 
     aws_byte_buf_init(&decoder->progress_entry.scratch, allocator, s_hpack_decoder_scratch_initial_size);
@@ -149,7 +322,7 @@ int aws_hpack_decode_string(
                 /* Do init stuff */
                 progress->state = HPACK_STRING_STATE_LENGTH;
                 progress->use_huffman = *to_decode->ptr >> 7;
-                aws_huffman_decoder_reset(&decoder->huffman_decoder);
+                aws_hpack_huffman_decoder_reset(&decoder->huffman_decoder);
                 /* fallthrough, since we didn't consume any data */
             }
             /* FALLTHRU */
@@ -182,17 +355,10 @@ int aws_hpack_decode_string(
                 struct aws_byte_cursor chunk = aws_byte_cursor_advance(to_decode, to_process);
 
                 if (progress->use_huffman) {
-                    if (aws_huffman_decode(&decoder->huffman_decoder, &chunk, output)) {
+                    if (aws_hpack_huffman_decode(&decoder->huffman_decoder, &chunk, output)) {
                         HPACK_LOGF(ERROR, decoder, "Error from Huffman decoder: %s", aws_error_name(aws_last_error()));
                         return AWS_OP_ERR;
                     }
-
-                    /* Decoder should consume all bytes we feed it.
-                     * EOS (end-of-string) symbol could stop it early, but HPACK says to treat EOS as error. */
-                    if (chunk.len != 0) {
-                        HPACK_LOG(ERROR, decoder, "Huffman encoded end-of-string symbol is illegal");
-                        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
-                    }
                 } else {
                     if (aws_byte_buf_append_dynamic(output, &chunk)) {
                         return AWS_OP_ERR;
@@ -201,9 +367,12 @@ int aws_hpack_decode_string(
 
                 /* If whole length consumed, we're done */
                 if (progress->length == 0) {
-                    /* #TODO Validate any padding bits left over in final byte of string.
-                     * "A padding not corresponding to the most significant bits of the
+                    /* "A padding not corresponding to the most significant bits of the
                      * code for the EOS symbol MUST be treated as a decoding error" */
+                    if (progress->use_huffman && aws_hpack_huffman_decode_finish(&decoder->huffman_decoder)) {
+                        HPACK_LOG(ERROR, decoder, "Huffman encoded string has invalid padding");
+                        return AWS_OP_ERR;
+                    }
 
                     /* #TODO impose limits on string length */
 
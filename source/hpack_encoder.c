@@ -4,12 +4,45 @@
  */
 #include <aws/http/private/hpack.h>
 
+#include <aws/http/private/http_impl.h>
+
 #define HPACK_LOGF(level, encoder, text, ...)                                                                          \
     AWS_LOGF_##level(AWS_LS_HTTP_ENCODER, "id=%p [HPACK]: " text, (encoder)->log_id, __VA_ARGS__)
 #define HPACK_LOG(level, encoder, text) HPACK_LOGF(level, encoder, "%s", text)
 
 struct aws_huffman_symbol_coder *hpack_get_coder(void);
 
+/* What the encoder has learned about one header-field from aws_hpack_encoder_set_header_template() */
+struct aws_hpack_header_template_entry {
+    /* Copy of header-field, strings point into storage */
+    struct aws_http_header header;
+    struct aws_byte_buf storage;
+
+    /* Static table index. Name and value match if static_value_found, otherwise name-only match. 0 if not found */
+    size_t static_index;
+    bool static_value_found;
+
+    /* Insertion number from the last time this header-field was inserted into the dynamic table, 0 if never */
+    uint64_t dynamic_insertion;
+
+    /* HPACK string literals for name and value, valid if is_encoded and huffman mode hasn't changed since */
+    struct aws_byte_buf encoded_name;
+    struct aws_byte_buf encoded_value;
+    enum aws_hpack_huffman_mode encoded_huffman_mode;
+    bool is_encoded;
+};
+
+struct aws_hpack_header_template {
+    struct aws_allocator *allocator;
+    struct aws_hpack_header_template_entry *entries;
+    size_t num_entries;
+
+    /* aws_http_header * -> aws_hpack_header_template_entry *. Keys point into entries */
+    struct aws_hash_table lookup;
+};
+
+static void s_header_template_destroy(struct aws_hpack_header_template *header_template);
+
 void aws_hpack_encoder_init(struct aws_hpack_encoder *encoder, struct aws_allocator *allocator, const void *log_id) {
 
     AWS_ZERO_STRUCT(*encoder);
@@ -22,9 +55,14 @@ void aws_hpack_encoder_init(struct aws_hpack_encoder *encoder, struct aws_alloca
     encoder->dynamic_table_size_update.pending = false;
     encoder->dynamic_table_size_update.latest_value = SIZE_MAX;
     encoder->dynamic_table_size_update.smallest_value = SIZE_MAX;
+
+    /* Capacity 0 allocates nothing, encoders that never send HTTP/1 messages never grow it */
+    aws_byte_buf_init(&encoder->lowercase_name_buf, allocator, 0);
 }
 
 void aws_hpack_encoder_clean_up(struct aws_hpack_encoder *encoder) {
+    s_header_template_destroy(encoder->header_template);
+    aws_byte_buf_clean_up(&encoder->lowercase_name_buf);
     aws_hpack_context_clean_up(&encoder->context);
     AWS_ZERO_STRUCT(*encoder);
 }
@@ -33,6 +71,15 @@ void aws_hpack_encoder_set_huffman_mode(struct aws_hpack_encoder *encoder, enum
     encoder->huffman_mode = mode;
 }
 
+void aws_hpack_encoder_set_indexing_policy(struct aws_hpack_encoder *encoder, bool enabled) {
+    encoder->indexing_policy.enabled = enabled;
+    AWS_ZERO_ARRAY(encoder->indexing_policy.slots);
+}
+
+void aws_hpack_encoder_get_stats(const struct aws_hpack_encoder *encoder, struct aws_hpack_encoder_stats *out_stats) {
+    *out_stats = encoder->stats;
+}
+
 void aws_hpack_encoder_update_max_table_size(struct aws_hpack_encoder *encoder, uint32_t new_max_size) {
 
     if (!encoder->dynamic_table_size_update.pending) {
@@ -130,6 +177,65 @@ error:
     return AWS_OP_ERR;
 }
 
+/* HPACK Huffman code for each byte value (RFC-7541 Appendix B), right-aligned */
+static const struct {
+    uint32_t pattern;
+    uint8_t num_bits;
+} s_huffman_codes[256] = {
+#define HUFFMAN_CODE(psymbol, pbit_string, pbit_code, pnum_bits) [psymbol] = {(pbit_code), (pnum_bits)},
+#include <aws/http/private/hpack_huffman_static_table.def>
+#undef HUFFMAN_CODE
+};
+
+/* Length in bytes of the Huffman-encoded string, including padding */
+static size_t s_huffman_encoded_length(struct aws_byte_cursor to_encode) {
+    /* Every code is at most 30 bits, so this can't overflow unless the string is absurdly long */
+    uint64_t num_bits = 0;
+    for (size_t i = 0; i < to_encode.len; ++i) {
+        num_bits += s_huffman_codes[to_encode.ptr[i]].num_bits;
+    }
+    return (size_t)((num_bits + 7) / 8);
+}
+
+/* Huffman-encode into output, which must already have room for s_huffman_encoded_length() bytes.
+ * Codes are gathered in a 64-bit accumulator and written out 32 bits at a time. */
+static void s_huffman_encode(struct aws_byte_cursor to_encode, struct aws_byte_buf *output) {
+    uint8_t *dst = output->buffer + output->len;
+    uint64_t accumulator = 0;
+    /* Number of pending bits in the accumulator, always < 32 between symbols, so adding a code (<= 30) fits */
+    size_t num_bits = 0;
+
+    for (size_t i = 0; i < to_encode.len; ++i) {
+        const uint8_t symbol = to_encode.ptr[i];
+        accumulator = (accumulator << s_huffman_codes[symbol].num_bits) | s_huffman_codes[symbol].pattern;
+        num_bits += s_huffman_codes[symbol].num_bits;
+
+        if (num_bits >= 32) {
+            num_bits -= 32;
+            const uint32_t word = (uint32_t)(accumulator >> num_bits);
+            dst[0] = (uint8_t)(word >> 24);
+            dst[1] = (uint8_t)(word >> 16);
+            dst[2] = (uint8_t)(word >> 8);
+            dst[3] = (uint8_t)word;
+            dst += 4;
+        }
+    }
+
+    /* Write out whole bytes */
+    while (num_bits >= 8) {
+        num_bits -= 8;
+        *dst++ = (uint8_t)(accumulator >> num_bits);
+    }
+
+    /* Pad the final byte with the most significant bits of EOS (all 1s) */
+    if (num_bits > 0) {
+        const size_t num_padding_bits = 8 - num_bits;
+        *dst++ = (uint8_t)((accumulator << num_padding_bits) | (UINT8_MAX >> num_bits));
+    }
+
+    output->len = (size_t)(dst - output->buffer);
+}
+
 int aws_hpack_encode_string(
     struct aws_hpack_encoder *encoder,
     struct aws_byte_cursor to_encode,
@@ -152,11 +258,11 @@ int aws_hpack_encode_string(
 
         case AWS_HPACK_HUFFMAN_ALWAYS:
             use_huffman = 1;
-            str_length = aws_huffman_get_encoded_length(&encoder->huffman_encoder, to_encode);
+            str_length = s_huffman_encoded_length(to_encode);
             break;
 
         case AWS_HPACK_HUFFMAN_SMALLEST:
-            str_length = aws_huffman_get_encoded_length(&encoder->huffman_encoder, to_encode);
+            str_length = s_huffman_encoded_length(to_encode);
             if (str_length < to_encode.len) {
                 use_huffman = 1;
             } else {
@@ -197,10 +303,7 @@ int aws_hpack_encode_string(
                 goto error;
             }
 
-            if (aws_huffman_encode(&encoder->huffman_encoder, &to_encode, output)) {
-                HPACK_LOGF(ERROR, encoder, "Error from Huffman encoder: %s", aws_error_name(aws_last_error()));
-                goto error;
-            }
+            s_huffman_encode(to_encode, output);
 
         } else {
             if (aws_byte_buf_append_dynamic(output, &to_encode)) {
@@ -213,7 +316,6 @@ int aws_hpack_encode_string(
 
 error:
     output->len = original_len;
-    aws_huffman_encoder_reset(&encoder->huffman_encoder);
     return AWS_OP_ERR;
 }
 
@@ -274,6 +376,61 @@ static int s_convert_http_compression_to_literal_entry_type(
     return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
 }
 
+/* When a name's occurrences reach this, its counts are halved */
+static const uint16_t s_indexing_policy_window = 32;
+/* Keep indexing a name until it's been seen this many times, there's no evidence against it yet */
+static const uint16_t s_indexing_policy_min_occurrences = 8;
+/* After that, keep indexing a name if at least 1 in this many occurrences repeats a recent value */
+static const uint16_t s_indexing_policy_min_repeat_ratio = 4;
+
+/* Record a USE_CACHE header-field and return whether the policy thinks it's worth inserting into the dynamic table */
+static bool s_indexing_policy_should_insert(struct aws_hpack_encoder *encoder, const struct aws_http_header *header) {
+    if (!encoder->indexing_policy.enabled) {
+        return true;
+    }
+
+    const uint32_t name_hash = (uint32_t)aws_hash_byte_cursor_ptr(&header->name);
+    const uint32_t value_hash = (uint32_t)aws_hash_byte_cursor_ptr(&header->value);
+
+    /* Direct-mapped, a different name landing in the slot takes it over */
+    struct aws_hpack_indexing_policy_slot *slot =
+        &encoder->indexing_policy.slots[name_hash % AWS_HPACK_INDEXING_POLICY_NAME_SLOTS];
+    if (slot->name_hash != name_hash || slot->occurrences == 0) {
+        AWS_ZERO_STRUCT(*slot);
+        slot->name_hash = name_hash;
+    }
+
+    bool repeated = false;
+    for (size_t i = 0; i < slot->num_recent_values; ++i) {
+        if (slot->recent_value_hashes[i] == value_hash) {
+            repeated = true;
+            break;
+        }
+    }
+
+    if (!repeated) {
+        slot->recent_value_hashes[slot->next_recent_value] = value_hash;
+        slot->next_recent_value = (slot->next_recent_value + 1) % AWS_HPACK_INDEXING_POLICY_RECENT_VALUES;
+        if (slot->num_recent_values < AWS_HPACK_INDEXING_POLICY_RECENT_VALUES) {
+            slot->num_recent_values++;
+        }
+    }
+
+    slot->occurrences++;
+    if (repeated) {
+        slot->repeats++;
+    }
+    if (slot->occurrences >= s_indexing_policy_window) {
+        slot->occurrences /= 2;
+        slot->repeats /= 2;
+    }
+
+    if (slot->occurrences < s_indexing_policy_min_occurrences) {
+        return true;
+    }
+    return (uint32_t)slot->repeats * s_indexing_policy_min_repeat_ratio >= slot->occurrences;
+}
+
 static int s_encode_header_field(
     struct aws_hpack_encoder *encoder,
     const struct aws_http_header *header,
@@ -289,9 +446,12 @@ static int s_encode_header_field(
     bool found_indexed_value;
     size_t header_index = aws_hpack_find_index(&encoder->context, header, true, &found_indexed_value);
 
+    bool should_insert = false;
     if (header->compression != AWS_HTTP_HEADER_COMPRESSION_USE_CACHE) {
         /* If user doesn't want to use indexed value, then don't use it */
         found_indexed_value = false;
+    } else {
+        should_insert = s_indexing_policy_should_insert(encoder, header);
     }
 
     if (header_index && found_indexed_value) {
@@ -305,6 +465,7 @@ static int s_encode_header_field(
             goto error;
         }
 
+        encoder->stats.num_indexed++;
         return AWS_OP_SUCCESS;
     }
 
@@ -315,6 +476,10 @@ static int s_encode_header_field(
     if (s_convert_http_compression_to_literal_entry_type(header->compression, &literal_entry_type)) {
         goto error;
     }
+    if (literal_entry_type == AWS_HPACK_ENTRY_LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING && !should_insert) {
+        literal_entry_type = AWS_HPACK_ENTRY_LITERAL_HEADER_FIELD_WITHOUT_INDEXING;
+        encoder->stats.num_skipped_by_policy++;
+    }
 
     /* the entry type makes up the first few bits of the next integer we encode */
     uint8_t starting_bit_pattern = s_hpack_entry_starting_bit_pattern[literal_entry_type];
@@ -348,9 +513,13 @@ static int s_encode_header_field(
 
     /* if "incremental indexing" type, insert header into the dynamic table. */
     if (AWS_HPACK_ENTRY_LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING == literal_entry_type) {
+        const uint64_t prev_insert_count = encoder->context.dynamic_table.insert_count;
         if (aws_hpack_insert_header(&encoder->context, header)) {
             goto error;
         }
+        if (encoder->context.dynamic_table.insert_count != prev_insert_count) {
+            encoder->stats.num_inserted++;
+        }
     }
 
     return AWS_OP_SUCCESS;
@@ -359,60 +528,422 @@ error:
     return AWS_OP_ERR;
 }
 
-int aws_hpack_encode_header_block(
+static uint64_t s_template_header_hash(const void *key) {
+    const struct aws_http_header *header = key;
+    return aws_hash_combine(aws_hash_byte_cursor_ptr(&header->name), aws_hash_byte_cursor_ptr(&header->value));
+}
+
+static bool s_template_header_eq(const void *a, const void *b) {
+    const struct aws_http_header *left = a;
+    const struct aws_http_header *right = b;
+    return aws_byte_cursor_eq(&left->name, &right->name) && aws_byte_cursor_eq(&left->value, &right->value);
+}
+
+static void s_header_template_destroy(struct aws_hpack_header_template *header_template) {
+    if (!header_template) {
+        return;
+    }
+
+    for (size_t i = 0; i < header_template->num_entries; ++i) {
+        struct aws_hpack_header_template_entry *entry = &header_template->entries[i];
+        aws_byte_buf_clean_up(&entry->storage);
+        aws_byte_buf_clean_up(&entry->encoded_name);
+        aws_byte_buf_clean_up(&entry->encoded_value);
+    }
+    aws_hash_table_clean_up(&header_template->lookup);
+    aws_mem_release(header_template->allocator, header_template->entries);
+    aws_mem_release(header_template->allocator, header_template);
+}
+
+int aws_hpack_encoder_set_header_template(struct aws_hpack_encoder *encoder, const struct aws_http_headers *headers) {
+    AWS_PRECONDITION(encoder);
+
+    s_header_template_destroy(encoder->header_template);
+    encoder->header_template = NULL;
+
+    const size_t num_headers = headers ? aws_http_headers_count(headers) : 0;
+    if (num_headers == 0) {
+        return AWS_OP_SUCCESS;
+    }
+
+    struct aws_allocator *allocator = encoder->context.allocator;
+    struct aws_hpack_header_template *header_template =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_hpack_header_template));
+    header_template->allocator = allocator;
+
+    header_template->entries = aws_mem_calloc(allocator, num_headers, sizeof(struct aws_hpack_header_template_entry));
+    if (!header_template->entries) {
+        goto error;
+    }
+    header_template->num_entries = num_headers;
+
+    if (aws_hash_table_init(
+            &header_template->lookup,
+            allocator,
+            num_headers,
+            s_template_header_hash,
+            s_template_header_eq,
+            NULL,
+            NULL)) {
+        goto error;
+    }
+
+    for (size_t i = 0; i < num_headers; ++i) {
+        struct aws_hpack_header_template_entry *entry = &header_template->entries[i];
+
+        struct aws_http_header src;
+        aws_http_headers_get_index(headers, i, &src);
+
+        /* Copy strings into storage we own */
+        if (aws_byte_buf_init(&entry->storage, allocator, src.name.len + src.value.len)) {
+            goto error;
+        }
+        /* Encoded string buffers grow as needed */
+        aws_byte_buf_init(&entry->encoded_name, allocator, 0);
+        aws_byte_buf_init(&entry->encoded_value, allocator, 0);
+        entry->header = src;
+        aws_byte_buf_append_and_update(&entry->storage, &entry->header.name);
+        aws_byte_buf_append_and_update(&entry->storage, &entry->header.value);
+
+        /* Static table never changes, so look it up once */
+        entry->static_index = aws_hpack_find_static_index(&entry->header, &entry->static_value_found);
+
+        if (aws_hash_table_put(&header_template->lookup, &entry->header, entry, NULL)) {
+            goto error;
+        }
+    }
+
+    HPACK_LOGF(DEBUG, encoder, "Header template set with %zu header-fields", num_headers);
+    encoder->header_template = header_template;
+    return AWS_OP_SUCCESS;
+
+error:
+    HPACK_LOGF(ERROR, encoder, "Failed to set header template: %s", aws_error_name(aws_last_error()));
+    s_header_template_destroy(header_template);
+    return AWS_OP_ERR;
+}
+
+/* Encode a header-field that matches a template entry, reusing cached work instead of table lookups and
+ * string encoding. Produces the same representation choices as s_encode_header_field(), except that a name
+ * only found in the dynamic table is sent as a literal */
+static int s_encode_template_header_field(
     struct aws_hpack_encoder *encoder,
-    const struct aws_http_headers *headers,
+    struct aws_hpack_header_template_entry *entry,
+    enum aws_http_header_compression compression,
     struct aws_byte_buf *output) {
 
-    /* Encode a dynamic table size update at the beginning of the first header-block
-     * following the change to the dynamic table size RFC-7541 4.2 */
-    if (encoder->dynamic_table_size_update.pending) {
-        if (encoder->dynamic_table_size_update.smallest_value != encoder->dynamic_table_size_update.latest_value) {
-            size_t smallest_update_value = encoder->dynamic_table_size_update.smallest_value;
-            HPACK_LOGF(
-                TRACE, encoder, "Encoding smallest dynamic table size update entry size: %zu", smallest_update_value);
-            if (aws_hpack_resize_dynamic_table(&encoder->context, smallest_update_value)) {
-                HPACK_LOGF(ERROR, encoder, "Dynamic table resize failed, size: %zu", smallest_update_value);
-                return AWS_OP_ERR;
+    size_t original_len = output->len;
+
+    if (compression == AWS_HTTP_HEADER_COMPRESSION_USE_CACHE) {
+        size_t header_index = 0;
+        if (entry->static_index && entry->static_value_found) {
+            header_index = entry->static_index;
+        } else {
+            /* Index is 0 if the peer's copy was evicted since we inserted it */
+            header_index = aws_hpack_get_index_of_insertion(&encoder->context, entry->dynamic_insertion);
+        }
+
+        if (header_index) {
+            /* Indexed header field */
+            const enum aws_hpack_entry_type entry_type = AWS_HPACK_ENTRY_INDEXED_HEADER_FIELD;
+            uint8_t starting_bit_pattern = s_hpack_entry_starting_bit_pattern[entry_type];
+            uint8_t num_prefix_bits = s_hpack_entry_num_prefix_bits[entry_type];
+            if (aws_hpack_encode_integer(header_index, starting_bit_pattern, num_prefix_bits, output)) {
+                goto error;
             }
-            uint8_t starting_bit_pattern = s_hpack_entry_starting_bit_pattern[AWS_HPACK_ENTRY_DYNAMIC_TABLE_RESIZE];
-            uint8_t num_prefix_bits = s_hpack_entry_num_prefix_bits[AWS_HPACK_ENTRY_DYNAMIC_TABLE_RESIZE];
-            if (aws_hpack_encode_integer(smallest_update_value, starting_bit_pattern, num_prefix_bits, output)) {
-                HPACK_LOGF(
-                    ERROR,
-                    encoder,
-                    "Integer encoding failed for table size update entry, integer: %zu",
-                    smallest_update_value);
-                return AWS_OP_ERR;
+            encoder->stats.num_indexed++;
+            return AWS_OP_SUCCESS;
+        }
+    }
+
+    /* Else, Literal header field... */
+    enum aws_hpack_entry_type literal_entry_type = AWS_HPACK_ENTRY_TYPE_COUNT;
+    if (s_convert_http_compression_to_literal_entry_type(compression, &literal_entry_type)) {
+        goto error;
+    }
+
+    /* Encode strings the first time they're needed, or again if huffman mode changed */
+    if (!entry->is_encoded || entry->encoded_huffman_mode != encoder->huffman_mode) {
+        aws_byte_buf_reset(&entry->encoded_name, false);
+        aws_byte_buf_reset(&entry->encoded_value, false);
+        entry->is_encoded = false;
+
+        if (!entry->static_index) {
+            if (aws_hpack_encode_string(encoder, entry->header.name, &entry->encoded_name)) {
+                goto error;
             }
         }
-        size_t last_update_value = encoder->dynamic_table_size_update.latest_value;
-        HPACK_LOGF(TRACE, encoder, "Encoding last dynamic table size update entry size: %zu", last_update_value);
-        if (aws_hpack_resize_dynamic_table(&encoder->context, last_update_value)) {
-            HPACK_LOGF(ERROR, encoder, "Dynamic table resize failed, size: %zu", last_update_value);
+        if (aws_hpack_encode_string(encoder, entry->header.value, &entry->encoded_value)) {
+            goto error;
+        }
+        entry->encoded_huffman_mode = encoder->huffman_mode;
+        entry->is_encoded = true;
+    }
+
+    uint8_t starting_bit_pattern = s_hpack_entry_starting_bit_pattern[literal_entry_type];
+    uint8_t num_prefix_bits = s_hpack_entry_num_prefix_bits[literal_entry_type];
+
+    /* Literal header field, with indexed name (static_index) or new name (index 0, followed by name string) */
+    if (aws_hpack_encode_integer(entry->static_index, starting_bit_pattern, num_prefix_bits, output)) {
+        goto error;
+    }
+    if (!entry->static_index) {
+        struct aws_byte_cursor encoded_name = aws_byte_cursor_from_buf(&entry->encoded_name);
+        if (aws_byte_buf_append_dynamic(output, &encoded_name)) {
+            goto error;
+        }
+    }
+
+    struct aws_byte_cursor encoded_value = aws_byte_cursor_from_buf(&entry->encoded_value);
+    if (aws_byte_buf_append_dynamic(output, &encoded_value)) {
+        goto error;
+    }
+
+    /* if "incremental indexing" type, insert header into the dynamic table, and remember where it went. */
+    if (AWS_HPACK_ENTRY_LITERAL_HEADER_FIELD_WITH_INCREMENTAL_INDEXING == literal_entry_type) {
+        const uint64_t prev_insert_count = encoder->context.dynamic_table.insert_count;
+        if (aws_hpack_insert_header(&encoder->context, &entry->header)) {
+            goto error;
+        }
+        if (encoder->context.dynamic_table.insert_count != prev_insert_count) {
+            entry->dynamic_insertion = encoder->context.dynamic_table.insert_count;
+            encoder->stats.num_inserted++;
+        }
+    }
+
+    return AWS_OP_SUCCESS;
+error:
+    output->len = original_len;
+    return AWS_OP_ERR;
+}
+
+/* Encode a dynamic table size update at the beginning of the first header-block
+ * following the change to the dynamic table size RFC-7541 4.2 */
+static int s_encode_dynamic_table_size_updates(struct aws_hpack_encoder *encoder, struct aws_byte_buf *output) {
+    if (!encoder->dynamic_table_size_update.pending) {
+        return AWS_OP_SUCCESS;
+    }
+
+    if (encoder->dynamic_table_size_update.smallest_value != encoder->dynamic_table_size_update.latest_value) {
+        size_t smallest_update_value = encoder->dynamic_table_size_update.smallest_value;
+        HPACK_LOGF(
+            TRACE, encoder, "Encoding smallest dynamic table size update entry size: %zu", smallest_update_value);
+        if (aws_hpack_resize_dynamic_table(&encoder->context, smallest_update_value)) {
+            HPACK_LOGF(ERROR, encoder, "Dynamic table resize failed, size: %zu", smallest_update_value);
             return AWS_OP_ERR;
         }
         uint8_t starting_bit_pattern = s_hpack_entry_starting_bit_pattern[AWS_HPACK_ENTRY_DYNAMIC_TABLE_RESIZE];
         uint8_t num_prefix_bits = s_hpack_entry_num_prefix_bits[AWS_HPACK_ENTRY_DYNAMIC_TABLE_RESIZE];
-        if (aws_hpack_encode_integer(last_update_value, starting_bit_pattern, num_prefix_bits, output)) {
+        if (aws_hpack_encode_integer(smallest_update_value, starting_bit_pattern, num_prefix_bits, output)) {
             HPACK_LOGF(
-                ERROR, encoder, "Integer encoding failed for table size update entry, integer: %zu", last_update_value);
+                ERROR,
+                encoder,
+                "Integer encoding failed for table size update entry, integer: %zu",
+                smallest_update_value);
             return AWS_OP_ERR;
         }
+    }
+    size_t last_update_value = encoder->dynamic_table_size_update.latest_value;
+    HPACK_LOGF(TRACE, encoder, "Encoding last dynamic table size update entry size: %zu", last_update_value);
+    if (aws_hpack_resize_dynamic_table(&encoder->context, last_update_value)) {
+        HPACK_LOGF(ERROR, encoder, "Dynamic table resize failed, size: %zu", last_update_value);
+        return AWS_OP_ERR;
+    }
+    uint8_t starting_bit_pattern = s_hpack_entry_starting_bit_pattern[AWS_HPACK_ENTRY_DYNAMIC_TABLE_RESIZE];
+    uint8_t num_prefix_bits = s_hpack_entry_num_prefix_bits[AWS_HPACK_ENTRY_DYNAMIC_TABLE_RESIZE];
+    if (aws_hpack_encode_integer(last_update_value, starting_bit_pattern, num_prefix_bits, output)) {
+        HPACK_LOGF(
+            ERROR, encoder, "Integer encoding failed for table size update entry, integer: %zu", last_update_value);
+        return AWS_OP_ERR;
+    }
+
+    encoder->dynamic_table_size_update.pending = false;
+    encoder->dynamic_table_size_update.latest_value = SIZE_MAX;
+    encoder->dynamic_table_size_update.smallest_value = SIZE_MAX;
+    return AWS_OP_SUCCESS;
+}
+
+/* Encode one header-field of a header-block, using the header template if it has this field */
+static int s_encode_header_block_field(
+    struct aws_hpack_encoder *encoder,
+    const struct aws_http_header *header,
+    struct aws_byte_buf *output) {
+
+    struct aws_hpack_encoder_stats *stats = &encoder->stats;
+    stats->num_header_fields++;
+    stats->raw_bytes += header->name.len + header->value.len;
+
+    if (encoder->header_template) {
+        struct aws_hash_element *elem = NULL;
+        aws_hash_table_find(&encoder->header_template->lookup, header, &elem);
+        if (elem) {
+            return s_encode_template_header_field(encoder, elem->value, header->compression, output);
+        }
+    }
+
+    return s_encode_header_field(encoder, header, output);
+}
+
+int aws_hpack_encode_header_block(
+    struct aws_hpack_encoder *encoder,
+    const struct aws_http_headers *headers,
+    struct aws_byte_buf *output) {
 
-        encoder->dynamic_table_size_update.pending = false;
-        encoder->dynamic_table_size_update.latest_value = SIZE_MAX;
-        encoder->dynamic_table_size_update.smallest_value = SIZE_MAX;
+    const size_t starting_len = output->len;
+
+    if (s_encode_dynamic_table_size_updates(encoder, output)) {
+        return AWS_OP_ERR;
     }
 
     const size_t num_headers = aws_http_headers_count(headers);
     for (size_t i = 0; i < num_headers; ++i) {
         struct aws_http_header header;
         aws_http_headers_get_index(headers, i, &header);
-        if (s_encode_header_field(encoder, &header, output)) {
+
+        if (s_encode_header_block_field(encoder, &header, output)) {
             return AWS_OP_ERR;
         }
     }
 
+    encoder->stats.encoded_bytes += output->len - starting_len;
     return AWS_OP_SUCCESS;
 }
+
+int aws_hpack_encode_header_block_from_http1(
+    struct aws_hpack_encoder *encoder,
+    const struct aws_http_message *http1_request,
+    struct aws_byte_buf *output) {
+
+    AWS_PRECONDITION(aws_http_message_is_request(http1_request));
+
+    const size_t starting_len = output->len;
+
+    /* Validate before encoding anything, so a bad request doesn't leave the dynamic table half-updated */
+    struct aws_http_header method = {.name = aws_http_header_method};
+    if (aws_http_message_get_request_method(http1_request, &method.value)) {
+        HPACK_LOG(ERROR, encoder, "Cannot encode HTTP/1 request as HTTP/2, no method found.");
+        return aws_raise_error(AWS_ERROR_HTTP_INVALID_METHOD);
+    }
+    struct aws_http_header path = {.name = aws_http_header_path};
+    if (aws_http_message_get_request_path(http1_request, &path.value)) {
+        HPACK_LOG(ERROR, encoder, "Cannot encode HTTP/1 request as HTTP/2, no path found.");
+        return aws_raise_error(AWS_ERROR_HTTP_INVALID_PATH);
+    }
+
+    if (s_encode_dynamic_table_size_updates(encoder, output)) {
+        return AWS_OP_ERR;
+    }
+
+    /* Pseudo-headers come first, in the same order aws_http2_message_new_from_http1() adds them */
+    const struct aws_http_headers *headers = aws_http_message_get_const_headers(http1_request);
+    if (s_encode_header_block_field(encoder, &method, output)) {
+        return AWS_OP_ERR;
+    }
+
+    /* TODO: as we support prior knowledge, we may also want to support http? */
+    struct aws_http_header scheme = {
+        .name = aws_http_header_scheme,
+        .value = aws_byte_cursor_from_c_str("https"),
+    };
+    if (s_encode_header_block_field(encoder, &scheme, output)) {
+        return AWS_OP_ERR;
+    }
+
+    /* ":authority" comes from the Host header, if there is one (RFC-9113 8.3.1) */
+    struct aws_http_header authority = {.name = aws_http_header_authority};
+    if (aws_http_headers_get(headers, aws_byte_cursor_from_c_str("host"), &authority.value) == AWS_OP_SUCCESS) {
+        if (s_encode_header_block_field(encoder, &authority, output)) {
+            return AWS_OP_ERR;
+        }
+    }
+
+    if (s_encode_header_block_field(encoder, &path, output)) {
+        return AWS_OP_ERR;
+    }
+
+    const size_t num_headers = aws_http_headers_count(headers);
+    for (size_t i = 0; i < num_headers; ++i) {
+        struct aws_http_header header;
+        aws_http_headers_get_index(headers, i, &header);
+
+        if (aws_http_header_name_is_connection_specific(aws_http_str_to_header_name(header.name))) {
+            continue;
+        }
+
+        /* HTTP/2 names must be lowercase. Only the name is rewritten, the value is encoded from the message */
+        aws_byte_buf_reset(&encoder->lowercase_name_buf, false);
+        if (aws_byte_buf_reserve(&encoder->lowercase_name_buf, header.name.len)) {
+            return AWS_OP_ERR;
+        }
+        aws_byte_buf_append_with_lookup(&encoder->lowercase_name_buf, &header.name, aws_lookup_table_to_lower_get());
+        header.name = aws_byte_cursor_from_buf(&encoder->lowercase_name_buf);
+
+        if (s_encode_header_block_field(encoder, &header, output)) {
+            return AWS_OP_ERR;
+        }
+    }
+
+    encoder->stats.encoded_bytes += output->len - starting_len;
+    return AWS_OP_SUCCESS;
+}
+
+/* Largest encoding of any integer we'd encode (a 64-bit value with the smallest prefix) */
+static const size_t s_hpack_integer_max_size = 11;
+
+/* The longest huffman code is 30 bits, so huffman never turns one octet into more than 4 */
+static const size_t s_huffman_max_octet_size = 4;
+
+/* Largest possible encoding of one header-field: entry type and index, then name and value as literals */
+static size_t s_header_field_max_size(const struct aws_hpack_encoder *encoder, const struct aws_http_header *header) {
+    const size_t octet_size = encoder->huffman_mode == AWS_HPACK_HUFFMAN_ALWAYS ? s_huffman_max_octet_size : 1;
+    size_t size = s_hpack_integer_max_size * 3;
+    size = aws_add_size_saturating(size, aws_mul_size_saturating(header->name.len, octet_size));
+    size = aws_add_size_saturating(size, aws_mul_size_saturating(header->value.len, octet_size));
+    return size;
+}
+
+static size_t s_headers_max_size(const struct aws_hpack_encoder *encoder, const struct aws_http_headers *headers) {
+    /* Up to 2 dynamic table size updates may precede the header-fields */
+    size_t size = s_hpack_integer_max_size * 2;
+
+    const size_t num_headers = aws_http_headers_count(headers);
+    for (size_t i = 0; i < num_headers; ++i) {
+        struct aws_http_header header;
+        aws_http_headers_get_index(headers, i, &header);
+        size = aws_add_size_saturating(size, s_header_field_max_size(encoder, &header));
+    }
+    return size;
+}
+
+size_t aws_hpack_encode_header_block_max_size(
+    const struct aws_hpack_encoder *encoder,
+    const struct aws_http_headers *headers) {
+
+    return s_headers_max_size(encoder, headers);
+}
+
+size_t aws_hpack_encode_header_block_from_http1_max_size(
+    const struct aws_hpack_encoder *encoder,
+    const struct aws_http_message *http1_request) {
+
+    AWS_PRECONDITION(aws_http_message_is_request(http1_request));
+
+    /* Count every header, even the connection-specific ones that get skipped, and the Host header again
+     * as ":authority". Pseudo-headers missing from the request count as empty. */
+    const struct aws_http_headers *headers = aws_http_message_get_const_headers(http1_request);
+    size_t size = s_headers_max_size(encoder, headers);
+
+    struct aws_http_header pseudoheaders[4] = {
+        {.name = aws_http_header_method},
+        {.name = aws_http_header_scheme, .value = aws_byte_cursor_from_c_str("https")},
+        {.name = aws_http_header_authority},
+        {.name = aws_http_header_path},
+    };
+    aws_http_message_get_request_method(http1_request, &pseudoheaders[0].value);
+    aws_http_headers_get(headers, aws_byte_cursor_from_c_str("host"), &pseudoheaders[2].value);
+    aws_http_message_get_request_path(http1_request, &pseudoheaders[3].value);
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(pseudoheaders); ++i) {
+        size = aws_add_size_saturating(size, s_header_field_max_size(encoder, &pseudoheaders[i]));
+    }
+    return size;
+}
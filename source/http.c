@@ -3,7 +3,6 @@
  * SPDX-License-Identifier: Apache-2.0.
  */
 
-#include <aws/common/hash_table.h>
 #include <aws/compression/compression.h>
 #include <aws/http/private/hpack.h>
 #include <aws/http/private/http_impl.h>
@@ -148,6 +147,45 @@ static struct aws_error_info s_errors[] = {
     AWS_DEFINE_ERROR_INFO_HTTP(
         AWS_ERROR_HTTP_MANUAL_WRITE_HAS_COMPLETED,
         "Manual write failed because manual writes are already completed."),
+    AWS_DEFINE_ERROR_INFO_HTTP(
+        AWS_ERROR_HTTP_CONNECTION_MANAGER_ACQUISITION_TIMEOUT,
+        "Connection acquisition failed because no connection became available before the acquisition timeout."),
+    AWS_DEFINE_ERROR_INFO_HTTP(
+        AWS_ERROR_HTTP_CONNECTION_MANAGER_MAX_PENDING_ACQUISITIONS_EXCEEDED,
+        "Connection acquisition failed because the connection manager has too many pending acquisitions."),
+    AWS_DEFINE_ERROR_INFO_HTTP(
+        AWS_ERROR_HTTP_WEBSOCKET_MESSAGE_TOO_BIG,
+        "Incoming websocket message exceeds the max message size."),
+    AWS_DEFINE_ERROR_INFO_HTTP(
+        AWS_ERROR_HTTP_CHANNEL_LATENCY_FAILURE,
+        "Http connection channel shut down due to a response or PING taking longer than the maximum latency"),
+    AWS_DEFINE_ERROR_INFO_HTTP(
+        AWS_ERROR_HTTP_CHANNEL_WINDOW_STALL_FAILURE,
+        "Http connection channel shut down due to being blocked by the peer's flow-control window for too long"),
+    AWS_DEFINE_ERROR_INFO_HTTP(
+        AWS_ERROR_HTTP_UNSUPPORTED_CONTENT_ENCODING,
+        "Response body uses a content-coding that can't be decoded"),
+    AWS_DEFINE_ERROR_INFO_HTTP(
+        AWS_ERROR_HTTP_CONTENT_DECODING_FAILED,
+        "Response body could not be decoded according to its content-coding"),
+    AWS_DEFINE_ERROR_INFO_HTTP(
+        AWS_ERROR_HTTP_CONTENT_ENCODING_FAILED,
+        "Request body could not be encoded according to its content-coding"),
+    AWS_DEFINE_ERROR_INFO_HTTP(
+        AWS_ERROR_HTTP_REQUEST_NOT_SENT,
+        "The connection closed before any of the request was sent, so it may be retried on another connection"),
+    AWS_DEFINE_ERROR_INFO_HTTP(
+        AWS_ERROR_HTTP_SERVER_CONNECTION_LIMIT_REACHED,
+        "The server refused the incoming connection because it has reached max_connections"),
+    AWS_DEFINE_ERROR_INFO_HTTP(
+        AWS_ERROR_HTTP_SERVER_CONNECTION_TIMEOUT,
+        "The server closed the connection because it was idle, or the request head took too long to arrive"),
+    AWS_DEFINE_ERROR_INFO_HTTP(
+        AWS_ERROR_HTTP_EXTENDED_CONNECT_NOT_SUPPORTED,
+        "The HTTP/2 server does not support the extended CONNECT method (SETTINGS_ENABLE_CONNECT_PROTOCOL)"),
+    AWS_DEFINE_ERROR_INFO_HTTP(
+        AWS_ERROR_HTTP_WEBSOCKET_MANAGER_SHUTTING_DOWN,
+        "Websocket acquisition failed because websocket manager is shutting down"),
 };
 /* clang-format on */
 
@@ -171,6 +209,7 @@ static struct aws_log_subject_info s_log_subject_infos[] = {
         AWS_LS_HTTP_PROXY_NEGOTIATION,
         "proxy-negotiation",
         "Negotiating an http connection with a proxy server"),
+    DEFINE_LOG_SUBJECT_INFO(AWS_LS_HTTP_WEBSOCKET_MANAGER, "websocket-manager", "Websocket manager"),
 };
 
 static struct aws_log_subject_info_list s_log_subject_list = {
@@ -178,108 +217,39 @@ static struct aws_log_subject_info_list s_log_subject_list = {
     .count = AWS_ARRAY_SIZE(s_log_subject_infos),
 };
 
-struct aws_enum_value {
-    struct aws_allocator *allocator;
-    int value;
-};
-
-static void s_destroy_enum_value(void *value) {
-    struct aws_enum_value *enum_value = value;
-    aws_mem_release(enum_value->allocator, enum_value);
-}
-
-/**
- * Given array of aws_byte_cursors, init hashtable where...
- * Key is aws_byte_cursor* (pointing into cursor from array) and comparisons are case-insensitive.
- * Value is the array index cast to a void*.
- */
-static void s_init_str_to_enum_hash_table(
-    struct aws_hash_table *table,
-    struct aws_allocator *alloc,
-    struct aws_byte_cursor *str_array,
-    int start_index,
-    int end_index,
-    bool ignore_case) {
-
-    int err = aws_hash_table_init(
-        table,
-        alloc,
-        end_index - start_index,
-        ignore_case ? aws_hash_byte_cursor_ptr_ignore_case : aws_hash_byte_cursor_ptr,
-        (aws_hash_callback_eq_fn *)(ignore_case ? aws_byte_cursor_eq_ignore_case : aws_byte_cursor_eq),
-        NULL,
-        s_destroy_enum_value);
-    AWS_FATAL_ASSERT(!err);
-
-    for (int i = start_index; i < end_index; ++i) {
-        int was_created = 0;
-        struct aws_enum_value *enum_value = aws_mem_calloc(alloc, 1, sizeof(struct aws_enum_value));
-        AWS_FATAL_ASSERT(enum_value);
-        enum_value->allocator = alloc;
-        enum_value->value = i;
-
-        AWS_FATAL_ASSERT(str_array[i].ptr && "Missing enum string");
-        err = aws_hash_table_put(table, &str_array[i], (void *)enum_value, &was_created);
-        AWS_FATAL_ASSERT(!err && was_created);
-    }
-}
-
-/**
- * Given key, get value from table initialized by s_init_str_to_enum_hash_table().
- * Returns -1 if key not found.
- */
-static int s_find_in_str_to_enum_hash_table(const struct aws_hash_table *table, struct aws_byte_cursor *key) {
-    struct aws_hash_element *elem;
-    aws_hash_table_find(table, key, &elem);
-    if (elem) {
-        struct aws_enum_value *enum_value = elem->value;
-        return enum_value->value;
-    }
-    return -1;
-}
-
 /* METHODS */
-static struct aws_hash_table s_method_str_to_enum;                         /* for string -> enum lookup */
-static struct aws_byte_cursor s_method_enum_to_str[AWS_HTTP_METHOD_COUNT]; /* for enum -> string lookup */
-
-static void s_methods_init(struct aws_allocator *alloc) {
-    s_method_enum_to_str[AWS_HTTP_METHOD_GET] = aws_http_method_get;
-    s_method_enum_to_str[AWS_HTTP_METHOD_HEAD] = aws_http_method_head;
-    s_method_enum_to_str[AWS_HTTP_METHOD_CONNECT] = aws_http_method_connect;
-
-    s_init_str_to_enum_hash_table(
-        &s_method_str_to_enum,
-        alloc,
-        s_method_enum_to_str,
-        AWS_HTTP_METHOD_UNKNOWN + 1,
-        AWS_HTTP_METHOD_COUNT,
-        false /* DO NOT ignore case of method */);
-}
-
-static void s_methods_clean_up(void) {
-    aws_hash_table_clean_up(&s_method_str_to_enum);
-}
-
+/* Only a few methods affect processing, so a switch on length and one compare replaces hashing.
+ * Methods are case-sensitive. */
 enum aws_http_method aws_http_str_to_method(struct aws_byte_cursor cursor) {
-    int method = s_find_in_str_to_enum_hash_table(&s_method_str_to_enum, &cursor);
-    if (method >= 0) {
-        return (enum aws_http_method)method;
+    switch (cursor.len) {
+        case 3:
+            if (aws_byte_cursor_eq(&cursor, &aws_http_method_get)) {
+                return AWS_HTTP_METHOD_GET;
+            }
+            break;
+        case 4:
+            if (aws_byte_cursor_eq(&cursor, &aws_http_method_head)) {
+                return AWS_HTTP_METHOD_HEAD;
+            }
+            break;
+        case 7:
+            if (aws_byte_cursor_eq(&cursor, &aws_http_method_connect)) {
+                return AWS_HTTP_METHOD_CONNECT;
+            }
+            break;
+        default:
+            break;
     }
     return AWS_HTTP_METHOD_UNKNOWN;
 }
 
 /* VERSIONS */
-static struct aws_byte_cursor s_version_enum_to_str[AWS_HTTP_HEADER_COUNT]; /* for enum -> string lookup */
-
-static void s_versions_init(struct aws_allocator *alloc) {
-    (void)alloc;
-    s_version_enum_to_str[AWS_HTTP_VERSION_UNKNOWN] = aws_byte_cursor_from_c_str("Unknown");
-    s_version_enum_to_str[AWS_HTTP_VERSION_1_0] = aws_byte_cursor_from_c_str("HTTP/1.0");
-    s_version_enum_to_str[AWS_HTTP_VERSION_1_1] = aws_byte_cursor_from_c_str("HTTP/1.1");
-    s_version_enum_to_str[AWS_HTTP_VERSION_2] = aws_byte_cursor_from_c_str("HTTP/2");
-}
-
-static void s_versions_clean_up(void) {}
+static const struct aws_byte_cursor s_version_enum_to_str[AWS_HTTP_VERSION_COUNT] = {
+    [AWS_HTTP_VERSION_UNKNOWN] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("Unknown"),
+    [AWS_HTTP_VERSION_1_0] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("HTTP/1.0"),
+    [AWS_HTTP_VERSION_1_1] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("HTTP/1.1"),
+    [AWS_HTTP_VERSION_2] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("HTTP/2"),
+};
 
 struct aws_byte_cursor aws_http_version_to_str(enum aws_http_version version) {
     if ((int)version < AWS_HTTP_VERSION_UNKNOWN || (int)version >= AWS_HTTP_VERSION_COUNT) {
@@ -290,83 +260,140 @@ struct aws_byte_cursor aws_http_version_to_str(enum aws_http_version version) {
 }
 
 /* HEADERS */
-static struct aws_hash_table s_header_str_to_enum;           /* for case-insensitive string -> enum lookup */
-static struct aws_hash_table s_lowercase_header_str_to_enum; /* for case-sensitive string -> enum lookup */
-static struct aws_byte_cursor s_header_enum_to_str[AWS_HTTP_HEADER_COUNT]; /* for enum -> string lookup */
-
-static void s_headers_init(struct aws_allocator *alloc) {
-    s_header_enum_to_str[AWS_HTTP_HEADER_METHOD] = aws_byte_cursor_from_c_str(":method");
-    s_header_enum_to_str[AWS_HTTP_HEADER_SCHEME] = aws_byte_cursor_from_c_str(":scheme");
-    s_header_enum_to_str[AWS_HTTP_HEADER_AUTHORITY] = aws_byte_cursor_from_c_str(":authority");
-    s_header_enum_to_str[AWS_HTTP_HEADER_PATH] = aws_byte_cursor_from_c_str(":path");
-    s_header_enum_to_str[AWS_HTTP_HEADER_STATUS] = aws_byte_cursor_from_c_str(":status");
-    s_header_enum_to_str[AWS_HTTP_HEADER_COOKIE] = aws_byte_cursor_from_c_str("cookie");
-    s_header_enum_to_str[AWS_HTTP_HEADER_SET_COOKIE] = aws_byte_cursor_from_c_str("set-cookie");
-    s_header_enum_to_str[AWS_HTTP_HEADER_HOST] = aws_byte_cursor_from_c_str("host");
-    s_header_enum_to_str[AWS_HTTP_HEADER_CONNECTION] = aws_byte_cursor_from_c_str("connection");
-    s_header_enum_to_str[AWS_HTTP_HEADER_CONTENT_LENGTH] = aws_byte_cursor_from_c_str("content-length");
-    s_header_enum_to_str[AWS_HTTP_HEADER_EXPECT] = aws_byte_cursor_from_c_str("expect");
-    s_header_enum_to_str[AWS_HTTP_HEADER_TRANSFER_ENCODING] = aws_byte_cursor_from_c_str("transfer-encoding");
-    s_header_enum_to_str[AWS_HTTP_HEADER_CACHE_CONTROL] = aws_byte_cursor_from_c_str("cache-control");
-    s_header_enum_to_str[AWS_HTTP_HEADER_MAX_FORWARDS] = aws_byte_cursor_from_c_str("max-forwards");
-    s_header_enum_to_str[AWS_HTTP_HEADER_PRAGMA] = aws_byte_cursor_from_c_str("pragma");
-    s_header_enum_to_str[AWS_HTTP_HEADER_RANGE] = aws_byte_cursor_from_c_str("range");
-    s_header_enum_to_str[AWS_HTTP_HEADER_TE] = aws_byte_cursor_from_c_str("te");
-    s_header_enum_to_str[AWS_HTTP_HEADER_CONTENT_ENCODING] = aws_byte_cursor_from_c_str("content-encoding");
-    s_header_enum_to_str[AWS_HTTP_HEADER_CONTENT_TYPE] = aws_byte_cursor_from_c_str("content-type");
-    s_header_enum_to_str[AWS_HTTP_HEADER_CONTENT_RANGE] = aws_byte_cursor_from_c_str("content-range");
-    s_header_enum_to_str[AWS_HTTP_HEADER_TRAILER] = aws_byte_cursor_from_c_str("trailer");
-    s_header_enum_to_str[AWS_HTTP_HEADER_WWW_AUTHENTICATE] = aws_byte_cursor_from_c_str("www-authenticate");
-    s_header_enum_to_str[AWS_HTTP_HEADER_AUTHORIZATION] = aws_byte_cursor_from_c_str("authorization");
-    s_header_enum_to_str[AWS_HTTP_HEADER_PROXY_AUTHENTICATE] = aws_byte_cursor_from_c_str("proxy-authenticate");
-    s_header_enum_to_str[AWS_HTTP_HEADER_PROXY_AUTHORIZATION] = aws_byte_cursor_from_c_str("proxy-authorization");
-    s_header_enum_to_str[AWS_HTTP_HEADER_AGE] = aws_byte_cursor_from_c_str("age");
-    s_header_enum_to_str[AWS_HTTP_HEADER_EXPIRES] = aws_byte_cursor_from_c_str("expires");
-    s_header_enum_to_str[AWS_HTTP_HEADER_DATE] = aws_byte_cursor_from_c_str("date");
-    s_header_enum_to_str[AWS_HTTP_HEADER_LOCATION] = aws_byte_cursor_from_c_str("location");
-    s_header_enum_to_str[AWS_HTTP_HEADER_RETRY_AFTER] = aws_byte_cursor_from_c_str("retry-after");
-    s_header_enum_to_str[AWS_HTTP_HEADER_VARY] = aws_byte_cursor_from_c_str("vary");
-    s_header_enum_to_str[AWS_HTTP_HEADER_WARNING] = aws_byte_cursor_from_c_str("warning");
-    s_header_enum_to_str[AWS_HTTP_HEADER_UPGRADE] = aws_byte_cursor_from_c_str("upgrade");
-    s_header_enum_to_str[AWS_HTTP_HEADER_KEEP_ALIVE] = aws_byte_cursor_from_c_str("keep-alive");
-    s_header_enum_to_str[AWS_HTTP_HEADER_PROXY_CONNECTION] = aws_byte_cursor_from_c_str("proxy-connection");
-
-    s_init_str_to_enum_hash_table(
-        &s_header_str_to_enum,
-        alloc,
-        s_header_enum_to_str,
-        AWS_HTTP_HEADER_UNKNOWN + 1,
-        AWS_HTTP_HEADER_COUNT,
-        true /* ignore case */);
-
-    s_init_str_to_enum_hash_table(
-        &s_lowercase_header_str_to_enum,
-        alloc,
-        s_header_enum_to_str,
-        AWS_HTTP_HEADER_UNKNOWN + 1,
-        AWS_HTTP_HEADER_COUNT,
-        false /* ignore case */);
+/* for enum -> string lookup */
+static const struct aws_byte_cursor s_header_enum_to_str[AWS_HTTP_HEADER_COUNT] = {
+    [AWS_HTTP_HEADER_METHOD] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL(":method"),
+    [AWS_HTTP_HEADER_SCHEME] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL(":scheme"),
+    [AWS_HTTP_HEADER_AUTHORITY] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL(":authority"),
+    [AWS_HTTP_HEADER_PATH] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL(":path"),
+    [AWS_HTTP_HEADER_STATUS] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL(":status"),
+    [AWS_HTTP_HEADER_COOKIE] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("cookie"),
+    [AWS_HTTP_HEADER_SET_COOKIE] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("set-cookie"),
+    [AWS_HTTP_HEADER_HOST] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("host"),
+    [AWS_HTTP_HEADER_CONNECTION] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("connection"),
+    [AWS_HTTP_HEADER_CONTENT_LENGTH] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("content-length"),
+    [AWS_HTTP_HEADER_EXPECT] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("expect"),
+    [AWS_HTTP_HEADER_TRANSFER_ENCODING] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("transfer-encoding"),
+    [AWS_HTTP_HEADER_CACHE_CONTROL] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("cache-control"),
+    [AWS_HTTP_HEADER_MAX_FORWARDS] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("max-forwards"),
+    [AWS_HTTP_HEADER_PRAGMA] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("pragma"),
+    [AWS_HTTP_HEADER_RANGE] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("range"),
+    [AWS_HTTP_HEADER_TE] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("te"),
+    [AWS_HTTP_HEADER_CONTENT_ENCODING] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("content-encoding"),
+    [AWS_HTTP_HEADER_CONTENT_TYPE] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("content-type"),
+    [AWS_HTTP_HEADER_CONTENT_RANGE] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("content-range"),
+    [AWS_HTTP_HEADER_TRAILER] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("trailer"),
+    [AWS_HTTP_HEADER_WWW_AUTHENTICATE] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("www-authenticate"),
+    [AWS_HTTP_HEADER_AUTHORIZATION] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("authorization"),
+    [AWS_HTTP_HEADER_PROXY_AUTHENTICATE] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("proxy-authenticate"),
+    [AWS_HTTP_HEADER_PROXY_AUTHORIZATION] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("proxy-authorization"),
+    [AWS_HTTP_HEADER_AGE] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("age"),
+    [AWS_HTTP_HEADER_EXPIRES] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("expires"),
+    [AWS_HTTP_HEADER_DATE] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("date"),
+    [AWS_HTTP_HEADER_LOCATION] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("location"),
+    [AWS_HTTP_HEADER_RETRY_AFTER] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("retry-after"),
+    [AWS_HTTP_HEADER_VARY] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("vary"),
+    [AWS_HTTP_HEADER_WARNING] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("warning"),
+    [AWS_HTTP_HEADER_UPGRADE] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("upgrade"),
+    [AWS_HTTP_HEADER_KEEP_ALIVE] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("keep-alive"),
+    [AWS_HTTP_HEADER_PROXY_CONNECTION] = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("proxy-connection"),
+};
+
+/* Every header is classified as it's decoded, so string -> enum lookup avoids hashing.
+ * Names are bucketed by length, then compared 8 bytes at a time against each candidate in the bucket.
+ * Most names in traffic are either known (1 or 2 word compares) or have a length no known name has (0 compares). */
+#define HEADER_NAME_MAX_LEN 24
+#define HEADER_NAME_MAX_WORDS (HEADER_NAME_MAX_LEN / 8)
+#define HEADER_NAME_MAX_CANDIDATES 8
+
+struct header_name_pattern {
+    /* Lowercase name, zero-padded to a whole number of words */
+    uint64_t lowercase[HEADER_NAME_MAX_WORDS];
+    /* 0x20 in each byte that's a letter. OR-ing this in lowercases letters, and leaves all other bytes alone */
+    uint64_t case_mask[HEADER_NAME_MAX_WORDS];
+    enum aws_http_header_name name;
+};
+
+static struct {
+    struct header_name_pattern patterns[HEADER_NAME_MAX_CANDIDATES];
+    size_t count;
+} s_header_patterns_by_len[HEADER_NAME_MAX_LEN + 1]; /* for string -> enum lookup */
+
+static void s_add_header_pattern(enum aws_http_header_name name) {
+    struct aws_byte_cursor str = s_header_enum_to_str[name];
+    AWS_FATAL_ASSERT(str.len > 0 && str.len <= HEADER_NAME_MAX_LEN);
+    AWS_FATAL_ASSERT(s_header_patterns_by_len[str.len].count < HEADER_NAME_MAX_CANDIDATES);
+
+    struct header_name_pattern *pattern =
+        &s_header_patterns_by_len[str.len].patterns[s_header_patterns_by_len[str.len].count++];
+    AWS_ZERO_STRUCT(*pattern);
+    pattern->name = name;
+
+    uint8_t case_mask[HEADER_NAME_MAX_LEN] = {0};
+    for (size_t i = 0; i < str.len; ++i) {
+        AWS_FATAL_ASSERT(!(str.ptr[i] >= 'A' && str.ptr[i] <= 'Z') && "Header string must be lowercase");
+        if (str.ptr[i] >= 'a' && str.ptr[i] <= 'z') {
+            case_mask[i] = 0x20;
+        }
+    }
+    memcpy(pattern->lowercase, str.ptr, str.len);
+    memcpy(pattern->case_mask, case_mask, sizeof(case_mask));
+}
+
+static enum aws_http_header_name s_find_header_pattern(struct aws_byte_cursor cursor, bool ignore_case) {
+    if (cursor.len > HEADER_NAME_MAX_LEN || s_header_patterns_by_len[cursor.len].count == 0) {
+        return AWS_HTTP_HEADER_UNKNOWN;
+    }
+
+    uint64_t words[HEADER_NAME_MAX_WORDS] = {0};
+    memcpy(words, cursor.ptr, cursor.len);
+    const size_t num_words = (cursor.len + 7) / 8;
+
+    for (size_t i = 0; i < s_header_patterns_by_len[cursor.len].count; ++i) {
+        const struct header_name_pattern *pattern = &s_header_patterns_by_len[cursor.len].patterns[i];
+        uint64_t mismatch = 0;
+        for (size_t w = 0; w < num_words; ++w) {
+            uint64_t word = ignore_case ? (words[w] | pattern->case_mask[w]) : words[w];
+            mismatch |= word ^ pattern->lowercase[w];
+        }
+        if (mismatch == 0) {
+            return pattern->name;
+        }
+    }
+
+    return AWS_HTTP_HEADER_UNKNOWN;
+}
+
+static void s_headers_init(void) {
+    for (int i = AWS_HTTP_HEADER_UNKNOWN + 1; i < AWS_HTTP_HEADER_COUNT; ++i) {
+        AWS_FATAL_ASSERT(s_header_enum_to_str[i].ptr && "Missing enum string");
+        s_add_header_pattern((enum aws_http_header_name)i);
+    }
 }
 
 static void s_headers_clean_up(void) {
-    aws_hash_table_clean_up(&s_header_str_to_enum);
-    aws_hash_table_clean_up(&s_lowercase_header_str_to_enum);
+    AWS_ZERO_ARRAY(s_header_patterns_by_len);
 }
 
 enum aws_http_header_name aws_http_str_to_header_name(struct aws_byte_cursor cursor) {
-    int header = s_find_in_str_to_enum_hash_table(&s_header_str_to_enum, &cursor);
-    if (header >= 0) {
-        return (enum aws_http_header_name)header;
-    }
-    return AWS_HTTP_HEADER_UNKNOWN;
+    return s_find_header_pattern(cursor, true /*ignore_case*/);
 }
 
 enum aws_http_header_name aws_http_lowercase_str_to_header_name(struct aws_byte_cursor cursor) {
-    int header = s_find_in_str_to_enum_hash_table(&s_lowercase_header_str_to_enum, &cursor);
-    if (header >= 0) {
-        return (enum aws_http_header_name)header;
+    return s_find_header_pattern(cursor, false /*ignore_case*/);
+}
+
+bool aws_http_header_name_is_connection_specific(enum aws_http_header_name name) {
+    switch (name) {
+        case AWS_HTTP_HEADER_TRANSFER_ENCODING:
+        case AWS_HTTP_HEADER_UPGRADE:
+        case AWS_HTTP_HEADER_KEEP_ALIVE:
+        case AWS_HTTP_HEADER_PROXY_CONNECTION:
+        case AWS_HTTP_HEADER_HOST:
+            return true;
+        default:
+            return false;
     }
-    return AWS_HTTP_HEADER_UNKNOWN;
 }
 
 /* STATUS */
@@ -514,9 +541,7 @@ void aws_http_library_init(struct aws_allocator *alloc) {
     aws_compression_library_init(alloc);
     aws_register_error_info(&s_error_list);
     aws_register_log_subject_info_list(&s_log_subject_list);
-    s_methods_init(alloc);
-    s_headers_init(alloc);
-    s_versions_init(alloc);
+    s_headers_init();
     aws_hpack_static_table_init(alloc);
 }
 
@@ -529,9 +554,7 @@ void aws_http_library_clean_up(void) {
     aws_thread_join_all_managed();
     aws_unregister_error_info(&s_error_list);
     aws_unregister_log_subject_info_list(&s_log_subject_list);
-    s_methods_clean_up();
     s_headers_clean_up();
-    s_versions_clean_up();
     aws_hpack_static_table_clean_up();
     aws_compression_library_clean_up();
     aws_io_library_clean_up();
@@ -560,6 +583,7 @@ const struct aws_byte_cursor aws_http_header_scheme = AWS_BYTE_CUR_INIT_FROM_STR
 const struct aws_byte_cursor aws_http_header_authority = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL(":authority");
 const struct aws_byte_cursor aws_http_header_path = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL(":path");
 const struct aws_byte_cursor aws_http_header_status = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL(":status");
+const struct aws_byte_cursor aws_http_header_protocol = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL(":protocol");
 
 const struct aws_byte_cursor aws_http_scheme_http = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("http");
 const struct aws_byte_cursor aws_http_scheme_https = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("https");
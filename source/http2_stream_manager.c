@@ -5,17 +5,25 @@
 
 #include <aws/common/array_list.h>
 #include <aws/common/clock.h>
+#include <aws/common/device_random.h>
 #include <aws/common/hash_table.h>
 #include <aws/common/logging.h>
+#include <aws/common/string.h>
 #include <aws/http/connection.h>
 #include <aws/http/connection_manager.h>
 #include <aws/http/request_response.h>
 #include <aws/io/channel.h>
 #include <aws/io/channel_bootstrap.h>
 #include <aws/io/event_loop.h>
+#include <aws/io/host_resolver.h>
+#include <aws/io/stream.h>
 
 #include <aws/http/http2_stream_manager.h>
+#include <aws/http/private/content_decoding_impl.h>
+#include <aws/http/private/h2_frames.h>
 #include <aws/http/private/http2_stream_manager_impl.h>
+#include <aws/http/private/http_impl.h>
+#include <aws/http/private/replay_body.h>
 #include <aws/http/private/request_response_impl.h>
 #include <aws/http/status_code.h>
 
@@ -49,11 +57,37 @@ static struct aws_h2_sm_pending_stream_acquisition *s_new_pending_stream_acquisi
 
     /* Copy the options and keep the underlying message alive */
     pending_stream_acquisition->options = *options;
+    if (options->http2_priority) {
+        pending_stream_acquisition->http2_priority = *options->http2_priority;
+        pending_stream_acquisition->options.http2_priority = &pending_stream_acquisition->http2_priority;
+    }
+    if (options->content_decoding) {
+        if (aws_http_content_decoding_prepare_request(options->request, options->content_decoding)) {
+            AWS_LOGF_WARN(
+                AWS_LS_HTTP_STREAM_MANAGER,
+                "Failed to add Accept-Encoding header to request, error %d (%s).",
+                aws_last_error(),
+                aws_error_name(aws_last_error()));
+        }
+        pending_stream_acquisition->content_decoding = *options->content_decoding;
+        AWS_ZERO_STRUCT(pending_stream_acquisition->content_decoding.accept_encoding);
+        pending_stream_acquisition->options.content_decoding = &pending_stream_acquisition->content_decoding;
+    }
+    if (options->content_encoding) {
+        pending_stream_acquisition->content_encoding = *options->content_encoding;
+        aws_byte_buf_init_copy_from_cursor(
+            &pending_stream_acquisition->content_coding_buf, allocator, options->content_encoding->content_coding);
+        pending_stream_acquisition->content_encoding.content_coding =
+            aws_byte_cursor_from_buf(&pending_stream_acquisition->content_coding_buf);
+        pending_stream_acquisition->options.content_encoding = &pending_stream_acquisition->content_encoding;
+    }
     pending_stream_acquisition->request = options->request;
     aws_http_message_acquire(pending_stream_acquisition->request);
     pending_stream_acquisition->callback = callback;
     pending_stream_acquisition->user_data = user_data;
     pending_stream_acquisition->allocator = allocator;
+    aws_linked_list_init(&pending_stream_acquisition->make_request_batch);
+    aws_high_res_clock_get_ticks(&pending_stream_acquisition->acquire_timestamp);
     return pending_stream_acquisition;
 }
 
@@ -65,9 +99,82 @@ static void s_pending_stream_acquisition_destroy(
     if (pending_stream_acquisition->request) {
         aws_http_message_release(pending_stream_acquisition->request);
     }
+    aws_byte_buf_clean_up(&pending_stream_acquisition->content_coding_buf);
+    if (pending_stream_acquisition->hedge_stream) {
+        aws_ref_count_release(&pending_stream_acquisition->hedge_stream->hedge->ref_count);
+    }
+    if (pending_stream_acquisition->replay) {
+        aws_ref_count_release(&pending_stream_acquisition->replay->ref_count);
+    }
     aws_mem_release(pending_stream_acquisition->allocator, pending_stream_acquisition);
 }
 
+static void s_replay_destroy(void *user_data) {
+    struct aws_h2_sm_replay *replay = user_data;
+    AWS_ASSERT(replay->acquired_stream == NULL);
+    aws_http_message_release(replay->request);
+    /* The user only hears about the stream going once every stream sending the request is gone */
+    if (replay->was_stream_made && replay->on_destroy) {
+        replay->on_destroy(replay->user_data);
+    }
+    aws_mem_release(replay->allocator, replay);
+}
+
+/* Set the acquisition up to send its request again if the stream fails, see `replay_buffer_size` */
+static void s_replay_new(
+    struct aws_h2_sm_pending_stream_acquisition *pending_stream_acquisition,
+    size_t replay_buffer_size) {
+
+    struct aws_http_message *request = pending_stream_acquisition->request;
+    if (aws_http_message_get_body_stream(request)) {
+        request = aws_http_replay_body_new_request(pending_stream_acquisition->allocator, request, replay_buffer_size);
+        if (!request) {
+            AWS_LOGF_WARN(
+                AWS_LS_HTTP_STREAM_MANAGER,
+                "Failed to set up request body for replay, error %d (%s). The request won't be sent again.",
+                aws_last_error(),
+                aws_error_name(aws_last_error()));
+            return;
+        }
+    } else {
+        aws_http_message_acquire(request);
+    }
+
+    struct aws_h2_sm_replay *replay =
+        aws_mem_calloc(pending_stream_acquisition->allocator, 1, sizeof(struct aws_h2_sm_replay));
+    replay->allocator = pending_stream_acquisition->allocator;
+    replay->on_destroy = pending_stream_acquisition->options.on_destroy;
+    replay->user_data = pending_stream_acquisition->options.user_data;
+    replay->request = request;
+    /* The acquisition holds the initial refcount */
+    aws_ref_count_init(&replay->ref_count, replay, s_replay_destroy);
+    pending_stream_acquisition->replay = replay;
+
+    /* Send the request with the replay buffer from the first time */
+    aws_http_message_release(pending_stream_acquisition->request);
+    pending_stream_acquisition->request = aws_http_message_acquire(request);
+    pending_stream_acquisition->options.request = request;
+}
+
+/**
+ * An acquisition made to send the request again failed without a stream. The user acquired a stream and is waiting
+ * to hear that it completed, so tell them with that.
+ */
+static void s_replay_on_failed_to_make(
+    struct aws_h2_sm_pending_stream_acquisition *pending_stream_acquisition,
+    int error_code) {
+
+    AWS_PRECONDITION(pending_stream_acquisition->is_replay);
+    struct aws_h2_sm_replay *replay = pending_stream_acquisition->replay;
+    struct aws_http_stream *acquired_stream = replay->acquired_stream;
+    replay->acquired_stream = NULL;
+    if (pending_stream_acquisition->options.on_complete) {
+        pending_stream_acquisition->options.on_complete(
+            acquired_stream, error_code, pending_stream_acquisition->options.user_data);
+    }
+    aws_http_stream_release(acquired_stream);
+}
+
 static void s_lock_synced_data(struct aws_http2_stream_manager *stream_manager) {
     int err = aws_mutex_lock(&stream_manager->synced_data.lock);
     AWS_ASSERT(!err && "lock failed");
@@ -131,18 +238,90 @@ static void s_aws_stream_management_transaction_clean_up(struct aws_http2_stream
     aws_ref_count_release(&work->stream_manager->internal_ref_count);
 }
 
-static struct aws_h2_sm_connection *s_get_best_sm_connection_from_set(struct aws_random_access_set *set) {
+static struct aws_h2_sm_connection *s_get_best_sm_connection_from_set(struct aws_random_access_intrusive_set *set) {
     /* Use the best two algorithm */
     int errored = AWS_ERROR_SUCCESS;
-    struct aws_h2_sm_connection *sm_connection_a = NULL;
-    errored = aws_random_access_set_random_get_ptr(set, (void **)&sm_connection_a);
-    struct aws_h2_sm_connection *sm_connection_b = NULL;
-    errored |= aws_random_access_set_random_get_ptr(set, (void **)&sm_connection_b);
+    struct aws_random_access_set_node *node_a = NULL;
+    errored = aws_random_access_intrusive_set_random_get(set, &node_a);
+    struct aws_random_access_set_node *node_b = NULL;
+    errored |= aws_random_access_intrusive_set_random_get(set, &node_b);
+    if (errored != AWS_ERROR_SUCCESS) {
+        return NULL;
+    }
+    struct aws_h2_sm_connection *sm_connection_a =
+        AWS_CONTAINER_OF(node_a, struct aws_h2_sm_connection, available_set_node);
+    struct aws_h2_sm_connection *sm_connection_b =
+        AWS_CONTAINER_OF(node_b, struct aws_h2_sm_connection, available_set_node);
     struct aws_h2_sm_connection *chosen_connection =
         sm_connection_a->num_streams_assigned > sm_connection_b->num_streams_assigned ? sm_connection_b
                                                                                       : sm_connection_a;
-    return errored == AWS_ERROR_SUCCESS ? chosen_connection : NULL;
-    (void)errored;
+    return chosen_connection;
+}
+
+/* With enable_adaptive_concurrency, the stream limit a connection starts with, if it's allowed that many */
+#define AWS_H2SM_ADAPTIVE_INITIAL_CONCURRENCY 10
+/* A response that starts this many times later than the connection's fastest, and later by at least
+ * AWS_H2SM_ADAPTIVE_MIN_LATENCY_RISE_NS, is taken as a sign the server is queueing streams */
+#define AWS_H2SM_ADAPTIVE_LATENCY_FACTOR 4
+#define AWS_H2SM_ADAPTIVE_MIN_LATENCY_RISE_NS (10 * (uint64_t)AWS_TIMESTAMP_NANOS / AWS_TIMESTAMP_MILLIS)
+
+/* What a stream is assumed to cost on top of the bytes it's known to move, so the number of streams still counts */
+#define AWS_H2SM_STREAM_LOAD_BYTES (16 * 1024)
+
+/* The load of a connection once one more stream is made from it */
+static uint64_t s_get_sm_connection_load(const struct aws_h2_sm_connection *sm_connection) {
+    uint64_t streams_load = aws_mul_u64_saturating(
+        (uint64_t)sm_connection->num_streams_assigned + 1, AWS_H2SM_STREAM_LOAD_BYTES);
+    return aws_add_u64_saturating(streams_load, aws_atomic_load_int(&sm_connection->outstanding_bytes));
+}
+
+/* AWS_H2SM_CONNECTION_SELECTION_LEAST_LOADED, power of two choices on the load of two distinct connections */
+static struct aws_h2_sm_connection *s_get_least_loaded_sm_connection_from_set(
+    struct aws_random_access_intrusive_set *set) {
+    size_t size = aws_random_access_intrusive_set_get_size(set);
+    if (size == 0) {
+        return NULL;
+    }
+
+    uint64_t random_64_bit_num = 0;
+    aws_device_random_u64(&random_64_bit_num);
+    size_t index_a = (size_t)(random_64_bit_num % size);
+    /* Any other connection, so two are always compared when there are two */
+    size_t index_b = size > 1 ? (index_a + 1 + (size_t)((random_64_bit_num >> 32) % (size - 1))) % size : index_a;
+
+    int errored = AWS_ERROR_SUCCESS;
+    struct aws_random_access_set_node *node_a = NULL;
+    errored = aws_random_access_intrusive_set_get_at_index(set, &node_a, index_a);
+    struct aws_random_access_set_node *node_b = NULL;
+    errored |= aws_random_access_intrusive_set_get_at_index(set, &node_b, index_b);
+    if (errored != AWS_ERROR_SUCCESS) {
+        return NULL;
+    }
+    struct aws_h2_sm_connection *sm_connection_a =
+        AWS_CONTAINER_OF(node_a, struct aws_h2_sm_connection, available_set_node);
+    struct aws_h2_sm_connection *sm_connection_b =
+        AWS_CONTAINER_OF(node_b, struct aws_h2_sm_connection, available_set_node);
+
+    uint64_t load_a = s_get_sm_connection_load(sm_connection_a);
+    uint64_t load_b = s_get_sm_connection_load(sm_connection_b);
+    uint64_t rtt_a = aws_atomic_load_int(&sm_connection_a->last_ping_rtt_ns);
+    uint64_t rtt_b = aws_atomic_load_int(&sm_connection_b->last_ping_rtt_ns);
+    if (rtt_a && rtt_b) {
+        /* Roughly how long each one takes to get through its load, if they have the same bandwidth */
+        load_a = aws_mul_u64_saturating(load_a, rtt_a);
+        load_b = aws_mul_u64_saturating(load_b, rtt_b);
+    }
+    return load_a > load_b ? sm_connection_b : sm_connection_a;
+}
+
+static struct aws_h2_sm_connection *s_pick_sm_connection_from_set(
+    struct aws_http2_stream_manager *stream_manager,
+    struct aws_random_access_intrusive_set *set) {
+
+    if (stream_manager->connection_selection == AWS_H2SM_CONNECTION_SELECTION_LEAST_LOADED) {
+        return s_get_least_loaded_sm_connection_from_set(set);
+    }
+    return s_get_best_sm_connection_from_set(set);
 }
 
 /* helper function for building the transaction: Try to assign connection for a pending stream acquisition */
@@ -153,12 +332,12 @@ static void s_sm_try_assign_connection_to_pending_stream_acquisition_synced(
 
     AWS_ASSERT(pending_stream_acquisition->sm_connection == NULL);
     int errored = 0;
-    if (aws_random_access_set_get_size(&stream_manager->synced_data.ideal_available_set)) {
+    if (aws_random_access_intrusive_set_get_size(&stream_manager->synced_data.ideal_available_set)) {
         /**
          * Try assigning to connection from ideal set
          */
         struct aws_h2_sm_connection *chosen_connection =
-            s_get_best_sm_connection_from_set(&stream_manager->synced_data.ideal_available_set);
+            s_pick_sm_connection_from_set(stream_manager, &stream_manager->synced_data.ideal_available_set);
         AWS_ASSERT(chosen_connection);
         pending_stream_acquisition->sm_connection = chosen_connection;
         chosen_connection->num_streams_assigned++;
@@ -175,8 +354,8 @@ static void s_sm_try_assign_connection_to_pending_stream_acquisition_synced(
             /* It becomes not available for new streams any more, remove it from the set, but still alive (streams
              * created will track the lifetime) */
             chosen_connection->state = AWS_H2SMCST_FULL;
-            errored |=
-                aws_random_access_set_remove(&stream_manager->synced_data.ideal_available_set, chosen_connection);
+            aws_random_access_intrusive_set_remove(
+                &stream_manager->synced_data.ideal_available_set, &chosen_connection->available_set_node);
             STREAM_MANAGER_LOGF(
                 DEBUG,
                 stream_manager,
@@ -186,11 +365,11 @@ static void s_sm_try_assign_connection_to_pending_stream_acquisition_synced(
                 chosen_connection->max_concurrent_streams);
         } else if (chosen_connection->num_streams_assigned >= stream_manager->ideal_concurrent_streams_per_connection) {
             /* It meets the ideal limit, but still available for new streams, move it to the nonidea-available set */
-            errored |=
-                aws_random_access_set_remove(&stream_manager->synced_data.ideal_available_set, chosen_connection);
+            aws_random_access_intrusive_set_remove(
+                &stream_manager->synced_data.ideal_available_set, &chosen_connection->available_set_node);
             bool added = false;
-            errored |= aws_random_access_set_add(
-                &stream_manager->synced_data.nonideal_available_set, chosen_connection, &added);
+            errored |= aws_random_access_intrusive_set_add(
+                &stream_manager->synced_data.nonideal_available_set, &chosen_connection->available_set_node, &added);
             errored |= !added;
             chosen_connection->state = AWS_H2SMCST_NEARLY_FULL;
             STREAM_MANAGER_LOGF(
@@ -208,9 +387,9 @@ static void s_sm_try_assign_connection_to_pending_stream_acquisition_synced(
          * possibly get. This way, we don't overfill the first connections we get our hands on.
          */
 
-        if (aws_random_access_set_get_size(&stream_manager->synced_data.nonideal_available_set)) {
+        if (aws_random_access_intrusive_set_get_size(&stream_manager->synced_data.nonideal_available_set)) {
             struct aws_h2_sm_connection *chosen_connection =
-                s_get_best_sm_connection_from_set(&stream_manager->synced_data.nonideal_available_set);
+                s_pick_sm_connection_from_set(stream_manager, &stream_manager->synced_data.nonideal_available_set);
             AWS_ASSERT(chosen_connection);
             pending_stream_acquisition->sm_connection = chosen_connection;
             chosen_connection->num_streams_assigned++;
@@ -227,8 +406,8 @@ static void s_sm_try_assign_connection_to_pending_stream_acquisition_synced(
                 /* It becomes not available for new streams any more, remove it from the set, but still alive (streams
                  * created will track the lifetime) */
                 chosen_connection->state = AWS_H2SMCST_FULL;
-                errored |= aws_random_access_set_remove(
-                    &stream_manager->synced_data.nonideal_available_set, chosen_connection);
+                aws_random_access_intrusive_set_remove(
+                    &stream_manager->synced_data.nonideal_available_set, &chosen_connection->available_set_node);
                 STREAM_MANAGER_LOGF(
                     DEBUG,
                     stream_manager,
@@ -256,6 +435,8 @@ static void s_finish_pending_stream_acquisitions_list_helper(
         AWS_ASSERT(pending_stream_acquisition->sm_connection == NULL);
         if (pending_stream_acquisition->callback) {
             pending_stream_acquisition->callback(NULL, error_code, pending_stream_acquisition->user_data);
+        } else if (pending_stream_acquisition->is_replay) {
+            s_replay_on_failed_to_make(pending_stream_acquisition, error_code);
         }
         STREAM_MANAGER_LOGF(
             DEBUG,
@@ -417,6 +598,7 @@ static void s_on_ping_complete(
         (void *)sm_connection->connection,
         round_trip_time_ns);
     sm_connection->thread_data.ping_received = true;
+    aws_atomic_store_int(&sm_connection->last_ping_rtt_ns, (size_t)aws_min_u64(round_trip_time_ns, SIZE_MAX));
 
 done:
     /* Release refcount held for ping complete */
@@ -515,6 +697,14 @@ static struct aws_h2_sm_connection *s_sm_connection_new(
     sm_connection->connection = connection;
     sm_connection->stream_manager = stream_manager;
     sm_connection->state = AWS_H2SMCST_IDEAL;
+    aws_atomic_init_int(&sm_connection->outstanding_bytes, 0);
+    aws_atomic_init_int(&sm_connection->last_ping_rtt_ns, 0);
+    if (stream_manager->enable_adaptive_concurrency) {
+        sm_connection->adaptive.max_limit = sm_connection->max_concurrent_streams;
+        sm_connection->adaptive.is_slow_start = true;
+        sm_connection->max_concurrent_streams =
+            aws_min_u32(sm_connection->max_concurrent_streams, AWS_H2SM_ADAPTIVE_INITIAL_CONCURRENCY);
+    }
     aws_ref_count_init(&sm_connection->ref_count, sm_connection, s_sm_connection_destroy);
     if (stream_manager->connection_ping_period_ns) {
         struct aws_channel *channel = aws_http_connection_get_channel(connection);
@@ -614,8 +804,8 @@ static void s_sm_on_connection_acquired(struct aws_http_connection *connection,
         } else {
             struct aws_h2_sm_connection *sm_connection = s_sm_connection_new(stream_manager, connection);
             bool added = false;
-            re_error |=
-                aws_random_access_set_add(&stream_manager->synced_data.ideal_available_set, sm_connection, &added);
+            re_error |= aws_random_access_intrusive_set_add(
+                &stream_manager->synced_data.ideal_available_set, &sm_connection->available_set_node, &added);
             re_error |= !added;
             ++stream_manager->synced_data.holding_connections_count;
         }
@@ -637,6 +827,440 @@ static void s_sm_on_connection_acquired(struct aws_http_connection *connection,
     s_aws_http2_stream_manager_execute_transaction(&work);
 }
 
+static bool s_is_tracking_load(const struct aws_http2_stream_manager *stream_manager) {
+    return stream_manager->connection_selection == AWS_H2SM_CONNECTION_SELECTION_LEAST_LOADED;
+}
+
+/* From the connection's thread. Counts the request body, which is held until the stream completes. */
+static void s_track_request_bytes(struct aws_h2_sm_pending_stream_acquisition *pending_stream_acquisition) {
+    struct aws_input_stream *body_stream = aws_http_message_get_body_stream(pending_stream_acquisition->request);
+    int64_t body_length = 0;
+    if (body_stream == NULL || aws_input_stream_get_length(body_stream, &body_length) || body_length <= 0) {
+        return;
+    }
+    pending_stream_acquisition->outstanding_request_bytes = (size_t)aws_min_u64((uint64_t)body_length, SIZE_MAX);
+    aws_atomic_fetch_add(
+        &pending_stream_acquisition->sm_connection->outstanding_bytes,
+        pending_stream_acquisition->outstanding_request_bytes);
+}
+
+/* From the connection's thread. Counts the response body the content-length announces, as it's still to come. */
+static void s_track_response_bytes(
+    struct aws_h2_sm_pending_stream_acquisition *pending_stream_acquisition,
+    const struct aws_http_header *header_array,
+    size_t num_headers) {
+
+    for (size_t i = 0; i < num_headers; ++i) {
+        if (aws_http_str_to_header_name(header_array[i].name) != AWS_HTTP_HEADER_CONTENT_LENGTH) {
+            continue;
+        }
+        uint64_t content_length = 0;
+        if (pending_stream_acquisition->outstanding_response_bytes == 0 &&
+            aws_byte_cursor_utf8_parse_u64(header_array[i].value, &content_length) == AWS_OP_SUCCESS) {
+            pending_stream_acquisition->outstanding_response_bytes = (size_t)aws_min_u64(content_length, SIZE_MAX);
+            aws_atomic_fetch_add(
+                &pending_stream_acquisition->sm_connection->outstanding_bytes,
+                pending_stream_acquisition->outstanding_response_bytes);
+        }
+        return;
+    }
+}
+
+/* From the connection's thread. Takes bytes the stream no longer has to move off of its connection. */
+static void s_untrack_bytes(
+    struct aws_h2_sm_pending_stream_acquisition *pending_stream_acquisition,
+    size_t request_bytes,
+    size_t response_bytes) {
+
+    request_bytes = aws_min_size(request_bytes, pending_stream_acquisition->outstanding_request_bytes);
+    response_bytes = aws_min_size(response_bytes, pending_stream_acquisition->outstanding_response_bytes);
+    pending_stream_acquisition->outstanding_request_bytes -= request_bytes;
+    pending_stream_acquisition->outstanding_response_bytes -= response_bytes;
+    if (request_bytes + response_bytes > 0) {
+        aws_atomic_fetch_sub(
+            &pending_stream_acquisition->sm_connection->outstanding_bytes,
+            aws_add_size_saturating(request_bytes, response_bytes));
+    }
+}
+
+/* With hedging and hedge_delay_ms of 0, the response latencies to see before hedging at a percentile of them */
+#define AWS_H2SM_HEDGE_MIN_LATENCY_SAMPLES 100
+#define AWS_H2SM_HEDGE_DEFAULT_LATENCY_PERCENTILE 95.0
+
+static bool s_is_hedging_enabled(const struct aws_http2_stream_manager *stream_manager) {
+    return stream_manager->hedging_budget_percent > 0;
+}
+
+static void s_hedge_destroy(void *user_data) {
+    struct aws_h2_sm_hedge *hedge = user_data;
+    bool was_stream_made = hedge->primary.stream != NULL;
+    if (hedge->primary.channel) {
+        aws_channel_release_hold(hedge->primary.channel);
+    }
+    if (hedge->duplicate.channel) {
+        aws_channel_release_hold(hedge->duplicate.channel);
+    }
+    aws_http_message_release(hedge->options.request);
+    /* The user only hears about the stream going once both of them are gone */
+    if (was_stream_made && hedge->options.on_destroy) {
+        hedge->options.on_destroy(hedge->options.user_data);
+    }
+    aws_mem_release(hedge->allocator, hedge);
+}
+
+static void s_hedge_new(
+    struct aws_http2_stream_manager *stream_manager,
+    struct aws_h2_sm_pending_stream_acquisition *pending_stream_acquisition) {
+
+    struct aws_h2_sm_hedge *hedge = aws_mem_calloc(stream_manager->allocator, 1, sizeof(struct aws_h2_sm_hedge));
+    hedge->allocator = stream_manager->allocator;
+    hedge->stream_manager = stream_manager;
+    hedge->options = pending_stream_acquisition->options;
+    if (pending_stream_acquisition->options.http2_priority) {
+        hedge->http2_priority = pending_stream_acquisition->http2_priority;
+        hedge->options.http2_priority = &hedge->http2_priority;
+    }
+    if (pending_stream_acquisition->options.content_decoding) {
+        hedge->content_decoding = pending_stream_acquisition->content_decoding;
+        hedge->options.content_decoding = &hedge->content_decoding;
+    }
+    /* Only requests without a body are hedged, so there's nothing to encode */
+    hedge->options.content_encoding = NULL;
+    aws_http_message_acquire(hedge->options.request);
+    aws_atomic_init_ptr(&hedge->winner, NULL);
+    aws_atomic_init_int(&hedge->open_streams, 0);
+    hedge->primary.hedge = hedge;
+    hedge->duplicate.hedge = hedge;
+    /* The acquisition holds the initial refcount */
+    aws_ref_count_init(&hedge->ref_count, hedge, s_hedge_destroy);
+    pending_stream_acquisition->hedge_stream = &hedge->primary;
+}
+
+/* From the loser's thread */
+static void s_hedge_cancel_task(struct aws_channel_task *task, void *arg, enum aws_task_status status) {
+    (void)task;
+    struct aws_h2_sm_hedge_stream *hedge_stream = arg;
+    struct aws_h2_sm_hedge *hedge = hedge_stream->hedge;
+    if (status == AWS_TASK_STATUS_RUN_READY && hedge_stream->stream && !hedge_stream->is_complete) {
+        STREAM_MANAGER_LOGF(
+            DEBUG,
+            hedge->stream_manager,
+            "Cancelling stream:%p as the other stream of its hedge got a response first",
+            (void *)hedge_stream->stream);
+        aws_http2_stream_reset(hedge_stream->stream, AWS_HTTP2_ERR_CANCEL);
+    }
+    aws_ref_count_release(&hedge->ref_count);
+}
+
+/**
+ * From the stream's thread. Returns whether the user sees the callbacks of the stream, which goes to the first to
+ * claim it. The other stream is cancelled then.
+ */
+static bool s_hedge_stream_claim(struct aws_h2_sm_hedge_stream *hedge_stream) {
+    struct aws_h2_sm_hedge *hedge = hedge_stream->hedge;
+    void *winner = NULL;
+    if (!aws_atomic_compare_exchange_ptr(&hedge->winner, &winner, hedge_stream)) {
+        return winner == hedge_stream;
+    }
+
+    struct aws_h2_sm_hedge_stream *loser = hedge_stream == &hedge->primary ? &hedge->duplicate : &hedge->primary;
+    /* The duplicate's channel is set from the primary's thread, before the duplicate can claim anything */
+    if (loser->channel) {
+        aws_channel_task_init(&loser->cancel_task, s_hedge_cancel_task, loser, "Stream manager hedge cancel task");
+        aws_ref_count_acquire(&hedge->ref_count);
+        aws_channel_schedule_task_now(loser->channel, &loser->cancel_task);
+    }
+    return true;
+}
+
+/* From the stream's thread */
+static bool s_is_stream_seen_by_user(struct aws_h2_sm_pending_stream_acquisition *pending_stream_acquisition) {
+    return pending_stream_acquisition->hedge_stream == NULL ||
+           s_hedge_stream_claim(pending_stream_acquisition->hedge_stream);
+}
+
+/* From the stream's thread. Returns whether the user sees the completion of the stream. */
+static bool s_hedge_stream_on_complete(struct aws_h2_sm_hedge_stream *hedge_stream) {
+    struct aws_h2_sm_hedge *hedge = hedge_stream->hedge;
+    hedge_stream->is_complete = true;
+    size_t open_streams = aws_atomic_fetch_sub(&hedge->open_streams, 1);
+    if (aws_atomic_load_ptr(&hedge->winner) == NULL && open_streams > 1) {
+        /* Failed without a response, but there's still the other one to hear from */
+        return false;
+    }
+    return s_hedge_stream_claim(hedge_stream);
+}
+
+/* 0 if it should not hedge */
+static uint64_t s_get_hedge_delay_ns(const struct aws_http2_stream_manager *stream_manager) {
+    if (stream_manager->hedge_delay_ns) {
+        return stream_manager->hedge_delay_ns;
+    }
+    struct aws_http_manager_histogram latencies;
+    aws_http_atomic_histogram_snapshot(&stream_manager->response_latency_histogram, &latencies);
+    if (latencies.count < AWS_H2SM_HEDGE_MIN_LATENCY_SAMPLES) {
+        return 0;
+    }
+    uint64_t delay_us = aws_http_manager_histogram_get_percentile(&latencies, stream_manager->hedge_latency_percentile);
+    return aws_timestamp_convert(aws_max_u64(delay_us, 1), AWS_TIMESTAMP_MICROS, AWS_TIMESTAMP_NANOS, NULL);
+}
+
+/* Update the sets after a hedge takes a stream from sm_connection, which was available */
+static void s_update_sm_connection_set_on_hedge_assigned_synced(
+    struct aws_h2_sm_connection *sm_connection,
+    struct aws_http2_stream_manager *stream_manager) {
+
+    int re_error = 0;
+    if (sm_connection->num_streams_assigned >= sm_connection->max_concurrent_streams) {
+        aws_random_access_intrusive_set_remove(
+            &stream_manager->synced_data.ideal_available_set, &sm_connection->available_set_node);
+        aws_random_access_intrusive_set_remove(
+            &stream_manager->synced_data.nonideal_available_set, &sm_connection->available_set_node);
+        sm_connection->state = AWS_H2SMCST_FULL;
+    } else if (
+        sm_connection->state == AWS_H2SMCST_IDEAL &&
+        sm_connection->num_streams_assigned >= stream_manager->ideal_concurrent_streams_per_connection) {
+        aws_random_access_intrusive_set_remove(
+            &stream_manager->synced_data.ideal_available_set, &sm_connection->available_set_node);
+        bool added = false;
+        re_error |= aws_random_access_intrusive_set_add(
+            &stream_manager->synced_data.nonideal_available_set, &sm_connection->available_set_node, &added);
+        re_error |= !added;
+        sm_connection->state = AWS_H2SMCST_NEARLY_FULL;
+    }
+    AWS_ASSERT(re_error == AWS_OP_SUCCESS);
+    (void)re_error;
+}
+
+/**
+ * Assign the duplicate of a hedge to an available connection other than the one its primary stream is on, if the
+ * budget allows. Hedges only use connections the manager already has, and never wait for one.
+ */
+/* *_synced should only be called with LOCK HELD or from another synced function */
+static void s_sm_try_assign_connection_to_hedge_synced(
+    struct aws_http2_stream_manager *stream_manager,
+    struct aws_h2_sm_pending_stream_acquisition *duplicate) {
+
+    struct aws_h2_sm_hedge *hedge = duplicate->hedge_stream->hedge;
+    if (stream_manager->synced_data.state != AWS_H2SMST_READY) {
+        return;
+    }
+    uint64_t budget = aws_mul_u64_saturating(
+        stream_manager->hedging_budget_percent, stream_manager->synced_data.acquisitions_count);
+    if (aws_mul_u64_saturating(stream_manager->synced_data.hedges_count + 1, 100) > budget) {
+        STREAM_MANAGER_LOGF(
+            DEBUG, stream_manager, "Not hedging acquisition:%p, the hedging budget is used up", (void *)duplicate);
+        return;
+    }
+
+    struct aws_random_access_intrusive_set *sets[] = {
+        &stream_manager->synced_data.ideal_available_set,
+        &stream_manager->synced_data.nonideal_available_set,
+    };
+    struct aws_h2_sm_connection *chosen_connection = NULL;
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(sets) && chosen_connection == NULL; ++i) {
+        size_t size = aws_random_access_intrusive_set_get_size(sets[i]);
+        for (size_t j = 0; j < size; ++j) {
+            struct aws_random_access_set_node *node = NULL;
+            AWS_FATAL_ASSERT(aws_random_access_intrusive_set_get_at_index(sets[i], &node, j) == AWS_OP_SUCCESS);
+            struct aws_h2_sm_connection *sm_connection =
+                AWS_CONTAINER_OF(node, struct aws_h2_sm_connection, available_set_node);
+            if (sm_connection != hedge->primary_sm_connection &&
+                (chosen_connection == NULL ||
+                 sm_connection->num_streams_assigned < chosen_connection->num_streams_assigned)) {
+                chosen_connection = sm_connection;
+            }
+        }
+    }
+    if (chosen_connection == NULL) {
+        STREAM_MANAGER_LOGF(
+            DEBUG, stream_manager, "Not hedging acquisition:%p, no other connection has room", (void *)duplicate);
+        return;
+    }
+
+    duplicate->sm_connection = chosen_connection;
+    chosen_connection->num_streams_assigned++;
+    ++stream_manager->synced_data.hedges_count;
+    STREAM_MANAGER_LOGF(
+        DEBUG,
+        stream_manager,
+        "Hedging on connection:%p with acquisition:%p. Streams assigned to the connection=%" PRIu32 "",
+        (void *)chosen_connection->connection,
+        (void *)duplicate,
+        chosen_connection->num_streams_assigned);
+    s_update_sm_connection_set_on_hedge_assigned_synced(chosen_connection, stream_manager);
+}
+
+/* From the primary stream's thread, once it has gone hedge_delay without a response */
+static void s_hedge_task(struct aws_channel_task *task, void *arg, enum aws_task_status status) {
+    (void)task;
+    struct aws_h2_sm_hedge *hedge = arg;
+    struct aws_http2_stream_manager *stream_manager = hedge->stream_manager;
+    if (status != AWS_TASK_STATUS_RUN_READY || hedge->primary.is_complete ||
+        aws_atomic_load_ptr(&hedge->winner) != NULL) {
+        goto done;
+    }
+
+    struct aws_h2_sm_pending_stream_acquisition *duplicate =
+        s_new_pending_stream_acquisition(hedge->allocator, &hedge->options, NULL /*callback*/, NULL /*user_data*/);
+    duplicate->hedge_stream = &hedge->duplicate;
+    aws_ref_count_acquire(&hedge->ref_count);
+
+    struct aws_http2_stream_management_transaction work;
+    s_aws_stream_management_transaction_init(&work, stream_manager);
+    { /* BEGIN CRITICAL SECTION */
+        s_lock_synced_data(stream_manager);
+        s_sm_try_assign_connection_to_hedge_synced(stream_manager, duplicate);
+        if (duplicate->sm_connection) {
+            aws_linked_list_push_back(&work.pending_make_requests, &duplicate->node);
+            s_sm_count_increase_synced(stream_manager, AWS_SMCT_PENDING_MAKE_REQUESTS, 1);
+            hedge->duplicate.channel = aws_http_connection_get_channel(duplicate->sm_connection->connection);
+            aws_channel_acquire_hold(hedge->duplicate.channel);
+        }
+        s_unlock_synced_data(stream_manager);
+    } /* END CRITICAL SECTION */
+    if (duplicate->sm_connection == NULL) {
+        s_pending_stream_acquisition_destroy(duplicate);
+    }
+    s_aws_http2_stream_manager_execute_transaction(&work);
+done:
+    aws_ref_count_release(&hedge->ref_count);
+}
+
+/* From the stream's thread, once it's activated */
+static void s_hedge_stream_on_made(
+    struct aws_h2_sm_pending_stream_acquisition *pending_stream_acquisition,
+    struct aws_http_stream *stream) {
+
+    struct aws_h2_sm_hedge_stream *hedge_stream = pending_stream_acquisition->hedge_stream;
+    struct aws_h2_sm_hedge *hedge = hedge_stream->hedge;
+    hedge_stream->stream = stream;
+    aws_atomic_fetch_add(&hedge->open_streams, 1);
+    if (hedge_stream != &hedge->primary) {
+        return;
+    }
+
+    struct aws_h2_sm_connection *sm_connection = pending_stream_acquisition->sm_connection;
+    struct aws_channel *channel = aws_http_connection_get_channel(sm_connection->connection);
+    hedge_stream->channel = channel;
+    aws_channel_acquire_hold(channel);
+    hedge->primary_sm_connection = sm_connection;
+    uint64_t delay_ns = s_get_hedge_delay_ns(hedge->stream_manager);
+    if (delay_ns == 0) {
+        return;
+    }
+    uint64_t now = 0;
+    aws_channel_current_clock_time(channel, &now);
+    aws_channel_task_init(&hedge->hedge_task, s_hedge_task, hedge, "Stream manager hedge task");
+    /* Keep a refcount on the hedge for the task to run */
+    aws_ref_count_acquire(&hedge->ref_count);
+    aws_channel_schedule_task_future(channel, &hedge->hedge_task, aws_add_u64_saturating(now, delay_ns));
+}
+
+/* Most times a request is sent again, see `replay_buffer_size` */
+#define AWS_H2SM_MAX_REPLAYS 3
+
+/* Whether the stream failed in a way that may be fixed by sending the request again */
+static bool s_is_replayable_error(struct aws_http_stream *stream, int error_code) {
+    switch (error_code) {
+        case AWS_ERROR_HTTP_GOAWAY_RECEIVED:
+            /* Only the streams the GOAWAY says the server didn't process complete with this */
+            return true;
+        case AWS_ERROR_HTTP_RST_STREAM_RECEIVED: {
+            uint32_t http2_error = 0;
+            return aws_http2_stream_get_received_reset_error_code(stream, &http2_error) == AWS_OP_SUCCESS &&
+                   http2_error == AWS_HTTP2_ERR_REFUSED_STREAM;
+        }
+        case AWS_ERROR_HTTP_CONNECTION_CLOSED:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * From the stream's thread, as it completes. If the stream failed before the server processed its request, send the
+ * request again with another acquisition. Returns whether it did, in which case the user hears from that instead.
+ */
+static bool s_replay_on_stream_complete(
+    struct aws_h2_sm_pending_stream_acquisition *pending_stream_acquisition,
+    struct aws_http_stream *stream,
+    int error_code) {
+
+    struct aws_h2_sm_replay *replay = pending_stream_acquisition->replay;
+    if (replay == NULL || pending_stream_acquisition->is_response_started ||
+        replay->replays_count >= AWS_H2SM_MAX_REPLAYS || !s_is_replayable_error(stream, error_code)) {
+        return false;
+    }
+
+    struct aws_h2_sm_connection *sm_connection = pending_stream_acquisition->sm_connection;
+    struct aws_http2_stream_manager *stream_manager = sm_connection->stream_manager;
+    struct aws_input_stream *body_stream = aws_http_message_get_body_stream(replay->request);
+    if (body_stream && aws_input_stream_seek(body_stream, 0, AWS_SSB_BEGIN)) {
+        STREAM_MANAGER_LOGF(
+            DEBUG,
+            stream_manager,
+            "Not sending request of stream:%p again, its body can't be replayed. error: %d(%s)",
+            (void *)stream,
+            aws_last_error(),
+            aws_error_str(aws_last_error()));
+        return false;
+    }
+
+    struct aws_http_make_request_options options = pending_stream_acquisition->options;
+    options.request = replay->request;
+    struct aws_h2_sm_pending_stream_acquisition *replay_acquisition = s_new_pending_stream_acquisition(
+        pending_stream_acquisition->allocator, &options, NULL /*callback*/, NULL /*user_data*/);
+    replay_acquisition->replay = replay;
+    replay_acquisition->is_replay = true;
+    aws_ref_count_acquire(&replay->ref_count);
+
+    /* Hold the stream the user acquired, until the user hears how sending the request again went */
+    bool is_first_replay = !pending_stream_acquisition->is_replay;
+    if (is_first_replay) {
+        replay->acquired_stream = aws_http_stream_acquire(stream);
+    }
+    ++replay->replays_count;
+
+    bool is_ready = false;
+    struct aws_http2_stream_management_transaction work;
+    s_aws_stream_management_transaction_init(&work, stream_manager);
+    { /* BEGIN CRITICAL SECTION */
+        s_lock_synced_data(stream_manager);
+        is_ready = stream_manager->synced_data.state == AWS_H2SMST_READY;
+        if (is_ready) {
+            aws_linked_list_push_back(
+                &stream_manager->synced_data.pending_stream_acquisitions, &replay_acquisition->node);
+            s_sm_count_increase_synced(stream_manager, AWS_SMCT_PENDING_ACQUISITION, 1);
+            s_aws_http2_stream_manager_build_transaction_synced(&work);
+        }
+        s_unlock_synced_data(stream_manager);
+    } /* END CRITICAL SECTION */
+
+    if (!is_ready) {
+        /* Report the failure as it is */
+        --replay->replays_count;
+        if (is_first_replay) {
+            aws_http_stream_release(replay->acquired_stream);
+            replay->acquired_stream = NULL;
+        }
+        s_pending_stream_acquisition_destroy(replay_acquisition);
+        return false;
+    }
+
+    STREAM_MANAGER_LOGF(
+        DEBUG,
+        stream_manager,
+        "Stream:%p failed before the server processed it with error: %d(%s). Sending its request again with "
+        "acquisition:%p",
+        (void *)stream,
+        error_code,
+        aws_error_str(error_code),
+        (void *)replay_acquisition);
+    s_aws_http2_stream_manager_execute_transaction(&work);
+    return true;
+}
+
 static int s_on_incoming_headers(
     struct aws_http_stream *stream,
     enum aws_http_header_block header_block,
@@ -647,7 +1271,14 @@ static int s_on_incoming_headers(
     struct aws_h2_sm_connection *sm_connection = pending_stream_acquisition->sm_connection;
     struct aws_http2_stream_manager *stream_manager = sm_connection->stream_manager;
 
-    if (pending_stream_acquisition->options.on_response_headers) {
+    if (s_is_tracking_load(stream_manager) && header_block == AWS_HTTP_HEADER_BLOCK_MAIN) {
+        s_track_response_bytes(pending_stream_acquisition, header_array, num_headers);
+    }
+    pending_stream_acquisition->is_response_started = true;
+
+    if (!s_is_stream_seen_by_user(pending_stream_acquisition)) {
+        /* The other stream of the hedge got its response first */
+    } else if (pending_stream_acquisition->options.on_response_headers) {
         return pending_stream_acquisition->options.on_response_headers(
             stream, header_block, header_array, num_headers, pending_stream_acquisition->options.user_data);
     }
@@ -686,7 +1317,18 @@ static int s_on_incoming_header_block_done(
     enum aws_http_header_block header_block,
     void *user_data) {
     struct aws_h2_sm_pending_stream_acquisition *pending_stream_acquisition = user_data;
-    if (pending_stream_acquisition->options.on_response_header_block_done) {
+    if (header_block != AWS_HTTP_HEADER_BLOCK_TRAILING && pending_stream_acquisition->response_timestamp == 0) {
+        aws_high_res_clock_get_ticks(&pending_stream_acquisition->response_timestamp);
+        struct aws_http2_stream_manager *stream_manager = pending_stream_acquisition->sm_connection->stream_manager;
+        if (s_is_hedging_enabled(stream_manager)) {
+            aws_http_atomic_histogram_record(
+                &stream_manager->response_latency_histogram,
+                pending_stream_acquisition->activate_timestamp,
+                pending_stream_acquisition->response_timestamp);
+        }
+    }
+    if (s_is_stream_seen_by_user(pending_stream_acquisition) &&
+        pending_stream_acquisition->options.on_response_header_block_done) {
         return pending_stream_acquisition->options.on_response_header_block_done(
             stream, header_block, pending_stream_acquisition->options.user_data);
     }
@@ -695,18 +1337,186 @@ static int s_on_incoming_header_block_done(
 
 static int s_on_incoming_body(struct aws_http_stream *stream, const struct aws_byte_cursor *data, void *user_data) {
     struct aws_h2_sm_pending_stream_acquisition *pending_stream_acquisition = user_data;
-    if (pending_stream_acquisition->options.on_response_body) {
+    s_untrack_bytes(pending_stream_acquisition, 0, data->len);
+    if (s_is_stream_seen_by_user(pending_stream_acquisition) && pending_stream_acquisition->options.on_response_body) {
         return pending_stream_acquisition->options.on_response_body(
             stream, data, pending_stream_acquisition->options.user_data);
     }
     return AWS_OP_SUCCESS;
 }
 
+static int s_on_incoming_body_lease(
+    struct aws_http_stream *stream,
+    struct aws_http_body_lease *lease,
+    void *user_data) {
+    struct aws_h2_sm_pending_stream_acquisition *pending_stream_acquisition = user_data;
+    s_untrack_bytes(pending_stream_acquisition, 0, aws_http_body_lease_get_data(lease).len);
+    if (s_is_stream_seen_by_user(pending_stream_acquisition)) {
+        return pending_stream_acquisition->options.on_response_body_lease(
+            stream, lease, pending_stream_acquisition->options.user_data);
+    }
+    return AWS_OP_SUCCESS;
+}
+
+/* How a stream that was made went, for enable_adaptive_concurrency */
+struct aws_h2_sm_stream_feedback {
+    bool is_refused;
+    /* 0 if it never got a response */
+    uint64_t response_latency_ns;
+};
+
+/* With enable_adaptive_concurrency, update the stream limit of sm_connection after one of its streams finishes */
+static void s_adapt_sm_connection_concurrency_synced(
+    struct aws_h2_sm_connection *sm_connection,
+    struct aws_http2_stream_manager *stream_manager,
+    const struct aws_h2_sm_stream_feedback *feedback,
+    uint32_t remote_max_con_streams) {
+
+    /* The peer may have changed SETTINGS_MAX_CONCURRENT_STREAMS since the last stream */
+    sm_connection->adaptive.max_limit =
+        aws_min_u32((uint32_t)stream_manager->max_concurrent_streams_per_connection, remote_max_con_streams);
+
+    bool is_congested = feedback->is_refused;
+    uint64_t min_latency = sm_connection->adaptive.min_response_latency_ns;
+    if (feedback->response_latency_ns == 0) {
+        /* No latency to learn from */
+    } else if (min_latency == 0 || feedback->response_latency_ns < min_latency) {
+        sm_connection->adaptive.min_response_latency_ns = feedback->response_latency_ns;
+    } else if (
+        feedback->response_latency_ns / AWS_H2SM_ADAPTIVE_LATENCY_FACTOR > min_latency &&
+        feedback->response_latency_ns - min_latency > AWS_H2SM_ADAPTIVE_MIN_LATENCY_RISE_NS) {
+        is_congested = true;
+    }
+
+    uint32_t old_limit = sm_connection->max_concurrent_streams;
+    uint32_t limit = old_limit;
+    /* num_streams_assigned no longer counts the finished stream */
+    bool was_at_limit = sm_connection->num_streams_assigned + 1 >= old_limit;
+    if (sm_connection->adaptive.skip_count > 0) {
+        /* It was made under the limit before the last drop, so it says nothing about the current one */
+        --sm_connection->adaptive.skip_count;
+    } else if (is_congested) {
+        limit = aws_max_u32(old_limit / 2, 1);
+        sm_connection->adaptive.is_slow_start = false;
+        sm_connection->adaptive.success_count = 0;
+        sm_connection->adaptive.skip_count = sm_connection->num_streams_assigned;
+    } else if (!was_at_limit) {
+        /* The limit wasn't what held the connection back */
+    } else if (sm_connection->adaptive.is_slow_start) {
+        ++limit;
+    } else if (++sm_connection->adaptive.success_count >= old_limit) {
+        ++limit;
+        sm_connection->adaptive.success_count = 0;
+    }
+    limit = aws_max_u32(aws_min_u32(limit, sm_connection->adaptive.max_limit), 1);
+    if (limit == old_limit) {
+        return;
+    }
+
+    STREAM_MANAGER_LOGF(
+        DEBUG,
+        stream_manager,
+        "connection:%p concurrent streams limit changes from %" PRIu32 " to %" PRIu32 "",
+        (void *)sm_connection->connection,
+        old_limit,
+        limit);
+    sm_connection->max_concurrent_streams = limit;
+    if (sm_connection->state != AWS_H2SMCST_FULL && sm_connection->num_streams_assigned >= limit) {
+        /* Not available for new streams until enough of the current ones finish */
+        aws_random_access_intrusive_set_remove(
+            &stream_manager->synced_data.ideal_available_set, &sm_connection->available_set_node);
+        aws_random_access_intrusive_set_remove(
+            &stream_manager->synced_data.nonideal_available_set, &sm_connection->available_set_node);
+        sm_connection->state = AWS_H2SMCST_FULL;
+    }
+}
+
+/* A connection asks for a replacement once it has this many stream ids left, and stops taking streams at the second */
+#define AWS_H2SM_REPLACEMENT_STREAM_IDS_LEFT (1 << 20)
+#define AWS_H2SM_DRAIN_STREAM_IDS_LEFT 1024
+
+/**
+ * sm_connection is about to stop taking streams. Acquire another connection now, so new streams don't wait for a whole
+ * connect once it does. If no acquisition needs the new connection by the time it's set up, it goes to the connection
+ * manager's idle connections for the next one that does.
+ */
+/* *_synced should only be called with LOCK HELD or from another synced function */
+static void s_sm_connection_request_replacement_synced(
+    struct aws_h2_sm_connection *sm_connection,
+    struct aws_http2_stream_management_transaction *work) {
+
+    struct aws_http2_stream_manager *stream_manager = work->stream_manager;
+    if (sm_connection->is_replacement_requested || stream_manager->synced_data.state != AWS_H2SMST_READY) {
+        return;
+    }
+    sm_connection->is_replacement_requested = true;
+    size_t connections = stream_manager->synced_data.holding_connections_count +
+                         stream_manager->synced_data.internal_refcount_stats[AWS_SMCT_CONNECTIONS_ACQUIRING];
+    if (connections >= stream_manager->max_connections) {
+        STREAM_MANAGER_LOGF(
+            DEBUG,
+            stream_manager,
+            "connection:%p is draining, but max connections are held or acquiring already",
+            (void *)sm_connection->connection);
+        return;
+    }
+    STREAM_MANAGER_LOGF(
+        DEBUG,
+        stream_manager,
+        "connection:%p is draining, acquiring a connection to replace it",
+        (void *)sm_connection->connection);
+    ++work->new_connections;
+    s_sm_count_increase_synced(stream_manager, AWS_SMCT_CONNECTIONS_ACQUIRING, 1);
+}
+
+/* From the connection's thread, after a stream is made. Replaces, then drains the connection as its ids run out. */
+static void s_sm_connection_check_stream_ids(
+    struct aws_h2_sm_connection *sm_connection,
+    struct aws_http2_stream_manager *stream_manager,
+    struct aws_http_stream *stream) {
+
+    uint32_t stream_ids_left = (AWS_H2_STREAM_ID_MAX - aws_http_stream_get_id(stream)) / 2;
+    bool should_drain = stream_ids_left <= AWS_H2SM_DRAIN_STREAM_IDS_LEFT;
+    if (stream_ids_left > AWS_H2SM_REPLACEMENT_STREAM_IDS_LEFT || sm_connection->thread_data.is_out_of_stream_ids ||
+        (!should_drain && sm_connection->thread_data.is_low_on_stream_ids)) {
+        return;
+    }
+    sm_connection->thread_data.is_low_on_stream_ids = true;
+    sm_connection->thread_data.is_out_of_stream_ids = should_drain;
+
+    struct aws_http2_stream_management_transaction work;
+    s_aws_stream_management_transaction_init(&work, stream_manager);
+    { /* BEGIN CRITICAL SECTION */
+        s_lock_synced_data(stream_manager);
+        if (should_drain) {
+            STREAM_MANAGER_LOGF(
+                DEBUG,
+                stream_manager,
+                "connection:%p has %" PRIu32 " stream ids left, moving it out of available connections.",
+                (void *)sm_connection->connection,
+                stream_ids_left);
+            sm_connection->is_draining = true;
+            sm_connection->state = AWS_H2SMCST_FULL;
+            aws_random_access_intrusive_set_remove(
+                &stream_manager->synced_data.ideal_available_set, &sm_connection->available_set_node);
+            aws_random_access_intrusive_set_remove(
+                &stream_manager->synced_data.nonideal_available_set, &sm_connection->available_set_node);
+        }
+        s_sm_connection_request_replacement_synced(sm_connection, &work);
+        s_unlock_synced_data(stream_manager);
+    } /* END CRITICAL SECTION */
+    s_aws_http2_stream_manager_execute_transaction(&work);
+}
+
 /* Helper invoked when underlying connections is still available and the num stream assigned has been updated */
 static void s_update_sm_connection_set_on_stream_finishes_synced(
     struct aws_h2_sm_connection *sm_connection,
     struct aws_http2_stream_manager *stream_manager) {
 
+    if (sm_connection->is_draining) {
+        /* Out of stream ids, it only waits for its streams to finish */
+        return;
+    }
     int re_error = 0;
     size_t cur_num = sm_connection->num_streams_assigned;
     size_t ideal_num = stream_manager->ideal_concurrent_streams_per_connection;
@@ -719,15 +1529,13 @@ static void s_update_sm_connection_set_on_stream_finishes_synced(
      */
     if (sm_connection->state == AWS_H2SMCST_NEARLY_FULL && cur_num < ideal_num) {
         /* this connection is back from soft limited to ideal */
-        bool exist = false;
-        (void)exist;
-        AWS_ASSERT(
-            aws_random_access_set_exist(&stream_manager->synced_data.nonideal_available_set, sm_connection, &exist) ==
-                AWS_OP_SUCCESS &&
-            exist);
-        re_error |= aws_random_access_set_remove(&stream_manager->synced_data.nonideal_available_set, sm_connection);
+        AWS_ASSERT(aws_random_access_intrusive_set_contains(
+            &stream_manager->synced_data.nonideal_available_set, &sm_connection->available_set_node));
+        aws_random_access_intrusive_set_remove(
+            &stream_manager->synced_data.nonideal_available_set, &sm_connection->available_set_node);
         bool added = false;
-        re_error |= aws_random_access_set_add(&stream_manager->synced_data.ideal_available_set, sm_connection, &added);
+        re_error |= aws_random_access_intrusive_set_add(
+            &stream_manager->synced_data.ideal_available_set, &sm_connection->available_set_node, &added);
         re_error |= !added;
         sm_connection->state = AWS_H2SMCST_IDEAL;
     } else if (sm_connection->state == AWS_H2SMCST_FULL && cur_num < max_num) {
@@ -744,14 +1552,14 @@ static void s_update_sm_connection_set_on_stream_finishes_synced(
             sm_connection->state = AWS_H2SMCST_NEARLY_FULL;
             STREAM_MANAGER_LOGF(
                 TRACE, stream_manager, "connection:%p added to soft limited set", (void *)sm_connection->connection);
-            re_error |=
-                aws_random_access_set_add(&stream_manager->synced_data.nonideal_available_set, sm_connection, &added);
+            re_error |= aws_random_access_intrusive_set_add(
+                &stream_manager->synced_data.nonideal_available_set, &sm_connection->available_set_node, &added);
         } else {
             sm_connection->state = AWS_H2SMCST_IDEAL;
             STREAM_MANAGER_LOGF(
                 TRACE, stream_manager, "connection:%p added to ideal set", (void *)sm_connection->connection);
-            re_error |=
-                aws_random_access_set_add(&stream_manager->synced_data.ideal_available_set, sm_connection, &added);
+            re_error |= aws_random_access_intrusive_set_add(
+                &stream_manager->synced_data.ideal_available_set, &sm_connection->available_set_node, &added);
         }
         re_error |= !added;
     }
@@ -759,21 +1567,35 @@ static void s_update_sm_connection_set_on_stream_finishes_synced(
     (void)re_error;
 }
 
+/* feedback is NULL if the stream was never made */
 static void s_sm_connection_on_scheduled_stream_finishes(
     struct aws_h2_sm_connection *sm_connection,
-    struct aws_http2_stream_manager *stream_manager) {
+    struct aws_http2_stream_manager *stream_manager,
+    const struct aws_h2_sm_stream_feedback *feedback) {
     /* Reach the max current will still allow new requests, but the new stream will complete with error */
     bool connection_available = aws_http_connection_new_requests_allowed(sm_connection->connection);
+    bool should_adapt = feedback && connection_available && stream_manager->enable_adaptive_concurrency;
+    uint32_t remote_max_con_streams = 0;
+    if (should_adapt) {
+        struct aws_http2_setting out_settings[AWS_HTTP2_SETTINGS_COUNT];
+        aws_http2_connection_get_remote_settings(sm_connection->connection, out_settings);
+        remote_max_con_streams = out_settings[AWS_HTTP2_SETTINGS_MAX_CONCURRENT_STREAMS - 1].value;
+    }
     struct aws_http2_stream_management_transaction work;
     s_aws_stream_management_transaction_init(&work, stream_manager);
     { /* BEGIN CRITICAL SECTION */
         s_lock_synced_data(stream_manager);
         s_sm_count_decrease_synced(stream_manager, AWS_SMCT_OPEN_STREAM, 1);
         --sm_connection->num_streams_assigned;
+        if (should_adapt) {
+            s_adapt_sm_connection_concurrency_synced(sm_connection, stream_manager, feedback, remote_max_con_streams);
+        }
         if (!connection_available) {
             /* It might be removed already, but, it's fine */
-            aws_random_access_set_remove(&stream_manager->synced_data.ideal_available_set, sm_connection);
-            aws_random_access_set_remove(&stream_manager->synced_data.nonideal_available_set, sm_connection);
+            aws_random_access_intrusive_set_remove(
+                &stream_manager->synced_data.ideal_available_set, &sm_connection->available_set_node);
+            aws_random_access_intrusive_set_remove(
+                &stream_manager->synced_data.nonideal_available_set, &sm_connection->available_set_node);
         } else {
             s_update_sm_connection_set_on_stream_finishes_synced(sm_connection, stream_manager);
         }
@@ -782,7 +1604,8 @@ static void s_sm_connection_on_scheduled_stream_finishes(
          * sm_connection */
         if (sm_connection->num_streams_assigned == 0) {
             /* It might be removed already, but, it's fine */
-            aws_random_access_set_remove(&stream_manager->synced_data.ideal_available_set, sm_connection);
+            aws_random_access_intrusive_set_remove(
+                &stream_manager->synced_data.ideal_available_set, &sm_connection->available_set_node);
             work.sm_connection_to_release = sm_connection;
             --stream_manager->synced_data.holding_connections_count;
             /* After we release one connection back, we should check if we need more connections */
@@ -791,6 +1614,10 @@ static void s_sm_connection_on_scheduled_stream_finishes(
                 s_check_new_connections_needed_synced(&work);
             }
         }
+        if (!connection_available) {
+            /* After a GOAWAY for example. Done last, so new connections already on the way count. */
+            s_sm_connection_request_replacement_synced(sm_connection, &work);
+        }
         s_unlock_synced_data(stream_manager);
     } /* END CRITICAL SECTION */
     s_aws_http2_stream_manager_execute_transaction(&work);
@@ -800,25 +1627,62 @@ static void s_on_stream_complete(struct aws_http_stream *stream, int error_code,
     struct aws_h2_sm_pending_stream_acquisition *pending_stream_acquisition = user_data;
     struct aws_h2_sm_connection *sm_connection = pending_stream_acquisition->sm_connection;
     struct aws_http2_stream_manager *stream_manager = sm_connection->stream_manager;
-    if (pending_stream_acquisition->options.on_complete) {
+    s_untrack_bytes(pending_stream_acquisition, SIZE_MAX, SIZE_MAX);
+
+    struct aws_h2_sm_stream_feedback feedback;
+    AWS_ZERO_STRUCT(feedback);
+    if (error_code == AWS_ERROR_HTTP_RST_STREAM_RECEIVED) {
+        uint32_t http2_error = 0;
+        if (aws_http2_stream_get_received_reset_error_code(stream, &http2_error) == AWS_OP_SUCCESS &&
+            (http2_error == AWS_HTTP2_ERR_REFUSED_STREAM || http2_error == AWS_HTTP2_ERR_ENHANCE_YOUR_CALM)) {
+            feedback.is_refused = true;
+        }
+    }
+    if (pending_stream_acquisition->response_timestamp > pending_stream_acquisition->activate_timestamp) {
+        feedback.response_latency_ns =
+            pending_stream_acquisition->response_timestamp - pending_stream_acquisition->activate_timestamp;
+    }
+
+    struct aws_h2_sm_hedge_stream *hedge_stream = pending_stream_acquisition->hedge_stream;
+    bool is_seen_by_user = hedge_stream == NULL || s_hedge_stream_on_complete(hedge_stream);
+    if (is_seen_by_user && s_replay_on_stream_complete(pending_stream_acquisition, stream, error_code)) {
+        /* The user hears from the stream sending the request again instead */
+        is_seen_by_user = false;
+    }
+    if (is_seen_by_user && pending_stream_acquisition->options.on_complete) {
         pending_stream_acquisition->options.on_complete(
             stream, error_code, pending_stream_acquisition->options.user_data);
     }
-    s_sm_connection_on_scheduled_stream_finishes(sm_connection, stream_manager);
+    if (hedge_stream && hedge_stream == &hedge_stream->hedge->duplicate) {
+        /* The user never owned the duplicate */
+        aws_http_stream_release(stream);
+    }
+    if (pending_stream_acquisition->is_replay) {
+        /* Nor the streams sending the request again. Done holding the one they did own once this is reported */
+        aws_http_stream_release(stream);
+        if (is_seen_by_user) {
+            aws_http_stream_release(pending_stream_acquisition->replay->acquired_stream);
+            pending_stream_acquisition->replay->acquired_stream = NULL;
+        }
+    }
+    s_sm_connection_on_scheduled_stream_finishes(sm_connection, stream_manager, &feedback);
 }
 
 static void s_on_stream_destroy(void *user_data) {
     struct aws_h2_sm_pending_stream_acquisition *pending_stream_acquisition = user_data;
-    if (pending_stream_acquisition->options.on_destroy) {
+    /* With hedging or replay, the user's on_destroy waits for the hedge or replay to go */
+    if (pending_stream_acquisition->hedge_stream == NULL && pending_stream_acquisition->replay == NULL &&
+        pending_stream_acquisition->options.on_destroy) {
         pending_stream_acquisition->options.on_destroy(pending_stream_acquisition->options.user_data);
     }
     s_pending_stream_acquisition_destroy(pending_stream_acquisition);
 }
 
-/* Scheduled to happen from connection's thread */
-static void s_make_request_task(struct aws_channel_task *task, void *arg, enum aws_task_status status) {
-    (void)task;
-    struct aws_h2_sm_pending_stream_acquisition *pending_stream_acquisition = arg;
+/* From connection's thread, once the acquisition is counted as an open stream */
+static void s_make_request(
+    struct aws_h2_sm_pending_stream_acquisition *pending_stream_acquisition,
+    enum aws_task_status status,
+    bool is_shutting_down) {
     struct aws_h2_sm_connection *sm_connection = pending_stream_acquisition->sm_connection;
     struct aws_http2_stream_manager *stream_manager = sm_connection->stream_manager;
     int error_code = AWS_ERROR_SUCCESS;
@@ -829,19 +1693,6 @@ static void s_make_request_task(struct aws_channel_task *task, void *arg, enum a
         "Make request task running for acquisition:%p from connection:%p thread",
         (void *)pending_stream_acquisition,
         (void *)sm_connection->connection);
-    bool is_shutting_down = false;
-    { /* BEGIN CRITICAL SECTION */
-        s_lock_synced_data(stream_manager);
-        is_shutting_down = stream_manager->synced_data.state != AWS_H2SMST_READY;
-        s_sm_count_decrease_synced(stream_manager, AWS_SMCT_PENDING_MAKE_REQUESTS, 1);
-        /* The stream has not open yet, but we increase the count here, if anything fails, the count will be decreased
-         */
-        s_sm_count_increase_synced(stream_manager, AWS_SMCT_OPEN_STREAM, 1);
-        AWS_ASSERT(
-            sm_connection->max_concurrent_streams >= sm_connection->num_streams_assigned &&
-            "The max concurrent streams exceed");
-        s_unlock_synced_data(stream_manager);
-    } /* END CRITICAL SECTION */
     /* this is a channel task. If it is canceled, that means the channel shutdown. In that case, that's equivalent
      * to a closed connection. */
     if (status != AWS_TASK_STATUS_RUN_READY) {
@@ -862,6 +1713,16 @@ static void s_make_request_task(struct aws_channel_task *task, void *arg, enum a
         error_code = AWS_ERROR_HTTP_STREAM_MANAGER_SHUTTING_DOWN;
         goto error;
     }
+    if (pending_stream_acquisition->hedge_stream &&
+        aws_atomic_load_ptr(&pending_stream_acquisition->hedge_stream->hedge->winner) != NULL) {
+        /* Only a duplicate can find its hedge decided already. Nobody is waiting for it. */
+        STREAM_MANAGER_LOGF(
+            TRACE,
+            stream_manager,
+            "acquisition:%p is not made as the stream it duplicates got a response first.",
+            (void *)pending_stream_acquisition);
+        goto error;
+    }
     struct aws_http_make_request_options request_options = {
         .self_size = sizeof(request_options),
         .request = pending_stream_acquisition->request,
@@ -872,7 +1733,13 @@ static void s_make_request_task(struct aws_channel_task *task, void *arg, enum a
         .on_destroy = s_on_stream_destroy,
         .user_data = pending_stream_acquisition,
         .http2_use_manual_data_writes = pending_stream_acquisition->options.http2_use_manual_data_writes,
+        .http2_priority = pending_stream_acquisition->options.http2_priority,
+        .content_decoding = pending_stream_acquisition->options.content_decoding,
+        .content_encoding = pending_stream_acquisition->options.content_encoding,
     };
+    if (pending_stream_acquisition->options.on_response_body_lease) {
+        request_options.on_response_body_lease = s_on_incoming_body_lease;
+    }
     /* TODO: we could put the pending acquisition back to the list if the connection is not available for new request.
      */
 
@@ -902,6 +1769,28 @@ static void s_make_request_task(struct aws_channel_task *task, void *arg, enum a
             aws_error_str(error_code));
         goto error;
     }
+    uint64_t now = 0;
+    aws_high_res_clock_get_ticks(&now);
+    aws_http_atomic_histogram_record(
+        &stream_manager->acquisition_wait_histogram, pending_stream_acquisition->acquire_timestamp, now);
+    pending_stream_acquisition->activate_timestamp = now;
+    /* Still on the connection's thread, where the stream writes its own metrics */
+    if (now > pending_stream_acquisition->acquire_timestamp) {
+        stream->metrics.connection_acquisition_wait_ns = (int64_t)(now - pending_stream_acquisition->acquire_timestamp);
+    } else {
+        stream->metrics.connection_acquisition_wait_ns = 0;
+    }
+    if (s_is_tracking_load(stream_manager)) {
+        s_track_request_bytes(pending_stream_acquisition);
+    }
+    if (pending_stream_acquisition->hedge_stream) {
+        s_hedge_stream_on_made(pending_stream_acquisition, stream);
+    }
+    if (pending_stream_acquisition->replay) {
+        pending_stream_acquisition->replay->was_stream_made = true;
+    }
+    s_sm_connection_check_stream_ids(sm_connection, stream_manager, stream);
+
     if (pending_stream_acquisition->callback) {
         pending_stream_acquisition->callback(stream, 0, pending_stream_acquisition->user_data);
     }
@@ -914,10 +1803,54 @@ static void s_make_request_task(struct aws_channel_task *task, void *arg, enum a
 error:
     if (pending_stream_acquisition->callback) {
         pending_stream_acquisition->callback(NULL, error_code, pending_stream_acquisition->user_data);
+    } else if (pending_stream_acquisition->is_replay) {
+        s_replay_on_failed_to_make(pending_stream_acquisition, error_code);
     }
     s_pending_stream_acquisition_destroy(pending_stream_acquisition);
     /* task should happen after destroy, as the task can trigger the whole stream manager to be destroyed */
-    s_sm_connection_on_scheduled_stream_finishes(sm_connection, stream_manager);
+    s_sm_connection_on_scheduled_stream_finishes(sm_connection, stream_manager, NULL);
+}
+
+/* Scheduled to happen from connection's thread. Makes the requests of the acquisition and of its batch. */
+static void s_make_request_task(struct aws_channel_task *task, void *arg, enum aws_task_status status) {
+    (void)task;
+    struct aws_h2_sm_pending_stream_acquisition *pending_stream_acquisition = arg;
+    struct aws_h2_sm_connection *sm_connection = pending_stream_acquisition->sm_connection;
+    struct aws_http2_stream_manager *stream_manager = sm_connection->stream_manager;
+
+    /* Take the batch first, as the acquisition can be gone once its request is made */
+    struct aws_linked_list batch;
+    aws_linked_list_init(&batch);
+    aws_linked_list_swap_contents(&batch, &pending_stream_acquisition->make_request_batch);
+    size_t num_requests = 1;
+    for (struct aws_linked_list_node *node = aws_linked_list_begin(&batch); node != aws_linked_list_end(&batch);
+         node = aws_linked_list_next(node)) {
+        ++num_requests;
+    }
+
+    bool is_shutting_down = false;
+    { /* BEGIN CRITICAL SECTION */
+        s_lock_synced_data(stream_manager);
+        is_shutting_down = stream_manager->synced_data.state != AWS_H2SMST_READY;
+        s_sm_count_decrease_synced(stream_manager, AWS_SMCT_PENDING_MAKE_REQUESTS, num_requests);
+        /* The streams have not open yet, but we increase the count here, if anything fails, the count will be
+         * decreased */
+        s_sm_count_increase_synced(stream_manager, AWS_SMCT_OPEN_STREAM, num_requests);
+        /* An adaptive limit can drop below the streams already assigned */
+        AWS_ASSERT(
+            (stream_manager->enable_adaptive_concurrency ||
+             sm_connection->max_concurrent_streams >= sm_connection->num_streams_assigned) &&
+            "The max concurrent streams exceed");
+        s_unlock_synced_data(stream_manager);
+    } /* END CRITICAL SECTION */
+
+    /* The streams still to make keep the connection and the stream manager alive */
+    s_make_request(pending_stream_acquisition, status, is_shutting_down);
+    while (!aws_linked_list_empty(&batch)) {
+        struct aws_linked_list_node *node = aws_linked_list_pop_front(&batch);
+        s_make_request(
+            AWS_CONTAINER_OF(node, struct aws_h2_sm_pending_stream_acquisition, node), status, is_shutting_down);
+    }
 }
 
 /* NEVER invoke with lock held */
@@ -948,6 +1881,19 @@ static void s_aws_http2_stream_manager_execute_transaction(struct aws_http2_stre
             pending_stream_acquisition->sm_connection &&
             "Stream manager internal bug: connection is not decided before execute transaction");
 
+        /* The rest of the requests for the same connection are made by the same task */
+        struct aws_linked_list_node *other_node = aws_linked_list_begin(&work->pending_make_requests);
+        while (other_node != aws_linked_list_end(&work->pending_make_requests)) {
+            struct aws_linked_list_node *next_node = aws_linked_list_next(other_node);
+            struct aws_h2_sm_pending_stream_acquisition *other_acquisition =
+                AWS_CONTAINER_OF(other_node, struct aws_h2_sm_pending_stream_acquisition, node);
+            if (other_acquisition->sm_connection == pending_stream_acquisition->sm_connection) {
+                aws_linked_list_remove(other_node);
+                aws_linked_list_push_back(&pending_stream_acquisition->make_request_batch, other_node);
+            }
+            other_node = next_node;
+        }
+
         STREAM_MANAGER_LOGF(
             TRACE,
             stream_manager,
@@ -985,6 +1931,292 @@ static void s_aws_http2_stream_manager_execute_transaction(struct aws_http2_stre
     s_aws_stream_management_transaction_clean_up(work);
 }
 
+static void s_destroy_string_list(struct aws_array_list *list) {
+    const size_t count = aws_array_list_length(list);
+    for (size_t i = 0; i < count; ++i) {
+        struct aws_string *str = NULL;
+        aws_array_list_get_at(list, &str, i);
+        aws_string_destroy(str);
+    }
+    aws_array_list_clean_up(list);
+}
+
+static int s_push_back_string(
+    struct aws_allocator *allocator,
+    struct aws_array_list *list,
+    struct aws_byte_cursor cur) {
+    struct aws_string *str = aws_string_new_from_cursor(allocator, &cur);
+    if (!str) {
+        return AWS_OP_ERR;
+    }
+    if (aws_array_list_push_back(list, &str)) {
+        aws_string_destroy(str);
+        return AWS_OP_ERR;
+    }
+    return AWS_OP_SUCCESS;
+}
+
+static void s_coalescing_group_destroy(void *user_data) {
+    struct aws_http2_stream_manager_coalescing_group *group = user_data;
+    AWS_FATAL_ASSERT(aws_linked_list_empty(&group->members));
+    aws_mutex_clean_up(&group->lock);
+    aws_mem_release(group->allocator, group);
+}
+
+struct aws_http2_stream_manager_coalescing_group *aws_http2_stream_manager_coalescing_group_new(
+    struct aws_allocator *allocator) {
+    struct aws_http2_stream_manager_coalescing_group *group =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_http2_stream_manager_coalescing_group));
+    group->allocator = allocator;
+    if (aws_mutex_init(&group->lock)) {
+        aws_mem_release(allocator, group);
+        return NULL;
+    }
+    aws_linked_list_init(&group->members);
+    aws_ref_count_init(&group->ref_count, group, s_coalescing_group_destroy);
+    return group;
+}
+
+struct aws_http2_stream_manager_coalescing_group *aws_http2_stream_manager_coalescing_group_acquire(
+    struct aws_http2_stream_manager_coalescing_group *group) {
+    if (group) {
+        aws_ref_count_acquire(&group->ref_count);
+    }
+    return group;
+}
+
+struct aws_http2_stream_manager_coalescing_group *aws_http2_stream_manager_coalescing_group_release(
+    struct aws_http2_stream_manager_coalescing_group *group) {
+    if (group) {
+        aws_ref_count_release(&group->ref_count);
+    }
+    return NULL;
+}
+
+static void s_lock_coalescing_group(struct aws_http2_stream_manager_coalescing_group *group) {
+    int err = aws_mutex_lock(&group->lock);
+    AWS_ASSERT(!err && "lock failed");
+    (void)err;
+}
+
+static void s_unlock_coalescing_group(struct aws_http2_stream_manager_coalescing_group *group) {
+    int err = aws_mutex_unlock(&group->lock);
+    AWS_ASSERT(!err && "unlock failed");
+    (void)err;
+}
+
+static int s_coalescing_init(
+    struct aws_http2_stream_manager *stream_manager,
+    const struct aws_http2_stream_manager_options *options) {
+    struct aws_allocator *allocator = stream_manager->allocator;
+    stream_manager->coalescing.group = aws_http2_stream_manager_coalescing_group_acquire(options->coalescing_group);
+    stream_manager->coalescing.port = options->port;
+    /* Nothing is allocated until the first push, so these can't fail */
+    struct aws_array_list *certificate_names = &stream_manager->coalescing.certificate_names;
+    aws_array_list_init_dynamic(certificate_names, allocator, 0, sizeof(struct aws_string *));
+    aws_array_list_init_dynamic(&stream_manager->coalescing.addresses, allocator, 0, sizeof(struct aws_string *));
+
+    stream_manager->coalescing.host = aws_string_new_from_cursor(allocator, &options->host);
+    if (!stream_manager->coalescing.host) {
+        return AWS_OP_ERR;
+    }
+    for (size_t i = 0; i < options->num_certificate_names; ++i) {
+        if (s_push_back_string(allocator, certificate_names, options->certificate_names[i])) {
+            return AWS_OP_ERR;
+        }
+    }
+    return AWS_OP_SUCCESS;
+}
+
+/* A "*." label in the name matches the leftmost label of the host, and nothing else */
+static bool s_certificate_name_covers_host(struct aws_byte_cursor name, struct aws_byte_cursor host) {
+    if (name.len > 2 && name.ptr[0] == '*' && name.ptr[1] == '.') {
+        const uint8_t *dot = memchr(host.ptr, '.', host.len);
+        if (dot == NULL || dot == host.ptr) {
+            return false;
+        }
+        struct aws_byte_cursor host_suffix = aws_byte_cursor_from_array(dot, host.len - (size_t)(dot - host.ptr));
+        aws_byte_cursor_advance(&name, 1);
+        return aws_byte_cursor_eq_ignore_case(&name, &host_suffix);
+    }
+    return aws_byte_cursor_eq_ignore_case(&name, &host);
+}
+
+static bool s_coalescing_certificate_covers(
+    const struct aws_http2_stream_manager *stream_manager,
+    const struct aws_string *host) {
+    struct aws_byte_cursor host_cur = aws_byte_cursor_from_string(host);
+    if (s_certificate_name_covers_host(aws_byte_cursor_from_string(stream_manager->coalescing.host), host_cur)) {
+        return true;
+    }
+    const size_t count = aws_array_list_length(&stream_manager->coalescing.certificate_names);
+    for (size_t i = 0; i < count; ++i) {
+        struct aws_string *name = NULL;
+        aws_array_list_get_at(&stream_manager->coalescing.certificate_names, &name, i);
+        if (s_certificate_name_covers_host(aws_byte_cursor_from_string(name), host_cur)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* The group's lock must be held */
+static bool s_coalescing_addresses_overlap_synced(
+    const struct aws_http2_stream_manager *stream_manager,
+    const struct aws_http2_stream_manager *other) {
+    const size_t count = aws_array_list_length(&stream_manager->coalescing.addresses);
+    const size_t other_count = aws_array_list_length(&other->coalescing.addresses);
+    for (size_t i = 0; i < count; ++i) {
+        struct aws_string *address = NULL;
+        aws_array_list_get_at(&stream_manager->coalescing.addresses, &address, i);
+        for (size_t j = 0; j < other_count; ++j) {
+            struct aws_string *other_address = NULL;
+            aws_array_list_get_at(&other->coalescing.addresses, &other_address, j);
+            if (aws_string_eq(address, other_address)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/* Fails once the last external refcount is gone, even if on_zero_external_ref hasn't run yet */
+static bool s_try_acquire_external_ref(struct aws_http2_stream_manager *stream_manager) {
+    size_t count = aws_atomic_load_int(&stream_manager->external_ref_count.ref_count);
+    while (count != 0) {
+        if (aws_atomic_compare_exchange_int(&stream_manager->external_ref_count.ref_count, &count, count + 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Find a manager of the group whose connections the acquisitions can go to, and acquire a refcount on it.
+ * Only when this manager has no connection, nor is acquiring one. The group's lock is taken before any member's.
+ */
+static struct aws_http2_stream_manager *s_acquire_coalescing_target(struct aws_http2_stream_manager *stream_manager) {
+    struct aws_http2_stream_manager_coalescing_group *group = stream_manager->coalescing.group;
+    if (!group) {
+        return NULL;
+    }
+    bool has_connections = false;
+    { /* BEGIN CRITICAL SECTION */
+        s_lock_synced_data(stream_manager);
+        has_connections = stream_manager->synced_data.holding_connections_count > 0 ||
+                          stream_manager->synced_data.internal_refcount_stats[AWS_SMCT_CONNECTIONS_ACQUIRING] > 0;
+        s_unlock_synced_data(stream_manager);
+    } /* END CRITICAL SECTION */
+    if (has_connections) {
+        return NULL;
+    }
+
+    struct aws_http2_stream_manager *target = NULL;
+    s_lock_coalescing_group(group);
+    if (stream_manager->coalescing.is_resolved) {
+        for (struct aws_linked_list_node *node = aws_linked_list_begin(&group->members);
+             node != aws_linked_list_end(&group->members);
+             node = aws_linked_list_next(node)) {
+            struct aws_http2_stream_manager *member =
+                AWS_CONTAINER_OF(node, struct aws_http2_stream_manager, coalescing.node);
+            if (member == stream_manager || !member->coalescing.is_resolved ||
+                member->coalescing.port != stream_manager->coalescing.port ||
+                !s_coalescing_certificate_covers(member, stream_manager->coalescing.host) ||
+                !s_coalescing_addresses_overlap_synced(stream_manager, member)) {
+                continue;
+            }
+            bool member_has_connections = false;
+            { /* BEGIN CRITICAL SECTION */
+                s_lock_synced_data(member);
+                member_has_connections = member->synced_data.state == AWS_H2SMST_READY &&
+                                         member->synced_data.holding_connections_count > 0;
+                s_unlock_synced_data(member);
+            } /* END CRITICAL SECTION */
+            if (member_has_connections && s_try_acquire_external_ref(member)) {
+                target = member;
+                break;
+            }
+        }
+    }
+    s_unlock_coalescing_group(group);
+    return target;
+}
+
+static void s_on_coalescing_host_resolved(
+    struct aws_host_resolver *resolver,
+    const struct aws_string *host_name,
+    int err_code,
+    const struct aws_array_list *host_addresses,
+    void *user_data) {
+    (void)resolver;
+    (void)host_name;
+    struct aws_http2_stream_manager *stream_manager = user_data;
+    struct aws_http2_stream_manager_coalescing_group *group = stream_manager->coalescing.group;
+    if (err_code) {
+        STREAM_MANAGER_LOGF(
+            WARN,
+            stream_manager,
+            "Failed to resolve host for connection coalescing, the connections won't be shared. error %d (%s)",
+            err_code,
+            aws_error_name(err_code));
+    } else {
+        s_lock_coalescing_group(group);
+        const size_t count = aws_array_list_length(host_addresses);
+        for (size_t i = 0; i < count; ++i) {
+            struct aws_host_address *host_address = NULL;
+            aws_array_list_get_at_ptr(host_addresses, (void **)&host_address, i);
+            if (s_push_back_string(
+                    stream_manager->allocator,
+                    &stream_manager->coalescing.addresses,
+                    aws_byte_cursor_from_string(host_address->address))) {
+                break;
+            }
+        }
+        stream_manager->coalescing.is_resolved = aws_array_list_length(&stream_manager->coalescing.addresses) > 0;
+        s_unlock_coalescing_group(group);
+    }
+    /* Acquired as the resolution started */
+    aws_ref_count_release(&stream_manager->internal_ref_count);
+}
+
+static void s_coalescing_group_add(struct aws_http2_stream_manager *stream_manager) {
+    struct aws_http2_stream_manager_coalescing_group *group = stream_manager->coalescing.group;
+    s_lock_coalescing_group(group);
+    aws_linked_list_push_back(&group->members, &stream_manager->coalescing.node);
+    stream_manager->coalescing.is_member = true;
+    s_unlock_coalescing_group(group);
+
+    /* Keep the manager alive until the resolution completes */
+    aws_ref_count_acquire(&stream_manager->internal_ref_count);
+    if (aws_host_resolver_resolve_host(
+            stream_manager->bootstrap->host_resolver,
+            stream_manager->coalescing.host,
+            s_on_coalescing_host_resolved,
+            &stream_manager->bootstrap->host_resolver_config,
+            stream_manager)) {
+        STREAM_MANAGER_LOGF(
+            WARN,
+            stream_manager,
+            "Failed to start resolving host for connection coalescing, the connections won't be shared. error %d (%s)",
+            aws_last_error(),
+            aws_error_name(aws_last_error()));
+        aws_ref_count_release(&stream_manager->internal_ref_count);
+    }
+}
+
+static void s_coalescing_group_remove(struct aws_http2_stream_manager *stream_manager) {
+    struct aws_http2_stream_manager_coalescing_group *group = stream_manager->coalescing.group;
+    if (!group) {
+        return;
+    }
+    s_lock_coalescing_group(group);
+    if (stream_manager->coalescing.is_member) {
+        aws_linked_list_remove(&stream_manager->coalescing.node);
+        stream_manager->coalescing.is_member = false;
+    }
+    s_unlock_coalescing_group(group);
+}
+
 void s_stream_manager_destroy_final(struct aws_http2_stream_manager *stream_manager) {
     if (!stream_manager) {
         return;
@@ -995,9 +2227,16 @@ void s_stream_manager_destroy_final(struct aws_http2_stream_manager *stream_mana
     AWS_FATAL_ASSERT(stream_manager->connection_manager == NULL);
     AWS_FATAL_ASSERT(aws_linked_list_empty(&stream_manager->synced_data.pending_stream_acquisitions));
     aws_mutex_clean_up(&stream_manager->synced_data.lock);
-    aws_random_access_set_clean_up(&stream_manager->synced_data.ideal_available_set);
-    aws_random_access_set_clean_up(&stream_manager->synced_data.nonideal_available_set);
+    aws_random_access_intrusive_set_clean_up(&stream_manager->synced_data.ideal_available_set);
+    aws_random_access_intrusive_set_clean_up(&stream_manager->synced_data.nonideal_available_set);
     aws_client_bootstrap_release(stream_manager->bootstrap);
+    if (stream_manager->coalescing.group) {
+        AWS_FATAL_ASSERT(!stream_manager->coalescing.is_member);
+        s_destroy_string_list(&stream_manager->coalescing.certificate_names);
+        s_destroy_string_list(&stream_manager->coalescing.addresses);
+        aws_string_destroy(stream_manager->coalescing.host);
+        aws_http2_stream_manager_coalescing_group_release(stream_manager->coalescing.group);
+    }
 
     if (stream_manager->shutdown_complete_callback) {
         stream_manager->shutdown_complete_callback(stream_manager->shutdown_complete_user_data);
@@ -1019,8 +2258,8 @@ void s_stream_manager_on_cm_shutdown_complete(void *user_data) {
 static void s_stream_manager_start_destroy(struct aws_http2_stream_manager *stream_manager) {
     STREAM_MANAGER_LOG(TRACE, stream_manager, "Stream Manager reaches the condition to destroy, start to destroy");
     /* If there is no outstanding streams, the connections set should be empty. */
-    AWS_ASSERT(aws_random_access_set_get_size(&stream_manager->synced_data.ideal_available_set) == 0);
-    AWS_ASSERT(aws_random_access_set_get_size(&stream_manager->synced_data.nonideal_available_set) == 0);
+    AWS_ASSERT(aws_random_access_intrusive_set_get_size(&stream_manager->synced_data.ideal_available_set) == 0);
+    AWS_ASSERT(aws_random_access_intrusive_set_get_size(&stream_manager->synced_data.nonideal_available_set) == 0);
     AWS_ASSERT(stream_manager->synced_data.internal_refcount_stats[AWS_SMCT_CONNECTIONS_ACQUIRING] == 0);
     AWS_ASSERT(stream_manager->synced_data.internal_refcount_stats[AWS_SMCT_OPEN_STREAM] == 0);
     AWS_ASSERT(stream_manager->synced_data.internal_refcount_stats[AWS_SMCT_PENDING_MAKE_REQUESTS] == 0);
@@ -1037,6 +2276,8 @@ void s_stream_manager_on_zero_external_ref(struct aws_http2_stream_manager *stre
         stream_manager,
         "Last refcount released, manager stop accepting new stream request and will start to clean up when not "
         "outstanding tasks remaining.");
+    /* No other manager of the group may send streams here from now on */
+    s_coalescing_group_remove(stream_manager);
     struct aws_http2_stream_management_transaction work;
     s_aws_stream_management_transaction_init(&work, stream_manager);
     { /* BEGIN CRITICAL SECTION */
@@ -1064,30 +2305,30 @@ struct aws_http2_stream_manager *aws_http2_stream_manager_new(
         aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
         return NULL;
     }
+    if (options->coalescing_group && (!options->tls_connection_options || options->proxy_options)) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_CONNECTION_MANAGER,
+            "Invalid options - Connection coalescing is only for secure connections without a proxy.");
+        aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+        return NULL;
+    }
     struct aws_http2_stream_manager *stream_manager =
         aws_mem_calloc(allocator, 1, sizeof(struct aws_http2_stream_manager));
     stream_manager->allocator = allocator;
     aws_linked_list_init(&stream_manager->synced_data.pending_stream_acquisitions);
+    aws_http_atomic_histogram_init(&stream_manager->acquisition_wait_histogram);
+    aws_http_atomic_histogram_init(&stream_manager->response_latency_histogram);
 
     if (aws_mutex_init(&stream_manager->synced_data.lock)) {
         goto on_error;
     }
-    if (aws_random_access_set_init(
-            &stream_manager->synced_data.ideal_available_set,
-            allocator,
-            aws_hash_ptr,
-            aws_ptr_eq,
-            NULL /* destroy function */,
-            2)) {
+    if (options->coalescing_group && s_coalescing_init(stream_manager, options)) {
         goto on_error;
     }
-    if (aws_random_access_set_init(
-            &stream_manager->synced_data.nonideal_available_set,
-            allocator,
-            aws_hash_ptr,
-            aws_ptr_eq,
-            NULL /* destroy function */,
-            2)) {
+    if (aws_random_access_intrusive_set_init(&stream_manager->synced_data.ideal_available_set, allocator, 2)) {
+        goto on_error;
+    }
+    if (aws_random_access_intrusive_set_init(&stream_manager->synced_data.nonideal_available_set, allocator, 2)) {
         goto on_error;
     }
     aws_ref_count_init(
@@ -1138,6 +2379,8 @@ struct aws_http2_stream_manager *aws_http2_stream_manager_new(
         .num_initial_settings = options->num_initial_settings,
         .max_closed_streams = options->max_closed_streams,
         .http2_conn_manual_window_management = options->conn_manual_window_management,
+        .http2_header_template = options->header_template,
+        .read_window_budget = options->read_window_budget,
     };
     /* aws_http_connection_manager_new needs to be the last thing that can fail */
     stream_manager->connection_manager = aws_http_connection_manager_new(allocator, &cm_options);
@@ -1155,6 +2398,17 @@ struct aws_http2_stream_manager *aws_http2_stream_manager_new(
         options->max_concurrent_streams_per_connection ? options->max_concurrent_streams_per_connection : UINT32_MAX;
     stream_manager->max_connections = options->max_connections;
     stream_manager->close_connection_on_server_error = options->close_connection_on_server_error;
+    stream_manager->connection_selection = options->connection_selection;
+    stream_manager->enable_adaptive_concurrency = options->enable_adaptive_concurrency;
+    stream_manager->hedging_budget_percent = options->hedging_budget_percent;
+    stream_manager->hedge_delay_ns =
+        aws_timestamp_convert(options->hedge_delay_ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+    stream_manager->hedge_latency_percentile = options->hedge_latency_percentile > 0.0
+                                                   ? options->hedge_latency_percentile
+                                                   : AWS_H2SM_HEDGE_DEFAULT_LATENCY_PERCENTILE;
+    if (stream_manager->coalescing.group) {
+        s_coalescing_group_add(stream_manager);
+    }
 
     return stream_manager;
 on_error:
@@ -1179,38 +2433,86 @@ struct aws_http2_stream_manager *aws_http2_stream_manager_release(struct aws_htt
 void aws_http2_stream_manager_acquire_stream(
     struct aws_http2_stream_manager *stream_manager,
     const struct aws_http2_stream_manager_acquire_stream_options *acquire_stream_option) {
+    aws_http2_stream_manager_acquire_streams(stream_manager, acquire_stream_option, 1);
+}
+
+void aws_http2_stream_manager_acquire_streams(
+    struct aws_http2_stream_manager *stream_manager,
+    const struct aws_http2_stream_manager_acquire_stream_options *acquire_stream_options,
+    size_t num_acquisitions) {
     AWS_PRECONDITION(stream_manager);
-    AWS_PRECONDITION(acquire_stream_option);
-    AWS_PRECONDITION(acquire_stream_option->callback);
-    AWS_PRECONDITION(acquire_stream_option->options);
+    AWS_PRECONDITION(acquire_stream_options || num_acquisitions == 0);
+    if (num_acquisitions > 0) {
+        struct aws_http2_stream_manager *coalescing_target = s_acquire_coalescing_target(stream_manager);
+        if (coalescing_target) {
+            STREAM_MANAGER_LOGF(
+                DEBUG,
+                stream_manager,
+                "Stream Manager reuses the connections of stream manager %p for %zu acquisitions",
+                (void *)coalescing_target,
+                num_acquisitions);
+            aws_http2_stream_manager_acquire_streams(coalescing_target, acquire_stream_options, num_acquisitions);
+            aws_http2_stream_manager_release(coalescing_target);
+            return;
+        }
+    }
+    struct aws_linked_list new_acquisitions;
+    aws_linked_list_init(&new_acquisitions);
+    for (size_t i = 0; i < num_acquisitions; ++i) {
+        const struct aws_http2_stream_manager_acquire_stream_options *acquire_stream_option =
+            &acquire_stream_options[i];
+        AWS_PRECONDITION(acquire_stream_option->callback);
+        AWS_PRECONDITION(acquire_stream_option->options);
+        struct aws_h2_sm_pending_stream_acquisition *pending_stream_acquisition = s_new_pending_stream_acquisition(
+            stream_manager->allocator,
+            acquire_stream_option->options,
+            acquire_stream_option->callback,
+            acquire_stream_option->user_data);
+        /* A duplicate can't share a body stream, or the data the user writes */
+        if (acquire_stream_option->allow_hedging && s_is_hedging_enabled(stream_manager) &&
+            !acquire_stream_option->options->http2_use_manual_data_writes &&
+            aws_http_message_get_body_stream(acquire_stream_option->options->request) == NULL) {
+            s_hedge_new(stream_manager, pending_stream_acquisition);
+        }
+        /* The user writes the data of manual writes, so there's nothing to send again */
+        if (acquire_stream_option->replay_buffer_size > 0 && pending_stream_acquisition->hedge_stream == NULL &&
+            !acquire_stream_option->options->http2_use_manual_data_writes) {
+            s_replay_new(pending_stream_acquisition, acquire_stream_option->replay_buffer_size);
+        }
+        STREAM_MANAGER_LOGF(
+            TRACE,
+            stream_manager,
+            "Stream Manager creates acquisition:%p for user",
+            (void *)pending_stream_acquisition);
+        aws_linked_list_push_back(&new_acquisitions, &pending_stream_acquisition->node);
+    }
+    if (num_acquisitions == 0) {
+        return;
+    }
+
     struct aws_http2_stream_management_transaction work;
-    struct aws_h2_sm_pending_stream_acquisition *pending_stream_acquisition = s_new_pending_stream_acquisition(
-        stream_manager->allocator,
-        acquire_stream_option->options,
-        acquire_stream_option->callback,
-        acquire_stream_option->user_data);
-    STREAM_MANAGER_LOGF(
-        TRACE, stream_manager, "Stream Manager creates acquisition:%p for user", (void *)pending_stream_acquisition);
     s_aws_stream_management_transaction_init(&work, stream_manager);
     { /* BEGIN CRITICAL SECTION */
         s_lock_synced_data(stream_manager);
         /* it's use after free crime */
         AWS_FATAL_ASSERT(stream_manager->synced_data.state != AWS_H2SMST_DESTROYING);
-        aws_linked_list_push_back(
-            &stream_manager->synced_data.pending_stream_acquisitions, &pending_stream_acquisition->node);
-        s_sm_count_increase_synced(stream_manager, AWS_SMCT_PENDING_ACQUISITION, 1);
+        aws_linked_list_move_all_back(&stream_manager->synced_data.pending_stream_acquisitions, &new_acquisitions);
+        s_sm_count_increase_synced(stream_manager, AWS_SMCT_PENDING_ACQUISITION, num_acquisitions);
+        stream_manager->synced_data.acquisitions_count += num_acquisitions;
         s_aws_http2_stream_manager_build_transaction_synced(&work);
         s_unlock_synced_data(stream_manager);
     } /* END CRITICAL SECTION */
     s_aws_http2_stream_manager_execute_transaction(&work);
 }
 
-static size_t s_get_available_streams_num_from_connection_set(const struct aws_random_access_set *set) {
+static size_t s_get_available_streams_num_from_connection_set(const struct aws_random_access_intrusive_set *set) {
     size_t all_available_streams_num = 0;
-    size_t ideal_connection_num = aws_random_access_set_get_size(set);
+    size_t ideal_connection_num = aws_random_access_intrusive_set_get_size(set);
     for (size_t i = 0; i < ideal_connection_num; i++) {
-        struct aws_h2_sm_connection *sm_connection = NULL;
-        AWS_FATAL_ASSERT(aws_random_access_set_random_get_ptr_index(set, (void **)&sm_connection, i) == AWS_OP_SUCCESS);
+        struct aws_random_access_set_node *node = NULL;
+        AWS_FATAL_ASSERT(aws_random_access_intrusive_set_get_at_index(set, &node, i) == AWS_OP_SUCCESS);
+        struct aws_h2_sm_connection *sm_connection =
+            AWS_CONTAINER_OF(node, struct aws_h2_sm_connection, available_set_node);
         uint32_t available_streams = sm_connection->max_concurrent_streams - sm_connection->num_streams_assigned;
         all_available_streams_num += (size_t)available_streams;
     }
@@ -1233,6 +2535,35 @@ void aws_http2_stream_manager_fetch_metrics(
             stream_manager->synced_data.internal_refcount_stats[AWS_SMCT_PENDING_ACQUISITION];
         out_metrics->available_concurrency = all_available_streams_num;
         out_metrics->leased_concurrency = stream_manager->synced_data.internal_refcount_stats[AWS_SMCT_OPEN_STREAM];
+        out_metrics->prewarmed_acquires = 0;
         s_unlock_synced_data((struct aws_http2_stream_manager *)(void *)stream_manager);
     } /* END CRITICAL SECTION */
 }
+
+void aws_http2_stream_manager_fetch_latency_metrics(
+    const struct aws_http2_stream_manager *stream_manager,
+    struct aws_http_manager_latency_metrics *out_metrics) {
+    AWS_PRECONDITION(stream_manager);
+    AWS_PRECONDITION(out_metrics);
+
+    /* Connections come from the underlying connection manager, but acquisitions here are for streams */
+    if (stream_manager->connection_manager) {
+        aws_http_connection_manager_fetch_latency_metrics(stream_manager->connection_manager, out_metrics);
+    } else {
+        AWS_ZERO_STRUCT(*out_metrics);
+    }
+    aws_http_atomic_histogram_snapshot(&stream_manager->acquisition_wait_histogram, &out_metrics->acquisition_wait);
+}
+
+void aws_http2_stream_manager_fetch_memory_usage(
+    const struct aws_http2_stream_manager *stream_manager,
+    struct aws_http_connection_memory_usage *out_usage) {
+    AWS_PRECONDITION(stream_manager);
+    AWS_PRECONDITION(out_usage);
+
+    if (stream_manager->connection_manager) {
+        aws_http_connection_manager_fetch_memory_usage(stream_manager->connection_manager, out_usage);
+    } else {
+        AWS_ZERO_STRUCT(*out_usage);
+    }
+}
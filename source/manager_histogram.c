@@ -0,0 +1,116 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/private/manager_histogram.h>
+
+#include <aws/common/clock.h>
+#include <aws/common/math.h>
+
+/*
+ * Values below SUB_BUCKET_COUNT get a bucket each. Above that, every power of 2 is split into SUB_BUCKET_COUNT
+ * equal buckets, so a bucket is never wider than 1/SUB_BUCKET_COUNT of its lower bound.
+ */
+#define SUB_BUCKET_BITS 3
+#define SUB_BUCKET_COUNT (1 << SUB_BUCKET_BITS)
+#define MAX_VALUE_BITS 36
+
+AWS_STATIC_ASSERT(
+    AWS_HTTP_MANAGER_HISTOGRAM_BUCKET_COUNT == (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT);
+
+static size_t s_bucket_index(uint64_t value_us) {
+    if (value_us < SUB_BUCKET_COUNT) {
+        return (size_t)value_us;
+    }
+    if (value_us >= (1ULL << MAX_VALUE_BITS)) {
+        return AWS_HTTP_MANAGER_HISTOGRAM_BUCKET_COUNT - 1;
+    }
+
+    size_t msb = 63 - aws_clz_u64(value_us);
+    size_t shift = msb - SUB_BUCKET_BITS;
+    /* (value_us >> shift) is in [SUB_BUCKET_COUNT, 2 * SUB_BUCKET_COUNT) */
+    return shift * SUB_BUCKET_COUNT + (size_t)(value_us >> shift);
+}
+
+uint64_t aws_http_manager_histogram_get_bucket_lower_bound(size_t bucket_index) {
+    AWS_PRECONDITION(bucket_index < AWS_HTTP_MANAGER_HISTOGRAM_BUCKET_COUNT);
+
+    if (bucket_index < SUB_BUCKET_COUNT) {
+        return bucket_index;
+    }
+
+    size_t shift = bucket_index / SUB_BUCKET_COUNT - 1;
+    uint64_t mantissa = bucket_index % SUB_BUCKET_COUNT + SUB_BUCKET_COUNT;
+    return mantissa << shift;
+}
+
+uint64_t aws_http_manager_histogram_get_percentile(
+    const struct aws_http_manager_histogram *histogram,
+    double percentile) {
+    AWS_PRECONDITION(histogram);
+
+    if (histogram->count == 0) {
+        return 0;
+    }
+
+    if (percentile < 0.0) {
+        percentile = 0.0;
+    } else if (percentile > 100.0) {
+        percentile = 100.0;
+    }
+
+    /* The rank of the record the percentile falls on, counting from 1 (nearest-rank method) */
+    double exact_rank = percentile / 100.0 * (double)histogram->count;
+    uint64_t rank = (uint64_t)exact_rank;
+    if ((double)rank < exact_rank) {
+        ++rank;
+    }
+    if (rank == 0) {
+        rank = 1;
+    } else if (rank > histogram->count) {
+        rank = histogram->count;
+    }
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < AWS_HTTP_MANAGER_HISTOGRAM_BUCKET_COUNT; ++i) {
+        seen += histogram->buckets[i];
+        if (seen >= rank) {
+            if (i + 1 == AWS_HTTP_MANAGER_HISTOGRAM_BUCKET_COUNT) {
+                return aws_http_manager_histogram_get_bucket_lower_bound(i);
+            }
+            return aws_http_manager_histogram_get_bucket_lower_bound(i + 1) - 1;
+        }
+    }
+
+    return aws_http_manager_histogram_get_bucket_lower_bound(AWS_HTTP_MANAGER_HISTOGRAM_BUCKET_COUNT - 1);
+}
+
+void aws_http_atomic_histogram_init(struct aws_http_atomic_histogram *histogram) {
+    for (size_t i = 0; i < AWS_HTTP_MANAGER_HISTOGRAM_BUCKET_COUNT; ++i) {
+        aws_atomic_init_int(&histogram->buckets[i], 0);
+    }
+    aws_atomic_init_int(&histogram->sum_us, 0);
+}
+
+void aws_http_atomic_histogram_record(struct aws_http_atomic_histogram *histogram, uint64_t start_ns, uint64_t end_ns) {
+    uint64_t duration_us = 0;
+    if (end_ns > start_ns) {
+        duration_us = aws_timestamp_convert(end_ns - start_ns, AWS_TIMESTAMP_NANOS, AWS_TIMESTAMP_MICROS, NULL);
+    }
+
+    aws_atomic_fetch_add_explicit(&histogram->buckets[s_bucket_index(duration_us)], 1, aws_memory_order_relaxed);
+    aws_atomic_fetch_add_explicit(&histogram->sum_us, (size_t)duration_us, aws_memory_order_relaxed);
+}
+
+void aws_http_atomic_histogram_snapshot(
+    const struct aws_http_atomic_histogram *histogram,
+    struct aws_http_manager_histogram *out_histogram) {
+
+    AWS_ZERO_STRUCT(*out_histogram);
+    for (size_t i = 0; i < AWS_HTTP_MANAGER_HISTOGRAM_BUCKET_COUNT; ++i) {
+        out_histogram->buckets[i] = aws_atomic_load_int_explicit(&histogram->buckets[i], aws_memory_order_relaxed);
+        out_histogram->count += out_histogram->buckets[i];
+    }
+    out_histogram->sum_us = aws_atomic_load_int_explicit(&histogram->sum_us, aws_memory_order_relaxed);
+}
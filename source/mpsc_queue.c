@@ -0,0 +1,65 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/private/mpsc_queue.h>
+
+/* Head is set to this once the queue is closed. Never dereferenced */
+static struct aws_linked_list_node s_closed_sentinel;
+
+void aws_http_mpsc_queue_init(struct aws_http_mpsc_queue *queue) {
+    aws_atomic_init_ptr(&queue->head, NULL);
+}
+
+bool aws_http_mpsc_queue_push(struct aws_http_mpsc_queue *queue, struct aws_linked_list_node *node) {
+    /* Nodes are only ever removed all at once, by exchanging the head, so there's no ABA problem */
+    void *head = aws_atomic_load_ptr(&queue->head);
+    do {
+        if (head == &s_closed_sentinel) {
+            return false;
+        }
+        node->next = head;
+    } while (!aws_atomic_compare_exchange_ptr(&queue->head, &head, node));
+
+    return true;
+}
+
+/* The nodes are linked newest to oldest, push each to the front of a list to put them back in order */
+static void s_move_nodes(struct aws_linked_list_node *newest, struct aws_linked_list *out_list) {
+    struct aws_linked_list ordered;
+    aws_linked_list_init(&ordered);
+
+    struct aws_linked_list_node *node = newest;
+    while (node) {
+        struct aws_linked_list_node *older = node->next;
+        aws_linked_list_push_front(&ordered, node);
+        node = older;
+    }
+
+    aws_linked_list_move_all_back(out_list, &ordered);
+}
+
+void aws_http_mpsc_queue_drain(struct aws_http_mpsc_queue *queue, struct aws_linked_list *out_list) {
+    /* Cheap check first, so an empty drain doesn't write to the shared cache line */
+    void *head = aws_atomic_load_ptr(&queue->head);
+    if (head == NULL || head == &s_closed_sentinel) {
+        return;
+    }
+
+    head = aws_atomic_exchange_ptr(&queue->head, NULL);
+    s_move_nodes(head, out_list);
+}
+
+void aws_http_mpsc_queue_close(struct aws_http_mpsc_queue *queue, struct aws_linked_list *out_list) {
+    void *head = aws_atomic_exchange_ptr(&queue->head, &s_closed_sentinel);
+    if (head == &s_closed_sentinel) {
+        return;
+    }
+    s_move_nodes(head, out_list);
+}
+
+bool aws_http_mpsc_queue_is_empty(const struct aws_http_mpsc_queue *queue) {
+    void *head = aws_atomic_load_ptr(&queue->head);
+    return head == NULL || head == &s_closed_sentinel;
+}
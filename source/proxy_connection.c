@@ -11,6 +11,7 @@
 #include <aws/common/string.h>
 #include <aws/http/connection_manager.h>
 #include <aws/http/private/connection_impl.h>
+#include <aws/http/private/strutil.h>
 #include <aws/http/proxy.h>
 #include <aws/http/request_response.h>
 #include <aws/io/channel.h>
@@ -76,6 +77,7 @@ void aws_http_proxy_user_data_destroy(struct aws_http_proxy_user_data *user_data
     aws_http_proxy_negotiator_release(user_data->proxy_negotiator);
 
     aws_client_bootstrap_release(user_data->original_bootstrap);
+    aws_http_connection_memory_tracker_release(user_data->memory_tracker);
 
     aws_mem_release(user_data->allocator, user_data);
 }
@@ -164,6 +166,7 @@ struct aws_http_proxy_user_data *aws_http_proxy_user_data_new(
     user_data->requested_event_loop = options.requested_event_loop;
     user_data->host_resolution_config = options.host_resolution_config;
     user_data->prior_knowledge_http2 = options.prior_knowledge_http2;
+    user_data->memory_tracker = aws_http_connection_memory_tracker_acquire(options.memory_tracker);
 
     /* one and only one setup callback must be valid */
     AWS_FATAL_ASSERT((user_data->original_http_on_setup == NULL) != (user_data->original_channel_on_setup == NULL));
@@ -271,6 +274,7 @@ struct aws_http_proxy_user_data *aws_http_proxy_user_data_new_reset_clone(
     user_data->original_user_data = old_user_data->original_user_data;
     user_data->original_http1_options = old_user_data->original_http1_options;
     user_data->original_http2_options = old_user_data->original_http2_options;
+    user_data->memory_tracker = aws_http_connection_memory_tracker_acquire(old_user_data->memory_tracker);
 
     /* keep a copy of the settings array if it's not NULL */
     if (old_user_data->original_http2_options.num_initial_settings > 0) {
@@ -545,6 +549,40 @@ static int s_aws_http_on_incoming_body_tunnel_proxy(
     return AWS_OP_SUCCESS;
 }
 
+/*
+ * Keep-Alive: timeout=5, max=100
+ * An idle tunnel may be closed by the proxy once its timeout passes, so the connection manager culls it first.
+ * Returns 0 if there's no valid timeout.
+ */
+static uint64_t s_get_keep_alive_timeout_ms(struct aws_byte_cursor value) {
+    struct aws_byte_cursor parameter;
+    AWS_ZERO_STRUCT(parameter);
+    while (aws_byte_cursor_next_split(&value, ',', &parameter)) {
+        struct aws_byte_cursor name;
+        AWS_ZERO_STRUCT(name);
+        aws_byte_cursor_next_split(&parameter, '=', &name);
+        if (name.len == parameter.len) {
+            /* No '=' */
+            continue;
+        }
+
+        struct aws_byte_cursor seconds_str = parameter;
+        aws_byte_cursor_advance(&seconds_str, name.len + 1);
+        name = aws_strutil_trim_http_whitespace(name);
+        if (!aws_byte_cursor_eq_c_str_ignore_case(&name, "timeout")) {
+            continue;
+        }
+
+        uint64_t seconds = 0;
+        if (aws_byte_cursor_utf8_parse_u64(aws_strutil_trim_http_whitespace(seconds_str), &seconds)) {
+            return 0;
+        }
+        return aws_mul_u64_saturating(seconds, 1000);
+    }
+
+    return 0;
+}
+
 static int s_aws_http_on_response_headers_tunnel_proxy(
     struct aws_http_stream *stream,
     enum aws_http_header_block header_block,
@@ -554,6 +592,14 @@ static int s_aws_http_on_response_headers_tunnel_proxy(
     (void)stream;
 
     struct aws_http_proxy_user_data *context = user_data;
+    if (header_block == AWS_HTTP_HEADER_BLOCK_MAIN) {
+        for (size_t i = 0; i < num_headers; ++i) {
+            if (aws_byte_cursor_eq_c_str_ignore_case(&header_array[i].name, "keep-alive")) {
+                context->connect_keep_alive_timeout_ms = s_get_keep_alive_timeout_ms(header_array[i].value);
+            }
+        }
+    }
+
     aws_http_proxy_negotiation_connect_on_incoming_headers_fn *on_incoming_headers =
         context->proxy_negotiator->strategy_vtable.tunnelling_vtable->on_incoming_headers_callback;
     if (on_incoming_headers != NULL) {
@@ -613,7 +659,8 @@ static int s_aws_http_apply_http_connection_to_proxied_channel(struct aws_http_p
         context->alpn_string_map.p_impl == NULL ? NULL : &context->alpn_string_map,
         &context->original_http1_options,
         &context->original_http2_options,
-        context->original_user_data);
+        context->original_user_data,
+        context->memory_tracker);
     if (connection == NULL) {
         AWS_LOGF_ERROR(
             AWS_LS_HTTP_CONNECTION,
@@ -630,6 +677,7 @@ static int s_aws_http_apply_http_connection_to_proxied_channel(struct aws_http_p
         (void *)connection,
         AWS_BYTE_CURSOR_PRI(aws_http_version_to_str(connection->http_version)));
 
+    connection->proxy_keep_alive_timeout_ms = context->connect_keep_alive_timeout_ms;
     context->final_connection = connection;
 
     return AWS_OP_SUCCESS;
@@ -846,6 +894,8 @@ static int s_make_proxy_connect_request(struct aws_http_proxy_user_data *user_da
         user_data->connect_request = NULL;
     }
 
+    /* A retried CONNECT mustn't keep what the rejected one's response said */
+    user_data->connect_keep_alive_timeout_ms = 0;
     user_data->connect_request = s_build_proxy_connect_request(user_data);
     if (user_data->connect_request == NULL) {
         return AWS_OP_ERR;
@@ -1051,6 +1101,7 @@ static int s_aws_http_client_connect_via_forwarding_proxy(const struct aws_http_
     options_copy.requested_event_loop = options->requested_event_loop;
     options_copy.host_resolution_config = options->host_resolution_config;
     options_copy.prior_knowledge_http2 = false; /* ToDo, expose the protocol specific config for proxy connection. */
+    options_copy.http2_upgrade = false;
 
     int result = aws_http_client_connect_internal(&options_copy, s_proxy_http_request_transform);
     if (result == AWS_OP_ERR) {
@@ -5,6 +5,7 @@
 
 #include <aws/http/proxy.h>
 
+#include <aws/common/atomics.h>
 #include <aws/common/encoding.h>
 #include <aws/common/string.h>
 #include <aws/http/private/proxy_impl.h>
@@ -1347,18 +1348,31 @@ done:
 
 /******************************************************************************************************************/
 
+/*
+ * Every connection made with the strategy (all of a connection manager's, for example) starts over from the same
+ * sequence, so each would pay for the same failed attempts, a 407 round trip (or a whole connection) apiece, before
+ * reaching the strategy that works. Instead, the sequence remembers where the last successful negotiation started,
+ * and new negotiators try the strategies from there, wrapping around to the ones before it if that stops working.
+ */
 struct aws_http_proxy_strategy_tunneling_sequence {
     struct aws_allocator *allocator;
 
     struct aws_array_list strategies;
 
+    /* Index of the strategy the last successful negotiation started with. Shared by negotiators on any thread */
+    struct aws_atomic_var start_index;
+
     struct aws_http_proxy_strategy strategy_base;
 };
 
 struct aws_http_proxy_negotiator_tunneling_sequence {
     struct aws_allocator *allocator;
 
+    struct aws_http_proxy_strategy *strategy;
+
+    /* The strategies' negotiators, in the order they're tried: negotiators[i] is for strategy (start_index + i) % n */
     struct aws_array_list negotiators;
+    size_t start_index;
     size_t current_negotiator_transform_index;
     void *original_internal_proxy_user_data;
     aws_http_proxy_negotiation_terminate_fn *original_negotiation_termination_callback;
@@ -1491,6 +1505,27 @@ static int s_sequence_on_connect_status(
         }
     }
 
+    if (status_code == AWS_HTTP_STATUS_CODE_200_OK && sequence_negotiator->current_negotiator_transform_index > 0) {
+        /*
+         * Remember where the winning attempt started. A negotiator that retries on the current connection carries
+         * on the exchange of the one before it (ntlm answering the challenge the ntlm credential attempt got),
+         * so it can't go first.
+         */
+        size_t position = sequence_negotiator->current_negotiator_transform_index - 1;
+        while (position > 0) {
+            struct aws_http_proxy_negotiator *negotiator = NULL;
+            aws_array_list_get_at(&sequence_negotiator->negotiators, &negotiator, position);
+            if (aws_http_proxy_negotiator_get_retry_directive(negotiator) != AWS_HPNRD_CURRENT_CONNECTION) {
+                break;
+            }
+            --position;
+        }
+
+        struct aws_http_proxy_strategy_tunneling_sequence *sequence_strategy = sequence_negotiator->strategy->impl;
+        aws_atomic_store_int(
+            &sequence_strategy->start_index, (sequence_negotiator->start_index + position) % negotiator_count);
+    }
+
     return AWS_OP_SUCCESS;
 }
 
@@ -1563,6 +1598,8 @@ static void s_destroy_tunneling_sequence_negotiator(struct aws_http_proxy_negoti
 
     aws_array_list_clean_up(&sequence_negotiator->negotiators);
 
+    aws_http_proxy_strategy_release(sequence_negotiator->strategy);
+
     aws_mem_release(sequence_negotiator->allocator, sequence_negotiator);
 }
 
@@ -1590,8 +1627,11 @@ static struct aws_http_proxy_negotiator *s_create_tunneling_sequence_negotiator(
     sequence_negotiator->negotiator_base.strategy_vtable.tunnelling_vtable =
         &s_tunneling_sequence_proxy_negotiator_tunneling_vtable;
 
+    sequence_negotiator->strategy = aws_http_proxy_strategy_acquire(proxy_strategy);
+
     struct aws_http_proxy_strategy_tunneling_sequence *sequence_strategy = proxy_strategy->impl;
     size_t strategy_count = aws_array_list_length(&sequence_strategy->strategies);
+    sequence_negotiator->start_index = aws_atomic_load_int(&sequence_strategy->start_index);
 
     if (aws_array_list_init_dynamic(
             &sequence_negotiator->negotiators, allocator, strategy_count, sizeof(struct aws_http_proxy_negotiator *))) {
@@ -1600,7 +1640,8 @@ static struct aws_http_proxy_negotiator *s_create_tunneling_sequence_negotiator(
 
     for (size_t i = 0; i < strategy_count; ++i) {
         struct aws_http_proxy_strategy *strategy = NULL;
-        if (aws_array_list_get_at(&sequence_strategy->strategies, &strategy, i)) {
+        if (aws_array_list_get_at(
+                &sequence_strategy->strategies, &strategy, (sequence_negotiator->start_index + i) % strategy_count)) {
             goto on_error;
         }
 
@@ -1665,6 +1706,7 @@ struct aws_http_proxy_strategy *aws_http_proxy_strategy_new_tunneling_sequence(
     sequence_strategy->strategy_base.vtable = &s_tunneling_sequence_strategy_vtable;
     sequence_strategy->strategy_base.proxy_connection_type = AWS_HPCT_HTTP_TUNNEL;
     sequence_strategy->allocator = allocator;
+    aws_atomic_init_int(&sequence_strategy->start_index, 0);
 
     aws_ref_count_init(
         &sequence_strategy->strategy_base.ref_count,
@@ -185,3 +185,102 @@ int aws_random_access_set_random_get_ptr_index(const struct aws_random_access_se
     AWS_PRECONDITION(out != NULL);
     return aws_array_list_get_at(&set->impl->list, (void *)out, index);
 }
+
+int aws_random_access_intrusive_set_init(
+    struct aws_random_access_intrusive_set *set,
+    struct aws_allocator *allocator,
+    size_t initial_item_allocation) {
+    AWS_FATAL_PRECONDITION(set);
+    AWS_FATAL_PRECONDITION(allocator);
+
+    return aws_array_list_init_dynamic(
+        &set->list, allocator, initial_item_allocation, sizeof(struct aws_random_access_set_node *));
+}
+
+void aws_random_access_intrusive_set_clean_up(struct aws_random_access_intrusive_set *set) {
+    if (!set) {
+        return;
+    }
+    aws_array_list_clean_up(&set->list);
+}
+
+int aws_random_access_intrusive_set_add(
+    struct aws_random_access_intrusive_set *set,
+    struct aws_random_access_set_node *node,
+    bool *added) {
+    AWS_PRECONDITION(set);
+    AWS_PRECONDITION(node);
+    AWS_PRECONDITION(added);
+    *added = false;
+    if (node->set == set) {
+        return AWS_OP_SUCCESS;
+    }
+    if (node->set != NULL) {
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+    }
+    if (aws_array_list_push_back(&set->list, (void *)&node)) {
+        return AWS_OP_ERR;
+    }
+    node->set = set;
+    node->index = aws_array_list_length(&set->list) - 1;
+    *added = true;
+    return AWS_OP_SUCCESS;
+}
+
+void aws_random_access_intrusive_set_remove(
+    struct aws_random_access_intrusive_set *set,
+    struct aws_random_access_set_node *node) {
+    AWS_PRECONDITION(set);
+    AWS_PRECONDITION(node);
+    if (node->set != set) {
+        /* It's removed already */
+        return;
+    }
+
+    size_t last_index = aws_array_list_length(&set->list) - 1;
+    AWS_ASSERT(node->index <= last_index);
+    if (node->index != last_index) {
+        /* Move the last node to the place of the one removed */
+        struct aws_random_access_set_node *last_node = NULL;
+        aws_array_list_get_at(&set->list, (void *)&last_node, last_index);
+        last_node->index = node->index;
+        aws_array_list_set_at(&set->list, (void *)&last_node, node->index);
+    }
+    aws_array_list_pop_back(&set->list);
+    node->set = NULL;
+    node->index = 0;
+}
+
+int aws_random_access_intrusive_set_random_get(
+    const struct aws_random_access_intrusive_set *set,
+    struct aws_random_access_set_node **out) {
+    AWS_PRECONDITION(set);
+    AWS_PRECONDITION(out != NULL);
+    size_t length = aws_array_list_length(&set->list);
+    if (length == 0) {
+        return aws_raise_error(AWS_ERROR_LIST_EMPTY);
+    }
+
+    uint64_t random_64_bit_num = 0;
+    aws_device_random_u64(&random_64_bit_num);
+    return aws_array_list_get_at(&set->list, (void *)out, (size_t)(random_64_bit_num % length));
+}
+
+int aws_random_access_intrusive_set_get_at_index(
+    const struct aws_random_access_intrusive_set *set,
+    struct aws_random_access_set_node **out,
+    size_t index) {
+    AWS_PRECONDITION(set);
+    AWS_PRECONDITION(out != NULL);
+    return aws_array_list_get_at(&set->list, (void *)out, index);
+}
+
+size_t aws_random_access_intrusive_set_get_size(const struct aws_random_access_intrusive_set *set) {
+    return aws_array_list_length(&set->list);
+}
+
+bool aws_random_access_intrusive_set_contains(
+    const struct aws_random_access_intrusive_set *set,
+    const struct aws_random_access_set_node *node) {
+    return node->set == set;
+}
@@ -0,0 +1,189 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/private/replay_body.h>
+
+#include <aws/http/request_response.h>
+#include <aws/io/logging.h>
+#include <aws/io/stream.h>
+
+/* Input stream that reads the source body stream, and keeps the start of it to read again */
+struct aws_http_replay_body_stream {
+    struct aws_input_stream base;
+    struct aws_allocator *allocator;
+    struct aws_input_stream *source;
+    /* The first bytes read from the source, up to the buffer's capacity */
+    struct aws_byte_buf replay_buf;
+    /* How much of replay_buf has been read since the last seek. Reads go to the source once it's all read */
+    size_t replay_offset;
+    /* More was read from the source than replay_buf could keep, so there's no going back to the start */
+    bool is_exceeded;
+};
+
+static int s_replay_body_seek(struct aws_input_stream *stream, int64_t offset, enum aws_stream_seek_basis basis) {
+    struct aws_http_replay_body_stream *replay_stream =
+        AWS_CONTAINER_OF(stream, struct aws_http_replay_body_stream, base);
+
+    if (offset != 0 || basis != AWS_SSB_BEGIN) {
+        return aws_raise_error(AWS_ERROR_UNSUPPORTED_OPERATION);
+    }
+
+    if (replay_stream->is_exceeded) {
+        AWS_LOGF_DEBUG(
+            AWS_LS_HTTP_STREAM,
+            "id=%p: Cannot replay request body, more than the %zu bytes kept was sent.",
+            (void *)stream,
+            replay_stream->replay_buf.capacity);
+        return aws_raise_error(AWS_IO_STREAM_SEEK_UNSUPPORTED);
+    }
+
+    replay_stream->replay_offset = 0;
+    return AWS_OP_SUCCESS;
+}
+
+static int s_replay_body_read(struct aws_input_stream *stream, struct aws_byte_buf *dest) {
+    struct aws_http_replay_body_stream *replay_stream =
+        AWS_CONTAINER_OF(stream, struct aws_http_replay_body_stream, base);
+
+    /* Whatever was kept goes first */
+    if (replay_stream->replay_offset < replay_stream->replay_buf.len) {
+        struct aws_byte_cursor kept = aws_byte_cursor_from_buf(&replay_stream->replay_buf);
+        aws_byte_cursor_advance(&kept, replay_stream->replay_offset);
+        struct aws_byte_cursor written = aws_byte_buf_write_to_capacity(dest, &kept);
+        replay_stream->replay_offset += written.len;
+        if (replay_stream->replay_offset < replay_stream->replay_buf.len) {
+            return AWS_OP_SUCCESS;
+        }
+    }
+
+    const size_t prev_dest_len = dest->len;
+    if (aws_input_stream_read(replay_stream->source, dest)) {
+        return AWS_OP_ERR;
+    }
+
+    /* Keep what fits of the new data */
+    struct aws_byte_cursor fresh = aws_byte_cursor_from_array(dest->buffer + prev_dest_len, dest->len - prev_dest_len);
+    struct aws_byte_cursor kept = aws_byte_buf_write_to_capacity(&replay_stream->replay_buf, &fresh);
+    replay_stream->replay_offset += kept.len;
+    if (fresh.len > 0) {
+        replay_stream->is_exceeded = true;
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+static int s_replay_body_get_status(struct aws_input_stream *stream, struct aws_stream_status *status) {
+    struct aws_http_replay_body_stream *replay_stream =
+        AWS_CONTAINER_OF(stream, struct aws_http_replay_body_stream, base);
+
+    if (aws_input_stream_get_status(replay_stream->source, status)) {
+        return AWS_OP_ERR;
+    }
+
+    /* The source may be done, but not the replay of it */
+    if (replay_stream->replay_offset < replay_stream->replay_buf.len) {
+        status->is_end_of_stream = false;
+    }
+    return AWS_OP_SUCCESS;
+}
+
+static int s_replay_body_get_length(struct aws_input_stream *stream, int64_t *out_length) {
+    struct aws_http_replay_body_stream *replay_stream =
+        AWS_CONTAINER_OF(stream, struct aws_http_replay_body_stream, base);
+
+    return aws_input_stream_get_length(replay_stream->source, out_length);
+}
+
+static void s_replay_body_destroy(void *user_data) {
+    struct aws_http_replay_body_stream *replay_stream = user_data;
+
+    aws_input_stream_release(replay_stream->source);
+    aws_byte_buf_clean_up(&replay_stream->replay_buf);
+    aws_mem_release(replay_stream->allocator, replay_stream);
+}
+
+static struct aws_input_stream_vtable s_replay_body_vtable = {
+    .seek = s_replay_body_seek,
+    .read = s_replay_body_read,
+    .get_status = s_replay_body_get_status,
+    .get_length = s_replay_body_get_length,
+};
+
+static struct aws_input_stream *s_replay_body_new(
+    struct aws_allocator *allocator,
+    struct aws_input_stream *source,
+    size_t replay_buffer_size) {
+
+    /* No need for more buffer than there is body */
+    int64_t length = 0;
+    if (aws_input_stream_get_length(source, &length) == AWS_OP_SUCCESS && length >= 0 &&
+        (uint64_t)length < replay_buffer_size) {
+        replay_buffer_size = (size_t)length;
+    }
+
+    struct aws_http_replay_body_stream *replay_stream =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_http_replay_body_stream));
+    replay_stream->allocator = allocator;
+    if (aws_byte_buf_init(&replay_stream->replay_buf, allocator, replay_buffer_size)) {
+        aws_mem_release(allocator, replay_stream);
+        return NULL;
+    }
+
+    replay_stream->source = aws_input_stream_acquire(source);
+    replay_stream->base.vtable = &s_replay_body_vtable;
+    aws_ref_count_init(&replay_stream->base.ref_count, replay_stream, s_replay_body_destroy);
+    return &replay_stream->base;
+}
+
+struct aws_http_message *aws_http_replay_body_new_request(
+    struct aws_allocator *allocator,
+    struct aws_http_message *request,
+    size_t replay_buffer_size) {
+
+    AWS_PRECONDITION(aws_http_message_get_body_stream(request));
+
+    struct aws_input_stream *body_stream = NULL;
+    const bool is_http2 = aws_http_message_get_protocol_version(request) == AWS_HTTP_VERSION_2;
+    struct aws_http_message *replay_request =
+        is_http2 ? aws_http2_message_new_request(allocator) : aws_http_message_new_request(allocator);
+    if (!replay_request) {
+        return NULL;
+    }
+
+    /* HTTP/2 requests carry the method and path as pseudo-headers, which are copied below */
+    if (!is_http2) {
+        struct aws_byte_cursor method;
+        struct aws_byte_cursor path;
+        if (aws_http_message_get_request_method(request, &method) ||
+            aws_http_message_set_request_method(replay_request, method) ||
+            aws_http_message_get_request_path(request, &path) ||
+            aws_http_message_set_request_path(replay_request, path)) {
+            goto error;
+        }
+    }
+
+    struct aws_http_headers *headers = aws_http_message_get_headers(request);
+    const size_t header_count = aws_http_headers_count(headers);
+    for (size_t i = 0; i < header_count; ++i) {
+        struct aws_http_header header;
+        aws_http_headers_get_index(headers, i, &header);
+        if (aws_http_message_add_header(replay_request, header)) {
+            goto error;
+        }
+    }
+
+    body_stream = s_replay_body_new(allocator, aws_http_message_get_body_stream(request), replay_buffer_size);
+    if (!body_stream) {
+        goto error;
+    }
+    aws_http_message_set_body_stream(replay_request, body_stream);
+    aws_input_stream_release(body_stream);
+
+    return replay_request;
+
+error:
+    aws_http_message_release(replay_request);
+    return NULL;
+}
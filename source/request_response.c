@@ -4,9 +4,15 @@
  */
 
 #include <aws/common/array_list.h>
+#include <aws/common/clock.h>
+#include <aws/common/hash_table.h>
+#include <aws/common/linked_list.h>
+#include <aws/common/math.h>
 #include <aws/common/mutex.h>
 #include <aws/common/string.h>
 #include <aws/http/private/connection_impl.h>
+#include <aws/http/private/content_decoding_impl.h>
+#include <aws/http/private/content_encoding_impl.h>
 #include <aws/http/private/request_response_impl.h>
 #include <aws/http/private/strutil.h>
 #include <aws/http/server.h>
@@ -21,6 +27,15 @@
 enum {
     /* Initial capacity for the aws_http_message.headers array_list. */
     AWS_HTTP_REQUEST_NUM_RESERVED_HEADERS = 16,
+
+    /* Minimum size of each block in aws_http_headers' string arena. */
+    AWS_HTTP_HEADERS_STRING_BLOCK_SIZE = 1024,
+
+    /* Bytes of name + value to reserve per header, when sizing the first block from a capacity hint. */
+    AWS_HTTP_HEADERS_ESTIMATED_STRING_LEN = 64,
+
+    /* Once aws_http_headers holds this many headers, lookups by name use an index instead of scanning. */
+    AWS_HTTP_HEADERS_INDEX_THRESHOLD = 16,
 };
 
 bool aws_http_header_name_eq(struct aws_byte_cursor name_a, struct aws_byte_cursor name_b) {
@@ -33,18 +48,275 @@ bool aws_http_header_name_eq(struct aws_byte_cursor name_a, struct aws_byte_curs
  * The linear array was simpler to implement and may be faster due to having fewer allocations.
  * The API has been designed so we can swap out the implementation later if desired.
  *
+ * -- Name Index Notes --
+ * Scanning is fine for small collections, but callers like signers look up every header by name,
+ * which goes O(n^2) on requests with many headers. Once a collection reaches AWS_HTTP_HEADERS_INDEX_THRESHOLD,
+ * we build a case-insensitive index from each name to its first position in the array and its number of occurrences.
+ * The index is kept up to date as headers are added and erased, rather than rebuilt.
+ * It's only modified by calls that modify the headers, so const lookups remain safe to call concurrently.
+ * If the index ever fails to allocate, it's dropped and lookups go back to scanning.
+ *
+ * -- Layering Notes --
+ * A headers object may be layered over a shared base (see aws_http_headers_new_layered()).
+ * Its contents are all of the base's headers, followed by its own. Reads look through to the base.
+ * Adding headers only touches the top layer. Anything that would change the base's headers
+ * (erasing or replacing them, or inserting a pseudo-header in front of them) first copies the base's headers
+ * into the top layer and lets go of the base, so the base is never modified.
+ *
  * -- String Storage Notes --
- * We use a single allocation to hold the name and value of each aws_http_header.
- * We could optimize storage by using something like a string pool. If we do this, be sure to maintain
- * the address of existing strings when adding new strings (a dynamic aws_byte_buf would not suffice).
+ * The name and value of each aws_http_header are stored together in an arena of blocks.
+ * Strings never move once added, since users may hold cursors to them (or pass them back in, see set()).
+ * Each entry is prefixed with a pointer to its block, and each block counts its live entries.
+ * When a block's last entry is erased, the block is freed (or rewound, if it's the one we're filling),
+ * so churn from erase() and set() doesn't grow memory without bound.
  */
+struct aws_http_headers_string_block {
+    struct aws_linked_list_node node;
+    size_t capacity;
+    size_t len;
+    size_t live_count;
+    /* data follows */
+};
+
 struct aws_http_headers {
     struct aws_allocator *alloc;
     struct aws_array_list array_list; /* Contains aws_http_header */
     struct aws_atomic_var refcount;
+
+    /* aws_http_headers_string_block, last one is being filled */
+    struct aws_linked_list string_blocks;
+    size_t string_block_size;
+
+    /* Key is aws_byte_cursor* (ignore case), value is aws_http_headers_index_entry*. Only valid if has_name_index */
+    struct aws_hash_table name_index;
+    bool has_name_index;
+
+    /* If set, these headers come before those in array_list. Never modified through this object. */
+    struct aws_http_headers *base;
 };
 
+struct aws_http_headers_index_entry {
+    /* Name of the header at `first`, this is the key's storage */
+    struct aws_byte_cursor name;
+    size_t first;
+    size_t count;
+};
+
+/* Number of headers in the top layer (array_list), not counting any base */
+static size_t s_own_count(const struct aws_http_headers *headers) {
+    return aws_array_list_length(&headers->array_list);
+}
+
+static uint8_t *s_string_block_data(struct aws_http_headers_string_block *block) {
+    return (uint8_t *)(block + 1);
+}
+
+/* Returns storage for len bytes, with a stable address until s_headers_string_release() */
+static uint8_t *s_headers_string_acquire(struct aws_http_headers *headers, size_t len) {
+    const size_t align = sizeof(void *);
+    size_t entry_len;
+    if (aws_add_size_checked(len, sizeof(struct aws_http_headers_string_block *) + align - 1, &entry_len)) {
+        return NULL;
+    }
+    entry_len &= ~(align - 1);
+
+    struct aws_http_headers_string_block *block = NULL;
+    if (!aws_linked_list_empty(&headers->string_blocks)) {
+        block = AWS_CONTAINER_OF(
+            aws_linked_list_back(&headers->string_blocks), struct aws_http_headers_string_block, node);
+        if (block->capacity - block->len < entry_len) {
+            if (block->live_count == 0) {
+                /* Empty block is too small for this entry, don't hold onto it */
+                aws_linked_list_remove(&block->node);
+                aws_mem_release(headers->alloc, block);
+            }
+            block = NULL;
+        }
+    }
+
+    if (block == NULL) {
+        size_t capacity = aws_max_size(entry_len, headers->string_block_size);
+        size_t alloc_size;
+        if (aws_add_size_checked(capacity, sizeof(struct aws_http_headers_string_block), &alloc_size)) {
+            return NULL;
+        }
+        block = aws_mem_acquire(headers->alloc, alloc_size);
+        if (!block) {
+            return NULL;
+        }
+        block->capacity = capacity;
+        block->len = 0;
+        block->live_count = 0;
+        aws_linked_list_push_back(&headers->string_blocks, &block->node);
+
+        /* Only the first block is sized by the capacity hint */
+        headers->string_block_size = AWS_HTTP_HEADERS_STRING_BLOCK_SIZE;
+    }
+
+    uint8_t *entry = s_string_block_data(block) + block->len;
+    block->len += entry_len;
+    block->live_count++;
+    memcpy(entry, &block, sizeof(block));
+    return entry + sizeof(block);
+}
+
+static void s_headers_string_release(struct aws_http_headers *headers, uint8_t *strmem) {
+    struct aws_http_headers_string_block *block = NULL;
+    memcpy(&block, strmem - sizeof(block), sizeof(block));
+    AWS_ASSERT(block->live_count > 0);
+
+    if (--block->live_count > 0) {
+        return;
+    }
+
+    if (&block->node == aws_linked_list_back(&headers->string_blocks)) {
+        /* Keep the block we're filling, but start over at the beginning */
+        block->len = 0;
+    } else {
+        aws_linked_list_remove(&block->node);
+        aws_mem_release(headers->alloc, block);
+    }
+}
+
+static void s_name_index_drop(struct aws_http_headers *headers) {
+    if (!headers->has_name_index) {
+        return;
+    }
+
+    for (struct aws_hash_iter iter = aws_hash_iter_begin(&headers->name_index); !aws_hash_iter_done(&iter);
+         aws_hash_iter_next(&iter)) {
+        aws_mem_release(headers->alloc, iter.element.value);
+    }
+    aws_hash_table_clean_up(&headers->name_index);
+    headers->has_name_index = false;
+}
+
+static struct aws_http_headers_index_entry *s_name_index_find(
+    const struct aws_http_headers *headers,
+    struct aws_byte_cursor name) {
+
+    struct aws_hash_element *elem = NULL;
+    aws_hash_table_find(&headers->name_index, &name, &elem);
+    return elem ? elem->value : NULL;
+}
+
+/* Count an occurrence of name at index. Drops the index on failure. */
+static void s_name_index_add(struct aws_http_headers *headers, size_t index, struct aws_byte_cursor name) {
+    struct aws_http_headers_index_entry *entry = s_name_index_find(headers, name);
+    if (entry) {
+        entry->count++;
+        if (index < entry->first) {
+            entry->first = index;
+            entry->name = name;
+        }
+        return;
+    }
+
+    entry = aws_mem_calloc(headers->alloc, 1, sizeof(struct aws_http_headers_index_entry));
+    if (!entry) {
+        goto error;
+    }
+    entry->name = name;
+    entry->first = index;
+    entry->count = 1;
+    if (aws_hash_table_put(&headers->name_index, &entry->name, entry, NULL)) {
+        aws_mem_release(headers->alloc, entry);
+        goto error;
+    }
+    return;
+
+error:
+    s_name_index_drop(headers);
+}
+
+/* Record that a header was inserted into the array at index */
+static void s_name_index_on_insert(struct aws_http_headers *headers, size_t index, struct aws_byte_cursor name) {
+    if (!headers->has_name_index) {
+        return;
+    }
+
+    if (index + 1 < s_own_count(headers)) {
+        /* Everything at or after index shifted back */
+        for (struct aws_hash_iter iter = aws_hash_iter_begin(&headers->name_index); !aws_hash_iter_done(&iter);
+             aws_hash_iter_next(&iter)) {
+            struct aws_http_headers_index_entry *entry = iter.element.value;
+            if (entry->first >= index) {
+                entry->first++;
+            }
+        }
+    }
+
+    s_name_index_add(headers, index, name);
+}
+
+/* Record that the header at index, with this name, was erased from the array */
+static void s_name_index_on_erase(struct aws_http_headers *headers, size_t index, struct aws_byte_cursor name) {
+    if (!headers->has_name_index) {
+        return;
+    }
+
+    struct aws_http_headers_index_entry *erased_entry = s_name_index_find(headers, name);
+    AWS_ASSERT(erased_entry);
+
+    if (--erased_entry->count == 0) {
+        aws_hash_table_remove(&headers->name_index, &name, NULL, NULL);
+        aws_mem_release(headers->alloc, erased_entry);
+        erased_entry = NULL;
+    }
+
+    /* Everything after index shifted forward */
+    for (struct aws_hash_iter iter = aws_hash_iter_begin(&headers->name_index); !aws_hash_iter_done(&iter);
+         aws_hash_iter_next(&iter)) {
+        struct aws_http_headers_index_entry *entry = iter.element.value;
+        if (entry->first > index) {
+            entry->first--;
+        }
+    }
+
+    if (erased_entry && erased_entry->first == index) {
+        /* Erased the first occurrence, find the next */
+        struct aws_http_header *header = NULL;
+        for (size_t i = index;; ++i) {
+            aws_array_list_get_at_ptr(&headers->array_list, (void **)&header, i);
+            AWS_ASSUME(header);
+            if (aws_http_header_name_eq(header->name, name)) {
+                erased_entry->first = i;
+                erased_entry->name = header->name;
+                break;
+            }
+        }
+    }
+}
+
+static void s_name_index_build(struct aws_http_headers *headers) {
+    AWS_ASSERT(!headers->has_name_index);
+
+    if (aws_hash_table_init(
+            &headers->name_index,
+            headers->alloc,
+            s_own_count(headers),
+            aws_hash_byte_cursor_ptr_ignore_case,
+            (aws_hash_callback_eq_fn *)aws_byte_cursor_eq_ignore_case,
+            NULL,
+            NULL)) {
+        return;
+    }
+    headers->has_name_index = true;
+
+    struct aws_http_header *header = NULL;
+    const size_t count = s_own_count(headers);
+    for (size_t i = 0; i < count && headers->has_name_index; ++i) {
+        aws_array_list_get_at_ptr(&headers->array_list, (void **)&header, i);
+        AWS_ASSUME(header);
+        s_name_index_add(headers, i, header->name);
+    }
+}
+
 struct aws_http_headers *aws_http_headers_new(struct aws_allocator *allocator) {
+    return aws_http_headers_new_with_capacity(allocator, 0);
+}
+
+struct aws_http_headers *aws_http_headers_new_with_capacity(struct aws_allocator *allocator, size_t header_count) {
     AWS_PRECONDITION(allocator);
 
     struct aws_http_headers *headers = aws_mem_calloc(allocator, 1, sizeof(struct aws_http_headers));
@@ -54,9 +326,16 @@ struct aws_http_headers *aws_http_headers_new(struct aws_allocator *allocator) {
 
     headers->alloc = allocator;
     aws_atomic_init_int(&headers->refcount, 1);
+    aws_linked_list_init(&headers->string_blocks);
+
+    /* The first string block is sized to hold the hinted number of headers */
+    headers->string_block_size = aws_max_size(
+        AWS_HTTP_HEADERS_STRING_BLOCK_SIZE,
+        aws_mul_size_saturating(header_count, AWS_HTTP_HEADERS_ESTIMATED_STRING_LEN));
 
+    size_t reserved_headers = header_count ? header_count : AWS_HTTP_REQUEST_NUM_RESERVED_HEADERS;
     if (aws_array_list_init_dynamic(
-            &headers->array_list, allocator, AWS_HTTP_REQUEST_NUM_RESERVED_HEADERS, sizeof(struct aws_http_header))) {
+            &headers->array_list, allocator, reserved_headers, sizeof(struct aws_http_header))) {
         goto array_list_failed;
     }
 
@@ -68,6 +347,17 @@ alloc_failed:
     return NULL;
 }
 
+struct aws_http_headers *aws_http_headers_new_layered(struct aws_allocator *allocator, struct aws_http_headers *base) {
+    AWS_PRECONDITION(base);
+
+    struct aws_http_headers *headers = aws_http_headers_new(allocator);
+    if (headers) {
+        headers->base = base;
+        aws_http_headers_acquire(base);
+    }
+    return headers;
+}
+
 void aws_http_headers_release(struct aws_http_headers *headers) {
     AWS_PRECONDITION(!headers || headers->alloc);
     if (!headers) {
@@ -77,7 +367,12 @@ void aws_http_headers_release(struct aws_http_headers *headers) {
     size_t prev_refcount = aws_atomic_fetch_sub(&headers->refcount, 1);
     if (prev_refcount == 1) {
         aws_http_headers_clear(headers);
+        s_name_index_drop(headers);
         aws_array_list_clean_up(&headers->array_list);
+        while (!aws_linked_list_empty(&headers->string_blocks)) {
+            struct aws_linked_list_node *node = aws_linked_list_pop_front(&headers->string_blocks);
+            aws_mem_release(headers->alloc, AWS_CONTAINER_OF(node, struct aws_http_headers_string_block, node));
+        }
         aws_mem_release(headers->alloc, headers);
     } else {
         AWS_ASSERT(prev_refcount != 0);
@@ -89,6 +384,81 @@ void aws_http_headers_acquire(struct aws_http_headers *headers) {
     aws_atomic_fetch_add(&headers->refcount, 1);
 }
 
+/* Copy the header's name and value into our storage, and point the header at the copies */
+static int s_headers_store_strings(struct aws_http_headers *headers, struct aws_http_header *header) {
+    size_t total_len;
+    if (aws_add_size_checked(header->name.len, header->value.len, &total_len)) {
+        return AWS_OP_ERR;
+    }
+
+    /* We put the name and value into the same arena entry. */
+    uint8_t *strmem = s_headers_string_acquire(headers, total_len);
+    if (!strmem) {
+        return AWS_OP_ERR;
+    }
+
+    struct aws_byte_buf strbuf = aws_byte_buf_from_empty_array(strmem, total_len);
+    aws_byte_buf_append_and_update(&strbuf, &header->name);
+    aws_byte_buf_append_and_update(&strbuf, &header->value);
+    return AWS_OP_SUCCESS;
+}
+
+/**
+ * Copy the base's headers into the top layer, so they can be modified.
+ * The base is handed back rather than released, since the caller's arguments may be referencing its memory.
+ * The caller must release it once they're done.
+ */
+static int s_http_headers_detach_base(struct aws_http_headers *headers, struct aws_http_headers **out_old_base) {
+    *out_old_base = NULL;
+    if (!headers->base) {
+        return AWS_OP_SUCCESS;
+    }
+
+    const size_t base_count = aws_http_headers_count(headers->base);
+    const size_t own_count = s_own_count(headers);
+
+    struct aws_array_list flattened;
+    if (aws_array_list_init_dynamic(
+            &flattened, headers->alloc, base_count + own_count, sizeof(struct aws_http_header))) {
+        return AWS_OP_ERR;
+    }
+
+    struct aws_http_header header;
+    for (size_t i = 0; i < base_count; ++i) {
+        aws_http_headers_get_index(headers->base, i, &header);
+        if (s_headers_store_strings(headers, &header)) {
+            goto error;
+        }
+        /* Can't fail, capacity was reserved up front */
+        aws_array_list_push_back(&flattened, &header);
+    }
+    for (size_t i = 0; i < own_count; ++i) {
+        aws_array_list_get_at(&headers->array_list, &header, i);
+        aws_array_list_push_back(&flattened, &header);
+    }
+
+    aws_array_list_swap_contents(&headers->array_list, &flattened);
+    aws_array_list_clean_up(&flattened);
+
+    /* Every position moved, rebuild the index from scratch */
+    s_name_index_drop(headers);
+    if (s_own_count(headers) >= AWS_HTTP_HEADERS_INDEX_THRESHOLD) {
+        s_name_index_build(headers);
+    }
+
+    *out_old_base = headers->base;
+    headers->base = NULL;
+    return AWS_OP_SUCCESS;
+
+error:
+    for (size_t i = 0; i < aws_array_list_length(&flattened); ++i) {
+        aws_array_list_get_at(&flattened, &header, i);
+        s_headers_string_release(headers, header.name.ptr);
+    }
+    aws_array_list_clean_up(&flattened);
+    return AWS_OP_ERR;
+}
+
 static int s_http_headers_add_header_impl(
     struct aws_http_headers *headers,
     const struct aws_http_header *header_orig,
@@ -108,18 +478,10 @@ static int s_http_headers_add_header_impl(
      * Trim it off here, so anyone querying this value has an easier time. */
     header_copy.value = aws_strutil_trim_http_whitespace(header_copy.value);
 
-    size_t total_len;
-    if (aws_add_size_checked(header_copy.name.len, header_copy.value.len, &total_len)) {
+    if (s_headers_store_strings(headers, &header_copy)) {
         return AWS_OP_ERR;
     }
 
-    /* Store our own copy of the strings.
-     * We put the name and value into the same allocation. */
-    uint8_t *strmem = aws_mem_acquire(headers->alloc, total_len);
-
-    struct aws_byte_buf strbuf = aws_byte_buf_from_empty_array(strmem, total_len);
-    aws_byte_buf_append_and_update(&strbuf, &header_copy.name);
-    aws_byte_buf_append_and_update(&strbuf, &header_copy.value);
     if (front) {
         if (aws_array_list_push_front(&headers->array_list, &header_copy)) {
             goto error;
@@ -130,10 +492,16 @@ static int s_http_headers_add_header_impl(
         }
     }
 
+    if (headers->has_name_index) {
+        s_name_index_on_insert(headers, front ? 0 : s_own_count(headers) - 1, header_copy.name);
+    } else if (s_own_count(headers) == AWS_HTTP_HEADERS_INDEX_THRESHOLD) {
+        s_name_index_build(headers);
+    }
+
     return AWS_OP_SUCCESS;
 
 error:
-    aws_mem_release(headers->alloc, strmem);
+    s_headers_string_release(headers, header_copy.name.ptr);
     return AWS_OP_ERR;
 }
 
@@ -149,7 +517,16 @@ int aws_http_headers_add_header(struct aws_http_headers *headers, const struct a
         aws_http_headers_get_index(headers, aws_http_headers_count(headers) - 1, &last_header);
         front = !aws_strutil_is_http_pseudo_header_name(last_header.name);
     }
-    return s_http_headers_add_header_impl(headers, header, front);
+
+    /* Going in front means going in front of the base's headers */
+    struct aws_http_headers *old_base = NULL;
+    if (front && s_http_headers_detach_base(headers, &old_base)) {
+        return AWS_OP_ERR;
+    }
+
+    int result = s_http_headers_add_header_impl(headers, header, front);
+    aws_http_headers_release(old_base);
+    return result;
 }
 
 int aws_http_headers_add(struct aws_http_headers *headers, struct aws_byte_cursor name, struct aws_byte_cursor value) {
@@ -160,29 +537,34 @@ int aws_http_headers_add(struct aws_http_headers *headers, struct aws_byte_curso
 void aws_http_headers_clear(struct aws_http_headers *headers) {
     AWS_PRECONDITION(headers);
 
+    aws_http_headers_release(headers->base);
+    headers->base = NULL;
+
     struct aws_http_header *header = NULL;
-    const size_t count = aws_http_headers_count(headers);
+    const size_t count = s_own_count(headers);
     for (size_t i = 0; i < count; ++i) {
         aws_array_list_get_at_ptr(&headers->array_list, (void **)&header, i);
         AWS_ASSUME(header);
 
-        /* Storage for name & value is in the same allocation */
-        aws_mem_release(headers->alloc, header->name.ptr);
+        /* Storage for name & value is in the same arena entry */
+        s_headers_string_release(headers, header->name.ptr);
     }
 
     aws_array_list_clear(&headers->array_list);
+    s_name_index_drop(headers);
 }
 
 /* Does not check index */
 static void s_http_headers_erase_index(struct aws_http_headers *headers, size_t index) {
-    struct aws_http_header *header = NULL;
-    aws_array_list_get_at_ptr(&headers->array_list, (void **)&header, index);
-    AWS_ASSUME(header);
-
-    /* Storage for name & value is in the same allocation */
-    aws_mem_release(headers->alloc, header->name.ptr);
+    struct aws_http_header header;
+    aws_array_list_get_at(&headers->array_list, &header, index);
 
     aws_array_list_erase(&headers->array_list, index);
+    s_name_index_on_erase(headers, index, header.name);
+
+    /* Storage for name & value is in the same arena entry.
+     * Release it last, the index may have been referencing the name. */
+    s_headers_string_release(headers, header.name.ptr);
 }
 
 int aws_http_headers_erase_index(struct aws_http_headers *headers, size_t index) {
@@ -192,10 +574,30 @@ int aws_http_headers_erase_index(struct aws_http_headers *headers, size_t index)
         return aws_raise_error(AWS_ERROR_INVALID_INDEX);
     }
 
+    struct aws_http_headers *old_base = NULL;
+    if (headers->base) {
+        const size_t base_count = aws_http_headers_count(headers->base);
+        if (index >= base_count) {
+            index -= base_count;
+        } else if (s_http_headers_detach_base(headers, &old_base)) {
+            return AWS_OP_ERR;
+        }
+    }
+
     s_http_headers_erase_index(headers, index);
+    aws_http_headers_release(old_base);
     return AWS_OP_SUCCESS;
 }
 
+/* Returns index to start scanning for name at, or SIZE_MAX if the index knows there are none */
+static size_t s_name_scan_start(const struct aws_http_headers *headers, struct aws_byte_cursor name) {
+    if (!headers->has_name_index) {
+        return 0;
+    }
+    struct aws_http_headers_index_entry *entry = s_name_index_find(headers, name);
+    return entry ? entry->first : SIZE_MAX;
+}
+
 /* Erase entries with name, stop at end_index */
 static int s_http_headers_erase(
     struct aws_http_headers *headers,
@@ -205,6 +607,9 @@ static int s_http_headers_erase(
     bool erased_any = false;
     struct aws_http_header *header = NULL;
 
+    /* Nothing before the first occurrence can match */
+    start_index = aws_max_size(start_index, s_name_scan_start(headers, name));
+
     /* Iterating in reverse is simpler */
     for (size_t n = end_index; n > start_index; --n) {
         const size_t i = n - 1;
@@ -225,11 +630,31 @@ static int s_http_headers_erase(
     return AWS_OP_SUCCESS;
 }
 
+/* Detach the base if it has any headers with this name */
+static int s_http_headers_detach_base_if_has(
+    struct aws_http_headers *headers,
+    struct aws_byte_cursor name,
+    struct aws_http_headers **out_old_base) {
+
+    *out_old_base = NULL;
+    if (headers->base && aws_http_headers_has(headers->base, name)) {
+        return s_http_headers_detach_base(headers, out_old_base);
+    }
+    return AWS_OP_SUCCESS;
+}
+
 int aws_http_headers_erase(struct aws_http_headers *headers, struct aws_byte_cursor name) {
     AWS_PRECONDITION(headers);
     AWS_PRECONDITION(aws_byte_cursor_is_valid(&name));
 
-    return s_http_headers_erase(headers, name, 0, aws_http_headers_count(headers));
+    struct aws_http_headers *old_base = NULL;
+    if (s_http_headers_detach_base_if_has(headers, name, &old_base)) {
+        return AWS_OP_ERR;
+    }
+
+    int result = s_http_headers_erase(headers, name, 0, s_own_count(headers));
+    aws_http_headers_release(old_base);
+    return result;
 }
 
 int aws_http_headers_erase_value(
@@ -240,19 +665,28 @@ int aws_http_headers_erase_value(
     AWS_PRECONDITION(headers);
     AWS_PRECONDITION(aws_byte_cursor_is_valid(&name) && aws_byte_cursor_is_valid(&value));
 
+    /* Coarse, but the base only needs detaching if it has the name at all */
+    struct aws_http_headers *old_base = NULL;
+    if (s_http_headers_detach_base_if_has(headers, name, &old_base)) {
+        return AWS_OP_ERR;
+    }
+
+    int result = aws_raise_error(AWS_ERROR_HTTP_HEADER_NOT_FOUND);
     struct aws_http_header *header = NULL;
-    const size_t count = aws_http_headers_count(headers);
-    for (size_t i = 0; i < count; ++i) {
+    const size_t count = s_own_count(headers);
+    for (size_t i = s_name_scan_start(headers, name); i < count; ++i) {
         aws_array_list_get_at_ptr(&headers->array_list, (void **)&header, i);
         AWS_ASSUME(header);
 
         if (aws_http_header_name_eq(header->name, name) && aws_byte_cursor_eq(&header->value, &value)) {
             s_http_headers_erase_index(headers, i);
-            return AWS_OP_SUCCESS;
+            result = AWS_OP_SUCCESS;
+            break;
         }
     }
 
-    return aws_raise_error(AWS_ERROR_HTTP_HEADER_NOT_FOUND);
+    aws_http_headers_release(old_base);
+    return result;
 }
 
 int aws_http_headers_add_array(struct aws_http_headers *headers, const struct aws_http_header *array, size_t count) {
@@ -270,9 +704,10 @@ int aws_http_headers_add_array(struct aws_http_headers *headers, const struct aw
     return AWS_OP_SUCCESS;
 
 error:
-    /* Erase headers from the end until we're back to our previous state */
+    /* Erase headers from the end until we're back to our previous state.
+     * New headers are all in the top layer, even if the base was detached along the way. */
     for (size_t new_count = aws_http_headers_count(headers); new_count > orig_count; --new_count) {
-        s_http_headers_erase_index(headers, new_count - 1);
+        s_http_headers_erase_index(headers, s_own_count(headers) - 1);
     }
 
     return AWS_OP_ERR;
@@ -282,22 +717,39 @@ int aws_http_headers_set(struct aws_http_headers *headers, struct aws_byte_curso
     AWS_PRECONDITION(headers);
     AWS_PRECONDITION(aws_byte_cursor_is_valid(&name) && aws_byte_cursor_is_valid(&value));
 
-    const size_t prev_count = aws_http_headers_count(headers);
     bool pseudo = aws_strutil_is_http_pseudo_header_name(name);
+
+    /* Pseudo-headers go in front of the base's headers, and existing headers with this name get replaced */
+    struct aws_http_headers *old_base = NULL;
+    if (pseudo && headers->base) {
+        if (s_http_headers_detach_base(headers, &old_base)) {
+            return AWS_OP_ERR;
+        }
+    } else if (s_http_headers_detach_base_if_has(headers, name, &old_base)) {
+        return AWS_OP_ERR;
+    }
+
+    const size_t prev_count = s_own_count(headers);
     const size_t start = pseudo ? 1 : 0;
     struct aws_http_header header = {.name = name, .value = value};
-    if (s_http_headers_add_header_impl(headers, &header, pseudo)) {
-        return AWS_OP_ERR;
+    int result = s_http_headers_add_header_impl(headers, &header, pseudo);
+    if (result == AWS_OP_SUCCESS) {
+        /* Erase pre-existing headers AFTER add, in case name or value was referencing their memory. */
+        s_http_headers_erase(headers, name, start, prev_count);
     }
-    /* Erase pre-existing headers AFTER add, in case name or value was referencing their memory. */
-    s_http_headers_erase(headers, name, start, prev_count);
-    return AWS_OP_SUCCESS;
+
+    aws_http_headers_release(old_base);
+    return result;
 }
 
 size_t aws_http_headers_count(const struct aws_http_headers *headers) {
     AWS_PRECONDITION(headers);
 
-    return aws_array_list_length(&headers->array_list);
+    size_t count = s_own_count(headers);
+    if (headers->base) {
+        count += aws_http_headers_count(headers->base);
+    }
+    return count;
 }
 
 int aws_http_headers_get_index(
@@ -308,6 +760,14 @@ int aws_http_headers_get_index(
     AWS_PRECONDITION(headers);
     AWS_PRECONDITION(out_header);
 
+    if (headers->base) {
+        const size_t base_count = aws_http_headers_count(headers->base);
+        if (index < base_count) {
+            return aws_http_headers_get_index(headers->base, index, out_header);
+        }
+        index -= base_count;
+    }
+
     return aws_array_list_get_at(&headers->array_list, out_header, index);
 }
 
@@ -317,32 +777,53 @@ int aws_http_headers_get_index(
  * of the message, by appending each subsequent field line value to the initial
  * field line value in order, separated by a comma (",") and optional whitespace
  * (OWS, defined in Section 5.6.3). For consistency, use comma SP. */
-AWS_HTTP_API
-struct aws_string *aws_http_headers_get_all(const struct aws_http_headers *headers, struct aws_byte_cursor name) {
-
-    AWS_PRECONDITION(headers);
-    AWS_PRECONDITION(aws_byte_cursor_is_valid(&name));
+static void s_http_headers_append_all(
+    const struct aws_http_headers *headers,
+    struct aws_byte_cursor name,
+    struct aws_byte_buf *value_builder,
+    bool *found) {
 
-    struct aws_string *value_str = NULL;
+    if (headers->base) {
+        s_http_headers_append_all(headers->base, name, value_builder, found);
+    }
 
     const struct aws_byte_cursor separator = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL(", ");
 
-    struct aws_byte_buf value_builder;
-    aws_byte_buf_init(&value_builder, headers->alloc, 0);
-    bool found = false;
+    /* With the index, we know where the matches start and when we've seen them all */
+    size_t remaining = SIZE_MAX;
+    if (headers->has_name_index) {
+        struct aws_http_headers_index_entry *entry = s_name_index_find(headers, name);
+        remaining = entry ? entry->count : 0;
+    }
+
     struct aws_http_header *header = NULL;
-    const size_t count = aws_http_headers_count(headers);
-    for (size_t i = 0; i < count; ++i) {
+    const size_t count = s_own_count(headers);
+    for (size_t i = s_name_scan_start(headers, name); i < count && remaining > 0; ++i) {
         aws_array_list_get_at_ptr(&headers->array_list, (void **)&header, i);
         if (aws_http_header_name_eq(name, header->name)) {
-            if (!found) {
-                found = true;
+            if (!*found) {
+                *found = true;
             } else {
-                aws_byte_buf_append_dynamic(&value_builder, &separator);
+                aws_byte_buf_append_dynamic(value_builder, &separator);
             }
-            aws_byte_buf_append_dynamic(&value_builder, &header->value);
+            aws_byte_buf_append_dynamic(value_builder, &header->value);
+            remaining--;
         }
     }
+}
+
+AWS_HTTP_API
+struct aws_string *aws_http_headers_get_all(const struct aws_http_headers *headers, struct aws_byte_cursor name) {
+
+    AWS_PRECONDITION(headers);
+    AWS_PRECONDITION(aws_byte_cursor_is_valid(&name));
+
+    struct aws_string *value_str = NULL;
+
+    struct aws_byte_buf value_builder;
+    aws_byte_buf_init(&value_builder, headers->alloc, 0);
+    bool found = false;
+    s_http_headers_append_all(headers, name, &value_builder, &found);
 
     if (found) {
         value_str = aws_string_new_from_buf(headers->alloc, &value_builder);
@@ -363,9 +844,14 @@ int aws_http_headers_get(
     AWS_PRECONDITION(out_value);
     AWS_PRECONDITION(aws_byte_cursor_is_valid(&name));
 
+    /* The base's headers come first */
+    if (headers->base && aws_http_headers_get(headers->base, name, out_value) == AWS_OP_SUCCESS) {
+        return AWS_OP_SUCCESS;
+    }
+
     struct aws_http_header *header = NULL;
-    const size_t count = aws_http_headers_count(headers);
-    for (size_t i = 0; i < count; ++i) {
+    const size_t count = s_own_count(headers);
+    for (size_t i = s_name_scan_start(headers, name); i < count; ++i) {
         aws_array_list_get_at_ptr(&headers->array_list, (void **)&header, i);
         AWS_ASSUME(header);
 
@@ -459,8 +945,9 @@ struct aws_http_message {
     /* Data specific to the request or response subclasses */
     union {
         struct aws_http_message_request_data {
-            struct aws_string *method;
-            struct aws_string *path;
+            /* HTTP/1 only, HTTP/2 stores these in pseudo-headers. Empty if not set. */
+            struct aws_byte_buf method;
+            struct aws_byte_buf path;
         } request;
         struct aws_http_message_response_data {
             int status;
@@ -471,30 +958,29 @@ struct aws_http_message {
     struct aws_http_message_response_data *response_data;
 };
 
-static int s_set_string_from_cursor(
-    struct aws_string **dst,
-    struct aws_byte_cursor cursor,
-    struct aws_allocator *alloc) {
-
+/* Replace dst's contents, reusing its capacity if possible. The cursor may point into dst. */
+static int s_set_buf_from_cursor(struct aws_byte_buf *dst, struct aws_byte_cursor cursor, struct aws_allocator *alloc) {
     AWS_PRECONDITION(dst);
 
-    /* If the cursor is empty, set dst to NULL */
-    struct aws_string *new_str;
-    if (cursor.len) {
-        new_str = aws_string_new_from_cursor(alloc, &cursor);
-        if (!new_str) {
-            return AWS_OP_ERR;
+    if (cursor.len <= dst->capacity) {
+        if (cursor.len) {
+            memmove(dst->buffer, cursor.ptr, cursor.len);
         }
-    } else {
-        new_str = NULL;
+        dst->len = cursor.len;
+        return AWS_OP_SUCCESS;
     }
 
-    /* Replace existing value */
-    aws_string_destroy(*dst);
+    struct aws_byte_buf new_buf;
+    if (aws_byte_buf_init_copy_from_cursor(&new_buf, alloc, cursor)) {
+        return AWS_OP_ERR;
+    }
 
-    *dst = new_str;
+    /* Replace existing value */
+    aws_byte_buf_clean_up(dst);
+    *dst = new_buf;
     return AWS_OP_SUCCESS;
 }
+
 static struct aws_http_message *s_message_new_common(
     struct aws_allocator *allocator,
     struct aws_http_headers *existing_headers) {
@@ -592,8 +1078,8 @@ struct aws_http_message *aws_http_message_release(struct aws_http_message *messa
     size_t prev_refcount = aws_atomic_fetch_sub(&message->refcount, 1);
     if (prev_refcount == 1) {
         if (message->request_data) {
-            aws_string_destroy(message->request_data->method);
-            aws_string_destroy(message->request_data->path);
+            aws_byte_buf_clean_up(&message->request_data->method);
+            aws_byte_buf_clean_up(&message->request_data->path);
         }
 
         aws_http_headers_release(message->headers);
@@ -614,6 +1100,105 @@ struct aws_http_message *aws_http_message_acquire(struct aws_http_message *messa
     return message;
 }
 
+int aws_http_message_reset(struct aws_http_message *message) {
+    AWS_PRECONDITION(message);
+
+    /* Clear the headers in place, unless someone else is also using them */
+    if (aws_atomic_load_int(&message->headers->refcount) == 1) {
+        aws_http_headers_clear(message->headers);
+    } else {
+        struct aws_http_headers *new_headers = aws_http_headers_new(message->allocator);
+        if (!new_headers) {
+            return AWS_OP_ERR;
+        }
+        aws_http_headers_release(message->headers);
+        message->headers = new_headers;
+    }
+
+    if (message->request_data) {
+        aws_byte_buf_reset(&message->request_data->method, false /*zero_contents*/);
+        aws_byte_buf_reset(&message->request_data->path, false /*zero_contents*/);
+    }
+
+    if (message->response_data) {
+        message->response_data->status = AWS_HTTP_STATUS_CODE_UNKNOWN;
+    }
+
+    aws_http_message_set_body_stream(message, NULL);
+    return AWS_OP_SUCCESS;
+}
+
+struct aws_http_message_pool {
+    struct aws_allocator *allocator;
+    /* Contains aws_http_message*, each reset and ready for use */
+    struct aws_array_list messages;
+    size_t max_messages;
+};
+
+struct aws_http_message_pool *aws_http_message_pool_new(struct aws_allocator *allocator, size_t max_messages) {
+    AWS_PRECONDITION(allocator);
+
+    struct aws_http_message_pool *pool = aws_mem_calloc(allocator, 1, sizeof(struct aws_http_message_pool));
+    if (!pool) {
+        return NULL;
+    }
+
+    pool->allocator = allocator;
+    pool->max_messages = max_messages;
+    if (aws_array_list_init_dynamic(&pool->messages, allocator, max_messages, sizeof(struct aws_http_message *))) {
+        aws_mem_release(allocator, pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+void aws_http_message_pool_destroy(struct aws_http_message_pool *pool) {
+    if (!pool) {
+        return;
+    }
+
+    struct aws_http_message *message = NULL;
+    while (aws_array_list_back(&pool->messages, &message) == AWS_OP_SUCCESS) {
+        aws_array_list_pop_back(&pool->messages);
+        aws_http_message_release(message);
+    }
+    aws_array_list_clean_up(&pool->messages);
+    aws_mem_release(pool->allocator, pool);
+}
+
+struct aws_http_message *aws_http_message_pool_acquire_request(struct aws_http_message_pool *pool) {
+    AWS_PRECONDITION(pool);
+
+    struct aws_http_message *message = NULL;
+    if (aws_array_list_back(&pool->messages, &message) == AWS_OP_SUCCESS) {
+        aws_array_list_pop_back(&pool->messages);
+        return message;
+    }
+
+    return aws_http_message_new_request(pool->allocator);
+}
+
+void aws_http_message_pool_release(struct aws_http_message_pool *pool, struct aws_http_message *message) {
+    AWS_PRECONDITION(pool);
+    if (!message) {
+        return;
+    }
+
+    /* Only keep messages that nobody else holds, which can be turned back into a blank HTTP/1.1 request */
+    bool keep = aws_array_list_length(&pool->messages) < pool->max_messages &&
+                aws_atomic_load_int(&message->refcount) == 1 && message->request_data &&
+                message->http_version == AWS_HTTP_VERSION_1_1 && message->allocator == pool->allocator;
+
+    if (keep && aws_http_message_reset(message) == AWS_OP_SUCCESS) {
+        /* Can't fail, capacity was reserved up front */
+        aws_array_list_push_back(&pool->messages, &message);
+        return;
+    }
+
+    aws_http_message_release(message);
+}
+
 bool aws_http_message_is_request(const struct aws_http_message *message) {
     AWS_PRECONDITION(message);
     return message->request_data;
@@ -637,7 +1222,7 @@ int aws_http_message_set_request_method(struct aws_http_message *request_message
     if (request_message->request_data) {
         switch (request_message->http_version) {
             case AWS_HTTP_VERSION_1_1:
-                return s_set_string_from_cursor(
+                return s_set_buf_from_cursor(
                     &request_message->request_data->method, method, request_message->allocator);
             case AWS_HTTP_VERSION_2:
                 return aws_http2_headers_set_request_method(request_message->headers, method);
@@ -659,8 +1244,8 @@ int aws_http_message_get_request_method(
     if (request_message->request_data) {
         switch (request_message->http_version) {
             case AWS_HTTP_VERSION_1_1:
-                if (request_message->request_data->method) {
-                    *out_method = aws_byte_cursor_from_string(request_message->request_data->method);
+                if (request_message->request_data->method.len) {
+                    *out_method = aws_byte_cursor_from_buf(&request_message->request_data->method);
                     return AWS_OP_SUCCESS;
                 }
                 break;
@@ -683,7 +1268,7 @@ int aws_http_message_set_request_path(struct aws_http_message *request_message,
     if (request_message->request_data) {
         switch (request_message->http_version) {
             case AWS_HTTP_VERSION_1_1:
-                return s_set_string_from_cursor(&request_message->request_data->path, path, request_message->allocator);
+                return s_set_buf_from_cursor(&request_message->request_data->path, path, request_message->allocator);
             case AWS_HTTP_VERSION_2:
                 return aws_http2_headers_set_request_path(request_message->headers, path);
             default:
@@ -705,8 +1290,8 @@ int aws_http_message_get_request_path(
     if (request_message->request_data) {
         switch (request_message->http_version) {
             case AWS_HTTP_VERSION_1_1:
-                if (request_message->request_data->path) {
-                    *out_path = aws_byte_cursor_from_string(request_message->request_data->path);
+                if (request_message->request_data->path.len) {
+                    *out_path = aws_byte_cursor_from_buf(&request_message->request_data->path);
                     return AWS_OP_SUCCESS;
                 }
                 break;
@@ -781,6 +1366,179 @@ void aws_http_message_set_body_stream(struct aws_http_message *message, struct a
     }
 }
 
+struct aws_http_body_segments_stream {
+    struct aws_input_stream base;
+    struct aws_allocator *allocator;
+    struct aws_http_body_segment *segments;
+    size_t segment_count;
+    /* Index of first segment that hasn't been fully consumed (and released) */
+    size_t next_index;
+    /* Bytes of segments[next_index] that have already been consumed */
+    size_t next_offset;
+    uint64_t total_len;
+};
+
+static void s_body_segments_release_next(struct aws_http_body_segments_stream *segments_stream) {
+    struct aws_http_body_segment *segment = &segments_stream->segments[segments_stream->next_index];
+    segments_stream->next_index++;
+    segments_stream->next_offset = 0;
+    if (segment->on_release) {
+        segment->on_release(segment->user_data);
+    }
+}
+
+/* Release empty segments, so that segments[next_index] has unread data (or we're at the end) */
+static void s_body_segments_skip_empty(struct aws_http_body_segments_stream *segments_stream) {
+    while (segments_stream->next_index < segments_stream->segment_count &&
+           segments_stream->segments[segments_stream->next_index].data.len == segments_stream->next_offset) {
+        s_body_segments_release_next(segments_stream);
+    }
+}
+
+static int s_body_segments_seek(
+    struct aws_input_stream *stream,
+    int64_t offset,
+    enum aws_stream_seek_basis basis) {
+
+    (void)stream;
+    (void)offset;
+    (void)basis;
+    return aws_raise_error(AWS_ERROR_UNSUPPORTED_OPERATION);
+}
+
+static int s_body_segments_read(struct aws_input_stream *stream, struct aws_byte_buf *dest) {
+    struct aws_http_body_segments_stream *segments_stream =
+        AWS_CONTAINER_OF(stream, struct aws_http_body_segments_stream, base);
+
+    s_body_segments_skip_empty(segments_stream);
+    while (segments_stream->next_index < segments_stream->segment_count && dest->len < dest->capacity) {
+        struct aws_byte_cursor unread = segments_stream->segments[segments_stream->next_index].data;
+        aws_byte_cursor_advance(&unread, segments_stream->next_offset);
+
+        struct aws_byte_cursor written = aws_byte_buf_write_to_capacity(dest, &unread);
+        segments_stream->next_offset += written.len;
+
+        /* Data has been copied, so the segment can be released as soon as it's fully read */
+        s_body_segments_skip_empty(segments_stream);
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+static int s_body_segments_get_status(struct aws_input_stream *stream, struct aws_stream_status *status) {
+    struct aws_http_body_segments_stream *segments_stream =
+        AWS_CONTAINER_OF(stream, struct aws_http_body_segments_stream, base);
+
+    s_body_segments_skip_empty(segments_stream);
+    status->is_end_of_stream = segments_stream->next_index == segments_stream->segment_count;
+    status->is_valid = true;
+    return AWS_OP_SUCCESS;
+}
+
+static int s_body_segments_get_length(struct aws_input_stream *stream, int64_t *out_length) {
+    struct aws_http_body_segments_stream *segments_stream =
+        AWS_CONTAINER_OF(stream, struct aws_http_body_segments_stream, base);
+
+    *out_length = (int64_t)segments_stream->total_len;
+    return AWS_OP_SUCCESS;
+}
+
+static void s_body_segments_destroy(void *user_data) {
+    struct aws_http_body_segments_stream *segments_stream = user_data;
+
+    while (segments_stream->next_index < segments_stream->segment_count) {
+        s_body_segments_release_next(segments_stream);
+    }
+
+    aws_mem_release(segments_stream->allocator, segments_stream);
+}
+
+static struct aws_input_stream_vtable s_body_segments_vtable = {
+    .seek = s_body_segments_seek,
+    .read = s_body_segments_read,
+    .get_status = s_body_segments_get_status,
+    .get_length = s_body_segments_get_length,
+};
+
+struct aws_input_stream *aws_http_body_segments_stream_new(
+    struct aws_allocator *allocator,
+    const struct aws_http_body_segment *segments,
+    size_t segment_count) {
+
+    AWS_PRECONDITION(allocator);
+    AWS_PRECONDITION(segments || segment_count == 0);
+
+    uint64_t total_len = 0;
+    for (size_t i = 0; i < segment_count; ++i) {
+        if (aws_add_u64_checked(total_len, segments[i].data.len, &total_len)) {
+            return NULL;
+        }
+    }
+    if (total_len > INT64_MAX) {
+        aws_raise_error(AWS_ERROR_OVERFLOW_DETECTED);
+        return NULL;
+    }
+
+    struct aws_http_body_segments_stream *segments_stream;
+    struct aws_http_body_segment *segments_storage;
+    if (!aws_mem_acquire_many(
+            allocator,
+            2,
+            &segments_stream,
+            sizeof(struct aws_http_body_segments_stream),
+            &segments_storage,
+            sizeof(struct aws_http_body_segment) * segment_count)) {
+        return NULL;
+    }
+
+    AWS_ZERO_STRUCT(*segments_stream);
+    segments_stream->allocator = allocator;
+    segments_stream->segments = segments_storage;
+    segments_stream->segment_count = segment_count;
+    segments_stream->total_len = total_len;
+    if (segment_count > 0) {
+        memcpy(segments_storage, segments, sizeof(struct aws_http_body_segment) * segment_count);
+    }
+
+    segments_stream->base.vtable = &s_body_segments_vtable;
+    aws_ref_count_init(&segments_stream->base.ref_count, segments_stream, s_body_segments_destroy);
+    return &segments_stream->base;
+}
+
+struct aws_http_body_segments_stream *aws_http_body_segments_stream_from_input_stream(
+    struct aws_input_stream *body_stream) {
+
+    if (body_stream == NULL || body_stream->vtable != &s_body_segments_vtable) {
+        return NULL;
+    }
+    return AWS_CONTAINER_OF(body_stream, struct aws_http_body_segments_stream, base);
+}
+
+size_t aws_http_body_segments_stream_get_next_len(struct aws_http_body_segments_stream *segments_stream) {
+    s_body_segments_skip_empty(segments_stream);
+    if (segments_stream->next_index == segments_stream->segment_count) {
+        return 0;
+    }
+    return segments_stream->segments[segments_stream->next_index].data.len - segments_stream->next_offset;
+}
+
+bool aws_http_body_segments_stream_take_next(
+    struct aws_http_body_segments_stream *segments_stream,
+    struct aws_http_body_segment *out_segment) {
+
+    s_body_segments_skip_empty(segments_stream);
+    if (segments_stream->next_index == segments_stream->segment_count) {
+        return false;
+    }
+
+    *out_segment = segments_stream->segments[segments_stream->next_index];
+    aws_byte_cursor_advance(&out_segment->data, segments_stream->next_offset);
+
+    segments_stream->next_index++;
+    segments_stream->next_offset = 0;
+    return true;
+}
+
 int aws_http1_stream_write_chunk(struct aws_http_stream *http1_stream, const struct aws_http1_chunk_options *options) {
     AWS_PRECONDITION(http1_stream);
     AWS_PRECONDITION(http1_stream->vtable);
@@ -807,6 +1565,19 @@ int aws_http2_stream_write_data(
     return http2_stream->vtable->http2_write_data(http2_stream, options);
 }
 
+int aws_http2_stream_notify_body_ready(struct aws_http_stream *http2_stream) {
+    AWS_PRECONDITION(http2_stream);
+    AWS_PRECONDITION(http2_stream->vtable);
+    if (!http2_stream->vtable->http2_notify_body_ready) {
+        AWS_LOGF_TRACE(
+            AWS_LS_HTTP_STREAM,
+            "id=%p: HTTP/2 stream only function invoked on other stream, ignoring call.",
+            (void *)http2_stream);
+        return aws_raise_error(AWS_ERROR_INVALID_STATE);
+    }
+    return http2_stream->vtable->http2_notify_body_ready(http2_stream);
+}
+
 int aws_http1_stream_add_chunked_trailer(
     struct aws_http_stream *http1_stream,
     const struct aws_http_headers *trailing_headers) {
@@ -889,15 +1660,73 @@ struct aws_http_stream *aws_http_connection_make_request(
         return NULL;
     }
 
+    if (options->http1_request_template && client_connection->http_version != AWS_HTTP_VERSION_1_1) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_CONNECTION,
+            "id=%p: Cannot create client request, HTTP/1.1 request template used on " PRInSTR " connection.",
+            (void *)client_connection,
+            AWS_BYTE_CURSOR_PRI(aws_http_version_to_str(client_connection->http_version)));
+        aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    if (options->content_decoding) {
+        if (!options->content_decoding->new_decoder || options->on_response_body_lease) {
+            AWS_LOGF_ERROR(
+                AWS_LS_HTTP_CONNECTION,
+                "id=%p: Cannot create client request, content decoding options are invalid.",
+                (void *)client_connection);
+            aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+            return NULL;
+        }
+
+        /* The connection reads the request's headers as it makes the stream */
+        if (aws_http_content_decoding_prepare_request(options->request, options->content_decoding)) {
+            return NULL;
+        }
+    }
+
+    /* Send a copy of the request, with its body read through the encoder */
+    struct aws_http_make_request_options encoded_options;
+    struct aws_http_message *encoded_request = NULL;
+    if (options->content_encoding) {
+        if (!options->content_encoding->new_encoder || options->content_encoding->content_coding.len == 0) {
+            AWS_LOGF_ERROR(
+                AWS_LS_HTTP_CONNECTION,
+                "id=%p: Cannot create client request, content encoding options are invalid.",
+                (void *)client_connection);
+            aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+            return NULL;
+        }
+
+        if (aws_http_message_get_body_stream(options->request)) {
+            encoded_request = aws_http_content_encoding_new_request(
+                client_connection->alloc, options->request, options->content_encoding);
+            if (!encoded_request) {
+                return NULL;
+            }
+
+            encoded_options = *options;
+            encoded_options.request = encoded_request;
+            options = &encoded_options;
+        }
+    }
+
     /* Connection owns stream, and must outlive stream */
     aws_http_connection_acquire(client_connection);
 
     struct aws_http_stream *stream = client_connection->vtable->make_request(client_connection, options);
+    aws_http_message_release(encoded_request);
     if (!stream) {
         aws_http_connection_release(client_connection);
         return NULL;
     }
 
+    if (options->content_decoding && aws_http_stream_content_decoding_init(stream, options->content_decoding)) {
+        aws_http_stream_release(stream);
+        return NULL;
+    }
+
     return stream;
 }
 
@@ -1035,26 +1864,17 @@ struct aws_http_message *aws_http2_message_new_from_http1(
         aws_byte_buf_append_with_lookup(&lower_name_buf, &header_iter.name, aws_lookup_table_to_lower_get());
         struct aws_byte_cursor lower_name_cursor = aws_byte_cursor_from_buf(&lower_name_buf);
         enum aws_http_header_name name_enum = aws_http_lowercase_str_to_header_name(lower_name_cursor);
-        switch (name_enum) {
-            case AWS_HTTP_HEADER_TRANSFER_ENCODING:
-            case AWS_HTTP_HEADER_UPGRADE:
-            case AWS_HTTP_HEADER_KEEP_ALIVE:
-            case AWS_HTTP_HEADER_PROXY_CONNECTION:
-            case AWS_HTTP_HEADER_HOST:
-                /**
-                 * An intermediary transforming an HTTP/1.x message to HTTP/2 MUST remove connection-specific header
-                 * fields as discussed in Section 7.6.1 of [HTTP]. (RFC=9113 8.2.2)
-                 */
-                AWS_LOGF_TRACE(
-                    AWS_LS_HTTP_GENERAL,
-                    "Skip connection-specific headers - \"%.*s\" ",
-                    (int)lower_name_cursor.len,
-                    lower_name_cursor.ptr);
-                copy_header = false;
-                break;
-
-            default:
-                break;
+        if (aws_http_header_name_is_connection_specific(name_enum)) {
+            /**
+             * An intermediary transforming an HTTP/1.x message to HTTP/2 MUST remove connection-specific header
+             * fields as discussed in Section 7.6.1 of [HTTP]. (RFC=9113 8.2.2)
+             */
+            AWS_LOGF_TRACE(
+                AWS_LS_HTTP_GENERAL,
+                "Skip connection-specific headers - \"%.*s\" ",
+                (int)lower_name_cursor.len,
+                lower_name_cursor.ptr);
+            copy_header = false;
         }
         if (copy_header) {
             if (aws_http_headers_add(copied_headers, lower_name_cursor, header_iter.value)) {
@@ -1113,6 +1933,23 @@ int aws_http_stream_send_response(struct aws_http_stream *stream, struct aws_htt
     return stream->owning_connection->vtable->stream_send_response(stream, response);
 }
 
+int aws_http1_stream_send_static_response(
+    struct aws_http_stream *http1_stream,
+    const struct aws_http1_static_response *static_response) {
+    AWS_PRECONDITION(http1_stream);
+    AWS_PRECONDITION(http1_stream->vtable);
+    AWS_PRECONDITION(static_response);
+    if (!http1_stream->vtable->http1_send_static_response) {
+        AWS_LOGF_TRACE(
+            AWS_LS_HTTP_STREAM,
+            "id=%p: HTTP/1 stream only function invoked on other stream, ignoring call.",
+            (void *)http1_stream);
+        return aws_raise_error(AWS_ERROR_INVALID_STATE);
+    }
+
+    return http1_stream->vtable->http1_send_static_response(http1_stream, static_response);
+}
+
 struct aws_http_stream *aws_http_stream_acquire(struct aws_http_stream *stream) {
     AWS_PRECONDITION(stream);
 
@@ -1135,6 +1972,7 @@ void aws_http_stream_release(struct aws_http_stream *stream) {
         aws_http_on_stream_destroy_fn *on_destroy_callback = stream->on_destroy;
 
         struct aws_http_connection *owning_connection = stream->owning_connection;
+        aws_http_stream_content_decoding_clean_up(stream);
         stream->vtable->destroy(stream);
 
         if (on_destroy_callback) {
@@ -1194,6 +2032,13 @@ int aws_http_stream_get_incoming_request_uri(const struct aws_http_stream *strea
 }
 
 void aws_http_stream_update_window(struct aws_http_stream *stream, size_t increment_size) {
+    if (stream->content_decoding) {
+        /* The user counts decoded bytes, the window is in encoded bytes */
+        increment_size = aws_http_stream_content_decoding_translate_window(stream, increment_size);
+        if (increment_size == 0) {
+            return;
+        }
+    }
     stream->vtable->update_window(stream, increment_size);
 }
 
@@ -1201,6 +2046,36 @@ uint32_t aws_http_stream_get_id(const struct aws_http_stream *stream) {
     return stream->id;
 }
 
+void aws_http_stream_get_metrics(const struct aws_http_stream *stream, struct aws_http_stream_metrics *out_metrics) {
+    AWS_PRECONDITION(stream);
+    AWS_PRECONDITION(out_metrics);
+    *out_metrics = stream->metrics;
+}
+
+void aws_http_stream_update_max_first_byte_latency(const struct aws_http_stream *stream, uint64_t *max_latency_ms) {
+    const struct aws_http_stream_metrics *metrics = &stream->metrics;
+    if (metrics->send_end_timestamp_ns == -1) {
+        return;
+    }
+
+    int64_t first_byte_timestamp_ns = metrics->receive_start_timestamp_ns;
+    if (first_byte_timestamp_ns == -1) {
+        uint64_t now_ns = 0;
+        aws_high_res_clock_get_ticks(&now_ns);
+        first_byte_timestamp_ns = (int64_t)now_ns;
+    }
+
+    /* Server streams receive before they send, there's nothing to measure */
+    if (first_byte_timestamp_ns > metrics->send_end_timestamp_ns) {
+        uint64_t latency_ms = aws_timestamp_convert(
+            (uint64_t)(first_byte_timestamp_ns - metrics->send_end_timestamp_ns),
+            AWS_TIMESTAMP_NANOS,
+            AWS_TIMESTAMP_MILLIS,
+            NULL);
+        *max_latency_ms = aws_max_u64(*max_latency_ms, latency_ms);
+    }
+}
+
 int aws_http2_stream_reset(struct aws_http_stream *http2_stream, uint32_t http2_error) {
     AWS_PRECONDITION(http2_stream);
     AWS_PRECONDITION(http2_stream->vtable);
@@ -21,6 +21,7 @@ void aws_crt_statistics_http1_channel_reset(struct aws_crt_statistics_http1_chan
     stats->pending_incoming_stream_ms = 0;
     stats->current_outgoing_stream_id = 0;
     stats->current_incoming_stream_id = 0;
+    stats->max_first_byte_latency_ms = 0;
 }
 
 void aws_crt_statistics_http2_channel_init(struct aws_crt_statistics_http2_channel *stats) {
@@ -32,4 +33,18 @@ void aws_crt_statistics_http2_channel_reset(struct aws_crt_statistics_http2_chan
     stats->pending_outgoing_stream_ms = 0;
     stats->pending_incoming_stream_ms = 0;
     stats->was_inactive = false;
+    AWS_ZERO_ARRAY(stats->frames_sent);
+    AWS_ZERO_ARRAY(stats->frames_received);
+    stats->data_bytes_sent = 0;
+    stats->data_bytes_received = 0;
+    stats->header_bytes_sent_compressed = 0;
+    stats->header_bytes_sent_uncompressed = 0;
+    stats->header_bytes_received_compressed = 0;
+    stats->header_bytes_received_uncompressed = 0;
+    stats->connection_window_stalled_ms = 0;
+    stats->stream_window_stalled_ms = 0;
+    AWS_ZERO_ARRAY(stats->rst_streams_sent);
+    AWS_ZERO_ARRAY(stats->rst_streams_received);
+    stats->max_first_byte_latency_ms = 0;
+    stats->max_ping_rtt_ms = 0;
 }
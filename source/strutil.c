@@ -2,6 +2,7 @@
  * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
  * SPDX-License-Identifier: Apache-2.0.
  */
+#include <aws/http/private/simd.h>
 #include <aws/http/private/strutil.h>
 
 static struct aws_byte_cursor s_trim(struct aws_byte_cursor cursor, const bool trim_table[256]) {
@@ -152,6 +153,53 @@ static const bool s_http_field_content_table[256] = {
     /* clang-format on */
 };
 
+/* Returns true if every char is legal field-content.
+ * Where the target has 128bit vectors, long values (ex: signatures, base64 tokens) are checked 16 bytes at a time.
+ * Outside of HTAB, field-content only forbids CTL (0x00-0x1F) and DEL (0x7F), which a vector compares directly. */
+static bool s_is_all_field_content(struct aws_byte_cursor cursor) {
+    size_t i = 0;
+
+#if defined(AWS_HTTP_SIMD_SSE2)
+    const __m128i ctl_max_vec = _mm_set1_epi8(0x1F);
+    const __m128i htab_vec = _mm_set1_epi8('\t');
+    const __m128i del_vec = _mm_set1_epi8(0x7F);
+    for (; cursor.len - i >= 16; i += 16) {
+        const __m128i chunk = _mm_loadu_si128((const __m128i *)(cursor.ptr + i));
+        /* SSE2 has no unsigned compare, but c <= max is the same as min(c, max) == c */
+        const __m128i is_ctl = _mm_cmpeq_epi8(_mm_min_epu8(chunk, ctl_max_vec), chunk);
+        const __m128i is_htab = _mm_cmpeq_epi8(chunk, htab_vec);
+        const __m128i is_del = _mm_cmpeq_epi8(chunk, del_vec);
+        const __m128i is_illegal = _mm_or_si128(_mm_andnot_si128(is_htab, is_ctl), is_del);
+        if (_mm_movemask_epi8(is_illegal) != 0) {
+            return false;
+        }
+    }
+#elif defined(AWS_HTTP_SIMD_NEON)
+    const uint8x16_t ctl_max_vec = vdupq_n_u8(0x1F);
+    const uint8x16_t htab_vec = vdupq_n_u8('\t');
+    const uint8x16_t del_vec = vdupq_n_u8(0x7F);
+    for (; cursor.len - i >= 16; i += 16) {
+        const uint8x16_t chunk = vld1q_u8(cursor.ptr + i);
+        const uint8x16_t is_ctl = vcleq_u8(chunk, ctl_max_vec);
+        const uint8x16_t is_htab = vceqq_u8(chunk, htab_vec);
+        const uint8x16_t is_del = vceqq_u8(chunk, del_vec);
+        const uint8x16_t is_illegal = vorrq_u8(vbicq_u8(is_ctl, is_htab), is_del);
+        if (aws_http_neon_nibble_mask(is_illegal) != 0) {
+            return false;
+        }
+    }
+#endif
+
+    for (; i < cursor.len; ++i) {
+        const uint8_t c = cursor.ptr[i];
+        if (s_http_field_content_table[c] == false) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 /**
  * From RFC7230 section 3.2:
  * field-value    = *( field-content / obs-fold )
@@ -172,15 +220,7 @@ bool aws_strutil_is_http_field_value(struct aws_byte_cursor cursor) {
     }
 
     /* ensure every char is legal field-content */
-    size_t i = 0;
-    do {
-        const uint8_t c = cursor.ptr[i++];
-        if (s_http_field_content_table[c] == false) {
-            return false;
-        }
-    } while (i < cursor.len);
-
-    return true;
+    return s_is_all_field_content(cursor);
 }
 
 /**
@@ -190,14 +230,8 @@ bool aws_strutil_is_http_field_value(struct aws_byte_cursor cursor) {
  * obs-text       = %x80-FF
  */
 bool aws_strutil_is_http_reason_phrase(struct aws_byte_cursor cursor) {
-    for (size_t i = 0; i < cursor.len; ++i) {
-        const uint8_t c = cursor.ptr[i];
-        /* the field-content table happens to allow the exact same characters as reason-phrase */
-        if (s_http_field_content_table[c] == false) {
-            return false;
-        }
-    }
-    return true;
+    /* the field-content table happens to allow the exact same characters as reason-phrase */
+    return s_is_all_field_content(cursor);
 }
 
 bool aws_strutil_is_http_request_target(struct aws_byte_cursor cursor) {
@@ -208,13 +242,32 @@ bool aws_strutil_is_http_request_target(struct aws_byte_cursor cursor) {
     /* TODO: Actually check the complete grammar as defined in RFC7230 5.3 and
      * RFC3986. Currently this just checks whether the sequence is blatantly illegal */
     size_t i = 0;
-    do {
-        const uint8_t c = cursor.ptr[i++];
+
+#if defined(AWS_HTTP_SIMD_SSE2)
+    const __m128i space_vec = _mm_set1_epi8(' ');
+    for (; cursor.len - i >= 16; i += 16) {
+        const __m128i chunk = _mm_loadu_si128((const __m128i *)(cursor.ptr + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(chunk, space_vec), chunk)) != 0) {
+            return false;
+        }
+    }
+#elif defined(AWS_HTTP_SIMD_NEON)
+    const uint8x16_t space_vec = vdupq_n_u8(' ');
+    for (; cursor.len - i >= 16; i += 16) {
+        const uint8x16_t chunk = vld1q_u8(cursor.ptr + i);
+        if (aws_http_neon_nibble_mask(vcleq_u8(chunk, space_vec)) != 0) {
+            return false;
+        }
+    }
+#endif
+
+    for (; i < cursor.len; ++i) {
+        const uint8_t c = cursor.ptr[i];
         /* everything <= ' ' is non-visible ascii*/
         if (c <= ' ') {
             return false;
         }
-    } while (i < cursor.len);
+    }
 
     return true;
 }
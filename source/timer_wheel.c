@@ -0,0 +1,222 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/private/timer_wheel.h>
+
+#include <aws/common/clock.h>
+#include <aws/common/task_scheduler.h>
+#include <aws/io/event_loop.h>
+#include <aws/io/logging.h>
+
+/**
+ * A hashed timer wheel: entries are filed in the slot for the tick they expire on, modulo the number of slots.
+ * One task per event-loop walks the slots as time passes, so the cost of a timeout doesn't depend on
+ * how many connections are waiting on one.
+ */
+struct aws_http_timer_wheel {
+    struct aws_allocator *allocator;
+    struct aws_event_loop *event_loop;
+    struct aws_task tick_task;
+    bool is_tick_task_scheduled;
+    /* Every slot up to and including this tick has been processed */
+    uint64_t current_tick;
+    size_t num_entries;
+    struct aws_linked_list slots[AWS_HTTP_TIMER_WHEEL_NUM_SLOTS];
+};
+
+/* Only its address matters, it's the key for the event-loop's local object */
+static int s_timer_wheel_local_object_key;
+
+static uint64_t s_tick_ns(void) {
+    return aws_timestamp_convert(AWS_HTTP_TIMER_WHEEL_TICK_MS, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+}
+
+static uint64_t s_now_ns(const struct aws_http_timer_wheel *wheel) {
+    uint64_t now_ns = 0;
+    aws_event_loop_current_clock_time(wheel->event_loop, &now_ns);
+    return now_ns;
+}
+
+/* Round up, so an entry never expires early. Ticks already processed are too late, use the next one */
+static uint64_t s_tick_for_deadline(const struct aws_http_timer_wheel *wheel, uint64_t deadline_ns) {
+    const uint64_t tick_ns = s_tick_ns();
+    uint64_t tick = deadline_ns / tick_ns + (deadline_ns % tick_ns != 0);
+    return aws_max_u64(tick, wheel->current_tick + 1);
+}
+
+static void s_file_entry(struct aws_http_timer_wheel *wheel, struct aws_http_timer_wheel_entry *entry, uint64_t tick) {
+    entry->filed_tick = tick;
+    aws_linked_list_push_back(&wheel->slots[tick % AWS_HTTP_TIMER_WHEEL_NUM_SLOTS], &entry->node);
+}
+
+static void s_tick_task(struct aws_task *task, void *arg, enum aws_task_status status);
+
+static void s_schedule_tick_task(struct aws_http_timer_wheel *wheel) {
+    wheel->is_tick_task_scheduled = true;
+    uint64_t run_at_ns = aws_mul_u64_saturating(wheel->current_tick + 1, s_tick_ns());
+    aws_event_loop_schedule_task_future(wheel->event_loop, &wheel->tick_task, run_at_ns);
+}
+
+static void s_process_slot(struct aws_http_timer_wheel *wheel, uint64_t tick, uint64_t now_ns) {
+    /* Move the slot's entries aside, so entries filed back into this slot aren't visited twice */
+    struct aws_linked_list due;
+    aws_linked_list_init(&due);
+    aws_linked_list_swap_contents(&due, &wheel->slots[tick % AWS_HTTP_TIMER_WHEEL_NUM_SLOTS]);
+
+    while (!aws_linked_list_empty(&due)) {
+        struct aws_linked_list_node *node = aws_linked_list_pop_front(&due);
+        struct aws_http_timer_wheel_entry *entry = AWS_CONTAINER_OF(node, struct aws_http_timer_wheel_entry, node);
+
+        if (entry->deadline_ns > now_ns) {
+            /* Deadline was pushed back since the entry was filed, or it's waiting out more turns of the wheel */
+            s_file_entry(wheel, entry, s_tick_for_deadline(wheel, entry->deadline_ns));
+            continue;
+        }
+
+        entry->deadline_ns = 0;
+        --wheel->num_entries;
+        entry->on_expired(entry, entry->user_data);
+    }
+}
+
+static void s_tick_task(struct aws_task *task, void *arg, enum aws_task_status status) {
+    (void)task;
+    struct aws_http_timer_wheel *wheel = arg;
+    wheel->is_tick_task_scheduled = false;
+    if (status != AWS_TASK_STATUS_RUN_READY) {
+        return;
+    }
+
+    uint64_t now_ns = s_now_ns(wheel);
+    uint64_t now_tick = now_ns / s_tick_ns();
+
+    /* If the event-loop stalled for more than a turn, one turn still visits every entry */
+    if (now_tick > wheel->current_tick + AWS_HTTP_TIMER_WHEEL_NUM_SLOTS) {
+        wheel->current_tick = now_tick - AWS_HTTP_TIMER_WHEEL_NUM_SLOTS;
+    }
+
+    while (wheel->current_tick < now_tick) {
+        ++wheel->current_tick;
+        s_process_slot(wheel, wheel->current_tick, now_ns);
+    }
+
+    /* Callbacks may have scheduled the task already */
+    if (wheel->num_entries > 0 && !wheel->is_tick_task_scheduled) {
+        s_schedule_tick_task(wheel);
+    }
+}
+
+static void s_timer_wheel_destroy(struct aws_http_timer_wheel *wheel) {
+    /* Anything still filed belongs to channels on this event-loop, which are gone by now */
+    aws_mem_release(wheel->allocator, wheel);
+}
+
+static void s_on_local_object_removed(struct aws_event_loop_local_object *object) {
+    s_timer_wheel_destroy(object->object);
+}
+
+struct aws_http_timer_wheel *aws_http_timer_wheel_get(struct aws_event_loop *event_loop) {
+    AWS_PRECONDITION(event_loop);
+    AWS_PRECONDITION(aws_event_loop_thread_is_callers_thread(event_loop));
+
+    struct aws_event_loop_local_object local_object;
+    if (aws_event_loop_fetch_local_object(event_loop, &s_timer_wheel_local_object_key, &local_object) ==
+        AWS_OP_SUCCESS) {
+        return local_object.object;
+    }
+
+    struct aws_http_timer_wheel *wheel = aws_mem_calloc(event_loop->alloc, 1, sizeof(struct aws_http_timer_wheel));
+    wheel->allocator = event_loop->alloc;
+    wheel->event_loop = event_loop;
+    aws_task_init(&wheel->tick_task, s_tick_task, wheel, "http_timer_wheel_tick");
+    for (size_t i = 0; i < AWS_HTTP_TIMER_WHEEL_NUM_SLOTS; ++i) {
+        aws_linked_list_init(&wheel->slots[i]);
+    }
+
+    local_object.key = &s_timer_wheel_local_object_key;
+    local_object.object = wheel;
+    local_object.on_object_removed = s_on_local_object_removed;
+    if (aws_event_loop_put_local_object(event_loop, &local_object)) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_GENERAL,
+            "id=%p: Failed to store timer wheel on event-loop, error %d (%s).",
+            (void *)event_loop,
+            aws_last_error(),
+            aws_error_name(aws_last_error()));
+        s_timer_wheel_destroy(wheel);
+        return NULL;
+    }
+
+    return wheel;
+}
+
+void aws_http_timer_wheel_entry_init(
+    struct aws_http_timer_wheel_entry *entry,
+    aws_http_timer_wheel_on_expired_fn *on_expired,
+    void *user_data) {
+
+    AWS_PRECONDITION(entry);
+    AWS_PRECONDITION(on_expired);
+    AWS_ZERO_STRUCT(*entry);
+    entry->on_expired = on_expired;
+    entry->user_data = user_data;
+}
+
+void aws_http_timer_wheel_schedule(
+    struct aws_http_timer_wheel *wheel,
+    struct aws_http_timer_wheel_entry *entry,
+    uint64_t deadline_ns) {
+
+    AWS_PRECONDITION(wheel);
+    AWS_PRECONDITION(entry);
+    AWS_PRECONDITION(aws_event_loop_thread_is_callers_thread(wheel->event_loop));
+
+    /* Zero means unarmed */
+    deadline_ns = aws_max_u64(deadline_ns, 1);
+
+    if (!wheel->is_tick_task_scheduled) {
+        /* Wheel was idle, no need to catch up on the ticks it slept through */
+        wheel->current_tick = s_now_ns(wheel) / s_tick_ns();
+    }
+
+    uint64_t tick = s_tick_for_deadline(wheel, deadline_ns);
+    if (entry->deadline_ns != 0) {
+        if (tick >= entry->filed_tick) {
+            /* Later than the slot it's in. It moves when that slot comes around */
+            entry->deadline_ns = deadline_ns;
+            return;
+        }
+        aws_linked_list_remove(&entry->node);
+    } else {
+        ++wheel->num_entries;
+    }
+
+    entry->deadline_ns = deadline_ns;
+    s_file_entry(wheel, entry, tick);
+
+    if (!wheel->is_tick_task_scheduled) {
+        s_schedule_tick_task(wheel);
+    }
+}
+
+void aws_http_timer_wheel_cancel(struct aws_http_timer_wheel *wheel, struct aws_http_timer_wheel_entry *entry) {
+    AWS_PRECONDITION(wheel);
+    AWS_PRECONDITION(entry);
+    AWS_PRECONDITION(aws_event_loop_thread_is_callers_thread(wheel->event_loop));
+
+    if (entry->deadline_ns == 0) {
+        return;
+    }
+
+    aws_linked_list_remove(&entry->node);
+    entry->deadline_ns = 0;
+    --wheel->num_entries;
+    /* The tick task stops itself once the wheel is empty */
+}
+
+bool aws_http_timer_wheel_entry_is_armed(const struct aws_http_timer_wheel_entry *entry) {
+    AWS_PRECONDITION(entry);
+    return entry->deadline_ns != 0;
+}
@@ -0,0 +1,62 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/private/tracing_impl.h>
+
+#ifdef AWS_HTTP_HAVE_SYS_SDT_H
+#    include <sys/sdt.h>
+#endif
+
+static const char *s_trace_event_names[AWS_HTTP_TRACE_EVENT_COUNT] = {
+    [AWS_HTTP_TRACE_STREAM_ACTIVATE] = "STREAM_ACTIVATE",
+    [AWS_HTTP_TRACE_STREAM_COMPLETE] = "STREAM_COMPLETE",
+    [AWS_HTTP_TRACE_H1_HEAD_ENCODED] = "H1_HEAD_ENCODED",
+    [AWS_HTTP_TRACE_H1_HEAD_DECODED] = "H1_HEAD_DECODED",
+    [AWS_HTTP_TRACE_H2_FRAME_ENCODED] = "H2_FRAME_ENCODED",
+    [AWS_HTTP_TRACE_H2_FRAME_DECODED] = "H2_FRAME_DECODED",
+    [AWS_HTTP_TRACE_CONNECTION_ACQUIRED] = "CONNECTION_ACQUIRED",
+    [AWS_HTTP_TRACE_CONNECTION_RELEASED] = "CONNECTION_RELEASED",
+    [AWS_HTTP_TRACE_WINDOW_STALL_BEGIN] = "WINDOW_STALL_BEGIN",
+    [AWS_HTTP_TRACE_WINDOW_STALL_END] = "WINDOW_STALL_END",
+};
+
+const char *aws_http_trace_event_to_str(enum aws_http_trace_event event) {
+    if ((size_t)event < AWS_HTTP_TRACE_EVENT_COUNT) {
+        return s_trace_event_names[event];
+    }
+    return "UNKNOWN";
+}
+
+#ifdef AWS_HTTP_ENABLE_TRACING
+
+static aws_http_trace_fn *s_trace_fn;
+static void *s_trace_user_data;
+
+int aws_http_set_trace_callback(aws_http_trace_fn *trace_fn, void *user_data) {
+    s_trace_fn = trace_fn;
+    s_trace_user_data = user_data;
+    return AWS_OP_SUCCESS;
+}
+
+void aws_http_trace(enum aws_http_trace_event event, const void *id, uint64_t arg1, uint64_t arg2) {
+#    ifdef AWS_HTTP_HAVE_SYS_SDT_H
+    DTRACE_PROBE4(aws_c_http, trace, (int)event, id, arg1, arg2);
+#    endif
+
+    aws_http_trace_fn *trace_fn = s_trace_fn;
+    if (trace_fn) {
+        trace_fn(event, id, arg1, arg2, s_trace_user_data);
+    }
+}
+
+#else /* !AWS_HTTP_ENABLE_TRACING */
+
+int aws_http_set_trace_callback(aws_http_trace_fn *trace_fn, void *user_data) {
+    (void)trace_fn;
+    (void)user_data;
+    return aws_raise_error(AWS_ERROR_UNSUPPORTED_OPERATION);
+}
+
+#endif /* AWS_HTTP_ENABLE_TRACING */
@@ -6,8 +6,10 @@
 #include <aws/http/private/websocket_impl.h>
 
 #include <aws/common/atomics.h>
+#include <aws/common/clock.h>
 #include <aws/common/device_random.h>
 #include <aws/common/encoding.h>
+#include <aws/common/math.h>
 #include <aws/common/mutex.h>
 #include <aws/common/ref_count.h>
 #include <aws/http/private/websocket_decoder.h>
@@ -24,9 +26,62 @@
 
 /* TODO: If something goes wrong during normal shutdown, do I change the error_code? */
 
+enum {
+    /* Idle outgoing_frames kept for reuse, per websocket */
+    OUTGOING_FRAME_POOL_MAX_FREE_COUNT = 32,
+
+    /* Incoming message buffers come in power-of-2 size classes, from 4KiB to 1MiB.
+     * Bigger buffers are allocated to fit, and freed when released. */
+    INCOMING_MESSAGE_POOL_MIN_BUFFER_SIZE = 4 * 1024,
+    INCOMING_MESSAGE_POOL_SIZE_CLASS_COUNT = 9,
+    /* Idle buffers kept for reuse, per size class */
+    INCOMING_MESSAGE_POOL_MAX_FREE_COUNT = 4,
+
+    DEFAULT_MAX_INCOMING_MESSAGE_SIZE = 16 * 1024 * 1024,
+};
+
 struct outgoing_frame {
     struct aws_websocket_send_frame_options def;
     struct aws_linked_list_node node;
+    /* Once the frame is completely written, this is the aws_io_message it finished in */
+    struct aws_io_message *io_msg;
+    /* How much of def.shared_payload has been written */
+    size_t shared_payload_offset;
+};
+
+struct aws_websocket_shared_payload {
+    struct aws_allocator *allocator;
+    struct aws_ref_count ref_count;
+    struct aws_http_body_segment segment;
+};
+
+/* An aws_io_message whose data is the memory of a shared payload, rather than memory from the channel's message pool.
+ * Whoever finishes with it frees it via aws_mem_release(message->allocator, message), like any other message. */
+struct aws_websocket_shared_payload_message {
+    struct aws_io_message base;
+    struct aws_websocket_shared_payload *payload;
+};
+
+/* Recycles the buffers of messages assembled for on_incoming_message.
+ * Messages can be released from any thread, even after the websocket is destroyed,
+ * so the pool has a lock, and is ref-counted by the websocket and every message that isn't idle in the pool. */
+struct aws_websocket_incoming_message_pool {
+    struct aws_allocator *allocator;
+    struct aws_ref_count ref_count;
+    struct aws_mutex lock;
+    /* Idle `struct aws_websocket_pooled_message`, per size class */
+    struct aws_linked_list free_lists[INCOMING_MESSAGE_POOL_SIZE_CLASS_COUNT];
+    size_t free_counts[INCOMING_MESSAGE_POOL_SIZE_CLASS_COUNT];
+};
+
+struct aws_websocket_pooled_message {
+    struct aws_websocket_incoming_message base;
+    struct aws_websocket_incoming_message_pool *pool;
+    struct aws_linked_list_node node;
+    /* Index of the buffer's size class, or INCOMING_MESSAGE_POOL_SIZE_CLASS_COUNT if it's too big to pool */
+    size_t size_class;
+    /* Storage was allocated along with the message */
+    struct aws_byte_buf buf;
 };
 
 struct aws_websocket {
@@ -41,13 +96,21 @@ struct aws_websocket {
     aws_websocket_on_incoming_frame_begin_fn *on_incoming_frame_begin;
     aws_websocket_on_incoming_frame_payload_fn *on_incoming_frame_payload;
     aws_websocket_on_incoming_frame_complete_fn *on_incoming_frame_complete;
+    aws_websocket_on_incoming_message_fn *on_incoming_message;
+    size_t max_incoming_message_size;
+    /* NULL unless on_incoming_message is set */
+    struct aws_websocket_incoming_message_pool *incoming_message_pool;
 
     struct aws_channel_task move_synced_data_to_thread_task;
     struct aws_channel_task shutdown_channel_task;
     struct aws_channel_task increment_read_window_task;
     struct aws_channel_task waiting_on_payload_stream_task;
     struct aws_channel_task close_timeout_task;
+    struct aws_channel_task write_coalescing_task;
     bool is_server;
+    bool permessage_deflate;
+    size_t max_write_messages_in_flight;
+    uint64_t write_coalescing_delay_ns;
 
     /* Data that should only be accessed from the websocket's channel thread. */
     struct {
@@ -60,8 +123,9 @@ struct aws_websocket {
         struct outgoing_frame *current_outgoing_frame;
 
         /*
-         * list of outbound frames that have been completely written to the io message heading to the socket.
-         * When the socket write completes we can in turn invoke completion callbacks for all of these frames
+         * list of outbound frames that have been completely written to the io messages heading to the socket,
+         * in the order they were written. When a socket write completes we can in turn invoke completion callbacks
+         * for all of the frames at the front of the list that finished in that io message.
          */
         struct aws_linked_list write_completion_frames;
 
@@ -76,6 +140,12 @@ struct aws_websocket {
         /* If current incoming frame is CONTINUATION, this is the data type it is a continuation of. */
         enum aws_websocket_opcode continuation_of_opcode;
 
+        /* Whether the current incoming data message is compressed, from the RSV1 bit of its first frame. */
+        bool is_incoming_message_compressed;
+
+        /* With on_incoming_message, the TEXT or BINARY message being put together. NULL between messages. */
+        struct aws_websocket_pooled_message *incoming_message;
+
         /* Amount to increment window after a channel message has been processed. */
         size_t incoming_message_window_update;
 
@@ -99,14 +169,21 @@ struct aws_websocket {
         int channel_shutdown_error_code;
         bool channel_shutdown_free_scarce_resources_immediately;
 
-        /* Wait until each aws_io_message is completely written to
-         * the socket before sending the next aws_io_message */
-        bool is_waiting_for_write_completion;
+        /* aws_io_messages sent to the socket that haven't completed yet.
+         * Once there are max_write_messages_in_flight, wait for one to complete before sending the next */
+        size_t write_messages_in_flight;
 
         /* If, while writing out data from a payload stream, we experience "read would block",
          * schedule a task to try again in the near-future. */
         bool is_waiting_on_payload_stream_task;
 
+        /* True while newly queued frames are held, waiting for write_coalescing_task */
+        bool is_write_coalescing_task_scheduled;
+
+        /* True when the rest of the current frame's shared payload is too big to copy,
+         * and is to be sent as its own aws_io_message. */
+        bool is_shared_payload_send_pending;
+
         /* True if this websocket is being used as a dumb mid-channel handler.
          * The websocket will no longer respond to its public API or invoke callbacks. */
         bool is_midchannel_handler;
@@ -118,6 +195,10 @@ struct aws_websocket {
 
         struct aws_linked_list outgoing_frame_list;
 
+        /* Idle outgoing_frames, so that sending lots of frames doesn't cost an allocation per frame */
+        struct aws_linked_list free_frame_list;
+        size_t free_frame_count;
+
         /* If non-zero, then increment_read_window_task is scheduled */
         size_t window_increment_size;
 
@@ -172,6 +253,8 @@ static int s_decoder_on_midchannel_payload(struct aws_websocket *websocket, stru
 static void s_destroy_outgoing_frame(struct aws_websocket *websocket, struct outgoing_frame *frame, int error_code);
 static void s_complete_frame_list(struct aws_websocket *websocket, struct aws_linked_list *frames, int error_code);
 static void s_complete_incoming_frame(struct aws_websocket *websocket, int error_code, bool *out_callback_result);
+static struct aws_websocket_incoming_message_pool *s_incoming_message_pool_new(struct aws_allocator *allocator);
+static void s_pooled_message_destroy(struct aws_websocket_pooled_message *message);
 static void s_finish_shutdown(struct aws_websocket *websocket);
 static void s_io_message_write_completed(
     struct aws_channel *channel,
@@ -189,11 +272,14 @@ static void s_increment_read_window_task(struct aws_channel_task *task, void *ar
 static void s_shutdown_channel_task(struct aws_channel_task *task, void *arg, enum aws_task_status status);
 static void s_waiting_on_payload_stream_task(struct aws_channel_task *task, void *arg, enum aws_task_status status);
 static void s_close_timeout_task(struct aws_channel_task *task, void *arg, enum aws_task_status status);
+static void s_write_coalescing_task(struct aws_channel_task *task, void *arg, enum aws_task_status status);
 static void s_schedule_channel_shutdown(struct aws_websocket *websocket, int error_code);
 static void s_shutdown_due_to_write_err(struct aws_websocket *websocket, int error_code);
 static void s_shutdown_due_to_read_err(struct aws_websocket *websocket, int error_code);
 static void s_stop_writing(struct aws_websocket *websocket, int send_frame_error_code);
 static void s_try_write_outgoing_frames(struct aws_websocket *websocket);
+static bool s_try_write_outgoing_io_message(struct aws_websocket *websocket);
+static bool s_try_send_shared_payload(struct aws_websocket *websocket);
 
 static struct aws_channel_handler_vtable s_channel_handler_vtable = {
     .process_read_message = s_handler_process_read_message,
@@ -276,8 +362,17 @@ struct aws_websocket *aws_websocket_handler_new(const struct aws_websocket_handl
     websocket->on_incoming_frame_begin = options->on_incoming_frame_begin;
     websocket->on_incoming_frame_payload = options->on_incoming_frame_payload;
     websocket->on_incoming_frame_complete = options->on_incoming_frame_complete;
+    websocket->on_incoming_message = options->on_incoming_message;
+    websocket->max_incoming_message_size = options->max_incoming_message_size > 0
+                                               ? options->max_incoming_message_size
+                                               : DEFAULT_MAX_INCOMING_MESSAGE_SIZE;
 
     websocket->is_server = options->is_server;
+    websocket->permessage_deflate = options->permessage_deflate;
+    websocket->max_write_messages_in_flight =
+        options->max_write_messages_in_flight > 0 ? options->max_write_messages_in_flight : 1;
+    websocket->write_coalescing_delay_ns = aws_timestamp_convert(
+        options->write_coalescing_delay_us, AWS_TIMESTAMP_MICROS, AWS_TIMESTAMP_NANOS, NULL);
 
     aws_channel_task_init(
         &websocket->move_synced_data_to_thread_task,
@@ -297,6 +392,8 @@ struct aws_websocket *aws_websocket_handler_new(const struct aws_websocket_handl
         websocket,
         "websocket_waiting_on_payload_stream");
     aws_channel_task_init(&websocket->close_timeout_task, s_close_timeout_task, websocket, "websocket_close_timeout");
+    aws_channel_task_init(
+        &websocket->write_coalescing_task, s_write_coalescing_task, websocket, "websocket_write_coalescing");
 
     aws_linked_list_init(&websocket->thread_data.outgoing_frame_list);
     aws_linked_list_init(&websocket->thread_data.write_completion_frames);
@@ -308,6 +405,7 @@ struct aws_websocket *aws_websocket_handler_new(const struct aws_websocket_handl
         &websocket->thread_data.decoder, options->allocator, s_decoder_on_frame, s_decoder_on_payload, websocket);
 
     aws_linked_list_init(&websocket->synced_data.outgoing_frame_list);
+    aws_linked_list_init(&websocket->synced_data.free_frame_list);
 
     err = aws_mutex_init(&websocket->synced_data.lock);
     if (err) {
@@ -320,6 +418,13 @@ struct aws_websocket *aws_websocket_handler_new(const struct aws_websocket_handl
         goto error;
     }
 
+    if (websocket->on_incoming_message) {
+        websocket->incoming_message_pool = s_incoming_message_pool_new(websocket->alloc);
+        if (!websocket->incoming_message_pool) {
+            goto error;
+        }
+    }
+
     err = aws_channel_slot_set_handler(slot, &websocket->channel_handler);
     if (err) {
         goto error;
@@ -349,6 +454,16 @@ static void s_handler_destroy(struct aws_channel_handler *handler) {
 
     aws_websocket_decoder_clean_up(&websocket->thread_data.decoder);
     aws_byte_buf_clean_up(&websocket->thread_data.incoming_ping_payload);
+    if (websocket->thread_data.incoming_message) {
+        s_pooled_message_destroy(websocket->thread_data.incoming_message);
+    }
+    if (websocket->incoming_message_pool) {
+        aws_ref_count_release(&websocket->incoming_message_pool->ref_count);
+    }
+    while (!aws_linked_list_empty(&websocket->synced_data.free_frame_list)) {
+        struct aws_linked_list_node *node = aws_linked_list_pop_front(&websocket->synced_data.free_frame_list);
+        aws_mem_release(websocket->alloc, AWS_CONTAINER_OF(node, struct outgoing_frame, node));
+    }
     aws_mutex_clean_up(&websocket->synced_data.lock);
     aws_mem_release(websocket->alloc, websocket);
 }
@@ -387,6 +502,18 @@ struct aws_channel *aws_websocket_get_channel(const struct aws_websocket *websoc
     return websocket->channel_slot->channel;
 }
 
+bool aws_websocket_is_open(struct aws_websocket *websocket) {
+    /* BEGIN CRITICAL SECTION */
+    s_lock_synced_data(websocket);
+    bool is_open = !websocket->synced_data.is_shutdown_channel_task_scheduled &&
+                   websocket->synced_data.send_frame_error_code == AWS_ERROR_SUCCESS &&
+                   !websocket->synced_data.is_midchannel_handler;
+    s_unlock_synced_data(websocket);
+    /* END CRITICAL SECTION */
+
+    return is_open;
+}
+
 int aws_websocket_convert_to_midchannel_handler(struct aws_websocket *websocket) {
     if (!aws_channel_thread_is_callers_thread(websocket->channel_slot->channel)) {
         AWS_LOGF_ERROR(
@@ -416,11 +543,59 @@ int aws_websocket_convert_to_midchannel_handler(struct aws_websocket *websocket)
         return aws_raise_error(AWS_ERROR_INVALID_STATE);
     }
 
+    if (websocket->permessage_deflate) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_WEBSOCKET,
+            "id=%p: Cannot convert to midchannel handler, payloads may be compressed with permessage-deflate.",
+            (void *)websocket);
+        return aws_raise_error(AWS_ERROR_INVALID_STATE);
+    }
+
     websocket->thread_data.is_midchannel_handler = true;
 
     return AWS_OP_SUCCESS;
 }
 
+static struct outgoing_frame *s_new_outgoing_frame(struct aws_websocket *websocket) {
+    struct outgoing_frame *frame = NULL;
+
+    /* BEGIN CRITICAL SECTION */
+    s_lock_synced_data(websocket);
+    if (!aws_linked_list_empty(&websocket->synced_data.free_frame_list)) {
+        struct aws_linked_list_node *node = aws_linked_list_pop_back(&websocket->synced_data.free_frame_list);
+        frame = AWS_CONTAINER_OF(node, struct outgoing_frame, node);
+        websocket->synced_data.free_frame_count--;
+    }
+    s_unlock_synced_data(websocket);
+    /* END CRITICAL SECTION */
+
+    if (frame) {
+        AWS_ZERO_STRUCT(*frame);
+        return frame;
+    }
+
+    return aws_mem_calloc(websocket->alloc, 1, sizeof(struct outgoing_frame));
+}
+
+/* Return frame to the pool, or free it if the pool is full */
+static void s_release_outgoing_frame(struct aws_websocket *websocket, struct outgoing_frame *frame) {
+    bool returned_to_pool = false;
+
+    /* BEGIN CRITICAL SECTION */
+    s_lock_synced_data(websocket);
+    if (websocket->synced_data.free_frame_count < OUTGOING_FRAME_POOL_MAX_FREE_COUNT) {
+        aws_linked_list_push_back(&websocket->synced_data.free_frame_list, &frame->node);
+        websocket->synced_data.free_frame_count++;
+        returned_to_pool = true;
+    }
+    s_unlock_synced_data(websocket);
+    /* END CRITICAL SECTION */
+
+    if (!returned_to_pool) {
+        aws_mem_release(websocket->alloc, frame);
+    }
+}
+
 static int s_send_frame(
     struct aws_websocket *websocket,
     const struct aws_websocket_send_frame_options *options,
@@ -430,7 +605,22 @@ static int s_send_frame(
     AWS_ASSERT(options);
 
     /* Check for bad input. Log about non-obvious errors. */
-    if (options->payload_length > 0 && !options->stream_outgoing_payload) {
+    if (options->shared_payload) {
+        if (options->stream_outgoing_payload) {
+            AWS_LOGF_ERROR(
+                AWS_LS_HTTP_WEBSOCKET,
+                "id=%p: Invalid frame options, cannot use both a shared payload and a payload streaming function.",
+                (void *)websocket);
+            return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+        }
+        if (options->payload_length != options->shared_payload->segment.data.len) {
+            AWS_LOGF_ERROR(
+                AWS_LS_HTTP_WEBSOCKET,
+                "id=%p: Invalid frame options, payload length does not match shared payload.",
+                (void *)websocket);
+            return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+        }
+    } else if (options->payload_length > 0 && !options->stream_outgoing_payload) {
         AWS_LOGF_ERROR(
             AWS_LS_HTTP_WEBSOCKET,
             "id=%p: Invalid frame options, payload streaming function required when payload length is non-zero.",
@@ -438,12 +628,31 @@ static int s_send_frame(
         return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
     }
 
-    struct outgoing_frame *frame = aws_mem_calloc(websocket->alloc, 1, sizeof(struct outgoing_frame));
+    /* RFC-7692 Section 6 - Only the first frame of a data message may have the RSV1 bit set */
+    if (options->compressed) {
+        if (!websocket->permessage_deflate) {
+            AWS_LOGF_ERROR(
+                AWS_LS_HTTP_WEBSOCKET,
+                "id=%p: Invalid frame options, cannot send compressed frame without permessage-deflate.",
+                (void *)websocket);
+            return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+        }
+        if (options->opcode != AWS_WEBSOCKET_OPCODE_TEXT && options->opcode != AWS_WEBSOCKET_OPCODE_BINARY) {
+            AWS_LOGF_ERROR(
+                AWS_LS_HTTP_WEBSOCKET,
+                "id=%p: Invalid frame options, only the first frame of a TEXT or BINARY message can be compressed.",
+                (void *)websocket);
+            return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+        }
+    }
+
+    struct outgoing_frame *frame = s_new_outgoing_frame(websocket);
     if (!frame) {
         return AWS_OP_ERR;
     }
 
     frame->def = *options;
+    aws_websocket_shared_payload_acquire(frame->def.shared_payload);
 
     /* Enqueue frame, unless no further sending is allowed. */
     int send_error = 0;
@@ -475,7 +684,8 @@ static int s_send_frame(
             send_error,
             aws_error_name(send_error));
 
-        aws_mem_release(websocket->alloc, frame);
+        aws_websocket_shared_payload_release(frame->def.shared_payload);
+        s_release_outgoing_frame(websocket, frame);
         return aws_raise_error(send_error);
     }
 
@@ -500,6 +710,85 @@ int aws_websocket_send_frame(struct aws_websocket *websocket, const struct aws_w
     return s_send_frame(websocket, options, true);
 }
 
+static void s_shared_payload_on_refcount_zero(void *user_data) {
+    struct aws_websocket_shared_payload *payload = user_data;
+    if (payload->segment.on_release) {
+        payload->segment.on_release(payload->segment.user_data);
+    }
+    aws_mem_release(payload->allocator, payload);
+}
+
+struct aws_websocket_shared_payload *aws_websocket_shared_payload_new(
+    struct aws_allocator *allocator,
+    const struct aws_http_body_segment *segment) {
+
+    AWS_PRECONDITION(allocator);
+    AWS_PRECONDITION(segment);
+
+    struct aws_websocket_shared_payload *payload =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_websocket_shared_payload));
+    payload->allocator = allocator;
+    aws_ref_count_init(&payload->ref_count, payload, s_shared_payload_on_refcount_zero);
+    payload->segment = *segment;
+    return payload;
+}
+
+struct aws_websocket_shared_payload *aws_websocket_shared_payload_acquire(
+    struct aws_websocket_shared_payload *payload) {
+    if (payload) {
+        aws_ref_count_acquire(&payload->ref_count);
+    }
+    return payload;
+}
+
+void aws_websocket_shared_payload_release(struct aws_websocket_shared_payload *payload) {
+    if (payload) {
+        aws_ref_count_release(&payload->ref_count);
+    }
+}
+
+/* Write newly queued frames, unless they should be held to coalesce with frames queued soon after */
+static void s_on_outgoing_frames_queued(struct aws_websocket *websocket) {
+    /* Don't hold frames once shutdown has begun, the CLOSE frame should go out ASAP */
+    if (websocket->write_coalescing_delay_ns == 0 ||
+        websocket->thread_data.is_shutting_down_and_waiting_for_close_frame_to_be_written) {
+        s_try_write_outgoing_frames(websocket);
+        return;
+    }
+
+    /* If a write is in flight, its completion will pick up these frames along with anything else queued by then */
+    if (websocket->thread_data.write_messages_in_flight > 0 ||
+        websocket->thread_data.is_write_coalescing_task_scheduled) {
+        return;
+    }
+
+    uint64_t now_ns = 0;
+    aws_channel_current_clock_time(websocket->channel_slot->channel, &now_ns);
+
+    AWS_LOGF_TRACE(
+        AWS_LS_HTTP_WEBSOCKET,
+        "id=%p: Delaying write by %" PRIu64 "ns to coalesce frames.",
+        (void *)websocket,
+        websocket->write_coalescing_delay_ns);
+
+    websocket->thread_data.is_write_coalescing_task_scheduled = true;
+    aws_channel_schedule_task_future(
+        websocket->channel_slot->channel,
+        &websocket->write_coalescing_task,
+        now_ns + websocket->write_coalescing_delay_ns);
+}
+
+static void s_write_coalescing_task(struct aws_channel_task *task, void *arg, enum aws_task_status status) {
+    (void)task;
+    if (status != AWS_TASK_STATUS_RUN_READY) {
+        return;
+    }
+
+    struct aws_websocket *websocket = arg;
+    websocket->thread_data.is_write_coalescing_task_scheduled = false;
+    s_try_write_outgoing_frames(websocket);
+}
+
 static void s_move_synced_data_to_thread_task(struct aws_channel_task *task, void *arg, enum aws_task_status status) {
     (void)task;
     if (status != AWS_TASK_STATUS_RUN_READY) {
@@ -522,11 +811,18 @@ static void s_move_synced_data_to_thread_task(struct aws_channel_task *task, voi
 
     if (!aws_linked_list_empty(&tmp_list)) {
         aws_linked_list_move_all_back(&websocket->thread_data.outgoing_frame_list, &tmp_list);
-        s_try_write_outgoing_frames(websocket);
+        s_on_outgoing_frames_queued(websocket);
     }
 }
 
 static void s_try_write_outgoing_frames(struct aws_websocket *websocket) {
+    /* Keep sending aws_io_messages until there's nothing to send, or no room for more in flight */
+    while (s_try_write_outgoing_io_message(websocket)) {
+    }
+}
+
+/* Fill one aws_io_message with outgoing frames and send it. Returns true if a message was sent */
+static bool s_try_write_outgoing_io_message(struct aws_websocket *websocket) {
     AWS_ASSERT(aws_channel_thread_is_callers_thread(websocket->channel_slot->channel));
     int err;
 
@@ -535,20 +831,24 @@ static void s_try_write_outgoing_frames(struct aws_websocket *websocket) {
         aws_linked_list_empty(&websocket->thread_data.outgoing_frame_list)) {
 
         AWS_LOGF_TRACE(AWS_LS_HTTP_WEBSOCKET, "id=%p: No data to write at this time.", (void *)websocket);
-        return;
+        return false;
     }
 
-    if (websocket->thread_data.is_waiting_for_write_completion) {
+    if (websocket->thread_data.write_messages_in_flight >= websocket->max_write_messages_in_flight) {
         AWS_LOGF_TRACE(
             AWS_LS_HTTP_WEBSOCKET,
             "id=%p: Waiting until outstanding aws_io_message is written to socket before sending more data.",
             (void *)websocket);
-        return;
+        return false;
     }
 
     if (websocket->thread_data.is_writing_stopped) {
         AWS_LOGF_TRACE(AWS_LS_HTTP_WEBSOCKET, "id=%p: Websocket is no longer sending data.", (void *)websocket);
-        return;
+        return false;
+    }
+
+    if (websocket->thread_data.is_shared_payload_send_pending) {
+        return s_try_send_shared_payload(websocket);
     }
 
     /* Acquire aws_io_message */
@@ -591,6 +891,7 @@ static void s_try_write_outgoing_frames(struct aws_websocket *websocket) {
 
             struct aws_websocket_frame frame = {
                 .fin = websocket->thread_data.current_outgoing_frame->def.fin,
+                .rsv = {websocket->thread_data.current_outgoing_frame->def.compressed},
                 .opcode = websocket->thread_data.current_outgoing_frame->def.opcode,
                 .payload_length = websocket->thread_data.current_outgoing_frame->def.payload_length,
             };
@@ -661,6 +962,7 @@ static void s_try_write_outgoing_frames(struct aws_websocket *websocket) {
          * a completely-written frame gets added to the write completion list so that when the socket write completes
          * we can complete all of the outbound frames that were finished as part of the io message
          */
+        websocket->thread_data.current_outgoing_frame->io_msg = io_msg;
         aws_linked_list_push_back(
             &websocket->thread_data.write_completion_frames, &websocket->thread_data.current_outgoing_frame->node);
 
@@ -671,6 +973,13 @@ static void s_try_write_outgoing_frames(struct aws_websocket *websocket) {
         }
     }
 
+    /* The frame's header might have filled the previous aws_io_message,
+     * leaving nothing for this one but a shared payload that's sent on its own. */
+    if (io_msg->message_data.len == 0 && websocket->thread_data.is_shared_payload_send_pending) {
+        aws_mem_release(io_msg->allocator, io_msg);
+        return s_try_send_shared_payload(websocket);
+    }
+
     /* If payload stream didn't have any bytes available to read right now, then the aws_io_message might be empty.
      * If this is the case schedule a task to try again in the future. */
     if (io_msg->message_data.len == 0) {
@@ -688,7 +997,7 @@ static void s_try_write_outgoing_frames(struct aws_websocket *websocket) {
         }
 
         aws_mem_release(io_msg->allocator, io_msg);
-        return;
+        return false;
     }
 
     /* Prepare to send aws_io_message up the channel. */
@@ -704,10 +1013,11 @@ static void s_try_write_outgoing_frames(struct aws_websocket *websocket) {
         (void *)websocket,
         io_msg->message_data.len);
 
-    websocket->thread_data.is_waiting_for_write_completion = true;
+    /* Count it first, in case it completes synchronously */
+    websocket->thread_data.write_messages_in_flight++;
     err = aws_channel_slot_send_message(websocket->channel_slot, io_msg, AWS_CHANNEL_DIR_WRITE);
     if (err) {
-        websocket->thread_data.is_waiting_for_write_completion = false;
+        websocket->thread_data.write_messages_in_flight--;
         AWS_LOGF_ERROR(
             AWS_LS_HTTP_WEBSOCKET,
             "id=%p: Failed to send message in write direction, error %d (%s).",
@@ -725,7 +1035,7 @@ static void s_try_write_outgoing_frames(struct aws_websocket *websocket) {
         s_finish_shutdown(websocket);
     }
 
-    return;
+    return true;
 
 error:
     if (io_msg) {
@@ -733,6 +1043,114 @@ error:
     }
 
     s_shutdown_due_to_write_err(websocket, aws_last_error());
+    return false;
+}
+
+static void s_shared_payload_message_write_completed(
+    struct aws_channel *channel,
+    struct aws_io_message *message,
+    int err_code,
+    void *user_data) {
+
+    struct aws_websocket_shared_payload_message *payload_msg =
+        AWS_CONTAINER_OF(message, struct aws_websocket_shared_payload_message, base);
+
+    /* Whether or not the write succeeded, the channel is done with the payload's memory */
+    aws_websocket_shared_payload_release(payload_msg->payload);
+    payload_msg->payload = NULL;
+
+    s_io_message_write_completed(channel, message, err_code, user_data);
+}
+
+/* Send the rest of the current frame's shared payload down the channel without copying it.
+ * Returns true if a message was sent */
+static bool s_try_send_shared_payload(struct aws_websocket *websocket) {
+    struct outgoing_frame *frame = websocket->thread_data.current_outgoing_frame;
+    AWS_ASSERT(frame && frame->def.shared_payload);
+
+    struct aws_byte_cursor data = frame->def.shared_payload->segment.data;
+    aws_byte_cursor_advance(&data, frame->shared_payload_offset);
+
+    struct aws_websocket_shared_payload_message *payload_msg =
+        aws_mem_calloc(websocket->alloc, 1, sizeof(struct aws_websocket_shared_payload_message));
+    payload_msg->payload = aws_websocket_shared_payload_acquire(frame->def.shared_payload);
+    payload_msg->base.allocator = websocket->alloc;
+    payload_msg->base.message_type = AWS_IO_MESSAGE_APPLICATION_DATA;
+    payload_msg->base.message_data = aws_byte_buf_from_array(data.ptr, data.len);
+    payload_msg->base.owning_channel = websocket->channel_slot->channel;
+    payload_msg->base.on_completion = s_shared_payload_message_write_completed;
+    payload_msg->base.user_data = websocket;
+
+    if (aws_websocket_encoder_take_payload(&websocket->thread_data.encoder, data.len)) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_WEBSOCKET,
+            "id=%p: Frame encoding failed with error %d (%s).",
+            (void *)websocket,
+            aws_last_error(),
+            aws_error_name(aws_last_error()));
+        goto error;
+    }
+    AWS_ASSERT(!aws_websocket_encoder_is_frame_in_progress(&websocket->thread_data.encoder));
+
+    websocket->thread_data.is_shared_payload_send_pending = false;
+    frame->shared_payload_offset += data.len;
+    frame->io_msg = &payload_msg->base;
+    aws_linked_list_push_back(&websocket->thread_data.write_completion_frames, &frame->node);
+    websocket->thread_data.current_outgoing_frame = NULL;
+
+    AWS_LOGF_TRACE(
+        AWS_LS_HTTP_WEBSOCKET,
+        "id=%p: Sending %zu bytes of frame=%p payload without copying.",
+        (void *)websocket,
+        data.len,
+        (void *)frame);
+
+    /* Count it first, in case it completes synchronously */
+    websocket->thread_data.write_messages_in_flight++;
+    if (aws_channel_slot_send_message(websocket->channel_slot, &payload_msg->base, AWS_CHANNEL_DIR_WRITE)) {
+        websocket->thread_data.write_messages_in_flight--;
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_WEBSOCKET,
+            "id=%p: Failed to send message in write direction, error %d (%s).",
+            (void *)websocket,
+            aws_last_error(),
+            aws_error_name(aws_last_error()));
+        goto error;
+    }
+
+    return true;
+
+error:
+    aws_websocket_shared_payload_release(payload_msg->payload);
+    aws_mem_release(websocket->alloc, payload_msg);
+
+    s_shutdown_due_to_write_err(websocket, aws_last_error());
+    return false;
+}
+
+/* Copy from the current frame's shared payload, unless the rest of it should be sent without copying */
+static int s_stream_shared_payload(struct aws_websocket *websocket, struct aws_byte_buf *out_buf) {
+    struct outgoing_frame *current_frame = websocket->thread_data.current_outgoing_frame;
+
+    struct aws_byte_cursor data = current_frame->def.shared_payload->segment.data;
+    aws_byte_cursor_advance(&data, current_frame->shared_payload_offset);
+
+    size_t space_available = out_buf->capacity - out_buf->len;
+
+    /* Masked payloads must be copied. So must control frames, which are tiny, and may not be interleaved with the
+     * messages sent around them. Everything else that won't fit whole is left for s_try_send_shared_payload(). */
+    if (data.len > space_available && websocket->is_server &&
+        aws_websocket_is_data_frame(current_frame->def.opcode)) {
+        websocket->thread_data.is_shared_payload_send_pending = true;
+        return AWS_OP_SUCCESS;
+    }
+
+    if (data.len > space_available) {
+        data.len = space_available;
+    }
+    aws_byte_buf_write_from_whole_cursor(out_buf, data);
+    current_frame->shared_payload_offset += data.len;
+    return AWS_OP_SUCCESS;
 }
 
 /* Encoder's outgoing_payload callback invokes current frame's callback */
@@ -742,6 +1160,10 @@ static int s_encoder_stream_outgoing_payload(struct aws_byte_buf *out_buf, void
     AWS_ASSERT(websocket->thread_data.current_outgoing_frame);
 
     struct outgoing_frame *current_frame = websocket->thread_data.current_outgoing_frame;
+    if (current_frame->def.shared_payload) {
+        return s_stream_shared_payload(websocket, out_buf);
+    }
+
     AWS_ASSERT(current_frame->def.stream_outgoing_payload);
 
     bool callback_result = current_frame->def.stream_outgoing_payload(websocket, out_buf, current_frame->def.user_data);
@@ -778,21 +1200,34 @@ static void s_io_message_write_completed(
     void *user_data) {
 
     (void)channel;
-    (void)message;
     struct aws_websocket *websocket = user_data;
     AWS_ASSERT(aws_channel_thread_is_callers_thread(channel));
+    AWS_ASSERT(websocket->thread_data.write_messages_in_flight > 0);
 
     /*
      * Invoke the completion callbacks (and then destroy) for all the frames that were completely written as
-     * part of this message completion at the socket layer
+     * part of this message completion at the socket layer. Messages complete in the order they're sent,
+     * so those frames are at the front of the list.
      */
-    s_complete_frame_list(websocket, &websocket->thread_data.write_completion_frames, err_code);
+    struct aws_linked_list completed_frames;
+    aws_linked_list_init(&completed_frames);
+    while (!aws_linked_list_empty(&websocket->thread_data.write_completion_frames)) {
+        struct aws_linked_list_node *node = aws_linked_list_front(&websocket->thread_data.write_completion_frames);
+        struct outgoing_frame *frame = AWS_CONTAINER_OF(node, struct outgoing_frame, node);
+        if (frame->io_msg != message) {
+            break;
+        }
+        aws_linked_list_remove(node);
+        aws_linked_list_push_back(&completed_frames, node);
+    }
+    s_complete_frame_list(websocket, &completed_frames, err_code);
+
+    websocket->thread_data.write_messages_in_flight--;
 
     if (err_code == AWS_ERROR_SUCCESS) {
         AWS_LOGF_TRACE(
             AWS_LS_HTTP_WEBSOCKET, "id=%p: aws_io_message written to socket, sending more data...", (void *)websocket);
 
-        websocket->thread_data.is_waiting_for_write_completion = false;
         s_try_write_outgoing_frames(websocket);
     } else {
         AWS_LOGF_TRACE(
@@ -881,7 +1316,8 @@ static void s_destroy_outgoing_frame(struct aws_websocket *websocket, struct out
         frame->def.on_complete(websocket, error_code, frame->def.user_data);
     }
 
-    aws_mem_release(websocket->alloc, frame);
+    aws_websocket_shared_payload_release(frame->def.shared_payload);
+    s_release_outgoing_frame(websocket, frame);
 }
 
 static void s_complete_frame_list(struct aws_websocket *websocket, struct aws_linked_list *frames, int error_code) {
@@ -934,6 +1370,7 @@ static void s_shutdown_due_to_write_err(struct aws_websocket *websocket, int err
     if (websocket->thread_data.current_outgoing_frame) {
         s_destroy_outgoing_frame(websocket, websocket->thread_data.current_outgoing_frame, error_code);
         websocket->thread_data.current_outgoing_frame = NULL;
+        websocket->thread_data.is_shared_payload_send_pending = false;
     }
 
     /* If we're in the final stages of shutdown, ensure shutdown completes.
@@ -1165,6 +1602,7 @@ static void s_finish_shutdown(struct aws_websocket *websocket) {
         s_destroy_outgoing_frame(
             websocket, websocket->thread_data.current_outgoing_frame, AWS_ERROR_HTTP_CONNECTION_CLOSED);
         websocket->thread_data.current_outgoing_frame = NULL;
+        websocket->thread_data.is_shared_payload_send_pending = false;
     }
 
     /* BEGIN CRITICAL SECTION */
@@ -1282,6 +1720,184 @@ clean_up:
     return AWS_OP_SUCCESS;
 }
 
+static void s_incoming_message_pool_on_refcount_zero(void *user_data) {
+    struct aws_websocket_incoming_message_pool *pool = user_data;
+    for (size_t i = 0; i < INCOMING_MESSAGE_POOL_SIZE_CLASS_COUNT; ++i) {
+        while (!aws_linked_list_empty(&pool->free_lists[i])) {
+            struct aws_linked_list_node *node = aws_linked_list_pop_front(&pool->free_lists[i]);
+            aws_mem_release(pool->allocator, AWS_CONTAINER_OF(node, struct aws_websocket_pooled_message, node));
+        }
+    }
+    aws_mutex_clean_up(&pool->lock);
+    aws_mem_release(pool->allocator, pool);
+}
+
+static struct aws_websocket_incoming_message_pool *s_incoming_message_pool_new(struct aws_allocator *allocator) {
+    struct aws_websocket_incoming_message_pool *pool =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_websocket_incoming_message_pool));
+    if (aws_mutex_init(&pool->lock)) {
+        aws_mem_release(allocator, pool);
+        return NULL;
+    }
+
+    pool->allocator = allocator;
+    aws_ref_count_init(&pool->ref_count, pool, s_incoming_message_pool_on_refcount_zero);
+    for (size_t i = 0; i < INCOMING_MESSAGE_POOL_SIZE_CLASS_COUNT; ++i) {
+        aws_linked_list_init(&pool->free_lists[i]);
+    }
+    return pool;
+}
+
+/* Get an empty message whose buffer holds at least `capacity` bytes, reusing an idle one if possible */
+static struct aws_websocket_pooled_message *s_pooled_message_new(
+    struct aws_websocket_incoming_message_pool *pool,
+    size_t capacity) {
+
+    size_t size_class = 0;
+    size_t buffer_size = INCOMING_MESSAGE_POOL_MIN_BUFFER_SIZE;
+    while (buffer_size < capacity && size_class < INCOMING_MESSAGE_POOL_SIZE_CLASS_COUNT) {
+        buffer_size <<= 1;
+        ++size_class;
+    }
+
+    struct aws_websocket_pooled_message *message = NULL;
+    if (size_class < INCOMING_MESSAGE_POOL_SIZE_CLASS_COUNT) {
+        /* BEGIN CRITICAL SECTION */
+        aws_mutex_lock(&pool->lock);
+        if (!aws_linked_list_empty(&pool->free_lists[size_class])) {
+            struct aws_linked_list_node *node = aws_linked_list_pop_back(&pool->free_lists[size_class]);
+            message = AWS_CONTAINER_OF(node, struct aws_websocket_pooled_message, node);
+            pool->free_counts[size_class]--;
+        }
+        aws_mutex_unlock(&pool->lock);
+        /* END CRITICAL SECTION */
+    } else {
+        buffer_size = capacity;
+    }
+
+    if (!message) {
+        void *storage;
+        if (!aws_mem_acquire_many(
+                pool->allocator, 2, &message, sizeof(struct aws_websocket_pooled_message), &storage, buffer_size)) {
+            return NULL;
+        }
+
+        AWS_ZERO_STRUCT(*message);
+        message->pool = pool;
+        message->size_class = size_class;
+        message->buf = aws_byte_buf_from_empty_array(storage, buffer_size);
+    }
+
+    AWS_ZERO_STRUCT(message->base);
+    message->buf.len = 0;
+    aws_ref_count_acquire(&pool->ref_count);
+    return message;
+}
+
+/* Return the message to its pool, or free it if the pool has enough idle messages of its size */
+static void s_pooled_message_destroy(struct aws_websocket_pooled_message *message) {
+    struct aws_websocket_incoming_message_pool *pool = message->pool;
+    bool returned_to_pool = false;
+
+    if (message->size_class < INCOMING_MESSAGE_POOL_SIZE_CLASS_COUNT) {
+        /* BEGIN CRITICAL SECTION */
+        aws_mutex_lock(&pool->lock);
+        if (pool->free_counts[message->size_class] < INCOMING_MESSAGE_POOL_MAX_FREE_COUNT) {
+            aws_linked_list_push_back(&pool->free_lists[message->size_class], &message->node);
+            pool->free_counts[message->size_class]++;
+            returned_to_pool = true;
+        }
+        aws_mutex_unlock(&pool->lock);
+        /* END CRITICAL SECTION */
+    }
+
+    if (!returned_to_pool) {
+        aws_mem_release(pool->allocator, message);
+    }
+
+    /* If this was the last ref, idle messages (possibly this one) are freed along with the pool */
+    aws_ref_count_release(&pool->ref_count);
+}
+
+void aws_websocket_incoming_message_release(struct aws_websocket_incoming_message *message) {
+    if (message) {
+        s_pooled_message_destroy(AWS_CONTAINER_OF(message, struct aws_websocket_pooled_message, base));
+    }
+}
+
+/* With on_incoming_message, the payload of data frames goes into a message rather than to the frame callbacks */
+static bool s_is_assembling_incoming_message(const struct aws_websocket *websocket) {
+    return websocket->on_incoming_message && !websocket->thread_data.is_midchannel_handler &&
+           aws_websocket_is_data_frame(websocket->thread_data.current_incoming_frame->opcode);
+}
+
+/* Make room in the incoming message for a data frame's payload, starting the message if this is its first frame */
+static int s_incoming_message_on_frame_begin(struct aws_websocket *websocket, const struct aws_websocket_frame *frame) {
+    struct aws_websocket_pooled_message *message = websocket->thread_data.incoming_message;
+    /* The decoder already ensures CONTINUATION frames come only in the middle of a message */
+    AWS_ASSERT((message != NULL) == (frame->opcode == AWS_WEBSOCKET_OPCODE_CONTINUATION));
+
+    size_t message_len = message ? message->buf.len : 0;
+    if (frame->payload_length > (uint64_t)(websocket->max_incoming_message_size - message_len)) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_WEBSOCKET,
+            "id=%p: Incoming message would exceed max size of %zu bytes.",
+            (void *)websocket,
+            websocket->max_incoming_message_size);
+        return aws_raise_error(AWS_ERROR_HTTP_WEBSOCKET_MESSAGE_TOO_BIG);
+    }
+
+    size_t required_capacity = message_len + (size_t)frame->payload_length;
+    if (message && required_capacity <= message->buf.capacity) {
+        return AWS_OP_SUCCESS;
+    }
+
+    /* When growing, at least double, so a message of many small frames isn't moved for each one */
+    size_t capacity = required_capacity;
+    if (message) {
+        size_t doubled_capacity = aws_mul_size_saturating(message->buf.capacity, 2);
+        capacity = aws_max_size(capacity, aws_min_size(doubled_capacity, websocket->max_incoming_message_size));
+    }
+
+    struct aws_websocket_pooled_message *new_message = s_pooled_message_new(websocket->incoming_message_pool, capacity);
+    if (!new_message) {
+        return AWS_OP_ERR;
+    }
+
+    if (message) {
+        new_message->base = message->base;
+        aws_byte_buf_write_from_whole_buffer(&new_message->buf, message->buf);
+        s_pooled_message_destroy(message);
+    } else {
+        new_message->base.opcode = frame->opcode;
+        new_message->base.compressed = frame->rsv[0];
+    }
+
+    websocket->thread_data.incoming_message = new_message;
+    return AWS_OP_SUCCESS;
+}
+
+/* Deliver the incoming message once its final frame is done. If the frame failed, the partial message is dropped. */
+static bool s_incoming_message_on_frame_complete(struct aws_websocket *websocket, int error_code) {
+    struct aws_websocket_pooled_message *message = websocket->thread_data.incoming_message;
+    if (error_code) {
+        websocket->thread_data.incoming_message = NULL;
+        if (message) {
+            s_pooled_message_destroy(message);
+        }
+        return true;
+    }
+
+    if (!websocket->thread_data.current_incoming_frame->fin) {
+        return true;
+    }
+
+    /* The user owns the message now */
+    websocket->thread_data.incoming_message = NULL;
+    message->base.payload = aws_byte_cursor_from_buf(&message->buf);
+    return websocket->on_incoming_message(websocket, &message->base, websocket->user_data);
+}
+
 static int s_decoder_on_frame(const struct aws_websocket_frame *frame, void *user_data) {
     struct aws_websocket *websocket = user_data;
     AWS_ASSERT(aws_channel_thread_is_callers_thread(websocket->channel_slot->channel));
@@ -1293,17 +1909,35 @@ static int s_decoder_on_frame(const struct aws_websocket_frame *frame, void *use
     websocket->thread_data.current_incoming_frame->payload_length = frame->payload_length;
     websocket->thread_data.current_incoming_frame->opcode = frame->opcode;
     websocket->thread_data.current_incoming_frame->fin = frame->fin;
+    websocket->thread_data.current_incoming_frame->compressed = false;
+
+    /* RFC-7692 Section 6 - The RSV1 bit means a message is compressed, and is only set on its first frame.
+     * Without permessage-deflate, no extension defines it. */
+    bool is_first_data_frame =
+        frame->opcode == AWS_WEBSOCKET_OPCODE_TEXT || frame->opcode == AWS_WEBSOCKET_OPCODE_BINARY;
+    if (frame->rsv[0] && (!websocket->permessage_deflate || !is_first_data_frame)) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_WEBSOCKET,
+            "id=%p: Received frame with opcode=%" PRIu8 "(%s) and unexpected RSV1 bit set.",
+            (void *)websocket,
+            frame->opcode,
+            aws_websocket_opcode_str(frame->opcode));
+        return aws_raise_error(AWS_ERROR_HTTP_WEBSOCKET_PROTOCOL_ERROR);
+    }
 
     /* If CONTINUATION frames are expected, remember which type of data is being continued.
      * RFC-6455 Section 5.4 Fragmentation */
     if (aws_websocket_is_data_frame(frame->opcode)) {
         if (frame->opcode != AWS_WEBSOCKET_OPCODE_CONTINUATION) {
+            websocket->thread_data.is_incoming_message_compressed = frame->rsv[0];
             if (frame->fin) {
                 websocket->thread_data.continuation_of_opcode = 0;
             } else {
                 websocket->thread_data.continuation_of_opcode = frame->opcode;
             }
         }
+        websocket->thread_data.current_incoming_frame->compressed =
+            websocket->thread_data.is_incoming_message_compressed;
     } else if (frame->opcode == AWS_WEBSOCKET_OPCODE_PING) {
         /* Prepare to store payload of PING so we can echo it back in the PONG */
         aws_byte_buf_reset(&websocket->thread_data.incoming_ping_payload, false /*zero_contents*/);
@@ -1315,6 +1949,10 @@ static int s_decoder_on_frame(const struct aws_websocket_frame *frame, void *use
          * Or we could impose our own internal limits, but for now this is simpler */
     }
 
+    if (s_is_assembling_incoming_message(websocket)) {
+        return s_incoming_message_on_frame_begin(websocket, frame);
+    }
+
     /* Invoke user cb */
     bool callback_result = true;
     if (websocket->on_incoming_frame_begin && !websocket->thread_data.is_midchannel_handler) {
@@ -1351,7 +1989,12 @@ static int s_decoder_on_payload(struct aws_byte_cursor data, void *user_data) {
 
 /* Invoke user cb */
 static int s_decoder_on_user_payload(struct aws_websocket *websocket, struct aws_byte_cursor data) {
-    if (websocket->on_incoming_frame_payload) {
+    if (s_is_assembling_incoming_message(websocket)) {
+        /* Room was made when the frame began */
+        struct aws_byte_buf *message_buf = &websocket->thread_data.incoming_message->buf;
+        AWS_ASSERT(message_buf->capacity - message_buf->len >= data.len);
+        aws_byte_buf_write_from_whole_cursor(message_buf, data);
+    } else if (websocket->on_incoming_frame_payload) {
         if (!websocket->on_incoming_frame_payload(
                 websocket, websocket->thread_data.current_incoming_frame, data, websocket->user_data)) {
 
@@ -1535,7 +2178,9 @@ static void s_complete_incoming_frame(struct aws_websocket *websocket, int error
 
     /* Invoke user cb */
     bool callback_result = true;
-    if (websocket->on_incoming_frame_complete && !websocket->thread_data.is_midchannel_handler) {
+    if (s_is_assembling_incoming_message(websocket)) {
+        callback_result = s_incoming_message_on_frame_complete(websocket, error_code);
+    } else if (websocket->on_incoming_frame_complete && !websocket->thread_data.is_midchannel_handler) {
         callback_result = websocket->on_incoming_frame_complete(
             websocket, websocket->thread_data.current_incoming_frame, error_code, websocket->user_data);
     }
@@ -8,14 +8,17 @@
 #include <aws/common/logging.h>
 #include <aws/common/string.h>
 #include <aws/http/connection.h>
+#include <aws/http/http2_stream_manager.h>
 #include <aws/http/private/http_impl.h>
 #include <aws/http/private/strutil.h>
 #include <aws/http/private/websocket_impl.h>
 #include <aws/http/request_response.h>
 #include <aws/http/status_code.h>
+#include <aws/io/channel.h>
 #include <aws/io/uri.h>
 
 #include <inttypes.h>
+#include <stdio.h>
 
 #ifdef _MSC_VER
 #    pragma warning(disable : 4204) /* non-constant aggregate initializer */
@@ -57,6 +60,8 @@ struct aws_websocket_client_bootstrap {
     struct aws_allocator *alloc;
     size_t initial_window_size;
     bool manual_window_update;
+    size_t max_write_messages_in_flight;
+    uint32_t write_coalescing_delay_us;
     void *user_data;
     /* Setup callback will be set NULL once it's invoked.
      * This is used to determine whether setup or shutdown should be invoked
@@ -66,6 +71,8 @@ struct aws_websocket_client_bootstrap {
     aws_websocket_on_incoming_frame_begin_fn *websocket_frame_begin_callback;
     aws_websocket_on_incoming_frame_payload_fn *websocket_frame_payload_callback;
     aws_websocket_on_incoming_frame_complete_fn *websocket_frame_complete_callback;
+    aws_websocket_on_incoming_message_fn *websocket_message_callback;
+    size_t max_incoming_message_size;
 
     /* Handshake request data */
     struct aws_http_message *handshake_request;
@@ -77,6 +84,13 @@ struct aws_websocket_client_bootstrap {
     /* Comma-separated values from the request's "Sec-WebSocket-Protocol" (or NULL if none)  */
     struct aws_string *expected_sec_websocket_protocols;
 
+    /* The permessage-deflate offer, whose "Sec-WebSocket-Extensions" header was added to the request */
+    bool permessage_deflate_offered;
+    struct aws_websocket_permessage_deflate_options permessage_deflate_offer;
+    /* The parameters in use, if the server accepted the offer */
+    bool permessage_deflate_accepted;
+    struct aws_websocket_permessage_deflate_options permessage_deflate;
+
     /* Handshake response data */
     int response_status;
     struct aws_http_headers *response_headers;
@@ -86,9 +100,30 @@ struct aws_websocket_client_bootstrap {
 
     int setup_error_code;
     struct aws_websocket *websocket;
+
+    /* Used when the websocket runs as a stream on an HTTP/2 connection (RFC-8441).
+     * The websocket gets a channel of its own, whose first handler carries its data over the stream.
+     * Only touched from the connection's thread, once the stream is acquired. */
+    struct {
+        struct aws_http2_stream_manager *stream_manager;
+        /* The handshake request, as an extended CONNECT */
+        struct aws_http_message *request;
+        struct aws_http_stream *stream;
+        struct aws_channel *channel;
+        /* NULL until the channel is set up, and again once it's shut down */
+        struct aws_websocket_h2_transport *transport;
+        /* DATA that arrived after a successful response, before the channel was ready for it */
+        struct aws_byte_buf early_body;
+        int stream_error_code;
+        bool is_stream_complete;
+        bool is_channel_shutdown_complete;
+    } h2;
 };
 
 static void s_ws_bootstrap_destroy(struct aws_websocket_client_bootstrap *ws_bootstrap);
+static int s_ws_bootstrap_add_permessage_deflate_offer(
+    struct aws_http_message *request,
+    const struct aws_websocket_permessage_deflate_options *offer);
 static int s_ws_bootstrap_calculate_sec_websocket_accept(
     struct aws_byte_cursor sec_websocket_key,
     struct aws_byte_buf *out_buf,
@@ -117,6 +152,9 @@ static int s_ws_bootstrap_on_handshake_response_body(
     const struct aws_byte_cursor *data,
     void *user_data);
 static void s_ws_bootstrap_on_stream_complete(struct aws_http_stream *stream, int error_code, void *user_data);
+static int s_ws_bootstrap_h2_connect(
+    struct aws_websocket_client_bootstrap *ws_bootstrap,
+    struct aws_http2_stream_manager *stream_manager);
 
 int aws_websocket_client_connect(const struct aws_websocket_client_connection_options *options) {
     aws_http_fatal_assert_library_initialized();
@@ -125,8 +163,9 @@ int aws_websocket_client_connect(const struct aws_websocket_client_connection_op
     /* Validate options */
     struct aws_byte_cursor path;
     aws_http_message_get_request_path(options->handshake_request, &path);
-    if (!options->allocator || !options->bootstrap || !options->socket_options || !options->host.len || !path.len ||
-        !options->on_connection_setup) {
+    bool has_transport = options->http2_stream_manager != NULL ||
+                         (options->bootstrap && options->socket_options && options->host.len);
+    if (!options->allocator || !has_transport || !path.len || !options->on_connection_setup) {
 
         AWS_LOGF_ERROR(AWS_LS_HTTP_WEBSOCKET_SETUP, "id=static: Missing required websocket connection options.");
         return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
@@ -149,20 +188,42 @@ int aws_websocket_client_connect(const struct aws_websocket_client_connection_op
 
     const struct aws_http_headers *request_headers = aws_http_message_get_headers(options->handshake_request);
     struct aws_byte_cursor sec_websocket_key;
-    if (aws_http_headers_get(request_headers, aws_byte_cursor_from_c_str("Sec-WebSocket-Key"), &sec_websocket_key)) {
+    AWS_ZERO_STRUCT(sec_websocket_key);
+    /* Over HTTP/2 there's no key, the stream itself shows the server took the request (RFC-8441 5) */
+    if (!options->http2_stream_manager &&
+        aws_http_headers_get(request_headers, aws_byte_cursor_from_c_str("Sec-WebSocket-Key"), &sec_websocket_key)) {
         AWS_LOGF_ERROR(
             AWS_LS_HTTP_WEBSOCKET_SETUP,
             "id=static: Websocket handshake request is missing required 'Sec-WebSocket-Key' header");
         return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
     }
 
-    /* Extensions are not currently supported */
+    /* The only extension supported is permessage-deflate, which is offered via the options */
     if (aws_http_headers_has(request_headers, aws_byte_cursor_from_c_str("Sec-WebSocket-Extensions"))) {
         AWS_LOGF_ERROR(
-            AWS_LS_HTTP_WEBSOCKET_SETUP, "id=static: 'Sec-WebSocket-Extensions' are not currently supported");
+            AWS_LS_HTTP_WEBSOCKET_SETUP,
+            "id=static: 'Sec-WebSocket-Extensions' are not currently supported, use the permessage_deflate option.");
         return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
     }
 
+    if (options->permessage_deflate) {
+        const uint8_t window_bits[] = {
+            options->permessage_deflate->server_max_window_bits,
+            options->permessage_deflate->client_max_window_bits,
+        };
+        for (size_t i = 0; i < AWS_ARRAY_SIZE(window_bits); ++i) {
+            if (window_bits[i] != 0 && (window_bits[i] < AWS_WEBSOCKET_PERMESSAGE_DEFLATE_MIN_WINDOW_BITS ||
+                                        window_bits[i] > AWS_WEBSOCKET_PERMESSAGE_DEFLATE_MAX_WINDOW_BITS)) {
+                AWS_LOGF_ERROR(
+                    AWS_LS_HTTP_WEBSOCKET_SETUP,
+                    "id=static: Invalid permessage-deflate options, window bits must be 0 or from %d to %d.",
+                    AWS_WEBSOCKET_PERMESSAGE_DEFLATE_MIN_WINDOW_BITS,
+                    AWS_WEBSOCKET_PERMESSAGE_DEFLATE_MAX_WINDOW_BITS);
+                return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+            }
+        }
+    }
+
     /* Create bootstrap */
     struct aws_websocket_client_bootstrap *ws_bootstrap =
         aws_mem_calloc(options->allocator, 1, sizeof(struct aws_websocket_client_bootstrap));
@@ -170,18 +231,23 @@ int aws_websocket_client_connect(const struct aws_websocket_client_connection_op
     ws_bootstrap->alloc = options->allocator;
     ws_bootstrap->initial_window_size = options->initial_window_size;
     ws_bootstrap->manual_window_update = options->manual_window_management;
+    ws_bootstrap->max_write_messages_in_flight = options->max_write_messages_in_flight;
+    ws_bootstrap->write_coalescing_delay_us = options->write_coalescing_delay_us;
     ws_bootstrap->user_data = options->user_data;
     ws_bootstrap->websocket_setup_callback = options->on_connection_setup;
     ws_bootstrap->websocket_shutdown_callback = options->on_connection_shutdown;
     ws_bootstrap->websocket_frame_begin_callback = options->on_incoming_frame_begin;
     ws_bootstrap->websocket_frame_payload_callback = options->on_incoming_frame_payload;
     ws_bootstrap->websocket_frame_complete_callback = options->on_incoming_frame_complete;
+    ws_bootstrap->websocket_message_callback = options->on_incoming_message;
+    ws_bootstrap->max_incoming_message_size = options->max_incoming_message_size;
     ws_bootstrap->handshake_request = aws_http_message_acquire(options->handshake_request);
     ws_bootstrap->response_status = AWS_HTTP_STATUS_CODE_UNKNOWN;
     ws_bootstrap->response_headers = aws_http_headers_new(ws_bootstrap->alloc);
     aws_byte_buf_init(&ws_bootstrap->response_body, ws_bootstrap->alloc, 0);
 
-    if (s_ws_bootstrap_calculate_sec_websocket_accept(
+    if (!options->http2_stream_manager &&
+        s_ws_bootstrap_calculate_sec_websocket_accept(
             sec_websocket_key, &ws_bootstrap->expected_sec_websocket_accept, ws_bootstrap->alloc)) {
         goto error;
     }
@@ -189,6 +255,21 @@ int aws_websocket_client_connect(const struct aws_websocket_client_connection_op
     ws_bootstrap->expected_sec_websocket_protocols =
         aws_http_headers_get_all(request_headers, aws_byte_cursor_from_c_str("Sec-WebSocket-Protocol"));
 
+    if (options->permessage_deflate) {
+        if (s_ws_bootstrap_add_permessage_deflate_offer(ws_bootstrap->handshake_request, options->permessage_deflate)) {
+            goto error;
+        }
+        ws_bootstrap->permessage_deflate_offered = true;
+        ws_bootstrap->permessage_deflate_offer = *options->permessage_deflate;
+    }
+
+    if (options->http2_stream_manager) {
+        if (s_ws_bootstrap_h2_connect(ws_bootstrap, options->http2_stream_manager)) {
+            goto error;
+        }
+        return AWS_OP_SUCCESS;
+    }
+
     /* Initiate HTTP connection */
     struct aws_http_client_connection_options http_options = AWS_HTTP_CLIENT_CONNECTION_OPTIONS_INIT;
     http_options.allocator = ws_bootstrap->alloc;
@@ -253,7 +334,16 @@ static void s_ws_bootstrap_destroy(struct aws_websocket_client_bootstrap *ws_boo
         return;
     }
 
+    if (ws_bootstrap->permessage_deflate_offered) {
+        /* Leave the user's request the way it was */
+        aws_http_headers_erase(
+            aws_http_message_get_headers(ws_bootstrap->handshake_request),
+            aws_byte_cursor_from_c_str("Sec-WebSocket-Extensions"));
+    }
     aws_http_message_release(ws_bootstrap->handshake_request);
+    aws_http_message_release(ws_bootstrap->h2.request);
+    aws_http2_stream_manager_release(ws_bootstrap->h2.stream_manager);
+    aws_byte_buf_clean_up(&ws_bootstrap->h2.early_body);
     aws_http_headers_release(ws_bootstrap->response_headers);
     aws_byte_buf_clean_up(&ws_bootstrap->expected_sec_websocket_accept);
     aws_string_destroy(ws_bootstrap->expected_sec_websocket_protocols);
@@ -262,6 +352,39 @@ static void s_ws_bootstrap_destroy(struct aws_websocket_client_bootstrap *ws_boo
     aws_mem_release(ws_bootstrap->alloc, ws_bootstrap);
 }
 
+/* Add the "Sec-WebSocket-Extensions" header offering permessage-deflate.
+ * RFC-7692 Section 5 */
+static int s_ws_bootstrap_add_permessage_deflate_offer(
+    struct aws_http_message *request,
+    const struct aws_websocket_permessage_deflate_options *offer) {
+
+    /* Longest possible offer is under 128 bytes */
+    uint8_t offer_storage[128];
+    struct aws_byte_buf offer_buf = aws_byte_buf_from_empty_array(offer_storage, sizeof(offer_storage));
+    aws_byte_buf_write_from_whole_cursor(&offer_buf, aws_byte_cursor_from_c_str("permessage-deflate"));
+    if (offer->server_no_context_takeover) {
+        aws_byte_buf_write_from_whole_cursor(&offer_buf, aws_byte_cursor_from_c_str("; server_no_context_takeover"));
+    }
+    if (offer->client_no_context_takeover) {
+        aws_byte_buf_write_from_whole_cursor(&offer_buf, aws_byte_cursor_from_c_str("; client_no_context_takeover"));
+    }
+    char param_str[32];
+    if (offer->server_max_window_bits) {
+        snprintf(param_str, sizeof(param_str), "; server_max_window_bits=%d", (int)offer->server_max_window_bits);
+        aws_byte_buf_write_from_whole_cursor(&offer_buf, aws_byte_cursor_from_c_str(param_str));
+    }
+    if (offer->client_max_window_bits) {
+        snprintf(param_str, sizeof(param_str), "; client_max_window_bits=%d", (int)offer->client_max_window_bits);
+        aws_byte_buf_write_from_whole_cursor(&offer_buf, aws_byte_cursor_from_c_str(param_str));
+    }
+
+    struct aws_http_header header = {
+        .name = aws_byte_cursor_from_c_str("Sec-WebSocket-Extensions"),
+        .value = aws_byte_cursor_from_buf(&offer_buf),
+    };
+    return aws_http_message_add_header(request, header);
+}
+
 /* Given the handshake request's "Sec-WebSocket-Key" value,
  * calculate the expected value for the response's "Sec-WebSocket-Accept".
  * RFC-6455 Section 4.1:
@@ -408,6 +531,9 @@ static void s_ws_bootstrap_invoke_setup_callback(struct aws_websocket_client_boo
         .handshake_response_header_array = response_header_array,
         .num_handshake_response_headers = num_response_headers,
         .handshake_response_body = response_body_ptr,
+        .permessage_deflate =
+            (ws_bootstrap->websocket && ws_bootstrap->permessage_deflate_accepted) ? &ws_bootstrap->permessage_deflate
+                                                                                    : NULL,
     };
 
     ws_bootstrap->websocket_setup_callback(&setup_data, ws_bootstrap->user_data);
@@ -653,6 +779,154 @@ static int s_ws_bootstrap_validate_sec_websocket_protocol(const struct aws_webso
     return aws_raise_error(AWS_ERROR_HTTP_WEBSOCKET_UPGRADE_FAILURE);
 }
 
+/* Parse a permessage-deflate window bits parameter, which may be a quoted-string. RFC-7692 Section 7.1.2 */
+static int s_parse_permessage_deflate_window_bits(struct aws_byte_cursor value, uint8_t *out_window_bits) {
+    if (value.len >= 2 && value.ptr[0] == '"' && value.ptr[value.len - 1] == '"') {
+        aws_byte_cursor_advance(&value, 1);
+        value.len--;
+    }
+
+    uint64_t window_bits = 0;
+    if (value.len == 0 || value.len > 2 || aws_byte_cursor_utf8_parse_u64(value, &window_bits) ||
+        window_bits < AWS_WEBSOCKET_PERMESSAGE_DEFLATE_MIN_WINDOW_BITS ||
+        window_bits > AWS_WEBSOCKET_PERMESSAGE_DEFLATE_MAX_WINDOW_BITS) {
+        return aws_raise_error(AWS_ERROR_HTTP_WEBSOCKET_UPGRADE_FAILURE);
+    }
+    *out_window_bits = (uint8_t)window_bits;
+    return AWS_OP_SUCCESS;
+}
+
+/* Check the extension the server accepted, and work out the permessage-deflate parameters in use.
+ * RFC-7692 Section 5.1 and Section 7.1 */
+static int s_ws_bootstrap_validate_sec_websocket_extensions(struct aws_websocket_client_bootstrap *ws_bootstrap) {
+    struct aws_string *response_extensions = aws_http_headers_get_all(
+        ws_bootstrap->response_headers, aws_byte_cursor_from_c_str("Sec-WebSocket-Extensions"));
+    if (response_extensions == NULL) {
+        /* Server declined any extensions offered */
+        return AWS_OP_SUCCESS;
+    }
+
+    struct aws_byte_cursor extension = aws_byte_cursor_from_string(response_extensions);
+    if (!ws_bootstrap->permessage_deflate_offered) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_WEBSOCKET_SETUP,
+            "id=%p: Response has 'Sec-WebSocket-Extensions' header, but no extensions were offered.",
+            (void *)ws_bootstrap);
+        goto error;
+    }
+
+    /* Only one extension was offered, so the server can't accept a list of them */
+    if (memchr(extension.ptr, ',', extension.len) != NULL) {
+        goto unexpected_value;
+    }
+
+    /* What's in use, unless the response says otherwise */
+    const struct aws_websocket_permessage_deflate_options *offer = &ws_bootstrap->permessage_deflate_offer;
+    struct aws_websocket_permessage_deflate_options accepted = {
+        .client_no_context_takeover = offer->client_no_context_takeover,
+        .server_max_window_bits = AWS_WEBSOCKET_PERMESSAGE_DEFLATE_MAX_WINDOW_BITS,
+        .client_max_window_bits = offer->client_max_window_bits ? offer->client_max_window_bits
+                                                                : AWS_WEBSOCKET_PERMESSAGE_DEFLATE_MAX_WINDOW_BITS,
+    };
+    bool seen_server_no_context_takeover = false;
+    bool seen_client_no_context_takeover = false;
+    bool seen_server_max_window_bits = false;
+    bool seen_client_max_window_bits = false;
+
+    /* The extension name, followed by its parameters: "name" or "name=value" */
+    struct aws_byte_cursor substr;
+    AWS_ZERO_STRUCT(substr);
+    bool is_extension_name = true;
+    while (aws_byte_cursor_next_split(&extension, ';', &substr)) {
+        struct aws_byte_cursor param = aws_strutil_trim_http_whitespace(substr);
+        if (is_extension_name) {
+            is_extension_name = false;
+            if (!aws_byte_cursor_eq_c_str_ignore_case(&param, "permessage-deflate")) {
+                goto unexpected_value;
+            }
+            continue;
+        }
+
+        struct aws_byte_cursor name = param;
+        struct aws_byte_cursor value;
+        AWS_ZERO_STRUCT(value);
+        bool has_value = false;
+        for (size_t i = 0; i < param.len; ++i) {
+            if (param.ptr[i] == '=') {
+                name = aws_strutil_trim_http_whitespace(aws_byte_cursor_from_array(param.ptr, i));
+                value = aws_strutil_trim_http_whitespace(
+                    aws_byte_cursor_from_array(param.ptr + i + 1, param.len - i - 1));
+                has_value = true;
+                break;
+            }
+        }
+
+        bool *seen = NULL;
+        if (aws_byte_cursor_eq_c_str_ignore_case(&name, "server_no_context_takeover")) {
+            seen = &seen_server_no_context_takeover;
+            if (has_value) {
+                goto unexpected_value;
+            }
+            accepted.server_no_context_takeover = true;
+
+        } else if (aws_byte_cursor_eq_c_str_ignore_case(&name, "client_no_context_takeover")) {
+            seen = &seen_client_no_context_takeover;
+            if (has_value) {
+                goto unexpected_value;
+            }
+            accepted.client_no_context_takeover = true;
+
+        } else if (aws_byte_cursor_eq_c_str_ignore_case(&name, "server_max_window_bits")) {
+            seen = &seen_server_max_window_bits;
+            if (!has_value || s_parse_permessage_deflate_window_bits(value, &accepted.server_max_window_bits)) {
+                goto unexpected_value;
+            }
+            /* No bigger than the client asked for */
+            if (offer->server_max_window_bits && accepted.server_max_window_bits > offer->server_max_window_bits) {
+                goto unexpected_value;
+            }
+
+        } else if (aws_byte_cursor_eq_c_str_ignore_case(&name, "client_max_window_bits")) {
+            seen = &seen_client_max_window_bits;
+            /* Only if the client offered it, and no bigger than that */
+            if (!offer->client_max_window_bits || !has_value ||
+                s_parse_permessage_deflate_window_bits(value, &accepted.client_max_window_bits) ||
+                accepted.client_max_window_bits > offer->client_max_window_bits) {
+                goto unexpected_value;
+            }
+
+        } else {
+            goto unexpected_value;
+        }
+
+        /* A parameter can't be repeated */
+        if (*seen) {
+            goto unexpected_value;
+        }
+        *seen = true;
+    }
+
+    ws_bootstrap->permessage_deflate_accepted = true;
+    ws_bootstrap->permessage_deflate = accepted;
+    AWS_LOGF_DEBUG(
+        AWS_LS_HTTP_WEBSOCKET_SETUP,
+        "id=%p: Server accepted Sec-WebSocket-Extensions: " PRInSTR,
+        (void *)ws_bootstrap,
+        AWS_BYTE_CURSOR_PRI(aws_byte_cursor_from_string(response_extensions)));
+    aws_string_destroy(response_extensions);
+    return AWS_OP_SUCCESS;
+
+unexpected_value:
+    AWS_LOGF_ERROR(
+        AWS_LS_HTTP_WEBSOCKET_SETUP,
+        "id=%p: Response 'Sec-WebSocket-Extensions' header has unexpected value '" PRInSTR "'",
+        (void *)ws_bootstrap,
+        AWS_BYTE_CURSOR_PRI(aws_byte_cursor_from_string(response_extensions)));
+error:
+    aws_string_destroy(response_extensions);
+    return aws_raise_error(AWS_ERROR_HTTP_WEBSOCKET_UPGRADE_FAILURE);
+}
+
 /* OK, we've got all the headers for the 101 Switching Protocols response.
  * Validate the handshake response, install the websocket handler into the channel,
  * and invoke the on_connection_setup callback. */
@@ -698,13 +972,12 @@ static int s_ws_bootstrap_validate_response_and_install_websocket_handler(
         goto error;
     }
 
-    /* (step 5 is about validating Sec-WebSocket-Extensions, but we don't support extensions) */
-    if (aws_http_headers_has(ws_bootstrap->response_headers, aws_byte_cursor_from_c_str("Sec-WebSocket-Extensions"))) {
-        AWS_LOGF_ERROR(
-            AWS_LS_HTTP_WEBSOCKET_SETUP,
-            "id=%p: Response has 'Sec-WebSocket-Extensions' header, but client does not support extensions.",
-            (void *)ws_bootstrap);
-        aws_raise_error(AWS_ERROR_HTTP_WEBSOCKET_UPGRADE_FAILURE);
+    /* 5.   If the response includes a |Sec-WebSocket-Extensions| header
+     *      field and this header field indicates the use of an extension
+     *      that was not present in the client's handshake (the server has
+     *      indicated an extension not requested by the client), the client
+     *      MUST _Fail the WebSocket Connection_. */
+    if (s_ws_bootstrap_validate_sec_websocket_extensions(ws_bootstrap)) {
         goto error;
     }
 
@@ -731,6 +1004,11 @@ static int s_ws_bootstrap_validate_response_and_install_websocket_handler(
         .on_incoming_frame_complete = ws_bootstrap->websocket_frame_complete_callback,
         .is_server = false,
         .manual_window_update = ws_bootstrap->manual_window_update,
+        .permessage_deflate = ws_bootstrap->permessage_deflate_accepted,
+        .max_write_messages_in_flight = ws_bootstrap->max_write_messages_in_flight,
+        .write_coalescing_delay_us = ws_bootstrap->write_coalescing_delay_us,
+        .on_incoming_message = ws_bootstrap->websocket_message_callback,
+        .max_incoming_message_size = ws_bootstrap->max_incoming_message_size,
     };
 
     ws_bootstrap->websocket = s_system_vtable->aws_websocket_handler_new(&ws_options);
@@ -865,3 +1143,433 @@ static void s_ws_bootstrap_on_stream_complete(struct aws_http_stream *stream, in
     /* Done with stream, let it be cleaned up */
     s_system_vtable->aws_http_stream_release(stream);
 }
+
+/*****************************************************************************************************************
+ * Websocket over HTTP/2 (RFC-8441)
+ *
+ * The handshake is an extended CONNECT stream, acquired from an HTTP/2 stream manager.
+ * Once the server responds 200, the websocket handler is installed into a channel of its own,
+ * whose first handler sends the websocket's data as the stream's DATA, and vice versa.
+ * Setup or shutdown is reported once both the stream has completed and the channel has shut down.
+ *****************************************************************************************************************/
+
+static void s_ws_bootstrap_on_h2_stream_acquired(struct aws_http_stream *stream, int error_code, void *user_data);
+static int s_ws_bootstrap_on_h2_response_header_block_done(
+    struct aws_http_stream *stream,
+    enum aws_http_header_block header_block,
+    void *user_data);
+static int s_ws_bootstrap_on_h2_response_body(
+    struct aws_http_stream *stream,
+    const struct aws_byte_cursor *data,
+    void *user_data);
+static void s_ws_bootstrap_on_h2_stream_complete(struct aws_http_stream *stream, int error_code, void *user_data);
+static void s_ws_bootstrap_on_h2_channel_setup(struct aws_channel *channel, int error_code, void *user_data);
+static void s_ws_bootstrap_on_h2_channel_shutdown(struct aws_channel *channel, int error_code, void *user_data);
+
+/* The handshake request, as an extended CONNECT (RFC-8441 5) */
+static struct aws_http_message *s_ws_bootstrap_new_extended_connect_request(
+    struct aws_websocket_client_bootstrap *ws_bootstrap) {
+
+    /* Connection-specific headers like "Upgrade" and "Connection" are left out of the conversion */
+    struct aws_http_message *request =
+        aws_http2_message_new_from_http1(ws_bootstrap->alloc, ws_bootstrap->handshake_request);
+    if (!request) {
+        return NULL;
+    }
+
+    struct aws_http_headers *headers = aws_http_message_get_headers(request);
+    if (aws_http2_headers_set_request_method(headers, aws_http_method_connect) ||
+        aws_http_headers_add(headers, aws_http_header_protocol, aws_byte_cursor_from_c_str("websocket"))) {
+        aws_http_message_release(request);
+        return NULL;
+    }
+
+    /* HTTP/2 websockets don't use Sec-WebSocket-Key or Sec-WebSocket-Accept. Erase fails if there's none */
+    aws_http_headers_erase(headers, aws_byte_cursor_from_c_str("sec-websocket-key"));
+    aws_reset_error();
+    return request;
+}
+
+static int s_ws_bootstrap_h2_connect(
+    struct aws_websocket_client_bootstrap *ws_bootstrap,
+    struct aws_http2_stream_manager *stream_manager) {
+
+    ws_bootstrap->h2.request = s_ws_bootstrap_new_extended_connect_request(ws_bootstrap);
+    if (!ws_bootstrap->h2.request) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_WEBSOCKET_SETUP,
+            "id=%p: Failed to create extended CONNECT request, error %d (%s)",
+            (void *)ws_bootstrap,
+            aws_last_error(),
+            aws_error_name(aws_last_error()));
+        return AWS_OP_ERR;
+    }
+    ws_bootstrap->h2.stream_manager = aws_http2_stream_manager_acquire(stream_manager);
+    aws_byte_buf_init(&ws_bootstrap->h2.early_body, ws_bootstrap->alloc, 0);
+
+    struct aws_http_make_request_options request_options = {
+        .self_size = sizeof(request_options),
+        .request = ws_bootstrap->h2.request,
+        .user_data = ws_bootstrap,
+        .on_response_headers = s_ws_bootstrap_on_handshake_response_headers,
+        .on_response_header_block_done = s_ws_bootstrap_on_h2_response_header_block_done,
+        .on_response_body = s_ws_bootstrap_on_h2_response_body,
+        .on_complete = s_ws_bootstrap_on_h2_stream_complete,
+        /* The stream stays open for the websocket's data */
+        .http2_use_manual_data_writes = true,
+    };
+    struct aws_http2_stream_manager_acquire_stream_options acquire_options = {
+        .callback = s_ws_bootstrap_on_h2_stream_acquired,
+        .user_data = ws_bootstrap,
+        .options = &request_options,
+    };
+    aws_http2_stream_manager_acquire_stream(stream_manager, &acquire_options);
+
+    AWS_LOGF_TRACE(
+        AWS_LS_HTTP_WEBSOCKET_SETUP,
+        "id=%p: Websocket setup begun, acquiring HTTP/2 stream from manager=%p",
+        (void *)ws_bootstrap,
+        (void *)stream_manager);
+    return AWS_OP_SUCCESS;
+}
+
+/* Once the stream has completed, and the channel (if there is one) has shut down, clean everything up */
+static void s_ws_bootstrap_h2_try_finish(struct aws_websocket_client_bootstrap *ws_bootstrap) {
+    if (!ws_bootstrap->h2.is_stream_complete) {
+        return;
+    }
+    if (ws_bootstrap->h2.channel && !ws_bootstrap->h2.is_channel_shutdown_complete) {
+        return;
+    }
+
+    /* The stream outlives the channel, since the channel's first handler writes to it */
+    if (ws_bootstrap->h2.channel) {
+        aws_channel_destroy(ws_bootstrap->h2.channel);
+    }
+    aws_http_stream_release(ws_bootstrap->h2.stream);
+    s_ws_bootstrap_destroy(ws_bootstrap);
+}
+
+static void s_ws_bootstrap_h2_invoke_setup_failure(
+    struct aws_websocket_client_bootstrap *ws_bootstrap,
+    int error_code) {
+
+    /* If there's already a setup_error_code, use that */
+    if (ws_bootstrap->setup_error_code) {
+        error_code = ws_bootstrap->setup_error_code;
+    }
+
+    /* Ensure non-zero error_code is passed */
+    if (!error_code) {
+        error_code = AWS_ERROR_UNKNOWN;
+    }
+
+    AWS_LOGF_ERROR(
+        AWS_LS_HTTP_WEBSOCKET_SETUP,
+        "id=%p: Websocket setup failed, error %d (%s).",
+        (void *)ws_bootstrap,
+        error_code,
+        aws_error_name(error_code));
+
+    s_ws_bootstrap_invoke_setup_callback(ws_bootstrap, error_code);
+}
+
+/* Called if something goes wrong after the stream is acquired.
+ * The stream is reset, and failure is reported once it has completed */
+static void s_ws_bootstrap_h2_cancel_setup_due_to_err(
+    struct aws_websocket_client_bootstrap *ws_bootstrap,
+    int error_code) {
+
+    AWS_ASSERT(error_code);
+
+    if (!ws_bootstrap->setup_error_code) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_WEBSOCKET_SETUP,
+            "id=%p: Canceling websocket setup due to error %d (%s).",
+            (void *)ws_bootstrap,
+            error_code,
+            aws_error_name(error_code));
+
+        ws_bootstrap->setup_error_code = error_code;
+    }
+
+    if (!ws_bootstrap->h2.is_stream_complete) {
+        aws_http2_stream_reset(ws_bootstrap->h2.stream, AWS_HTTP2_ERR_CANCEL);
+    }
+}
+
+static void s_ws_bootstrap_on_h2_stream_acquired(struct aws_http_stream *stream, int error_code, void *user_data) {
+    struct aws_websocket_client_bootstrap *ws_bootstrap = user_data;
+
+    if (error_code) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_WEBSOCKET_SETUP,
+            "id=%p: Websocket setup failed to acquire HTTP/2 stream, error %d (%s).",
+            (void *)ws_bootstrap,
+            error_code,
+            aws_error_name(error_code));
+
+        s_ws_bootstrap_invoke_setup_callback(ws_bootstrap, error_code);
+        s_ws_bootstrap_destroy(ws_bootstrap);
+        return;
+    }
+
+    /* The stream is already activated, and the rest happens on its connection's thread */
+    ws_bootstrap->h2.stream = stream;
+
+    AWS_LOGF_TRACE(
+        AWS_LS_HTTP_WEBSOCKET_SETUP,
+        "id=%p: HTTP/2 stream acquired, sent websocket extended CONNECT request.",
+        (void *)ws_bootstrap);
+}
+
+/* Got all the headers of a 2xx response. Validate them, and set up a channel for the websocket */
+static int s_ws_bootstrap_h2_validate_response_and_create_channel(
+    struct aws_websocket_client_bootstrap *ws_bootstrap,
+    struct aws_http_stream *stream) {
+
+    /* RFC-8441 5: There's no Sec-WebSocket-Accept, the rest is validated as RFC-6455 Section 4.1 says */
+    if (s_ws_bootstrap_validate_sec_websocket_extensions(ws_bootstrap)) {
+        return AWS_OP_ERR;
+    }
+
+    if (s_ws_bootstrap_validate_sec_websocket_protocol(ws_bootstrap)) {
+        return AWS_OP_ERR;
+    }
+
+    /* The channel shares the connection's event-loop, so the stream and the channel never need to cross threads */
+    struct aws_channel *connection_channel = aws_http_connection_get_channel(aws_http_stream_get_connection(stream));
+    struct aws_channel_options channel_options = {
+        .event_loop = aws_channel_get_event_loop(connection_channel),
+        .on_setup_completed = s_ws_bootstrap_on_h2_channel_setup,
+        .setup_user_data = ws_bootstrap,
+        .on_shutdown_completed = s_ws_bootstrap_on_h2_channel_shutdown,
+        .shutdown_user_data = ws_bootstrap,
+        .enable_read_back_pressure = ws_bootstrap->manual_window_update,
+    };
+    ws_bootstrap->h2.channel = aws_channel_new(ws_bootstrap->alloc, &channel_options);
+    if (!ws_bootstrap->h2.channel) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_WEBSOCKET_SETUP,
+            "id=%p: Failed to create channel for websocket, error %d (%s)",
+            (void *)ws_bootstrap,
+            aws_last_error(),
+            aws_error_name(aws_last_error()));
+        return AWS_OP_ERR;
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+static int s_ws_bootstrap_on_h2_response_header_block_done(
+    struct aws_http_stream *stream,
+    enum aws_http_header_block header_block,
+    void *user_data) {
+
+    struct aws_websocket_client_bootstrap *ws_bootstrap = user_data;
+
+    if (header_block == AWS_HTTP_HEADER_BLOCK_TRAILING) {
+        return AWS_OP_SUCCESS;
+    }
+
+    aws_http_stream_get_incoming_response_status(stream, &ws_bootstrap->response_status);
+    ws_bootstrap->got_full_response_headers = true;
+
+    if (header_block == AWS_HTTP_HEADER_BLOCK_INFORMATIONAL) {
+        AWS_LOGF_DEBUG(
+            AWS_LS_HTTP_WEBSOCKET_SETUP,
+            "id=%p: Server sent interim response with status code %d",
+            (void *)ws_bootstrap,
+            ws_bootstrap->response_status);
+
+        aws_http_headers_clear(ws_bootstrap->response_headers);
+        ws_bootstrap->got_full_response_headers = false;
+        return AWS_OP_SUCCESS;
+    }
+
+    /* RFC-8441 5: Any 2xx is success. Otherwise keep the stream going, and report the complete response */
+    if (ws_bootstrap->response_status / 100 != 2) {
+        ws_bootstrap->setup_error_code = AWS_ERROR_HTTP_WEBSOCKET_UPGRADE_FAILURE;
+        return AWS_OP_SUCCESS;
+    }
+
+    if (s_ws_bootstrap_h2_validate_response_and_create_channel(ws_bootstrap, stream)) {
+        s_ws_bootstrap_h2_cancel_setup_due_to_err(ws_bootstrap, aws_last_error());
+        /* Returning error stops HTTP from processing any further data */
+        return AWS_OP_ERR;
+    }
+    return AWS_OP_SUCCESS;
+}
+
+static int s_ws_bootstrap_on_h2_response_body(
+    struct aws_http_stream *stream,
+    const struct aws_byte_cursor *data,
+    void *user_data) {
+
+    struct aws_websocket_client_bootstrap *ws_bootstrap = user_data;
+
+    if (ws_bootstrap->h2.transport) {
+        return aws_websocket_h2_transport_on_stream_body(ws_bootstrap->h2.transport, *data);
+    }
+
+    if (ws_bootstrap->h2.channel) {
+        /* Websocket data, but the channel isn't ready for it yet */
+        if (!ws_bootstrap->h2.is_channel_shutdown_complete) {
+            aws_byte_buf_append_dynamic(&ws_bootstrap->h2.early_body, data);
+        }
+        return AWS_OP_SUCCESS;
+    }
+
+    /* Body of a failed response, see s_ws_bootstrap_on_handshake_response_body() */
+    aws_byte_buf_append_dynamic(&ws_bootstrap->response_body, data);
+    if (ws_bootstrap->manual_window_update) {
+        aws_http_stream_update_window(stream, data->len);
+    }
+    return AWS_OP_SUCCESS;
+}
+
+static void s_ws_bootstrap_on_h2_stream_complete(struct aws_http_stream *stream, int error_code, void *user_data) {
+    (void)stream;
+    struct aws_websocket_client_bootstrap *ws_bootstrap = user_data;
+
+    ws_bootstrap->h2.is_stream_complete = true;
+    ws_bootstrap->h2.stream_error_code = error_code;
+
+    if (ws_bootstrap->h2.transport) {
+        /* Finishes once the channel has shut down */
+        aws_websocket_h2_transport_on_stream_complete(ws_bootstrap->h2.transport, error_code);
+        return;
+    }
+
+    if (ws_bootstrap->h2.channel) {
+        /* The channel is still being set up, or is shutting down. Its callback finishes */
+        return;
+    }
+
+    /* Only report the body if we received a complete response */
+    if (error_code == 0) {
+        ws_bootstrap->got_full_response_body = true;
+    }
+    s_ws_bootstrap_h2_invoke_setup_failure(ws_bootstrap, error_code);
+    s_ws_bootstrap_h2_try_finish(ws_bootstrap);
+}
+
+static void s_ws_bootstrap_on_h2_channel_setup(struct aws_channel *channel, int error_code, void *user_data) {
+    struct aws_websocket_client_bootstrap *ws_bootstrap = user_data;
+
+    if (error_code) {
+        /* A channel that failed setup never shuts down, it's just destroyed */
+        aws_channel_destroy(channel);
+        ws_bootstrap->h2.channel = NULL;
+        s_ws_bootstrap_h2_cancel_setup_due_to_err(ws_bootstrap, error_code);
+        if (ws_bootstrap->h2.is_stream_complete) {
+            s_ws_bootstrap_h2_invoke_setup_failure(ws_bootstrap, error_code);
+            s_ws_bootstrap_h2_try_finish(ws_bootstrap);
+        }
+        return;
+    }
+
+    if (ws_bootstrap->h2.is_stream_complete) {
+        /* The server ended the stream already */
+        int stream_error_code = ws_bootstrap->h2.stream_error_code;
+        s_ws_bootstrap_h2_cancel_setup_due_to_err(
+            ws_bootstrap, stream_error_code ? stream_error_code : AWS_ERROR_HTTP_CONNECTION_CLOSED);
+        aws_channel_shutdown(channel, ws_bootstrap->setup_error_code);
+        return;
+    }
+
+    ws_bootstrap->h2.transport = aws_websocket_h2_transport_new(ws_bootstrap->alloc, channel, ws_bootstrap->h2.stream);
+    if (!ws_bootstrap->h2.transport) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_WEBSOCKET_SETUP,
+            "id=%p: Failed to create HTTP/2 stream handler, error %d (%s)",
+            (void *)ws_bootstrap,
+            aws_last_error(),
+            aws_error_name(aws_last_error()));
+        goto error;
+    }
+
+    struct aws_websocket_handler_options ws_options = {
+        .allocator = ws_bootstrap->alloc,
+        .channel = channel,
+        .initial_window_size = ws_bootstrap->initial_window_size,
+        .user_data = ws_bootstrap->user_data,
+        .on_incoming_frame_begin = ws_bootstrap->websocket_frame_begin_callback,
+        .on_incoming_frame_payload = ws_bootstrap->websocket_frame_payload_callback,
+        .on_incoming_frame_complete = ws_bootstrap->websocket_frame_complete_callback,
+        .is_server = false,
+        .manual_window_update = ws_bootstrap->manual_window_update,
+        .permessage_deflate = ws_bootstrap->permessage_deflate_accepted,
+        .max_write_messages_in_flight = ws_bootstrap->max_write_messages_in_flight,
+        .write_coalescing_delay_us = ws_bootstrap->write_coalescing_delay_us,
+        .on_incoming_message = ws_bootstrap->websocket_message_callback,
+        .max_incoming_message_size = ws_bootstrap->max_incoming_message_size,
+    };
+
+    ws_bootstrap->websocket = s_system_vtable->aws_websocket_handler_new(&ws_options);
+    if (!ws_bootstrap->websocket) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_WEBSOCKET_SETUP,
+            "id=%p: Failed to create websocket handler, error %d (%s)",
+            (void *)ws_bootstrap,
+            aws_last_error(),
+            aws_error_name(aws_last_error()));
+        goto error;
+    }
+
+    /* Success! Setup complete! */
+    AWS_LOGF_TRACE(
+        AWS_LS_HTTP_WEBSOCKET_SETUP,
+        "id=%p: Setup success, created websocket=%p over HTTP/2 stream",
+        (void *)ws_bootstrap,
+        (void *)ws_bootstrap->websocket);
+
+    AWS_LOGF_DEBUG(
+        AWS_LS_HTTP_WEBSOCKET, "id=%p: Websocket client connection established.", (void *)ws_bootstrap->websocket);
+
+    s_ws_bootstrap_invoke_setup_callback(ws_bootstrap, 0 /*error_code*/);
+
+    /* Now that there's someone to read it, pass on what arrived early */
+    if (ws_bootstrap->h2.early_body.len > 0) {
+        struct aws_byte_cursor early_body = aws_byte_cursor_from_buf(&ws_bootstrap->h2.early_body);
+        if (aws_websocket_h2_transport_on_stream_body(ws_bootstrap->h2.transport, early_body)) {
+            aws_channel_shutdown(channel, aws_last_error());
+        }
+        aws_byte_buf_clean_up(&ws_bootstrap->h2.early_body);
+    }
+    return;
+
+error:
+    s_ws_bootstrap_h2_cancel_setup_due_to_err(ws_bootstrap, aws_last_error());
+    aws_channel_shutdown(channel, ws_bootstrap->setup_error_code);
+}
+
+static void s_ws_bootstrap_on_h2_channel_shutdown(struct aws_channel *channel, int error_code, void *user_data) {
+    (void)channel;
+    struct aws_websocket_client_bootstrap *ws_bootstrap = user_data;
+
+    ws_bootstrap->h2.is_channel_shutdown_complete = true;
+    ws_bootstrap->h2.transport = NULL;
+
+    /* Normally the stream's handler already ended it, but make sure */
+    if (!ws_bootstrap->h2.is_stream_complete) {
+        aws_http2_stream_reset(ws_bootstrap->h2.stream, AWS_HTTP2_ERR_CANCEL);
+    }
+
+    if (ws_bootstrap->websocket_setup_callback) {
+        AWS_ASSERT(!ws_bootstrap->websocket);
+        s_ws_bootstrap_h2_invoke_setup_failure(ws_bootstrap, error_code);
+
+    } else if (ws_bootstrap->websocket_shutdown_callback) {
+        AWS_LOGF_DEBUG(
+            AWS_LS_HTTP_WEBSOCKET,
+            "id=%p: Websocket client connection shut down with error %d (%s).",
+            (void *)ws_bootstrap->websocket,
+            error_code,
+            aws_error_name(error_code));
+
+        ws_bootstrap->websocket_shutdown_callback(ws_bootstrap->websocket, error_code, ws_bootstrap->user_data);
+    }
+
+    s_ws_bootstrap_h2_try_finish(ws_bootstrap);
+}
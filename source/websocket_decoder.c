@@ -6,6 +6,7 @@
 #include <aws/http/private/websocket_decoder.h>
 
 #include <aws/common/encoding.h>
+#include <aws/http/private/simd.h>
 
 #include <inttypes.h>
 
@@ -90,6 +91,7 @@ static int s_state_opcode_byte(struct aws_websocket_decoder *decoder, struct aws
 
     if (decoder->current_frame.opcode == AWS_WEBSOCKET_OPCODE_TEXT) {
         decoder->processing_text_message = true;
+        AWS_ZERO_STRUCT(decoder->text_message_validator);
     }
 
     decoder->state = AWS_WEBSOCKET_DECODER_STATE_LENGTH_BYTE;
@@ -261,25 +263,24 @@ static int s_state_payload(struct aws_websocket_decoder *decoder, struct aws_byt
     /* Unmask data, if necessary.
      * RFC-6455 Section 5.3 Client-to-Server Masking
      * Each byte of payload is XOR against a byte of the masking-key */
-    if (decoder->current_frame.masked) {
-        uint64_t mask_index = decoder->state_bytes_processed;
-
-        /* Optimization idea: don't do this 1 byte at a time */
-        uint8_t *current_byte = payload.ptr;
-        uint8_t *end_byte = payload.ptr + payload.len;
-        while (current_byte != end_byte) {
-            *current_byte++ ^= decoder->current_frame.masking_key[mask_index++ % 4];
-        }
-    }
+    const uint8_t *masking_key = decoder->current_frame.masked ? decoder->current_frame.masking_key : NULL;
 
     /* TODO: validate payload of CLOSE frame */
 
-    /* Validate the UTF-8 for TEXT messages (a TEXT frame and any subsequent CONTINUATION frames) */
+    /* Validate the UTF-8 for TEXT messages (a TEXT frame and any subsequent CONTINUATION frames).
+     * The validator unmasks as it goes, so the payload is only read once. */
     if (decoder->processing_text_message && aws_websocket_is_data_frame(decoder->current_frame.opcode)) {
-        if (aws_utf8_decoder_update(decoder->text_message_validator, payload)) {
+        if (aws_websocket_utf8_validator_update(
+                &decoder->text_message_validator,
+                payload.ptr,
+                payload.len,
+                masking_key,
+                decoder->state_bytes_processed)) {
             AWS_LOGF_ERROR(AWS_LS_HTTP_WEBSOCKET, "id=%p: Received invalid UTF-8", (void *)decoder->user_data);
             return aws_raise_error(AWS_ERROR_HTTP_WEBSOCKET_PROTOCOL_ERROR);
         }
+    } else if (masking_key) {
+        aws_websocket_mask_payload(payload.ptr, payload.len, masking_key, decoder->state_bytes_processed);
     }
 
     /* Invoke on_payload() callback to inform user of payload data */
@@ -308,7 +309,7 @@ static int s_state_frame_end(struct aws_websocket_decoder *decoder, struct aws_b
     if (decoder->processing_text_message && aws_websocket_is_data_frame(decoder->current_frame.opcode) &&
         decoder->current_frame.fin) {
 
-        if (aws_utf8_decoder_finalize(decoder->text_message_validator)) {
+        if (aws_websocket_utf8_validator_finalize(&decoder->text_message_validator)) {
             AWS_LOGF_ERROR(
                 AWS_LS_HTTP_WEBSOCKET,
                 "id=%p: Received invalid UTF-8 (incomplete encoding)",
@@ -374,14 +375,170 @@ void aws_websocket_decoder_init(
     aws_websocket_decoder_payload_fn *on_payload,
     void *user_data) {
 
+    (void)alloc;
+
     AWS_ZERO_STRUCT(*decoder);
     decoder->user_data = user_data;
     decoder->on_frame = on_frame;
     decoder->on_payload = on_payload;
-    decoder->text_message_validator = aws_utf8_decoder_new(alloc, NULL /*options*/);
 }
 
 void aws_websocket_decoder_clean_up(struct aws_websocket_decoder *decoder) {
-    aws_utf8_decoder_destroy(decoder->text_message_validator);
     AWS_ZERO_STRUCT(*decoder);
 }
+
+/* Validate one byte, the slow way */
+static int s_utf8_validate_byte(struct aws_websocket_utf8_validator *validator, uint8_t byte) {
+    if (validator->remaining_bytes == 0) {
+        if (byte < 0x80) {
+            return AWS_OP_SUCCESS;
+        }
+
+        /* The lead byte says how many continuation bytes follow */
+        if ((byte & 0xE0) == 0xC0) {
+            validator->codepoint = byte & 0x1F;
+            validator->min_codepoint = 0x80;
+            validator->remaining_bytes = 1;
+        } else if ((byte & 0xF0) == 0xE0) {
+            validator->codepoint = byte & 0x0F;
+            validator->min_codepoint = 0x800;
+            validator->remaining_bytes = 2;
+        } else if ((byte & 0xF8) == 0xF0) {
+            validator->codepoint = byte & 0x07;
+            validator->min_codepoint = 0x10000;
+            validator->remaining_bytes = 3;
+        } else {
+            return aws_raise_error(AWS_ERROR_INVALID_UTF8);
+        }
+        return AWS_OP_SUCCESS;
+    }
+
+    if ((byte & 0xC0) != 0x80) {
+        return aws_raise_error(AWS_ERROR_INVALID_UTF8);
+    }
+
+    validator->codepoint = (validator->codepoint << 6) | (byte & 0x3F);
+    validator->remaining_bytes--;
+    if (validator->remaining_bytes == 0) {
+        /* No overlong encodings, surrogates, or anything past the last codepoint */
+        if (validator->codepoint < validator->min_codepoint || validator->codepoint > 0x10FFFF ||
+            (validator->codepoint >= 0xD800 && validator->codepoint <= 0xDFFF)) {
+            return aws_raise_error(AWS_ERROR_INVALID_UTF8);
+        }
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+static int s_utf8_validate_bytes(struct aws_websocket_utf8_validator *validator, const uint8_t *bytes, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        if (s_utf8_validate_byte(validator, bytes[i])) {
+            return AWS_OP_ERR;
+        }
+    }
+    return AWS_OP_SUCCESS;
+}
+
+int aws_websocket_utf8_validator_update(
+    struct aws_websocket_utf8_validator *validator,
+    uint8_t *payload,
+    size_t len,
+    const uint8_t *masking_key,
+    uint64_t mask_offset) {
+
+    AWS_PRECONDITION(validator);
+    AWS_PRECONDITION(payload || len == 0);
+
+    /* The key rotated to line up with payload[0], as in aws_websocket_mask_payload().
+     * All zeros when there's no masking, so that XOR-ing it is harmless. */
+    uint8_t key[8] = {0};
+    if (masking_key) {
+        for (size_t i = 0; i < sizeof(key); ++i) {
+            key[i] = masking_key[(mask_offset + i) % 4];
+        }
+    }
+
+    /* Each block is unmasked, then skipped if it's all ASCII and no codepoint is in progress.
+     * Blocks with anything else go through the byte-at-a-time validator. */
+    size_t i = 0;
+#if defined(AWS_HTTP_SIMD_SSE2)
+    if (len >= 16) {
+        uint32_t key_32 = 0;
+        memcpy(&key_32, key, sizeof(key_32));
+        const __m128i key_vec = _mm_set1_epi32((int)key_32);
+        for (; len - i >= 16; i += 16) {
+            __m128i chunk = _mm_loadu_si128((const __m128i *)(payload + i));
+            if (masking_key) {
+                chunk = _mm_xor_si128(chunk, key_vec);
+                _mm_storeu_si128((__m128i *)(payload + i), chunk);
+            }
+            if (validator->remaining_bytes == 0 && _mm_movemask_epi8(chunk) == 0) {
+                continue;
+            }
+            if (s_utf8_validate_bytes(validator, payload + i, 16)) {
+                return AWS_OP_ERR;
+            }
+        }
+    }
+#elif defined(AWS_HTTP_SIMD_NEON)
+    if (len >= 16) {
+        uint32_t key_32 = 0;
+        memcpy(&key_32, key, sizeof(key_32));
+        const uint8x16_t key_vec = vreinterpretq_u8_u32(vdupq_n_u32(key_32));
+        const uint8x16_t high_bit = vdupq_n_u8(0x80);
+        for (; len - i >= 16; i += 16) {
+            uint8x16_t chunk = vld1q_u8(payload + i);
+            if (masking_key) {
+                chunk = veorq_u8(chunk, key_vec);
+                vst1q_u8(payload + i, chunk);
+            }
+            if (validator->remaining_bytes == 0 && aws_http_neon_nibble_mask(vtstq_u8(chunk, high_bit)) == 0) {
+                continue;
+            }
+            if (s_utf8_validate_bytes(validator, payload + i, 16)) {
+                return AWS_OP_ERR;
+            }
+        }
+    }
+#endif
+
+    /* memcpy for the word loads and stores, since the payload can have any alignment */
+    uint64_t key_64 = 0;
+    memcpy(&key_64, key, sizeof(key_64));
+    for (; len - i >= 8; i += 8) {
+        uint64_t word = 0;
+        memcpy(&word, payload + i, sizeof(word));
+        if (masking_key) {
+            word ^= key_64;
+            memcpy(payload + i, &word, sizeof(word));
+        }
+        if (validator->remaining_bytes == 0 && (word & 0x8080808080808080ULL) == 0) {
+            continue;
+        }
+        if (s_utf8_validate_bytes(validator, payload + i, 8)) {
+            return AWS_OP_ERR;
+        }
+    }
+
+    for (; i < len; ++i) {
+        if (masking_key) {
+            payload[i] ^= key[i % 4];
+        }
+        if (s_utf8_validate_byte(validator, payload[i])) {
+            return AWS_OP_ERR;
+        }
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+int aws_websocket_utf8_validator_finalize(struct aws_websocket_utf8_validator *validator) {
+    AWS_PRECONDITION(validator);
+
+    bool is_complete = validator->remaining_bytes == 0;
+    AWS_ZERO_STRUCT(*validator);
+    if (!is_complete) {
+        return aws_raise_error(AWS_ERROR_INVALID_UTF8);
+    }
+    return AWS_OP_SUCCESS;
+}
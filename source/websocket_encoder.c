@@ -5,6 +5,8 @@
 
 #include <aws/http/private/websocket_encoder.h>
 
+#include <aws/http/private/simd.h>
+
 #include <inttypes.h>
 
 typedef int(state_fn)(struct aws_websocket_encoder *encoder, struct aws_byte_buf *out_buf);
@@ -201,14 +203,8 @@ static int s_state_payload(struct aws_websocket_encoder *encoder, struct aws_byt
      * RFC-6455 Section 5.3 Client-to-Server Masking
      * Each byte of payload is XOR against a byte of the masking-key */
     if (encoder->frame.masked) {
-        uint64_t mask_index = prev_bytes_processed;
-
-        /* Optimization idea: don't do this 1 byte at a time */
-        uint8_t *current_byte = out_buf->buffer + prev_buf.len;
-        uint8_t *end_byte = out_buf->buffer + out_buf->len;
-        while (current_byte != end_byte) {
-            *current_byte++ ^= encoder->frame.masking_key[mask_index++ % 4];
-        }
+        aws_websocket_mask_payload(
+            out_buf->buffer + prev_buf.len, bytes_written, encoder->frame.masking_key, prev_bytes_processed);
     }
 
     /* If done writing payload, proceed to next state */
@@ -269,6 +265,31 @@ int aws_websocket_encoder_process(struct aws_websocket_encoder *encoder, struct
     return AWS_OP_SUCCESS;
 }
 
+int aws_websocket_encoder_take_payload(struct aws_websocket_encoder *encoder, uint64_t len) {
+    if (encoder->state != AWS_WEBSOCKET_ENCODER_STATE_PAYLOAD || encoder->frame.masked) {
+        return aws_raise_error(AWS_ERROR_INVALID_STATE);
+    }
+
+    uint64_t bytes_processed;
+    if (aws_add_u64_checked(encoder->state_bytes_processed, len, &bytes_processed) ||
+        bytes_processed > encoder->frame.payload_length) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_WEBSOCKET,
+            "id=%p: Outgoing stream has exceeded stated payload length of %" PRIu64,
+            (void *)encoder->user_data,
+            encoder->frame.payload_length);
+        return aws_raise_error(AWS_ERROR_HTTP_OUTGOING_STREAM_LENGTH_INCORRECT);
+    }
+
+    encoder->state_bytes_processed = bytes_processed;
+    if (bytes_processed == encoder->frame.payload_length) {
+        encoder->state = AWS_WEBSOCKET_ENCODER_STATE_INIT;
+        encoder->is_frame_in_progress = false;
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
 int aws_websocket_encoder_start_frame(struct aws_websocket_encoder *encoder, const struct aws_websocket_frame *frame) {
     /* Error-check as much as possible before accepting next frame */
     if (encoder->is_frame_in_progress) {
@@ -373,3 +394,48 @@ uint64_t aws_websocket_frame_encoded_size(const struct aws_websocket_frame *fram
 
     return total;
 }
+
+void aws_websocket_mask_payload(uint8_t *payload, size_t len, const uint8_t masking_key[4], uint64_t mask_offset) {
+    /* The key rotated so that its first byte lines up with payload[0], twice over for whole 8 byte words.
+     * Every word and vector is a multiple of 4 bytes long, so the key stays lined up from one to the next. */
+    uint8_t key[8];
+    for (size_t i = 0; i < sizeof(key); ++i) {
+        key[i] = masking_key[(mask_offset + i) % 4];
+    }
+
+    size_t i = 0;
+#if defined(AWS_HTTP_SIMD_SSE2)
+    if (len >= 16) {
+        uint32_t key_32 = 0;
+        memcpy(&key_32, key, sizeof(key_32));
+        const __m128i key_vec = _mm_set1_epi32((int)key_32);
+        for (; len - i >= 16; i += 16) {
+            const __m128i chunk = _mm_loadu_si128((const __m128i *)(payload + i));
+            _mm_storeu_si128((__m128i *)(payload + i), _mm_xor_si128(chunk, key_vec));
+        }
+    }
+#elif defined(AWS_HTTP_SIMD_NEON)
+    if (len >= 16) {
+        uint32_t key_32 = 0;
+        memcpy(&key_32, key, sizeof(key_32));
+        const uint8x16_t key_vec = vreinterpretq_u8_u32(vdupq_n_u32(key_32));
+        for (; len - i >= 16; i += 16) {
+            vst1q_u8(payload + i, veorq_u8(vld1q_u8(payload + i), key_vec));
+        }
+    }
+#endif
+
+    /* memcpy for the word loads and stores, since the payload can have any alignment */
+    uint64_t key_64 = 0;
+    memcpy(&key_64, key, sizeof(key_64));
+    for (; len - i >= 8; i += 8) {
+        uint64_t word = 0;
+        memcpy(&word, payload + i, sizeof(word));
+        word ^= key_64;
+        memcpy(payload + i, &word, sizeof(word));
+    }
+
+    for (; i < len; ++i) {
+        payload[i] ^= key[i % 4];
+    }
+}
@@ -0,0 +1,336 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/private/websocket_impl.h>
+
+#include <aws/common/logging.h>
+#include <aws/http/connection.h>
+#include <aws/http/request_response.h>
+#include <aws/io/channel.h>
+#include <aws/io/logging.h>
+
+#include <inttypes.h>
+
+#ifdef _MSC_VER
+#    pragma warning(disable : 4204) /* non-constant aggregate initializer */
+#endif
+
+/**
+ * The first handler in a channel whose "socket" is an HTTP/2 stream, for websockets over HTTP/2 (RFC-8441).
+ * Messages written down the channel become the stream's DATA, and the stream's DATA is sent up the channel.
+ * This lets the websocket handler work the same whether it owns a connection, or shares one as a stream.
+ * Everything here happens on the thread of the stream's connection, which is also the channel's thread.
+ */
+struct aws_websocket_h2_transport {
+    struct aws_allocator *alloc;
+    struct aws_channel_handler handler;
+    struct aws_channel_slot *slot;
+
+    /* Not owned, the websocket bootstrap keeps the stream alive until the channel is destroyed */
+    struct aws_http_stream *stream;
+
+    /* DATA received when the read direction had no window for it. Sent on once the window opens */
+    struct aws_byte_buf pending_read;
+
+    /* Bytes sent up the channel that the stream hasn't been given window for yet */
+    size_t window_to_restore;
+
+    bool is_stream_complete;
+    bool is_read_stopped;
+    bool is_write_stopped;
+};
+
+static int s_handler_process_read_message(
+    struct aws_channel_handler *handler,
+    struct aws_channel_slot *slot,
+    struct aws_io_message *message);
+
+static int s_handler_process_write_message(
+    struct aws_channel_handler *handler,
+    struct aws_channel_slot *slot,
+    struct aws_io_message *message);
+
+static int s_handler_increment_read_window(
+    struct aws_channel_handler *handler,
+    struct aws_channel_slot *slot,
+    size_t size);
+
+static int s_handler_shutdown(
+    struct aws_channel_handler *handler,
+    struct aws_channel_slot *slot,
+    enum aws_channel_direction dir,
+    int error_code,
+    bool free_scarce_resources_immediately);
+
+static size_t s_handler_initial_window_size(struct aws_channel_handler *handler);
+static size_t s_handler_message_overhead(struct aws_channel_handler *handler);
+static void s_handler_destroy(struct aws_channel_handler *handler);
+
+static struct aws_channel_handler_vtable s_h2_transport_vtable = {
+    .process_read_message = s_handler_process_read_message,
+    .process_write_message = s_handler_process_write_message,
+    .increment_read_window = s_handler_increment_read_window,
+    .shutdown = s_handler_shutdown,
+    .initial_window_size = s_handler_initial_window_size,
+    .message_overhead = s_handler_message_overhead,
+    .destroy = s_handler_destroy,
+};
+
+struct aws_websocket_h2_transport *aws_websocket_h2_transport_new(
+    struct aws_allocator *allocator,
+    struct aws_channel *channel,
+    struct aws_http_stream *stream) {
+
+    AWS_PRECONDITION(aws_channel_thread_is_callers_thread(channel));
+
+    struct aws_channel_slot *slot = aws_channel_slot_new(channel);
+    if (!slot) {
+        return NULL;
+    }
+
+    if (aws_channel_slot_insert_end(channel, slot)) {
+        goto error;
+    }
+
+    struct aws_websocket_h2_transport *transport =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_websocket_h2_transport));
+    transport->alloc = allocator;
+    transport->handler.vtable = &s_h2_transport_vtable;
+    transport->handler.alloc = allocator;
+    transport->handler.impl = transport;
+    transport->slot = slot;
+    transport->stream = stream;
+    aws_byte_buf_init(&transport->pending_read, allocator, 0);
+
+    if (aws_channel_slot_set_handler(slot, &transport->handler)) {
+        s_handler_destroy(&transport->handler);
+        goto error;
+    }
+
+    AWS_LOGF_TRACE(
+        AWS_LS_HTTP_WEBSOCKET,
+        "id=%p: Carrying channel over HTTP/2 stream=%p (id=%" PRIu32 ")",
+        (void *)transport,
+        (void *)stream,
+        aws_http_stream_get_id(stream));
+    return transport;
+
+error:
+    aws_channel_slot_remove(slot);
+    return NULL;
+}
+
+static void s_handler_destroy(struct aws_channel_handler *handler) {
+    struct aws_websocket_h2_transport *transport = handler->impl;
+    aws_byte_buf_clean_up(&transport->pending_read);
+    aws_mem_release(transport->alloc, transport);
+}
+
+static size_t s_handler_initial_window_size(struct aws_channel_handler *handler) {
+    (void)handler;
+    /* Nothing sends messages up to this handler, the stream's DATA comes from the side */
+    return SIZE_MAX;
+}
+
+static size_t s_handler_message_overhead(struct aws_channel_handler *handler) {
+    (void)handler;
+    return 0;
+}
+
+static int s_handler_process_read_message(
+    struct aws_channel_handler *handler,
+    struct aws_channel_slot *slot,
+    struct aws_io_message *message) {
+
+    (void)handler;
+    (void)slot;
+    (void)message;
+    /* This is the first handler, nothing is to the left of it */
+    return aws_raise_error(AWS_ERROR_INVALID_STATE);
+}
+
+/* Send as much of the data up the channel as its window allows.
+ * The data is advanced past whatever was sent */
+static int s_send_up_channel(struct aws_websocket_h2_transport *transport, struct aws_byte_cursor *data) {
+    struct aws_channel *channel = transport->slot->channel;
+    while (data->len > 0) {
+        size_t window = aws_channel_slot_downstream_read_window(transport->slot);
+        if (window == 0) {
+            break;
+        }
+
+        size_t chunk_size = aws_min_size(data->len, window);
+        struct aws_io_message *msg =
+            aws_channel_acquire_message_from_pool(channel, AWS_IO_MESSAGE_APPLICATION_DATA, chunk_size);
+        if (!msg) {
+            return AWS_OP_ERR;
+        }
+
+        /* The pool may give us less than we asked for */
+        chunk_size = aws_min_size(chunk_size, msg->message_data.capacity);
+        struct aws_byte_cursor chunk = aws_byte_cursor_advance(data, chunk_size);
+        aws_byte_buf_write_from_whole_cursor(&msg->message_data, chunk);
+
+        if (aws_channel_slot_send_message(transport->slot, msg, AWS_CHANNEL_DIR_READ)) {
+            aws_mem_release(msg->allocator, msg);
+            return AWS_OP_ERR;
+        }
+        transport->window_to_restore += chunk_size;
+    }
+    return AWS_OP_SUCCESS;
+}
+
+int aws_websocket_h2_transport_on_stream_body(
+    struct aws_websocket_h2_transport *transport,
+    struct aws_byte_cursor data) {
+
+    AWS_PRECONDITION(aws_channel_thread_is_callers_thread(transport->slot->channel));
+
+    if (transport->is_read_stopped) {
+        /* The channel is shutting down, no one is left to read it */
+        return AWS_OP_SUCCESS;
+    }
+
+    /* Don't jump ahead of data that's already waiting */
+    if (transport->pending_read.len == 0) {
+        if (s_send_up_channel(transport, &data)) {
+            AWS_LOGF_ERROR(
+                AWS_LS_HTTP_WEBSOCKET,
+                "id=%p: Failed to send stream DATA up the channel, error %d (%s).",
+                (void *)transport,
+                aws_last_error(),
+                aws_error_name(aws_last_error()));
+            return AWS_OP_ERR;
+        }
+    }
+
+    if (data.len > 0) {
+        aws_byte_buf_append_dynamic(&transport->pending_read, &data);
+    }
+    return AWS_OP_SUCCESS;
+}
+
+void aws_websocket_h2_transport_on_stream_complete(struct aws_websocket_h2_transport *transport, int error_code) {
+    AWS_PRECONDITION(aws_channel_thread_is_callers_thread(transport->slot->channel));
+
+    AWS_LOGF_DEBUG(
+        AWS_LS_HTTP_WEBSOCKET,
+        "id=%p: HTTP/2 stream completed with error %d (%s), shutting down channel.",
+        (void *)transport,
+        error_code,
+        aws_error_name(error_code));
+
+    transport->is_stream_complete = true;
+    aws_channel_shutdown(transport->slot->channel, error_code);
+}
+
+static int s_handler_increment_read_window(
+    struct aws_channel_handler *handler,
+    struct aws_channel_slot *slot,
+    size_t size) {
+
+    (void)slot;
+    (void)size;
+    struct aws_websocket_h2_transport *transport = handler->impl;
+
+    if (transport->is_read_stopped) {
+        return AWS_OP_SUCCESS;
+    }
+
+    if (transport->pending_read.len > 0) {
+        struct aws_byte_cursor pending = aws_byte_cursor_from_buf(&transport->pending_read);
+        int err = s_send_up_channel(transport, &pending);
+        /* Keep whatever didn't fit at the front of the buffer */
+        memmove(transport->pending_read.buffer, pending.ptr, pending.len);
+        transport->pending_read.len = pending.len;
+        if (err) {
+            aws_channel_shutdown(slot->channel, aws_last_error());
+            return AWS_OP_SUCCESS;
+        }
+    }
+
+    /* Only give the stream back the window for bytes the channel has consumed.
+     * The channel's window isn't the stream's window, their initial sizes come from different places */
+    if (!transport->is_stream_complete && transport->window_to_restore > 0 && transport->pending_read.len == 0) {
+        aws_http_stream_update_window(transport->stream, transport->window_to_restore);
+        transport->window_to_restore = 0;
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+static void s_on_stream_write_complete(struct aws_http_stream *stream, int error_code, void *user_data) {
+    (void)stream;
+    struct aws_io_message *message = user_data;
+
+    if (message->on_completion) {
+        message->on_completion(message->owning_channel, message, error_code, message->user_data);
+    }
+    aws_mem_release(message->allocator, message);
+}
+
+static int s_handler_process_write_message(
+    struct aws_channel_handler *handler,
+    struct aws_channel_slot *slot,
+    struct aws_io_message *message) {
+
+    (void)slot;
+    struct aws_websocket_h2_transport *transport = handler->impl;
+
+    if (transport->is_write_stopped || transport->is_stream_complete) {
+        return aws_raise_error(AWS_ERROR_HTTP_STREAM_HAS_COMPLETED);
+    }
+
+    /* The message's memory stays put until the write completes, so the stream can send it without a copy */
+    struct aws_http2_stream_write_data_options write = {
+        .data_buffer = aws_byte_cursor_from_buf(&message->message_data),
+        .on_complete = s_on_stream_write_complete,
+        .user_data = message,
+    };
+    if (aws_http2_stream_write_data(transport->stream, &write)) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_WEBSOCKET,
+            "id=%p: Failed to write to HTTP/2 stream, error %d (%s).",
+            (void *)transport,
+            aws_last_error(),
+            aws_error_name(aws_last_error()));
+        return AWS_OP_ERR;
+    }
+    return AWS_OP_SUCCESS;
+}
+
+static int s_handler_shutdown(
+    struct aws_channel_handler *handler,
+    struct aws_channel_slot *slot,
+    enum aws_channel_direction dir,
+    int error_code,
+    bool free_scarce_resources_immediately) {
+
+    struct aws_websocket_h2_transport *transport = handler->impl;
+
+    if (dir == AWS_CHANNEL_DIR_READ) {
+        transport->is_read_stopped = true;
+        aws_byte_buf_reset(&transport->pending_read, false);
+    } else {
+        transport->is_write_stopped = true;
+        if (!transport->is_stream_complete) {
+            if (error_code || free_scarce_resources_immediately) {
+                /* Abnormal closure (RFC-8441 6) */
+                aws_http2_stream_reset(transport->stream, AWS_HTTP2_ERR_CANCEL);
+            } else {
+                /* Orderly closure, the websocket's CLOSE frame is already written. End our side of the stream */
+                struct aws_http2_stream_write_data_options write = {
+                    .end_stream = true,
+                };
+                if (aws_http2_stream_write_data(transport->stream, &write)) {
+                    aws_http2_stream_reset(transport->stream, AWS_HTTP2_ERR_CANCEL);
+                }
+            }
+        }
+    }
+
+    aws_channel_slot_on_handler_shutdown_complete(slot, dir, error_code, free_scarce_resources_immediately);
+    return AWS_OP_SUCCESS;
+}
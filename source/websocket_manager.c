@@ -0,0 +1,997 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/websocket_manager.h>
+
+#include <aws/http/private/websocket_impl.h>
+#include <aws/http/private/websocket_manager_system_vtable.h>
+#include <aws/http/request_response.h>
+
+#include <aws/io/channel_bootstrap.h>
+#include <aws/io/event_loop.h>
+#include <aws/io/logging.h>
+#include <aws/io/socket.h>
+#include <aws/io/tls_channel_handler.h>
+
+#include <aws/common/clock.h>
+#include <aws/common/linked_list.h>
+#include <aws/common/mutex.h>
+#include <aws/common/ref_count.h>
+#include <aws/common/string.h>
+
+#ifdef _MSC_VER
+#    pragma warning(disable : 4204) /* non-constant aggregate initializer */
+#    pragma warning(disable : 4232) /* function pointer to dll symbol */
+#endif
+
+static const struct aws_websocket_manager_system_vtable s_default_system_vtable = {
+    .aws_websocket_client_connect = aws_websocket_client_connect,
+    .aws_websocket_send_frame = aws_websocket_send_frame,
+    .aws_websocket_close = aws_websocket_close,
+    .aws_websocket_release = aws_websocket_release,
+    .aws_websocket_is_open = aws_websocket_is_open,
+    .get_monotonic_time = aws_high_res_clock_get_ticks,
+};
+
+static const struct aws_websocket_manager_system_vtable *s_system_vtable = &s_default_system_vtable;
+
+void aws_websocket_manager_set_system_vtable(const struct aws_websocket_manager_system_vtable *system_vtable) {
+    s_system_vtable = system_vtable ? system_vtable : &s_default_system_vtable;
+}
+
+enum aws_websocket_manager_state_type {
+    AWS_WSMST_READY,
+    AWS_WSMST_SHUTTING_DOWN,
+};
+
+/*
+ * A websocket connected by the manager, from the connect call until the manager lets go of it: once it has shut
+ * down, and isn't vended.
+ */
+struct aws_websocket_manager_entry {
+    struct aws_allocator *allocator;
+    struct aws_websocket_manager *manager;
+    /* NULL until setup completes */
+    struct aws_websocket *websocket;
+
+    /*
+     * The rest is protected by the manager's lock.
+     * In the manager's idle_websockets while is_idle, or vended_websockets while is_vended.
+     * Neither while it's being closed.
+     */
+    struct aws_linked_list_node node;
+    bool is_idle;
+    bool is_vended;
+    bool is_shut_down;
+    /* When it last went idle, for max_websocket_idle_ms */
+    uint64_t idle_timestamp;
+    /* When the server was last heard from, for ping_interval_ms */
+    uint64_t heard_timestamp;
+    /* When the PING was sent, while one is waiting for its PONG */
+    uint64_t ping_timestamp;
+    bool is_ping_outstanding;
+
+    /*
+     * The callbacks of whoever has the websocket, see aws_websocket_manager_acquire_options.
+     * They have a lock of their own, so incoming frames don't contend for the manager's lock.
+     * Lock order is manager->synced_data.lock, then lease_lock.
+     */
+    struct aws_mutex lease_lock;
+    struct aws_websocket_manager_acquire_options lease;
+    bool is_leased;
+};
+
+/* An acquisition waiting for a websocket, or about to be told it has one */
+struct aws_websocket_manager_pending_acquisition {
+    struct aws_allocator *allocator;
+    struct aws_linked_list_node node;
+    struct aws_websocket_manager_acquire_options options;
+    /* The websocket vended to it, or the error_code to fail with */
+    struct aws_websocket_manager_entry *entry;
+    int error_code;
+};
+
+struct aws_websocket_manager {
+    struct aws_allocator *allocator;
+    const struct aws_websocket_manager_system_vtable *system_vtable;
+
+    /* Refcount managed by user. Once this drops to zero, the manager state transitions to shutting down */
+    struct aws_ref_count ref_count;
+
+    /* Configuration, immutable after creation */
+    struct aws_client_bootstrap *bootstrap;
+    struct aws_socket_options socket_options;
+    struct aws_tls_connection_options *tls_options;
+    struct aws_string *host;
+    uint16_t port;
+    struct aws_string *path;
+    struct aws_http_headers *handshake_headers;
+    size_t initial_window_size;
+    bool manual_window_management;
+    size_t max_websockets;
+    size_t min_idle_websockets;
+    uint64_t max_idle_ns;
+    uint64_t ping_interval_ns;
+    uint64_t ping_timeout_ns;
+    void *shutdown_complete_user_data;
+    aws_websocket_manager_shutdown_complete_fn *shutdown_complete_callback;
+
+    /*
+     * Culls and pings idle websockets. Runs periodically on maintenance_event_loop if max_websocket_idle_ms or
+     * ping_interval_ms is set, and always reschedules itself, until the final destruction task cancels it.
+     */
+    struct aws_event_loop *maintenance_event_loop;
+    struct aws_task maintenance_task;
+    uint64_t maintenance_period_ns;
+    struct aws_task final_destruction_task;
+
+    /* Any thread may touch this data, but the lock must be held */
+    struct {
+        struct aws_mutex lock;
+        enum aws_websocket_manager_state_type state;
+
+        /* List of aws_websocket_manager_entry. The one idle the longest is at the front */
+        struct aws_linked_list idle_websockets;
+        size_t idle_count;
+
+        /* List of aws_websocket_manager_entry */
+        struct aws_linked_list vended_websockets;
+
+        /* List of aws_websocket_manager_pending_acquisition, in the order they were made */
+        struct aws_linked_list pending_acquisitions;
+        size_t pending_acquisition_count;
+
+        /* Connect calls whose setup callback hasn't fired yet */
+        size_t pending_connect_count;
+
+        /* Websockets that are set up and not yet let go of, whether idle, vended or being closed */
+        size_t open_count;
+
+        bool is_destroying;
+    } synced_data;
+};
+
+/*
+ * Everything to do outside the lock once the manager's state is updated.
+ * Built under the lock, then executed outside of it.
+ */
+struct aws_websocket_manager_transaction {
+    struct aws_websocket_manager *manager;
+    /* List of aws_websocket_manager_pending_acquisition to invoke the callbacks of */
+    struct aws_linked_list completed_acquisitions;
+    size_t new_websockets;
+    /* The manager is done with it, release its websocket and free it */
+    struct aws_websocket_manager_entry *entry_to_destroy;
+    bool should_destroy_manager;
+};
+
+static void s_on_websocket_setup(const struct aws_websocket_on_connection_setup_data *setup, void *user_data);
+static void s_on_websocket_shutdown(struct aws_websocket *websocket, int error_code, void *user_data);
+static bool s_on_incoming_frame_begin(
+    struct aws_websocket *websocket,
+    const struct aws_websocket_incoming_frame *frame,
+    void *user_data);
+static bool s_on_incoming_frame_payload(
+    struct aws_websocket *websocket,
+    const struct aws_websocket_incoming_frame *frame,
+    struct aws_byte_cursor data,
+    void *user_data);
+static bool s_on_incoming_frame_complete(
+    struct aws_websocket *websocket,
+    const struct aws_websocket_incoming_frame *frame,
+    int error_code,
+    void *user_data);
+static void s_maintenance_task(struct aws_task *task, void *arg, enum aws_task_status status);
+
+static void s_lock_synced_data(struct aws_websocket_manager *manager) {
+    int err = aws_mutex_lock(&manager->synced_data.lock);
+    AWS_ASSERT(!err && "lock failed");
+    (void)err;
+}
+
+static void s_unlock_synced_data(struct aws_websocket_manager *manager) {
+    int err = aws_mutex_unlock(&manager->synced_data.lock);
+    AWS_ASSERT(!err && "unlock failed");
+    (void)err;
+}
+
+static uint64_t s_now(const struct aws_websocket_manager *manager) {
+    uint64_t now = 0;
+    manager->system_vtable->get_monotonic_time(&now);
+    return now;
+}
+
+static void s_transaction_init(
+    struct aws_websocket_manager_transaction *transaction,
+    struct aws_websocket_manager *manager) {
+
+    AWS_ZERO_STRUCT(*transaction);
+    transaction->manager = manager;
+    aws_linked_list_init(&transaction->completed_acquisitions);
+}
+
+static void s_entry_destroy(struct aws_websocket_manager_entry *entry) {
+    if (entry->websocket) {
+        entry->manager->system_vtable->aws_websocket_release(entry->websocket);
+    }
+    aws_mutex_clean_up(&entry->lease_lock);
+    aws_mem_release(entry->allocator, entry);
+}
+
+/* Copy the callbacks of whoever has the websocket. Returns false while no one does */
+static bool s_get_lease(
+    struct aws_websocket_manager_entry *entry,
+    struct aws_websocket_manager_acquire_options *lease) {
+    aws_mutex_lock(&entry->lease_lock);
+    bool is_leased = entry->is_leased;
+    if (is_leased) {
+        *lease = entry->lease;
+    }
+    aws_mutex_unlock(&entry->lease_lock);
+    return is_leased;
+}
+
+static void s_set_lease(
+    struct aws_websocket_manager_entry *entry,
+    const struct aws_websocket_manager_acquire_options *lease) {
+
+    aws_mutex_lock(&entry->lease_lock);
+    entry->is_leased = lease != NULL;
+    if (lease) {
+        entry->lease = *lease;
+    } else {
+        AWS_ZERO_STRUCT(entry->lease);
+    }
+    aws_mutex_unlock(&entry->lease_lock);
+}
+
+static void s_make_idle_synced(struct aws_websocket_manager_entry *entry, uint64_t now) {
+    struct aws_websocket_manager *manager = entry->manager;
+    entry->is_idle = true;
+    entry->idle_timestamp = now;
+    aws_linked_list_push_back(&manager->synced_data.idle_websockets, &entry->node);
+    ++manager->synced_data.idle_count;
+}
+
+static void s_remove_idle_synced(struct aws_websocket_manager_entry *entry) {
+    AWS_ASSERT(entry->is_idle);
+    entry->is_idle = false;
+    aws_linked_list_remove(&entry->node);
+    --entry->manager->synced_data.idle_count;
+}
+
+/* Closing only schedules the shutdown on the websocket's thread, so it's fine to do with the lock held.
+ * The entry stays around until the shutdown callback */
+static void s_close_synced(struct aws_websocket_manager_entry *entry, bool free_scarce_resources_immediately) {
+    if (entry->is_idle) {
+        s_remove_idle_synced(entry);
+    }
+    entry->manager->system_vtable->aws_websocket_close(entry->websocket, free_scarce_resources_immediately);
+}
+
+static void s_vend_synced(
+    struct aws_websocket_manager_entry *entry,
+    struct aws_websocket_manager_pending_acquisition *acquisition,
+    struct aws_websocket_manager_transaction *transaction) {
+
+    struct aws_websocket_manager *manager = entry->manager;
+    if (entry->is_idle) {
+        s_remove_idle_synced(entry);
+    }
+    entry->is_vended = true;
+    entry->is_ping_outstanding = false;
+    aws_linked_list_push_back(&manager->synced_data.vended_websockets, &entry->node);
+    s_set_lease(entry, &acquisition->options);
+
+    acquisition->entry = entry;
+    aws_linked_list_push_back(&transaction->completed_acquisitions, &acquisition->node);
+}
+
+static void s_fail_acquisition_synced(
+    struct aws_websocket_manager *manager,
+    struct aws_websocket_manager_transaction *transaction,
+    int error_code) {
+
+    struct aws_linked_list_node *node = aws_linked_list_pop_front(&manager->synced_data.pending_acquisitions);
+    --manager->synced_data.pending_acquisition_count;
+
+    struct aws_websocket_manager_pending_acquisition *acquisition =
+        AWS_CONTAINER_OF(node, struct aws_websocket_manager_pending_acquisition, node);
+    acquisition->error_code = error_code;
+    aws_linked_list_push_back(&transaction->completed_acquisitions, &acquisition->node);
+}
+
+/*
+ * Work out what to do next from the manager's state: serve pending acquisitions from the idle pool, and connect
+ * enough new websockets for the rest, plus min_idle_websockets. Or, when shutting down, fail the acquisitions and
+ * close the idle pool.
+ * After a connect fails, skip_prewarm holds off topping up the idle pool until the next maintenance task or
+ * transaction, so an unreachable host isn't retried in a tight loop.
+ */
+static void s_build_transaction_synced(struct aws_websocket_manager_transaction *transaction, bool skip_prewarm) {
+    struct aws_websocket_manager *manager = transaction->manager;
+
+    if (manager->synced_data.state == AWS_WSMST_READY) {
+        while (manager->synced_data.pending_acquisition_count > 0 && manager->synced_data.idle_count > 0) {
+            /* Most recently used first, so the ones that aren't needed go idle long enough to be culled */
+            struct aws_linked_list_node *idle_node = aws_linked_list_back(&manager->synced_data.idle_websockets);
+            struct aws_linked_list_node *acquisition_node =
+                aws_linked_list_pop_front(&manager->synced_data.pending_acquisitions);
+            --manager->synced_data.pending_acquisition_count;
+
+            s_vend_synced(
+                AWS_CONTAINER_OF(idle_node, struct aws_websocket_manager_entry, node),
+                AWS_CONTAINER_OF(acquisition_node, struct aws_websocket_manager_pending_acquisition, node),
+                transaction);
+        }
+
+        size_t wanted = manager->synced_data.pending_acquisition_count;
+        if (!skip_prewarm && manager->synced_data.idle_count < manager->min_idle_websockets) {
+            wanted += manager->min_idle_websockets - manager->synced_data.idle_count;
+        }
+
+        size_t in_use = manager->synced_data.open_count + manager->synced_data.pending_connect_count;
+        size_t room = manager->max_websockets > in_use ? manager->max_websockets - in_use : 0;
+        if (wanted > manager->synced_data.pending_connect_count) {
+            transaction->new_websockets = aws_min_size(wanted - manager->synced_data.pending_connect_count, room);
+            manager->synced_data.pending_connect_count += transaction->new_websockets;
+        }
+        return;
+    }
+
+    while (manager->synced_data.pending_acquisition_count > 0) {
+        s_fail_acquisition_synced(manager, transaction, AWS_ERROR_HTTP_WEBSOCKET_MANAGER_SHUTTING_DOWN);
+    }
+
+    while (!aws_linked_list_empty(&manager->synced_data.idle_websockets)) {
+        struct aws_linked_list_node *node = aws_linked_list_front(&manager->synced_data.idle_websockets);
+        s_close_synced(AWS_CONTAINER_OF(node, struct aws_websocket_manager_entry, node), false);
+    }
+
+    if (manager->synced_data.open_count == 0 && manager->synced_data.pending_connect_count == 0 &&
+        !manager->synced_data.is_destroying) {
+        manager->synced_data.is_destroying = true;
+        transaction->should_destroy_manager = true;
+    }
+}
+
+static void s_manager_destroy(struct aws_websocket_manager *manager) {
+    AWS_LOGF_INFO(AWS_LS_HTTP_WEBSOCKET_MANAGER, "id=%p: Destroying self", (void *)manager);
+
+    AWS_FATAL_ASSERT(aws_linked_list_empty(&manager->synced_data.idle_websockets));
+    AWS_FATAL_ASSERT(aws_linked_list_empty(&manager->synced_data.vended_websockets));
+    AWS_FATAL_ASSERT(aws_linked_list_empty(&manager->synced_data.pending_acquisitions));
+
+    aws_string_destroy(manager->host);
+    aws_string_destroy(manager->path);
+    aws_http_headers_release(manager->handshake_headers);
+    if (manager->tls_options) {
+        aws_tls_connection_options_clean_up(manager->tls_options);
+        aws_mem_release(manager->allocator, manager->tls_options);
+    }
+    aws_mutex_clean_up(&manager->synced_data.lock);
+    aws_client_bootstrap_release(manager->bootstrap);
+
+    if (manager->shutdown_complete_callback) {
+        manager->shutdown_complete_callback(manager->shutdown_complete_user_data);
+    }
+
+    aws_mem_release(manager->allocator, manager);
+}
+
+/* Scheduled on the maintenance task's event loop, the only place that task can be cancelled from */
+static void s_final_destruction_task(struct aws_task *task, void *arg, enum aws_task_status status) {
+    (void)task;
+    (void)status;
+    struct aws_websocket_manager *manager = arg;
+
+    aws_event_loop_cancel_task(manager->maintenance_event_loop, &manager->maintenance_task);
+    s_manager_destroy(manager);
+}
+
+static int s_connect_new_websocket(struct aws_websocket_manager *manager);
+static void s_on_connect_failed(struct aws_websocket_manager *manager, int error_code);
+
+static void s_execute_transaction(struct aws_websocket_manager_transaction *transaction) {
+    struct aws_websocket_manager *manager = transaction->manager;
+
+    if (transaction->entry_to_destroy) {
+        s_entry_destroy(transaction->entry_to_destroy);
+    }
+
+    /* Connect outside the lock, the setup callback may fire on another thread before this returns */
+    for (size_t i = 0; i < transaction->new_websockets; ++i) {
+        if (s_connect_new_websocket(manager)) {
+            s_on_connect_failed(manager, aws_last_error());
+        }
+    }
+
+    while (!aws_linked_list_empty(&transaction->completed_acquisitions)) {
+        struct aws_linked_list_node *node = aws_linked_list_pop_front(&transaction->completed_acquisitions);
+        struct aws_websocket_manager_pending_acquisition *acquisition =
+            AWS_CONTAINER_OF(node, struct aws_websocket_manager_pending_acquisition, node);
+
+        if (acquisition->entry) {
+            AWS_LOGF_DEBUG(
+                AWS_LS_HTTP_WEBSOCKET_MANAGER,
+                "id=%p: Vending websocket %p",
+                (void *)manager,
+                (void *)acquisition->entry->websocket);
+            acquisition->options.on_acquired(
+                acquisition->entry->websocket, AWS_ERROR_SUCCESS, acquisition->options.user_data);
+        } else {
+            AWS_LOGF_DEBUG(
+                AWS_LS_HTTP_WEBSOCKET_MANAGER,
+                "id=%p: Failing websocket acquisition with error %d (%s)",
+                (void *)manager,
+                acquisition->error_code,
+                aws_error_str(acquisition->error_code));
+            acquisition->options.on_acquired(NULL, acquisition->error_code, acquisition->options.user_data);
+        }
+        aws_mem_release(acquisition->allocator, acquisition);
+    }
+
+    if (transaction->should_destroy_manager) {
+        if (manager->maintenance_event_loop) {
+            aws_task_init(
+                &manager->final_destruction_task,
+                s_final_destruction_task,
+                manager,
+                "websocket_manager_final_destruction");
+            aws_event_loop_schedule_task_now(manager->maintenance_event_loop, &manager->final_destruction_task);
+        } else {
+            s_manager_destroy(manager);
+        }
+    }
+}
+
+static int s_connect_new_websocket(struct aws_websocket_manager *manager) {
+    struct aws_websocket_manager_entry *entry =
+        aws_mem_calloc(manager->allocator, 1, sizeof(struct aws_websocket_manager_entry));
+    entry->allocator = manager->allocator;
+    entry->manager = manager;
+    aws_mutex_init(&entry->lease_lock);
+
+    /* A fresh request each time, so every websocket gets its own Sec-WebSocket-Key */
+    struct aws_http_message *handshake_request = aws_http_message_new_websocket_handshake_request(
+        manager->allocator, aws_byte_cursor_from_string(manager->path), aws_byte_cursor_from_string(manager->host));
+    if (!handshake_request) {
+        goto error;
+    }
+
+    const size_t num_headers = aws_http_headers_count(manager->handshake_headers);
+    for (size_t i = 0; i < num_headers; ++i) {
+        struct aws_http_header header;
+        aws_http_headers_get_index(manager->handshake_headers, i, &header);
+        if (aws_http_message_add_header(handshake_request, header)) {
+            goto error;
+        }
+    }
+
+    struct aws_websocket_client_connection_options options = {
+        .allocator = manager->allocator,
+        .bootstrap = manager->bootstrap,
+        .socket_options = &manager->socket_options,
+        .tls_options = manager->tls_options,
+        .host = aws_byte_cursor_from_string(manager->host),
+        .port = manager->port,
+        .handshake_request = handshake_request,
+        .initial_window_size = manager->initial_window_size,
+        .manual_window_management = manager->manual_window_management,
+        .user_data = entry,
+        .on_connection_setup = s_on_websocket_setup,
+        .on_connection_shutdown = s_on_websocket_shutdown,
+        .on_incoming_frame_begin = s_on_incoming_frame_begin,
+        .on_incoming_frame_payload = s_on_incoming_frame_payload,
+        .on_incoming_frame_complete = s_on_incoming_frame_complete,
+    };
+
+    if (manager->system_vtable->aws_websocket_client_connect(&options)) {
+        goto error;
+    }
+
+    /* The connect keeps the request alive until the handshake completes */
+    aws_http_message_release(handshake_request);
+    return AWS_OP_SUCCESS;
+
+error:
+    AWS_LOGF_ERROR(
+        AWS_LS_HTTP_WEBSOCKET_MANAGER,
+        "id=%p: Failed to start websocket connect, error %d (%s)",
+        (void *)manager,
+        aws_last_error(),
+        aws_error_name(aws_last_error()));
+    aws_http_message_release(handshake_request);
+    s_entry_destroy(entry);
+    return AWS_OP_ERR;
+}
+
+static void s_on_connect_failed(struct aws_websocket_manager *manager, int error_code) {
+    struct aws_websocket_manager_transaction transaction;
+    s_transaction_init(&transaction, manager);
+
+    /* BEGIN CRITICAL SECTION */
+    s_lock_synced_data(manager);
+    --manager->synced_data.pending_connect_count;
+    /* Fail an acquisition that this connect was for, rather than leave it waiting */
+    if (manager->synced_data.pending_acquisition_count > manager->synced_data.pending_connect_count) {
+        s_fail_acquisition_synced(manager, &transaction, error_code);
+    }
+    s_build_transaction_synced(&transaction, true /*skip_prewarm*/);
+    s_unlock_synced_data(manager);
+    /* END CRITICAL SECTION */
+
+    s_execute_transaction(&transaction);
+}
+
+static void s_on_websocket_setup(const struct aws_websocket_on_connection_setup_data *setup, void *user_data) {
+    struct aws_websocket_manager_entry *entry = user_data;
+    struct aws_websocket_manager *manager = entry->manager;
+
+    if (setup->error_code) {
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_WEBSOCKET_MANAGER,
+            "id=%p: Websocket setup failed, error %d (%s)",
+            (void *)manager,
+            setup->error_code,
+            aws_error_name(setup->error_code));
+        s_entry_destroy(entry);
+        s_on_connect_failed(manager, setup->error_code);
+        return;
+    }
+
+    AWS_LOGF_DEBUG(
+        AWS_LS_HTTP_WEBSOCKET_MANAGER, "id=%p: Websocket %p set up", (void *)manager, (void *)setup->websocket);
+
+    struct aws_websocket_manager_transaction transaction;
+    s_transaction_init(&transaction, manager);
+
+    /* BEGIN CRITICAL SECTION */
+    s_lock_synced_data(manager);
+    entry->websocket = setup->websocket;
+    --manager->synced_data.pending_connect_count;
+    ++manager->synced_data.open_count;
+
+    if (manager->synced_data.state == AWS_WSMST_READY) {
+        uint64_t now = s_now(manager);
+        entry->heard_timestamp = now;
+        s_make_idle_synced(entry, now);
+    } else {
+        s_close_synced(entry, false);
+    }
+
+    s_build_transaction_synced(&transaction, false);
+    s_unlock_synced_data(manager);
+    /* END CRITICAL SECTION */
+
+    s_execute_transaction(&transaction);
+}
+
+static void s_on_websocket_shutdown(struct aws_websocket *websocket, int error_code, void *user_data) {
+    struct aws_websocket_manager_entry *entry = user_data;
+    struct aws_websocket_manager *manager = entry->manager;
+
+    AWS_LOGF_DEBUG(
+        AWS_LS_HTTP_WEBSOCKET_MANAGER,
+        "id=%p: Websocket %p shut down, error %d (%s)",
+        (void *)manager,
+        (void *)websocket,
+        error_code,
+        aws_error_name(error_code));
+
+    struct aws_websocket_manager_transaction transaction;
+    s_transaction_init(&transaction, manager);
+    struct aws_websocket_manager_acquire_options lease;
+    bool is_leased = false;
+
+    /* BEGIN CRITICAL SECTION */
+    s_lock_synced_data(manager);
+    entry->is_shut_down = true;
+    if (entry->is_idle) {
+        s_remove_idle_synced(entry);
+    }
+
+    if (entry->is_vended) {
+        /* Whoever has it is told, and lets go of it with aws_websocket_manager_release_websocket() */
+        is_leased = s_get_lease(entry, &lease);
+    } else {
+        --manager->synced_data.open_count;
+        transaction.entry_to_destroy = entry;
+    }
+
+    s_build_transaction_synced(&transaction, false);
+    s_unlock_synced_data(manager);
+    /* END CRITICAL SECTION */
+
+    if (is_leased && lease.on_connection_shutdown) {
+        lease.on_connection_shutdown(websocket, error_code, lease.user_data);
+    }
+
+    s_execute_transaction(&transaction);
+}
+
+/* A frame arrived while no one has the websocket. Returns false to close it */
+static bool s_on_idle_frame_begin(
+    struct aws_websocket_manager_entry *entry,
+    const struct aws_websocket_incoming_frame *frame) {
+
+    struct aws_websocket_manager *manager = entry->manager;
+
+    if (aws_websocket_is_data_frame(frame->opcode)) {
+        /* No one is around to read it, and whoever gets the websocket next wouldn't expect it */
+        AWS_LOGF_DEBUG(
+            AWS_LS_HTTP_WEBSOCKET_MANAGER,
+            "id=%p: Closing idle websocket %p, it received a %s frame",
+            (void *)manager,
+            (void *)entry->websocket,
+            aws_websocket_opcode_str(frame->opcode));
+        return false;
+    }
+
+    /* BEGIN CRITICAL SECTION */
+    s_lock_synced_data(manager);
+    entry->heard_timestamp = s_now(manager);
+    if (frame->opcode == AWS_WEBSOCKET_OPCODE_PONG) {
+        entry->is_ping_outstanding = false;
+    }
+    s_unlock_synced_data(manager);
+    /* END CRITICAL SECTION */
+
+    return true;
+}
+
+static bool s_on_incoming_frame_begin(
+    struct aws_websocket *websocket,
+    const struct aws_websocket_incoming_frame *frame,
+    void *user_data) {
+
+    struct aws_websocket_manager_entry *entry = user_data;
+    struct aws_websocket_manager_acquire_options lease;
+    if (!s_get_lease(entry, &lease)) {
+        return s_on_idle_frame_begin(entry, frame);
+    }
+
+    if (lease.on_incoming_frame_begin) {
+        return lease.on_incoming_frame_begin(websocket, frame, lease.user_data);
+    }
+    return true;
+}
+
+static bool s_on_incoming_frame_payload(
+    struct aws_websocket *websocket,
+    const struct aws_websocket_incoming_frame *frame,
+    struct aws_byte_cursor data,
+    void *user_data) {
+
+    struct aws_websocket_manager_entry *entry = user_data;
+    struct aws_websocket_manager_acquire_options lease;
+    if (s_get_lease(entry, &lease) && lease.on_incoming_frame_payload) {
+        return lease.on_incoming_frame_payload(websocket, frame, data, lease.user_data);
+    }
+    return true;
+}
+
+static bool s_on_incoming_frame_complete(
+    struct aws_websocket *websocket,
+    const struct aws_websocket_incoming_frame *frame,
+    int error_code,
+    void *user_data) {
+
+    struct aws_websocket_manager_entry *entry = user_data;
+    struct aws_websocket_manager_acquire_options lease;
+    if (s_get_lease(entry, &lease) && lease.on_incoming_frame_complete) {
+        return lease.on_incoming_frame_complete(websocket, frame, error_code, lease.user_data);
+    }
+    return true;
+}
+
+/* Cull websockets idle too long, and check on the rest with PINGs. Sending, like closing, only schedules work on the
+ * websocket's thread, so it's fine to do with the lock held */
+static void s_maintain_idle_websockets_synced(struct aws_websocket_manager *manager) {
+    const uint64_t now = s_now(manager);
+
+    struct aws_linked_list_node *node = aws_linked_list_begin(&manager->synced_data.idle_websockets);
+    while (node != aws_linked_list_end(&manager->synced_data.idle_websockets)) {
+        struct aws_websocket_manager_entry *entry = AWS_CONTAINER_OF(node, struct aws_websocket_manager_entry, node);
+        node = aws_linked_list_next(node);
+
+        if (entry->is_ping_outstanding && now - entry->ping_timestamp >= manager->ping_timeout_ns) {
+            AWS_LOGF_DEBUG(
+                AWS_LS_HTTP_WEBSOCKET_MANAGER,
+                "id=%p: Closing idle websocket %p, PING got no response",
+                (void *)manager,
+                (void *)entry->websocket);
+            s_close_synced(entry, true /*free_scarce_resources_immediately*/);
+            continue;
+        }
+
+        /* The front of the list has been idle the longest, so those go first */
+        if (manager->max_idle_ns > 0 && now - entry->idle_timestamp >= manager->max_idle_ns &&
+            manager->synced_data.idle_count > manager->min_idle_websockets) {
+            AWS_LOGF_DEBUG(
+                AWS_LS_HTTP_WEBSOCKET_MANAGER,
+                "id=%p: Culling websocket %p, idle too long",
+                (void *)manager,
+                (void *)entry->websocket);
+            s_close_synced(entry, false);
+            continue;
+        }
+
+        if (manager->ping_interval_ns > 0 && !entry->is_ping_outstanding &&
+            now - entry->heard_timestamp >= manager->ping_interval_ns) {
+            struct aws_websocket_send_frame_options ping = {
+                .opcode = AWS_WEBSOCKET_OPCODE_PING,
+                .fin = true,
+            };
+            if (manager->system_vtable->aws_websocket_send_frame(entry->websocket, &ping)) {
+                s_close_synced(entry, true /*free_scarce_resources_immediately*/);
+                continue;
+            }
+            entry->is_ping_outstanding = true;
+            entry->ping_timestamp = now;
+        }
+    }
+}
+
+static void s_schedule_maintenance(struct aws_websocket_manager *manager) {
+    aws_event_loop_schedule_task_future(
+        manager->maintenance_event_loop, &manager->maintenance_task, s_now(manager) + manager->maintenance_period_ns);
+}
+
+static void s_maintenance_task(struct aws_task *task, void *arg, enum aws_task_status status) {
+    (void)task;
+    if (status != AWS_TASK_STATUS_RUN_READY) {
+        return;
+    }
+
+    struct aws_websocket_manager *manager = arg;
+    struct aws_websocket_manager_transaction transaction;
+    s_transaction_init(&transaction, manager);
+
+    /* BEGIN CRITICAL SECTION */
+    s_lock_synced_data(manager);
+    if (manager->synced_data.state == AWS_WSMST_READY) {
+        s_maintain_idle_websockets_synced(manager);
+        s_build_transaction_synced(&transaction, false);
+    }
+    s_unlock_synced_data(manager);
+    /* END CRITICAL SECTION */
+
+    s_execute_transaction(&transaction);
+
+    /* Keeps going until the final destruction task cancels it */
+    s_schedule_maintenance(manager);
+}
+
+static void s_on_ref_count_zero(void *user_data) {
+    struct aws_websocket_manager *manager = user_data;
+
+    AWS_LOGF_INFO(AWS_LS_HTTP_WEBSOCKET_MANAGER, "id=%p: Last external ref released, shutting down", (void *)manager);
+
+    struct aws_websocket_manager_transaction transaction;
+    s_transaction_init(&transaction, manager);
+
+    /* BEGIN CRITICAL SECTION */
+    s_lock_synced_data(manager);
+    manager->synced_data.state = AWS_WSMST_SHUTTING_DOWN;
+    s_build_transaction_synced(&transaction, false);
+    s_unlock_synced_data(manager);
+    /* END CRITICAL SECTION */
+
+    s_execute_transaction(&transaction);
+}
+
+static uint64_t s_millis_to_nanos(uint64_t millis) {
+    return aws_timestamp_convert(millis, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+}
+
+struct aws_websocket_manager *aws_websocket_manager_new(
+    struct aws_allocator *allocator,
+    const struct aws_websocket_manager_options *options) {
+
+    if (!options || !options->bootstrap || !options->socket_options || options->host.len == 0 ||
+        options->path.len == 0 || options->max_websockets == 0 ||
+        options->min_idle_websockets > options->max_websockets) {
+        AWS_LOGF_ERROR(AWS_LS_HTTP_WEBSOCKET_MANAGER, "Invalid options - failed to create websocket manager");
+        aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    struct aws_websocket_manager *manager = aws_mem_calloc(allocator, 1, sizeof(struct aws_websocket_manager));
+    manager->allocator = allocator;
+    manager->system_vtable = s_system_vtable;
+
+    if (aws_mutex_init(&manager->synced_data.lock)) {
+        aws_mem_release(allocator, manager);
+        return NULL;
+    }
+    aws_linked_list_init(&manager->synced_data.idle_websockets);
+    aws_linked_list_init(&manager->synced_data.vended_websockets);
+    aws_linked_list_init(&manager->synced_data.pending_acquisitions);
+
+    manager->bootstrap = aws_client_bootstrap_acquire(options->bootstrap);
+    manager->socket_options = *options->socket_options;
+    manager->host = aws_string_new_from_cursor(allocator, &options->host);
+    manager->port = options->port;
+    manager->path = aws_string_new_from_cursor(allocator, &options->path);
+    manager->handshake_headers = aws_http_headers_new(allocator);
+    if (!manager->host || !manager->path || !manager->handshake_headers) {
+        goto on_error;
+    }
+
+    if (options->num_handshake_headers > 0 &&
+        aws_http_headers_add_array(
+            manager->handshake_headers, options->handshake_header_array, options->num_handshake_headers)) {
+        goto on_error;
+    }
+
+    if (options->tls_options) {
+        manager->tls_options = aws_mem_calloc(allocator, 1, sizeof(struct aws_tls_connection_options));
+        if (aws_tls_connection_options_copy(manager->tls_options, options->tls_options)) {
+            aws_mem_release(allocator, manager->tls_options);
+            manager->tls_options = NULL;
+            goto on_error;
+        }
+    }
+
+    manager->initial_window_size = options->initial_window_size;
+    manager->manual_window_management = options->manual_window_management;
+    manager->max_websockets = options->max_websockets;
+    manager->min_idle_websockets = options->min_idle_websockets;
+    manager->max_idle_ns = s_millis_to_nanos(options->max_websocket_idle_ms);
+    manager->ping_interval_ns = s_millis_to_nanos(options->ping_interval_ms);
+    manager->ping_timeout_ns = s_millis_to_nanos(options->ping_timeout_ms ? options->ping_timeout_ms
+                                                                           : options->ping_interval_ms);
+    manager->shutdown_complete_user_data = options->shutdown_complete_user_data;
+    manager->shutdown_complete_callback = options->shutdown_complete_callback;
+    aws_ref_count_init(&manager->ref_count, manager, s_on_ref_count_zero);
+
+    /* Check on idle websockets at least as often as anything about them can expire */
+    if (manager->max_idle_ns > 0 || manager->ping_interval_ns > 0) {
+        uint64_t period = UINT64_MAX;
+        if (manager->max_idle_ns > 0) {
+            period = manager->max_idle_ns;
+        }
+        if (manager->ping_interval_ns > 0) {
+            period = aws_min_u64(period, aws_min_u64(manager->ping_interval_ns, manager->ping_timeout_ns));
+        }
+        manager->maintenance_period_ns = period;
+        manager->maintenance_event_loop = aws_event_loop_group_get_next_loop(manager->bootstrap->event_loop_group);
+        aws_task_init(&manager->maintenance_task, s_maintenance_task, manager, "websocket_manager_maintenance");
+        s_schedule_maintenance(manager);
+    }
+
+    AWS_LOGF_INFO(
+        AWS_LS_HTTP_WEBSOCKET_MANAGER,
+        "id=%p: Successfully created, keeping %zu to %zu websockets to " PRInSTR,
+        (void *)manager,
+        manager->min_idle_websockets,
+        manager->max_websockets,
+        AWS_BYTE_CURSOR_PRI(options->host));
+
+    /* Start on min_idle_websockets right away */
+    struct aws_websocket_manager_transaction transaction;
+    s_transaction_init(&transaction, manager);
+
+    /* BEGIN CRITICAL SECTION */
+    s_lock_synced_data(manager);
+    s_build_transaction_synced(&transaction, false);
+    s_unlock_synced_data(manager);
+    /* END CRITICAL SECTION */
+
+    s_execute_transaction(&transaction);
+
+    return manager;
+
+on_error:
+    aws_string_destroy(manager->host);
+    aws_string_destroy(manager->path);
+    aws_http_headers_release(manager->handshake_headers);
+    aws_client_bootstrap_release(manager->bootstrap);
+    aws_mutex_clean_up(&manager->synced_data.lock);
+    aws_mem_release(allocator, manager);
+    return NULL;
+}
+
+void aws_websocket_manager_acquire(struct aws_websocket_manager *manager) {
+    aws_ref_count_acquire(&manager->ref_count);
+}
+
+void aws_websocket_manager_release(struct aws_websocket_manager *manager) {
+    if (manager) {
+        aws_ref_count_release(&manager->ref_count);
+    }
+}
+
+int aws_websocket_manager_acquire_websocket(
+    struct aws_websocket_manager *manager,
+    const struct aws_websocket_manager_acquire_options *options) {
+
+    AWS_PRECONDITION(options && options->on_acquired);
+
+    struct aws_websocket_manager_pending_acquisition *acquisition =
+        aws_mem_calloc(manager->allocator, 1, sizeof(struct aws_websocket_manager_pending_acquisition));
+    acquisition->allocator = manager->allocator;
+    acquisition->options = *options;
+
+    struct aws_websocket_manager_transaction transaction;
+    s_transaction_init(&transaction, manager);
+
+    /* BEGIN CRITICAL SECTION */
+    s_lock_synced_data(manager);
+    if (manager->synced_data.state != AWS_WSMST_READY) {
+        s_unlock_synced_data(manager);
+        aws_mem_release(manager->allocator, acquisition);
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_WEBSOCKET_MANAGER,
+            "id=%p: Cannot acquire websocket, manager is shutting down",
+            (void *)manager);
+        return aws_raise_error(AWS_ERROR_HTTP_WEBSOCKET_MANAGER_SHUTTING_DOWN);
+    }
+
+    aws_linked_list_push_back(&manager->synced_data.pending_acquisitions, &acquisition->node);
+    ++manager->synced_data.pending_acquisition_count;
+    s_build_transaction_synced(&transaction, false);
+    s_unlock_synced_data(manager);
+    /* END CRITICAL SECTION */
+
+    s_execute_transaction(&transaction);
+    return AWS_OP_SUCCESS;
+}
+
+int aws_websocket_manager_release_websocket(struct aws_websocket_manager *manager, struct aws_websocket *websocket) {
+    struct aws_websocket_manager_transaction transaction;
+    s_transaction_init(&transaction, manager);
+    struct aws_websocket_manager_entry *entry = NULL;
+
+    /* BEGIN CRITICAL SECTION */
+    s_lock_synced_data(manager);
+    for (struct aws_linked_list_node *node = aws_linked_list_begin(&manager->synced_data.vended_websockets);
+         node != aws_linked_list_end(&manager->synced_data.vended_websockets);
+         node = aws_linked_list_next(node)) {
+
+        struct aws_websocket_manager_entry *vended = AWS_CONTAINER_OF(node, struct aws_websocket_manager_entry, node);
+        if (vended->websocket == websocket) {
+            entry = vended;
+            break;
+        }
+    }
+
+    if (!entry) {
+        s_unlock_synced_data(manager);
+        AWS_LOGF_ERROR(
+            AWS_LS_HTTP_WEBSOCKET_MANAGER,
+            "id=%p: Cannot release websocket %p, it was not acquired from this manager",
+            (void *)manager,
+            (void *)websocket);
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+    }
+
+    aws_linked_list_remove(&entry->node);
+    entry->is_vended = false;
+    s_set_lease(entry, NULL);
+
+    if (entry->is_shut_down) {
+        --manager->synced_data.open_count;
+        transaction.entry_to_destroy = entry;
+    } else if (
+        manager->synced_data.state != AWS_WSMST_READY || !manager->system_vtable->aws_websocket_is_open(websocket)) {
+        s_close_synced(entry, false);
+    } else {
+        uint64_t now = s_now(manager);
+        entry->heard_timestamp = now;
+        s_make_idle_synced(entry, now);
+    }
+
+    s_build_transaction_synced(&transaction, false);
+    s_unlock_synced_data(manager);
+    /* END CRITICAL SECTION */
+
+    AWS_LOGF_DEBUG(
+        AWS_LS_HTTP_WEBSOCKET_MANAGER, "id=%p: Websocket %p released", (void *)manager, (void *)websocket);
+
+    s_execute_transaction(&transaction);
+    return AWS_OP_SUCCESS;
+}
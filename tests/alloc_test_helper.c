@@ -0,0 +1,67 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include "alloc_test_helper.h"
+
+#include <aws/testing/aws_test_harness.h>
+
+static void *s_counting_acquire(struct aws_allocator *allocator, size_t size) {
+    struct counting_allocator *counting = allocator->impl;
+    counting->num_allocations++;
+    return aws_mem_acquire(counting->wrapped, size);
+}
+
+static void s_counting_release(struct aws_allocator *allocator, void *ptr) {
+    struct counting_allocator *counting = allocator->impl;
+    aws_mem_release(counting->wrapped, ptr);
+}
+
+static void *s_counting_realloc(struct aws_allocator *allocator, void *oldptr, size_t oldsize, size_t newsize) {
+    struct counting_allocator *counting = allocator->impl;
+    counting->num_allocations++;
+    void *ptr = oldptr;
+    if (aws_mem_realloc(counting->wrapped, &ptr, oldsize, newsize)) {
+        return NULL;
+    }
+    return ptr;
+}
+
+static void *s_counting_calloc(struct aws_allocator *allocator, size_t num, size_t size) {
+    struct counting_allocator *counting = allocator->impl;
+    counting->num_allocations++;
+    return aws_mem_calloc(counting->wrapped, num, size);
+}
+
+void counting_allocator_init(struct counting_allocator *counting, struct aws_allocator *wrapped) {
+    AWS_ZERO_STRUCT(*counting);
+    counting->base.mem_acquire = s_counting_acquire;
+    counting->base.mem_release = s_counting_release;
+    counting->base.mem_realloc = s_counting_realloc;
+    counting->base.mem_calloc = s_counting_calloc;
+    counting->base.impl = counting;
+    counting->wrapped = wrapped;
+}
+
+int counting_allocator_check_budget(
+    const struct counting_allocator *counting,
+    const char *op_name,
+    size_t num_allocations_before,
+    size_t num_ops,
+    size_t budget_per_op) {
+
+    ASSERT_TRUE(num_ops > 0);
+    const size_t num_allocations = counting->num_allocations - num_allocations_before;
+
+    ASSERT_TRUE(
+        num_allocations <= num_ops * budget_per_op,
+        "%s: %zu allocations over %zu, %.3f allocations/%s (budget %zu)",
+        op_name,
+        num_allocations,
+        num_ops,
+        (double)num_allocations / (double)num_ops,
+        op_name,
+        budget_per_op);
+    return AWS_OP_SUCCESS;
+}
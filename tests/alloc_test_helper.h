@@ -0,0 +1,37 @@
+#ifndef AWS_HTTP_ALLOC_TEST_HELPER_H
+#define AWS_HTTP_ALLOC_TEST_HELPER_H
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/common/common.h>
+
+/**
+ * Counts every allocation made through it, then passes it along to the wrapped allocator.
+ * Give `base` to the code under test and keep using the wrapped allocator for the test's own bookkeeping,
+ * so only the code under test is counted.
+ * Not thread-safe, tests using it run everything on one thread.
+ */
+struct counting_allocator {
+    struct aws_allocator base;
+    struct aws_allocator *wrapped;
+    size_t num_allocations;
+};
+
+void counting_allocator_init(struct counting_allocator *counting, struct aws_allocator *wrapped);
+
+/**
+ * Check an allocation budget: fails if more than `budget_per_op` allocations per op were made
+ * since num_allocations was `num_allocations_before`. Budgets are averaged across all ops,
+ * so run enough of them that one-off growth (of a pool, or a table) is amortized away.
+ * On failure, the message gives the measured rate, to show how far over budget it went.
+ */
+int counting_allocator_check_budget(
+    const struct counting_allocator *counting,
+    const char *op_name,
+    size_t num_allocations_before,
+    size_t num_ops,
+    size_t budget_per_op);
+
+#endif /* AWS_HTTP_ALLOC_TEST_HELPER_H */
@@ -237,6 +237,36 @@ static struct aws_h2err s_decoder_on_headers_i(
     return s_on_header(false /* is_push_promise */, stream_id, header, name_enum, block_type, userdata);
 }
 
+static struct aws_h2err s_decoder_on_headers_block(
+    uint32_t stream_id,
+    const struct aws_http_header *header_array,
+    const enum aws_http_header_name *name_enum_array,
+    size_t num_headers,
+    enum aws_http_header_block block_type,
+    void *userdata) {
+
+    struct h2_decode_tester *decode_tester = userdata;
+    struct h2_decoded_frame *frame = h2_decode_tester_latest_frame(decode_tester);
+
+    /* Validate */
+    AWS_FATAL_ASSERT(AWS_H2_FRAME_T_HEADERS == frame->type);
+    AWS_FATAL_ASSERT(!frame->finished);
+    AWS_FATAL_ASSERT(frame->stream_id == stream_id);
+
+    /* Whole block should arrive at once, and never mixed with _i() calls */
+    AWS_FATAL_ASSERT(frame->header_block_callback_count == 0);
+    AWS_FATAL_ASSERT(aws_http_headers_count(frame->headers) == 0);
+    frame->header_block_callback_count++;
+
+    for (size_t i = 0; i < num_headers; ++i) {
+        AWS_FATAL_ASSERT(aws_http_lowercase_str_to_header_name(header_array[i].name) == name_enum_array[i]);
+        AWS_FATAL_ASSERT(AWS_OP_SUCCESS == aws_http_headers_add_header(frame->headers, &header_array[i]));
+    }
+    frame->header_block_type = block_type;
+
+    return AWS_H2ERR_SUCCESS;
+}
+
 static struct aws_h2err s_on_headers_end(
     bool is_push_promise,
     uint32_t stream_id,
@@ -463,6 +493,7 @@ static struct aws_h2err s_decoder_on_window_update(uint32_t stream_id, uint32_t
 static struct aws_h2_decoder_vtable s_decoder_vtable = {
     .on_headers_begin = s_decoder_on_headers_begin,
     .on_headers_i = s_decoder_on_headers_i,
+    .on_headers_block = s_decoder_on_headers_block,
     .on_headers_end = s_decoder_on_headers_end,
     .on_push_promise_begin = s_decoder_on_push_promise_begin,
     .on_push_promise_i = s_decoder_on_push_promise_i,
@@ -490,6 +521,7 @@ int h2_decode_tester_init(struct h2_decode_tester *decode_tester, const struct h
         .userdata = decode_tester,
         .is_server = options->is_server,
         .skip_connection_preface = options->skip_connection_preface,
+        .collect_header_blocks = options->collect_header_blocks,
     };
     decode_tester->decoder = aws_h2_decoder_new(&decoder_params);
     ASSERT_NOT_NULL(decode_tester->decoder);
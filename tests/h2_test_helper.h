@@ -94,6 +94,7 @@ struct h2_decoded_frame {
     struct aws_http_headers *headers;             /* HEADERS and PUSH_PROMISE have this */
     bool headers_malformed;                       /* HEADERS and PUSH_PROMISE have this */
     enum aws_http_header_block header_block_type; /* HEADERS have this */
+    size_t header_block_callback_count;           /* HEADERS have this, if decoder collects header-blocks */
     struct aws_array_list settings;               /* contains aws_http2_setting, SETTINGS has this */
     struct aws_byte_buf data;                     /* DATA and GOAWAY have this */
     uint32_t data_payload_len;                    /* DATA has this */
@@ -125,6 +126,7 @@ struct h2_decode_tester_options {
     struct aws_allocator *alloc;
     bool is_server;
     bool skip_connection_preface;
+    bool collect_header_blocks;
 };
 
 int h2_decode_tester_init(struct h2_decode_tester *decode_tester, const struct h2_decode_tester_options *options);
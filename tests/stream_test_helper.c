@@ -22,6 +22,7 @@ static int s_on_headers(
     (void)stream;
     struct client_stream_tester *tester = user_data;
     ASSERT_FALSE(tester->complete);
+    tester->on_headers_count++;
 
     if (tester->current_header_block == UNKNOWN_HEADER_BLOCK) {
         tester->current_header_block = header_block;
@@ -201,6 +202,8 @@ int client_stream_tester_init(
         .on_metrics = s_on_metrics,
         .on_complete = s_on_complete,
         .on_destroy = s_on_destroy,
+        .http2_priority = options->http2_priority,
+        .content_decoding = options->content_decoding,
     };
     tester->stream = aws_http_connection_make_request(options->connection, &request_options);
     ASSERT_NOT_NULL(tester->stream);
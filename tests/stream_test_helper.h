@@ -20,6 +20,9 @@ struct client_stream_tester {
 
     enum aws_http_header_block current_header_block;
 
+    /* Number of times on_response_headers fired */
+    size_t on_headers_count;
+
     /* Array of completed Informational (1xx) responses */
     struct aws_http_message *info_responses[4];
     size_t num_info_responses;
@@ -51,6 +54,10 @@ struct client_stream_tester {
 struct client_stream_tester_options {
     struct aws_http_message *request;
     struct aws_http_connection *connection;
+    /* Optional, see aws_http_make_request_options.http2_priority */
+    const struct aws_http2_stream_priority *http2_priority;
+    /* Optional, see aws_http_make_request_options.content_decoding */
+    const struct aws_http_content_decoding_options *content_decoding;
 };
 
 int client_stream_tester_init(
@@ -44,6 +44,8 @@ struct tester_options {
     char *client_alpn_list;
     bool no_connection; /* don't connect server to client */
     bool pin_event_loop;
+    size_t max_connections;
+    uint64_t idle_timeout_ms;
 };
 
 /* Singleton used by tests in this file */
@@ -361,6 +363,8 @@ static int s_tester_init(struct tester *tester, const struct tester_options *opt
     server_options.server_user_data = tester;
     server_options.on_incoming_connection = s_tester_on_server_connection_setup;
     server_options.on_destroy_complete = s_tester_http_server_on_destroy;
+    server_options.max_connections = options->max_connections;
+    server_options.idle_timeout_ms = options->idle_timeout_ms;
     if (options->tls) {
         ASSERT_SUCCESS(s_tls_server_opt_tester_init(
             tester, options->server_alpn_list ? options->server_alpn_list : "h2;http/1.1"));
@@ -464,6 +468,101 @@ void release_all_server_connections(struct tester *tester) {
     tester->wait_server_connection_is_shutdown = tester->server_connection_num;
 }
 
+/* Wait for the server to refuse the connection, and for the client to find out about it one way or the other */
+static bool s_tester_connection_refused_pred(void *user_data) {
+    struct tester *tester = user_data;
+    return tester->server_wait_result && (tester->client_wait_result || tester->client_connection_num == 2);
+}
+
+static int s_test_server_max_connections(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+    struct tester_options options = {
+        .alloc = allocator,
+        .max_connections = 1,
+    };
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init(&tester, &options));
+
+    struct aws_http_server_metrics metrics;
+    aws_http_server_fetch_metrics(tester.server, &metrics);
+    ASSERT_UINT_EQUALS(1, metrics.current_connections);
+    ASSERT_UINT_EQUALS(1, metrics.accepted_connections);
+    ASSERT_UINT_EQUALS(0, metrics.rejected_connections);
+
+    /* The second connection is over the limit */
+    ASSERT_SUCCESS(aws_http_client_connect(&tester.client_options));
+    ASSERT_FAILS(s_tester_wait(&tester, s_tester_connection_refused_pred));
+    ASSERT_INT_EQUALS(AWS_ERROR_HTTP_SERVER_CONNECTION_LIMIT_REACHED, aws_last_error());
+    ASSERT_INT_EQUALS(1, tester.server_connection_num);
+
+    aws_http_server_fetch_metrics(tester.server, &metrics);
+    ASSERT_UINT_EQUALS(1, metrics.accepted_connections);
+    ASSERT_UINT_EQUALS(1, metrics.rejected_connections);
+    ASSERT_TRUE(metrics.is_refusing_connections);
+
+    release_all_client_connections(&tester);
+    release_all_server_connections(&tester);
+    ASSERT_SUCCESS(s_tester_wait(&tester, s_tester_connection_shutdown_pred));
+
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(server_max_connections, s_test_server_max_connections);
+
+static int s_test_server_max_connections_invalid_threshold(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+    struct tester_options options = {
+        .alloc = allocator,
+        .no_connection = true,
+    };
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init(&tester, &options));
+
+    struct aws_http_server_options server_options = AWS_HTTP_SERVER_OPTIONS_INIT;
+    server_options.allocator = allocator;
+    server_options.bootstrap = tester.server_bootstrap;
+    server_options.endpoint = &tester.endpoint;
+    server_options.socket_options = &tester.socket_options;
+    server_options.on_incoming_connection = s_tester_on_server_connection_setup;
+
+    /* threshold must be below max_connections */
+    server_options.max_connections = 2;
+    server_options.resume_connections_threshold = 2;
+    ASSERT_NULL(aws_http_server_new(&server_options));
+    ASSERT_INT_EQUALS(AWS_ERROR_INVALID_ARGUMENT, aws_last_error());
+
+    /* threshold means nothing without max_connections */
+    server_options.max_connections = 0;
+    server_options.resume_connections_threshold = 1;
+    ASSERT_NULL(aws_http_server_new(&server_options));
+    ASSERT_INT_EQUALS(AWS_ERROR_INVALID_ARGUMENT, aws_last_error());
+
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(server_max_connections_invalid_threshold, s_test_server_max_connections_invalid_threshold);
+
+static int s_test_server_idle_timeout(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+    struct tester_options options = {
+        .alloc = allocator,
+        .idle_timeout_ms = 200,
+    };
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init(&tester, &options));
+
+    /* Nobody sends a request, so the server closes the connection */
+    tester.wait_client_connection_is_shutdown = 1;
+    tester.wait_server_connection_is_shutdown = 1;
+    ASSERT_SUCCESS(s_tester_wait(&tester, s_tester_connection_shutdown_pred));
+
+    release_all_client_connections(&tester);
+    release_all_server_connections(&tester);
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(server_idle_timeout, s_test_server_idle_timeout);
+
 static int s_test_connection_setup_shutdown(struct aws_allocator *allocator, void *ctx) {
     (void)ctx;
     struct tester_options options = {
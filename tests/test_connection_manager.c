@@ -37,11 +37,22 @@ enum new_connection_result_type {
     AWS_NCRT_SUCCESS,
     AWS_NCRT_ERROR_VIA_CALLBACK,
     AWS_NCRT_ERROR_FROM_CREATE,
+    /* set up once s_complete_deferred_connections() is called, so the connect stays pending until then */
+    AWS_NCRT_SUCCESS_DEFERRED,
 };
 
 struct mock_connection {
     enum new_connection_result_type result;
     bool is_closed_on_release;
+    struct aws_event_loop *event_loop;
+    /* What the manager passed as user_data for its connection callbacks */
+    void *user_data;
+    bool is_http2;
+    uint32_t max_concurrent_streams;
+    uint64_t proxy_keep_alive_timeout_ms;
+    /* Set while an AWS_NCRT_SUCCESS_DEFERRED connection waits to be set up */
+    aws_http_on_client_connection_setup_fn *deferred_on_setup;
+    aws_http2_on_change_settings_complete_fn *deferred_on_initial_settings_completed;
 };
 
 struct cm_tester_options {
@@ -58,6 +69,17 @@ struct cm_tester_options {
     struct aws_http2_setting *initial_settings_array;
     size_t num_initial_settings;
     bool self_lib_init;
+    bool enable_event_loop_shards;
+    /* defaults to 1 */
+    size_t event_loop_count;
+    size_t min_idle_connections;
+    enum aws_http_connection_manager_idle_selection idle_selection;
+    /* successful mock connections added before the manager is created, for the ones it opens right away */
+    size_t initial_mock_connection_count;
+    struct aws_host_resolution_config *host_resolution_config;
+    uint64_t connection_acquisition_timeout_ms;
+    size_t max_pending_connection_acquisitions;
+    size_t max_http2_leases_per_connection;
 };
 
 struct cm_tester {
@@ -73,12 +95,14 @@ struct cm_tester {
     struct aws_tls_ctx_options tls_ctx_options;
     struct aws_tls_connection_options tls_connection_options;
     struct aws_http_proxy_options *verify_proxy_options;
+    struct aws_host_resolution_config *verify_host_resolution_config;
 
     struct aws_mutex lock;
     struct aws_condition_variable signal;
 
     struct aws_array_list connections;
     size_t connection_errors;
+    int last_acquisition_error_code;
     size_t connection_releases;
 
     size_t wait_for_connection_count;
@@ -134,6 +158,8 @@ static struct aws_event_loop *s_new_event_loop(
     return aws_event_loop_new_default(alloc, options->clock);
 }
 
+static void s_add_mock_connections(size_t count, enum new_connection_result_type result, bool closed_on_release);
+
 static int s_cm_tester_init(struct cm_tester_options *options) {
     struct cm_tester *tester = &s_tester;
 
@@ -158,7 +184,9 @@ static int s_cm_tester_init(struct cm_tester_options *options) {
         clock_fn = options->mock_table->get_monotonic_time;
     }
 
-    tester->event_loop_group = aws_event_loop_group_new(tester->allocator, clock_fn, 1, s_new_event_loop, NULL, NULL);
+    uint16_t event_loop_count = options->event_loop_count ? (uint16_t)options->event_loop_count : 1;
+    tester->event_loop_group =
+        aws_event_loop_group_new(tester->allocator, clock_fn, event_loop_count, s_new_event_loop, NULL, NULL);
 
     struct aws_host_resolver_default_options resolver_options = {
         .el_group = tester->event_loop_group,
@@ -195,6 +223,7 @@ static int s_cm_tester_init(struct cm_tester_options *options) {
     aws_tls_connection_options_set_server_name(&tester->tls_connection_options, options->allocator, &server_name);
 
     tester->verify_proxy_options = options->proxy_options;
+    tester->verify_host_resolution_config = options->host_resolution_config;
     tester->proxy_ev_settings.env_var_type = options->use_proxy_env ? AWS_HPEV_ENABLE : AWS_HPEV_DISABLE;
     struct aws_tls_connection_options default_tls_connection_options;
     AWS_ZERO_STRUCT(default_tls_connection_options);
@@ -219,12 +248,25 @@ static int s_cm_tester_init(struct cm_tester_options *options) {
         .http2_prior_knowledge = !options->use_tls && options->http2,
         .initial_settings_array = options->initial_settings_array,
         .num_initial_settings = options->num_initial_settings,
+        .enable_event_loop_shards = options->enable_event_loop_shards,
+        .min_idle_connections = options->min_idle_connections,
+        .idle_selection = options->idle_selection,
+        .host_resolution_config = options->host_resolution_config,
+        .connection_acquisition_timeout_ms = options->connection_acquisition_timeout_ms,
+        .max_pending_connection_acquisitions = options->max_pending_connection_acquisitions,
+        .max_http2_leases_per_connection = options->max_http2_leases_per_connection,
     };
 
     if (options->mock_table) {
         g_aws_http_connection_manager_default_system_vtable_ptr = options->mock_table;
     }
 
+    aws_atomic_store_int(&tester->next_connection_id, 0);
+
+    ASSERT_SUCCESS(aws_array_list_init_dynamic(
+        &tester->mock_connections, tester->allocator, 10, sizeof(struct mock_connection *)));
+    s_add_mock_connections(options->initial_mock_connection_count, AWS_NCRT_SUCCESS, false);
+
     tester->connection_manager = aws_http_connection_manager_new(tester->allocator, &cm_options);
     ASSERT_NOT_NULL(tester->connection_manager);
     aws_tls_connection_options_clean_up(&default_tls_connection_options);
@@ -235,11 +277,6 @@ static int s_cm_tester_init(struct cm_tester_options *options) {
 
     tester->mock_table = options->mock_table;
 
-    aws_atomic_store_int(&tester->next_connection_id, 0);
-
-    ASSERT_SUCCESS(aws_array_list_init_dynamic(
-        &tester->mock_connections, tester->allocator, 10, sizeof(struct mock_connection *)));
-
     return AWS_OP_SUCCESS;
 }
 
@@ -327,7 +364,6 @@ release:
 }
 
 static void s_on_acquire_connection(struct aws_http_connection *connection, int error_code, void *user_data) {
-    (void)error_code;
     (void)user_data;
 
     struct cm_tester *tester = &s_tester;
@@ -336,6 +372,7 @@ static void s_on_acquire_connection(struct aws_http_connection *connection, int
 
     if (connection == NULL) {
         ++tester->connection_errors;
+        tester->last_acquisition_error_code = error_code;
     } else {
         aws_array_list_push_back(&tester->connections, &connection);
     }
@@ -353,6 +390,18 @@ static void s_acquire_connections(size_t count) {
     }
 }
 
+static void s_acquire_connection_on_event_loop(struct aws_event_loop *event_loop, bool require_event_loop) {
+    struct cm_tester *tester = &s_tester;
+
+    struct aws_http_connection_manager_acquire_connection_options options = {
+        .callback = s_on_acquire_connection,
+        .user_data = tester,
+        .event_loop = event_loop,
+        .require_event_loop = require_event_loop,
+    };
+    aws_http_connection_manager_acquire_connection_with_options(tester->connection_manager, &options);
+}
+
 static bool s_is_connection_reply_count_at_least(void *context) {
     (void)context;
 
@@ -746,6 +795,18 @@ static int s_aws_http_connection_manager_create_connection_sync_mock(
         ASSERT_UINT_EQUALS(options->proxy_options->connection_type, tester->verify_proxy_options->connection_type);
     }
 
+    /* Verify that the host resolution override has been propagated to the connection attempt */
+    if (tester->verify_host_resolution_config) {
+        ASSERT_NOT_NULL(options->host_resolution_config);
+        ASSERT_PTR_EQUALS(tester->verify_host_resolution_config->impl, options->host_resolution_config->impl);
+        ASSERT_UINT_EQUALS(tester->verify_host_resolution_config->max_ttl, options->host_resolution_config->max_ttl);
+        ASSERT_UINT_EQUALS(
+            tester->verify_host_resolution_config->resolve_frequency_ns,
+            options->host_resolution_config->resolve_frequency_ns);
+    } else {
+        ASSERT_NULL(options->host_resolution_config);
+    }
+
     struct mock_connection *connection = NULL;
 
     if (next_connection_id < aws_array_list_length(&tester->mock_connections)) {
@@ -753,10 +814,27 @@ static int s_aws_http_connection_manager_create_connection_sync_mock(
     }
 
     if (connection) {
+        connection->user_data = options->user_data;
+        /* spread the connections across the event loops, like the bootstrap would */
+        size_t loop_count = aws_event_loop_group_get_loop_count(tester->event_loop_group);
+        connection->event_loop =
+            options->requested_event_loop
+                ? options->requested_event_loop
+                : aws_event_loop_group_get_loop_at(tester->event_loop_group, next_connection_id % loop_count);
+
         if (connection->result == AWS_NCRT_SUCCESS) {
             options->on_setup((struct aws_http_connection *)connection, AWS_ERROR_SUCCESS, options->user_data);
+            if (connection->is_http2) {
+                /* The peer's settings arrive right away */
+                options->http2_options->on_initial_settings_completed(
+                    (struct aws_http_connection *)connection, AWS_ERROR_SUCCESS, options->user_data);
+            }
         } else if (connection->result == AWS_NCRT_ERROR_VIA_CALLBACK) {
             options->on_setup(NULL, AWS_ERROR_HTTP_UNKNOWN, options->user_data);
+        } else if (connection->result == AWS_NCRT_SUCCESS_DEFERRED) {
+            connection->deferred_on_setup = options->on_setup;
+            connection->deferred_on_initial_settings_completed =
+                options->http2_options ? options->http2_options->on_initial_settings_completed : NULL;
         }
 
         if (connection->result != AWS_NCRT_ERROR_FROM_CREATE) {
@@ -768,11 +846,10 @@ static int s_aws_http_connection_manager_create_connection_sync_mock(
 }
 
 static void s_aws_http_connection_manager_release_connection_sync_mock(struct aws_http_connection *connection) {
-    (void)connection;
-
     struct cm_tester *tester = &s_tester;
 
-    tester->release_connection_fn(connection, AWS_ERROR_SUCCESS, tester->connection_manager);
+    struct mock_connection *mock_connection = (struct mock_connection *)connection;
+    tester->release_connection_fn(connection, AWS_ERROR_SUCCESS, mock_connection->user_data);
 }
 
 static void s_aws_http_connection_manager_close_connection_sync_mock(struct aws_http_connection *connection) {
@@ -803,9 +880,10 @@ static struct aws_channel *s_aws_http_connection_manager_connection_get_channel_
 
 static enum aws_http_version s_aws_http_connection_manager_connection_get_version_sync_mock(
     const struct aws_http_connection *connection) {
-    (void)connection;
 
-    return AWS_HTTP_VERSION_1_1;
+    const struct mock_connection *proxy = (const struct mock_connection *)(const void *)connection;
+
+    return proxy->is_http2 ? AWS_HTTP_VERSION_2 : AWS_HTTP_VERSION_1_1;
 }
 
 static struct aws_http_connection_manager_system_vtable s_synchronous_mocks = {
@@ -860,6 +938,43 @@ AWS_TEST_CASE(
     test_connection_manager_acquire_release_mix_synchronous,
     s_test_connection_manager_acquire_release_mix_synchronous);
 
+static int s_test_connection_manager_host_resolution_config(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    /* the manager must keep its own copy, this one goes away before any connection is made */
+    struct aws_host_resolution_config *host_resolution_config =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_host_resolution_config));
+    host_resolution_config->impl = aws_default_dns_resolve;
+    host_resolution_config->max_ttl = 7;
+    host_resolution_config->resolve_frequency_ns = 100;
+
+    struct aws_host_resolution_config expected = *host_resolution_config;
+
+    struct cm_tester_options options = {
+        .allocator = allocator,
+        .max_connections = 5,
+        .mock_table = &s_synchronous_mocks,
+        .host_resolution_config = host_resolution_config,
+    };
+
+    ASSERT_SUCCESS(s_cm_tester_init(&options));
+    aws_mem_release(allocator, host_resolution_config);
+    s_tester.verify_host_resolution_config = &expected;
+
+    s_add_mock_connections(5, AWS_NCRT_SUCCESS, false);
+
+    s_acquire_connections(5);
+
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(5));
+    ASSERT_SUCCESS(s_release_connections(5, false));
+    ASSERT_UINT_EQUALS(0, s_tester.connection_errors);
+
+    ASSERT_SUCCESS(s_cm_tester_clean_up());
+
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(test_connection_manager_host_resolution_config, s_test_connection_manager_host_resolution_config);
+
 static int s_test_connection_manager_connect_callback_failure(struct aws_allocator *allocator, void *ctx) {
     (void)ctx;
 
@@ -910,6 +1025,284 @@ static int s_test_connection_manager_connect_immediate_failure(struct aws_alloca
 }
 AWS_TEST_CASE(test_connection_manager_connect_immediate_failure, s_test_connection_manager_connect_immediate_failure);
 
+static int s_test_connection_manager_max_pending_acquisitions(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct cm_tester_options options = {
+        .allocator = allocator,
+        .max_connections = 1,
+        .mock_table = &s_synchronous_mocks,
+        .max_pending_connection_acquisitions = 2,
+    };
+
+    ASSERT_SUCCESS(s_cm_tester_init(&options));
+
+    s_add_mock_connections(1, AWS_NCRT_SUCCESS, false);
+
+    s_acquire_connections(1);
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(1));
+
+    /* Two wait for the only connection, the third is turned away right away */
+    s_acquire_connections(3);
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(2));
+    ASSERT_UINT_EQUALS(1, s_tester.connection_errors);
+    ASSERT_INT_EQUALS(
+        AWS_ERROR_HTTP_CONNECTION_MANAGER_MAX_PENDING_ACQUISITIONS_EXCEEDED, s_tester.last_acquisition_error_code);
+
+    struct aws_http_manager_metrics metrics;
+    aws_http_connection_manager_fetch_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(2, metrics.pending_concurrency_acquires);
+
+    /* The waiting acquisitions are served in turn */
+    ASSERT_SUCCESS(s_release_connections(1, false));
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(3));
+    ASSERT_SUCCESS(s_release_connections(1, false));
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(4));
+    ASSERT_UINT_EQUALS(1, s_tester.connection_errors);
+
+    ASSERT_SUCCESS(s_release_connections(1, false));
+
+    ASSERT_SUCCESS(s_cm_tester_clean_up());
+
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(test_connection_manager_max_pending_acquisitions, s_test_connection_manager_max_pending_acquisitions);
+
+static int s_test_connection_manager_acquisition_timeout(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct cm_tester_options options = {
+        .allocator = allocator,
+        .max_connections = 1,
+        .mock_table = &s_synchronous_mocks,
+        .connection_acquisition_timeout_ms = 100,
+    };
+
+    ASSERT_SUCCESS(s_cm_tester_init(&options));
+
+    s_add_mock_connections(1, AWS_NCRT_SUCCESS, false);
+
+    s_acquire_connections(1);
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(1));
+
+    /* Nothing is released, so these wait until they time out */
+    s_acquire_connections(2);
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(3));
+    ASSERT_UINT_EQUALS(2, s_tester.connection_errors);
+    ASSERT_INT_EQUALS(AWS_ERROR_HTTP_CONNECTION_MANAGER_ACQUISITION_TIMEOUT, s_tester.last_acquisition_error_code);
+
+    struct aws_http_manager_metrics metrics;
+    aws_http_connection_manager_fetch_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(0, metrics.pending_concurrency_acquires);
+
+    /* One that's served before its deadline doesn't time out */
+    s_acquire_connections(1);
+    ASSERT_SUCCESS(s_release_connections(1, false));
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(4));
+    ASSERT_UINT_EQUALS(2, s_tester.connection_errors);
+
+    ASSERT_SUCCESS(s_release_connections(1, false));
+
+    ASSERT_SUCCESS(s_cm_tester_clean_up());
+
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(test_connection_manager_acquisition_timeout, s_test_connection_manager_acquisition_timeout);
+
+static int s_test_connection_manager_latency_metrics(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct cm_tester_options options = {
+        .allocator = allocator,
+        .max_connections = 5,
+        .mock_table = &s_synchronous_mocks,
+    };
+
+    ASSERT_SUCCESS(s_cm_tester_init(&options));
+
+    s_add_mock_connections(3, AWS_NCRT_SUCCESS, true);
+    s_add_mock_connections(1, AWS_NCRT_ERROR_VIA_CALLBACK, false);
+
+    s_acquire_connections(4);
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(4));
+    ASSERT_UINT_EQUALS(1, s_tester.connection_errors);
+
+    struct aws_http_manager_latency_metrics metrics;
+    aws_http_connection_manager_fetch_latency_metrics(s_tester.connection_manager, &metrics);
+    /* The failed acquisition and connect aren't recorded */
+    ASSERT_UINT_EQUALS(3, metrics.acquisition_wait.count);
+    ASSERT_UINT_EQUALS(3, metrics.connection_setup.count);
+    ASSERT_UINT_EQUALS(0, metrics.http2_settings.count);
+    ASSERT_UINT_EQUALS(0, metrics.connection_lifetime.count);
+
+    /* The connections close on release, which ends their lifetime */
+    ASSERT_SUCCESS(s_release_connections(3, false));
+    aws_http_connection_manager_fetch_latency_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(3, metrics.connection_lifetime.count);
+
+    ASSERT_SUCCESS(s_cm_tester_clean_up());
+
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(test_connection_manager_latency_metrics, s_test_connection_manager_latency_metrics);
+
+static uint32_t s_aws_http_connection_manager_connection_get_max_concurrent_streams_sync_mock(
+    const struct aws_http_connection *connection) {
+
+    const struct mock_connection *proxy = (const struct mock_connection *)(const void *)connection;
+
+    return proxy->max_concurrent_streams;
+}
+
+static struct aws_http_connection_manager_system_vtable s_http2_lease_mocks = {
+    .create_connection = s_aws_http_connection_manager_create_connection_sync_mock,
+    .release_connection = s_aws_http_connection_manager_release_connection_sync_mock,
+    .close_connection = s_aws_http_connection_manager_close_connection_sync_mock,
+    .is_connection_available = s_aws_http_connection_manager_is_connection_available_sync_mock,
+    .get_monotonic_time = aws_high_res_clock_get_ticks,
+    .connection_get_channel = s_aws_http_connection_manager_connection_get_channel_sync_mock,
+    .is_callers_thread = s_aws_http_connection_manager_is_callers_thread_sync_mock,
+    .connection_get_version = s_aws_http_connection_manager_connection_get_version_sync_mock,
+    .connection_get_max_concurrent_streams =
+        s_aws_http_connection_manager_connection_get_max_concurrent_streams_sync_mock,
+};
+
+static void s_add_http2_mock_connection(uint32_t max_concurrent_streams) {
+    s_add_mock_connections(1, AWS_NCRT_SUCCESS, false);
+
+    struct mock_connection *mock = NULL;
+    aws_array_list_back(&s_tester.mock_connections, &mock);
+    mock->is_http2 = true;
+    mock->max_concurrent_streams = max_concurrent_streams;
+}
+
+/* Set up every AWS_NCRT_SUCCESS_DEFERRED connection the manager has tried to open so far */
+static void s_complete_deferred_connections(void) {
+    struct cm_tester *tester = &s_tester;
+
+    size_t created_count = aws_atomic_load_int(&tester->next_connection_id);
+    for (size_t i = 0; i < created_count && i < aws_array_list_length(&tester->mock_connections); ++i) {
+        struct mock_connection *mock = NULL;
+        aws_array_list_get_at(&tester->mock_connections, &mock, i);
+        if (mock->deferred_on_setup == NULL) {
+            continue;
+        }
+
+        aws_http_on_client_connection_setup_fn *on_setup = mock->deferred_on_setup;
+        mock->deferred_on_setup = NULL;
+        on_setup((struct aws_http_connection *)mock, AWS_ERROR_SUCCESS, mock->user_data);
+        if (mock->is_http2 && mock->deferred_on_initial_settings_completed) {
+            mock->deferred_on_initial_settings_completed(
+                (struct aws_http_connection *)mock, AWS_ERROR_SUCCESS, mock->user_data);
+        }
+    }
+}
+
+static int s_test_connection_manager_http2_multiplexing(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct cm_tester_options options = {
+        .allocator = allocator,
+        .max_connections = 2,
+        .mock_table = &s_http2_lease_mocks,
+        .max_http2_leases_per_connection = 3,
+    };
+
+    ASSERT_SUCCESS(s_cm_tester_init(&options));
+
+    /* The first takes as many leases as the manager allows, the peer only allows one stream on the second */
+    s_add_http2_mock_connection(100);
+    s_add_http2_mock_connection(1);
+
+    s_acquire_connections(5);
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(4));
+    ASSERT_UINT_EQUALS(0, s_tester.connection_errors);
+    ASSERT_UINT_EQUALS(2, aws_atomic_load_int(&s_tester.next_connection_id));
+
+    struct aws_http_connection *first_connection = NULL;
+    struct aws_http_connection *connection = NULL;
+    aws_array_list_get_at(&s_tester.connections, &first_connection, 0);
+    for (size_t i = 1; i < 3; ++i) {
+        aws_array_list_get_at(&s_tester.connections, &connection, i);
+        ASSERT_PTR_EQUALS(first_connection, connection);
+    }
+    aws_array_list_get_at(&s_tester.connections, &connection, 3);
+    ASSERT_FALSE(first_connection == connection);
+
+    struct aws_http_manager_metrics metrics;
+    aws_http_connection_manager_fetch_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(0, metrics.available_concurrency);
+    ASSERT_UINT_EQUALS(4, metrics.leased_concurrency);
+    ASSERT_UINT_EQUALS(1, metrics.pending_concurrency_acquires);
+
+    /* The second connection's only lease goes to the one waiting */
+    ASSERT_SUCCESS(s_release_connections(1, false));
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(6));
+    ASSERT_UINT_EQUALS(2, aws_atomic_load_int(&s_tester.next_connection_id));
+
+    /* The first connection is only given back with its last lease */
+    ASSERT_SUCCESS(s_release_connections(3, false));
+    aws_http_connection_manager_fetch_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(1, metrics.available_concurrency);
+    ASSERT_UINT_EQUALS(1, metrics.leased_concurrency);
+
+    ASSERT_SUCCESS(s_release_connections(1, false));
+    aws_http_connection_manager_fetch_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(2, metrics.available_concurrency);
+    ASSERT_UINT_EQUALS(0, metrics.leased_concurrency);
+    ASSERT_UINT_EQUALS(0, metrics.pending_concurrency_acquires);
+
+    ASSERT_SUCCESS(s_cm_tester_clean_up());
+
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(test_connection_manager_http2_multiplexing, s_test_connection_manager_http2_multiplexing);
+
+/* With prior knowledge, connections still being set up are known to be HTTP/2. A burst of acquisitions must only open
+ * enough of them to cover every acquisition with leases, rather than one per acquisition */
+static int s_test_connection_manager_http2_multiplexing_burst(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct cm_tester_options options = {
+        .allocator = allocator,
+        .max_connections = 10,
+        .mock_table = &s_http2_lease_mocks,
+        .http2 = true,
+        .max_http2_leases_per_connection = 4,
+    };
+
+    ASSERT_SUCCESS(s_cm_tester_init(&options));
+
+    for (size_t i = 0; i < 10; ++i) {
+        s_add_mock_connections(1, AWS_NCRT_SUCCESS_DEFERRED, false);
+        struct mock_connection *mock = NULL;
+        aws_array_list_back(&s_tester.mock_connections, &mock);
+        mock->is_http2 = true;
+        mock->max_concurrent_streams = 100;
+    }
+
+    /* Nothing is set up yet, so every acquisition waits on the connects */
+    s_acquire_connections(10);
+    ASSERT_UINT_EQUALS(3, aws_atomic_load_int(&s_tester.next_connection_id));
+
+    s_complete_deferred_connections();
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(10));
+    ASSERT_UINT_EQUALS(0, s_tester.connection_errors);
+    ASSERT_UINT_EQUALS(3, aws_atomic_load_int(&s_tester.next_connection_id));
+
+    struct aws_http_manager_metrics metrics;
+    aws_http_connection_manager_fetch_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(10, metrics.leased_concurrency);
+    ASSERT_UINT_EQUALS(0, metrics.pending_concurrency_acquires);
+
+    ASSERT_SUCCESS(s_release_connections(10, false));
+
+    ASSERT_SUCCESS(s_cm_tester_clean_up());
+
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(test_connection_manager_http2_multiplexing_burst, s_test_connection_manager_http2_multiplexing_burst);
+
 static int s_test_connection_manager_proxy_setup_shutdown(struct aws_allocator *allocator, void *ctx) {
     (void)ctx;
 
@@ -1166,6 +1559,47 @@ static int s_test_connection_manager_idle_culling_mixture(struct aws_allocator *
 }
 AWS_TEST_CASE(test_connection_manager_idle_culling_mixture, s_test_connection_manager_idle_culling_mixture);
 
+/* More connections expire at once than one cull moves, the rest must still go without waiting another interval */
+static int s_test_connection_manager_idle_culling_batches(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    uint64_t now = 0;
+    size_t connection_count = 600;
+
+    struct cm_tester_options options = {
+        .allocator = allocator,
+        .max_connections = connection_count,
+        .mock_table = &s_idle_mocks,
+        .max_connection_idle_in_ms = 1000,
+        .starting_mock_time = now,
+    };
+
+    ASSERT_SUCCESS(s_cm_tester_init(&options));
+
+    s_add_mock_connections(connection_count, AWS_NCRT_SUCCESS, false);
+
+    s_acquire_connections(connection_count);
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(connection_count));
+    ASSERT_SUCCESS(s_release_connections(connection_count, false));
+
+    /*
+     * advance fake time enough to cause every connection to be culled, also sleep for real to give the cull task
+     * a chance to run in the real event loop.
+     */
+    uint64_t one_sec_in_nanos = aws_timestamp_convert(1, AWS_TIMESTAMP_SECS, AWS_TIMESTAMP_NANOS, NULL);
+    s_tester_set_mock_time(now + one_sec_in_nanos);
+    aws_thread_current_sleep(2 * one_sec_in_nanos);
+
+    struct aws_http_manager_metrics metrics;
+    aws_http_connection_manager_fetch_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(0, metrics.available_concurrency);
+
+    ASSERT_SUCCESS(s_cm_tester_clean_up());
+
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(test_connection_manager_idle_culling_batches, s_test_connection_manager_idle_culling_batches);
+
 /**
  * Once upon time, if the culling test is running while the connection manager is shutting, the refcount will be messed
  * up (back from zero to one and trigger the destroy to happen twice)
@@ -1198,6 +1632,546 @@ static int s_test_connection_manager_idle_culling_refcount(struct aws_allocator
 
 AWS_TEST_CASE(test_connection_manager_idle_culling_refcount, s_test_connection_manager_idle_culling_refcount);
 
+static uint64_t s_aws_http_connection_manager_connection_get_proxy_keep_alive_timeout_sync_mock(
+    const struct aws_http_connection *connection) {
+
+    const struct mock_connection *proxy = (const struct mock_connection *)(const void *)connection;
+
+    return proxy->proxy_keep_alive_timeout_ms;
+}
+
+static struct aws_http_connection_manager_system_vtable s_proxy_keep_alive_mocks = {
+    .create_connection = s_aws_http_connection_manager_create_connection_sync_mock,
+    .release_connection = s_aws_http_connection_manager_release_connection_sync_mock,
+    .close_connection = s_aws_http_connection_manager_close_connection_sync_mock,
+    .is_connection_available = s_aws_http_connection_manager_is_connection_available_sync_mock,
+    .get_monotonic_time = s_tester_get_mock_time,
+    .connection_get_channel = s_aws_http_connection_manager_connection_get_channel_sync_mock,
+    .is_callers_thread = s_aws_http_connection_manager_is_callers_thread_sync_mock,
+    .connection_get_version = s_aws_http_connection_manager_connection_get_version_sync_mock,
+    .connection_get_proxy_keep_alive_timeout =
+        s_aws_http_connection_manager_connection_get_proxy_keep_alive_timeout_sync_mock,
+};
+
+/*
+ * A tunnel whose proxy sent "Keep-Alive: timeout=3" is culled a second early, long before max_connection_idle_in_ms.
+ * It went idle last, after a connection with the full idle timeout, so it also has to be filed ahead of it.
+ */
+static int s_test_connection_manager_idle_culling_proxy_keep_alive(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct aws_array_list seen_connections;
+    AWS_ZERO_STRUCT(seen_connections);
+    ASSERT_SUCCESS(aws_array_list_init_dynamic(&seen_connections, allocator, 10, sizeof(struct aws_http_connection *)));
+
+    uint64_t now = 0;
+
+    struct cm_tester_options options = {
+        .allocator = allocator,
+        .max_connections = 2,
+        .mock_table = &s_proxy_keep_alive_mocks,
+        .max_connection_idle_in_ms = 60000,
+        .starting_mock_time = now,
+    };
+
+    ASSERT_SUCCESS(s_cm_tester_init(&options));
+
+    s_add_mock_connections(3, AWS_NCRT_SUCCESS, false);
+    struct mock_connection *tunnel = NULL;
+    aws_array_list_get_at(&s_tester.mock_connections, &tunnel, 0);
+    tunnel->proxy_keep_alive_timeout_ms = 3000;
+
+    s_acquire_connections(2);
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(2));
+    s_register_acquired_connections(&seen_connections);
+
+    /* Connections are released back to front, so the tunnel goes idle last */
+    s_release_connections(2, false);
+
+    /* Past the tunnel's cull time, nowhere near the other one's */
+    uint64_t one_sec_in_nanos = aws_timestamp_convert(1, AWS_TIMESTAMP_SECS, AWS_TIMESTAMP_NANOS, NULL);
+    s_tester_set_mock_time(now + 2 * one_sec_in_nanos);
+    aws_thread_current_sleep(2 * one_sec_in_nanos);
+
+    s_acquire_connections(2);
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(4));
+
+    /* Only the tunnel was replaced */
+    ASSERT_INT_EQUALS(1, s_get_acquired_connections_seen_count(&seen_connections));
+    bool is_tunnel_vended = false;
+    aws_mutex_lock(&s_tester.lock);
+    for (size_t i = 0; i < aws_array_list_length(&s_tester.connections); ++i) {
+        struct aws_http_connection *connection = NULL;
+        aws_array_list_get_at(&s_tester.connections, &connection, i);
+        is_tunnel_vended |= (void *)connection == (void *)tunnel;
+    }
+    aws_mutex_unlock(&s_tester.lock);
+    ASSERT_FALSE(is_tunnel_vended);
+
+    s_release_connections(2, false);
+
+    ASSERT_SUCCESS(s_cm_tester_clean_up());
+
+    aws_array_list_clean_up(&seen_connections);
+
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(
+    test_connection_manager_idle_culling_proxy_keep_alive,
+    s_test_connection_manager_idle_culling_proxy_keep_alive);
+
+static struct aws_event_loop *s_aws_http_connection_manager_connection_get_event_loop_sync_mock(
+    struct aws_http_connection *connection) {
+
+    struct mock_connection *proxy = (struct mock_connection *)(void *)connection;
+
+    return proxy->event_loop;
+}
+
+static struct aws_http_connection_manager_system_vtable s_shard_mocks = {
+    .create_connection = s_aws_http_connection_manager_create_connection_sync_mock,
+    .release_connection = s_aws_http_connection_manager_release_connection_sync_mock,
+    .close_connection = s_aws_http_connection_manager_close_connection_sync_mock,
+    .is_connection_available = s_aws_http_connection_manager_is_connection_available_sync_mock,
+    .get_monotonic_time = s_tester_get_mock_time,
+    .connection_get_channel = s_aws_http_connection_manager_connection_get_channel_sync_mock,
+    .is_callers_thread = s_aws_http_connection_manager_is_callers_thread_sync_mock,
+    .connection_get_version = s_aws_http_connection_manager_connection_get_version_sync_mock,
+    .connection_get_event_loop = s_aws_http_connection_manager_connection_get_event_loop_sync_mock,
+};
+
+static int s_test_connection_manager_event_loop_shards(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct cm_tester_options options = {
+        .allocator = allocator,
+        .max_connections = 4,
+        .mock_table = &s_shard_mocks,
+        .enable_event_loop_shards = true,
+        .event_loop_count = 2,
+    };
+
+    ASSERT_SUCCESS(s_cm_tester_init(&options));
+
+    s_add_mock_connections(8, AWS_NCRT_SUCCESS, false);
+
+    s_acquire_connections(4);
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(4));
+
+    struct aws_http_manager_metrics metrics;
+    aws_http_connection_manager_fetch_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(0, metrics.available_concurrency);
+    ASSERT_UINT_EQUALS(0, metrics.pending_concurrency_acquires);
+    ASSERT_UINT_EQUALS(4, metrics.leased_concurrency);
+
+    /* nothing is waiting, so every release goes to the pool of the connection's event loop */
+    ASSERT_SUCCESS(s_release_connections(4, false));
+
+    aws_http_connection_manager_fetch_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(4, metrics.available_concurrency);
+    ASSERT_UINT_EQUALS(0, metrics.leased_concurrency);
+
+    /* the idle connections come back out of the pools, no new connections are made */
+    s_acquire_connections(4);
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(8));
+    ASSERT_UINT_EQUALS(4, aws_atomic_load_int(&s_tester.next_connection_id));
+
+    /* connections sitting in the pools still count against max_connections */
+    s_acquire_connections(1);
+    aws_http_connection_manager_fetch_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(0, metrics.available_concurrency);
+    ASSERT_UINT_EQUALS(1, metrics.pending_concurrency_acquires);
+    ASSERT_UINT_EQUALS(4, metrics.leased_concurrency);
+
+    /* with an acquisition pending, the release is handed straight to it */
+    ASSERT_SUCCESS(s_release_connections(1, false));
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(9));
+
+    aws_http_connection_manager_fetch_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(0, metrics.available_concurrency);
+    ASSERT_UINT_EQUALS(0, metrics.pending_concurrency_acquires);
+    ASSERT_UINT_EQUALS(4, metrics.leased_concurrency);
+    ASSERT_UINT_EQUALS(4, aws_atomic_load_int(&s_tester.next_connection_id));
+
+    ASSERT_UINT_EQUALS(0, s_tester.connection_errors);
+
+    ASSERT_SUCCESS(s_release_connections(4, false));
+
+    ASSERT_SUCCESS(s_cm_tester_clean_up());
+
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(test_connection_manager_event_loop_shards, s_test_connection_manager_event_loop_shards);
+
+static int s_test_connection_manager_event_loop_shards_idle_culling(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct aws_array_list seen_connections;
+    AWS_ZERO_STRUCT(seen_connections);
+    ASSERT_SUCCESS(aws_array_list_init_dynamic(&seen_connections, allocator, 10, sizeof(struct aws_http_connection *)));
+
+    uint64_t now = 0;
+
+    struct cm_tester_options options = {
+        .allocator = allocator,
+        .max_connections = 10,
+        .mock_table = &s_shard_mocks,
+        .max_connection_idle_in_ms = 1000,
+        .starting_mock_time = now,
+        .enable_event_loop_shards = true,
+        .event_loop_count = 2,
+    };
+
+    ASSERT_SUCCESS(s_cm_tester_init(&options));
+
+    /* add enough fake connections to cover all the acquires */
+    s_add_mock_connections(20, AWS_NCRT_SUCCESS, false);
+
+    s_acquire_connections(10);
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(10));
+
+    /* remember what connections we acquired */
+    s_register_acquired_connections(&seen_connections);
+
+    /* release the connections into the pools of both event loops */
+    s_release_connections(10, false);
+
+    uint64_t one_sec_in_nanos = aws_timestamp_convert(1, AWS_TIMESTAMP_SECS, AWS_TIMESTAMP_NANOS, NULL);
+
+    /*
+     * advance fake time enough to cause every pooled connection to be culled, also sleep for real to give the cull
+     * task a chance to run in the real event loop.
+     */
+    s_tester_set_mock_time(now + one_sec_in_nanos);
+    aws_thread_current_sleep(2 * one_sec_in_nanos);
+
+    struct aws_http_manager_metrics metrics;
+    aws_http_connection_manager_fetch_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(0, metrics.available_concurrency);
+    ASSERT_UINT_EQUALS(0, metrics.leased_concurrency);
+
+    /* acquire some connections */
+    s_acquire_connections(10);
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(20));
+
+    /* make sure the connections acquired were all new */
+    ASSERT_INT_EQUALS(s_get_acquired_connections_seen_count(&seen_connections), 0);
+
+    /* release everything and clean up */
+    s_release_connections(10, false);
+
+    ASSERT_SUCCESS(s_cm_tester_clean_up());
+
+    aws_array_list_clean_up(&seen_connections);
+
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(
+    test_connection_manager_event_loop_shards_idle_culling,
+    s_test_connection_manager_event_loop_shards_idle_culling);
+
+static struct aws_event_loop *s_get_last_acquired_connection_event_loop(void) {
+    struct mock_connection *connection = NULL;
+
+    aws_mutex_lock(&s_tester.lock);
+    aws_array_list_back(&s_tester.connections, &connection);
+    aws_mutex_unlock(&s_tester.lock);
+
+    return connection ? connection->event_loop : NULL;
+}
+
+static int s_test_connection_manager_acquire_on_event_loop(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct cm_tester_options options = {
+        .allocator = allocator,
+        .max_connections = 4,
+        .mock_table = &s_shard_mocks,
+        .event_loop_count = 2,
+    };
+
+    ASSERT_SUCCESS(s_cm_tester_init(&options));
+
+    struct aws_event_loop *loop_0 = aws_event_loop_group_get_loop_at(s_tester.event_loop_group, 0);
+    struct aws_event_loop *loop_1 = aws_event_loop_group_get_loop_at(s_tester.event_loop_group, 1);
+
+    s_add_mock_connections(4, AWS_NCRT_SUCCESS, false);
+
+    /* one connection on each event loop */
+    s_acquire_connections(2);
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(2));
+
+    /* the connection on loop 1 is released first, so the newest idle connection is on loop 0 */
+    ASSERT_SUCCESS(s_release_connections(2, false));
+
+    /* the idle connection on the requested event loop wins over the newest one */
+    s_acquire_connection_on_event_loop(loop_1, true);
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(3));
+    ASSERT_PTR_EQUALS(loop_1, s_get_last_acquired_connection_event_loop());
+
+    /* with nothing idle on loop 1, a preference takes whatever is idle */
+    s_acquire_connection_on_event_loop(loop_1, false);
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(4));
+    ASSERT_PTR_EQUALS(loop_0, s_get_last_acquired_connection_event_loop());
+    ASSERT_UINT_EQUALS(2, aws_atomic_load_int(&s_tester.next_connection_id));
+
+    /* with nothing idle at all, the new connection is created on the requested event loop */
+    s_acquire_connection_on_event_loop(loop_0, false);
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(5));
+    ASSERT_PTR_EQUALS(loop_0, s_get_last_acquired_connection_event_loop());
+    ASSERT_UINT_EQUALS(3, aws_atomic_load_int(&s_tester.next_connection_id));
+
+    ASSERT_UINT_EQUALS(0, s_tester.connection_errors);
+
+    ASSERT_SUCCESS(s_release_connections(3, false));
+
+    ASSERT_SUCCESS(s_cm_tester_clean_up());
+
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(test_connection_manager_acquire_on_event_loop, s_test_connection_manager_acquire_on_event_loop);
+
+static int s_test_connection_manager_acquire_require_event_loop_at_max(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct cm_tester_options options = {
+        .allocator = allocator,
+        .max_connections = 1,
+        .mock_table = &s_shard_mocks,
+        .enable_event_loop_shards = true,
+        .event_loop_count = 2,
+    };
+
+    ASSERT_SUCCESS(s_cm_tester_init(&options));
+
+    struct aws_event_loop *loop_0 = aws_event_loop_group_get_loop_at(s_tester.event_loop_group, 0);
+    struct aws_event_loop *loop_1 = aws_event_loop_group_get_loop_at(s_tester.event_loop_group, 1);
+
+    s_add_mock_connections(2, AWS_NCRT_SUCCESS, false);
+
+    s_acquire_connections(1);
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(1));
+    ASSERT_PTR_EQUALS(loop_0, s_get_last_acquired_connection_event_loop());
+
+    /* the only connection the manager may have is vended, so this waits */
+    s_acquire_connection_on_event_loop(loop_1, true);
+
+    struct aws_http_manager_metrics metrics;
+    aws_http_connection_manager_fetch_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(1, metrics.pending_concurrency_acquires);
+    ASSERT_UINT_EQUALS(1, metrics.leased_concurrency);
+
+    /* the released connection is on the wrong loop, so it's closed to make room for one on loop 1 */
+    ASSERT_SUCCESS(s_release_connections(1, false));
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(2));
+    ASSERT_PTR_EQUALS(loop_1, s_get_last_acquired_connection_event_loop());
+    ASSERT_UINT_EQUALS(2, aws_atomic_load_int(&s_tester.next_connection_id));
+
+    aws_http_connection_manager_fetch_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(0, metrics.available_concurrency);
+    ASSERT_UINT_EQUALS(0, metrics.pending_concurrency_acquires);
+    ASSERT_UINT_EQUALS(1, metrics.leased_concurrency);
+
+    ASSERT_UINT_EQUALS(0, s_tester.connection_errors);
+
+    ASSERT_SUCCESS(s_release_connections(1, false));
+
+    ASSERT_SUCCESS(s_cm_tester_clean_up());
+
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(
+    test_connection_manager_acquire_require_event_loop_at_max,
+    s_test_connection_manager_acquire_require_event_loop_at_max);
+
+static int s_test_connection_manager_prewarm(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct cm_tester_options options = {
+        .allocator = allocator,
+        .max_connections = 4,
+        .mock_table = &s_idle_mocks,
+    };
+
+    ASSERT_SUCCESS(s_cm_tester_init(&options));
+
+    s_add_mock_connections(4, AWS_NCRT_SUCCESS, false);
+
+    aws_http_connection_manager_prewarm(s_tester.connection_manager, 2);
+    ASSERT_UINT_EQUALS(2, aws_atomic_load_int(&s_tester.next_connection_id));
+
+    struct aws_http_manager_metrics metrics;
+    aws_http_connection_manager_fetch_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(2, metrics.available_concurrency);
+    ASSERT_UINT_EQUALS(0, metrics.leased_concurrency);
+    ASSERT_UINT_EQUALS(0, metrics.prewarmed_acquires);
+
+    /* the acquisitions don't wait on new connections */
+    s_acquire_connections(2);
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(2));
+    ASSERT_UINT_EQUALS(2, aws_atomic_load_int(&s_tester.next_connection_id));
+
+    aws_http_connection_manager_fetch_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(0, metrics.available_concurrency);
+    ASSERT_UINT_EQUALS(2, metrics.leased_concurrency);
+    ASSERT_UINT_EQUALS(2, metrics.prewarmed_acquires);
+
+    /* prewarming never goes past max_connections */
+    aws_http_connection_manager_prewarm(s_tester.connection_manager, 10);
+    ASSERT_UINT_EQUALS(4, aws_atomic_load_int(&s_tester.next_connection_id));
+
+    aws_http_connection_manager_fetch_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(2, metrics.available_concurrency);
+    ASSERT_UINT_EQUALS(2, metrics.leased_concurrency);
+
+    /* released connections aren't prewarmed ones */
+    ASSERT_SUCCESS(s_release_connections(2, false));
+    s_acquire_connections(4);
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(6));
+
+    aws_http_connection_manager_fetch_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(4, metrics.prewarmed_acquires);
+
+    ASSERT_UINT_EQUALS(0, s_tester.connection_errors);
+
+    ASSERT_SUCCESS(s_release_connections(4, false));
+
+    ASSERT_SUCCESS(s_cm_tester_clean_up());
+
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(test_connection_manager_prewarm, s_test_connection_manager_prewarm);
+
+static int s_test_connection_manager_min_idle_connections(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    uint64_t now = 0;
+
+    struct cm_tester_options options = {
+        .allocator = allocator,
+        .max_connections = 4,
+        .mock_table = &s_idle_mocks,
+        .max_connection_idle_in_ms = 1000,
+        .starting_mock_time = now,
+        .min_idle_connections = 2,
+        .initial_mock_connection_count = 2,
+    };
+
+    ASSERT_SUCCESS(s_cm_tester_init(&options));
+
+    s_add_mock_connections(2, AWS_NCRT_SUCCESS, false);
+
+    /* the pool is warm as soon as the manager exists */
+    ASSERT_UINT_EQUALS(2, aws_atomic_load_int(&s_tester.next_connection_id));
+
+    struct aws_http_manager_metrics metrics;
+    aws_http_connection_manager_fetch_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(2, metrics.available_concurrency);
+
+    /* taking an idle connection opens another to keep two idle */
+    s_acquire_connections(1);
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(1));
+    ASSERT_UINT_EQUALS(3, aws_atomic_load_int(&s_tester.next_connection_id));
+
+    aws_http_connection_manager_fetch_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(2, metrics.available_concurrency);
+    ASSERT_UINT_EQUALS(1, metrics.leased_concurrency);
+    ASSERT_UINT_EQUALS(1, metrics.prewarmed_acquires);
+
+    ASSERT_SUCCESS(s_release_connections(1, false));
+
+    aws_http_connection_manager_fetch_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(3, metrics.available_concurrency);
+
+    /*
+     * advance fake time enough for every idle connection to be culled, also sleep for real to give the cull task
+     * a chance to run in the real event loop. Only the one above min_idle_connections goes.
+     */
+    uint64_t one_sec_in_nanos = aws_timestamp_convert(1, AWS_TIMESTAMP_SECS, AWS_TIMESTAMP_NANOS, NULL);
+    s_tester_set_mock_time(now + one_sec_in_nanos);
+    aws_thread_current_sleep(2 * one_sec_in_nanos);
+
+    aws_http_connection_manager_fetch_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(2, metrics.available_concurrency);
+    ASSERT_UINT_EQUALS(0, metrics.leased_concurrency);
+    ASSERT_UINT_EQUALS(3, aws_atomic_load_int(&s_tester.next_connection_id));
+
+    ASSERT_UINT_EQUALS(0, s_tester.connection_errors);
+
+    ASSERT_SUCCESS(s_cm_tester_clean_up());
+
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(test_connection_manager_min_idle_connections, s_test_connection_manager_min_idle_connections);
+
+/*
+ * Busy for a while on one connection at a time, after three went idle. MRU keeps reusing the same one, so the
+ * other two go cold and get culled. LRU cycles through all three, so none of them do.
+ */
+static int s_test_connection_manager_idle_selection(
+    struct aws_allocator *allocator,
+    enum aws_http_connection_manager_idle_selection idle_selection,
+    size_t expected_survivor_count) {
+
+    uint64_t now = 0;
+
+    struct cm_tester_options options = {
+        .allocator = allocator,
+        .max_connections = 3,
+        .mock_table = &s_idle_mocks,
+        .max_connection_idle_in_ms = 1000,
+        .starting_mock_time = now,
+        .idle_selection = idle_selection,
+    };
+
+    ASSERT_SUCCESS(s_cm_tester_init(&options));
+
+    s_add_mock_connections(3, AWS_NCRT_SUCCESS, false);
+
+    s_acquire_connections(3);
+    ASSERT_SUCCESS(s_wait_on_connection_reply_count(3));
+    ASSERT_SUCCESS(s_release_connections(3, false));
+
+    uint64_t one_sec_in_nanos = aws_timestamp_convert(1, AWS_TIMESTAMP_SECS, AWS_TIMESTAMP_NANOS, NULL);
+    s_tester_set_mock_time(now + one_sec_in_nanos / 2);
+    for (size_t i = 0; i < 3; ++i) {
+        s_acquire_connections(1);
+        ASSERT_SUCCESS(s_wait_on_connection_reply_count(3 + i + 1));
+        ASSERT_SUCCESS(s_release_connections(1, false));
+    }
+
+    /*
+     * advance fake time past the cull time of the connections released at the start, also sleep for real to give
+     * the cull task a chance to run in the real event loop.
+     */
+    s_tester_set_mock_time(now + one_sec_in_nanos);
+    aws_thread_current_sleep(2 * one_sec_in_nanos);
+
+    struct aws_http_manager_metrics metrics;
+    aws_http_connection_manager_fetch_metrics(s_tester.connection_manager, &metrics);
+    ASSERT_UINT_EQUALS(expected_survivor_count, metrics.available_concurrency);
+
+    /* nothing new was ever needed */
+    ASSERT_UINT_EQUALS(3, aws_atomic_load_int(&s_tester.next_connection_id));
+    ASSERT_UINT_EQUALS(0, s_tester.connection_errors);
+
+    ASSERT_SUCCESS(s_cm_tester_clean_up());
+
+    return AWS_OP_SUCCESS;
+}
+
+static int s_test_connection_manager_idle_selection_mru(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+    return s_test_connection_manager_idle_selection(allocator, AWS_HCMIS_MRU, 1);
+}
+AWS_TEST_CASE(test_connection_manager_idle_selection_mru, s_test_connection_manager_idle_selection_mru);
+
+static int s_test_connection_manager_idle_selection_lru(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+    return s_test_connection_manager_idle_selection(allocator, AWS_HCMIS_LRU, 3);
+}
+AWS_TEST_CASE(test_connection_manager_idle_selection_lru, s_test_connection_manager_idle_selection_lru);
+
 /**
  * Proxy integration tests. Maybe we should move this to another file. But let's do it later. Someday.
  * AWS_TEST_HTTP_PROXY_HOST - host address of the proxy to use for tests that make open connections to the proxy
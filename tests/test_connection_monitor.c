@@ -36,15 +36,25 @@ static int s_test_http_connection_monitor_options_is_valid(struct aws_allocator
     options.allowable_throughput_failure_interval_seconds = 2;
     ASSERT_TRUE(aws_http_connection_monitoring_options_is_valid(&options));
 
+    /* Latency and stall checks work without the throughput check, but not with half of it */
+    AWS_ZERO_STRUCT(options);
+    options.maximum_first_byte_latency_ms = 1000;
+    ASSERT_TRUE(aws_http_connection_monitoring_options_is_valid(&options));
+    options.minimum_throughput_bytes_per_second = 1000;
+    ASSERT_FALSE(aws_http_connection_monitoring_options_is_valid(&options));
+
+    AWS_ZERO_STRUCT(options);
+    options.maximum_ping_rtt_ms = 1000;
+    ASSERT_TRUE(aws_http_connection_monitoring_options_is_valid(&options));
+
+    AWS_ZERO_STRUCT(options);
+    options.maximum_window_stall_ms = 1000;
+    ASSERT_TRUE(aws_http_connection_monitoring_options_is_valid(&options));
+
     return AWS_OP_SUCCESS;
 }
 AWS_TEST_CASE(test_http_connection_monitor_options_is_valid, s_test_http_connection_monitor_options_is_valid);
 
-static void s_testing_channel_shutdown_callback(int error_code, void *user_data) {
-    (void)error_code;
-    (void)user_data;
-}
-
 enum monitor_test_event_type { MTET_EMPTY, MTET_STATS };
 
 struct http_monitor_test_stats_event {
@@ -71,10 +81,17 @@ struct monitor_test_context {
 
     struct aws_array_list requests;
     struct aws_byte_buf large_body_buf;
+
+    int shutdown_error_code;
 };
 
 static struct monitor_test_context s_test_context;
 
+static void s_testing_channel_shutdown_callback(int error_code, void *user_data) {
+    (void)user_data;
+    s_test_context.shutdown_error_code = error_code;
+}
+
 static uint64_t s_clock_value = 0;
 
 static int s_mock_clock(uint64_t *timestamp) {
@@ -954,6 +971,52 @@ static int s_test_http_connection_monitor_shutdown(struct aws_allocator *allocat
 }
 AWS_TEST_CASE(test_http_connection_monitor_shutdown, s_test_http_connection_monitor_shutdown);
 
+/*
+ * A test where a response takes too long to start, with no throughput check configured
+ */
+static int s_test_http_connection_monitor_first_byte_latency(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct aws_http_connection_monitoring_options options = {
+        .maximum_first_byte_latency_ms = 2000,
+    };
+    ASSERT_SUCCESS(
+        s_init_monitor_test(allocator, aws_crt_statistics_handler_new_http_connection_monitor(allocator, &options)));
+
+    struct http_monitor_test_stats_event event = {
+        .event_type = MTET_STATS,
+        .socket_stats =
+            {
+                .category = AWSCRT_STAT_CAT_SOCKET,
+            },
+        .http_stats =
+            {
+                .category = AWSCRT_STAT_CAT_HTTP1_CHANNEL,
+                .current_incoming_stream_id = 1,
+                .max_first_byte_latency_ms = 2000,
+            },
+    };
+
+    /* At the threshold is fine */
+    s_clock_value = aws_timestamp_convert(1, AWS_TIMESTAMP_SECS, AWS_TIMESTAMP_NANOS, NULL);
+    s_apply_stats_event_to_testing_channel(&event);
+    testing_channel_drain_queued_tasks(&s_test_context.test_channel);
+    ASSERT_FALSE(testing_channel_is_shutdown_completed(&s_test_context.test_channel));
+
+    /* Past it, the connection is shut down */
+    event.http_stats.max_first_byte_latency_ms = 2001;
+    s_clock_value = aws_timestamp_convert(2, AWS_TIMESTAMP_SECS, AWS_TIMESTAMP_NANOS, NULL);
+    s_apply_stats_event_to_testing_channel(&event);
+    testing_channel_drain_queued_tasks(&s_test_context.test_channel);
+    ASSERT_TRUE(testing_channel_is_shutdown_completed(&s_test_context.test_channel));
+    ASSERT_INT_EQUALS(AWS_ERROR_HTTP_CHANNEL_LATENCY_FAILURE, s_test_context.shutdown_error_code);
+
+    s_clean_up_monitor_test();
+
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(test_http_connection_monitor_first_byte_latency, s_test_http_connection_monitor_first_byte_latency);
+
 /*
 
  Pattern 2 (http statistics verification)
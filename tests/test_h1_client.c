@@ -3,8 +3,13 @@
  * SPDX-License-Identifier: Apache-2.0.
  */
 
+#include "alloc_test_helper.h"
 #include "stream_test_helper.h"
+#include <aws/common/clock.h>
+#include <aws/common/thread.h>
 #include <aws/common/uuid.h>
+#include <aws/http/content_decoding.h>
+#include <aws/http/content_encoding.h>
 #include <aws/http/private/h1_connection.h>
 #include <aws/http/request_response.h>
 #include <aws/http/status_code.h>
@@ -94,6 +99,14 @@ struct tester_options {
     bool manual_window_management;
     size_t initial_stream_window_size;
     size_t read_buffer_capacity;
+    size_t max_read_buffer_capacity;
+    bool deliver_whole_header_blocks;
+    uint64_t expect_continue_timeout_ms;
+    size_t max_write_messages_in_flight;
+    size_t max_pipelined_requests;
+    bool bulk_body_passthrough;
+    /* Optional, the connection uses this allocator instead of the tester's */
+    struct aws_allocator *connection_alloc;
 };
 
 static int s_tester_init_ex(struct tester *tester, struct aws_allocator *alloc, const struct tester_options *options) {
@@ -116,9 +129,18 @@ static int s_tester_init_ex(struct tester *tester, struct aws_allocator *alloc,
     struct aws_http1_connection_options http1_options;
     AWS_ZERO_STRUCT(http1_options);
     http1_options.read_buffer_capacity = options->read_buffer_capacity;
+    http1_options.max_read_buffer_capacity = options->max_read_buffer_capacity;
+    http1_options.expect_continue_timeout_ms = options->expect_continue_timeout_ms;
+    http1_options.deliver_whole_header_blocks = options->deliver_whole_header_blocks;
+    http1_options.max_write_messages_in_flight = options->max_write_messages_in_flight;
+    http1_options.max_pipelined_requests = options->max_pipelined_requests;
+    http1_options.bulk_body_passthrough = options->bulk_body_passthrough;
 
     tester->connection = aws_http_connection_new_http1_1_client(
-        alloc, options->manual_window_management, options->initial_stream_window_size, &http1_options);
+        options->connection_alloc ? options->connection_alloc : alloc,
+        options->manual_window_management,
+        options->initial_stream_window_size,
+        &http1_options);
     ASSERT_NOT_NULL(tester->connection);
 
     struct aws_channel_slot *slot = aws_channel_slot_new(tester->testing_channel.channel);
@@ -1033,6 +1055,195 @@ H1_CLIENT_TEST_CASE(h1_client_request_write_chunk_as_write_completes_regression)
     return AWS_OP_SUCCESS;
 }
 
+static size_t s_count_list_nodes(const struct aws_linked_list *list) {
+    size_t count = 0;
+    for (const struct aws_linked_list_node *node = aws_linked_list_begin(list); node != aws_linked_list_end(list);
+         node = aws_linked_list_next(node)) {
+        ++count;
+    }
+    return count;
+}
+
+/* Small chunks that queue up while an aws_io_message is being written should all go out in the next aws_io_message */
+H1_CLIENT_TEST_CASE(h1_client_request_queued_chunks_share_message) {
+    (void)ctx;
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init(&tester, allocator));
+
+    testing_channel_complete_written_messages_immediately(&tester.testing_channel, false, 0);
+
+    struct aws_http_message *request = s_new_default_chunked_put_request(allocator);
+    struct aws_http_make_request_options opt = {
+        .self_size = sizeof(opt),
+        .request = request,
+    };
+    struct aws_http_stream *stream = aws_http_connection_make_request(tester.connection, &opt);
+    ASSERT_NOT_NULL(stream);
+    ASSERT_SUCCESS(aws_http_stream_activate(stream));
+
+    /* The head gets written, and its aws_io_message stays in flight */
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    struct aws_linked_list *written_msgs = testing_channel_get_written_message_queue(&tester.testing_channel);
+    ASSERT_UINT_EQUALS(1, s_count_list_nodes(written_msgs));
+
+    /* Queue up several small chunks */
+    static const struct aws_byte_cursor bodies[] = {
+        AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("write"),
+        AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("more"),
+        AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("tests"),
+    };
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(bodies); ++i) {
+        struct aws_input_stream *body_stream = aws_input_stream_new_from_cursor(allocator, &bodies[i]);
+        struct aws_http1_chunk_options options = s_default_chunk_options(body_stream, bodies[i].len);
+        ASSERT_SUCCESS(aws_http1_stream_write_chunk(stream, &options));
+    }
+    ASSERT_SUCCESS(s_write_termination_chunk(allocator, stream));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    ASSERT_UINT_EQUALS(1, s_count_list_nodes(written_msgs));
+
+    /* Complete the head's aws_io_message */
+    struct aws_io_message *head_msg =
+        AWS_CONTAINER_OF(aws_linked_list_front(written_msgs), struct aws_io_message, queueing_handle);
+    head_msg->on_completion(tester.testing_channel.channel, head_msg, 0, head_msg->user_data);
+    head_msg->on_completion = NULL;
+
+    /* Every queued chunk should go out together */
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    ASSERT_UINT_EQUALS(2, s_count_list_nodes(written_msgs));
+
+    const char *expected = "PUT /plan.txt HTTP/1.1\r\n"
+                           "Transfer-Encoding: chunked\r\n"
+                           "\r\n"
+                           "5\r\n"
+                           "write"
+                           "\r\n"
+                           "4\r\n"
+                           "more"
+                           "\r\n"
+                           "5\r\n"
+                           "tests"
+                           "\r\n"
+                           "0\r\n"
+                           "\r\n";
+
+    ASSERT_SUCCESS(testing_channel_check_written_messages_str(&tester.testing_channel, allocator, expected));
+
+    /* clean up */
+    aws_http_message_destroy(request);
+    aws_http_stream_release(stream);
+
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
+static size_t s_count_messages_in_flight(const struct aws_linked_list *written_msgs) {
+    size_t count = 0;
+    for (const struct aws_linked_list_node *node = aws_linked_list_begin(written_msgs);
+         node != aws_linked_list_end(written_msgs);
+         node = aws_linked_list_next(node)) {
+
+        const struct aws_io_message *msg = AWS_CONTAINER_OF(node, struct aws_io_message, queueing_handle);
+        if (msg->on_completion) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+/* With max_write_messages_in_flight, that many aws_io_messages are sent before waiting for one to complete */
+H1_CLIENT_TEST_CASE(h1_client_request_multiple_write_messages_in_flight) {
+    (void)ctx;
+    struct tester tester;
+    struct tester_options tester_opts = {
+        .max_write_messages_in_flight = 3,
+    };
+    ASSERT_SUCCESS(s_tester_init_ex(&tester, allocator, &tester_opts));
+
+    testing_channel_complete_written_messages_immediately(&tester.testing_channel, false, 0);
+
+    /* Body big enough to need a bunch of aws_io_messages */
+    size_t body_len = g_aws_channel_max_fragment_size * 8;
+    struct aws_byte_buf body_buf;
+    ASSERT_SUCCESS(aws_byte_buf_init(&body_buf, allocator, body_len));
+    while (body_buf.len < body_len) {
+        aws_byte_buf_write_u8(&body_buf, (uint8_t)('a' + body_buf.len % 26));
+    }
+
+    const struct aws_byte_cursor body = aws_byte_cursor_from_buf(&body_buf);
+    struct aws_input_stream *body_stream = aws_input_stream_new_from_cursor(allocator, &body);
+
+    char content_length_value[100];
+    snprintf(content_length_value, sizeof(content_length_value), "%zu", body_len);
+    struct aws_http_header headers[] = {
+        {
+            .name = aws_byte_cursor_from_c_str("Content-Length"),
+            .value = aws_byte_cursor_from_c_str(content_length_value),
+        },
+    };
+
+    struct aws_http_message *request = aws_http_message_new_request(allocator);
+    ASSERT_NOT_NULL(request);
+    ASSERT_SUCCESS(aws_http_message_set_request_method(request, aws_byte_cursor_from_c_str("PUT")));
+    ASSERT_SUCCESS(aws_http_message_set_request_path(request, aws_byte_cursor_from_c_str("/large.txt")));
+    aws_http_message_add_header_array(request, headers, AWS_ARRAY_SIZE(headers));
+    aws_http_message_set_body_stream(request, body_stream);
+
+    struct aws_http_make_request_options opt = {
+        .self_size = sizeof(opt),
+        .request = request,
+    };
+    struct aws_http_stream *stream = aws_http_connection_make_request(tester.connection, &opt);
+    ASSERT_NOT_NULL(stream);
+    ASSERT_SUCCESS(aws_http_stream_activate(stream));
+
+    /* The connection should fill the pipeline, then wait */
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    struct aws_linked_list *written_msgs = testing_channel_get_written_message_queue(&tester.testing_channel);
+    ASSERT_UINT_EQUALS(3, s_count_messages_in_flight(written_msgs));
+
+    /* Each time the oldest message completes, another one takes its place */
+    size_t completed_count = 0;
+    for (struct aws_linked_list_node *node = aws_linked_list_begin(written_msgs);
+         node != aws_linked_list_end(written_msgs);
+         node = aws_linked_list_next(node)) {
+
+        struct aws_io_message *msg = AWS_CONTAINER_OF(node, struct aws_io_message, queueing_handle);
+        ASSERT_NOT_NULL(msg->on_completion);
+        msg->on_completion(tester.testing_channel.channel, msg, 0, msg->user_data);
+        msg->on_completion = NULL;
+        ++completed_count;
+
+        testing_channel_drain_queued_tasks(&tester.testing_channel);
+        ASSERT_TRUE(s_count_messages_in_flight(written_msgs) <= 3);
+    }
+    ASSERT_TRUE(completed_count > 3);
+
+    /* check result */
+    const char *expected_head_fmt = "PUT /large.txt HTTP/1.1\r\n"
+                                    "Content-Length: %zu\r\n"
+                                    "\r\n";
+    char expected_head[1024];
+    int expected_head_len = snprintf(expected_head, sizeof(expected_head), expected_head_fmt, body_len);
+
+    struct aws_byte_buf expected_buf;
+    ASSERT_SUCCESS(aws_byte_buf_init(&expected_buf, allocator, body_len + expected_head_len));
+    ASSERT_TRUE(aws_byte_buf_write(&expected_buf, (uint8_t *)expected_head, expected_head_len));
+    ASSERT_TRUE(aws_byte_buf_write_from_whole_buffer(&expected_buf, body_buf));
+
+    ASSERT_SUCCESS(testing_channel_check_written_messages(
+        &tester.testing_channel, allocator, aws_byte_cursor_from_buf(&expected_buf)));
+
+    /* clean up */
+    aws_input_stream_release(body_stream);
+    aws_http_message_destroy(request);
+    aws_http_stream_release(stream);
+    aws_byte_buf_clean_up(&body_buf);
+    aws_byte_buf_clean_up(&expected_buf);
+
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
 H1_CLIENT_TEST_CASE(h1_client_request_content_length_0_ok) {
     (void)ctx;
     struct tester tester;
@@ -1247,6 +1458,111 @@ H1_CLIENT_TEST_CASE(h1_client_request_send_large_body) {
     return AWS_OP_SUCCESS;
 }
 
+static void s_count_body_segment_release(void *user_data) {
+    size_t *release_count = user_data;
+    (*release_count)++;
+}
+
+/* Send a request whose body is caller-owned segments. The large one is too big to copy into an aws_io_message,
+ * so it's sent as-is, and released once written */
+H1_CLIENT_TEST_CASE(h1_client_request_send_body_segments) {
+    (void)ctx;
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init(&tester, allocator));
+
+    size_t large_len = 1024 * 1024 * 1; /* 1MB */
+    struct aws_byte_buf large_buf;
+    ASSERT_SUCCESS(aws_byte_buf_init(&large_buf, allocator, large_len));
+    while (large_buf.len < large_len) {
+        int r = rand();
+        aws_byte_buf_write_be32(&large_buf, (uint32_t)r);
+    }
+
+    size_t release_counts[3] = {0};
+    struct aws_http_body_segment segments[] = {
+        {
+            .data = aws_byte_cursor_from_c_str("small before,"),
+            .on_release = s_count_body_segment_release,
+            .user_data = &release_counts[0],
+        },
+        {
+            .data = aws_byte_cursor_from_buf(&large_buf),
+            .on_release = s_count_body_segment_release,
+            .user_data = &release_counts[1],
+        },
+        {
+            .data = aws_byte_cursor_from_c_str("small after"),
+            .on_release = s_count_body_segment_release,
+            .user_data = &release_counts[2],
+        },
+    };
+    size_t body_len = segments[0].data.len + segments[1].data.len + segments[2].data.len;
+
+    struct aws_input_stream *body_stream =
+        aws_http_body_segments_stream_new(allocator, segments, AWS_ARRAY_SIZE(segments));
+    ASSERT_NOT_NULL(body_stream);
+
+    char content_length_value[100];
+    snprintf(content_length_value, sizeof(content_length_value), "%zu", body_len);
+    struct aws_http_header headers[] = {
+        {
+            .name = aws_byte_cursor_from_c_str("Content-Length"),
+            .value = aws_byte_cursor_from_c_str(content_length_value),
+        },
+    };
+
+    struct aws_http_message *request = aws_http_message_new_request(allocator);
+    ASSERT_NOT_NULL(request);
+    ASSERT_SUCCESS(aws_http_message_set_request_method(request, aws_byte_cursor_from_c_str("PUT")));
+    ASSERT_SUCCESS(aws_http_message_set_request_path(request, aws_byte_cursor_from_c_str("/large.txt")));
+    aws_http_message_add_header_array(request, headers, AWS_ARRAY_SIZE(headers));
+    aws_http_message_set_body_stream(request, body_stream);
+    /* request holds the only reference now */
+    aws_input_stream_release(body_stream);
+
+    struct aws_http_make_request_options opt = {
+        .self_size = sizeof(opt),
+        .request = request,
+    };
+    struct aws_http_stream *stream = aws_http_connection_make_request(tester.connection, &opt);
+    ASSERT_NOT_NULL(stream);
+    ASSERT_SUCCESS(aws_http_stream_activate(stream));
+
+    /* check result */
+    const char *expected_head_fmt = "PUT /large.txt HTTP/1.1\r\n"
+                                    "Content-Length: %zu\r\n"
+                                    "\r\n";
+    char expected_head[1024];
+    int expected_head_len = snprintf(expected_head, sizeof(expected_head), expected_head_fmt, body_len);
+
+    struct aws_byte_buf expected_buf;
+    ASSERT_SUCCESS(aws_byte_buf_init(&expected_buf, allocator, body_len + expected_head_len));
+    ASSERT_TRUE(aws_byte_buf_write(&expected_buf, (uint8_t *)expected_head, expected_head_len));
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(segments); ++i) {
+        ASSERT_TRUE(aws_byte_buf_write_from_whole_cursor(&expected_buf, segments[i].data));
+    }
+
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    /* every segment was released once written */
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(release_counts); ++i) {
+        ASSERT_UINT_EQUALS(1, release_counts[i]);
+    }
+
+    ASSERT_SUCCESS(testing_channel_check_written_messages(
+        &tester.testing_channel, allocator, aws_byte_cursor_from_buf(&expected_buf)));
+
+    /* clean up */
+    aws_http_message_destroy(request);
+    aws_http_stream_release(stream);
+
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+
+    aws_byte_buf_clean_up(&large_buf);
+    aws_byte_buf_clean_up(&expected_buf);
+    return AWS_OP_SUCCESS;
+}
+
 static int s_parse_chunked_extensions(
     const char *extensions,
     struct aws_http1_chunk_extension *expected_extensions,
@@ -1944,6 +2260,18 @@ H1_CLIENT_TEST_CASE(h1_client_response_get_body) {
         stream_tester.metrics.sending_duration_ns ==
         stream_tester.metrics.send_end_timestamp_ns - stream_tester.metrics.send_start_timestamp_ns);
     ASSERT_TRUE(stream_tester.metrics.stream_id == stream_tester.stream->id);
+    ASSERT_TRUE(stream_tester.metrics.activate_timestamp_ns > 0);
+    ASSERT_TRUE(stream_tester.metrics.activate_timestamp_ns <= stream_tester.metrics.send_start_timestamp_ns);
+    ASSERT_TRUE(
+        stream_tester.metrics.receive_headers_end_timestamp_ns >= stream_tester.metrics.receive_start_timestamp_ns);
+    ASSERT_TRUE(
+        stream_tester.metrics.receive_headers_end_timestamp_ns <= stream_tester.metrics.receive_end_timestamp_ns);
+    ASSERT_TRUE(stream_tester.metrics.connection_acquisition_wait_ns == -1);
+
+    struct aws_http_stream_metrics metrics;
+    aws_http_stream_get_metrics(stream_tester.stream, &metrics);
+    ASSERT_INT_EQUALS(stream_tester.metrics.activate_timestamp_ns, metrics.activate_timestamp_ns);
+    ASSERT_INT_EQUALS(stream_tester.metrics.receive_end_timestamp_ns, metrics.receive_end_timestamp_ns);
 
     /* clean up */
     client_stream_tester_clean_up(&stream_tester);
@@ -2058,54 +2386,343 @@ H1_CLIENT_TEST_CASE(h1_client_response_get_100) {
     return AWS_OP_SUCCESS;
 }
 
-/* Check that a response spread across multiple aws_io_messages comes through */
-H1_CLIENT_TEST_CASE(h1_client_response_get_1_from_multiple_io_messages) {
-    (void)ctx;
-    struct tester tester;
-    ASSERT_SUCCESS(s_tester_init(&tester, allocator));
-
-    /* send request */
-    struct aws_http_message *request = s_new_default_get_request(allocator);
+static const struct aws_byte_cursor s_expect_continue_body = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("write more tests");
 
-    struct client_stream_tester stream_tester;
-    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, &tester, request));
+/* PUT request with "Expect: 100-continue" header, and either a 16 byte body or chunked encoding */
+static struct aws_http_message *s_new_expect_continue_put_request(struct aws_allocator *allocator, bool chunked) {
+    struct aws_http_message *request =
+        chunked ? s_new_default_chunked_put_request(allocator) : aws_http_message_new_request(allocator);
+    AWS_FATAL_ASSERT(request);
 
-    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    if (!chunked) {
+        AWS_FATAL_ASSERT(
+            AWS_OP_SUCCESS == aws_http_message_set_request_method(request, aws_byte_cursor_from_c_str("PUT")));
+        AWS_FATAL_ASSERT(
+            AWS_OP_SUCCESS == aws_http_message_set_request_path(request, aws_byte_cursor_from_c_str("/plan.txt")));
 
-    /* Ensure the request can be destroyed after request is sent */
-    aws_http_message_destroy(request);
+        struct aws_http_header content_length = {
+            .name = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("Content-Length"),
+            .value = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("16"),
+        };
+        AWS_FATAL_ASSERT(AWS_OP_SUCCESS == aws_http_message_add_header(request, content_length));
 
-    /* send response with each byte in its own aws_io_message */
-    const char *response_str = "HTTP/1.1 200 OK\r\n"
-                               "Content-Length: 9\r\n"
-                               "\r\n"
-                               "Call Momo";
-    size_t response_str_len = strlen(response_str);
-    for (size_t i = 0; i < response_str_len; ++i) {
-        ASSERT_SUCCESS(
-            testing_channel_push_read_data(&tester.testing_channel, aws_byte_cursor_from_array(response_str + i, 1)));
+        struct aws_input_stream *body_stream = aws_input_stream_new_from_cursor(allocator, &s_expect_continue_body);
+        AWS_FATAL_ASSERT(body_stream);
+        aws_http_message_set_body_stream(request, body_stream);
+        aws_input_stream_release(body_stream);
     }
 
-    testing_channel_drain_queued_tasks(&tester.testing_channel);
-
-    /* check result */
-    ASSERT_TRUE(stream_tester.complete);
-    ASSERT_INT_EQUALS(AWS_ERROR_SUCCESS, stream_tester.on_complete_error_code);
-    ASSERT_INT_EQUALS(200, stream_tester.response_status);
-    ASSERT_UINT_EQUALS(1, aws_http_headers_count(stream_tester.response_headers));
-    ASSERT_SUCCESS(s_check_header(stream_tester.response_headers, 0, "Content-Length", "9"));
-    ASSERT_TRUE(aws_byte_buf_eq_c_str(&stream_tester.response_body, "Call Momo"));
+    struct aws_http_header expect = {
+        .name = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("Expect"),
+        .value = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("100-continue"),
+    };
+    AWS_FATAL_ASSERT(AWS_OP_SUCCESS == aws_http_message_add_header(request, expect));
 
-    /* clean up */
-    client_stream_tester_clean_up(&stream_tester);
-    ASSERT_SUCCESS(s_tester_clean_up(&tester));
-    return AWS_OP_SUCCESS;
+    return request;
 }
 
-/* Check that multiple responses in a single aws_io_message all come through */
-H1_CLIENT_TEST_CASE(h1_client_response_get_multiple_from_1_io_message) {
+/* Request body should be held until "100 Continue" arrives */
+H1_CLIENT_TEST_CASE(h1_client_request_expect_continue_waits_for_100) {
     (void)ctx;
-    struct tester tester;
+    struct tester_options tester_opts = {
+        .expect_continue_timeout_ms = 60 * 1000,
+    };
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init_ex(&tester, allocator, &tester_opts));
+
+    struct aws_http_message *request = s_new_expect_continue_put_request(allocator, false /*chunked*/);
+    struct client_stream_tester stream_tester;
+    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, &tester, request));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    /* Only the head should be sent */
+    ASSERT_SUCCESS(testing_channel_check_written_messages_str(
+        &tester.testing_channel,
+        allocator,
+        "PUT /plan.txt HTTP/1.1\r\n"
+        "Content-Length: 16\r\n"
+        "Expect: 100-continue\r\n"
+        "\r\n"));
+
+    /* Body should be sent once server says to continue */
+    ASSERT_SUCCESS(testing_channel_push_read_str(&tester.testing_channel, "HTTP/1.1 100 Continue\r\n\r\n"));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    ASSERT_SUCCESS(testing_channel_check_written_messages_str(&tester.testing_channel, allocator, "write more tests"));
+    ASSERT_FALSE(stream_tester.complete);
+
+    ASSERT_SUCCESS(testing_channel_push_read_str(
+        &tester.testing_channel,
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length: 0\r\n"
+        "\r\n"));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    ASSERT_TRUE(stream_tester.complete);
+    ASSERT_INT_EQUALS(AWS_ERROR_SUCCESS, stream_tester.on_complete_error_code);
+    ASSERT_INT_EQUALS(200, stream_tester.response_status);
+    ASSERT_UINT_EQUALS(1, stream_tester.num_info_responses);
+    ASSERT_TRUE(aws_http_connection_is_open(tester.connection));
+
+    /* clean up */
+    aws_http_message_release(request);
+    client_stream_tester_clean_up(&stream_tester);
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
+/* Request body should be sent anyway if the server doesn't respond before the timeout */
+H1_CLIENT_TEST_CASE(h1_client_request_expect_continue_timeout) {
+    (void)ctx;
+    struct tester_options tester_opts = {
+        .expect_continue_timeout_ms = 200,
+    };
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init_ex(&tester, allocator, &tester_opts));
+
+    struct aws_http_message *request = s_new_expect_continue_put_request(allocator, false /*chunked*/);
+    struct client_stream_tester stream_tester;
+    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, &tester, request));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    ASSERT_SUCCESS(testing_channel_check_written_messages_str(
+        &tester.testing_channel,
+        allocator,
+        "PUT /plan.txt HTTP/1.1\r\n"
+        "Content-Length: 16\r\n"
+        "Expect: 100-continue\r\n"
+        "\r\n"));
+
+    /* Wait past the timeout */
+    aws_thread_current_sleep(aws_timestamp_convert(400, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    ASSERT_SUCCESS(testing_channel_check_written_messages_str(&tester.testing_channel, allocator, "write more tests"));
+
+    /* A late "100 Continue" is harmless */
+    ASSERT_SUCCESS(testing_channel_push_read_str(
+        &tester.testing_channel,
+        "HTTP/1.1 100 Continue\r\n"
+        "\r\n"
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length: 0\r\n"
+        "\r\n"));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    ASSERT_TRUE(stream_tester.complete);
+    ASSERT_INT_EQUALS(AWS_ERROR_SUCCESS, stream_tester.on_complete_error_code);
+    ASSERT_INT_EQUALS(200, stream_tester.response_status);
+    ASSERT_TRUE(aws_http_connection_is_open(tester.connection));
+
+    /* clean up */
+    aws_http_message_release(request);
+    client_stream_tester_clean_up(&stream_tester);
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
+/* If a final response arrives instead of "100 Continue", the body is never sent.
+ * The body has a Content-Length, so the connection must close. */
+H1_CLIENT_TEST_CASE(h1_client_request_expect_continue_rejected) {
+    (void)ctx;
+    struct tester_options tester_opts = {
+        .expect_continue_timeout_ms = 60 * 1000,
+    };
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init_ex(&tester, allocator, &tester_opts));
+
+    struct aws_http_message *request = s_new_expect_continue_put_request(allocator, false /*chunked*/);
+    struct client_stream_tester stream_tester;
+    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, &tester, request));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    ASSERT_SUCCESS(testing_channel_check_written_messages_str(
+        &tester.testing_channel,
+        allocator,
+        "PUT /plan.txt HTTP/1.1\r\n"
+        "Content-Length: 16\r\n"
+        "Expect: 100-continue\r\n"
+        "\r\n"));
+
+    ASSERT_SUCCESS(testing_channel_push_read_str(
+        &tester.testing_channel,
+        "HTTP/1.1 413 Content Too Large\r\n"
+        "Content-Length: 0\r\n"
+        "\r\n"));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    ASSERT_TRUE(stream_tester.complete);
+    ASSERT_INT_EQUALS(AWS_ERROR_SUCCESS, stream_tester.on_complete_error_code);
+    ASSERT_INT_EQUALS(413, stream_tester.response_status);
+    ASSERT_FALSE(stream_tester.on_complete_connection_is_open);
+
+    /* Body was never sent */
+    ASSERT_TRUE(aws_linked_list_empty(testing_channel_get_written_message_queue(&tester.testing_channel)));
+
+    /* Connection should have shut down cleanly after delivering response */
+    ASSERT_TRUE(testing_channel_is_shutdown_completed(&tester.testing_channel));
+    ASSERT_INT_EQUALS(AWS_ERROR_SUCCESS, testing_channel_get_shutdown_error_code(&tester.testing_channel));
+
+    /* clean up */
+    aws_http_message_release(request);
+    client_stream_tester_clean_up(&stream_tester);
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
+/* If a final response arrives instead of "100 Continue", a chunked body is ended with the last-chunk,
+ * and the connection can keep going */
+H1_CLIENT_TEST_CASE(h1_client_request_expect_continue_rejected_chunked) {
+    (void)ctx;
+    struct tester_options tester_opts = {
+        .expect_continue_timeout_ms = 60 * 1000,
+    };
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init_ex(&tester, allocator, &tester_opts));
+
+    struct aws_http_message *request = s_new_expect_continue_put_request(allocator, true /*chunked*/);
+    struct client_stream_tester stream_tester;
+    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, &tester, request));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    ASSERT_SUCCESS(testing_channel_check_written_messages_str(
+        &tester.testing_channel,
+        allocator,
+        "PUT /plan.txt HTTP/1.1\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "Expect: 100-continue\r\n"
+        "\r\n"));
+
+    ASSERT_SUCCESS(testing_channel_push_read_str(
+        &tester.testing_channel,
+        "HTTP/1.1 403 Forbidden\r\n"
+        "Content-Length: 0\r\n"
+        "\r\n"));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    ASSERT_SUCCESS(testing_channel_check_written_messages_str(&tester.testing_channel, allocator, "0\r\n\r\n"));
+
+    ASSERT_TRUE(stream_tester.complete);
+    ASSERT_INT_EQUALS(AWS_ERROR_SUCCESS, stream_tester.on_complete_error_code);
+    ASSERT_INT_EQUALS(403, stream_tester.response_status);
+    ASSERT_TRUE(stream_tester.on_complete_connection_is_open);
+    ASSERT_FALSE(testing_channel_is_shutdown_completed(&tester.testing_channel));
+
+    /* clean up */
+    aws_http_message_release(request);
+    client_stream_tester_clean_up(&stream_tester);
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
+/* Check that a response spread across multiple aws_io_messages comes through */
+H1_CLIENT_TEST_CASE(h1_client_response_get_1_from_multiple_io_messages) {
+    (void)ctx;
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init(&tester, allocator));
+
+    /* send request */
+    struct aws_http_message *request = s_new_default_get_request(allocator);
+
+    struct client_stream_tester stream_tester;
+    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, &tester, request));
+
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    /* Ensure the request can be destroyed after request is sent */
+    aws_http_message_destroy(request);
+
+    /* send response with each byte in its own aws_io_message */
+    const char *response_str = "HTTP/1.1 200 OK\r\n"
+                               "Content-Length: 9\r\n"
+                               "\r\n"
+                               "Call Momo";
+    size_t response_str_len = strlen(response_str);
+    for (size_t i = 0; i < response_str_len; ++i) {
+        ASSERT_SUCCESS(
+            testing_channel_push_read_data(&tester.testing_channel, aws_byte_cursor_from_array(response_str + i, 1)));
+    }
+
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    /* check result */
+    ASSERT_TRUE(stream_tester.complete);
+    ASSERT_INT_EQUALS(AWS_ERROR_SUCCESS, stream_tester.on_complete_error_code);
+    ASSERT_INT_EQUALS(200, stream_tester.response_status);
+    ASSERT_UINT_EQUALS(1, aws_http_headers_count(stream_tester.response_headers));
+    ASSERT_SUCCESS(s_check_header(stream_tester.response_headers, 0, "Content-Length", "9"));
+    ASSERT_TRUE(aws_byte_buf_eq_c_str(&stream_tester.response_body, "Call Momo"));
+
+    /* clean up */
+    client_stream_tester_clean_up(&stream_tester);
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
+/* Check that deliver_whole_header_blocks gets each header-block to the user in one callback,
+ * even when the block is spread across aws_io_messages and some lines are split between them */
+H1_CLIENT_TEST_CASE(h1_client_response_whole_header_blocks) {
+    (void)ctx;
+    struct tester tester;
+    struct tester_options tester_options = {
+        .deliver_whole_header_blocks = true,
+    };
+    ASSERT_SUCCESS(s_tester_init_ex(&tester, allocator, &tester_options));
+
+    /* send request */
+    struct aws_http_message *request = s_new_default_get_request(allocator);
+
+    struct client_stream_tester stream_tester;
+    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, &tester, request));
+
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    /* Ensure the request can be destroyed after request is sent */
+    aws_http_message_destroy(request);
+
+    /* send response, splitting the main header-block mid-line across aws_io_messages */
+    ASSERT_SUCCESS(testing_channel_push_read_str(
+        &tester.testing_channel,
+        "HTTP/1.1 100 Continue\r\n"
+        "Date: Fri, 01 Mar 2019 17:18:55 GMT\r\n"
+        "\r\n"
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length: 9\r\n"
+        "x-amz-request"));
+    ASSERT_SUCCESS(testing_channel_push_read_str(&tester.testing_channel, "-id: 4B5B4C7A6C4FE422\r\nServer: some-"));
+    ASSERT_SUCCESS(testing_channel_push_read_str(&tester.testing_channel, "server\r\n"));
+    ASSERT_SUCCESS(testing_channel_push_read_str(&tester.testing_channel, "ETag: \"fba9dede5f27\"\r"));
+    ASSERT_SUCCESS(testing_channel_push_read_str(&tester.testing_channel, "\n\r\nCall Momo"));
+
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    /* check result */
+    ASSERT_TRUE(stream_tester.complete);
+    ASSERT_INT_EQUALS(AWS_ERROR_SUCCESS, stream_tester.on_complete_error_code);
+    ASSERT_INT_EQUALS(200, stream_tester.response_status);
+
+    /* one callback for the informational block, one for the main block */
+    ASSERT_UINT_EQUALS(2, stream_tester.on_headers_count);
+
+    ASSERT_UINT_EQUALS(1, stream_tester.num_info_responses);
+    ASSERT_SUCCESS(s_check_info_response_header(&stream_tester, 0, 0, "Date", "Fri, 01 Mar 2019 17:18:55 GMT"));
+
+    ASSERT_UINT_EQUALS(4, aws_http_headers_count(stream_tester.response_headers));
+    ASSERT_SUCCESS(s_check_header(stream_tester.response_headers, 0, "Content-Length", "9"));
+    ASSERT_SUCCESS(s_check_header(stream_tester.response_headers, 1, "x-amz-request-id", "4B5B4C7A6C4FE422"));
+    ASSERT_SUCCESS(s_check_header(stream_tester.response_headers, 2, "Server", "some-server"));
+    ASSERT_SUCCESS(s_check_header(stream_tester.response_headers, 3, "ETag", "\"fba9dede5f27\""));
+
+    ASSERT_TRUE(aws_byte_buf_eq_c_str(&stream_tester.response_body, "Call Momo"));
+
+    /* clean up */
+    client_stream_tester_clean_up(&stream_tester);
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
+/* Check that multiple responses in a single aws_io_message all come through */
+H1_CLIENT_TEST_CASE(h1_client_response_get_multiple_from_1_io_message) {
+    (void)ctx;
+    struct tester tester;
     ASSERT_SUCCESS(s_tester_init(&tester, allocator));
 
     /* send requests */
@@ -2822,31 +3439,180 @@ H1_CLIENT_TEST_CASE(h1_client_request_close_header_with_chunked_encoding_and_pip
     return AWS_OP_SUCCESS;
 }
 
-/* Test that the stream window rules are respected. These rules are:
- * - Each new stream's window starts at initial_stream_window_size.
- * - Only body data counts against the stream's window.
- * - The stream will not receive more body data than its window allows.
- * - Any future streams on the same connection also start with initial_stream_window_size,
- *   they should not be affected if a previous stream had a very small or very large window when it ended.
- */
-H1_CLIENT_TEST_CASE(h1_client_respects_stream_window) {
-    (void)ctx;
+static const char *s_pipelined_get_request_str = "GET / HTTP/1.1\r\n"
+                                                  "\r\n";
+static const char *s_pipelined_response_str = "HTTP/1.1 200 OK\r\n"
+                                              "Content-Length: 0\r\n"
+                                              "\r\n";
 
-    /* This test only checks that the stream window is respected.
-     * We're not testing the connection window, so just use a giant buffer */
+/* With max_pipelined_requests, only that many requests are written ahead of their responses */
+H1_CLIENT_TEST_CASE(h1_client_request_max_pipelined_requests) {
+    (void)ctx;
     struct tester_options tester_opts = {
-        .manual_window_management = true,
-        .initial_stream_window_size = 5,
-        .read_buffer_capacity = SIZE_MAX,
+        .max_pipelined_requests = 2,
     };
     struct tester tester;
     ASSERT_SUCCESS(s_tester_init_ex(&tester, allocator, &tester_opts));
 
-    /**
-     * Request/Response 1
-     */
+    enum { NUM_STREAMS = 3 };
+    struct aws_http_message *requests[NUM_STREAMS];
+    struct client_stream_tester stream_testers[NUM_STREAMS];
+    for (size_t i = 0; i < NUM_STREAMS; ++i) {
+        requests[i] = s_new_default_get_request(allocator);
+        ASSERT_SUCCESS(s_stream_tester_init(&stream_testers[i], &tester, requests[i]));
+    }
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
 
-    struct aws_http_message *request = s_new_default_get_request(allocator);
+    /* The first 2 requests are written back to back, the 3rd waits */
+    char expected[256];
+    snprintf(expected, sizeof(expected), "%s%s", s_pipelined_get_request_str, s_pipelined_get_request_str);
+    ASSERT_SUCCESS(testing_channel_check_written_messages_str(&tester.testing_channel, allocator, expected));
+
+    /* Once the 1st response completes, the 3rd request is written */
+    ASSERT_SUCCESS(testing_channel_push_read_str(&tester.testing_channel, s_pipelined_response_str));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    ASSERT_TRUE(stream_testers[0].complete);
+    ASSERT_SUCCESS(testing_channel_check_written_messages_str(
+        &tester.testing_channel, allocator, s_pipelined_get_request_str));
+
+    for (size_t i = 1; i < NUM_STREAMS; ++i) {
+        ASSERT_SUCCESS(testing_channel_push_read_str(&tester.testing_channel, s_pipelined_response_str));
+    }
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    for (size_t i = 0; i < NUM_STREAMS; ++i) {
+        ASSERT_TRUE(stream_testers[i].complete);
+        ASSERT_INT_EQUALS(AWS_ERROR_SUCCESS, stream_testers[i].on_complete_error_code);
+        ASSERT_INT_EQUALS(200, stream_testers[i].response_status);
+    }
+    ASSERT_TRUE(aws_http_connection_is_open(tester.connection));
+
+    /* clean up */
+    for (size_t i = 0; i < NUM_STREAMS; ++i) {
+        aws_http_message_destroy(requests[i]);
+        client_stream_tester_clean_up(&stream_testers[i]);
+    }
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
+/* With max_pipelined_requests, a request that isn't idempotent is only written alone */
+H1_CLIENT_TEST_CASE(h1_client_request_pipelining_waits_for_non_idempotent) {
+    (void)ctx;
+    struct tester_options tester_opts = {
+        .max_pipelined_requests = 4,
+    };
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init_ex(&tester, allocator, &tester_opts));
+
+    enum { NUM_STREAMS = 3 };
+    struct aws_http_message *requests[NUM_STREAMS] = {
+        s_new_default_get_request(allocator),
+        s_new_default_get_request(allocator),
+        s_new_default_get_request(allocator),
+    };
+    ASSERT_SUCCESS(aws_http_message_set_request_method(requests[1], aws_byte_cursor_from_c_str("POST")));
+    struct client_stream_tester stream_testers[NUM_STREAMS];
+    for (size_t i = 0; i < NUM_STREAMS; ++i) {
+        ASSERT_SUCCESS(s_stream_tester_init(&stream_testers[i], &tester, requests[i]));
+    }
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    /* The POST waits for the response before it, and the GET after it waits for the POST's response */
+    ASSERT_SUCCESS(testing_channel_check_written_messages_str(
+        &tester.testing_channel, allocator, s_pipelined_get_request_str));
+
+    ASSERT_SUCCESS(testing_channel_push_read_str(&tester.testing_channel, s_pipelined_response_str));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    ASSERT_SUCCESS(testing_channel_check_written_messages_str(
+        &tester.testing_channel,
+        allocator,
+        "POST / HTTP/1.1\r\n"
+        "\r\n"));
+
+    ASSERT_SUCCESS(testing_channel_push_read_str(&tester.testing_channel, s_pipelined_response_str));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    ASSERT_SUCCESS(testing_channel_check_written_messages_str(
+        &tester.testing_channel, allocator, s_pipelined_get_request_str));
+
+    ASSERT_SUCCESS(testing_channel_push_read_str(&tester.testing_channel, s_pipelined_response_str));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    for (size_t i = 0; i < NUM_STREAMS; ++i) {
+        ASSERT_TRUE(stream_testers[i].complete);
+        ASSERT_INT_EQUALS(AWS_ERROR_SUCCESS, stream_testers[i].on_complete_error_code);
+    }
+
+    /* clean up */
+    for (size_t i = 0; i < NUM_STREAMS; ++i) {
+        aws_http_message_destroy(requests[i]);
+        client_stream_tester_clean_up(&stream_testers[i]);
+    }
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
+/* With max_pipelined_requests, if the connection closes mid-pipeline, the requests never written can be told apart */
+H1_CLIENT_TEST_CASE(h1_client_request_pipelining_connection_closed) {
+    (void)ctx;
+    struct tester_options tester_opts = {
+        .max_pipelined_requests = 2,
+    };
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init_ex(&tester, allocator, &tester_opts));
+
+    enum { NUM_STREAMS = 3 };
+    struct aws_http_message *requests[NUM_STREAMS];
+    struct client_stream_tester stream_testers[NUM_STREAMS];
+    for (size_t i = 0; i < NUM_STREAMS; ++i) {
+        requests[i] = s_new_default_get_request(allocator);
+        ASSERT_SUCCESS(s_stream_tester_init(&stream_testers[i], &tester, requests[i]));
+    }
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    aws_channel_shutdown(tester.testing_channel.channel, AWS_IO_SOCKET_CLOSED);
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    for (size_t i = 0; i < NUM_STREAMS; ++i) {
+        ASSERT_TRUE(stream_testers[i].complete);
+    }
+    /* The server may have acted on the requests written */
+    ASSERT_INT_EQUALS(AWS_IO_SOCKET_CLOSED, stream_testers[0].on_complete_error_code);
+    ASSERT_INT_EQUALS(AWS_IO_SOCKET_CLOSED, stream_testers[1].on_complete_error_code);
+    ASSERT_INT_EQUALS(AWS_ERROR_HTTP_REQUEST_NOT_SENT, stream_testers[2].on_complete_error_code);
+
+    /* clean up */
+    for (size_t i = 0; i < NUM_STREAMS; ++i) {
+        aws_http_message_destroy(requests[i]);
+        client_stream_tester_clean_up(&stream_testers[i]);
+    }
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
+/* Test that the stream window rules are respected. These rules are:
+ * - Each new stream's window starts at initial_stream_window_size.
+ * - Only body data counts against the stream's window.
+ * - The stream will not receive more body data than its window allows.
+ * - Any future streams on the same connection also start with initial_stream_window_size,
+ *   they should not be affected if a previous stream had a very small or very large window when it ended.
+ */
+H1_CLIENT_TEST_CASE(h1_client_respects_stream_window) {
+    (void)ctx;
+
+    /* This test only checks that the stream window is respected.
+     * We're not testing the connection window, so just use a giant buffer */
+    struct tester_options tester_opts = {
+        .manual_window_management = true,
+        .initial_stream_window_size = 5,
+        .read_buffer_capacity = SIZE_MAX,
+    };
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init_ex(&tester, allocator, &tester_opts));
+
+    /**
+     * Request/Response 1
+     */
+
+    struct aws_http_message *request = s_new_default_get_request(allocator);
 
     struct client_stream_tester stream_tester1;
     ASSERT_SUCCESS(s_stream_tester_init(&stream_tester1, &tester, request));
@@ -2934,6 +3700,627 @@ H1_CLIENT_TEST_CASE(h1_client_respects_stream_window) {
     return AWS_OP_SUCCESS;
 }
 
+/* Check that memory usage is reported, and added to a tracker's totals until the connection is destroyed */
+H1_CLIENT_TEST_CASE(h1_client_memory_usage) {
+    (void)ctx;
+    struct tester_options tester_opts = {
+        .manual_window_management = true,
+        .initial_stream_window_size = 5,
+        .read_buffer_capacity = SIZE_MAX,
+    };
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init_ex(&tester, allocator, &tester_opts));
+
+    struct aws_http_connection_memory_tracker *tracker =
+        aws_http_connection_memory_tracker_new(allocator, 0 /*read_window_budget*/);
+    aws_http_connection_set_memory_tracker(tester.connection, tracker);
+
+    struct aws_http_message *request = s_new_default_get_request(allocator);
+    struct client_stream_tester stream_tester;
+    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, &tester, request));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    /* Split a header-line across messages, so the decoder needs its scratch space.
+     * The body is 2X the stream window, so half of it stays unconsumed */
+    ASSERT_SUCCESS(testing_channel_push_read_str(&tester.testing_channel, "HTTP/1.1 200 OK\r\nContent-Len"));
+    ASSERT_SUCCESS(testing_channel_push_read_str(&tester.testing_channel, "gth: 10\r\n\r\n0123456789"));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    ASSERT_BIN_ARRAYS_EQUALS("01234", 5, stream_tester.response_body.buffer, stream_tester.response_body.len);
+
+    struct aws_http_connection_memory_usage usage;
+    aws_http_connection_get_memory_usage(tester.connection, &usage);
+    ASSERT_TRUE(usage.decoder_scratch > 0);
+    ASSERT_UINT_EQUALS(0, usage.hpack_tables);
+    ASSERT_UINT_EQUALS(5, usage.unconsumed_reads);
+
+    struct aws_http_connection_memory_usage totals;
+    aws_http_connection_memory_tracker_get_usage(tracker, &totals);
+    ASSERT_UINT_EQUALS(usage.decoder_scratch, totals.decoder_scratch);
+    ASSERT_UINT_EQUALS(usage.outgoing_queue, totals.outgoing_queue);
+    ASSERT_UINT_EQUALS(usage.buffered_headers, totals.buffered_headers);
+    ASSERT_UINT_EQUALS(usage.unconsumed_reads, totals.unconsumed_reads);
+
+    /* Opening the window consumes the rest */
+    aws_http_stream_update_window(stream_tester.stream, 5);
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    ASSERT_TRUE(stream_tester.complete);
+    ASSERT_SUCCESS(stream_tester.on_complete_error_code);
+
+    aws_http_connection_get_memory_usage(tester.connection, &usage);
+    ASSERT_UINT_EQUALS(0, usage.unconsumed_reads);
+    aws_http_connection_memory_tracker_get_usage(tracker, &totals);
+    ASSERT_UINT_EQUALS(0, totals.unconsumed_reads);
+
+    client_stream_tester_clean_up(&stream_tester);
+    aws_http_message_destroy(request);
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+
+    /* The connection took its usage out of the totals as it was destroyed */
+    aws_http_connection_memory_tracker_get_usage(tracker, &totals);
+    ASSERT_UINT_EQUALS(0, totals.decoder_scratch);
+    ASSERT_UINT_EQUALS(0, totals.outgoing_queue);
+    ASSERT_UINT_EQUALS(0, totals.buffered_headers);
+    ASSERT_UINT_EQUALS(0, totals.unconsumed_reads);
+    aws_http_connection_memory_tracker_release(tracker);
+    return AWS_OP_SUCCESS;
+}
+
+/* Check that connections sharing a read window budget only grow their windows while it has room,
+ * and that a connection held below its fair share gets more once another releases some */
+H1_CLIENT_TEST_CASE(h1_client_read_window_budget) {
+    (void)ctx;
+    struct tester_options tester_opts = {
+        .manual_window_management = true,
+        .initial_stream_window_size = 0,
+        .read_buffer_capacity = 60,
+    };
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init_ex(&tester, allocator, &tester_opts));
+
+    /* A second connection, on its own channel. The logger and library are already set up by the first */
+    struct tester tester_b;
+    AWS_ZERO_STRUCT(tester_b);
+    tester_b.alloc = allocator;
+    struct aws_testing_channel_options test_channel_options = {.clock_fn = aws_high_res_clock_get_ticks};
+    ASSERT_SUCCESS(testing_channel_init(&tester_b.testing_channel, allocator, &test_channel_options));
+    struct aws_http1_connection_options http1_options = {.read_buffer_capacity = 60};
+    tester_b.connection = aws_http_connection_new_http1_1_client(allocator, true, 0, &http1_options);
+    ASSERT_NOT_NULL(tester_b.connection);
+    struct aws_channel_slot *slot = aws_channel_slot_new(tester_b.testing_channel.channel);
+    ASSERT_NOT_NULL(slot);
+    ASSERT_SUCCESS(aws_channel_slot_insert_end(tester_b.testing_channel.channel, slot));
+    ASSERT_SUCCESS(aws_channel_slot_set_handler(slot, &tester_b.connection->channel_handler));
+    tester_b.connection->vtable->on_channel_handler_installed(&tester_b.connection->channel_handler, slot);
+    testing_channel_drain_queued_tasks(&tester_b.testing_channel);
+
+    struct aws_http_connection_memory_tracker *tracker =
+        aws_http_connection_memory_tracker_new(allocator, 100 /*read_window_budget*/);
+    aws_http_connection_set_memory_tracker(tester.connection, tracker);
+    aws_http_connection_set_memory_tracker(tester_b.connection, tracker);
+
+    struct aws_http_message *request = s_new_default_get_request(allocator);
+    struct client_stream_tester stream_tester;
+    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, &tester, request));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    struct aws_http_message *request_b = s_new_default_get_request(allocator);
+    struct client_stream_tester stream_tester_b;
+    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester_b, &tester_b, request_b));
+    testing_channel_drain_queued_tasks(&tester_b.testing_channel);
+
+    /* The first connection is alone, so it gets its window back after the 39 bytes of headers.
+     * Then the body fills its read buffer, since the stream window is 0 */
+    const char *headers = "HTTP/1.1 200 OK\r\n"
+                          "Content-Length: 60\r\n"
+                          "\r\n";
+    ASSERT_SUCCESS(testing_channel_push_read_str(&tester.testing_channel, headers));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    ASSERT_UINT_EQUALS(60, aws_h1_connection_window_stats(tester.connection).connection_window);
+
+    ASSERT_SUCCESS(testing_channel_push_read_str(
+        &tester.testing_channel, "012345678901234567890123456789012345678901234567890123456789"));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    struct aws_h1_window_stats window_stats = aws_h1_connection_window_stats(tester.connection);
+    ASSERT_UINT_EQUALS(0, window_stats.connection_window);
+    ASSERT_UINT_EQUALS(60, window_stats.buffer_pending_bytes);
+
+    /* 60 of the 100 are in use, the second connection only gets the 19 left after its headers */
+    ASSERT_SUCCESS(testing_channel_push_read_str(&tester_b.testing_channel, headers));
+    testing_channel_drain_queued_tasks(&tester_b.testing_channel);
+    ASSERT_UINT_EQUALS(21 + 19, aws_h1_connection_window_stats(tester_b.connection).connection_window);
+
+    /* Consuming the body releases the first connection's 60, but it only takes back its fair share */
+    aws_http_stream_update_window(stream_tester.stream, 60);
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    ASSERT_TRUE(stream_tester.complete);
+    ASSERT_UINT_EQUALS(50, aws_h1_connection_window_stats(tester.connection).connection_window);
+
+    /* The second connection was below its fair share, so it tries again and gets up to it */
+    testing_channel_drain_queued_tasks(&tester_b.testing_channel);
+    ASSERT_UINT_EQUALS(50, aws_h1_connection_window_stats(tester_b.connection).connection_window);
+
+    client_stream_tester_clean_up(&stream_tester_b);
+    aws_http_message_destroy(request_b);
+    aws_http_connection_release(tester_b.connection);
+    ASSERT_SUCCESS(testing_channel_clean_up(&tester_b.testing_channel));
+
+    client_stream_tester_clean_up(&stream_tester);
+    aws_http_message_destroy(request);
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+
+    /* Destroyed connections give back what they reserved */
+    ASSERT_UINT_EQUALS(0, tracker->synced_data.reserved);
+    ASSERT_UINT_EQUALS(0, tracker->synced_data.connection_count);
+    aws_http_connection_memory_tracker_release(tracker);
+    return AWS_OP_SUCCESS;
+}
+
+struct body_lease_tester {
+    struct aws_http_body_lease *lease;
+    bool complete;
+};
+
+static int s_body_lease_tester_on_body_lease(
+    struct aws_http_stream *stream,
+    struct aws_http_body_lease *lease,
+    void *user_data) {
+    (void)stream;
+    struct body_lease_tester *lease_tester = user_data;
+    AWS_FATAL_ASSERT(lease_tester->lease == NULL);
+    lease_tester->lease = aws_http_body_lease_acquire(lease);
+    return AWS_OP_SUCCESS;
+}
+
+static void s_body_lease_tester_on_complete(struct aws_http_stream *stream, int error_code, void *user_data) {
+    (void)stream;
+    (void)error_code;
+    struct body_lease_tester *lease_tester = user_data;
+    lease_tester->complete = true;
+}
+
+/* Leased body data stays valid after the connection is done with it, and holds the connection window shut */
+H1_CLIENT_TEST_CASE(h1_client_body_lease) {
+    (void)ctx;
+    struct tester_options tester_opts = {
+        .manual_window_management = true,
+        .initial_stream_window_size = 100,
+        .read_buffer_capacity = 100,
+    };
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init_ex(&tester, allocator, &tester_opts));
+
+    struct body_lease_tester lease_tester;
+    AWS_ZERO_STRUCT(lease_tester);
+    struct aws_http_message *request = s_new_default_get_request(allocator);
+    struct aws_http_make_request_options opt = {
+        .self_size = sizeof(opt),
+        .request = request,
+        .on_complete = s_body_lease_tester_on_complete,
+        .user_data = &lease_tester,
+        .on_response_body_lease = s_body_lease_tester_on_body_lease,
+    };
+    struct aws_http_stream *stream = aws_http_connection_make_request(tester.connection, &opt);
+    ASSERT_NOT_NULL(stream);
+    ASSERT_SUCCESS(aws_http_stream_activate(stream));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    ASSERT_SUCCESS(testing_channel_push_read_str(
+        &tester.testing_channel,
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length: 40\r\n"
+        "\r\n"));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    ASSERT_UINT_EQUALS(100, aws_h1_connection_window_stats(tester.connection).connection_window);
+
+    /* The connection is done with the body's message, but the lease still holds it */
+    const char *body = "0123456789012345678901234567890123456789";
+    ASSERT_SUCCESS(testing_channel_push_read_str(&tester.testing_channel, body));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    ASSERT_TRUE(lease_tester.complete);
+    ASSERT_NOT_NULL(lease_tester.lease);
+    struct aws_h1_window_stats window_stats = aws_h1_connection_window_stats(tester.connection);
+    ASSERT_UINT_EQUALS(0, window_stats.buffer_pending_bytes);
+    ASSERT_UINT_EQUALS(60, window_stats.connection_window);
+    ASSERT_BIN_ARRAYS_EQUALS(
+        body,
+        strlen(body),
+        aws_http_body_lease_get_data(lease_tester.lease).ptr,
+        aws_http_body_lease_get_data(lease_tester.lease).len);
+
+    /* Releasing the lease gives the window back */
+    aws_http_body_lease_release(lease_tester.lease);
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    ASSERT_UINT_EQUALS(100, aws_h1_connection_window_stats(tester.connection).connection_window);
+
+    aws_http_stream_release(stream);
+    aws_http_message_destroy(request);
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
+/* Test decoder for the "x-double" content-coding, where every byte is sent twice */
+struct double_decoder {
+    struct aws_http_content_decoder base;
+    bool has_pending;
+    uint8_t pending;
+};
+
+static int s_double_decoder_decode(
+    struct aws_http_content_decoder *decoder_base,
+    struct aws_byte_cursor *encoded,
+    struct aws_byte_buf *decoded) {
+    struct double_decoder *decoder = decoder_base->impl;
+    while (encoded->len > 0 && decoded->len < decoded->capacity) {
+        uint8_t byte = encoded->ptr[0];
+        aws_byte_cursor_advance(encoded, 1);
+        if (!decoder->has_pending) {
+            decoder->pending = byte;
+            decoder->has_pending = true;
+            continue;
+        }
+        if (byte != decoder->pending) {
+            return aws_raise_error(AWS_ERROR_HTTP_CONTENT_DECODING_FAILED);
+        }
+        aws_byte_buf_write_u8(decoded, byte);
+        decoder->has_pending = false;
+    }
+    return AWS_OP_SUCCESS;
+}
+
+static int s_double_decoder_finish(struct aws_http_content_decoder *decoder_base) {
+    struct double_decoder *decoder = decoder_base->impl;
+    return decoder->has_pending ? aws_raise_error(AWS_ERROR_HTTP_CONTENT_DECODING_FAILED) : AWS_OP_SUCCESS;
+}
+
+static void s_double_decoder_destroy(struct aws_http_content_decoder *decoder) {
+    aws_mem_release(decoder->allocator, decoder);
+}
+
+static struct aws_http_content_decoder_vtable s_double_decoder_vtable = {
+    .decode = s_double_decoder_decode,
+    .finish = s_double_decoder_finish,
+    .destroy = s_double_decoder_destroy,
+};
+
+static struct aws_http_content_decoder *s_double_decoder_new(
+    struct aws_allocator *allocator,
+    struct aws_byte_cursor content_coding,
+    void *user_data) {
+    (void)user_data;
+    if (!aws_byte_cursor_eq_c_str_ignore_case(&content_coding, "x-double")) {
+        aws_raise_error(AWS_ERROR_HTTP_UNSUPPORTED_CONTENT_ENCODING);
+        return NULL;
+    }
+    struct double_decoder *decoder = aws_mem_calloc(allocator, 1, sizeof(struct double_decoder));
+    decoder->base.vtable = &s_double_decoder_vtable;
+    decoder->base.allocator = allocator;
+    decoder->base.impl = decoder;
+    return &decoder->base;
+}
+
+H1_CLIENT_TEST_CASE(h1_client_response_content_decoding) {
+    (void)ctx;
+    struct tester_options tester_opts = {
+        .manual_window_management = true,
+        .initial_stream_window_size = 100,
+    };
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init_ex(&tester, allocator, &tester_opts));
+
+    /* A small buffer, so decoding takes several passes */
+    struct aws_http_content_decoding_options decoding_options = {
+        .new_decoder = s_double_decoder_new,
+        .accept_encoding = aws_byte_cursor_from_c_str("x-double"),
+        .decoded_buffer_size = 4,
+    };
+    struct aws_http_message *request = s_new_default_get_request(allocator);
+    struct client_stream_tester stream_tester;
+    struct client_stream_tester_options stream_tester_opts = {
+        .request = request,
+        .connection = tester.connection,
+        .content_decoding = &decoding_options,
+    };
+    ASSERT_SUCCESS(client_stream_tester_init(&stream_tester, allocator, &stream_tester_opts));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    ASSERT_SUCCESS(testing_channel_check_written_message_str(
+        &tester.testing_channel,
+        "GET / HTTP/1.1\r\n"
+        "Accept-Encoding: x-double\r\n"
+        "\r\n"));
+
+    /* The odd byte at the end of the first part decodes with the second part */
+    ASSERT_SUCCESS(testing_channel_push_read_str(
+        &tester.testing_channel,
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Encoding: x-double\r\n"
+        "Content-Length: 20\r\n"
+        "\r\n"
+        "aabbccddeef"));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    ASSERT_BIN_ARRAYS_EQUALS("abcde", 5, stream_tester.response_body.buffer, stream_tester.response_body.len);
+    ASSERT_UINT_EQUALS(89, aws_h1_connection_window_stats(tester.connection).stream_window);
+
+    /* The window is updated by decoded bytes, and grows by the encoded bytes they came from */
+    aws_http_stream_update_window(stream_tester.stream, 5);
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    ASSERT_UINT_EQUALS(100, aws_h1_connection_window_stats(tester.connection).stream_window);
+
+    ASSERT_SUCCESS(testing_channel_push_read_str(&tester.testing_channel, "fgghhiijj"));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    ASSERT_TRUE(stream_tester.complete);
+    ASSERT_INT_EQUALS(AWS_ERROR_SUCCESS, stream_tester.on_complete_error_code);
+    ASSERT_BIN_ARRAYS_EQUALS("abcdefghij", 10, stream_tester.response_body.buffer, stream_tester.response_body.len);
+
+    client_stream_tester_clean_up(&stream_tester);
+    aws_http_message_destroy(request);
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
+H1_CLIENT_TEST_CASE(h1_client_response_content_decoding_unsupported) {
+    (void)ctx;
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init(&tester, allocator));
+
+    struct aws_http_content_decoding_options decoding_options = {
+        .new_decoder = s_double_decoder_new,
+    };
+    struct aws_http_message *request = s_new_default_get_request(allocator);
+    struct client_stream_tester stream_tester;
+    struct client_stream_tester_options stream_tester_opts = {
+        .request = request,
+        .connection = tester.connection,
+        .content_decoding = &decoding_options,
+    };
+    ASSERT_SUCCESS(client_stream_tester_init(&stream_tester, allocator, &stream_tester_opts));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    ASSERT_SUCCESS(testing_channel_push_read_str(
+        &tester.testing_channel,
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Encoding: gzip\r\n"
+        "Content-Length: 4\r\n"
+        "\r\n"
+        "data"));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    ASSERT_TRUE(stream_tester.complete);
+    ASSERT_INT_EQUALS(AWS_ERROR_HTTP_UNSUPPORTED_CONTENT_ENCODING, stream_tester.on_complete_error_code);
+
+    client_stream_tester_clean_up(&stream_tester);
+    aws_http_message_destroy(request);
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
+/* Test encoder for the "x-double" content-coding */
+static int s_double_encoder_encode(
+    struct aws_http_content_encoder *encoder,
+    struct aws_byte_cursor *unencoded,
+    bool is_end,
+    struct aws_byte_buf *encoded,
+    bool *out_is_complete) {
+    (void)encoder;
+    while (unencoded->len > 0 && encoded->capacity - encoded->len >= 2) {
+        aws_byte_buf_write_u8(encoded, unencoded->ptr[0]);
+        aws_byte_buf_write_u8(encoded, unencoded->ptr[0]);
+        aws_byte_cursor_advance(unencoded, 1);
+    }
+    *out_is_complete = is_end && unencoded->len == 0;
+    return AWS_OP_SUCCESS;
+}
+
+static void s_double_encoder_destroy(struct aws_http_content_encoder *encoder) {
+    aws_mem_release(encoder->allocator, encoder);
+}
+
+static struct aws_http_content_encoder_vtable s_double_encoder_vtable = {
+    .encode = s_double_encoder_encode,
+    .destroy = s_double_encoder_destroy,
+};
+
+static struct aws_http_content_encoder *s_double_encoder_new(
+    struct aws_allocator *allocator,
+    struct aws_byte_cursor content_coding,
+    void *user_data) {
+    (void)content_coding;
+    (void)user_data;
+    struct aws_http_content_encoder *encoder = aws_mem_calloc(allocator, 1, sizeof(struct aws_http_content_encoder));
+    encoder->vtable = &s_double_encoder_vtable;
+    encoder->allocator = allocator;
+    return encoder;
+}
+
+H1_CLIENT_TEST_CASE(h1_client_request_content_encoding) {
+    (void)ctx;
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init(&tester, allocator));
+
+    static const struct aws_byte_cursor body = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("abcde");
+    struct aws_input_stream *body_stream = aws_input_stream_new_from_cursor(allocator, &body);
+
+    struct aws_http_header headers[] = {
+        {
+            .name = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("Content-Length"),
+            .value = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("5"),
+        },
+    };
+
+    struct aws_http_message *request = aws_http_message_new_request(allocator);
+    ASSERT_NOT_NULL(request);
+    ASSERT_SUCCESS(aws_http_message_set_request_method(request, aws_byte_cursor_from_c_str("PUT")));
+    ASSERT_SUCCESS(aws_http_message_set_request_path(request, aws_byte_cursor_from_c_str("/plan.txt")));
+    aws_http_message_add_header_array(request, headers, AWS_ARRAY_SIZE(headers));
+    aws_http_message_set_body_stream(request, body_stream);
+
+    /* A small buffer, so the body is read in several passes */
+    struct aws_http_content_encoding_options encoding_options = {
+        .content_coding = aws_byte_cursor_from_c_str("x-double"),
+        .new_encoder = s_double_encoder_new,
+        .unencoded_buffer_size = 2,
+    };
+    struct aws_http_make_request_options opt = {
+        .self_size = sizeof(opt),
+        .request = request,
+        .content_encoding = &encoding_options,
+    };
+    struct aws_http_stream *stream = aws_http_connection_make_request(tester.connection, &opt);
+    ASSERT_NOT_NULL(stream);
+    aws_http_stream_activate(stream);
+
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    /* The encoded length isn't known, so the body is sent chunked */
+    const char *expected = "PUT /plan.txt HTTP/1.1\r\n"
+                           "Content-Encoding: x-double\r\n"
+                           "Transfer-Encoding: chunked\r\n"
+                           "\r\n"
+                           "0000000A\r\n"
+                           "aabbccddee\r\n"
+                           "0\r\n"
+                           "\r\n";
+    ASSERT_SUCCESS(testing_channel_check_written_messages_str(&tester.testing_channel, allocator, expected));
+
+    /* The user's request isn't modified */
+    ASSERT_UINT_EQUALS(1, aws_http_message_get_header_count(request));
+
+    /* clean up */
+    aws_input_stream_release(body_stream);
+    aws_http_message_destroy(request);
+    aws_http_stream_release(stream);
+
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
+/* With bulk_body_passthrough, reads within the body go straight to the stream,
+ * and the connection window is only incremented once half of it is used, or the body ends */
+H1_CLIENT_TEST_CASE(h1_client_bulk_body_passthrough) {
+    (void)ctx;
+
+    struct tester_options tester_opts = {
+        .manual_window_management = true,
+        .initial_stream_window_size = 1000,
+        .read_buffer_capacity = 100,
+        .bulk_body_passthrough = true,
+    };
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init_ex(&tester, allocator, &tester_opts));
+
+    struct aws_http_message *request = s_new_default_get_request(allocator);
+    struct client_stream_tester stream_tester;
+    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, &tester, request));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    /* The 40 byte head is decoded as usual, and the window is incremented right away */
+    ASSERT_SUCCESS(testing_channel_push_read_str(
+        &tester.testing_channel,
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length: 100\r\n"
+        "\r\n"));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    struct aws_h1_window_stats window_stats = aws_h1_connection_window_stats(tester.connection);
+    ASSERT_UINT_EQUALS(40, window_stats.recent_window_increments);
+    ASSERT_UINT_EQUALS(100, window_stats.connection_window);
+
+    /* Body arrives 10 bytes at a time. The window isn't incremented while at least half of it is left */
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_SUCCESS(testing_channel_push_read_str(&tester.testing_channel, "0123456789"));
+        testing_channel_drain_queued_tasks(&tester.testing_channel);
+    }
+    ASSERT_UINT_EQUALS(50, stream_tester.response_body.len);
+
+    window_stats = aws_h1_connection_window_stats(tester.connection);
+    ASSERT_UINT_EQUALS(0, window_stats.recent_window_increments);
+    ASSERT_UINT_EQUALS(50, window_stats.connection_window);
+    ASSERT_UINT_EQUALS(0, window_stats.buffer_pending_bytes);
+    ASSERT_UINT_EQUALS(950, window_stats.stream_window);
+
+    /* Now it's below half, so it's topped up all at once */
+    ASSERT_SUCCESS(testing_channel_push_read_str(&tester.testing_channel, "0123456789"));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    window_stats = aws_h1_connection_window_stats(tester.connection);
+    ASSERT_UINT_EQUALS(60, window_stats.recent_window_increments);
+    ASSERT_UINT_EQUALS(100, window_stats.connection_window);
+
+    /* The read that ends the body completes the stream, and the window is incremented after it */
+    ASSERT_SUCCESS(testing_channel_push_read_str(&tester.testing_channel, "0123456789012345678901234567890123456789"));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    ASSERT_TRUE(stream_tester.complete);
+    ASSERT_SUCCESS(stream_tester.on_complete_error_code);
+    ASSERT_INT_EQUALS(200, stream_tester.response_status);
+    ASSERT_UINT_EQUALS(100, stream_tester.response_body.len);
+
+    window_stats = aws_h1_connection_window_stats(tester.connection);
+    ASSERT_UINT_EQUALS(40, window_stats.recent_window_increments);
+    ASSERT_UINT_EQUALS(100, window_stats.connection_window);
+
+    client_stream_tester_clean_up(&stream_tester);
+    aws_http_message_release(request);
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
+/* Once the connection is warm, a request/response cycle may allocate at most this many times.
+ * That's the stream and the encoded request head, plus a little slack. Nothing per header or per read */
+#define H1_CLIENT_ALLOCATIONS_PER_CYCLE 4
+
+/* Hold request/response cycles to an allocation budget.
+ * Only the connection gets the counting allocator, the test's own requests and testers aren't counted */
+H1_CLIENT_TEST_CASE(h1_client_allocation_budget) {
+    (void)ctx;
+    struct counting_allocator counting;
+    counting_allocator_init(&counting, allocator);
+
+    struct tester_options tester_opts = {
+        .connection_alloc = &counting.base,
+    };
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init_ex(&tester, allocator, &tester_opts));
+
+    struct aws_http_message *request = s_new_default_get_request(allocator);
+
+    /* Enough headers that allocating per header would blow the budget */
+    const char *response_str = "HTTP/1.1 200 OK\r\n"
+                               "Date: Fri, 01 Mar 2019 17:18:55 GMT\r\n"
+                               "Server: AmazonS3\r\n"
+                               "Content-Type: text/plain\r\n"
+                               "Cache-Control: no-cache\r\n"
+                               "ETag: \"3e25960a79dbc69b674cd4ec67a72c62\"\r\n"
+                               "x-amz-request-id: 0A49CE4060975EAC\r\n"
+                               "Content-Length: 9\r\n"
+                               "\r\n"
+                               "Call Momo";
+
+    enum { WARMUP_CYCLES = 4, MEASURED_CYCLES = 100 };
+    size_t num_allocations_before = 0;
+    for (size_t i = 0; i < WARMUP_CYCLES + MEASURED_CYCLES; ++i) {
+        if (i == WARMUP_CYCLES) {
+            num_allocations_before = counting.num_allocations;
+        }
+
+        struct client_stream_tester stream_tester;
+        ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, &tester, request));
+        testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+        ASSERT_SUCCESS(testing_channel_push_read_str(&tester.testing_channel, response_str));
+        testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+        ASSERT_TRUE(stream_tester.complete);
+        ASSERT_SUCCESS(stream_tester.on_complete_error_code);
+        ASSERT_TRUE(aws_byte_buf_eq_c_str(&stream_tester.response_body, "Call Momo"));
+        client_stream_tester_clean_up(&stream_tester);
+    }
+
+    ASSERT_SUCCESS(counting_allocator_check_budget(
+        &counting, "cycle", num_allocations_before, MEASURED_CYCLES, H1_CLIENT_ALLOCATIONS_PER_CYCLE));
+
+    aws_http_message_release(request);
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
 /* This tests the specific way that HTTP/1 manages its connection window. */
 H1_CLIENT_TEST_CASE(h1_client_connection_window_with_buffer) {
     (void)ctx;
@@ -3105,6 +4492,78 @@ H1_CLIENT_TEST_CASE(h1_client_connection_window_with_small_buffer) {
     return AWS_OP_SUCCESS;
 }
 
+/* Test that read buffer grows when the window limits throughput, and shrinks when connection goes idle */
+H1_CLIENT_TEST_CASE(h1_client_connection_window_auto_sizes_buffer) {
+    (void)ctx;
+
+    struct tester_options tester_opts = {
+        .manual_window_management = true,
+        .initial_stream_window_size = 1024 * 1024,
+        .read_buffer_capacity = 100,
+        .max_read_buffer_capacity = 400,
+    };
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init_ex(&tester, allocator, &tester_opts));
+
+    struct aws_http_message *request = s_new_default_get_request(allocator);
+    struct client_stream_tester stream_tester;
+    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, &tester, request));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    struct aws_h1_window_stats window_stats = aws_h1_connection_window_stats(tester.connection);
+    ASSERT_UINT_EQUALS(100, window_stats.buffer_capacity);
+    ASSERT_UINT_EQUALS(400, window_stats.buffer_max_capacity);
+    ASSERT_UINT_EQUALS(100, window_stats.connection_window);
+
+    /* 41 byte head + 1000 byte body */
+    struct aws_byte_buf response_buf;
+    ASSERT_SUCCESS(aws_byte_buf_init(&response_buf, allocator, 1041));
+    ASSERT_TRUE(aws_byte_buf_write_from_whole_cursor(
+        &response_buf,
+        aws_byte_cursor_from_c_str("HTTP/1.1 200 OK\r\n"
+                                   "Content-Length: 1000\r\n"
+                                   "\r\n")));
+    ASSERT_UINT_EQUALS(41, response_buf.len);
+    ASSERT_TRUE(aws_byte_buf_write_u8_n(&response_buf, 'z', 1000));
+    struct aws_byte_cursor response_cursor = aws_byte_cursor_from_buf(&response_buf);
+
+    /* Each time the whole window is used up, and the stream keeps up, the buffer should double (up to max) */
+    const size_t expected_capacities[] = {200, 400, 400};
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(expected_capacities); ++i) {
+        struct aws_byte_cursor fill_window = aws_byte_cursor_advance(&response_cursor, window_stats.connection_window);
+        ASSERT_SUCCESS(testing_channel_push_read_data(&tester.testing_channel, fill_window));
+        testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+        window_stats = aws_h1_connection_window_stats(tester.connection);
+        ASSERT_UINT_EQUALS(expected_capacities[i], window_stats.buffer_capacity);
+        ASSERT_UINT_EQUALS(0, window_stats.buffer_pending_bytes);
+        ASSERT_UINT_EQUALS(expected_capacities[i], window_stats.connection_window);
+    }
+
+    /* Send the rest, which doesn't fill the window. Once the stream is done, the idle connection's buffer shrinks */
+    ASSERT_UINT_EQUALS(341, response_cursor.len);
+    ASSERT_SUCCESS(testing_channel_push_read_data(&tester.testing_channel, response_cursor));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    ASSERT_TRUE(stream_tester.complete);
+    ASSERT_SUCCESS(stream_tester.on_complete_error_code);
+    ASSERT_UINT_EQUALS(1000, stream_tester.response_body.len);
+
+    window_stats = aws_h1_connection_window_stats(tester.connection);
+    ASSERT_FALSE(window_stats.has_incoming_stream);
+    ASSERT_UINT_EQUALS(200, window_stats.buffer_capacity);
+    ASSERT_UINT_EQUALS(0, window_stats.buffer_pending_bytes);
+    ASSERT_UINT_EQUALS(200, window_stats.connection_window);
+    ASSERT_UINT_EQUALS(141, window_stats.recent_window_increments);
+
+    /* clean up */
+    aws_byte_buf_clean_up(&response_buf);
+    client_stream_tester_clean_up(&stream_tester);
+    aws_http_message_release(request);
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
 static void s_on_complete(struct aws_http_stream *stream, int error_code, void *user_data) {
     (void)stream;
     int *completion_error_code = user_data;
@@ -6,11 +6,14 @@
 #include <aws/http/private/h1_decoder.h>
 
 #include <aws/common/array_list.h>
+#include <aws/common/hash_table.h>
+#include <aws/http/private/http_impl.h>
 #include <aws/io/logging.h>
 #include <aws/testing/aws_test_harness.h>
 
 #include <ctype.h>
 #include <stdio.h>
+#include <string.h>
 
 static const struct aws_byte_cursor s_typical_request = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("GET / HTTP/1.1\r\n"
                                                                                               "Host: amazon.com\r\n"
@@ -849,3 +852,353 @@ static int s_h1_test_ignore_chunk_extensions(struct aws_allocator *allocator, vo
     s_test_clean_up();
     return AWS_OP_SUCCESS;
 }
+
+struct s_header_value_check {
+    struct aws_byte_cursor expected_value;
+    int header_count;
+    int first_error;
+};
+
+static int s_check_header_value(const struct aws_h1_decoded_header *header, void *user_data) {
+    struct s_header_value_check *check = (struct s_header_value_check *)user_data;
+    if (check->first_error == AWS_OP_SUCCESS && !aws_byte_cursor_eq(&header->value_data, &check->expected_value)) {
+        check->first_error = AWS_OP_ERR;
+    }
+    check->header_count++;
+    return AWS_OP_SUCCESS;
+}
+
+/* Move the CRLF of a header line across every position within a 16 byte block, and split the message
+ * at every position too, so the CRLF scan sees "\r" and "\n" on either side of vector and chunk boundaries. */
+AWS_TEST_CASE(h1_decode_crlf_at_every_offset, s_h1_decode_crlf_at_every_offset);
+static int s_h1_decode_crlf_at_every_offset(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+    s_test_init(allocator);
+
+    char value[64];
+    char msg_str[128];
+    for (size_t value_len = 1; value_len < 48; ++value_len) {
+        for (size_t i = 0; i < value_len; ++i) {
+            value[i] = (char)('a' + (i % 26));
+        }
+        value[value_len] = '\0';
+        int msg_len = snprintf(msg_str, sizeof(msg_str), "HTTP/1.1 200 OK\r\nX: %s\r\n\r\n", value);
+        ASSERT_TRUE(msg_len > 0 && (size_t)msg_len < sizeof(msg_str));
+
+        for (size_t split = 0; split < (size_t)msg_len; ++split) {
+            struct s_header_value_check check = {
+                .expected_value = aws_byte_cursor_from_array(value, value_len),
+            };
+
+            struct aws_h1_decoder_params params;
+            s_common_decoder_setup(allocator, 1024, &params, s_response, &check);
+            params.vtable.on_header = s_check_header_value;
+            struct aws_h1_decoder *decoder = aws_h1_decoder_new(&params);
+
+            struct aws_byte_cursor msg = aws_byte_cursor_from_array(msg_str, (size_t)msg_len);
+            struct aws_byte_cursor first = aws_byte_cursor_advance(&msg, split);
+            ASSERT_SUCCESS(aws_h1_decode(decoder, &first));
+            ASSERT_SUCCESS(aws_h1_decode(decoder, &msg));
+
+            ASSERT_INT_EQUALS(1, check.header_count);
+            ASSERT_SUCCESS(check.first_error);
+
+            aws_h1_decoder_destroy(decoder);
+        }
+    }
+
+    s_test_clean_up();
+    return AWS_OP_SUCCESS;
+}
+
+/* Headers typical of responses passing through a proxy in front of S3 */
+static const struct aws_byte_cursor s_header_heavy_response = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL(
+    "HTTP/1.1 200 OK\r\n"
+    "x-amz-id-2: kPBf8ED41a5+zvKRxzS9hFDh1LM5JxGP4sQAyWlwTHgbq9JayMSj6XoG4d/s8UGesbQ07uC6ZZE=\r\n"
+    "x-amz-request-id: 4B5B4C7A6C4FE422\r\n"
+    "Date: Wed, 21 Oct 2015 07:28:00 GMT\r\n"
+    "Last-Modified: Tue, 20 Oct 2015 19:03:56 GMT\r\n"
+    "ETag: \"fba9dede5f27731c9771645a39863328\"\r\n"
+    "x-amz-server-side-encryption: AES256\r\n"
+    "x-amz-version-id: 3HL4kqtJlcpXroDTDmJ+rmSpXd3dIbrHY+MTRCxf3vjVBH40Nr8X8gdRQBpUMLUo\r\n"
+    "x-amz-storage-class: STANDARD_IA\r\n"
+    "x-amz-meta-user-supplied-checksum: 9b2cf535f27731c974343645a3985328\r\n"
+    "Accept-Ranges: bytes\r\n"
+    "Content-Type: application/octet-stream\r\n"
+    "Cache-Control: private, max-age=0, no-cache, no-store, must-revalidate\r\n"
+    "Access-Control-Allow-Origin: https://console.example.com\r\n"
+    "Access-Control-Expose-Headers: ETag, x-amz-request-id, x-amz-id-2, x-amz-version-id\r\n"
+    "Strict-Transport-Security: max-age=31536000; includeSubDomains\r\n"
+    "Via: 1.1 3b2605f4c1d8b8ea2bd2c9b0a07f2c4e.cloudfront.net (CloudFront)\r\n"
+    "X-Cache: Miss from cloudfront\r\n"
+    "Server: AmazonS3\r\n"
+    "Content-Length: 0\r\n"
+    "\r\n");
+
+/* Length of the "HTTP/1.1 200 OK\r\n" status line that starts s_header_heavy_response */
+#define HEADER_HEAVY_STATUS_LINE_LEN 17
+
+struct s_header_lines_check {
+    /* Header lines of the current message not yet seen by on_header */
+    struct aws_byte_cursor remaining;
+    int header_count;
+    int done_count;
+    int first_error;
+};
+
+static void s_header_lines_check_reset(struct s_header_lines_check *check) {
+    check->remaining = s_header_heavy_response;
+    aws_byte_cursor_advance(&check->remaining, HEADER_HEAVY_STATUS_LINE_LEN);
+}
+
+/* Each header must match the next "name: value" line of the message */
+static int s_check_header_line(const struct aws_h1_decoded_header *header, void *user_data) {
+    struct s_header_lines_check *check = (struct s_header_lines_check *)user_data;
+    check->header_count++;
+
+    struct aws_byte_cursor crlf = aws_byte_cursor_from_c_str("\r\n");
+    struct aws_byte_cursor found;
+    if (aws_byte_cursor_find_exact(&check->remaining, &crlf, &found)) {
+        check->first_error = AWS_OP_ERR;
+        return AWS_OP_SUCCESS;
+    }
+    size_t line_len = (size_t)(found.ptr - check->remaining.ptr);
+    struct aws_byte_cursor line = aws_byte_cursor_advance(&check->remaining, line_len);
+    aws_byte_cursor_advance(&check->remaining, crlf.len);
+
+    struct aws_byte_cursor name = aws_byte_cursor_advance(&line, header->name_data.len);
+    struct aws_byte_cursor separator = aws_byte_cursor_advance(&line, 2);
+    if (!aws_byte_cursor_eq(&name, &header->name_data) || !aws_byte_cursor_eq_c_str(&separator, ": ") ||
+        !aws_byte_cursor_eq(&line, &header->value_data)) {
+        check->first_error = AWS_OP_ERR;
+    }
+    return AWS_OP_SUCCESS;
+}
+
+static int s_on_header_lines_done(void *user_data) {
+    struct s_header_lines_check *check = (struct s_header_lines_check *)user_data;
+    check->done_count++;
+    s_header_lines_check_reset(check);
+    return AWS_OP_SUCCESS;
+}
+
+/* Decode header-heavy responses back to back, both as whole messages and in small reads that leave
+ * partial lines in scratch_space, and check every header comes out intact. */
+AWS_TEST_CASE(h1_decode_header_heavy_responses, s_h1_decode_header_heavy_responses);
+static int s_h1_decode_header_heavy_responses(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+    s_test_init(allocator);
+
+    const int message_count = 100;
+    const int headers_per_message = 19;
+    const size_t read_sizes[] = {SIZE_MAX, 64, 1};
+
+    for (size_t r = 0; r < AWS_ARRAY_SIZE(read_sizes); ++r) {
+        struct s_header_lines_check check;
+        AWS_ZERO_STRUCT(check);
+        s_header_lines_check_reset(&check);
+
+        struct aws_h1_decoder_params params;
+        s_common_decoder_setup(allocator, 1024, &params, s_response, &check);
+        params.vtable.on_header = s_check_header_line;
+        params.vtable.on_done = s_on_header_lines_done;
+        struct aws_h1_decoder *decoder = aws_h1_decoder_new(&params);
+
+        for (int i = 0; i < message_count; ++i) {
+            struct aws_byte_cursor msg = s_header_heavy_response;
+            while (msg.len > 0) {
+                struct aws_byte_cursor chunk = aws_byte_cursor_advance(&msg, aws_min_size(read_sizes[r], msg.len));
+                ASSERT_SUCCESS(aws_h1_decode(decoder, &chunk));
+            }
+        }
+
+        ASSERT_SUCCESS(check.first_error);
+        ASSERT_INT_EQUALS(message_count, check.done_count);
+        ASSERT_INT_EQUALS(message_count * headers_per_message, check.header_count);
+
+        aws_h1_decoder_destroy(decoder);
+    }
+
+    s_test_clean_up();
+    return AWS_OP_SUCCESS;
+}
+
+static const struct {
+    const char *str;
+    enum aws_http_header_name name;
+} s_known_header_names[] = {
+    {":method", AWS_HTTP_HEADER_METHOD},
+    {":scheme", AWS_HTTP_HEADER_SCHEME},
+    {":authority", AWS_HTTP_HEADER_AUTHORITY},
+    {":path", AWS_HTTP_HEADER_PATH},
+    {":status", AWS_HTTP_HEADER_STATUS},
+    {"connection", AWS_HTTP_HEADER_CONNECTION},
+    {"content-length", AWS_HTTP_HEADER_CONTENT_LENGTH},
+    {"expect", AWS_HTTP_HEADER_EXPECT},
+    {"transfer-encoding", AWS_HTTP_HEADER_TRANSFER_ENCODING},
+    {"cookie", AWS_HTTP_HEADER_COOKIE},
+    {"set-cookie", AWS_HTTP_HEADER_SET_COOKIE},
+    {"host", AWS_HTTP_HEADER_HOST},
+    {"cache-control", AWS_HTTP_HEADER_CACHE_CONTROL},
+    {"max-forwards", AWS_HTTP_HEADER_MAX_FORWARDS},
+    {"pragma", AWS_HTTP_HEADER_PRAGMA},
+    {"range", AWS_HTTP_HEADER_RANGE},
+    {"te", AWS_HTTP_HEADER_TE},
+    {"content-encoding", AWS_HTTP_HEADER_CONTENT_ENCODING},
+    {"content-type", AWS_HTTP_HEADER_CONTENT_TYPE},
+    {"content-range", AWS_HTTP_HEADER_CONTENT_RANGE},
+    {"trailer", AWS_HTTP_HEADER_TRAILER},
+    {"www-authenticate", AWS_HTTP_HEADER_WWW_AUTHENTICATE},
+    {"authorization", AWS_HTTP_HEADER_AUTHORIZATION},
+    {"proxy-authenticate", AWS_HTTP_HEADER_PROXY_AUTHENTICATE},
+    {"proxy-authorization", AWS_HTTP_HEADER_PROXY_AUTHORIZATION},
+    {"age", AWS_HTTP_HEADER_AGE},
+    {"expires", AWS_HTTP_HEADER_EXPIRES},
+    {"date", AWS_HTTP_HEADER_DATE},
+    {"location", AWS_HTTP_HEADER_LOCATION},
+    {"retry-after", AWS_HTTP_HEADER_RETRY_AFTER},
+    {"vary", AWS_HTTP_HEADER_VARY},
+    {"warning", AWS_HTTP_HEADER_WARNING},
+    {"upgrade", AWS_HTTP_HEADER_UPGRADE},
+    {"keep-alive", AWS_HTTP_HEADER_KEEP_ALIVE},
+    {"proxy-connection", AWS_HTTP_HEADER_PROXY_CONNECTION},
+};
+
+AWS_TEST_CASE(h1_decode_header_name_lookup, s_h1_decode_header_name_lookup);
+static int s_h1_decode_header_name_lookup(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+    s_test_init(allocator);
+
+    ASSERT_UINT_EQUALS(AWS_HTTP_HEADER_COUNT - 1, AWS_ARRAY_SIZE(s_known_header_names));
+
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(s_known_header_names); ++i) {
+        char buf[32];
+        size_t len = strlen(s_known_header_names[i].str);
+        memcpy(buf, s_known_header_names[i].str, len);
+        struct aws_byte_cursor name = aws_byte_cursor_from_array(buf, len);
+
+        ASSERT_INT_EQUALS(s_known_header_names[i].name, aws_http_str_to_header_name(name));
+        ASSERT_INT_EQUALS(s_known_header_names[i].name, aws_http_lowercase_str_to_header_name(name));
+
+        /* Alternate case on every letter */
+        bool has_letter = false;
+        for (size_t j = 0; j < len; ++j) {
+            if (j % 2 == 0 && isalpha((unsigned char)buf[j])) {
+                buf[j] = (char)toupper((unsigned char)buf[j]);
+                has_letter = true;
+            }
+        }
+        ASSERT_INT_EQUALS(s_known_header_names[i].name, aws_http_str_to_header_name(name));
+        if (has_letter) {
+            ASSERT_INT_EQUALS(AWS_HTTP_HEADER_UNKNOWN, aws_http_lowercase_str_to_header_name(name));
+        }
+
+        /* Prefixes are not matches */
+        struct aws_byte_cursor prefix = aws_byte_cursor_from_array(buf, len - 1);
+        ASSERT_INT_EQUALS(AWS_HTTP_HEADER_UNKNOWN, aws_http_str_to_header_name(prefix));
+
+        /* Changing any single byte to a non-letter breaks the match, even where case-folding would alias it */
+        for (size_t j = 0; j < len; ++j) {
+            char original = buf[j];
+            buf[j] = (original == '-') ? '\r' : '\x01';
+            ASSERT_INT_EQUALS(AWS_HTTP_HEADER_UNKNOWN, aws_http_str_to_header_name(name));
+            buf[j] = original;
+        }
+    }
+
+    const char *unknown[] = {
+        "",
+        "x-amz-request-id",
+        "contentlength",
+        "content_length",
+        "this-header-name-is-too-long-to-know",
+    };
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(unknown); ++i) {
+        ASSERT_INT_EQUALS(AWS_HTTP_HEADER_UNKNOWN, aws_http_str_to_header_name(aws_byte_cursor_from_c_str(unknown[i])));
+    }
+
+    s_test_clean_up();
+    return AWS_OP_SUCCESS;
+}
+
+AWS_TEST_CASE(h1_decode_method_lookup, s_h1_decode_method_lookup);
+static int s_h1_decode_method_lookup(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+    s_test_init(allocator);
+
+    ASSERT_INT_EQUALS(AWS_HTTP_METHOD_GET, aws_http_str_to_method(aws_byte_cursor_from_c_str("GET")));
+    ASSERT_INT_EQUALS(AWS_HTTP_METHOD_HEAD, aws_http_str_to_method(aws_byte_cursor_from_c_str("HEAD")));
+    ASSERT_INT_EQUALS(AWS_HTTP_METHOD_CONNECT, aws_http_str_to_method(aws_byte_cursor_from_c_str("CONNECT")));
+
+    /* Methods are case-sensitive, and only the ones that affect processing are known */
+    const char *unknown[] = {
+        "",
+        "get",
+        "Head",
+        "GETS",
+        "POST",
+        "OPTIONS",
+    };
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(unknown); ++i) {
+        ASSERT_INT_EQUALS(AWS_HTTP_METHOD_UNKNOWN, aws_http_str_to_method(aws_byte_cursor_from_c_str(unknown[i])));
+    }
+
+    s_test_clean_up();
+    return AWS_OP_SUCCESS;
+}
+
+/* Header name classification must agree with the ignore-case hash lookup it replaced */
+AWS_TEST_CASE(h1_decode_header_name_lookup_matches_hash_table, s_h1_decode_header_name_lookup_matches_hash_table);
+static int s_h1_decode_header_name_lookup_matches_hash_table(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+    s_test_init(allocator);
+
+    /* Names as they arrive on the wire: a mix of known names in canonical case, and unknown names */
+    const char *wire_names[] = {
+        "Content-Type",
+        "Content-Length",
+        "Connection",
+        "Date",
+        "x-amz-id-2",
+        "x-amz-request-id",
+        "ETag",
+        "Accept-Ranges",
+        "Cache-Control",
+        "Transfer-Encoding",
+        "Via",
+        "X-Cache",
+        "Server",
+        "Last-Modified",
+    };
+    struct aws_byte_cursor names[AWS_ARRAY_SIZE(wire_names)];
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(wire_names); ++i) {
+        names[i] = aws_byte_cursor_from_c_str(wire_names[i]);
+    }
+
+    struct aws_hash_table reference;
+    ASSERT_SUCCESS(aws_hash_table_init(
+        &reference,
+        allocator,
+        AWS_ARRAY_SIZE(s_known_header_names),
+        aws_hash_byte_cursor_ptr_ignore_case,
+        (aws_hash_callback_eq_fn *)aws_byte_cursor_eq_ignore_case,
+        NULL,
+        NULL));
+    struct aws_byte_cursor keys[AWS_ARRAY_SIZE(s_known_header_names)];
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(s_known_header_names); ++i) {
+        keys[i] = aws_byte_cursor_from_c_str(s_known_header_names[i].str);
+        ASSERT_SUCCESS(aws_hash_table_put(&reference, &keys[i], (void *)(size_t)s_known_header_names[i].name, NULL));
+    }
+
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(names); ++i) {
+        struct aws_hash_element *elem = NULL;
+        ASSERT_SUCCESS(aws_hash_table_find(&reference, &names[i], &elem));
+        enum aws_http_header_name expected =
+            elem ? (enum aws_http_header_name)(size_t)elem->value : AWS_HTTP_HEADER_UNKNOWN;
+        ASSERT_INT_EQUALS(expected, aws_http_str_to_header_name(names[i]));
+    }
+
+    aws_hash_table_clean_up(&reference);
+    s_test_clean_up();
+    return AWS_OP_SUCCESS;
+}
@@ -564,3 +564,231 @@ H1_ENCODER_TEST_CASE(h1_encoder_rejects_bad_header_value) {
         AWS_ARRAY_SIZE(headers) /*header_count*/,
         AWS_ERROR_HTTP_INVALID_HEADER_VALUE /*expected_error*/);
 }
+
+static int s_encode_request_head(
+    struct aws_allocator *allocator,
+    const struct aws_http_message *request,
+    const struct aws_http1_request_template *request_template,
+    struct aws_byte_buf *out_head) {
+
+    struct aws_linked_list chunk_list;
+    aws_linked_list_init(&chunk_list);
+
+    struct aws_h1_encoder_message encoder_message;
+    ASSERT_SUCCESS(aws_h1_encoder_message_init_from_request_template(
+        &encoder_message, allocator, request, request_template, &chunk_list));
+
+    ASSERT_SUCCESS(aws_byte_buf_init_copy(out_head, allocator, &encoder_message.outgoing_head_buf));
+    aws_h1_encoder_message_clean_up(&encoder_message);
+    return AWS_OP_SUCCESS;
+}
+
+H1_ENCODER_TEST_CASE(h1_encoder_request_template) {
+    (void)ctx;
+    s_test_init(allocator);
+
+    const struct aws_http_header shared_headers[] = {
+        {
+            .name = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("Host"),
+            .value = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("amazon.com"),
+        },
+        {
+            .name = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("Connection"),
+            .value = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("close"),
+        },
+    };
+    const struct aws_http_header own_headers[] = {
+        {
+            .name = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("Range"),
+            .value = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("bytes=0-99"),
+        },
+    };
+
+    /* Template carries the method and shared headers */
+    struct aws_http_message *template_source = aws_http_message_new_request(allocator);
+    ASSERT_SUCCESS(aws_http_message_set_request_method(template_source, aws_byte_cursor_from_c_str("GET")));
+    ASSERT_SUCCESS(aws_http_message_add_header_array(template_source, shared_headers, AWS_ARRAY_SIZE(shared_headers)));
+    struct aws_http1_request_template *request_template =
+        aws_http1_request_template_new(allocator, template_source);
+    ASSERT_NOT_NULL(request_template);
+    aws_http_message_destroy(template_source);
+
+    /* Request made with the template only carries its path and own headers */
+    struct aws_http_message *request = aws_http_message_new_request(allocator);
+    ASSERT_SUCCESS(aws_http_message_set_request_path(request, aws_byte_cursor_from_c_str("/index.html")));
+    ASSERT_SUCCESS(aws_http_message_add_header_array(request, own_headers, AWS_ARRAY_SIZE(own_headers)));
+
+    /* The same request, made without a template */
+    struct aws_http_message *full_request = aws_http_message_new_request(allocator);
+    ASSERT_SUCCESS(aws_http_message_set_request_method(full_request, aws_byte_cursor_from_c_str("GET")));
+    ASSERT_SUCCESS(aws_http_message_set_request_path(full_request, aws_byte_cursor_from_c_str("/index.html")));
+    ASSERT_SUCCESS(aws_http_message_add_header_array(full_request, shared_headers, AWS_ARRAY_SIZE(shared_headers)));
+    ASSERT_SUCCESS(aws_http_message_add_header_array(full_request, own_headers, AWS_ARRAY_SIZE(own_headers)));
+
+    struct aws_byte_buf template_head;
+    ASSERT_SUCCESS(s_encode_request_head(allocator, request, request_template, &template_head));
+    struct aws_byte_buf full_head;
+    ASSERT_SUCCESS(s_encode_request_head(allocator, full_request, NULL /*request_template*/, &full_head));
+    ASSERT_BIN_ARRAYS_EQUALS(full_head.buffer, full_head.len, template_head.buffer, template_head.len);
+
+    /* Template's "Connection: close" is noticed */
+    struct aws_linked_list chunk_list;
+    aws_linked_list_init(&chunk_list);
+    struct aws_h1_encoder_message encoder_message;
+    ASSERT_SUCCESS(aws_h1_encoder_message_init_from_request_template(
+        &encoder_message, allocator, request, request_template, &chunk_list));
+    ASSERT_TRUE(encoder_message.has_connection_close_header);
+    aws_h1_encoder_message_clean_up(&encoder_message);
+
+    /* Setting the same method as the template is fine, a different method is an error */
+    struct aws_byte_buf same_method_head;
+    ASSERT_SUCCESS(aws_http_message_set_request_method(request, aws_byte_cursor_from_c_str("GET")));
+    ASSERT_SUCCESS(s_encode_request_head(allocator, request, request_template, &same_method_head));
+    ASSERT_BIN_ARRAYS_EQUALS(full_head.buffer, full_head.len, same_method_head.buffer, same_method_head.len);
+
+    ASSERT_SUCCESS(aws_http_message_set_request_method(request, aws_byte_cursor_from_c_str("PUT")));
+    ASSERT_ERROR(
+        AWS_ERROR_HTTP_INVALID_METHOD,
+        aws_h1_encoder_message_init_from_request_template(
+            &encoder_message, allocator, request, request_template, &chunk_list));
+
+    aws_byte_buf_clean_up(&same_method_head);
+    aws_byte_buf_clean_up(&full_head);
+    aws_byte_buf_clean_up(&template_head);
+    aws_http_message_destroy(full_request);
+    aws_http_message_destroy(request);
+    aws_http1_request_template_destroy(request_template);
+    s_test_clean_up();
+    return AWS_OP_SUCCESS;
+}
+
+static int s_test_bad_request_template(
+    struct aws_allocator *allocator,
+    const char *method,
+    const struct aws_http_header *header_array,
+    size_t header_count,
+    int expected_error) {
+
+    s_test_init(allocator);
+
+    struct aws_http_message *request = aws_http_message_new_request(allocator);
+    ASSERT_NOT_NULL(request);
+    if (method) {
+        ASSERT_SUCCESS(aws_http_message_set_request_method(request, aws_byte_cursor_from_c_str(method)));
+    }
+    if (header_array) {
+        ASSERT_SUCCESS(aws_http_message_add_header_array(request, header_array, header_count));
+    }
+
+    ASSERT_NULL(aws_http1_request_template_new(allocator, request));
+    ASSERT_INT_EQUALS(expected_error, aws_last_error());
+
+    aws_http_message_destroy(request);
+    s_test_clean_up();
+    return AWS_OP_SUCCESS;
+}
+
+H1_ENCODER_TEST_CASE(h1_encoder_request_template_rejects_missing_method) {
+    (void)ctx;
+    return s_test_bad_request_template(
+        allocator,
+        NULL /*method*/,
+        s_typical_request_headers /*header_array*/,
+        AWS_ARRAY_SIZE(s_typical_request_headers) /*header_count*/,
+        AWS_ERROR_HTTP_INVALID_METHOD /*expected_error*/);
+}
+
+H1_ENCODER_TEST_CASE(h1_encoder_request_template_rejects_bad_header_value) {
+    (void)ctx;
+    const struct aws_http_header headers[] = {
+        {
+            .name = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("X-Line-Folds-Are-Bad-Mkay"),
+            .value = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("item1,\r\n item2"),
+        },
+    };
+
+    return s_test_bad_request_template(
+        allocator,
+        "GET" /*method*/,
+        headers /*header_array*/,
+        AWS_ARRAY_SIZE(headers) /*header_count*/,
+        AWS_ERROR_HTTP_INVALID_HEADER_VALUE /*expected_error*/);
+}
+
+H1_ENCODER_TEST_CASE(h1_encoder_request_template_rejects_body_headers) {
+    (void)ctx;
+    const struct aws_http_header headers[] = {
+        {
+            .name = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("Host"),
+            .value = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("amazon.com"),
+        },
+        {
+            .name = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("Content-Length"),
+            .value = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("16"),
+        },
+    };
+
+    return s_test_bad_request_template(
+        allocator,
+        "PUT" /*method*/,
+        headers /*header_array*/,
+        AWS_ARRAY_SIZE(headers) /*header_count*/,
+        AWS_ERROR_HTTP_INVALID_HEADER_FIELD /*expected_error*/);
+}
+
+H1_ENCODER_TEST_CASE(h1_encoder_chunk_pool_reuses_chunks) {
+    (void)ctx;
+    s_test_init(allocator);
+
+    struct aws_h1_chunk_pool pool;
+    ASSERT_SUCCESS(aws_h1_chunk_pool_init(&pool, allocator, 1 /*max_free_count*/));
+
+    static const struct aws_byte_cursor body = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("write more tests");
+    struct aws_input_stream *body_stream = aws_input_stream_new_from_cursor(allocator, &body);
+    struct aws_http1_chunk_options options = {
+        .chunk_data = body_stream,
+        .chunk_data_size = body.len,
+    };
+
+    /* Destroyed chunk is reused, with its chunk-line rewritten */
+    struct aws_h1_chunk *chunk_a = aws_h1_chunk_new_from_pool(&pool, &options);
+    ASSERT_NOT_NULL(chunk_a);
+    ASSERT_PTR_EQUALS(&pool, chunk_a->pool);
+    ASSERT_BIN_ARRAYS_EQUALS("10\r\n", 4, chunk_a->chunk_line.buffer, chunk_a->chunk_line.len);
+    aws_h1_chunk_destroy(chunk_a);
+    ASSERT_UINT_EQUALS(1, pool.free_count);
+
+    options.chunk_data_size = 5;
+    struct aws_h1_chunk *chunk_b = aws_h1_chunk_new_from_pool(&pool, &options);
+    ASSERT_PTR_EQUALS(chunk_a, chunk_b);
+    ASSERT_UINT_EQUALS(0, pool.free_count);
+    ASSERT_UINT_EQUALS(5, chunk_b->data_size);
+    ASSERT_BIN_ARRAYS_EQUALS("5\r\n", 3, chunk_b->chunk_line.buffer, chunk_b->chunk_line.len);
+
+    /* Pool doesn't hold more than max_free_count */
+    struct aws_h1_chunk *chunk_c = aws_h1_chunk_new_from_pool(&pool, &options);
+    ASSERT_NOT_NULL(chunk_c);
+    aws_h1_chunk_destroy(chunk_b);
+    aws_h1_chunk_destroy(chunk_c);
+    ASSERT_UINT_EQUALS(1, pool.free_count);
+
+    /* Chunk-line too long to pool */
+    char long_key[AWS_H1_POOLED_CHUNK_LINE_SIZE];
+    memset(long_key, 'k', sizeof(long_key));
+    struct aws_http1_chunk_extension extension = {
+        .key = aws_byte_cursor_from_array(long_key, sizeof(long_key)),
+        .value = aws_byte_cursor_from_c_str("v"),
+    };
+    options.extensions = &extension;
+    options.num_extensions = 1;
+    struct aws_h1_chunk *chunk_d = aws_h1_chunk_new_from_pool(&pool, &options);
+    ASSERT_NOT_NULL(chunk_d);
+    ASSERT_NULL(chunk_d->pool);
+    aws_h1_chunk_destroy(chunk_d);
+    ASSERT_UINT_EQUALS(1, pool.free_count);
+
+    aws_input_stream_release(body_stream);
+    aws_h1_chunk_pool_clean_up(&pool);
+    s_test_clean_up();
+    return AWS_OP_SUCCESS;
+}
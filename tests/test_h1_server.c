@@ -11,7 +11,9 @@
 
 #include <aws/common/clock.h>
 #include <aws/common/condition_variable.h>
+#include <aws/common/file.h>
 #include <aws/common/log_writer.h>
+#include <aws/common/thread.h>
 #include <aws/common/uuid.h>
 #include <aws/io/channel_bootstrap.h>
 #include <aws/io/logging.h>
@@ -622,6 +624,106 @@ TEST_CASE(h1_server_send_304_response) {
     return AWS_OP_SUCCESS;
 }
 
+/* One static response serves many requests, and only its head is sent for HEAD requests */
+TEST_CASE(h1_server_send_static_response) {
+    (void)ctx;
+    ASSERT_SUCCESS(s_tester_init(allocator));
+
+    struct aws_byte_cursor body_src = aws_byte_cursor_from_c_str("healthy");
+    struct aws_input_stream *body = aws_input_stream_new_from_cursor(allocator, &body_src);
+    ASSERT_NOT_NULL(body);
+    struct aws_http_header headers[] = {
+        {
+            .name = aws_byte_cursor_from_c_str("Content-Length"),
+            .value = aws_byte_cursor_from_c_str("7"),
+        },
+    };
+    struct aws_http_message *response;
+    ASSERT_SUCCESS(s_create_response(&response, 200, headers, AWS_ARRAY_SIZE(headers), body));
+    struct aws_http1_static_response *static_response = aws_http1_static_response_new(allocator, response);
+    ASSERT_NOT_NULL(static_response);
+
+    /* The source response isn't needed once the static response exists */
+    aws_http_message_destroy(response);
+    aws_input_stream_release(body);
+
+    const char *incoming_request = "GET /health HTTP/1.1\r\n"
+                                   "\r\n"
+                                   "HEAD /health HTTP/1.1\r\n"
+                                   "\r\n"
+                                   "GET /health HTTP/1.1\r\n"
+                                   "\r\n";
+    ASSERT_SUCCESS(s_send_message_c_str(incoming_request));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_INT_EQUALS(3, s_tester.request_num);
+
+    for (int i = 0; i < s_tester.request_num; ++i) {
+        ASSERT_SUCCESS(aws_http1_stream_send_static_response(s_tester.requests[i].request_handler, static_response));
+    }
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+    const char *expected = "HTTP/1.1 200 OK\r\n"
+                           "Content-Length: 7\r\n"
+                           "\r\n"
+                           "healthy"
+                           "HTTP/1.1 200 OK\r\n"
+                           "Content-Length: 7\r\n"
+                           "\r\n"
+                           "HTTP/1.1 200 OK\r\n"
+                           "Content-Length: 7\r\n"
+                           "\r\n"
+                           "healthy";
+    ASSERT_SUCCESS(testing_channel_check_written_messages_str(&s_tester.testing_channel, allocator, expected));
+
+    /* A stream only gets one response */
+    ASSERT_FAILS(aws_http1_stream_send_static_response(s_tester.requests[0].request_handler, static_response));
+
+    for (int i = 0; i < s_tester.request_num; ++i) {
+        ASSERT_UINT_EQUALS(1, s_tester.requests[i].on_complete_cb_count);
+        ASSERT_INT_EQUALS(AWS_ERROR_SUCCESS, s_tester.requests[i].on_complete_error_code);
+    }
+
+    ASSERT_SUCCESS(s_server_tester_clean_up());
+    aws_http1_static_response_destroy(static_response);
+    return AWS_OP_SUCCESS;
+}
+
+/* The body is captured up front, so it must have a known length */
+TEST_CASE(h1_server_static_response_rejects_bad_body) {
+    (void)ctx;
+    ASSERT_SUCCESS(s_tester_init(allocator));
+
+    struct aws_http_header chunked_headers[] = {
+        {
+            .name = aws_byte_cursor_from_c_str("Transfer-Encoding"),
+            .value = aws_byte_cursor_from_c_str("chunked"),
+        },
+    };
+    struct aws_http_message *response;
+    ASSERT_SUCCESS(s_create_response(&response, 200, chunked_headers, AWS_ARRAY_SIZE(chunked_headers), NULL));
+    ASSERT_NULL(aws_http1_static_response_new(allocator, response));
+    ASSERT_INT_EQUALS(AWS_ERROR_HTTP_INVALID_HEADER_FIELD, aws_last_error());
+    aws_http_message_destroy(response);
+
+    /* Body is shorter than Content-Length */
+    struct aws_byte_cursor body_src = aws_byte_cursor_from_c_str("short");
+    struct aws_input_stream *body = aws_input_stream_new_from_cursor(allocator, &body_src);
+    struct aws_http_header length_headers[] = {
+        {
+            .name = aws_byte_cursor_from_c_str("Content-Length"),
+            .value = aws_byte_cursor_from_c_str("100"),
+        },
+    };
+    ASSERT_SUCCESS(s_create_response(&response, 200, length_headers, AWS_ARRAY_SIZE(length_headers), body));
+    ASSERT_NULL(aws_http1_static_response_new(allocator, response));
+    ASSERT_INT_EQUALS(AWS_ERROR_HTTP_OUTGOING_STREAM_LENGTH_INCORRECT, aws_last_error());
+    aws_http_message_destroy(response);
+    aws_input_stream_release(body);
+
+    ASSERT_SUCCESS(s_server_tester_clean_up());
+    return AWS_OP_SUCCESS;
+}
+
 TEST_CASE(h1_server_send_multiple_responses_in_order) {
 
     (void)ctx;
@@ -950,6 +1052,12 @@ static int s_check_multiple_messages(struct tester *tester, struct aws_byte_curs
         struct aws_byte_cursor compare_cur = aws_byte_cursor_from_array(expected.ptr + progress, comparing);
         ASSERT_TRUE(aws_byte_cursor_eq_byte_buf(&compare_cur, &msg->message_data));
 
+        /* If writes aren't completing immediately, complete this one now that its data has been checked */
+        if (msg->on_completion) {
+            msg->on_completion(tester->testing_channel.channel, msg, AWS_ERROR_SUCCESS, msg->user_data);
+            msg->on_completion = NULL;
+        }
+
         aws_mem_release(msg->allocator, msg);
 
         progress += comparing;
@@ -1030,6 +1138,88 @@ TEST_CASE(h1_server_send_response_large_body) {
     return AWS_OP_SUCCESS;
 }
 
+/* Send part of a file as the response body, via aws_http_body_stream_new_from_file() */
+TEST_CASE(h1_server_send_response_file_body) {
+
+    (void)ctx;
+    ASSERT_SUCCESS(s_tester_init(allocator));
+
+    const char *incoming_request = "GET / HTTP/1.1\r\n"
+                                   "\r\n";
+    ASSERT_SUCCESS(s_send_message_c_str(incoming_request));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+    ASSERT_TRUE(s_tester.request_num == 1);
+
+    struct tester_request *request = s_tester.requests;
+
+    /* write a file a bit over 2MB, so the body spans several mapped segments */
+    const char *file_path = "h1_server_send_response_file_body.tmp";
+    size_t file_len = 1024 * 1024 * 2 + 4096;
+    struct aws_byte_buf file_buf;
+    ASSERT_SUCCESS(aws_byte_buf_init(&file_buf, allocator, file_len));
+    while (file_buf.len < file_len) {
+        int r = rand();
+        aws_byte_buf_write_be32(&file_buf, (uint32_t)r);
+    }
+
+    FILE *file = aws_fopen(file_path, "wb");
+    ASSERT_NOT_NULL(file);
+    ASSERT_UINT_EQUALS(file_len, fwrite(file_buf.buffer, 1, file_len, file));
+    ASSERT_INT_EQUALS(0, fclose(file));
+
+    /* range past the end of the file is rejected */
+    ASSERT_NULL(aws_http_body_stream_new_from_file(allocator, file_path, 1, file_len));
+    ASSERT_INT_EQUALS(AWS_ERROR_INVALID_ARGUMENT, aws_last_error());
+
+    /* send a range that doesn't start on a page boundary */
+    size_t body_offset = 1000;
+    size_t body_len = file_len - 3000;
+    request->response_body = aws_http_body_stream_new_from_file(allocator, file_path, body_offset, body_len);
+    ASSERT_NOT_NULL(request->response_body);
+
+    /* The mapping is released as each write completes, so don't complete writes until their data is checked */
+    testing_channel_complete_written_messages_immediately(&s_tester.testing_channel, false, AWS_ERROR_SUCCESS);
+
+    char content_length_value[100];
+    snprintf(content_length_value, sizeof(content_length_value), "%zu", body_len);
+
+    struct aws_http_header headers[] = {
+        {
+            .name = aws_byte_cursor_from_c_str("Content-Length"),
+            .value = aws_byte_cursor_from_c_str(content_length_value),
+        },
+    };
+
+    struct aws_http_message *response;
+    ASSERT_SUCCESS(s_create_response(&response, 200, headers, AWS_ARRAY_SIZE(headers), request->response_body));
+    ASSERT_SUCCESS(aws_http_stream_send_response(request->request_handler, response));
+
+    const char *expected_head_fmt = "HTTP/1.1 200 OK\r\n"
+                                    "Content-Length: %zu\r\n"
+                                    "\r\n";
+
+    char expected_head[1024];
+    int expected_head_len = snprintf(expected_head, sizeof(expected_head), expected_head_fmt, body_len);
+
+    struct aws_byte_buf expected_buf;
+    ASSERT_SUCCESS(aws_byte_buf_init(&expected_buf, allocator, body_len + expected_head_len));
+    ASSERT_TRUE(aws_byte_buf_write(&expected_buf, (uint8_t *)expected_head, expected_head_len));
+    ASSERT_TRUE(aws_byte_buf_write(&expected_buf, file_buf.buffer + body_offset, body_len));
+
+    size_t num_io_messages;
+    ASSERT_SUCCESS(s_check_multiple_messages(&s_tester, aws_byte_cursor_from_buf(&expected_buf), &num_io_messages));
+
+    ASSERT_TRUE(num_io_messages > 1);
+
+    ASSERT_SUCCESS(s_server_tester_clean_up());
+    aws_http_message_destroy(response);
+    aws_byte_buf_clean_up(&file_buf);
+    aws_byte_buf_clean_up(&expected_buf);
+    ASSERT_INT_EQUALS(0, remove(file_path));
+    return AWS_OP_SUCCESS;
+}
+
 /* Send a response whose headers doesn't fit in a single aws_io_message */
 TEST_CASE(h1_server_send_response_large_head) {
 
@@ -1697,3 +1887,83 @@ TEST_CASE(h1_server_close_from_on_thread_makes_not_open) {
     ASSERT_SUCCESS(s_server_tester_clean_up());
     return AWS_OP_SUCCESS;
 }
+
+static int s_timeout_shutdown_error_code;
+
+static void s_on_timeout_channel_shutdown(int error_code, void *user_data) {
+    (void)user_data;
+    s_timeout_shutdown_error_code = error_code;
+}
+
+static int s_start_server_timeouts(uint64_t idle_timeout_ms, uint64_t header_read_timeout_ms) {
+    s_timeout_shutdown_error_code = AWS_ERROR_SUCCESS;
+    s_tester.testing_channel.channel_shutdown = s_on_timeout_channel_shutdown;
+    ASSERT_SUCCESS(aws_http_connection_start_server_timeouts(
+        s_tester.server_connection,
+        aws_timestamp_convert(idle_timeout_ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL),
+        aws_timestamp_convert(header_read_timeout_ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL)));
+    return AWS_OP_SUCCESS;
+}
+
+static void s_sleep_ms(uint64_t ms) {
+    aws_thread_current_sleep(aws_timestamp_convert(ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+}
+
+/* The idle timer is paused while a request is being handled, and starts over once the response is done */
+TEST_CASE(h1_server_idle_timeout) {
+    (void)ctx;
+    ASSERT_SUCCESS(s_tester_init(allocator));
+    ASSERT_SUCCESS(s_start_server_timeouts(200 /*idle_timeout_ms*/, 0 /*header_read_timeout_ms*/));
+
+    ASSERT_SUCCESS(s_send_message_c_str("GET / HTTP/1.1\r\n\r\n"));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_INT_EQUALS(1, s_tester.request_num);
+
+    /* Handler takes its time, that's fine */
+    s_sleep_ms(400);
+    ASSERT_TRUE(aws_http_connection_is_open(s_tester.server_connection));
+
+    struct aws_http_message *response;
+    ASSERT_SUCCESS(s_create_response(&response, 204, NULL, 0, NULL));
+    ASSERT_SUCCESS(aws_http_stream_send_response(s_tester.requests[0].request_handler, response));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_TRUE(aws_http_connection_is_open(s_tester.server_connection));
+
+    /* Now the connection is idle */
+    s_sleep_ms(400);
+    ASSERT_FALSE(aws_http_connection_is_open(s_tester.server_connection));
+    ASSERT_TRUE(testing_channel_is_shutdown_completed(&s_tester.testing_channel));
+    ASSERT_INT_EQUALS(AWS_ERROR_HTTP_SERVER_CONNECTION_TIMEOUT, s_timeout_shutdown_error_code);
+
+    aws_http_message_destroy(response);
+    ASSERT_SUCCESS(s_server_tester_clean_up());
+    return AWS_OP_SUCCESS;
+}
+
+/* A request head that trickles in doesn't get to hold the connection open */
+TEST_CASE(h1_server_header_read_timeout) {
+    (void)ctx;
+    ASSERT_SUCCESS(s_tester_init(allocator));
+    ASSERT_SUCCESS(s_start_server_timeouts(0 /*idle_timeout_ms*/, 200 /*header_read_timeout_ms*/));
+
+    /* No idle timeout, so a quiet connection stays open */
+    s_sleep_ms(400);
+    ASSERT_TRUE(aws_http_connection_is_open(s_tester.server_connection));
+
+    ASSERT_SUCCESS(s_send_message_c_str("GET / HTTP/1.1\r\n"));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    s_sleep_ms(100);
+
+    /* More of the head arriving doesn't restart the clock */
+    ASSERT_SUCCESS(s_send_message_c_str("Host: example.com\r\n"));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    s_sleep_ms(300);
+
+    ASSERT_FALSE(aws_http_connection_is_open(s_tester.server_connection));
+    ASSERT_TRUE(testing_channel_is_shutdown_completed(&s_tester.testing_channel));
+    ASSERT_INT_EQUALS(AWS_ERROR_HTTP_SERVER_CONNECTION_TIMEOUT, s_timeout_shutdown_error_code);
+
+    ASSERT_SUCCESS(s_server_tester_clean_up());
+    return AWS_OP_SUCCESS;
+}
@@ -3,9 +3,13 @@
  * SPDX-License-Identifier: Apache-2.0.
  */
 
+#include "alloc_test_helper.h"
 #include "h2_test_helper.h"
 #include "stream_test_helper.h"
+#include <aws/common/clock.h>
+#include <aws/common/thread.h>
 #include <aws/http/private/h2_connection.h>
+#include <aws/http/private/h2_decoder.h>
 #include <aws/http/private/request_response_impl.h>
 #include <aws/http/request_response.h>
 #include <aws/io/stream.h>
@@ -79,6 +83,15 @@ static struct tester {
     struct connection_user_data user_data;
 
     bool no_conn_manual_win_management;
+    uint32_t write_coalescing_delay_us;
+    size_t max_write_messages_in_flight;
+    uint32_t stream_window_auto_tuning_max_size;
+    bool deliver_whole_header_blocks;
+    uint32_t header_table_adaptive_min_size;
+    uint32_t header_table_adaptive_max_size;
+    uint32_t bulk_data_max_frame_size;
+    /* If set, the connection uses this allocator instead of the tester's */
+    struct aws_allocator *connection_alloc;
 } s_tester;
 
 static int s_tester_init(struct aws_allocator *alloc, void *ctx) {
@@ -103,10 +116,19 @@ static int s_tester_init(struct aws_allocator *alloc, void *ctx) {
         .on_goaway_received = s_on_goaway_received,
         .on_remote_settings_change = s_on_remote_settings_change,
         .conn_manual_window_management = !s_tester.no_conn_manual_win_management,
-    };
-
-    s_tester.connection =
-        aws_http_connection_new_http2_client(alloc, false /* manual window management */, &http2_options);
+        .write_coalescing_delay_us = s_tester.write_coalescing_delay_us,
+        .max_write_messages_in_flight = s_tester.max_write_messages_in_flight,
+        .stream_window_auto_tuning_max_size = s_tester.stream_window_auto_tuning_max_size,
+        .deliver_whole_header_blocks = s_tester.deliver_whole_header_blocks,
+        .header_table_adaptive_min_size = s_tester.header_table_adaptive_min_size,
+        .header_table_adaptive_max_size = s_tester.header_table_adaptive_max_size,
+        .bulk_data_max_frame_size = s_tester.bulk_data_max_frame_size,
+    };
+
+    s_tester.connection = aws_http_connection_new_http2_client(
+        s_tester.connection_alloc ? s_tester.connection_alloc : alloc,
+        false /* manual window management */,
+        &http2_options);
     ASSERT_NOT_NULL(s_tester.connection);
 
     {
@@ -471,6 +493,18 @@ TEST_CASE(h2_client_stream_complete) {
         stream_tester.metrics.sending_duration_ns ==
         stream_tester.metrics.send_end_timestamp_ns - stream_tester.metrics.send_start_timestamp_ns);
     ASSERT_TRUE(stream_tester.metrics.stream_id == stream_tester.stream->id);
+    ASSERT_TRUE(stream_tester.metrics.activate_timestamp_ns > 0);
+    ASSERT_TRUE(stream_tester.metrics.activate_timestamp_ns <= stream_tester.metrics.send_start_timestamp_ns);
+    ASSERT_TRUE(
+        stream_tester.metrics.receive_headers_end_timestamp_ns >= stream_tester.metrics.receive_start_timestamp_ns);
+    ASSERT_TRUE(
+        stream_tester.metrics.receive_headers_end_timestamp_ns <= stream_tester.metrics.receive_end_timestamp_ns);
+    ASSERT_TRUE(stream_tester.metrics.connection_acquisition_wait_ns == -1);
+
+    struct aws_http_stream_metrics metrics;
+    aws_http_stream_get_metrics(stream_tester.stream, &metrics);
+    ASSERT_INT_EQUALS(stream_tester.metrics.activate_timestamp_ns, metrics.activate_timestamp_ns);
+    ASSERT_INT_EQUALS(stream_tester.metrics.receive_end_timestamp_ns, metrics.receive_end_timestamp_ns);
 
     ASSERT_TRUE(aws_http_connection_is_open(s_tester.connection));
 
@@ -481,6 +515,194 @@ TEST_CASE(h2_client_stream_complete) {
     return s_tester_clean_up();
 }
 
+/* Check that memory usage is reported, and added to a tracker's totals until the connection is destroyed */
+TEST_CASE(h2_client_memory_usage) {
+    ASSERT_SUCCESS(s_tester_init(allocator, ctx));
+
+    struct aws_http_connection_memory_tracker *tracker =
+        aws_http_connection_memory_tracker_new(allocator, 0 /*read_window_budget*/);
+    aws_http_connection_set_memory_tracker(s_tester.connection, tracker);
+
+    /* the connection preface went out before the tracker was set, it must count anyway */
+    struct aws_http_connection_memory_usage usage;
+    struct aws_http_connection_memory_usage totals;
+    aws_http_connection_get_memory_usage(s_tester.connection, &usage);
+    aws_http_connection_memory_tracker_get_usage(tracker, &totals);
+    ASSERT_TRUE(usage.decoder_scratch > 0);
+    ASSERT_TRUE(usage.hpack_tables > 0);
+    ASSERT_UINT_EQUALS(usage.decoder_scratch, totals.decoder_scratch);
+    ASSERT_UINT_EQUALS(usage.hpack_tables, totals.hpack_tables);
+
+    ASSERT_SUCCESS(h2_fake_peer_send_connection_preface_default_settings(&s_tester.peer));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+    struct aws_http_message *request = aws_http2_message_new_request(allocator);
+    ASSERT_NOT_NULL(request);
+    struct aws_http_header request_headers_src[] = {
+        DEFINE_HEADER(":method", "GET"),
+        DEFINE_HEADER(":scheme", "https"),
+        DEFINE_HEADER(":path", "/"),
+    };
+    aws_http_message_add_header_array(request, request_headers_src, AWS_ARRAY_SIZE(request_headers_src));
+
+    struct client_stream_tester stream_tester;
+    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, request));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+    struct aws_http_header response_headers_src[] = {
+        DEFINE_HEADER(":status", "200"),
+        DEFINE_HEADER("date", "Wed, 01 Apr 2020 23:02:49 GMT"),
+    };
+    struct aws_http_headers *response_headers = aws_http_headers_new(allocator);
+    aws_http_headers_add_array(response_headers, response_headers_src, AWS_ARRAY_SIZE(response_headers_src));
+    struct aws_h2_frame *response_frame = aws_h2_frame_new_headers(
+        allocator, aws_http_stream_get_id(stream_tester.stream), response_headers, true /*end_stream*/, 0, NULL);
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&s_tester.peer, response_frame));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_TRUE(stream_tester.complete);
+
+    /* everything has been written, HTTP/2 never holds unconsumed reads */
+    aws_http_connection_get_memory_usage(s_tester.connection, &usage);
+    aws_http_connection_memory_tracker_get_usage(tracker, &totals);
+    ASSERT_UINT_EQUALS(0, usage.outgoing_queue);
+    ASSERT_UINT_EQUALS(0, usage.unconsumed_reads);
+    ASSERT_UINT_EQUALS(usage.decoder_scratch, totals.decoder_scratch);
+    ASSERT_UINT_EQUALS(usage.frame_cache, totals.frame_cache);
+    ASSERT_UINT_EQUALS(usage.hpack_tables, totals.hpack_tables);
+    ASSERT_UINT_EQUALS(usage.buffered_headers, totals.buffered_headers);
+
+    aws_http_headers_release(response_headers);
+    aws_http_message_release(request);
+    client_stream_tester_clean_up(&stream_tester);
+    ASSERT_SUCCESS(s_tester_clean_up());
+
+    /* The connection took its usage out of the totals as it was destroyed */
+    aws_http_connection_memory_tracker_get_usage(tracker, &totals);
+    ASSERT_UINT_EQUALS(0, totals.decoder_scratch);
+    ASSERT_UINT_EQUALS(0, totals.hpack_tables);
+    ASSERT_UINT_EQUALS(0, totals.outgoing_queue);
+    ASSERT_UINT_EQUALS(0, totals.buffered_headers);
+    ASSERT_UINT_EQUALS(0, totals.frame_cache);
+    aws_http_connection_memory_tracker_release(tracker);
+    return AWS_OP_SUCCESS;
+}
+
+static struct aws_crt_statistics_http2_channel *s_gather_statistics(void) {
+    void *stats_storage[1];
+    struct aws_array_list stats_list;
+    aws_array_list_init_static(&stats_list, stats_storage, 1, sizeof(void *));
+
+    struct aws_channel_handler *handler = &s_tester.connection->channel_handler;
+    handler->vtable->gather_statistics(handler, &stats_list);
+    if (aws_array_list_length(&stats_list) != 1) {
+        return NULL;
+    }
+
+    void *stats_base = NULL;
+    aws_array_list_get_at(&stats_list, &stats_base, 0);
+    return stats_base;
+}
+
+/* Test that frames, bytes, and RST_STREAMs are counted in the connection's statistics */
+TEST_CASE(h2_client_statistics) {
+    ASSERT_SUCCESS(s_tester_init(allocator, ctx));
+
+    /* fake peer sends connection preface */
+    ASSERT_SUCCESS(h2_fake_peer_send_connection_preface_default_settings(&s_tester.peer));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+    struct aws_http_header request_headers_src[] = {
+        DEFINE_HEADER(":method", "GET"),
+        DEFINE_HEADER(":scheme", "https"),
+        DEFINE_HEADER(":path", "/"),
+    };
+    size_t request_header_bytes = 0;
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(request_headers_src); ++i) {
+        request_header_bytes += request_headers_src[i].name.len + request_headers_src[i].value.len;
+    }
+    struct aws_http_message *request = aws_http2_message_new_request(allocator);
+    ASSERT_NOT_NULL(request);
+    aws_http_message_add_header_array(request, request_headers_src, AWS_ARRAY_SIZE(request_headers_src));
+
+    /* 1st stream gets a response with a body */
+    struct client_stream_tester stream_tester;
+    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, request));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    uint32_t stream_id = aws_http_stream_get_id(stream_tester.stream);
+
+    struct aws_http_header response_headers_src[] = {
+        DEFINE_HEADER(":status", "200"),
+    };
+    struct aws_http_headers *response_headers = aws_http_headers_new(allocator);
+    aws_http_headers_add_array(response_headers, response_headers_src, AWS_ARRAY_SIZE(response_headers_src));
+    struct aws_h2_frame *peer_frame =
+        aws_h2_frame_new_headers(allocator, stream_id, response_headers, false /*end_stream*/, 0, NULL);
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&s_tester.peer, peer_frame));
+    ASSERT_SUCCESS(h2_fake_peer_send_data_frame_str(&s_tester.peer, stream_id, "hello", true /*end_stream*/));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_TRUE(stream_tester.complete);
+    ASSERT_INT_EQUALS(AWS_ERROR_SUCCESS, stream_tester.on_complete_error_code);
+    client_stream_tester_clean_up(&stream_tester);
+
+    /* 2nd stream is refused by the peer */
+    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, request));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+    struct aws_crt_statistics_http2_channel *stats = s_gather_statistics();
+    ASSERT_NOT_NULL(stats);
+    ASSERT_UINT_EQUALS(1, stats->active_stream_count);
+
+    peer_frame = aws_h2_frame_new_rst_stream(
+        allocator, aws_http_stream_get_id(stream_tester.stream), AWS_HTTP2_ERR_REFUSED_STREAM);
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&s_tester.peer, peer_frame));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_TRUE(stream_tester.complete);
+    client_stream_tester_clean_up(&stream_tester);
+
+    /* 3rd stream is reset by the client */
+    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, request));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_SUCCESS(aws_http2_stream_reset(stream_tester.stream, AWS_HTTP2_ERR_CANCEL));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_TRUE(stream_tester.complete);
+    client_stream_tester_clean_up(&stream_tester);
+
+    stats = s_gather_statistics();
+    ASSERT_NOT_NULL(stats);
+    ASSERT_UINT_EQUALS(0, stats->active_stream_count);
+
+    ASSERT_UINT_EQUALS(3, stats->frames_sent[AWS_H2_FRAME_T_HEADERS]);
+    ASSERT_UINT_EQUALS(1, stats->frames_sent[AWS_H2_FRAME_T_RST_STREAM]);
+    ASSERT_TRUE(stats->frames_sent[AWS_H2_FRAME_T_SETTINGS] > 0);
+    ASSERT_UINT_EQUALS(0, stats->frames_sent[AWS_H2_FRAME_T_DATA]);
+    ASSERT_UINT_EQUALS(0, stats->data_bytes_sent);
+    ASSERT_UINT_EQUALS(3 * request_header_bytes, stats->header_bytes_sent_uncompressed);
+    ASSERT_TRUE(stats->header_bytes_sent_compressed > 0);
+    ASSERT_UINT_EQUALS(1, stats->rst_streams_sent[AWS_HTTP2_ERR_CANCEL]);
+
+    ASSERT_UINT_EQUALS(1, stats->frames_received[AWS_H2_FRAME_T_HEADERS]);
+    ASSERT_UINT_EQUALS(1, stats->frames_received[AWS_H2_FRAME_T_DATA]);
+    ASSERT_UINT_EQUALS(1, stats->frames_received[AWS_H2_FRAME_T_RST_STREAM]);
+    ASSERT_TRUE(stats->frames_received[AWS_H2_FRAME_T_SETTINGS] > 0);
+    ASSERT_UINT_EQUALS(5, stats->data_bytes_received);
+    ASSERT_UINT_EQUALS(strlen(":status") + strlen("200"), stats->header_bytes_received_uncompressed);
+    ASSERT_TRUE(stats->header_bytes_received_compressed > 0);
+    ASSERT_UINT_EQUALS(1, stats->rst_streams_received[AWS_HTTP2_ERR_REFUSED_STREAM]);
+
+    /* Counters start over once reset */
+    s_tester.connection->channel_handler.vtable->reset_statistics(&s_tester.connection->channel_handler);
+    ASSERT_UINT_EQUALS(0, stats->frames_sent[AWS_H2_FRAME_T_HEADERS]);
+    ASSERT_UINT_EQUALS(0, stats->frames_received[AWS_H2_FRAME_T_DATA]);
+    ASSERT_UINT_EQUALS(0, stats->data_bytes_received);
+    ASSERT_UINT_EQUALS(0, stats->header_bytes_sent_uncompressed);
+    ASSERT_UINT_EQUALS(0, stats->rst_streams_sent[AWS_HTTP2_ERR_CANCEL]);
+
+    /* clean up */
+    aws_http_headers_release(response_headers);
+    aws_http_message_release(request);
+    return s_tester_clean_up();
+}
+
 /* Calling aws_http_connection_close() should cleanly shut down connection */
 TEST_CASE(h2_client_close) {
     ASSERT_SUCCESS(s_tester_init(allocator, ctx));
@@ -1159,6 +1381,80 @@ TEST_CASE(h2_client_stream_receive_trailing_headers) {
     return s_tester_clean_up();
 }
 
+/* With deliver_whole_header_blocks, each header-block reaches the user in a single on_response_headers call */
+TEST_CASE(h2_client_stream_receive_whole_header_blocks) {
+    s_tester.deliver_whole_header_blocks = true;
+    ASSERT_SUCCESS(s_tester_init(allocator, ctx));
+
+    /* fake peer sends connection preface */
+    ASSERT_SUCCESS(h2_fake_peer_send_connection_preface_default_settings(&s_tester.peer));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+    /* send request */
+    struct aws_http_message *request = aws_http2_message_new_request(allocator);
+    ASSERT_NOT_NULL(request);
+
+    struct aws_http_header request_headers_src[] = {
+        DEFINE_HEADER(":method", "GET"),
+        DEFINE_HEADER(":scheme", "https"),
+        DEFINE_HEADER(":path", "/"),
+    };
+    aws_http_message_add_header_array(request, request_headers_src, AWS_ARRAY_SIZE(request_headers_src));
+
+    struct client_stream_tester stream_tester;
+    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, request));
+
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    uint32_t stream_id = aws_http_stream_get_id(stream_tester.stream);
+
+    /* fake peer sends a main-header-block response */
+    struct aws_http_header response_headers_src[] = {
+        DEFINE_HEADER(":status", "200"),
+        DEFINE_HEADER("date", "Wed, 01 Apr 2020 23:02:49 GMT"),
+        DEFINE_HEADER("content-length", "5"),
+        DEFINE_HEADER("content-type", "text/plain"),
+        DEFINE_HEADER("server", "fake-peer"),
+        DEFINE_HEADER("x-custom-header", "custom-value"),
+    };
+
+    struct aws_http_headers *response_headers = aws_http_headers_new(allocator);
+    aws_http_headers_add_array(response_headers, response_headers_src, AWS_ARRAY_SIZE(response_headers_src));
+
+    struct aws_h2_frame *peer_frame =
+        aws_h2_frame_new_headers(allocator, stream_id, response_headers, false /*end_stream*/, 0, NULL);
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&s_tester.peer, peer_frame));
+    ASSERT_SUCCESS(h2_fake_peer_send_data_frame_str(&s_tester.peer, stream_id, "hello", false /*end_stream*/));
+
+    /* fake peer sends a trailing-header-block response */
+    struct aws_http_header response_trailer_src[] = {
+        DEFINE_HEADER("user-agent", "test"),
+        DEFINE_HEADER("x-checksum", "abcdef"),
+    };
+
+    struct aws_http_headers *response_trailer = aws_http_headers_new(allocator);
+    aws_http_headers_add_array(response_trailer, response_trailer_src, AWS_ARRAY_SIZE(response_trailer_src));
+
+    peer_frame = aws_h2_frame_new_headers(allocator, stream_id, response_trailer, true /*end_stream*/, 0, NULL);
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&s_tester.peer, peer_frame));
+
+    /* validate that client received complete response, one callback per header-block */
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_TRUE(stream_tester.complete);
+    ASSERT_INT_EQUALS(AWS_ERROR_SUCCESS, stream_tester.on_complete_error_code);
+    ASSERT_INT_EQUALS(200, stream_tester.response_status);
+    ASSERT_UINT_EQUALS(2, stream_tester.on_headers_count);
+    ASSERT_SUCCESS(s_compare_headers(response_headers, stream_tester.response_headers));
+    ASSERT_SUCCESS(s_compare_headers(response_trailer, stream_tester.response_trailer));
+    ASSERT_BIN_ARRAYS_EQUALS("hello", 5, stream_tester.response_body.buffer, stream_tester.response_body.len);
+
+    /* clean up */
+    aws_http_headers_release(response_headers);
+    aws_http_headers_release(response_trailer);
+    aws_http_message_release(request);
+    client_stream_tester_clean_up(&stream_tester);
+    return s_tester_clean_up();
+}
+
 TEST_CASE(h2_client_stream_err_receive_trailing_before_main) {
     ASSERT_SUCCESS(s_tester_init(allocator, ctx));
 
@@ -1409,6 +1705,66 @@ TEST_CASE(h2_client_conn_err_stream_frames_received_after_removed_from_cache) {
     return s_tester_clean_up();
 }
 
+/* Test that a long-lived stream closing late doesn't push streams that closed earlier out of the cache */
+TEST_CASE(h2_client_stream_closed_streams_evicted_in_close_order) {
+    ASSERT_SUCCESS(s_tester_init(allocator, ctx));
+
+    /* fake peer sends connection preface */
+    ASSERT_SUCCESS(h2_fake_peer_send_connection_preface_default_settings(&s_tester.peer));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+    /* the first stream stays open while enough streams to fill the cache open and close */
+    enum { NUM_STREAMS = AWS_HTTP2_DEFAULT_MAX_CLOSED_STREAMS + 1 };
+    struct aws_http_message *requests[NUM_STREAMS];
+
+    struct aws_http_header request_headers_src[] = {
+        DEFINE_HEADER(":method", "GET"),
+        DEFINE_HEADER(":scheme", "https"),
+        DEFINE_HEADER(":path", "/"),
+    };
+    struct client_stream_tester stream_tester[NUM_STREAMS];
+
+    for (size_t i = 0; i < NUM_STREAMS; i++) {
+        requests[i] = aws_http2_message_new_request(allocator);
+        aws_http_message_add_header_array(requests[i], request_headers_src, AWS_ARRAY_SIZE(request_headers_src));
+        ASSERT_SUCCESS(s_stream_tester_init(&stream_tester[i], requests[i]));
+        testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+        if (i > 0) {
+            struct aws_h2_frame *peer_frame = aws_h2_frame_new_rst_stream(
+                allocator, aws_http_stream_get_id(stream_tester[i].stream), AWS_HTTP2_ERR_ENHANCE_YOUR_CALM);
+            ASSERT_SUCCESS(h2_fake_peer_send_frame(&s_tester.peer, peer_frame));
+            testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+        }
+    }
+
+    /* now the first stream completes */
+    struct aws_http_header response_headers_src[] = {
+        DEFINE_HEADER(":status", "404"),
+    };
+    struct aws_http_headers *response_headers = aws_http_headers_new(allocator);
+    aws_http_headers_add_array(response_headers, response_headers_src, AWS_ARRAY_SIZE(response_headers_src));
+    struct aws_h2_frame *peer_frame = aws_h2_frame_new_headers(
+        allocator, aws_http_stream_get_id(stream_tester[0].stream), response_headers, true /*end_stream*/, 0, NULL);
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&s_tester.peer, peer_frame));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_TRUE(stream_tester[0].complete);
+
+    /* a late frame for the last stream to close before it is still recognized, rather than a connection error */
+    peer_frame =
+        aws_h2_frame_new_window_update(allocator, aws_http_stream_get_id(stream_tester[NUM_STREAMS - 1].stream), 99);
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&s_tester.peer, peer_frame));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_TRUE(aws_http_connection_is_open(s_tester.connection));
+
+    /* clean up */
+    aws_http_headers_release(response_headers);
+    for (size_t i = 0; i < NUM_STREAMS; i++) {
+        aws_http_message_release(requests[i]);
+        client_stream_tester_clean_up(&stream_tester[i]);
+    }
+    return s_tester_clean_up();
+}
+
 /* Test receiving a response with DATA frames */
 TEST_CASE(h2_client_stream_receive_data) {
     ASSERT_SUCCESS(s_tester_init(allocator, ctx));
@@ -1804,31 +2160,642 @@ TEST_CASE(h2_client_stream_send_lots_of_data) {
     return s_tester_clean_up();
 }
 
-/* Test sending a request whose aws_input_stream is not providing body data all at once */
-TEST_CASE(h2_client_stream_send_stalled_data) {
+static int s_stream_tester_init_with_priority(
+    struct client_stream_tester *stream_tester,
+    struct aws_http_message *request,
+    const struct aws_http2_stream_priority *priority) {
+    struct client_stream_tester_options options = {
+        .request = request,
+        .connection = s_tester.connection,
+        .http2_priority = priority,
+    };
+    return client_stream_tester_init(stream_tester, s_tester.alloc, &options);
+}
+
+/* Test that DATA is sent in order of stream priority.
+ * The most urgent stream sends first, even though it was created last.
+ * The least urgent stream waits until the others are done. */
+TEST_CASE(h2_client_stream_send_data_by_priority) {
     ASSERT_SUCCESS(s_tester_init(allocator, ctx));
 
     /* get connection preface and acks out of the way */
     ASSERT_SUCCESS(h2_fake_peer_send_connection_preface_default_settings(&s_tester.peer));
     testing_channel_drain_queued_tasks(&s_tester.testing_channel);
     ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+    const size_t initial_frame_count = h2_decode_tester_frame_count(&s_tester.peer.decode);
 
-    /* get request ready
-     * the body_stream will stall and provide no data when we try to read from it */
-    struct aws_http_message *request = aws_http2_message_new_request(allocator);
-    ASSERT_NOT_NULL(request);
+    /* big body spans multiple aws_io_messages, but fits within the initial flow-control windows */
+    size_t big_body_size = g_aws_channel_max_fragment_size * 2;
+    struct aws_byte_buf big_body_buf;
+    ASSERT_SUCCESS(aws_byte_buf_init(&big_body_buf, allocator, big_body_size));
+    ASSERT_TRUE(aws_byte_buf_write_u8_n(&big_body_buf, (uint8_t)'a', big_body_size));
 
-    struct aws_http_header request_headers_src[] = {
-        DEFINE_HEADER(":method", "POST"),
-        DEFINE_HEADER(":scheme", "https"),
-        DEFINE_HEADER(":path", "/"),
+    enum { NUM_STREAMS = 3 };
+    struct aws_http_header request_headers_src[NUM_STREAMS][4] = {
+        /* default priority */
+        {
+            DEFINE_HEADER(":method", "POST"),
+            DEFINE_HEADER(":scheme", "https"),
+            DEFINE_HEADER(":path", "/a.txt"),
+            DEFINE_HEADER("x-filler", "a"),
+        },
+        /* less urgent, via RFC-9218 header */
+        {
+            DEFINE_HEADER(":method", "POST"),
+            DEFINE_HEADER(":scheme", "https"),
+            DEFINE_HEADER(":path", "/b.txt"),
+            DEFINE_HEADER("priority", "u=5, i"),
+        },
+        /* most urgent, via options (header is overridden) */
+        {
+            DEFINE_HEADER(":method", "POST"),
+            DEFINE_HEADER(":scheme", "https"),
+            DEFINE_HEADER(":path", "/c.txt"),
+            DEFINE_HEADER("priority", "u=7"),
+        },
     };
-    aws_http_message_add_header_array(request, request_headers_src, AWS_ARRAY_SIZE(request_headers_src));
+    struct aws_byte_cursor body_cursors[NUM_STREAMS] = {
+        aws_byte_cursor_from_buf(&big_body_buf),
+        aws_byte_cursor_from_c_str("bbbb"),
+        aws_byte_cursor_from_c_str("cccc"),
+    };
+    struct aws_http2_stream_priority most_urgent = {.urgency = 0, .incremental = false};
+    const struct aws_http2_stream_priority *priorities[NUM_STREAMS] = {NULL, NULL, &most_urgent};
 
-    const char *body_src = "hello";
-    struct aws_byte_cursor body_cursor = aws_byte_cursor_from_c_str(body_src);
-    struct aws_input_stream *request_body = aws_input_stream_new_tester(allocator, body_cursor);
-    aws_input_stream_tester_set_max_bytes_per_read(request_body, 0);
+    struct aws_http_message *requests[NUM_STREAMS];
+    struct aws_input_stream *request_bodies[NUM_STREAMS];
+    struct client_stream_tester stream_testers[NUM_STREAMS];
+    for (size_t i = 0; i < NUM_STREAMS; ++i) {
+        requests[i] = aws_http2_message_new_request(allocator);
+        aws_http_message_add_header_array(requests[i], request_headers_src[i], AWS_ARRAY_SIZE(request_headers_src[i]));
+        request_bodies[i] = aws_input_stream_new_from_cursor(allocator, &body_cursors[i]);
+        ASSERT_NOT_NULL(request_bodies[i]);
+        aws_http_message_set_body_stream(requests[i], request_bodies[i]);
+        ASSERT_SUCCESS(s_stream_tester_init_with_priority(&stream_testers[i], requests[i], priorities[i]));
+    }
+
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+
+    /* find the order in which DATA was sent */
+    uint32_t stream_ids[NUM_STREAMS];
+    for (size_t i = 0; i < NUM_STREAMS; ++i) {
+        stream_ids[i] = aws_http_stream_get_id(stream_testers[i].stream);
+    }
+    const size_t frame_count = h2_decode_tester_frame_count(&s_tester.peer.decode);
+    size_t first_data_i = SIZE_MAX;
+    size_t a_end_stream_i = SIZE_MAX;
+    size_t b_first_data_i = SIZE_MAX;
+    for (size_t i = initial_frame_count; i < frame_count; ++i) {
+        struct h2_decoded_frame *frame = h2_decode_tester_get_frame(&s_tester.peer.decode, i);
+        if (frame->type != AWS_H2_FRAME_T_DATA) {
+            continue;
+        }
+        if (first_data_i == SIZE_MAX) {
+            first_data_i = i;
+        }
+        if (frame->stream_id == stream_ids[0] && frame->end_stream) {
+            a_end_stream_i = i;
+        }
+        if (frame->stream_id == stream_ids[1] && b_first_data_i == SIZE_MAX) {
+            b_first_data_i = i;
+        }
+    }
+
+    /* most urgent stream went first, and sent everything at once */
+    struct h2_decoded_frame *first_data_frame = h2_decode_tester_get_frame(&s_tester.peer.decode, first_data_i);
+    ASSERT_UINT_EQUALS(stream_ids[2], first_data_frame->stream_id);
+    ASSERT_TRUE(first_data_frame->end_stream);
+
+    /* least urgent stream didn't start until default-priority stream was done */
+    ASSERT_TRUE(a_end_stream_i != SIZE_MAX);
+    ASSERT_TRUE(b_first_data_i != SIZE_MAX);
+    ASSERT_TRUE(a_end_stream_i < b_first_data_i);
+
+    /* validate that all data sent successfully */
+    for (size_t i = 0; i < NUM_STREAMS; ++i) {
+        ASSERT_SUCCESS(h2_decode_tester_check_data_across_frames(
+            &s_tester.peer.decode, stream_ids[i], body_cursors[i], true /*expect_end_frame*/));
+    }
+
+    /* clean up */
+    for (size_t i = 0; i < NUM_STREAMS; ++i) {
+        client_stream_tester_clean_up(&stream_testers[i]);
+        aws_http_message_release(requests[i]);
+        aws_input_stream_release(request_bodies[i]);
+    }
+    aws_byte_buf_clean_up(&big_body_buf);
+    return s_tester_clean_up();
+}
+
+/* Sleep past the write coalescing delay, then run any tasks that became due */
+static void s_drain_tasks_after_coalescing_delay(void) {
+    aws_thread_current_sleep(
+        aws_timestamp_convert(s_tester.write_coalescing_delay_us, AWS_TIMESTAMP_MICROS, AWS_TIMESTAMP_NANOS, NULL));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+}
+
+static size_t s_written_message_count(void) {
+    struct aws_linked_list *written_msgs = testing_channel_get_written_message_queue(&s_tester.testing_channel);
+    size_t count = 0;
+    for (struct aws_linked_list_node *node = aws_linked_list_begin(written_msgs);
+         node != aws_linked_list_end(written_msgs);
+         node = aws_linked_list_next(node)) {
+        ++count;
+    }
+    return count;
+}
+
+/* Send a big urgent body while many other streams wait their turn.
+ * Waiting streams stay in their priority buckets, so the urgent body must go out in full before any of theirs. */
+TEST_CASE(h2_client_stream_send_data_urgent_among_waiting) {
+    ASSERT_SUCCESS(s_tester_init(allocator, ctx));
+
+    /* open the flow-control windows all the way, so only scheduling limits how fast DATA goes out */
+    struct aws_http2_setting settings_array[] = {
+        {.id = AWS_HTTP2_SETTINGS_INITIAL_WINDOW_SIZE, .value = AWS_H2_WINDOW_UPDATE_MAX},
+    };
+    struct aws_h2_frame *settings =
+        aws_h2_frame_new_settings(allocator, settings_array, AWS_ARRAY_SIZE(settings_array), false /*ack*/);
+    ASSERT_NOT_NULL(settings);
+    ASSERT_SUCCESS(h2_fake_peer_send_connection_preface(&s_tester.peer, settings));
+    struct aws_h2_frame *window_update =
+        aws_h2_frame_new_window_update(allocator, 0 /*stream_id*/, AWS_H2_WINDOW_UPDATE_MAX - AWS_H2_INIT_WINDOW_SIZE);
+    ASSERT_NOT_NULL(window_update);
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&s_tester.peer, window_update));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+
+    enum { NUM_STREAMS = 101 };
+    struct aws_http_header request_headers_src[] = {
+        DEFINE_HEADER(":method", "POST"),
+        DEFINE_HEADER(":scheme", "https"),
+        DEFINE_HEADER(":path", "/"),
+    };
+
+    /* the first stream is most urgent and has a body spanning many aws_io_messages, the rest have 1 byte each */
+    const size_t big_body_size = g_aws_channel_max_fragment_size * 64;
+    struct aws_byte_buf big_body_buf;
+    ASSERT_SUCCESS(aws_byte_buf_init(&big_body_buf, allocator, big_body_size));
+    ASSERT_TRUE(aws_byte_buf_write_u8_n(&big_body_buf, (uint8_t)'a', big_body_size));
+    struct aws_http2_stream_priority most_urgent = {.urgency = 0, .incremental = false};
+
+    struct aws_http_message **requests = aws_mem_calloc(allocator, NUM_STREAMS, sizeof(struct aws_http_message *));
+    struct aws_input_stream **request_bodies =
+        aws_mem_calloc(allocator, NUM_STREAMS, sizeof(struct aws_input_stream *));
+    struct client_stream_tester *stream_testers =
+        aws_mem_calloc(allocator, NUM_STREAMS, sizeof(struct client_stream_tester));
+    for (size_t i = 0; i < NUM_STREAMS; ++i) {
+        requests[i] = aws_http2_message_new_request(allocator);
+        aws_http_message_add_header_array(requests[i], request_headers_src, AWS_ARRAY_SIZE(request_headers_src));
+        struct aws_byte_cursor body_cursor =
+            i == 0 ? aws_byte_cursor_from_buf(&big_body_buf) : aws_byte_cursor_from_c_str("z");
+        request_bodies[i] = aws_input_stream_new_from_cursor(allocator, &body_cursor);
+        ASSERT_NOT_NULL(request_bodies[i]);
+        aws_http_message_set_body_stream(requests[i], request_bodies[i]);
+        ASSERT_SUCCESS(
+            s_stream_tester_init_with_priority(&stream_testers[i], requests[i], i == 0 ? &most_urgent : NULL));
+    }
+
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+    /* validate that all data sent successfully */
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+    uint32_t urgent_stream_id = aws_http_stream_get_id(stream_testers[0].stream);
+    ASSERT_SUCCESS(h2_decode_tester_check_data_across_frames(
+        &s_tester.peer.decode, urgent_stream_id, aws_byte_cursor_from_buf(&big_body_buf), true /*expect_end_frame*/));
+
+    /* the urgent body finished before any waiting stream sent its DATA */
+    size_t urgent_end_idx = 0;
+    struct h2_decoded_frame *frame = NULL;
+    size_t search_idx = 0;
+    while ((frame = h2_decode_tester_find_stream_frame(
+                &s_tester.peer.decode, AWS_H2_FRAME_T_DATA, urgent_stream_id, search_idx, &urgent_end_idx))) {
+        search_idx = urgent_end_idx + 1;
+        if (frame->end_stream) {
+            break;
+        }
+    }
+    ASSERT_NOT_NULL(frame);
+
+    for (size_t i = 1; i < NUM_STREAMS; ++i) {
+        uint32_t stream_id = aws_http_stream_get_id(stream_testers[i].stream);
+        ASSERT_SUCCESS(h2_decode_tester_check_data_str_across_frames(
+            &s_tester.peer.decode, stream_id, "z", true /*expect_end_frame*/));
+        size_t data_idx = 0;
+        ASSERT_NOT_NULL(
+            h2_decode_tester_find_stream_frame(&s_tester.peer.decode, AWS_H2_FRAME_T_DATA, stream_id, 0, &data_idx));
+        ASSERT_TRUE(data_idx > urgent_end_idx);
+    }
+
+    /* clean up */
+    for (size_t i = 0; i < NUM_STREAMS; ++i) {
+        client_stream_tester_clean_up(&stream_testers[i]);
+        aws_http_message_release(requests[i]);
+        aws_input_stream_release(request_bodies[i]);
+    }
+    aws_mem_release(allocator, stream_testers);
+    aws_mem_release(allocator, request_bodies);
+    aws_mem_release(allocator, requests);
+    aws_byte_buf_clean_up(&big_body_buf);
+    return s_tester_clean_up();
+}
+
+/* Once the connection is warm, receiving DATA shouldn't allocate at all.
+ * The WINDOW_UPDATE frames sent back come from the connection's frame pool */
+#define H2_CLIENT_ALLOCATIONS_PER_DATA_FRAME 0
+
+/* Once the connection is warm, a request/response cycle may allocate at most this many times.
+ * That's the stream itself, plus a little slack. HPACK encoding and decoding both header-blocks shouldn't allocate */
+#define H2_CLIENT_ALLOCATIONS_PER_STREAM 3
+
+/* In the allocation budget tests, only the connection gets the counting allocator.
+ * The test's own requests, testers, and fake peer aren't counted */
+
+static int s_send_response_headers(uint32_t stream_id, bool end_stream) {
+    struct aws_http_header response_headers_src[] = {
+        DEFINE_HEADER(":status", "200"),
+        DEFINE_HEADER("date", "Fri, 01 Mar 2019 17:18:55 GMT"),
+        DEFINE_HEADER("server", "AmazonS3"),
+        DEFINE_HEADER("content-type", "text/plain"),
+        DEFINE_HEADER("x-amz-request-id", "0A49CE4060975EAC"),
+    };
+    struct aws_http_headers *response_headers = aws_http_headers_new(s_tester.alloc);
+    ASSERT_SUCCESS(
+        aws_http_headers_add_array(response_headers, response_headers_src, AWS_ARRAY_SIZE(response_headers_src)));
+    struct aws_h2_frame *response_frame =
+        aws_h2_frame_new_headers(s_tester.alloc, stream_id, response_headers, end_stream, 0, NULL);
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&s_tester.peer, response_frame));
+    aws_http_headers_release(response_headers);
+    return AWS_OP_SUCCESS;
+}
+
+TEST_CASE(h2_client_data_frame_allocation_budget) {
+    struct counting_allocator counting;
+    counting_allocator_init(&counting, allocator);
+    s_tester.connection_alloc = &counting.base;
+    ASSERT_SUCCESS(s_tester_init(allocator, ctx));
+
+    ASSERT_SUCCESS(h2_fake_peer_send_connection_preface_default_settings(&s_tester.peer));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+    struct aws_http_message *request = aws_http2_message_new_request(allocator);
+    ASSERT_NOT_NULL(request);
+    struct aws_http_header request_headers_src[] = {
+        DEFINE_HEADER(":method", "GET"),
+        DEFINE_HEADER(":scheme", "https"),
+        DEFINE_HEADER(":path", "/"),
+    };
+    ASSERT_SUCCESS(
+        aws_http_message_add_header_array(request, request_headers_src, AWS_ARRAY_SIZE(request_headers_src)));
+
+    struct client_stream_tester stream_tester;
+    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, request));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    uint32_t stream_id = aws_http_stream_get_id(stream_tester.stream);
+
+    ASSERT_SUCCESS(s_send_response_headers(stream_id, false /*end_stream*/));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+    /* One DATA frame per aws_io_message, so each goes all the way through on its own */
+    enum { WARMUP_FRAMES = 10, MEASURED_FRAMES = 100 };
+    size_t num_allocations_before = 0;
+    for (size_t i = 0; i < WARMUP_FRAMES + MEASURED_FRAMES; ++i) {
+        if (i == WARMUP_FRAMES) {
+            num_allocations_before = counting.num_allocations;
+        }
+        ASSERT_SUCCESS(h2_fake_peer_send_data_frame_str(&s_tester.peer, stream_id, "0123456789", false));
+        testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    }
+
+    ASSERT_SUCCESS(counting_allocator_check_budget(
+        &counting, "DATA frame", num_allocations_before, MEASURED_FRAMES, H2_CLIENT_ALLOCATIONS_PER_DATA_FRAME));
+
+    ASSERT_SUCCESS(h2_fake_peer_send_data_frame_str(&s_tester.peer, stream_id, "", true /*end_stream*/));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_TRUE(stream_tester.complete);
+    ASSERT_INT_EQUALS(AWS_ERROR_SUCCESS, stream_tester.on_complete_error_code);
+    ASSERT_UINT_EQUALS((WARMUP_FRAMES + MEASURED_FRAMES) * 10, stream_tester.response_body.len);
+
+    aws_http_message_release(request);
+    client_stream_tester_clean_up(&stream_tester);
+    return s_tester_clean_up();
+}
+
+TEST_CASE(h2_client_stream_allocation_budget) {
+    struct counting_allocator counting;
+    counting_allocator_init(&counting, allocator);
+    s_tester.connection_alloc = &counting.base;
+    ASSERT_SUCCESS(s_tester_init(allocator, ctx));
+
+    ASSERT_SUCCESS(h2_fake_peer_send_connection_preface_default_settings(&s_tester.peer));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+    struct aws_http_message *request = aws_http2_message_new_request(allocator);
+    ASSERT_NOT_NULL(request);
+    struct aws_http_header request_headers_src[] = {
+        DEFINE_HEADER(":method", "GET"),
+        DEFINE_HEADER(":scheme", "https"),
+        DEFINE_HEADER(":path", "/"),
+        DEFINE_HEADER(":authority", "example.com"),
+        DEFINE_HEADER("user-agent", "aws-c-http"),
+        DEFINE_HEADER("accept", "*/*"),
+    };
+    ASSERT_SUCCESS(
+        aws_http_message_add_header_array(request, request_headers_src, AWS_ARRAY_SIZE(request_headers_src)));
+
+    enum { WARMUP_STREAMS = 4, MEASURED_STREAMS = 100 };
+    size_t num_allocations_before = 0;
+    for (size_t i = 0; i < WARMUP_STREAMS + MEASURED_STREAMS; ++i) {
+        if (i == WARMUP_STREAMS) {
+            num_allocations_before = counting.num_allocations;
+        }
+
+        struct client_stream_tester stream_tester;
+        ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, request));
+        testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+        ASSERT_SUCCESS(s_send_response_headers(aws_http_stream_get_id(stream_tester.stream), true /*end_stream*/));
+        testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+        ASSERT_TRUE(stream_tester.complete);
+        ASSERT_INT_EQUALS(AWS_ERROR_SUCCESS, stream_tester.on_complete_error_code);
+        ASSERT_INT_EQUALS(200, stream_tester.response_status);
+        client_stream_tester_clean_up(&stream_tester);
+    }
+
+    ASSERT_SUCCESS(counting_allocator_check_budget(
+        &counting, "stream", num_allocations_before, MEASURED_STREAMS, H2_CLIENT_ALLOCATIONS_PER_STREAM));
+
+    aws_http_message_release(request);
+    return s_tester_clean_up();
+}
+
+static uint32_t s_largest_data_frame_payload(uint32_t stream_id) {
+    uint32_t largest = 0;
+    for (size_t i = 0; i < h2_decode_tester_frame_count(&s_tester.peer.decode); ++i) {
+        struct h2_decoded_frame *frame = h2_decode_tester_get_frame(&s_tester.peer.decode, i);
+        if (frame->type == AWS_H2_FRAME_T_DATA && frame->stream_id == stream_id) {
+            largest = aws_max_u32(largest, frame->data_payload_len);
+        }
+    }
+    return largest;
+}
+
+/* Test that with bulk_data_max_frame_size set, the client advertises a larger SETTINGS_MAX_FRAME_SIZE,
+ * and sends large DATA frames while one stream sends alone, but default-sized frames while streams take turns */
+TEST_CASE(h2_client_stream_bulk_data_frame_size) {
+    const uint32_t bulk_frame_size = 64 * 1024;
+    s_tester.bulk_data_max_frame_size = bulk_frame_size;
+    ASSERT_SUCCESS(s_tester_init(allocator, ctx));
+
+    /* the initial SETTINGS lets the peer send large frames too */
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+    struct h2_decoded_frame *settings_frame =
+        h2_decode_tester_find_frame(&s_tester.peer.decode, AWS_H2_FRAME_T_SETTINGS, 0, NULL /*out_idx*/);
+    ASSERT_NOT_NULL(settings_frame);
+    bool found_max_frame_size = false;
+    for (size_t i = 0; i < aws_array_list_length(&settings_frame->settings); ++i) {
+        struct aws_http2_setting setting;
+        aws_array_list_get_at(&settings_frame->settings, &setting, i);
+        if (setting.id == AWS_HTTP2_SETTINGS_MAX_FRAME_SIZE) {
+            ASSERT_UINT_EQUALS(bulk_frame_size, setting.value);
+            found_max_frame_size = true;
+        }
+    }
+    ASSERT_TRUE(found_max_frame_size);
+
+    /* peer allows large frames and opens the flow-control windows wide */
+    struct aws_http2_setting settings_array[] = {
+        {.id = AWS_HTTP2_SETTINGS_MAX_FRAME_SIZE, .value = AWS_H2_PAYLOAD_MAX},
+        {.id = AWS_HTTP2_SETTINGS_INITIAL_WINDOW_SIZE, .value = AWS_H2_WINDOW_UPDATE_MAX},
+    };
+    struct aws_h2_frame *settings =
+        aws_h2_frame_new_settings(allocator, settings_array, AWS_ARRAY_SIZE(settings_array), false /*ack*/);
+    ASSERT_NOT_NULL(settings);
+    ASSERT_SUCCESS(h2_fake_peer_send_connection_preface(&s_tester.peer, settings));
+    struct aws_h2_frame *window_update =
+        aws_h2_frame_new_window_update(allocator, 0 /*stream_id*/, AWS_H2_WINDOW_UPDATE_MAX - AWS_H2_INIT_WINDOW_SIZE);
+    ASSERT_NOT_NULL(window_update);
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&s_tester.peer, window_update));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+    aws_h2_decoder_set_setting_max_frame_size(s_tester.peer.decode.decoder, AWS_H2_PAYLOAD_MAX);
+
+    struct aws_http_header request_headers_src[] = {
+        DEFINE_HEADER(":method", "POST"),
+        DEFINE_HEADER(":scheme", "https"),
+        DEFINE_HEADER(":path", "/"),
+    };
+    const size_t body_size = bulk_frame_size * 3;
+    struct aws_byte_buf body_buf;
+    ASSERT_SUCCESS(aws_byte_buf_init(&body_buf, allocator, body_size));
+    ASSERT_TRUE(aws_byte_buf_write_u8_n(&body_buf, (uint8_t)'a', body_size));
+    const uint32_t default_frame_size = aws_h2_settings_initial[AWS_HTTP2_SETTINGS_MAX_FRAME_SIZE];
+
+    /* the first stream sends alone, then the next two are created together */
+    enum { NUM_STREAMS = 3 };
+    struct aws_http_message *requests[NUM_STREAMS];
+    struct aws_input_stream *request_bodies[NUM_STREAMS];
+    struct client_stream_tester stream_testers[NUM_STREAMS];
+    for (size_t i = 0; i < NUM_STREAMS; ++i) {
+        requests[i] = aws_http2_message_new_request(allocator);
+        aws_http_message_add_header_array(requests[i], request_headers_src, AWS_ARRAY_SIZE(request_headers_src));
+        struct aws_byte_cursor body_cursor = aws_byte_cursor_from_buf(&body_buf);
+        request_bodies[i] = aws_input_stream_new_from_cursor(allocator, &body_cursor);
+        ASSERT_NOT_NULL(request_bodies[i]);
+        aws_http_message_set_body_stream(requests[i], request_bodies[i]);
+        ASSERT_SUCCESS(s_stream_tester_init(&stream_testers[i], requests[i]));
+        if (i != 1) {
+            testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+        }
+    }
+
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+    for (size_t i = 0; i < NUM_STREAMS; ++i) {
+        ASSERT_SUCCESS(h2_decode_tester_check_data_across_frames(
+            &s_tester.peer.decode,
+            aws_http_stream_get_id(stream_testers[i].stream),
+            aws_byte_cursor_from_buf(&body_buf),
+            true /*expect_end_frame*/));
+    }
+    ASSERT_UINT_EQUALS(bulk_frame_size, s_largest_data_frame_payload(aws_http_stream_get_id(stream_testers[0].stream)));
+    /* the second stream always had the third waiting behind it */
+    ASSERT_TRUE(
+        s_largest_data_frame_payload(aws_http_stream_get_id(stream_testers[1].stream)) <= default_frame_size);
+
+    /* clean up */
+    for (size_t i = 0; i < NUM_STREAMS; ++i) {
+        client_stream_tester_clean_up(&stream_testers[i]);
+        aws_http_message_release(requests[i]);
+        aws_input_stream_release(request_bodies[i]);
+    }
+    aws_byte_buf_clean_up(&body_buf);
+    return s_tester_clean_up();
+}
+
+/* Test that with write coalescing enabled, frames queued by separate tasks are written in a single message */
+TEST_CASE(h2_client_write_coalescing) {
+    s_tester.write_coalescing_delay_us = 20000;
+    ASSERT_SUCCESS(s_tester_init(allocator, ctx));
+
+    /* connection preface is held for the coalescing delay too */
+    ASSERT_UINT_EQUALS(0, s_written_message_count());
+    s_drain_tasks_after_coalescing_delay();
+    ASSERT_UINT_EQUALS(1, s_written_message_count());
+
+    /* get connection preface and acks out of the way */
+    ASSERT_SUCCESS(h2_fake_peer_send_connection_preface_default_settings(&s_tester.peer));
+    s_drain_tasks_after_coalescing_delay();
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+    size_t frame_count = h2_decode_tester_frame_count(&s_tester.peer.decode);
+
+    /* activate 2 streams from separate tasks */
+    enum { NUM_STREAMS = 2 };
+    struct aws_http_message *requests[NUM_STREAMS];
+    struct client_stream_tester stream_testers[NUM_STREAMS];
+    struct aws_http_header headers[] = {
+        DEFINE_HEADER(":method", "GET"),
+        DEFINE_HEADER(":scheme", "https"),
+        DEFINE_HEADER(":path", "/"),
+    };
+    for (size_t i = 0; i < NUM_STREAMS; ++i) {
+        requests[i] = aws_http2_message_new_request(allocator);
+        ASSERT_NOT_NULL(requests[i]);
+        ASSERT_SUCCESS(aws_http_message_add_header_array(requests[i], headers, AWS_ARRAY_SIZE(headers)));
+        ASSERT_SUCCESS(s_stream_tester_init(&stream_testers[i], requests[i]));
+        testing_channel_run_currently_queued_tasks(&s_tester.testing_channel);
+    }
+
+    /* nothing written until the delay passes, then everything goes out in 1 message */
+    ASSERT_UINT_EQUALS(0, s_written_message_count());
+    s_drain_tasks_after_coalescing_delay();
+    ASSERT_UINT_EQUALS(1, s_written_message_count());
+
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+    ASSERT_UINT_EQUALS(frame_count + NUM_STREAMS, h2_decode_tester_frame_count(&s_tester.peer.decode));
+    for (size_t i = 0; i < NUM_STREAMS; ++i) {
+        struct h2_decoded_frame *frame = h2_decode_tester_get_frame(&s_tester.peer.decode, frame_count + i);
+        ASSERT_UINT_EQUALS(AWS_H2_FRAME_T_HEADERS, frame->type);
+        ASSERT_UINT_EQUALS(aws_http_stream_get_id(stream_testers[i].stream), frame->stream_id);
+    }
+
+    /* clean up */
+    aws_http_connection_close(s_tester.connection);
+    for (size_t i = 0; i < NUM_STREAMS; ++i) {
+        client_stream_tester_clean_up(&stream_testers[i]);
+        aws_http_message_release(requests[i]);
+    }
+    return s_tester_clean_up();
+}
+
+static size_t s_written_messages_in_flight_count(void) {
+    struct aws_linked_list *written_msgs = testing_channel_get_written_message_queue(&s_tester.testing_channel);
+    size_t count = 0;
+    for (struct aws_linked_list_node *node = aws_linked_list_begin(written_msgs);
+         node != aws_linked_list_end(written_msgs);
+         node = aws_linked_list_next(node)) {
+
+        struct aws_io_message *msg = AWS_CONTAINER_OF(node, struct aws_io_message, queueing_handle);
+        if (msg->on_completion) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+/* Test that with max_write_messages_in_flight, that many messages are written before waiting for one to complete */
+TEST_CASE(h2_client_multiple_write_messages_in_flight) {
+    s_tester.max_write_messages_in_flight = 2;
+    ASSERT_SUCCESS(s_tester_init(allocator, ctx));
+
+    /* get connection preface and acks out of the way */
+    ASSERT_SUCCESS(h2_fake_peer_send_connection_preface_default_settings(&s_tester.peer));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+
+    testing_channel_complete_written_messages_immediately(&s_tester.testing_channel, false, AWS_ERROR_SUCCESS);
+
+    /* send request with a body that needs several messages, but fits in the initial window */
+    size_t body_size = 40000;
+    struct aws_byte_buf body_buf;
+    ASSERT_SUCCESS(aws_byte_buf_init(&body_buf, allocator, body_size));
+    ASSERT_TRUE(aws_byte_buf_write_u8_n(&body_buf, (uint8_t)'a', body_size));
+    struct aws_byte_cursor body_cursor = aws_byte_cursor_from_buf(&body_buf);
+    struct aws_input_stream *request_body = aws_input_stream_new_from_cursor(allocator, &body_cursor);
+
+    struct aws_http_message *request = aws_http2_message_new_request(allocator);
+    ASSERT_NOT_NULL(request);
+    struct aws_http_header request_headers_src[] = {
+        DEFINE_HEADER(":method", "POST"),
+        DEFINE_HEADER(":scheme", "https"),
+        DEFINE_HEADER(":path", "/"),
+    };
+    aws_http_message_add_header_array(request, request_headers_src, AWS_ARRAY_SIZE(request_headers_src));
+    aws_http_message_set_body_stream(request, request_body);
+
+    struct client_stream_tester stream_tester;
+    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, request));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_UINT_EQUALS(2, s_written_messages_in_flight_count());
+
+    /* each time the oldest message completes, another may take its place */
+    struct aws_linked_list *written_msgs = testing_channel_get_written_message_queue(&s_tester.testing_channel);
+    size_t completed_count = 0;
+    for (struct aws_linked_list_node *node = aws_linked_list_begin(written_msgs);
+         node != aws_linked_list_end(written_msgs);
+         node = aws_linked_list_next(node)) {
+
+        struct aws_io_message *msg = AWS_CONTAINER_OF(node, struct aws_io_message, queueing_handle);
+        ASSERT_NOT_NULL(msg->on_completion);
+        msg->on_completion(s_tester.testing_channel.channel, msg, AWS_ERROR_SUCCESS, msg->user_data);
+        msg->on_completion = NULL;
+        ++completed_count;
+
+        testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+        ASSERT_TRUE(s_written_messages_in_flight_count() <= 2);
+    }
+    ASSERT_TRUE(completed_count > 2);
+
+    /* validate that all data sent successfully */
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+    ASSERT_SUCCESS(h2_decode_tester_check_data_across_frames(
+        &s_tester.peer.decode, aws_http_stream_get_id(stream_tester.stream), body_cursor, true /*expect_end_frame*/));
+
+    /* clean up */
+    aws_http_connection_close(s_tester.connection);
+    client_stream_tester_clean_up(&stream_tester);
+    aws_http_message_release(request);
+    aws_input_stream_release(request_body);
+    aws_byte_buf_clean_up(&body_buf);
+    return s_tester_clean_up();
+}
+
+/* Test sending a request whose aws_input_stream is not providing body data all at once */
+TEST_CASE(h2_client_stream_send_stalled_data) {
+    ASSERT_SUCCESS(s_tester_init(allocator, ctx));
+
+    /* get connection preface and acks out of the way */
+    ASSERT_SUCCESS(h2_fake_peer_send_connection_preface_default_settings(&s_tester.peer));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+
+    /* get request ready
+     * the body_stream will stall and provide no data when we try to read from it */
+    struct aws_http_message *request = aws_http2_message_new_request(allocator);
+    ASSERT_NOT_NULL(request);
+
+    struct aws_http_header request_headers_src[] = {
+        DEFINE_HEADER(":method", "POST"),
+        DEFINE_HEADER(":scheme", "https"),
+        DEFINE_HEADER(":path", "/"),
+    };
+    aws_http_message_add_header_array(request, request_headers_src, AWS_ARRAY_SIZE(request_headers_src));
+
+    const char *body_src = "hello";
+    struct aws_byte_cursor body_cursor = aws_byte_cursor_from_c_str(body_src);
+    struct aws_input_stream *request_body = aws_input_stream_new_tester(allocator, body_cursor);
+    aws_input_stream_tester_set_max_bytes_per_read(request_body, 0);
 
     aws_http_message_set_body_stream(request, request_body);
 
@@ -1876,6 +2843,60 @@ TEST_CASE(h2_client_stream_send_stalled_data) {
     return s_tester_clean_up();
 }
 
+/* Test that a connection which stopped polling a stalled body stream resumes immediately when notified */
+TEST_CASE(h2_client_stream_notify_body_ready) {
+    ASSERT_SUCCESS(s_tester_init(allocator, ctx));
+
+    /* get connection preface and acks out of the way */
+    ASSERT_SUCCESS(h2_fake_peer_send_connection_preface_default_settings(&s_tester.peer));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+
+    /* get request ready
+     * the body_stream will stall and provide no data when we try to read from it */
+    struct aws_http_message *request = aws_http2_message_new_request(allocator);
+    ASSERT_NOT_NULL(request);
+
+    struct aws_http_header request_headers_src[] = {
+        DEFINE_HEADER(":method", "POST"),
+        DEFINE_HEADER(":scheme", "https"),
+        DEFINE_HEADER(":path", "/"),
+    };
+    aws_http_message_add_header_array(request, request_headers_src, AWS_ARRAY_SIZE(request_headers_src));
+
+    const char *body_src = "hello";
+    struct aws_byte_cursor body_cursor = aws_byte_cursor_from_c_str(body_src);
+    struct aws_input_stream *request_body = aws_input_stream_new_tester(allocator, body_cursor);
+    aws_input_stream_tester_set_max_bytes_per_read(request_body, 0);
+
+    aws_http_message_set_body_stream(request, request_body);
+
+    struct client_stream_tester stream_tester;
+    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, request));
+    uint32_t stream_id = aws_http_stream_get_id(stream_tester.stream);
+
+    /* Run enough event-loop ticks that the connection gives up polling the body every tick */
+    for (size_t i = 0; i < AWS_H2_OUTGOING_FRAMES_EMPTY_POLL_LIMIT * 2; ++i) {
+        testing_channel_run_currently_queued_tasks(&s_tester.testing_channel);
+    }
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+    ASSERT_NULL(h2_decode_tester_find_frame(&s_tester.peer.decode, AWS_H2_FRAME_T_DATA, 0 /*search_start_idx*/, NULL));
+
+    /* Body has data now. Notify, and the DATA should go out on the very next tick */
+    aws_input_stream_tester_set_max_bytes_per_read(request_body, SIZE_MAX);
+    ASSERT_SUCCESS(aws_http2_stream_notify_body_ready(stream_tester.stream));
+    testing_channel_run_currently_queued_tasks(&s_tester.testing_channel);
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+    ASSERT_SUCCESS(
+        h2_decode_tester_check_data_str_across_frames(&s_tester.peer.decode, stream_id, body_src, true /*end_stream*/));
+
+    /* clean up */
+    aws_http_message_release(request);
+    client_stream_tester_clean_up(&stream_tester);
+    aws_input_stream_release(request_body);
+    return s_tester_clean_up();
+}
+
 static int s_fake_peer_window_update_check(
     struct aws_allocator *alloc,
     uint32_t stream_id,
@@ -2414,93 +3435,333 @@ TEST_CASE(h2_client_stream_send_data_controlled_by_connection_and_stream_window_
         ASSERT_INT_EQUALS(200, stream_testers[i].response_status);
     }
 
-    ASSERT_TRUE(aws_http_connection_is_open(s_tester.connection));
+    ASSERT_TRUE(aws_http_connection_is_open(s_tester.connection));
+
+    /* clean up */
+    aws_http_headers_release(response_headers);
+    for (size_t i = 0; i < NUM_STREAMS; ++i) {
+        client_stream_tester_clean_up(&stream_testers[i]);
+        aws_http_message_release(requests[i]);
+        aws_input_stream_release(request_bodies[i]);
+        aws_byte_buf_clean_up(&request_body_bufs[i]);
+    }
+    return s_tester_clean_up();
+}
+
+/* Test receiving a response with DATA frames, the window update frame will be sent */
+TEST_CASE(h2_client_stream_send_window_update) {
+    /* Enable automatic window manager management */
+    s_tester.no_conn_manual_win_management = true;
+    ASSERT_SUCCESS(s_tester_init(allocator, ctx));
+
+    /* fake peer sends connection preface */
+    ASSERT_SUCCESS(h2_fake_peer_send_connection_preface_default_settings(&s_tester.peer));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+    /* Check the inital window update frame has been sent to maximize the connection window */
+    size_t initial_window_update_index = 0;
+    struct h2_decoded_frame *initial_connection_window_update_frame = h2_decode_tester_find_stream_frame(
+        &s_tester.peer.decode, AWS_H2_FRAME_T_WINDOW_UPDATE, 0 /*stream_id*/, 0 /*idx*/, &initial_window_update_index);
+    ASSERT_NOT_NULL(initial_connection_window_update_frame);
+    ASSERT_UINT_EQUALS(
+        AWS_H2_WINDOW_UPDATE_MAX - AWS_H2_INIT_WINDOW_SIZE,
+        initial_connection_window_update_frame->window_size_increment);
+
+    /* send request */
+    struct aws_http_message *request = aws_http2_message_new_request(allocator);
+    ASSERT_NOT_NULL(request);
+
+    struct aws_http_header request_headers_src[] = {
+        DEFINE_HEADER(":method", "GET"),
+        DEFINE_HEADER(":scheme", "https"),
+        DEFINE_HEADER(":path", "/"),
+    };
+    aws_http_message_add_header_array(request, request_headers_src, AWS_ARRAY_SIZE(request_headers_src));
+
+    struct client_stream_tester stream_tester;
+    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, request));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    uint32_t stream_id = aws_http_stream_get_id(stream_tester.stream);
+
+    /* fake peer sends response headers */
+    struct aws_http_header response_headers_src[] = {
+        DEFINE_HEADER(":status", "200"),
+    };
+
+    struct aws_http_headers *response_headers = aws_http_headers_new(allocator);
+    aws_http_headers_add_array(response_headers, response_headers_src, AWS_ARRAY_SIZE(response_headers_src));
+
+    struct aws_h2_frame *response_frame =
+        aws_h2_frame_new_headers(allocator, stream_id, response_headers, false /*end_stream*/, 0, NULL);
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&s_tester.peer, response_frame));
+
+    /* fake peer sends 1 DATA frame */
+    const char *body_src = "hello";
+    ASSERT_SUCCESS(h2_fake_peer_send_data_frame_str(&s_tester.peer, stream_id, body_src, false /*end_stream*/));
+
+    /* check that 2 WINDOW_UPDATE frames have been sent.
+     * 1 for the connection, and 1 for the stream */
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+
+    struct h2_decoded_frame *stream_window_update_frame = h2_decode_tester_find_stream_frame(
+        &s_tester.peer.decode, AWS_H2_FRAME_T_WINDOW_UPDATE, stream_id, 0 /*idx*/, NULL);
+    ASSERT_NOT_NULL(stream_window_update_frame);
+    ASSERT_UINT_EQUALS(5, stream_window_update_frame->window_size_increment);
+
+    struct h2_decoded_frame *connection_window_update_frame = h2_decode_tester_find_stream_frame(
+        &s_tester.peer.decode,
+        AWS_H2_FRAME_T_WINDOW_UPDATE,
+        0 /*stream_id*/,
+        initial_window_update_index + 1 /*idx*/,
+        NULL);
+    ASSERT_NOT_NULL(connection_window_update_frame);
+    ASSERT_UINT_EQUALS(5, connection_window_update_frame->window_size_increment);
+
+    /* clean up */
+    aws_http_headers_release(response_headers);
+    aws_http_message_release(request);
+    client_stream_tester_clean_up(&stream_tester);
+    return s_tester_clean_up();
+}
+
+/* Test that stream windows grow once the peer nearly fills one within a PING round-trip */
+TEST_CASE(h2_client_stream_window_auto_tuning) {
+    s_tester.stream_window_auto_tuning_max_size = 1024 * 1024;
+    ASSERT_SUCCESS(s_tester_init(allocator, ctx));
+
+    /* get connection preface and acks out of the way */
+    ASSERT_SUCCESS(h2_fake_peer_send_connection_preface_default_settings(&s_tester.peer));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+
+    /* send request */
+    struct aws_http_message *request = aws_http2_message_new_request(allocator);
+    ASSERT_NOT_NULL(request);
+
+    struct aws_http_header request_headers_src[] = {
+        DEFINE_HEADER(":method", "GET"),
+        DEFINE_HEADER(":scheme", "https"),
+        DEFINE_HEADER(":path", "/"),
+    };
+    aws_http_message_add_header_array(request, request_headers_src, AWS_ARRAY_SIZE(request_headers_src));
+
+    struct client_stream_tester stream_tester;
+    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, request));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    uint32_t stream_id = aws_http_stream_get_id(stream_tester.stream);
+
+    /* fake peer sends response headers */
+    struct aws_http_header response_headers_src[] = {
+        DEFINE_HEADER(":status", "200"),
+    };
+    struct aws_http_headers *response_headers = aws_http_headers_new(allocator);
+    aws_http_headers_add_array(response_headers, response_headers_src, AWS_ARRAY_SIZE(response_headers_src));
+    struct aws_h2_frame *response_frame =
+        aws_h2_frame_new_headers(allocator, stream_id, response_headers, false /*end_stream*/, 0, NULL);
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&s_tester.peer, response_frame));
+
+    /* fake peer sends 3 full DATA frames, that's more than 2/3 of the initial window */
+    struct aws_byte_buf body_buf;
+    const uint32_t frame_size = 16384; /* default SETTINGS_MAX_FRAME_SIZE */
+    ASSERT_SUCCESS(aws_byte_buf_init(&body_buf, allocator, frame_size));
+    ASSERT_TRUE(aws_byte_buf_write_u8_n(&body_buf, 'a', body_buf.capacity));
+    const size_t num_data_frames = 3;
+    for (size_t i = 0; i < num_data_frames; ++i) {
+        ASSERT_SUCCESS(h2_fake_peer_send_data_frame(
+            &s_tester.peer, stream_id, aws_byte_cursor_from_buf(&body_buf), false /*end_stream*/));
+    }
+
+    /* the first DATA triggers a PING, and window updates only replace what was received */
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+
+    struct h2_decoded_frame *ping_frame =
+        h2_decode_tester_find_frame(&s_tester.peer.decode, AWS_H2_FRAME_T_PING, 0 /*search_start_idx*/, NULL);
+    ASSERT_NOT_NULL(ping_frame);
+    ASSERT_FALSE(ping_frame->ack);
+
+    size_t search_idx = 0;
+    for (size_t i = 0; i < num_data_frames; ++i) {
+        struct h2_decoded_frame *window_update_frame = h2_decode_tester_find_stream_frame(
+            &s_tester.peer.decode, AWS_H2_FRAME_T_WINDOW_UPDATE, stream_id, search_idx, &search_idx);
+        ASSERT_NOT_NULL(window_update_frame);
+        ASSERT_UINT_EQUALS(frame_size, window_update_frame->window_size_increment);
+        ++search_idx;
+    }
+
+    /* fake peer ACKs the PING, then sends more DATA */
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(
+        &s_tester.peer, aws_h2_frame_new_ping(allocator, true /*ack*/, ping_frame->ping_opaque_data)));
+    ASSERT_SUCCESS(h2_fake_peer_send_data_frame(
+        &s_tester.peer, stream_id, aws_byte_cursor_from_buf(&body_buf), false /*end_stream*/));
+
+    /* the stream's window should have doubled */
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+    struct h2_decoded_frame *window_update_frame = h2_decode_tester_find_stream_frame(
+        &s_tester.peer.decode, AWS_H2_FRAME_T_WINDOW_UPDATE, stream_id, search_idx, NULL);
+    ASSERT_NOT_NULL(window_update_frame);
+    ASSERT_UINT_EQUALS(frame_size + AWS_H2_INIT_WINDOW_SIZE, window_update_frame->window_size_increment);
+
+    /* clean up */
+    aws_byte_buf_clean_up(&body_buf);
+    aws_http_headers_release(response_headers);
+    aws_http_message_release(request);
+    client_stream_tester_clean_up(&stream_tester);
+    return s_tester_clean_up();
+}
+
+/* Test that stream windows don't grow when the DATA received is spread across streams that aren't window-limited */
+TEST_CASE(h2_client_stream_window_auto_tuning_per_stream) {
+    s_tester.stream_window_auto_tuning_max_size = 1024 * 1024;
+    ASSERT_SUCCESS(s_tester_init(allocator, ctx));
+
+    /* get connection preface and acks out of the way */
+    ASSERT_SUCCESS(h2_fake_peer_send_connection_preface_default_settings(&s_tester.peer));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+
+    /* send 2 requests */
+    struct aws_http_message *request = aws_http2_message_new_request(allocator);
+    ASSERT_NOT_NULL(request);
+
+    struct aws_http_header request_headers_src[] = {
+        DEFINE_HEADER(":method", "GET"),
+        DEFINE_HEADER(":scheme", "https"),
+        DEFINE_HEADER(":path", "/"),
+    };
+    aws_http_message_add_header_array(request, request_headers_src, AWS_ARRAY_SIZE(request_headers_src));
+
+    struct client_stream_tester stream_testers[2];
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(stream_testers); ++i) {
+        ASSERT_SUCCESS(s_stream_tester_init(&stream_testers[i], request));
+    }
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+    /* fake peer sends response headers, then 2 full DATA frames on each stream.
+     * That's more than 2/3 of the initial window in total, but less on each stream */
+    struct aws_http_header response_headers_src[] = {
+        DEFINE_HEADER(":status", "200"),
+    };
+    struct aws_http_headers *response_headers = aws_http_headers_new(allocator);
+    aws_http_headers_add_array(response_headers, response_headers_src, AWS_ARRAY_SIZE(response_headers_src));
+
+    struct aws_byte_buf body_buf;
+    const uint32_t frame_size = 16384; /* default SETTINGS_MAX_FRAME_SIZE */
+    ASSERT_SUCCESS(aws_byte_buf_init(&body_buf, allocator, frame_size));
+    ASSERT_TRUE(aws_byte_buf_write_u8_n(&body_buf, 'a', body_buf.capacity));
+    const size_t num_data_frames = 2;
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(stream_testers); ++i) {
+        uint32_t stream_id = aws_http_stream_get_id(stream_testers[i].stream);
+        struct aws_h2_frame *response_frame =
+            aws_h2_frame_new_headers(allocator, stream_id, response_headers, false /*end_stream*/, 0, NULL);
+        ASSERT_SUCCESS(h2_fake_peer_send_frame(&s_tester.peer, response_frame));
+        for (size_t j = 0; j < num_data_frames; ++j) {
+            ASSERT_SUCCESS(h2_fake_peer_send_data_frame(
+                &s_tester.peer, stream_id, aws_byte_cursor_from_buf(&body_buf), false /*end_stream*/));
+        }
+    }
+
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+    struct h2_decoded_frame *ping_frame =
+        h2_decode_tester_find_frame(&s_tester.peer.decode, AWS_H2_FRAME_T_PING, 0 /*search_start_idx*/, NULL);
+    ASSERT_NOT_NULL(ping_frame);
+    size_t search_idx = h2_decode_tester_frame_count(&s_tester.peer.decode);
+
+    /* fake peer ACKs the PING, then sends more DATA */
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(
+        &s_tester.peer, aws_h2_frame_new_ping(allocator, true /*ack*/, ping_frame->ping_opaque_data)));
+    uint32_t first_stream_id = aws_http_stream_get_id(stream_testers[0].stream);
+    ASSERT_SUCCESS(h2_fake_peer_send_data_frame(
+        &s_tester.peer, first_stream_id, aws_byte_cursor_from_buf(&body_buf), false /*end_stream*/));
+
+    /* the stream's window should not have grown */
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+    struct h2_decoded_frame *window_update_frame = h2_decode_tester_find_stream_frame(
+        &s_tester.peer.decode, AWS_H2_FRAME_T_WINDOW_UPDATE, first_stream_id, search_idx, NULL);
+    ASSERT_NOT_NULL(window_update_frame);
+    ASSERT_UINT_EQUALS(frame_size, window_update_frame->window_size_increment);
 
     /* clean up */
+    aws_byte_buf_clean_up(&body_buf);
     aws_http_headers_release(response_headers);
-    for (size_t i = 0; i < NUM_STREAMS; ++i) {
+    aws_http_message_release(request);
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(stream_testers); ++i) {
         client_stream_tester_clean_up(&stream_testers[i]);
-        aws_http_message_release(requests[i]);
-        aws_input_stream_release(request_bodies[i]);
-        aws_byte_buf_clean_up(&request_body_bufs[i]);
     }
     return s_tester_clean_up();
 }
 
-/* Test receiving a response with DATA frames, the window update frame will be sent */
-TEST_CASE(h2_client_stream_send_window_update) {
-    /* Enable automatic window manager management */
-    s_tester.no_conn_manual_win_management = true;
+/* Test that SETTINGS_HEADER_TABLE_SIZE shrinks when the peer's responses barely use the HPACK dynamic table */
+TEST_CASE(h2_client_header_table_adaptive_shrink) {
+    s_tester.header_table_adaptive_min_size = 512;
+    s_tester.header_table_adaptive_max_size = 64 * 1024;
     ASSERT_SUCCESS(s_tester_init(allocator, ctx));
 
-    /* fake peer sends connection preface */
+    /* get connection preface and acks out of the way */
     ASSERT_SUCCESS(h2_fake_peer_send_connection_preface_default_settings(&s_tester.peer));
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&s_tester.peer, aws_h2_frame_new_settings(allocator, NULL, 0, true)));
     testing_channel_drain_queued_tasks(&s_tester.testing_channel);
     ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
-    /* Check the inital window update frame has been sent to maximize the connection window */
-    size_t initial_window_update_index = 0;
-    struct h2_decoded_frame *initial_connection_window_update_frame = h2_decode_tester_find_stream_frame(
-        &s_tester.peer.decode, AWS_H2_FRAME_T_WINDOW_UPDATE, 0 /*stream_id*/, 0 /*idx*/, &initial_window_update_index);
-    ASSERT_NOT_NULL(initial_connection_window_update_frame);
-    ASSERT_UINT_EQUALS(
-        AWS_H2_WINDOW_UPDATE_MAX - AWS_H2_INIT_WINDOW_SIZE,
-        initial_connection_window_update_frame->window_size_increment);
-
-    /* send request */
-    struct aws_http_message *request = aws_http2_message_new_request(allocator);
-    ASSERT_NOT_NULL(request);
+    const size_t num_frames_before_requests = h2_decode_tester_frame_count(&s_tester.peer.decode);
 
     struct aws_http_header request_headers_src[] = {
         DEFINE_HEADER(":method", "GET"),
         DEFINE_HEADER(":scheme", "https"),
         DEFINE_HEADER(":path", "/"),
     };
-    aws_http_message_add_header_array(request, request_headers_src, AWS_ARRAY_SIZE(request_headers_src));
-
-    struct client_stream_tester stream_tester;
-    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, request));
-    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
-    uint32_t stream_id = aws_http_stream_get_id(stream_tester.stream);
-
-    /* fake peer sends response headers */
+    /* response is entirely from the static table */
     struct aws_http_header response_headers_src[] = {
         DEFINE_HEADER(":status", "200"),
     };
-
     struct aws_http_headers *response_headers = aws_http_headers_new(allocator);
     aws_http_headers_add_array(response_headers, response_headers_src, AWS_ARRAY_SIZE(response_headers_src));
 
-    struct aws_h2_frame *response_frame =
-        aws_h2_frame_new_headers(allocator, stream_id, response_headers, false /*end_stream*/, 0, NULL);
-    ASSERT_SUCCESS(h2_fake_peer_send_frame(&s_tester.peer, response_frame));
+    /* usage is evaluated every 64 header-blocks received */
+    for (size_t i = 0; i < 64; ++i) {
+        struct aws_http_message *request = aws_http2_message_new_request(allocator);
+        ASSERT_NOT_NULL(request);
+        aws_http_message_add_header_array(request, request_headers_src, AWS_ARRAY_SIZE(request_headers_src));
 
-    /* fake peer sends 1 DATA frame */
-    const char *body_src = "hello";
-    ASSERT_SUCCESS(h2_fake_peer_send_data_frame_str(&s_tester.peer, stream_id, body_src, false /*end_stream*/));
+        struct client_stream_tester stream_tester;
+        ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, request));
+        testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+        uint32_t stream_id = aws_http_stream_get_id(stream_tester.stream);
 
-    /* check that 2 WINDOW_UPDATE frames have been sent.
-     * 1 for the connection, and 1 for the stream */
-    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
-    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+        struct aws_h2_frame *response_frame =
+            aws_h2_frame_new_headers(allocator, stream_id, response_headers, true /*end_stream*/, 0, NULL);
+        ASSERT_SUCCESS(h2_fake_peer_send_frame(&s_tester.peer, response_frame));
+        testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+        ASSERT_TRUE(stream_tester.complete);
 
-    struct h2_decoded_frame *stream_window_update_frame = h2_decode_tester_find_stream_frame(
-        &s_tester.peer.decode, AWS_H2_FRAME_T_WINDOW_UPDATE, stream_id, 0 /*idx*/, NULL);
-    ASSERT_NOT_NULL(stream_window_update_frame);
-    ASSERT_UINT_EQUALS(5, stream_window_update_frame->window_size_increment);
+        aws_http_message_release(request);
+        client_stream_tester_clean_up(&stream_tester);
+    }
 
-    struct h2_decoded_frame *connection_window_update_frame = h2_decode_tester_find_stream_frame(
-        &s_tester.peer.decode,
-        AWS_H2_FRAME_T_WINDOW_UPDATE,
-        0 /*stream_id*/,
-        initial_window_update_index + 1 /*idx*/,
-        NULL);
-    ASSERT_NOT_NULL(connection_window_update_frame);
-    ASSERT_UINT_EQUALS(5, connection_window_update_frame->window_size_increment);
+    /* the table went unused, so the connection offers the peer half the default size */
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+    struct h2_decoded_frame *settings_frame = h2_decode_tester_find_frame(
+        &s_tester.peer.decode, AWS_H2_FRAME_T_SETTINGS, num_frames_before_requests, NULL /*out_idx*/);
+    ASSERT_NOT_NULL(settings_frame);
+    ASSERT_FALSE(settings_frame->ack);
+    ASSERT_UINT_EQUALS(1, aws_array_list_length(&settings_frame->settings));
+    struct aws_http2_setting setting;
+    aws_array_list_get_at(&settings_frame->settings, &setting, 0);
+    ASSERT_INT_EQUALS(AWS_HTTP2_SETTINGS_HEADER_TABLE_SIZE, setting.id);
+    ASSERT_UINT_EQUALS(2048, setting.value);
+
+    /* the new size is in effect once the peer ACKs */
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&s_tester.peer, aws_h2_frame_new_settings(allocator, NULL, 0, true)));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    struct aws_http2_setting local_settings[AWS_HTTP2_SETTINGS_COUNT];
+    aws_http2_connection_get_local_settings(s_tester.connection, local_settings);
+    ASSERT_UINT_EQUALS(2048, local_settings[AWS_HTTP2_SETTINGS_HEADER_TABLE_SIZE - 1].value);
 
     /* clean up */
     aws_http_headers_release(response_headers);
-    aws_http_message_release(request);
-    client_stream_tester_clean_up(&stream_tester);
     return s_tester_clean_up();
 }
 
@@ -4173,6 +5434,60 @@ TEST_CASE(h2_client_send_ping_successfully_receive_ack) {
     return s_tester_clean_up();
 }
 
+/* Test that the connection estimates its round-trip time from SETTINGS and PING ACKs */
+TEST_CASE(h2_client_rtt_estimate) {
+
+    ASSERT_SUCCESS(s_tester_init(allocator, ctx));
+
+    /* no estimate until something is ACKed */
+    struct aws_http2_rtt_estimate estimate;
+    ASSERT_FAILS(aws_http2_connection_get_rtt_estimate(s_tester.connection, &estimate));
+    ASSERT_INT_EQUALS(AWS_ERROR_HTTP_DATA_NOT_AVAILABLE, aws_last_error());
+
+    /* peer ACKs the initial SETTINGS */
+    ASSERT_SUCCESS(h2_fake_peer_send_connection_preface_default_settings(&s_tester.peer));
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&s_tester.peer, aws_h2_frame_new_settings(allocator, NULL, 0, true)));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_SUCCESS(aws_http2_connection_get_rtt_estimate(s_tester.connection, &estimate));
+    ASSERT_UINT_EQUALS(1, estimate.sample_count);
+    ASSERT_UINT_EQUALS(estimate.latest_rtt_ns, estimate.smoothed_rtt_ns);
+    ASSERT_UINT_EQUALS(estimate.latest_rtt_ns / 2, estimate.rtt_variation_ns);
+    const uint64_t first_rtt_ns = estimate.latest_rtt_ns;
+
+    /* peer takes a while to ACK a PING */
+    ASSERT_SUCCESS(aws_http2_connection_ping(s_tester.connection, NULL, NULL /*on_completed*/, NULL /*user_data*/));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+    struct h2_decoded_frame *ping_frame =
+        h2_decode_tester_find_frame(&s_tester.peer.decode, AWS_H2_FRAME_T_PING, 0, NULL);
+    ASSERT_NOT_NULL(ping_frame);
+    const uint64_t delay_ns = aws_timestamp_convert(20, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+    aws_thread_current_sleep(delay_ns);
+    struct aws_h2_frame *peer_frame = aws_h2_frame_new_ping(allocator, true /*ACK*/, ping_frame->ping_opaque_data);
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&s_tester.peer, peer_frame));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+    /* the slow sample only moves the smoothed estimate 1/8th of the way */
+    ASSERT_SUCCESS(aws_http2_connection_get_rtt_estimate(s_tester.connection, &estimate));
+    ASSERT_UINT_EQUALS(2, estimate.sample_count);
+    ASSERT_TRUE(estimate.latest_rtt_ns >= delay_ns);
+    ASSERT_UINT_EQUALS(aws_min_u64(first_rtt_ns, estimate.latest_rtt_ns), estimate.min_rtt_ns);
+    ASSERT_UINT_EQUALS(first_rtt_ns - first_rtt_ns / 8 + estimate.latest_rtt_ns / 8, estimate.smoothed_rtt_ns);
+    ASSERT_TRUE(estimate.smoothed_rtt_ns < estimate.latest_rtt_ns);
+
+    /* and it's reported in the statistics */
+    struct aws_crt_statistics_http2_channel *stats = s_gather_statistics();
+    ASSERT_NOT_NULL(stats);
+    ASSERT_UINT_EQUALS(
+        aws_timestamp_convert(estimate.smoothed_rtt_ns, AWS_TIMESTAMP_NANOS, AWS_TIMESTAMP_MILLIS, NULL),
+        stats->smoothed_rtt_ms);
+    ASSERT_UINT_EQUALS(
+        aws_timestamp_convert(estimate.rtt_variation_ns, AWS_TIMESTAMP_NANOS, AWS_TIMESTAMP_MILLIS, NULL),
+        stats->rtt_variation_ms);
+
+    return s_tester_clean_up();
+}
+
 /* Test the user request a PING, but peer never sends PING ACK back */
 TEST_CASE(h2_client_send_ping_no_ack_received) {
 
@@ -5637,3 +6952,258 @@ TEST_CASE(h2_client_manual_data_write_connection_close) {
     aws_input_stream_release(data_stream);
     return s_tester_clean_up();
 }
+
+struct h2_client_zero_copy_write_ctx {
+    bool on_complete_called;
+    int on_complete_error_code;
+};
+
+static void s_on_zero_copy_write_complete(struct aws_http_stream *stream, int error_code, void *user_data) {
+    (void)stream;
+    struct h2_client_zero_copy_write_ctx *test_ctx = user_data;
+    test_ctx->on_complete_called = true;
+    test_ctx->on_complete_error_code = error_code;
+}
+
+/* A write with data_buffer should be sent from the user's memory, without copying it into a channel message */
+TEST_CASE(h2_client_manual_data_write_zero_copy) {
+
+    ASSERT_SUCCESS(s_tester_init(allocator, ctx));
+    /* get connection preface and acks out of the way */
+    ASSERT_SUCCESS(h2_fake_peer_send_connection_preface_default_settings(&s_tester.peer));
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+
+    struct aws_http_message *request = aws_http2_message_new_request(allocator);
+    ASSERT_NOT_NULL(request);
+
+    struct aws_http_header request_headers_src[] = {
+        DEFINE_HEADER(":method", "POST"),
+        DEFINE_HEADER(":scheme", "https"),
+        DEFINE_HEADER(":path", "/"),
+    };
+    aws_http_message_add_header_array(request, request_headers_src, AWS_ARRAY_SIZE(request_headers_src));
+    struct aws_http_make_request_options request_options = {
+        .self_size = sizeof(request_options),
+        .request = request,
+        .http2_use_manual_data_writes = true,
+    };
+    struct aws_http_stream *stream = aws_http_connection_make_request(s_tester.connection, &request_options);
+    ASSERT_NOT_NULL(stream);
+    aws_http_stream_activate(stream);
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+    /* bigger than a frame, smaller than the initial flow-control windows */
+    struct aws_byte_buf payload;
+    ASSERT_SUCCESS(aws_byte_buf_init(&payload, allocator, 40000));
+    while (payload.len < payload.capacity) {
+        aws_byte_buf_write_u8(&payload, (uint8_t)('a' + payload.len % 26));
+    }
+
+    /* Setting both data and data_buffer is not allowed */
+    struct aws_byte_cursor stream_data = aws_byte_cursor_from_c_str("x");
+    struct aws_input_stream *data_stream = aws_input_stream_new_from_cursor(allocator, &stream_data);
+    struct aws_http2_stream_write_data_options bad_write = {
+        .data = data_stream,
+        .data_buffer = aws_byte_cursor_from_buf(&payload),
+    };
+    ASSERT_FAILS(aws_http2_stream_write_data(stream, &bad_write));
+    ASSERT_INT_EQUALS(AWS_ERROR_INVALID_ARGUMENT, aws_last_error());
+    aws_input_stream_release(data_stream);
+
+    struct h2_client_zero_copy_write_ctx test_ctx = {0};
+    struct aws_http2_stream_write_data_options write = {
+        .data_buffer = aws_byte_cursor_from_buf(&payload),
+        .end_stream = true,
+        .on_complete = s_on_zero_copy_write_complete,
+        .user_data = &test_ctx,
+    };
+    ASSERT_SUCCESS(aws_http2_stream_write_data(stream, &write));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+    /* at least one written message should point straight into the user's buffer */
+    bool found_zero_copy_msg = false;
+    struct aws_linked_list *written_msgs = testing_channel_get_written_message_queue(&s_tester.testing_channel);
+    for (struct aws_linked_list_node *node = aws_linked_list_begin(written_msgs);
+         node != aws_linked_list_end(written_msgs);
+         node = aws_linked_list_next(node)) {
+        struct aws_io_message *msg = AWS_CONTAINER_OF(node, struct aws_io_message, queueing_handle);
+        if (msg->message_data.buffer >= payload.buffer && msg->message_data.buffer < payload.buffer + payload.len) {
+            found_zero_copy_msg = true;
+        }
+    }
+    ASSERT_TRUE(found_zero_copy_msg);
+
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+    ASSERT_SUCCESS(h2_decode_tester_check_data_across_frames(
+        &s_tester.peer.decode,
+        aws_http_stream_get_id(stream),
+        aws_byte_cursor_from_buf(&payload),
+        true /*end_stream*/));
+
+    ASSERT_TRUE(test_ctx.on_complete_called);
+    ASSERT_INT_EQUALS(AWS_ERROR_SUCCESS, test_ctx.on_complete_error_code);
+
+    aws_http_message_release(request);
+    aws_http_stream_release(stream);
+
+    /* close the connection */
+    aws_http_connection_close(s_tester.connection);
+
+    /* clean up */
+    aws_byte_buf_clean_up(&payload);
+    return s_tester_clean_up();
+}
+
+/* Payloads too small to be worth a message of their own are copied, so small writes share an aws_io_message */
+TEST_CASE(h2_client_manual_data_write_zero_copy_small_payloads) {
+
+    ASSERT_SUCCESS(s_tester_init(allocator, ctx));
+    /* get connection preface and acks out of the way */
+    ASSERT_SUCCESS(h2_fake_peer_send_connection_preface_default_settings(&s_tester.peer));
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+
+    struct aws_http_message *request = aws_http2_message_new_request(allocator);
+    ASSERT_NOT_NULL(request);
+
+    struct aws_http_header request_headers_src[] = {
+        DEFINE_HEADER(":method", "POST"),
+        DEFINE_HEADER(":scheme", "https"),
+        DEFINE_HEADER(":path", "/"),
+    };
+    aws_http_message_add_header_array(request, request_headers_src, AWS_ARRAY_SIZE(request_headers_src));
+    struct aws_http_make_request_options request_options = {
+        .self_size = sizeof(request_options),
+        .request = request,
+        .http2_use_manual_data_writes = true,
+    };
+    struct aws_http_stream *stream = aws_http_connection_make_request(s_tester.connection, &request_options);
+    ASSERT_NOT_NULL(stream);
+    aws_http_stream_activate(stream);
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+
+    enum { NUM_WRITES = 10, WRITE_SIZE = 100 };
+    struct aws_byte_buf payload;
+    ASSERT_SUCCESS(aws_byte_buf_init(&payload, allocator, NUM_WRITES * WRITE_SIZE));
+    while (payload.len < payload.capacity) {
+        aws_byte_buf_write_u8(&payload, (uint8_t)('a' + payload.len % 26));
+    }
+
+    struct h2_client_zero_copy_write_ctx test_ctxs[NUM_WRITES];
+    AWS_ZERO_ARRAY(test_ctxs);
+    for (size_t i = 0; i < NUM_WRITES; ++i) {
+        struct aws_http2_stream_write_data_options write = {
+            .data_buffer = aws_byte_cursor_from_array(payload.buffer + i * WRITE_SIZE, WRITE_SIZE),
+            .end_stream = i == NUM_WRITES - 1,
+            .on_complete = s_on_zero_copy_write_complete,
+            .user_data = &test_ctxs[i],
+        };
+        ASSERT_SUCCESS(aws_http2_stream_write_data(stream, &write));
+    }
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+    /* every write was copied into the same message */
+    ASSERT_UINT_EQUALS(1, s_written_message_count());
+    struct aws_linked_list *written_msgs = testing_channel_get_written_message_queue(&s_tester.testing_channel);
+    struct aws_io_message *msg =
+        AWS_CONTAINER_OF(aws_linked_list_front(written_msgs), struct aws_io_message, queueing_handle);
+    ASSERT_FALSE(msg->message_data.buffer >= payload.buffer && msg->message_data.buffer < payload.buffer + payload.len);
+
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+    ASSERT_SUCCESS(h2_decode_tester_check_data_across_frames(
+        &s_tester.peer.decode,
+        aws_http_stream_get_id(stream),
+        aws_byte_cursor_from_buf(&payload),
+        true /*end_stream*/));
+
+    for (size_t i = 0; i < NUM_WRITES; ++i) {
+        ASSERT_TRUE(test_ctxs[i].on_complete_called);
+        ASSERT_INT_EQUALS(AWS_ERROR_SUCCESS, test_ctxs[i].on_complete_error_code);
+    }
+
+    aws_http_message_release(request);
+    aws_http_stream_release(stream);
+
+    /* close the connection */
+    aws_http_connection_close(s_tester.connection);
+
+    /* clean up */
+    aws_byte_buf_clean_up(&payload);
+    return s_tester_clean_up();
+}
+
+static struct aws_http_message *s_new_extended_connect_request(struct aws_allocator *allocator) {
+    struct aws_http_message *request = aws_http2_message_new_request(allocator);
+    struct aws_http_header request_headers_src[] = {
+        DEFINE_HEADER(":method", "CONNECT"),
+        DEFINE_HEADER(":protocol", "websocket"),
+        DEFINE_HEADER(":scheme", "https"),
+        DEFINE_HEADER(":path", "/chat"),
+        DEFINE_HEADER(":authority", "example.com"),
+    };
+    aws_http_message_add_header_array(request, request_headers_src, AWS_ARRAY_SIZE(request_headers_src));
+    return request;
+}
+
+/* An extended CONNECT waits for peer's SETTINGS, and is sent once they enable it (RFC-8441 3) */
+TEST_CASE(h2_client_extended_connect_waits_for_settings) {
+    ASSERT_SUCCESS(s_tester_init(allocator, ctx));
+
+    struct aws_http_message *request = s_new_extended_connect_request(allocator);
+    ASSERT_NOT_NULL(request);
+    struct client_stream_tester stream_tester;
+    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, request));
+
+    /* Nothing but the connection preface goes out before peer's SETTINGS arrive */
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+    ASSERT_NULL(h2_decode_tester_find_frame(&s_tester.peer.decode, AWS_H2_FRAME_T_HEADERS, 0, NULL));
+    ASSERT_FALSE(stream_tester.complete);
+    ASSERT_FALSE(aws_http2_connection_get_remote_enable_connect_protocol(s_tester.connection));
+
+    struct aws_http2_setting settings_array[] = {
+        {.id = AWS_HTTP2_SETTINGS_ENABLE_CONNECT_PROTOCOL, .value = 1},
+    };
+    struct aws_h2_frame *settings =
+        aws_h2_frame_new_settings(allocator, settings_array, AWS_ARRAY_SIZE(settings_array), false /*ack*/);
+    ASSERT_NOT_NULL(settings);
+    ASSERT_SUCCESS(h2_fake_peer_send_connection_preface(&s_tester.peer, settings));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+    struct h2_decoded_frame *sent_headers_frame =
+        h2_decode_tester_find_frame(&s_tester.peer.decode, AWS_H2_FRAME_T_HEADERS, 0, NULL);
+    ASSERT_NOT_NULL(sent_headers_frame);
+    ASSERT_SUCCESS(s_compare_headers(aws_http_message_get_headers(request), sent_headers_frame->headers));
+    ASSERT_FALSE(stream_tester.complete);
+
+    ASSERT_TRUE(aws_http2_connection_get_remote_enable_connect_protocol(s_tester.connection));
+    ASSERT_FALSE(aws_http2_connection_get_local_enable_connect_protocol(s_tester.connection));
+
+    aws_http_message_release(request);
+    client_stream_tester_clean_up(&stream_tester);
+    return s_tester_clean_up();
+}
+
+/* If peer's SETTINGS don't enable extended CONNECT, the stream fails without being sent */
+TEST_CASE(h2_client_extended_connect_not_supported) {
+    ASSERT_SUCCESS(s_tester_init(allocator, ctx));
+
+    struct aws_http_message *request = s_new_extended_connect_request(allocator);
+    ASSERT_NOT_NULL(request);
+    struct client_stream_tester stream_tester;
+    ASSERT_SUCCESS(s_stream_tester_init(&stream_tester, request));
+
+    ASSERT_SUCCESS(h2_fake_peer_send_connection_preface_default_settings(&s_tester.peer));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+    ASSERT_TRUE(stream_tester.complete);
+    ASSERT_INT_EQUALS(AWS_ERROR_HTTP_EXTENDED_CONNECT_NOT_SUPPORTED, stream_tester.on_complete_error_code);
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+    ASSERT_NULL(h2_decode_tester_find_frame(&s_tester.peer.decode, AWS_H2_FRAME_T_HEADERS, 0, NULL));
+    ASSERT_TRUE(aws_http_connection_is_open(s_tester.connection));
+
+    aws_http_message_release(request);
+    client_stream_tester_clean_up(&stream_tester);
+    return s_tester_clean_up();
+}
@@ -0,0 +1,102 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/private/h2_closed_streams.h>
+
+#include <aws/testing/aws_test_harness.h>
+
+/* Check the index against the ring: every recorded stream has exactly one index entry,
+ * that entry points at the stream's ring slot and is reachable by find, and nothing else is indexed */
+static int s_check_index_matches_ring(const struct aws_h2_closed_streams *closed_streams) {
+    size_t recorded = 0;
+    for (size_t i = 0; i < closed_streams->ring_capacity; ++i) {
+        const struct aws_h2_closed_stream *record = &closed_streams->ring[i];
+        if (record->stream_id != 0) {
+            recorded++;
+            ASSERT_PTR_EQUALS(record, aws_h2_closed_streams_find(closed_streams, record->stream_id));
+        }
+    }
+    ASSERT_UINT_EQUALS(recorded, closed_streams->index_count);
+
+    size_t indexed = 0;
+    for (size_t i = 0; i < closed_streams->index_capacity; ++i) {
+        const struct aws_h2_closed_streams_index_slot *slot = &closed_streams->index[i];
+        if (slot->stream_id != 0) {
+            indexed++;
+            ASSERT_TRUE(slot->ring_slot < closed_streams->ring_capacity);
+            ASSERT_UINT_EQUALS(slot->stream_id, closed_streams->ring[slot->ring_slot].stream_id);
+        }
+    }
+    ASSERT_UINT_EQUALS(recorded, indexed);
+    return AWS_OP_SUCCESS;
+}
+
+static int s_h2_closed_streams_evicts_oldest_fn(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    const size_t capacity = 8;
+    struct aws_h2_closed_streams closed_streams;
+    ASSERT_SUCCESS(aws_h2_closed_streams_init(&closed_streams, allocator, capacity));
+    ASSERT_NULL(aws_h2_closed_streams_find(&closed_streams, 1));
+    ASSERT_SUCCESS(s_check_index_matches_ring(&closed_streams));
+
+    /* Mix client and server ids, and ids that share a home slot in the index, so probe chains get long
+     * and evictions remove entries from the middle of them */
+    const uint32_t stride = (uint32_t)closed_streams.index_capacity * 2 * 100;
+    uint32_t ids[200];
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(ids); ++i) {
+        ids[i] = (uint32_t)(i / 4) * 2 + 1 + (uint32_t)(i % 4) * stride + (uint32_t)(i % 2);
+    }
+
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(ids); ++i) {
+        aws_h2_closed_streams_add(&closed_streams, ids[i], (uint8_t)(i % 4));
+        ASSERT_SUCCESS(s_check_index_matches_ring(&closed_streams));
+
+        /* Only the most recent `capacity` streams are remembered */
+        for (size_t j = 0; j <= i; ++j) {
+            const struct aws_h2_closed_stream *found = aws_h2_closed_streams_find(&closed_streams, ids[j]);
+            if (j + capacity > i) {
+                ASSERT_NOT_NULL(found);
+                ASSERT_UINT_EQUALS(ids[j], found->stream_id);
+                ASSERT_UINT_EQUALS(j % 4, found->closed_when);
+            } else {
+                ASSERT_NULL(found);
+            }
+        }
+    }
+    ASSERT_UINT_EQUALS(capacity, closed_streams.index_count);
+
+    aws_h2_closed_streams_clean_up(&closed_streams);
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(h2_closed_streams_evicts_oldest, s_h2_closed_streams_evicts_oldest_fn)
+
+/* Recording a stream-id that's already recorded replaces the old record instead of keeping both */
+static int s_h2_closed_streams_add_again_fn(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct aws_h2_closed_streams closed_streams;
+    ASSERT_SUCCESS(aws_h2_closed_streams_init(&closed_streams, allocator, 4));
+
+    aws_h2_closed_streams_add(&closed_streams, 1, 1);
+    aws_h2_closed_streams_add(&closed_streams, 3, 1);
+    aws_h2_closed_streams_add(&closed_streams, 1, 2);
+    ASSERT_SUCCESS(s_check_index_matches_ring(&closed_streams));
+    ASSERT_UINT_EQUALS(2, closed_streams.index_count);
+    ASSERT_UINT_EQUALS(2, aws_h2_closed_streams_find(&closed_streams, 1)->closed_when);
+
+    /* Overwriting the emptied slot, and later the slot holding the new record, must keep the index consistent */
+    for (uint32_t id = 5; id < 20; id += 2) {
+        aws_h2_closed_streams_add(&closed_streams, id, 3);
+        ASSERT_SUCCESS(s_check_index_matches_ring(&closed_streams));
+    }
+    ASSERT_NULL(aws_h2_closed_streams_find(&closed_streams, 1));
+    ASSERT_NULL(aws_h2_closed_streams_find(&closed_streams, 3));
+    ASSERT_NOT_NULL(aws_h2_closed_streams_find(&closed_streams, 19));
+
+    aws_h2_closed_streams_clean_up(&closed_streams);
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(h2_closed_streams_add_again, s_h2_closed_streams_add_again_fn)
@@ -15,6 +15,9 @@ struct fixture {
 
     bool is_server;
     bool skip_connection_preface;
+
+    /* If true, decoder delivers each HEADERS header-block via a single on_headers_block() */
+    bool collect_header_blocks;
 };
 
 static int s_fixture_init(struct fixture *fixture, struct aws_allocator *allocator) {
@@ -24,6 +27,7 @@ static int s_fixture_init(struct fixture *fixture, struct aws_allocator *allocat
         .alloc = allocator,
         .is_server = fixture->is_server,
         .skip_connection_preface = fixture->skip_connection_preface,
+        .collect_header_blocks = fixture->collect_header_blocks,
     };
     ASSERT_SUCCESS(h2_decode_tester_init(&fixture->decode, &options));
 
@@ -63,16 +67,18 @@ static int s_fixture_test_teardown(struct aws_allocator *allocator, int setup_re
 /* declare 2 tests, where:
  * 1) NAME runs the decoder over input all at once
  * 2) NAME_one_byte_at_a_time runs the decoder on one byte of input at a time. */
-#define H2_DECODER_TEST_CASE_IMPL(NAME, IS_SERVER, SKIP_PREFACE)                                                       \
+#define H2_DECODER_TEST_CASE_IMPL(NAME, IS_SERVER, SKIP_PREFACE, COLLECT_HEADER_BLOCKS)                                \
     static struct fixture s_fixture_##NAME = {                                                                         \
         .is_server = (IS_SERVER),                                                                                      \
         .skip_connection_preface = (SKIP_PREFACE),                                                                     \
+        .collect_header_blocks = (COLLECT_HEADER_BLOCKS),                                                              \
     };                                                                                                                 \
     AWS_TEST_CASE_FIXTURE(NAME, s_fixture_test_setup, s_test_##NAME, s_fixture_test_teardown, &s_fixture_##NAME);      \
     static struct fixture s_fixture_##NAME##_one_byte_at_a_time = {                                                    \
         .one_byte_at_a_time = true,                                                                                    \
         .is_server = (IS_SERVER),                                                                                      \
         .skip_connection_preface = (SKIP_PREFACE),                                                                     \
+        .collect_header_blocks = (COLLECT_HEADER_BLOCKS),                                                              \
     };                                                                                                                 \
     AWS_TEST_CASE_FIXTURE(                                                                                             \
         NAME##_one_byte_at_a_time,                                                                                     \
@@ -82,10 +88,16 @@ static int s_fixture_test_teardown(struct aws_allocator *allocator, int setup_re
         &s_fixture_##NAME##_one_byte_at_a_time)                                                                        \
     static int s_test_##NAME(struct aws_allocator *allocator, void *ctx)
 
-#define H2_DECODER_ON_CLIENT_TEST(NAME) H2_DECODER_TEST_CASE_IMPL(NAME, false /*server*/, true /*skip_preface*/)
-#define H2_DECODER_ON_SERVER_TEST(NAME) H2_DECODER_TEST_CASE_IMPL(NAME, true /*server*/, true /*skip_preface*/)
-#define H2_DECODER_ON_CLIENT_PREFACE_TEST(NAME) H2_DECODER_TEST_CASE_IMPL(NAME, false, false)
-#define H2_DECODER_ON_SERVER_PREFACE_TEST(NAME) H2_DECODER_TEST_CASE_IMPL(NAME, true, false)
+#define H2_DECODER_ON_CLIENT_TEST(NAME)                                                                                \
+    H2_DECODER_TEST_CASE_IMPL(NAME, false /*server*/, true /*skip_preface*/, false /*collect*/)
+#define H2_DECODER_ON_SERVER_TEST(NAME)                                                                                \
+    H2_DECODER_TEST_CASE_IMPL(NAME, true /*server*/, true /*skip_preface*/, false /*collect*/)
+#define H2_DECODER_ON_CLIENT_PREFACE_TEST(NAME) H2_DECODER_TEST_CASE_IMPL(NAME, false, false, false)
+#define H2_DECODER_ON_SERVER_PREFACE_TEST(NAME) H2_DECODER_TEST_CASE_IMPL(NAME, true, false, false)
+#define H2_DECODER_ON_CLIENT_COLLECTING_TEST(NAME)                                                                     \
+    H2_DECODER_TEST_CASE_IMPL(NAME, false /*server*/, true /*skip_preface*/, true /*collect*/)
+#define H2_DECODER_ON_SERVER_COLLECTING_TEST(NAME)                                                                     \
+    H2_DECODER_TEST_CASE_IMPL(NAME, true /*server*/, true /*skip_preface*/, true /*collect*/)
 
 /* Make sure fixture works */
 TEST_CASE(h2_decoder_sanity_check) {
@@ -147,6 +159,70 @@ H2_DECODER_ON_CLIENT_TEST(h2_decoder_data) {
     return AWS_OP_SUCCESS;
 }
 
+/* Back-to-back DATA frames in one buffer must each be delivered, whether or not they can skip the state machine */
+H2_DECODER_ON_CLIENT_TEST(h2_decoder_data_consecutive_frames) {
+    (void)allocator;
+    struct fixture *fixture = ctx;
+
+    /* clang-format off */
+    uint8_t input[] = {
+        0x00, 0x00, 0x05,           /* Length (24) */
+        AWS_H2_FRAME_T_DATA,        /* Type (8) */
+        0x0,                        /* Flags (8) */
+        0x00, 0x00, 0x00, 0x01,     /* Reserved (1) | Stream Identifier (31) */
+        'h', 'e', 'l', 'l', 'o',    /* Data (*) */
+
+        0x00, 0x00, 0x00,           /* Length (24) */
+        AWS_H2_FRAME_T_DATA,        /* Type (8) */
+        AWS_H2_FRAME_F_END_STREAM,  /* Flags (8) */
+        0x80, 0x00, 0x00, 0x03,     /* Reserved (1) | Stream Identifier (31) */
+
+        0x00, 0x00, 0x07,           /* Length (24) */
+        AWS_H2_FRAME_T_DATA,        /* Type (8) */
+        AWS_H2_FRAME_F_PADDED | AWS_H2_FRAME_F_END_STREAM, /* Flags (8) */
+        0x00, 0x00, 0x00, 0x01,     /* Reserved (1) | Stream Identifier (31) */
+        0x01,                       /* Pad Length (8)                           - F_PADDED */
+        'w', 'o', 'r', 'l', 'd',    /* Data (*) */
+        0x00,                       /* Padding (*)                              - F_PADDED */
+
+        0x00, 0x00, 0x03,           /* Length (24) */
+        AWS_H2_FRAME_T_DATA,        /* Type (8) */
+        AWS_H2_FRAME_F_END_STREAM,  /* Flags (8) */
+        0x00, 0x00, 0x00, 0x05,     /* Reserved (1) | Stream Identifier (31) */
+        'e', 'n', 'd',              /* Data (*) */
+    };
+    /* clang-format on */
+
+    ASSERT_H2ERR_SUCCESS(s_decode_all(fixture, aws_byte_cursor_from_array(input, sizeof(input))));
+
+    /* Validate. */
+    ASSERT_UINT_EQUALS(4, h2_decode_tester_frame_count(&fixture->decode));
+
+    struct h2_decoded_frame *frame = h2_decode_tester_get_frame(&fixture->decode, 0);
+    ASSERT_SUCCESS(h2_decoded_frame_check_finished(frame, AWS_H2_FRAME_T_DATA, 1 /*stream_id*/));
+    ASSERT_UINT_EQUALS(5, frame->data_payload_len);
+    ASSERT_FALSE(frame->end_stream);
+    ASSERT_TRUE(aws_byte_buf_eq_c_str(&frame->data, "hello"));
+
+    frame = h2_decode_tester_get_frame(&fixture->decode, 1);
+    ASSERT_SUCCESS(h2_decoded_frame_check_finished(frame, AWS_H2_FRAME_T_DATA, 3 /*stream_id*/));
+    ASSERT_UINT_EQUALS(0, frame->data.len);
+    ASSERT_TRUE(frame->end_stream);
+
+    frame = h2_decode_tester_get_frame(&fixture->decode, 2);
+    ASSERT_SUCCESS(h2_decoded_frame_check_finished(frame, AWS_H2_FRAME_T_DATA, 1 /*stream_id*/));
+    ASSERT_UINT_EQUALS(7, frame->data_payload_len);
+    ASSERT_TRUE(frame->end_stream);
+    ASSERT_TRUE(aws_byte_buf_eq_c_str(&frame->data, "world"));
+
+    frame = h2_decode_tester_get_frame(&fixture->decode, 3);
+    ASSERT_SUCCESS(h2_decoded_frame_check_finished(frame, AWS_H2_FRAME_T_DATA, 5 /*stream_id*/));
+    ASSERT_UINT_EQUALS(3, frame->data_payload_len);
+    ASSERT_TRUE(frame->end_stream);
+    ASSERT_TRUE(aws_byte_buf_eq_c_str(&frame->data, "end"));
+    return AWS_OP_SUCCESS;
+}
+
 /* Test padded DATA frame */
 H2_DECODER_ON_CLIENT_TEST(h2_decoder_data_padded) {
     (void)allocator;
@@ -636,6 +712,55 @@ H2_DECODER_ON_SERVER_TEST(h2_decoder_headers_request) {
     return AWS_OP_SUCCESS;
 }
 
+/* Pseudo-header values bigger than the decoder's initial buffer for them must still be delivered intact */
+H2_DECODER_ON_SERVER_TEST(h2_decoder_headers_request_long_path) {
+    struct fixture *fixture = ctx;
+
+    char path[301];
+    path[0] = '/';
+    memset(path + 1, 'a', sizeof(path) - 2);
+    path[sizeof(path) - 1] = '\0';
+
+    /* clang-format off */
+    uint8_t prefix[] = {
+        0x00, 0x01, 0x3e,               /* Length (24) */
+        AWS_H2_FRAME_T_HEADERS,         /* Type (8) */
+        AWS_H2_FRAME_F_END_HEADERS | AWS_H2_FRAME_F_END_STREAM, /* Flags (8) */
+        0x00, 0x00, 0x00, 0x01,         /* Reserved (1) | Stream Identifier (31) */
+        /* HEADERS */
+        0x82,                           /* ":method: GET" - indexed */
+        0x86,                           /* ":scheme: http" - indexed */
+        0x44, 0x7f, 0xad, 0x01,         /* ":path: /aaa..." - indexed name, 300 byte uncompressed value follows */
+    };
+    uint8_t suffix[] = {
+        0x41, 10, 'a', 'm', 'a', 'z', 'o', 'n', '.', 'c', 'o', 'm', /* ":authority: amazon.com" - indexed name */
+    };
+    /* clang-format on */
+
+    struct aws_byte_buf input;
+    ASSERT_SUCCESS(aws_byte_buf_init(&input, allocator, 512));
+    ASSERT_TRUE(aws_byte_buf_write(&input, prefix, sizeof(prefix)));
+    ASSERT_TRUE(aws_byte_buf_write(&input, (const uint8_t *)path, sizeof(path) - 1));
+    ASSERT_TRUE(aws_byte_buf_write(&input, suffix, sizeof(suffix)));
+    ASSERT_UINT_EQUALS(AWS_H2_FRAME_PREFIX_SIZE + 0x13e, input.len);
+
+    /* Decode */
+    ASSERT_H2ERR_SUCCESS(s_decode_all(fixture, aws_byte_cursor_from_buf(&input)));
+
+    /* Validate */
+    struct h2_decoded_frame *frame = h2_decode_tester_latest_frame(&fixture->decode);
+    ASSERT_SUCCESS(h2_decoded_frame_check_finished(frame, AWS_H2_FRAME_T_HEADERS, 1 /*stream_id*/));
+    ASSERT_FALSE(frame->headers_malformed);
+    ASSERT_UINT_EQUALS(4, aws_http_headers_count(frame->headers));
+    ASSERT_SUCCESS(s_check_header(frame, 0, ":method", "GET", AWS_HTTP_HEADER_COMPRESSION_USE_CACHE));
+    ASSERT_SUCCESS(s_check_header(frame, 1, ":scheme", "http", AWS_HTTP_HEADER_COMPRESSION_USE_CACHE));
+    ASSERT_SUCCESS(s_check_header(frame, 2, ":authority", "amazon.com", AWS_HTTP_HEADER_COMPRESSION_USE_CACHE));
+    ASSERT_SUCCESS(s_check_header(frame, 3, ":path", path, AWS_HTTP_HEADER_COMPRESSION_USE_CACHE));
+
+    aws_byte_buf_clean_up(&input);
+    return AWS_OP_SUCCESS;
+}
+
 H2_DECODER_ON_SERVER_TEST(h2_decoder_headers_cookies) {
     (void)allocator;
     struct fixture *fixture = ctx;
@@ -681,6 +806,101 @@ H2_DECODER_ON_SERVER_TEST(h2_decoder_headers_cookies) {
     return AWS_OP_SUCCESS;
 }
 
+/* With collect_header_blocks, every header-field in a block spanning CONTINUATION frames
+ * (including buffered pseudo-headers and the concatenated cookie) arrives in one callback */
+H2_DECODER_ON_SERVER_COLLECTING_TEST(h2_decoder_headers_block_collected) {
+    (void)allocator;
+    struct fixture *fixture = ctx;
+
+    /* clang-format off */
+    uint8_t input[] = {
+        /* HEADERS FRAME*/
+        0x00, 0x00, 0x06,           /* Length (24) */
+        AWS_H2_FRAME_T_HEADERS,     /* Type (8) */
+        AWS_H2_FRAME_F_END_STREAM,  /* Flags (8) */
+        0x76, 0x54, 0x32, 0x10,     /* Reserved (1) | Stream Identifier (31) */
+        /* HEADERS */
+        0x82,                       /* ":method: GET" - indexed */
+        0x60, 0x03, 'a', '=', 'b',  /* "cache: a=b" - indexed name, uncompressed value */
+
+        /* CONTINUATION FRAME*/
+        0x00, 0x00, 16,             /* Length (24) */
+        AWS_H2_FRAME_T_CONTINUATION,/* Type (8) */
+        AWS_H2_FRAME_F_END_HEADERS, /* Flags (8) */
+        0x76, 0x54, 0x32, 0x10,     /* Reserved (1) | Stream Identifier (31) */
+        /* PAYLOAD */
+        0x7a, 0x04, 't', 'e', 's', 't',  /* "user-agent: test" - indexed name, uncompressed value */
+        0x60, 0x03, 'c', '=', 'd',  /* "cache: c=d" - indexed name, uncompressed value */
+        0x60, 0x03, 'e', '=', 'f',  /* "cache: e=f" - indexed name, uncompressed value */
+
+        /* Second HEADERS FRAME on another stream, arena is reused */
+        0x00, 0x00, 0x07,           /* Length (24) */
+        AWS_H2_FRAME_T_HEADERS,     /* Type (8) */
+        AWS_H2_FRAME_F_END_HEADERS | AWS_H2_FRAME_F_END_STREAM, /* Flags (8) */
+        0x00, 0x00, 0x00, 0x03,     /* Reserved (1) | Stream Identifier (31) */
+        /* HEADERS */
+        0x82,                       /* ":method: GET" - indexed */
+        0x7a, 0x04, 'a', 'b', 'c', 'd',  /* "user-agent: abcd" - indexed name, uncompressed value */
+    };
+    /* clang-format on */
+
+    /* Decode */
+    ASSERT_H2ERR_SUCCESS(s_decode_all(fixture, aws_byte_cursor_from_array(input, sizeof(input))));
+
+    /* Validate */
+    ASSERT_UINT_EQUALS(2, h2_decode_tester_frame_count(&fixture->decode));
+
+    struct h2_decoded_frame *frame = h2_decode_tester_get_frame(&fixture->decode, 0);
+    ASSERT_SUCCESS(h2_decoded_frame_check_finished(frame, AWS_H2_FRAME_T_HEADERS, 0x76543210 /*stream_id*/));
+    ASSERT_FALSE(frame->headers_malformed);
+    ASSERT_UINT_EQUALS(1, frame->header_block_callback_count);
+    ASSERT_UINT_EQUALS(3, aws_http_headers_count(frame->headers));
+    ASSERT_SUCCESS(s_check_header(frame, 0, ":method", "GET", AWS_HTTP_HEADER_COMPRESSION_USE_CACHE));
+    ASSERT_SUCCESS(s_check_header(frame, 1, "user-agent", "test", AWS_HTTP_HEADER_COMPRESSION_USE_CACHE));
+    ASSERT_SUCCESS(s_check_header(frame, 2, "cookie", "a=b; c=d; e=f", AWS_HTTP_HEADER_COMPRESSION_USE_CACHE));
+    ASSERT_INT_EQUALS(AWS_HTTP_HEADER_BLOCK_MAIN, frame->header_block_type);
+    ASSERT_TRUE(frame->end_stream);
+
+    frame = h2_decode_tester_get_frame(&fixture->decode, 1);
+    ASSERT_SUCCESS(h2_decoded_frame_check_finished(frame, AWS_H2_FRAME_T_HEADERS, 3 /*stream_id*/));
+    ASSERT_UINT_EQUALS(1, frame->header_block_callback_count);
+    ASSERT_UINT_EQUALS(2, aws_http_headers_count(frame->headers));
+    ASSERT_SUCCESS(s_check_header(frame, 0, ":method", "GET", AWS_HTTP_HEADER_COMPRESSION_USE_CACHE));
+    ASSERT_SUCCESS(s_check_header(frame, 1, "user-agent", "abcd", AWS_HTTP_HEADER_COMPRESSION_USE_CACHE));
+
+    return AWS_OP_SUCCESS;
+}
+
+/* With collect_header_blocks, a malformed header-block is reported in on_headers_end() without being delivered */
+H2_DECODER_ON_CLIENT_COLLECTING_TEST(h2_decoder_malformed_headers_block_not_delivered) {
+    (void)allocator;
+    struct fixture *fixture = ctx;
+
+    /* clang-format off */
+    uint8_t input[] = {
+        0x00, 0x00, 0x09,               /* Length (24) */
+        AWS_H2_FRAME_T_HEADERS,         /* Type (8) */
+        AWS_H2_FRAME_F_END_HEADERS | AWS_H2_FRAME_F_END_STREAM, /* Flags (8) */
+        0x76, 0x54, 0x32, 0x10,         /* Reserved (1) | Stream Identifier (31) */
+        /* HEADERS */
+        0x48, 0x03, '3', '0', '2',      /* ":status: 302" - indexed name, uncompressed value */
+        0x40, 0x00, 0x01, 'a',          /* ": a" - literal blank name, uncompressed value */
+    };
+    /* clang-format on */
+
+    /* Decode */
+    ASSERT_H2ERR_SUCCESS(s_decode_all(fixture, aws_byte_cursor_from_array(input, sizeof(input))));
+
+    /* Validate */
+    struct h2_decoded_frame *frame = h2_decode_tester_latest_frame(&fixture->decode);
+    ASSERT_SUCCESS(h2_decoded_frame_check_finished(frame, AWS_H2_FRAME_T_HEADERS, 0x76543210 /*stream_id*/));
+    ASSERT_TRUE(frame->headers_malformed);
+    ASSERT_UINT_EQUALS(0, frame->header_block_callback_count);
+    ASSERT_UINT_EQUALS(0, aws_http_headers_count(frame->headers));
+    ASSERT_TRUE(frame->end_stream);
+    return AWS_OP_SUCCESS;
+}
+
 /* A trailing header has no pseudo-headers, and always ends the stream */
 H2_DECODER_ON_CLIENT_TEST(h2_decoder_headers_trailer) {
     (void)allocator;
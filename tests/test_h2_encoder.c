@@ -247,6 +247,66 @@ TEST_CASE(h2_encoder_headers) {
     return AWS_OP_SUCCESS;
 }
 
+/* When the output has plenty of room, the header-block is HPACK-encoded straight into it.
+ * The bytes must be the same as when it goes through the intermediate buffer */
+TEST_CASE(h2_encoder_headers_direct) {
+    (void)ctx;
+
+    struct aws_http_headers *headers = aws_http_headers_new(allocator);
+    ASSERT_NOT_NULL(headers);
+
+    struct aws_http_header h = DEFINE_STATIC_HEADER(":status", "302", USE_CACHE);
+    ASSERT_SUCCESS(aws_http_headers_add_header(headers, &h));
+
+    struct aws_h2_frame_priority_settings priority = {
+        .stream_dependency_exclusive = true,
+        .stream_dependency = 0x01234567,
+        .weight = 9,
+    };
+
+    struct aws_h2_frame *frame = aws_h2_frame_new_headers(
+        allocator, 0x76543210 /*stream_id*/, headers, true /*end_stream*/, 2 /*pad_length*/, &priority);
+    ASSERT_NOT_NULL(frame);
+    const size_t memory_size = frame->memory_size;
+
+    /* clang-format off */
+    uint8_t expected[] = {
+        0x00, 0x00, 12,             /* Length (24) */
+        AWS_H2_FRAME_T_HEADERS,     /* Type (8) */
+        AWS_H2_FRAME_F_END_STREAM | AWS_H2_FRAME_F_END_HEADERS | AWS_H2_FRAME_F_PADDED | AWS_H2_FRAME_F_PRIORITY, /* Flags (8) */
+        0x76, 0x54, 0x32, 0x10,     /* Reserved (1) | Stream Identifier (31) */
+        /* HEADERS */
+        0x02,                       /* Pad Length (8)                           - F_PADDED */
+        0x81, 0x23, 0x45, 0x67,     /* Exclusive (1) | Stream Dependency (31)   - F_PRIORITY*/
+        0x09,                       /* Weight (8)                               - F_PRIORITY */
+        0x48, 0x82, 0x64, 0x02,     /* ":status: 302" - indexed name, huffman-compressed value */
+        0x00, 0x00                  /* Padding (*)                              - F_PADDED */
+    };
+    /* clang-format on */
+
+    struct aws_h2_frame_encoder encoder;
+    ASSERT_SUCCESS(aws_h2_frame_encoder_init(&encoder, allocator, NULL /*logging_id*/));
+
+    /* Start partway into the buffer, like a message that already holds other frames */
+    struct aws_byte_buf buffer;
+    ASSERT_SUCCESS(aws_byte_buf_init(&buffer, allocator, 1024));
+    ASSERT_TRUE(aws_byte_buf_write_u8_n(&buffer, 0xFF, 3));
+
+    bool frame_complete;
+    ASSERT_SUCCESS(aws_h2_encode_frame(&encoder, frame, &buffer, &frame_complete));
+    ASSERT_TRUE(frame_complete);
+    ASSERT_BIN_ARRAYS_EQUALS(expected, sizeof(expected), buffer.buffer + 3, buffer.len - 3);
+
+    /* No intermediate buffer was needed */
+    ASSERT_UINT_EQUALS(memory_size, frame->memory_size);
+
+    aws_byte_buf_clean_up(&buffer);
+    aws_h2_frame_encoder_clean_up(&encoder);
+    aws_h2_frame_destroy(frame);
+    aws_http_headers_release(headers);
+    return AWS_OP_SUCCESS;
+}
+
 TEST_CASE(h2_encoder_priority) {
     (void)ctx;
 
@@ -469,3 +529,66 @@ TEST_CASE(h2_encoder_window_update) {
     aws_h2_frame_destroy(frame);
     return AWS_OP_SUCCESS;
 }
+
+/* Frames allocated from a frame pool should reuse memory once freed, and still encode correctly */
+TEST_CASE(h2_encoder_frame_pool) {
+    (void)ctx;
+    struct aws_h2_frame_pool pool;
+    ASSERT_SUCCESS(aws_h2_frame_pool_init(&pool, allocator));
+
+    struct aws_h2_frame *frame = aws_h2_frame_new_window_update(&pool.allocator, 1 /*stream_id*/, 1 /*increment*/);
+    ASSERT_NOT_NULL(frame);
+    void *first_frame_memory = frame;
+    ASSERT_UINT_EQUALS(0, pool.cached_bytes);
+    aws_h2_frame_destroy(frame);
+    ASSERT_TRUE(pool.cached_bytes > 0);
+
+    /* a freed block is reused for the next frame of similar size */
+    frame = aws_h2_frame_new_window_update(&pool.allocator, 2 /*stream_id*/, 0x7FFFFFFF /*increment*/);
+    ASSERT_NOT_NULL(frame);
+    ASSERT_PTR_EQUALS(first_frame_memory, frame);
+    ASSERT_UINT_EQUALS(0, pool.cached_bytes);
+
+    /* clang-format off */
+    uint8_t expected[] = {
+        0x00, 0x00, 0x04,           /* Length (24) */
+        AWS_H2_FRAME_T_WINDOW_UPDATE,/* Type (8) */
+        0x0,                        /* Flags (8) */
+        0x00, 0x00, 0x00, 0x02,     /* Reserved (1) | Stream Identifier (31) */
+        0x7F, 0xFF, 0xFF, 0xFF,     /* Reserved (1) | Window Size Increment (31) */
+    };
+    /* clang-format on */
+    ASSERT_SUCCESS(s_encode_frame(allocator, frame, expected, sizeof(expected)));
+    aws_h2_frame_destroy(frame);
+
+    /* allocations too big for any size class go straight to the parent allocator */
+    struct aws_byte_buf big_debug_data;
+    ASSERT_SUCCESS(aws_byte_buf_init(&big_debug_data, allocator, 4096));
+    ASSERT_TRUE(aws_byte_buf_write_u8_n(&big_debug_data, 'a', big_debug_data.capacity));
+    frame = aws_h2_frame_new_goaway(
+        &pool.allocator, 1 /*last_stream_id*/, AWS_HTTP2_ERR_NO_ERROR, aws_byte_cursor_from_buf(&big_debug_data));
+    ASSERT_NOT_NULL(frame);
+    aws_h2_frame_destroy(frame);
+    aws_byte_buf_clean_up(&big_debug_data);
+
+    /* only so many freed blocks are kept per size class */
+    struct aws_h2_frame *frames[AWS_H2_FRAME_POOL_MAX_FREE_BLOCKS * 2];
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(frames); ++i) {
+        frames[i] = aws_h2_frame_new_window_update(&pool.allocator, 1 /*stream_id*/, 1 /*increment*/);
+        ASSERT_NOT_NULL(frames[i]);
+    }
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(frames); ++i) {
+        aws_h2_frame_destroy(frames[i]);
+    }
+    size_t cached_blocks = 0;
+    for (size_t i = 0; i < AWS_H2_FRAME_POOL_SIZE_CLASS_COUNT; ++i) {
+        ASSERT_TRUE(pool.size_classes[i].free_count <= AWS_H2_FRAME_POOL_MAX_FREE_BLOCKS);
+        cached_blocks += pool.size_classes[i].free_count;
+    }
+    ASSERT_TRUE(cached_blocks > 0);
+    ASSERT_TRUE(pool.cached_bytes >= cached_blocks * AWS_H2_FRAME_POOL_MIN_BLOCK_SIZE);
+
+    /* the test allocator reports a leak if clean up misses any cached block */
+    aws_h2_frame_pool_clean_up(&pool);
+    return AWS_OP_SUCCESS;
+}
@@ -0,0 +1,219 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/common/hash_table.h>
+#include <aws/http/private/h2_stream_table.h>
+
+#include <aws/testing/aws_test_harness.h>
+
+/* The table never dereferences streams, so any unique address works as a stand-in */
+static uint8_t s_fake_streams[20000];
+
+static struct aws_h2_stream *s_fake_stream(size_t i) {
+    AWS_FATAL_ASSERT(i < AWS_ARRAY_SIZE(s_fake_streams));
+    return (struct aws_h2_stream *)&s_fake_streams[i];
+}
+
+static uint32_t s_client_stream_id(size_t i) {
+    return (uint32_t)(i * 2 + 1);
+}
+
+static int s_h2_stream_table_insert_find_remove_fn(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct aws_h2_stream_table table;
+    ASSERT_SUCCESS(aws_h2_stream_table_init(&table, allocator, 0));
+    ASSERT_UINT_EQUALS(0, aws_h2_stream_table_get_count(&table));
+    ASSERT_NULL(aws_h2_stream_table_find(&table, 1));
+
+    /* Insert enough to force the table to grow a few times */
+    const size_t count = 100;
+    for (size_t i = 0; i < count; ++i) {
+        ASSERT_SUCCESS(aws_h2_stream_table_insert(&table, s_client_stream_id(i), s_fake_stream(i)));
+    }
+    ASSERT_UINT_EQUALS(count, aws_h2_stream_table_get_count(&table));
+
+    for (size_t i = 0; i < count; ++i) {
+        ASSERT_PTR_EQUALS(s_fake_stream(i), aws_h2_stream_table_find(&table, s_client_stream_id(i)));
+    }
+    ASSERT_NULL(aws_h2_stream_table_find(&table, s_client_stream_id(count)));
+    ASSERT_NULL(aws_h2_stream_table_find(&table, 2));
+
+    /* Remove every other stream, the rest must still be found */
+    for (size_t i = 0; i < count; i += 2) {
+        aws_h2_stream_table_remove(&table, s_client_stream_id(i));
+    }
+    ASSERT_UINT_EQUALS(count / 2, aws_h2_stream_table_get_count(&table));
+    for (size_t i = 0; i < count; ++i) {
+        struct aws_h2_stream *expected = (i % 2) ? s_fake_stream(i) : NULL;
+        ASSERT_PTR_EQUALS(expected, aws_h2_stream_table_find(&table, s_client_stream_id(i)));
+    }
+
+    /* Removing something that's not there is harmless */
+    aws_h2_stream_table_remove(&table, s_client_stream_id(0));
+    aws_h2_stream_table_remove(&table, 9999);
+    ASSERT_UINT_EQUALS(count / 2, aws_h2_stream_table_get_count(&table));
+
+    for (size_t i = 1; i < count; i += 2) {
+        aws_h2_stream_table_remove(&table, s_client_stream_id(i));
+    }
+    ASSERT_UINT_EQUALS(0, aws_h2_stream_table_get_count(&table));
+
+    aws_h2_stream_table_clean_up(&table);
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(h2_stream_table_insert_find_remove, s_h2_stream_table_insert_find_remove_fn)
+
+/* Stream-ids that share a home slot must all be reachable, no matter which leave first */
+static int s_h2_stream_table_collisions_fn(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct aws_h2_stream_table table;
+    ASSERT_SUCCESS(aws_h2_stream_table_init(&table, allocator, 8));
+    const uint32_t stride = (uint32_t)table.capacity * 2;
+
+    /* Client-initiated and server-initiated ids next to each other share a slot as well */
+    uint32_t ids[] = {1, 2, 1 + stride, 2 + stride, 1 + stride * 2};
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(ids); ++i) {
+        ASSERT_SUCCESS(aws_h2_stream_table_insert(&table, ids[i], s_fake_stream(i)));
+    }
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(ids); ++i) {
+        ASSERT_PTR_EQUALS(s_fake_stream(i), aws_h2_stream_table_find(&table, ids[i]));
+    }
+
+    /* Removing the head of a probe chain must not hide the entries after it */
+    aws_h2_stream_table_remove(&table, ids[0]);
+    aws_h2_stream_table_remove(&table, ids[2]);
+    ASSERT_NULL(aws_h2_stream_table_find(&table, ids[0]));
+    ASSERT_NULL(aws_h2_stream_table_find(&table, ids[2]));
+    ASSERT_PTR_EQUALS(s_fake_stream(1), aws_h2_stream_table_find(&table, ids[1]));
+    ASSERT_PTR_EQUALS(s_fake_stream(3), aws_h2_stream_table_find(&table, ids[3]));
+    ASSERT_PTR_EQUALS(s_fake_stream(4), aws_h2_stream_table_find(&table, ids[4]));
+
+    aws_h2_stream_table_clean_up(&table);
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(h2_stream_table_collisions, s_h2_stream_table_collisions_fn)
+
+/* Typical connection usage: new streams keep getting higher ids while older ones finish.
+ * The table must not grow without bound, since the number of active streams stays the same */
+static int s_h2_stream_table_sliding_window_fn(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct aws_h2_stream_table table;
+    ASSERT_SUCCESS(aws_h2_stream_table_init(&table, allocator, 8));
+
+    const size_t window = 10;
+    for (size_t i = 0; i < window; ++i) {
+        ASSERT_SUCCESS(aws_h2_stream_table_insert(&table, s_client_stream_id(i), s_fake_stream(i)));
+    }
+    size_t settled_capacity = 0;
+
+    for (size_t i = window; i < 10000; ++i) {
+        if (i == 1000) {
+            settled_capacity = table.capacity;
+        }
+        aws_h2_stream_table_remove(&table, s_client_stream_id(i - window));
+        ASSERT_SUCCESS(aws_h2_stream_table_insert(&table, s_client_stream_id(i), s_fake_stream(i)));
+        ASSERT_UINT_EQUALS(window, aws_h2_stream_table_get_count(&table));
+        for (size_t j = i + 1 - window; j <= i; ++j) {
+            ASSERT_PTR_EQUALS(s_fake_stream(j), aws_h2_stream_table_find(&table, s_client_stream_id(j)));
+        }
+    }
+    ASSERT_UINT_EQUALS(settled_capacity, table.capacity);
+    ASSERT_TRUE(table.capacity <= window * 4);
+
+    aws_h2_stream_table_clean_up(&table);
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(h2_stream_table_sliding_window, s_h2_stream_table_sliding_window_fn)
+
+/* Connection code completes streams while iterating, which removes them from the table */
+static int s_h2_stream_table_remove_while_iterating_fn(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct aws_h2_stream_table table;
+    ASSERT_SUCCESS(aws_h2_stream_table_init(&table, allocator, 8));
+
+    const size_t count = 50;
+    for (size_t i = 0; i < count; ++i) {
+        ASSERT_SUCCESS(aws_h2_stream_table_insert(&table, s_client_stream_id(i), s_fake_stream(i)));
+    }
+
+    /* Visit each stream exactly once, removing the odd ones as we go */
+    bool visited[50] = {false};
+    size_t visit_count = 0;
+    struct aws_h2_stream_table_iter iter = aws_h2_stream_table_iter_begin(&table);
+    while (!aws_h2_stream_table_iter_done(&iter)) {
+        struct aws_h2_stream *stream = iter.stream;
+        aws_h2_stream_table_iter_next(&iter);
+
+        size_t i = (size_t)((uint8_t *)stream - s_fake_streams);
+        ASSERT_TRUE(i < count);
+        ASSERT_FALSE(visited[i]);
+        visited[i] = true;
+        visit_count++;
+        if (i % 2) {
+            aws_h2_stream_table_remove(&table, s_client_stream_id(i));
+        }
+    }
+    ASSERT_UINT_EQUALS(count, visit_count);
+    ASSERT_UINT_EQUALS(count / 2, aws_h2_stream_table_get_count(&table));
+
+    /* Remove everything while iterating */
+    iter = aws_h2_stream_table_iter_begin(&table);
+    visit_count = 0;
+    while (!aws_h2_stream_table_iter_done(&iter)) {
+        struct aws_h2_stream *stream = iter.stream;
+        aws_h2_stream_table_iter_next(&iter);
+        size_t i = (size_t)((uint8_t *)stream - s_fake_streams);
+        aws_h2_stream_table_remove(&table, s_client_stream_id(i));
+        visit_count++;
+    }
+    ASSERT_UINT_EQUALS(count / 2, visit_count);
+    ASSERT_UINT_EQUALS(0, aws_h2_stream_table_get_count(&table));
+
+    iter = aws_h2_stream_table_iter_begin(&table);
+    ASSERT_TRUE(aws_h2_stream_table_iter_done(&iter));
+
+    aws_h2_stream_table_clean_up(&table);
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(h2_stream_table_remove_while_iterating, s_h2_stream_table_remove_while_iterating_fn)
+
+/* Every lookup must agree with the aws_hash_table the connection used to keep its active streams in */
+static int s_h2_stream_table_matches_hash_table_fn(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    const size_t stream_counts[] = {100, 1000, 10000};
+
+    for (size_t c = 0; c < AWS_ARRAY_SIZE(stream_counts); ++c) {
+        const size_t count = stream_counts[c];
+
+        struct aws_hash_table map;
+        ASSERT_SUCCESS(aws_hash_table_init(&map, allocator, 8, aws_hash_ptr, aws_ptr_eq, NULL, NULL));
+        struct aws_h2_stream_table table;
+        ASSERT_SUCCESS(aws_h2_stream_table_init(&table, allocator, 8));
+
+        for (size_t i = 0; i < count; ++i) {
+            ASSERT_SUCCESS(aws_hash_table_put(&map, (void *)(size_t)s_client_stream_id(i), s_fake_stream(i), NULL));
+            ASSERT_SUCCESS(aws_h2_stream_table_insert(&table, s_client_stream_id(i), s_fake_stream(i)));
+        }
+
+        /* One past the end is in neither */
+        for (size_t i = 0; i <= count; ++i) {
+            struct aws_hash_element *found = NULL;
+            ASSERT_SUCCESS(aws_hash_table_find(&map, (void *)(size_t)s_client_stream_id(i), &found));
+            struct aws_h2_stream *expected = found ? found->value : NULL;
+            ASSERT_PTR_EQUALS(expected, aws_h2_stream_table_find(&table, s_client_stream_id(i)));
+        }
+
+        aws_h2_stream_table_clean_up(&table);
+        aws_hash_table_clean_up(&map);
+    }
+
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(h2_stream_table_matches_hash_table, s_h2_stream_table_matches_hash_table_fn)
@@ -0,0 +1,237 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include "h2_test_helper.h"
+#include <aws/common/clock.h>
+#include <aws/http/connection.h>
+#include <aws/http/private/connection_impl.h>
+#include <aws/http/request_response.h>
+#include <aws/io/channel_bootstrap.h>
+#include <aws/io/socket.h>
+#include <aws/testing/io_testing_channel.h>
+
+#define TEST_CASE(NAME)                                                                                                \
+    AWS_TEST_CASE(NAME, s_test_##NAME);                                                                                \
+    static int s_test_##NAME(struct aws_allocator *allocator, void *ctx)
+
+#define DEFINE_HEADER(NAME, VALUE)                                                                                     \
+    { .name = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL(NAME), .value = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL(VALUE), }
+
+/* Client connections are set up over a testing channel, so the tests can play the server */
+static struct upgrade_tester {
+    struct aws_allocator *alloc;
+    struct testing_channel testing_channel;
+    struct h2_fake_peer peer;
+
+    aws_client_bootstrap_on_channel_event_fn *channel_setup_callback;
+    aws_client_bootstrap_on_channel_event_fn *channel_shutdown_callback;
+    void *channel_user_data;
+
+    struct aws_http_connection *connection;
+    bool setup_completed;
+    int setup_error_code;
+    bool shutdown_completed;
+} s_tester;
+
+static void s_on_testing_channel_shutdown(int error_code, void *user_data) {
+    (void)user_data;
+    s_tester.channel_shutdown_callback(
+        NULL /*bootstrap*/, error_code, s_tester.testing_channel.channel, s_tester.channel_user_data);
+}
+
+static int s_mock_new_socket_channel(struct aws_socket_channel_bootstrap_options *channel_options) {
+    s_tester.channel_setup_callback = channel_options->setup_callback;
+    s_tester.channel_shutdown_callback = channel_options->shutdown_callback;
+    s_tester.channel_user_data = channel_options->user_data;
+
+    struct aws_testing_channel_options testing_channel_options = {.clock_fn = aws_high_res_clock_get_ticks};
+    ASSERT_SUCCESS(testing_channel_init(&s_tester.testing_channel, s_tester.alloc, &testing_channel_options));
+    s_tester.testing_channel.channel_shutdown = s_on_testing_channel_shutdown;
+
+    s_tester.channel_setup_callback(
+        NULL /*bootstrap*/, AWS_ERROR_SUCCESS, s_tester.testing_channel.channel, s_tester.channel_user_data);
+    return AWS_OP_SUCCESS;
+}
+
+static struct aws_http_connection_system_vtable s_mock_system_vtable = {
+    .new_socket_channel = s_mock_new_socket_channel,
+};
+
+static void s_on_connection_setup(struct aws_http_connection *connection, int error_code, void *user_data) {
+    (void)user_data;
+    s_tester.connection = connection;
+    s_tester.setup_error_code = error_code;
+    s_tester.setup_completed = true;
+}
+
+static void s_on_connection_shutdown(struct aws_http_connection *connection, int error_code, void *user_data) {
+    (void)connection;
+    (void)error_code;
+    (void)user_data;
+    s_tester.shutdown_completed = true;
+}
+
+static int s_tester_connect(struct aws_allocator *allocator) {
+    aws_http_library_init(allocator);
+    AWS_ZERO_STRUCT(s_tester);
+    s_tester.alloc = allocator;
+    aws_http_connection_set_system_vtable(&s_mock_system_vtable);
+
+    struct aws_http2_setting settings_array[] = {
+        {.id = AWS_HTTP2_SETTINGS_ENABLE_PUSH, .value = 0},
+    };
+    struct aws_http2_connection_options http2_options = {
+        .initial_settings_array = settings_array,
+        .num_initial_settings = AWS_ARRAY_SIZE(settings_array),
+    };
+    struct aws_socket_options socket_options;
+    AWS_ZERO_STRUCT(socket_options);
+
+    struct aws_http_client_connection_options options = AWS_HTTP_CLIENT_CONNECTION_OPTIONS_INIT;
+    options.allocator = allocator;
+    options.host_name = aws_byte_cursor_from_c_str("example.com");
+    options.port = 80;
+    options.socket_options = &socket_options;
+    options.http2_options = &http2_options;
+    options.on_setup = s_on_connection_setup;
+    options.on_shutdown = s_on_connection_shutdown;
+    options.http2_upgrade = true;
+    ASSERT_SUCCESS(aws_http_client_connect(&options));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+    /* The user doesn't get a connection until the server answers the upgrade request */
+    ASSERT_FALSE(s_tester.setup_completed);
+    const char *expected = "OPTIONS * HTTP/1.1\r\n"
+                           "Host: example.com\r\n"
+                           "Connection: Upgrade, HTTP2-Settings\r\n"
+                           "Upgrade: h2c\r\n"
+                           "HTTP2-Settings: AAIAAAAA\r\n"
+                           "\r\n";
+    ASSERT_SUCCESS(testing_channel_check_written_messages_str(&s_tester.testing_channel, allocator, expected));
+    return AWS_OP_SUCCESS;
+}
+
+static int s_tester_clean_up(void) {
+    h2_fake_peer_clean_up(&s_tester.peer);
+    aws_http_connection_release(s_tester.connection);
+    ASSERT_SUCCESS(testing_channel_clean_up(&s_tester.testing_channel));
+    ASSERT_TRUE(s_tester.shutdown_completed);
+    aws_http_library_clean_up();
+    return AWS_OP_SUCCESS;
+}
+
+/* The server switches protocols, and the user gets an HTTP/2 connection over the same channel */
+TEST_CASE(h2c_upgrade_accepted) {
+    (void)ctx;
+    ASSERT_SUCCESS(s_tester_connect(allocator));
+
+    ASSERT_SUCCESS(testing_channel_push_read_str(
+        &s_tester.testing_channel,
+        "HTTP/1.1 101 Switching Protocols\r\n"
+        "Connection: Upgrade\r\n"
+        "Upgrade: h2c\r\n"
+        "\r\n"));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+    ASSERT_TRUE(s_tester.setup_completed);
+    ASSERT_INT_EQUALS(AWS_ERROR_SUCCESS, s_tester.setup_error_code);
+    ASSERT_INT_EQUALS(AWS_HTTP_VERSION_2, aws_http_connection_get_version(s_tester.connection));
+
+    /* Client sends its connection preface, and cancels stream 1, which the upgrade request became */
+    struct h2_fake_peer_options peer_options = {
+        .alloc = allocator,
+        .testing_channel = &s_tester.testing_channel,
+        .is_server = true,
+    };
+    ASSERT_SUCCESS(h2_fake_peer_init(&s_tester.peer, &peer_options));
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+    ASSERT_NOT_NULL(h2_decode_tester_find_frame(&s_tester.peer.decode, AWS_H2_FRAME_T_SETTINGS, 0, NULL));
+    struct h2_decoded_frame *rst_stream_frame =
+        h2_decode_tester_find_stream_frame(&s_tester.peer.decode, AWS_H2_FRAME_T_RST_STREAM, 1, 0, NULL);
+    ASSERT_NOT_NULL(rst_stream_frame);
+    ASSERT_UINT_EQUALS(AWS_HTTP2_ERR_CANCEL, rst_stream_frame->error_code);
+
+    /* Server's response to the upgrade request is ignored */
+    ASSERT_SUCCESS(h2_fake_peer_send_connection_preface_default_settings(&s_tester.peer));
+    struct aws_http_header response_headers_src[] = {
+        DEFINE_HEADER(":status", "200"),
+    };
+    struct aws_http_headers *response_headers = aws_http_headers_new(allocator);
+    aws_http_headers_add_array(response_headers, response_headers_src, AWS_ARRAY_SIZE(response_headers_src));
+    struct aws_h2_frame *response_frame =
+        aws_h2_frame_new_headers(allocator, 1 /*stream_id*/, response_headers, true /*end_stream*/, 0, NULL);
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&s_tester.peer, response_frame));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_TRUE(aws_http_connection_is_open(s_tester.connection));
+
+    /* The user's first stream is stream 3 */
+    struct aws_http_message *request = aws_http2_message_new_request(allocator);
+    struct aws_http_header request_headers[] = {
+        DEFINE_HEADER(":method", "GET"),
+        DEFINE_HEADER(":scheme", "http"),
+        DEFINE_HEADER(":path", "/"),
+        DEFINE_HEADER(":authority", "example.com"),
+    };
+    ASSERT_SUCCESS(aws_http_message_add_header_array(request, request_headers, AWS_ARRAY_SIZE(request_headers)));
+    struct aws_http_make_request_options request_options = {
+        .self_size = sizeof(request_options),
+        .request = request,
+    };
+    struct aws_http_stream *stream = aws_http_connection_make_request(s_tester.connection, &request_options);
+    ASSERT_NOT_NULL(stream);
+    ASSERT_SUCCESS(aws_http_stream_activate(stream));
+    ASSERT_UINT_EQUALS(3, aws_http_stream_get_id(stream));
+
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&s_tester.peer));
+    ASSERT_NOT_NULL(h2_decode_tester_find_stream_frame(&s_tester.peer.decode, AWS_H2_FRAME_T_HEADERS, 3, 0, NULL));
+
+    /* shutdown channel so request can be released */
+    aws_channel_shutdown(s_tester.testing_channel.channel, AWS_ERROR_SUCCESS);
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+    aws_http_stream_release(stream);
+    aws_http_message_release(request);
+    aws_http_headers_release(response_headers);
+
+    return s_tester_clean_up();
+}
+
+/* The server ignores the upgrade, and the user gets the HTTP/1.1 connection once the response is done */
+TEST_CASE(h2c_upgrade_declined) {
+    (void)ctx;
+    ASSERT_SUCCESS(s_tester_connect(allocator));
+
+    ASSERT_SUCCESS(testing_channel_push_read_str(
+        &s_tester.testing_channel,
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length: 0\r\n"
+        "\r\n"));
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+    ASSERT_TRUE(s_tester.setup_completed);
+    ASSERT_INT_EQUALS(AWS_ERROR_SUCCESS, s_tester.setup_error_code);
+    ASSERT_INT_EQUALS(AWS_HTTP_VERSION_1_1, aws_http_connection_get_version(s_tester.connection));
+    ASSERT_TRUE(aws_http_connection_new_requests_allowed(s_tester.connection));
+
+    return s_tester_clean_up();
+}
+
+/* The connection closes before the server answers, so setup fails */
+TEST_CASE(h2c_upgrade_connection_closed) {
+    (void)ctx;
+    ASSERT_SUCCESS(s_tester_connect(allocator));
+
+    aws_channel_shutdown(s_tester.testing_channel.channel, AWS_IO_SOCKET_CLOSED);
+    testing_channel_drain_queued_tasks(&s_tester.testing_channel);
+
+    ASSERT_TRUE(s_tester.setup_completed);
+    ASSERT_NULL(s_tester.connection);
+    ASSERT_TRUE(s_tester.setup_error_code != AWS_ERROR_SUCCESS);
+    ASSERT_FALSE(s_tester.shutdown_completed);
+
+    ASSERT_SUCCESS(testing_channel_clean_up(&s_tester.testing_channel));
+    aws_http_library_clean_up();
+    return AWS_OP_SUCCESS;
+}
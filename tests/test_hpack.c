@@ -8,6 +8,8 @@
 
 #include <aws/http/request_response.h>
 
+#include <stdio.h>
+
 /* #TODO test that buffer is resized if space is insufficient */
 
 AWS_TEST_CASE(hpack_encode_integer, test_hpack_encode_integer)
@@ -468,6 +470,54 @@ TEST_DECODE_ONE_BYTE_AT_A_TIME(hpack_decode_string_huffman) {
     return AWS_OP_SUCCESS;
 }
 
+/* Padding must be the most significant bits of EOS (all 1s) */
+TEST_DECODE_ONE_BYTE_AT_A_TIME(hpack_decode_string_huffman_bad_padding) {
+    struct decode_fixture *fixture = ctx;
+
+    /* Huffman-encoded "a" is 00011, followed by 3 bits of padding that should be 111, but are 000 */
+    uint8_t input[] = {0x81, 0x18};
+    struct aws_byte_cursor to_decode = aws_byte_cursor_from_array(input, AWS_ARRAY_SIZE(input));
+    struct aws_byte_buf output;
+    ASSERT_SUCCESS(aws_byte_buf_init(&output, allocator, 4));
+    bool complete;
+    ASSERT_FAILS(s_decode_string(fixture, &to_decode, &output, &complete));
+
+    aws_byte_buf_clean_up(&output);
+    return AWS_OP_SUCCESS;
+}
+
+/* Padding longer than 7 bits is an error */
+TEST_DECODE_ONE_BYTE_AT_A_TIME(hpack_decode_string_huffman_long_padding) {
+    struct decode_fixture *fixture = ctx;
+
+    /* Huffman-encoded "a" is 00011, followed by 11 bits of 1s */
+    uint8_t input[] = {0x82, 0x1f, 0xff};
+    struct aws_byte_cursor to_decode = aws_byte_cursor_from_array(input, AWS_ARRAY_SIZE(input));
+    struct aws_byte_buf output;
+    ASSERT_SUCCESS(aws_byte_buf_init(&output, allocator, 4));
+    bool complete;
+    ASSERT_FAILS(s_decode_string(fixture, &to_decode, &output, &complete));
+
+    aws_byte_buf_clean_up(&output);
+    return AWS_OP_SUCCESS;
+}
+
+/* EOS symbol must not appear in a Huffman-encoded string */
+TEST_DECODE_ONE_BYTE_AT_A_TIME(hpack_decode_string_huffman_eos) {
+    struct decode_fixture *fixture = ctx;
+
+    /* EOS is 30 bits of 1s */
+    uint8_t input[] = {0x84, 0xff, 0xff, 0xff, 0xff};
+    struct aws_byte_cursor to_decode = aws_byte_cursor_from_array(input, AWS_ARRAY_SIZE(input));
+    struct aws_byte_buf output;
+    ASSERT_SUCCESS(aws_byte_buf_init(&output, allocator, 4));
+    bool complete;
+    ASSERT_FAILS(s_decode_string(fixture, &to_decode, &output, &complete));
+
+    aws_byte_buf_clean_up(&output);
+    return AWS_OP_SUCCESS;
+}
+
 /* Test that partial input doesn't register as "complete" */
 TEST_DECODE_ONE_BYTE_AT_A_TIME(hpack_decode_string_ongoing) {
     struct decode_fixture *fixture = ctx;
@@ -546,6 +596,58 @@ static int test_hpack_static_table_find(struct aws_allocator *allocator, void *c
     return AWS_OP_SUCCESS;
 }
 
+/* Every entry in the static table can be found, by name-and-value and by name alone */
+AWS_TEST_CASE(hpack_static_table_find_all, test_hpack_static_table_find_all)
+static int test_hpack_static_table_find_all(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_http_library_init(allocator);
+    struct aws_hpack_context context;
+    aws_hpack_context_init(&context, allocator, AWS_LS_HTTP_GENERAL, NULL);
+    ASSERT_SUCCESS(aws_hpack_resize_dynamic_table(&context, 0));
+
+    bool found_value = false;
+    size_t lowest_index_with_name = 0;
+    for (size_t i = 1; i <= 61; ++i) {
+        const struct aws_http_header *entry = aws_hpack_get_header(&context, i);
+        ASSERT_NOT_NULL(entry);
+
+        /* Entries sharing a name are adjacent, name-only lookups give the lowest index */
+        if (i == 1 || !aws_byte_cursor_eq(&entry->name, &aws_hpack_get_header(&context, i - 1)->name)) {
+            lowest_index_with_name = i;
+        }
+
+        ASSERT_UINT_EQUALS(i, aws_hpack_find_index(&context, entry, true, &found_value));
+        ASSERT_UINT_EQUALS(entry->value.len > 0, found_value);
+        ASSERT_UINT_EQUALS(i, aws_hpack_find_static_index(entry, &found_value));
+        ASSERT_UINT_EQUALS(entry->value.len > 0, found_value);
+
+        ASSERT_UINT_EQUALS(lowest_index_with_name, aws_hpack_find_index(&context, entry, false, &found_value));
+        ASSERT_FALSE(found_value);
+
+        /* Same name, unknown value */
+        struct aws_http_header other_value = {
+            .name = entry->name,
+            .value = aws_byte_cursor_from_c_str("not-a-static-value"),
+        };
+        ASSERT_UINT_EQUALS(lowest_index_with_name, aws_hpack_find_index(&context, &other_value, true, &found_value));
+        ASSERT_FALSE(found_value);
+
+        /* A name missing its last character is not in the table */
+        struct aws_http_header truncated = {.name = entry->name};
+        truncated.name.len--;
+        ASSERT_UINT_EQUALS(0, aws_hpack_find_index(&context, &truncated, true, &found_value));
+    }
+
+    /* Empty name */
+    struct aws_http_header empty = {.name = {0}};
+    ASSERT_UINT_EQUALS(0, aws_hpack_find_index(&context, &empty, true, &found_value));
+
+    aws_hpack_context_clean_up(&context);
+    aws_http_library_clean_up();
+    return AWS_OP_SUCCESS;
+}
+
 AWS_TEST_CASE(hpack_static_table_get, test_hpack_static_table_get)
 static int test_hpack_static_table_get(struct aws_allocator *allocator, void *ctx) {
     (void)ctx;
@@ -703,6 +805,150 @@ static int s_check_header(
     return AWS_OP_SUCCESS;
 }
 
+/* Header number i for the churn test. Names repeat, values vary in length (including empty) */
+static struct aws_http_header s_churn_header(size_t i, char *name_buf, size_t name_buf_len, char *value_buf) {
+    snprintf(name_buf, name_buf_len, "x-churn-%zu", i % 13);
+    const size_t value_len = (i * 7) % 60;
+    memset(value_buf, 'a' + (int)(i % 26), value_len);
+
+    struct aws_http_header header = {
+        .name = aws_byte_cursor_from_c_str(name_buf),
+        .value = aws_byte_cursor_from_array(value_buf, value_len),
+    };
+    return header;
+}
+
+/* Insert many headers through several table sizes, checking the whole table after each insert.
+ * Strings storage moves around (sliding forward, growing, shrinking) so this checks nothing gets lost. */
+AWS_TEST_CASE(hpack_dynamic_table_churn, test_hpack_dynamic_table_churn)
+static int test_hpack_dynamic_table_churn(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_http_library_init(allocator);
+    struct aws_hpack_context context;
+    aws_hpack_context_init(&context, allocator, AWS_LS_HTTP_GENERAL, NULL);
+
+    /* Includes a size that fits just 1 entry, and growing again after that */
+    const size_t table_sizes[] = {4096, 256, 120, 0, 8192, 1024};
+    size_t insert_count = 0;
+    char name_buf[32];
+    char value_buf[64];
+
+    for (size_t s = 0; s < AWS_ARRAY_SIZE(table_sizes); ++s) {
+        const size_t max_size = table_sizes[s];
+        ASSERT_SUCCESS(aws_hpack_resize_dynamic_table(&context, max_size));
+
+        for (size_t n = 0; n < 1000; ++n) {
+            struct aws_http_header header = s_churn_header(insert_count, name_buf, sizeof(name_buf), value_buf);
+            if (aws_hpack_get_header_size(&header) > max_size) {
+                continue;
+            }
+            ASSERT_SUCCESS(aws_hpack_insert_header(&context, &header));
+            insert_count++;
+
+            /* Expect the newest headers that fit, newest at index 62 */
+            size_t expected_size = 0;
+            size_t expected_num_elements = 0;
+            for (size_t k = 0; k < insert_count; ++k) {
+                char expected_name[32];
+                char expected_value[64];
+                struct aws_http_header expected =
+                    s_churn_header(insert_count - 1 - k, expected_name, sizeof(expected_name), expected_value);
+                if (expected_size + aws_hpack_get_header_size(&expected) > max_size) {
+                    break;
+                }
+                expected_size += aws_hpack_get_header_size(&expected);
+                expected_num_elements++;
+
+                const struct aws_http_header *found = aws_hpack_get_header(&context, 62 + k);
+                ASSERT_NOT_NULL(found);
+                ASSERT_TRUE(aws_byte_cursor_eq(&expected.name, &found->name));
+                ASSERT_TRUE(aws_byte_cursor_eq(&expected.value, &found->value));
+            }
+            ASSERT_UINT_EQUALS(expected_num_elements, aws_hpack_get_dynamic_table_num_elements(&context));
+
+            /* Newest entry can be found by name-and-value */
+            bool found_value = false;
+            ASSERT_UINT_EQUALS(62, aws_hpack_find_index(&context, &header, true, &found_value));
+            ASSERT_UINT_EQUALS(header.value.len > 0, found_value);
+
+            /* Strings storage stays within twice the table size */
+            ASSERT_TRUE(context.dynamic_table.strings_capacity <= 2 * max_size);
+        }
+    }
+
+    aws_hpack_context_clean_up(&context);
+    aws_http_library_clean_up();
+    return AWS_OP_SUCCESS;
+}
+
+/* Send header "x-cycle-<i>" the way an encoder would: index it if it's in the table, otherwise insert it */
+static int s_suggest_size_use_header(struct aws_hpack_context *context, size_t i) {
+    char name[32];
+    snprintf(name, sizeof(name), "x-cycle-%zu", i);
+    struct aws_http_header header = {
+        .name = aws_byte_cursor_from_c_str(name),
+        .value = aws_byte_cursor_from_c_str("vvvvvvvvvvvvvvvvvvvv"),
+    };
+
+    bool found_value = false;
+    aws_hpack_find_index(context, &header, true, &found_value);
+    if (!found_value) {
+        ASSERT_SUCCESS(aws_hpack_insert_header(context, &header));
+    }
+    return AWS_OP_SUCCESS;
+}
+
+/* Resize the table to whatever aws_hpack_suggest_dynamic_table_size() suggests, and check that's what's expected */
+static int s_suggest_size_apply(struct aws_hpack_context *context, size_t min, size_t max, size_t expected) {
+    size_t suggested = aws_hpack_suggest_dynamic_table_size(context, min, max);
+    ASSERT_UINT_EQUALS(expected, suggested);
+    ASSERT_SUCCESS(aws_hpack_resize_dynamic_table(context, suggested));
+    return AWS_OP_SUCCESS;
+}
+
+AWS_TEST_CASE(hpack_dynamic_table_suggest_size, test_hpack_dynamic_table_suggest_size)
+static int test_hpack_dynamic_table_suggest_size(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_http_library_init(allocator);
+    struct aws_hpack_context context;
+    aws_hpack_context_init(&context, allocator, AWS_LS_HTTP_GENERAL, NULL);
+
+    /* Each entry is 61 bytes. A table mostly going unused shrinks by half each time,
+     * down to twice what's used, but not below the min */
+    ASSERT_SUCCESS(s_suggest_size_use_header(&context, 0));
+    ASSERT_SUCCESS(s_suggest_size_apply(&context, 256, 65536, 2048));
+    ASSERT_SUCCESS(s_suggest_size_apply(&context, 256, 65536, 1024));
+    ASSERT_SUCCESS(s_suggest_size_apply(&context, 256, 65536, 512));
+    ASSERT_SUCCESS(s_suggest_size_apply(&context, 256, 65536, 256));
+    ASSERT_SUCCESS(s_suggest_size_apply(&context, 256, 65536, 256));
+    ASSERT_SUCCESS(s_suggest_size_apply(&context, 64, 65536, 128));
+
+    /* Cycle through 10 headers, which don't all fit. Every one gets evicted before it's needed again,
+     * so the table grows until they fit, then stays that size */
+    ASSERT_SUCCESS(aws_hpack_resize_dynamic_table(&context, 256));
+    const size_t expected_sizes[] = {512, 1024, 1024, 1024};
+    for (size_t round = 0; round < AWS_ARRAY_SIZE(expected_sizes); ++round) {
+        for (size_t i = 0; i < 40; ++i) {
+            ASSERT_SUCCESS(s_suggest_size_use_header(&context, i % 10));
+        }
+        ASSERT_SUCCESS(s_suggest_size_apply(&context, 256, 65536, expected_sizes[round]));
+    }
+    ASSERT_UINT_EQUALS(10, aws_hpack_get_dynamic_table_num_elements(&context));
+
+    /* Growth stops at the max */
+    ASSERT_SUCCESS(aws_hpack_resize_dynamic_table(&context, 256));
+    for (size_t i = 0; i < 40; ++i) {
+        ASSERT_SUCCESS(s_suggest_size_use_header(&context, i % 10));
+    }
+    ASSERT_SUCCESS(s_suggest_size_apply(&context, 128, 384, 384));
+
+    aws_hpack_context_clean_up(&context);
+    aws_http_library_clean_up();
+    return AWS_OP_SUCCESS;
+}
+
 AWS_TEST_CASE(hpack_decode_indexed_from_dynamic_table, test_hpack_decode_indexed_from_dynamic_table)
 static int test_hpack_decode_indexed_from_dynamic_table(struct aws_allocator *allocator, void *ctx) {
     (void)ctx;
@@ -875,3 +1121,483 @@ static int test_hpack_dynamic_table_size_update_from_setting(struct aws_allocato
     aws_http_library_clean_up();
     return AWS_OP_SUCCESS;
 }
+
+#define DEFINE_HEADER(NAME, VALUE)                                                                                     \
+    { .name = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL(NAME), .value = AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL(VALUE), }
+
+/* Encode the same header-blocks with and without a header template. The output must be identical. */
+static int s_check_header_template_matches_plain_encoder(
+    struct aws_allocator *allocator,
+    size_t max_table_size,
+    bool switch_huffman_mode) {
+
+    struct aws_hpack_encoder plain_encoder;
+    aws_hpack_encoder_init(&plain_encoder, allocator, NULL);
+    struct aws_hpack_encoder template_encoder;
+    aws_hpack_encoder_init(&template_encoder, allocator, NULL);
+
+    aws_hpack_encoder_update_max_table_size(&plain_encoder, max_table_size);
+    aws_hpack_encoder_update_max_table_size(&template_encoder, max_table_size);
+
+    /* Template covers: full static match, static name match, new name, and a field sent without caching */
+    struct aws_http_header template_src[] = {
+        DEFINE_HEADER(":method", "GET"),
+        DEFINE_HEADER(":scheme", "https"),
+        DEFINE_HEADER("user-agent", "aws-c-http/test"),
+        DEFINE_HEADER("x-amz-template-field", "a fairly long value to make huffman worthwhile"),
+        DEFINE_HEADER("authorization", "secret"),
+    };
+    struct aws_http_headers *template_headers = aws_http_headers_new(allocator);
+    ASSERT_SUCCESS(aws_http_headers_add_array(template_headers, template_src, AWS_ARRAY_SIZE(template_src)));
+    ASSERT_SUCCESS(aws_hpack_encoder_set_header_template(&template_encoder, template_headers));
+    /* Template is a copy */
+    aws_http_headers_release(template_headers);
+
+    struct aws_byte_buf plain_output;
+    ASSERT_SUCCESS(aws_byte_buf_init(&plain_output, allocator, 128));
+    struct aws_byte_buf template_output;
+    ASSERT_SUCCESS(aws_byte_buf_init(&template_output, allocator, 128));
+
+    for (int i = 0; i < 20; ++i) {
+        if (switch_huffman_mode) {
+            enum aws_hpack_huffman_mode mode = (i / 3) % 2 ? AWS_HPACK_HUFFMAN_NEVER : AWS_HPACK_HUFFMAN_SMALLEST;
+            aws_hpack_encoder_set_huffman_mode(&plain_encoder, mode);
+            aws_hpack_encoder_set_huffman_mode(&template_encoder, mode);
+        }
+
+        char request_id[32];
+        snprintf(request_id, sizeof(request_id), "%d", i);
+
+        struct aws_http_headers *headers = aws_http_headers_new(allocator);
+        ASSERT_SUCCESS(aws_http_headers_add_array(headers, template_src, 4));
+        /* Not in template, and changes every block, so it keeps evicting other entries from a small table */
+        ASSERT_SUCCESS(aws_http_headers_add(
+            headers, aws_byte_cursor_from_c_str("x-request-id"), aws_byte_cursor_from_c_str(request_id)));
+        /* Same name and value as template entry, but with different compression */
+        struct aws_http_header authorization = template_src[4];
+        authorization.compression = AWS_HTTP_HEADER_COMPRESSION_NO_FORWARD_CACHE;
+        ASSERT_SUCCESS(aws_http_headers_add_header(headers, &authorization));
+
+        aws_byte_buf_reset(&plain_output, false);
+        aws_byte_buf_reset(&template_output, false);
+        ASSERT_SUCCESS(aws_hpack_encode_header_block(&plain_encoder, headers, &plain_output));
+        ASSERT_SUCCESS(aws_hpack_encode_header_block(&template_encoder, headers, &template_output));
+        ASSERT_BIN_ARRAYS_EQUALS(plain_output.buffer, plain_output.len, template_output.buffer, template_output.len);
+
+        aws_http_headers_release(headers);
+    }
+
+    aws_byte_buf_clean_up(&plain_output);
+    aws_byte_buf_clean_up(&template_output);
+    aws_hpack_encoder_clean_up(&plain_encoder);
+    aws_hpack_encoder_clean_up(&template_encoder);
+    return AWS_OP_SUCCESS;
+}
+
+AWS_TEST_CASE(hpack_encode_header_template, test_hpack_encode_header_template)
+static int test_hpack_encode_header_template(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+    aws_http_library_init(allocator);
+
+    /* Default table size, entries stay in dynamic table */
+    ASSERT_SUCCESS(s_check_header_template_matches_plain_encoder(allocator, 4096, false /*switch_huffman_mode*/));
+    /* Huffman mode changes, cached strings must be re-encoded */
+    ASSERT_SUCCESS(s_check_header_template_matches_plain_encoder(allocator, 4096, true /*switch_huffman_mode*/));
+    /* Table only fits a few entries, template entries keep getting evicted */
+    ASSERT_SUCCESS(s_check_header_template_matches_plain_encoder(allocator, 150, false /*switch_huffman_mode*/));
+    /* Dynamic table disabled */
+    ASSERT_SUCCESS(s_check_header_template_matches_plain_encoder(allocator, 0, true /*switch_huffman_mode*/));
+
+    aws_http_library_clean_up();
+    return AWS_OP_SUCCESS;
+}
+
+AWS_TEST_CASE(hpack_encode_header_template_replace, test_hpack_encode_header_template_replace)
+static int test_hpack_encode_header_template_replace(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+    aws_http_library_init(allocator);
+
+    struct aws_hpack_encoder encoder;
+    aws_hpack_encoder_init(&encoder, allocator, NULL);
+
+    struct aws_http_headers *template_headers = aws_http_headers_new(allocator);
+    DEFINE_STATIC_HEADER(header, "x-amz-template-field", "value");
+    ASSERT_SUCCESS(aws_http_headers_add_header(template_headers, &header));
+
+    /* Setting again replaces the old template, setting NULL or empty headers removes it */
+    ASSERT_SUCCESS(aws_hpack_encoder_set_header_template(&encoder, template_headers));
+    ASSERT_NOT_NULL(encoder.header_template);
+    ASSERT_SUCCESS(aws_hpack_encoder_set_header_template(&encoder, template_headers));
+    ASSERT_NOT_NULL(encoder.header_template);
+    ASSERT_SUCCESS(aws_hpack_encoder_set_header_template(&encoder, NULL));
+    ASSERT_NULL(encoder.header_template);
+    ASSERT_SUCCESS(aws_hpack_encoder_set_header_template(&encoder, template_headers));
+    aws_http_headers_clear(template_headers);
+    ASSERT_SUCCESS(aws_hpack_encoder_set_header_template(&encoder, template_headers));
+    ASSERT_NULL(encoder.header_template);
+
+    /* Encoder cleans up any template it still has */
+    aws_http_headers_add_header(template_headers, &header);
+    ASSERT_SUCCESS(aws_hpack_encoder_set_header_template(&encoder, template_headers));
+
+    aws_http_headers_release(template_headers);
+    aws_hpack_encoder_clean_up(&encoder);
+    aws_http_library_clean_up();
+    return AWS_OP_SUCCESS;
+}
+
+/* Encode header-blocks with a request-id that's always new, a field that never changes, and one alternating field */
+static int s_encode_indexing_policy_blocks(
+    struct aws_allocator *allocator,
+    bool policy_enabled,
+    struct aws_hpack_encoder_stats *out_stats) {
+
+    struct aws_hpack_encoder encoder;
+    aws_hpack_encoder_init(&encoder, allocator, NULL);
+    aws_hpack_encoder_set_indexing_policy(&encoder, policy_enabled);
+
+    struct aws_byte_buf output;
+    ASSERT_SUCCESS(aws_byte_buf_init(&output, allocator, 128));
+    size_t total_output_len = 0;
+
+    for (int i = 0; i < 40; ++i) {
+        char request_id[32];
+        snprintf(request_id, sizeof(request_id), "%d", i);
+
+        struct aws_http_headers *headers = aws_http_headers_new(allocator);
+        ASSERT_SUCCESS(aws_http_headers_add(
+            headers, aws_byte_cursor_from_c_str("x-request-id"), aws_byte_cursor_from_c_str(request_id)));
+        ASSERT_SUCCESS(aws_http_headers_add(
+            headers, aws_byte_cursor_from_c_str("x-app"), aws_byte_cursor_from_c_str("aws-c-http/test")));
+        ASSERT_SUCCESS(aws_http_headers_add(
+            headers, aws_byte_cursor_from_c_str("x-alternating"), aws_byte_cursor_from_c_str(i % 2 ? "a" : "b")));
+
+        aws_byte_buf_reset(&output, false);
+        ASSERT_SUCCESS(aws_hpack_encode_header_block(&encoder, headers, &output));
+        total_output_len += output.len;
+
+        aws_http_headers_release(headers);
+    }
+
+    aws_hpack_encoder_get_stats(&encoder, out_stats);
+    ASSERT_UINT_EQUALS(total_output_len, out_stats->encoded_bytes);
+    ASSERT_UINT_EQUALS(120, out_stats->num_header_fields);
+    ASSERT_TRUE(out_stats->encoded_bytes < out_stats->raw_bytes);
+    ASSERT_UINT_EQUALS(out_stats->num_inserted, aws_hpack_get_dynamic_table_num_elements(&encoder.context));
+
+    aws_byte_buf_clean_up(&output);
+    aws_hpack_encoder_clean_up(&encoder);
+    return AWS_OP_SUCCESS;
+}
+
+AWS_TEST_CASE(hpack_encode_indexing_policy, test_hpack_encode_indexing_policy)
+static int test_hpack_encode_indexing_policy(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+    aws_http_library_init(allocator);
+
+    /* Without the policy, every new request-id is inserted */
+    struct aws_hpack_encoder_stats stats;
+    ASSERT_SUCCESS(s_encode_indexing_policy_blocks(allocator, false /*policy_enabled*/, &stats));
+    ASSERT_UINT_EQUALS(40 + 1 + 2, stats.num_inserted);
+    ASSERT_UINT_EQUALS(39 + 38, stats.num_indexed);
+    ASSERT_UINT_EQUALS(0, stats.num_skipped_by_policy);
+
+    /* With the policy, request-ids stop being inserted once the name has been seen enough to judge it.
+     * Fields whose values repeat are indexed just the same */
+    ASSERT_SUCCESS(s_encode_indexing_policy_blocks(allocator, true /*policy_enabled*/, &stats));
+    ASSERT_UINT_EQUALS(7 + 1 + 2, stats.num_inserted);
+    ASSERT_UINT_EQUALS(39 + 38, stats.num_indexed);
+    ASSERT_UINT_EQUALS(33, stats.num_skipped_by_policy);
+
+    aws_http_library_clean_up();
+    return AWS_OP_SUCCESS;
+}
+
+/* Encoding an HTTP/1 request directly must produce the same header-blocks as converting it to HTTP/2 first */
+AWS_TEST_CASE(hpack_encode_header_block_from_http1, test_hpack_encode_header_block_from_http1)
+static int test_hpack_encode_header_block_from_http1(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+    aws_http_library_init(allocator);
+
+    struct aws_hpack_encoder converted_encoder;
+    aws_hpack_encoder_init(&converted_encoder, allocator, NULL);
+    struct aws_hpack_encoder direct_encoder;
+    aws_hpack_encoder_init(&direct_encoder, allocator, NULL);
+
+    struct aws_byte_buf converted_output;
+    ASSERT_SUCCESS(aws_byte_buf_init(&converted_output, allocator, 128));
+    struct aws_byte_buf direct_output;
+    ASSERT_SUCCESS(aws_byte_buf_init(&direct_output, allocator, 128));
+
+    struct aws_http_header request_headers_src[] = {
+        DEFINE_HEADER("Accept", "*/*"),
+        DEFINE_HEADER("HOST", "example.com"),
+        DEFINE_HEADER("User-Agent", "aws-c-http/test"),
+        DEFINE_HEADER("Transfer-Encoding", "chunked"), /* connection-specific headers are skipped */
+        DEFINE_HEADER("upgrade", "h2c"),
+        DEFINE_HEADER("X-Amz-Some-Rather-Long-Header-Name-To-Grow-The-Name-Buffer", "value"),
+    };
+
+    for (int i = 0; i < 10; ++i) {
+        struct aws_http_message *request = aws_http_message_new_request(allocator);
+        ASSERT_NOT_NULL(request);
+        struct aws_byte_cursor method = i % 2 ? aws_http_method_get : aws_http_method_post;
+        ASSERT_SUCCESS(aws_http_message_set_request_method(request, method));
+        ASSERT_SUCCESS(aws_http_message_set_request_path(request, aws_byte_cursor_from_c_str("/index.html")));
+        /* Leave out Host sometimes, then there's no ":authority" */
+        for (size_t h = 0; h < AWS_ARRAY_SIZE(request_headers_src); ++h) {
+            if (h != 1 || i % 3 != 0) {
+                ASSERT_SUCCESS(aws_http_message_add_header(request, request_headers_src[h]));
+            }
+        }
+        char request_id[32];
+        snprintf(request_id, sizeof(request_id), "%d", i);
+        ASSERT_SUCCESS(aws_http_message_add_header(
+            request,
+            (struct aws_http_header){
+                .name = aws_byte_cursor_from_c_str("X-Request-Id"),
+                .value = aws_byte_cursor_from_c_str(request_id),
+            }));
+
+        struct aws_http_message *converted = aws_http2_message_new_from_http1(allocator, request);
+        ASSERT_NOT_NULL(converted);
+
+        aws_byte_buf_reset(&converted_output, false);
+        aws_byte_buf_reset(&direct_output, false);
+        ASSERT_SUCCESS(aws_hpack_encode_header_block(
+            &converted_encoder, aws_http_message_get_const_headers(converted), &converted_output));
+        ASSERT_SUCCESS(aws_hpack_encode_header_block_from_http1(&direct_encoder, request, &direct_output));
+        ASSERT_BIN_ARRAYS_EQUALS(
+            converted_output.buffer, converted_output.len, direct_output.buffer, direct_output.len);
+
+        aws_http_message_release(converted);
+        aws_http_message_release(request);
+    }
+
+    struct aws_hpack_encoder_stats converted_stats;
+    aws_hpack_encoder_get_stats(&converted_encoder, &converted_stats);
+    struct aws_hpack_encoder_stats direct_stats;
+    aws_hpack_encoder_get_stats(&direct_encoder, &direct_stats);
+    ASSERT_UINT_EQUALS(converted_stats.num_header_fields, direct_stats.num_header_fields);
+    ASSERT_UINT_EQUALS(converted_stats.raw_bytes, direct_stats.raw_bytes);
+    ASSERT_UINT_EQUALS(converted_stats.encoded_bytes, direct_stats.encoded_bytes);
+
+    /* A request without a path fails before anything is encoded */
+    struct aws_http_message *no_path = aws_http_message_new_request(allocator);
+    ASSERT_SUCCESS(aws_http_message_set_request_method(no_path, aws_http_method_get));
+    aws_byte_buf_reset(&direct_output, false);
+    ASSERT_FAILS(aws_hpack_encode_header_block_from_http1(&direct_encoder, no_path, &direct_output));
+    ASSERT_INT_EQUALS(AWS_ERROR_HTTP_INVALID_PATH, aws_last_error());
+    ASSERT_UINT_EQUALS(0, direct_output.len);
+    aws_http_message_release(no_path);
+
+    aws_byte_buf_clean_up(&converted_output);
+    aws_byte_buf_clean_up(&direct_output);
+    aws_hpack_encoder_clean_up(&converted_encoder);
+    aws_hpack_encoder_clean_up(&direct_encoder);
+    aws_http_library_clean_up();
+    return AWS_OP_SUCCESS;
+}
+
+/* Every byte value survives a round trip through the Huffman encoder and decoder, fed in chunks of any size */
+AWS_TEST_CASE(hpack_huffman_decode_all_symbols, test_hpack_huffman_decode_all_symbols)
+static int test_hpack_huffman_decode_all_symbols(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+    aws_http_library_init(allocator);
+
+    struct aws_hpack_encoder encoder;
+    aws_hpack_encoder_init(&encoder, allocator, NULL);
+
+    uint8_t all_bytes[256];
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(all_bytes); ++i) {
+        all_bytes[i] = (uint8_t)i;
+    }
+
+    /* Encode without the string length prefix */
+    struct aws_byte_cursor to_encode = aws_byte_cursor_from_array(all_bytes, sizeof(all_bytes));
+    struct aws_byte_buf encoded;
+    ASSERT_SUCCESS(aws_byte_buf_init(&encoded, allocator, 1024));
+    ASSERT_SUCCESS(aws_huffman_encode(&encoder.huffman_encoder, &to_encode, &encoded));
+    struct aws_byte_cursor encoded_cursor = aws_byte_cursor_from_buf(&encoded);
+
+    for (size_t chunk_size = 1; chunk_size <= 8; ++chunk_size) {
+        struct aws_byte_buf decoded;
+        ASSERT_SUCCESS(aws_byte_buf_init(&decoded, allocator, 1)); /* Note buffer is initially too small */
+
+        struct aws_hpack_huffman_decoder huffman_decoder;
+        aws_hpack_huffman_decoder_reset(&huffman_decoder);
+
+        struct aws_byte_cursor to_decode = encoded_cursor;
+        while (to_decode.len) {
+            struct aws_byte_cursor chunk = aws_byte_cursor_advance(&to_decode, aws_min_size(chunk_size, to_decode.len));
+            ASSERT_SUCCESS(aws_hpack_huffman_decode(&huffman_decoder, &chunk, &decoded));
+            ASSERT_UINT_EQUALS(0, chunk.len);
+        }
+        ASSERT_SUCCESS(aws_hpack_huffman_decode_finish(&huffman_decoder));
+        ASSERT_BIN_ARRAYS_EQUALS(all_bytes, sizeof(all_bytes), decoded.buffer, decoded.len);
+
+        aws_byte_buf_clean_up(&decoded);
+    }
+
+    aws_byte_buf_clean_up(&encoded);
+    aws_hpack_encoder_clean_up(&encoder);
+    aws_http_library_clean_up();
+    return AWS_OP_SUCCESS;
+}
+
+/* Realistic header values */
+static const char *s_realistic_header_values[] = {
+    "www.example.com",
+    "Mozilla/5.0 (Macintosh; Intel Mac OS X 10_15_7) AppleWebKit/537.36 (KHTML, like Gecko)",
+    "text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8",
+    "gzip, deflate, br",
+    "Mon, 21 Oct 2013 20:13:21 GMT",
+    "private, max-age=0, no-cache",
+    "AWS4-HMAC-SHA256 Credential=AKIDEXAMPLE/20150830/us-east-1/iam/aws4_request, "
+    "SignedHeaders=content-type;host;x-amz-date, "
+    "Signature=5d672d79c15b13162d9279b0855cfba6789a8edb4c82c400e06b5924a6f2b5d7",
+    "/my-bucket/path/to/some/object.json?versionId=3HL4kqtJlcpXroDTDmJ.rmSpXd3dIbrHY",
+};
+
+/* The HPACK table-driven Huffman decoder must decode the same as the generic bit-by-bit aws_huffman_decode() */
+AWS_TEST_CASE(hpack_huffman_decode_matches_generic, test_hpack_huffman_decode_matches_generic)
+static int test_hpack_huffman_decode_matches_generic(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+    aws_http_library_init(allocator);
+
+    struct aws_hpack_encoder encoder;
+    aws_hpack_encoder_init(&encoder, allocator, NULL);
+
+    struct aws_huffman_decoder generic_decoder;
+    aws_huffman_decoder_init(&generic_decoder, encoder.huffman_encoder.coder);
+    aws_huffman_decoder_allow_growth(&generic_decoder, true);
+
+    struct aws_hpack_huffman_decoder hpack_decoder;
+
+    struct aws_byte_buf encoded;
+    ASSERT_SUCCESS(aws_byte_buf_init(&encoded, allocator, 1024));
+    struct aws_byte_buf generic_output;
+    ASSERT_SUCCESS(aws_byte_buf_init(&generic_output, allocator, 1024));
+    struct aws_byte_buf hpack_output;
+    ASSERT_SUCCESS(aws_byte_buf_init(&hpack_output, allocator, 1024));
+
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(s_realistic_header_values); ++i) {
+        /* Encode each value, without its length prefix */
+        struct aws_byte_cursor value = aws_byte_cursor_from_c_str(s_realistic_header_values[i]);
+        aws_byte_buf_reset(&encoded, false);
+        ASSERT_SUCCESS(aws_huffman_encode(&encoder.huffman_encoder, &value, &encoded));
+        aws_huffman_encoder_reset(&encoder.huffman_encoder);
+
+        aws_byte_buf_reset(&generic_output, false);
+        aws_huffman_decoder_reset(&generic_decoder);
+        struct aws_byte_cursor to_decode = aws_byte_cursor_from_buf(&encoded);
+        ASSERT_SUCCESS(aws_huffman_decode(&generic_decoder, &to_decode, &generic_output));
+
+        aws_byte_buf_reset(&hpack_output, false);
+        aws_hpack_huffman_decoder_reset(&hpack_decoder);
+        to_decode = aws_byte_cursor_from_buf(&encoded);
+        ASSERT_SUCCESS(aws_hpack_huffman_decode(&hpack_decoder, &to_decode, &hpack_output));
+        ASSERT_SUCCESS(aws_hpack_huffman_decode_finish(&hpack_decoder));
+
+        ASSERT_BIN_ARRAYS_EQUALS(value.ptr, value.len, generic_output.buffer, generic_output.len);
+        ASSERT_BIN_ARRAYS_EQUALS(value.ptr, value.len, hpack_output.buffer, hpack_output.len);
+    }
+
+    aws_byte_buf_clean_up(&hpack_output);
+    aws_byte_buf_clean_up(&generic_output);
+    aws_byte_buf_clean_up(&encoded);
+    aws_hpack_encoder_clean_up(&encoder);
+    aws_http_library_clean_up();
+    return AWS_OP_SUCCESS;
+}
+
+/* Huffman-encoded string literal matches RFC-7541 and the generic aws_huffman_encode() */
+AWS_TEST_CASE(hpack_encode_string_huffman, test_hpack_encode_string_huffman)
+static int test_hpack_encode_string_huffman(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+    aws_http_library_init(allocator);
+
+    struct aws_hpack_encoder encoder;
+    aws_hpack_encoder_init(&encoder, allocator, NULL);
+    aws_hpack_encoder_set_huffman_mode(&encoder, AWS_HPACK_HUFFMAN_ALWAYS);
+
+    struct aws_byte_buf output;
+    ASSERT_SUCCESS(aws_byte_buf_init(&output, allocator, 1)); /* Note buffer is initially too small */
+
+    /* RFC-7541 - Request Examples with Huffman Coding - C.4.1. First Request */
+    uint8_t expected[] = {0x8c, 0xf1, 0xe3, 0xc2, 0xe5, 0xf2, 0x3a, 0x6b, 0xa0, 0xab, 0x90, 0xf4, 0xff};
+    ASSERT_SUCCESS(aws_hpack_encode_string(&encoder, aws_byte_cursor_from_c_str("www.example.com"), &output));
+    ASSERT_BIN_ARRAYS_EQUALS(expected, sizeof(expected), output.buffer, output.len);
+
+    /* Every byte value, and strings of every length up to 256, compared against the generic encoder */
+    uint8_t all_bytes[256];
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(all_bytes); ++i) {
+        all_bytes[i] = (uint8_t)(255 - i);
+    }
+    struct aws_byte_buf generic_output;
+    ASSERT_SUCCESS(aws_byte_buf_init(&generic_output, allocator, 1024));
+    for (size_t len = 0; len <= sizeof(all_bytes); ++len) {
+        struct aws_byte_cursor to_encode = aws_byte_cursor_from_array(all_bytes, len);
+
+        aws_byte_buf_reset(&output, false);
+        ASSERT_SUCCESS(aws_hpack_encode_string(&encoder, to_encode, &output));
+
+        aws_byte_buf_reset(&generic_output, false);
+        const size_t generic_len = aws_huffman_get_encoded_length(&encoder.huffman_encoder, to_encode);
+        ASSERT_SUCCESS(aws_hpack_encode_integer(generic_len, 0x80, 7, &generic_output));
+        ASSERT_SUCCESS(aws_huffman_encode(&encoder.huffman_encoder, &to_encode, &generic_output));
+        aws_huffman_encoder_reset(&encoder.huffman_encoder);
+
+        ASSERT_BIN_ARRAYS_EQUALS(generic_output.buffer, generic_output.len, output.buffer, output.len);
+    }
+
+    aws_byte_buf_clean_up(&generic_output);
+    aws_byte_buf_clean_up(&output);
+    aws_hpack_encoder_clean_up(&encoder);
+    aws_http_library_clean_up();
+    return AWS_OP_SUCCESS;
+}
+
+/* aws_hpack_encode_string() in SMALLEST mode must match doing the same with the generic aws_huffman encoder */
+AWS_TEST_CASE(hpack_huffman_encode_smallest_matches_generic, test_hpack_huffman_encode_smallest_matches_generic)
+static int test_hpack_huffman_encode_smallest_matches_generic(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+    aws_http_library_init(allocator);
+
+    struct aws_hpack_encoder encoder;
+    aws_hpack_encoder_init(&encoder, allocator, NULL);
+    aws_hpack_encoder_set_huffman_mode(&encoder, AWS_HPACK_HUFFMAN_SMALLEST);
+
+    struct aws_byte_buf output;
+    ASSERT_SUCCESS(aws_byte_buf_init(&output, allocator, 1024));
+    struct aws_byte_buf generic_output;
+    ASSERT_SUCCESS(aws_byte_buf_init(&generic_output, allocator, 1024));
+
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(s_realistic_header_values); ++i) {
+        struct aws_byte_cursor to_encode = aws_byte_cursor_from_c_str(s_realistic_header_values[i]);
+
+        /* What "smallest" mode used to do: measure, then encode */
+        aws_byte_buf_reset(&generic_output, false);
+        const size_t huffman_len = aws_huffman_get_encoded_length(&encoder.huffman_encoder, to_encode);
+        if (huffman_len < to_encode.len) {
+            ASSERT_SUCCESS(aws_hpack_encode_integer(huffman_len, 0x80, 7, &generic_output));
+            ASSERT_SUCCESS(aws_huffman_encode(&encoder.huffman_encoder, &to_encode, &generic_output));
+            aws_huffman_encoder_reset(&encoder.huffman_encoder);
+        } else {
+            ASSERT_SUCCESS(aws_hpack_encode_integer(to_encode.len, 0, 7, &generic_output));
+            ASSERT_SUCCESS(aws_byte_buf_append_dynamic(&generic_output, &to_encode));
+        }
+
+        aws_byte_buf_reset(&output, false);
+        to_encode = aws_byte_cursor_from_c_str(s_realistic_header_values[i]);
+        ASSERT_SUCCESS(aws_hpack_encode_string(&encoder, to_encode, &output));
+
+        ASSERT_BIN_ARRAYS_EQUALS(generic_output.buffer, generic_output.len, output.buffer, output.len);
+    }
+
+    aws_byte_buf_clean_up(&generic_output);
+    aws_byte_buf_clean_up(&output);
+    aws_hpack_encoder_clean_up(&encoder);
+    aws_http_library_clean_up();
+    return AWS_OP_SUCCESS;
+}
@@ -0,0 +1,107 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/common/clock.h>
+#include <aws/http/private/manager_histogram.h>
+
+#include <aws/testing/aws_test_harness.h>
+
+static void s_record_us(struct aws_http_atomic_histogram *histogram, uint64_t duration_us) {
+    uint64_t start_ns = 1000;
+    uint64_t end_ns = start_ns + aws_timestamp_convert(duration_us, AWS_TIMESTAMP_MICROS, AWS_TIMESTAMP_NANOS, NULL);
+    aws_http_atomic_histogram_record(histogram, start_ns, end_ns);
+}
+
+/* Returns the bucket a duration was recorded in */
+static size_t s_find_only_bucket(const struct aws_http_manager_histogram *histogram) {
+    for (size_t i = 0; i < AWS_HTTP_MANAGER_HISTOGRAM_BUCKET_COUNT; ++i) {
+        if (histogram->buckets[i] > 0) {
+            return i;
+        }
+    }
+    return AWS_HTTP_MANAGER_HISTOGRAM_BUCKET_COUNT;
+}
+
+static int s_manager_histogram_buckets_fn(struct aws_allocator *allocator, void *ctx) {
+    (void)allocator;
+    (void)ctx;
+
+    /* Lower bounds start at 0 and grow, each bucket no wider than 1/8 of its lower bound past the exact ones */
+    ASSERT_UINT_EQUALS(0, aws_http_manager_histogram_get_bucket_lower_bound(0));
+    for (size_t i = 1; i < AWS_HTTP_MANAGER_HISTOGRAM_BUCKET_COUNT; ++i) {
+        uint64_t lower_bound = aws_http_manager_histogram_get_bucket_lower_bound(i);
+        uint64_t previous_lower_bound = aws_http_manager_histogram_get_bucket_lower_bound(i - 1);
+        ASSERT_TRUE(lower_bound > previous_lower_bound);
+        if (i > 8) {
+            ASSERT_TRUE((lower_bound - previous_lower_bound) * 8 <= previous_lower_bound);
+        }
+    }
+
+    /* A duration lands in the bucket whose range holds it */
+    const uint64_t durations_us[] = {0, 1, 7, 8, 9, 15, 16, 17, 100, 999, 1000, 123456, 3600000000ULL};
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(durations_us); ++i) {
+        struct aws_http_atomic_histogram histogram;
+        aws_http_atomic_histogram_init(&histogram);
+        s_record_us(&histogram, durations_us[i]);
+
+        struct aws_http_manager_histogram snapshot;
+        aws_http_atomic_histogram_snapshot(&histogram, &snapshot);
+        ASSERT_UINT_EQUALS(1, snapshot.count);
+        ASSERT_UINT_EQUALS(durations_us[i], snapshot.sum_us);
+
+        size_t bucket = s_find_only_bucket(&snapshot);
+        ASSERT_TRUE(bucket < AWS_HTTP_MANAGER_HISTOGRAM_BUCKET_COUNT);
+        ASSERT_TRUE(aws_http_manager_histogram_get_bucket_lower_bound(bucket) <= durations_us[i]);
+        ASSERT_TRUE(durations_us[i] < aws_http_manager_histogram_get_bucket_lower_bound(bucket + 1));
+    }
+
+    /* Anything too long goes in the last bucket, and a clock going backwards counts as 0 */
+    struct aws_http_atomic_histogram histogram;
+    aws_http_atomic_histogram_init(&histogram);
+    s_record_us(&histogram, UINT64_MAX / 2000);
+    aws_http_atomic_histogram_record(&histogram, 2000, 1000);
+
+    struct aws_http_manager_histogram snapshot;
+    aws_http_atomic_histogram_snapshot(&histogram, &snapshot);
+    ASSERT_UINT_EQUALS(2, snapshot.count);
+    ASSERT_UINT_EQUALS(1, snapshot.buckets[AWS_HTTP_MANAGER_HISTOGRAM_BUCKET_COUNT - 1]);
+    ASSERT_UINT_EQUALS(1, snapshot.buckets[0]);
+
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(manager_histogram_buckets, s_manager_histogram_buckets_fn)
+
+static int s_manager_histogram_percentiles_fn(struct aws_allocator *allocator, void *ctx) {
+    (void)allocator;
+    (void)ctx;
+
+    struct aws_http_atomic_histogram histogram;
+    aws_http_atomic_histogram_init(&histogram);
+
+    struct aws_http_manager_histogram snapshot;
+    aws_http_atomic_histogram_snapshot(&histogram, &snapshot);
+    ASSERT_UINT_EQUALS(0, snapshot.count);
+    ASSERT_UINT_EQUALS(0, aws_http_manager_histogram_get_percentile(&snapshot, 50.0));
+
+    /* 1ms to 1000ms */
+    for (uint64_t i = 1; i <= 1000; ++i) {
+        s_record_us(&histogram, i * 1000);
+    }
+    aws_http_atomic_histogram_snapshot(&histogram, &snapshot);
+    ASSERT_UINT_EQUALS(1000, snapshot.count);
+    ASSERT_UINT_EQUALS(500500000, snapshot.sum_us);
+
+    /* Each result is an upper bound on the real value, and within 12.5% of it */
+    const double percentiles[] = {0.0, 1.0, 50.0, 90.0, 99.0, 99.9, 100.0};
+    const uint64_t expected_us[] = {1000, 10000, 500000, 900000, 990000, 999000, 1000000};
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(percentiles); ++i) {
+        uint64_t value_us = aws_http_manager_histogram_get_percentile(&snapshot, percentiles[i]);
+        ASSERT_TRUE(value_us >= expected_us[i]);
+        ASSERT_TRUE(value_us <= expected_us[i] + expected_us[i] / 8);
+    }
+
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(manager_histogram_percentiles, s_manager_histogram_percentiles_fn)
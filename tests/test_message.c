@@ -7,8 +7,13 @@
 #include <aws/http/private/request_response_impl.h>
 #include <aws/http/request_response.h>
 #include <aws/http/status_code.h>
+#include <aws/io/stream.h>
 #include <aws/testing/aws_test_harness.h>
 
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
 #define TEST_CASE(NAME)                                                                                                \
     AWS_TEST_CASE(NAME, s_test_##NAME);                                                                                \
     static int s_test_##NAME(struct aws_allocator *allocator, void *ctx)
@@ -325,6 +330,324 @@ TEST_CASE(headers_clear) {
     return AWS_OP_SUCCESS;
 }
 
+TEST_CASE(headers_new_with_capacity) {
+    (void)ctx;
+    struct aws_http_headers *headers = aws_http_headers_new_with_capacity(allocator, 25);
+    ASSERT_NOT_NULL(headers);
+
+    char name[32];
+    char value[32];
+    for (int i = 0; i < 25; ++i) {
+        snprintf(name, sizeof(name), "X-Header-%d", i);
+        snprintf(value, sizeof(value), "value-%d", i);
+        ASSERT_SUCCESS(
+            aws_http_headers_add(headers, aws_byte_cursor_from_c_str(name), aws_byte_cursor_from_c_str(value)));
+    }
+
+    ASSERT_UINT_EQUALS(25, aws_http_headers_count(headers));
+    for (int i = 0; i < 25; ++i) {
+        snprintf(name, sizeof(name), "X-Header-%d", i);
+        snprintf(value, sizeof(value), "value-%d", i);
+        struct aws_http_header get;
+        ASSERT_SUCCESS(aws_http_headers_get_index(headers, (size_t)i, &get));
+        ASSERT_SUCCESS(s_check_header_eq(get, name, value));
+    }
+
+    aws_http_headers_release(headers);
+    return AWS_OP_SUCCESS;
+}
+
+/* Strings must keep their address while other headers come and go, since users hold cursors to them */
+TEST_CASE(headers_string_storage_is_stable) {
+    (void)ctx;
+    struct aws_http_headers *headers = aws_http_headers_new(allocator);
+    ASSERT_NOT_NULL(headers);
+
+    ASSERT_SUCCESS(
+        aws_http_headers_add(headers, aws_byte_cursor_from_c_str("Host"), aws_byte_cursor_from_c_str("example.com")));
+    struct aws_http_header host;
+    ASSERT_SUCCESS(aws_http_headers_get_index(headers, 0, &host));
+
+    /* Fill several string blocks, including values too big for a block of their own */
+    uint8_t big_value[3000];
+    memset(big_value, 'v', sizeof(big_value));
+    for (size_t i = 0; i < 100; ++i) {
+        struct aws_byte_cursor value = aws_byte_cursor_from_array(big_value, (i * 97) % sizeof(big_value));
+        ASSERT_SUCCESS(aws_http_headers_add(headers, aws_byte_cursor_from_c_str("X-Filler"), value));
+    }
+
+    /* Erasing other headers must not disturb the first one */
+    ASSERT_SUCCESS(aws_http_headers_erase(headers, aws_byte_cursor_from_c_str("X-Filler")));
+    ASSERT_UINT_EQUALS(1, aws_http_headers_count(headers));
+
+    struct aws_http_header get;
+    ASSERT_SUCCESS(aws_http_headers_get_index(headers, 0, &get));
+    ASSERT_PTR_EQUALS(host.name.ptr, get.name.ptr);
+    ASSERT_PTR_EQUALS(host.value.ptr, get.value.ptr);
+    ASSERT_SUCCESS(s_check_header_eq(host, "Host", "example.com"));
+
+    /* set() may reference the memory of the very header it replaces */
+    for (size_t i = 0; i < 1000; ++i) {
+        ASSERT_SUCCESS(aws_http_headers_get_index(headers, 0, &get));
+        ASSERT_SUCCESS(aws_http_headers_set(headers, get.name, get.value));
+        ASSERT_UINT_EQUALS(1, aws_http_headers_count(headers));
+    }
+    ASSERT_SUCCESS(aws_http_headers_get_index(headers, 0, &get));
+    ASSERT_SUCCESS(s_check_header_eq(get, "Host", "example.com"));
+
+    /* Headers are still usable after clear() */
+    aws_http_headers_clear(headers);
+    ASSERT_SUCCESS(
+        aws_http_headers_add(headers, aws_byte_cursor_from_c_str("Cookie"), aws_byte_cursor_from_c_str("a=1")));
+    ASSERT_SUCCESS(aws_http_headers_get_index(headers, 0, &get));
+    ASSERT_SUCCESS(s_check_header_eq(get, "Cookie", "a=1"));
+
+    aws_http_headers_release(headers);
+    return AWS_OP_SUCCESS;
+}
+
+/* Check get() and get_all() against a plain scan of the array */
+static int s_check_lookups_match_scan(struct aws_http_headers *headers, struct aws_byte_cursor name) {
+    struct aws_byte_cursor first_value;
+    AWS_ZERO_STRUCT(first_value);
+    size_t matches = 0;
+    for (size_t i = 0; i < aws_http_headers_count(headers); ++i) {
+        struct aws_http_header header;
+        ASSERT_SUCCESS(aws_http_headers_get_index(headers, i, &header));
+        if (aws_http_header_name_eq(header.name, name)) {
+            if (matches++ == 0) {
+                first_value = header.value;
+            }
+        }
+    }
+
+    struct aws_byte_cursor value;
+    struct aws_string *all = aws_http_headers_get_all(headers, name);
+    if (matches == 0) {
+        ASSERT_ERROR(AWS_ERROR_HTTP_HEADER_NOT_FOUND, aws_http_headers_get(headers, name, &value));
+        ASSERT_NULL(all);
+        ASSERT_FALSE(aws_http_headers_has(headers, name));
+    } else {
+        ASSERT_SUCCESS(aws_http_headers_get(headers, name, &value));
+        ASSERT_PTR_EQUALS(first_value.ptr, value.ptr);
+        ASSERT_NOT_NULL(all);
+        /* Each value is 1 char, joined by ", " */
+        ASSERT_UINT_EQUALS(matches * 3 - 2, all->len);
+        aws_string_destroy(all);
+    }
+    return AWS_OP_SUCCESS;
+}
+
+/* Large collections look names up through an index. Mutate one at random and make sure lookups stay correct. */
+TEST_CASE(headers_name_index) {
+    (void)ctx;
+    struct aws_http_headers *headers = aws_http_headers_new(allocator);
+    ASSERT_NOT_NULL(headers);
+
+    const char *names[] = {"A", "b", "C", "d", "E", "f", "G", "h", ":path", "Unused"};
+    const char *values[] = {"0", "1", "2", "3", "4", "5", "6", "7", "8", "9"};
+    srand(7);
+
+    for (size_t op = 0; op < 3000; ++op) {
+        /* Pick names case-insensitively, to make sure the index is too */
+        char name_buf[16];
+        const char *name_src = names[rand() % (AWS_ARRAY_SIZE(names) - 1)];
+        size_t name_len = strlen(name_src);
+        for (size_t i = 0; i < name_len; ++i) {
+            unsigned char c = (unsigned char)name_src[i];
+            name_buf[i] = (char)((rand() % 2) ? toupper(c) : tolower(c));
+        }
+        struct aws_byte_cursor name = aws_byte_cursor_from_array(name_buf, name_len);
+        struct aws_byte_cursor value = aws_byte_cursor_from_c_str(values[rand() % AWS_ARRAY_SIZE(values)]);
+
+        /* Grow to around 60 headers, shrinking back below the index threshold now and then */
+        size_t count = aws_http_headers_count(headers);
+        int action = rand() % 10;
+        if (count < 60 && action < 5) {
+            ASSERT_SUCCESS(aws_http_headers_add(headers, name, value));
+        } else if (action == 5) {
+            ASSERT_SUCCESS(aws_http_headers_set(headers, name, value));
+        } else if (action == 6) {
+            aws_http_headers_erase(headers, name);
+        } else if (action == 7) {
+            aws_http_headers_erase_value(headers, name, value);
+        } else if (count > 0) {
+            ASSERT_SUCCESS(aws_http_headers_erase_index(headers, (size_t)rand() % count));
+        }
+
+        if (op % 500 == 499) {
+            aws_http_headers_clear(headers);
+        }
+
+        for (size_t i = 0; i < AWS_ARRAY_SIZE(names); ++i) {
+            ASSERT_SUCCESS(s_check_lookups_match_scan(headers, aws_byte_cursor_from_c_str(names[i])));
+        }
+    }
+
+    aws_http_headers_release(headers);
+    return AWS_OP_SUCCESS;
+}
+
+static int s_check_headers_match(const struct aws_http_headers *a, const struct aws_http_headers *b) {
+    ASSERT_UINT_EQUALS(aws_http_headers_count(a), aws_http_headers_count(b));
+    for (size_t i = 0; i < aws_http_headers_count(a); ++i) {
+        struct aws_http_header header_a;
+        struct aws_http_header header_b;
+        ASSERT_SUCCESS(aws_http_headers_get_index(a, i, &header_a));
+        ASSERT_SUCCESS(aws_http_headers_get_index(b, i, &header_b));
+        ASSERT_SUCCESS(s_check_headers_eq(header_a, header_b));
+    }
+    return AWS_OP_SUCCESS;
+}
+
+TEST_CASE(headers_layered) {
+    (void)ctx;
+    struct aws_http_headers *base = aws_http_headers_new(allocator);
+    const struct aws_http_header base_headers[] = {
+        s_make_header("User-Agent", "sdk/1.0"),
+        s_make_header("X-Trace", "abc"),
+        s_make_header("Accept", "text/html"),
+    };
+    ASSERT_SUCCESS(aws_http_headers_add_array(base, base_headers, AWS_ARRAY_SIZE(base_headers)));
+
+    struct aws_http_headers *headers = aws_http_headers_new_layered(allocator, base);
+    ASSERT_NOT_NULL(headers);
+
+    /* Starts out looking like the base, storage is shared */
+    ASSERT_SUCCESS(s_check_headers_match(base, headers));
+    struct aws_http_header get;
+    struct aws_http_header get_base;
+    ASSERT_SUCCESS(aws_http_headers_get_index(headers, 1, &get));
+    ASSERT_SUCCESS(aws_http_headers_get_index(base, 1, &get_base));
+    ASSERT_PTR_EQUALS(get_base.value.ptr, get.value.ptr);
+
+    /* Additions only go to the top layer */
+    ASSERT_SUCCESS(
+        aws_http_headers_add(headers, aws_byte_cursor_from_c_str("Host"), aws_byte_cursor_from_c_str("a.com")));
+    ASSERT_SUCCESS(
+        aws_http_headers_add(headers, aws_byte_cursor_from_c_str("Accept"), aws_byte_cursor_from_c_str("*/*")));
+    ASSERT_UINT_EQUALS(5, aws_http_headers_count(headers));
+    ASSERT_UINT_EQUALS(3, aws_http_headers_count(base));
+    ASSERT_SUCCESS(aws_http_headers_get_index(headers, 3, &get));
+    ASSERT_SUCCESS(s_check_header_eq(get, "Host", "a.com"));
+
+    /* Lookups see both layers, base first */
+    struct aws_byte_cursor value;
+    ASSERT_SUCCESS(aws_http_headers_get(headers, aws_byte_cursor_from_c_str("user-agent"), &value));
+    ASSERT_SUCCESS(s_check_value_eq(value, "sdk/1.0"));
+    ASSERT_SUCCESS(aws_http_headers_get(headers, aws_byte_cursor_from_c_str("host"), &value));
+    ASSERT_SUCCESS(s_check_value_eq(value, "a.com"));
+    struct aws_string *all = aws_http_headers_get_all(headers, aws_byte_cursor_from_c_str("Accept"));
+    ASSERT_NOT_NULL(all);
+    ASSERT_TRUE(aws_string_eq_c_str(all, "text/html, */*"));
+    aws_string_destroy(all);
+
+    /* Erasing a header only in the top layer leaves the base shared */
+    ASSERT_SUCCESS(aws_http_headers_erase(headers, aws_byte_cursor_from_c_str("Host")));
+    ASSERT_UINT_EQUALS(4, aws_http_headers_count(headers));
+
+    /* Replacing a base header copies the base, and leaves the base alone */
+    ASSERT_SUCCESS(
+        aws_http_headers_set(headers, aws_byte_cursor_from_c_str("X-Trace"), aws_byte_cursor_from_c_str("def")));
+    ASSERT_SUCCESS(aws_http_headers_get(headers, aws_byte_cursor_from_c_str("X-Trace"), &value));
+    ASSERT_SUCCESS(s_check_value_eq(value, "def"));
+    ASSERT_SUCCESS(aws_http_headers_get(base, aws_byte_cursor_from_c_str("X-Trace"), &value));
+    ASSERT_SUCCESS(s_check_value_eq(value, "abc"));
+    ASSERT_UINT_EQUALS(3, aws_http_headers_count(base));
+    ASSERT_UINT_EQUALS(4, aws_http_headers_count(headers));
+
+    /* Pseudo-headers go in front of the base's headers */
+    struct aws_http_headers *h2_headers = aws_http_headers_new_layered(allocator, base);
+    ASSERT_SUCCESS(aws_http2_headers_set_request_method(h2_headers, aws_byte_cursor_from_c_str("GET")));
+    ASSERT_SUCCESS(aws_http_headers_get_index(h2_headers, 0, &get));
+    ASSERT_SUCCESS(s_check_header_eq(get, ":method", "GET"));
+    ASSERT_UINT_EQUALS(4, aws_http_headers_count(h2_headers));
+    ASSERT_UINT_EQUALS(3, aws_http_headers_count(base));
+
+    /* Layered objects keep the base alive */
+    aws_http_headers_release(base);
+    ASSERT_SUCCESS(aws_http_headers_get(h2_headers, aws_byte_cursor_from_c_str("User-Agent"), &value));
+    ASSERT_SUCCESS(s_check_value_eq(value, "sdk/1.0"));
+
+    aws_http_headers_clear(h2_headers);
+    ASSERT_UINT_EQUALS(0, aws_http_headers_count(h2_headers));
+
+    aws_http_headers_release(h2_headers);
+    aws_http_headers_release(headers);
+    return AWS_OP_SUCCESS;
+}
+
+/* Apply random edits to a layered object and to a flat copy, they must always look the same */
+TEST_CASE(headers_layered_matches_flat) {
+    (void)ctx;
+    const char *names[] = {"A", "b", "C", ":path"};
+    const char *values[] = {"0", "1", "2"};
+    srand(31);
+
+    for (size_t round = 0; round < 50; ++round) {
+        struct aws_http_headers *base = aws_http_headers_new(allocator);
+        struct aws_http_headers *flat = aws_http_headers_new(allocator);
+        size_t base_count = (size_t)rand() % 24;
+        for (size_t i = 0; i < base_count; ++i) {
+            struct aws_byte_cursor name = aws_byte_cursor_from_c_str(names[rand() % 3]);
+            struct aws_byte_cursor value = aws_byte_cursor_from_c_str(values[rand() % 3]);
+            ASSERT_SUCCESS(aws_http_headers_add(base, name, value));
+            ASSERT_SUCCESS(aws_http_headers_add(flat, name, value));
+        }
+        struct aws_http_headers *layered = aws_http_headers_new_layered(allocator, base);
+        struct aws_http_headers *base_copy = aws_http_headers_new(allocator);
+        for (size_t i = 0; i < aws_http_headers_count(base); ++i) {
+            struct aws_http_header header;
+            ASSERT_SUCCESS(aws_http_headers_get_index(base, i, &header));
+            ASSERT_SUCCESS(aws_http_headers_add_header(base_copy, &header));
+        }
+
+        for (size_t op = 0; op < 40; ++op) {
+            struct aws_byte_cursor name = aws_byte_cursor_from_c_str(names[rand() % AWS_ARRAY_SIZE(names)]);
+            struct aws_byte_cursor value = aws_byte_cursor_from_c_str(values[rand() % AWS_ARRAY_SIZE(values)]);
+            size_t count = aws_http_headers_count(flat);
+            switch (rand() % 5) {
+                case 0:
+                    ASSERT_SUCCESS(aws_http_headers_add(flat, name, value));
+                    ASSERT_SUCCESS(aws_http_headers_add(layered, name, value));
+                    break;
+                case 1:
+                    ASSERT_SUCCESS(aws_http_headers_set(flat, name, value));
+                    ASSERT_SUCCESS(aws_http_headers_set(layered, name, value));
+                    break;
+                case 2:
+                    ASSERT_INT_EQUALS(aws_http_headers_erase(flat, name), aws_http_headers_erase(layered, name));
+                    break;
+                case 3:
+                    ASSERT_INT_EQUALS(
+                        aws_http_headers_erase_value(flat, name, value),
+                        aws_http_headers_erase_value(layered, name, value));
+                    break;
+                default:
+                    if (count > 0) {
+                        size_t index = (size_t)rand() % count;
+                        ASSERT_SUCCESS(aws_http_headers_erase_index(flat, index));
+                        ASSERT_SUCCESS(aws_http_headers_erase_index(layered, index));
+                    }
+                    break;
+            }
+
+            ASSERT_SUCCESS(s_check_headers_match(flat, layered));
+            for (size_t i = 0; i < AWS_ARRAY_SIZE(names); ++i) {
+                ASSERT_SUCCESS(s_check_lookups_match_scan(layered, aws_byte_cursor_from_c_str(names[i])));
+            }
+            ASSERT_SUCCESS(s_check_headers_match(base_copy, base));
+        }
+
+        aws_http_headers_release(layered);
+        aws_http_headers_release(base_copy);
+        aws_http_headers_release(flat);
+        aws_http_headers_release(base);
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
 TEST_CASE(headers_get_all) {
     (void)ctx;
 
@@ -513,3 +836,224 @@ TEST_CASE(message_with_existing_headers) {
     aws_http_message_release(message);
     return AWS_OP_SUCCESS;
 }
+
+TEST_CASE(message_reset) {
+    (void)ctx;
+    struct aws_http_message *request = aws_http_message_new_request(allocator);
+    ASSERT_NOT_NULL(request);
+
+    ASSERT_SUCCESS(aws_http_message_set_request_method(request, aws_byte_cursor_from_c_str("PUT")));
+    ASSERT_SUCCESS(aws_http_message_set_request_path(request, aws_byte_cursor_from_c_str("/a/long/path?query=1")));
+    struct aws_http_header header = {aws_byte_cursor_from_c_str("Host"), aws_byte_cursor_from_c_str("example.com")};
+    ASSERT_SUCCESS(aws_http_message_add_header(request, header));
+    struct aws_byte_cursor body_data = aws_byte_cursor_from_c_str("body");
+    struct aws_input_stream *body = aws_input_stream_new_from_cursor(allocator, &body_data);
+    aws_http_message_set_body_stream(request, body);
+    aws_input_stream_release(body);
+
+    struct aws_byte_cursor path;
+    ASSERT_SUCCESS(aws_http_message_get_request_path(request, &path));
+    struct aws_http_headers *headers = aws_http_message_get_headers(request);
+
+    ASSERT_SUCCESS(aws_http_message_reset(request));
+
+    /* Everything is blank again */
+    struct aws_byte_cursor get;
+    ASSERT_ERROR(AWS_ERROR_HTTP_DATA_NOT_AVAILABLE, aws_http_message_get_request_method(request, &get));
+    ASSERT_ERROR(AWS_ERROR_HTTP_DATA_NOT_AVAILABLE, aws_http_message_get_request_path(request, &get));
+    ASSERT_UINT_EQUALS(0, aws_http_message_get_header_count(request));
+    ASSERT_NULL(aws_http_message_get_body_stream(request));
+    ASSERT_TRUE(aws_http_message_is_request(request));
+
+    /* Storage is kept for reuse */
+    ASSERT_PTR_EQUALS(headers, aws_http_message_get_headers(request));
+    ASSERT_SUCCESS(aws_http_message_set_request_path(request, aws_byte_cursor_from_c_str("/short")));
+    ASSERT_SUCCESS(aws_http_message_get_request_path(request, &get));
+    ASSERT_PTR_EQUALS(path.ptr, get.ptr);
+    ASSERT_TRUE(aws_byte_cursor_eq_c_str(&get, "/short"));
+
+    /* Setting a value from a piece of itself works */
+    ASSERT_SUCCESS(aws_http_message_set_request_path(request, aws_byte_cursor_from_array(get.ptr + 1, 3)));
+    ASSERT_SUCCESS(aws_http_message_get_request_path(request, &get));
+    ASSERT_TRUE(aws_byte_cursor_eq_c_str(&get, "sho"));
+
+    aws_http_message_release(request);
+
+    /* Responses go back to an unknown status */
+    struct aws_http_message *response = aws_http_message_new_response(allocator);
+    ASSERT_NOT_NULL(response);
+    ASSERT_SUCCESS(aws_http_message_set_response_status(response, 404));
+    ASSERT_SUCCESS(aws_http_message_reset(response));
+    int status;
+    ASSERT_ERROR(AWS_ERROR_HTTP_DATA_NOT_AVAILABLE, aws_http_message_get_response_status(response, &status));
+    aws_http_message_release(response);
+
+    return AWS_OP_SUCCESS;
+}
+
+/* Headers held elsewhere must not be cleared out from under their other holder */
+TEST_CASE(message_reset_with_shared_headers) {
+    (void)ctx;
+    struct aws_http_headers *headers = aws_http_headers_new(allocator);
+    ASSERT_SUCCESS(
+        aws_http_headers_add(headers, aws_byte_cursor_from_c_str("Host"), aws_byte_cursor_from_c_str("example.com")));
+
+    struct aws_http_message *request = aws_http_message_new_request_with_headers(allocator, headers);
+    ASSERT_NOT_NULL(request);
+
+    ASSERT_SUCCESS(aws_http_message_reset(request));
+    ASSERT_UINT_EQUALS(0, aws_http_message_get_header_count(request));
+    ASSERT_FALSE(headers == aws_http_message_get_headers(request));
+    ASSERT_TRUE(aws_http_headers_has(headers, aws_byte_cursor_from_c_str("Host")));
+
+    aws_http_message_release(request);
+    aws_http_headers_release(headers);
+    return AWS_OP_SUCCESS;
+}
+
+TEST_CASE(message_pool_reuses_requests) {
+    (void)ctx;
+    struct aws_http_message_pool *pool = aws_http_message_pool_new(allocator, 2);
+    ASSERT_NOT_NULL(pool);
+
+    struct aws_http_message *a = aws_http_message_pool_acquire_request(pool);
+    struct aws_http_message *b = aws_http_message_pool_acquire_request(pool);
+    struct aws_http_message *c = aws_http_message_pool_acquire_request(pool);
+    ASSERT_NOT_NULL(a);
+    ASSERT_NOT_NULL(b);
+    ASSERT_NOT_NULL(c);
+    ASSERT_TRUE(aws_http_message_is_request(a));
+    ASSERT_INT_EQUALS(AWS_HTTP_VERSION_1_1, aws_http_message_get_protocol_version(a));
+
+    ASSERT_SUCCESS(aws_http_message_set_request_method(a, aws_byte_cursor_from_c_str("GET")));
+    struct aws_http_header header = {aws_byte_cursor_from_c_str("Host"), aws_byte_cursor_from_c_str("example.com")};
+    ASSERT_SUCCESS(aws_http_message_add_header(a, header));
+
+    /* A message that's held elsewhere isn't pooled, it's just released */
+    aws_http_message_acquire(c);
+    aws_http_message_pool_release(pool, c);
+
+    /* These are reset and kept */
+    aws_http_message_pool_release(pool, a);
+    aws_http_message_pool_release(pool, b);
+
+    /* The pool is full now, this one is just released */
+    aws_http_message_pool_release(pool, c);
+
+    /* Most recently returned comes back first, blank */
+    struct aws_http_message *reused = aws_http_message_pool_acquire_request(pool);
+    ASSERT_PTR_EQUALS(b, reused);
+    reused = aws_http_message_pool_acquire_request(pool);
+    ASSERT_PTR_EQUALS(a, reused);
+    struct aws_byte_cursor method;
+    ASSERT_ERROR(AWS_ERROR_HTTP_DATA_NOT_AVAILABLE, aws_http_message_get_request_method(reused, &method));
+    ASSERT_UINT_EQUALS(0, aws_http_message_get_header_count(reused));
+
+    /* Messages outlive the pool */
+    aws_http_message_pool_release(pool, b);
+    aws_http_message_pool_destroy(pool);
+    ASSERT_SUCCESS(aws_http_message_set_request_method(a, aws_byte_cursor_from_c_str("POST")));
+    aws_http_message_release(a);
+
+    return AWS_OP_SUCCESS;
+}
+
+static void s_count_segment_release(void *user_data) {
+    size_t *release_count = user_data;
+    (*release_count)++;
+}
+
+/* Read a body segments stream like any other stream, segments are released as they're read */
+TEST_CASE(message_body_segments_stream_read) {
+    (void)ctx;
+    size_t release_counts[3] = {0};
+    struct aws_http_body_segment segments[] = {
+        {
+            .data = aws_byte_cursor_from_c_str("write "),
+            .on_release = s_count_segment_release,
+            .user_data = &release_counts[0],
+        },
+        {
+            .data = aws_byte_cursor_from_c_str(""),
+            .on_release = s_count_segment_release,
+            .user_data = &release_counts[1],
+        },
+        {
+            .data = aws_byte_cursor_from_c_str("more tests"),
+            .on_release = s_count_segment_release,
+            .user_data = &release_counts[2],
+        },
+    };
+
+    struct aws_input_stream *stream = aws_http_body_segments_stream_new(allocator, segments, AWS_ARRAY_SIZE(segments));
+    ASSERT_NOT_NULL(stream);
+
+    int64_t length;
+    ASSERT_SUCCESS(aws_input_stream_get_length(stream, &length));
+    ASSERT_INT_EQUALS(16, length);
+
+    /* read 4 bytes at a time */
+    uint8_t storage[16];
+    struct aws_byte_buf dest = aws_byte_buf_from_empty_array(storage, 4);
+    ASSERT_SUCCESS(aws_input_stream_read(stream, &dest));
+    ASSERT_UINT_EQUALS(0, release_counts[0]);
+
+    dest.capacity = 8;
+    ASSERT_SUCCESS(aws_input_stream_read(stream, &dest));
+    ASSERT_UINT_EQUALS(1, release_counts[0]);
+    ASSERT_UINT_EQUALS(1, release_counts[1]);
+    ASSERT_UINT_EQUALS(0, release_counts[2]);
+
+    struct aws_stream_status status;
+    ASSERT_SUCCESS(aws_input_stream_get_status(stream, &status));
+    ASSERT_FALSE(status.is_end_of_stream);
+
+    dest.capacity = sizeof(storage);
+    ASSERT_SUCCESS(aws_input_stream_read(stream, &dest));
+    ASSERT_BIN_ARRAYS_EQUALS("write more tests", 16, dest.buffer, dest.len);
+    ASSERT_UINT_EQUALS(1, release_counts[2]);
+
+    ASSERT_SUCCESS(aws_input_stream_get_status(stream, &status));
+    ASSERT_TRUE(status.is_end_of_stream);
+
+    /* seeking is not supported, since data is released as it's consumed */
+    ASSERT_FAILS(aws_input_stream_seek(stream, 0, AWS_SSB_BEGIN));
+
+    aws_input_stream_release(stream);
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(release_counts); ++i) {
+        ASSERT_UINT_EQUALS(1, release_counts[i]);
+    }
+    return AWS_OP_SUCCESS;
+}
+
+/* Segments that were never consumed are released when the stream is destroyed */
+TEST_CASE(message_body_segments_stream_release_unread) {
+    (void)ctx;
+    size_t release_counts[2] = {0};
+    struct aws_http_body_segment segments[] = {
+        {
+            .data = aws_byte_cursor_from_c_str("write more"),
+            .on_release = s_count_segment_release,
+            .user_data = &release_counts[0],
+        },
+        {
+            .data = aws_byte_cursor_from_c_str(" tests"),
+            .on_release = s_count_segment_release,
+            .user_data = &release_counts[1],
+        },
+    };
+
+    struct aws_input_stream *stream = aws_http_body_segments_stream_new(allocator, segments, AWS_ARRAY_SIZE(segments));
+    ASSERT_NOT_NULL(stream);
+
+    /* partially read 1st segment */
+    uint8_t storage[4];
+    struct aws_byte_buf dest = aws_byte_buf_from_empty_array(storage, sizeof(storage));
+    ASSERT_SUCCESS(aws_input_stream_read(stream, &dest));
+    ASSERT_UINT_EQUALS(0, release_counts[0]);
+
+    aws_input_stream_release(stream);
+    ASSERT_UINT_EQUALS(1, release_counts[0]);
+    ASSERT_UINT_EQUALS(1, release_counts[1]);
+    return AWS_OP_SUCCESS;
+}
@@ -0,0 +1,167 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/common/thread.h>
+#include <aws/http/private/mpsc_queue.h>
+
+#include <aws/testing/aws_test_harness.h>
+
+struct test_item {
+    struct aws_linked_list_node node;
+    size_t producer;
+    size_t sequence;
+};
+
+static int s_mpsc_queue_push_drain_fn(struct aws_allocator *allocator, void *ctx) {
+    (void)allocator;
+    (void)ctx;
+
+    struct aws_http_mpsc_queue queue;
+    aws_http_mpsc_queue_init(&queue);
+    ASSERT_TRUE(aws_http_mpsc_queue_is_empty(&queue));
+
+    struct aws_linked_list out_list;
+    aws_linked_list_init(&out_list);
+
+    /* Draining an empty queue is harmless */
+    aws_http_mpsc_queue_drain(&queue, &out_list);
+    ASSERT_TRUE(aws_linked_list_empty(&out_list));
+
+    struct test_item items[5];
+    AWS_ZERO_ARRAY(items);
+    for (size_t i = 0; i < 3; ++i) {
+        items[i].sequence = i;
+        ASSERT_TRUE(aws_http_mpsc_queue_push(&queue, &items[i].node));
+    }
+    ASSERT_FALSE(aws_http_mpsc_queue_is_empty(&queue));
+
+    aws_http_mpsc_queue_drain(&queue, &out_list);
+    ASSERT_TRUE(aws_http_mpsc_queue_is_empty(&queue));
+
+    /* A second drain appends after what's already in the list */
+    for (size_t i = 3; i < AWS_ARRAY_SIZE(items); ++i) {
+        items[i].sequence = i;
+        ASSERT_TRUE(aws_http_mpsc_queue_push(&queue, &items[i].node));
+    }
+    aws_http_mpsc_queue_drain(&queue, &out_list);
+
+    size_t expected = 0;
+    while (!aws_linked_list_empty(&out_list)) {
+        struct aws_linked_list_node *node = aws_linked_list_pop_front(&out_list);
+        struct test_item *item = AWS_CONTAINER_OF(node, struct test_item, node);
+        ASSERT_UINT_EQUALS(expected, item->sequence);
+        ++expected;
+    }
+    ASSERT_UINT_EQUALS(AWS_ARRAY_SIZE(items), expected);
+
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(mpsc_queue_push_drain, s_mpsc_queue_push_drain_fn)
+
+static int s_mpsc_queue_close_fn(struct aws_allocator *allocator, void *ctx) {
+    (void)allocator;
+    (void)ctx;
+
+    struct aws_http_mpsc_queue queue;
+    aws_http_mpsc_queue_init(&queue);
+
+    struct test_item items[2];
+    AWS_ZERO_ARRAY(items);
+    ASSERT_TRUE(aws_http_mpsc_queue_push(&queue, &items[0].node));
+
+    /* Closing hands back whatever was still queued */
+    struct aws_linked_list out_list;
+    aws_linked_list_init(&out_list);
+    aws_http_mpsc_queue_close(&queue, &out_list);
+    ASSERT_PTR_EQUALS(&items[0].node, aws_linked_list_front(&out_list));
+    ASSERT_PTR_EQUALS(&items[0].node, aws_linked_list_back(&out_list));
+    ASSERT_TRUE(aws_http_mpsc_queue_is_empty(&queue));
+
+    /* Pushes are rejected from then on, and nothing more comes out */
+    ASSERT_FALSE(aws_http_mpsc_queue_push(&queue, &items[1].node));
+    aws_linked_list_init(&out_list);
+    aws_http_mpsc_queue_drain(&queue, &out_list);
+    ASSERT_TRUE(aws_linked_list_empty(&out_list));
+    aws_http_mpsc_queue_close(&queue, &out_list);
+    ASSERT_TRUE(aws_linked_list_empty(&out_list));
+
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(mpsc_queue_close, s_mpsc_queue_close_fn)
+
+enum {
+    STRESS_PRODUCER_COUNT = 4,
+    STRESS_ITEMS_PER_PRODUCER = 10000,
+};
+
+struct stress_producer {
+    struct aws_http_mpsc_queue *queue;
+    struct test_item *items;
+    size_t producer;
+};
+
+static void s_stress_producer_fn(void *arg) {
+    struct stress_producer *producer = arg;
+    for (size_t i = 0; i < STRESS_ITEMS_PER_PRODUCER; ++i) {
+        struct test_item *item = &producer->items[i];
+        item->producer = producer->producer;
+        item->sequence = i;
+        AWS_FATAL_ASSERT(aws_http_mpsc_queue_push(producer->queue, &item->node));
+    }
+}
+
+/* Every item pushed from several threads comes out exactly once, and each producer's items stay in order */
+static int s_mpsc_queue_multiple_producers_fn(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct aws_http_mpsc_queue queue;
+    aws_http_mpsc_queue_init(&queue);
+
+    struct test_item *items =
+        aws_mem_calloc(allocator, STRESS_PRODUCER_COUNT * STRESS_ITEMS_PER_PRODUCER, sizeof(struct test_item));
+    struct stress_producer producers[STRESS_PRODUCER_COUNT];
+    struct aws_thread threads[STRESS_PRODUCER_COUNT];
+    for (size_t p = 0; p < STRESS_PRODUCER_COUNT; ++p) {
+        producers[p].queue = &queue;
+        producers[p].items = &items[p * STRESS_ITEMS_PER_PRODUCER];
+        producers[p].producer = p;
+        ASSERT_SUCCESS(aws_thread_init(&threads[p], allocator));
+        ASSERT_SUCCESS(aws_thread_launch(&threads[p], s_stress_producer_fn, &producers[p], NULL));
+    }
+
+    size_t next_sequence[STRESS_PRODUCER_COUNT];
+    AWS_ZERO_ARRAY(next_sequence);
+
+    /* Drain while the producers are still running, then once more after they've all finished */
+    for (size_t round = 0; round < 2; ++round) {
+        if (round == 0) {
+            aws_thread_current_sleep(1000000 /*1ms*/);
+        } else {
+            for (size_t p = 0; p < STRESS_PRODUCER_COUNT; ++p) {
+                ASSERT_SUCCESS(aws_thread_join(&threads[p]));
+                aws_thread_clean_up(&threads[p]);
+            }
+        }
+
+        struct aws_linked_list out_list;
+        aws_linked_list_init(&out_list);
+        aws_http_mpsc_queue_drain(&queue, &out_list);
+        while (!aws_linked_list_empty(&out_list)) {
+            struct aws_linked_list_node *node = aws_linked_list_pop_front(&out_list);
+            struct test_item *item = AWS_CONTAINER_OF(node, struct test_item, node);
+            ASSERT_UINT_EQUALS(next_sequence[item->producer], item->sequence);
+            ++next_sequence[item->producer];
+        }
+    }
+
+    for (size_t p = 0; p < STRESS_PRODUCER_COUNT; ++p) {
+        ASSERT_UINT_EQUALS(STRESS_ITEMS_PER_PRODUCER, next_sequence[p]);
+    }
+    ASSERT_TRUE(aws_http_mpsc_queue_is_empty(&queue));
+
+    aws_mem_release(allocator, items);
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(mpsc_queue_multiple_producers, s_mpsc_queue_multiple_producers_fn)
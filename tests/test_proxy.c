@@ -999,6 +999,116 @@ static int s_test_http_proxy_adaptive_ntlm_success(struct aws_allocator *allocat
 
 AWS_TEST_CASE(test_http_proxy_adaptive_ntlm_success, s_test_http_proxy_adaptive_ntlm_success);
 
+/* Once kerberos worked, the next connection with the same strategy skips the vanilla CONNECT and its 407 */
+static int s_test_http_proxy_adaptive_kerberos_remembered(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct aws_http_proxy_strategy *adaptive_strategy = s_create_adaptive_strategy(allocator);
+
+    struct aws_byte_cursor connect_responses[] = {
+        aws_byte_cursor_from_string(s_unauthorized_response),
+        aws_byte_cursor_from_string(s_good_response),
+    };
+
+    struct mocked_proxy_test_options options = {
+        .test_mode = PTTM_HTTP_TUNNEL,
+        .failure_type = PTFT_NONE,
+        .proxy_strategy = adaptive_strategy,
+        .mocked_response_count = 2,
+        .mocked_responses = connect_responses,
+    };
+
+    ASSERT_SUCCESS(s_setup_proxy_test(allocator, &options));
+    ASSERT_SUCCESS(proxy_tester_wait(&tester, proxy_tester_connection_setup_pred));
+    ASSERT_TRUE(tester.client_connection != NULL);
+    ASSERT_TRUE(tester.wait_result == AWS_ERROR_SUCCESS);
+    ASSERT_SUCCESS(proxy_tester_clean_up(&tester));
+
+    /* Second connection */
+    options.mocked_response_count = 1;
+    options.mocked_responses = &connect_responses[1];
+
+    aws_proxy_test_verify_connect_fn verifiers[] = {
+        s_verify_kerberos_connect_request,
+    };
+
+    ASSERT_SUCCESS(s_setup_proxy_test(allocator, &options));
+    ASSERT_SUCCESS(proxy_tester_wait(&tester, proxy_tester_connection_setup_pred));
+    ASSERT_TRUE(tester.client_connection != NULL);
+    ASSERT_TRUE(tester.wait_result == AWS_ERROR_SUCCESS);
+    ASSERT_SUCCESS(s_verify_connect_requests(verifiers, 1));
+
+    aws_http_proxy_strategy_release(adaptive_strategy);
+
+    ASSERT_SUCCESS(proxy_tester_clean_up(&tester));
+
+    return AWS_OP_SUCCESS;
+}
+
+AWS_TEST_CASE(test_http_proxy_adaptive_kerberos_remembered, s_test_http_proxy_adaptive_kerberos_remembered);
+
+/* ntlm's challenge answer only works after the ntlm credential attempt, so that's where the next connection starts */
+static int s_test_http_proxy_adaptive_ntlm_remembered(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct aws_http_proxy_strategy *adaptive_strategy = s_create_adaptive_strategy(allocator);
+
+    struct aws_byte_cursor bad_response = aws_byte_cursor_from_string(s_ntlm_response);
+    struct aws_byte_cursor good_response = aws_byte_cursor_from_string(s_good_response);
+
+    struct aws_byte_cursor first_connect_responses[] = {
+        bad_response,
+        bad_response,
+        bad_response,
+        good_response,
+    };
+
+    struct mocked_proxy_test_options options = {
+        .test_mode = PTTM_HTTP_TUNNEL,
+        .failure_type = PTFT_NONE,
+        .proxy_strategy = adaptive_strategy,
+        .mocked_response_count = 4,
+        .mocked_responses = first_connect_responses,
+    };
+
+    ASSERT_SUCCESS(s_setup_proxy_test(allocator, &options));
+    ASSERT_SUCCESS(proxy_tester_verify_connect_request(&tester));
+    ASSERT_SUCCESS(proxy_tester_send_connect_response(&tester));
+    ASSERT_SUCCESS(proxy_tester_wait(&tester, proxy_tester_connection_setup_pred));
+    ASSERT_TRUE(tester.client_connection != NULL);
+    ASSERT_TRUE(tester.wait_result == AWS_ERROR_SUCCESS);
+    ASSERT_SUCCESS(proxy_tester_clean_up(&tester));
+
+    /* Second connection */
+    struct aws_byte_cursor second_connect_responses[] = {
+        bad_response,
+        good_response,
+    };
+    options.mocked_response_count = 2;
+    options.mocked_responses = second_connect_responses;
+
+    aws_proxy_test_verify_connect_fn verifiers[] = {
+        s_verify_ntlm_connect_token_request,
+        s_verify_ntlm_connect_challenge_token_request,
+    };
+
+    ASSERT_SUCCESS(s_setup_proxy_test(allocator, &options));
+    ASSERT_SUCCESS(proxy_tester_verify_connect_request(&tester));
+    ASSERT_SUCCESS(proxy_tester_send_connect_response(&tester));
+    ASSERT_SUCCESS(proxy_tester_wait(&tester, proxy_tester_connection_setup_pred));
+    ASSERT_TRUE(tester.client_connection != NULL);
+    ASSERT_TRUE(tester.wait_result == AWS_ERROR_SUCCESS);
+    ASSERT_SUCCESS(s_verify_connect_requests(verifiers, 2));
+
+    aws_http_proxy_strategy_release(adaptive_strategy);
+
+    ASSERT_SUCCESS(proxy_tester_clean_up(&tester));
+
+    return AWS_OP_SUCCESS;
+}
+
+AWS_TEST_CASE(test_http_proxy_adaptive_ntlm_remembered, s_test_http_proxy_adaptive_ntlm_remembered);
+
 static int s_test_http_proxy_adaptive_failure(struct aws_allocator *allocator, void *ctx) {
     (void)ctx;
 
@@ -201,3 +201,102 @@ static int s_random_access_set_owns_element_fn(struct aws_allocator *allocator,
 }
 
 AWS_TEST_CASE(random_access_set_owns_element_test, s_random_access_set_owns_element_fn)
+
+struct intrusive_element {
+    int value;
+    struct aws_random_access_set_node node;
+};
+
+static int s_random_access_intrusive_set_fn(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+    struct intrusive_element elements[4];
+    AWS_ZERO_ARRAY(elements);
+
+    struct aws_random_access_intrusive_set set;
+    /* With only 1 initial element, so the array grows */
+    ASSERT_SUCCESS(aws_random_access_intrusive_set_init(&set, allocator, 1));
+    struct aws_random_access_set_node *out = NULL;
+    ASSERT_FAILS(aws_random_access_intrusive_set_random_get(&set, &out));
+
+    bool added = false;
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(elements); ++i) {
+        elements[i].value = (int)i;
+        ASSERT_SUCCESS(aws_random_access_intrusive_set_add(&set, &elements[i].node, &added));
+        ASSERT_TRUE(added);
+    }
+    /* You cannot have duplicates */
+    ASSERT_SUCCESS(aws_random_access_intrusive_set_add(&set, &elements[2].node, &added));
+    ASSERT_FALSE(added);
+    ASSERT_UINT_EQUALS(4, aws_random_access_intrusive_set_get_size(&set));
+
+    /* Remove from the middle, the last one takes its index */
+    aws_random_access_intrusive_set_remove(&set, &elements[1].node);
+    ASSERT_FALSE(aws_random_access_intrusive_set_contains(&set, &elements[1].node));
+    ASSERT_UINT_EQUALS(3, aws_random_access_intrusive_set_get_size(&set));
+    ASSERT_SUCCESS(aws_random_access_intrusive_set_get_at_index(&set, &out, 1));
+    ASSERT_PTR_EQUALS(&elements[3].node, out);
+    ASSERT_UINT_EQUALS(1, elements[3].node.index);
+    ASSERT_INT_EQUALS(3, AWS_CONTAINER_OF(out, struct intrusive_element, node)->value);
+    ASSERT_FAILS(aws_random_access_intrusive_set_get_at_index(&set, &out, 3));
+
+    /* Removing it again does nothing */
+    aws_random_access_intrusive_set_remove(&set, &elements[1].node);
+    ASSERT_UINT_EQUALS(3, aws_random_access_intrusive_set_get_size(&set));
+
+    /* Remove the last one */
+    aws_random_access_intrusive_set_remove(&set, &elements[2].node);
+    ASSERT_UINT_EQUALS(2, aws_random_access_intrusive_set_get_size(&set));
+
+    /* Random get only finds what's left */
+    for (size_t i = 0; i < 20; ++i) {
+        ASSERT_SUCCESS(aws_random_access_intrusive_set_random_get(&set, &out));
+        ASSERT_TRUE(out == &elements[0].node || out == &elements[3].node);
+    }
+
+    /* It can be added back */
+    ASSERT_SUCCESS(aws_random_access_intrusive_set_add(&set, &elements[1].node, &added));
+    ASSERT_TRUE(added);
+    ASSERT_TRUE(aws_random_access_intrusive_set_contains(&set, &elements[1].node));
+    ASSERT_UINT_EQUALS(2, elements[1].node.index);
+
+    aws_random_access_intrusive_set_clean_up(&set);
+    return AWS_OP_SUCCESS;
+}
+
+AWS_TEST_CASE(random_access_intrusive_set_test, s_random_access_intrusive_set_fn)
+
+static int s_random_access_intrusive_set_other_set_fn(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+    struct intrusive_element element;
+    AWS_ZERO_STRUCT(element);
+
+    struct aws_random_access_intrusive_set set_a;
+    struct aws_random_access_intrusive_set set_b;
+    ASSERT_SUCCESS(aws_random_access_intrusive_set_init(&set_a, allocator, 1));
+    ASSERT_SUCCESS(aws_random_access_intrusive_set_init(&set_b, allocator, 1));
+
+    bool added = false;
+    ASSERT_SUCCESS(aws_random_access_intrusive_set_add(&set_a, &element.node, &added));
+    ASSERT_TRUE(added);
+
+    /* A node is in one set at a time */
+    ASSERT_FAILS(aws_random_access_intrusive_set_add(&set_b, &element.node, &added));
+    ASSERT_INT_EQUALS(AWS_ERROR_INVALID_ARGUMENT, aws_last_error());
+    ASSERT_FALSE(added);
+    /* Removing from a set it's not in does nothing */
+    aws_random_access_intrusive_set_remove(&set_b, &element.node);
+    ASSERT_TRUE(aws_random_access_intrusive_set_contains(&set_a, &element.node));
+
+    /* Moving it */
+    aws_random_access_intrusive_set_remove(&set_a, &element.node);
+    ASSERT_SUCCESS(aws_random_access_intrusive_set_add(&set_b, &element.node, &added));
+    ASSERT_TRUE(added);
+    ASSERT_UINT_EQUALS(0, aws_random_access_intrusive_set_get_size(&set_a));
+    ASSERT_UINT_EQUALS(1, aws_random_access_intrusive_set_get_size(&set_b));
+
+    aws_random_access_intrusive_set_clean_up(&set_a);
+    aws_random_access_intrusive_set_clean_up(&set_b);
+    return AWS_OP_SUCCESS;
+}
+
+AWS_TEST_CASE(random_access_intrusive_set_other_set_test, s_random_access_intrusive_set_other_set_fn)
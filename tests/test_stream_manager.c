@@ -25,6 +25,7 @@
 #include <aws/common/byte_buf.h>
 #include <aws/common/condition_variable.h>
 #include <aws/common/string.h>
+#include <aws/common/thread.h>
 
 #include <aws/testing/aws_test_harness.h>
 #include <aws/testing/io_testing_channel.h>
@@ -52,6 +53,13 @@ struct sm_tester_options {
     bool close_connection_on_server_error;
     size_t connection_ping_period_ms;
     size_t connection_ping_timeout_ms;
+    enum aws_http2_stream_manager_connection_selection connection_selection;
+    bool enable_adaptive_concurrency;
+    size_t hedging_budget_percent;
+    size_t hedge_delay_ms;
+    struct aws_http2_stream_manager_coalescing_group *coalescing_group;
+    const struct aws_byte_cursor *certificate_names;
+    size_t num_certificate_names;
 };
 
 static struct aws_logger s_logger;
@@ -88,6 +96,8 @@ struct sm_tester {
     int stream_completed_error_code;
 
     bool is_shutdown_complete;
+    /* For the second stream manager of the coalescing tests */
+    bool is_coalesced_shutdown_complete;
 
     /* Fake HTTP/2 connection */
     size_t wait_for_fake_connection_count;
@@ -109,6 +119,13 @@ struct sm_tester {
     aws_http_on_client_connection_setup_fn *on_setup;
 
     size_t length_sent;
+
+    /* Whether the streams acquired from now on allow hedging */
+    bool allow_hedging;
+    /* The replay_buffer_size of the streams acquired from now on */
+    size_t replay_buffer_size;
+    /* Whether to acquire the streams with one aws_http2_stream_manager_acquire_streams call */
+    bool acquire_in_batch;
 };
 
 static struct sm_tester s_tester;
@@ -286,7 +303,14 @@ static int s_tester_init(struct sm_tester_options *options) {
         .close_connection_on_server_error = options->close_connection_on_server_error,
         .connection_ping_period_ms = options->connection_ping_period_ms,
         .connection_ping_timeout_ms = options->connection_ping_timeout_ms,
+        .connection_selection = options->connection_selection,
+        .enable_adaptive_concurrency = options->enable_adaptive_concurrency,
+        .hedging_budget_percent = options->hedging_budget_percent,
+        .hedge_delay_ms = options->hedge_delay_ms,
         .http2_prior_knowledge = options->prior_knowledge,
+        .coalescing_group = options->coalescing_group,
+        .certificate_names = options->certificate_names,
+        .num_certificate_names = options->num_certificate_names,
     };
     s_tester.stream_manager = aws_http2_stream_manager_new(alloc, &sm_options);
 
@@ -521,7 +545,23 @@ static int s_sm_stream_acquiring_customize_request(
         .options = request_options,
         .callback = s_sm_tester_on_stream_acquired,
         .user_data = &s_tester,
+        .allow_hedging = s_tester.allow_hedging,
+        .replay_buffer_size = s_tester.replay_buffer_size,
     };
+    if (s_tester.acquire_in_batch && num_streams == 0) {
+        aws_http2_stream_manager_acquire_streams(s_tester.stream_manager, NULL, 0);
+        return AWS_OP_SUCCESS;
+    }
+    if (s_tester.acquire_in_batch) {
+        struct aws_http2_stream_manager_acquire_stream_options *acquire_stream_options =
+            aws_mem_calloc(s_tester.allocator, (size_t)num_streams, sizeof(acquire_stream_option));
+        for (int i = 0; i < num_streams; ++i) {
+            acquire_stream_options[i] = acquire_stream_option;
+        }
+        aws_http2_stream_manager_acquire_streams(s_tester.stream_manager, acquire_stream_options, (size_t)num_streams);
+        aws_mem_release(s_tester.allocator, acquire_stream_options);
+        return AWS_OP_SUCCESS;
+    }
     for (int i = 0; i < num_streams; ++i) {
         /* TODO: Test the callback will always be fired asynced, as now the CM cannot ensure the callback happens
          * asynchronously, we cannot ensure it as well. */
@@ -1065,6 +1105,297 @@ TEST_CASE(h2_sm_mock_large_ideal_num_streams) {
     return s_tester_clean_up();
 }
 
+/* Test that a new stream goes to the connection with less left to download, when both have as many streams */
+TEST_CASE(h2_sm_mock_least_loaded_connection_selection) {
+    (void)ctx;
+    struct sm_tester_options options = {
+        .max_connections = 2,
+        .ideal_concurrent_streams_per_connection = 1,
+        .max_concurrent_streams_per_connection = 5,
+        .connection_selection = AWS_H2SM_CONNECTION_SELECTION_LEAST_LOADED,
+        .alloc = allocator,
+    };
+    ASSERT_SUCCESS(s_tester_init(&options));
+    s_override_cm_connect_function(s_aws_http_connection_manager_create_connection_sync_mock);
+    /* One stream on each connection */
+    ASSERT_SUCCESS(s_sm_stream_acquiring(2));
+    ASSERT_SUCCESS(s_wait_on_fake_connection_count(2));
+    s_drain_all_fake_connection_testing_channel();
+    ASSERT_SUCCESS(s_wait_on_streams_acquired_count(2));
+
+    /* The first connection's stream has a large response body on the way */
+    struct sm_fake_connection *loaded_connection = s_get_fake_connection(0);
+    struct sm_fake_connection *other_connection = s_get_fake_connection(1);
+    ASSERT_INT_EQUALS(1, s_fake_connection_get_stream_received(loaded_connection));
+    ASSERT_INT_EQUALS(1, s_fake_connection_get_stream_received(other_connection));
+    struct aws_http_header response_headers_src[] = {
+        DEFINE_HEADER(":status", "200"),
+        DEFINE_HEADER("content-length", "5"),
+    };
+    struct aws_http_headers *response_headers = aws_http_headers_new(allocator);
+    aws_http_headers_add_array(response_headers, response_headers_src, AWS_ARRAY_SIZE(response_headers_src));
+    struct aws_h2_frame *response_frame =
+        aws_h2_frame_new_headers(allocator, 1 /*stream_id*/, response_headers, false /*end_stream*/, 0, NULL);
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&loaded_connection->peer, response_frame));
+    aws_http_headers_release(response_headers);
+    testing_channel_drain_queued_tasks(&loaded_connection->testing_channel);
+
+    /* The streams on both are even, so the new one goes where less is left to download */
+    ASSERT_SUCCESS(s_sm_stream_acquiring(1));
+    s_drain_all_fake_connection_testing_channel();
+    ASSERT_SUCCESS(s_wait_on_streams_acquired_count(3));
+    ASSERT_INT_EQUALS(1, s_fake_connection_get_stream_received(loaded_connection));
+    ASSERT_INT_EQUALS(2, s_fake_connection_get_stream_received(other_connection));
+
+    /* Finish the download and the other connection's streams */
+    ASSERT_SUCCESS(h2_fake_peer_send_data_frame_str(&loaded_connection->peer, 1 /*stream_id*/, "hello", true));
+    testing_channel_drain_queued_tasks(&loaded_connection->testing_channel);
+    s_fake_connection_complete_streams(other_connection, 0 /*all streams*/);
+    ASSERT_SUCCESS(s_wait_on_streams_completed_count(3));
+    ASSERT_INT_EQUALS(0, s_tester.stream_complete_errors);
+
+    return s_tester_clean_up();
+}
+
+/* Test that the adaptive stream limit starts low, grows as streams complete, and drops on a refused stream */
+TEST_CASE(h2_sm_mock_adaptive_concurrency) {
+    (void)ctx;
+    struct sm_tester_options options = {
+        .max_connections = 1,
+        .enable_adaptive_concurrency = true,
+        .alloc = allocator,
+    };
+    ASSERT_SUCCESS(s_tester_init(&options));
+    s_override_cm_connect_function(s_aws_http_connection_manager_create_connection_sync_mock);
+
+    /* The peer allows 100, but the connection starts with 10 */
+    ASSERT_SUCCESS(s_sm_stream_acquiring(15));
+    ASSERT_SUCCESS(s_wait_on_fake_connection_count(1));
+    s_drain_all_fake_connection_testing_channel();
+    ASSERT_SUCCESS(s_wait_on_streams_acquired_count(10));
+    ASSERT_UINT_EQUALS(10, aws_array_list_length(&s_tester.streams));
+    struct aws_http_manager_metrics out_metrics;
+    aws_http2_stream_manager_fetch_metrics(s_tester.stream_manager, &out_metrics);
+    ASSERT_UINT_EQUALS(0, out_metrics.available_concurrency);
+    ASSERT_UINT_EQUALS(5, out_metrics.pending_concurrency_acquires);
+    ASSERT_UINT_EQUALS(10, out_metrics.leased_concurrency);
+
+    /* The completions raise the limit, so the waiting streams are made and there's room for more */
+    struct sm_fake_connection *fake_connection = s_get_fake_connection(0);
+    s_fake_connection_complete_streams(fake_connection, 10);
+    s_drain_all_fake_connection_testing_channel();
+    ASSERT_UINT_EQUALS(15, aws_array_list_length(&s_tester.streams));
+    ASSERT_SUCCESS(s_sm_stream_acquiring(20));
+    s_drain_all_fake_connection_testing_channel();
+    aws_http2_stream_manager_fetch_metrics(s_tester.stream_manager, &out_metrics);
+    size_t leased = out_metrics.leased_concurrency;
+    size_t pending = out_metrics.pending_concurrency_acquires;
+    ASSERT_TRUE(leased > 10);
+    ASSERT_UINT_EQUALS(25, leased + pending);
+    ASSERT_TRUE(pending > 0);
+
+    /* The peer refuses the newest stream: it isn't replaced, as the limit drops below the streams still open */
+    size_t stream_count = aws_array_list_length(&s_tester.streams);
+    uint32_t newest_stream_id = (uint32_t)(stream_count * 2 - 1);
+    struct aws_h2_frame *rst_stream =
+        aws_h2_frame_new_rst_stream(allocator, newest_stream_id, AWS_HTTP2_ERR_REFUSED_STREAM);
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&fake_connection->peer, rst_stream));
+    s_drain_all_fake_connection_testing_channel();
+    aws_http2_stream_manager_fetch_metrics(s_tester.stream_manager, &out_metrics);
+    ASSERT_UINT_EQUALS(leased - 1, out_metrics.leased_concurrency);
+    ASSERT_UINT_EQUALS(pending, out_metrics.pending_concurrency_acquires);
+    ASSERT_UINT_EQUALS(stream_count, aws_array_list_length(&s_tester.streams));
+
+    ASSERT_SUCCESS(s_complete_all_fake_connection_streams());
+    s_drain_all_fake_connection_testing_channel();
+    ASSERT_SUCCESS(s_complete_all_fake_connection_streams());
+    s_drain_all_fake_connection_testing_channel();
+    ASSERT_SUCCESS(s_complete_all_fake_connection_streams());
+
+    return s_tester_clean_up();
+}
+
+/* Test that streams acquired in one batch are spread over the connections, a task for each */
+TEST_CASE(h2_sm_mock_acquire_streams_batch) {
+    (void)ctx;
+    struct sm_tester_options options = {
+        .max_connections = 2,
+        .ideal_concurrent_streams_per_connection = 5,
+        .alloc = allocator,
+    };
+    ASSERT_SUCCESS(s_tester_init(&options));
+    s_override_cm_connect_function(s_aws_http_connection_manager_create_connection_sync_mock);
+    s_tester.acquire_in_batch = true;
+    ASSERT_SUCCESS(s_sm_stream_acquiring(10));
+    ASSERT_SUCCESS(s_wait_on_fake_connection_count(2));
+    s_drain_all_fake_connection_testing_channel();
+    ASSERT_SUCCESS(s_wait_on_streams_acquired_count(10));
+    ASSERT_UINT_EQUALS(0, s_tester.acquiring_stream_errors);
+    for (size_t i = 0; i < aws_array_list_length(&s_tester.fake_connections); ++i) {
+        struct sm_fake_connection *fake_connection = s_get_fake_connection(i);
+        ASSERT_INT_EQUALS(5, s_fake_connection_get_stream_received(fake_connection));
+    }
+
+    /* An empty batch does nothing */
+    ASSERT_SUCCESS(s_sm_stream_acquiring(0));
+    struct aws_http_manager_metrics out_metrics;
+    aws_http2_stream_manager_fetch_metrics(s_tester.stream_manager, &out_metrics);
+    ASSERT_UINT_EQUALS(0, out_metrics.pending_concurrency_acquires);
+    ASSERT_UINT_EQUALS(10, out_metrics.leased_concurrency);
+
+    ASSERT_SUCCESS(s_complete_all_fake_connection_streams());
+    ASSERT_SUCCESS(s_wait_on_streams_completed_count(10));
+    ASSERT_UINT_EQUALS(0, s_tester.stream_complete_errors);
+
+    return s_tester_clean_up();
+}
+
+/* Test that a slow stream is hedged on the other connection, and the first response wins */
+TEST_CASE(h2_sm_mock_hedging) {
+    (void)ctx;
+    struct sm_tester_options options = {
+        .max_connections = 2,
+        .ideal_concurrent_streams_per_connection = 1,
+        .hedging_budget_percent = 50,
+        .hedge_delay_ms = 10,
+        .alloc = allocator,
+    };
+    ASSERT_SUCCESS(s_tester_init(&options));
+    s_override_cm_connect_function(s_aws_http_connection_manager_create_connection_sync_mock);
+    /* A stream that doesn't allow hedging on the first connection, then one that does on the second */
+    ASSERT_SUCCESS(s_sm_stream_acquiring(1));
+    ASSERT_SUCCESS(s_wait_on_fake_connection_count(1));
+    s_drain_all_fake_connection_testing_channel();
+    ASSERT_SUCCESS(s_wait_on_streams_acquired_count(1));
+    s_tester.allow_hedging = true;
+    ASSERT_SUCCESS(s_sm_stream_acquiring(1));
+    ASSERT_SUCCESS(s_wait_on_fake_connection_count(2));
+    s_drain_all_fake_connection_testing_channel();
+    ASSERT_SUCCESS(s_wait_on_streams_acquired_count(2));
+    struct sm_fake_connection *other_connection = s_get_fake_connection(0);
+    struct sm_fake_connection *slow_connection = s_get_fake_connection(1);
+    ASSERT_INT_EQUALS(1, s_fake_connection_get_stream_received(other_connection));
+    ASSERT_INT_EQUALS(1, s_fake_connection_get_stream_received(slow_connection));
+
+    /* No response in time, so the request is sent again on the other connection */
+    aws_thread_current_sleep(aws_timestamp_convert(50, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL));
+    testing_channel_drain_queued_tasks(&slow_connection->testing_channel);
+    testing_channel_drain_queued_tasks(&other_connection->testing_channel);
+    ASSERT_INT_EQUALS(2, s_fake_connection_get_stream_received(other_connection));
+    ASSERT_UINT_EQUALS(2, aws_array_list_length(&s_tester.streams));
+
+    /* The duplicate answers first, which cancels the slow stream */
+    struct aws_http_header response_headers_src[] = {
+        DEFINE_HEADER(":status", "200"),
+    };
+    struct aws_http_headers *response_headers = aws_http_headers_new(allocator);
+    aws_http_headers_add_array(response_headers, response_headers_src, AWS_ARRAY_SIZE(response_headers_src));
+    struct aws_h2_frame *response_frame =
+        aws_h2_frame_new_headers(allocator, 3 /*stream_id*/, response_headers, true /*end_stream*/, 0, NULL);
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&other_connection->peer, response_frame));
+    testing_channel_drain_queued_tasks(&other_connection->testing_channel);
+    ASSERT_UINT_EQUALS(1, s_tester.stream_completed_count);
+    ASSERT_UINT_EQUALS(1, s_tester.stream_200_count);
+    testing_channel_drain_queued_tasks(&slow_connection->testing_channel);
+    ASSERT_SUCCESS(h2_fake_peer_decode_messages_from_testing_channel(&slow_connection->peer));
+    struct h2_decoded_frame *rst_stream_frame =
+        h2_decode_tester_find_frame(&slow_connection->peer.decode, AWS_H2_FRAME_T_RST_STREAM, 0, NULL);
+    ASSERT_NOT_NULL(rst_stream_frame);
+    ASSERT_UINT_EQUALS(1, rst_stream_frame->stream_id);
+    ASSERT_UINT_EQUALS(AWS_HTTP2_ERR_CANCEL, rst_stream_frame->error_code);
+    /* The user doesn't hear about the cancelled stream */
+    ASSERT_UINT_EQUALS(1, s_tester.stream_completed_count);
+    ASSERT_UINT_EQUALS(0, s_tester.stream_complete_errors);
+
+    /* The stream that doesn't allow hedging finishes as normal, and each acquisition is destroyed once */
+    response_frame =
+        aws_h2_frame_new_headers(allocator, 1 /*stream_id*/, response_headers, true /*end_stream*/, 0, NULL);
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&other_connection->peer, response_frame));
+    aws_http_headers_release(response_headers);
+    testing_channel_drain_queued_tasks(&other_connection->testing_channel);
+    ASSERT_SUCCESS(s_wait_on_streams_completed_count(2));
+    ASSERT_UINT_EQUALS(2, s_tester.stream_200_count);
+    ASSERT_UINT_EQUALS(0, s_tester.stream_complete_errors);
+    s_release_all_streams();
+    s_drain_all_fake_connection_testing_channel();
+    ASSERT_UINT_EQUALS(2, aws_atomic_load_int(&s_tester.stream_destroyed_count));
+
+    return s_tester_clean_up();
+}
+
+/* Test that a refused stream's request is sent again, body included, without the user seeing the refusal */
+TEST_CASE(h2_sm_mock_replay_refused_stream) {
+    (void)ctx;
+    struct sm_tester_options options = {
+        .max_connections = 1,
+        .alloc = allocator,
+    };
+    ASSERT_SUCCESS(s_tester_init(&options));
+    s_override_cm_connect_function(s_aws_http_connection_manager_create_connection_sync_mock);
+
+    struct aws_http_header request_headers_src[] = {
+        DEFINE_HEADER(":method", "PUT"),
+        DEFINE_HEADER(":scheme", "https"),
+        DEFINE_HEADER(":path", "/"),
+        DEFINE_HEADER(":authority", "www.amazon.com"),
+    };
+    struct aws_http_message *request = aws_http2_message_new_request(allocator);
+    aws_http_message_add_header_array(request, request_headers_src, AWS_ARRAY_SIZE(request_headers_src));
+    /* The body stream is never seeked, it's read once and the replay buffer sends it again */
+    struct aws_input_stream *body_stream =
+        aws_input_stream_new_tester(allocator, aws_byte_cursor_from_c_str("replay me"));
+    aws_http_message_set_body_stream(request, body_stream);
+    aws_input_stream_release(body_stream);
+    struct aws_http_make_request_options request_options = {
+        .self_size = sizeof(request_options),
+        .request = request,
+        .user_data = &s_tester,
+        .on_complete = s_sm_tester_on_stream_complete,
+        .on_destroy = s_sm_tester_on_stream_destroy,
+    };
+    s_tester.replay_buffer_size = 1024;
+    ASSERT_SUCCESS(s_sm_stream_acquiring_customize_request(1, &request_options));
+    aws_http_message_release(request);
+    ASSERT_SUCCESS(s_wait_on_fake_connection_count(1));
+    s_drain_all_fake_connection_testing_channel();
+    ASSERT_SUCCESS(s_wait_on_streams_acquired_count(1));
+    struct sm_fake_connection *fake_connection = s_get_fake_connection(0);
+    ASSERT_SUCCESS(h2_fake_peer_send_connection_preface_default_settings(&fake_connection->peer));
+    ASSERT_INT_EQUALS(1, s_fake_connection_get_stream_received(fake_connection));
+
+    /* The server refuses the stream, so the request goes again as a new stream */
+    struct aws_h2_frame *rst_stream_frame =
+        aws_h2_frame_new_rst_stream(allocator, 1 /*stream_id*/, AWS_HTTP2_ERR_REFUSED_STREAM);
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&fake_connection->peer, rst_stream_frame));
+    testing_channel_drain_queued_tasks(&fake_connection->testing_channel);
+    ASSERT_UINT_EQUALS(0, s_tester.stream_completed_count);
+    ASSERT_INT_EQUALS(2, s_fake_connection_get_stream_received(fake_connection));
+    ASSERT_SUCCESS(h2_decode_tester_check_data_str_across_frames(
+        &fake_connection->peer.decode, 3 /*stream_id*/, "replay me", true /*end_stream*/));
+
+    /* The user only hears about the stream that got a response */
+    struct aws_http_header response_headers_src[] = {
+        DEFINE_HEADER(":status", "200"),
+    };
+    struct aws_http_headers *response_headers = aws_http_headers_new(allocator);
+    aws_http_headers_add_array(response_headers, response_headers_src, AWS_ARRAY_SIZE(response_headers_src));
+    struct aws_h2_frame *response_frame =
+        aws_h2_frame_new_headers(allocator, 3 /*stream_id*/, response_headers, true /*end_stream*/, 0, NULL);
+    aws_http_headers_release(response_headers);
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&fake_connection->peer, response_frame));
+    testing_channel_drain_queued_tasks(&fake_connection->testing_channel);
+    ASSERT_SUCCESS(s_wait_on_streams_completed_count(1));
+    ASSERT_UINT_EQUALS(1, s_tester.stream_200_count);
+    ASSERT_UINT_EQUALS(0, s_tester.stream_complete_errors);
+
+    /* The user's on_destroy comes once, after both streams are gone */
+    s_release_all_streams();
+    s_drain_all_fake_connection_testing_channel();
+    ASSERT_UINT_EQUALS(1, aws_atomic_load_int(&s_tester.stream_destroyed_count));
+
+    return s_tester_clean_up();
+}
+
 /* Test that goaway received from peer, new connection will be made */
 TEST_CASE(h2_sm_mock_goaway) {
     (void)ctx;
@@ -1117,6 +1448,207 @@ TEST_CASE(h2_sm_mock_goaway) {
     return s_tester_clean_up();
 }
 
+/* Test that a connection draining after GOAWAY gets a replacement before any new stream needs one */
+TEST_CASE(h2_sm_mock_goaway_replacement) {
+    (void)ctx;
+    struct sm_tester_options options = {
+        .max_connections = 2,
+        .alloc = allocator,
+    };
+    ASSERT_SUCCESS(s_tester_init(&options));
+    s_override_cm_connect_function(s_aws_http_connection_manager_create_connection_sync_mock);
+    ASSERT_SUCCESS(s_sm_stream_acquiring(2));
+    ASSERT_SUCCESS(s_wait_on_fake_connection_count(1));
+    s_drain_all_fake_connection_testing_channel();
+    ASSERT_SUCCESS(s_wait_on_streams_acquired_count(2));
+
+    /* The peer rotates the connection, letting the streams it has finish */
+    struct sm_fake_connection *draining_connection = s_get_fake_connection(0);
+    ASSERT_SUCCESS(h2_fake_peer_send_connection_preface_default_settings(&draining_connection->peer));
+    struct aws_byte_cursor debug_info;
+    AWS_ZERO_STRUCT(debug_info);
+    struct aws_h2_frame *peer_frame =
+        aws_h2_frame_new_goaway(allocator, 3 /*last_stream_id*/, AWS_HTTP2_ERR_NO_ERROR, debug_info);
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&draining_connection->peer, peer_frame));
+    testing_channel_drain_queued_tasks(&draining_connection->testing_channel);
+    ASSERT_INT_EQUALS(0, s_tester.stream_complete_errors);
+
+    /* The first stream to finish starts the replacement, with nothing waiting for it yet */
+    struct aws_http_header response_headers_src[] = {
+        DEFINE_HEADER(":status", "200"),
+    };
+    struct aws_http_headers *response_headers = aws_http_headers_new(allocator);
+    aws_http_headers_add_array(response_headers, response_headers_src, AWS_ARRAY_SIZE(response_headers_src));
+    peer_frame = aws_h2_frame_new_headers(allocator, 1 /*stream_id*/, response_headers, true /*end_stream*/, 0, NULL);
+    aws_http_headers_release(response_headers);
+    ASSERT_SUCCESS(h2_fake_peer_send_frame(&draining_connection->peer, peer_frame));
+    testing_channel_drain_queued_tasks(&draining_connection->testing_channel);
+    ASSERT_SUCCESS(s_wait_on_fake_connection_count(2));
+    s_drain_all_fake_connection_testing_channel();
+
+    /* A new stream goes to the replacement, no other connection is made */
+    ASSERT_SUCCESS(s_sm_stream_acquiring(1));
+    s_drain_all_fake_connection_testing_channel();
+    ASSERT_SUCCESS(s_wait_on_streams_acquired_count(3));
+    ASSERT_UINT_EQUALS(2, aws_array_list_length(&s_tester.fake_connections));
+    ASSERT_INT_EQUALS(1, s_fake_connection_get_stream_received(s_get_fake_connection(1)));
+
+    ASSERT_SUCCESS(s_complete_all_fake_connection_streams());
+    ASSERT_SUCCESS(s_wait_on_streams_completed_count(3));
+    ASSERT_INT_EQUALS(0, s_tester.stream_complete_errors);
+
+    return s_tester_clean_up();
+}
+
+/* Test that a connection running out of stream ids is replaced, and gets no more streams */
+TEST_CASE(h2_sm_mock_stream_ids_replacement) {
+    (void)ctx;
+    struct sm_tester_options options = {
+        .max_connections = 2,
+        .alloc = allocator,
+    };
+    ASSERT_SUCCESS(s_tester_init(&options));
+    s_override_cm_connect_function(s_aws_http_connection_manager_create_connection_sync_mock);
+    ASSERT_SUCCESS(s_sm_stream_acquiring(1));
+    ASSERT_SUCCESS(s_wait_on_fake_connection_count(1));
+    s_drain_all_fake_connection_testing_channel();
+    ASSERT_SUCCESS(s_wait_on_streams_acquired_count(1));
+
+    /* Pretend the connection has made almost all the streams it can */
+    struct sm_fake_connection *draining_connection = s_get_fake_connection(0);
+    draining_connection->connection->next_stream_id = AWS_H2_STREAM_ID_MAX - 2 * 10;
+    ASSERT_SUCCESS(s_sm_stream_acquiring(1));
+    ASSERT_SUCCESS(s_wait_on_fake_connection_count(2));
+    s_drain_all_fake_connection_testing_channel();
+    ASSERT_SUCCESS(s_wait_on_streams_acquired_count(2));
+    ASSERT_INT_EQUALS(2, s_fake_connection_get_stream_received(draining_connection));
+
+    /* The next stream goes to the replacement */
+    ASSERT_SUCCESS(s_sm_stream_acquiring(1));
+    s_drain_all_fake_connection_testing_channel();
+    ASSERT_SUCCESS(s_wait_on_streams_acquired_count(3));
+    ASSERT_UINT_EQUALS(2, aws_array_list_length(&s_tester.fake_connections));
+    ASSERT_INT_EQUALS(2, s_fake_connection_get_stream_received(draining_connection));
+    ASSERT_INT_EQUALS(1, s_fake_connection_get_stream_received(s_get_fake_connection(1)));
+
+    ASSERT_SUCCESS(s_complete_all_fake_connection_streams());
+    ASSERT_SUCCESS(s_wait_on_streams_completed_count(3));
+    ASSERT_INT_EQUALS(0, s_tester.stream_complete_errors);
+
+    return s_tester_clean_up();
+}
+
+static void s_sm_tester_on_coalesced_sm_shutdown_complete(void *user_data) {
+    (void)user_data;
+    aws_mutex_lock(&s_tester.lock);
+    s_tester.is_coalesced_shutdown_complete = true;
+    aws_mutex_unlock(&s_tester.lock);
+    aws_condition_variable_notify_one(&s_tester.signal);
+}
+
+static bool s_is_coalesced_shutdown_complete(void *context) {
+    (void)context;
+    return s_tester.is_coalesced_shutdown_complete;
+}
+
+static bool s_is_coalescing_resolved(struct aws_http2_stream_manager *stream_manager) {
+    struct aws_http2_stream_manager_coalescing_group *group = stream_manager->coalescing.group;
+    AWS_FATAL_ASSERT(aws_mutex_lock(&group->lock) == AWS_OP_SUCCESS);
+    bool is_resolved = stream_manager->coalescing.is_resolved;
+    AWS_FATAL_ASSERT(aws_mutex_unlock(&group->lock) == AWS_OP_SUCCESS);
+    return is_resolved;
+}
+
+/* Test that a stream manager with no connection of its own makes its streams on another manager's connection, which
+ * is to the same address and whose certificate covers its host */
+TEST_CASE(h2_sm_mock_connection_coalescing) {
+    (void)ctx;
+    struct aws_http2_stream_manager_coalescing_group *group = aws_http2_stream_manager_coalescing_group_new(allocator);
+    ASSERT_NOT_NULL(group);
+    struct aws_byte_cursor uri = aws_byte_cursor_from_c_str("https://localhost");
+    struct aws_byte_cursor certificate_names[] = {aws_byte_cursor_from_c_str("127.0.0.1")};
+    struct sm_tester_options options = {
+        .max_connections = 1,
+        .alloc = allocator,
+        .uri_cursor = &uri,
+        .coalescing_group = group,
+        .certificate_names = certificate_names,
+        .num_certificate_names = AWS_ARRAY_SIZE(certificate_names),
+    };
+    ASSERT_SUCCESS(s_tester_init(&options));
+    s_override_cm_connect_function(s_aws_http_connection_manager_create_connection_sync_mock);
+
+    /* Its own connections would really be connected, and fail, as nothing listens there */
+    struct aws_socket_options socket_options = {
+        .type = AWS_SOCKET_STREAM,
+        .domain = AWS_SOCKET_IPV4,
+        .connect_timeout_ms = 1000,
+    };
+    struct aws_http2_stream_manager_options coalesced_options = {
+        .bootstrap = s_tester.client_bootstrap,
+        .socket_options = &socket_options,
+        .tls_connection_options = &s_tester.tls_connection_options,
+        .host = aws_byte_cursor_from_c_str("127.0.0.1"),
+        .port = 443,
+        .max_connections = 1,
+        .shutdown_complete_user_data = &s_tester,
+        .shutdown_complete_callback = s_sm_tester_on_coalesced_sm_shutdown_complete,
+        .coalescing_group = group,
+    };
+    struct aws_http2_stream_manager *coalesced_manager = aws_http2_stream_manager_new(allocator, &coalesced_options);
+    ASSERT_NOT_NULL(coalesced_manager);
+    while (!s_is_coalescing_resolved(s_tester.stream_manager) || !s_is_coalescing_resolved(coalesced_manager)) {
+        aws_thread_current_sleep(1000000 /*1ms*/);
+    }
+
+    ASSERT_SUCCESS(s_sm_stream_acquiring(1));
+    ASSERT_SUCCESS(s_wait_on_fake_connection_count(1));
+    s_drain_all_fake_connection_testing_channel();
+    ASSERT_SUCCESS(s_wait_on_streams_acquired_count(1));
+
+    struct aws_http_message *request = aws_http2_message_new_request(allocator);
+    ASSERT_NOT_NULL(request);
+    struct aws_http_header request_headers_src[] = {
+        DEFINE_HEADER(":method", "GET"),
+        DEFINE_HEADER(":scheme", "https"),
+        DEFINE_HEADER(":path", "/"),
+        DEFINE_HEADER(":authority", "127.0.0.1"),
+    };
+    aws_http_message_add_header_array(request, request_headers_src, AWS_ARRAY_SIZE(request_headers_src));
+    struct aws_http_make_request_options request_options = {
+        .self_size = sizeof(request_options),
+        .request = request,
+        .user_data = &s_tester,
+        .on_complete = s_sm_tester_on_stream_complete,
+        .on_destroy = s_sm_tester_on_stream_destroy,
+    };
+    struct aws_http2_stream_manager_acquire_stream_options acquire_stream_option = {
+        .options = &request_options,
+        .callback = s_sm_tester_on_stream_acquired,
+        .user_data = &s_tester,
+    };
+    aws_http2_stream_manager_acquire_stream(coalesced_manager, &acquire_stream_option);
+    aws_http_message_release(request);
+    s_drain_all_fake_connection_testing_channel();
+    ASSERT_SUCCESS(s_wait_on_streams_acquired_count(2));
+    ASSERT_UINT_EQUALS(0, s_tester.acquiring_stream_errors);
+    ASSERT_UINT_EQUALS(1, aws_array_list_length(&s_tester.fake_connections));
+    ASSERT_INT_EQUALS(2, s_fake_connection_get_stream_received(s_get_fake_connection(0)));
+
+    ASSERT_SUCCESS(s_complete_all_fake_connection_streams());
+    ASSERT_SUCCESS(s_wait_on_streams_completed_count(2));
+    ASSERT_INT_EQUALS(0, s_tester.stream_complete_errors);
+
+    aws_http2_stream_manager_release(coalesced_manager);
+    ASSERT_SUCCESS(aws_mutex_lock(&s_tester.lock));
+    ASSERT_SUCCESS(aws_condition_variable_wait_pred(
+        &s_tester.signal, &s_tester.lock, s_is_coalesced_shutdown_complete, NULL));
+    ASSERT_SUCCESS(aws_mutex_unlock(&s_tester.lock));
+    aws_http2_stream_manager_coalescing_group_release(group);
+
+    return s_tester_clean_up();
+}
+
 /* Test that PING works as expected. */
 TEST_CASE(h2_sm_connection_ping) {
     (void)ctx;
@@ -0,0 +1,52 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/tracing.h>
+
+#include <aws/testing/aws_test_harness.h>
+
+#include <string.h>
+
+static void s_on_trace(enum aws_http_trace_event event, const void *id, uint64_t arg1, uint64_t arg2, void *user_data) {
+    (void)event;
+    (void)id;
+    (void)arg1;
+    (void)arg2;
+    (void)user_data;
+}
+
+static int s_tracing_event_names_fn(struct aws_allocator *allocator, void *ctx) {
+    (void)allocator;
+    (void)ctx;
+
+    /* Every event has a name of its own */
+    for (int i = 0; i < AWS_HTTP_TRACE_EVENT_COUNT; ++i) {
+        const char *name = aws_http_trace_event_to_str((enum aws_http_trace_event)i);
+        ASSERT_NOT_NULL(name);
+        ASSERT_TRUE(strcmp("UNKNOWN", name) != 0);
+        for (int j = 0; j < i; ++j) {
+            ASSERT_TRUE(strcmp(aws_http_trace_event_to_str((enum aws_http_trace_event)j), name) != 0);
+        }
+    }
+    ASSERT_STR_EQUALS("UNKNOWN", aws_http_trace_event_to_str(AWS_HTTP_TRACE_EVENT_COUNT));
+
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(tracing_event_names, s_tracing_event_names_fn)
+
+static int s_tracing_set_callback_fn(struct aws_allocator *allocator, void *ctx) {
+    (void)allocator;
+    (void)ctx;
+
+    /* Setting the callback only works if the tracepoints are compiled in */
+    if (aws_http_set_trace_callback(s_on_trace, NULL) == AWS_OP_SUCCESS) {
+        ASSERT_SUCCESS(aws_http_set_trace_callback(NULL, NULL));
+    } else {
+        ASSERT_INT_EQUALS(AWS_ERROR_UNSUPPORTED_OPERATION, aws_last_error());
+    }
+
+    return AWS_OP_SUCCESS;
+}
+AWS_TEST_CASE(tracing_set_callback, s_tracing_set_callback_fn)
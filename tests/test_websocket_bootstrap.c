@@ -115,6 +115,8 @@ static struct tester {
     const struct test_response *handshake_response;
     size_t num_handshake_response_headers;
 
+    const struct aws_websocket_permessage_deflate_options *permessage_deflate_offer;
+
     /* State */
     bool http_connect_called_successfully;
 
@@ -135,6 +137,10 @@ static struct tester {
     bool http_stream_on_complete_invoked;
 
     bool websocket_new_called_successfully;
+    bool websocket_new_permessage_deflate;
+
+    /* "Sec-WebSocket-Extensions" of the request that was sent */
+    char request_extensions[128];
 
     bool http_stream_release_called;
     bool http_stream_activate_called_successfully;
@@ -144,6 +150,8 @@ static struct tester {
     bool websocket_setup_had_response_status;
     bool websocket_setup_had_response_headers;
     bool websocket_setup_had_response_body;
+    bool websocket_setup_had_permessage_deflate;
+    struct aws_websocket_permessage_deflate_options websocket_setup_permessage_deflate;
 
     bool websocket_shutdown_invoked;
     int websocket_shutdown_error_code;
@@ -304,6 +312,15 @@ static struct aws_http_stream *s_mock_http_connection_make_request(
     /* Check that headers passed into websocket_connect() carry through. */
     AWS_FATAL_ASSERT(s_request_eq(s_tester.handshake_request, options->request));
 
+    struct aws_byte_cursor request_extensions;
+    if (aws_http_headers_get(
+            aws_http_message_get_headers(options->request),
+            aws_byte_cursor_from_c_str("Sec-WebSocket-Extensions"),
+            &request_extensions) == AWS_OP_SUCCESS) {
+        AWS_FATAL_ASSERT(request_extensions.len < sizeof(s_tester.request_extensions));
+        memcpy(s_tester.request_extensions, request_extensions.ptr, request_extensions.len);
+    }
+
     s_tester.http_stream_new_called_successfully = true;
     s_tester.http_stream_on_response_headers = options->on_response_headers;
     s_tester.http_stream_on_response_header_block_done = options->on_response_header_block_done;
@@ -372,6 +389,7 @@ static struct aws_websocket *s_mock_websocket_handler_new(const struct aws_webso
     }
 
     s_tester.websocket_new_called_successfully = true;
+    s_tester.websocket_new_permessage_deflate = options->permessage_deflate;
     return s_mock_websocket;
 }
 
@@ -412,6 +430,12 @@ static void s_on_websocket_setup(const struct aws_websocket_on_connection_setup_
         AWS_FATAL_ASSERT(setup->handshake_response_header_array != NULL);
     }
 
+    if (setup->permessage_deflate) {
+        AWS_FATAL_ASSERT(setup->websocket != NULL);
+        s_tester.websocket_setup_had_permessage_deflate = true;
+        s_tester.websocket_setup_permessage_deflate = *setup->permessage_deflate;
+    }
+
     AWS_FATAL_ASSERT(user_data == &s_tester);
 
     s_tester.websocket_setup_invoked = true;
@@ -474,6 +498,7 @@ static int s_drive_websocket_connect(int *out_error_code) {
         .user_data = &s_tester,
         .on_connection_setup = s_on_websocket_setup,
         .on_connection_shutdown = s_on_websocket_shutdown,
+        .permessage_deflate = s_tester.permessage_deflate_offer,
     };
 
     int err = aws_websocket_client_connect(&ws_options);
@@ -953,6 +978,132 @@ TEST_CASE(websocket_boot_fail_from_unsupported_sec_websocket_extensions_in_respo
     return s_websocket_boot_fail_from_bad_101_response(allocator, &bad_response);
 }
 
+/* Response accepting permessage-deflate with the given "Sec-WebSocket-Extensions" value */
+static void s_init_permessage_deflate_response(struct test_response *response, const char *extensions) {
+    *response = s_accepted_response;
+    size_t i = 0;
+    while (response->headers[i].name.len) {
+        ++i;
+    }
+    response->headers[i].name = aws_byte_cursor_from_c_str("Sec-WebSocket-Extensions");
+    response->headers[i].value = aws_byte_cursor_from_c_str(extensions);
+}
+
+TEST_CASE(websocket_boot_ok_with_permessage_deflate) {
+    (void)ctx;
+    const struct aws_websocket_permessage_deflate_options offer = {
+        .server_no_context_takeover = true,
+        .client_max_window_bits = 12,
+    };
+    s_tester.permessage_deflate_offer = &offer;
+
+    struct test_response response;
+    s_init_permessage_deflate_response(
+        &response, "permessage-deflate ; server_no_context_takeover; client_max_window_bits=\"10\"");
+    s_tester.handshake_response = &response;
+
+    ASSERT_SUCCESS(s_tester_init(allocator));
+
+    int websocket_connect_error_code;
+    ASSERT_SUCCESS(s_drive_websocket_connect(&websocket_connect_error_code));
+    ASSERT_INT_EQUALS(0, websocket_connect_error_code);
+
+    ASSERT_STR_EQUALS(
+        "permessage-deflate; server_no_context_takeover; client_max_window_bits=12", s_tester.request_extensions);
+    ASSERT_TRUE(s_tester.websocket_new_permessage_deflate);
+    ASSERT_TRUE(s_tester.websocket_setup_had_permessage_deflate);
+    ASSERT_TRUE(s_tester.websocket_setup_permessage_deflate.server_no_context_takeover);
+    ASSERT_FALSE(s_tester.websocket_setup_permessage_deflate.client_no_context_takeover);
+    ASSERT_UINT_EQUALS(15, s_tester.websocket_setup_permessage_deflate.server_max_window_bits);
+    ASSERT_UINT_EQUALS(10, s_tester.websocket_setup_permessage_deflate.client_max_window_bits);
+
+    ASSERT_SUCCESS(s_tester_clean_up());
+    return AWS_OP_SUCCESS;
+}
+
+/* The server may decline the offer, and the websocket works without compression */
+TEST_CASE(websocket_boot_ok_with_permessage_deflate_declined) {
+    (void)ctx;
+    const struct aws_websocket_permessage_deflate_options offer = {
+        .client_no_context_takeover = true,
+        .server_max_window_bits = 9,
+    };
+    s_tester.permessage_deflate_offer = &offer;
+
+    ASSERT_SUCCESS(s_tester_init(allocator));
+
+    int websocket_connect_error_code;
+    ASSERT_SUCCESS(s_drive_websocket_connect(&websocket_connect_error_code));
+    ASSERT_INT_EQUALS(0, websocket_connect_error_code);
+
+    ASSERT_STR_EQUALS(
+        "permessage-deflate; client_no_context_takeover; server_max_window_bits=9", s_tester.request_extensions);
+    ASSERT_FALSE(s_tester.websocket_new_permessage_deflate);
+    ASSERT_FALSE(s_tester.websocket_setup_had_permessage_deflate);
+
+    ASSERT_SUCCESS(s_tester_clean_up());
+    return AWS_OP_SUCCESS;
+}
+
+TEST_CASE(websocket_boot_fail_from_invalid_permessage_deflate_options) {
+    (void)ctx;
+    const struct aws_websocket_permessage_deflate_options offer = {
+        .server_max_window_bits = 16,
+    };
+    s_tester.permessage_deflate_offer = &offer;
+
+    ASSERT_SUCCESS(s_tester_init(allocator));
+
+    int websocket_connect_error_code;
+    ASSERT_SUCCESS(s_drive_websocket_connect(&websocket_connect_error_code));
+    ASSERT_INT_EQUALS(AWS_ERROR_INVALID_ARGUMENT, websocket_connect_error_code);
+    ASSERT_FALSE(s_tester.websocket_setup_invoked);
+
+    ASSERT_SUCCESS(s_tester_clean_up());
+    return AWS_OP_SUCCESS;
+}
+
+static int s_websocket_boot_fail_from_bad_permessage_deflate_response(
+    struct aws_allocator *alloc,
+    const char *extensions) {
+
+    static const struct aws_websocket_permessage_deflate_options s_offer = {
+        .server_max_window_bits = 12,
+    };
+    s_tester.permessage_deflate_offer = &s_offer;
+
+    static struct test_response s_bad_response;
+    s_init_permessage_deflate_response(&s_bad_response, extensions);
+    ASSERT_SUCCESS(s_websocket_boot_fail_from_bad_101_response(alloc, &s_bad_response));
+    ASSERT_FALSE(s_tester.websocket_setup_had_permessage_deflate);
+    return AWS_OP_SUCCESS;
+}
+
+/* The server can't pick a window bigger than the client asked for */
+TEST_CASE(websocket_boot_fail_from_permessage_deflate_window_too_big) {
+    (void)ctx;
+    return s_websocket_boot_fail_from_bad_permessage_deflate_response(
+        allocator, "permessage-deflate; server_max_window_bits=13");
+}
+
+/* The server can only limit the client's window if the client offered it */
+TEST_CASE(websocket_boot_fail_from_unoffered_permessage_deflate_parameter) {
+    (void)ctx;
+    return s_websocket_boot_fail_from_bad_permessage_deflate_response(
+        allocator, "permessage-deflate; client_max_window_bits=10");
+}
+
+TEST_CASE(websocket_boot_fail_from_duplicate_permessage_deflate_parameter) {
+    (void)ctx;
+    return s_websocket_boot_fail_from_bad_permessage_deflate_response(
+        allocator, "permessage-deflate; server_no_context_takeover; server_no_context_takeover");
+}
+
+TEST_CASE(websocket_boot_fail_from_unknown_sec_websocket_extension) {
+    (void)ctx;
+    return s_websocket_boot_fail_from_bad_permessage_deflate_response(allocator, "x-webkit-deflate-frame");
+}
+
 /* If client requests a specific protocol, the server response must say it's being used */
 TEST_CASE(websocket_boot_ok_with_sec_websocket_protocol_header) {
     (void)ctx;
@@ -5,6 +5,7 @@
 
 #include <aws/http/private/websocket_decoder.h>
 
+#include <aws/common/encoding.h>
 #include <aws/io/logging.h>
 #include <aws/testing/aws_test_harness.h>
 
@@ -867,6 +868,82 @@ DECODER_TEST_CASE(websocket_decoder_fail_on_fragmented_bad_utf8_text) {
 }
 
 /* Test that an error from the on_frame callback fails the decoder */
+/* Validate `text` (optionally masked) split into two pieces, and check it gets the same answer as aws_decode_utf8() */
+static int s_check_utf8_validator(const uint8_t *text, size_t len, size_t split, const uint8_t *masking_key) {
+    uint8_t payload[64];
+    AWS_FATAL_ASSERT(len <= sizeof(payload));
+    memcpy(payload, text, len);
+    if (masking_key) {
+        aws_websocket_mask_payload(payload, len, masking_key, 0);
+    }
+
+    bool expect_valid = aws_decode_utf8(aws_byte_cursor_from_array(text, len), NULL) == AWS_OP_SUCCESS;
+
+    struct aws_websocket_utf8_validator validator;
+    AWS_ZERO_STRUCT(validator);
+    bool valid = aws_websocket_utf8_validator_update(&validator, payload, split, masking_key, 0) == AWS_OP_SUCCESS &&
+                 aws_websocket_utf8_validator_update(
+                     &validator, payload + split, len - split, masking_key, split) == AWS_OP_SUCCESS &&
+                 aws_websocket_utf8_validator_finalize(&validator) == AWS_OP_SUCCESS;
+
+    ASSERT_INT_EQUALS(expect_valid, valid);
+    if (valid) {
+        /* The payload was unmasked along the way */
+        ASSERT_BIN_ARRAYS_EQUALS(text, len, payload, len);
+    }
+    return AWS_OP_SUCCESS;
+}
+
+/* The validator's fast paths agree with the reference decoder, wherever a sequence lands and however it's split */
+DECODER_TEST_CASE(websocket_utf8_validator) {
+    (void)allocator;
+    (void)ctx;
+    const uint8_t masking_key[4] = {0x37, 0xfa, 0x21, 0x3d};
+
+    struct aws_byte_cursor sequences[] = {
+        aws_byte_cursor_from_c_str(""),
+        aws_byte_cursor_from_c_str("\xC2\xA9"),             /* U+00A9 */
+        aws_byte_cursor_from_c_str("\xE2\x82\xAC"),         /* U+20AC */
+        aws_byte_cursor_from_c_str("\xF0\x90\x8D\x88"),     /* U+10348 */
+        aws_byte_cursor_from_c_str("\xF4\x8F\xBF\xBF"),     /* U+10FFFF */
+        aws_byte_cursor_from_c_str("\xC0\x80"),             /* overlong */
+        aws_byte_cursor_from_c_str("\xE0\x80\xAF"),         /* overlong */
+        aws_byte_cursor_from_c_str("\xED\xA0\x80"),         /* surrogate */
+        aws_byte_cursor_from_c_str("\xF8\x88\x80\x80\x80"), /* 5 byte encoding */
+        aws_byte_cursor_from_c_str("\x80"),                 /* lone continuation byte */
+        aws_byte_cursor_from_c_str("\xE2\x82"),             /* truncated */
+        aws_byte_cursor_from_c_str("\xE2\x41\xAC"),         /* ASCII where a continuation byte belongs */
+    };
+
+    for (size_t s = 0; s < AWS_ARRAY_SIZE(sequences); ++s) {
+        /* ASCII before and after, putting the sequence at every position in and around a vector or word */
+        for (size_t prefix_len = 0; prefix_len <= 20; ++prefix_len) {
+            uint8_t text[64];
+            size_t len = 0;
+            memset(text, 'a', prefix_len);
+            len += prefix_len;
+            memcpy(text + len, sequences[s].ptr, sequences[s].len);
+            len += sequences[s].len;
+            memset(text + len, 'z', 20);
+            len += 20;
+
+            for (size_t split = 0; split <= len; ++split) {
+                ASSERT_SUCCESS(s_check_utf8_validator(text, len, split, NULL));
+                ASSERT_SUCCESS(s_check_utf8_validator(text, len, split, masking_key));
+            }
+        }
+    }
+
+    /* RFC-3629 ends UTF-8 at U+10FFFF */
+    uint8_t past_max[] = {0xF4, 0x90, 0x80, 0x80};
+    struct aws_websocket_utf8_validator validator;
+    AWS_ZERO_STRUCT(validator);
+    ASSERT_FAILS(aws_websocket_utf8_validator_update(&validator, past_max, sizeof(past_max), NULL, 0));
+    ASSERT_INT_EQUALS(AWS_ERROR_INVALID_UTF8, aws_last_error());
+
+    return AWS_OP_SUCCESS;
+}
+
 DECODER_TEST_CASE(websocket_decoder_on_frame_callback_can_fail_decoder) {
     (void)ctx;
     struct decoder_tester tester;
@@ -628,3 +628,81 @@ ENCODER_TEST_CASE(websocket_encoder_payload_callback_can_fail_encoder) {
     ASSERT_SUCCESS(s_encoder_tester_clean_up(&tester));
     return AWS_OP_SUCCESS;
 }
+
+static void s_reference_mask_payload(uint8_t *payload, size_t len, const uint8_t masking_key[4], uint64_t mask_offset) {
+    for (size_t i = 0; i < len; ++i) {
+        payload[i] ^= masking_key[(mask_offset + i) % 4];
+    }
+}
+
+ENCODER_TEST_CASE(websocket_mask_payload) {
+    (void)allocator;
+    (void)ctx;
+    const uint8_t masking_key[4] = {0x37, 0xfa, 0x21, 0x3d};
+
+    /* Over the lengths around the word and vector sizes, starting at every alignment and mask offset */
+    uint8_t original[80];
+    for (size_t i = 0; i < sizeof(original); ++i) {
+        original[i] = (uint8_t)(i * 7 + 1);
+    }
+    for (size_t len = 0; len <= 64; ++len) {
+        for (size_t align = 0; align < 8; ++align) {
+            for (uint64_t mask_offset = 0; mask_offset < 8; ++mask_offset) {
+                uint8_t expected[80];
+                uint8_t actual[80];
+                memcpy(expected, original, sizeof(original));
+                memcpy(actual, original, sizeof(original));
+                s_reference_mask_payload(expected + align, len, masking_key, mask_offset);
+                aws_websocket_mask_payload(actual + align, len, masking_key, mask_offset);
+                ASSERT_BIN_ARRAYS_EQUALS(expected, sizeof(expected), actual, sizeof(actual));
+            }
+        }
+    }
+
+    /* Masking a payload in pieces of any size comes out the same as all at once */
+    uint8_t whole[77];
+    uint8_t pieces[77];
+    memcpy(whole, original, sizeof(whole));
+    memcpy(pieces, original, sizeof(pieces));
+    aws_websocket_mask_payload(whole, sizeof(whole), masking_key, 0);
+    const size_t piece_lengths[] = {1, 3, 17, 2, 9, 30, 15};
+    size_t offset = 0;
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(piece_lengths); ++i) {
+        aws_websocket_mask_payload(pieces + offset, piece_lengths[i], masking_key, offset);
+        offset += piece_lengths[i];
+    }
+    ASSERT_UINT_EQUALS(sizeof(pieces), offset);
+    ASSERT_BIN_ARRAYS_EQUALS(whole, sizeof(whole), pieces, sizeof(pieces));
+
+    return AWS_OP_SUCCESS;
+}
+
+/* Masking payloads big enough to go through the vector loop many times, starting at every offset into the
+ * masking key and from an unaligned address, must match masking one byte at a time */
+ENCODER_TEST_CASE(websocket_mask_payload_large) {
+    (void)ctx;
+    const uint8_t masking_key[4] = {0x37, 0xfa, 0x21, 0x3d};
+    const size_t payload_sizes[] = {125, 1024, 16 * 1024, 256 * 1024};
+    const size_t max_payload_size = payload_sizes[AWS_ARRAY_SIZE(payload_sizes) - 1];
+
+    uint8_t *expected = aws_mem_calloc(allocator, 1, max_payload_size);
+    uint8_t *payload = aws_mem_calloc(allocator, 1, max_payload_size + 1);
+    for (size_t s = 0; s < AWS_ARRAY_SIZE(payload_sizes); ++s) {
+        /* Off by one from the allocation's alignment, like a payload after a frame header */
+        uint8_t *unaligned_payload = payload + 1;
+        size_t payload_size = payload_sizes[s];
+        for (uint64_t mask_offset = 0; mask_offset < 4; ++mask_offset) {
+            for (size_t i = 0; i < payload_size; ++i) {
+                expected[i] = (uint8_t)(i * 7 + 1);
+                unaligned_payload[i] = expected[i];
+            }
+            s_reference_mask_payload(expected, payload_size, masking_key, mask_offset);
+            aws_websocket_mask_payload(unaligned_payload, payload_size, masking_key, mask_offset);
+            ASSERT_BIN_ARRAYS_EQUALS(expected, payload_size, unaligned_payload, payload_size);
+        }
+    }
+
+    aws_mem_release(allocator, expected);
+    aws_mem_release(allocator, payload);
+    return AWS_OP_SUCCESS;
+}
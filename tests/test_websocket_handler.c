@@ -5,8 +5,13 @@
 
 #include <aws/http/private/websocket_impl.h>
 
+#include "alloc_test_helper.h"
+
+#include <aws/common/clock.h>
+#include <aws/common/thread.h>
 #include <aws/http/private/websocket_decoder.h>
 #include <aws/http/private/websocket_encoder.h>
+#include <aws/http/request_response.h>
 #include <aws/io/logging.h>
 #include <aws/testing/io_testing_channel.h>
 
@@ -37,7 +42,16 @@ struct incoming_frame {
     bool is_complete;
 };
 
-static struct tester_options { bool manual_window_update; } s_tester_options;
+static struct tester_options {
+    bool is_server;
+    bool manual_window_update;
+    size_t max_write_messages_in_flight;
+    uint32_t write_coalescing_delay_us;
+    bool deliver_whole_messages;
+    size_t max_incoming_message_size;
+    /* If set, the websocket uses this allocator instead of the tester's */
+    struct aws_allocator *websocket_alloc;
+} s_tester_options;
 
 struct tester {
     struct aws_allocator *alloc;
@@ -65,6 +79,10 @@ struct tester {
     size_t fail_on_incoming_frame_payload_n;  /* If set, return false on Nth incoming_frame_payload callback */
     size_t fail_on_incoming_frame_complete_n; /* If set, return false on Nth incoming_frame_complete callback */
 
+    /* Messages reported via the websocket's on_incoming_message callback, released during clean up */
+    struct aws_websocket_incoming_message *incoming_messages[10];
+    size_t num_incoming_messages;
+
     /* For pushing messages downstream, to be read by websocket handler.
      * readpush_frame is for tests to define websocket frames to be pushed downstream.
      * An encoder is used to turn these into proper bits */
@@ -268,6 +286,18 @@ static bool s_on_incoming_frame_complete(
     return true;
 }
 
+static bool s_on_incoming_message(
+    struct aws_websocket *websocket,
+    struct aws_websocket_incoming_message *message,
+    void *user_data) {
+
+    (void)websocket;
+    struct tester *tester = user_data;
+    AWS_FATAL_ASSERT(tester->num_incoming_messages < AWS_ARRAY_SIZE(tester->incoming_messages));
+    tester->incoming_messages[tester->num_incoming_messages++] = message;
+    return true;
+}
+
 static void s_set_readpush_frames(struct tester *tester, struct readpush_frame *frames, size_t num_frames) {
     tester->readpush_frames = frames;
     tester->num_readpush_frames = num_frames;
@@ -477,14 +507,19 @@ static int s_tester_init(struct tester *tester, struct aws_allocator *alloc) {
     ASSERT_SUCCESS(testing_channel_init(&tester->testing_channel, alloc, &test_channel_options));
 
     struct aws_websocket_handler_options ws_options = {
-        .allocator = alloc,
+        .allocator = s_tester_options.websocket_alloc ? s_tester_options.websocket_alloc : alloc,
         .channel = tester->testing_channel.channel,
         .initial_window_size = s_default_initial_window_size,
         .user_data = tester,
         .on_incoming_frame_begin = s_on_incoming_frame_begin,
         .on_incoming_frame_payload = s_on_incoming_frame_payload,
         .on_incoming_frame_complete = s_on_incoming_frame_complete,
+        .is_server = s_tester_options.is_server,
         .manual_window_update = s_tester_options.manual_window_update,
+        .max_write_messages_in_flight = s_tester_options.max_write_messages_in_flight,
+        .write_coalescing_delay_us = s_tester_options.write_coalescing_delay_us,
+        .on_incoming_message = s_tester_options.deliver_whole_messages ? s_on_incoming_message : NULL,
+        .max_incoming_message_size = s_tester_options.max_incoming_message_size,
     };
     tester->websocket = aws_websocket_handler_new(&ws_options);
     ASSERT_NOT_NULL(tester->websocket);
@@ -503,6 +538,11 @@ static int s_tester_clean_up(struct tester *tester) {
 
     ASSERT_SUCCESS(testing_channel_clean_up(&tester->testing_channel));
 
+    /* Messages may outlive the websocket */
+    for (size_t i = 0; i < tester->num_incoming_messages; ++i) {
+        aws_websocket_incoming_message_release(tester->incoming_messages[i]);
+    }
+
     for (size_t i = 0; i < AWS_ARRAY_SIZE(tester->written_frames); ++i) {
         aws_byte_buf_clean_up(&tester->written_frames[i].payload);
     }
@@ -822,6 +862,159 @@ TEST_CASE(websocket_handler_send_huge_frame) {
     return AWS_OP_SUCCESS;
 }
 
+static void s_on_shared_payload_release(void *user_data) {
+    size_t *release_count = user_data;
+    (*release_count)++;
+}
+
+static int s_send_shared_payload_frame(
+    struct tester *tester,
+    struct send_tester *send_tester,
+    struct aws_websocket_shared_payload *shared_payload) {
+
+    send_tester->owner = tester;
+    send_tester->def.payload_length = send_tester->payload.len;
+    send_tester->def.shared_payload = shared_payload;
+    send_tester->def.on_complete = s_on_outgoing_frame_complete;
+    send_tester->def.user_data = send_tester;
+    ASSERT_SUCCESS(aws_websocket_send_frame(tester->websocket, &send_tester->def));
+    return AWS_OP_SUCCESS;
+}
+
+/* Client frames are masked, so a shared payload gets copied like any other */
+TEST_CASE(websocket_handler_send_shared_payload) {
+    (void)ctx;
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init(&tester, allocator));
+
+    struct aws_byte_buf giant_buf;
+    ASSERT_SUCCESS(aws_byte_buf_init(&giant_buf, allocator, 100000));
+    while (aws_byte_buf_write_u8(&giant_buf, (uint8_t)rand())) {
+    }
+
+    size_t release_count = 0;
+    struct aws_http_body_segment segment = {
+        .data = aws_byte_cursor_from_buf(&giant_buf),
+        .on_release = s_on_shared_payload_release,
+        .user_data = &release_count,
+    };
+    struct aws_websocket_shared_payload *shared_payload = aws_websocket_shared_payload_new(allocator, &segment);
+    ASSERT_NOT_NULL(shared_payload);
+
+    struct send_tester send = {
+        .payload = segment.data,
+        .def =
+            {
+                .opcode = AWS_WEBSOCKET_OPCODE_BINARY,
+                .fin = true,
+            },
+    };
+    ASSERT_SUCCESS(s_send_shared_payload_frame(&tester, &send, shared_payload));
+
+    /* A payload length that doesn't match the shared payload is rejected */
+    struct aws_websocket_send_frame_options bad_options = send.def;
+    bad_options.payload_length--;
+    ASSERT_FAILS(aws_websocket_send_frame(tester.websocket, &bad_options));
+    ASSERT_INT_EQUALS(AWS_ERROR_INVALID_ARGUMENT, aws_last_error());
+
+    /* The websocket holds its own reference */
+    aws_websocket_shared_payload_release(shared_payload);
+    ASSERT_UINT_EQUALS(0, release_count);
+
+    ASSERT_SUCCESS(s_drain_written_messages(&tester));
+    ASSERT_SUCCESS(s_check_written_message(&send, 0));
+    ASSERT_TRUE(tester.num_written_io_messages > 1);
+    ASSERT_UINT_EQUALS(1, release_count);
+
+    aws_byte_buf_clean_up(&giant_buf);
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
+/* Server frames aren't masked, so a large shared payload goes down the channel as-is */
+TEST_CASE(websocket_handler_server_sends_shared_payload_without_copying) {
+    (void)ctx;
+    s_tester_options.is_server = true;
+    s_tester_options.max_write_messages_in_flight = 2;
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init(&tester, allocator));
+
+    struct aws_byte_buf giant_buf;
+    ASSERT_SUCCESS(aws_byte_buf_init(&giant_buf, allocator, 100000));
+    while (aws_byte_buf_write_u8(&giant_buf, (uint8_t)rand())) {
+    }
+
+    size_t release_count = 0;
+    struct aws_http_body_segment segment = {
+        .data = aws_byte_cursor_from_buf(&giant_buf),
+        .on_release = s_on_shared_payload_release,
+        .user_data = &release_count,
+    };
+    struct aws_websocket_shared_payload *shared_payload = aws_websocket_shared_payload_new(allocator, &segment);
+    ASSERT_NOT_NULL(shared_payload);
+
+    struct send_tester send = {
+        .payload = segment.data,
+        .def =
+            {
+                .opcode = AWS_WEBSOCKET_OPCODE_BINARY,
+                .fin = true,
+            },
+    };
+    ASSERT_SUCCESS(s_send_shared_payload_frame(&tester, &send, shared_payload));
+    aws_websocket_shared_payload_release(shared_payload);
+
+    /* The frame's header goes in one message, and its payload in the next, pointing at the caller's memory */
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+    struct aws_linked_list *io_msgs = testing_channel_get_written_message_queue(&tester.testing_channel);
+    struct aws_linked_list_node *node = aws_linked_list_begin(io_msgs);
+    ASSERT_TRUE(node != aws_linked_list_end(io_msgs));
+    node = aws_linked_list_next(node);
+    ASSERT_TRUE(node != aws_linked_list_end(io_msgs));
+    struct aws_io_message *payload_msg = AWS_CONTAINER_OF(node, struct aws_io_message, queueing_handle);
+    ASSERT_PTR_EQUALS(giant_buf.buffer, payload_msg->message_data.buffer);
+    ASSERT_UINT_EQUALS(giant_buf.len, payload_msg->message_data.len);
+    ASSERT_UINT_EQUALS(0, release_count);
+
+    ASSERT_SUCCESS(s_drain_written_messages(&tester));
+    ASSERT_UINT_EQUALS(2, tester.num_written_io_messages);
+    ASSERT_UINT_EQUALS(1, send.on_complete_count);
+    ASSERT_INT_EQUALS(AWS_ERROR_SUCCESS, send.on_complete_error_code);
+    ASSERT_UINT_EQUALS(1, tester.num_written_frames);
+    ASSERT_FALSE(tester.written_frames[0].def.masked);
+    ASSERT_TRUE(aws_byte_cursor_eq_byte_buf(&send.payload, &tester.written_frames[0].payload));
+    ASSERT_UINT_EQUALS(1, release_count);
+
+    /* A payload that fits in the current message is copied */
+    struct aws_http_body_segment small_segment = {
+        .data = aws_byte_cursor_from_c_str("Small enough to copy"),
+        .on_release = s_on_shared_payload_release,
+        .user_data = &release_count,
+    };
+    shared_payload = aws_websocket_shared_payload_new(allocator, &small_segment);
+    struct send_tester small_send = {
+        .payload = small_segment.data,
+        .def =
+            {
+                .opcode = AWS_WEBSOCKET_OPCODE_TEXT,
+                .fin = true,
+            },
+    };
+    ASSERT_SUCCESS(s_send_shared_payload_frame(&tester, &small_send, shared_payload));
+    aws_websocket_shared_payload_release(shared_payload);
+
+    ASSERT_SUCCESS(s_drain_written_messages(&tester));
+    ASSERT_UINT_EQUALS(3, tester.num_written_io_messages);
+    ASSERT_UINT_EQUALS(1, small_send.on_complete_count);
+    ASSERT_UINT_EQUALS(2, tester.num_written_frames);
+    ASSERT_TRUE(aws_byte_cursor_eq_byte_buf(&small_send.payload, &tester.written_frames[1].payload));
+    ASSERT_UINT_EQUALS(2, release_count);
+
+    aws_byte_buf_clean_up(&giant_buf);
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
 TEST_CASE(websocket_handler_send_payload_slowly) {
     (void)ctx;
     struct tester tester;
@@ -1144,6 +1337,118 @@ TEST_CASE(websocket_handler_delayed_write_completion) {
     return AWS_OP_SUCCESS;
 }
 
+/* With max_write_messages_in_flight, that many aws_io_messages are sent before waiting for one to complete,
+ * and each frame completes along with the aws_io_message it finished in */
+TEST_CASE(websocket_handler_multiple_write_messages_in_flight) {
+    (void)ctx;
+    struct tester tester;
+    s_tester_options.max_write_messages_in_flight = 3;
+    ASSERT_SUCCESS(s_tester_init(&tester, allocator));
+
+    testing_channel_complete_written_messages_immediately(&tester.testing_channel, false, AWS_OP_SUCCESS);
+
+    struct aws_byte_cursor payload = aws_byte_cursor_from_c_str("bitter butter.");
+
+    const size_t count = 10000;
+    struct send_tester *sending = aws_mem_calloc(allocator, count, sizeof(struct send_tester));
+    ASSERT_NOT_NULL(sending);
+
+    for (size_t i = 0; i < count; ++i) {
+        struct send_tester *send = &sending[i];
+        send->payload = payload;
+        send->def.opcode = AWS_WEBSOCKET_OPCODE_TEXT;
+        send->def.fin = true;
+
+        ASSERT_SUCCESS(s_send_frame(&tester, send));
+    }
+
+    struct aws_linked_list *io_msgs = testing_channel_get_written_message_queue(&tester.testing_channel);
+    size_t total_io_msg_count = 0;
+    while (true) {
+        testing_channel_drain_queued_tasks(&tester.testing_channel);
+        if (aws_linked_list_empty(io_msgs)) {
+            break;
+        }
+
+        size_t in_flight_count = 0;
+        for (struct aws_linked_list_node *node = aws_linked_list_begin(io_msgs); node != aws_linked_list_end(io_msgs);
+             node = aws_linked_list_next(node)) {
+            ++in_flight_count;
+        }
+        ASSERT_TRUE(in_flight_count <= 3);
+        if (total_io_msg_count == 0) {
+            /* Nothing completes until the aws_io_message its frame is in does */
+            ASSERT_UINT_EQUALS(3, in_flight_count);
+            ASSERT_UINT_EQUALS(0, tester.on_send_complete_count);
+        }
+
+        total_io_msg_count++;
+        size_t complete_count_before = tester.on_send_complete_count;
+
+        struct aws_linked_list_node *node = aws_linked_list_pop_front(io_msgs);
+        struct aws_io_message *msg = AWS_CONTAINER_OF(node, struct aws_io_message, queueing_handle);
+        if (msg->on_completion) {
+            msg->on_completion(tester.testing_channel.channel, msg, AWS_ERROR_SUCCESS, msg->user_data);
+        }
+        aws_mem_release(msg->allocator, msg);
+
+        /* Completing the oldest message completes the frames it finished, but not ones in later messages */
+        ASSERT_TRUE(tester.on_send_complete_count > complete_count_before);
+        if (!aws_linked_list_empty(io_msgs)) {
+            ASSERT_TRUE(tester.on_send_complete_count < count);
+        }
+    }
+
+    /* Assert that every frame completed, in the order it was sent */
+    for (size_t i = 0; i < count; ++i) {
+        ASSERT_UINT_EQUALS(1, sending[i].on_complete_count);
+        ASSERT_UINT_EQUALS(i, sending[i].on_complete_order);
+        ASSERT_INT_EQUALS(AWS_ERROR_SUCCESS, sending[i].on_complete_error_code);
+    }
+
+    ASSERT_TRUE(total_io_msg_count > 3);
+
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    aws_mem_release(allocator, sending);
+    return AWS_OP_SUCCESS;
+}
+
+/* With write_coalescing_delay_us, frames queued while nothing is being written are held until the delay passes,
+ * then go out together */
+TEST_CASE(websocket_handler_write_coalescing) {
+    (void)ctx;
+    struct tester tester;
+    s_tester_options.write_coalescing_delay_us = 20000;
+    ASSERT_SUCCESS(s_tester_init(&tester, allocator));
+
+    struct send_tester sending[10];
+    AWS_ZERO_ARRAY(sending);
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(sending); ++i) {
+        sending[i].payload = aws_byte_cursor_from_c_str("ack");
+        sending[i].def.opcode = AWS_WEBSOCKET_OPCODE_TEXT;
+        sending[i].def.fin = true;
+
+        ASSERT_SUCCESS(s_send_frame(&tester, &sending[i]));
+        testing_channel_drain_queued_tasks(&tester.testing_channel);
+    }
+
+    /* Nothing is written until the delay passes */
+    struct aws_linked_list *io_msgs = testing_channel_get_written_message_queue(&tester.testing_channel);
+    ASSERT_TRUE(aws_linked_list_empty(io_msgs));
+
+    aws_thread_current_sleep(aws_timestamp_convert(
+        s_tester_options.write_coalescing_delay_us, AWS_TIMESTAMP_MICROS, AWS_TIMESTAMP_NANOS, NULL));
+    ASSERT_SUCCESS(s_drain_written_messages(&tester));
+
+    ASSERT_UINT_EQUALS(1, tester.num_written_io_messages);
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(sending); ++i) {
+        ASSERT_SUCCESS(s_check_written_message(&sending[i], i));
+    }
+
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
 TEST_CASE(websocket_handler_send_halts_if_payload_fn_returns_false) {
     (void)ctx;
     struct tester tester;
@@ -1655,6 +1960,156 @@ TEST_CASE(websocket_handler_read_halts_if_complete_fn_returns_false) {
     return AWS_OP_SUCCESS;
 }
 
+TEST_CASE(websocket_handler_read_whole_messages) {
+    (void)ctx;
+    s_tester_options.deliver_whole_messages = true;
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init(&tester, allocator));
+
+    uint8_t big_payload[10000];
+    for (size_t i = 0; i < sizeof(big_payload); ++i) {
+        big_payload[i] = (uint8_t)i;
+    }
+
+    struct readpush_frame pushing[] = {
+        {
+            .payload = aws_byte_cursor_from_c_str("Uno."),
+            .def =
+                {
+                    .opcode = AWS_WEBSOCKET_OPCODE_TEXT,
+                    .fin = false,
+                },
+        },
+        {
+            .payload = aws_byte_cursor_from_c_str("ping"),
+            .def =
+                {
+                    .opcode = AWS_WEBSOCKET_OPCODE_PING,
+                    .fin = true,
+                },
+        },
+        {
+            .payload = aws_byte_cursor_from_c_str("Dos."),
+            .def =
+                {
+                    .opcode = AWS_WEBSOCKET_OPCODE_CONTINUATION,
+                    .fin = false,
+                },
+        },
+        {
+            .payload = aws_byte_cursor_from_c_str("Tres."),
+            .def =
+                {
+                    .opcode = AWS_WEBSOCKET_OPCODE_CONTINUATION,
+                    .fin = true,
+                },
+        },
+        {
+            .payload = aws_byte_cursor_from_array(big_payload, 1000),
+            .def =
+                {
+                    .opcode = AWS_WEBSOCKET_OPCODE_BINARY,
+                    .fin = false,
+                },
+        },
+        {
+            /* Doesn't fit in the buffer the message started with */
+            .payload = aws_byte_cursor_from_array(big_payload + 1000, sizeof(big_payload) - 1000),
+            .def =
+                {
+                    .opcode = AWS_WEBSOCKET_OPCODE_CONTINUATION,
+                    .fin = true,
+                },
+        },
+    };
+
+    s_set_readpush_frames(&tester, pushing, AWS_ARRAY_SIZE(pushing));
+    struct readpush_options options = {.message_size = 3};
+    ASSERT_SUCCESS(s_do_readpush(&tester, options));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    /* Only the PING went to the frame callbacks */
+    ASSERT_UINT_EQUALS(1, tester.num_incoming_frames);
+    ASSERT_UINT_EQUALS(AWS_WEBSOCKET_OPCODE_PING, tester.incoming_frames[0].def.opcode);
+
+    ASSERT_UINT_EQUALS(2, tester.num_incoming_messages);
+    ASSERT_UINT_EQUALS(AWS_WEBSOCKET_OPCODE_TEXT, tester.incoming_messages[0]->opcode);
+    ASSERT_FALSE(tester.incoming_messages[0]->compressed);
+    ASSERT_BIN_ARRAYS_EQUALS(
+        "Uno.Dos.Tres.", 13, tester.incoming_messages[0]->payload.ptr, tester.incoming_messages[0]->payload.len);
+    ASSERT_UINT_EQUALS(AWS_WEBSOCKET_OPCODE_BINARY, tester.incoming_messages[1]->opcode);
+    ASSERT_BIN_ARRAYS_EQUALS(
+        big_payload,
+        sizeof(big_payload),
+        tester.incoming_messages[1]->payload.ptr,
+        tester.incoming_messages[1]->payload.len);
+
+    /* A released buffer is used again for the next message of its size */
+    const uint8_t *released_ptr = tester.incoming_messages[0]->payload.ptr;
+    aws_websocket_incoming_message_release(tester.incoming_messages[0]);
+    tester.incoming_messages[0] = tester.incoming_messages[--tester.num_incoming_messages];
+
+    struct readpush_frame pushing_again[] = {
+        {
+            .payload = aws_byte_cursor_from_c_str("Cuatro."),
+            .def =
+                {
+                    .opcode = AWS_WEBSOCKET_OPCODE_TEXT,
+                    .fin = true,
+                },
+        },
+    };
+    s_set_readpush_frames(&tester, pushing_again, AWS_ARRAY_SIZE(pushing_again));
+    ASSERT_SUCCESS(s_do_readpush_all(&tester));
+    testing_channel_drain_queued_tasks(&tester.testing_channel);
+
+    ASSERT_UINT_EQUALS(2, tester.num_incoming_messages);
+    ASSERT_PTR_EQUALS(released_ptr, tester.incoming_messages[1]->payload.ptr);
+    ASSERT_BIN_ARRAYS_EQUALS(
+        "Cuatro.", 7, tester.incoming_messages[1]->payload.ptr, tester.incoming_messages[1]->payload.len);
+
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
+TEST_CASE(websocket_handler_read_message_too_big) {
+    (void)ctx;
+    s_tester_options.deliver_whole_messages = true;
+    s_tester_options.max_incoming_message_size = 10;
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init(&tester, allocator));
+
+    struct readpush_frame pushing[] = {
+        {
+            .payload = aws_byte_cursor_from_c_str("12345"),
+            .def =
+                {
+                    .opcode = AWS_WEBSOCKET_OPCODE_BINARY,
+                    .fin = false,
+                },
+        },
+        {
+            .payload = aws_byte_cursor_from_c_str("678901"),
+            .def =
+                {
+                    .opcode = AWS_WEBSOCKET_OPCODE_CONTINUATION,
+                    .fin = true,
+                },
+        },
+    };
+
+    s_set_readpush_frames(&tester, pushing, AWS_ARRAY_SIZE(pushing));
+    ASSERT_SUCCESS(s_do_readpush_all(&tester));
+    s_drain_written_messages(&tester);
+
+    /* The partial message was dropped, and the connection closed */
+    ASSERT_UINT_EQUALS(0, tester.num_incoming_messages);
+    ASSERT_TRUE(testing_channel_is_shutdown_completed(&tester.testing_channel));
+
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
 static int s_window_manual_increment_common(struct aws_allocator *allocator, bool on_thread) {
     struct tester tester;
     s_tester_options.manual_window_update = true;
@@ -1881,6 +2336,61 @@ TEST_CASE(websocket_handler_wont_send_pong_after_close_frame) {
     return AWS_OP_SUCCESS;
 }
 
+/* Once the websocket is warm, sending and receiving a frame shouldn't allocate at all.
+ * Outgoing frames come from the websocket's pool, and incoming frames are decoded in place */
+#define WEBSOCKET_ALLOCATIONS_PER_FRAME 0
+
+/* Hold frames to an allocation budget.
+ * Only the websocket gets the counting allocator, the test's own bookkeeping isn't counted */
+TEST_CASE(websocket_handler_frame_allocation_budget) {
+    (void)ctx;
+    struct counting_allocator counting;
+    counting_allocator_init(&counting, allocator);
+    s_tester_options.websocket_alloc = &counting.base;
+
+    struct tester tester;
+    ASSERT_SUCCESS(s_tester_init(&tester, allocator));
+
+    enum { WARMUP_FRAMES = 10, MEASURED_FRAMES = 50, TOTAL_FRAMES = WARMUP_FRAMES + MEASURED_FRAMES };
+    struct send_tester sending[TOTAL_FRAMES];
+    struct readpush_frame pushing[TOTAL_FRAMES];
+    AWS_ZERO_ARRAY(sending);
+    AWS_ZERO_ARRAY(pushing);
+    for (size_t i = 0; i < TOTAL_FRAMES; ++i) {
+        sending[i].payload = aws_byte_cursor_from_c_str("Hickory dickory dock.");
+        sending[i].def.opcode = AWS_WEBSOCKET_OPCODE_BINARY;
+        sending[i].def.fin = true;
+        pushing[i].payload = aws_byte_cursor_from_c_str("The mouse ran up the clock.");
+        pushing[i].def.opcode = AWS_WEBSOCKET_OPCODE_BINARY;
+        pushing[i].def.fin = true;
+    }
+    s_set_readpush_frames(&tester, pushing, TOTAL_FRAMES);
+
+    /* Each frame goes all the way through, in each direction, before the next */
+    struct readpush_options one_frame = {.num_frames = 1};
+    size_t num_allocations_before = 0;
+    for (size_t i = 0; i < TOTAL_FRAMES; ++i) {
+        if (i == WARMUP_FRAMES) {
+            num_allocations_before = counting.num_allocations;
+        }
+        ASSERT_SUCCESS(s_send_frame(&tester, &sending[i]));
+        ASSERT_SUCCESS(s_drain_written_messages(&tester));
+        ASSERT_SUCCESS(s_do_readpush(&tester, one_frame));
+        testing_channel_drain_queued_tasks(&tester.testing_channel);
+    }
+
+    ASSERT_SUCCESS(counting_allocator_check_budget(
+        &counting, "frame", num_allocations_before, MEASURED_FRAMES, WEBSOCKET_ALLOCATIONS_PER_FRAME));
+
+    for (size_t i = 0; i < TOTAL_FRAMES; ++i) {
+        ASSERT_SUCCESS(s_check_written_message(&sending[i], i));
+        ASSERT_SUCCESS(s_readpush_check(&tester, i, AWS_ERROR_SUCCESS));
+    }
+
+    ASSERT_SUCCESS(s_tester_clean_up(&tester));
+    return AWS_OP_SUCCESS;
+}
+
 TEST_CASE(websocket_midchannel_read_message) {
     (void)ctx;
     struct tester tester;
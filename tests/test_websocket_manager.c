@@ -0,0 +1,620 @@
+/**
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/http/private/websocket_manager_system_vtable.h>
+
+#include <aws/common/clock.h>
+#include <aws/common/condition_variable.h>
+#include <aws/common/mutex.h>
+#include <aws/http/request_response.h>
+#include <aws/io/channel_bootstrap.h>
+#include <aws/io/event_loop.h>
+#include <aws/io/host_resolver.h>
+#include <aws/io/socket.h>
+#include <aws/testing/aws_test_harness.h>
+
+#ifdef _MSC_VER
+#    pragma warning(disable : 4204) /* non-constant aggregate initializer */
+#endif
+
+#define TEST_CASE(NAME)                                                                                                \
+    AWS_TEST_CASE(NAME, s_test_##NAME);                                                                                \
+    static int s_test_##NAME(struct aws_allocator *allocator, void *ctx)
+
+#define MAX_MOCK_WEBSOCKETS 16
+#define WAIT_TIMEOUT_SEC 10
+#define WAIT_TIMEOUT_NS                                                                                                \
+    ((int64_t)aws_timestamp_convert(WAIT_TIMEOUT_SEC, AWS_TIMESTAMP_SECS, AWS_TIMESTAMP_NANOS, NULL))
+
+static int s_mock_websocket_client_connect(const struct aws_websocket_client_connection_options *options);
+static int s_mock_websocket_send_frame(
+    struct aws_websocket *websocket,
+    const struct aws_websocket_send_frame_options *options);
+static void s_mock_websocket_close(struct aws_websocket *websocket, bool free_scarce_resources_immediately);
+static void s_mock_websocket_release(struct aws_websocket *websocket);
+static bool s_mock_websocket_is_open(struct aws_websocket *websocket);
+static int s_mock_get_monotonic_time(uint64_t *time);
+
+static const struct aws_websocket_manager_system_vtable s_mock_system_vtable = {
+    .aws_websocket_client_connect = s_mock_websocket_client_connect,
+    .aws_websocket_send_frame = s_mock_websocket_send_frame,
+    .aws_websocket_close = s_mock_websocket_close,
+    .aws_websocket_release = s_mock_websocket_release,
+    .aws_websocket_is_open = s_mock_websocket_is_open,
+    .get_monotonic_time = s_mock_get_monotonic_time,
+};
+
+/* Stands in for a websocket the manager connected. Its address is passed around as the struct aws_websocket * */
+struct mock_websocket {
+    aws_websocket_on_connection_setup_fn *on_connection_setup;
+    aws_websocket_on_connection_shutdown_fn *on_connection_shutdown;
+    aws_websocket_on_incoming_frame_begin_fn *on_incoming_frame_begin;
+    aws_websocket_on_incoming_frame_complete_fn *on_incoming_frame_complete;
+    void *user_data;
+
+    bool is_setup_called;
+    bool is_set_up;
+    bool is_open;
+    bool is_close_called;
+    bool is_released;
+    size_t ping_count;
+};
+
+/* Needs to be a static singleton so that mock functions can access it */
+static struct tester {
+    struct aws_allocator *alloc;
+    struct aws_event_loop_group *event_loop_group;
+    struct aws_host_resolver *host_resolver;
+    struct aws_client_bootstrap *client_bootstrap;
+    struct aws_websocket_manager *manager;
+
+    /* Everything below is protected by the lock, mocks may be called from the manager's event loop */
+    struct aws_mutex lock;
+    struct aws_condition_variable signal;
+
+    uint64_t mock_time;
+
+    struct mock_websocket websockets[MAX_MOCK_WEBSOCKETS];
+    size_t websocket_count;
+    size_t released_count;
+
+    struct aws_websocket *acquired_websockets[MAX_MOCK_WEBSOCKETS];
+    size_t acquired_count;
+    int acquire_error_code;
+    size_t acquire_failed_count;
+
+    size_t frames_forwarded;
+    size_t shutdowns_forwarded;
+
+    bool is_shutdown_complete;
+} s_tester;
+
+static int s_mock_get_monotonic_time(uint64_t *time) {
+    aws_mutex_lock(&s_tester.lock);
+    *time = s_tester.mock_time;
+    aws_mutex_unlock(&s_tester.lock);
+    return AWS_OP_SUCCESS;
+}
+
+static void s_advance_mock_time_ms(uint64_t ms) {
+    aws_mutex_lock(&s_tester.lock);
+    s_tester.mock_time += aws_timestamp_convert(ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+    aws_mutex_unlock(&s_tester.lock);
+}
+
+static struct aws_websocket *s_websocket(size_t index) {
+    return (struct aws_websocket *)&s_tester.websockets[index];
+}
+
+static int s_mock_websocket_client_connect(const struct aws_websocket_client_connection_options *options) {
+    AWS_FATAL_ASSERT(options->handshake_request);
+    struct aws_byte_cursor path;
+    AWS_FATAL_ASSERT(aws_http_message_get_request_path(options->handshake_request, &path) == AWS_OP_SUCCESS);
+    AWS_FATAL_ASSERT(aws_byte_cursor_eq_c_str(&path, "/chat"));
+
+    aws_mutex_lock(&s_tester.lock);
+    AWS_FATAL_ASSERT(s_tester.websocket_count < MAX_MOCK_WEBSOCKETS);
+    struct mock_websocket *mock = &s_tester.websockets[s_tester.websocket_count++];
+    mock->on_connection_setup = options->on_connection_setup;
+    mock->on_connection_shutdown = options->on_connection_shutdown;
+    mock->on_incoming_frame_begin = options->on_incoming_frame_begin;
+    mock->on_incoming_frame_complete = options->on_incoming_frame_complete;
+    mock->user_data = options->user_data;
+    aws_condition_variable_notify_all(&s_tester.signal);
+    aws_mutex_unlock(&s_tester.lock);
+    return AWS_OP_SUCCESS;
+}
+
+static int s_mock_websocket_send_frame(
+    struct aws_websocket *websocket,
+    const struct aws_websocket_send_frame_options *options) {
+
+    struct mock_websocket *mock = (struct mock_websocket *)websocket;
+    AWS_FATAL_ASSERT(options->opcode == AWS_WEBSOCKET_OPCODE_PING);
+
+    aws_mutex_lock(&s_tester.lock);
+    AWS_FATAL_ASSERT(!mock->is_released);
+    ++mock->ping_count;
+    aws_condition_variable_notify_all(&s_tester.signal);
+    aws_mutex_unlock(&s_tester.lock);
+    return AWS_OP_SUCCESS;
+}
+
+static void s_mock_websocket_close(struct aws_websocket *websocket, bool free_scarce_resources_immediately) {
+    (void)free_scarce_resources_immediately;
+    struct mock_websocket *mock = (struct mock_websocket *)websocket;
+
+    aws_mutex_lock(&s_tester.lock);
+    AWS_FATAL_ASSERT(!mock->is_released);
+    mock->is_open = false;
+    mock->is_close_called = true;
+    aws_condition_variable_notify_all(&s_tester.signal);
+    aws_mutex_unlock(&s_tester.lock);
+}
+
+static void s_mock_websocket_release(struct aws_websocket *websocket) {
+    struct mock_websocket *mock = (struct mock_websocket *)websocket;
+
+    aws_mutex_lock(&s_tester.lock);
+    AWS_FATAL_ASSERT(!mock->is_released);
+    mock->is_released = true;
+    ++s_tester.released_count;
+    aws_mutex_unlock(&s_tester.lock);
+}
+
+static bool s_mock_websocket_is_open(struct aws_websocket *websocket) {
+    struct mock_websocket *mock = (struct mock_websocket *)websocket;
+
+    aws_mutex_lock(&s_tester.lock);
+    bool is_open = mock->is_open;
+    aws_mutex_unlock(&s_tester.lock);
+    return is_open;
+}
+
+static void s_on_shutdown_complete(void *user_data) {
+    (void)user_data;
+    aws_mutex_lock(&s_tester.lock);
+    s_tester.is_shutdown_complete = true;
+    aws_condition_variable_notify_all(&s_tester.signal);
+    aws_mutex_unlock(&s_tester.lock);
+}
+
+struct tester_options {
+    size_t max_websockets;
+    size_t min_idle_websockets;
+    uint64_t max_websocket_idle_ms;
+    uint64_t ping_interval_ms;
+};
+
+static struct aws_event_loop *s_new_event_loop(
+    struct aws_allocator *alloc,
+    const struct aws_event_loop_options *options,
+    void *new_loop_user_data) {
+    (void)new_loop_user_data;
+
+    return aws_event_loop_new_default(alloc, options->clock);
+}
+
+static int s_tester_init(struct aws_allocator *alloc, const struct tester_options *options) {
+    aws_http_library_init(alloc);
+
+    AWS_ZERO_STRUCT(s_tester);
+    s_tester.alloc = alloc;
+    ASSERT_SUCCESS(aws_mutex_init(&s_tester.lock));
+    ASSERT_SUCCESS(aws_condition_variable_init(&s_tester.signal));
+
+    aws_websocket_manager_set_system_vtable(&s_mock_system_vtable);
+
+    /* The event loop runs on mock time too, so the manager's maintenance task only runs as the test advances it */
+    s_tester.event_loop_group =
+        aws_event_loop_group_new(alloc, s_mock_get_monotonic_time, 1, s_new_event_loop, NULL, NULL);
+    ASSERT_NOT_NULL(s_tester.event_loop_group);
+    struct aws_host_resolver_default_options resolver_options = {
+        .el_group = s_tester.event_loop_group,
+        .max_entries = 8,
+    };
+    s_tester.host_resolver = aws_host_resolver_new_default(alloc, &resolver_options);
+    struct aws_client_bootstrap_options bootstrap_options = {
+        .event_loop_group = s_tester.event_loop_group,
+        .host_resolver = s_tester.host_resolver,
+    };
+    s_tester.client_bootstrap = aws_client_bootstrap_new(alloc, &bootstrap_options);
+    ASSERT_NOT_NULL(s_tester.client_bootstrap);
+
+    struct aws_socket_options socket_options = {
+        .type = AWS_SOCKET_STREAM,
+        .domain = AWS_SOCKET_IPV4,
+        .connect_timeout_ms = 10000,
+    };
+
+    struct aws_http_header protocol_header = {
+        .name = aws_byte_cursor_from_c_str("Sec-WebSocket-Protocol"),
+        .value = aws_byte_cursor_from_c_str("chat"),
+    };
+
+    struct aws_websocket_manager_options manager_options = {
+        .bootstrap = s_tester.client_bootstrap,
+        .socket_options = &socket_options,
+        .host = aws_byte_cursor_from_c_str("example.com"),
+        .port = 80,
+        .path = aws_byte_cursor_from_c_str("/chat"),
+        .handshake_header_array = &protocol_header,
+        .num_handshake_headers = 1,
+        .max_websockets = options->max_websockets,
+        .min_idle_websockets = options->min_idle_websockets,
+        .max_websocket_idle_ms = options->max_websocket_idle_ms,
+        .ping_interval_ms = options->ping_interval_ms,
+        .shutdown_complete_callback = s_on_shutdown_complete,
+    };
+    s_tester.manager = aws_websocket_manager_new(alloc, &manager_options);
+    ASSERT_NOT_NULL(s_tester.manager);
+    return AWS_OP_SUCCESS;
+}
+
+static bool s_is_shutdown_complete(void *context) {
+    (void)context;
+    return s_tester.is_shutdown_complete;
+}
+
+static void s_setup_websocket(size_t index, int error_code);
+
+/* Release the manager, fail the connects still in progress, and shut down every websocket it closes,
+ * until it's gone */
+static int s_tester_clean_up(void) {
+    aws_websocket_manager_release(s_tester.manager);
+
+    for (size_t i = 0; i < s_tester.websocket_count; ++i) {
+        if (!s_tester.websockets[i].is_setup_called) {
+            s_setup_websocket(i, AWS_ERROR_HTTP_CONNECTION_CLOSED);
+        }
+    }
+
+    for (size_t i = 0; i < s_tester.websocket_count; ++i) {
+        struct mock_websocket *mock = &s_tester.websockets[i];
+        aws_mutex_lock(&s_tester.lock);
+        bool shut_down = mock->is_set_up && mock->is_close_called && !mock->is_released;
+        aws_mutex_unlock(&s_tester.lock);
+        if (shut_down) {
+            mock->on_connection_shutdown(s_websocket(i), AWS_ERROR_SUCCESS, mock->user_data);
+        }
+    }
+
+    aws_mutex_lock(&s_tester.lock);
+    ASSERT_SUCCESS(aws_condition_variable_wait_for_pred(
+        &s_tester.signal, &s_tester.lock, WAIT_TIMEOUT_NS, s_is_shutdown_complete, NULL));
+    aws_mutex_unlock(&s_tester.lock);
+
+    aws_client_bootstrap_release(s_tester.client_bootstrap);
+    aws_host_resolver_release(s_tester.host_resolver);
+    aws_event_loop_group_release(s_tester.event_loop_group);
+
+    aws_websocket_manager_set_system_vtable(NULL);
+    /* Waits for the event loop threads, which read the mock time until they're done */
+    aws_http_library_clean_up();
+    aws_condition_variable_clean_up(&s_tester.signal);
+    aws_mutex_clean_up(&s_tester.lock);
+    return AWS_OP_SUCCESS;
+}
+
+static void s_setup_websocket(size_t index, int error_code) {
+    struct mock_websocket *mock = &s_tester.websockets[index];
+    struct aws_websocket_on_connection_setup_data setup = {
+        .error_code = error_code,
+    };
+    mock->is_setup_called = true;
+    if (!error_code) {
+        aws_mutex_lock(&s_tester.lock);
+        mock->is_set_up = true;
+        mock->is_open = true;
+        aws_mutex_unlock(&s_tester.lock);
+        setup.websocket = s_websocket(index);
+    }
+    mock->on_connection_setup(&setup, mock->user_data);
+}
+
+static void s_shutdown_websocket(size_t index) {
+    struct mock_websocket *mock = &s_tester.websockets[index];
+    aws_mutex_lock(&s_tester.lock);
+    mock->is_open = false;
+    aws_mutex_unlock(&s_tester.lock);
+    mock->on_connection_shutdown(s_websocket(index), AWS_ERROR_SUCCESS, mock->user_data);
+}
+
+static bool s_send_frame(size_t index, uint8_t opcode) {
+    struct mock_websocket *mock = &s_tester.websockets[index];
+    struct aws_websocket_incoming_frame frame = {
+        .opcode = opcode,
+        .fin = true,
+    };
+    if (!mock->on_incoming_frame_begin(s_websocket(index), &frame, mock->user_data)) {
+        return false;
+    }
+    return mock->on_incoming_frame_complete(s_websocket(index), &frame, AWS_ERROR_SUCCESS, mock->user_data);
+}
+
+static void s_on_acquired(struct aws_websocket *websocket, int error_code, void *user_data) {
+    AWS_FATAL_ASSERT(user_data == &s_tester);
+    aws_mutex_lock(&s_tester.lock);
+    if (error_code) {
+        AWS_FATAL_ASSERT(websocket == NULL);
+        s_tester.acquire_error_code = error_code;
+        ++s_tester.acquire_failed_count;
+    } else {
+        AWS_FATAL_ASSERT(s_tester.acquired_count < MAX_MOCK_WEBSOCKETS);
+        s_tester.acquired_websockets[s_tester.acquired_count++] = websocket;
+    }
+    aws_mutex_unlock(&s_tester.lock);
+}
+
+static bool s_on_frame_begin(
+    struct aws_websocket *websocket,
+    const struct aws_websocket_incoming_frame *frame,
+    void *user_data) {
+
+    (void)websocket;
+    (void)frame;
+    AWS_FATAL_ASSERT(user_data == &s_tester);
+    aws_mutex_lock(&s_tester.lock);
+    ++s_tester.frames_forwarded;
+    aws_mutex_unlock(&s_tester.lock);
+    return true;
+}
+
+static void s_on_shutdown(struct aws_websocket *websocket, int error_code, void *user_data) {
+    (void)websocket;
+    (void)error_code;
+    AWS_FATAL_ASSERT(user_data == &s_tester);
+    aws_mutex_lock(&s_tester.lock);
+    ++s_tester.shutdowns_forwarded;
+    aws_mutex_unlock(&s_tester.lock);
+}
+
+static int s_acquire(void) {
+    struct aws_websocket_manager_acquire_options options = {
+        .on_acquired = s_on_acquired,
+        .on_connection_shutdown = s_on_shutdown,
+        .on_incoming_frame_begin = s_on_frame_begin,
+        .user_data = &s_tester,
+    };
+    return aws_websocket_manager_acquire_websocket(s_tester.manager, &options);
+}
+
+struct wait_context {
+    const size_t *value;
+    size_t at_least;
+};
+
+static bool s_is_at_least(void *context) {
+    struct wait_context *wait = context;
+    return *wait->value >= wait->at_least;
+}
+
+/* Wait for something the manager's event loop does */
+static int s_wait_for_count(const size_t *value, size_t at_least) {
+    struct wait_context wait = {.value = value, .at_least = at_least};
+    aws_mutex_lock(&s_tester.lock);
+    int err =
+        aws_condition_variable_wait_for_pred(&s_tester.signal, &s_tester.lock, WAIT_TIMEOUT_NS, s_is_at_least, &wait);
+    aws_mutex_unlock(&s_tester.lock);
+    return err;
+}
+
+static bool s_is_close_called(void *context) {
+    return ((struct mock_websocket *)context)->is_close_called;
+}
+
+static int s_wait_for_close(size_t index) {
+    aws_mutex_lock(&s_tester.lock);
+    int err = aws_condition_variable_wait_for_pred(
+        &s_tester.signal, &s_tester.lock, WAIT_TIMEOUT_NS, s_is_close_called, &s_tester.websockets[index]);
+    aws_mutex_unlock(&s_tester.lock);
+    return err;
+}
+
+/* The manager connects min_idle_websockets ahead of demand, and vends them without waiting */
+TEST_CASE(websocket_manager_prewarms_min_idle) {
+    (void)ctx;
+    struct tester_options options = {
+        .max_websockets = 4,
+        .min_idle_websockets = 2,
+    };
+    ASSERT_SUCCESS(s_tester_init(allocator, &options));
+    ASSERT_UINT_EQUALS(2, s_tester.websocket_count);
+
+    s_setup_websocket(0, AWS_ERROR_SUCCESS);
+    s_setup_websocket(1, AWS_ERROR_SUCCESS);
+    ASSERT_UINT_EQUALS(2, s_tester.websocket_count);
+
+    /* Vended right away, most recently set up first. Another is connected to keep 2 idle */
+    ASSERT_SUCCESS(s_acquire());
+    ASSERT_UINT_EQUALS(1, s_tester.acquired_count);
+    ASSERT_PTR_EQUALS(s_websocket(1), s_tester.acquired_websockets[0]);
+    ASSERT_UINT_EQUALS(3, s_tester.websocket_count);
+    s_setup_websocket(2, AWS_ERROR_SUCCESS);
+
+    /* Frames go to whoever acquired the websocket */
+    ASSERT_TRUE(s_send_frame(1, AWS_WEBSOCKET_OPCODE_TEXT));
+    ASSERT_UINT_EQUALS(1, s_tester.frames_forwarded);
+
+    /* Released, it goes back to the pool, and its frames stop being forwarded */
+    ASSERT_SUCCESS(aws_websocket_manager_release_websocket(s_tester.manager, s_websocket(1)));
+    ASSERT_TRUE(s_send_frame(1, AWS_WEBSOCKET_OPCODE_PONG));
+    ASSERT_UINT_EQUALS(1, s_tester.frames_forwarded);
+    ASSERT_FALSE(s_tester.websockets[1].is_close_called);
+
+    /* Releasing a websocket twice is an error */
+    ASSERT_FAILS(aws_websocket_manager_release_websocket(s_tester.manager, s_websocket(1)));
+
+    /* Shutting down the manager closes the idle pool */
+    ASSERT_SUCCESS(s_tester_clean_up());
+    ASSERT_TRUE(s_tester.websockets[0].is_close_called);
+    ASSERT_TRUE(s_tester.websockets[1].is_close_called);
+    ASSERT_TRUE(s_tester.websockets[2].is_close_called);
+    ASSERT_UINT_EQUALS(3, s_tester.released_count);
+    return AWS_OP_SUCCESS;
+}
+
+/* Acquisitions wait for a websocket to be connected or released, max_websockets are never exceeded */
+TEST_CASE(websocket_manager_acquire_waits) {
+    (void)ctx;
+    struct tester_options options = {
+        .max_websockets = 1,
+    };
+    ASSERT_SUCCESS(s_tester_init(allocator, &options));
+    ASSERT_UINT_EQUALS(0, s_tester.websocket_count);
+
+    ASSERT_SUCCESS(s_acquire());
+    ASSERT_SUCCESS(s_acquire());
+    ASSERT_UINT_EQUALS(1, s_tester.websocket_count);
+    ASSERT_UINT_EQUALS(0, s_tester.acquired_count);
+
+    s_setup_websocket(0, AWS_ERROR_SUCCESS);
+    ASSERT_UINT_EQUALS(1, s_tester.acquired_count);
+
+    /* Handed straight to the waiting acquisition */
+    ASSERT_SUCCESS(aws_websocket_manager_release_websocket(s_tester.manager, s_websocket(0)));
+    ASSERT_UINT_EQUALS(2, s_tester.acquired_count);
+    ASSERT_PTR_EQUALS(s_websocket(0), s_tester.acquired_websockets[1]);
+    ASSERT_UINT_EQUALS(1, s_tester.websocket_count);
+
+    /* Shutting down while acquired is forwarded. It's let go of once released */
+    s_shutdown_websocket(0);
+    ASSERT_UINT_EQUALS(1, s_tester.shutdowns_forwarded);
+    ASSERT_UINT_EQUALS(0, s_tester.released_count);
+    ASSERT_SUCCESS(aws_websocket_manager_release_websocket(s_tester.manager, s_websocket(0)));
+    ASSERT_UINT_EQUALS(1, s_tester.released_count);
+
+    ASSERT_SUCCESS(s_tester_clean_up());
+    return AWS_OP_SUCCESS;
+}
+
+/* A websocket closed by the one who acquired it isn't vended again */
+TEST_CASE(websocket_manager_closed_websocket_not_reused) {
+    (void)ctx;
+    struct tester_options options = {
+        .max_websockets = 2,
+        .min_idle_websockets = 1,
+    };
+    ASSERT_SUCCESS(s_tester_init(allocator, &options));
+    s_setup_websocket(0, AWS_ERROR_SUCCESS);
+
+    ASSERT_SUCCESS(s_acquire());
+    ASSERT_PTR_EQUALS(s_websocket(0), s_tester.acquired_websockets[0]);
+    s_setup_websocket(1, AWS_ERROR_SUCCESS);
+
+    /* The user closed it before releasing it */
+    aws_mutex_lock(&s_tester.lock);
+    s_tester.websockets[0].is_open = false;
+    aws_mutex_unlock(&s_tester.lock);
+    ASSERT_SUCCESS(aws_websocket_manager_release_websocket(s_tester.manager, s_websocket(0)));
+    ASSERT_TRUE(s_tester.websockets[0].is_close_called);
+
+    ASSERT_SUCCESS(s_acquire());
+    ASSERT_PTR_EQUALS(s_websocket(1), s_tester.acquired_websockets[1]);
+
+    s_shutdown_websocket(0);
+    ASSERT_UINT_EQUALS(1, s_tester.released_count);
+    ASSERT_UINT_EQUALS(0, s_tester.shutdowns_forwarded);
+
+    /* With 0 shut down, there's room to connect another for min_idle_websockets */
+    ASSERT_UINT_EQUALS(3, s_tester.websocket_count);
+
+    ASSERT_SUCCESS(aws_websocket_manager_release_websocket(s_tester.manager, s_websocket(1)));
+    ASSERT_SUCCESS(s_tester_clean_up());
+    return AWS_OP_SUCCESS;
+}
+
+/* A failed setup fails the acquisition waiting on it, rather than leaving it waiting */
+TEST_CASE(websocket_manager_setup_failure_fails_acquisition) {
+    (void)ctx;
+    struct tester_options options = {
+        .max_websockets = 1,
+    };
+    ASSERT_SUCCESS(s_tester_init(allocator, &options));
+
+    ASSERT_SUCCESS(s_acquire());
+    ASSERT_UINT_EQUALS(1, s_tester.websocket_count);
+    s_setup_websocket(0, AWS_ERROR_HTTP_WEBSOCKET_UPGRADE_FAILURE);
+    ASSERT_UINT_EQUALS(1, s_tester.acquire_failed_count);
+    ASSERT_INT_EQUALS(AWS_ERROR_HTTP_WEBSOCKET_UPGRADE_FAILURE, s_tester.acquire_error_code);
+
+    /* Not retried until something asks for it */
+    ASSERT_UINT_EQUALS(1, s_tester.websocket_count);
+
+    /* Acquisitions still waiting when the manager shuts down fail */
+    ASSERT_SUCCESS(s_acquire());
+    ASSERT_UINT_EQUALS(2, s_tester.websocket_count);
+    ASSERT_SUCCESS(s_tester_clean_up());
+    ASSERT_UINT_EQUALS(2, s_tester.acquire_failed_count);
+    ASSERT_INT_EQUALS(AWS_ERROR_HTTP_WEBSOCKET_MANAGER_SHUTTING_DOWN, s_tester.acquire_error_code);
+    return AWS_OP_SUCCESS;
+}
+
+/* Idle websockets are pinged, and replaced if the PONG doesn't come back */
+TEST_CASE(websocket_manager_pings_idle_websockets) {
+    (void)ctx;
+    struct tester_options options = {
+        .max_websockets = 2,
+        .min_idle_websockets = 1,
+        .ping_interval_ms = 100,
+    };
+    ASSERT_SUCCESS(s_tester_init(allocator, &options));
+    s_setup_websocket(0, AWS_ERROR_SUCCESS);
+
+    s_advance_mock_time_ms(100);
+    ASSERT_SUCCESS(s_wait_for_count(&s_tester.websockets[0].ping_count, 1));
+
+    /* The PONG comes back, the next PING waits a whole interval */
+    ASSERT_TRUE(s_send_frame(0, AWS_WEBSOCKET_OPCODE_PONG));
+    s_advance_mock_time_ms(100);
+    ASSERT_SUCCESS(s_wait_for_count(&s_tester.websockets[0].ping_count, 2));
+    ASSERT_FALSE(s_tester.websockets[0].is_close_called);
+
+    /* No PONG this time. It's closed, and another is connected in its place */
+    s_advance_mock_time_ms(100);
+    ASSERT_SUCCESS(s_wait_for_close(0));
+    s_shutdown_websocket(0);
+    ASSERT_SUCCESS(s_wait_for_count(&s_tester.websocket_count, 2));
+    s_setup_websocket(1, AWS_ERROR_SUCCESS);
+
+    /* Data while idle has no one to go to, the websocket is closed */
+    ASSERT_FALSE(s_send_frame(1, AWS_WEBSOCKET_OPCODE_TEXT));
+
+    ASSERT_SUCCESS(s_tester_clean_up());
+    return AWS_OP_SUCCESS;
+}
+
+/* Websockets idle too long are closed, but never below min_idle_websockets */
+TEST_CASE(websocket_manager_culls_idle_websockets) {
+    (void)ctx;
+    struct tester_options options = {
+        .max_websockets = 3,
+        .min_idle_websockets = 1,
+        .max_websocket_idle_ms = 100,
+    };
+    ASSERT_SUCCESS(s_tester_init(allocator, &options));
+    s_setup_websocket(0, AWS_ERROR_SUCCESS);
+
+    /* Take two, so a second one is connected, then give both back */
+    ASSERT_SUCCESS(s_acquire());
+    s_setup_websocket(1, AWS_ERROR_SUCCESS);
+    ASSERT_SUCCESS(s_acquire());
+    ASSERT_UINT_EQUALS(2, s_tester.acquired_count);
+    s_setup_websocket(2, AWS_ERROR_SUCCESS);
+    ASSERT_SUCCESS(aws_websocket_manager_release_websocket(s_tester.manager, s_tester.acquired_websockets[0]));
+    ASSERT_SUCCESS(aws_websocket_manager_release_websocket(s_tester.manager, s_tester.acquired_websockets[1]));
+
+    /* The ones idle the longest go first, the most recently released is kept */
+    s_advance_mock_time_ms(100);
+    ASSERT_SUCCESS(s_wait_for_close(2));
+    ASSERT_SUCCESS(s_wait_for_close(0));
+    ASSERT_FALSE(s_tester.websockets[1].is_close_called);
+    ASSERT_UINT_EQUALS(3, s_tester.websocket_count);
+
+    s_shutdown_websocket(0);
+    s_shutdown_websocket(2);
+    ASSERT_SUCCESS(s_tester_clean_up());
+    return AWS_OP_SUCCESS;
+}